@@ -0,0 +1,298 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "RenderBenchmark.h"
+#include "Synthetic.h"
+
+#include <core/EventQueue.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences.h>
+#include <core/Timeline.h>
+#include <core/Version.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace H2Core;
+
+// Replacing the global allocation functions counts all allocations
+// done via new, including those within the core library. Allocations
+// by C libraries and Qt's containers using malloc() directly are not
+// covered.
+static std::atomic<uint64_t> nAllocations( 0 );
+
+void* operator new( std::size_t nSize )
+{
+	nAllocations.fetch_add( 1, std::memory_order_relaxed );
+	void* p = std::malloc( nSize > 0 ? nSize : 1 );
+	if ( p == nullptr ) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[]( std::size_t nSize )
+{
+	return operator new( nSize );
+}
+
+void operator delete( void* p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void* p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+/** \return Peak resident set size of the process in KiB or -1 if
+	unknown.*/
+static long peakRss()
+{
+#ifndef WIN32
+	struct rusage usage;
+	if ( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+#endif
+	return -1;
+}
+
+static Song* createHiHatSong( int nBars )
+{
+	Song* pSong = createSyntheticSong( 1, 4410, 44100 );
+	Pattern* pPattern = pSong->getPatternList()->get( 0 );
+	Instrument* pHiHat = pSong->getInstrumentList()->get( 0 );
+
+	int nStep = std::max( pPattern->get_length() / 64, 1 );
+	for ( int nPos = 0; nPos < pPattern->get_length(); nPos += nStep ) {
+		pPattern->insert_note( new Note( pHiHat, nPos, 0.8, 1.0, 1.0, -1, 0 ) );
+	}
+	setSyntheticSongLength( pSong, nBars );
+	return pSong;
+}
+
+static Song* createVoicesSong( int nBars )
+{
+	const int nInstruments = 16;
+	const int nVoices = 128;
+	Song* pSong = createSyntheticSong( nInstruments, 4 * 44100, 44100 );
+	Pattern* pPattern = pSong->getPatternList()->get( 0 );
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+
+	for ( int ii = 0; ii < nVoices; ++ii ) {
+		float fPitch = ii / nInstruments - nVoices / nInstruments / 2;
+		pPattern->insert_note( new Note( pInstrumentList->get( ii % nInstruments ),
+										 0, 0.8, 1.0, 1.0, -1, fPitch ) );
+	}
+	setSyntheticSongLength( pSong, nBars );
+	return pSong;
+}
+
+struct RenderResult {
+	QString sName;
+	bool bSuccess;
+	/** Length of the rendered file.*/
+	double fAudioSeconds;
+	double fWallSeconds;
+	uint64_t nAllocations;
+	/** Peak resident set size of the process so far.*/
+	long nPeakRss;
+};
+
+/**
+ * Exports @a pSong to @a sOutput and blocks till it is done.
+ *
+ * \param nTempoMarkers If positive, a tempo marker is added to each
+ * of the first @a nTempoMarkers bars.
+ */
+static RenderResult renderSong( Song* pSong, const QString& sName, const QString& sOutput,
+								int nSampleRate, int nTempoMarkers = 0 )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	EventQueue* pQueue = EventQueue::get_instance();
+	Preferences* pPref = Preferences::get_instance();
+
+	RenderResult result = { sName, false, 0, 0, 0, -1 };
+
+	pHydrogen->setSong( pSong );
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		pInstrumentList->get( ii )->set_currently_exported( true );
+	}
+
+	bool bUseTimelineBpm = pPref->getUseTimelineBpm();
+	if ( nTempoMarkers > 0 ) {
+		Timeline* pTimeline = pHydrogen->getTimeline();
+		pTimeline->deleteAllTempoMarkers();
+		for ( int ii = 0; ii < nTempoMarkers; ++ii ) {
+			pTimeline->addTempoMarker( ii, 80 + 10 * ii );
+		}
+		pPref->setUseTimelineBpm( true );
+	}
+
+	while ( pQueue->pop_event().type != EVENT_NONE ) {
+	}
+
+	pHydrogen->startExportSession( nSampleRate, 16 );
+
+	uint64_t nStartAllocations = nAllocations.load();
+	auto start = std::chrono::steady_clock::now();
+	pHydrogen->startExportSong( sOutput );
+
+	bool bDone = false;
+	while ( ! bDone ) {
+		Event event = pQueue->pop_event();
+		if ( event.type == EVENT_PROGRESS && event.value >= 100 ) {
+			bDone = true;
+		} else if ( event.type == EVENT_NONE ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		}
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	result.nAllocations = nAllocations.load() - nStartAllocations;
+	result.fWallSeconds = std::chrono::duration<double>( end - start ).count();
+	result.nPeakRss = peakRss();
+
+	pHydrogen->stopExportSession();
+
+	if ( nTempoMarkers > 0 ) {
+		pHydrogen->getTimeline()->deleteAllTempoMarkers();
+		pPref->setUseTimelineBpm( bUseTimelineBpm );
+	}
+
+	auto pRendered = Sample::load( sOutput );
+	if ( pRendered != nullptr && pRendered->get_sample_rate() > 0 ) {
+		result.fAudioSeconds = pRendered->get_frames() /
+			static_cast<double>( pRendered->get_sample_rate() );
+		result.bSuccess = result.fAudioSeconds > 0;
+	}
+	QFile::remove( sOutput );
+
+	return result;
+}
+
+int runRenderBenchmark( const QStringList& songs, const QString& sJsonFile, int nSampleRate )
+{
+	QTemporaryDir dir;
+	QString sOutput = dir.filePath( "render.wav" );
+
+	std::vector<RenderResult> results;
+	for ( const auto& sSong : songs ) {
+		Song* pSong = Song::load( sSong );
+		if ( pSong == nullptr ) {
+			results.push_back( { QFileInfo( sSong ).fileName(), false, 0, 0, 0, -1 } );
+			continue;
+		}
+		results.push_back( renderSong( pSong, QFileInfo( sSong ).fileName(), sOutput, nSampleRate ) );
+	}
+	results.push_back( renderSong( createHiHatSong( 16 ), "stress-hihat-1/64", sOutput, nSampleRate ) );
+	results.push_back( renderSong( createVoicesSong( 16 ), "stress-128-voices", sOutput, nSampleRate ) );
+	results.push_back( renderSong( createHiHatSong( 20 ), "stress-20-tempo-markers", sOutput,
+								   nSampleRate, 20 ) );
+
+	bool bSuccess = true;
+	QJsonArray jsonResults;
+	for ( const auto& result : results ) {
+		QJsonObject jsonResult;
+		jsonResult[ "name" ] = result.sName;
+		jsonResult[ "success" ] = result.bSuccess;
+		if ( result.bSuccess ) {
+			jsonResult[ "audio_seconds" ] = result.fAudioSeconds;
+			jsonResult[ "wall_seconds" ] = result.fWallSeconds;
+			jsonResult[ "realtime_factor" ] = result.fWallSeconds > 0 ?
+				result.fAudioSeconds / result.fWallSeconds : 0;
+			jsonResult[ "allocations" ] = static_cast<double>( result.nAllocations );
+			jsonResult[ "allocations_per_second" ] = result.fWallSeconds > 0 ?
+				result.nAllocations / result.fWallSeconds : 0;
+			jsonResult[ "peak_rss_kib" ] = static_cast<double>( result.nPeakRss );
+		} else {
+			bSuccess = false;
+		}
+		jsonResults.append( jsonResult );
+	}
+
+	Preferences* pPref = Preferences::get_instance();
+	QJsonObject json;
+	json[ "version" ] = QString::fromStdString( get_version() );
+	json[ "date" ] = QDateTime::currentDateTimeUtc().toString( Qt::ISODate );
+	json[ "sample_rate" ] = nSampleRate;
+	json[ "buffer_size" ] = static_cast<int>( pPref->m_nBufferSize );
+	json[ "sampler_workers" ] = pPref->m_nSamplerWorkers;
+	json[ "songs" ] = jsonResults;
+
+	QByteArray data = QJsonDocument( json ).toJson();
+	if ( sJsonFile.isEmpty() ) {
+		fwrite( data.constData(), 1, data.size(), stdout );
+	} else {
+		QFile file( sJsonFile );
+		if ( ! file.open( QIODevice::WriteOnly ) || file.write( data ) != data.size() ) {
+			fprintf( stderr, "Unable to write [%s]\n", sJsonFile.toLocal8Bit().constData() );
+			return 1;
+		}
+	}
+
+	return bSuccess ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef BENCHMARK_RENDER_H
+#define BENCHMARK_RENDER_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * Exports @a songs followed by a set of generated stress songs
+ * through the DiskWriterDriver and writes the throughput of each of
+ * them as JSON to @a sJsonFile (stdout if empty).
+ *
+ * The stress songs consist of
+ * - a hi-hat playing 1/64 notes,
+ * - 128 pitched notes of long samples at the start of each bar,
+ * - and the hi-hat song with a tempo marker at each of its 20 bars.
+ *
+ * \return 0 if all songs were rendered successfully and 1 otherwise.
+ */
+int runRenderBenchmark( const QStringList& songs, const QString& sJsonFile, int nSampleRate );
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "Synthetic.h"
+
+#include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace H2Core;
+
+std::shared_ptr<Sample> createNoiseSample( int nFrames, int nSampleRate, unsigned nSeed )
+{
+	float* pData_L = new float[ nFrames ];
+	float* pData_R = new float[ nFrames ];
+	std::minstd_rand generator( nSeed + 1 );
+	std::uniform_real_distribution<float> distribution( -1.0, 1.0 );
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		float fEnvelope = std::exp( -3.0f * ii / nFrames );
+		pData_L[ ii ] = distribution( generator ) * fEnvelope;
+		pData_R[ ii ] = distribution( generator ) * fEnvelope;
+	}
+	return std::make_shared<Sample>( QString( "noise_%1.wav" ).arg( nSeed ),
+									 nFrames, nSampleRate, pData_L, pData_R );
+}
+
+Song* createSyntheticSong( int nInstruments, int nSampleFrames, int nSampleRate )
+{
+	Song* pSong = Song::getDefaultSong();
+	pSong->getComponents()->push_back( new DrumkitComponent( 0, "Main" ) );
+
+	InstrumentList* pInstrumentList = new InstrumentList();
+	for ( int ii = 0; ii < nInstruments; ++ii ) {
+		Instrument* pInstrument = new Instrument( ii, QString( "Noise %1" ).arg( ii ) );
+		InstrumentComponent* pComponent = new InstrumentComponent( 0 );
+		pComponent->set_layer( new InstrumentLayer( createNoiseSample( nSampleFrames, nSampleRate, ii ) ), 0 );
+		pInstrument->get_components()->push_back( pComponent );
+		pInstrumentList->add( pInstrument );
+	}
+	delete pSong->getInstrumentList();
+	pSong->setInstrumentList( pInstrumentList );
+
+	return pSong;
+}
+
+void setSyntheticSongLength( Song* pSong, int nBars )
+{
+	std::vector<PatternList*>* pColumns = pSong->getPatternGroupVector();
+	for ( auto pColumn : *pColumns ) {
+		pColumn->clear();
+		delete pColumn;
+	}
+	pColumns->clear();
+
+	for ( int ii = 0; ii < nBars; ++ii ) {
+		PatternList* pColumn = new PatternList();
+		pColumn->add( pSong->getPatternList()->get( 0 ) );
+		pColumns->push_back( pColumn );
+	}
+}
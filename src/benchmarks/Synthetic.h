@@ -0,0 +1,45 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef BENCHMARK_SYNTHETIC_H
+#define BENCHMARK_SYNTHETIC_H
+
+#include <memory>
+
+namespace H2Core {
+	class Sample;
+	class Song;
+}
+
+/** Decaying stereo noise burst of @a nFrames.*/
+std::shared_ptr<H2Core::Sample> createNoiseSample( int nFrames, int nSampleRate, unsigned nSeed );
+
+/**
+ * Creates a Song of @a nInstruments, each playing a noise burst of
+ * @a nSampleFrames, and a single empty pattern.
+ */
+H2Core::Song* createSyntheticSong( int nInstruments, int nSampleFrames, int nSampleRate );
+
+/** Repeats the first pattern of @a pSong @a nBars times.*/
+void setSyntheticSongLength( H2Core::Song* pSong, int nBars );
+
+#endif
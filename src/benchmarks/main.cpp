@@ -0,0 +1,270 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+/*
+ * Measures the rendering speed of the Sampler.
+ *
+ * The engine is driven through the FakeDriver using a synthetic
+ * drumkit of long noise bursts, so the voices triggered at the
+ * beginning of each run keep on playing till its end. For each
+ * buffer size, interpolation mode, and filter setting the time spent
+ * in Sampler::process() is reported along with the number of voices
+ * a single core is able to render in realtime.
+ *
+ * With --render whole songs are exported instead, see
+ * runRenderBenchmark().
+ */
+
+#include "RenderBenchmark.h"
+#include "Synthetic.h"
+
+#include <core/AudioEngine.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/NotePool.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Sampler/Interpolation.h>
+#include <core/Sampler/Sampler.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace H2Core;
+
+/** Number of instruments of the synthetic drumkit.*/
+static const int nKitSize = 16;
+/** Sample rate of the FakeDriver.*/
+static const int nDriverSampleRate = 44100;
+
+struct RenderMode {
+	const char* sName;
+	/** Samples recorded at a different rate than the driver's are
+		resampled using #interpolateMode.*/
+	int nSampleRate;
+	Interpolation::InterpolateMode interpolateMode;
+};
+
+static const RenderMode renderModes[] = {
+	{ "none", nDriverSampleRate, Interpolation::InterpolateMode::Linear },
+	{ "linear", 48000, Interpolation::InterpolateMode::Linear },
+	{ "cosine", 48000, Interpolation::InterpolateMode::Cosine },
+	{ "third", 48000, Interpolation::InterpolateMode::Third },
+	{ "cubic", 48000, Interpolation::InterpolateMode::Cubic },
+	{ "hermite", 48000, Interpolation::InterpolateMode::Hermite },
+	{ "sinc", 48000, Interpolation::InterpolateMode::Sinc },
+};
+
+static Song* createSong( int nFrames, int nSampleRate, bool bFilter )
+{
+	Song* pSong = createSyntheticSong( nKitSize, nFrames, nSampleRate );
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		Instrument* pInstrument = pInstrumentList->get( ii );
+		pInstrument->set_filter_active( bFilter );
+		pInstrument->set_filter_cutoff( 0.5 );
+		pInstrument->set_filter_resonance( 0.5 );
+	}
+	return pSong;
+}
+
+/**
+ * Triggers @a nVoices notes and renders @a nFrames in buffers of
+ * @a nBufferSize.
+ *
+ * \return Average time in microseconds spent in Sampler::process()
+ * per buffer or a negative value if voices did end prematurely.
+ */
+static double measure( Song* pSong, int nVoices, int nBufferSize, int nFrames )
+{
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+
+	pSampler->stopPlayingNotes();
+	for ( int ii = 0; ii < nVoices; ++ii ) {
+		Note* pNote = new ( NotePool::get_instance() )
+			Note( pInstrumentList->get( ii % pInstrumentList->size() ),
+				  0, 0.8, 1.0, 1.0, -1, 0 );
+		pSampler->noteOn( pNote );
+	}
+
+	// Let first-use allocations happen outside of the measurement.
+	pSampler->process( nBufferSize, pSong );
+
+	int nBuffers = std::max( nFrames / nBufferSize, 1 );
+	auto start = std::chrono::steady_clock::now();
+	for ( int ii = 0; ii < nBuffers; ++ii ) {
+		pSampler->process( nBufferSize, pSong );
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	bool bComplete = pSampler->getPlayingNotesNumber() == nVoices;
+	pSampler->stopPlayingNotes();
+	if ( ! bComplete ) {
+		return -1;
+	}
+
+	return std::chrono::duration<double, std::micro>( end - start ).count() / nBuffers;
+}
+
+/** \return Average time in milliseconds it takes Sample::load() to
+	read a WAV file of @a nFrames.*/
+static double measureSampleLoad( int nFrames, int nRuns )
+{
+	QTemporaryDir dir;
+	QString sPath = dir.filePath( "noise.wav" );
+	if ( ! createNoiseSample( nFrames, nDriverSampleRate, 0 )->write( sPath ) ) {
+		return -1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for ( int ii = 0; ii < nRuns; ++ii ) {
+		if ( Sample::load( sPath ) == nullptr ) {
+			return -1;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::milli>( end - start ).count() / nRuns;
+}
+
+int main( int argc, char** argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QCommandLineParser parser;
+	QCommandLineOption voicesOption( QStringList() << "n" << "voices", "Number of voices rendered simultaneously", "Voices", "64" );
+	QCommandLineOption bufferSizesOption( QStringList() << "b" << "buffer-sizes", "Comma-separated list of buffer sizes", "Sizes", "64,256,1024" );
+	QCommandLineOption secondsOption( QStringList() << "s" << "seconds", "Length of audio rendered per run", "Seconds", "2" );
+	QCommandLineOption workersOption( QStringList() << "w" << "workers", "Number of additional sampler worker threads", "Workers", "0" );
+	QCommandLineOption dataOption( QStringList() << "P" << "data", "Use an alternate system data path", "Path" );
+	QCommandLineOption renderOption( QStringList() << "r" << "render", "Export songs through the DiskWriterDriver instead. Defaults to the songs of the functional tests" );
+	QCommandLineOption jsonOption( QStringList() << "j" << "json", "Write the results of --render to a file instead of stdout", "File" );
+	QCommandLineOption verboseOption( QStringList() << "V" << "verbose", "Level, if present, may be None, Error, Warning, Info, Debug or 0xHHHH","Level");
+	parser.addHelpOption();
+	parser.addOption( voicesOption );
+	parser.addOption( bufferSizesOption );
+	parser.addOption( secondsOption );
+	parser.addOption( workersOption );
+	parser.addOption( dataOption );
+	parser.addOption( renderOption );
+	parser.addOption( jsonOption );
+	parser.addOption( verboseOption );
+	parser.addPositionalArgument( "songs", "Songs exported with --render", "[songs...]" );
+	parser.process( app );
+
+	int nVoices = std::max( parser.value( voicesOption ).toInt(), 1 );
+	int nFrames = std::max( parser.value( secondsOption ).toInt(), 1 ) * nDriverSampleRate;
+	int nWorkers = std::max( parser.value( workersOption ).toInt(), 0 );
+	std::vector<int> bufferSizes;
+	for ( const auto& sSize : parser.value( bufferSizesOption ).split( ',' ) ) {
+		int nSize = sSize.toInt();
+		if ( nSize > 0 && nSize <= MAX_BUFFER_SIZE ) {
+			bufferSizes.push_back( nSize );
+		}
+	}
+
+	unsigned logLevelOpt = Logger::None;
+	if ( parser.isSet( verboseOption ) ) {
+		logLevelOpt = parser.value( verboseOption ).isEmpty() ?
+			Logger::Error|Logger::Warning :
+			Logger::parse_log_level( parser.value( verboseOption ).toLocal8Bit() );
+	}
+
+	Logger* pLogger = Logger::bootstrap( logLevelOpt );
+	Object::bootstrap( pLogger, pLogger->should_log( Logger::Debug ) );
+	// The songs of the functional tests rely on the drumkits shipped
+	// in the source tree.
+	Filesystem::bootstrap( pLogger, parser.isSet( dataOption ) ?
+						   parser.value( dataOption ) : QString( H2_SOURCE_DIR "/data/" ) );
+
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_nSamplerWorkers = nWorkers;
+	pPref->m_nMaxNotes = parser.isSet( renderOption ) ? 1024 : nVoices;
+	pPref->m_bSampleStreaming = false;
+	pPref->publishRealtimeConfig();
+	Hydrogen::create_instance();
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+
+	if ( parser.isSet( renderOption ) ) {
+		QStringList songs = parser.positionalArguments();
+		if ( songs.isEmpty() ) {
+			QDir functionalDir( H2_SOURCE_DIR "/src/tests/data/functional" );
+			for ( const auto& sSong : functionalDir.entryList( QStringList( "*.h2song" ),
+															  QDir::Files, QDir::Name ) ) {
+				songs << functionalDir.absoluteFilePath( sSong );
+			}
+		}
+		return runRenderBenchmark( songs, parser.value( jsonOption ), 44100 );
+	}
+
+	printf( "%d voices, %d worker threads, %d s rendered per run\n\n",
+			nVoices, nWorkers, nFrames / nDriverSampleRate );
+	printf( "%8s %10s %7s %12s %8s %16s\n", "buffer", "resampling", "filter",
+			"us/buffer", "load", "voices/core" );
+
+	// The voices have to last for the warm-up buffer and the
+	// whole run even when resampled.
+	int nSampleFrames = nFrames * 5 / 4 + 2 * MAX_BUFFER_SIZE;
+	int nCores = nWorkers + 1;
+
+	for ( const auto& mode : renderModes ) {
+		for ( bool bFilter : { false, true } ) {
+			pHydrogen->setSong( createSong( nSampleFrames, mode.nSampleRate, bFilter ) );
+			pSampler->setInterpolateMode( mode.interpolateMode );
+
+			for ( int nBufferSize : bufferSizes ) {
+				double fMicros = measure( pHydrogen->getSong(), nVoices, nBufferSize, nFrames );
+				if ( fMicros < 0 ) {
+					printf( "%8d %10s %7s %12s\n", nBufferSize, mode.sName,
+							bFilter ? "on" : "off", "voices ended prematurely" );
+					continue;
+				}
+				double fBufferMicros = 1e6 * nBufferSize / nDriverSampleRate;
+				double fLoad = fMicros / fBufferMicros;
+				printf( "%8d %10s %7s %12.2f %7.1f%% %16.0f\n", nBufferSize, mode.sName,
+						bFilter ? "on" : "off", fMicros, 100 * fLoad,
+						nVoices / fLoad / nCores );
+			}
+		}
+	}
+
+	printf( "\nSample::load(): %.2f ms per %d s stereo WAV file\n",
+			measureSampleLoad( nFrames, 10 ), nFrames / nDriverSampleRate );
+
+	return 0;
+}
@@ -20,8 +20,20 @@
  *
  */
 
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QDataStream>
 #include <QLibraryInfo>
+#include <QProcess>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
 #include <QThread>
+#include <QtEndian>
 #include <core/config.h>
 #include <core/Version.h>
 #include <getopt.h>
@@ -38,19 +50,29 @@
 #include <core/Basics/Instrument.h>
 #include <core/Globals.h>
 #include <core/EventQueue.h>
+#include <core/SongExporter.h>
+#include <core/IO/ExportWriter.h>
 #include <core/Preferences.h>
 #include <core/H2Exception.h>
 #include <core/Basics/Playlist.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/DrumkitIndex.h>
 #include <core/Sampler/Interpolation.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Tracer.h>
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <signal.h>
 
 using namespace H2Core;
 
 void showInfo();
 void showUsage();
+void showLatencyReport();
 
 #define HAS_ARG 1
 static struct option long_opts[] = {
@@ -68,7 +90,16 @@ static struct option long_opts[] = {
 	{"verbose", optional_argument, nullptr, 'V'},
 	{"help", 0, nullptr, 'h'},
 	{"install", required_argument, nullptr, 'i'},
+	{"cache-samples", 0, nullptr, 'C'},
+	{"upgrade-drumkits", optional_argument, nullptr, 'U'},
 	{"drumkit", required_argument, nullptr, 'k'},
+	{"batch", required_argument, nullptr, 'B'},
+	{"jobs", required_argument, nullptr, 'j'},
+	{"batch-part", required_argument, nullptr, 'P'},
+	{"serve", required_argument, nullptr, 'N'},
+	{"worker", required_argument, nullptr, 'W'},
+	{"latency", 0, nullptr, 'L'},
+	{"trace", required_argument, nullptr, 'T'},
 	{nullptr, 0, nullptr, 0},
 };
 
@@ -106,10 +137,526 @@ void show_playlist (uint active )
 	std::cout << std::endl;
 }
 
+/** A single song of a batch manifest and the files it is rendered
+	to.*/
+struct BatchJob
+{
+	QString sSong;
+	QStringList outFilenames;
+};
+
+/**
+ * Splits a line of a batch manifest at whitespace. Fields containing
+ * spaces can be enclosed in double quotes.
+ */
+QStringList split_batch_line( const QString& sLine )
+{
+	QStringList fields;
+	QString sField;
+	bool bQuoted = false;
+	bool bInField = false;
+	for ( const QChar& c : sLine ) {
+		if ( c == '"' ) {
+			bQuoted = ! bQuoted;
+			bInField = true;
+		} else if ( c.isSpace() && ! bQuoted ) {
+			if ( bInField ) {
+				fields << sField;
+				sField.clear();
+				bInField = false;
+			}
+		} else {
+			sField.append( c );
+			bInField = true;
+		}
+	}
+	if ( bInField ) {
+		fields << sField;
+	}
+	return fields;
+}
+
+/**
+ * Reads a batch manifest. Each line holds a song followed by one or
+ * more output files, whose suffixes determine the format they are
+ * written in. Empty lines and lines starting with '#' are
+ * ignored. Relative paths are resolved with respect to the folder
+ * of the manifest.
+ */
+bool load_batch_manifest( const QString& sFilename, std::vector<BatchJob>& jobs )
+{
+	QFile file( sFilename );
+	if ( ! file.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+		___ERRORLOG( QString( "Unable to open batch manifest [%1]" ).arg( sFilename ) );
+		return false;
+	}
+	QDir baseDir = QFileInfo( sFilename ).absoluteDir();
+
+	QTextStream stream( &file );
+	int nLine = 0;
+	while ( ! stream.atEnd() ) {
+		QString sLine = stream.readLine().trimmed();
+		++nLine;
+		if ( sLine.isEmpty() || sLine.startsWith( '#' ) ) {
+			continue;
+		}
+
+		QStringList fields = split_batch_line( sLine );
+		if ( fields.size() < 2 ) {
+			___ERRORLOG( QString( "%1:%2: a song and at least one output file are required" )
+						 .arg( sFilename ).arg( nLine ) );
+			return false;
+		}
+
+		BatchJob job;
+		job.sSong = baseDir.absoluteFilePath( fields.takeFirst() );
+		for ( const auto& sOut : fields ) {
+			job.outFilenames << baseDir.absoluteFilePath( sOut );
+		}
+		jobs.push_back( job );
+	}
+	return true;
+}
+
+/** Prints the loudness and true peak of all files exported by the
+	current export session.*/
+void print_export_analysis()
+{
+	for ( const auto& analysis : ExportWriter::getAnalyses() ) {
+		std::cout << QString( "%1: %2 LUFS, %3 dBTP" )
+			.arg( analysis.sFilename )
+			.arg( analysis.fLoudness, 0, 'f', 1 )
+			.arg( analysis.fTruePeak, 0, 'f', 1 ).toLocal8Bit().data();
+		if ( analysis.fGain != 0 ) {
+			std::cout << QString( ", normalized by %1 dB" )
+				.arg( analysis.fGain, 0, 'f', 1 ).toLocal8Bit().data();
+		}
+		std::cout << std::endl;
+	}
+}
+
+/**
+ * Renders @a job using the DiskWriterDriver and blocks till it is
+ * done.
+ *
+ * The current Song is deleted not until the next one was loaded. All
+ * samples they have in common - typically the whole drumkit - are
+ * therefore picked up from the SamplePool instead of being decoded
+ * again.
+ */
+bool render_batch_job( const BatchJob& job, int nRate, int nBits )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	EventQueue* pQueue = EventQueue::get_instance();
+
+	Song* pSong = Song::load( job.sSong );
+	if ( pSong == nullptr ) {
+		___ERRORLOG( QString( "Unable to load song [%1]" ).arg( job.sSong ) );
+		return false;
+	}
+	pHydrogen->setSong( pSong );
+
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		pInstrumentList->get( ii )->set_currently_exported( true );
+	}
+
+	// Progress of a previous job must not terminate this one.
+	while ( pQueue->pop_event().type != EVENT_NONE ) {
+	}
+
+	// MIDI and LilyPond files are written while the audio is
+	// rendered.
+	SongExporter::Job exportJob;
+	exportJob.nSampleRate = nRate;
+	exportJob.nSampleDepth = nBits;
+	exportJob.midiFormat = static_cast<SongExporter::MidiFormat>(
+		Preferences::get_instance()->getMidiExportMode() );
+	SongExporter::addFilenames( exportJob, job.outFilenames );
+	SongExporter exporter;
+	if ( ! exporter.start( exportJob ) ) {
+		return false;
+	}
+
+	bool bDone = exportJob.audioFilenames.isEmpty();
+	while ( ! bDone && ! quit ) {
+		Event event = pQueue->pop_event();
+		switch ( event.type ) {
+		case EVENT_PROGRESS:
+			bDone = event.value >= 100;
+			break;
+		case EVENT_NONE:
+			Sleeper::msleep( 10 );
+			break;
+		case EVENT_QUIT:
+			quit = true;
+			break;
+		default:
+			break;
+		}
+	}
+	if ( ! exportJob.audioFilenames.isEmpty() ) {
+		if ( bDone ) {
+			print_export_analysis();
+		}
+		pHydrogen->stopExportSession();
+	}
+
+	if ( ! exporter.finish() || ! bDone ) {
+		return false;
+	}
+	for ( const auto& sOut : job.outFilenames ) {
+		if ( ! QFileInfo( sOut ).exists() ) {
+			___ERRORLOG( QString( "Output file [%1] was not written" ).arg( sOut ) );
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Renders the jobs of @a jobs with index @a nPart modulo @a nParts
+ * one after another.
+ *
+ * \return Number of jobs which failed.
+ */
+int render_batch( const std::vector<BatchJob>& jobs, int nPart, int nParts,
+				  int nRate, int nBits )
+{
+	int nFailed = 0;
+	for ( int ii = nPart; ii < static_cast<int>( jobs.size() ) && ! quit; ii += nParts ) {
+		const BatchJob& job = jobs[ ii ];
+		bool bSuccess = render_batch_job( job, nRate, nBits );
+		if ( ! bSuccess ) {
+			++nFailed;
+		}
+		std::cout << "[" << ( ii + 1 ) << "/" << jobs.size() << "] "
+				  << job.sSong.toLocal8Bit().constData() << " -> "
+				  << job.outFilenames.join( ", " ).toLocal8Bit().constData()
+				  << ( bSuccess ? " DONE" : " FAILED" ) << std::endl;
+	}
+	return nFailed;
+}
+
+/**
+ * Distributes a batch across @a nWorkers processes of @a sProgram,
+ * each handling every @a nWorkers th job using the --batch-part
+ * option. Each of them runs its own audio engine.
+ *
+ * \return 0 if all workers succeeded and 1 otherwise.
+ */
+int run_batch_workers( const QString& sProgram, const QStringList& arguments, int nWorkers )
+{
+	std::vector<std::unique_ptr<QProcess>> workers;
+	for ( int ii = 0; ii < nWorkers; ++ii ) {
+		std::unique_ptr<QProcess> pWorker( new QProcess );
+		pWorker->setProcessChannelMode( QProcess::ForwardedChannels );
+		pWorker->start( sProgram, QStringList( arguments )
+						<< "--batch-part" << QString( "%1/%2" ).arg( ii ).arg( nWorkers ) );
+		if ( ! pWorker->waitForStarted( -1 ) ) {
+			___ERRORLOG( QString( "Unable to start batch worker [%1]: %2" )
+						 .arg( sProgram ).arg( pWorker->errorString() ) );
+			continue;
+		}
+		workers.push_back( std::move( pWorker ) );
+	}
+
+	bool bSuccess = static_cast<int>( workers.size() ) == nWorkers;
+	for ( auto& pWorker : workers ) {
+		pWorker->waitForFinished( -1 );
+		if ( pWorker->exitStatus() != QProcess::NormalExit ||
+			 pWorker->exitCode() != 0 ) {
+			bSuccess = false;
+		}
+	}
+	return bSuccess ? 0 : 1;
+}
+
+/**
+ * Sends @a message to @a pSocket prefixed by its size and blocks till
+ * it was written.
+ */
+bool write_farm_message( QTcpSocket* pSocket, const QVariantMap& message )
+{
+	QByteArray data;
+	QDataStream stream( &data, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_5_6 );
+	stream << message;
+
+	uchar header[ sizeof( quint64 ) ];
+	qToBigEndian<quint64>( data.size(), header );
+	pSocket->write( reinterpret_cast<const char*>( header ), sizeof( header ) );
+	pSocket->write( data );
+	while ( pSocket->bytesToWrite() > 0 ) {
+		if ( ! pSocket->waitForBytesWritten( 30000 ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Reads the next message written by write_farm_message() from @a
+ * pSocket.
+ *
+ * \param nTimeout Milliseconds to wait for further data. With -1 the
+ * function blocks till the message is complete or the connection is
+ * lost.
+ *
+ * \return true if a whole message was read into @a message.
+ */
+bool read_farm_message( QTcpSocket* pSocket, QVariantMap& message, int nTimeout )
+{
+	bool bWait = true;
+	for ( ;; ) {
+		// The message is decoded not until it arrived completely to
+		// not parse large results over and over again.
+		uchar header[ sizeof( quint64 ) ];
+		if ( pSocket->peek( reinterpret_cast<char*>( header ), sizeof( header ) ) ==
+			 static_cast<qint64>( sizeof( header ) ) ) {
+			quint64 nSize = qFromBigEndian<quint64>( header );
+			if ( static_cast<quint64>( pSocket->bytesAvailable() ) >= sizeof( header ) + nSize ) {
+				pSocket->read( sizeof( header ) );
+				QByteArray data = pSocket->read( nSize );
+				QDataStream stream( data );
+				stream.setVersion( QDataStream::Qt_5_6 );
+				stream >> message;
+				if ( stream.status() != QDataStream::Ok ) {
+					___ERRORLOG( "Corrupt message received. Closing connection" );
+					pSocket->abort();
+					return false;
+				}
+				return true;
+			}
+		}
+		if ( ! bWait || ! pSocket->waitForReadyRead( nTimeout ) ) {
+			return false;
+		}
+		bWait = nTimeout < 0;
+	}
+}
+
+/**
+ * Hands out the jobs of @a jobs to h2cli instances connecting to @a
+ * nPort using --worker and writes the files they rendered to the
+ * outputs listed in the manifest.
+ *
+ * The song files are sent along with the jobs. The drumkits they use
+ * have to be installed on the workers. Jobs of workers which lose
+ * their connection are handed to the next idle one.
+ *
+ * \return Number of jobs which failed.
+ */
+int serve_batch( const std::vector<BatchJob>& jobs, quint16 nPort, int nRate, int nBits )
+{
+	QTcpServer server;
+	if ( ! server.listen( QHostAddress::Any, nPort ) ) {
+		___ERRORLOG( QString( "Unable to listen on port [%1]: %2" )
+					 .arg( nPort ).arg( server.errorString() ) );
+		return static_cast<int>( jobs.size() );
+	}
+	std::cout << "Waiting for workers on port " << server.serverPort() << std::endl;
+
+	struct Worker {
+		std::unique_ptr<QTcpSocket> pSocket;
+		// Index of the job being rendered or -1 if idle.
+		int nJob;
+	};
+	std::vector<Worker> workers;
+	std::deque<int> pending;
+	for ( int ii = 0; ii < static_cast<int>( jobs.size() ); ++ii ) {
+		pending.push_back( ii );
+	}
+
+	int nFinished = 0;
+	int nFailed = 0;
+	auto finishJob = [&]( int nJob, bool bSuccess ) {
+		++nFinished;
+		if ( ! bSuccess ) {
+			++nFailed;
+		}
+		std::cout << "[" << ( nJob + 1 ) << "/" << jobs.size() << "] "
+				  << jobs[ nJob ].sSong.toLocal8Bit().constData() << " -> "
+				  << jobs[ nJob ].outFilenames.join( ", " ).toLocal8Bit().constData()
+				  << ( bSuccess ? " DONE" : " FAILED" ) << std::endl;
+	};
+
+	while ( nFinished < static_cast<int>( jobs.size() ) && ! quit ) {
+		server.waitForNewConnection( workers.empty() ? 100 : 0 );
+		while ( server.hasPendingConnections() ) {
+			QTcpSocket* pSocket = server.nextPendingConnection();
+			___INFOLOG( QString( "Worker [%1] connected" )
+						.arg( pSocket->peerAddress().toString() ) );
+			workers.push_back( { std::unique_ptr<QTcpSocket>( pSocket ), -1 } );
+		}
+
+		for ( auto& worker : workers ) {
+			QVariantMap message;
+			if ( read_farm_message( worker.pSocket.get(), message, 10 ) &&
+				 message[ "type" ].toString() == "result" && worker.nJob >= 0 ) {
+				const BatchJob& job = jobs[ worker.nJob ];
+				QVariantList files = message[ "files" ].toList();
+				bool bSuccess = message[ "success" ].toBool() &&
+					files.size() == job.outFilenames.size();
+				for ( int ii = 0; bSuccess && ii < files.size(); ++ii ) {
+					QFile file( job.outFilenames[ ii ] );
+					if ( ! file.open( QIODevice::WriteOnly ) ||
+						 file.write( files[ ii ].toByteArray() ) != files[ ii ].toByteArray().size() ) {
+						___ERRORLOG( QString( "Unable to write [%1]" ).arg( job.outFilenames[ ii ] ) );
+						bSuccess = false;
+					}
+				}
+				finishJob( worker.nJob, bSuccess );
+				worker.nJob = -1;
+			}
+
+			if ( worker.pSocket->state() != QAbstractSocket::ConnectedState ) {
+				if ( worker.nJob >= 0 ) {
+					___WARNINGLOG( QString( "Worker [%1] disconnected. Rescheduling [%2]" )
+								   .arg( worker.pSocket->peerAddress().toString() )
+								   .arg( jobs[ worker.nJob ].sSong ) );
+					pending.push_front( worker.nJob );
+					worker.nJob = -1;
+				}
+				continue;
+			}
+
+			while ( worker.nJob < 0 && ! pending.empty() ) {
+				int nJob = pending.front();
+				pending.pop_front();
+				const BatchJob& job = jobs[ nJob ];
+				QFile song( job.sSong );
+				if ( ! song.open( QIODevice::ReadOnly ) ) {
+					___ERRORLOG( QString( "Unable to read song [%1]" ).arg( job.sSong ) );
+					finishJob( nJob, false );
+					continue;
+				}
+				QStringList outputs;
+				for ( const auto& sOut : job.outFilenames ) {
+					outputs << QFileInfo( sOut ).fileName();
+				}
+				QVariantMap jobMessage;
+				jobMessage[ "type" ] = "job";
+				jobMessage[ "song" ] = QFileInfo( job.sSong ).fileName();
+				jobMessage[ "data" ] = song.readAll();
+				jobMessage[ "outputs" ] = outputs;
+				jobMessage[ "rate" ] = nRate;
+				jobMessage[ "bits" ] = nBits;
+				// A write failure shows up as a lost connection.
+				worker.nJob = nJob;
+				write_farm_message( worker.pSocket.get(), jobMessage );
+			}
+		}
+
+		workers.erase( std::remove_if( workers.begin(), workers.end(),
+									   []( const Worker& worker ) {
+										   return worker.pSocket->state() !=
+											   QAbstractSocket::ConnectedState; } ),
+					   workers.end() );
+	}
+
+	QVariantMap done;
+	done[ "type" ] = "done";
+	for ( auto& worker : workers ) {
+		write_farm_message( worker.pSocket.get(), done );
+		worker.pSocket->disconnectFromHost();
+	}
+	return nFailed + static_cast<int>( jobs.size() ) - nFinished;
+}
+
+/**
+ * Connects to an h2cli instance started with --serve at @a sAddress
+ * (HOST:PORT) and renders the jobs it hands out till there are none
+ * left.
+ *
+ * \return Number of jobs which failed. If the connection could not be
+ * established or got lost, one is added.
+ */
+int run_farm_worker( const QString& sAddress )
+{
+	int nColon = sAddress.lastIndexOf( ':' );
+	QString sHost = sAddress.left( nColon );
+	quint16 nPort = sAddress.mid( nColon + 1 ).toUShort();
+	if ( nColon <= 0 || nPort == 0 ) {
+		___ERRORLOG( QString( "Invalid coordinator address [%1]. HOST:PORT expected" )
+					 .arg( sAddress ) );
+		return 1;
+	}
+
+	QTcpSocket socket;
+	socket.connectToHost( sHost, nPort );
+	if ( ! socket.waitForConnected( 30000 ) ) {
+		___ERRORLOG( QString( "Unable to connect to coordinator [%1]: %2" )
+					 .arg( sAddress ).arg( socket.errorString() ) );
+		return 1;
+	}
+
+	int nFailed = 0;
+	while ( ! quit ) {
+		QVariantMap message;
+		if ( ! read_farm_message( &socket, message, -1 ) ) {
+			___ERRORLOG( QString( "Lost connection to coordinator [%1]" ).arg( sAddress ) );
+			return nFailed + 1;
+		}
+		if ( message[ "type" ].toString() == "done" ) {
+			break;
+		}
+		if ( message[ "type" ].toString() != "job" ) {
+			continue;
+		}
+
+		// Names are stripped of directories sent by a
+		// misbehaving coordinator.
+		QTemporaryDir dir;
+		BatchJob job;
+		job.sSong = dir.filePath( QFileInfo( message[ "song" ].toString() ).fileName() );
+		for ( const auto& sOut : message[ "outputs" ].toStringList() ) {
+			// The suffix determines the format of the file.
+			job.outFilenames << dir.filePath( QString( "%1_%2" )
+											  .arg( job.outFilenames.size() )
+											  .arg( QFileInfo( sOut ).fileName() ) );
+		}
+
+		QFile song( job.sSong );
+		bool bSuccess = ! job.outFilenames.isEmpty() && song.open( QIODevice::WriteOnly ) &&
+			song.write( message[ "data" ].toByteArray() ) == message[ "data" ].toByteArray().size();
+		song.close();
+		bSuccess = bSuccess && render_batch_job( job, message[ "rate" ].toInt(),
+												 message[ "bits" ].toInt() );
+
+		QVariantList files;
+		for ( int ii = 0; bSuccess && ii < job.outFilenames.size(); ++ii ) {
+			QFile file( job.outFilenames[ ii ] );
+			if ( ! file.open( QIODevice::ReadOnly ) ) {
+				bSuccess = false;
+				break;
+			}
+			files << file.readAll();
+		}
+		if ( ! bSuccess ) {
+			++nFailed;
+			files.clear();
+		}
+		std::cout << message[ "song" ].toString().toLocal8Bit().constData()
+				  << ( bSuccess ? " DONE" : " FAILED" ) << std::endl;
+
+		QVariantMap result;
+		result[ "type" ] = "result";
+		result[ "success" ] = bSuccess;
+		result[ "files" ] = files;
+		if ( ! write_farm_message( &socket, result ) ) {
+			___ERRORLOG( QString( "Lost connection to coordinator [%1]" ).arg( sAddress ) );
+			return nFailed + 1;
+		}
+	}
+	return nFailed;
+}
+
 #define NELEM(a) ( sizeof(a)/sizeof((a)[0]) )
 
 int main(int argc, char *argv[])
 {
+	int nResult = 0;
 	try {
 		// Options...
 		char *cp;
@@ -131,16 +678,29 @@ int main(int argc, char *argv[])
 		// Deal with the options
 		QString songFilename;
 		QString playlistFilename;
-		QString outFilename = nullptr;
+		QStringList outFilenames;
 		QString sSelectedDriver;
 		bool showVersionOpt = false;
 		const char* logLevelOpt = "Error";
 		bool showHelpOpt = false;
 		QString drumkitName;
+		bool bCacheSamples = false;
+		bool bUpgradeDrumkits = false;
+		QString sUpgradeDir;
 		QString drumkitToLoad;
 		short bits = 16;
 		int rate = 44100;
 		short interpolation = 0;
+		QString batchFilename;
+		// Zero if not given.
+		int nJobs = 0;
+		int nBatchPart = 0;
+		int nBatchParts = 1;
+		// Zero if no coordinator is to be started.
+		int nServePort = 0;
+		QString sCoordinator;
+		bool bLatencyReport = false;
+		QString sTraceFilename;
 #ifdef H2CORE_HAVE_JACKSESSION
 		QString sessionId;
 #endif
@@ -160,12 +720,21 @@ int main(int argc, char *argv[])
 				playlistFilename = QString::fromLocal8Bit(optarg);
 				break;
 			case 'o':
-				outFilename = QString::fromLocal8Bit(optarg);
+				outFilenames << QString::fromLocal8Bit(optarg);
 				break;
 			case 'i':
 				//install h2drumkit
 				drumkitName = QString::fromLocal8Bit(optarg);
 				break;
+			case 'C':
+				bCacheSamples = true;
+				break;
+			case 'U':
+				bUpgradeDrumkits = true;
+				if ( optarg ) {
+					sUpgradeDir = QString::fromLocal8Bit(optarg);
+				}
+				break;
 			case 'k':
 				//load Drumkit
 				drumkitToLoad = QString::fromLocal8Bit(optarg);
@@ -176,6 +745,43 @@ int main(int argc, char *argv[])
 			case 'b':
 				bits = strtol(optarg, nullptr, 10);
 				break;
+			case 'B':
+				batchFilename = QString::fromLocal8Bit(optarg);
+				break;
+			case 'j':
+				nJobs = strtol(optarg, nullptr, 10);
+				if ( nJobs <= 0 ) {
+					nJobs = QThread::idealThreadCount();
+				}
+				break;
+			case 'P': {
+				QStringList part = QString::fromLocal8Bit(optarg).split( '/' );
+				if ( part.size() == 2 ) {
+					nBatchPart = part[ 0 ].toInt();
+					nBatchParts = part[ 1 ].toInt();
+				}
+				if ( nBatchParts <= 0 || nBatchPart < 0 || nBatchPart >= nBatchParts ) {
+					std::cerr << "Invalid batch part [" << optarg << "]" << std::endl;
+					exit(1);
+				}
+				break;
+			}
+			case 'N':
+				nServePort = strtol(optarg, nullptr, 10);
+				if ( nServePort <= 0 || nServePort > 65535 ) {
+					std::cerr << "Invalid port [" << optarg << "]" << std::endl;
+					exit(1);
+				}
+				break;
+			case 'W':
+				sCoordinator = QString::fromLocal8Bit(optarg);
+				break;
+			case 'L':
+				bLatencyReport = true;
+				break;
+			case 'T':
+				sTraceFilename = QString::fromLocal8Bit(optarg);
+				break;
 			case 'v':
 				showVersionOpt = true;
 				break;
@@ -205,10 +811,71 @@ int main(int argc, char *argv[])
 			exit(0);
 		}
 
+		if ( nServePort > 0 && batchFilename.isEmpty() ) {
+			std::cerr << "--serve requires a --batch manifest" << std::endl;
+			exit(1);
+		}
+
+		// Enabled before any thread gets started.
+		if ( ! sTraceFilename.isEmpty() ) {
+			Tracer::setEnabled( true );
+		}
+
 		// Man your battle stations... this is not a drill.
 		Logger* logger = Logger::bootstrap( Logger::parse_log_level( logLevelOpt ) );
 		Object::bootstrap( logger, logger->should_log( Logger::Debug ) );
 		Filesystem::bootstrap( logger );
+
+		std::vector<BatchJob> batchJobs;
+		// Holds the preferences of a batch run.
+		std::unique_ptr<QTemporaryDir> pBatchConfigDir;
+		if ( ! batchFilename.isEmpty() ) {
+			if ( ! load_batch_manifest( batchFilename, batchJobs ) ) {
+				return 1;
+			}
+			if ( batchJobs.empty() ) {
+				___ERRORLOG( QString( "No songs listed in batch manifest [%1]" ).arg( batchFilename ) );
+				return 1;
+			}
+
+			if ( nServePort > 0 ) {
+				// The coordinator does not render on its own.
+				QCoreApplication app( argc, argv );
+				signal( SIGINT, signal_handler );
+				nResult = serve_batch( batchJobs, nServePort, rate, bits ) > 0 ? 1 : 0;
+				delete Logger::get_instance();
+				return nResult;
+			}
+
+			if ( nJobs > 1 ) {
+				QStringList arguments;
+				arguments << "--batch" << QFileInfo( batchFilename ).absoluteFilePath()
+						  << "--rate" << QString::number( rate )
+						  << "--bits" << QString::number( bits )
+						  << QString( "--verbose=%1" ).arg( logLevelOpt );
+				if ( ! sSelectedDriver.isEmpty() ) {
+					arguments << "--driver" << sSelectedDriver;
+				}
+				nResult = run_batch_workers( QString::fromLocal8Bit( argv[0] ),
+												 arguments, std::min( nJobs, static_cast<int>( batchJobs.size() ) ) );
+				delete Logger::get_instance();
+				return nResult;
+			}
+		}
+
+		if ( ! batchJobs.empty() || ! sCoordinator.isEmpty() ) {
+			// Neither the temporary audio driver nor the last song
+			// of the batch are supposed to end up in the user's
+			// preferences. Concurrent workers would clobber them as
+			// well.
+			pBatchConfigDir.reset( new QTemporaryDir );
+			QString sConfig = pBatchConfigDir->filePath( "hydrogen.conf" );
+			QFile::copy( QFile::exists( Filesystem::usr_config_path() ) ?
+						 Filesystem::usr_config_path() : Filesystem::sys_config_path(),
+						 sConfig );
+			Filesystem::setPreferencesOverwritePath( sConfig );
+		}
+
 		MidiMap::create_instance();
 		Preferences::create_instance();
 		Preferences* preferences = Preferences::get_instance();
@@ -226,10 +893,29 @@ int main(int argc, char *argv[])
 #endif
 
 		if ( ! drumkitName.isEmpty() ){
-			Drumkit::install( drumkitName );
+			Drumkit::install( drumkitName, bCacheSamples );
 			exit(0);
 		}
 
+		if ( bUpgradeDrumkits ) {
+			if ( sUpgradeDir.isEmpty() ) {
+				sUpgradeDir = Filesystem::usr_drumkits_dir();
+			}
+			QStringList failed;
+			int nUpgraded = Drumkit::upgrade_drumkits( sUpgradeDir, nJobs, &failed );
+			std::cout << nUpgraded << " drumkit(s) upgraded in "
+					  << sUpgradeDir.toLocal8Bit().data() << std::endl;
+			for ( const auto& sFailed : failed ) {
+				std::cout << "Unable to upgrade " << sFailed.toLocal8Bit().data() << std::endl;
+			}
+			// Indexing the kits only after the upgrade keeps it from
+			// converting them one at a time. The validation results
+			// were cached by the workers.
+			DrumkitIndex::create_instance();
+			delete DrumkitIndex::get_instance();
+			exit( failed.isEmpty() ? 0 : 1 );
+		}
+
 		if (sSelectedDriver == "auto") {
 			preferences->m_sAudioDriver = "Auto";
 		}
@@ -248,6 +934,15 @@ int main(int argc, char *argv[])
 		else if (sSelectedDriver == "PulseAudio") {
 			preferences->m_sAudioDriver = "PulseAudio";
 		}
+		else if ( sSelectedDriver == "PipeWire" ) {
+			preferences->m_sAudioDriver = "PipeWire";
+		}
+		else if ( sSelectedDriver.isEmpty() &&
+				  ( ! batchJobs.empty() || ! sCoordinator.isEmpty() ) ) {
+			// The DiskWriterDriver takes over for every job. No need
+			// to bring up a real device in between.
+			preferences->m_sAudioDriver = "Fake";
+		}
 
 #ifdef H2CORE_HAVE_LASH
 		if ( preferences->useLash() && lashClient->isConnected() ) {
@@ -288,7 +983,20 @@ int main(int argc, char *argv[])
 //		QString path = pQApp->applicationFilePath();
 //		preferences->setJackSessionApplicationPath ( path );
 #endif
-		Hydrogen::create_instance();
+		// Decode the samples of the Song opened below while the
+		// drivers are started.
+		QString sStartupSong;
+		if ( ! batchJobs.empty() ) {
+			sStartupSong = batchJobs[ nBatchPart < static_cast<int>( batchJobs.size() ) ?
+									  nBatchPart : 0 ].sSong;
+		}
+		else if ( playlistFilename.isEmpty() && sCoordinator.isEmpty() ) {
+			sStartupSong = songFilename;
+			if ( sStartupSong.isEmpty() && preferences->isRestoreLastSongEnabled() ) {
+				sStartupSong = preferences->getLastSongFilename();
+			}
+		}
+		Hydrogen::create_instance( sStartupSong );
 		Hydrogen *pHydrogen = Hydrogen::get_instance();
 		Song *pSong = nullptr;
 		Playlist *pPlaylist = nullptr;
@@ -322,7 +1030,7 @@ int main(int argc, char *argv[])
 		if ( ! pSong ) {
 			if ( !songFilename.isEmpty() ) {
 				pSong = Song::load( songFilename );
-			} else {
+			} else if ( batchJobs.empty() && sCoordinator.isEmpty() ) {
 				/* Try load last song */
 				bool restoreLastSong = preferences->isRestoreLastSongEnabled();
 				QString filename = preferences->getLastSongFilename();
@@ -366,6 +1074,9 @@ int main(int argc, char *argv[])
 			case 4:
 					pSampler->setInterpolateMode( Interpolation::InterpolateMode::Hermite );
 					break;
+			case 5:
+					pSampler->setInterpolateMode( Interpolation::InterpolateMode::Sinc );
+					break;
 			case 0:
 			default:
 					pSampler->setInterpolateMode( Interpolation::InterpolateMode::Linear );
@@ -375,20 +1086,56 @@ int main(int argc, char *argv[])
 
 		signal(SIGINT, signal_handler);
 
+		if ( ! batchJobs.empty() ) {
+			if ( render_batch( batchJobs, nBatchPart, nBatchParts, rate, bits ) > 0 ) {
+				nResult = 1;
+			}
+			// Deleted below.
+			pSong = pHydrogen->getSong();
+			quit = true;
+		}
+		else if ( ! sCoordinator.isEmpty() ) {
+			QCoreApplication app( argc, argv );
+			if ( run_farm_worker( sCoordinator ) > 0 ) {
+				nResult = 1;
+			}
+			pSong = pHydrogen->getSong();
+			quit = true;
+		}
 		
 		bool ExportMode = false;
-		if ( ! outFilename.isEmpty() ) {
+		SongExporter exporter;
+		if ( ! outFilenames.isEmpty() ) {
 			InstrumentList *pInstrumentList = pSong->getInstrumentList();
 			for (auto i = 0; i < pInstrumentList->size(); i++) {
 				pInstrumentList->get(i)->set_currently_exported( true );
 			}
-			pHydrogen->startExportSession(rate, bits);
-			pHydrogen->startExportSong( outFilename );
-			std::cout << "Export Progress ... ";
-			ExportMode = true;
+			// All audio files are written within the same pass while
+			// the MIDI and LilyPond files are written in the
+			// background.
+			SongExporter::Job exportJob;
+			exportJob.nSampleRate = rate;
+			exportJob.nSampleDepth = bits;
+			exportJob.midiFormat = static_cast<SongExporter::MidiFormat>(
+				preferences->getMidiExportMode() );
+			SongExporter::addFilenames( exportJob, outFilenames );
+			if ( ! exporter.start( exportJob ) ) {
+				nResult = 1;
+				quit = true;
+			} else if ( exportJob.audioFilenames.isEmpty() ) {
+				if ( ! exporter.finish() ) {
+					nResult = 1;
+				}
+				quit = true;
+			} else {
+				std::cout << "Export Progress ... ";
+				ExportMode = true;
+			}
 		}
 
 		// Interactive mode
+		QElapsedTimer latencyReportTimer;
+		latencyReportTimer.start();
 		while ( ! quit ) {
 			/* FIXME: Someday here will be The Real CLI ;-) */
 			Event event = pQueue->pop_event();
@@ -403,7 +1150,11 @@ int main(int argc, char *argv[])
 					std::cout << "\rExport Progress ... " << event.value << "%";
 				} else {
 					pHydrogen->stopExportSession();
+					if ( ! exporter.finish() ) {
+						nResult = 1;
+					}
 					std::cout << "\rExport Progress ... DONE" << std::endl;
+					print_export_analysis();
 					quit = true;
 				}
 				break;
@@ -423,6 +1174,10 @@ int main(int argc, char *argv[])
 				break;
 			case EVENT_NONE: /* Sleep if there is no more events */
 				Sleeper::msleep ( 100 );
+				if ( bLatencyReport && latencyReportTimer.elapsed() >= 10000 ) {
+					showLatencyReport();
+					latencyReportTimer.restart();
+				}
 				break;
 				
 			case EVENT_QUIT: // Shutdown if indicated by a
@@ -438,6 +1193,16 @@ int main(int argc, char *argv[])
 		if ( pHydrogen->getState() == STATE_PLAYING ) {
 			pHydrogen->sequencer_stop();
 		}
+		if ( bLatencyReport ) {
+			showLatencyReport();
+		}
+		if ( ! sTraceFilename.isEmpty() ) {
+			if ( Tracer::dump( sTraceFilename ) ) {
+				___INFOLOG( QString( "Trace written to [%1]" ).arg( sTraceFilename ) );
+			} else {
+				___ERRORLOG( QString( "Unable to write trace to [%1]" ).arg( sTraceFilename ) );
+			}
+		}
 
 		delete pSong;
 		delete pPlaylist;
@@ -466,7 +1231,7 @@ int main(int argc, char *argv[])
 		std::cerr << "[main] Unknown exception X-(" << std::endl;
 	}
 
-	return 0;
+	return nResult;
 }
 
 /* Show some information */
@@ -493,13 +1258,34 @@ void showUsage()
 	std::cout << "   -d, --driver AUDIODRIVER - Use the selected audio driver (jack, alsa, oss)" << std::endl;
 	std::cout << "   -s, --song FILE - Load a song (*.h2song) at startup" << std::endl;
 	std::cout << "   -p, --playlist FILE - Load a playlist (*.h2playlist) at startup" << std::endl;
-	std::cout << "   -o, --outfile FILE - Output to file (export)" << std::endl;
+	std::cout << "   -o, --outfile FILE - Output to file (export). Can be given" << std::endl;
+	std::cout << "       several times to write e.g. both a WAV and an OGG file." << std::endl;
+	std::cout << "       Files ending in .mid or .ly are exported as MIDI or LilyPond" << std::endl;
+	std::cout << "       while the audio is rendered" << std::endl;
 	std::cout << "   -r, --rate RATE - Set bitrate while exporting file" << std::endl;
 	std::cout << "   -b, --bits BITS - Set bits depth while exporting file" << std::endl;
 	std::cout << "   -k, --kit drumkit_name - Load a drumkit at startup" << std::endl;
 	std::cout << "   -i, --install FILE - install a drumkit (*.h2drumkit)" << std::endl;
+	std::cout << "   -C, --cache-samples - Decode the samples of the installed drumkit" << std::endl;
+	std::cout << "       into the sample cache right away" << std::endl;
+	std::cout << "   -U[DIR], --upgrade-drumkits[=DIR] - Convert all legacy drumkits" << std::endl;
+	std::cout << "       found in DIR (default: user drumkits) using --jobs threads" << std::endl;
 	std::cout << "   -I, --interpolate INT - Interpolation" << std::endl;
-	std::cout << "       (0:linear [default],1:cosine,2:third,3:cubic,4:hermite)" << std::endl;
+	std::cout << "       (0:linear [default],1:cosine,2:third,3:cubic,4:hermite,5:sinc)" << std::endl;
+	std::cout << "   -B, --batch FILE - Export all songs listed in FILE. Each line holds" << std::endl;
+	std::cout << "       a song followed by one or more output files" << std::endl;
+	std::cout << "   -j, --jobs N - Distribute the batch across N processes (0: one per core)" << std::endl;
+	std::cout << "       or upgrade N drumkits at once (default: one per core)" << std::endl;
+	std::cout << "   -P, --batch-part K/N - Only export every Nth song of the batch" << std::endl;
+	std::cout << "       starting with the Kth (counting from 0)" << std::endl;
+	std::cout << "   -N, --serve PORT - Hand out the songs of the batch to workers" << std::endl;
+	std::cout << "       connecting to PORT and collect the files they render" << std::endl;
+	std::cout << "   -W, --worker HOST:PORT - Render songs handed out by a --serve" << std::endl;
+	std::cout << "       instance. The drumkits used have to be installed locally" << std::endl;
+	std::cout << "   -L, --latency - Periodically print the latency of notes" << std::endl;
+	std::cout << "       triggered via MIDI" << std::endl;
+	std::cout << "   -T, --trace FILE - Record a timeline of the engine and driver" << std::endl;
+	std::cout << "       threads and write it as Chrome trace JSON on exit" << std::endl;
 
 #ifdef H2CORE_HAVE_JACKSESSION
 	std::cout << "   -S, --jacksessionid ID - Start a JackSessionHandler session" << std::endl;
@@ -516,3 +1302,23 @@ void showUsage()
 	std::cout << "   -v, --version - Show version info" << std::endl;
 	std::cout << "   -h, --help - Show this help message" << std::endl;
 }
+
+/* Print the latency of notes triggered via MIDI */
+void showLatencyReport()
+{
+	LatencyProbe* pLatencyProbe = AudioEngine::get_instance()->get_latency_probe();
+	std::cout << "MIDI note latency (median / 99th percentile / max, ms):" << std::endl;
+	for ( int ii = 0; ii < LatencyProbe::SOURCE_COUNT; ++ii ) {
+		LatencyProbe::Source source = static_cast<LatencyProbe::Source>( ii );
+		LatencyProbe::Statistics statistics = pLatencyProbe->getStatistics( source );
+		if ( statistics.nTriggers == 0 ) {
+			continue;
+		}
+		std::cout << "   " << LatencyProbe::getSourceName( source ).toLocal8Bit().constData()
+				  << ": " << QString( "%1 / %2 / %3 (%4 notes)" )
+				  .arg( statistics.fMedian, 0, 'f', 2 )
+				  .arg( statistics.fPercentile99, 0, 'f', 2 )
+				  .arg( statistics.fMax, 0, 'f', 2 )
+				  .arg( statistics.nTriggers ).toLocal8Bit().constData() << std::endl;
+	}
+}
@@ -0,0 +1,124 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+/*
+ * Replacements of the allocation functions reporting to the
+ * H2Core::AllocationTracker.
+ *
+ * Include this file in exactly one translation unit of an
+ * executable. With glibc malloc(), calloc(), and realloc() are
+ * interposed, which covers operator new as well as the allocations
+ * of Qt and the C libraries. Elsewhere only the global operator new
+ * is replaced.
+ */
+
+#ifndef ALLOCATION_HOOKS_H
+#define ALLOCATION_HOOKS_H
+
+#include <core/AllocationTracker.h>
+
+#include <cstdlib>
+#include <new>
+
+/** Set while an allocation is reported. Allocations made by the
+	AllocationTracker itself, e.g. by the dynamic linker on the
+	first access of its thread-local state, are forwarded
+	directly.*/
+static thread_local bool bInAllocationHook = false;
+
+static inline void reportAllocation( size_t nSize )
+{
+	if ( ! bInAllocationHook && H2Core::AllocationTracker::isEnabled() ) {
+		bInAllocationHook = true;
+		H2Core::AllocationTracker::recordAllocation( nSize );
+		bInAllocationHook = false;
+	}
+}
+
+#ifdef __GLIBC__
+
+extern "C" {
+	void* __libc_malloc( size_t );
+	void* __libc_calloc( size_t, size_t );
+	void* __libc_realloc( void*, size_t );
+
+	void* malloc( size_t nSize )
+	{
+		reportAllocation( nSize );
+		return __libc_malloc( nSize );
+	}
+
+	void* calloc( size_t nMembers, size_t nSize )
+	{
+		reportAllocation( nMembers * nSize );
+		return __libc_calloc( nMembers, nSize );
+	}
+
+	void* realloc( void* p, size_t nSize )
+	{
+		reportAllocation( nSize );
+		return __libc_realloc( p, nSize );
+	}
+}
+
+#else
+
+void* operator new( std::size_t nSize )
+{
+	reportAllocation( nSize );
+	void* p = std::malloc( nSize > 0 ? nSize : 1 );
+	if ( p == nullptr ) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[]( std::size_t nSize )
+{
+	return operator new( nSize );
+}
+
+void operator delete( void* p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void* p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+#endif
+
+#endif
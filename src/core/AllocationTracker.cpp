@@ -0,0 +1,220 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <core/AllocationTracker.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define H2_HAVE_BACKTRACE
+#endif
+
+namespace H2Core
+{
+
+struct CallSite {
+	std::atomic<long long> nCount;
+	int nFrames;
+	void* frames[ ALLOCATION_TRACKER_FRAMES ];
+};
+
+static std::atomic<bool> bEnabled( false );
+static std::atomic<long long> nCycles( 0 );
+static std::atomic<long long> nAllocations( 0 );
+static std::atomic<long long> nAllocatingCycles( 0 );
+static std::atomic<int> nMaxAllocationsPerCycle( 0 );
+/** Allocations of the cycle in progress.*/
+static std::atomic<int> nCycleAllocations( 0 );
+
+static CallSite callSites[ ALLOCATION_TRACKER_SITES ];
+/** Number of valid entries of #callSites.*/
+static std::atomic<int> nCallSites( 0 );
+/** Serializes the insertion into #callSites.*/
+static std::atomic_flag callSitesLock = ATOMIC_FLAG_INIT;
+
+/** Nesting depth of the realtime scopes of the calling thread.*/
+static thread_local int nRealtimeDepth = 0;
+
+/** Frames of the backtrace belonging to recordAllocation() and the
+	hook calling it.*/
+static const int nSkippedFrames = 2;
+
+AllocationTracker::Cycle::Cycle()
+	: m_bActive( bEnabled.load( std::memory_order_relaxed ) )
+{
+	if ( m_bActive ) {
+		nCycleAllocations.store( 0, std::memory_order_relaxed );
+		++nRealtimeDepth;
+	}
+}
+
+AllocationTracker::Cycle::~Cycle()
+{
+	if ( ! m_bActive ) {
+		return;
+	}
+	--nRealtimeDepth;
+
+	// The worker threads are done by now.
+	int nCount = nCycleAllocations.load( std::memory_order_relaxed );
+	nCycles.fetch_add( 1, std::memory_order_relaxed );
+	if ( nCount > 0 ) {
+		nAllocatingCycles.fetch_add( 1, std::memory_order_relaxed );
+		if ( nCount > nMaxAllocationsPerCycle.load( std::memory_order_relaxed ) ) {
+			nMaxAllocationsPerCycle.store( nCount, std::memory_order_relaxed );
+		}
+	}
+}
+
+AllocationTracker::Scope::Scope()
+	: m_bActive( bEnabled.load( std::memory_order_relaxed ) )
+{
+	if ( m_bActive ) {
+		++nRealtimeDepth;
+	}
+}
+
+AllocationTracker::Scope::~Scope()
+{
+	if ( m_bActive ) {
+		--nRealtimeDepth;
+	}
+}
+
+void AllocationTracker::setEnabled( bool bEnable )
+{
+#ifdef H2_HAVE_BACKTRACE
+	if ( bEnable ) {
+		// The first call loads the unwinder.
+		void* frames[ ALLOCATION_TRACKER_FRAMES ];
+		backtrace( frames, ALLOCATION_TRACKER_FRAMES );
+	}
+#endif
+	bEnabled.store( bEnable );
+}
+
+bool AllocationTracker::isEnabled()
+{
+	return bEnabled.load( std::memory_order_relaxed );
+}
+
+void AllocationTracker::recordAllocation( size_t nSize )
+{
+	if ( nRealtimeDepth <= 0 ) {
+		return;
+	}
+	nAllocations.fetch_add( 1, std::memory_order_relaxed );
+	nCycleAllocations.fetch_add( 1, std::memory_order_relaxed );
+
+#ifdef H2_HAVE_BACKTRACE
+	void* frames[ ALLOCATION_TRACKER_FRAMES ];
+	int nFrames = backtrace( frames, ALLOCATION_TRACKER_FRAMES );
+
+	int nSites = nCallSites.load( std::memory_order_acquire );
+	for ( int ii = 0; ii < nSites; ++ii ) {
+		CallSite& site = callSites[ ii ];
+		if ( site.nFrames == nFrames &&
+			 memcmp( site.frames, frames, nFrames * sizeof( void* ) ) == 0 ) {
+			site.nCount.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+	}
+
+	// Rather drop a site than wait for another realtime thread.
+	if ( callSitesLock.test_and_set( std::memory_order_acquire ) ) {
+		return;
+	}
+	nSites = nCallSites.load( std::memory_order_relaxed );
+	if ( nSites < ALLOCATION_TRACKER_SITES ) {
+		CallSite& site = callSites[ nSites ];
+		site.nCount.store( 1, std::memory_order_relaxed );
+		site.nFrames = nFrames;
+		memcpy( site.frames, frames, nFrames * sizeof( void* ) );
+		nCallSites.store( nSites + 1, std::memory_order_release );
+	}
+	callSitesLock.clear( std::memory_order_release );
+#else
+	(void) nSize;
+#endif
+}
+
+long long AllocationTracker::getCycles()
+{
+	return nCycles.load();
+}
+
+long long AllocationTracker::getAllocations()
+{
+	return nAllocations.load();
+}
+
+long long AllocationTracker::getAllocatingCycles()
+{
+	return nAllocatingCycles.load();
+}
+
+int AllocationTracker::getMaxAllocationsPerCycle()
+{
+	return nMaxAllocationsPerCycle.load();
+}
+
+QStringList AllocationTracker::getCallSites()
+{
+	QStringList sites;
+#ifdef H2_HAVE_BACKTRACE
+	int nSites = nCallSites.load( std::memory_order_acquire );
+	for ( int ii = 0; ii < nSites; ++ii ) {
+		const CallSite& site = callSites[ ii ];
+		int nFrames = site.nFrames - nSkippedFrames;
+		if ( nFrames <= 0 ) {
+			continue;
+		}
+		char** symbols = backtrace_symbols( site.frames + nSkippedFrames, nFrames );
+		if ( symbols == nullptr ) {
+			continue;
+		}
+		QString sSite = QString( "%1 allocations" ).arg( site.nCount.load() );
+		for ( int nFrame = 0; nFrame < nFrames; ++nFrame ) {
+			sSite.append( QString( "\n    %1" ).arg( symbols[ nFrame ] ) );
+		}
+		free( symbols );
+		sites << sSite;
+	}
+#endif
+	return sites;
+}
+
+void AllocationTracker::reset()
+{
+	nCycles.store( 0 );
+	nAllocations.store( 0 );
+	nAllocatingCycles.store( 0 );
+	nMaxAllocationsPerCycle.store( 0 );
+	nCallSites.store( 0 );
+}
+
+};
@@ -0,0 +1,118 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <QStringList>
+
+#include <cstddef>
+
+/** Maximum number of distinct call sites recorded by the
+	H2Core::AllocationTracker.*/
+#define ALLOCATION_TRACKER_SITES 64
+/** Depth of the backtraces recorded by the
+	H2Core::AllocationTracker.*/
+#define ALLOCATION_TRACKER_FRAMES 16
+
+namespace H2Core
+{
+
+/**
+ * Opt-in instrumentation counting heap allocations on the realtime
+ * threads.
+ *
+ * audioEngine_process() marks each process cycle using a
+ * AllocationTracker::Cycle and the WorkerPool marks the tasks it
+ * executes on behalf of the audio thread using a
+ * AllocationTracker::Scope. An executable wanting to track
+ * allocations includes core/AllocationHooks.h in exactly one of its
+ * translation units. The hooks defined there report each allocation
+ * to recordAllocation(), which does only count those inside a
+ * marked scope.
+ *
+ * While disabled, which is the default, the markers cost a relaxed
+ * atomic load each. Counting and recording call sites neither locks
+ * nor allocates.
+ */
+class AllocationTracker
+{
+public:
+	/** Marks the calling thread as realtime till destruction and
+		accounts a process cycle.*/
+	class Cycle
+	{
+	public:
+		Cycle();
+		~Cycle();
+	private:
+		bool m_bActive;
+	};
+
+	/** Marks the calling thread as realtime till destruction.*/
+	class Scope
+	{
+	public:
+		Scope();
+		~Scope();
+	private:
+		bool m_bActive;
+	};
+
+	/** Enables or disables the tracking. Enabling does also load
+		everything required to capture backtraces, which might
+		allocate on first use.*/
+	static void setEnabled( bool bEnabled );
+	static bool isEnabled();
+
+	/** Called by the hooks of core/AllocationHooks.h for each
+		allocation of @a nSize bytes.*/
+	static void recordAllocation( size_t nSize );
+
+	/** \return Number of cycles since the last reset().*/
+	static long long getCycles();
+	/** \return Number of allocations within marked scopes since the
+		last reset().*/
+	static long long getAllocations();
+	/** \return Number of cycles with at least one allocation since
+		the last reset().*/
+	static long long getAllocatingCycles();
+	/** \return Highest number of allocations in a single cycle since
+		the last reset().*/
+	static int getMaxAllocationsPerCycle();
+	/**
+	 * Symbolized backtraces of the distinct call sites allocating
+	 * since the last reset(), each prefixed with the number of
+	 * allocations. Empty on platforms without backtrace().
+	 *
+	 * Must not be called on a realtime thread.
+	 */
+	static QStringList getCallSites();
+	/** Discards all counts and call sites.*/
+	static void reset();
+};
+
+};
+
+#endif
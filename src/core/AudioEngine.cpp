@@ -29,6 +29,8 @@
 
 #include <core/Hydrogen.h>	// TODO: remove this line as soon as possible
 #include <core/Preferences.h>
+#include <core/Helpers/TickTime.h>
+#include <algorithm>
 #include <cassert>
 
 namespace H2Core
@@ -50,6 +52,18 @@ AudioEngine::AudioEngine()
 		: Object( __class_name )
 		, __sampler( nullptr )
 		, __synth( nullptr )
+		, m_pMetronome( nullptr )
+		, m_pCommandQueue( nullptr )
+		, m_pProfiler( nullptr )
+		, m_pLatencyProbe( nullptr )
+		, m_pOverloadGovernor( nullptr )
+		, m_pPeakMeters( nullptr )
+		, m_pPlaybackSnapshot( nullptr )
+		, m_pColumnSnapshots( nullptr )
+		, m_pPlaybackClock( nullptr )
+		, m_pLinkTransport( nullptr )
+		, m_pNetworkStemOutput( nullptr )
+		, m_pMetricsExporter( nullptr )
 		, m_fElapsedTime( 0 )
 {
 	__instance = this;
@@ -57,6 +71,18 @@ AudioEngine::AudioEngine()
 
 	__sampler = new Sampler;
 	__synth = new Synth;
+	m_pMetronome = new Metronome;
+	m_pCommandQueue = new CommandQueue;
+	m_pProfiler = new ProcessProfiler;
+	m_pLatencyProbe = new LatencyProbe;
+	m_pOverloadGovernor = new OverloadGovernor;
+	m_pPeakMeters = new PeakMeters;
+	m_pPlaybackSnapshot = new PlaybackSnapshot;
+	m_pColumnSnapshots = new ColumnSnapshots;
+	m_pPlaybackClock = new PlaybackClock;
+	m_pLinkTransport = new LinkTransport;
+	m_pNetworkStemOutput = new NetworkStemOutput;
+	m_pMetricsExporter = new MetricsExporter;
 
 #ifdef H2CORE_HAVE_LADSPA
 	Effects::create_instance();
@@ -69,6 +95,8 @@ AudioEngine::AudioEngine()
 AudioEngine::~AudioEngine()
 {
 	INFOLOG( "DESTROY" );
+	// Its thread reads the other helpers.
+	delete m_pMetricsExporter;
 #ifdef H2CORE_HAVE_LADSPA
 	delete Effects::get_instance();
 #endif
@@ -76,6 +104,17 @@ AudioEngine::~AudioEngine()
 //	delete Sequencer::get_instance();
 	delete __sampler;
 	delete __synth;
+	delete m_pMetronome;
+	delete m_pCommandQueue;
+	delete m_pProfiler;
+	delete m_pLatencyProbe;
+	delete m_pOverloadGovernor;
+	delete m_pPeakMeters;
+	delete m_pPlaybackSnapshot;
+	delete m_pColumnSnapshots;
+	delete m_pPlaybackClock;
+	delete m_pLinkTransport;
+	delete m_pNetworkStemOutput;
 }
 
 
@@ -95,6 +134,72 @@ Synth* AudioEngine::get_synth()
 	return __synth;
 }
 
+Metronome* AudioEngine::get_metronome()
+{
+	assert(m_pMetronome);
+	return m_pMetronome;
+}
+
+ProcessProfiler* AudioEngine::get_profiler()
+{
+	assert(m_pProfiler);
+	return m_pProfiler;
+}
+
+LatencyProbe* AudioEngine::get_latency_probe()
+{
+	assert(m_pLatencyProbe);
+	return m_pLatencyProbe;
+}
+
+OverloadGovernor* AudioEngine::get_overload_governor()
+{
+	assert(m_pOverloadGovernor);
+	return m_pOverloadGovernor;
+}
+
+PeakMeters* AudioEngine::get_peak_meters()
+{
+	assert(m_pPeakMeters);
+	return m_pPeakMeters;
+}
+
+PlaybackSnapshot* AudioEngine::get_playback_snapshot()
+{
+	assert(m_pPlaybackSnapshot);
+	return m_pPlaybackSnapshot;
+}
+
+ColumnSnapshots* AudioEngine::get_column_snapshots()
+{
+	assert(m_pColumnSnapshots);
+	return m_pColumnSnapshots;
+}
+
+PlaybackClock* AudioEngine::get_playback_clock()
+{
+	assert(m_pPlaybackClock);
+	return m_pPlaybackClock;
+}
+
+LinkTransport* AudioEngine::get_link_transport()
+{
+	assert(m_pLinkTransport);
+	return m_pLinkTransport;
+}
+
+NetworkStemOutput* AudioEngine::get_network_stem_output()
+{
+	assert(m_pNetworkStemOutput);
+	return m_pNetworkStemOutput;
+}
+
+MetricsExporter* AudioEngine::get_metrics_exporter()
+{
+	assert(m_pMetricsExporter);
+	return m_pMetricsExporter;
+}
+
 void AudioEngine::lock( const char* file, unsigned int line, const char* function )
 {
 	__engine_mutex.lock();
@@ -139,9 +244,10 @@ bool AudioEngine::try_lock_for( std::chrono::microseconds duration, const char*
 
 float AudioEngine::compute_tick_size( const int nSampleRate, const float fBpm, const int nResolution)
 {
-	float fTickSize = nSampleRate * 60.0 / fBpm / nResolution;
-	
-	return fTickSize;
+	// Rounded from the fixed point tick size to agree with
+	// TransportInfo::m_fTickSize.
+	return static_cast<float>( TickTime::toFrames(
+		TickTime::tickSize( std::max( 0, nSampleRate ), fBpm, nResolution ) ) );
 }
 	
 void AudioEngine::calculateElapsedTime( const unsigned sampleRate, const unsigned long nFrame, const int nResolution ) {
@@ -178,47 +284,11 @@ void AudioEngine::calculateElapsedTime( const unsigned sampleRate, const unsigne
 		m_fElapsedTime = static_cast<float>(totalTicks) * fTickSize / 
 			static_cast<float>(sampleRate);
 	} else {
-
-		m_fElapsedTime = 0;
-
-		int nPatternStartInTicks;
-		long totalTicks;
-		long previousTicks = 0;
-		float fPreviousTickSize;
-
-		// TODO: how to handle the BPM before the first marker?
-		fPreviousTickSize = compute_tick_size( static_cast<int>(sampleRate), 
-											   tempoMarkers[0]->fBpm, nResolution );
-		
-		// For each BPM marker on the Timeline we will get the number
-		// of ticks since the previous marker/beginning and convert
-		// them into time using tick size corresponding to the tempo.
-		for ( auto const& mmarker: tempoMarkers ){
-			totalTicks = pHydrogen->getTickForPosition( mmarker->nBar );
-			    
-			if ( totalTicks < currentTick ) {
-				m_fElapsedTime += static_cast<float>(totalTicks - previousTicks) * 
-					fPreviousTickSize / static_cast<float>(sampleRate);
-			} else {
-				m_fElapsedTime += static_cast<float>(currentTick - previousTicks) * 
-					fPreviousTickSize / static_cast<float>(sampleRate);
-				return;
-			}
-
-			fPreviousTickSize = compute_tick_size( static_cast<int>(sampleRate), 
-												   mmarker->fBpm, nResolution );
-			previousTicks = totalTicks;
-		}
-		const int nCurrentPatternNumber = pHydrogen->getPosForTick( currentTick, &nPatternStartInTicks );
-		totalTicks = pHydrogen->getTickForPosition( nCurrentPatternNumber );
-		
-		// The code above calculates the number of ticks elapsed since
-		// the beginning of the Song till the start of the current
-		// pattern. The following line covers the remain ticks.
-		totalTicks += static_cast<long>(currentTick - nPatternStartInTicks);
-
-		m_fElapsedTime += static_cast<float>(totalTicks - previousTicks) * fPreviousTickSize / 
-			static_cast<float>(sampleRate);
+		// The tempo map of the Timeline does already hold the time
+		// passed at each marker.
+		m_fElapsedTime = static_cast<float>(
+			pHydrogen->getTimeline()->getTimeAtTick( static_cast<long>(currentTick),
+													 pHydrogen->getSong() ) );
 	}
 }
 
@@ -243,5 +313,28 @@ void AudioEngine::unlock()
 	__engine_mutex.unlock();
 }
 
+void AudioEngine::postCommand( CommandQueue::Command command )
+{
+	if ( Hydrogen::get_instance()->getState() >= STATE_READY ) {
+		if ( m_pCommandQueue->push( command ) ) {
+			return;
+		}
+		WARNINGLOG( "Command queue is full. Applying command directly." );
+	}
+
+	lock( RIGHT_HERE );
+	// Keep the order of previously posted commands.
+	m_pCommandQueue->process();
+	command();
+	unlock();
+}
+
+void AudioEngine::processCommands()
+{
+	if ( ! m_pCommandQueue->empty() ) {
+		m_pCommandQueue->process();
+	}
+}
+
 
 }; // namespace H2Core
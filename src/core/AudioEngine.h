@@ -25,7 +25,19 @@
 
 #include <core/config.h>
 #include <core/Object.h>
+#include <core/ColumnSnapshots.h>
+#include <core/CommandQueue.h>
+#include <core/PeakMeters.h>
+#include <core/PlaybackClock.h>
+#include <core/PlaybackSnapshot.h>
+#include <core/LatencyProbe.h>
+#include <core/OverloadGovernor.h>
+#include <core/IO/LinkTransport.h>
+#include <core/IO/MetricsExporter.h>
+#include <core/IO/NetworkStemOutput.h>
+#include <core/ProcessProfiler.h>
 #include <core/Sampler/Sampler.h>
+#include <core/Synth/Metronome.h>
 #include <core/Synth/Synth.h>
 
 #include <string>
@@ -78,8 +90,8 @@ public:
 	/** 
 	 * Destructor of the AudioEngine.
 	 *
-	 * Deletes the Effects singleton and the #__sampler and
-	 * #__synth objects.
+	 * Deletes the Effects singleton and the #__sampler, #__synth,
+	 * and #m_pMetronome objects.
 	 */
 	~AudioEngine();
 
@@ -163,6 +175,32 @@ public:
 	 * AudioEngine lock.
 	 */
 	void assertLocked( );
+
+	/**
+	 * Posts a mutation of the Song, a Pattern, or an Instrument to be
+	 * applied by the audio engine.
+	 *
+	 * Instead of acquiring the AudioEngine lock itself - and forcing
+	 * audioEngine_process() to wait or drop a buffer - the calling
+	 * thread hands @a command to the #m_pCommandQueue. It will be
+	 * executed at the beginning of the next process cycle by the
+	 * realtime thread while holding the lock.
+	 *
+	 * If the audio engine is not processing at the moment or the
+	 * queue is full, @a command is applied right away in the calling
+	 * thread while locking the engine via lock().
+	 *
+	 * \param command Function object to apply. It should neither
+	 * block nor allocate memory.
+	 */
+	void postCommand( CommandQueue::Command command );
+	/**
+	 * Applies all pending commands of #m_pCommandQueue.
+	 *
+	 * Called by audioEngine_process(). The AudioEngine must be
+	 * locked by the calling thread.
+	 */
+	void processCommands();
 	
 	static float compute_tick_size( const int nSampleRate, const float fBpm, const int nResolution);
 
@@ -170,6 +208,28 @@ public:
 	Sampler* get_sampler();
 	/** \return #__synth */
 	Synth* get_synth();
+	/** \return #m_pMetronome */
+	Metronome* get_metronome();
+	/** \return #m_pProfiler */
+	ProcessProfiler* get_profiler();
+	/** \return #m_pLatencyProbe */
+	LatencyProbe* get_latency_probe();
+	/** \return #m_pOverloadGovernor */
+	OverloadGovernor* get_overload_governor();
+	/** \return #m_pPeakMeters */
+	PeakMeters* get_peak_meters();
+	/** \return #m_pPlaybackSnapshot */
+	PlaybackSnapshot* get_playback_snapshot();
+	/** \return #m_pColumnSnapshots */
+	ColumnSnapshots* get_column_snapshots();
+	/** \return #m_pPlaybackClock */
+	PlaybackClock* get_playback_clock();
+	/** \return #m_pLinkTransport */
+	LinkTransport* get_link_transport();
+	/** \return #m_pNetworkStemOutput */
+	NetworkStemOutput* get_network_stem_output();
+	/** \return #m_pMetricsExporter */
+	MetricsExporter* get_metrics_exporter();
 	
 	/** \return #m_fElapsedTime */
 	float getElapsedTime() const;
@@ -224,6 +284,34 @@ private:
 	Sampler* __sampler;
 	/** Local instance of the Synth. */
 	Synth* __synth;
+	/** Click generator used for the metronome.*/
+	Metronome* m_pMetronome;
+	/** Commands posted using postCommand() and applied by
+		processCommands().*/
+	CommandQueue* m_pCommandQueue;
+	/** Timing of the stages of audioEngine_process().*/
+	ProcessProfiler* m_pProfiler;
+	/** Latency of notes triggered via MIDI.*/
+	LatencyProbe* m_pLatencyProbe;
+	/** Rendering quality under load.*/
+	OverloadGovernor* m_pOverloadGovernor;
+	/** Peaks of all mixer strips handed to the GUI.*/
+	PeakMeters* m_pPeakMeters;
+	/** Playing and next patterns handed to the GUI and the OSC
+		server.*/
+	PlaybackSnapshot* m_pPlaybackSnapshot;
+	/** Long notes sounding in each column of the song, resumed
+		after relocations.*/
+	ColumnSnapshots* m_pColumnSnapshots;
+	/** Timestamped transport position the GUI extrapolates its
+		playheads from.*/
+	PlaybackClock* m_pPlaybackClock;
+	/** Synchronization with the Ableton Link session.*/
+	LinkTransport* m_pLinkTransport;
+	/** Streaming of the tracks to a remote host.*/
+	NetworkStemOutput* m_pNetworkStemOutput;
+	/** Export of health metrics to fleet monitoring.*/
+	MetricsExporter* m_pMetricsExporter;
 
 	/**
 	 * Mutex for synchronizing the access to the Song object and
@@ -20,6 +20,7 @@
  *
  */
 #include <core/AutomationPathSerializer.h>
+#include <core/Helpers/Xml.h>
 
 namespace H2Core
 {
@@ -62,5 +63,15 @@ void AutomationPathSerializer::write_automation_path(QDomNode &node, const Autom
 	}
 }
 
+void AutomationPathSerializer::write_automation_path(XMLWriter &writer, const AutomationPath &path)
+{
+	for (auto point : path) {
+		writer.start_element("point");
+		writer.write_attribute("x", QString::number(point.first));
+		writer.write_attribute("y", QString::number(point.second));
+		writer.end_element();
+	}
+}
+
 
 }
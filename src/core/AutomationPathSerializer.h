@@ -30,6 +30,8 @@
 namespace H2Core
 {
 
+class XMLWriter;
+
 class AutomationPathSerializer : private Object
 {
 	H2_OBJECT
@@ -39,6 +41,9 @@ public:
 
 	void read_automation_path(const QDomNode &node, AutomationPath &path);
 	void write_automation_path(QDomNode &node, const AutomationPath &path);
+	/** Writes the points of @a path into the element opened last
+		in @a writer.*/
+	void write_automation_path(XMLWriter &writer, const AutomationPath &path);
 
 };
 
@@ -24,6 +24,9 @@
 
 #include "ExponentialTables.h"
 
+#include <algorithm>
+#include <cfloat>
+
 namespace H2Core
 {
 
@@ -72,7 +75,8 @@ ADSR::ADSR( unsigned int attack, unsigned int decay, float sustain, unsigned int
 	__state( ATTACK ),
 	__ticks( 0.0 ),
 	__value( 0.0 ),
-	__release_value( 0.0 )
+	__release_value( 0.0 ),
+	__fading_out( false )
 {
 	normalise();
 }
@@ -85,7 +89,8 @@ ADSR::ADSR( const ADSR* other ) : Object( __class_name ),
 	__state( other->__state ),
 	__ticks( other->__ticks ),
 	__value( other->__value ),
-	__release_value( other->__release_value )
+	__release_value( other->__release_value ),
+	__fading_out( other->__fading_out )
 {
 	normalise();
 }
@@ -148,10 +153,104 @@ float ADSR::get_value( float step )
 	return __value;
 }
 
+/** Number of frames - but at most @a nMaxFrames - which can be
+	computed without checking whether @a fTicks, increased by @a fStep
+	per frame, did pass the end of a segment of length @a
+	nLength. Some frames are kept as a margin for the rounding errors
+	accumulated by adding up @a fStep.*/
+inline static int frames_in_segment( float fTicks, unsigned int nLength, float fStep, int nMaxFrames )
+{
+	if ( fStep <= 0 || nMaxFrames <= 0 ) {
+		return 0;
+	}
+	double fMargin = static_cast<double>( nMaxFrames ) * nLength * FLT_EPSILON + fStep;
+	double fFrames = ( static_cast<double>( nLength ) - fTicks - fMargin ) / fStep;
+	if ( fFrames < 1 ) {
+		return 0;
+	}
+	return std::min( static_cast<int>( fFrames ), nMaxFrames );
+}
+
+void ADSR::get_values( float* pValues, int nFrames, float step )
+{
+	int ii = 0;
+
+	while ( ii < nFrames ) {
+		switch ( __state ) {
+		case ATTACK: {
+			if ( __attack == 0 ) {
+				pValues[ ii++ ] = get_value( step );
+				break;
+			}
+			int nSafe = frames_in_segment( __ticks, __attack, step, nFrames - ii );
+			for ( int nn = 0; nn < nSafe; ++nn ) {
+				__value = convex_exponant( linear_interpolation( 0.0, 1.0, ( __ticks * 1.0 / __attack ) ) );
+				pValues[ ii++ ] = __value;
+				__ticks += step;
+			}
+			if ( ii < nFrames ) {
+				// Handles the transition into the next segment.
+				pValues[ ii++ ] = get_value( step );
+			}
+			break;
+		}
+
+		case DECAY: {
+			if ( __decay == 0 ) {
+				pValues[ ii++ ] = get_value( step );
+				break;
+			}
+			int nSafe = frames_in_segment( __ticks, __decay, step, nFrames - ii );
+			for ( int nn = 0; nn < nSafe; ++nn ) {
+				__value = concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __decay ) ) ) * (1 - __sustain) + __sustain;
+				pValues[ ii++ ] = __value;
+				__ticks += step;
+			}
+			if ( ii < nFrames ) {
+				pValues[ ii++ ] = get_value( step );
+			}
+			break;
+		}
+
+		case SUSTAIN:
+			// Only left via release().
+			__value = __sustain;
+			for ( ; ii < nFrames; ++ii ) {
+				pValues[ ii ] = __sustain;
+			}
+			break;
+
+		case RELEASE: {
+			if ( __release < 256 ) {
+				__release = 256;
+			}
+			int nSafe = frames_in_segment( __ticks, __release, step, nFrames - ii );
+			for ( int nn = 0; nn < nSafe; ++nn ) {
+				__value = concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __release ) ) ) * __release_value;
+				pValues[ ii++ ] = __value;
+				__ticks += step;
+			}
+			if ( ii < nFrames ) {
+				pValues[ ii++ ] = get_value( step );
+			}
+			break;
+		}
+
+		case IDLE:
+		default:
+			__value = 0;
+			for ( ; ii < nFrames; ++ii ) {
+				pValues[ ii ] = 0;
+			}
+		}
+	}
+}
+
 void ADSR::attack()
 {
 	__state = ATTACK;
 	__ticks = 0;
+	__fading_out = false;
 }
 
 float ADSR::release()
@@ -164,6 +263,20 @@ float ADSR::release()
 	return __release_value;
 }
 
+void ADSR::fade_out( unsigned int nTicks )
+{
+	__fading_out = true;
+	if ( __state == IDLE ) {
+		return;
+	}
+	// Bypasses normalise() on purpose. The fade has to be shorter
+	// than any regular release.
+	__release = std::max( nTicks, 1u );
+	__release_value = __value;
+	__state = RELEASE;
+	__ticks = 0;
+}
+
 QString ADSR::toQString( const QString& sPrefix, bool bShort ) const {
 	QString s = Object::sPrintIndention;
 	QString sOutput;
@@ -89,6 +89,40 @@ class ADSR : public Object
 		 * \param step the increment to be added to __ticks
 		 */
 		float get_value( float step );
+		/**
+		 * compute the values of @a nFrames consecutive frames at
+		 * once.
+		 *
+		 * The result is identical to calling get_value() @a nFrames
+		 * times. But the number of frames left in the current
+		 * segment is determined up front so the inner loops do not
+		 * have to check the state for every frame.
+		 *
+		 * \param pValues buffer of at least @a nFrames elements the
+		 * envelope will be written to
+		 * \param nFrames number of frames to compute
+		 * \param step the increment to be added to __ticks per frame
+		 */
+		void get_values( float* pValues, int nFrames, float step );
+		/** \return true if the envelope did reach its end*/
+		bool is_idle() const;
+		/** \return true if the envelope is in its RELEASE state or did
+			already reach its end*/
+		bool is_released() const;
+		/** \return value computed by the latest call to get_value() or
+			get_values()*/
+		float get_current_value() const;
+		/**
+		 * start a release of @a nTicks from the current value
+		 * regardless of the configured __release and of an already
+		 * running release. Used to silence a voice taken by the
+		 * voice stealing of the Sampler without a click.
+		 * \param nTicks duration of the fade out
+		 */
+		void fade_out( unsigned int nTicks );
+		/** \return true if fade_out() was called since the last
+			attack()*/
+		bool is_fading_out() const;
 		/**
 		 * sets state to RELEASE,
 		 * returns 0 if the state is IDLE,
@@ -123,6 +157,7 @@ class ADSR : public Object
 		float __ticks;          ///< current tick count
 		float __value;          ///< current value
 		float __release_value;  ///< value when the release state was entered
+		bool __fading_out;      ///< fade_out() was called since the last attack()
 		void normalise();
 };
 
@@ -168,6 +203,26 @@ inline unsigned int ADSR::get_release()
 	return __release;
 }
 
+inline bool ADSR::is_idle() const
+{
+	return __state == IDLE;
+}
+
+inline bool ADSR::is_released() const
+{
+	return __state == RELEASE || __state == IDLE;
+}
+
+inline float ADSR::get_current_value() const
+{
+	return __value;
+}
+
+inline bool ADSR::is_fading_out() const
+{
+	return __fading_out;
+}
+
 };
 
 #endif // H2C_ADRS_H
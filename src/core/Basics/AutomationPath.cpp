@@ -21,6 +21,8 @@
  */
 #include <core/Basics/AutomationPath.h>
 
+#include <algorithm>
+
 namespace H2Core
 {
 
@@ -30,8 +32,45 @@ AutomationPath::AutomationPath(float min, float max, float def)
 	: Object(__class_name),
 	  _min(min),
 	  _max(max),
-	  _def(def)
+	  _def(def),
+	  _flat(std::make_shared<const flat_points>())
+{
+}
+
+
+/**
+ * \brief Refresh the points used for evaluation
+ *
+ * Has to be called after each change of _points.
+ **/
+void AutomationPath::update_flat()
 {
+	std::shared_ptr<const flat_points> pFlat =
+		std::make_shared<const flat_points>( _points.begin(), _points.end() );
+	std::atomic_store( &_flat, pFlat );
+}
+
+
+/**
+ * \brief Interpolate between two neighbouring points
+ * \param points Non-empty points of a path
+ * \param nNext Index of the first point located after x
+ * \param x Location
+ **/
+float AutomationPath::interpolate( const flat_points& points, size_t nNext, float x ) noexcept
+{
+	if (nNext == 0) {
+		return points.front().second;
+	}
+	if (nNext >= points.size()) {
+		return points.back().second;
+	}
+
+	const auto& p0 = points[nNext - 1];
+	const auto& p1 = points[nNext];
+	float d = (x - p0.first)/(p1.first - p0.first);
+
+	return p0.second + (p1.second - p0.second)*d;
 }
 
 
@@ -39,35 +78,54 @@ AutomationPath::AutomationPath(float min, float max, float def)
  * \brief Get value at given location
  * \param x Location
  *
- * If location is between points, value is computed
+ * If location is between points, value is computed. Use a
+ * Cursor to evaluate the path at many locations.
  **/
 float AutomationPath::get_value(float x) const noexcept
 {
-	if (_points.empty()) {
+	std::shared_ptr<const flat_points> pFlat = std::atomic_load( &_flat );
+	if (pFlat->empty()) {
 		return _def;
 	}
 
-	auto f = _points.begin();
-	if(x <= f->first) {
-		return f->second;
-	}
+	auto i = std::upper_bound( pFlat->begin(), pFlat->end(), x,
+							   []( float x, const std::pair<float,float>& p ) {
+								   return x < p.first; } );
+	return interpolate( *pFlat, i - pFlat->begin(), x );
+}
 
-	auto l = _points.rbegin();
-	if(x >= l->first) {
-		return l->second;
-	}
 
-	auto i = _points.lower_bound(x);
-	auto p1 = *i;
-	auto p0 = *(--i);
-	float x1 = p0.first;
-	float y1 = p0.second;
-	float x2 = p1.first;
-	float y2 = p1.second;
+AutomationPath::Cursor::Cursor( const AutomationPath* pPath )
+	: m_pPoints( std::atomic_load( &pPath->_flat ) ),
+	  m_fDefault( pPath->_def ),
+	  m_nNext( 0 )
+{
+}
+
+
+/**
+ * \brief Get value at given location
+ * \param x Location
+ **/
+float AutomationPath::Cursor::get_value( float x ) noexcept
+{
+	const flat_points& points = *m_pPoints;
+	if (points.empty()) {
+		return m_fDefault;
+	}
 
-	float d = (x-x1)/(x2 - x1);
+	if (m_nNext > 0 && x < points[m_nNext - 1].first) {
+		// Moving backwards. Start over.
+		m_nNext = std::upper_bound( points.begin(), points.end(), x,
+									[]( float x, const std::pair<float,float>& p ) {
+										return x < p.first; } ) - points.begin();
+	} else {
+		while (m_nNext < points.size() && points[m_nNext].first <= x) {
+			++m_nNext;
+		}
+	}
 
-	return y1 + (y2-y1)*d;
+	return interpolate( points, m_nNext, x );
 }
 
 
@@ -79,6 +137,7 @@ float AutomationPath::get_value(float x) const noexcept
 void AutomationPath::add_point(float x, float y)
 {
 	_points[x] = y;
+	update_flat();
 }
 
 
@@ -175,6 +234,7 @@ AutomationPath::iterator AutomationPath::move(iterator &in, float x, float y)
 {
 	_points.erase(in);
 	auto rv = _points.insert(std::make_pair(x,y));
+	update_flat();
 	return rv.first;
 }
 
@@ -188,6 +248,7 @@ void AutomationPath::remove_point(float x)
 	auto it = find(x);
 	if (it != _points.end()) {
 		_points.erase(it);
+		update_flat();
 	}
 }
 
@@ -24,6 +24,8 @@
 
 #include <core/Object.h>
 #include <map>
+#include <memory>
+#include <vector>
 
 #if __cplusplus <= 199711L
 #  define noexcept
@@ -41,6 +43,7 @@ class AutomationPath : public Object
 	typedef std::map<float,float>::const_iterator const_iterator;
 
 	private:
+	typedef std::vector<std::pair<float,float>> flat_points;
 	
 	float _min;
 	float _max;
@@ -48,7 +51,42 @@ class AutomationPath : public Object
 
 	std::map<float,float> _points;
 
+	/** Copy of #_points in contiguous memory used for
+	 * evaluation. Replaced as a whole by update_flat() after each
+	 * edit, so a Cursor created by the audio engine keeps on
+	 * reading the copy it started with.*/
+	std::shared_ptr<const flat_points> _flat;
+
+	void update_flat();
+
+	static float interpolate( const flat_points& points, size_t nNext, float x ) noexcept;
+
 	public:
+
+	/**
+	 * Evaluates a path at a sequence of locations.
+	 *
+	 * Locations which do not decrease are looked up by advancing
+	 * the cursor instead of searching all points. This
+	 * makes evaluating the path for every note of a process cycle
+	 * linear in the number of notes and points.
+	 */
+	class Cursor
+	{
+		public:
+		explicit Cursor( const AutomationPath* pPath );
+
+		/** Same as AutomationPath::get_value() of the path at the
+		 * time the cursor was created.*/
+		float get_value( float x ) noexcept;
+
+		private:
+		std::shared_ptr<const flat_points> m_pPoints;
+		float m_fDefault;
+		/** Index of the first point located after the
+		 * previously queried location.*/
+		size_t m_nNext;
+	};
 	
 	AutomationPath(float min, float max, float def);
 
@@ -0,0 +1,339 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/DeferredSampleLoader.h>
+
+#include <core/AudioEngine.h>
+#include <core/EventQueue.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/SampleLoader.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Threads.h>
+
+#include <algorithm>
+#include <map>
+
+namespace H2Core
+{
+
+const char* DeferredSampleLoader::__class_name = "DeferredSampleLoader";
+
+DeferredSampleLoader* DeferredSampleLoader::__instance = nullptr;
+
+/** Number of samples the worker hands to a single SampleLoader. Keeps
+	prioritize() effective while making use of all cores.*/
+static const int nDeferredBatchSize = 16;
+
+void DeferredSampleLoader::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new DeferredSampleLoader;
+	}
+}
+
+DeferredSampleLoader::DeferredSampleLoader()
+	: Object( __class_name )
+	, m_bQuit( false )
+	, m_bBusy( false )
+{
+	m_worker = std::thread( &DeferredSampleLoader::workerLoop, this );
+}
+
+DeferredSampleLoader::~DeferredSampleLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bQuit = true;
+		m_queue.clear();
+		m_condition.notify_all();
+	}
+	m_worker.join();
+
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+std::set<InstrumentLayer*> DeferredSampleLoader::used_layers( InstrumentList* pInstruments,
+															  PatternList* pPatterns,
+															  float fHumanizeVelocity )
+{
+	std::set<InstrumentLayer*> layers;
+	if ( pInstruments == nullptr || pPatterns == nullptr ) {
+		return layers;
+	}
+
+	std::map<Instrument*, std::set<float>> velocities;
+	for ( int nPattern = 0; nPattern < pPatterns->size(); ++nPattern ) {
+		const Pattern::notes_t* pNotes = pPatterns->get( nPattern )->get_notes();
+		FOREACH_NOTE_CST_IT_BEGIN_END( pNotes, it ) {
+			Note* pNote = it->second;
+			if ( pNote->get_instrument() != nullptr && ! pNote->get_note_off() ) {
+				velocities[ pNote->get_instrument() ].insert( pNote->get_velocity() );
+			}
+		}
+	}
+
+	const int nMaxLayers = InstrumentComponent::getMaxLayers();
+	std::vector<int> selected( nMaxLayers );
+	for ( int nInstr = 0; nInstr < pInstruments->size(); ++nInstr ) {
+		Instrument* pInstrument = pInstruments->get( nInstr );
+		auto it = velocities.find( pInstrument );
+		if ( it == velocities.end() ) {
+			continue;
+		}
+		for ( auto& pComponent : *pInstrument->get_components() ) {
+			if ( fHumanizeVelocity != 0 ) {
+				for ( int nLayer = 0; nLayer < nMaxLayers; ++nLayer ) {
+					if ( pComponent->get_layer( nLayer ) != nullptr ) {
+						layers.insert( pComponent->get_layer( nLayer ) );
+					}
+				}
+				continue;
+			}
+
+			pComponent->update_layer_table();
+			for ( float fVelocity : it->second ) {
+				int nSelected = pComponent->select_layers( fVelocity, selected.data() );
+				// Random and round robin selection pick any of the
+				// matching layers.
+				if ( pInstrument->sample_selection_alg() == Instrument::VELOCITY ) {
+					nSelected = std::min( nSelected, 1 );
+				}
+				for ( int ii = 0; ii < nSelected; ++ii ) {
+					layers.insert( pComponent->get_layer( selected[ ii ] ) );
+				}
+			}
+		}
+	}
+	return layers;
+}
+
+void DeferredSampleLoader::load_song_layers( const std::vector<std::pair<Instrument*, InstrumentLayer*>>& layers,
+											 InstrumentList* pInstruments, PatternList* pPatterns,
+											 float fHumanizeVelocity )
+{
+	DeferredSampleLoader* pDeferred = get_instance();
+	bool bDefer = pDeferred != nullptr &&
+		Preferences::get_instance()->m_bDeferUnusedSamples;
+	std::set<InstrumentLayer*> used;
+	if ( bDefer ) {
+		used = used_layers( pInstruments, pPatterns, fHumanizeVelocity );
+	}
+
+	SampleLoader sampleLoader;
+	std::vector<std::pair<Instrument*, InstrumentLayer*>> loaderLayers;
+	std::vector<std::shared_ptr<Sample>> deferred;
+	for ( const auto& layer : layers ) {
+		auto pSample = layer.second->get_sample();
+		if ( pSample == nullptr ) {
+			continue;
+		}
+		if ( bDefer && used.find( layer.second ) == used.end() ) {
+			deferred.push_back( pSample );
+		} else {
+			sampleLoader.add( pSample, true );
+			loaderLayers.push_back( layer );
+		}
+	}
+
+	sampleLoader.run();
+	for ( int ii = 0; ii < sampleLoader.size(); ++ii ) {
+		Instrument* pInstrument = loaderLayers[ ii ].first;
+		InstrumentLayer* pLayer = loaderLayers[ ii ].second;
+		if ( sampleLoader.is_loaded( ii ) ) {
+			pLayer->set_sample( sampleLoader.get( ii ) );
+		} else {
+			_ERRORLOG( "Error loading sample: " + pLayer->get_sample()->get_filepath() );
+			pLayer->set_sample( nullptr );
+			pInstrument->set_muted( true );
+			pInstrument->set_missing_samples( true );
+		}
+	}
+
+	if ( bDefer ) {
+		_INFOLOG( QString( "Decoded %1 samples, deferred %2" )
+				  .arg( sampleLoader.size() ).arg( deferred.size() ) );
+		pDeferred->load( deferred );
+	}
+}
+
+void DeferredSampleLoader::load( const std::vector<std::shared_ptr<Sample>>& samples )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_queue.clear();
+	for ( const auto& pSample : samples ) {
+		m_queue.push_back( pSample );
+	}
+	m_condition.notify_all();
+}
+
+void DeferredSampleLoader::load_first( std::shared_ptr<Sample> pSample )
+{
+	if ( pSample == nullptr ) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_queue.push_front( pSample );
+	m_condition.notify_all();
+}
+
+void DeferredSampleLoader::prioritize( Instrument* pInstrument )
+{
+	if ( pInstrument == nullptr ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_queue.empty() ) {
+		return;
+	}
+
+	std::set<Sample*> samples;
+	for ( const auto& pComponent : *pInstrument->get_components() ) {
+		for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+			InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+			if ( pLayer != nullptr && pLayer->get_sample() != nullptr ) {
+				samples.insert( pLayer->get_sample().get() );
+			}
+		}
+	}
+
+	std::stable_partition( m_queue.begin(), m_queue.end(),
+						   [&]( const std::weak_ptr<Sample>& pQueued ) {
+							   auto pSample = pQueued.lock();
+							   return pSample != nullptr &&
+								   samples.find( pSample.get() ) != samples.end();
+						   } );
+}
+
+void DeferredSampleLoader::wait()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_condition.wait( lock, [&]() {
+		return m_bQuit || ( m_queue.empty() && ! m_bBusy );
+	} );
+}
+
+void DeferredSampleLoader::workerLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "deferred samples" );
+
+	for ( ;; ) {
+		std::vector<std::shared_ptr<Sample>> targets;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_bBusy = false;
+			m_condition.notify_all();
+			m_condition.wait( lock, [&]() {
+				return m_bQuit || ! m_queue.empty();
+			} );
+			if ( m_bQuit ) {
+				return;
+			}
+			while ( ! m_queue.empty() &&
+					static_cast<int>( targets.size() ) < nDeferredBatchSize ) {
+				auto pTarget = m_queue.front().lock();
+				m_queue.pop_front();
+				// Dropped if the song was closed in the meantime.
+				if ( pTarget != nullptr ) {
+					targets.push_back( pTarget );
+				}
+			}
+			m_bBusy = true;
+		}
+
+		// Samples created by path are not shared with the song before
+		// being decoded completely.
+		SampleLoader sampleLoader;
+		for ( const auto& pTarget : targets ) {
+			sampleLoader.add( pTarget->get_filepath() );
+		}
+		sampleLoader.run( true, false );
+
+		bool bPublished = false;
+		for ( const auto& pTarget : targets ) {
+			auto pLoaded = sampleLoader.take( pTarget->get_filepath() );
+			if ( pLoaded == nullptr ) {
+				ERRORLOG( "Error loading sample: " + pTarget->get_filepath() );
+				continue;
+			}
+			// The released sample is freed when leaving the scope and
+			// thus neither within the AudioEngine lock nor in the
+			// audio thread.
+			auto pReleased = publish( pTarget, pLoaded );
+			bPublished = true;
+		}
+		if ( bPublished ) {
+			EventQueue::get_instance()->push_event( EVENT_LAYER_SAMPLES_LOADED, 0 );
+		}
+	}
+}
+
+std::shared_ptr<Sample> DeferredSampleLoader::publish( std::shared_ptr<Sample> pTarget,
+													   std::shared_ptr<Sample> pLoaded )
+{
+	bool bReplaced = false;
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong != nullptr ) {
+		InstrumentList* pInstrumentList = pSong->getInstrumentList();
+		for ( int nInstr = 0; nInstr < pInstrumentList->size(); ++nInstr ) {
+			Instrument* pInstrument = pInstrumentList->get( nInstr );
+			for ( auto& pComponent : *pInstrument->get_components() ) {
+				for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+					InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+					if ( pLayer != nullptr && pLayer->get_sample() == pTarget ) {
+						pLayer->set_sample( pLoaded );
+						bReplaced = true;
+					}
+				}
+			}
+		}
+	}
+
+	if ( bReplaced ) {
+		AudioEngine::get_instance()->unlock();
+		return pTarget;
+	}
+
+	// The song was not handed to Hydrogen yet.
+	pTarget->swap_data( pLoaded );
+
+	AudioEngine::get_instance()->unlock();
+
+	return pLoaded;
+}
+
+};
@@ -0,0 +1,158 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_DEFERRED_SAMPLE_LOADER_H
+#define H2C_DEFERRED_SAMPLE_LOADER_H
+
+#include <core/Object.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace H2Core
+{
+
+class Instrument;
+class InstrumentLayer;
+class InstrumentList;
+class PatternList;
+class Sample;
+
+/**
+ * Decodes the samples of a song no note of it does trigger in a
+ * background thread.
+ *
+ * With Preferences::m_bDeferUnusedSamples set, load_song_layers()
+ * does only decode the layers selected by the notes of the song's
+ * patterns right away. The others keep their empty placeholder
+ * Sample, which the Sampler renders as silence, until the worker
+ * handed them over. Live input of an instrument moves its samples to
+ * the front of the queue, see prioritize().
+ *
+ * The InstrumentEditor uses the same mechanism to replace the sample
+ * of a single layer while the song keeps on playing, see
+ * load_first().
+ *
+ * #EVENT_LAYER_SAMPLES_LOADED is pushed whenever decoded samples were
+ * handed over.
+ */
+class DeferredSampleLoader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals nullptr, a new DeferredSampleLoader
+		 * singleton will be created and stored in #__instance.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static DeferredSampleLoader* get_instance();
+
+		~DeferredSampleLoader();
+
+		/**
+		 * Decodes the placeholder samples of the layers in @a
+		 * layers, which SongReader::readSong() and
+		 * SongCache::restore() create for unmodified samples.
+		 *
+		 * Unless Preferences::m_bDeferUnusedSamples is set, all of
+		 * them are decoded by a SampleLoader right away. Otherwise
+		 * only the ones in used_layers() are and the remainder is
+		 * queued.
+		 *
+		 * Layers whose sample could not be loaded are cleared and
+		 * their instrument is muted.
+		 */
+		static void load_song_layers( const std::vector<std::pair<Instrument*, InstrumentLayer*>>& layers,
+									  InstrumentList* pInstruments, PatternList* pPatterns,
+									  float fHumanizeVelocity );
+
+		/**
+		 * \return All layers of @a pInstruments the Sampler might
+		 * select for the notes in @a pPatterns. If @a
+		 * fHumanizeVelocity is not zero, all layers of the
+		 * instruments having notes are included.
+		 */
+		static std::set<InstrumentLayer*> used_layers( InstrumentList* pInstruments,
+													   PatternList* pPatterns,
+													   float fHumanizeVelocity );
+
+		/** Queues the placeholders @a samples. Samples of a
+			previous song still pending are dropped.*/
+		void load( const std::vector<std::shared_ptr<Sample>>& samples );
+		/**
+		 * Queues the placeholder @a pSample, a Sample created by
+		 * path only, in front of all others. In contrast to load()
+		 * the pending samples are kept.
+		 *
+		 * The placeholder is meant to be put into a layer with the
+		 * AudioEngine locked just for swapping the pointers.
+		 */
+		void load_first( std::shared_ptr<Sample> pSample );
+		/** Moves the queued samples of @a pInstrument to the front
+			of the queue.*/
+		void prioritize( Instrument* pInstrument );
+		/** Blocks until all queued samples were handed over.*/
+		void wait();
+
+	private:
+		/** Pointer to the DeferredSampleLoader singleton.*/
+		static DeferredSampleLoader* __instance;
+
+		DeferredSampleLoader();
+
+		void workerLoop();
+		/** Hands the decoded @a pLoaded over to the layers of the
+			current song holding @a pTarget or, if there are none,
+			to @a pTarget itself.
+
+			\return The sample not used anymore. To be freed outside
+			of the AudioEngine lock.*/
+		std::shared_ptr<Sample> publish( std::shared_ptr<Sample> pTarget,
+										 std::shared_ptr<Sample> pLoaded );
+
+		std::thread m_worker;
+		bool m_bQuit;
+		/** true while the worker is processing samples taken from
+			#m_queue.*/
+		bool m_bBusy;
+		std::deque<std::weak_ptr<Sample>> m_queue;
+		/** Protects #m_queue, #m_bBusy, and #m_bQuit.*/
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+};
+
+inline DeferredSampleLoader* DeferredSampleLoader::get_instance() {
+	return __instance;
+}
+
+};
+
+#endif
@@ -36,6 +36,8 @@
 
 #include <core/Basics/Sample.h>
 #include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/DrumkitIndex.h>
+#include <core/Helpers/FileInfoCache.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/InstrumentComponent.h>
@@ -43,6 +45,16 @@
 
 #include <core/Helpers/Xml.h>
 #include <core/Helpers/Legacy.h>
+#include <core/Helpers/Threads.h>
+#include <core/Preferences.h>
+
+#include <QDirIterator>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace H2Core
 {
@@ -110,8 +122,18 @@ Drumkit* Drumkit::load_file( const QString& dk_path, const bool load_samples )
 {
 	bool bReadingSuccessful = true;
 	
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	bool bIndexedValid = pIndex != nullptr && pIndex->is_valid( dk_path );
+
+	// Checking the samples of the kit one by one is slow on network
+	// mounts.
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->prefetch( QFileInfo( dk_path ).absolutePath() );
+	}
+
 	XMLDoc doc;
-	if( !doc.read( dk_path, Filesystem::drumkit_xsd_path() ) ) {
+	if( !( bIndexedValid ? doc.read( dk_path ) :
+		   doc.read( dk_path, Filesystem::drumkit_xsd_path() ) ) ) {
 		
 		//Something went wrong. Lets see how old this drumkit is..
 		
@@ -250,6 +272,77 @@ void Drumkit::upgrade_drumkit(Drumkit* pDrumkit, const QString& dk_path)
 	}
 }
 
+int Drumkit::upgrade_drumkits( const QString& sDir, int nJobs, QStringList* pFailed )
+{
+	QStringList drumkitFiles;
+	QDirIterator it( sDir, QStringList() << "drumkit.xml", QDir::Files,
+					 QDirIterator::Subdirectories | QDirIterator::FollowSymlinks );
+	while ( it.hasNext() ) {
+		drumkitFiles << it.next();
+	}
+	if ( drumkitFiles.isEmpty() ) {
+		_WARNINGLOG( QString( "No drumkits found in %1" ).arg( sDir ) );
+		return 0;
+	}
+
+	if ( nJobs <= 0 ) {
+		nJobs = std::max( QThread::idealThreadCount(), 1 );
+	}
+	nJobs = std::min( nJobs, drumkitFiles.size() );
+
+	std::atomic<int> nNext( 0 );
+	std::atomic<int> nUpgraded( 0 );
+	std::mutex failedMutex;
+	QStringList failed;
+
+	auto upgrade = [&]() {
+		Threads::configureCurrentThread( Threads::Role::Background, "drumkit upgrade" );
+		for ( int ii = nNext++; ii < drumkitFiles.size(); ii = nNext++ ) {
+			const QString& sFile = drumkitFiles[ ii ];
+			XMLDoc doc;
+			if ( doc.read( sFile, Filesystem::drumkit_xsd_path() ) ) {
+				continue;
+			}
+
+			// Converts and rewrites the file.
+			Drumkit* pDrumkit = load_file( sFile, false );
+			bool bValid = false;
+			if ( pDrumkit != nullptr ) {
+				delete pDrumkit;
+				XMLDoc upgradedDoc;
+				bValid = upgradedDoc.read( sFile, Filesystem::drumkit_xsd_path() );
+			}
+
+			if ( bValid ) {
+				++nUpgraded;
+				_INFOLOG( QString( "Upgraded drumkit %1" ).arg( sFile ) );
+			} else {
+				_ERRORLOG( QString( "Unable to upgrade drumkit %1" ).arg( sFile ) );
+				std::lock_guard<std::mutex> lock( failedMutex );
+				failed << sFile;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for ( int ii = 1; ii < nJobs; ++ii ) {
+		workers.emplace_back( upgrade );
+	}
+	upgrade();
+	for ( auto& worker : workers ) {
+		worker.join();
+	}
+
+	if ( pFailed != nullptr ) {
+		failed.sort();
+		*pFailed << failed;
+	}
+	if ( nUpgraded > 0 && DrumkitIndex::get_instance() != nullptr ) {
+		DrumkitIndex::get_instance()->invalidate();
+	}
+	return nUpgraded;
+}
+
 void Drumkit::unload_samples()
 {
 	INFOLOG( QString( "Unloading drumkit %1 instrument samples" ).arg( __name ) );
@@ -332,7 +425,11 @@ bool Drumkit::save_file( const QString& dk_path, bool overwrite, int component_i
 	XMLDoc doc;
 	XMLNode root = doc.set_root( "drumkit_info", "drumkit" );
 	save_to( &root, component_id );
-	return doc.write( dk_path );
+	bool bWritten = doc.write( dk_path );
+	if ( DrumkitIndex::get_instance() != nullptr ) {
+		DrumkitIndex::get_instance()->invalidate();
+	}
+	return bWritten;
 }
 
 void Drumkit::save_to( XMLNode* node, int component_id )
@@ -455,6 +552,9 @@ bool Drumkit::remove( const QString& sDrumkitName, Filesystem::Lookup lookup )
 		_ERRORLOG( QString( "Unable to remove drumkit: %1" ).arg( sDrumkitDir ) );
 		return false;
 	}
+	if ( DrumkitIndex::get_instance() != nullptr ) {
+		DrumkitIndex::get_instance()->invalidate();
+	}
 	return true;
 }
 
@@ -501,13 +601,11 @@ bool Drumkit::isUserDrumkit() const {
 	return true;
 }
 	
-bool Drumkit::install( const QString& path )
+bool Drumkit::install( const QString& path, bool bBuildSampleCache )
 {
 	_INFOLOG( QString( "Install drumkit %1" ).arg( path ) );
 #ifdef H2CORE_HAVE_LIBARCHIVE
-	int r;
 	struct archive* arch;
-	struct archive_entry* entry;
 
 	arch = archive_read_new();
 
@@ -535,28 +633,8 @@ bool Drumkit::install( const QString& path )
 
 		return false;
 	}
-	bool ret = true;
-	QString dk_dir = Filesystem::usr_drumkits_dir() + "/";
-	while ( ( r = archive_read_next_header( arch, &entry ) ) != ARCHIVE_EOF ) {
-		if ( r != ARCHIVE_OK ) {
-			_ERRORLOG( QString( "archive_read_next_header() [%1] %2" ).arg( archive_errno( arch ) ).arg( archive_error_string( arch ) ) );
-			ret = false;
-			break;
-		}
-		QString np = dk_dir + archive_entry_pathname( entry );
-
-		QByteArray newpath = np.toLocal8Bit();
-
-		archive_entry_set_pathname( entry, newpath.data() );
-		r = archive_read_extract( arch, entry, 0 );
-		if ( r == ARCHIVE_WARN ) {
-			_WARNINGLOG( QString( "archive_read_extract() [%1] %2" ).arg( archive_errno( arch ) ).arg( archive_error_string( arch ) ) );
-		} else if ( r != ARCHIVE_OK ) {
-			_ERRORLOG( QString( "archive_read_extract() [%1] %2" ).arg( archive_errno( arch ) ).arg( archive_error_string( arch ) ) );
-			ret = false;
-			break;
-		}
-	}
+	QStringList installedKits;
+	bool ret = extract_archive( arch, &installedKits );
 	archive_read_close( arch );
 
 #if ARCHIVE_VERSION_NUMBER < 3000000
@@ -565,6 +643,8 @@ bool Drumkit::install( const QString& path )
 	archive_read_free( arch );
 #endif
 
+	finish_install( installedKits, bBuildSampleCache );
+
 	return ret;
 #else // H2CORE_HAVE_LIBARCHIVE
 #ifndef WIN32
@@ -605,6 +685,9 @@ bool Drumkit::install( const QString& path )
 		_ERRORLOG( QString( "tar_close(): %1" ).arg( QString::fromLocal8Bit( strerror( errno ) ) ) );
 		ret = false;
 	}
+	// libtar does not report the extracted files. Their drumkit.xml
+	// are neither validated nor their samples cached in advance.
+	finish_install( QStringList(), bBuildSampleCache );
 	return ret;
 #else // WIN32
 	_ERRORLOG( "WIN32 NOT IMPLEMENTED" );
@@ -613,6 +696,63 @@ bool Drumkit::install( const QString& path )
 #endif
 }
 
+bool Drumkit::extract_archive( struct archive* pArchive, QStringList* pInstalledKits )
+{
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	int r;
+	struct archive_entry* entry;
+	QString dk_dir = Filesystem::usr_drumkits_dir() + "/";
+	while ( ( r = archive_read_next_header( pArchive, &entry ) ) != ARCHIVE_EOF ) {
+		if ( r != ARCHIVE_OK ) {
+			_ERRORLOG( QString( "archive_read_next_header() [%1] %2" ).arg( archive_errno( pArchive ) ).arg( archive_error_string( pArchive ) ) );
+			return false;
+		}
+		QString np = dk_dir + archive_entry_pathname( entry );
+
+		QByteArray newpath = np.toLocal8Bit();
+
+		archive_entry_set_pathname( entry, newpath.data() );
+		r = archive_read_extract( pArchive, entry, 0 );
+		if ( r == ARCHIVE_WARN ) {
+			_WARNINGLOG( QString( "archive_read_extract() [%1] %2" ).arg( archive_errno( pArchive ) ).arg( archive_error_string( pArchive ) ) );
+		} else if ( r != ARCHIVE_OK ) {
+			_ERRORLOG( QString( "archive_read_extract() [%1] %2" ).arg( archive_errno( pArchive ) ).arg( archive_error_string( pArchive ) ) );
+			return false;
+		}
+		if ( QFileInfo( np ).fileName() == "drumkit.xml" ) {
+			*pInstalledKits << np;
+		}
+	}
+	return true;
+#else
+	_ERRORLOG( "Extracting archives requires libarchive" );
+	return false;
+#endif
+}
+
+void Drumkit::finish_install( const QStringList& installedKits, bool bBuildSampleCache )
+{
+	// Validate the new drumkits right away. Routine loads will reuse
+	// the result instead of running the schema validator.
+	for ( const auto& sKitFile : installedKits ) {
+		XMLDoc doc;
+		doc.read( sKitFile, Filesystem::drumkit_xsd_path(), true );
+	}
+
+	if ( bBuildSampleCache && Preferences::get_instance()->m_bSampleCache ) {
+		for ( const auto& sKitFile : installedKits ) {
+			_INFOLOG( QString( "Caching the samples of %1" ).arg( sKitFile ) );
+			// Loading the samples does store their decoded data.
+			Drumkit* pDrumkit = Drumkit::load_file( sKitFile, true );
+			delete pDrumkit;
+		}
+	}
+
+	if ( DrumkitIndex::get_instance() != nullptr ) {
+		DrumkitIndex::get_instance()->invalidate();
+	}
+}
+
 QString Drumkit::toQString( const QString& sPrefix, bool bShort ) const {
 	QString s = Object::sPrintIndention;
 	QString sOutput;
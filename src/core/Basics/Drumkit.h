@@ -26,6 +26,8 @@
 #include <core/Object.h>
 #include <core/Helpers/Filesystem.h>
 
+struct archive;
+
 namespace H2Core
 {
 
@@ -92,6 +94,9 @@ class Drumkit : public H2Core::Object
 		 * and load_samples() is triggered if @a load_samples
 		 * is true.
 		 *
+		 * Drumkits the DrumkitIndex found to be valid are read
+		 * without validating them again.
+		 *
 		 * \param dk_path is a path to an xml file
 		 * \param load_samples automatically load sample data if set to true
 		 *
@@ -113,6 +118,26 @@ class Drumkit : public H2Core::Object
 		 * our xml schema.
 		 */
 		static void upgrade_drumkit( Drumkit* pDrumkit, const QString& dk_path );
+		/**
+		 * Upgrades all drumkits found in @a sDir and its
+		 * subdirectories which do not comply with the current XML
+		 * Schema definition, see load_file().
+		 *
+		 * The drumkits are converted by @a nJobs threads in
+		 * parallel. Each converted drumkit.xml is validated once
+		 * and the DrumkitIndex is invalidated to record the
+		 * results, so later loads do not enter the legacy code
+		 * path anymore.
+		 *
+		 * \param nJobs Number of threads. One per core if zero or
+		 * less.
+		 * \param pFailed If not nullptr, the paths of all drumkits
+		 * which could not be loaded or do still not validate are
+		 * appended.
+		 *
+		 * \return Number of upgraded drumkits.
+		 */
+		static int upgrade_drumkits( const QString& sDir, int nJobs, QStringList* pFailed = nullptr );
 
 		/**
 		 * check if a user drumkit with the given name
@@ -176,10 +201,37 @@ class Drumkit : public H2Core::Object
 		static bool save( const QString& sName, const QString& sAuthor, const QString& sInfo, const QString& sLicense, const QString& sImage, const QString& sImageLicense, InstrumentList* pInstruments, std::vector<DrumkitComponent*>* pComponents, bool bOverwrite=false );
 		/**
 		 * install a drumkit from a filename
+		 *
+		 * To install an archive while it is still being downloaded
+		 * use DrumkitInstaller instead.
 		 * \param path the path to the new drumkit archive
+		 * \param bBuildSampleCache load the samples of the new
+		 * drumkits once, so their decoded data is stored in the
+		 * SampleCache and the first load is fast as well. Only done
+		 * if Preferences::m_bSampleCache is set.
 		 * \return true on success
 		 */
-		static bool install( const QString& path );
+		static bool install( const QString& path, bool bBuildSampleCache = false );
+		/**
+		 * Extracts all entries of an opened libarchive reader into
+		 * the user drumkit folder.
+		 *
+		 * \param pArchive reader opened by the caller
+		 * \param pInstalledKits the paths of the extracted drumkit.xml
+		 * files are appended to it
+		 * \return true if all entries were extracted
+		 */
+		static bool extract_archive( struct archive* pArchive, QStringList* pInstalledKits );
+		/**
+		 * Completes the installation of freshly extracted
+		 * drumkits. Their drumkit.xml files are validated right away,
+		 * so routine loads can reuse the result, the SampleCache is
+		 * filled if requested and the DrumkitIndex is invalidated.
+		 *
+		 * \param installedKits paths of the extracted drumkit.xml files
+		 * \param bBuildSampleCache see install()
+		 */
+		static void finish_install( const QStringList& installedKits, bool bBuildSampleCache );
 		/**
 		 * remove a drumkit from the disk
 		 * \param dk_name the drumkit name
@@ -35,6 +35,8 @@
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/InstrumentLayer.h>
+#include <core/FX/InsertChain.h>
+#include <core/Helpers/Dsp.h>
 
 namespace H2Core
 {
@@ -52,9 +54,11 @@ DrumkitComponent::DrumkitComponent( const int id, const QString& name )
 	, __out_R( nullptr )
 	, __peak_l( 0.0 )
 	, __peak_r( 0.0 )
+	, __insert_chain( nullptr )
 {
-	__out_L = new float[ MAX_BUFFER_SIZE ];
-	__out_R = new float[ MAX_BUFFER_SIZE ];
+	__out_L = Dsp::allocate( MAX_BUFFER_SIZE );
+	__out_R = Dsp::allocate( MAX_BUFFER_SIZE );
+	__insert_chain = new InsertChain( __out_L, __out_R );
 }
 
 DrumkitComponent::DrumkitComponent( DrumkitComponent* other )
@@ -68,37 +72,24 @@ DrumkitComponent::DrumkitComponent( DrumkitComponent* other )
 	, __out_R( nullptr )
 	, __peak_l( 0.0 )
 	, __peak_r( 0.0 )
+	, __insert_chain( nullptr )
 {
-	__out_L = new float[ MAX_BUFFER_SIZE ];
-	__out_R = new float[ MAX_BUFFER_SIZE ];
+	__out_L = Dsp::allocate( MAX_BUFFER_SIZE );
+	__out_R = Dsp::allocate( MAX_BUFFER_SIZE );
+	__insert_chain = new InsertChain( __out_L, __out_R );
 }
 
 DrumkitComponent::~DrumkitComponent()
 {
-	delete[] __out_L;
-	delete[] __out_R;
+	delete __insert_chain;
+	Dsp::release( __out_L );
+	Dsp::release( __out_R );
 }
 
 void DrumkitComponent::reset_outs( uint32_t nFrames )
 {
-	memset( __out_L, 0, nFrames * sizeof( float ) );
-	memset( __out_R, 0, nFrames * sizeof( float ) );
-}
-
-void DrumkitComponent::set_outs( int nBufferPos, float valL, float valR )
-{
-	__out_L[nBufferPos] += valL;
-	__out_R[nBufferPos] += valR;
-}
-
-float DrumkitComponent::get_out_L( int nBufferPos )
-{
-	return __out_L[nBufferPos];
-}
-
-float DrumkitComponent::get_out_R( int nBufferPos )
-{
-	return __out_R[nBufferPos];
+	Dsp::clear( __out_L, nFrames );
+	Dsp::clear( __out_R, nFrames );
 }
 
 void DrumkitComponent::load_from( DrumkitComponent* component, bool is_live )
@@ -34,6 +34,7 @@ class XMLNode;
 class ADSR;
 class Drumkit;
 class InstrumentLayer;
+class InsertChain;
 
 class DrumkitComponent : public H2Core::Object
 {
@@ -68,10 +69,20 @@ class DrumkitComponent : public H2Core::Object
 		void						set_peak_r( float val );
 		float						get_peak_r() const;
 
+		/** Zeroes the first @a nFrames values of both output
+			buffers at the beginning of a process cycle.*/
 		void						reset_outs( uint32_t nFrames );
-		void						set_outs( int nBufferPos, float valL, float valR );
-		float						get_out_L( int nBufferPos );
-		float						get_out_R( int nBufferPos );
+		/** \return Whole left output buffer of size
+			#MAX_BUFFER_SIZE, aligned to #DSP_BUFFER_ALIGNMENT
+			bytes. The Sampler accumulates the voices of the
+			component block-wise into it.*/
+		float*						get_out_buffer_L() const;
+		/** \return Whole right output buffer. See
+			get_out_buffer_L().*/
+		float*						get_out_buffer_R() const;
+		/** \return Insert effects processing the output
+			buffers. Not copied along with the component.*/
+		InsertChain*				get_insert_chain() const;
 		/** Formatted string version for debugging purposes.
 		 * \param sPrefix String prefix which will be added in front of
 		 * every new line
@@ -95,6 +106,8 @@ class DrumkitComponent : public H2Core::Object
 
 		float *		__out_L;
 		float *		__out_R;
+
+		InsertChain *	__insert_chain;
 };
 
 // DEFINITIONS
@@ -171,6 +184,21 @@ inline float DrumkitComponent::get_peak_r() const
 	return __peak_r;
 }
 
+inline float* DrumkitComponent::get_out_buffer_L() const
+{
+	return __out_L;
+}
+
+inline float* DrumkitComponent::get_out_buffer_R() const
+{
+	return __out_R;
+}
+
+inline InsertChain* DrumkitComponent::get_insert_chain() const
+{
+	return __insert_chain;
+}
+
 };
 
 
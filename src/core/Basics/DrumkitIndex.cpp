@@ -0,0 +1,374 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/DrumkitIndex.h>
+
+#include <core/EventQueue.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Helpers/Xml.h>
+#include "Version.h"
+
+#include <algorithm>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QSaveFile>
+
+namespace H2Core
+{
+
+const char* DrumkitIndex::__class_name = "DrumkitIndex";
+
+DrumkitIndex* DrumkitIndex::__instance = nullptr;
+
+/** Identifies the files written by DrumkitIndex::write_index().*/
+static const quint32 nIndexMagic = 0x48324b49;
+/** Has to be increased whenever the layout of the index changes.*/
+static const quint32 nIndexVersion = 2;
+
+/** \return Modification time of @a sPath in ms since epoch or -1 if
+	it does not exist.*/
+static qint64 modification_time( const QString& sPath )
+{
+	QFileInfo info( sPath );
+	if ( ! info.exists() ) {
+		return -1;
+	}
+	return info.lastModified().toMSecsSinceEpoch();
+}
+
+QDataStream& operator<<( QDataStream& stream, const DrumkitIndex::Entry& entry )
+{
+	stream << entry.sDirName << entry.sPath << entry.sName << entry.sAuthor
+		   << entry.sInfo << entry.sLicense << entry.sImage << entry.sImageLicense
+		   << entry.instruments << entry.components
+		   << entry.nModified << entry.nSize << entry.bLoaded << entry.bValid;
+	return stream;
+}
+
+QDataStream& operator>>( QDataStream& stream, DrumkitIndex::Entry& entry )
+{
+	stream >> entry.sDirName >> entry.sPath >> entry.sName >> entry.sAuthor
+		   >> entry.sInfo >> entry.sLicense >> entry.sImage >> entry.sImageLicense
+		   >> entry.instruments >> entry.components
+		   >> entry.nModified >> entry.nSize >> entry.bLoaded >> entry.bValid;
+	return stream;
+}
+
+void DrumkitIndex::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new DrumkitIndex;
+	}
+}
+
+DrumkitIndex::DrumkitIndex()
+	: Object( __class_name )
+	, m_mutex( QMutex::Recursive )
+	, m_nUserDirModified( -1 )
+	, m_nSystemDirModified( -1 )
+	, m_bDirty( true )
+	, m_bUpdating( false )
+	, m_pWatcher( new QFileSystemWatcher )
+{
+	QObject::connect( m_pWatcher, &QFileSystemWatcher::directoryChanged,
+					  m_pWatcher, [this]( const QString& ) { changed(); } );
+	QObject::connect( m_pWatcher, &QFileSystemWatcher::fileChanged,
+					  m_pWatcher, [this]( const QString& ) { changed(); } );
+
+	QMutexLocker locker( &m_mutex );
+	read_index();
+	update();
+}
+
+DrumkitIndex::~DrumkitIndex()
+{
+	delete m_pWatcher;
+	__instance = nullptr;
+}
+
+QStringList DrumkitIndex::get_drumkit_list( Filesystem::Lookup lookup )
+{
+	QMutexLocker locker( &m_mutex );
+	update();
+
+	QStringList drumkits;
+	for ( const auto& entry : lookup == Filesystem::Lookup::system ?
+			  m_systemEntries : m_userEntries ) {
+		drumkits << entry.sDirName;
+	}
+	return drumkits;
+}
+
+std::vector<DrumkitIndex::Entry> DrumkitIndex::get_entries( Filesystem::Lookup lookup )
+{
+	QMutexLocker locker( &m_mutex );
+	update();
+
+	return lookup == Filesystem::Lookup::system ? m_systemEntries : m_userEntries;
+}
+
+void DrumkitIndex::invalidate()
+{
+	m_bDirty.store( true );
+}
+
+bool DrumkitIndex::is_valid( const QString& sDrumkitFile )
+{
+	QFileInfo info( sDrumkitFile );
+	QString sPath = QDir::cleanPath( info.absoluteFilePath() );
+
+	QMutexLocker locker( &m_mutex );
+	for ( const auto* pEntries : { &m_userEntries, &m_systemEntries } ) {
+		for ( const auto& entry : *pEntries ) {
+			if ( QDir::cleanPath( Filesystem::drumkit_file( entry.sPath ) ) == sPath ) {
+				return entry.bValid &&
+					entry.nModified == info.lastModified().toMSecsSinceEpoch() &&
+					entry.nSize == info.size();
+			}
+		}
+	}
+	return false;
+}
+
+void DrumkitIndex::changed()
+{
+	m_bDirty.store( true );
+	EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LIST_CHANGED, 0 );
+}
+
+void DrumkitIndex::update()
+{
+	if ( m_bUpdating ) {
+		return;
+	}
+
+	// Files written by Hydrogen itself might show up before the
+	// watcher had the chance to report them. Adding or removing a
+	// drumkit does change the modification time of its parent.
+	qint64 nUserDirModified = modification_time( Filesystem::usr_drumkits_dir() );
+	qint64 nSystemDirModified = modification_time( Filesystem::sys_drumkits_dir() );
+	if ( ! m_bDirty.exchange( false ) &&
+		 nUserDirModified == m_nUserDirModified &&
+		 nSystemDirModified == m_nSystemDirModified ) {
+		return;
+	}
+
+	m_bUpdating = true;
+	m_nUserDirModified = nUserDirModified;
+	m_nSystemDirModified = nSystemDirModified;
+
+	bool bChanged = scan( Filesystem::usr_drumkits_dir(), m_userEntries );
+	bChanged = scan( Filesystem::sys_drumkits_dir(), m_systemEntries ) || bChanged;
+	m_bUpdating = false;
+
+	if ( bChanged ) {
+		write_index();
+	}
+
+	watch();
+}
+
+bool DrumkitIndex::scan( const QString& sDir, std::vector<Entry>& entries )
+{
+	std::vector<Entry> newEntries;
+	bool bChanged = false;
+
+	QStringList possible = QDir( sDir ).entryList( QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot );
+	for ( const auto& sDirName : possible ) {
+		QString sPath = sDir + sDirName;
+		if ( ! Filesystem::drumkit_valid( sPath ) ) {
+			ERRORLOG( QString( "drumkit %1 is not usable" ).arg( sDirName ) );
+			continue;
+		}
+
+		QFileInfo info( Filesystem::drumkit_file( sPath ) );
+		qint64 nModified = info.lastModified().toMSecsSinceEpoch();
+		qint64 nSize = info.size();
+
+		auto it = std::find_if( entries.begin(), entries.end(), [&]( const Entry& entry ) {
+			return entry.sDirName == sDirName;
+		} );
+		if ( it != entries.end() && it->nModified == nModified && it->nSize == nSize ) {
+			newEntries.push_back( *it );
+			continue;
+		}
+
+		bChanged = true;
+		Entry entry;
+		entry.sDirName = sDirName;
+		entry.sPath = sPath;
+		entry.nModified = nModified;
+		entry.nSize = nSize;
+		entry.bLoaded = false;
+		entry.bValid = false;
+
+		Drumkit* pDrumkit = Drumkit::load( sPath, false );
+		if ( pDrumkit != nullptr ) {
+			entry.bLoaded = true;
+			entry.sName = pDrumkit->get_name();
+			entry.sAuthor = pDrumkit->get_author();
+			entry.sInfo = pDrumkit->get_info();
+			entry.sLicense = pDrumkit->get_license();
+			entry.sImage = pDrumkit->get_image();
+			entry.sImageLicense = pDrumkit->get_image_license();
+
+			InstrumentList* pInstrList = pDrumkit->get_instruments();
+			for ( int i = 0; i < pInstrList->size(); ++i ) {
+				entry.instruments << pInstrList->get( i )->get_name();
+			}
+			for ( const auto& pComponent : *pDrumkit->get_components() ) {
+				entry.components << pComponent->get_name();
+			}
+			delete pDrumkit;
+
+			// Legacy drumkits are upgraded while being loaded.
+			QFileInfo upgradedInfo( Filesystem::drumkit_file( sPath ) );
+			entry.nModified = upgradedInfo.lastModified().toMSecsSinceEpoch();
+			entry.nSize = upgradedInfo.size();
+
+			// The result is cached by XMLDoc, so this does not
+			// validate the file a second time.
+			XMLDoc doc;
+			entry.bValid = doc.read( Filesystem::drumkit_file( sPath ),
+									 Filesystem::drumkit_xsd_path() );
+		}
+		newEntries.push_back( entry );
+	}
+
+	if ( bChanged || newEntries.size() != entries.size() ) {
+		entries.swap( newEntries );
+		return true;
+	}
+	return false;
+}
+
+void DrumkitIndex::watch()
+{
+	QStringList paths;
+	paths << Filesystem::usr_drumkits_dir() << Filesystem::sys_drumkits_dir();
+	for ( const auto& entry : m_userEntries ) {
+		paths << Filesystem::drumkit_file( entry.sPath );
+	}
+	for ( const auto& entry : m_systemEntries ) {
+		paths << Filesystem::drumkit_file( entry.sPath );
+	}
+
+	QStringList watched = m_pWatcher->files() + m_pWatcher->directories();
+	QStringList missing;
+	for ( const auto& sPath : paths ) {
+		if ( ! watched.contains( sPath ) && QFileInfo( sPath ).exists() ) {
+			missing << sPath;
+		}
+	}
+	if ( ! missing.isEmpty() ) {
+		m_pWatcher->addPaths( missing );
+	}
+}
+
+void DrumkitIndex::read_index()
+{
+	QFile file( Filesystem::drumkit_index_file() );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	quint32 nMagic, nVersion;
+	QString sHydrogenVersion, sUserDir, sSystemDir;
+	stream >> nMagic >> nVersion >> sHydrogenVersion;
+	if ( stream.status() != QDataStream::Ok || nMagic != nIndexMagic ||
+		 nVersion != nIndexVersion ||
+		 sHydrogenVersion != QString( get_version().c_str() ) ) {
+		INFOLOG( QString( "Ignoring outdated drumkit index %1" ).arg( file.fileName() ) );
+		return;
+	}
+
+	std::vector<Entry> userEntries, systemEntries;
+	quint32 nUserEntries, nSystemEntries;
+	stream >> sUserDir >> sSystemDir >> nUserEntries;
+	for ( quint32 i = 0; i < nUserEntries && stream.status() == QDataStream::Ok; ++i ) {
+		Entry entry;
+		stream >> entry;
+		userEntries.push_back( entry );
+	}
+	stream >> nSystemEntries;
+	for ( quint32 i = 0; i < nSystemEntries && stream.status() == QDataStream::Ok; ++i ) {
+		Entry entry;
+		stream >> entry;
+		systemEntries.push_back( entry );
+	}
+
+	if ( stream.status() != QDataStream::Ok ) {
+		WARNINGLOG( QString( "Drumkit index %1 is corrupt" ).arg( file.fileName() ) );
+		return;
+	}
+
+	// Using another data folder does e.g. happen in the unit tests.
+	if ( sUserDir == Filesystem::usr_drumkits_dir() ) {
+		m_userEntries.swap( userEntries );
+	}
+	if ( sSystemDir == Filesystem::sys_drumkits_dir() ) {
+		m_systemEntries.swap( systemEntries );
+	}
+}
+
+void DrumkitIndex::write_index()
+{
+	QSaveFile file( Filesystem::drumkit_index_file() );
+	if ( ! file.open( QIODevice::WriteOnly ) ) {
+		WARNINGLOG( QString( "Unable to write drumkit index %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	stream << nIndexMagic << nIndexVersion << QString( get_version().c_str() )
+		   << Filesystem::usr_drumkits_dir() << Filesystem::sys_drumkits_dir();
+	stream << static_cast<quint32>( m_userEntries.size() );
+	for ( const auto& entry : m_userEntries ) {
+		stream << entry;
+	}
+	stream << static_cast<quint32>( m_systemEntries.size() );
+	for ( const auto& entry : m_systemEntries ) {
+		stream << entry;
+	}
+
+	if ( ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to write drumkit index %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+	}
+}
+
+};
@@ -0,0 +1,173 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_DRUMKIT_INDEX_H
+#define H2C_DRUMKIT_INDEX_H
+
+#include <core/Object.h>
+#include <core/Helpers/Filesystem.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+#include <atomic>
+#include <vector>
+
+class QDataStream;
+class QFileSystemWatcher;
+
+namespace H2Core
+{
+
+/**
+ * Persistent index of all installed user and system drumkits.
+ *
+ * Listing the drumkits used to require reading the drumkit directories
+ * and the drumkit.xml file of each single kit. The index keeps the
+ * metadata of all kits in memory and in
+ * Filesystem::drumkit_index_file(), so the SoundLibraryPanel and
+ * Filesystem::drumkit_path_search() can answer without touching the
+ * disk.
+ *
+ * A QFileSystemWatcher observes both drumkit directories and all
+ * drumkit.xml files. Once one of them changes, the next query does
+ * only reread the kits whose drumkit.xml differs in size or
+ * modification time from the indexed one and
+ * #EVENT_DRUMKIT_LIST_CHANGED is pushed. Since the watcher requires
+ * an event loop, code modifying a drumkit should still call
+ * invalidate().
+ */
+class DrumkitIndex : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Metadata of an installed drumkit.*/
+		struct Entry {
+			/** Name of the drumkit directory.*/
+			QString sDirName;
+			/** Absolute path of the drumkit directory.*/
+			QString sPath;
+			QString sName;
+			QString sAuthor;
+			QString sInfo;
+			QString sLicense;
+			QString sImage;
+			QString sImageLicense;
+			QStringList instruments;
+			QStringList components;
+			/** Modification time of drumkit.xml in ms since epoch.*/
+			qint64 nModified;
+			/** Size of drumkit.xml in bytes.*/
+			qint64 nSize;
+			/** Whether drumkit.xml could be read. If not, all
+				metadata is empty.*/
+			bool bLoaded;
+			/** Whether drumkit.xml - after upgrading a legacy kit -
+				complies with Filesystem::drumkit_xsd_path().*/
+			bool bValid;
+		};
+
+		/**
+		 * If #__instance equals nullptr, a new DrumkitIndex
+		 * singleton will be created and stored in #__instance.
+		 *
+		 * Has to be called in the main thread.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static DrumkitIndex* get_instance();
+
+		~DrumkitIndex();
+
+		/**
+		 * \param lookup Either Filesystem::Lookup::user or
+		 * Filesystem::Lookup::system.
+		 * \return Directory names of all usable drumkits, see
+		 * Filesystem::usr_drumkit_list().
+		 */
+		QStringList get_drumkit_list( Filesystem::Lookup lookup );
+		/**
+		 * \param lookup Either Filesystem::Lookup::user or
+		 * Filesystem::Lookup::system.
+		 * \return Metadata of all usable drumkits, including the
+		 * ones failing to load.
+		 */
+		std::vector<Entry> get_entries( Filesystem::Lookup lookup );
+
+		/** Forces the next query to check all drumkits for changes.*/
+		void invalidate();
+
+		/**
+		 * Does not update the index.
+		 *
+		 * \param sDrumkitFile Path to a drumkit.xml file.
+		 * \return true if @a sDrumkitFile was found to comply with
+		 * the current XML Schema definition when it was indexed and
+		 * did not change since.
+		 */
+		bool is_valid( const QString& sDrumkitFile );
+
+	private:
+		DrumkitIndex();
+
+		/** Brings the index up to date if it was invalidated or one
+			of the drumkit directories changed. Has to be called with
+			#m_mutex locked.*/
+		void update();
+		/** Rescans @a sDir rereading changed kits only.
+			\return true if @a entries did change.*/
+		bool scan( const QString& sDir, std::vector<Entry>& entries );
+		/** Adds all directories and drumkit.xml files to the
+			watcher not observed yet.*/
+		void watch();
+		/** Called by #m_pWatcher.*/
+		void changed();
+
+		void read_index();
+		void write_index();
+
+		static DrumkitIndex* __instance;
+
+		/** Recursive since reading a drumkit might list the drumkits
+			itself.*/
+		QMutex m_mutex;
+		std::vector<Entry> m_userEntries;
+		std::vector<Entry> m_systemEntries;
+		/** Modification times of the user and system drumkit
+			directories at the time of the last update().*/
+		qint64 m_nUserDirModified;
+		qint64 m_nSystemDirModified;
+		std::atomic<bool> m_bDirty;
+		/** Set while update() runs to prevent recursive updates.*/
+		bool m_bUpdating;
+		QFileSystemWatcher* m_pWatcher;
+};
+
+inline DrumkitIndex* DrumkitIndex::get_instance() {
+	return __instance;
+}
+
+};
+
+#endif
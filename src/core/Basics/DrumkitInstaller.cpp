@@ -0,0 +1,214 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/DrumkitInstaller.h>
+#include <core/config.h>
+#ifdef H2CORE_HAVE_LIBARCHIVE
+#include <archive.h>
+#endif
+
+#include <core/Basics/Drumkit.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Helpers/Threads.h>
+
+#include <cerrno>
+
+namespace H2Core
+{
+
+const char* DrumkitInstaller::__class_name = "DrumkitInstaller";
+
+#ifdef H2CORE_HAVE_LIBARCHIVE
+#if ARCHIVE_VERSION_NUMBER < 3000000
+static ssize_t readArchive( struct archive* pArchive, void* pInstaller, const void** ppBuffer )
+#else
+static la_ssize_t readArchive( struct archive* pArchive, void* pInstaller, const void** ppBuffer )
+#endif
+{
+	int nSize = static_cast<DrumkitInstaller*>( pInstaller )->nextChunk( ppBuffer );
+	if ( nSize < 0 ) {
+		archive_set_error( pArchive, ECANCELED, "Installation aborted" );
+	}
+	return nSize;
+}
+#endif
+
+DrumkitInstaller::DrumkitInstaller( bool bBuildSampleCache )
+	: Object( __class_name )
+	, m_bBuildSampleCache( bBuildSampleCache )
+	, m_bEndOfData( false )
+	, m_bAborted( false )
+	, m_bDone( false )
+	, m_bSuccess( false )
+	, m_bJoined( false )
+{
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	m_worker = std::thread( &DrumkitInstaller::workerLoop, this );
+#else
+	m_spool.setFileName( Filesystem::tmp_file_path( "drumkit.h2drumkit" ) );
+	if ( ! m_spool.open( QIODevice::WriteOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1" ).arg( m_spool.fileName() ) );
+		m_bDone = true;
+	}
+#endif
+}
+
+DrumkitInstaller::~DrumkitInstaller()
+{
+	if ( ! m_bJoined ) {
+		abort();
+	}
+}
+
+void DrumkitInstaller::feed( const QByteArray& data )
+{
+	if ( data.isEmpty() ) {
+		return;
+	}
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_bDone || m_bEndOfData || m_bAborted ) {
+		return;
+	}
+	m_chunks.push_back( data );
+	m_condition.notify_all();
+#else
+	if ( ! m_bDone && m_spool.write( data ) != data.size() ) {
+		ERRORLOG( QString( "Unable to write %1" ).arg( m_spool.fileName() ) );
+		m_bDone = true;
+	}
+#endif
+}
+
+bool DrumkitInstaller::finish()
+{
+	if ( m_bJoined ) {
+		return m_bSuccess;
+	}
+	m_bJoined = true;
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bEndOfData = true;
+		m_condition.notify_all();
+	}
+	m_worker.join();
+#else
+	if ( ! m_bDone ) {
+		m_spool.close();
+		m_bSuccess = Drumkit::install( m_spool.fileName(), m_bBuildSampleCache );
+		m_bDone = true;
+	}
+	m_spool.remove();
+#endif
+	return m_bSuccess;
+}
+
+void DrumkitInstaller::abort()
+{
+	if ( m_bJoined ) {
+		return;
+	}
+	m_bJoined = true;
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bAborted = true;
+		m_chunks.clear();
+		m_condition.notify_all();
+	}
+	m_worker.join();
+#else
+	m_spool.close();
+	m_spool.remove();
+#endif
+	m_bSuccess = false;
+}
+
+int DrumkitInstaller::nextChunk( const void** ppBuffer )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_condition.wait( lock, [&]() {
+		return m_bAborted || m_bEndOfData || ! m_chunks.empty();
+	} );
+	if ( m_bAborted ) {
+		return -1;
+	}
+	if ( m_chunks.empty() ) {
+		return 0;
+	}
+	// libarchive reads from the buffer until it asks for the next
+	// one.
+	m_current = std::move( m_chunks.front() );
+	m_chunks.pop_front();
+	*ppBuffer = m_current.constData();
+	return m_current.size();
+}
+
+void DrumkitInstaller::workerLoop()
+{
+#ifdef H2CORE_HAVE_LIBARCHIVE
+	Threads::configureCurrentThread( Threads::Role::Background, "drumkit installer" );
+
+	struct archive* arch = archive_read_new();
+
+#if ARCHIVE_VERSION_NUMBER < 3000000
+	archive_read_support_compression_all( arch );
+#else
+	archive_read_support_filter_all( arch );
+#endif
+
+	archive_read_support_format_all( arch );
+
+	bool bSuccess = false;
+	QStringList installedKits;
+	if ( archive_read_open( arch, this, nullptr, readArchive, nullptr ) != ARCHIVE_OK ) {
+		ERRORLOG( QString( "archive_read_open() [%1] %2" ).arg( archive_errno( arch ) ).arg( archive_error_string( arch ) ) );
+	} else {
+		bSuccess = Drumkit::extract_archive( arch, &installedKits );
+		archive_read_close( arch );
+	}
+
+#if ARCHIVE_VERSION_NUMBER < 3000000
+	archive_read_finish( arch );
+#else
+	archive_read_free( arch );
+#endif
+
+	bool bAborted;
+	{
+		// Data fed after a failure is dropped right away.
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bDone = true;
+		m_chunks.clear();
+		bAborted = m_bAborted;
+	}
+	// Whatever got extracted is kept and becomes visible.
+	Drumkit::finish_install( installedKits, m_bBuildSampleCache && ! bAborted );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_bSuccess = bSuccess && ! bAborted;
+#endif
+}
+
+};
@@ -0,0 +1,122 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_DRUMKIT_INSTALLER_H
+#define H2C_DRUMKIT_INSTALLER_H
+
+#include <core/Object.h>
+
+#include <QByteArray>
+#include <QFile>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace H2Core
+{
+
+/**
+ * Installs a drumkit archive while it is still being received.
+ *
+ * The data handed to feed(), e.g. by a running download, is extracted
+ * into the user drumkit folder by a background thread using the
+ * streaming reader of libarchive. Unpacking does therefore overlap
+ * with the transfer and the archive itself is never written to
+ * disk. Without libarchive the data is collected in a temporary file
+ * installed by finish() using Drumkit::install().
+ *
+ * All methods have to be called from the same thread.
+ */
+class DrumkitInstaller : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** \param bBuildSampleCache see Drumkit::install()*/
+		DrumkitInstaller( bool bBuildSampleCache = false );
+		/** Calls abort() unless finish() was called before.*/
+		~DrumkitInstaller();
+
+		/**
+		 * Hands the next part of the archive to the worker. Nothing
+		 * is done once the extraction failed.
+		 *
+		 * \param data next bytes of the archive
+		 */
+		void feed( const QByteArray& data );
+		/**
+		 * Marks the end of the archive and waits for the worker to
+		 * extract the remaining entries and complete the
+		 * installation using Drumkit::finish_install().
+		 *
+		 * \return true if the whole archive was installed
+		 */
+		bool finish();
+		/**
+		 * Stops the extraction, e.g. because the download
+		 * failed. Entries already extracted are kept.
+		 */
+		void abort();
+
+		/**
+		 * Provides the next chunk to the read callback of
+		 * libarchive. Blocks the worker until there is one.
+		 *
+		 * \param ppBuffer set to the chunk
+		 * \return its size, 0 at the end of the archive, and -1 if
+		 * the installation was aborted
+		 */
+		int nextChunk( const void** ppBuffer );
+
+	private:
+		/** Extracts the archive while the data is fed. Only used with
+			libarchive.*/
+		void workerLoop();
+
+		bool m_bBuildSampleCache;
+		/** Chunks not handed to libarchive yet.*/
+		std::deque<QByteArray> m_chunks;
+		/** Chunk libarchive is reading from.*/
+		QByteArray m_current;
+		/** Set by finish().*/
+		bool m_bEndOfData;
+		/** Set by abort().*/
+		bool m_bAborted;
+		/** Set by the worker once it stopped extracting.*/
+		bool m_bDone;
+		/** Whether all entries were extracted.*/
+		bool m_bSuccess;
+		/** Whether finish() or abort() was called.*/
+		bool m_bJoined;
+		/** Protects all members above but #m_bJoined.*/
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::thread m_worker;
+		/** Archive collected without libarchive.*/
+		QFile m_spool;
+};
+
+};
+
+#endif
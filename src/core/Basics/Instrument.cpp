@@ -30,6 +30,8 @@
 
 #include <core/Basics/Adsr.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleLoader.h>
+#include <core/Basics/SamplePool.h>
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/DrumkitComponent.h>
 #include <core/Basics/InstrumentList.h>
@@ -41,43 +43,34 @@ namespace H2Core
 
 const char* Instrument::__class_name = "Instrument";
 
+std::atomic<int> Instrument::__midi_out_note_revision( 0 );
+std::atomic<int> Instrument::__lookup_revision( 0 );
+
 Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 	: Object( __class_name )
 	, __id( id )
 	, __name( name )
-	, __gain( 1.0 )
-	, __volume( 1.0 )
-	, __pan_l( 1.0 )
-	, __pan_r( 1.0 )
-	, __peak_l( 0.0 )
-	, __peak_r( 0.0 )
-	, __adsr( adsr )
-	, __filter_active( false )
-	, __filter_cutoff( 1.0 )
-	, __filter_resonance( 0.0 )
-	, __pitch_offset( 0.0 )
-	, __random_pitch_factor( 0.0 )
 	, __midi_out_note( 36 + id )
 	, __midi_out_channel( -1 )
 	, __stop_notes( false )
-	, __sample_selection_alg( VELOCITY )
 	, __active( true )
-	, __soloed( false )
-	, __muted( false )
-	, __mute_group( -1 )
 	, __queued( 0 )
+	, __voices( nullptr )
+	, __render_voices( 0 )
+	, __render_frames( 0 )
+	, __render_resampled_frames( 0 )
+	, __render_nanoseconds( 0 )
 	, __hihat_grp( -1 )
 	, __lower_cc( 0 )
 	, __higher_cc( 127 )
-	, __components( nullptr )
+	, __output_bus( "" )
 	, __is_preview_instrument(false)
 	, __is_metronome_instrument(false)
-	, __apply_velocity( true )
-	, __current_instr_for_export(false)
 	, m_bHasMissingSamples( false )
 {
-	if ( __adsr == nullptr ) {
-		__adsr = new ADSR();
+	__render.pADSR = adsr;
+	if ( __render.pADSR == nullptr ) {
+		__render.pADSR = new ADSR();
 	}
 
     if( __midi_out_note < MIDI_OUT_NOTE_MIN ){
@@ -88,53 +81,37 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
 		__midi_out_note = MIDI_OUT_NOTE_MAX;	
 	}
 	
-	for ( int i=0; i<MAX_FX; i++ ) {
-		__fx_level[i] = 0.0;
-	}
-	__components = new std::vector<InstrumentComponent*> ();
+	__render.pComponents = new std::vector<InstrumentComponent*> ();
 }
 
 Instrument::Instrument( Instrument* other )
 	: Object( __class_name )
+	, __render( other->__render )
 	, __id( other->get_id() )
 	, __name( other->get_name() )
-	, __gain( other->__gain )
-	, __volume( other->get_volume() )
-	, __pan_l( other->get_pan_l() )
-	, __pan_r( other->get_pan_r() )
-	, __peak_l( other->get_peak_l() )
-	, __peak_r( other->get_peak_r() )
-	, __adsr( new ADSR( *( other->get_adsr() ) ) )
-	, __filter_active( other->is_filter_active() )
-	, __filter_cutoff( other->get_filter_cutoff() )
-	, __filter_resonance( other->get_filter_resonance() )
-	, __pitch_offset( other->get_pitch_offset() )
-	, __random_pitch_factor( other->get_random_pitch_factor() )
 	, __midi_out_note( other->get_midi_out_note() )
 	, __midi_out_channel( other->get_midi_out_channel() )
 	, __stop_notes( other->is_stop_notes() )
-	, __sample_selection_alg( other->sample_selection_alg() )
 	, __active( other->is_active() )
-	, __soloed( other->is_soloed() )
-	, __muted( other->is_muted() )
-	, __mute_group( other->get_mute_group() )
 	, __queued( other->is_queued() )
+	, __voices( nullptr )
+	, __render_voices( 0 )
+	, __render_frames( 0 )
+	, __render_resampled_frames( 0 )
+	, __render_nanoseconds( 0 )
 	, __hihat_grp( other->get_hihat_grp() )
 	, __lower_cc( other->get_lower_cc() )
 	, __higher_cc( other->get_higher_cc() )
-	, __components( nullptr )
+	, __output_bus( other->get_output_bus() )
 	, __is_preview_instrument(false)
 	, __is_metronome_instrument(false)
-	, __apply_velocity( other->get_apply_velocity() )
-	, __current_instr_for_export(false)
 {
-	for ( int i=0; i<MAX_FX; i++ ) {
-		__fx_level[i] = other->get_fx_level( i );
-	}
+	__render.pADSR = new ADSR( *( other->get_adsr() ) );
+	__render.bCurrentlyExported = false;
 
-	__components = new std::vector<InstrumentComponent*> ();
+	__render.pComponents = new std::vector<InstrumentComponent*> ();
 	for (auto it = other->get_components()->begin(); it != other->get_components()->end(); ++it) {
-		__components->push_back(new InstrumentComponent(*it));
+		__render.pComponents->push_back(new InstrumentComponent(*it));
 	}
 }
 
@@ -144,10 +121,10 @@ Instrument::~Instrument()
 		delete pComponent;
 	}	
 
-	delete __components;
+	delete __render.pComponents;
 
-	delete __adsr;
-	__adsr = nullptr;
+	delete __render.pADSR;
+	__render.pADSR = nullptr;
 }
 
 Instrument* Instrument::load_instrument( const QString& drumkit_name, const QString& instrument_name, Filesystem::Lookup lookup )
@@ -157,7 +134,7 @@ Instrument* Instrument::load_instrument( const QString& drumkit_name, const QStr
 	return pInstrument;
 }
 
-void Instrument::load_from( Drumkit* pDrumkit, Instrument* pInstrument, bool is_live )
+void Instrument::load_from( Drumkit* pDrumkit, Instrument* pInstrument, bool is_live, SampleLoader* pLoader )
 {
 	if ( is_live ) {
 		AudioEngine::get_instance()->lock( RIGHT_HERE );
@@ -197,7 +174,13 @@ void Instrument::load_from( Drumkit* pDrumkit, Instrument* pInstrument, bool is_
 				}
 			} else {
 				QString sample_path =  pDrumkit->get_path() + "/" + src_layer->get_sample()->get_filename();
-				auto pSample = Sample::load( sample_path );
+				std::shared_ptr<Sample> pSample;
+				if ( pLoader != nullptr ) {
+					pSample = pLoader->take( sample_path );
+				}
+				if ( pSample == nullptr ) {
+					pSample = SamplePool::load( sample_path, true );
+				}
 				if ( pSample == nullptr ) {
 					_ERRORLOG( QString( "Error loading sample %1. Creating a new empty layer." ).arg( sample_path ) );
 					set_missing_samples( true );
@@ -361,28 +344,28 @@ void Instrument::save_to( XMLNode* node, int component_id )
 	XMLNode InstrumentNode = node->createNode( "instrument" );
 	InstrumentNode.write_int( "id", __id );
 	InstrumentNode.write_string( "name", __name );
-	InstrumentNode.write_float( "volume", __volume );
-	InstrumentNode.write_bool( "isMuted", __muted );
-	InstrumentNode.write_bool( "isSoloed", __soloed );
-	InstrumentNode.write_float( "pan_L", __pan_l );
-	InstrumentNode.write_float( "pan_R", __pan_r );
-	InstrumentNode.write_float( "pitchOffset", __pitch_offset );
-	InstrumentNode.write_float( "randomPitchFactor", __random_pitch_factor );
-	InstrumentNode.write_float( "gain", __gain );
-	InstrumentNode.write_bool( "applyVelocity", __apply_velocity );
-	InstrumentNode.write_bool( "filterActive", __filter_active );
-	InstrumentNode.write_float( "filterCutoff", __filter_cutoff );
-	InstrumentNode.write_float( "filterResonance", __filter_resonance );
-	InstrumentNode.write_float( "Attack", __adsr->get_attack() );
-	InstrumentNode.write_float( "Decay", __adsr->get_decay() );
-	InstrumentNode.write_float( "Sustain", __adsr->get_sustain() );
-	InstrumentNode.write_float( "Release", __adsr->get_release() );
-	InstrumentNode.write_int( "muteGroup", __mute_group );
+	InstrumentNode.write_float( "volume", __render.fVolume );
+	InstrumentNode.write_bool( "isMuted", __render.bMuted );
+	InstrumentNode.write_bool( "isSoloed", __render.bSoloed );
+	InstrumentNode.write_float( "pan_L", __render.fPan_L );
+	InstrumentNode.write_float( "pan_R", __render.fPan_R );
+	InstrumentNode.write_float( "pitchOffset", __render.fPitchOffset );
+	InstrumentNode.write_float( "randomPitchFactor", __render.fRandomPitchFactor );
+	InstrumentNode.write_float( "gain", __render.fGain );
+	InstrumentNode.write_bool( "applyVelocity", __render.bApplyVelocity );
+	InstrumentNode.write_bool( "filterActive", __render.bFilterActive );
+	InstrumentNode.write_float( "filterCutoff", __render.fFilterCutoff );
+	InstrumentNode.write_float( "filterResonance", __render.fFilterResonance );
+	InstrumentNode.write_float( "Attack", __render.pADSR->get_attack() );
+	InstrumentNode.write_float( "Decay", __render.pADSR->get_decay() );
+	InstrumentNode.write_float( "Sustain", __render.pADSR->get_sustain() );
+	InstrumentNode.write_float( "Release", __render.pADSR->get_release() );
+	InstrumentNode.write_int( "muteGroup", __render.nMuteGroup );
 	InstrumentNode.write_int( "midiOutChannel", __midi_out_channel );
 	InstrumentNode.write_int( "midiOutNote", __midi_out_note );
 	InstrumentNode.write_bool( "isStopNote", __stop_notes );
 
-	switch ( __sample_selection_alg ) {
+	switch ( __render.sampleSelectionAlg ) {
 	case VELOCITY:
 		InstrumentNode.write_string( "sampleSelectionAlgo", "VELOCITY" );
 		break;
@@ -399,9 +382,9 @@ void Instrument::save_to( XMLNode* node, int component_id )
 	InstrumentNode.write_int( "higher_cc", __higher_cc );
 
 	for ( int i=0; i<MAX_FX; i++ ) {
-		InstrumentNode.write_float( QString( "FX%1Level" ).arg( i+1 ), __fx_level[i] );
+		InstrumentNode.write_float( QString( "FX%1Level" ).arg( i+1 ), __render.fFxLevel[i] );
 	}
-	for (std::vector<InstrumentComponent*>::iterator it = __components->begin() ; it != __components->end(); ++it) {
+	for (std::vector<InstrumentComponent*>::iterator it = __render.pComponents->begin() ; it != __render.pComponents->end(); ++it) {
 		InstrumentComponent* pComponent = *it;
 		if( component_id == -1 || pComponent->get_drumkit_componentID() == component_id ) {
 			pComponent->save_to( &InstrumentNode, component_id );
@@ -411,10 +394,10 @@ void Instrument::save_to( XMLNode* node, int component_id )
 
 void Instrument::set_adsr( ADSR* adsr )
 {
-	if( __adsr ) {
-		delete __adsr;
+	if( __render.pADSR ) {
+		delete __render.pADSR;
 	}
-	__adsr = adsr;
+	__render.pADSR = adsr;
 }
 
 InstrumentComponent* Instrument::get_component( int DrumkitComponentID )
@@ -436,42 +419,44 @@ QString Instrument::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2id: %3\n" ).arg( sPrefix ).arg( s ).arg( __id ) )
 			.append( QString( "%1%2name: %3\n" ).arg( sPrefix ).arg( s ).arg( __name ) )
 			.append( QString( "%1%2drumkit_name: %3\n" ).arg( sPrefix ).arg( s ).arg( __drumkit_name ) )
-			.append( QString( "%1%2gain: %3\n" ).arg( sPrefix ).arg( s ).arg( __gain ) )
-			.append( QString( "%1%2volume: %3\n" ).arg( sPrefix ).arg( s ).arg( __volume ) )
-			.append( QString( "%1%2pan_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __pan_l ) )
-			.append( QString( "%1%2pan_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __pan_r ) )
-			.append( QString( "%1%2peak_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __peak_l ) )
-			.append( QString( "%1%2peak_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __peak_r ) )
-			.append( QString( "%1" ).arg( __adsr->toQString( sPrefix + s, bShort ) ) )
-			.append( QString( "%1%2filter_active: %3\n" ).arg( sPrefix ).arg( s ).arg( __filter_active ) )
-			.append( QString( "%1%2filter_cutoff: %3\n" ).arg( sPrefix ).arg( s ).arg( __filter_cutoff ) )
-			.append( QString( "%1%2filter_resonance: %3\n" ).arg( sPrefix ).arg( s ).arg( __filter_resonance ) )
-			.append( QString( "%1%2random_pitch_factor: %3\n" ).arg( sPrefix ).arg( s ).arg( __random_pitch_factor ) )
-			.append( QString( "%1%2pitch_offset: %3\n" ).arg( sPrefix ).arg( s ).arg( __pitch_offset ) )
+			.append( QString( "%1%2gain: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fGain ) )
+			.append( QString( "%1%2volume: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fVolume ) )
+			.append( QString( "%1%2pan_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fPan_L ) )
+			.append( QString( "%1%2pan_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fPan_R ) )
+			.append( QString( "%1%2peak_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fPeak_L ) )
+			.append( QString( "%1%2peak_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fPeak_R ) )
+			.append( QString( "%1" ).arg( __render.pADSR->toQString( sPrefix + s, bShort ) ) )
+			.append( QString( "%1%2filter_active: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bFilterActive ) )
+			.append( QString( "%1%2filter_cutoff: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fFilterCutoff ) )
+			.append( QString( "%1%2filter_resonance: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fFilterResonance ) )
+			.append( QString( "%1%2random_pitch_factor: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fRandomPitchFactor ) )
+			.append( QString( "%1%2pitch_offset: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.fPitchOffset ) )
 			.append( QString( "%1%2midi_out_note: %3\n" ).arg( sPrefix ).arg( s ).arg( __midi_out_note ) )
 			.append( QString( "%1%2midi_out_channel: %3\n" ).arg( sPrefix ).arg( s ).arg( __midi_out_channel ) )
 			.append( QString( "%1%2stop_notes: %3\n" ).arg( sPrefix ).arg( s ).arg( __stop_notes ) )
-			.append( QString( "%1%2sample_selection_alg: %3\n" ).arg( sPrefix ).arg( s ).arg( __sample_selection_alg ) )
+			.append( QString( "%1%2sample_selection_alg: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.sampleSelectionAlg ) )
 			.append( QString( "%1%2active: %3\n" ).arg( sPrefix ).arg( s ).arg( __active ) )
-			.append( QString( "%1%2soloed: %3\n" ).arg( sPrefix ).arg( s ).arg( __soloed ) )
-			.append( QString( "%1%2muted: %3\n" ).arg( sPrefix ).arg( s ).arg( __muted ) )
-			.append( QString( "%1%2mute_group: %3\n" ).arg( sPrefix ).arg( s ).arg( __mute_group ) )
+			.append( QString( "%1%2soloed: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bSoloed ) )
+			.append( QString( "%1%2muted: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bMuted ) )
+			.append( QString( "%1%2mute_group: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.nMuteGroup ) )
 			.append( QString( "%1%2queued: %3\n" ).arg( sPrefix ).arg( s ).arg( __queued ) ) ;
 		sOutput.append( QString( "%1%2fx_level: [ " ).arg( sPrefix ).arg( s ) );
-		for ( auto ff : __fx_level ) {
+		for ( auto ff : __render.fFxLevel ) {
 			sOutput.append( QString( "%1 " ).arg( ff ) );
 		}
 		sOutput.append( QString( "]\n" ) )
 			.append( QString( "%1%2hihat_grp: %3\n" ).arg( sPrefix ).arg( s ).arg( __hihat_grp ) )
 			.append( QString( "%1%2lower_cc: %3\n" ).arg( sPrefix ).arg( s ).arg( __lower_cc ) )
 			.append( QString( "%1%2higher_cc: %3\n" ).arg( sPrefix ).arg( s ).arg( __higher_cc ) )
+			.append( QString( "%1%2output_bus: %3\n" ).arg( sPrefix ).arg( s ).arg( __output_bus ) )
 			.append( QString( "%1%2is_preview_instrument: %3\n" ).arg( sPrefix ).arg( s ).arg( __is_preview_instrument ) )
 			.append( QString( "%1%2is_metronome_instrument: %3\n" ).arg( sPrefix ).arg( s ).arg( __is_metronome_instrument ) )
-			.append( QString( "%1%2apply_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( __apply_velocity ) )
-			.append( QString( "%1%2current_instr_for_export: %3\n" ).arg( sPrefix ).arg( s ).arg( __current_instr_for_export ) )
+			.append( QString( "%1%2apply_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bApplyVelocity ) )
+			.append( QString( "%1%2sinc_interpolation: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bSincInterpolation ) )
+			.append( QString( "%1%2current_instr_for_export: %3\n" ).arg( sPrefix ).arg( s ).arg( __render.bCurrentlyExported ) )
 			.append( QString( "%1%2m_bHasMissingSamples: %3\n" ).arg( sPrefix ).arg( s ).arg( m_bHasMissingSamples ) )
 			.append( QString( "%1%2components:\n" ).arg( sPrefix ).arg( s ) );
-		for ( auto cc : *__components ) {
+		for ( auto cc : *__render.pComponents ) {
 			if ( cc != nullptr ) {
 				sOutput.append( QString( "%1" ).arg( cc->toQString( sPrefix + s + s, bShort ) ) );
 			}
@@ -482,42 +467,44 @@ QString Instrument::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( " id: %1" ).arg( __id ) )
 			.append( QString( ", name: %1" ).arg( __name ) )
 			.append( QString( ", drumkit_name: %1" ).arg( __drumkit_name ) )
-			.append( QString( ", gain: %1" ).arg( __gain ) )
-			.append( QString( ", volume: %1" ).arg( __volume ) )
-			.append( QString( ", pan_l: %1" ).arg( __pan_l ) )
-			.append( QString( ", pan_r: %1" ).arg( __pan_r ) )
-			.append( QString( ", peak_l: %1" ).arg( __peak_l ) )
-			.append( QString( ", peak_r: %1" ).arg( __peak_r ) )
-			.append( QString( ", [%1" ).arg( __adsr->toQString( sPrefix + s, bShort ).replace( "\n", "]" ) ) )
-			.append( QString( ", filter_active: %1" ).arg( __filter_active ) )
-			.append( QString( ", filter_cutoff: %1" ).arg( __filter_cutoff ) )
-			.append( QString( ", filter_resonance: %1" ).arg( __filter_resonance ) )
-			.append( QString( ", random_pitch_factor: %1" ).arg( __random_pitch_factor ) )
-			.append( QString( ", pitch_offset: %1" ).arg( __pitch_offset ) )
+			.append( QString( ", gain: %1" ).arg( __render.fGain ) )
+			.append( QString( ", volume: %1" ).arg( __render.fVolume ) )
+			.append( QString( ", pan_l: %1" ).arg( __render.fPan_L ) )
+			.append( QString( ", pan_r: %1" ).arg( __render.fPan_R ) )
+			.append( QString( ", peak_l: %1" ).arg( __render.fPeak_L ) )
+			.append( QString( ", peak_r: %1" ).arg( __render.fPeak_R ) )
+			.append( QString( ", [%1" ).arg( __render.pADSR->toQString( sPrefix + s, bShort ).replace( "\n", "]" ) ) )
+			.append( QString( ", filter_active: %1" ).arg( __render.bFilterActive ) )
+			.append( QString( ", filter_cutoff: %1" ).arg( __render.fFilterCutoff ) )
+			.append( QString( ", filter_resonance: %1" ).arg( __render.fFilterResonance ) )
+			.append( QString( ", random_pitch_factor: %1" ).arg( __render.fRandomPitchFactor ) )
+			.append( QString( ", pitch_offset: %1" ).arg( __render.fPitchOffset ) )
 			.append( QString( ", midi_out_note: %1" ).arg( __midi_out_note ) )
 			.append( QString( ", midi_out_channel: %1" ).arg( __midi_out_channel ) )
 			.append( QString( ", stop_notes: %1" ).arg( __stop_notes ) )
-			.append( QString( ", sample_selection_alg: %1" ).arg( __sample_selection_alg ) )
+			.append( QString( ", sample_selection_alg: %1" ).arg( __render.sampleSelectionAlg ) )
 			.append( QString( ", active: %1" ).arg( __active ) )
-			.append( QString( ", soloed: %1" ).arg( __soloed ) )
-			.append( QString( ", muted: %1" ).arg( __muted ) )
-			.append( QString( ", mute_group: %1" ).arg( __mute_group ) )
+			.append( QString( ", soloed: %1" ).arg( __render.bSoloed ) )
+			.append( QString( ", muted: %1" ).arg( __render.bMuted ) )
+			.append( QString( ", mute_group: %1" ).arg( __render.nMuteGroup ) )
 			.append( QString( ", queued: %1" ).arg( __queued ) ) ;
 		sOutput.append( QString( ", fx_level: [ " ) );
-		for ( auto ff : __fx_level ) {
+		for ( auto ff : __render.fFxLevel ) {
 			sOutput.append( QString( "%1 " ).arg( ff ) );
 		}
 		sOutput.append( QString( "]" ) )
 			.append( QString( ", hihat_grp: %1" ).arg( __hihat_grp ) )
 			.append( QString( ", lower_cc: %1" ).arg( __lower_cc ) )
 			.append( QString( ", higher_cc: %1" ).arg( __higher_cc ) )
+			.append( QString( ", output_bus: %1" ).arg( __output_bus ) )
 			.append( QString( ", is_preview_instrument: %1" ).arg( __is_preview_instrument ) )
 			.append( QString( ", is_metronome_instrument: %1" ).arg( __is_metronome_instrument ) )
-			.append( QString( ", apply_velocity: %1" ).arg( __apply_velocity ) )
-			.append( QString( ", current_instr_for_export: %1" ).arg( __current_instr_for_export ) )
+			.append( QString( ", apply_velocity: %1" ).arg( __render.bApplyVelocity ) )
+			.append( QString( ", sinc_interpolation: %1" ).arg( __render.bSincInterpolation ) )
+			.append( QString( ", current_instr_for_export: %1" ).arg( __render.bCurrentlyExported ) )
 			.append( QString( ", m_bHasMissingSamples: %1" ).arg( m_bHasMissingSamples ) )
 			.append( QString( ", components: [" ) );
-		for ( auto cc : *__components ) {
+		for ( auto cc : *__render.pComponents ) {
 			if ( cc != nullptr ) {
 				sOutput.append( QString( " %1" ).arg( cc->get_drumkit_componentID() ) );
 			}
@@ -23,6 +23,7 @@
 #ifndef H2C_INSTRUMENT_H
 #define H2C_INSTRUMENT_H
 
+#include <atomic>
 #include <cassert>
 #include <core/Object.h>
 #include <core/Basics/Adsr.h>
@@ -42,6 +43,8 @@ class Drumkit;
 class DrumkitComponent;
 class InstrumentLayer;
 class InstrumentComponent;
+class Note;
+class SampleLoader;
 
 
 /**
@@ -94,8 +97,11 @@ class Instrument : public H2Core::Object
 		 * \param drumkit the drumkit the instrument belongs to
 		 * \param instrument to load samples and members from
 		 * \param is_live is it performed while playing
+		 * \param pLoader optional loader the samples of @a drumkit
+		 * were already decoded by. Samples not found in there are
+		 * loaded right away.
 		 */
-		void load_from( Drumkit* drumkit, Instrument* instrument, bool is_live = true );
+		void load_from( Drumkit* drumkit, Instrument* instrument, bool is_live = true, SampleLoader* pLoader = nullptr );
 
 		/**
 		 * Calls the InstrumentLayer::load_sample() member
@@ -157,6 +163,18 @@ class Instrument : public H2Core::Object
 		void set_midi_out_note( int note );
 		/** get the midi out note of the instrument */
 		int get_midi_out_note() const;
+		/**
+		 * Counter incremented each time the midi out note of any
+		 * instrument is changed. Used by InstrumentList to detect
+		 * whether its note lookup table became stale.
+		 */
+		static int get_midi_out_note_revision();
+		/**
+		 * Counter incremented each time the id or the name of any
+		 * instrument is changed. Used by InstrumentList to detect
+		 * whether its id and name lookup tables became stale.
+		 */
+		static int get_lookup_revision();
 
 		/** set muted status of the instrument */
 		void set_muted( bool muted );
@@ -237,6 +255,77 @@ class Instrument : public H2Core::Object
 		void dequeue();
 		/** get the queued status of the instrument */
 		bool is_queued() const;
+		/** \return Head of the list of voices of the Sampler playing
+			the instrument. See Note::get_voice_link().*/
+		Note** get_voices();
+
+		/**
+		 * Cost of rendering the instrument accounted by the
+		 * Sampler.
+		 *
+		 * All counters but #nVoices accumulate since the instrument
+		 * was created. Consumers, like the Mixer and the OscServer,
+		 * derive rates by comparing two successive values.
+		 */
+		struct RenderStats {
+			/** Number of voices currently playing.*/
+			int nVoices;
+			/** Frames of sample layers rendered.*/
+			long long nFrames;
+			/** Part of #nFrames which had to be resampled.*/
+			long long nResampledFrames;
+			/** Time spent in Sampler::renderNote().*/
+			long long nNanoseconds;
+		};
+		/** \return Current statistics. Can be called from arbitrary
+			threads.*/
+		RenderStats get_render_stats() const;
+
+		/**
+		 * Parameters the Sampler reads for every voice and process
+		 * cycle.
+		 *
+		 * They are stored in a block of their own, aligned to a
+		 * cache line, instead of being scattered between the names,
+		 * paths, and MIDI settings only used by the model and the
+		 * editors. The block is the only copy of these parameters,
+		 * so it is always up to date and the regular accessors read
+		 * and write it too.
+		 */
+		struct alignas(64) RenderState {
+			float fGain = 1.0;				///< gain of the instrument
+			float fVolume = 1.0;			///< volume of the instrument
+			float fPan_L = 1.0;				///< left pan of the instrument
+			float fPan_R = 1.0;				///< right pan of the instrument
+			float fPeak_L = 0.0;			///< left current peak value
+			float fPeak_R = 0.0;			///< right current peak value
+			float fFilterCutoff = 1.0;		///< filter cutoff (0..1)
+			float fFilterResonance = 0.0;	///< filter resonant frequency (0..1)
+			float fRandomPitchFactor = 0.0;	///< random pitch factor
+			float fPitchOffset = 0.0;		///< instrument main pitch offset
+			float fFxLevel[ MAX_FX ] = {};	///< Ladspa FX level array
+			int nMuteGroup = -1;			///< mute group of the instrument
+			SampleSelectionAlgo sampleSelectionAlg = VELOCITY;	///< how Hydrogen will chose the sample to use
+			bool bFilterActive = false;		///< is filter active?
+			bool bMuted = false;			///< is the instrument muted?
+			bool bSoloed = false;			///< is the instrument in solo mode?
+			bool bApplyVelocity = true;		///< change the sample gain based on velocity
+			bool bSincInterpolation = false;	///< see set_sinc_interpolation()
+			bool bCurrentlyExported = false;	///< is the instrument currently being exported?
+			ADSR* pADSR = nullptr;			///< attack delay sustain release instance
+			std::vector<InstrumentComponent*>* pComponents = nullptr;	///< InstrumentLayer array
+		};
+		/** \return Parameters used by the Sampler.*/
+		const RenderState& get_render_state() const;
+		/** Adds @a nDelta to the number of voices playing the
+			instrument. Audio engine only.*/
+		void add_render_voices( int nDelta );
+		/** Accounts @a nFrames frames of a sample layer rendered by
+			the Sampler. Can be called by its worker threads too.*/
+		void add_render_frames( int nFrames, bool bResampled );
+		/** Accounts @a nNanoseconds spent rendering a voice. Can be
+			called by the worker threads of the Sampler too.*/
+		void add_render_time( long long nNanoseconds );
 
 		/** set the stop notes status of the instrument */
 		void set_stop_notes( bool stopnotes );
@@ -255,6 +344,11 @@ class Instrument : public H2Core::Object
 		void set_higher_cc( int message );
 		int get_higher_cc() const;
 
+		/** Sets the JACK output bus #__output_bus.*/
+		void set_output_bus( const QString& sBus );
+		/** \return #__output_bus */
+		const QString& get_output_bus() const;
+
 		///< set the name of the related drumkit
 		void set_drumkit_name( const QString& name );
 		///< get the name of the related drumkits
@@ -274,6 +368,13 @@ class Instrument : public H2Core::Object
 		void set_apply_velocity( bool apply_velocity );
 		bool get_apply_velocity() const;
 
+		/** Whether the Sampler does render the notes of this
+			instrument using the windowed sinc interpolation instead
+			of the globally selected one. Meant for instruments which
+			are pitched a lot.*/
+		void set_sinc_interpolation( bool bSincInterpolation );
+		bool get_sinc_interpolation() const;
+
 		bool is_currently_exported() const;
 		void set_currently_exported( bool isCurrentlyExported );
 
@@ -290,6 +391,9 @@ class Instrument : public H2Core::Object
 		QString toQString( const QString& sPrefix, bool bShort = true ) const override;
 
 	private:
+		/** Hot parameters read by the Sampler. Kept first, so they
+			share the cache lines of the object header only.*/
+		RenderState				__render;
 	        /** Identifier of an instrument, which should be
 		    unique. It is set by set_id() and accessed via
 	        get_id().*/
@@ -298,36 +402,29 @@ class Instrument : public H2Core::Object
 		    and accessed via get_name().*/
 		QString					__name;
 		QString					__drumkit_name;			///< the name of the drumkit this instrument belongs to
-		float					__gain;					///< gain of the instrument
-		float					__volume;				///< volume of the instrument
-		float					__pan_l;				///< left pan of the instrument
-		float					__pan_r;				///< right pan of the instrument
-		float					__peak_l;				///< left current peak value
-		float					__peak_r;				///< right current peak value
-		ADSR*					__adsr;					///< attack delay sustain release instance
-		bool					__filter_active;		///< is filter active?
-		float					__filter_cutoff;		///< filter cutoff (0..1)
-		float					__filter_resonance;		///< filter resonant frequency (0..1)
-		float					__random_pitch_factor;	///< random pitch factor
-		float					__pitch_offset;	///< instrument main pitch offset
 		int						__midi_out_note;		///< midi out note
+		static std::atomic<int>	__midi_out_note_revision;	///< see get_midi_out_note_revision()
+		static std::atomic<int>	__lookup_revision;		///< see get_lookup_revision()
 		int						__midi_out_channel;		///< midi out channel
 		bool					__stop_notes;			///< will the note automatically generate a note off after being on
-		SampleSelectionAlgo		__sample_selection_alg;	///< how Hydrogen will chose the sample to use
 		bool					__active;				///< is the instrument active?
-		bool					__soloed;				///< is the instrument in solo mode?
-		bool					__muted;				///< is the instrument muted?
-		int						__mute_group;			///< mute group of the instrument
-		int						__queued;				///< count the number of notes queued within Sampler::__playing_notes_queue or std::priority_queue m_songNoteQueue
-		float					__fx_level[MAX_FX];		///< Ladspa FX level array
+		int						__queued;				///< count the number of notes queued within Sampler::__playing_notes_queue or NoteQueue m_songNoteQueue
+		Note*					__voices;				///< first voice of the Sampler playing the instrument
+		std::atomic<int>		__render_voices;		///< see get_render_stats()
+		std::atomic<long long>	__render_frames;		///< see get_render_stats()
+		std::atomic<long long>	__render_resampled_frames;	///< see get_render_stats()
+		std::atomic<long long>	__render_nanoseconds;	///< see get_render_stats()
 		int						__hihat_grp;			///< the instrument is part of a hihat
 		int						__lower_cc;				///< lower cc level
 		int						__higher_cc;			///< higher cc level
+		/** Name of the JACK output bus all components of the
+			instrument are routed to if per-track outputs are
+			enabled. Instruments sharing a bus are summed into a
+			single pair of ports. If empty, each component gets a
+			pair of ports of its own.*/
+		QString					__output_bus;
 		bool					__is_preview_instrument;		///< is the instrument an hydrogen preview instrument?
 		bool					__is_metronome_instrument;		///< is the instrument an metronome instrument?
-		std::vector<InstrumentComponent*>* __components;		///< InstrumentLayer array
-		bool					__apply_velocity;				///< change the sample gain based on velocity
-		bool					__current_instr_for_export;		///< is the instrument currently being exported?
 		bool 					m_bHasMissingSamples;	///< does the instrument have missing sample files?
 };
 
@@ -337,6 +434,7 @@ class Instrument : public H2Core::Object
 inline void Instrument::set_name( const QString& name )
 {
 	__name = name;
+	__lookup_revision.fetch_add( 1, std::memory_order_relaxed );
 }
 /** Access the name of the Instrument.
  * \return #__name */
@@ -349,6 +447,7 @@ inline const QString& Instrument::get_name() const
 inline void Instrument::set_id( const int id )
 {
 	__id = id;
+	__lookup_revision.fetch_add( 1, std::memory_order_relaxed );
 }
 /** Returns #__id. 
 * \return #__id. */
@@ -359,22 +458,22 @@ inline int Instrument::get_id() const
 
 inline ADSR* Instrument::get_adsr() const
 {
-	return __adsr;
+	return __render.pADSR;
 }
 
 inline ADSR* Instrument::copy_adsr() const
 {
-	return new ADSR( __adsr );
+	return new ADSR( __render.pADSR );
 }
 
 inline void Instrument::set_mute_group( int group )
 {
-	__mute_group = ( group<-1 ? -1 : group );
+	__render.nMuteGroup = ( group<-1 ? -1 : group );
 }
 
 inline int Instrument::get_mute_group() const
 {
-	return __mute_group;
+	return __render.nMuteGroup;
 }
 
 inline int Instrument::get_midi_out_channel() const
@@ -400,139 +499,150 @@ inline void Instrument::set_midi_out_note( int note )
 {
 	if ( ( note >= MIDI_OUT_NOTE_MIN ) && ( note <= MIDI_OUT_NOTE_MAX ) ) {
 		__midi_out_note = note;
+		__midi_out_note_revision.fetch_add( 1, std::memory_order_relaxed );
 	} else {
 		ERRORLOG( QString( "midi out note %1 out of bounds" ).arg( note ) );
 	}
 }
 
+inline int Instrument::get_midi_out_note_revision()
+{
+	return __midi_out_note_revision.load( std::memory_order_relaxed );
+}
+
+inline int Instrument::get_lookup_revision()
+{
+	return __lookup_revision.load( std::memory_order_relaxed );
+}
+
 inline void Instrument::set_muted( bool muted )
 {
-	__muted = muted;
+	__render.bMuted = muted;
 }
 
 inline bool Instrument::is_muted() const
 {
-	return __muted;
+	return __render.bMuted;
 }
 
 inline void Instrument::set_pan_l( float val )
 {
-	__pan_l = val;
+	__render.fPan_L = val;
 }
 
 inline float Instrument::get_pan_l() const
 {
-	return __pan_l;
+	return __render.fPan_L;
 }
 
 inline void Instrument::set_pan_r( float val )
 {
-	__pan_r = val;
+	__render.fPan_R = val;
 }
 
 inline float Instrument::get_pan_r() const
 {
-	return __pan_r;
+	return __render.fPan_R;
 }
 
 inline void Instrument::set_gain( float gain )
 {
-	__gain = gain;
+	__render.fGain = gain;
 }
 
 inline float Instrument::get_gain() const
 {
-	return __gain;
+	return __render.fGain;
 }
 
 inline void Instrument::set_volume( float volume )
 {
-	__volume = volume;
+	__render.fVolume = volume;
 }
 
 inline float Instrument::get_volume() const
 {
-	return __volume;
+	return __render.fVolume;
 }
 
 inline void Instrument::set_filter_active( bool active )
 {
-	__filter_active = active;
+	__render.bFilterActive = active;
 }
 
 inline bool Instrument::is_filter_active() const
 {
-	return __filter_active;
+	return __render.bFilterActive;
 }
 
 inline void Instrument::set_filter_resonance( float val )
 {
-	__filter_resonance = val;
+	__render.fFilterResonance = val;
 }
 
 inline float Instrument::get_filter_resonance() const
 {
-	return __filter_resonance;
+	return __render.fFilterResonance;
 }
 
 inline void Instrument::set_filter_cutoff( float val )
 {
-	__filter_cutoff = val;
+	__render.fFilterCutoff = val;
 }
 
 inline float Instrument::get_filter_cutoff() const
 {
-	return __filter_cutoff;
+	return __render.fFilterCutoff;
 }
 
 inline void Instrument::set_peak_l( float val )
 {
-	__peak_l = val;
+	__render.fPeak_L = val;
 }
 
 inline float Instrument::get_peak_l() const
 {
-	return __peak_l;
+	return __render.fPeak_L;
 }
 
 inline void Instrument::set_peak_r( float val )
 {
-	__peak_r = val;
+	__render.fPeak_R = val;
 }
 
 inline float Instrument::get_peak_r() const
 {
-	return __peak_r;
+	return __render.fPeak_R;
 }
 
 inline void Instrument::set_fx_level( float level, int index )
 {
-	__fx_level[index] = level;
+	__render.fFxLevel[index] = level;
 }
 
 inline float Instrument::get_fx_level( int index ) const
 {
-	return __fx_level[index];
+	return __render.fFxLevel[index];
 }
 
 inline void Instrument::set_random_pitch_factor( float val )
 {
-	__random_pitch_factor = val;
+	__render.fRandomPitchFactor = val;
 }
 
 inline void Instrument::set_pitch_offset( float val )
 {
-	__pitch_offset = val;
+	__render.fPitchOffset = val;
 }
 
 inline float Instrument::get_random_pitch_factor() const
 {
-	return __random_pitch_factor;
+	return __render.fRandomPitchFactor;
 }
 
 inline float Instrument::get_pitch_offset() const
 {
-	return __pitch_offset;
+	return __render.fPitchOffset;
 }
 
 inline void Instrument::set_active( bool active )
@@ -547,12 +657,12 @@ inline bool Instrument::is_active() const
 
 inline void Instrument::set_soloed( bool soloed )
 {
-	__soloed = soloed;
+	__render.bSoloed = soloed;
 }
 
 inline bool Instrument::is_soloed() const
 {
-	return __soloed;
+	return __render.bSoloed;
 }
 
 inline void Instrument::enqueue()
@@ -571,6 +681,44 @@ inline bool Instrument::is_queued() const
 	return ( __queued > 0 );
 }
 
+inline Note** Instrument::get_voices()
+{
+	return &__voices;
+}
+
+inline Instrument::RenderStats Instrument::get_render_stats() const
+{
+	RenderStats stats;
+	stats.nVoices = __render_voices.load( std::memory_order_relaxed );
+	stats.nFrames = __render_frames.load( std::memory_order_relaxed );
+	stats.nResampledFrames = __render_resampled_frames.load( std::memory_order_relaxed );
+	stats.nNanoseconds = __render_nanoseconds.load( std::memory_order_relaxed );
+	return stats;
+}
+
+inline const Instrument::RenderState& Instrument::get_render_state() const
+{
+	return __render;
+}
+
+inline void Instrument::add_render_voices( int nDelta )
+{
+	__render_voices.fetch_add( nDelta, std::memory_order_relaxed );
+}
+
+inline void Instrument::add_render_frames( int nFrames, bool bResampled )
+{
+	__render_frames.fetch_add( nFrames, std::memory_order_relaxed );
+	if ( bResampled ) {
+		__render_resampled_frames.fetch_add( nFrames, std::memory_order_relaxed );
+	}
+}
+
+inline void Instrument::add_render_time( long long nNanoseconds )
+{
+	__render_nanoseconds.fetch_add( nNanoseconds, std::memory_order_relaxed );
+}
+
 inline void Instrument::set_stop_notes( bool stopnotes )
 {
 	__stop_notes = stopnotes;
@@ -583,12 +731,12 @@ inline bool Instrument::is_stop_notes() const
 
 inline void Instrument::set_sample_selection_alg( SampleSelectionAlgo selected_algo)
 {
-	__sample_selection_alg = selected_algo;
+	__render.sampleSelectionAlg = selected_algo;
 }
 
 inline Instrument::SampleSelectionAlgo Instrument::sample_selection_alg() const
 {
-	return __sample_selection_alg;
+	return __render.sampleSelectionAlg;
 }
 
 inline void Instrument::set_hihat_grp( int hihat_grp )
@@ -621,6 +769,16 @@ inline int Instrument::get_higher_cc() const
 	return __higher_cc;
 }
 
+inline void Instrument::set_output_bus( const QString& sBus )
+{
+	__output_bus = sBus;
+}
+
+inline const QString& Instrument::get_output_bus() const
+{
+	return __output_bus;
+}
+
 inline void Instrument::set_drumkit_name( const QString& name )
 {
 	__drumkit_name = name;
@@ -653,27 +811,37 @@ inline void Instrument::set_is_metronome_instrument(bool isMetronome)
 
 inline std::vector<InstrumentComponent*>* Instrument::get_components()
 {
-	return __components;
+	return __render.pComponents;
 }
 
 inline void Instrument::set_apply_velocity( bool apply_velocity )
 {
-	__apply_velocity = apply_velocity;
+	__render.bApplyVelocity = apply_velocity;
 }
 
 inline bool Instrument::get_apply_velocity() const
 {
-	return __apply_velocity;
+	return __render.bApplyVelocity;
+}
+
+inline void Instrument::set_sinc_interpolation( bool bSincInterpolation )
+{
+	__render.bSincInterpolation = bSincInterpolation;
+}
+
+inline bool Instrument::get_sinc_interpolation() const
+{
+	return __render.bSincInterpolation;
 }
 
 inline bool Instrument::is_currently_exported() const
 {
-	return __current_instr_for_export;
+	return __render.bCurrentlyExported;
 }
 
 inline void Instrument::set_currently_exported( bool isCurrentlyExported )
 {
-	__current_instr_for_export = isCurrentlyExported;
+	__render.bCurrentlyExported = isCurrentlyExported;
 }
 
 };
@@ -22,7 +22,9 @@
 
 #include <core/Basics/InstrumentComponent.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 #include <core/AudioEngine.h>
 
@@ -48,6 +50,7 @@ InstrumentComponent::InstrumentComponent( int related_drumkit_componentID )
 	: Object( __class_name )
 	, __related_drumkit_componentID( related_drumkit_componentID )
 	, __gain( 1.0 )
+	, __layer_table_generation( 0 )
 {
 	__layers.resize( m_nMaxLayers );
 	for ( int i = 0; i < m_nMaxLayers; i++ ) {
@@ -59,6 +62,7 @@ InstrumentComponent::InstrumentComponent( InstrumentComponent* other )
 	: Object( __class_name )
 	, __related_drumkit_componentID( other->__related_drumkit_componentID )
 	, __gain( other->__gain )
+	, __layer_table_generation( 0 )
 {
 	__layers.resize( m_nMaxLayers );
 	for ( int i = 0; i < m_nMaxLayers; i++ ) {
@@ -86,6 +90,99 @@ void InstrumentComponent::set_layer( InstrumentLayer* layer, int idx )
 		delete __layers[ idx ];
 	}
 	__layers[ idx ] = layer;
+	InstrumentLayer::next_generation();
+}
+
+void InstrumentComponent::update_layer_table()
+{
+	unsigned nGeneration = InstrumentLayer::get_generation();
+	if ( nGeneration == __layer_table_generation ) {
+		return;
+	}
+	__layer_table_generation = nGeneration;
+
+	__layer_table.clear();
+	for ( int nZone = 0; nZone < LAYER_TABLE_ZONES; ++nZone ) {
+		float fZoneStart = static_cast<float>( nZone ) / LAYER_TABLE_ZONES;
+		float fZoneEnd = static_cast<float>( nZone + 1 ) / LAYER_TABLE_ZONES;
+		__layer_table_offsets[ nZone ] = __layer_table.size();
+		__layer_below[ nZone ] = -1;
+		__layer_above[ nZone ] = -1;
+
+		for ( int nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ) {
+			InstrumentLayer* pLayer = __layers[ nLayer ];
+			if ( pLayer == nullptr ) {
+				continue;
+			}
+			float fStart = pLayer->get_start_velocity();
+			float fEnd = pLayer->get_end_velocity();
+			if ( fStart <= fZoneEnd && fEnd >= fZoneStart ) {
+				__layer_table.push_back( nLayer );
+			}
+			else if ( fEnd < fZoneStart ) {
+				if ( __layer_below[ nZone ] == -1 ||
+					 fEnd > __layers[ __layer_below[ nZone ] ]->get_end_velocity() ) {
+					__layer_below[ nZone ] = nLayer;
+				}
+			}
+			else if ( fStart > fZoneEnd ) {
+				if ( __layer_above[ nZone ] == -1 ||
+					 fStart < __layers[ __layer_above[ nZone ] ]->get_start_velocity() ) {
+					__layer_above[ nZone ] = nLayer;
+				}
+			}
+		}
+	}
+	__layer_table_offsets[ LAYER_TABLE_ZONES ] = __layer_table.size();
+}
+
+int InstrumentComponent::select_layers( float fVelocity, int* pLayers ) const
+{
+	int nZone = std::min( std::max( static_cast<int>( fVelocity * LAYER_TABLE_ZONES ), 0 ),
+						  LAYER_TABLE_ZONES - 1 );
+	int nFound = 0;
+	for ( int ii = __layer_table_offsets[ nZone ]; ii < __layer_table_offsets[ nZone + 1 ]; ++ii ) {
+		int nLayer = __layer_table[ ii ];
+		InstrumentLayer* pLayer = __layers[ nLayer ];
+		if ( pLayer != nullptr && fVelocity >= pLayer->get_start_velocity() &&
+			 fVelocity <= pLayer->get_end_velocity() ) {
+			pLayers[ nFound ] = nLayer;
+			++nFound;
+		}
+	}
+	if ( nFound > 0 ) {
+		return nFound;
+	}
+
+	// The velocity fell into a hole. This can happen if the
+	// drumkit wasn't written with enough care. The nearest layer is
+	// either one intersecting the zone or the closest one before or
+	// after it.
+	float fShortestDistance = 0;
+	int nNearestLayer = -1;
+	auto checkLayer = [&]( int nLayer ) {
+		InstrumentLayer* pLayer = nLayer >= 0 ? __layers[ nLayer ] : nullptr;
+		if ( pLayer == nullptr ) {
+			return;
+		}
+		float fDistance = std::min( std::fabs( pLayer->get_start_velocity() - fVelocity ),
+									std::fabs( pLayer->get_end_velocity() - fVelocity ) );
+		if ( nNearestLayer == -1 || fDistance < fShortestDistance ) {
+			fShortestDistance = fDistance;
+			nNearestLayer = nLayer;
+		}
+	};
+	for ( int ii = __layer_table_offsets[ nZone ]; ii < __layer_table_offsets[ nZone + 1 ]; ++ii ) {
+		checkLayer( __layer_table[ ii ] );
+	}
+	checkLayer( __layer_below[ nZone ] );
+	checkLayer( __layer_above[ nZone ] );
+
+	if ( nNearestLayer == -1 ) {
+		return 0;
+	}
+	pLayers[ 0 ] = nNearestLayer;
+	return 1;
 }
 
 void InstrumentComponent::setMaxLayers( int layers )
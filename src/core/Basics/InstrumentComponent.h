@@ -27,6 +27,10 @@
 #include <vector>
 #include <core/Object.h>
 
+/** Number of zones the velocity range [0,1] is divided into by the
+	layer table of the H2Core::InstrumentComponent.*/
+#define LAYER_TABLE_ZONES 128
+
 namespace H2Core
 {
 
@@ -51,6 +55,26 @@ class InstrumentComponent : public H2Core::Object
 		InstrumentLayer*	get_layer( int idx );
 		void				set_layer( InstrumentLayer* layer, int idx );
 
+		/**
+		 * Rebuilds the table used by select_layers() if any layer
+		 * changed since the last call. Called by the Sampler before
+		 * rendering, so select_layers() can be used by several
+		 * threads at once.
+		 */
+		void				update_layer_table();
+		/**
+		 * Writes the indices of all layers whose velocity range
+		 * contains @a fVelocity into @a pLayers in ascending
+		 * order. If @a fVelocity falls into a hole between the
+		 * layers, the index of the nearest layer is written instead.
+		 *
+		 * \param fVelocity Velocity of a note.
+		 * \param pLayers Array holding at least getMaxLayers()
+		 *   entries.
+		 * \return Number of indices written.
+		 */
+		int					select_layers( float fVelocity, int* pLayers ) const;
+
 		void				set_drumkit_componentID( int related_drumkit_componentID );
 		int					get_drumkit_componentID();
 
@@ -87,6 +111,20 @@ class InstrumentComponent : public H2Core::Object
 		 * Preferences::Preferences(): 16. */
 		static int			m_nMaxLayers;
 		std::vector<InstrumentLayer*>	__layers;
+
+		/** Indices of the layers intersecting each of the
+			#LAYER_TABLE_ZONES velocity zones, stored one zone after
+			another.*/
+		std::vector<int>	__layer_table;
+		/** Position of the layers of each zone in #__layer_table
+			plus its end.*/
+		int					__layer_table_offsets[ LAYER_TABLE_ZONES + 1 ];
+		/** Nearest layer ending before each zone or -1.*/
+		int					__layer_below[ LAYER_TABLE_ZONES ];
+		/** Nearest layer starting after each zone or -1.*/
+		int					__layer_above[ LAYER_TABLE_ZONES ];
+		/** InstrumentLayer::get_generation() the table was built at.*/
+		unsigned			__layer_table_generation;
 };
 
 // DEFINITIONS
@@ -30,6 +30,8 @@ namespace H2Core
 
 const char* InstrumentLayer::__class_name = "InstrumentLayer";
 
+std::atomic<unsigned> InstrumentLayer::__generation( 1 );
+
 InstrumentLayer::InstrumentLayer( std::shared_ptr<Sample> sample ) : Object( __class_name ),
 	__start_velocity( 0.0 ),
 	__end_velocity( 1.0 ),
@@ -69,7 +71,7 @@ void InstrumentLayer::set_sample( std::shared_ptr<Sample> sample )
 void InstrumentLayer::load_sample()
 {
 	if( __sample ) {
-		__sample->load();
+		__sample->load( true );
 	}
 }
 
@@ -95,10 +97,10 @@ void InstrumentLayer::save_to( XMLNode* node )
 {
 	XMLNode layer_node = node->createNode( "layer" );
 	layer_node.write_string( "filename", get_sample()->get_filename() );
-	layer_node.write_float( "min", __start_velocity );
-	layer_node.write_float( "max", __end_velocity );
-	layer_node.write_float( "gain", __gain );
-	layer_node.write_float( "pitch", __pitch );
+	layer_node.write_float( "min", get_start_velocity() );
+	layer_node.write_float( "max", get_end_velocity() );
+	layer_node.write_float( "gain", get_gain() );
+	layer_node.write_float( "pitch", get_pitch() );
 }
 
 QString InstrumentLayer::toQString( const QString& sPrefix, bool bShort ) const {
@@ -106,17 +108,17 @@ QString InstrumentLayer::toQString( const QString& sPrefix, bool bShort ) const
 	QString sOutput;
 	if ( ! bShort ) {
 		sOutput = QString( "%1[InstrumentLayer]\n" ).arg( sPrefix )
-			.append( QString( "%1%2gain: %3\n" ).arg( sPrefix ).arg( s ).arg( __gain ) )
-			.append( QString( "%1%2pitch: %3\n" ).arg( sPrefix ).arg( s ).arg( __pitch ) )
-			.append( QString( "%1%2start_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( __start_velocity ) )
-			.append( QString( "%1%2end_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( __end_velocity ) )
+			.append( QString( "%1%2gain: %3\n" ).arg( sPrefix ).arg( s ).arg( get_gain() ) )
+			.append( QString( "%1%2pitch: %3\n" ).arg( sPrefix ).arg( s ).arg( get_pitch() ) )
+			.append( QString( "%1%2start_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( get_start_velocity() ) )
+			.append( QString( "%1%2end_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( get_end_velocity() ) )
 			.append( QString( "%1" ).arg( __sample->toQString( sPrefix + s, bShort ) ) );
 	} else {
 		sOutput = QString( "[InstrumentLayer]" )
-			.append( QString( " gain: %1" ).arg( __gain ) )
-			.append( QString( ", pitch: %1" ).arg( __pitch ) )
-			.append( QString( ", start_velocity: %1" ).arg( __start_velocity ) )
-			.append( QString( ", end_velocity: %1" ).arg( __end_velocity ) )
+			.append( QString( " gain: %1" ).arg( get_gain() ) )
+			.append( QString( ", pitch: %1" ).arg( get_pitch() ) )
+			.append( QString( ", start_velocity: %1" ).arg( get_start_velocity() ) )
+			.append( QString( ", end_velocity: %1" ).arg( get_end_velocity() ) )
 			.append( QString( ", sample: %1\n" ).arg( __sample->get_filepath() ) );
 	}
 	
@@ -23,6 +23,7 @@
 #ifndef H2C_INSTRUMENT_LAYER_H
 #define H2C_INSTRUMENT_LAYER_H
 
+#include <atomic>
 #include <memory>
 #include <core/Object.h>
 
@@ -82,9 +83,21 @@ namespace H2Core
 		/** get the sample of the layer */
 		std::shared_ptr<Sample> get_sample() const;
 
+		/**
+		 * \return Counter increased whenever the velocity range of
+		 * any layer changes or a layer is added to or removed from an
+		 * InstrumentComponent. Tells
+		 * InstrumentComponent::update_layer_table() to rebuild its
+		 * table.
+		 */
+		static unsigned get_generation();
+		/** Increases the counter returned by get_generation().*/
+		static void next_generation();
+
 		/**
 		 * Calls the #H2Core::Sample::load()
-		 * member function of #__sample.
+		 * member function of #__sample. The sample is allowed
+		 * to be streamed.
 		 */
 		void load_sample();
 		/*
@@ -115,53 +128,61 @@ namespace H2Core
 		QString toQString( const QString& sPrefix, bool bShort = true ) const override;
 
 	private:
-		float __gain;               ///< ratio between the input sample and the output signal, 1.0 by default
-		float __pitch;              ///< the frequency of the sample, 0.0 by default which means output pitch is the same as input pitch
-		float __start_velocity;     ///< the start velocity of the sample, 0.0 by default
-		float __end_velocity;       ///< the end velocity of the sample, 1.0 by default
+		/* The parameters are atomic as the InstrumentEditor does
+		   change them while the Sampler is reading them without
+		   locking the AudioEngine.*/
+		std::atomic<float> __gain;               ///< ratio between the input sample and the output signal, 1.0 by default
+		std::atomic<float> __pitch;              ///< the frequency of the sample, 0.0 by default which means output pitch is the same as input pitch
+		std::atomic<float> __start_velocity;     ///< the start velocity of the sample, 0.0 by default
+		std::atomic<float> __end_velocity;       ///< the end velocity of the sample, 1.0 by default
 		std::shared_ptr<Sample> __sample;           ///< the underlaying sample
+		/** see get_generation(). Atomic as layers are edited
+			without locking the AudioEngine.*/
+		static std::atomic<unsigned> __generation;
 	};
 
 	// DEFINITIONS
 
 	inline void InstrumentLayer::set_gain( float gain )
 	{
-		__gain = gain;
+		__gain.store( gain, std::memory_order_relaxed );
 	}
 
 	inline float InstrumentLayer::get_gain() const
 	{
-		return __gain;
+		return __gain.load( std::memory_order_relaxed );
 	}
 
 	inline void InstrumentLayer::set_pitch( float pitch )
 	{
-		__pitch = pitch;
+		__pitch.store( pitch, std::memory_order_relaxed );
 	}
 
 	inline float InstrumentLayer::get_pitch() const
 	{
-		return __pitch;
+		return __pitch.load( std::memory_order_relaxed );
 	}
 
 	inline void InstrumentLayer::set_start_velocity( float start )
 	{
-		__start_velocity = start;
+		__start_velocity.store( start, std::memory_order_relaxed );
+		next_generation();
 	}
 
 	inline float InstrumentLayer::get_start_velocity() const
 	{
-		return __start_velocity;
+		return __start_velocity.load( std::memory_order_relaxed );
 	}
 
 	inline void InstrumentLayer::set_end_velocity( float end )
 	{
-		__end_velocity = end;
+		__end_velocity.store( end, std::memory_order_relaxed );
+		next_generation();
 	}
 
 	inline float InstrumentLayer::get_end_velocity() const
 	{
-		return __end_velocity;
+		return __end_velocity.load( std::memory_order_relaxed );
 	}
 
 	inline std::shared_ptr<Sample> InstrumentLayer::get_sample() const
@@ -169,6 +190,16 @@ namespace H2Core
 		return __sample;
 	}
 
+	inline unsigned InstrumentLayer::get_generation()
+	{
+		return __generation.load( std::memory_order_relaxed );
+	}
+
+	inline void InstrumentLayer::next_generation()
+	{
+		__generation.fetch_add( 1, std::memory_order_relaxed );
+	}
+
 };
 
 #endif // H2C_INSTRUMENT_LAYER_H
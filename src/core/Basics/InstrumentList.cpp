@@ -24,6 +24,7 @@
 
 #include <core/Helpers/Xml.h>
 #include <core/Basics/Instrument.h>
+#include <core/Basics/SampleLoader.h>
 
 #include <set>
 
@@ -32,8 +33,17 @@ namespace H2Core
 
 const char* InstrumentList::__class_name = "InstrumentList";
 
+/** \return Slot of @a id within a table of @a nMask + 1 slots.
+	Multiplying by an odd constant maps consecutive ids to distinct
+	slots.*/
+static inline unsigned id_slot( int id, unsigned nMask )
+{
+	return ( static_cast<unsigned>( id ) * 2654435761u ) & nMask;
+}
+
 InstrumentList::InstrumentList() : Object( __class_name )
 {
+	update_lookup_tables();
 }
 
 InstrumentList::InstrumentList( InstrumentList* other ) : Object( __class_name )
@@ -42,6 +52,7 @@ InstrumentList::InstrumentList( InstrumentList* other ) : Object( __class_name )
 	for ( int i=0; i<other->size(); i++ ) {
 		( *this ) << ( new Instrument( ( *other )[i] ) );
 	}
+	update_lookup_tables();
 }
 
 InstrumentList::~InstrumentList()
@@ -53,9 +64,9 @@ InstrumentList::~InstrumentList()
 
 void InstrumentList::load_samples()
 {
-	for( int i=0; i<__instruments.size(); i++ ) {
-		__instruments[i]->load_samples();
-	}
+	SampleLoader loader;
+	loader.add( this );
+	loader.run();
 }
 
 void InstrumentList::unload_samples()
@@ -103,6 +114,7 @@ void InstrumentList::operator<<( Instrument* instrument )
 		if( __instruments[i]==instrument ) return;
 	}
 	__instruments.push_back( instrument );
+	update_lookup_tables();
 }
 
 void InstrumentList::add( Instrument* instrument )
@@ -112,6 +124,7 @@ void InstrumentList::add( Instrument* instrument )
 		if( __instruments[i]==instrument ) return;
 	}
 	__instruments.push_back( instrument );
+	update_lookup_tables();
 }
 
 void InstrumentList::insert( int idx, Instrument* instrument )
@@ -121,6 +134,7 @@ void InstrumentList::insert( int idx, Instrument* instrument )
 		if( __instruments[i]==instrument ) return;
 	}
 	__instruments.insert( __instruments.begin() + idx, instrument );
+	update_lookup_tables();
 }
 
 Instrument* InstrumentList::operator[]( int idx )
@@ -164,26 +178,136 @@ int InstrumentList::index( Instrument* instr )
 
 Instrument*  InstrumentList::find( const int id )
 {
-	for( int i=0; i<__instruments.size(); i++ ) {
-		if ( __instruments[i]->get_id()==id ) return __instruments[i];
+	if ( __id_map_revision != Instrument::get_lookup_revision() ) {
+		update_id_map();
+	}
+
+	unsigned nMask = __id_slots.size() - 1;
+	for ( unsigned nSlot = id_slot( id, nMask ); __id_slots[ nSlot ] >= 0;
+		  nSlot = ( nSlot + 1 ) & nMask ) {
+		Instrument* pInstr = __instruments[ __id_slots[ nSlot ] ];
+		if ( pInstr->get_id() == id ) {
+			return pInstr;
+		}
 	}
 	return nullptr;
 }
 
 Instrument*  InstrumentList::find( const QString& name )
 {
-	for( int i=0; i<__instruments.size(); i++ ) {
-		if ( __instruments[i]->get_name()==name ) return __instruments[i];
+	if ( __name_map_revision != Instrument::get_lookup_revision() ) {
+		update_name_map();
 	}
-	return nullptr;
+
+	int idx = __name_map.value( name, -1 );
+	return idx >= 0 ? __instruments[ idx ] : nullptr;
 }
 
 Instrument*  InstrumentList::findMidiNote( const int note )
 {
-	for( int i=0; i<__instruments.size(); i++ ) {
-		if ( __instruments[i]->get_midi_out_note()==note ) return __instruments[i];
+	int idx = findMidiNoteIndex( note );
+	if ( idx < 0 ) {
+		return nullptr;
+	}
+	return __instruments[idx];
+}
+
+int InstrumentList::findMidiNoteIndex( const int note, int after )
+{
+	if ( note < MIDI_OUT_NOTE_MIN || note > MIDI_OUT_NOTE_MAX ) {
+		return -1;
+	}
+
+	// The midi out note of an instrument can be changed without the
+	// list taking notice. Since the number of instruments did not
+	// change, the rebuild does not allocate.
+	if ( __midi_note_map_revision != Instrument::get_midi_out_note_revision() ) {
+		update_midi_note_map();
+	}
+
+	if ( after < 0 ) {
+		return __midi_note_map[ note ];
+	}
+	if ( !is_valid_index( after ) ||
+		 __instruments[after]->get_midi_out_note() != note ) {
+		return -1;
+	}
+	return __next_midi_note[ after ];
+}
+
+void InstrumentList::update_lookup_tables()
+{
+	update_midi_note_map();
+	update_id_map();
+	// Names are looked up by the GUI and while loading only. The
+	// table is rebuilt on demand so adding many instruments in a row
+	// does not rehash all names each time.
+	__name_map_revision = -1;
+}
+
+void InstrumentList::update_id_map()
+{
+	// Read the revision first. A concurrent change of an id will
+	// then trigger another update on the next lookup.
+	__id_map_revision = Instrument::get_lookup_revision();
+
+	// At most half of the slots are used, so the probe sequences stay
+	// short. As long as the number of instruments does not grow, the
+	// rebuild does not allocate.
+	size_t nSlots = 16;
+	while ( nSlots < 2 * __instruments.size() ) {
+		nSlots *= 2;
+	}
+	__id_slots.assign( nSlots, -1 );
+
+	unsigned nMask = nSlots - 1;
+	for ( int i = 0; i < __instruments.size(); i++ ) {
+		int id = __instruments[i]->get_id();
+		unsigned nSlot = id_slot( id, nMask );
+		while ( __id_slots[ nSlot ] >= 0 &&
+				__instruments[ __id_slots[ nSlot ] ]->get_id() != id ) {
+			nSlot = ( nSlot + 1 ) & nMask;
+		}
+		// Keep the instrument with the lowest index, like the
+		// former linear search.
+		if ( __id_slots[ nSlot ] < 0 ) {
+			__id_slots[ nSlot ] = i;
+		}
+	}
+}
+
+void InstrumentList::update_name_map()
+{
+	__name_map_revision = Instrument::get_lookup_revision();
+
+	__name_map.clear();
+	__name_map.reserve( __instruments.size() );
+	for ( int i = (int)__instruments.size() - 1; i >= 0; i-- ) {
+		__name_map.insert( __instruments[i]->get_name(), i );
+	}
+}
+
+void InstrumentList::update_midi_note_map()
+{
+	// Read the revision first. A concurrent change of a note will
+	// then trigger another update on the next lookup.
+	__midi_note_map_revision = Instrument::get_midi_out_note_revision();
+
+	for ( int note = 0; note <= MIDI_OUT_NOTE_MAX; note++ ) {
+		__midi_note_map[ note ] = -1;
+	}
+	__next_midi_note.assign( __instruments.size(), -1 );
+
+	// Walk backwards so the first instrument of each chain is the
+	// one with the lowest index, like the former linear search.
+	for ( int i = (int)__instruments.size() - 1; i >= 0; i-- ) {
+		int note = __instruments[i]->get_midi_out_note();
+		if ( note < MIDI_OUT_NOTE_MIN || note > MIDI_OUT_NOTE_MAX ) {
+			continue;
+		}
+		__next_midi_note[ i ] = __midi_note_map[ note ];
+		__midi_note_map[ note ] = i;
 	}
-	return nullptr;
 }
 
 Instrument* InstrumentList::del( int idx )
@@ -191,6 +315,7 @@ Instrument* InstrumentList::del( int idx )
 	assert( idx >= 0 && idx < __instruments.size() );
 	Instrument* instrument = __instruments[idx];
 	__instruments.erase( __instruments.begin() + idx );
+	update_lookup_tables();
 	return instrument;
 }
 
@@ -199,6 +324,7 @@ Instrument* InstrumentList::del( Instrument* instrument )
 	for( int i=0; i<__instruments.size(); i++ ) {
 		if( __instruments[i]==instrument ) {
 			__instruments.erase( __instruments.begin() + i );
+			update_lookup_tables();
 			return instrument;
 		}
 	}
@@ -214,6 +340,7 @@ void InstrumentList::swap( int idx_a, int idx_b )
 	Instrument* tmp = __instruments[idx_a];
 	__instruments[idx_a] = __instruments[idx_b];
 	__instruments[idx_b] = tmp;
+	update_lookup_tables();
 }
 
 void InstrumentList::move( int idx_a, int idx_b )
@@ -225,6 +352,7 @@ void InstrumentList::move( int idx_a, int idx_b )
 	Instrument* tmp = __instruments[idx_a];
 	__instruments.erase( __instruments.begin() + idx_a );
 	__instruments.insert( __instruments.begin() + idx_b, tmp );
+	update_lookup_tables();
 }
 
 void InstrumentList::fix_issue_307()
@@ -25,6 +25,9 @@
 
 #include <vector>
 #include <core/Object.h>
+#include <core/Globals.h>
+
+#include <QtCore/QHash>
 
 namespace H2Core
 {
@@ -103,15 +106,22 @@ class InstrumentList : public H2Core::Object
 		 */
 		int index( Instrument* instrument );
 		/**
-		 * find an instrument within the instruments
+		 * find an instrument within the instruments using a hash
+		 * table keyed by id. The table is rebuilt in place once an
+		 * id changed, so lookups do not allocate as long as the
+		 * number of instruments stays the same.
 		 * \param i the id of the instrument to find
-		 * \return 0 if not found
+		 * \return 0 if not found. If several instruments share the
+		 * id, the one with the lowest index.
 		 */
 		Instrument* find( const int i );
 		/**
-		 * find an instrument within the instruments
+		 * find an instrument within the instruments using a hash
+		 * table keyed by name, rebuilt on first use after a name
+		 * changed.
 		 * \param name the name of the instrument to find
-		 * \return 0 if not found
+		 * \return 0 if not found. If several instruments share the
+		 * name, the one with the lowest index.
 		 */
 		Instrument* find( const QString& name );
 		/**
@@ -120,6 +130,20 @@ class InstrumentList : public H2Core::Object
 		 * \return 0 if not found
 		 */
 		Instrument* findMidiNote( const int note );
+		/**
+		 * find the index of an instrument which play the given midi
+		 * note using a lookup table instead of scanning the list.
+		 *
+		 * Since several instruments can share the same note (layered
+		 * triggers), all of them can be visited by passing the
+		 * previously returned index as @a after.
+		 *
+		 * \param note the Midi note of the instrument to find
+		 * \param after index of the previous match or -1 to get
+		 * the first instrument playing @a note
+		 * \return -1 if not found
+		 */
+		int findMidiNoteIndex( const int note, int after = -1 );
 		/**
 		 * swap the instruments of two different indexes
 		 * \param idx_a the first index
@@ -133,8 +157,8 @@ class InstrumentList : public H2Core::Object
 		 */
 		void move( int idx_a, int idx_b );
 
-		/** Calls the Instrument::load_samples() member
-		 * function of all Instruments in #__instruments.
+		/** Loads the samples of all Instruments in #__instruments
+		 * concurrently using a SampleLoader.
 		 */
 		void load_samples();
 		/** Calls the Instrument::unload_samples() member
@@ -190,7 +214,42 @@ class InstrumentList : public H2Core::Object
 		QString toQString( const QString& sPrefix, bool bShort = true ) const override;
 
 	private:
+		/** Brings all lookup tables in line with #__instruments
+			after it changed.*/
+		void update_lookup_tables();
+		/** Rebuilds #__midi_note_map and #__next_midi_note from the
+			current midi out notes of all instruments.*/
+		void update_midi_note_map();
+		/** Rebuilds #__id_slots from the current ids of all
+			instruments.*/
+		void update_id_map();
+		/** Rebuilds #__name_map from the current names of all
+			instruments.*/
+		void update_name_map();
+
 		std::vector<Instrument*> __instruments;            ///< the list of instruments
+		/** Index of the first instrument playing a note, -1 if
+			there is none.*/
+		int __midi_note_map[ MIDI_OUT_NOTE_MAX + 1 ];
+		/** Index of the next instrument playing the same note as the
+			instrument at the same position in #__instruments, -1 if
+			there is none.*/
+		std::vector<int> __next_midi_note;
+		/** Instrument::get_midi_out_note_revision() at the time
+			#__midi_note_map was built.*/
+		int __midi_note_map_revision;
+		/** Open addressing hash table of the indices within
+			#__instruments keyed by instrument id. The number of slots
+			is a power of two, unused ones hold -1.*/
+		std::vector<int> __id_slots;
+		/** Instrument::get_lookup_revision() at the time #__id_slots
+			was built.*/
+		int __id_map_revision;
+		/** Index of the first instrument of each name.*/
+		QHash<QString, int> __name_map;
+		/** Instrument::get_lookup_revision() at the time #__name_map
+			was built, -1 if it has to be rebuilt.*/
+		int __name_map_revision;
 };
 
 // DEFINITIONS
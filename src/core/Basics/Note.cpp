@@ -30,6 +30,10 @@
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/InstrumentList.h>
+#include <core/Basics/NotePool.h>
+#include <core/Basics/Pattern.h>
+
+#include <new>
 
 namespace H2Core
 {
@@ -50,34 +54,37 @@ Note::Note( Instrument* instrument, int position, float velocity, float pan_l, f
 	  __pitch( pitch ),
 	  __key( C ),
 	  __octave( P8 ),
-	  __adsr( nullptr ),
+	  __adsr(),
 	  __lead_lag( 0.0 ),
 	  __cut_off( 1.0 ),
 	  __resonance( 0.0 ),
 	  __humanize_delay( 0 ),
-	  __bpfb_l( 0.0 ),
-	  __bpfb_r( 0.0 ),
-	  __lpfb_l( 0.0 ),
-	  __lpfb_r( 0.0 ),
+	  __start_offset( 0 ),
 	  __pattern_idx( 0 ),
 	  __midi_msg( -1 ),
 	  __note_off( false ),
 	  __just_recorded( false ),
-	  __probability( 1.0f )
+	  __probability( 1.0f ),
+	  __voice_age( 0 ),
+	  __voice_links{},
+	  __voice_mute_group( -1 ),
+	  __voice_index( -1 ),
+	  __trigger_time( 0 ),
+	  __trigger_source( -1 ),
+	  __pan_law_pan( 0.0 ),
+	  __pan_law_revision( -1 ),
+	  __pan_law_gain_l( 1.0 ),
+	  __pan_law_gain_r( 1.0 )
 {
+	reset_layers_selected();
+
 	if ( __instrument != nullptr ) {
-		__adsr = __instrument->copy_adsr();
+		__adsr = *__instrument->get_adsr();
 		__instrument_id = __instrument->get_id();
-
-		for (std::vector<InstrumentComponent*>::iterator it = __instrument->get_components()->begin() ; it !=__instrument->get_components()->end(); ++it) {
-			InstrumentComponent *pCompo = *it;
-
-			SelectedLayerInfo *sampleInfo = new SelectedLayerInfo;
-			sampleInfo->SelectedLayer = -1;
-			sampleInfo->SamplePosition = 0;
-
-			__layers_selected[ pCompo->get_drumkit_componentID() ] = sampleInfo;
-		}
+		// Start the filter right at the current settings instead of
+		// ramping towards them during the first block.
+		__cut_off = __instrument->get_filter_cutoff();
+		__resonance = __instrument->get_filter_resonance();
 	}
 
 	set_pan_l(pan_l);
@@ -97,42 +104,92 @@ Note::Note( Note* other, Instrument* instrument )
 	  __pitch( other->get_pitch() ),
 	  __key( other->get_key() ),
 	  __octave( other->get_octave() ),
-	  __adsr( nullptr ),
+	  __adsr(),
 	  __lead_lag( other->get_lead_lag() ),
 	  __cut_off( other->get_cut_off() ),
 	  __resonance( other->get_resonance() ),
 	  __humanize_delay( other->get_humanize_delay() ),
-	  __bpfb_l( other->get_bpfb_l() ),
-	  __bpfb_r( other->get_bpfb_r() ),
-	  __lpfb_l( other->get_lpfb_l() ),
-	  __lpfb_r( other->get_lpfb_r() ),
+	  __start_offset( other->get_start_offset() ),
 	  __pattern_idx( other->get_pattern_idx() ),
 	  __midi_msg( other->get_midi_msg() ),
 	  __note_off( other->get_note_off() ),
 	  __just_recorded( other->get_just_recorded() ),
-	  __probability( other->get_probability() )
+	  __probability( other->get_probability() ),
+	  __voice_age( 0 ),
+	  __voice_links{},
+	  __voice_mute_group( -1 ),
+	  __voice_index( -1 ),
+	  __trigger_time( other->get_trigger_time() ),
+	  __trigger_source( other->get_trigger_source() ),
+	  __frozen_pattern( other->__frozen_pattern ),
+	  __pan_law_pan( 0.0 ),
+	  __pan_law_revision( -1 ),
+	  __pan_law_gain_l( 1.0 ),
+	  __pan_law_gain_r( 1.0 )
 {
+	reset_layers_selected();
+
 	if ( instrument != nullptr ) __instrument = instrument;
 	if ( __instrument != nullptr ) {
-		__adsr = __instrument->copy_adsr();
+		__adsr = *__instrument->get_adsr();
 		__instrument_id = __instrument->get_id();
+		// Start the filter right at the current settings instead of
+		// ramping towards them during the first block.
+		__cut_off = __instrument->get_filter_cutoff();
+		__resonance = __instrument->get_filter_resonance();
+	}
+}
+
+Note::~Note()
+{
+}
 
-		for (std::vector<InstrumentComponent*>::iterator it = __instrument->get_components()->begin() ; it !=__instrument->get_components()->end(); ++it) {
-			InstrumentComponent *pCompo = *it;
+void Note::reset_layers_selected()
+{
+	for ( int ii = 0; ii < MAX_COMPONENTS; ++ii ) {
+		__layers_selected[ ii ].SelectedLayer = -1;
+		__layers_selected[ ii ].SamplePosition = 0;
+		__layers_selected[ ii ].Stream = -1;
+		__layers_selected[ ii ].Gain_L = -1;
+		__layers_selected[ ii ].Gain_R = -1;
+		__layers_selected[ ii ].TrackGain_L = -1;
+		__layers_selected[ ii ].TrackGain_R = -1;
+		__layers_selected[ ii ].Bpfb_L = 0;
+		__layers_selected[ ii ].Bpfb_R = 0;
+		__layers_selected[ ii ].Lpfb_L = 0;
+		__layers_selected[ ii ].Lpfb_R = 0;
+	}
+}
 
-			SelectedLayerInfo *sampleInfo = new SelectedLayerInfo;
-			sampleInfo->SelectedLayer = -1;
-			sampleInfo->SamplePosition = 0;
+void* Note::operator new( size_t nSize )
+{
+	return ::operator new( nSize );
+}
 
-			__layers_selected[ pCompo->get_drumkit_componentID() ] = sampleInfo;
+void* Note::operator new( size_t nSize, NotePool* pPool )
+{
+	if ( pPool != nullptr && nSize <= sizeof( Note ) ) {
+		void* p = pPool->allocate();
+		if ( p != nullptr ) {
+			return p;
 		}
 	}
+	return ::operator new( nSize );
 }
 
-Note::~Note()
+void Note::operator delete( void* p )
+{
+	NotePool* pPool = NotePool::get_instance();
+	if ( pPool != nullptr && pPool->contains( p ) ) {
+		pPool->deallocate( p );
+	} else {
+		::operator delete( p );
+	}
+}
+
+void Note::operator delete( void* p, NotePool* )
 {
-	delete __adsr;
-	__adsr = nullptr;
+	Note::operator delete( p );
 }
 
 static inline float check_boundary( float v, float min, float max )
@@ -150,6 +207,13 @@ void Note::set_velocity( float velocity )
 void Note::set_lead_lag( float lead_lag )
 {
 	__lead_lag = check_boundary( lead_lag, LEAD_LAG_MIN, LEAD_LAG_MAX );
+	Pattern::next_generation();
+}
+
+void Note::set_probability( float value )
+{
+	__probability = value;
+	Pattern::next_generation();
 }
 
 void Note::set_pan_l( float pan )
@@ -174,9 +238,68 @@ void Note::map_instrument( InstrumentList* instruments )
 	}
 }
 
+void Note::compute_lr_values( float* pBuffer_L, float* pBuffer_R, int nFrames,
+							  SelectedLayerInfo* pLayer )
+{
+	if ( nFrames <= 0 ) {
+		return;
+	}
+
+	const float fCutOff = __instrument->get_filter_cutoff();
+	const float fResonance = __instrument->get_filter_resonance();
+
+	// Keep the state in locals so the compiler can hold it in
+	// registers. The left and right recursions are independent and
+	// are interleaved for instruction level parallelism.
+	float fBpfb_L = pLayer->Bpfb_L;
+	float fBpfb_R = pLayer->Bpfb_R;
+	float fLpfb_L = pLayer->Lpfb_L;
+	float fLpfb_R = pLayer->Lpfb_R;
+
+	if ( fCutOff == __cut_off && fResonance == __resonance ) {
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			fBpfb_L = fResonance * fBpfb_L + fCutOff * ( pBuffer_L[ ii ] - fLpfb_L );
+			fBpfb_R = fResonance * fBpfb_R + fCutOff * ( pBuffer_R[ ii ] - fLpfb_R );
+			fLpfb_L += fCutOff * fBpfb_L;
+			fLpfb_R += fCutOff * fBpfb_R;
+			pBuffer_L[ ii ] = fLpfb_L;
+			pBuffer_R[ ii ] = fLpfb_R;
+		}
+	} else {
+		const float fCutOffStep = ( fCutOff - __cut_off ) / nFrames;
+		const float fResonanceStep = ( fResonance - __resonance ) / nFrames;
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			const float fC = __cut_off + fCutOffStep * ( ii + 1 );
+			const float fR = __resonance + fResonanceStep * ( ii + 1 );
+			fBpfb_L = fR * fBpfb_L + fC * ( pBuffer_L[ ii ] - fLpfb_L );
+			fBpfb_R = fR * fBpfb_R + fC * ( pBuffer_R[ ii ] - fLpfb_R );
+			fLpfb_L += fC * fBpfb_L;
+			fLpfb_R += fC * fBpfb_R;
+			pBuffer_L[ ii ] = fLpfb_L;
+			pBuffer_R[ ii ] = fLpfb_R;
+		}
+	}
+
+	pLayer->Bpfb_L = fBpfb_L;
+	pLayer->Bpfb_R = fBpfb_R;
+	pLayer->Lpfb_L = fLpfb_L;
+	pLayer->Lpfb_R = fLpfb_R;
+}
+
+void Note::end_filter_block()
+{
+	__cut_off = __instrument->get_filter_cutoff();
+	__resonance = __instrument->get_filter_resonance();
+}
+
 QString Note::key_to_string()
 {
-	return QString( "%1%2" ).arg( __key_str[__key] ).arg( __octave );
+	return key_to_string( __key, __octave );
+}
+
+QString Note::key_to_string( Key key, Octave octave )
+{
+	return QString( "%1%2" ).arg( __key_str[key] ).arg( octave );
 }
 
 void Note::set_key_octave( const QString& str )
@@ -261,16 +384,12 @@ QString Note::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2pitch: %3\n" ).arg( sPrefix ).arg( s ).arg( __pitch ) )
 			.append( QString( "%1%2key: %3\n" ).arg( sPrefix ).arg( s ).arg( __key ) )
 			.append( QString( "%1%2octave: %3\n" ).arg( sPrefix ).arg( s ).arg( __octave ) )
-			.append( QString( "%1" ).arg( __adsr->toQString( sPrefix + s, bShort ) ) )
+			.append( QString( "%1" ).arg( __adsr.toQString( sPrefix + s, bShort ) ) )
 			.append( QString( "%1%2lead_lag: %3\n" ).arg( sPrefix ).arg( s ).arg( __lead_lag ) )
 			.append( QString( "%1%2cut_off: %3\n" ).arg( sPrefix ).arg( s ).arg( __cut_off ) )
 			.append( QString( "%1%2resonance: %3\n" ).arg( sPrefix ).arg( s ).arg( __resonance ) )
 			.append( QString( "%1%2humanize_delay: %3\n" ).arg( sPrefix ).arg( s ).arg( __humanize_delay ) )
 			.append( QString( "%1%2key: %3\n" ).arg( sPrefix ).arg( s ).arg( __key ) )
-			.append( QString( "%1%2bpfb_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __bpfb_l ) )
-			.append( QString( "%1%2bpfb_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __bpfb_r ) )
-			.append( QString( "%1%2lpfb_l: %3\n" ).arg( sPrefix ).arg( s ).arg( __lpfb_l ) )
-			.append( QString( "%1%2lpfb_r: %3\n" ).arg( sPrefix ).arg( s ).arg( __lpfb_r ) )
 			.append( QString( "%1%2pattern_idx: %3\n" ).arg( sPrefix ).arg( s ).arg( __pattern_idx ) )
 			.append( QString( "%1%2midi_msg: %3\n" ).arg( sPrefix ).arg( s ).arg( __midi_msg ) )
 			.append( QString( "%1%2note_off: %3\n" ).arg( sPrefix ).arg( s ).arg( __note_off ) )
@@ -299,16 +418,12 @@ QString Note::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( ", pitch: %1" ).arg( __pitch ) )
 			.append( QString( ", key: %1" ).arg( __key ) )
 			.append( QString( ", octave: %1" ).arg( __octave ) )
-			.append( QString( ", [%1" ).arg( __adsr->toQString( sPrefix + s, bShort ).replace( "\n", "]" ) ) )
+			.append( QString( ", [%1" ).arg( __adsr.toQString( sPrefix + s, bShort ).replace( "\n", "]" ) ) )
 			.append( QString( ", lead_lag: %1" ).arg( __lead_lag ) )
 			.append( QString( ", cut_off: %1" ).arg( __cut_off ) )
 			.append( QString( ", resonance: %1" ).arg( __resonance ) )
 			.append( QString( ", humanize_delay: %1" ).arg( __humanize_delay ) )
 			.append( QString( ", key: %1" ).arg( __key ) )
-			.append( QString( ", bpfb_l: %1" ).arg( __bpfb_l ) )
-			.append( QString( ", bpfb_r: %1" ).arg( __bpfb_r ) )
-			.append( QString( ", lpfb_l: %1" ).arg( __lpfb_l ) )
-			.append( QString( ", lpfb_r: %1" ).arg( __lpfb_r ) )
 			.append( QString( ", pattern_idx: %1" ).arg( __pattern_idx ) )
 			.append( QString( ", midi_msg: %1" ).arg( __midi_msg ) )
 			.append( QString( ", note_off: %1" ).arg( __note_off ) )
@@ -23,9 +23,15 @@
 #ifndef H2C_NOTE_H
 #define H2C_NOTE_H
 
+#include <core/config.h>
 #include <core/Object.h>
+#include <core/Basics/Adsr.h>
 #include <core/Basics/Instrument.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 #define KEY_MIN                 0
 #define KEY_MAX                 11
 #define OCTAVE_MIN              -3
@@ -51,13 +57,23 @@ namespace H2Core
 {
 
 class XMLNode;
-class ADSR;
 class Instrument;
 class InstrumentList;
+class NotePool;
+struct FrozenPattern;
 
 struct SelectedLayerInfo {
 	int SelectedLayer;		///< selected layer during layer selection
 	float SamplePosition;	///< place marker for overlapping process() cycles
+	int Stream;				///< stream of the SampleStreamer feeding the sample, -1 if none
+	float Gain_L;			///< left gain used at the end of the previous process() cycle, -1 if none
+	float Gain_R;			///< right gain used at the end of the previous process() cycle
+	float TrackGain_L;		///< left gain of the track output at the end of the previous process() cycle
+	float TrackGain_R;		///< right gain of the track output at the end of the previous process() cycle
+	float Bpfb_L;			///< left band pass filter buffer of the component
+	float Bpfb_R;			///< right band pass filter buffer of the component
+	float Lpfb_L;			///< left low pass filter buffer of the component
+	float Lpfb_R;			///< right low pass filter buffer of the component
 };
 
 /**
@@ -93,6 +109,21 @@ class Note : public H2Core::Object
 		/** destructor */
 		~Note();
 
+		/** allocates the note from the heap */
+		static void* operator new( size_t nSize );
+		/**
+		 * allocates the note from @a pPool. Falls back to the heap
+		 * if @a pPool is exhausted or nullptr.
+		 * \param nSize size of the note
+		 * \param pPool pool to allocate the note from
+		 */
+		static void* operator new( size_t nSize, NotePool* pPool );
+		/** returns the memory of the note to the NotePool it was
+		 * allocated from or to the heap */
+		static void operator delete( void* p );
+		/** used if the constructor of a pool allocated note throws */
+		static void operator delete( void* p, NotePool* pPool );
+
 		/*
 		 * save the note within the given XMLNode
 		 * \param node the XMLNode to feed
@@ -116,6 +147,12 @@ class Note : public H2Core::Object
 		void map_instrument( InstrumentList* instruments );
 		/** #__instrument accessor */
 		Instrument* get_instrument();
+		/**
+		 * Points the note to @a pInstrument without altering its
+		 * ADSR or selected layers. Does not allocate memory.
+		 * \param pInstrument the new instrument
+		 */
+		void set_instrument( Instrument* pInstrument );
 		/** return true if #__instrument is set */
 		bool has_instrument() const;
 		/**
@@ -162,6 +199,9 @@ class Note : public H2Core::Object
 		float get_pan_r() const;
 		/**
 		 * #__lead_lag setter
+		 *
+		 * Increases Pattern::get_generation() since the value is
+		 * part of the table of PatternList::get_notes_at().
 		 * \param value the new value
 		 */
 		void set_lead_lag( float value );
@@ -211,9 +251,91 @@ class Note : public H2Core::Object
 		SelectedLayerInfo* get_layer_selected( int CompoID );
 
 
+		/**
+		 * #__probability setter
+		 *
+		 * Increases Pattern::get_generation() since the value is
+		 * part of the table of PatternList::get_notes_at().
+		 * \param value the new value
+		 */
 		void set_probability( float value );
+		/** #__probability accessor */
 		float get_probability() const;
 
+		/**
+		 * #__voice_age setter
+		 * \param value the new value
+		 */
+		void set_voice_age( uint64_t value );
+		/** #__voice_age accessor */
+		uint64_t get_voice_age() const;
+
+		/** Lists of voices maintained by the Sampler.*/
+		enum VoiceList {
+			/** Voices of the same Instrument.*/
+			INSTRUMENT_VOICES = 0,
+			/** Voices started in the same mute group.*/
+			MUTE_GROUP_VOICES,
+			/** Voices triggered by the same MIDI key.*/
+			MIDI_KEY_VOICES,
+			VOICE_LISTS
+		};
+		/** Neighbours of a voice within one of the lists of the
+			Sampler.*/
+		struct VoiceLink {
+			Note* pPrev;
+			Note* pNext;
+		};
+		/**
+		 * \param nList Note::VoiceList
+		 * \return Links of the note within list @a nList. Only valid
+		 * while the note is played by the Sampler.
+		 */
+		VoiceLink& get_voice_link( int nList );
+		/** #__voice_mute_group setter */
+		void set_voice_mute_group( int nGroup );
+		/** #__voice_mute_group accessor */
+		int get_voice_mute_group() const;
+		/** #__voice_index setter */
+		void set_voice_index( int nIndex );
+		/** #__voice_index accessor */
+		int get_voice_index() const;
+
+		/**
+		 * Marks the note as triggered by a MIDI message to measure
+		 * its latency using the LatencyProbe.
+		 * \param nTimestamp time the message was received as
+		 * returned by rtclock_now_ns() or 0 to clear the mark
+		 * \param nSource LatencyProbe::Source of the message
+		 */
+		void set_trigger( int64_t nTimestamp, int nSource );
+		/** #__trigger_time accessor */
+		int64_t get_trigger_time() const;
+		/** #__trigger_source accessor */
+		int get_trigger_source() const;
+
+		/**
+		 * Makes the note play a render of the InstrumentFreezer
+		 * instead of the layers of its instrument.
+		 */
+		void set_frozen_pattern( const std::shared_ptr<const FrozenPattern>& pFrozen );
+		/** #__frozen_pattern accessor */
+		const FrozenPattern* get_frozen_pattern() const;
+
+		/**
+		 * Retrieves the pan law gains cached by set_pan_law_gains().
+		 * \param fPan resultant pan of note and instrument in [-1,1]
+		 * \param nRevision revision of the pan law table of the Sampler
+		 * \param pGain_L set to the cached left gain on success
+		 * \param pGain_R set to the cached right gain on success
+		 * \return false if there are no gains cached for @a fPan and
+		 * @a nRevision.
+		 */
+		bool get_pan_law_gains( float fPan, int nRevision, float* pGain_L, float* pGain_R ) const;
+		/** Caches the pan law gains of @a fPan for revision
+			@a nRevision of the pan law table of the Sampler.*/
+		void set_pan_law_gains( float fPan, int nRevision, float fGain_L, float fGain_R );
+
 		/**
 		 * #__humanize_delay setter
 		 * \param value the new value
@@ -221,18 +343,17 @@ class Note : public H2Core::Object
 		void set_humanize_delay( int value );
 		/** #__humanize_delay accessor */
 		int get_humanize_delay() const;
+		/**
+		 * #__start_offset setter
+		 * \param nFrames Output frames of the note already passed.
+		 */
+		void set_start_offset( int nFrames );
+		/** #__start_offset accessor */
+		int get_start_offset() const;
 		/** #__cut_off accessor */
 		float get_cut_off() const;
 		/** #__resonance accessor */
 		float get_resonance() const;
-		/** #__bpfb_l accessor */
-		float get_bpfb_l() const;
-		/** #__bpfb_r accessor */
-		float get_bpfb_r() const;
-		/** #__lpfb_l accessor */
-		float get_lpfb_l() const;
-		/** #__lpfb_r accessor */
-		float get_lpfb_r() const;
 		/** #__key accessor */
 		Key get_key();
 		/** #__octave accessor */
@@ -257,6 +378,8 @@ class Note : public H2Core::Object
 
 		/** return a string representation of key-octave */
 		QString key_to_string();
+		/** return a string representation of @a key and @a octave */
+		static QString key_to_string( Key key, Octave octave );
 		/**
 		 * parse str and set #__key and #__octave
 		 * \param str the string to be parsed
@@ -277,7 +400,7 @@ class Note : public H2Core::Object
 		void set_midi_info( Key key, Octave octave, int msg );
 
 		/** get the ADSR of the note */
-		ADSR* get_adsr() const;
+		ADSR* get_adsr();
 		/** call release on adsr */
 		//float release_adsr() const              { return __adsr->release(); }
 		/** call get value on adsr */
@@ -294,11 +417,27 @@ class Note : public H2Core::Object
 		bool match( const Note *pNote ) const;
 
 		/**
-		 * compute left and right output based on filters
-		 * \param val_l the left channel value
-		 * \param val_r the right channel value
+		 * Applies the resonant low pass filter of the instrument to a
+		 * block of frames of a single component in place.
+		 *
+		 * The coefficients are ramped linearly from the ones used
+		 * during the previous block - stored in #__cut_off and
+		 * #__resonance - to the current settings of the instrument to
+		 * avoid zipper noise when they are automated. All components
+		 * of the note share the same ramp until end_filter_block()
+		 * is called.
+		 *
+		 * \param pBuffer_L the left channel values
+		 * \param pBuffer_R the right channel values
+		 * \param nFrames number of frames to process
+		 * \param pLayer the component holding the filter state
 		 */
-		void compute_lr_values( float* val_l, float* val_r );
+		void compute_lr_values( float* pBuffer_L, float* pBuffer_R, int nFrames,
+								SelectedLayerInfo* pLayer );
+		/** Stores the current filter settings of the instrument in
+			#__cut_off and #__resonance once all components of a
+			block were filtered.*/
+		void end_filter_block();
 		/** Formatted string version for debugging purposes.
 		 * \param sPrefix String prefix which will be added in front of
 		 * every new line
@@ -321,29 +460,45 @@ class Note : public H2Core::Object
 		float			__pitch;              ///< the frequency of the note
 		Key				__key;                  ///< the key, [0;11]==[C;B]
 		Octave			 __octave;            ///< the octave [-3;3]
-		ADSR*			__adsr;               ///< attack decay sustain release
+		ADSR			__adsr;               ///< attack decay sustain release, copied from the instrument
 		float			__lead_lag;           ///< lead or lag offset of the note
-		float			__cut_off;            ///< filter cutoff [0;1]
-		float			__resonance;          ///< filter resonant frequency [0;1]
+		float			__cut_off;            ///< filter cutoff [0;1] applied during the last block
+		float			__resonance;          ///< filter resonant frequency [0;1] applied during the last block
 		int				__humanize_delay;       ///< used in "humanize" function
-		std::map< int, SelectedLayerInfo* > __layers_selected;
-		float			__bpfb_l;             ///< left band pass filter buffer
-		float			__bpfb_r;             ///< right band pass filter buffer
-		float			__lpfb_l;             ///< left low pass filter buffer
-		float			__lpfb_r;             ///< right low pass filter buffer
+		/** Output frames the note did already play before it was
+			queued. Set for notes resumed after a relocation, which
+			start in the middle of their samples.*/
+		int				__start_offset;
+		/** layer selection state of each component, indexed by
+			drumkit component ID */
+		SelectedLayerInfo	__layers_selected[ MAX_COMPONENTS ];
 		int				__pattern_idx;          ///< index of the pattern holding this note for undo actions
 		int				__midi_msg;             ///< TODO
 		bool			__note_off;            ///< note type on|off
 		bool			__just_recorded;       ///< used in record+delete
 		float			__probability;        ///< note probability
+		uint64_t		__voice_age;          ///< order in which the Sampler started playing the note
+		VoiceLink		__voice_links[ VOICE_LISTS ]; ///< position within the voice lists of the Sampler
+		int				__voice_mute_group;     ///< mute group the Sampler started playing the note in
+		int				__voice_index;          ///< position within the playing notes of the Sampler, -1 if not playing
+		int64_t			__trigger_time;       ///< time the triggering MIDI message was received, 0 if not measured
+		int				__trigger_source;       ///< LatencyProbe::Source of the triggering MIDI message
+		std::shared_ptr<const FrozenPattern> __frozen_pattern; ///< render played instead of the layers, nullptr for regular notes
+		float			__pan_law_pan;        ///< resultant pan the gains in #__pan_law_gain_l and #__pan_law_gain_r were computed for
+		int				__pan_law_revision;     ///< revision of the pan law table of the cached gains, -1 if none
+		float			__pan_law_gain_l;     ///< cached left gain of the pan law
+		float			__pan_law_gain_r;     ///< cached right gain of the pan law
 		static const char* __key_str[]; ///< used to build QString from #__key an #__octave
+
+		/** marks all entries of #__layers_selected as not selected yet */
+		void reset_layers_selected();
 };
 
 // DEFINITIONS
 
-inline ADSR* Note::get_adsr() const
+inline ADSR* Note::get_adsr()
 {
-	return __adsr;
+	return &__adsr;
 }
 
 inline Instrument* Note::get_instrument()
@@ -351,6 +506,12 @@ inline Instrument* Note::get_instrument()
 	return __instrument;
 }
 
+inline void Note::set_instrument( Instrument* pInstrument )
+{
+	__instrument = pInstrument;
+	__instrument_id = pInstrument->get_id();
+}
+
 inline bool Note::has_instrument() const
 {
 	return __instrument!=nullptr;
@@ -466,54 +627,122 @@ inline float Note::get_probability() const
 	return __probability;
 }
 
-inline void Note::set_probability( float value )
+
+inline void Note::set_voice_age( uint64_t value )
 {
-	__probability = value;
+	__voice_age = value;
 }
 
-inline SelectedLayerInfo* Note::get_layer_selected( int CompoID )
+inline uint64_t Note::get_voice_age() const
 {
-	return __layers_selected[ CompoID ];
+	return __voice_age;
 }
 
-inline void Note::set_humanize_delay( int value )
+inline Note::VoiceLink& Note::get_voice_link( int nList )
 {
-	__humanize_delay = value;
+	return __voice_links[ nList ];
 }
 
-inline int Note::get_humanize_delay() const
+inline void Note::set_voice_mute_group( int nGroup )
 {
-	return __humanize_delay;
+	__voice_mute_group = nGroup;
 }
 
-inline float Note::get_cut_off() const
+inline int Note::get_voice_mute_group() const
 {
-	return __cut_off;
+	return __voice_mute_group;
 }
 
-inline float Note::get_resonance() const
+inline void Note::set_voice_index( int nIndex )
 {
-	return __resonance;
+	__voice_index = nIndex;
+}
+
+inline int Note::get_voice_index() const
+{
+	return __voice_index;
 }
 
-inline float Note::get_bpfb_l() const
+inline void Note::set_trigger( int64_t nTimestamp, int nSource )
 {
-	return __bpfb_l;
+	__trigger_time = nTimestamp;
+	__trigger_source = nSource;
 }
 
-inline float Note::get_bpfb_r() const
+inline int64_t Note::get_trigger_time() const
 {
-	return __bpfb_r;
+	return __trigger_time;
 }
 
-inline float Note::get_lpfb_l() const
+inline int Note::get_trigger_source() const
 {
-	return __lpfb_l;
+	return __trigger_source;
 }
 
-inline float Note::get_lpfb_r() const
+inline void Note::set_frozen_pattern( const std::shared_ptr<const FrozenPattern>& pFrozen )
 {
-	return __lpfb_r;
+	__frozen_pattern = pFrozen;
+}
+
+inline const FrozenPattern* Note::get_frozen_pattern() const
+{
+	return __frozen_pattern.get();
+}
+
+inline bool Note::get_pan_law_gains( float fPan, int nRevision, float* pGain_L, float* pGain_R ) const
+{
+	if ( nRevision != __pan_law_revision || fPan != __pan_law_pan ) {
+		return false;
+	}
+	*pGain_L = __pan_law_gain_l;
+	*pGain_R = __pan_law_gain_r;
+	return true;
+}
+
+inline void Note::set_pan_law_gains( float fPan, int nRevision, float fGain_L, float fGain_R )
+{
+	__pan_law_pan = fPan;
+	__pan_law_revision = nRevision;
+	__pan_law_gain_l = fGain_L;
+	__pan_law_gain_r = fGain_R;
+}
+
+inline SelectedLayerInfo* Note::get_layer_selected( int CompoID )
+{
+	if ( CompoID < 0 || CompoID >= MAX_COMPONENTS ) {
+		return nullptr;
+	}
+	return &__layers_selected[ CompoID ];
+}
+
+inline void Note::set_humanize_delay( int value )
+{
+	__humanize_delay = value;
+}
+
+inline int Note::get_humanize_delay() const
+{
+	return __humanize_delay;
+}
+
+inline void Note::set_start_offset( int nFrames )
+{
+	__start_offset = nFrames;
+}
+
+inline int Note::get_start_offset() const
+{
+	return __start_offset;
+}
+
+inline float Note::get_cut_off() const
+{
+	return __cut_off;
+}
+
+inline float Note::get_resonance() const
+{
+	return __resonance;
 }
 
 inline Note::Key Note::get_key()
@@ -572,25 +801,6 @@ inline bool Note::match( const Note *pNote ) const
 	return match( pNote->__instrument, pNote->__key, pNote->__octave );
 }
 
-inline void Note::compute_lr_values( float* val_l, float* val_r )
-{
-	/* TODO ???
-	if( !has_instrument() ) {
-		*val_l = 0.0f;
-		*val_r = 0.0f;
-		return;
-	}
-	*/
-	float cut_off = __instrument->get_filter_cutoff();
-	float resonance = __instrument->get_filter_resonance();
-	__bpfb_l  =  resonance * __bpfb_l  + cut_off * ( *val_l - __lpfb_l );
-	__lpfb_l +=  cut_off   * __bpfb_l;
-	__bpfb_r  =  resonance * __bpfb_r  + cut_off * ( *val_r - __lpfb_r );
-	__lpfb_r +=  cut_off   * __bpfb_r;
-	*val_l = __lpfb_l;
-	*val_r = __lpfb_r;
-}
-
 };
 
 #endif // H2C_NOTE_H
@@ -0,0 +1,119 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/Basics/NotePool.h>
+#include <core/Basics/Note.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* NotePool::__class_name = "NotePool";
+
+NotePool* NotePool::__instance = nullptr;
+
+/** Index marking the end of the freelist.*/
+static const uint32_t nEmpty = 0xffffffff;
+
+void NotePool::create_instance( int nCapacity )
+{
+	if ( __instance == nullptr ) {
+		__instance = new NotePool( nCapacity );
+	}
+}
+
+NotePool::NotePool( int nCapacity )
+	: Object( __class_name )
+	, m_nCapacity( std::max( nCapacity, 1 ) )
+	, m_nHead( 0 )
+{
+	const size_t nAlign = alignof( Note );
+	m_nChunkSize = ( sizeof( Note ) + nAlign - 1 ) / nAlign * nAlign;
+
+	// Memory returned by new[] is suitably aligned for all
+	// fundamental types, which covers Note. Touching it right away
+	// does prevent page faults during the first process cycles.
+	m_pChunks = new char[ m_nChunkSize * m_nCapacity ];
+	memset( m_pChunks, 0, m_nChunkSize * m_nCapacity );
+
+	m_pNext = new std::atomic<uint32_t>[ m_nCapacity ];
+	for ( int ii = 0; ii < m_nCapacity; ++ii ) {
+		m_pNext[ ii ].store( ii + 1 < m_nCapacity ? ii + 1 : nEmpty,
+							 std::memory_order_relaxed );
+	}
+
+	INFOLOG( QString( "Preallocated %1 notes" ).arg( m_nCapacity ) );
+}
+
+NotePool::~NotePool()
+{
+	delete[] m_pNext;
+	delete[] m_pChunks;
+	__instance = nullptr;
+}
+
+void* NotePool::allocate()
+{
+	uint64_t nHead = m_nHead.load( std::memory_order_acquire );
+
+	for ( ;; ) {
+		uint32_t nIndex = static_cast<uint32_t>( nHead );
+		if ( nIndex == nEmpty ) {
+			return nullptr;
+		}
+
+		// Might read a stale value if another thread popped the
+		// chunk in the meantime. The tag will let the CAS fail in
+		// that case.
+		uint32_t nNext = m_pNext[ nIndex ].load( std::memory_order_relaxed );
+		uint64_t nNewHead = ( ( ( nHead >> 32 ) + 1 ) << 32 ) | nNext;
+
+		if ( m_nHead.compare_exchange_weak( nHead, nNewHead,
+											std::memory_order_acq_rel,
+											std::memory_order_acquire ) ) {
+			return m_pChunks + m_nChunkSize * nIndex;
+		}
+	}
+}
+
+void NotePool::deallocate( void* pChunk )
+{
+	uint32_t nIndex = static_cast<uint32_t>(
+		( static_cast<char*>( pChunk ) - m_pChunks ) / m_nChunkSize );
+	uint64_t nHead = m_nHead.load( std::memory_order_relaxed );
+
+	for ( ;; ) {
+		m_pNext[ nIndex ].store( static_cast<uint32_t>( nHead ),
+								 std::memory_order_relaxed );
+		uint64_t nNewHead = ( ( ( nHead >> 32 ) + 1 ) << 32 ) | nIndex;
+
+		if ( m_nHead.compare_exchange_weak( nHead, nNewHead,
+											std::memory_order_release,
+											std::memory_order_relaxed ) ) {
+			return;
+		}
+	}
+}
+
+};
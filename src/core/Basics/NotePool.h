@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_POOL_H
+#define H2C_NOTE_POOL_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace H2Core
+{
+
+/**
+ * Fixed-capacity arena the audio engine creates its Note instances
+ * in.
+ *
+ * All copies of pattern notes, metronome clicks, stop notes, and
+ * realtime notes handed to the Sampler are constructed using
+ * `new ( NotePool::get_instance() ) Note( ... )` and are destroyed
+ * by a plain `delete`. Note::operator delete() checks whether the
+ * memory belongs to the pool and returns it to the freelist. This
+ * way neither the construction nor the destruction of these notes
+ * does touch the heap inside the process cycle.
+ *
+ * The freelist is a lock-free stack of chunk indices. Its head is
+ * tagged with a counter to avoid the ABA problem, so allocate() and
+ * deallocate() may be called from arbitrary threads concurrently.
+ *
+ * If the pool is exhausted, allocate() returns nullptr and the
+ * caller falls back to the heap.
+ */
+class NotePool : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/**
+	 * If #__instance equals 0, a new NotePool singleton holding
+	 * @a nCapacity notes will be created and stored in it.
+	 *
+	 * It is called in Hydrogen::create_instance().
+	 */
+	static void create_instance( int nCapacity );
+	/**
+	 * Returns a pointer to the current NotePool singleton stored in
+	 * #__instance. Contrary to most other singletons it is allowed
+	 * to be nullptr (e.g. in unit tests).
+	 */
+	static NotePool* get_instance() { return __instance; }
+	~NotePool();
+
+	/** \return uninitialized memory for a single Note or nullptr if
+		all chunks are in use.*/
+	void* allocate();
+	/** Returns @a pChunk, previously obtained by allocate(), to the
+		freelist.*/
+	void deallocate( void* pChunk );
+	/** \return true if @a p points into the memory of the pool.*/
+	bool contains( const void* p ) const;
+
+	int getCapacity() const;
+
+private:
+	NotePool( int nCapacity );
+
+	/** Object holding the current NotePool singleton. It is
+		initialized with NULL, set with create_instance(), and
+		accessed with get_instance().*/
+	static NotePool* __instance;
+
+	int m_nCapacity;
+	/** Size of a single chunk. sizeof(Note) rounded up to its
+		alignment.*/
+	size_t m_nChunkSize;
+	char* m_pChunks;
+	/** Index of the next free chunk for each chunk in the
+		freelist.*/
+	std::atomic<uint32_t>* m_pNext;
+	/** Tag (upper 32 bits) and index of the first free chunk (lower
+		32 bits).*/
+	alignas(64) std::atomic<uint64_t> m_nHead;
+};
+
+inline int NotePool::getCapacity() const {
+	return m_nCapacity;
+}
+
+inline bool NotePool::contains( const void* p ) const {
+	const char* pChar = static_cast<const char*>( p );
+	return pChar >= m_pChunks &&
+		pChar < m_pChunks + m_nChunkSize * m_nCapacity;
+}
+
+};
+
+#endif
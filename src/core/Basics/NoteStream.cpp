@@ -0,0 +1,77 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/NoteStream.h>
+
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+NoteStream::NoteStream( const Song& song )
+{
+	const std::vector<PatternList*>* pColumns = song.getPatternGroupVector();
+	if ( pColumns == nullptr ) {
+		return;
+	}
+
+	int nTick = 0;
+	m_columns.reserve( pColumns->size() );
+	for ( int nColumn = 0; nColumn < static_cast<int>( pColumns->size() ); ++nColumn ) {
+		Column column;
+		column.nStartTick = nTick;
+		column.nLength = 0;
+
+		const PatternList* pPatternList = ( *pColumns )[ nColumn ];
+		const int nPatterns = pPatternList != nullptr ? pPatternList->size() : 0;
+		for ( int nPattern = 0; nPattern < nPatterns; ++nPattern ) {
+			const Pattern* pPattern = pPatternList->get( nPattern );
+			if ( pPattern == nullptr ) {
+				column.patternLengths.push_back( 0 );
+				continue;
+			}
+			const int nLength = pPattern->get_length();
+			column.patternLengths.push_back( nLength );
+			column.nLength = std::max( column.nLength, nLength );
+
+			const Pattern::notes_t* pNotes = pPattern->get_notes();
+			for ( int nPosition = 0; nPosition < nLength; ++nPosition ) {
+				FOREACH_NOTE_CST_IT_BOUND( pNotes, it, nPosition ) {
+					if ( it->second != nullptr ) {
+						m_entries.push_back( { nColumn, nPattern, nPosition, it->second } );
+					}
+				}
+			}
+		}
+
+		nTick += column.nLength;
+		m_columns.push_back( std::move( column ) );
+	}
+}
+
+};
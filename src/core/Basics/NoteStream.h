@@ -0,0 +1,86 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_NOTE_STREAM_H
+#define H2C_NOTE_STREAM_H
+
+#include <vector>
+
+namespace H2Core
+{
+
+class Note;
+class Song;
+
+/**
+ * All notes of a song in the order they are stored in its columns,
+ * gathered by a single traversal of the song.
+ *
+ * Shared by the SMFWriter and LilyPond, so exporting a song into
+ * several formats at once - see SongExporter - walks it only once.
+ * The notes are referenced, not copied. The song must therefore not
+ * be modified while the stream is used.
+ */
+class NoteStream
+{
+public:
+	struct Column {
+		/** Tick the column starts at. The first one starts at 0.*/
+		int nStartTick;
+		/** Length of the longest pattern of the column in ticks. 0
+			if it is empty.*/
+		int nLength;
+		/** Lengths of the patterns of the column in their order.*/
+		std::vector<int> patternLengths;
+	};
+
+	struct Entry {
+		/** Index in getColumns().*/
+		int nColumn;
+		/** Index of the pattern within the column.*/
+		int nPattern;
+		/** Position of the note within its pattern in ticks.*/
+		int nPosition;
+		Note* pNote;
+	};
+
+	/** Gathers the notes of @a song. Notes positioned beyond the
+		end of their pattern are skipped.*/
+	explicit NoteStream( const Song& song );
+
+	const std::vector<Column>& getColumns() const {
+		return m_columns;
+	}
+	/** \return All notes sorted by column, pattern, and position.*/
+	const std::vector<Entry>& getEntries() const {
+		return m_entries;
+	}
+
+private:
+	std::vector<Column> m_columns;
+	std::vector<Entry> m_entries;
+};
+
+};
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <core/Basics/Pattern.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include <core/Basics/Note.h>
@@ -37,6 +38,10 @@ namespace H2Core
 
 const char* Pattern::__class_name = "Pattern";
 
+std::atomic<unsigned> Pattern::__generation( 1 );
+std::atomic<int> Pattern::__name_revision( 0 );
+std::atomic<unsigned> Pattern::__notes_revision( 0 );
+
 Pattern::Pattern( const QString& name, const QString& info, const QString& category, int length, int denominator )
 	: Object( __class_name )
 	, __length( length )
@@ -44,6 +49,8 @@ Pattern::Pattern( const QString& name, const QString& info, const QString& categ
 	, __name( name )
 	, __info( info )
 	, __category( category )
+	, __events_valid( false )
+	, __instrument_notes_valid( true )
 {
 }
 
@@ -54,6 +61,8 @@ Pattern::Pattern( Pattern* other )
 	, __name( other->get_name() )
 	, __info( other->get_info() )
 	, __category( other->get_category() )
+	, __events_valid( false )
+	, __instrument_notes_valid( false )
 {
 	FOREACH_NOTE_CST_IT_BEGIN_END( other->get_notes(),it ) {
 		__notes.insert( std::make_pair( it->first, new Note( it->second ) ) );
@@ -65,6 +74,7 @@ Pattern::~Pattern()
 	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
 		delete it->second;
 	}
+	notes_modified();
 }
 
 Pattern* Pattern::load_file( const QString& pattern_path, InstrumentList* instruments )
@@ -152,67 +162,135 @@ void Pattern::save_to( XMLNode* node, const Instrument* instrumentOnly ) const
 
 Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, Note::Key key, Note::Octave octave, bool strict ) const
 {
-	for( notes_cst_it_t it=__notes.lower_bound( idx_a ); it!=__notes.upper_bound( idx_a ); it++ ) {
-		Note* note = it->second;
-		assert( note );
-		if ( note->match( instrument, key, octave ) ) return note;
+	int nCount;
+	Note* const* ppNotes = get_instrument_notes( instrument, idx_a, idx_a + 1, nCount );
+	for ( int ii = 0; ii < nCount; ++ii ) {
+		if ( ppNotes[ ii ]->match( instrument, key, octave ) ) return ppNotes[ ii ];
 	}
 	if( idx_b==-1 ) return nullptr;
-	for( notes_cst_it_t it=__notes.lower_bound( idx_b ); it!=__notes.upper_bound( idx_b ); it++ ) {
-		Note* note = it->second;
-		assert( note );
-		if ( note->match( instrument, key, octave ) ) return note;
+	ppNotes = get_instrument_notes( instrument, idx_b, idx_b + 1, nCount );
+	for ( int ii = 0; ii < nCount; ++ii ) {
+		if ( ppNotes[ ii ]->match( instrument, key, octave ) ) return ppNotes[ ii ];
 	}
 	if( strict ) return nullptr;
-	// TODO maybe not start from 0 but idx_b-X
-	for ( int n=0; n<idx_b; n++ ) {
-		for( notes_cst_it_t it=__notes.lower_bound( n ); it!=__notes.upper_bound( n ); it++ ) {
-			Note* note = it->second;
-			assert( note );
-			if ( note->match( instrument, key, octave ) && ( ( idx_b<=note->get_position()+note->get_length() ) && idx_b>=note->get_position() ) ) return note;
-		}
+	ppNotes = get_instrument_notes( instrument, 0, idx_b, nCount );
+	for ( int ii = 0; ii < nCount; ++ii ) {
+		Note* note = ppNotes[ ii ];
+		if ( note->match( instrument, key, octave ) && idx_b<=note->get_position()+note->get_length() ) return note;
 	}
 	return nullptr;
 }
 
 Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, bool strict ) const
 {
-	notes_cst_it_t it;
-	for( it=__notes.lower_bound( idx_a ); it!=__notes.upper_bound( idx_a ); it++ ) {
-		Note* note = it->second;
-		assert( note );
-		if ( note->get_instrument() == instrument ) return note;
-	}
+	int nCount;
+	Note* const* ppNotes = get_instrument_notes( instrument, idx_a, idx_a + 1, nCount );
+	if ( nCount > 0 ) return ppNotes[ 0 ];
 	if( idx_b==-1 ) return nullptr;
-	for( it=__notes.lower_bound( idx_b ); it!=__notes.upper_bound( idx_b ); it++ ) {
-		Note* note = it->second;
-		assert( note );
-		if ( note->get_instrument() == instrument ) return note;
-	}
+	ppNotes = get_instrument_notes( instrument, idx_b, idx_b + 1, nCount );
+	if ( nCount > 0 ) return ppNotes[ 0 ];
 	if ( strict ) return nullptr;
-	// TODO maybe not start from 0 but idx_b-X
-	for ( int n=0; n<idx_b; n++ ) {
-		for( it=__notes.lower_bound( n ); it!=__notes.upper_bound( n ); it++ ) {
-			Note* note = it->second;
-			assert( note );
-			if ( note->get_instrument() == instrument && ( ( idx_b<=note->get_position()+note->get_length() ) && idx_b>=note->get_position() ) ) return note;
-		}
+	ppNotes = get_instrument_notes( instrument, 0, idx_b, nCount );
+	for ( int ii = 0; ii < nCount; ++ii ) {
+		Note* note = ppNotes[ ii ];
+		if ( idx_b<=note->get_position()+note->get_length() ) return note;
 	}
 
 	return nullptr;
 }
 
+Note* const* Pattern::get_instrument_notes( const Instrument* pInstrument, int nFirst,
+											int nLast, int& nCount ) const
+{
+	if ( ! __instrument_notes_valid ) {
+		compile_instrument_notes();
+	}
+	nCount = 0;
+	auto it = __instrument_notes.find( pInstrument );
+	if ( it == __instrument_notes.end() || nFirst >= nLast ) {
+		return nullptr;
+	}
+
+	const std::vector<Note*>& notes = it->second;
+	auto first = std::lower_bound( notes.begin(), notes.end(), nFirst, []( Note* pNote, int nPos ) {
+		return pNote->get_position() < nPos;
+	} );
+	auto last = std::lower_bound( first, notes.end(), nLast, []( Note* pNote, int nPos ) {
+		return pNote->get_position() < nPos;
+	} );
+	nCount = static_cast<int>( last - first );
+	return notes.data() + ( first - notes.begin() );
+}
+
+void Pattern::compile_instrument_notes() const
+{
+	__instrument_notes.clear();
+	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); ++it ) {
+		__instrument_notes[ it->second->get_instrument() ].push_back( it->second );
+	}
+	__instrument_notes_valid = true;
+}
+
+void Pattern::index_note( Note* pNote )
+{
+	if ( ! __instrument_notes_valid ) {
+		return;
+	}
+	std::vector<Note*>& notes = __instrument_notes[ pNote->get_instrument() ];
+	auto it = std::upper_bound( notes.begin(), notes.end(), pNote->get_position(),
+								[]( int nPos, Note* pOther ) {
+									return nPos < pOther->get_position();
+								} );
+	notes.insert( it, pNote );
+}
+
+void Pattern::insert_notes( std::vector<Note*>& notes )
+{
+	std::stable_sort( notes.begin(), notes.end(), []( Note* pA, Note* pB ) {
+		return pA->get_position() < pB->get_position();
+	});
+	for ( Note* pNote : notes ) {
+		__notes.emplace_hint( __notes.end(), pNote->get_position(), pNote );
+		index_note( pNote );
+	}
+	invalidate_events();
+}
+
 void Pattern::remove_note( Note* note )
 {
 	int pos = note->get_position();
 	for( notes_it_t it=__notes.lower_bound( pos ); it!=__notes.end() && it->first == pos; ++it ) {
 		if( it->second==note ) {
 			__notes.erase( it );
+			if ( __instrument_notes_valid ) {
+				std::vector<Note*>& notes = __instrument_notes[ note->get_instrument() ];
+				notes.erase( std::remove( notes.begin(), notes.end(), note ), notes.end() );
+			}
+			invalidate_events();
 			break;
 		}
 	}
 }
 
+void Pattern::compile_events()
+{
+	__events.clear();
+	__events.reserve( __notes.size() );
+
+	int nLastTick = __notes.empty() ? -1 : __notes.rbegin()->first;
+	__event_offsets.assign( std::max( nLastTick + 2, 1 ), 0 );
+
+	for( notes_cst_it_t it=__notes.lower_bound( 0 ); it!=__notes.end(); ++it ) {
+		__events.push_back( it->second );
+		++__event_offsets[ it->first + 1 ];
+	}
+	for ( size_t ii = 1; ii < __event_offsets.size(); ++ii ) {
+		__event_offsets[ ii ] += __event_offsets[ ii - 1 ];
+	}
+
+	__events_valid = true;
+}
+
 bool Pattern::references( Instrument* instr )
 {
 	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
@@ -239,10 +317,12 @@ void Pattern::purge_instrument( Instrument* instr )
 			}
 			slate.push_back( note );
 			__notes.erase( it++ );
+			invalidate_events();
 		} else {
 			++it;
 		}
 	}
+	__instrument_notes.erase( instr );
 	if ( locked ) {
 		H2Core::AudioEngine::get_instance()->unlock();
 		while ( slate.size() ) {
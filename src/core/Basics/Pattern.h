@@ -23,7 +23,10 @@
 #ifndef H2C_PATTERN_H
 #define H2C_PATTERN_H
 
+#include <atomic>
+#include <map>
 #include <set>
+#include <vector>
 #include <core/Object.h>
 #include <core/Basics/Note.h>
 
@@ -117,6 +120,16 @@ class Pattern : public H2Core::Object
 		 * \param note the note to be inserted
 		 */
 		void insert_note( Note* note );
+		/**
+		 * insert many notes at once within __notes
+		 *
+		 * Sorted by position, which is done in place, all notes
+		 * are appended using the end of __notes as hint instead of
+		 * searching the multimap for each one of them. Notes
+		 * sharing a position keep their order.
+		 * \param notes the notes to be inserted
+		 */
+		void insert_notes( std::vector<Note*>& notes );
 		/**
 		 * search for a note at a given index within __notes which correspond to the given arguments
 		 * \param idx_a the first __notes index to search in
@@ -142,6 +155,67 @@ class Pattern : public H2Core::Object
 		 * \param note the note to be removed
 		 */
 		void remove_note( Note* note );
+		/**
+		 * Has to be called after modifying the notes returned by
+		 * get_notes() directly or reassigning the instrument of a
+		 * note, before any of the removed notes is deleted.
+		 */
+		void notes_changed();
+		/**
+		 * Provides the notes of @a pInstrument starting within
+		 * [@a nFirst, @a nLast) without visiting the ones of other
+		 * instruments.
+		 *
+		 * The per-instrument index is kept up to date by
+		 * insert_note(), insert_notes(), remove_note(), and
+		 * purge_instrument() and rebuilt on first use after
+		 * notes_changed().
+		 *
+		 * \param nCount set to the number of notes found
+		 * \return the first of @a nCount notes ordered by position,
+		 * notes sharing a position in the order of get_notes().
+		 * Valid until the notes change.
+		 */
+		Note* const* get_instrument_notes( const Instrument* pInstrument, int nFirst,
+										   int nLast, int& nCount ) const;
+		/**
+		 * Provides the notes starting at a given tick for
+		 * audioEngine_updateNoteQueue().
+		 *
+		 * Walking the multimap for each tick is replaced by a lookup
+		 * in a contiguous table of all notes ordered by position. It
+		 * is rebuilt on first use after the notes did change, so the
+		 * caller has to hold the AudioEngine lock.
+		 *
+		 * \param nTick position within the pattern
+		 * \param nCount set to the number of notes starting at @a nTick
+		 * \return the first of @a nCount notes, in the order of
+		 * get_notes(). Valid until the notes change.
+		 */
+		Note* const* get_notes_at( int nTick, int& nCount );
+		/**
+		 * \return Counter increased whenever the notes or the
+		 * virtual patterns of any pattern or the content of any
+		 * PatternList change. Tells PatternList::get_notes_at()
+		 * to rebuild its table.
+		 */
+		static unsigned get_generation();
+		/** Increases the counter returned by get_generation().*/
+		static void next_generation();
+		/**
+		 * \return Counter increased whenever the name of any
+		 * pattern changes. Tells PatternList::find() to rebuild its
+		 * name lookup table.
+		 */
+		static int get_name_revision();
+		/**
+		 * \return Counter increased whenever the notes or the
+		 * virtual patterns of any pattern change or a pattern is
+		 * deleted. Unlike get_generation() it stays the same when
+		 * a PatternList is modified. Tells ColumnSnapshots whether
+		 * the notes it refers to are still valid.
+		 */
+		static unsigned get_notes_revision();
 
 		/**
 		 * check if this pattern contains a note referencing the given instrument
@@ -211,6 +285,32 @@ class Pattern : public H2Core::Object
 		notes_t __notes;                                        ///< a multimap (hash with possible multiple values for one key) of note
 		virtual_patterns_t __virtual_patterns;                  ///< a list of patterns directly referenced by this one
 		virtual_patterns_t __flattened_virtual_patterns;        ///< the complete list of virtual patterns
+		std::vector<Note*> __events;                            ///< all notes of __notes with non-negative position, see get_notes_at()
+		std::vector<int> __event_offsets;                       ///< index of the first note of each tick within __events, plus the end
+		bool __events_valid;                                    ///< whether __events reflects __notes
+		/** notes of __notes per instrument ordered by position,
+			see get_instrument_notes()*/
+		mutable std::map<const Instrument*, std::vector<Note*>> __instrument_notes;
+		mutable bool __instrument_notes_valid;                  ///< whether __instrument_notes reflects __notes
+		/** see get_generation(). Atomic as patterns not owned by
+			the Song are modified without locking the AudioEngine.*/
+		static std::atomic<unsigned> __generation;
+		static std::atomic<int> __name_revision;               ///< see get_name_revision()
+		static std::atomic<unsigned> __notes_revision;         ///< see get_notes_revision()
+		/** Increases both the generation and the notes
+			revision.*/
+		static void notes_modified();
+		/** Rebuilds __events and __event_offsets.*/
+		void compile_events();
+		/** Rebuilds __instrument_notes.*/
+		void compile_instrument_notes() const;
+		/** Adds @a pNote to __instrument_notes behind the notes of
+			its instrument sharing its position, as the multimap
+			does.*/
+		void index_note( Note* pNote );
+		/** Marks __events as outdated and increases the
+			generation.*/
+		void invalidate_events();
 		/**
 		 * load a pattern from an XMLNode
 		 * \param node the XMLDode to read from
@@ -237,6 +337,7 @@ class Pattern : public H2Core::Object
 inline void Pattern::set_name( const QString& name )
 {
 	__name = name;
+	__name_revision.fetch_add( 1, std::memory_order_relaxed );
 }
 
 inline const QString& Pattern::get_name() const
@@ -302,6 +403,59 @@ inline const Pattern::virtual_patterns_t* Pattern::get_flattened_virtual_pattern
 inline void Pattern::insert_note( Note* note )
 {
 	__notes.insert( std::make_pair( note->get_position(), note ) );
+	index_note( note );
+	invalidate_events();
+}
+
+inline void Pattern::notes_changed()
+{
+	__instrument_notes_valid = false;
+	invalidate_events();
+}
+
+inline void Pattern::invalidate_events()
+{
+	__events_valid = false;
+	notes_modified();
+}
+
+inline unsigned Pattern::get_generation()
+{
+	return __generation.load( std::memory_order_relaxed );
+}
+
+inline void Pattern::next_generation()
+{
+	__generation.fetch_add( 1, std::memory_order_relaxed );
+}
+
+inline int Pattern::get_name_revision()
+{
+	return __name_revision.load( std::memory_order_relaxed );
+}
+
+inline unsigned Pattern::get_notes_revision()
+{
+	return __notes_revision.load( std::memory_order_relaxed );
+}
+
+inline void Pattern::notes_modified()
+{
+	__notes_revision.fetch_add( 1, std::memory_order_relaxed );
+	next_generation();
+}
+
+inline Note* const* Pattern::get_notes_at( int nTick, int& nCount )
+{
+	if ( ! __events_valid ) {
+		compile_events();
+	}
+	if ( nTick < 0 || nTick + 1 >= static_cast<int>( __event_offsets.size() ) ) {
+		nCount = 0;
+		return nullptr;
+	}
+	nCount = __event_offsets[ nTick + 1 ] - __event_offsets[ nTick ];
+	return __events.data() + __event_offsets[ nTick ];
 }
 
 inline bool Pattern::virtual_patterns_empty() const
@@ -312,22 +466,26 @@ inline bool Pattern::virtual_patterns_empty() const
 inline void Pattern::virtual_patterns_clear()
 {
 	__virtual_patterns.clear();
+	notes_modified();
 }
 
 inline void Pattern::virtual_patterns_add( Pattern* pattern )
 {
 	__virtual_patterns.insert( pattern );
+	notes_modified();
 }
 
 inline void Pattern::virtual_patterns_del( Pattern* pattern )
 {
 	virtual_patterns_cst_it_t it = __virtual_patterns.find( pattern );
 	if ( it!=__virtual_patterns.end() ) __virtual_patterns.erase( it );
+	notes_modified();
 }
 
 inline void Pattern::flattened_virtual_patterns_clear()
 {
 	__flattened_virtual_patterns.clear();
+	notes_modified();
 }
 
 };
@@ -0,0 +1,385 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/PatternIndex.h>
+
+#include <core/config.h>
+#include <core/EventQueue.h>
+#include <core/Basics/Instrument.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Helpers/Xml.h>
+#include "Version.h"
+
+#include <algorithm>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QSaveFile>
+
+namespace H2Core
+{
+
+const char* PatternIndex::__class_name = "PatternIndex";
+
+PatternIndex* PatternIndex::__instance = nullptr;
+
+/** Identifies the files written by PatternIndex::write_index().*/
+static const quint32 nIndexMagic = 0x48325049;
+/** Has to be increased whenever the layout of the index changes.*/
+static const quint32 nIndexVersion = 1;
+
+QDataStream& operator<<( QDataStream& stream, const PatternIndex::Entry& entry )
+{
+	stream << entry.sPath << entry.sDirName << entry.sName << entry.sInfo
+		   << entry.sCategory << entry.sAuthor << entry.sLicense << entry.sDrumkitName
+		   << entry.nLength << entry.nNotes << entry.instruments << entry.fNoteDensity
+		   << entry.nModified << entry.nSize << entry.bLoaded;
+	return stream;
+}
+
+QDataStream& operator>>( QDataStream& stream, PatternIndex::Entry& entry )
+{
+	stream >> entry.sPath >> entry.sDirName >> entry.sName >> entry.sInfo
+		   >> entry.sCategory >> entry.sAuthor >> entry.sLicense >> entry.sDrumkitName
+		   >> entry.nLength >> entry.nNotes >> entry.instruments >> entry.fNoteDensity
+		   >> entry.nModified >> entry.nSize >> entry.bLoaded;
+	return stream;
+}
+
+void PatternIndex::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new PatternIndex;
+	}
+}
+
+PatternIndex::PatternIndex()
+	: Object( __class_name )
+	, m_bDirty( true )
+	, m_pWatcher( new QFileSystemWatcher )
+{
+	QObject::connect( m_pWatcher, &QFileSystemWatcher::directoryChanged,
+					  m_pWatcher, [this]( const QString& ) { changed(); } );
+
+	QMutexLocker locker( &m_mutex );
+	read_index();
+	update();
+}
+
+PatternIndex::~PatternIndex()
+{
+	delete m_pWatcher;
+	__instance = nullptr;
+}
+
+std::vector<PatternIndex::Entry> PatternIndex::get_entries()
+{
+	QMutexLocker locker( &m_mutex );
+	update();
+
+	return m_entries;
+}
+
+QStringList PatternIndex::get_categories()
+{
+	QMutexLocker locker( &m_mutex );
+	update();
+
+	QStringList categories;
+	for ( const auto& entry : m_entries ) {
+		if ( entry.bLoaded && ! entry.sCategory.isEmpty() &&
+			 ! categories.contains( entry.sCategory ) ) {
+			categories << entry.sCategory;
+		}
+	}
+	categories.sort( Qt::CaseInsensitive );
+	return categories;
+}
+
+std::vector<PatternIndex::Entry> PatternIndex::find( const QString& sText, const QString& sCategory )
+{
+	QStringList words = sText.split( QRegExp( "\\s+" ), QString::SkipEmptyParts );
+
+	QMutexLocker locker( &m_mutex );
+	update();
+
+	std::vector<Entry> matches;
+	for ( const auto& entry : m_entries ) {
+		if ( ! entry.bLoaded ||
+			 ( ! sCategory.isEmpty() && entry.sCategory != sCategory ) ) {
+			continue;
+		}
+
+		bool bMatch = true;
+		for ( const auto& sWord : words ) {
+			if ( ! entry.sName.contains( sWord, Qt::CaseInsensitive ) &&
+				 ! entry.sInfo.contains( sWord, Qt::CaseInsensitive ) &&
+				 ! entry.sCategory.contains( sWord, Qt::CaseInsensitive ) &&
+				 ! entry.sDrumkitName.contains( sWord, Qt::CaseInsensitive ) ) {
+				bMatch = false;
+				break;
+			}
+		}
+		if ( bMatch ) {
+			matches.push_back( entry );
+		}
+	}
+	return matches;
+}
+
+void PatternIndex::invalidate()
+{
+	m_bDirty.store( true );
+}
+
+PatternIndex::Entry PatternIndex::read_entry( const QString& sPath )
+{
+	QFileInfo info( sPath );
+
+	Entry entry;
+	entry.sPath = sPath;
+	entry.sDirName = info.absoluteDir() == QDir( Filesystem::patterns_dir() ) ?
+		"" : info.absoluteDir().dirName();
+	entry.nLength = 0;
+	entry.nNotes = 0;
+	entry.fNoteDensity = 0;
+	entry.nModified = info.lastModified().toMSecsSinceEpoch();
+	entry.nSize = info.size();
+	entry.bLoaded = false;
+
+	// Validating the file against the XML Schema definition would
+	// take longer than reading it. Broken files are indexed with the
+	// metadata found and fail once they are loaded.
+	XMLDoc doc;
+	if ( ! doc.read( sPath ) ) {
+		return entry;
+	}
+	XMLNode root = doc.firstChildElement( "drumkit_pattern" );
+	if ( root.isNull() ) {
+		ERRORLOG( QString( "drumkit_pattern node not found in %1" ).arg( sPath ) );
+		return entry;
+	}
+	XMLNode pattern_node = root.firstChildElement( "pattern" );
+	if ( pattern_node.isNull() ) {
+		ERRORLOG( QString( "pattern node not found in %1" ).arg( sPath ) );
+		return entry;
+	}
+
+	entry.bLoaded = true;
+	entry.sDrumkitName = root.read_string( "drumkit_name", "" );
+	if ( entry.sDrumkitName.isEmpty() ) {
+		entry.sDrumkitName = root.read_string( "pattern_for_drumkit", "" );
+	}
+	entry.sAuthor = root.read_string( "author", "" );
+	entry.sLicense = root.read_string( "license", "" );
+
+	// Legacy patterns use pattern_name, see Pattern::load_from().
+	entry.sName = pattern_node.read_string( "name", "" );
+	if ( entry.sName.isEmpty() ) {
+		entry.sName = pattern_node.read_string( "pattern_name", "" );
+	}
+	entry.sInfo = pattern_node.read_string( "info", "" );
+	entry.sCategory = pattern_node.read_string( "category", "" );
+	entry.nLength = pattern_node.read_int( "size", 0 );
+
+	XMLNode note_list_node = pattern_node.firstChildElement( "noteList" );
+	XMLNode note_node = note_list_node.firstChildElement( "note" );
+	while ( ! note_node.isNull() ) {
+		++entry.nNotes;
+		int nId = note_node.read_int( "instrument", EMPTY_INSTR_ID );
+		if ( nId != EMPTY_INSTR_ID && ! entry.instruments.contains( nId ) ) {
+			entry.instruments << nId;
+		}
+		note_node = note_node.nextSiblingElement( "note" );
+	}
+	std::sort( entry.instruments.begin(), entry.instruments.end() );
+
+	if ( entry.nLength > 0 ) {
+		entry.fNoteDensity = entry.nNotes * ( MAX_NOTES / 4.0f ) / entry.nLength;
+	}
+
+	return entry;
+}
+
+void PatternIndex::changed()
+{
+	m_bDirty.store( true );
+	EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LIST_CHANGED, 0 );
+}
+
+QHash<QString, qint64> PatternIndex::directory_times()
+{
+	QHash<QString, qint64> times;
+	QStringList dirs;
+	dirs << Filesystem::patterns_dir();
+	for ( const auto& sDrumkit : Filesystem::pattern_drumkits() ) {
+		dirs << Filesystem::patterns_dir( sDrumkit );
+	}
+	for ( const auto& sDir : dirs ) {
+		QFileInfo info( sDir );
+		if ( info.exists() ) {
+			times.insert( sDir, info.lastModified().toMSecsSinceEpoch() );
+		}
+	}
+	return times;
+}
+
+void PatternIndex::update()
+{
+	// Files written by Hydrogen itself might show up before the
+	// watcher had the chance to report them. Adding or removing a
+	// pattern does change the modification time of its directory.
+	QHash<QString, qint64> directoryTimes = directory_times();
+	if ( ! m_bDirty.exchange( false ) && directoryTimes == m_directoryTimes ) {
+		return;
+	}
+	m_directoryTimes = directoryTimes;
+
+	if ( scan() ) {
+		write_index();
+	}
+
+	watch();
+}
+
+bool PatternIndex::scan()
+{
+	QHash<QString, const Entry*> previous;
+	for ( const auto& entry : m_entries ) {
+		previous.insert( entry.sPath, &entry );
+	}
+
+	std::vector<Entry> newEntries;
+	bool bChanged = false;
+
+	QStringList dirs = m_directoryTimes.keys();
+	dirs.sort();
+	for ( const auto& sDir : dirs ) {
+		for ( const auto& sFile : Filesystem::pattern_list( sDir ) ) {
+			QString sPath = sDir + sFile;
+			QFileInfo info( sPath );
+
+			const Entry* pPrevious = previous.value( sPath, nullptr );
+			if ( pPrevious != nullptr &&
+				 pPrevious->nModified == info.lastModified().toMSecsSinceEpoch() &&
+				 pPrevious->nSize == info.size() ) {
+				newEntries.push_back( *pPrevious );
+				continue;
+			}
+
+			bChanged = true;
+			newEntries.push_back( read_entry( sPath ) );
+		}
+	}
+
+	if ( bChanged || newEntries.size() != m_entries.size() ) {
+		m_entries.swap( newEntries );
+		return true;
+	}
+	return false;
+}
+
+void PatternIndex::watch()
+{
+	QStringList watched = m_pWatcher->directories();
+	QStringList missing;
+	for ( const auto& sDir : m_directoryTimes.keys() ) {
+		if ( ! watched.contains( sDir ) ) {
+			missing << sDir;
+		}
+	}
+	if ( ! missing.isEmpty() ) {
+		m_pWatcher->addPaths( missing );
+	}
+}
+
+void PatternIndex::read_index()
+{
+	QFile file( Filesystem::pattern_index_file() );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	quint32 nMagic, nVersion;
+	QString sHydrogenVersion, sPatternsDir;
+	stream >> nMagic >> nVersion >> sHydrogenVersion;
+	if ( stream.status() != QDataStream::Ok || nMagic != nIndexMagic ||
+		 nVersion != nIndexVersion ||
+		 sHydrogenVersion != QString( get_version().c_str() ) ) {
+		INFOLOG( QString( "Ignoring outdated pattern index %1" ).arg( file.fileName() ) );
+		return;
+	}
+
+	std::vector<Entry> entries;
+	quint32 nEntries;
+	stream >> sPatternsDir >> nEntries;
+	for ( quint32 i = 0; i < nEntries && stream.status() == QDataStream::Ok; ++i ) {
+		Entry entry;
+		stream >> entry;
+		entries.push_back( entry );
+	}
+
+	if ( stream.status() != QDataStream::Ok ) {
+		WARNINGLOG( QString( "Pattern index %1 is corrupt" ).arg( file.fileName() ) );
+		return;
+	}
+
+	// Using another data folder does e.g. happen in the unit tests.
+	if ( sPatternsDir == Filesystem::patterns_dir() ) {
+		m_entries.swap( entries );
+	}
+}
+
+void PatternIndex::write_index()
+{
+	QSaveFile file( Filesystem::pattern_index_file() );
+	if ( ! file.open( QIODevice::WriteOnly ) ) {
+		WARNINGLOG( QString( "Unable to write pattern index %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	stream << nIndexMagic << nIndexVersion << QString( get_version().c_str() )
+		   << Filesystem::patterns_dir();
+	stream << static_cast<quint32>( m_entries.size() );
+	for ( const auto& entry : m_entries ) {
+		stream << entry;
+	}
+
+	if ( ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to write pattern index %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+	}
+}
+
+};
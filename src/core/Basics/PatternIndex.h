@@ -0,0 +1,174 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_PATTERN_INDEX_H
+#define H2C_PATTERN_INDEX_H
+
+#include <core/Object.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+#include <atomic>
+#include <vector>
+
+class QDataStream;
+class QFileSystemWatcher;
+
+namespace H2Core
+{
+
+/**
+ * Persistent index of all patterns in the user pattern library.
+ *
+ * Listing the patterns used to require parsing every single
+ * .h2pattern file in Filesystem::patterns_dir() and its drumkit
+ * subdirectories. The index keeps their metadata in memory and in
+ * Filesystem::pattern_index_file(), so the SoundLibraryPanel can
+ * browse and search the library without touching the disk.
+ *
+ * A QFileSystemWatcher observes the pattern directories. Once one of
+ * them changes, the next query does only reread the files differing
+ * in size or modification time from the indexed ones and
+ * #EVENT_DRUMKIT_LIST_CHANGED is pushed. Overwriting a file in place
+ * does not change its directory, so code saving or deleting a pattern
+ * should still call invalidate().
+ */
+class PatternIndex : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Metadata of a pattern file.*/
+		struct Entry {
+			/** Absolute path of the .h2pattern file.*/
+			QString sPath;
+			/** Name of the subdirectory of Filesystem::patterns_dir()
+				holding the file. Empty for the top level.*/
+			QString sDirName;
+			QString sName;
+			QString sInfo;
+			QString sCategory;
+			QString sAuthor;
+			QString sLicense;
+			/** Drumkit the pattern was created with.*/
+			QString sDrumkitName;
+			/** Length in ticks.*/
+			int nLength;
+			int nNotes;
+			/** Sorted IDs of all instruments the notes refer to.*/
+			QList<int> instruments;
+			/** Average number of notes per quarter.*/
+			float fNoteDensity;
+			/** Modification time of the file in ms since epoch.*/
+			qint64 nModified;
+			/** Size of the file in bytes.*/
+			qint64 nSize;
+			/** Whether the file could be read. If not, all metadata
+				is empty.*/
+			bool bLoaded;
+		};
+
+		/**
+		 * If #__instance equals nullptr, a new PatternIndex
+		 * singleton will be created and stored in #__instance.
+		 *
+		 * Has to be called in the main thread.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static PatternIndex* get_instance();
+
+		~PatternIndex();
+
+		/** \return Metadata of all patterns, including the ones
+			failing to load.*/
+		std::vector<Entry> get_entries();
+		/** \return Sorted categories of all loaded patterns. Empty
+			categories are omitted.*/
+		QStringList get_categories();
+		/**
+		 * Searches the loaded patterns.
+		 *
+		 * \param sText Whitespace separated words, each of which has
+		 * to be contained - ignoring the case - in the name, info,
+		 * category, or drumkit name of a match. Matches all patterns
+		 * if empty.
+		 * \param sCategory Only patterns of this category match. All
+		 * categories match if empty.
+		 */
+		std::vector<Entry> find( const QString& sText, const QString& sCategory = "" );
+
+		/** Forces the next query to check all patterns for changes.*/
+		void invalidate();
+
+		/**
+		 * Reads the metadata of a single pattern without touching
+		 * the index.
+		 *
+		 * \param sPath Path to a .h2pattern file.
+		 */
+		static Entry read_entry( const QString& sPath );
+
+	private:
+		PatternIndex();
+
+		/** Brings the index up to date if it was invalidated or one
+			of the pattern directories changed. Has to be called with
+			#m_mutex locked.*/
+		void update();
+		/** \return Modification times of Filesystem::patterns_dir()
+			and all its subdirectories.*/
+		static QHash<QString, qint64> directory_times();
+		/** Rescans all pattern directories rereading changed files
+			only.
+			\return true if #m_entries did change.*/
+		bool scan();
+		/** Adds all pattern directories to the watcher not observed
+			yet.*/
+		void watch();
+		/** Called by #m_pWatcher.*/
+		void changed();
+
+		void read_index();
+		void write_index();
+
+		static PatternIndex* __instance;
+
+		QMutex m_mutex;
+		std::vector<Entry> m_entries;
+		/** directory_times() at the time of the last update().*/
+		QHash<QString, qint64> m_directoryTimes;
+		std::atomic<bool> m_bDirty;
+		QFileSystemWatcher* m_pWatcher;
+};
+
+inline PatternIndex* PatternIndex::get_instance() {
+	return __instance;
+}
+
+};
+
+#endif
@@ -34,10 +34,14 @@ namespace H2Core
 const char* PatternList::__class_name = "PatternList";
 
 PatternList::PatternList() : Object( __class_name )
+	, __events_generation( 0 )
+	, __name_map_revision( -1 )
 {
 }
 
 PatternList::PatternList( PatternList* other ) : Object( __class_name )
+	, __events_generation( 0 )
+	, __name_map_revision( -1 )
 {
 	assert( __patterns.size() == 0 );
 	for ( int i=0; i<other->size(); i++ ) {
@@ -61,6 +65,8 @@ void PatternList::add( Pattern* pattern )
 		return;
 	}
 	__patterns.push_back( pattern );
+	__name_map_revision = -1;
+	Pattern::next_generation();
 }
 
 void PatternList::insert( int idx, Pattern* pattern )
@@ -71,6 +77,15 @@ void PatternList::insert( int idx, Pattern* pattern )
 		return;
 	}
 	__patterns.insert( __patterns.begin() + idx, pattern );
+	__name_map_revision = -1;
+	Pattern::next_generation();
+}
+
+void PatternList::clear()
+{
+	__patterns.clear();
+	__name_map_revision = -1;
+	Pattern::next_generation();
 }
 
 Pattern* PatternList::get( int idx )
@@ -109,6 +124,8 @@ Pattern* PatternList::del( int idx )
 	assert( idx >= 0 && idx < __patterns.size() );
 	Pattern* pattern = __patterns[idx];
 	__patterns.erase( __patterns.begin() + idx );
+	__name_map_revision = -1;
+	Pattern::next_generation();
 	return pattern;
 }
 
@@ -139,6 +156,8 @@ Pattern* PatternList::replace( int idx, Pattern* pattern )
 
 	__patterns.insert( __patterns.begin() + idx, pattern );
 	__patterns.erase( __patterns.begin() + idx + 1 );
+	__name_map_revision = -1;
+	Pattern::next_generation();
 
 	//create return pattern after patternlist tätatä to return the right one
 	Pattern* ret = __patterns[idx];
@@ -154,10 +173,25 @@ void PatternList::set_to_old()
 
 Pattern*  PatternList::find( const QString& name )
 {
-	for( int i=0; i<__patterns.size(); i++ ) {
-		if ( __patterns[i]->get_name()==name ) return __patterns[i];
+	update_name_map();
+	int idx = __name_map.value( name, -1 );
+	return idx >= 0 ? __patterns[ idx ] : nullptr;
+}
+
+void PatternList::update_name_map()
+{
+	if ( __name_map_revision == Pattern::get_name_revision() ) {
+		return;
+	}
+	__name_map_revision = Pattern::get_name_revision();
+
+	// QMultiHash::value() returns the most recently inserted value,
+	// so walking backwards makes it the lowest index.
+	__name_map.clear();
+	__name_map.reserve( __patterns.size() );
+	for ( int i = (int)__patterns.size() - 1; i >= 0; i-- ) {
+		__name_map.insert( __patterns[i]->get_name(), i );
 	}
-	return nullptr;
 }
 
 void PatternList::swap( int idx_a, int idx_b )
@@ -170,6 +204,8 @@ void PatternList::swap( int idx_a, int idx_b )
 	Pattern* tmp = __patterns[idx_a];
 	__patterns[idx_a] = __patterns[idx_b];
 	__patterns[idx_b] = tmp;
+	__name_map_revision = -1;
+	Pattern::next_generation();
 }
 
 void PatternList::move( int idx_a, int idx_b )
@@ -182,6 +218,70 @@ void PatternList::move( int idx_a, int idx_b )
 	Pattern* tmp = __patterns[idx_a];
 	__patterns.erase( __patterns.begin() + idx_a );
 	__patterns.insert( __patterns.begin() + idx_b, tmp );
+	__name_map_revision = -1;
+	Pattern::next_generation();
+}
+
+Note* const* PatternList::get_notes_at( int nTick, int& nCount )
+{
+	if ( __events_generation != Pattern::get_generation() ) {
+		compile_events();
+	}
+	if ( nTick < 0 || nTick + 1 >= static_cast<int>( __event_offsets.size() ) ) {
+		nCount = 0;
+		return nullptr;
+	}
+	nCount = __event_offsets[ nTick + 1 ] - __event_offsets[ nTick ];
+	return __events.data() + __event_offsets[ nTick ];
+}
+
+Note* const* PatternList::get_notes_at( int nTick, int& nCount,
+										const float*& pLeadLag, const float*& pProbability )
+{
+	Note* const* ppNotes = get_notes_at( nTick, nCount );
+	if ( ppNotes == nullptr ) {
+		pLeadLag = nullptr;
+		pProbability = nullptr;
+		return nullptr;
+	}
+	pLeadLag = __event_lead_lag.data() + __event_offsets[ nTick ];
+	pProbability = __event_probability.data() + __event_offsets[ nTick ];
+	return ppNotes;
+}
+
+void PatternList::compile_events()
+{
+	// The tables of the patterns are merged tick by tick.
+	int nTicks = 0;
+	size_t nEvents = 0;
+	for ( Pattern* pPattern : __patterns ) {
+		const Pattern::notes_t* pNotes = pPattern->get_notes();
+		if ( ! pNotes->empty() ) {
+			nTicks = std::max( nTicks, pNotes->rbegin()->first + 1 );
+		}
+		nEvents += pNotes->size();
+	}
+
+	__events.clear();
+	__events.reserve( nEvents );
+	__event_offsets.assign( nTicks + 1, 0 );
+	for ( int nTick = 0; nTick < nTicks; ++nTick ) {
+		for ( Pattern* pPattern : __patterns ) {
+			int nNotes = 0;
+			Note* const* ppNotes = pPattern->get_notes_at( nTick, nNotes );
+			__events.insert( __events.end(), ppNotes, ppNotes + nNotes );
+		}
+		__event_offsets[ nTick + 1 ] = __events.size();
+	}
+
+	__event_lead_lag.resize( __events.size() );
+	__event_probability.resize( __events.size() );
+	for ( size_t nEvent = 0; nEvent < __events.size(); ++nEvent ) {
+		__event_lead_lag[ nEvent ] = __events[ nEvent ]->get_lead_lag();
+		__event_probability[ nEvent ] = __events[ nEvent ]->get_probability();
+	}
+
+	__events_generation = Pattern::get_generation();
 }
 
 void PatternList::flattened_virtual_patterns_compute()
@@ -201,8 +301,10 @@ bool PatternList::check_name( QString patternName, Pattern* ignore )
 		return false;
 	}
 
-	for (uint i = 0; i < __patterns.size(); i++) {
-		if ( __patterns[i] != ignore && __patterns[i]->get_name() == patternName ) {
+	update_name_map();
+	for ( auto it = __name_map.constFind( patternName );
+		  it != __name_map.constEnd() && it.key() == patternName; ++it ) {
+		if ( __patterns[ it.value() ] != ignore ) {
 			return false;
 		}
 	}
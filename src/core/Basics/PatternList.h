@@ -27,9 +27,12 @@
 #include <core/Object.h>
 #include <core/AudioEngine.h>
 
+#include <QtCore/QMultiHash>
+
 namespace H2Core
 {
 
+class Note;
 class Pattern;
 class AudioEngineLocking;
 
@@ -114,9 +117,12 @@ class AudioEngineLocking;
 		 */
 		void set_to_old();
 		/**
-		 * find a pattern within the patterns
+		 * find a pattern within the patterns using a hash table
+		 * keyed by name, rebuilt on first use after the list or the
+		 * name of any pattern changed.
 		 * \param name the name of the pattern to find
-		 * \return 0 if not found
+		 * \return 0 if not found. If several patterns share the
+		 * name, the one with the lowest index.
 		 */
 		Pattern* find( const QString& name );
 		/**
@@ -135,6 +141,38 @@ class AudioEngineLocking;
 		 * call compute_flattened_virtual_patterns on each pattern
 		 */
 		void flattened_virtual_patterns_compute();
+		/**
+		 * Provides the notes of all patterns of the list starting at
+		 * a given tick for audioEngine_updateNoteQueue().
+		 *
+		 * Like Pattern::get_notes_at() but the tables of all
+		 * patterns are merged into a single one. Patterns expanded
+		 * by their virtual patterns therefore cost the same to
+		 * schedule as a single pattern. The table is rebuilt on
+		 * first use after any Pattern or PatternList did change, so
+		 * the caller has to hold the AudioEngine lock.
+		 *
+		 * \param nTick position within the patterns
+		 * \param nCount set to the number of notes starting at @a nTick
+		 * \return the first of @a nCount notes, ordered by their
+		 * pattern within the list. Valid until any pattern changes.
+		 */
+		Note* const* get_notes_at( int nTick, int& nCount );
+		/**
+		 * Like get_notes_at() but the lead-lag and the probability
+		 * of the notes are provided as well. They are stored in
+		 * separate arrays next to the table, so the scheduler reads
+		 * them linearly and does not touch the notes it drops.
+		 *
+		 * \param nTick position within the patterns
+		 * \param nCount set to the number of notes starting at @a nTick
+		 * \param pLeadLag set to the Note::get_lead_lag() of the @a nCount notes
+		 * \param pProbability set to the Note::get_probability() of the @a nCount notes
+		 * \return the first of @a nCount notes, ordered by their
+		 * pattern within the list. Valid until any pattern changes.
+		 */
+		Note* const* get_notes_at( int nTick, int& nCount,
+								   const float*& pLeadLag, const float*& pProbability );
 		/**
 		 * call del_virtual_pattern on each pattern
 		 * \param pattern the pattern to remove where it's found
@@ -170,6 +208,20 @@ class AudioEngineLocking;
 
 	private:
 		std::vector<Pattern*> __patterns;            ///< the list of patterns
+		std::vector<Note*> __events;                 ///< notes of all patterns by tick, see get_notes_at()
+		std::vector<int> __event_offsets;            ///< index of the first note of each tick within __events, plus the end
+		std::vector<float> __event_lead_lag;         ///< lead-lag of each note of __events
+		std::vector<float> __event_probability;      ///< probability of each note of __events
+		unsigned __events_generation;                ///< Pattern::get_generation() __events was built at
+		/** Rebuilds __events, __event_offsets and the columns.*/
+		void compile_events();
+		/** indices of __patterns by name, see find()*/
+		QMultiHash<QString, int> __name_map;
+		/** Pattern::get_name_revision() __name_map was built at, -1
+			if __patterns changed since*/
+		int __name_map_revision;
+		/** Rebuilds __name_map if it is stale.*/
+		void update_name_map();
 
 };
 
@@ -180,11 +232,6 @@ inline int PatternList::size() const
 	return __patterns.size();
 }
 
-inline void PatternList::clear()
-{
-	__patterns.clear();
-}
-
 inline void PatternList::operator<<( Pattern* pattern )
 {
 	add( pattern );
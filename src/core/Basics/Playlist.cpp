@@ -46,6 +46,7 @@ Playlist::Playlist()
 
 Playlist::~Playlist()
 {
+	m_preloader.stop();
 	clear();
 	__instance = nullptr;
 }
@@ -59,6 +60,8 @@ void Playlist::create_instance()
 
 void Playlist::clear()
 {
+	m_preloader.clear();
+
 	for ( int i = 0; i < __entries.size(); i++ ) {
 		delete __entries[i];
 	}
@@ -179,6 +182,22 @@ void Playlist::activateSong( int songNumber )
 	setActiveSongNumber( songNumber );
 
 	execScript( songNumber );
+
+	// The song was already loaded by the caller. Samples kept from
+	// the previous preload are released and the ones of the next
+	// entry are fetched while this one is playing.
+	preloadSong( songNumber + 1 );
+}
+
+void Playlist::preloadSong( int nIndex )
+{
+	m_preloader.clear();
+
+	if ( nIndex < 0 || nIndex >= size() || ! get( nIndex )->fileExists ) {
+		return;
+	}
+
+	m_preloader.start( get( nIndex )->filePath );
 }
 
 bool Playlist::getSongFilenameByNumber( int songNumber, QString& filename)
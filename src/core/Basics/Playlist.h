@@ -24,6 +24,7 @@
 #define H2C_PLAYLIST_H
 
 #include <core/Object.h>
+#include <core/Basics/SamplePreloader.h>
 
 namespace H2Core
 {
@@ -106,6 +107,21 @@ class Playlist : public H2Core::Object
 
 		void execScript( int index );
 
+		/**
+		 * Loads the samples referenced by the song of entry @a
+		 * nIndex in the background.
+		 *
+		 * The song itself can not be read ahead of time since
+		 * SongReader::readSong() does alter the state of the
+		 * engine. But the decoding of its samples does dominate the
+		 * loading time of a song. The loaded samples are held till
+		 * the next call and handed to the layers of the next song
+		 * once it is opened.
+		 */
+		void preloadSong( int nIndex );
+
+		SamplePreloader m_preloader;
+
 		void save_to( XMLNode* node, bool useRelativePaths );
 		static Playlist* load_from( XMLNode* root, QFileInfo& fileInfo, bool useRelativePaths );
 };
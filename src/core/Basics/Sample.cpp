@@ -22,13 +22,21 @@
 
 
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include <core/Hydrogen.h>
 #include <core/Preferences.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleArena.h>
+#include <core/Basics/SampleMemory.h>
+#include <core/Basics/SamplePack.h>
+#include <core/Basics/SampleStretcher.h>
+#include <core/Helpers/Dsp.h>
 
 #if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
 #include <rubberband/RubberBandStretcher.h>
@@ -44,6 +52,20 @@ const char* EnvelopePoint::__class_name = "EnvolopePoint";
 
 const std::vector<QString> Sample::__loop_modes = { "forward", "reverse", "pingpong" };
 
+int Sample::__stream_preload = 0;
+bool Sample::__compact_storage = false;
+int Sample::__packed_preload = 0;
+int Sample::__resample_rate = 0;
+float Sample::__silence_threshold = 0;
+std::atomic<unsigned> Sample::__use_epoch( 1 );
+
+/** Number of taps of each phase of the filter used by
+	Sample::resample().*/
+static const int nResampleTaps = 32;
+/** Upper limit of the number of phases of the filter. Ratios requiring
+	more are approximated by the nearest phase.*/
+static const int nMaxResamplePhases = 1024;
+
 #if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
 static double compute_pitch_scale( const Sample::Rubberband& r );
 static RubberBand::RubberBandStretcher::Options compute_rubberband_options( const Sample::Rubberband& r );
@@ -73,7 +95,19 @@ Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* da
 	__sample_rate( sample_rate ),
 	__data_l( data_l ),
 	__data_r( data_r ),
-	__is_modified( false )
+	__resident_frames( frames ),
+	__is_streamed( false ),
+	__compact_l( nullptr ),
+	__compact_r( nullptr ),
+	__is_compact( false ),
+	__is_modified( false ),
+	__is_looped( false ),
+	__source_frames( 0 ),
+	__memory_prepared( false ),
+	__peaks_generation( 0 ),
+	__audible_start( 0 ),
+	__audible_end( -1 ),
+	__last_used( 0 )
 {
 	assert( filepath.lastIndexOf( "/" ) >0 );
 }
@@ -84,20 +118,55 @@ Sample::Sample( std::shared_ptr<Sample> pOther ): Object( __class_name ),
 	__sample_rate( pOther->get_sample_rate() ),
 	__data_l( nullptr ),
 	__data_r( nullptr ),
+	__resident_frames( pOther->get_resident_frames() ),
+	__is_streamed( pOther->is_streamed() ),
+	__compact_l( nullptr ),
+	__compact_r( nullptr ),
+	__is_compact( pOther->is_compact() ),
 	__is_modified( pOther->get_is_modified() ),
+	__is_looped( pOther->__is_looped ),
+	__source_frames( pOther->__source_frames ),
+	__velocity_gains( pOther->__velocity_gains ),
+	__pan_gains( pOther->__pan_gains ),
 	__loops( pOther->__loops ),
-	__rubberband( pOther->__rubberband )
+	__rubberband( pOther->__rubberband ),
+	__memory_prepared( false ),
+	__pack( pOther->get_pack() ),
+	__peaks( pOther->get_peaks() ),
+	__peaks_generation( 0 ),
+	__audible_start( pOther->__audible_start ),
+	__audible_end( pOther->__audible_end ),
+	__last_used( pOther->__last_used.load( std::memory_order_relaxed ) )
 {
+	// The unlooped frames of a looped sample are copied instead and
+	// the envelopes of a deferred one are not applied yet.
+	int nCopiedFrames = __resident_frames;
+	if ( __is_looped ) {
+		nCopiedFrames = __source_frames;
+	} else if ( pOther->is_deferred() && ! __is_compact ) {
+		nCopiedFrames = __frames;
+	}
 
-	__data_l = new float[__frames];
-	__data_r = new float[__frames];
+	__data_l = SampleArena::allocate( nCopiedFrames, __filepath );
+	__data_r = SampleArena::allocate( nCopiedFrames, __filepath );
 	
 	// Since the third argument of memcpy takes the number of bytes,
 	// which are about to be copied, and the data is given in float,
 	// which are  four bytes each, the number of copied frames
-	// `__frames` has to be multiplied by four.
-	memcpy( __data_l, pOther->get_data_l(), __frames * 4 );
-	memcpy( __data_r, pOther->get_data_r(), __frames * 4 );
+	// `nCopiedFrames` has to be multiplied by four.
+	memcpy( __data_l, pOther->get_data_l(), nCopiedFrames * 4 );
+	memcpy( __data_r, pOther->get_data_r(), nCopiedFrames * 4 );
+
+	if ( __is_compact ) {
+		__compact_l = new int16_t[ __frames ];
+		memcpy( __compact_l, pOther->__compact_l, __frames * sizeof( int16_t ) );
+		if ( pOther->__compact_r == pOther->__compact_l ) {
+			__compact_r = __compact_l;
+		} else {
+			__compact_r = new int16_t[ __frames ];
+			memcpy( __compact_r, pOther->__compact_r, __frames * sizeof( int16_t ) );
+		}
+	}
 	
 	PanEnvelope* pPan = pOther->get_pan_envelope();
 	for( int i=0; i<pPan->size(); i++ ) {
@@ -112,12 +181,85 @@ Sample::Sample( std::shared_ptr<Sample> pOther ): Object( __class_name ),
 
 Sample::~Sample()
 {
-	if ( __data_l != nullptr ) {
-		delete[] __data_l;
+	free_data();
+}
+
+void Sample::free_data()
+{
+	if ( __memory_prepared ) {
+		SampleMemory::release( this );
+	}
+	if ( __mapping.pAddress != nullptr ) {
+		SampleCache::release( __mapping );
+		__mapping = SampleCache::Mapping();
+	} else {
+		SampleArena::deallocate( __data_l );
+		SampleArena::deallocate( __data_r );
+	}
+	__data_l = __data_r = nullptr;
+
+	if ( __compact_r != __compact_l ) {
+		delete[] __compact_r;
+	}
+	delete[] __compact_l;
+	__compact_l = __compact_r = nullptr;
+	__pack.reset();
+	__is_looped = false;
+	__source_frames = 0;
+	__velocity_gains.clear();
+	__pan_gains.clear();
+
+	invalidate_peaks();
+}
+
+void Sample::invalidate_peaks()
+{
+	std::lock_guard<std::mutex> lock( __peaks_mutex );
+	__peaks = nullptr;
+	++__peaks_generation;
+	__audible_start = 0;
+	__audible_end = -1;
+}
+
+std::shared_ptr<const SamplePeaks> Sample::get_peaks() const
+{
+	std::lock_guard<std::mutex> lock( __peaks_mutex );
+	return __peaks;
+}
+
+bool Sample::set_peaks( std::shared_ptr<const SamplePeaks> pPeaks, int nGeneration )
+{
+	std::lock_guard<std::mutex> lock( __peaks_mutex );
+	if ( nGeneration != __peaks_generation ) {
+		return false;
+	}
+	__peaks = pPeaks;
+	return true;
+}
+
+int Sample::get_peaks_generation() const
+{
+	std::lock_guard<std::mutex> lock( __peaks_mutex );
+	return __peaks_generation;
+}
+
+SampleAnalysis Sample::get_analysis() const
+{
+	auto pPeaks = get_peaks();
+	if ( pPeaks == nullptr ) {
+		return SampleAnalysis();
 	}
-	if ( __data_r != nullptr ) {
-		delete[] __data_r;
+
+	SampleAnalysis analysis = pPeaks->get_analysis();
+	// Samples resampled at load time are summarized at the rate of
+	// their file.
+	if ( pPeaks->get_frames() > 0 && pPeaks->get_frames() != __frames ) {
+		double fScale = __frames / static_cast<double>( pPeaks->get_frames() );
+		analysis.nOnset = std::min( __frames, static_cast<int>( analysis.nOnset * fScale ) );
+		analysis.nEnd = std::min( __frames,
+								  static_cast<int>( std::ceil( analysis.nEnd * fScale ) ) );
 	}
+	return analysis;
 }
 
 void Sample::set_filename( const QString& filename )
@@ -128,7 +270,7 @@ void Sample::set_filename( const QString& filename )
 }
 
 
-std::shared_ptr<Sample> Sample::load( const QString& sFilepath )
+std::shared_ptr<Sample> Sample::load( const QString& sFilepath, bool bAllowStreaming )
 {
 	std::shared_ptr<Sample> pSample;
 	
@@ -139,7 +281,7 @@ std::shared_ptr<Sample> Sample::load( const QString& sFilepath )
 
 	pSample = std::make_shared<Sample>( sFilepath );
 		
-	if( !pSample->load() ) {
+	if( !pSample->load( bAllowStreaming ) ) {
 		pSample.reset();
 		return pSample;
 	}
@@ -147,12 +289,40 @@ std::shared_ptr<Sample> Sample::load( const QString& sFilepath )
 	return pSample;
 }
 
-std::shared_ptr<Sample> Sample::load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
+std::shared_ptr<Sample> Sample::load_streamed( const QString& sFilepath, int nResidentFrames )
+{
+	std::shared_ptr<Sample> pSample;
+
+	if( !Filesystem::file_readable( sFilepath ) ) {
+		ERRORLOG( QString( "Unable to read %1" ).arg( sFilepath ) );
+		return pSample;
+	}
+
+	pSample = std::make_shared<Sample>( sFilepath );
+
+	if( !pSample->load_file( false, nResidentFrames ) ) {
+		pSample.reset();
+	}
+
+	return pSample;
+}
+
+std::shared_ptr<Sample> Sample::load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, bool bStretchInBackground )
 {
 	auto pSample = Sample::load( filepath );
 	
 	if( pSample ){
-		pSample->apply( loops, rubber, velocity, pan );
+		SampleStretcher* pStretcher = SampleStretcher::get_instance();
+		if ( bStretchInBackground && rubber.use && pStretcher != nullptr ) {
+			pSample->apply_loops( loops );
+			pSample->apply_velocity( velocity );
+			pSample->apply_pan( pan );
+			pSample->set_rubberband( rubber );
+			pSample->detect_silence();
+			pStretcher->stretch( pSample );
+		} else {
+			pSample->apply( loops, rubber, velocity, pan );
+		}
 	}
 
 	return pSample;
@@ -164,14 +334,162 @@ void Sample::apply( const Loops& loops, const Rubberband& rubber, const Velocity
 	apply_velocity( velocity );
 	apply_pan( pan );
 #ifdef H2CORE_HAVE_RUBBERBAND
-	apply_rubberband( rubber );
+	apply_rubberband( rubber, Hydrogen::get_instance()->getNewBpmJTM() );
 #else
-	exec_rubberband_cli( rubber );
+	exec_rubberband_cli( rubber, Hydrogen::get_instance()->getNewBpmJTM() );
 #endif
+	detect_silence();
 }
 
-bool Sample::load()
+void Sample::swap_data( std::shared_ptr<Sample> pOther )
 {
+	// The bookkeeping of SampleMemory is per sample.
+	if ( __memory_prepared ) {
+		SampleMemory::release( this );
+	}
+	if ( pOther->__memory_prepared ) {
+		SampleMemory::release( pOther.get() );
+	}
+	std::swap( __frames, pOther->__frames );
+	std::swap( __data_l, pOther->__data_l );
+	std::swap( __data_r, pOther->__data_r );
+	std::swap( __resident_frames, pOther->__resident_frames );
+	std::swap( __is_streamed, pOther->__is_streamed );
+	std::swap( __compact_l, pOther->__compact_l );
+	std::swap( __compact_r, pOther->__compact_r );
+	std::swap( __is_compact, pOther->__is_compact );
+	std::swap( __is_looped, pOther->__is_looped );
+	std::swap( __source_frames, pOther->__source_frames );
+	std::swap( __velocity_gains, pOther->__velocity_gains );
+	std::swap( __pan_gains, pOther->__pan_gains );
+	std::swap( __mapping, pOther->__mapping );
+	std::swap( __pack, pOther->__pack );
+	std::swap( __rubberband, pOther->__rubberband );
+	__is_modified = true;
+	int nAudibleStart = pOther->__audible_start;
+	int nAudibleEnd = pOther->__audible_end;
+	invalidate_peaks();
+	__audible_start = nAudibleStart;
+	__audible_end = nAudibleEnd;
+}
+
+bool Sample::load( bool bAllowStreaming )
+{
+	if ( ! load_file( bAllowStreaming, bAllowStreaming ? __stream_preload : 0 ) ) {
+		return false;
+	}
+	detect_silence();
+	return true;
+}
+
+void Sample::set_silence_threshold( float fThreshold )
+{
+	__silence_threshold = fThreshold;
+}
+
+void Sample::detect_silence()
+{
+	__audible_start = 0;
+	__audible_end = -1;
+	if ( __silence_threshold <= 0 || __frames <= 0 ) {
+		return;
+	}
+
+	// Of a sample streamed from disk only the head is known.
+	const bool bTail = ! __is_streamed || __pack != nullptr;
+	const int nReadable = bTail ? __frames : __resident_frames;
+	const int nBlocks = ( nReadable + SAMPLE_PACK_BLOCK - 1 ) / SAMPLE_PACK_BLOCK;
+	const bool bPacked = __pack != nullptr && ! __is_looped;
+
+	std::vector<float> block_L( SAMPLE_PACK_BLOCK ), block_R( SAMPLE_PACK_BLOCK );
+	std::vector<int16_t> packed_L, packed_R;
+	if ( bPacked ) {
+		packed_L.resize( SAMPLE_PACK_BLOCK );
+		packed_R.resize( SAMPLE_PACK_BLOCK );
+	}
+
+	// Reads the frames of block @a nBlock into block_L and block_R
+	// and returns their number.
+	auto readBlock = [&]( int nBlock ) {
+		int nFirst = nBlock * SAMPLE_PACK_BLOCK;
+		int nFrames = std::min( SAMPLE_PACK_BLOCK, nReadable - nFirst );
+		if ( bPacked ) {
+			nFrames = __pack->decode_block( nBlock, packed_L.data(), packed_R.data() );
+			Dsp::convertInt16( block_L.data(), packed_L.data(), nFrames );
+			Dsp::convertInt16( block_R.data(), packed_R.data(), nFrames );
+			apply_envelope_gains( nFirst, nFrames, block_L.data(), block_R.data() );
+		} else {
+			read_frames( nFirst, nFrames, block_L.data(), block_R.data() );
+		}
+		return nFrames;
+	};
+	auto isAudible = [&]( int nFrame ) {
+		return std::fabs( block_L[ nFrame ] ) > __silence_threshold ||
+			std::fabs( block_R[ nFrame ] ) > __silence_threshold;
+	};
+
+	int nStart = -1;
+	for ( int nBlock = 0; nBlock < nBlocks && nStart == -1; ++nBlock ) {
+		int nFrames = readBlock( nBlock );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			if ( isAudible( ii ) ) {
+				nStart = nBlock * SAMPLE_PACK_BLOCK + ii;
+				break;
+			}
+		}
+	}
+
+	if ( ! bTail ) {
+		__audible_start = std::max( nStart, 0 );
+		return;
+	}
+	if ( nStart == -1 ) {
+		// Entirely silent.
+		__audible_end = 0;
+		return;
+	}
+	__audible_start = nStart;
+
+	for ( int nBlock = nBlocks - 1; nBlock >= nStart / SAMPLE_PACK_BLOCK; --nBlock ) {
+		int nFrames = readBlock( nBlock );
+		for ( int ii = nFrames - 1; ii >= 0; --ii ) {
+			if ( isAudible( ii ) ) {
+				__audible_end = nBlock * SAMPLE_PACK_BLOCK + ii + 1;
+				return;
+			}
+		}
+	}
+}
+
+bool Sample::load_file( bool bAllowStreaming, int nStreamPreload )
+{
+	// Streamed samples are read from the original file by the
+	// SampleStreamer anyway and temporary files, like the output of
+	// the Rubber Band CLI, are not worth caching. The cache does only
+	// hold float data, which would defeat the compact and packed
+	// storage.
+	bool bUseCache = Preferences::get_instance()->m_bSampleCache &&
+		nStreamPreload <= 0 &&
+		! ( bAllowStreaming && ( __compact_storage || __packed_preload > 0 ) ) &&
+		! __filepath.startsWith( Filesystem::tmp_dir() );
+	bool bResample = bAllowStreaming && __resample_rate > 0;
+	if ( bUseCache ) {
+		if ( bResample && load_cached( __resample_rate ) ) {
+			return true;
+		}
+		if ( load_cached( 0 ) ) {
+			if ( bResample && __sample_rate != __resample_rate ) {
+				resample( __resample_rate, true );
+				// Only data mapped from the cache can be dropped by
+				// SampleMemory::enforce_budget().
+				if ( Preferences::get_instance()->m_nSampleMemoryBudget > 0 ) {
+					load_cached( __resample_rate );
+				}
+			}
+			return true;
+		}
+	}
+
 	// Will contain a bunch of metadata about the loaded sample.
 	SF_INFO sound_info = {0};
 
@@ -193,9 +511,44 @@ bool Sample::load()
 		sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
 	}
 
+	// Samples encoded with at most 16 bit do not gain any precision
+	// from being stored as float.
+	int nSubFormat = sound_info.format & SF_FORMAT_SUBMASK;
+	bool bNative16 = nSubFormat == SF_FORMAT_PCM_16 || nSubFormat == SF_FORMAT_PCM_S8 ||
+		nSubFormat == SF_FORMAT_PCM_U8;
+	bool bResampled = bResample && sound_info.samplerate != __resample_rate;
+
+	// Long ones are compressed in memory rather than streamed from
+	// disk.
+	if ( bAllowStreaming && __packed_preload > 0 && bNative16 && ! bResampled &&
+		 sound_info.frames > __packed_preload ) {
+		bool bSuccess = load_packed( file, sound_info );
+		if ( sf_close( file ) != 0 ){
+			WARNINGLOG( QString( "Unable to close sample file %1" ).arg( __filepath ) );
+		}
+		return bSuccess;
+	}
+
+	// Of long samples allowed to be streamed only the head is
+	// kept in memory.
+	int nResidentFrames = sound_info.frames;
+	bool bStreamed = false;
+	if ( nStreamPreload > 0 && sound_info.frames > nStreamPreload ) {
+		nResidentFrames = nStreamPreload;
+		bStreamed = true;
+	}
+
+	if ( bAllowStreaming && __compact_storage && ! bStreamed && ! bResampled && bNative16 ) {
+		bool bSuccess = load_compact( file, sound_info );
+		if ( sf_close( file ) != 0 ){
+			WARNINGLOG( QString( "Unable to close sample file %1" ).arg( __filepath ) );
+		}
+		return bSuccess;
+	}
+
 	// Create an array, which will hold the block of samples read
 	// from file.
-	float* buffer = new float[ sound_info.frames * sound_info.channels ];
+	float* buffer = new float[ nResidentFrames * sound_info.channels ];
 	
 	//memset( buffer, 0, sound_info.frames *sound_info.channels );
 	
@@ -203,10 +556,11 @@ bool Sample::load()
 	// convert the format of the underlying data on the fly. The
 	// output will be an array of floats regardless of file's
 	// encoding (e.g. 16 bit PCM).
-	sf_count_t count = sf_read_float( file, buffer, sound_info.frames * sound_info.channels );
+	sf_count_t count = sf_read_float( file, buffer, nResidentFrames * sound_info.channels );
 	if( count==0 ){
 		WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
 	}
+	bool bComplete = ( count == static_cast<sf_count_t>( nResidentFrames ) * sound_info.channels );
 	
 	// Deallocate the handler.
 	if ( sf_close( file ) != 0 ){
@@ -221,26 +575,300 @@ bool Sample::load()
 	// of the Sample class.
 	__frames = sound_info.frames;
 	__sample_rate = sound_info.samplerate;
+	__resident_frames = nResidentFrames;
+	__is_streamed = bStreamed;
 
 	// Split the loaded frames into left and right channel. 
 	// If only one channels was present in the underlying data,
 	// duplicate its content.
-	__data_l = new float[ sound_info.frames ];
-	__data_r = new float[ sound_info.frames ];
+	__data_l = SampleArena::allocate( nResidentFrames, __filepath );
+	__data_r = SampleArena::allocate( nResidentFrames, __filepath );
 	if ( sound_info.channels == 1 ) {
-		memcpy( __data_l, buffer, __frames * sizeof( float ) );
-		memcpy( __data_r, buffer, __frames * sizeof( float ) );
+		memcpy( __data_l, buffer, nResidentFrames * sizeof( float ) );
+		memcpy( __data_r, buffer, nResidentFrames * sizeof( float ) );
 	} else if ( sound_info.channels == SAMPLE_CHANNELS ) {
-		for ( int i = 0; i < __frames; i++ ) {
+		for ( int i = 0; i < nResidentFrames; i++ ) {
 			__data_l[i] = buffer[i * SAMPLE_CHANNELS ];
 			__data_r[i] = buffer[i * SAMPLE_CHANNELS + 1 ];
 		}
 	}
 	delete[] buffer;
 
+	if ( bUseCache && ! bStreamed && bComplete ) {
+		SampleCache::store( __filepath, __frames, __sample_rate, __data_l, __data_r );
+	}
+
+	// The SampleStreamer reads the remaining frames of streamed
+	// samples from the original file.
+	if ( bResample && ! bStreamed ) {
+		resample( __resample_rate, bUseCache && bComplete );
+	}
+
+	// Only data mapped from the cache can be dropped by
+	// SampleMemory::enforce_budget().
+	if ( bUseCache && ! bStreamed && bComplete &&
+		 Preferences::get_instance()->m_nSampleMemoryBudget > 0 ) {
+		load_cached( __sample_rate != sound_info.samplerate ? __sample_rate : 0 );
+	}
+
+	return true;
+}
+
+bool Sample::load_cached( int nResampledRate )
+{
+	int nFrames, nSampleRate;
+	float* pData_L;
+	float* pData_R;
+	SampleCache::Mapping mapping;
+	if ( ! SampleCache::load( __filepath, &nFrames, &nSampleRate,
+							  &pData_L, &pData_R, &mapping, nResampledRate ) ) {
+		return false;
+	}
+
+	unload();
+	__frames = nFrames;
+	__sample_rate = nSampleRate;
+	__resident_frames = nFrames;
+	__is_streamed = false;
+	__data_l = pData_L;
+	__data_r = pData_R;
+	__mapping = mapping;
+	return true;
+}
+
+void Sample::resample( int nSampleRate, bool bStore )
+{
+	if ( nSampleRate <= 0 || __sample_rate <= 0 || __sample_rate == nSampleRate ||
+		 __is_streamed || __is_compact || __frames <= 0 ) {
+		return;
+	}
+
+	// Output frame n is located at n * nDown / nUp input frames.
+	int nGcd = nSampleRate, nRemainder = __sample_rate;
+	while ( nRemainder != 0 ) {
+		int nTmp = nGcd % nRemainder;
+		nGcd = nRemainder;
+		nRemainder = nTmp;
+	}
+	const int64_t nUp = nSampleRate / nGcd;
+	const int64_t nDown = __sample_rate / nGcd;
+	const int nPhases = static_cast<int>( std::min( nUp, static_cast<int64_t>( nMaxResamplePhases ) ) );
+
+	// Windowed sinc low pass at the lower of both Nyquist
+	// frequencies, sampled at nPhases fractional offsets.
+	const double fCutoff = std::min( 1.0, static_cast<double>( nUp ) / nDown );
+	const int nHalf = nResampleTaps / 2;
+	std::vector<float> filter( nPhases * nResampleTaps );
+	for ( int nPhase = 0; nPhase < nPhases; ++nPhase ) {
+		double fOffset = static_cast<double>( nPhase ) / nPhases;
+		for ( int nTap = 0; nTap < nResampleTaps; ++nTap ) {
+			double fX = nTap - nHalf + 1 - fOffset;
+			double fSinc = fX == 0 ? 1.0 : sin( M_PI * fCutoff * fX ) / ( M_PI * fCutoff * fX );
+			double fWindow = 0.42 + 0.5 * cos( M_PI * fX / nHalf ) +
+				0.08 * cos( 2 * M_PI * fX / nHalf );
+			filter[ nPhase * nResampleTaps + nTap ] = fCutoff * fSinc * fWindow;
+		}
+	}
+
+	const int nFrames = static_cast<int>( static_cast<int64_t>( __frames ) * nUp / nDown );
+	float* pData[ 2 ] = { SampleArena::allocate( nFrames, __filepath ),
+						  SampleArena::allocate( nFrames, __filepath ) };
+	const float* pSource[ 2 ] = { __data_l, __data_r };
+
+	for ( int nChannel = 0; nChannel < 2; ++nChannel ) {
+		const float* pIn = pSource[ nChannel ];
+		float* pOut = pData[ nChannel ];
+		for ( int nFrame = 0; nFrame < nFrames; ++nFrame ) {
+			int64_t nPos = nFrame * nDown;
+			int nFirst = static_cast<int>( nPos / nUp ) - nHalf + 1;
+			int nPhase = static_cast<int>( ( nPos % nUp ) * nPhases / nUp );
+			const float* pFilter = &filter[ nPhase * nResampleTaps ];
+
+			float fValue = 0;
+			if ( nFirst >= 0 && nFirst + nResampleTaps <= __frames ) {
+				for ( int nTap = 0; nTap < nResampleTaps; ++nTap ) {
+					fValue += pIn[ nFirst + nTap ] * pFilter[ nTap ];
+				}
+			} else {
+				for ( int nTap = 0; nTap < nResampleTaps; ++nTap ) {
+					int nIndex = nFirst + nTap;
+					if ( nIndex >= 0 && nIndex < __frames ) {
+						fValue += pIn[ nIndex ] * pFilter[ nTap ];
+					}
+				}
+			}
+			pOut[ nFrame ] = fValue;
+		}
+	}
+
+	free_data();
+	__data_l = pData[ 0 ];
+	__data_r = pData[ 1 ];
+	__frames = nFrames;
+	__resident_frames = nFrames;
+	__sample_rate = nSampleRate;
+
+	if ( bStore ) {
+		SampleCache::store( __filepath, __frames, __sample_rate, __data_l, __data_r,
+							nSampleRate );
+	}
+}
+
+bool Sample::load_compact( SNDFILE* file, const SF_INFO& sound_info )
+{
+	int16_t* buffer = new int16_t[ sound_info.frames * sound_info.channels ];
+
+	// Libsndfile does not scale 16 bit PCM when reading shorts.
+	sf_count_t count = sf_read_short( file, buffer, sound_info.frames * sound_info.channels );
+	if( count==0 ){
+		WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
+	}
+	if ( count < static_cast<sf_count_t>( sound_info.frames ) * sound_info.channels ) {
+		memset( buffer + count, 0,
+				( sound_info.frames * sound_info.channels - count ) * sizeof( int16_t ) );
+	}
+
+	unload();
+
+	__frames = sound_info.frames;
+	__sample_rate = sound_info.samplerate;
+	__resident_frames = 0;
+	__is_streamed = false;
+	__is_compact = true;
+
+	if ( sound_info.channels == 1 ) {
+		// Mono samples are stored only once.
+		__compact_l = __compact_r = buffer;
+	} else {
+		__compact_l = new int16_t[ __frames ];
+		__compact_r = new int16_t[ __frames ];
+		for ( int i = 0; i < __frames; i++ ) {
+			__compact_l[i] = buffer[i * sound_info.channels ];
+			__compact_r[i] = buffer[i * sound_info.channels + 1 ];
+		}
+		delete[] buffer;
+	}
+
 	return true;
 }
 
+bool Sample::load_packed( SNDFILE* file, const SF_INFO& sound_info )
+{
+	std::vector<int16_t> buffer( static_cast<size_t>( sound_info.frames ) * sound_info.channels );
+
+	// Libsndfile does not scale 16 bit PCM when reading shorts.
+	sf_count_t count = sf_read_short( file, buffer.data(), buffer.size() );
+	if( count==0 ){
+		WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
+	}
+
+	// Frames missing in a truncated file are left silent.
+	auto pPack = std::make_shared<SamplePack>( buffer.data(), sound_info.frames,
+											   sound_info.channels );
+
+	unload();
+
+	__frames = sound_info.frames;
+	__sample_rate = sound_info.samplerate;
+	__resident_frames = std::min( __packed_preload, __frames );
+	__is_streamed = true;
+	__pack = pPack;
+
+	// The head is played right away, before the SampleStreamer
+	// had the chance to decode anything.
+	__data_l = SampleArena::allocate( __resident_frames, __filepath );
+	__data_r = SampleArena::allocate( __resident_frames, __filepath );
+	const int nRight = sound_info.channels > 1 ? 1 : 0;
+	const float fScale = 1.0f / 32768.0f;
+	for ( int i = 0; i < __resident_frames; i++ ) {
+		__data_l[i] = buffer[i * sound_info.channels ] * fScale;
+		__data_r[i] = buffer[i * sound_info.channels + nRight ] * fScale;
+	}
+
+	return true;
+}
+
+void Sample::read_frames( int nFirst, int nFrames, float* pOut_L, float* pOut_R ) const
+{
+	if ( __is_looped ) {
+		int nOut = 0;
+		while ( nOut < nFrames ) {
+			int nStep, nLength;
+			int nSource = map_looped_frame( nFirst + nOut, &nStep, &nLength );
+			nLength = std::min( nLength, nFrames - nOut );
+			if ( nStep > 0 ) {
+				memcpy( pOut_L + nOut, __data_l + nSource, nLength * sizeof( float ) );
+				memcpy( pOut_R + nOut, __data_r + nSource, nLength * sizeof( float ) );
+			} else {
+				for ( int ii = 0; ii < nLength; ++ii ) {
+					// Reversed sections start at end_frame, which
+					// may be one past the last frame.
+					int nFrame = std::min( nSource - ii, __source_frames - 1 );
+					pOut_L[ nOut + ii ] = __data_l[ nFrame ];
+					pOut_R[ nOut + ii ] = __data_r[ nFrame ];
+				}
+			}
+			nOut += nLength;
+		}
+	} else if ( ! __is_compact ) {
+		memcpy( pOut_L, __data_l + nFirst, nFrames * sizeof( float ) );
+		memcpy( pOut_R, __data_r + nFirst, nFrames * sizeof( float ) );
+	} else {
+		Dsp::convertInt16( pOut_L, __compact_l + nFirst, nFrames );
+		if ( __compact_r == __compact_l ) {
+			memcpy( pOut_R, pOut_L, nFrames * sizeof( float ) );
+		} else {
+			Dsp::convertInt16( pOut_R, __compact_r + nFirst, nFrames );
+		}
+	}
+
+	apply_envelope_gains( nFirst, nFrames, pOut_L, pOut_R );
+}
+
+void Sample::apply_envelope_gains( int nFirst, int nFrames, float* pOut_L, float* pOut_R ) const
+{
+	int nLast = std::min( nFirst + nFrames, __frames );
+
+	for ( const auto& segment : __velocity_gains ) {
+		int nEnd = std::min( segment.nEnd, nLast );
+		for ( int z = std::max( { segment.nStart, nFirst, 0 } ); z < nEnd; ++z ) {
+			float y = segment.fGain - ( z - segment.nStart ) * segment.fStep;
+			pOut_L[ z - nFirst ] *= y;
+			pOut_R[ z - nFirst ] *= y;
+		}
+	}
+
+	for ( const auto& segment : __pan_gains ) {
+		int nEnd = std::min( segment.nEnd, nLast );
+		for ( int z = std::max( { segment.nStart, nFirst, 0 } ); z < nEnd; ++z ) {
+			float y = segment.fGain - ( z - segment.nStart ) * segment.fStep;
+			// seems wrong to modify only one channel ?!?!
+			if ( y < 0 ) {
+				pOut_L[ z - nFirst ] *= 1 + y;
+			} else if ( y > 0 ) {
+				pOut_R[ z - nFirst ] *= 1 - y;
+			}
+		}
+	}
+}
+
+bool Sample::make_resident()
+{
+	if ( is_deferred() ) {
+		expand();
+		return true;
+	}
+	if ( __is_compact ) {
+		INFOLOG( QString( "Converting compactly stored sample %1 to float" ).arg( __filepath ) );
+		return load( false );
+	}
+	if ( ! __is_streamed ) {
+		return true;
+	}
+	INFOLOG( QString( "Loading all frames of streamed sample %1" ).arg( __filepath ) );
+	return load( false );
+}
+
 bool Sample::apply_loops( const Loops& lo )
 {
 	if( __loops == lo ) {
@@ -267,77 +895,85 @@ bool Sample::apply_loops( const Loops& lo )
 		return false;
 	}
 	//if( lo == __loops ) return true;
+	if ( !make_resident() ) {
+		return false;
+	}
 
-	bool full_loop = lo.start_frame==lo.loop_frame;
 	int full_length =  lo.end_frame - lo.start_frame;
 	int loop_length =  lo.end_frame - lo.loop_frame;
-	int new_length = full_length + loop_length * lo.count;
 
-	float* new_data_l = new float[ new_length ];
-	float* new_data_r = new float[ new_length ];
+	// The unlooped frames are kept and the loops are applied by
+	// read_frames(). Subsequent transformations, like envelopes or
+	// Rubber Band, do expand them using make_resident().
+	__loops = lo;
+	__source_frames = __frames;
+	__frames = full_length + loop_length * lo.count;
+	__is_looped = true;
+	__is_modified = true;
+	invalidate_peaks();
+	return true;
+}
 
-	// copy full_length frames to new_data
-	if ( lo.mode==Loops::REVERSE && ( lo.count==0 || full_loop ) ) {
-		if( full_loop ) {
-			// copy end => start
-			for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) {
-				new_data_l[i]=__data_l[j];
-			}
-			for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) {
-				new_data_r[i]=__data_r[j];
-			}
-		} else {
-			// copy start => loop
-			int to_loop = lo.loop_frame - lo.start_frame;
-			memcpy( new_data_l, __data_l+lo.start_frame, sizeof( float )*to_loop );
-			memcpy( new_data_r, __data_r+lo.start_frame, sizeof( float )*to_loop );
-			// copy end => loop
-			for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) {
-				new_data_l[i]=__data_l[j];
-			}
-			for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) {
-				new_data_r[i]=__data_r[j];
-			}
-		}
-	} else {
-		// copy start => end
-		memcpy( new_data_l, __data_l+lo.start_frame, sizeof( float )*full_length );
-		memcpy( new_data_r, __data_r+lo.start_frame, sizeof( float )*full_length );
-	}
-	// copy the loops
-	if( lo.count>0 ) {
-		int x = full_length;
-		bool forward = ( lo.mode==Loops::FORWARD );
-		bool ping_pong = ( lo.mode==Loops::PINGPONG );
-		for( int i=0; i<lo.count; i++ ) {
-			if ( forward ) {
-				// copy loop => end
-				memcpy( &new_data_l[x], __data_l+lo.loop_frame, sizeof( float )*loop_length );
-				memcpy( &new_data_r[x], __data_r+lo.loop_frame, sizeof( float )*loop_length );
-			} else {
-				// copy end => loop
-				for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) {
-					new_data_l[y]=__data_l[i];
-				}
-				for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) {
-					new_data_r[y]=__data_r[i];
-				}
-			}
-			x+=loop_length;
-			if( ping_pong ) {
-				forward=!forward;
+int Sample::map_looped_frame( int nFrame, int* pStep, int* pLength ) const
+{
+	const Loops& lo = __loops;
+	bool full_loop = lo.start_frame==lo.loop_frame;
+	int full_length =  lo.end_frame - lo.start_frame;
+	int loop_length =  lo.end_frame - lo.loop_frame;
+
+	if ( nFrame < full_length ) {
+		if ( lo.mode==Loops::REVERSE && ( lo.count==0 || full_loop ) ) {
+			int to_loop = full_loop ? 0 : lo.loop_frame - lo.start_frame;
+			if ( nFrame < to_loop ) {
+				// start => loop
+				*pStep = 1;
+				*pLength = to_loop - nFrame;
+				return lo.start_frame + nFrame;
 			}
+			// end => loop
+			*pStep = -1;
+			*pLength = full_length - nFrame;
+			return lo.end_frame - ( nFrame - to_loop );
 		}
-		assert( x==new_length );
+		// start => end
+		*pStep = 1;
+		*pLength = full_length - nFrame;
+		return lo.start_frame + nFrame;
 	}
-	__loops = lo;
-	delete[] __data_l;
-	delete[] __data_r;
+
+	int nLoop = ( nFrame - full_length ) / loop_length;
+	int nOffset = ( nFrame - full_length ) % loop_length;
+	bool forward = lo.mode==Loops::FORWARD ||
+		( lo.mode==Loops::PINGPONG && nLoop % 2 == 1 );
+	*pLength = loop_length - nOffset;
+	if ( forward ) {
+		// loop => end
+		*pStep = 1;
+		return lo.loop_frame + nOffset;
+	}
+	// end => loop
+	*pStep = -1;
+	return lo.end_frame - nOffset;
+}
+
+void Sample::expand()
+{
+	int nFrames = __frames;
+	float* new_data_l = SampleArena::allocate( nFrames, __filepath );
+	float* new_data_r = SampleArena::allocate( nFrames, __filepath );
+	read_frames( 0, nFrames, new_data_l, new_data_r );
+
+	// The content does not change.
+	int nAudibleStart = __audible_start;
+	int nAudibleEnd = __audible_end;
+	free_data();
+	__audible_start = nAudibleStart;
+	__audible_end = nAudibleEnd;
 	__data_l = new_data_l;
 	__data_r = new_data_r;
-	__frames = new_length;
-	__is_modified = true;
-	return true;
+	__frames = nFrames;
+	__resident_frames = nFrames;
+	__is_compact = false;
 }
 
 void Sample::apply_velocity( const VelocityEnvelope& v )
@@ -350,8 +986,14 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 	{
 		return;
 	}
+	// The envelope is applied by read_frames() and replaces the
+	// previous one.
+	if ( __is_streamed && !make_resident() ) {
+		return;
+	}
 	
 	__velocity_envelope.clear();
+	__velocity_gains.clear();
 	if ( v.size() > 0 ) {
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < v.size(); i++ ) {
@@ -363,11 +1005,8 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 				end_frame = __frames;
 			}
 			int length = end_frame - start_frame ;
-			float step = ( y - k ) / length;;
-			for ( int z = start_frame ; z < end_frame; z++ ) {
-				__data_l[z] = __data_l[z] * y;
-				__data_r[z] = __data_r[z] * y;
-				y-=step;
+			if ( length > 0 ) {
+				__velocity_gains.push_back( { start_frame, end_frame, y, ( y - k ) / length } );
 			}
 		}
 		
@@ -376,6 +1015,7 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 		}
 	}
 	__is_modified = true;
+	invalidate_peaks();
 }
 
 void Sample::apply_pan( const PanEnvelope& p )
@@ -385,8 +1025,12 @@ void Sample::apply_pan( const PanEnvelope& p )
 	{
 		return;
 	}
+	if ( __is_streamed && !make_resident() ) {
+		return;
+	}
 	
 	__pan_envelope.clear();
+	__pan_gains.clear();
 	if ( p.size() > 0 ) {
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < p.size(); i++ ) {
@@ -398,22 +1042,8 @@ void Sample::apply_pan( const PanEnvelope& p )
 				end_frame = __frames;
 			}
 			int length = end_frame - start_frame ;
-			float step = ( y - k ) / length;;
-			for ( int z = start_frame ; z < end_frame; z++ ) {
-				// seems wrong to modify only one channel ?!?!
-				if( y < 0 ) {
-					float k = 1 + y;
-					__data_l[z] = __data_l[z] * k;
-					__data_r[z] = __data_r[z];
-				} else if ( y > 0 ) {
-					float k = 1 - y;
-					__data_l[z] = __data_l[z];
-					__data_r[z] = __data_r[z] * k;
-				} else if( y==0 ) {
-					__data_l[z] = __data_l[z];
-					__data_r[z] = __data_r[z];
-				}
-				y-=step;
+			if ( length > 0 ) {
+				__pan_gains.push_back( { start_frame, end_frame, y, ( y - k ) / length } );
 			}
 		}
 		
@@ -422,17 +1052,21 @@ void Sample::apply_pan( const PanEnvelope& p )
 		}
 	}
 	__is_modified = true;
+	invalidate_peaks();
 }
 
-void Sample::apply_rubberband( const Rubberband& rb )
+void Sample::apply_rubberband( const Rubberband& rb, float fBpm )
 {
 	// TODO see Rubberband declaration in sample.h
 #ifdef H2CORE_HAVE_RUBBERBAND
 	if( !rb.use ){
 		return;
 	}
+	if ( !make_resident() ) {
+		return;
+	}
 	// compute rubberband options
-	double output_duration = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider;
+	double output_duration = 60.0 / fBpm * rb.divider;
 	double time_ratio = output_duration / get_sample_duration();
 	RubberBand::RubberBandStretcher::Options options = compute_rubberband_options( rb );
 	double pitch_scale = compute_pitch_scale( rb );
@@ -575,10 +1209,9 @@ void Sample::apply_rubberband( const Rubberband& rb )
 		retrieved += n;
 	}
 	
-	delete [] __data_l;
-	delete [] __data_r;
-	__data_l = new float[ retrieved ];
-	__data_r = new float[ retrieved ];
+	free_data();
+	__data_l = SampleArena::allocate( retrieved, __filepath );
+	__data_r = SampleArena::allocate( retrieved, __filepath );
 	memcpy( __data_l, out_data_l, retrieved*sizeof( float ) );
 	memcpy( __data_r, out_data_r, retrieved*sizeof( float ) );
 	delete [] out_data_l;
@@ -588,10 +1221,11 @@ void Sample::apply_rubberband( const Rubberband& rb )
 	__rubberband = rb;
 	__frames = retrieved;
 	__is_modified = true;
+	invalidate_peaks();
 #endif
 }
 
-bool Sample::exec_rubberband_cli( const Rubberband& rb )
+bool Sample::exec_rubberband_cli( const Rubberband& rb, float fBpm )
 {
 	//set the path to rubberband-cli
 	QString program = Preferences::get_instance()->m_rubberBandCLIexecutable;
@@ -602,6 +1236,9 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 	}
 
 	if( rb.use ) {
+		if ( !make_resident() ) {
+			return false;
+		}
 		QString outfilePath =  QDir::tempPath() + "/tmp_rb_outfile.wav";
 		if( !write( outfilePath ) ) {
 			ERRORLOG( "unable to write sample" );
@@ -610,7 +1247,7 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 
 		unsigned rubberoutframes = 0;
 		double ratio = 1.0;
-		double durationtime = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider/*beats*/;
+		double durationtime = 60.0 / fBpm * rb.divider/*beats*/;
 		double induration = get_sample_duration();
 		if ( induration != 0.0 ) {
 			ratio = durationtime / induration;
@@ -660,12 +1297,16 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 
 		__frames = p_Rubberbanded->get_frames();
 
+		free_data();
 		__data_l = p_Rubberbanded->get_data_l();
 		__data_r = p_Rubberbanded->get_data_r();
+		__mapping = p_Rubberbanded->__mapping;
 		p_Rubberbanded->__data_l = nullptr;
 		p_Rubberbanded->__data_r = nullptr;
+		p_Rubberbanded->__mapping = SampleCache::Mapping();
 
 		__is_modified = true;
+		invalidate_peaks();
 		__rubberband = rb;
 	}
 	return true;
@@ -686,6 +1327,9 @@ Sample::Loops::LoopMode Sample::parse_loop_mode( const QString& sMode )
 
 bool Sample::write( const QString& path, int format )
 {
+	if ( !make_resident() ) {
+		return false;
+	}
 	float* obuf = new float[ SAMPLE_CHANNELS * __frames ];
 	for ( int i = 0; i < __frames; ++i ) {
 		float value_l = __data_l[i];
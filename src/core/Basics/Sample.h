@@ -23,15 +23,22 @@
 #ifndef H2C_SAMPLE_H
 #define H2C_SAMPLE_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <sndfile.h>
 
 #include <core/Object.h>
+#include <core/Basics/SampleCache.h>
+#include <core/Basics/SamplePeaks.h>
 
 namespace H2Core
 {
 
+class SamplePack;
+
 /**
  * A container for a sample, being able to apply modifications on it
  */
@@ -157,14 +164,27 @@ class Sample : public H2Core::Object
 		 * load() member on it.
 		 *
 		 * \param filepath the file to load audio data from
+		 * \param bAllowStreaming passed to the load() member
 		 *
 		 * \return Pointer to the newly initialized Sample. If
 		 * the provided @a filepath is not readable, a nullptr
 		 * is returned instead.
 		 *
-		 * \fn load(const QString& filepath)
+		 * \fn load(const QString& filepath, bool bAllowStreaming)
 		 */
-		static std::shared_ptr<Sample> load( const QString& filepath);
+		static std::shared_ptr<Sample> load( const QString& filepath, bool bAllowStreaming = false );
+		/**
+		 * Load a long sample, like the playback track of a Song,
+		 * keeping only its first @a nResidentFrames in memory.
+		 *
+		 * Independent of set_stream_preload(). The remaining frames
+		 * are fed to the Sampler by the SampleStreamer. Neither
+		 * compact storage nor resampling is applied.
+		 *
+		 * \return Pointer to the newly initialized Sample or a
+		 * nullptr if @a filepath could not be read.
+		 */
+		static std::shared_ptr<Sample> load_streamed( const QString& filepath, int nResidentFrames );
 	
 		/**
 		 * Load a sample from a file and apply the
@@ -180,14 +200,18 @@ class Sample : public H2Core::Object
 		 * \param rubber band transformation parameters
 		 * \param velocity envelope points
 		 * \param pan envelope points
+		 * \param bStretchInBackground If true, Rubber Band is not
+		 * applied right away but queued in the SampleStretcher.
+		 * The returned Sample holds the unstretched data until
+		 * it is done.
 		 *
 		 * \return Pointer to the newly initialized Sample. If
 		 * the provided @a filepath is not readable, a nullptr
 		 * is returned instead.
 		 *
-		 * \overload load(const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan)
+		 * \overload load(const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, bool bStretchInBackground)
 		 */
-		static std::shared_ptr<Sample> load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan );
+		static std::shared_ptr<Sample> load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, bool bStretchInBackground = false );
 
 		/**
 		 * Load the sample stored in #__filepath into
@@ -210,9 +234,146 @@ class Sample : public H2Core::Object
 		 * truncated and a warning log message will be
 		 * displayed.
 		 *
-		 * \fn load()
+		 * If @a bAllowStreaming is set and streaming was enabled
+		 * using set_stream_preload(), only the head of a long
+		 * sample is read. The remaining frames are fed to the
+		 * Sampler by the SampleStreamer during playback.
+		 *
+		 * If @a bAllowStreaming and set_compact_storage() are set,
+		 * samples encoded with at most 16 bit are kept in their
+		 * native resolution instead and mono ones in a single
+		 * channel (see is_compact()).
+		 *
+		 * If @a bAllowStreaming and set_packed_storage() are set,
+		 * long samples encoded with at most 16 bit are compressed
+		 * losslessly in memory instead (see get_pack()). This
+		 * takes precedence over both streaming and the compact
+		 * storage.
+		 *
+		 * If @a bAllowStreaming is set and a rate was set using
+		 * set_resample_rate(), samples recorded at a different
+		 * rate and not streamed are converted to it right away.
+		 * This takes precedence over the compact storage. The
+		 * converted data is kept in the SampleCache too.
+		 *
+		 * \param bAllowStreaming Whether the sample may be
+		 * streamed or stored compactly. Only samples played by the
+		 * Sampler without further processing should be.
+		 *
+		 * \fn load(bool bAllowStreaming)
+		 */
+		bool load( bool bAllowStreaming = false );
+		/**
+		 * Reads the frames of a streamed sample not resident yet
+		 * and converts compactly stored ones to float. Used before
+		 * the sample data is processed as a whole.
+		 *
+		 * \return true on success or if the sample was already
+		 * resident.
+		 */
+		bool make_resident();
+		/** \return true if only the first get_resident_frames()
+			frames of the sample are in memory.*/
+		bool is_streamed() const;
+		/** \return Number of frames available in #__data_l
+			and #__data_r.*/
+		int get_resident_frames() const;
+		/**
+		 * Sets the number of frames kept in memory of streamed
+		 * samples. Streaming is disabled if @a nFrames is zero,
+		 * which is the default.
+		 *
+		 * It is called by the Sampler when setting up its
+		 * SampleStreamer.
+		 */
+		static void set_stream_preload( int nFrames );
+		/** \return true if the frames are held in 16 bit
+			integers instead of #__data_l and #__data_r. Those are
+			nullptr and get_resident_frames() is zero in this case.
+			The frames can be accessed using read_frames().*/
+		bool is_compact() const;
+		/**
+		 * Enables the compact storage of samples loaded using
+		 * load() with @a bAllowStreaming set.
+		 *
+		 * It is called by the Sampler according to
+		 * Preferences::m_bCompactSampleStorage.
+		 */
+		static void set_compact_storage( bool bEnabled );
+		/**
+		 * Enables the lossless compressed storage of samples
+		 * loaded using load() with @a bAllowStreaming set. Of
+		 * samples longer than @a nResidentFrames only those are
+		 * kept in #__data_l and #__data_r. The sample is
+		 * streamed and the SampleStreamer decodes the remaining
+		 * frames from memory. Zero, the default, disables it.
+		 *
+		 * It is called by the Sampler according to
+		 * Preferences::m_bPackedSampleStorage.
+		 */
+		static void set_packed_storage( int nResidentFrames );
+		/** \return All frames of a streamed sample compressed
+			losslessly, or nullptr if the SampleStreamer has to
+			read them from #__filepath. See
+			set_packed_storage().*/
+		std::shared_ptr<const SamplePack> get_pack() const;
+		/** \return true if #__loops or the envelopes are not
+			applied to the data in memory but by read_frames() on
+			the fly. get_resident_frames() is zero in this case and
+			the frames have to be accessed using read_frames().
+			make_resident() does apply them.*/
+		bool is_deferred() const;
+		/**
+		 * Sets the rate samples loaded using load() with
+		 * @a bAllowStreaming set are resampled to. Zero, the
+		 * default, disables the resampling.
+		 *
+		 * It is called by the audio engine with the rate of the
+		 * audio driver according to
+		 * Preferences::m_bResampleSamples.
 		 */
-		bool load();
+		static void set_resample_rate( int nSampleRate );
+		/**
+		 * Sets the level below which the head and the tail of
+		 * samples are considered silent by detect_silence(). Zero,
+		 * the default, disables the detection.
+		 *
+		 * It is called by the Sampler according to
+		 * Preferences::m_bTrimSampleSilence.
+		 */
+		static void set_silence_threshold( float fThreshold );
+		/**
+		 * Determines get_audible_start() and get_audible_end() by
+		 * scanning the frames from either end.
+		 *
+		 * Called by load() and apply(). Code modifying the sample
+		 * using the individual apply_*() functions has to call it
+		 * again. The tail of a sample streamed from disk is not
+		 * known in advance and is never trimmed.
+		 */
+		void detect_silence();
+		/** \return First frame exceeding the silence threshold.
+			The Sampler skips blocks before it. Zero if unknown.*/
+		int get_audible_start() const;
+		/** \return Frame following the last one exceeding the
+			silence threshold. Voices end once they reach it.
+			get_frames() if unknown.*/
+		int get_audible_end() const;
+		/**
+		 * Converts the frames [@a nFirst, @a nFirst + @a nFrames) of
+		 * a sample stored compactly to float or applies the loops
+		 * and envelopes of a deferred one (see is_deferred()).
+		 *
+		 * Neither allocates memory nor locks and may thus be used
+		 * by the Sampler.
+		 *
+		 * \param nFirst First frame to read. Has to be valid.
+		 * \param nFrames Number of frames to read. Must not exceed
+		 * the end of the sample.
+		 * \param pOut_L Receives the left channel.
+		 * \param pOut_R Receives the right channel.
+		 */
+		void read_frames( int nFirst, int nFrames, float* pOut_L, float* pOut_R ) const;
 		/**
 		 * Flush the current content of the left and right
 		 * channel and the current metadata.
@@ -241,6 +402,11 @@ class Sample : public H2Core::Object
 		void apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan );
 		/**
 		 * apply loop transformation to the sample
+		 *
+		 * The loops are not expanded but stored along the
+		 * unlooped frames (see is_deferred()), so the memory used
+		 * does not grow with the number of repetitions.
+		 *
 		 * \param lo loops parameters
 		 */
 		bool apply_loops( const Loops& lo );
@@ -257,13 +423,23 @@ class Sample : public H2Core::Object
 		/**
 		 * apply rubberband transformation to the sample
 		 * \param rb rubberband parameters
+		 * \param fBpm tempo the sample is stretched to
 		 */
-		void apply_rubberband( const Rubberband& rb );
+		void apply_rubberband( const Rubberband& rb, float fBpm );
 		/**
 		 * call rubberband cli to modify the sample
 		 * \param rb rubberband parameters
+		 * \param fBpm tempo the sample is stretched to
 		 */
-		bool exec_rubberband_cli( const Rubberband& rb );
+		bool exec_rubberband_cli( const Rubberband& rb, float fBpm );
+		/**
+		 * Exchanges the audio data, its length, and the
+		 * rubberband parameters with the ones of @a pOther.
+		 *
+		 * Does neither allocate nor free memory. The previous
+		 * data is released along with @a pOther.
+		 */
+		void swap_data( std::shared_ptr<Sample> pOther );
 
 		/** \return true if both data channels are null pointers */
 		bool is_empty() const;
@@ -290,7 +466,8 @@ class Sample : public H2Core::Object
 		double get_sample_duration( ) const;
 	
 		/** \return data size, which is calculated by
-		 * #__frames time sizeof( float ) * 2 
+		 * #__frames time sizeof( float ) * 2 or the size of the
+		 * compact storage respectively
 		 */
 		int get_size() const;
 		/** \return #__data_l*/
@@ -312,6 +489,36 @@ class Sample : public H2Core::Object
 		Loops get_loops() const;
 		/** \return #__rubberband parameters */
 		Rubberband get_rubberband() const;
+		/** \param rb Sets #__rubberband without applying it.*/
+		void set_rubberband( const Rubberband& rb );
+		/** \return Pyramid of minima and maxima shared by all wave
+			displays of the sample or nullptr if it was not built
+			yet. See SamplePeakBuilder.*/
+		std::shared_ptr<const SamplePeaks> get_peaks() const;
+		/**
+		 * Attaches @a pPeaks unless the data did change since
+		 * get_peaks_generation() returned @a nGeneration.
+		 *
+		 * \return false if @a pPeaks is outdated and was dropped.
+		 */
+		bool set_peaks( std::shared_ptr<const SamplePeaks> pPeaks, int nGeneration );
+		/** \return Counter increased whenever the data changes and
+			the attached SamplePeaks are dropped.*/
+		int get_peaks_generation() const;
+		/**
+		 * \return Statistics of the sample taken from the attached
+		 * SamplePeaks with frames counted at the current sample
+		 * rate. SampleAnalysis::bValid is false if no peaks are
+		 * attached yet. Does not scan the data.
+		 */
+		SampleAnalysis get_analysis() const;
+		/**
+		 * Marks the sample as being used by the Sampler. Neither
+		 * blocks nor allocates. SampleMemory::enforce_budget()
+		 * does drop the data of the samples not used for the
+		 * longest time first.
+		 */
+		void mark_used();
 		/**
 		 * parse the given string and rturn the corresponding loop_mode
 		 * \param string the loop mode text to be parsed
@@ -329,36 +536,151 @@ class Sample : public H2Core::Object
 		 * \return String presentation of current object.*/
 		QString toQString( const QString& sPrefix, bool bShort = true ) const override;
 	private:
+		/** Keys the shared samples by their storage settings.*/
+		friend class SamplePool;
+		/** Locks and pre-touches the data.*/
+		friend class SampleMemory;
+
 		QString				__filepath;          ///< filepath of the sample
 		int					__frames;            ///< number of frames in this sample
 		int					__sample_rate;       ///< samplerate for this sample
 		float*				__data_l;            ///< left channel data
 		float*				__data_r;            ///< right channel data
+		/** number of frames in #__data_l and #__data_r if
+			#__is_streamed is true*/
+		int					__resident_frames;
+		bool				__is_streamed;       ///< true if only the head of the sample is loaded
+		int16_t*			__compact_l;         ///< left channel data if #__is_compact is true
+		int16_t*			__compact_r;         ///< right channel data, equal to #__compact_l for mono samples
+		bool				__is_compact;        ///< true if the sample is stored in #__compact_l and #__compact_r
 		bool				__is_modified;       ///< true if sample is modified
+		bool				__is_looped;         ///< true if #__loops are applied by read_frames()
+		int					__source_frames;     ///< number of unlooped frames in #__data_l and #__data_r of a looped sample
+		/** Linear section of an envelope. The gain at frame @a z
+			within [nStart, nEnd) is fGain - ( z - nStart ) * fStep.*/
+		struct EnvelopeSegment {
+			int nStart;
+			int nEnd;
+			float fGain;
+			float fStep;
+		};
+		/** sections of #__velocity_envelope applied by read_frames()*/
+		std::vector<EnvelopeSegment> __velocity_gains;
+		/** sections of #__pan_envelope applied by read_frames()*/
+		std::vector<EnvelopeSegment> __pan_gains;
 		PanEnvelope			__pan_envelope;      ///< pan envelope vector
 		VelocityEnvelope	__velocity_envelope; ///< velocity envelope vector
 		Loops				__loops;             ///< set of loop parameters
 		Rubberband			__rubberband;        ///< set of rubberband parameters
 		/** loop modes string */
 		static const std::vector<QString> __loop_modes;
+		/** number of frames kept in memory of streamed samples*/
+		static int __stream_preload;
+		/** whether samples allowed to be streamed may be stored
+			compactly*/
+		static bool __compact_storage;
+		/** number of frames kept in float of samples stored in a
+			SamplePack, or zero*/
+		static int __packed_preload;
+		/** see get_pack()*/
+		std::shared_ptr<const SamplePack> __pack;
+		/** rate samples allowed to be streamed are resampled to, or
+			zero*/
+		static int __resample_rate;
+		/** region of the SampleCache holding #__data_l and
+			#__data_r. Empty if they are allocated on the heap.*/
+		SampleCache::Mapping __mapping;
+		/** whether the data was handed to SampleMemory::prepare()
+			and has to be released by free_data()*/
+		bool __memory_prepared;
+		/** see get_peaks()*/
+		std::shared_ptr<const SamplePeaks> __peaks;
+		/** see get_peaks_generation()*/
+		int __peaks_generation;
+		/** see get_audible_start()*/
+		int __audible_start;
+		/** see get_audible_end(), -1 if unknown*/
+		int __audible_end;
+		/** level below which frames are considered silent, zero if
+			disabled*/
+		static float __silence_threshold;
+		/** value of #__use_epoch at the last call to mark_used()*/
+		std::atomic<unsigned> __last_used;
+		/** advanced by each SampleMemory::enforce_budget()*/
+		static std::atomic<unsigned> __use_epoch;
+		/** Protects #__peaks and #__peaks_generation, which are
+			accessed by the SamplePeakBuilder worker too.*/
+		mutable std::mutex __peaks_mutex;
+
+		/** release #__data_l and #__data_r */
+		void free_data();
+		/** Drops #__peaks and the results of detect_silence()
+			after the data did change.*/
+		void invalidate_peaks();
+		/**
+		 * Maps frame @a nFrame of a looped sample to the unlooped
+		 * data.
+		 *
+		 * \param nFrame Frame within [0, #__frames).
+		 * \param pStep Set to the direction (1 or -1) the
+		 * following frames are read in.
+		 * \param pLength Set to the number of frames, @a nFrame
+		 * included, which can be read in this direction.
+		 * \return Frame within #__data_l and #__data_r.
+		 */
+		int map_looped_frame( int nFrame, int* pStep, int* pLength ) const;
+		/** Multiplies the frames [@a nFirst, @a nFirst + @a nFrames)
+			read into @a pOut_L and @a pOut_R with the envelopes.*/
+		void apply_envelope_gains( int nFirst, int nFrames, float* pOut_L, float* pOut_R ) const;
+		/** Writes the frames of a deferred sample, loops and
+			envelopes applied, into a buffer of its own.*/
+		void expand();
+		/** Reads the content of an opened file encoded with at
+			most 16 bit into #__compact_l and #__compact_r.*/
+		bool load_compact( SNDFILE* file, const SF_INFO& sound_info );
+		/** Reads the content of an opened file encoded with at
+			most 16 bit into #__pack and its head into #__data_l
+			and #__data_r.*/
+		bool load_packed( SNDFILE* file, const SF_INFO& sound_info );
+		/** Implements load(bool bAllowStreaming). Samples longer
+			than @a nStreamPreload frames are streamed if it is
+			positive.*/
+		bool load_file( bool bAllowStreaming, int nStreamPreload );
+		/** Maps the entry of #__filepath in the SampleCache.
+			\param nResampledRate Passed to SampleCache::load().*/
+		bool load_cached( int nResampledRate );
+		/** Converts #__data_l and #__data_r to @a nSampleRate
+			using a polyphase windowed sinc filter.
+			\param bStore Whether to store the result in the
+			SampleCache.*/
+		void resample( int nSampleRate, bool bStore );
 };
 
 // DEFINITIONS
 
-inline void Sample::unload()
+inline int Sample::get_audible_start() const
 {
-	if ( __data_l != nullptr ) {
-		delete [] __data_l;
-	}
-	
-	if ( __data_r != nullptr ) {
-		delete [] __data_r;
+	return __audible_start;
+}
+
+inline int Sample::get_audible_end() const
+{
+	if ( __audible_end < 0 || __audible_end > __frames ) {
+		return __frames;
 	}
+	return __audible_end;
+}
+
+inline void Sample::unload()
+{
+	free_data();
 	__frames = __sample_rate = 0;
+	__resident_frames = 0;
+	__is_streamed = false;
+	__is_compact = false;
+	__is_looped = false;
 	/** #__is_modified = false; leave this unchanged as pan,
 	    velocity, loop and rubberband are kept unchanged */
-
-	__data_l = __data_r = nullptr;
 }
 
 inline bool Sample::is_empty() const
@@ -403,9 +725,63 @@ inline double Sample::get_sample_duration() const
 
 inline int Sample::get_size() const
 {
+	if ( __is_looped ) {
+		return __source_frames * sizeof( float ) * 2;
+	}
+	if ( __is_compact ) {
+		return __frames * sizeof( int16_t ) * ( __compact_l == __compact_r ? 1 : 2 );
+	}
 	return __frames * sizeof( float ) * 2;
 }
 
+inline bool Sample::is_streamed() const
+{
+	return __is_streamed;
+}
+
+inline int Sample::get_resident_frames() const
+{
+	if ( __is_compact || is_deferred() ) {
+		return 0;
+	}
+	return __is_streamed ? __resident_frames : __frames;
+}
+
+inline void Sample::set_stream_preload( int nFrames )
+{
+	__stream_preload = nFrames;
+}
+
+inline bool Sample::is_compact() const
+{
+	return __is_compact;
+}
+
+inline bool Sample::is_deferred() const
+{
+	return __is_looped || ! __velocity_gains.empty() || ! __pan_gains.empty();
+}
+
+inline void Sample::set_compact_storage( bool bEnabled )
+{
+	__compact_storage = bEnabled;
+}
+
+inline void Sample::set_packed_storage( int nResidentFrames )
+{
+	__packed_preload = nResidentFrames > 0 ? nResidentFrames : 0;
+}
+
+inline std::shared_ptr<const SamplePack> Sample::get_pack() const
+{
+	return __pack;
+}
+
+inline void Sample::set_resample_rate( int nSampleRate )
+{
+	__resample_rate = nSampleRate;
+}
+
 inline float* Sample::get_data_l() const
 {
 	return __data_l;
@@ -451,6 +827,17 @@ inline Sample::Rubberband Sample::get_rubberband() const
 	return __rubberband;
 }
 
+inline void Sample::set_rubberband( const Rubberband& rb )
+{
+	__rubberband = rb;
+}
+
+inline void Sample::mark_used()
+{
+	__last_used.store( __use_epoch.load( std::memory_order_relaxed ),
+					   std::memory_order_relaxed );
+}
+
 };
 
 #endif // H2C_SAMPLE_H
@@ -0,0 +1,263 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SampleArena.h>
+
+#include <core/Preferences.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace H2Core
+{
+
+const char* SampleArena::__class_name = "SampleArena";
+
+std::mutex SampleArena::m_mutex;
+std::map<uintptr_t, SampleArena::Region> SampleArena::m_regions;
+std::map<QString, SampleArena::Directory> SampleArena::m_directories;
+std::unordered_map<uintptr_t, size_t> SampleArena::m_buffers;
+bool SampleArena::m_bHugeTlbFailed = false;
+
+#ifndef WIN32
+/** \return Size of a memory page in bytes.*/
+static size_t pageSize()
+{
+	static const size_t nPageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+	return nPageSize;
+}
+
+/** Rounds @a nValue up to a multiple of @a nAlignment, which has to
+	be a power of two.*/
+static size_t alignUp( size_t nValue, size_t nAlignment )
+{
+	return ( nValue + nAlignment - 1 ) & ~( nAlignment - 1 );
+}
+#endif
+
+float* SampleArena::allocate( size_t nFrames, const QString& sFilepath )
+{
+#ifndef WIN32
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref != nullptr &&
+		 pPref->m_sampleArenaPages != Preferences::SampleArenaPages::heap ) {
+		float* pData = allocate_in_region(
+			std::max<size_t>( nFrames, 1 ) * sizeof( float ),
+			sFilepath.left( sFilepath.lastIndexOf( '/' ) ),
+			pPref->m_bLockSampleMemory,
+			pPref->m_sampleArenaPages == Preferences::SampleArenaPages::hugeTlb );
+		if ( pData != nullptr ) {
+			return pData;
+		}
+	}
+#endif
+	return new float[ nFrames ];
+}
+
+void SampleArena::deallocate( float* pData )
+{
+	if ( pData == nullptr ) {
+		return;
+	}
+
+#ifndef WIN32
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		const uintptr_t nAddress = reinterpret_cast<uintptr_t>( pData );
+		auto it = m_regions.upper_bound( nAddress );
+		if ( it != m_regions.begin() ) {
+			--it;
+			Region& region = it->second;
+			if ( nAddress < it->first + region.nSize ) {
+				auto buffer = m_buffers.find( nAddress );
+				size_t nBytes = buffer != m_buffers.end() ? buffer->second : 0;
+				if ( buffer != m_buffers.end() ) {
+					m_buffers.erase( buffer );
+				}
+
+				if ( --region.nBuffers <= 0 ) {
+					unmap_region( &region );
+					m_regions.erase( it );
+				} else if ( ! region.bHugeTlb ) {
+					// Buffers are never reused within a region. The
+					// pages covered by this one alone are given back
+					// right away.
+					uintptr_t nStart = alignUp( nAddress, pageSize() );
+					uintptr_t nEnd = ( nAddress + nBytes ) & ~( pageSize() - 1 );
+					if ( nEnd > nStart ) {
+						madvise( reinterpret_cast<void*>( nStart ), nEnd - nStart, MADV_DONTNEED );
+					}
+				}
+				return;
+			}
+		}
+	}
+#endif
+	delete[] pData;
+}
+
+SampleArena::Stats SampleArena::get_stats()
+{
+	Stats stats;
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for ( const auto& it : m_regions ) {
+		++stats.nRegions;
+		if ( it.second.bHugeTlb ) {
+			++stats.nHugeTlbRegions;
+		}
+		stats.nMappedBytes += it.second.nSize;
+	}
+	for ( const auto& it : m_buffers ) {
+		stats.nUsedBytes += it.second;
+	}
+	return stats;
+}
+
+float* SampleArena::allocate_in_region( size_t nBytes, const QString& sDirectory,
+										bool bPageAligned, bool bHugeTlb )
+{
+#ifndef WIN32
+	const size_t nBufferAlignment = bPageAligned ? std::max( pageSize(), nAlignment ) : nAlignment;
+	nBytes = alignUp( nBytes, nBufferAlignment );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	Directory& directory = m_directories[ sDirectory ];
+	Region* pRegion = directory.pOpen;
+	if ( pRegion == nullptr ||
+		 alignUp( pRegion->nUsed, nBufferAlignment ) + nBytes > pRegion->nSize ) {
+		if ( nBytes > nMaxRegionSize / 4 ) {
+			// Long samples get a region of their own to not waste
+			// the remainder of the open one.
+			pRegion = map_region( alignUp( nBytes, nHugePageSize ), sDirectory, bHugeTlb );
+		} else {
+			size_t nSize = nMinRegionSize << std::min( directory.nRegions, 4 );
+			pRegion = map_region( std::min( nSize, nMaxRegionSize ), sDirectory, bHugeTlb );
+			if ( pRegion != nullptr ) {
+				directory.pOpen = pRegion;
+			}
+		}
+		if ( pRegion == nullptr ) {
+			if ( directory.nRegions == 0 ) {
+				m_directories.erase( sDirectory );
+			}
+			return nullptr;
+		}
+		++directory.nRegions;
+	}
+
+	size_t nOffset = alignUp( pRegion->nUsed, nBufferAlignment );
+	pRegion->nUsed = nOffset + nBytes;
+	++pRegion->nBuffers;
+	char* pData = pRegion->pStart + nOffset;
+	m_buffers[ reinterpret_cast<uintptr_t>( pData ) ] = nBytes;
+	return reinterpret_cast<float*>( pData );
+#else
+	return nullptr;
+#endif
+}
+
+SampleArena::Region* SampleArena::map_region( size_t nSize, const QString& sDirectory,
+											  bool bHugeTlb )
+{
+#ifndef WIN32
+	char* pStart = nullptr;
+	bool bMappedHugeTlb = false;
+
+#ifdef MAP_HUGETLB
+	if ( bHugeTlb ) {
+		void* pMapped = mmap( nullptr, nSize, PROT_READ | PROT_WRITE,
+							  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if ( pMapped != MAP_FAILED ) {
+			pStart = static_cast<char*>( pMapped );
+			bMappedHugeTlb = true;
+		} else if ( ! m_bHugeTlbFailed ) {
+			_WARNINGLOG( QString( "Unable to map huge pages for sample data: %1. Using transparent huge pages instead" )
+						 .arg( strerror( errno ) ) );
+			m_bHugeTlbFailed = true;
+		}
+	}
+#endif
+
+	if ( pStart == nullptr ) {
+		// Transparent huge pages are only used for the parts of a
+		// mapping aligned to their size. One extra page is mapped
+		// and the surplus around the aligned span unmapped again.
+		size_t nMapped = nSize + nHugePageSize;
+		void* pMapped = mmap( nullptr, nMapped, PROT_READ | PROT_WRITE,
+							  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( pMapped == MAP_FAILED ) {
+			_ERRORLOG( QString( "Unable to map %1 bytes for sample data: %2" )
+					   .arg( nMapped ).arg( strerror( errno ) ) );
+			return nullptr;
+		}
+		uintptr_t nMappedStart = reinterpret_cast<uintptr_t>( pMapped );
+		uintptr_t nStart = alignUp( nMappedStart, nHugePageSize );
+		if ( nStart > nMappedStart ) {
+			munmap( pMapped, nStart - nMappedStart );
+		}
+		size_t nTail = nMappedStart + nMapped - ( nStart + nSize );
+		if ( nTail > 0 ) {
+			munmap( reinterpret_cast<void*>( nStart + nSize ), nTail );
+		}
+		pStart = reinterpret_cast<char*>( nStart );
+#ifdef MADV_HUGEPAGE
+		madvise( pStart, nSize, MADV_HUGEPAGE );
+#endif
+	}
+
+	Region region;
+	region.pStart = pStart;
+	region.nSize = nSize;
+	region.nUsed = 0;
+	region.nBuffers = 0;
+	region.bHugeTlb = bMappedHugeTlb;
+	region.sDirectory = sDirectory;
+	return &( m_regions[ reinterpret_cast<uintptr_t>( pStart ) ] = region );
+#else
+	return nullptr;
+#endif
+}
+
+void SampleArena::unmap_region( Region* pRegion )
+{
+#ifndef WIN32
+	auto it = m_directories.find( pRegion->sDirectory );
+	if ( it != m_directories.end() ) {
+		if ( it->second.pOpen == pRegion ) {
+			it->second.pOpen = nullptr;
+		}
+		if ( --it->second.nRegions <= 0 ) {
+			m_directories.erase( it );
+		}
+	}
+	munmap( pRegion->pStart, pRegion->nSize );
+#endif
+}
+
+};
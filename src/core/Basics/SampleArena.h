@@ -0,0 +1,141 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_ARENA_H
+#define H2C_SAMPLE_ARENA_H
+
+#include <core/Object.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace H2Core
+{
+
+/**
+ * Allocates the data of samples from large memory regions.
+ *
+ * Allocating each channel of each sample on the heap scatters the
+ * data of a drumkit across the whole address space. Voices reading
+ * from many samples at once then miss the TLB frequently, and the
+ * heap fragments as kits are loaded and unloaded.
+ *
+ * The arena maps regions of several MB instead. They are backed by
+ * transparent huge pages or, if available, by huge pages reserved via
+ * MAP_HUGETLB, see Preferences::m_sampleArenaPages. All samples in
+ * the same directory - usually the ones of a drumkit - share their
+ * regions. A region is unmapped as soon as none of its buffers is
+ * used anymore, so switching drumkits returns the memory of the
+ * previous kit to the system as a whole. The pages of buffers
+ * released earlier are returned right away.
+ *
+ * Buffers are aligned to a cache line, or to a page if
+ * Preferences::m_bLockSampleMemory is set. This way the page
+ * granular locks of SampleMemory are not shared by several samples.
+ *
+ * On Windows and with SampleArenaPages::heap all buffers are
+ * allocated on the heap.
+ */
+class SampleArena : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Usage as reported by get_stats().*/
+		struct Stats {
+			int nRegions = 0;
+			/** Regions backed by MAP_HUGETLB.*/
+			int nHugeTlbRegions = 0;
+			/** Size of all regions in bytes.*/
+			size_t nMappedBytes = 0;
+			/** Size of the buffers in use in bytes.*/
+			size_t nUsedBytes = 0;
+		};
+
+		/** Alignment of all buffers in bytes.*/
+		static constexpr size_t nAlignment = 64;
+		/** Size of a huge page in bytes. Regions are multiples of
+			it and aligned to it.*/
+		static constexpr size_t nHugePageSize = 2 * 1024 * 1024;
+		/** Size of the first region of a directory. Each further one
+			is twice as large up to #nMaxRegionSize.*/
+		static constexpr size_t nMinRegionSize = 2 * nHugePageSize;
+		static constexpr size_t nMaxRegionSize = 32 * nHugePageSize;
+
+		/**
+		 * \param nFrames Number of floats to allocate.
+		 * \param sFilepath File of the sample the buffer belongs to.
+		 *
+		 * \return Buffer to be released using deallocate(). Never
+		 *   nullptr.
+		 */
+		static float* allocate( size_t nFrames, const QString& sFilepath );
+		/** Releases @a pData. Buffers not allocated by allocate() are
+			deleted using delete[].*/
+		static void deallocate( float* pData );
+
+		static Stats get_stats();
+
+	private:
+		struct Region {
+			char* pStart;
+			size_t nSize;
+			/** Offset of the first byte not handed out yet.*/
+			size_t nUsed;
+			/** Number of buffers in use.*/
+			int nBuffers;
+			bool bHugeTlb;
+			QString sDirectory;
+		};
+		/** Bookkeeping of all regions of a directory.*/
+		struct Directory {
+			/** Region new buffers are taken from or nullptr.*/
+			Region* pOpen = nullptr;
+			int nRegions = 0;
+		};
+
+		/** Allocates a buffer of @a nBytes in a region of
+			@a sDirectory. \return nullptr on failure.*/
+		static float* allocate_in_region( size_t nBytes, const QString& sDirectory,
+										  bool bPageAligned, bool bHugeTlb );
+		/** Maps a new region of @a nSize bytes.*/
+		static Region* map_region( size_t nSize, const QString& sDirectory, bool bHugeTlb );
+		static void unmap_region( Region* pRegion );
+
+		/** Protects all members below.*/
+		static std::mutex m_mutex;
+		/** Regions indexed by their first byte.*/
+		static std::map<uintptr_t, Region> m_regions;
+		static std::map<QString, Directory> m_directories;
+		/** Sizes of all buffers in use indexed by their address.*/
+		static std::unordered_map<uintptr_t, size_t> m_buffers;
+		/** Whether mapping huge pages via MAP_HUGETLB did fail once.
+			Used to log only the first failure.*/
+		static bool m_bHugeTlbFailed;
+};
+
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SampleCache.h>
+#include <core/Helpers/Filesystem.h>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#include <cstdint>
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace H2Core
+{
+
+const char* SampleCache::__class_name = "SampleCache";
+
+/** Layout of the beginning of a cache file. It is followed by the
+	path of the original file, padding up to the next multiple of
+	#nDataAlignment, and the frames of the left and the right
+	channel.*/
+struct CacheHeader {
+	char sMagic[ 4 ];
+	uint32_t nVersion;
+	/** Modification time of the original file in ms since epoch.*/
+	int64_t nModified;
+	/** Size of the original file in bytes.*/
+	int64_t nSize;
+	int32_t nFrames;
+	int32_t nSampleRate;
+	/** Length of the UTF-8 encoded path of the original file.*/
+	int32_t nPathLength;
+	int32_t nReserved;
+};
+
+static const char sCacheMagic[ 4 ] = { 'H', '2', 'S', 'C' };
+/** Has to be increased whenever the layout or the decoding does
+	change.*/
+static const uint32_t nCacheVersion = 1;
+static const size_t nDataAlignment = 16;
+
+static size_t dataOffset( size_t nPathLength )
+{
+	size_t nOffset = sizeof( CacheHeader ) + nPathLength;
+	return ( nOffset + nDataAlignment - 1 ) / nDataAlignment * nDataAlignment;
+}
+
+QString SampleCache::cache_path( const QString& sFilepath, int nResampledRate )
+{
+	QString sKey = sFilepath;
+	if ( nResampledRate > 0 ) {
+		sKey += QString( "@%1" ).arg( nResampledRate );
+	}
+	QByteArray hash = QCryptographicHash::hash( sKey.toUtf8(),
+												QCryptographicHash::Sha1 );
+	return Filesystem::samples_cache_dir() + QString( hash.toHex() ) + ".h2sc";
+}
+
+bool SampleCache::load( const QString& sFilepath, int* pFrames, int* pSampleRate,
+						float** ppData_L, float** ppData_R, Mapping* pMapping,
+						int nResampledRate )
+{
+#ifdef WIN32
+	return false;
+#else
+	QFileInfo fileInfo( sFilepath );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+	QByteArray path = sAbsolutePath.toUtf8();
+
+	int fd = ::open( cache_path( sAbsolutePath, nResampledRate ).toLocal8Bit(), O_RDONLY );
+	if ( fd < 0 ) {
+		// Not cached yet.
+		return false;
+	}
+
+	struct stat cacheStat;
+	if ( fstat( fd, &cacheStat ) != 0 ||
+		 static_cast<size_t>( cacheStat.st_size ) < dataOffset( path.size() ) ) {
+		::close( fd );
+		return false;
+	}
+	size_t nSize = cacheStat.st_size;
+
+	int nFlags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	// Fault the pages in right away, so the audio thread won't have
+	// to later on.
+	nFlags |= MAP_POPULATE;
+#endif
+	void* pAddress = mmap( nullptr, nSize, PROT_READ | PROT_WRITE, nFlags, fd, 0 );
+	::close( fd );
+	if ( pAddress == MAP_FAILED ) {
+		WARNINGLOG( QString( "Unable to map cache of %1" ).arg( sAbsolutePath ) );
+		return false;
+	}
+
+	const CacheHeader* pHeader = static_cast<const CacheHeader*>( pAddress );
+	const char* pPath = static_cast<const char*>( pAddress ) + sizeof( CacheHeader );
+	size_t nOffset = dataOffset( path.size() );
+	bool bValid =
+		memcmp( pHeader->sMagic, sCacheMagic, sizeof( sCacheMagic ) ) == 0 &&
+		pHeader->nVersion == nCacheVersion &&
+		pHeader->nModified == fileInfo.lastModified().toMSecsSinceEpoch() &&
+		pHeader->nSize == fileInfo.size() &&
+		pHeader->nFrames >= 0 &&
+		pHeader->nPathLength == path.size() &&
+		memcmp( pPath, path.constData(), path.size() ) == 0 &&
+		( nResampledRate <= 0 || pHeader->nSampleRate == nResampledRate ) &&
+		nSize == nOffset + 2 * static_cast<size_t>( pHeader->nFrames ) * sizeof( float );
+	if ( ! bValid ) {
+		// Outdated. It will be replaced by the caller.
+		munmap( pAddress, nSize );
+		return false;
+	}
+
+	float* pData = reinterpret_cast<float*>( static_cast<char*>( pAddress ) + nOffset );
+	*pFrames = pHeader->nFrames;
+	*pSampleRate = pHeader->nSampleRate;
+	*ppData_L = pData;
+	*ppData_R = pData + pHeader->nFrames;
+	pMapping->pAddress = pAddress;
+	pMapping->nSize = nSize;
+
+	return true;
+#endif
+}
+
+void SampleCache::store( const QString& sFilepath, int nFrames, int nSampleRate,
+						 const float* pData_L, const float* pData_R,
+						 int nResampledRate )
+{
+#ifndef WIN32
+	if ( ! QDir( Filesystem::samples_cache_dir() ).exists() ) {
+		return;
+	}
+
+	QFileInfo fileInfo( sFilepath );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+	QByteArray path = sAbsolutePath.toUtf8();
+
+	CacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.sMagic, sCacheMagic, sizeof( sCacheMagic ) );
+	header.nVersion = nCacheVersion;
+	header.nModified = fileInfo.lastModified().toMSecsSinceEpoch();
+	header.nSize = fileInfo.size();
+	header.nFrames = nFrames;
+	header.nSampleRate = nSampleRate;
+	header.nPathLength = path.size();
+
+	QByteArray padding( dataOffset( path.size() ) - sizeof( header ) - path.size(), '\0' );
+	qint64 nDataSize = static_cast<qint64>( nFrames ) * sizeof( float );
+
+	// Written to a temporary file first, and renamed on commit(), so
+	// other instances do never map an incomplete entry.
+	QSaveFile file( cache_path( sAbsolutePath, nResampledRate ) );
+	if ( ! file.open( QIODevice::WriteOnly ) ||
+		 file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) != sizeof( header ) ||
+		 file.write( path ) != path.size() ||
+		 file.write( padding ) != padding.size() ||
+		 file.write( reinterpret_cast<const char*>( pData_L ), nDataSize ) != nDataSize ||
+		 file.write( reinterpret_cast<const char*>( pData_R ), nDataSize ) != nDataSize ||
+		 ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to cache %1: %2" )
+					.arg( sAbsolutePath ).arg( file.errorString() ) );
+	}
+#endif
+}
+
+void SampleCache::release( const Mapping& mapping )
+{
+#ifndef WIN32
+	if ( mapping.pAddress != nullptr ) {
+		munmap( mapping.pAddress, mapping.nSize );
+	}
+#endif
+}
+
+};
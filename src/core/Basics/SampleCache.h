@@ -0,0 +1,103 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_CACHE_H
+#define H2C_SAMPLE_CACHE_H
+
+#include <core/Object.h>
+
+#include <cstddef>
+
+namespace H2Core
+{
+
+/**
+ * On-disk cache of decoded samples.
+ *
+ * Each file loaded by Sample::load() is stored as deinterleaved 32 bit
+ * float data in Filesystem::samples_cache_dir(), keyed by its absolute
+ * path and validated against its size and modification time. Loading
+ * the same file again does map the cache file into memory instead of
+ * decoding it with libsndfile. This makes switching between drumkits
+ * already seen before nearly instant and, since the mapping is private
+ * but backed by the page cache, several Hydrogen instances on the same
+ * host share the memory of unmodified samples.
+ *
+ * Modifications applied to the data of a mapped sample (loops,
+ * envelopes, Rubber Band) are copy-on-write and never reach the cache
+ * file.
+ *
+ * Not available on Windows, where load() does always fail and store()
+ * does nothing.
+ */
+class SampleCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Region of a cache file mapped into memory.*/
+		struct Mapping {
+			void* pAddress = nullptr;
+			size_t nSize = 0;
+		};
+
+		/**
+		 * Maps the cached data of @a sFilepath into memory.
+		 *
+		 * \param sFilepath Path of the original sample file.
+		 * \param pFrames Set to the number of frames.
+		 * \param pSampleRate Set to the sample rate.
+		 * \param ppData_L Set to the left channel within @a pMapping.
+		 * \param ppData_R Set to the right channel within @a pMapping.
+		 * \param pMapping Has to be handed to release() once the data
+		 * is not used anymore.
+		 * \param nResampledRate If larger than zero, the entry of the
+		 * data resampled to this rate is looked up instead of the
+		 * decoded one.
+		 *
+		 * \return false if there is no valid cache entry.
+		 */
+		static bool load( const QString& sFilepath, int* pFrames, int* pSampleRate,
+						  float** ppData_L, float** ppData_R, Mapping* pMapping,
+						  int nResampledRate = 0 );
+		/**
+		 * Stores the decoded data of @a sFilepath. An existing entry
+		 * is replaced atomically.
+		 *
+		 * \param nResampledRate If larger than zero, the data was
+		 * resampled to this rate and is stored alongside the
+		 * decoded one.
+		 */
+		static void store( const QString& sFilepath, int nFrames, int nSampleRate,
+						   const float* pData_L, const float* pData_R,
+						   int nResampledRate = 0 );
+		/** Unmaps a region returned by load().*/
+		static void release( const Mapping& mapping );
+
+	private:
+		/** \return Path of the cache file of @a sFilepath.*/
+		static QString cache_path( const QString& sFilepath, int nResampledRate );
+};
+
+};
+
+#endif
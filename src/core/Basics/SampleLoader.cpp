@@ -0,0 +1,243 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SampleLoader.h>
+
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/SampleMemory.h>
+#include <core/Basics/SamplePool.h>
+#include <core/EventQueue.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+namespace H2Core
+{
+
+const char* SampleLoader::__class_name = "SampleLoader";
+
+/** Upper limit of the threads used by SampleLoader::run(). Beyond,
+	the storage device rather than the decoding is the bottleneck.*/
+static const int nMaxLoaderThreads = 8;
+
+SampleLoader::SampleLoader()
+	: Object( __class_name )
+{
+}
+
+SampleLoader::~SampleLoader()
+{
+}
+
+int SampleLoader::add( std::shared_ptr<Sample> pSample, bool bShare )
+{
+	m_samples.push_back( pSample );
+	m_shared.push_back( bShare );
+	return m_samples.size() - 1;
+}
+
+void SampleLoader::add( const QString& sFilepath )
+{
+	m_pathIndices.insert( std::make_pair( sFilepath, add( std::make_shared<Sample>( sFilepath ), true ) ) );
+}
+
+void SampleLoader::add( Drumkit* pDrumkit )
+{
+	InstrumentList* pInstruments = pDrumkit->get_instruments();
+	for ( int nInstr = 0; nInstr < pInstruments->size(); ++nInstr ) {
+		for ( const auto& pComponent : *pInstruments->get( nInstr )->get_components() ) {
+			for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				if ( pLayer != nullptr && pLayer->get_sample() != nullptr ) {
+					add( pDrumkit->get_path() + "/" + pLayer->get_sample()->get_filename() );
+				}
+			}
+		}
+	}
+}
+
+void SampleLoader::add( InstrumentList* pInstruments )
+{
+	for ( int nInstr = 0; nInstr < pInstruments->size(); ++nInstr ) {
+		for ( const auto& pComponent : *pInstruments->get( nInstr )->get_components() ) {
+			for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				if ( pLayer != nullptr && pLayer->get_sample() != nullptr ) {
+					add( pLayer->get_sample() );
+				}
+			}
+		}
+	}
+}
+
+void SampleLoader::run( bool bAllowStreaming, bool bReportProgress )
+{
+	const int nTotal = m_samples.size();
+	m_loaded.assign( nTotal, 0 );
+	if ( nTotal == 0 ) {
+		return;
+	}
+
+	// Shareable samples already in the pool or queued more than once
+	// are not decoded again. The indices of the ones left are stored
+	// in tasks.
+	std::vector<QString> keys( nTotal );
+	std::vector<int> duplicates( nTotal, -1 );
+	std::map<QString, int> firstIndices;
+	std::vector<int> tasks;
+	int nShared = 0;
+	for ( int ii = 0; ii < nTotal; ++ii ) {
+		if ( m_shared[ ii ] ) {
+			keys[ ii ] = SamplePool::key( m_samples[ ii ]->get_filepath(), bAllowStreaming );
+			auto pPooled = SamplePool::get( keys[ ii ] );
+			if ( pPooled != nullptr ) {
+				m_samples[ ii ] = pPooled;
+				m_loaded[ ii ] = 1;
+				++nShared;
+				continue;
+			}
+			auto it = firstIndices.find( keys[ ii ] );
+			if ( it != firstIndices.end() ) {
+				duplicates[ ii ] = it->second;
+				++nShared;
+				continue;
+			}
+			firstIndices[ keys[ ii ] ] = ii;
+		}
+		tasks.push_back( ii );
+	}
+
+	const int nSamples = tasks.size();
+	std::atomic<int> nNext( 0 );
+	std::atomic<int> nDone( 0 );
+	auto loadNext = [&]() {
+		int nTask = nNext.fetch_add( 1, std::memory_order_relaxed );
+		if ( nTask >= nSamples ) {
+			return false;
+		}
+		// Each thread only writes its own elements.
+		int nIndex = tasks[ nTask ];
+		m_loaded[ nIndex ] = m_samples[ nIndex ]->load( bAllowStreaming );
+		nDone.fetch_add( 1, std::memory_order_release );
+		return true;
+	};
+
+	int nThreads = std::min( { static_cast<int>( std::thread::hardware_concurrency() ),
+							   nMaxLoaderThreads, nSamples } );
+	std::vector<std::thread> threads;
+	for ( int ii = 1; ii < nThreads; ++ii ) {
+		threads.push_back( std::thread( [&]() {
+			while ( loadNext() ) {}
+		} ) );
+	}
+
+	// The calling thread does decode too and is the only one
+	// pushing events, as the EventQueue is not prepared for
+	// concurrent producers.
+	EventQueue* pEventQueue = EventQueue::get_instance();
+	int nReported = -1;
+	for ( ;; ) {
+		bool bLoaded = loadNext();
+		int nProgress = nSamples == 0 ? 100 :
+			nDone.load( std::memory_order_acquire ) * 100 / nSamples;
+		if ( bReportProgress && nProgress != nReported ) {
+			pEventQueue->push_event( EVENT_SAMPLE_LOADING_PROGRESS, nProgress );
+			nReported = nProgress;
+		}
+		if ( nProgress == 100 ) {
+			break;
+		}
+		if ( ! bLoaded ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+		}
+	}
+
+	for ( auto& thread : threads ) {
+		thread.join();
+	}
+
+	for ( int nIndex : tasks ) {
+		if ( m_shared[ nIndex ] && m_loaded[ nIndex ] ) {
+			m_samples[ nIndex ] = SamplePool::insert( keys[ nIndex ], m_samples[ nIndex ] );
+		}
+	}
+	for ( int ii = 0; ii < nTotal; ++ii ) {
+		if ( duplicates[ ii ] >= 0 ) {
+			m_samples[ ii ] = m_samples[ duplicates[ ii ] ];
+			m_loaded[ ii ] = m_loaded[ duplicates[ ii ] ];
+		}
+	}
+
+	// Samples taken from the SamplePool were prepared when loaded
+	// first and are skipped.
+	for ( int ii = 0; ii < nTotal; ++ii ) {
+		if ( m_loaded[ ii ] ) {
+			SampleMemory::prepare( m_samples[ ii ].get() );
+		}
+	}
+	SampleMemory::enforce_budget();
+
+	INFOLOG( QString( "Loaded %1 samples using %2 threads, %3 shared" )
+			 .arg( nSamples ).arg( nThreads ).arg( nShared ) );
+}
+
+bool SampleLoader::is_loaded( int nIndex ) const
+{
+	if ( nIndex < 0 || nIndex >= static_cast<int>( m_loaded.size() ) ) {
+		return false;
+	}
+	return m_loaded[ nIndex ] != 0;
+}
+
+std::shared_ptr<Sample> SampleLoader::get( int nIndex ) const
+{
+	if ( nIndex < 0 || nIndex >= static_cast<int>( m_samples.size() ) ) {
+		return nullptr;
+	}
+	return m_samples[ nIndex ];
+}
+
+std::shared_ptr<Sample> SampleLoader::take( const QString& sFilepath )
+{
+	auto it = m_pathIndices.find( sFilepath );
+	if ( it == m_pathIndices.end() ) {
+		return nullptr;
+	}
+	int nIndex = it->second;
+	m_pathIndices.erase( it );
+
+	if ( ! is_loaded( nIndex ) ) {
+		return nullptr;
+	}
+	return m_samples[ nIndex ];
+}
+
+};
@@ -0,0 +1,135 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_LOADER_H
+#define H2C_SAMPLE_LOADER_H
+
+#include <core/Object.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace H2Core
+{
+
+class Drumkit;
+class InstrumentList;
+class Sample;
+
+/**
+ * Decodes a batch of samples concurrently.
+ *
+ * Samples are queued using add() and decoded by run() on up to one
+ * thread per CPU core, the calling one included. The calling thread
+ * does report the progress in percent via
+ * #H2Core::EVENT_SAMPLE_LOADING_PROGRESS unless asked otherwise.
+ *
+ * Samples added by path are created by the loader itself and handed
+ * to their layers using take() only after they were decoded
+ * completely. Samples added as objects are loaded in place and must
+ * not be rendered concurrently.
+ *
+ * Samples added by path or marked as shareable are looked up in the
+ * SamplePool first and registered in it once decoded. Identical files
+ * within the same batch are decoded only once.
+ */
+class SampleLoader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		SampleLoader();
+		~SampleLoader();
+
+		/**
+		 * Queues @a pSample to be loaded in place.
+		 *
+		 * \param pSample Sample to load.
+		 * \param bShare Whether run() may replace @a pSample by an
+		 * instance of the SamplePool. Only valid for samples not
+		 * referenced anywhere else yet. The caller has to retrieve
+		 * the result using get() in this case.
+		 *
+		 * \return Index to be passed to is_loaded() and get().
+		 */
+		int add( std::shared_ptr<Sample> pSample, bool bShare = false );
+		/** Queues a new Sample for @a sFilepath. It can be retrieved
+			using take() after run().*/
+		void add( const QString& sFilepath );
+		/** Queues the samples of all layers of @a pDrumkit by path,
+			as expected by Instrument::load_from().*/
+		void add( Drumkit* pDrumkit );
+		/** Queues the samples of all layers of @a pInstruments to
+			be loaded in place.*/
+		void add( InstrumentList* pInstruments );
+
+		/**
+		 * Decodes all queued samples and returns once all of them
+		 * are done. The data of the loaded ones is locked or
+		 * pre-touched by SampleMemory::prepare().
+		 *
+		 * \param bAllowStreaming Passed to Sample::load().
+		 * \param bReportProgress Whether to push
+		 * #H2Core::EVENT_SAMPLE_LOADING_PROGRESS. Has to be false
+		 * if the calling thread is not allowed to push events.
+		 */
+		void run( bool bAllowStreaming = true, bool bReportProgress = true );
+
+		/** \return Whether the sample @a nIndex was loaded
+			successfully by run().*/
+		bool is_loaded( int nIndex ) const;
+		/** \return Sample @a nIndex after run(). Differs from the one
+			passed to add() if it was shared.*/
+		std::shared_ptr<Sample> get( int nIndex ) const;
+		/**
+		 * Hands out a sample added for @a sFilepath and decoded by
+		 * run(). Each one is handed out only once.
+		 *
+		 * \return nullptr if there is none left or it could not be
+		 * loaded.
+		 */
+		std::shared_ptr<Sample> take( const QString& sFilepath );
+
+		/** \return Number of queued samples.*/
+		int size() const;
+
+	private:
+		std::vector<std::shared_ptr<Sample>> m_samples;
+		/** Whether the element at the same position in #m_samples
+			was loaded by run().*/
+		std::vector<char> m_loaded;
+		/** Whether the element at the same position in #m_samples
+			may be taken from the SamplePool.*/
+		std::vector<char> m_shared;
+		/** Indices in #m_samples of samples added by path and not
+			taken yet.*/
+		std::multimap<QString, int> m_pathIndices;
+};
+
+inline int SampleLoader::size() const {
+	return m_samples.size();
+}
+
+};
+
+#endif
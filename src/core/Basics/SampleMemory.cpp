@@ -0,0 +1,377 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SampleMemory.h>
+
+#include <core/Basics/Sample.h>
+#include <core/Basics/SampleArena.h>
+#include <core/Basics/SamplePack.h>
+#include <core/Preferences.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace H2Core
+{
+
+const char* SampleMemory::__class_name = "SampleMemory";
+
+std::mutex SampleMemory::m_mutex;
+std::map<const Sample*, SampleMemory::Entry> SampleMemory::m_entries;
+size_t SampleMemory::m_nLockedBytes = 0;
+bool SampleMemory::m_bLockFailed = false;
+int SampleMemory::m_nEvictions = 0;
+bool SampleMemory::m_bBudgetExceeded = false;
+
+/** \return Size of a memory page in bytes.*/
+static size_t pageSize()
+{
+#ifndef WIN32
+	static const size_t nPageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+	return nPageSize;
+#else
+	return 4096;
+#endif
+}
+
+/** Extends [@a pAddress, @a pAddress + @a nSize ) to page
+	boundaries.*/
+static void alignToPages( const void* pAddress, size_t nSize, void** ppStart, size_t* pLength )
+{
+	const uintptr_t nMask = pageSize() - 1;
+	uintptr_t nStart = reinterpret_cast<uintptr_t>( pAddress ) & ~nMask;
+	uintptr_t nEnd = ( reinterpret_cast<uintptr_t>( pAddress ) + nSize + nMask ) & ~nMask;
+	*ppStart = reinterpret_cast<void*>( nStart );
+	*pLength = nEnd - nStart;
+}
+
+void SampleMemory::prepare( Sample* pSample )
+{
+	if ( pSample == nullptr ) {
+		return;
+	}
+	std::vector<Region> sampleRegions = regions( pSample );
+	if ( sampleRegions.empty() ) {
+		return;
+	}
+
+	Entry entry;
+	entry.regions = sampleRegions;
+	for ( const auto& region : sampleRegions ) {
+		entry.nBytes += region.nSize;
+	}
+
+	Preferences* pPref = Preferences::get_instance();
+	bool bLock = pPref != nullptr && pPref->m_bLockSampleMemory;
+	size_t nLimit = pPref != nullptr ?
+		static_cast<size_t>( std::max( 0, pPref->m_nSampleMemoryLockLimit ) ) * 1024 * 1024 : 0;
+
+	// The budget is reserved up front as mlock() may take a while
+	// to fault in the pages, during which get_stats() should not be
+	// blocked.
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( pSample->__memory_prepared || m_entries.count( pSample ) > 0 ) {
+			return;
+		}
+		if ( bLock ) {
+			if ( ! m_bLockFailed && m_nLockedBytes + entry.nBytes <= nLimit ) {
+				m_nLockedBytes += entry.nBytes;
+				entry.bLocked = true;
+			} else {
+				entry.bFailed = true;
+			}
+		}
+	}
+
+	if ( entry.bLocked && ! lock_regions( sampleRegions ) ) {
+		int nError = errno;
+		entry.bLocked = false;
+		entry.bFailed = true;
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_nLockedBytes -= entry.nBytes;
+		if ( ! m_bLockFailed ) {
+			_WARNINGLOG( QString( "Unable to lock sample data into RAM: %1. Samples will be pre-touched only" )
+						 .arg( strerror( nError ) ) );
+			m_bLockFailed = true;
+		}
+	}
+	if ( ! entry.bLocked ) {
+		touch_regions( sampleRegions );
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_entries[ pSample ] = entry;
+	pSample->__memory_prepared = true;
+	// Freshly loaded samples are about to be played.
+	pSample->mark_used();
+}
+
+void SampleMemory::release( Sample* pSample )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	pSample->__memory_prepared = false;
+	auto it = m_entries.find( pSample );
+	if ( it == m_entries.end() ) {
+		return;
+	}
+	if ( it->second.bLocked ) {
+		unlock_regions( it->second.regions );
+		m_nLockedBytes -= it->second.nBytes;
+	}
+	m_entries.erase( it );
+}
+
+SampleMemory::Stats SampleMemory::get_stats()
+{
+	Stats stats;
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref != nullptr ) {
+		stats.nBudgetBytes =
+			static_cast<size_t>( std::max( 0, pPref->m_nSampleMemoryBudget ) ) * 1024 * 1024;
+	}
+	SampleArena::Stats arenaStats = SampleArena::get_stats();
+	stats.nArenaBytes = arenaStats.nMappedBytes;
+	stats.nArenaRegions = arenaStats.nRegions;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	stats.nEvictions = m_nEvictions;
+	for ( const auto& it : m_entries ) {
+		const Entry& entry = it.second;
+		++stats.nSamples;
+		stats.nBytes += entry.nBytes;
+		if ( entry.bLocked ) {
+			++stats.nLockedSamples;
+			stats.nLockedBytes += entry.nBytes;
+		}
+		if ( entry.bFailed ) {
+			++stats.nFailedSamples;
+		}
+		stats.nResidentBytes += resident_bytes( entry.regions );
+	}
+	return stats;
+}
+
+void SampleMemory::enforce_budget()
+{
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref == nullptr || pPref->m_nSampleMemoryBudget <= 0 ) {
+		return;
+	}
+	const size_t nBudget = static_cast<size_t>( pPref->m_nSampleMemoryBudget ) * 1024 * 1024;
+
+	// Samples marked from now on are more recent than all marked
+	// before.
+	Sample::__use_epoch.fetch_add( 1, std::memory_order_relaxed );
+
+	struct Candidate {
+		unsigned nLastUsed;
+		size_t nResident;
+		Entry* pEntry;
+		const Sample* pSample;
+	};
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	size_t nResident = 0;
+	std::vector<Candidate> candidates;
+	for ( auto& it : m_entries ) {
+		size_t nEntryResident = resident_bytes( it.second.regions );
+		nResident += nEntryResident;
+		if ( nEntryResident > 0 && is_evictable( it.first ) ) {
+			candidates.push_back( { it.first->__last_used.load( std::memory_order_relaxed ),
+									nEntryResident, &it.second, it.first } );
+		}
+	}
+	if ( nResident <= nBudget ) {
+		m_bBudgetExceeded = false;
+		return;
+	}
+
+	std::sort( candidates.begin(), candidates.end(),
+			   []( const Candidate& a, const Candidate& b ) {
+				   return a.nLastUsed < b.nLastUsed;
+			   } );
+
+#ifndef WIN32
+	for ( const auto& candidate : candidates ) {
+		if ( nResident <= nBudget ) {
+			break;
+		}
+		Entry* pEntry = candidate.pEntry;
+		if ( pEntry->bLocked ) {
+			unlock_regions( pEntry->regions );
+			m_nLockedBytes -= pEntry->nBytes;
+			pEntry->bLocked = false;
+		}
+		// Pages of a private file mapping not written to are read
+		// from the file again on the next access.
+		const SampleCache::Mapping& mapping = candidate.pSample->__mapping;
+		if ( madvise( mapping.pAddress, mapping.nSize, MADV_DONTNEED ) != 0 ) {
+			continue;
+		}
+		nResident -= std::min( nResident, candidate.nResident );
+		++m_nEvictions;
+	}
+#endif
+
+	if ( nResident > nBudget && ! m_bBudgetExceeded ) {
+		_WARNINGLOG( QString( "%1 MB of sample data resident in RAM exceed the budget of %2 MB. Only samples read from the cache can be dropped" )
+					 .arg( nResident / ( 1024 * 1024 ) ).arg( pPref->m_nSampleMemoryBudget ) );
+		m_bBudgetExceeded = true;
+	}
+}
+
+bool SampleMemory::is_evictable( const Sample* pSample )
+{
+	const SampleCache::Mapping& mapping = pSample->__mapping;
+	if ( mapping.pAddress == nullptr || pSample->__is_modified ) {
+		return false;
+	}
+	const char* pStart = static_cast<const char*>( mapping.pAddress );
+	for ( const auto& region : regions( pSample ) ) {
+		const char* pAddress = static_cast<const char*>( region.pAddress );
+		if ( pAddress < pStart || pAddress + region.nSize > pStart + mapping.nSize ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<SampleMemory::Region> SampleMemory::regions( const Sample* pSample )
+{
+	std::vector<Region> sampleRegions;
+	if ( pSample->__is_compact ) {
+		size_t nSize = static_cast<size_t>( pSample->__frames ) * sizeof( int16_t );
+		if ( pSample->__compact_l != nullptr ) {
+			sampleRegions.push_back( { pSample->__compact_l, nSize } );
+		}
+		if ( pSample->__compact_r != nullptr && pSample->__compact_r != pSample->__compact_l ) {
+			sampleRegions.push_back( { pSample->__compact_r, nSize } );
+		}
+		return sampleRegions;
+	}
+
+	int nFrames = pSample->__frames;
+	if ( pSample->__is_looped ) {
+		nFrames = pSample->__source_frames;
+	} else if ( pSample->__is_streamed ) {
+		nFrames = pSample->__resident_frames;
+	}
+	size_t nSize = static_cast<size_t>( std::max( 0, nFrames ) ) * sizeof( float );
+	if ( nSize > 0 && pSample->__data_l != nullptr ) {
+		sampleRegions.push_back( { pSample->__data_l, nSize } );
+	}
+	if ( nSize > 0 && pSample->__data_r != nullptr && pSample->__data_r != pSample->__data_l ) {
+		sampleRegions.push_back( { pSample->__data_r, nSize } );
+	}
+	// The SampleStreamer decodes packed samples from memory.
+	if ( pSample->__pack != nullptr ) {
+		sampleRegions.push_back( { pSample->__pack->get_data(), pSample->__pack->get_size() } );
+	}
+	return sampleRegions;
+}
+
+bool SampleMemory::lock_regions( const std::vector<Region>& regions )
+{
+#ifndef WIN32
+	for ( size_t ii = 0; ii < regions.size(); ++ii ) {
+		void* pStart;
+		size_t nLength;
+		alignToPages( regions[ ii ].pAddress, regions[ ii ].nSize, &pStart, &nLength );
+		if ( mlock( pStart, nLength ) != 0 ) {
+			int nError = errno;
+			unlock_regions( std::vector<Region>( regions.begin(), regions.begin() + ii ) );
+			errno = nError;
+			return false;
+		}
+	}
+	return true;
+#else
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+void SampleMemory::unlock_regions( const std::vector<Region>& regions )
+{
+#ifndef WIN32
+	for ( const auto& region : regions ) {
+		void* pStart;
+		size_t nLength;
+		alignToPages( region.pAddress, region.nSize, &pStart, &nLength );
+		munlock( pStart, nLength );
+	}
+#endif
+}
+
+void SampleMemory::touch_regions( const std::vector<Region>& regions )
+{
+	const size_t nPageSize = pageSize();
+	for ( const auto& region : regions ) {
+		const volatile char* pData = static_cast<const volatile char*>( region.pAddress );
+		char nSum = 0;
+		for ( size_t nOffset = 0; nOffset < region.nSize; nOffset += nPageSize ) {
+			nSum += pData[ nOffset ];
+		}
+		if ( region.nSize > 0 ) {
+			nSum += pData[ region.nSize - 1 ];
+		}
+		(void) nSum;
+	}
+}
+
+size_t SampleMemory::resident_bytes( const std::vector<Region>& regions )
+{
+	size_t nResident = 0;
+#ifndef WIN32
+	const size_t nPageSize = pageSize();
+	for ( const auto& region : regions ) {
+		void* pStart;
+		size_t nLength;
+		alignToPages( region.pAddress, region.nSize, &pStart, &nLength );
+#ifdef __APPLE__
+		std::vector<char> pages( nLength / nPageSize );
+#else
+		std::vector<unsigned char> pages( nLength / nPageSize );
+#endif
+		if ( mincore( pStart, nLength, pages.data() ) != 0 ) {
+			continue;
+		}
+		for ( auto page : pages ) {
+			if ( page & 1 ) {
+				nResident += nPageSize;
+			}
+		}
+	}
+#endif
+	return nResident;
+}
+
+};
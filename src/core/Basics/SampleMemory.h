@@ -0,0 +1,175 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_MEMORY_H
+#define H2C_SAMPLE_MEMORY_H
+
+#include <core/Object.h>
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Keeps the data of loaded samples resident in RAM.
+ *
+ * Samples decoded by the SampleLoader are handed to prepare(), which
+ * locks their buffers into RAM if Preferences::m_bLockSampleMemory
+ * is set and the total stays below
+ * Preferences::m_nSampleMemoryLockLimit. Samples not locked are
+ * pre-touched instead, so that data mapped from the SampleCache is
+ * read from disk at load time rather than by a page fault within the
+ * process cycle.
+ *
+ * Beyond Preferences::m_nSampleMemoryBudget enforce_budget() drops
+ * the data of the samples not played for the longest time. Only data
+ * mapped from the SampleCache and not modified since can be dropped,
+ * as the kernel reads it from the cache file again on the next
+ * access.
+ *
+ * Locks are page granular. Buffers sharing a page with other heap
+ * allocations do unlock the whole page once released.
+ *
+ * Sample data allocated by the SampleArena is locked and touched
+ * the same way. Its buffers are page aligned while sample memory is
+ * locked.
+ *
+ * Not available on Windows, where prepare() merely pre-touches the
+ * data and get_stats() does not report resident memory.
+ */
+class SampleMemory : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Memory usage as reported by get_stats().*/
+		struct Stats {
+			/** Samples passed to prepare() and not released yet.*/
+			int nSamples = 0;
+			/** Samples locked into RAM.*/
+			int nLockedSamples = 0;
+			/** Samples which should have been locked but were
+				not, as the limit was reached or mlock() failed.*/
+			int nFailedSamples = 0;
+			/** Size of the data of all samples in bytes.*/
+			size_t nBytes = 0;
+			/** Size of the data of the locked samples in bytes.*/
+			size_t nLockedBytes = 0;
+			/** Bytes of sample data currently resident in RAM,
+				rounded to pages.*/
+			size_t nResidentBytes = 0;
+			/** Preferences::m_nSampleMemoryBudget in bytes, 0 for
+				none.*/
+			size_t nBudgetBytes = 0;
+			/** Number of times the data of a sample was dropped
+				by enforce_budget().*/
+			int nEvictions = 0;
+			/** Bytes mapped by the SampleArena. Includes the
+				unused remainder of its regions.*/
+			size_t nArenaBytes = 0;
+			/** Number of regions of the SampleArena.*/
+			int nArenaRegions = 0;
+		};
+
+		/**
+		 * Locks or pre-touches the data of @a pSample. Samples
+		 * prepared already are skipped. The data is released again
+		 * by Sample::free_data().
+		 *
+		 * Has to be called by the thread which loaded @a pSample
+		 * before it is used by the audio engine.
+		 */
+		static void prepare( Sample* pSample );
+		/** Unlocks the data of @a pSample and forgets about it.*/
+		static void release( Sample* pSample );
+
+		/** \return Memory usage of all prepared samples. Queries the
+			kernel for each of their pages and is therefore meant
+			to be called by the GUI only every now and then.*/
+		static Stats get_stats();
+
+		/**
+		 * Drops the resident data of the samples least recently
+		 * marked by Sample::mark_used() until the sample data
+		 * resident in RAM fits Preferences::m_nSampleMemoryBudget.
+		 * Locked samples are unlocked first. Does nothing if no
+		 * budget is set.
+		 *
+		 * Queries the kernel for each page of the prepared samples
+		 * and is meant to be called by the SampleLoader after
+		 * loading a batch of samples.
+		 */
+		static void enforce_budget();
+
+	private:
+		/** Contiguous block of sample data.*/
+		struct Region {
+			const void* pAddress;
+			size_t nSize;
+		};
+		/** Bookkeeping of a prepared sample.*/
+		struct Entry {
+			std::vector<Region> regions;
+			size_t nBytes = 0;
+			bool bLocked = false;
+			bool bFailed = false;
+		};
+
+		/** \return Buffers holding the data of @a pSample.*/
+		static std::vector<Region> regions( const Sample* pSample );
+		/** Locks @a regions using mlock() and undoes it again if
+			any of them fails.*/
+		static bool lock_regions( const std::vector<Region>& regions );
+		static void unlock_regions( const std::vector<Region>& regions );
+		/** Reads one byte of each page of @a regions.*/
+		static void touch_regions( const std::vector<Region>& regions );
+		/** \return Bytes of @a regions resident in RAM.*/
+		static size_t resident_bytes( const std::vector<Region>& regions );
+		/** \return Whether the data of @a pSample can be dropped and
+			read from the SampleCache again.*/
+		static bool is_evictable( const Sample* pSample );
+
+		/** Protects all members below and the
+			Sample::__memory_prepared flags.*/
+		static std::mutex m_mutex;
+		static std::map<const Sample*, Entry> m_entries;
+		/** Bytes locked or about to be locked by prepare().*/
+		static size_t m_nLockedBytes;
+		/** Whether mlock() did fail once. Used to log only the first
+			failure.*/
+		static bool m_bLockFailed;
+		/** See Stats::nEvictions.*/
+		static int m_nEvictions;
+		/** Whether enforce_budget() did fail to meet the budget
+			once. Used to log only the first failure.*/
+		static bool m_bBudgetExceeded;
+};
+
+};
+
+#endif
@@ -0,0 +1,323 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <core/Basics/SamplePack.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace H2Core
+{
+
+const char* SamplePack::__class_name = "SamplePack";
+
+/** Highest order of the fixed predictors.*/
+static const int nMaxOrder = 3;
+/** Residuals with a Rice quotient of at least this value are stored
+	verbatim.*/
+static const int nEscapeQuotient = 24;
+/** Bits of a residual stored verbatim. The residuals of the
+	difference of two 16 bit channels stay below 2^20.*/
+static const int nEscapeBits = 24;
+/** Bits of the warm-up frames preceding the residuals.*/
+static const int nWarmupBits = 18;
+/** Bytes the BitReader may read beyond the last block.*/
+static const int nPaddingBytes = 8;
+
+static inline uint32_t zigzag( int32_t nValue )
+{
+	return ( static_cast<uint32_t>( nValue ) << 1 ) ^ static_cast<uint32_t>( nValue >> 31 );
+}
+
+static inline int32_t unzigzag( uint32_t nValue )
+{
+	return static_cast<int32_t>( nValue >> 1 ) ^ -static_cast<int32_t>( nValue & 1 );
+}
+
+/** \return Prediction of frame @a nFrame of @a pIn by the fixed
+	polynomial of order @a nOrder.*/
+static inline int32_t predict( const int32_t* pIn, int nFrame, int nOrder )
+{
+	switch ( nOrder ) {
+	case 1:
+		return pIn[ nFrame - 1 ];
+	case 2:
+		return 2 * pIn[ nFrame - 1 ] - pIn[ nFrame - 2 ];
+	case 3:
+		return 3 * pIn[ nFrame - 1 ] - 3 * pIn[ nFrame - 2 ] + pIn[ nFrame - 3 ];
+	default:
+		return 0;
+	}
+}
+
+/** Appends bits, most significant first, to a byte vector.*/
+class BitWriter {
+public:
+	BitWriter( std::vector<uint8_t>& data ) : m_data( data ), m_nBits( 0 ), m_nCount( 0 ) {}
+
+	/** Appends the lower @a nBits bits of @a nValue. At most 32.*/
+	void write( uint32_t nValue, int nBits ) {
+		m_nBits = ( m_nBits << nBits ) | ( nValue & ( ( uint64_t( 1 ) << nBits ) - 1 ) );
+		m_nCount += nBits;
+		while ( m_nCount >= 8 ) {
+			m_nCount -= 8;
+			m_data.push_back( static_cast<uint8_t>( m_nBits >> m_nCount ) );
+		}
+	}
+
+	void writeRice( uint32_t nValue, int nK ) {
+		uint32_t nQuotient = nValue >> nK;
+		if ( nQuotient < static_cast<uint32_t>( nEscapeQuotient ) ) {
+			// nQuotient ones terminated by a zero.
+			write( ( ( 1u << nQuotient ) - 1 ) << 1, nQuotient + 1 );
+			write( nValue, nK );
+		} else {
+			write( ( 1u << nEscapeQuotient ) - 1, nEscapeQuotient );
+			write( nValue, nEscapeBits );
+		}
+	}
+
+	/** Pads the last byte with zeros.*/
+	void flush() {
+		if ( m_nCount > 0 ) {
+			m_data.push_back( static_cast<uint8_t>( m_nBits << ( 8 - m_nCount ) ) );
+			m_nCount = 0;
+		}
+	}
+
+private:
+	std::vector<uint8_t>& m_data;
+	uint64_t m_nBits;
+	int m_nCount;
+};
+
+/** Reads the bits written by BitWriter.*/
+class BitReader {
+public:
+	BitReader( const uint8_t* pData ) : m_pData( pData ), m_nBits( 0 ), m_nCount( 0 ) {}
+
+	uint32_t read( int nBits ) {
+		if ( nBits == 0 ) {
+			return 0;
+		}
+		if ( m_nCount < nBits ) {
+			refill();
+		}
+		uint32_t nValue = static_cast<uint32_t>( m_nBits >> ( 64 - nBits ) );
+		m_nBits <<= nBits;
+		m_nCount -= nBits;
+		return nValue;
+	}
+
+	uint32_t readRice( int nK ) {
+		if ( m_nCount < nEscapeQuotient + 1 ) {
+			refill();
+		}
+		int nQuotient = 0;
+		while ( nQuotient < nEscapeQuotient && ( m_nBits >> 63 ) != 0 ) {
+			m_nBits <<= 1;
+			++nQuotient;
+		}
+		m_nCount -= nQuotient;
+		if ( nQuotient == nEscapeQuotient ) {
+			return read( nEscapeBits );
+		}
+		// Terminating zero.
+		m_nBits <<= 1;
+		--m_nCount;
+		return ( static_cast<uint32_t>( nQuotient ) << nK ) | read( nK );
+	}
+
+private:
+	/** Keeps more than 56 bits in #m_nBits.*/
+	void refill() {
+		while ( m_nCount <= 56 ) {
+			m_nBits |= static_cast<uint64_t>( *m_pData++ ) << ( 56 - m_nCount );
+			m_nCount += 8;
+		}
+	}
+
+	const uint8_t* m_pData;
+	/** Bits not consumed yet, aligned to the most significant one.*/
+	uint64_t m_nBits;
+	int m_nCount;
+};
+
+/** \return Sum of the absolute residuals of @a pIn using the best
+	fixed predictor, which is written to @a pOrder.*/
+static uint64_t bestOrder( const int32_t* pIn, int nFrames, int* pOrder )
+{
+	uint64_t sums[ nMaxOrder + 1 ] = { 0 };
+	for ( int ii = nMaxOrder; ii < nFrames; ++ii ) {
+		for ( int nOrder = 0; nOrder <= nMaxOrder; ++nOrder ) {
+			sums[ nOrder ] += std::abs( pIn[ ii ] - predict( pIn, ii, nOrder ) );
+		}
+	}
+	*pOrder = 0;
+	for ( int nOrder = 1; nOrder <= std::min( nMaxOrder, nFrames ); ++nOrder ) {
+		if ( sums[ nOrder ] < sums[ *pOrder ] ) {
+			*pOrder = nOrder;
+		}
+	}
+	return sums[ *pOrder ];
+}
+
+static void encodeChannel( BitWriter& writer, const int32_t* pIn, int nFrames )
+{
+	int nOrder;
+	bestOrder( pIn, nFrames, &nOrder );
+
+	std::vector<uint32_t> residuals;
+	residuals.reserve( nFrames );
+	uint64_t nSum = 0;
+	for ( int ii = nOrder; ii < nFrames; ++ii ) {
+		residuals.push_back( zigzag( pIn[ ii ] - predict( pIn, ii, nOrder ) ) );
+		nSum += residuals.back();
+	}
+
+	// The optimal Rice parameter is close to log2 of the mean
+	// residual. Its neighbours are tried as well.
+	uint64_t nMean = residuals.empty() ? 0 : nSum / residuals.size();
+	int nEstimate = 0;
+	while ( nEstimate < 20 && ( uint64_t( 1 ) << ( nEstimate + 1 ) ) <= nMean ) {
+		++nEstimate;
+	}
+	int nK = nEstimate;
+	uint64_t nBestCost = UINT64_MAX;
+	for ( int nCandidate = std::max( 0, nEstimate - 1 ); nCandidate <= nEstimate + 1; ++nCandidate ) {
+		uint64_t nCost = 0;
+		for ( auto nValue : residuals ) {
+			uint32_t nQuotient = nValue >> nCandidate;
+			nCost += nQuotient < static_cast<uint32_t>( nEscapeQuotient ) ?
+				nQuotient + 1 + nCandidate : nEscapeQuotient + nEscapeBits;
+		}
+		if ( nCost < nBestCost ) {
+			nBestCost = nCost;
+			nK = nCandidate;
+		}
+	}
+
+	writer.write( nOrder, 2 );
+	writer.write( nK, 5 );
+	for ( int ii = 0; ii < nOrder; ++ii ) {
+		writer.write( zigzag( pIn[ ii ] ), nWarmupBits );
+	}
+	for ( auto nValue : residuals ) {
+		writer.writeRice( nValue, nK );
+	}
+}
+
+/** Decodes a channel written by encodeChannel() and adds @a pBase,
+	if given, to it.*/
+static void decodeChannel( BitReader& reader, int nFrames, const int16_t* pBase, int16_t* pOut )
+{
+	const int nOrder = static_cast<int>( reader.read( 2 ) );
+	const int nK = static_cast<int>( reader.read( 5 ) );
+
+	int32_t x1 = 0, x2 = 0, x3 = 0;
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		int32_t nValue;
+		if ( ii < nOrder ) {
+			nValue = unzigzag( reader.read( nWarmupBits ) );
+		} else {
+			int32_t nPrediction;
+			switch ( nOrder ) {
+			case 1:
+				nPrediction = x1;
+				break;
+			case 2:
+				nPrediction = 2 * x1 - x2;
+				break;
+			case 3:
+				nPrediction = 3 * x1 - 3 * x2 + x3;
+				break;
+			default:
+				nPrediction = 0;
+			}
+			nValue = nPrediction + unzigzag( reader.readRice( nK ) );
+		}
+		x3 = x2;
+		x2 = x1;
+		x1 = nValue;
+		pOut[ ii ] = static_cast<int16_t>( pBase != nullptr ? pBase[ ii ] + nValue : nValue );
+	}
+}
+
+SamplePack::SamplePack( const int16_t* pFrames, int nFrames, int nChannels )
+	: Object( __class_name )
+	, m_nFrames( std::max( nFrames, 0 ) )
+	, m_nChannels( std::min( std::max( nChannels, 1 ), 2 ) )
+{
+	std::vector<int32_t> left( SAMPLE_PACK_BLOCK ), right( SAMPLE_PACK_BLOCK ),
+		side( SAMPLE_PACK_BLOCK );
+	m_data.reserve( static_cast<size_t>( m_nFrames ) * m_nChannels );
+	BitWriter writer( m_data );
+
+	for ( int nStart = 0; nStart < m_nFrames; nStart += SAMPLE_PACK_BLOCK ) {
+		int nLength = std::min( SAMPLE_PACK_BLOCK, m_nFrames - nStart );
+		for ( int ii = 0; ii < nLength; ++ii ) {
+			const int16_t* pFrame = pFrames + static_cast<size_t>( nStart + ii ) * nChannels;
+			left[ ii ] = pFrame[ 0 ];
+			if ( m_nChannels == 2 ) {
+				right[ ii ] = pFrame[ 1 ];
+				side[ ii ] = right[ ii ] - left[ ii ];
+			}
+		}
+
+		m_blockOffsets.push_back( static_cast<uint32_t>( m_data.size() ) );
+		encodeChannel( writer, left.data(), nLength );
+		if ( m_nChannels == 2 ) {
+			int nOrder;
+			bool bSide = bestOrder( side.data(), nLength, &nOrder ) <
+				bestOrder( right.data(), nLength, &nOrder );
+			writer.write( bSide ? 1 : 0, 1 );
+			encodeChannel( writer, bSide ? side.data() : right.data(), nLength );
+		}
+		writer.flush();
+	}
+
+	m_data.resize( m_data.size() + nPaddingBytes, 0 );
+	m_data.shrink_to_fit();
+}
+
+int SamplePack::decode_block( int nBlock, int16_t* pOut_L, int16_t* pOut_R ) const
+{
+	if ( nBlock < 0 || nBlock >= get_blocks() ) {
+		return 0;
+	}
+	int nLength = std::min( SAMPLE_PACK_BLOCK, m_nFrames - nBlock * SAMPLE_PACK_BLOCK );
+
+	BitReader reader( m_data.data() + m_blockOffsets[ nBlock ] );
+	decodeChannel( reader, nLength, nullptr, pOut_L );
+	if ( m_nChannels == 1 ) {
+		std::copy( pOut_L, pOut_L + nLength, pOut_R );
+	} else {
+		bool bSide = reader.read( 1 ) != 0;
+		decodeChannel( reader, nLength, bSide ? pOut_L : nullptr, pOut_R );
+	}
+
+	return nLength;
+}
+
+};
@@ -0,0 +1,134 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef H2C_SAMPLE_PACK_H
+#define H2C_SAMPLE_PACK_H
+
+#include <core/Object.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Number of frames of a single block of a H2Core::SamplePack.*/
+#define SAMPLE_PACK_BLOCK 4096
+
+namespace H2Core
+{
+
+/**
+ * Losslessly compressed 16 bit frames of a Sample.
+ *
+ * The frames are split into independently decodable blocks of
+ * #SAMPLE_PACK_BLOCK frames. Within each block every channel is
+ * predicted by the fixed polynomial of order zero to three yielding
+ * the smallest residuals, which are Rice coded. The right channel of
+ * a stereo block is stored as its difference to the left one if this
+ * is cheaper. Drum samples, dominated by decaying tails, shrink to
+ * about half of their 16 bit size or below.
+ *
+ * Used by Sample::load() if set_packed_storage() is set. The
+ * SampleStreamer decodes the blocks a voice is about to play in its
+ * background thread. The pack is immutable once encoded and shared
+ * by all copies of the Sample.
+ */
+class SamplePack : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * Encodes @a nFrames interleaved frames.
+		 *
+		 * \param pFrames Interleaved frames of @a nChannels channels.
+		 * Only the first two are encoded.
+		 * \param nFrames Number of frames.
+		 * \param nChannels Number of channels of @a pFrames.
+		 */
+		SamplePack( const int16_t* pFrames, int nFrames, int nChannels );
+
+		/** \return Number of frames.*/
+		int get_frames() const;
+		/** \return Number of encoded channels, 1 or 2.*/
+		int get_channels() const;
+		/** \return Number of blocks.*/
+		int get_blocks() const;
+		/** \return Start of the encoded data.*/
+		const void* get_data() const;
+		/** \return Size of the encoded data in bytes.*/
+		size_t get_size() const;
+
+		/**
+		 * Decodes block @a nBlock, which holds the frames starting
+		 * at @a nBlock * #SAMPLE_PACK_BLOCK.
+		 *
+		 * Neither allocates memory nor locks.
+		 *
+		 * \param pOut_L Receives up to #SAMPLE_PACK_BLOCK frames of
+		 * the left channel.
+		 * \param pOut_R Receives the right channel. The left one is
+		 * copied for mono packs.
+		 *
+		 * \return Number of frames decoded, 0 if @a nBlock is out
+		 * of range.
+		 */
+		int decode_block( int nBlock, int16_t* pOut_L, int16_t* pOut_R ) const;
+
+	private:
+		int m_nFrames;
+		int m_nChannels;
+		/** Offset of each block in #m_data.*/
+		std::vector<uint32_t> m_blockOffsets;
+		/** Encoded blocks followed by a few padding bytes, so the
+			decoder does not have to check for the end.*/
+		std::vector<uint8_t> m_data;
+};
+
+inline int SamplePack::get_frames() const
+{
+	return m_nFrames;
+}
+
+inline int SamplePack::get_channels() const
+{
+	return m_nChannels;
+}
+
+inline int SamplePack::get_blocks() const
+{
+	return static_cast<int>( m_blockOffsets.size() );
+}
+
+inline const void* SamplePack::get_data() const
+{
+	return m_data.data();
+}
+
+inline size_t SamplePack::get_size() const
+{
+	return m_data.size();
+}
+
+};
+
+#endif
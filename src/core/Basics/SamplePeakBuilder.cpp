@@ -0,0 +1,207 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/SamplePeaks.h>
+#include <core/EventQueue.h>
+#include <core/Preferences.h>
+#include <core/Helpers/Filesystem.h>
+
+namespace H2Core
+{
+
+const char* SamplePeakBuilder::__class_name = "SamplePeakBuilder";
+
+SamplePeakBuilder* SamplePeakBuilder::__instance = nullptr;
+
+void SamplePeakBuilder::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new SamplePeakBuilder;
+	}
+}
+
+SamplePeakBuilder::SamplePeakBuilder()
+	: Object( __class_name )
+	, m_bQuit( false )
+{
+	m_worker = std::thread( &SamplePeakBuilder::workerLoop, this );
+}
+
+SamplePeakBuilder::~SamplePeakBuilder()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bQuit = true;
+		m_jobs.clear();
+		m_condition.notify_all();
+	}
+	m_worker.join();
+
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+std::shared_ptr<const SamplePeaks> SamplePeakBuilder::peaks( std::shared_ptr<Sample> pSample )
+{
+	if ( pSample == nullptr ) {
+		return nullptr;
+	}
+
+	auto pPeaks = pSample->get_peaks();
+	if ( pPeaks != nullptr ) {
+		return pPeaks;
+	}
+
+	Job job;
+	job.pTarget = pSample;
+	job.pTargetId = pSample.get();
+	job.nGeneration = pSample->get_peaks_generation();
+	job.sFilepath = pSample->get_filepath();
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		for ( const auto& pending : m_jobs ) {
+			if ( pending.pTargetId == job.pTargetId &&
+				 pending.nGeneration == job.nGeneration ) {
+				// Already on its way.
+				return nullptr;
+			}
+		}
+	}
+
+	if ( pSample->get_is_modified() ) {
+		job.pCopy = std::make_shared<Sample>( pSample );
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for ( auto& pending : m_jobs ) {
+		if ( pending.pTargetId == job.pTargetId ) {
+			// Only the most recent data matters.
+			pending = std::move( job );
+			return nullptr;
+		}
+	}
+	m_jobs.push_back( std::move( job ) );
+	m_condition.notify_all();
+
+	return nullptr;
+}
+
+std::shared_ptr<const SamplePeaks> SamplePeakBuilder::build( std::shared_ptr<Sample> pSample )
+{
+	if ( pSample == nullptr ) {
+		return nullptr;
+	}
+
+	auto pPeaks = pSample->get_peaks();
+	if ( pPeaks != nullptr ) {
+		return pPeaks;
+	}
+
+	int nGeneration = pSample->get_peaks_generation();
+	std::shared_ptr<SamplePeaks> pBuilt;
+	if ( pSample->get_is_modified() ) {
+		pBuilt = std::make_shared<SamplePeaks>( pSample );
+	} else {
+		// Only the head of a streamed sample is held in memory.
+		pBuilt = process( pSample->get_filepath(),
+						  pSample->is_streamed() ? nullptr : pSample );
+	}
+	if ( pBuilt == nullptr ) {
+		return nullptr;
+	}
+
+	pSample->set_peaks( pBuilt, nGeneration );
+	return pBuilt;
+}
+
+std::shared_ptr<SamplePeaks> SamplePeakBuilder::process( const QString& sFilepath,
+														 std::shared_ptr<Sample> pSample )
+{
+	// Same policy as for the SampleCache.
+	bool bStore = Preferences::get_instance()->m_bSampleCache &&
+		! sFilepath.startsWith( Filesystem::tmp_dir() );
+	if ( bStore ) {
+		auto pPeaks = SamplePeaks::load( sFilepath );
+		if ( pPeaks != nullptr ) {
+			return pPeaks;
+		}
+	}
+
+	if ( pSample == nullptr ) {
+		pSample = Sample::load( sFilepath );
+		if ( pSample == nullptr ) {
+			ERRORLOG( QString( "Unable to build peaks of [%1]" ).arg( sFilepath ) );
+			return nullptr;
+		}
+	}
+
+	auto pPeaks = std::make_shared<SamplePeaks>( pSample );
+	if ( bStore ) {
+		pPeaks->store( sFilepath );
+	}
+
+	return pPeaks;
+}
+
+void SamplePeakBuilder::workerLoop()
+{
+	for ( ;; ) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_condition.wait( lock, [&]() {
+				return m_bQuit || ! m_jobs.empty();
+			} );
+			if ( m_bQuit ) {
+				return;
+			}
+			job = std::move( m_jobs.front() );
+			m_jobs.pop_front();
+		}
+
+		if ( job.pTarget.expired() ) {
+			continue;
+		}
+
+		std::shared_ptr<SamplePeaks> pPeaks;
+		if ( job.pCopy != nullptr ) {
+			pPeaks = std::make_shared<SamplePeaks>( job.pCopy );
+		} else {
+			pPeaks = process( job.sFilepath, nullptr );
+		}
+		if ( pPeaks == nullptr ) {
+			continue;
+		}
+
+		auto pTarget = job.pTarget.lock();
+		if ( pTarget != nullptr && pTarget->set_peaks( pPeaks, job.nGeneration ) ) {
+			EventQueue::get_instance()->push_event( EVENT_SAMPLE_PEAKS_READY, 0 );
+		}
+	}
+}
+
+};
@@ -0,0 +1,134 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_PEAK_BUILDER_H
+#define H2C_SAMPLE_PEAK_BUILDER_H
+
+#include <core/Object.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace H2Core
+{
+
+class Sample;
+class SamplePeaks;
+
+/**
+ * Builds the SamplePeaks of samples in a background thread.
+ *
+ * Wave displays call peaks() whenever they need the waveform of a
+ * sample. The first call queues a job and returns nullptr, so the
+ * widget can fall back to scanning the frames itself. Once the
+ * worker is done, the pyramid is attached to the sample using
+ * Sample::set_peaks() and #EVENT_SAMPLE_PEAKS_READY is pushed, upon
+ * which the widgets redraw using the shared result.
+ *
+ * Unmodified samples are read from their file by the worker and
+ * their pyramids are stored on disk if Preferences::m_bSampleCache
+ * is set. Modified ones, whose data does only exist in memory, are
+ * copied by the calling thread.
+ */
+class SamplePeakBuilder : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals nullptr, a new SamplePeakBuilder
+		 * singleton will be created and stored in #__instance.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static SamplePeakBuilder* get_instance();
+
+		~SamplePeakBuilder();
+
+		/**
+		 * \return Pyramid of @a pSample. If there is none yet, a job
+		 * is queued and nullptr is returned.
+		 */
+		std::shared_ptr<const SamplePeaks> peaks( std::shared_ptr<Sample> pSample );
+
+		/**
+		 * Builds the pyramid of @a pSample in the calling thread,
+		 * unless it has one already, and attaches it.
+		 *
+		 * Intended for samples the caller did just load on its own,
+		 * which are neither shared nor displayed by anyone else. Can
+		 * be used without an instance.
+		 */
+		static std::shared_ptr<const SamplePeaks> build( std::shared_ptr<Sample> pSample );
+
+	private:
+		/** Pointer to the SamplePeakBuilder singleton.*/
+		static SamplePeakBuilder* __instance;
+
+		SamplePeakBuilder();
+
+		struct Job {
+			/** Sample to attach the result to. The job is dropped
+				if it got deleted in the meantime.*/
+			std::weak_ptr<Sample> pTarget;
+			/** Only used to identify pending jobs of the same
+				sample.*/
+			Sample* pTargetId;
+			/** Sample::get_peaks_generation() at the time the job
+				was queued.*/
+			int nGeneration;
+			QString sFilepath;
+			/** Copy of the data of a modified sample. nullptr if
+				the file has to be read instead.*/
+			std::shared_ptr<Sample> pCopy;
+		};
+
+		void workerLoop();
+		/**
+		 * \return Stored pyramid of the unmodified sample file
+		 * @a sFilepath or one built from scratch. In the latter
+		 * case the data of @a pSample is scanned or, if it is
+		 * nullptr, the file is read.
+		 */
+		static std::shared_ptr<SamplePeaks> process( const QString& sFilepath,
+													 std::shared_ptr<Sample> pSample );
+
+		std::thread m_worker;
+		bool m_bQuit;
+		std::deque<Job> m_jobs;
+		/** Protects #m_jobs and #m_bQuit.*/
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+};
+
+inline SamplePeakBuilder* SamplePeakBuilder::get_instance()
+{
+	return __instance;
+}
+
+};
+
+#endif
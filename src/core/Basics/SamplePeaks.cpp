@@ -0,0 +1,361 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SamplePeaks.h>
+#include <core/Basics/Sample.h>
+#include <core/Helpers/Filesystem.h>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* SamplePeaks::__class_name = "SamplePeaks";
+
+static_assert( ( SAMPLE_PEAKS_BLOCK & ( SAMPLE_PEAKS_BLOCK - 1 ) ) == 0,
+			   "SAMPLE_PEAKS_BLOCK has to be a power of two" );
+
+/** Layout of the beginning of a stored pyramid. It is followed by
+	the path of the original file and the content of
+	SamplePeaks::m_data.*/
+struct PeaksHeader {
+	char sMagic[ 4 ];
+	uint32_t nVersion;
+	/** Modification time of the original file in ms since epoch.*/
+	int64_t nModified;
+	/** Size of the original file in bytes.*/
+	int64_t nSize;
+	int32_t nFrames;
+	/** Length of the UTF-8 encoded path of the original file.*/
+	int32_t nPathLength;
+	/** SampleAnalysis of the original file.*/
+	float fPeak;
+	float fRms;
+	int32_t nOnset;
+	int32_t nEnd;
+};
+
+static const char sPeaksMagic[ 4 ] = { 'H', '2', 'P', 'K' };
+/** Has to be increased whenever the layout or the decoding does
+	change.*/
+static const uint32_t nPeaksVersion = 2;
+/** Number of frames converted at once when scanning compactly
+	stored samples.*/
+static const int nChunkFrames = 64 * SAMPLE_PEAKS_BLOCK;
+
+SamplePeaks::SamplePeaks()
+	: Object( __class_name )
+	, m_nFrames( 0 )
+{
+}
+
+SamplePeaks::SamplePeaks( std::shared_ptr<Sample> pSample )
+	: Object( __class_name )
+	, m_nFrames( pSample->get_frames() )
+{
+	build_levels();
+	m_analysis.bValid = true;
+	if ( m_levelSizes.empty() ) {
+		return;
+	}
+
+	int nBlocks = m_levelSizes[ 0 ];
+	float* pPeaks_L = m_data.data();
+	float* pPeaks_R = pPeaks_L + 2 * nBlocks;
+	for ( int ii = 0; ii < 2 * nBlocks; ++ii ) {
+		pPeaks_L[ ii ] = 0;
+		pPeaks_R[ ii ] = 0;
+	}
+
+	// Compactly stored and deferred samples are converted in chunks.
+	// Only the head of a streamed sample is held in memory.
+	bool bConvert = pSample->is_compact() || pSample->is_deferred();
+	int nScanned = bConvert ? m_nFrames :
+		std::min( m_nFrames, pSample->get_resident_frames() );
+	std::vector<float> buffer_L, buffer_R;
+	if ( bConvert ) {
+		buffer_L.resize( nChunkFrames );
+		buffer_R.resize( nChunkFrames );
+	}
+	auto read = [&]( int nFirst, int nFrames,
+					 const float*& pData_L, const float*& pData_R ) {
+		if ( bConvert ) {
+			pSample->read_frames( nFirst, nFrames, buffer_L.data(), buffer_R.data() );
+			pData_L = buffer_L.data();
+			pData_R = buffer_R.data();
+		} else {
+			pData_L = pSample->get_data_l() + nFirst;
+			pData_R = pSample->get_data_r() + nFirst;
+		}
+	};
+
+	double fSquares = 0;
+	int nEnd = 0;
+	for ( int nFirst = 0; nFirst < nScanned; nFirst += nChunkFrames ) {
+		int nFrames = std::min( nChunkFrames, nScanned - nFirst );
+		const float* pData_L;
+		const float* pData_R;
+		read( nFirst, nFrames, pData_L, pData_R );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			int nBlock = ( nFirst + ii ) / SAMPLE_PEAKS_BLOCK;
+			float* pL = pPeaks_L + 2 * nBlock;
+			float* pR = pPeaks_R + 2 * nBlock;
+			pL[ 0 ] = std::min( pL[ 0 ], pData_L[ ii ] );
+			pL[ 1 ] = std::max( pL[ 1 ], pData_L[ ii ] );
+			pR[ 0 ] = std::min( pR[ 0 ], pData_R[ ii ] );
+			pR[ 1 ] = std::max( pR[ 1 ], pData_R[ ii ] );
+			fSquares += pData_L[ ii ] * pData_L[ ii ] + pData_R[ ii ] * pData_R[ ii ];
+			if ( std::fabs( pData_L[ ii ] ) > fSilenceLevel ||
+				 std::fabs( pData_R[ ii ] ) > fSilenceLevel ) {
+				nEnd = nFirst + ii + 1;
+			}
+		}
+	}
+
+	// The peak and the block holding the onset are read off level
+	// zero. Only the frames of the latter have to be scanned again.
+	auto blockPeak = [&]( int nBlock ) {
+		return std::max( std::max( -pPeaks_L[ 2 * nBlock ], pPeaks_L[ 2 * nBlock + 1 ] ),
+						 std::max( -pPeaks_R[ 2 * nBlock ], pPeaks_R[ 2 * nBlock + 1 ] ) );
+	};
+	float fPeak = 0;
+	for ( int nBlock = 0; nBlock < nBlocks; ++nBlock ) {
+		fPeak = std::max( fPeak, blockPeak( nBlock ) );
+	}
+
+	int nOnset = 0;
+	float fOnset = fOnsetLevel * fPeak;
+	if ( fPeak > 0 ) {
+		int nBlock = 0;
+		while ( blockPeak( nBlock ) < fOnset ) {
+			++nBlock;
+		}
+		int nFirst = nBlock * SAMPLE_PEAKS_BLOCK;
+		int nFrames = std::min( SAMPLE_PEAKS_BLOCK, nScanned - nFirst );
+		const float* pData_L;
+		const float* pData_R;
+		read( nFirst, nFrames, pData_L, pData_R );
+		nOnset = nFirst;
+		while ( nOnset + 1 < nFirst + nFrames &&
+				std::fabs( pData_L[ nOnset - nFirst ] ) < fOnset &&
+				std::fabs( pData_R[ nOnset - nFirst ] ) < fOnset ) {
+			++nOnset;
+		}
+	}
+
+	m_analysis.fPeak = fPeak;
+	m_analysis.fRms = nScanned > 0 ? std::sqrt( fSquares / ( 2.0 * nScanned ) ) : 0;
+	m_analysis.nOnset = nOnset;
+	// The tail of a streamed sample is unknown.
+	m_analysis.nEnd = nScanned < m_nFrames ? m_nFrames : nEnd;
+
+	for ( size_t nLevel = 1; nLevel < m_levelSizes.size(); ++nLevel ) {
+		int nSize = m_levelSizes[ nLevel ];
+		int nLowerSize = m_levelSizes[ nLevel - 1 ];
+		for ( int nChannel = 0; nChannel < 2; ++nChannel ) {
+			const float* pLower = m_data.data() + m_levelOffsets[ nLevel - 1 ] +
+				2 * nChannel * nLowerSize;
+			float* pLevel = m_data.data() + m_levelOffsets[ nLevel ] +
+				2 * nChannel * nSize;
+			for ( int ii = 0; ii < nSize; ++ii ) {
+				const float* pFirst = pLower + 4 * ii;
+				if ( 2 * ii + 1 < nLowerSize ) {
+					pLevel[ 2 * ii ] = std::min( pFirst[ 0 ], pFirst[ 2 ] );
+					pLevel[ 2 * ii + 1 ] = std::max( pFirst[ 1 ], pFirst[ 3 ] );
+				} else {
+					pLevel[ 2 * ii ] = pFirst[ 0 ];
+					pLevel[ 2 * ii + 1 ] = pFirst[ 1 ];
+				}
+			}
+		}
+	}
+}
+
+SamplePeaks::~SamplePeaks()
+{
+}
+
+void SamplePeaks::build_levels()
+{
+	m_levelSizes.clear();
+	m_levelOffsets.clear();
+
+	size_t nTotal = 0;
+	int nSize = ( m_nFrames + SAMPLE_PEAKS_BLOCK - 1 ) / SAMPLE_PEAKS_BLOCK;
+	while ( nSize > 0 ) {
+		m_levelSizes.push_back( nSize );
+		m_levelOffsets.push_back( nTotal );
+		// Minimum and maximum of both channels.
+		nTotal += 4 * static_cast<size_t>( nSize );
+		if ( nSize == 1 ) {
+			break;
+		}
+		nSize = ( nSize + 1 ) / 2;
+	}
+
+	m_data.resize( nTotal );
+}
+
+bool SamplePeaks::get_peaks( int nChannel, double fFirstFrame, double fFramesPerPixel,
+							 int nPixels, float* pMin, float* pMax ) const
+{
+	if ( fFramesPerPixel < SAMPLE_PEAKS_BLOCK ) {
+		return false;
+	}
+
+	if ( m_levelSizes.empty() ) {
+		for ( int ii = 0; ii < nPixels; ++ii ) {
+			pMin[ ii ] = 0;
+			pMax[ ii ] = 0;
+		}
+		return true;
+	}
+
+	size_t nLevel = 0;
+	double fBlock = SAMPLE_PEAKS_BLOCK;
+	while ( nLevel + 1 < m_levelSizes.size() && 2 * fBlock <= fFramesPerPixel ) {
+		++nLevel;
+		fBlock *= 2;
+	}
+
+	int nSize = m_levelSizes[ nLevel ];
+	const float* pLevel = m_data.data() + m_levelOffsets[ nLevel ] +
+		2 * ( nChannel == 0 ? 0 : 1 ) * nSize;
+
+	for ( int ii = 0; ii < nPixels; ++ii ) {
+		double fStart = fFirstFrame + ii * fFramesPerPixel;
+		int nFirst = std::max( 0.0, std::floor( fStart / fBlock ) );
+		int nLast = std::min( static_cast<double>( nSize ),
+							  std::ceil( ( fStart + fFramesPerPixel ) / fBlock ) );
+
+		float fMin = 0;
+		float fMax = 0;
+		for ( int nBlock = nFirst; nBlock < nLast; ++nBlock ) {
+			fMin = std::min( fMin, pLevel[ 2 * nBlock ] );
+			fMax = std::max( fMax, pLevel[ 2 * nBlock + 1 ] );
+		}
+		pMin[ ii ] = fMin;
+		pMax[ ii ] = fMax;
+	}
+
+	return true;
+}
+
+QString SamplePeaks::cache_path( const QString& sFilepath )
+{
+	QByteArray hash = QCryptographicHash::hash( sFilepath.toUtf8(),
+												QCryptographicHash::Sha1 );
+	return Filesystem::samples_cache_dir() + QString( hash.toHex() ) + ".h2pk";
+}
+
+std::shared_ptr<SamplePeaks> SamplePeaks::load( const QString& sFilepath )
+{
+	QFileInfo fileInfo( sFilepath );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+	QByteArray path = sAbsolutePath.toUtf8();
+
+	QFile file( cache_path( sAbsolutePath ) );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		// Not stored yet.
+		return nullptr;
+	}
+
+	PeaksHeader header;
+	if ( file.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) != sizeof( header ) ||
+		 memcmp( header.sMagic, sPeaksMagic, sizeof( sPeaksMagic ) ) != 0 ||
+		 header.nVersion != nPeaksVersion ||
+		 header.nModified != fileInfo.lastModified().toMSecsSinceEpoch() ||
+		 header.nSize != fileInfo.size() ||
+		 header.nFrames < 0 ||
+		 header.nPathLength != path.size() ||
+		 file.read( header.nPathLength ) != path ) {
+		// Outdated. It will be replaced by the caller.
+		return nullptr;
+	}
+
+	std::shared_ptr<SamplePeaks> pPeaks( new SamplePeaks );
+	pPeaks->m_nFrames = header.nFrames;
+	pPeaks->m_analysis.bValid = true;
+	pPeaks->m_analysis.fPeak = header.fPeak;
+	pPeaks->m_analysis.fRms = header.fRms;
+	pPeaks->m_analysis.nOnset = header.nOnset;
+	pPeaks->m_analysis.nEnd = header.nEnd;
+	pPeaks->build_levels();
+
+	qint64 nDataSize = static_cast<qint64>( pPeaks->m_data.size() ) * sizeof( float );
+	if ( file.read( reinterpret_cast<char*>( pPeaks->m_data.data() ), nDataSize ) != nDataSize ||
+		 ! file.atEnd() ) {
+		WARNINGLOG( QString( "Stored peaks of %1 are truncated" ).arg( sAbsolutePath ) );
+		return nullptr;
+	}
+
+	return pPeaks;
+}
+
+void SamplePeaks::store( const QString& sFilepath ) const
+{
+	if ( ! QDir( Filesystem::samples_cache_dir() ).exists() ) {
+		return;
+	}
+
+	QFileInfo fileInfo( sFilepath );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+	QByteArray path = sAbsolutePath.toUtf8();
+
+	PeaksHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.sMagic, sPeaksMagic, sizeof( sPeaksMagic ) );
+	header.nVersion = nPeaksVersion;
+	header.nModified = fileInfo.lastModified().toMSecsSinceEpoch();
+	header.nSize = fileInfo.size();
+	header.nFrames = m_nFrames;
+	header.nPathLength = path.size();
+	header.fPeak = m_analysis.fPeak;
+	header.fRms = m_analysis.fRms;
+	header.nOnset = m_analysis.nOnset;
+	header.nEnd = m_analysis.nEnd;
+
+	qint64 nDataSize = static_cast<qint64>( m_data.size() ) * sizeof( float );
+
+	QSaveFile file( cache_path( sAbsolutePath ) );
+	if ( ! file.open( QIODevice::WriteOnly ) ||
+		 file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) != sizeof( header ) ||
+		 file.write( path ) != path.size() ||
+		 file.write( reinterpret_cast<const char*>( m_data.data() ), nDataSize ) != nDataSize ||
+		 ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to store peaks of %1: %2" )
+					.arg( sAbsolutePath ).arg( file.errorString() ) );
+	}
+}
+
+};
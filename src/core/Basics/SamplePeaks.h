@@ -0,0 +1,176 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_PEAKS_H
+#define H2C_SAMPLE_PEAKS_H
+
+#include <core/Object.h>
+
+#include <memory>
+#include <vector>
+
+/** Number of frames summarized by a single entry of the finest level
+	of a H2Core::SamplePeaks pyramid. Has to be a power of two.*/
+#define SAMPLE_PEAKS_BLOCK 64
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Statistics of a Sample determined once along with its SamplePeaks
+ * and stored with them.
+ *
+ * Frames are counted from the beginning of the sample. For a
+ * streamed sample only its resident head is analysed and #nEnd is the
+ * number of frames of the sample.
+ */
+struct SampleAnalysis {
+	/** Whether the remaining members are valid.*/
+	bool bValid;
+	/** Largest absolute value of both channels.*/
+	float fPeak;
+	/** Root mean square of both channels.*/
+	float fRms;
+	/** First frame reaching SamplePeaks::fOnsetLevel times #fPeak
+		in either channel.*/
+	int nOnset;
+	/** Frame following the last one exceeding
+		SamplePeaks::fSilenceLevel in either channel. 0 if the
+		sample is silent.*/
+	int nEnd;
+
+	SampleAnalysis()
+		: bValid( false ), fPeak( 0 ), fRms( 0 ), nOnset( 0 ), nEnd( 0 ) {}
+};
+
+/**
+ * Multi-resolution summary of the minima and maxima of a Sample.
+ *
+ * Level zero holds the minimum and maximum of each channel for
+ * consecutive blocks of #SAMPLE_PEAKS_BLOCK frames, each further
+ * level those of two neighbouring entries of the level below, until
+ * a single entry covers the whole sample. Drawing a waveform at an
+ * arbitrary zoom does thus cost O(pixels) instead of O(frames).
+ *
+ * The pyramid is immutable once built and shared by all widgets
+ * displaying the same Sample (see Sample::get_peaks() and
+ * SamplePeakBuilder). Pyramids of unmodified sample files are
+ * stored in Filesystem::samples_cache_dir() next to the SampleCache
+ * entries, keyed by the path of the file and validated against its
+ * size and modification time.
+ *
+ * The scan building the pyramid does also yield the SampleAnalysis
+ * of the sample, which is stored alongside.
+ */
+class SamplePeaks : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Level relative to the peak marking the onset of a
+			sample (-20 dB).*/
+		static constexpr float fOnsetLevel = 0.1;
+		/** Absolute value below which the end of a sample is
+			considered silent (-80 dBFS).*/
+		static constexpr float fSilenceLevel = 1e-4;
+
+		/**
+		 * Scans the data of @a pSample.
+		 *
+		 * Only the resident frames of a streamed sample are
+		 * covered. Frames beyond are treated as silence.
+		 */
+		SamplePeaks( std::shared_ptr<Sample> pSample );
+		~SamplePeaks();
+
+		/** \return Number of frames of the sample at the time the
+			pyramid was built.*/
+		int get_frames() const;
+		/** \return Statistics of the sample in frames of the
+			pyramid, see get_frames().*/
+		const SampleAnalysis& get_analysis() const;
+
+		/**
+		 * Determines minimum and maximum of channel @a nChannel for
+		 * @a nPixels consecutive ranges of @a fFramesPerPixel frames
+		 * each, the first one starting at @a fFirstFrame. Ranges
+		 * beyond the end of the sample yield zero.
+		 *
+		 * The result is taken from the coarsest level whose blocks
+		 * are not larger than a pixel. It may therefore include up
+		 * to one block of frames adjacent to each range.
+		 *
+		 * \param nChannel 0 for the left and 1 for the right channel.
+		 *
+		 * \return false if @a fFramesPerPixel is smaller than
+		 * #SAMPLE_PEAKS_BLOCK. The caller has to scan the frames itself
+		 * in this case.
+		 */
+		bool get_peaks( int nChannel, double fFirstFrame, double fFramesPerPixel,
+						int nPixels, float* pMin, float* pMax ) const;
+
+		/**
+		 * Loads the stored pyramid of the unmodified file @a sFilepath.
+		 *
+		 * \return nullptr if there is no valid entry.
+		 */
+		static std::shared_ptr<SamplePeaks> load( const QString& sFilepath );
+		/** Stores the pyramid of the unmodified file
+			@a sFilepath. An existing entry is replaced atomically.*/
+		void store( const QString& sFilepath ) const;
+
+	private:
+		SamplePeaks();
+
+		/** Adds the levels above level zero.*/
+		void build_levels();
+
+		int m_nFrames;
+		SampleAnalysis m_analysis;
+		/** Number of blocks of each level.*/
+		std::vector<int> m_levelSizes;
+		/** Offset of each level in #m_data.*/
+		std::vector<size_t> m_levelOffsets;
+		/** Minimum and maximum of all blocks of all levels. Within a
+			level all blocks of the left channel are followed by
+			those of the right one.*/
+		std::vector<float> m_data;
+
+		/** \return Path of the stored pyramid of @a sFilepath.*/
+		static QString cache_path( const QString& sFilepath );
+};
+
+inline int SamplePeaks::get_frames() const
+{
+	return m_nFrames;
+}
+
+inline const SampleAnalysis& SamplePeaks::get_analysis() const
+{
+	return m_analysis;
+}
+
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SamplePool.h>
+#include <core/Hydrogen.h>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+
+namespace H2Core
+{
+
+const char* SamplePool::__class_name = "SamplePool";
+
+std::mutex SamplePool::__mutex;
+std::map<QString, std::weak_ptr<Sample>> SamplePool::__samples;
+size_t SamplePool::__purged_size = 0;
+
+QString SamplePool::file_key( const QString& sFilepath )
+{
+	QFileInfo fileInfo( sFilepath );
+	QString sPath = fileInfo.canonicalFilePath();
+	if ( sPath.isEmpty() ) {
+		sPath = fileInfo.absoluteFilePath();
+	}
+	return QString( "%1|%2|%3" ).arg( sPath ).arg( fileInfo.size() )
+		.arg( fileInfo.lastModified().toMSecsSinceEpoch() );
+}
+
+QString SamplePool::key( const QString& sFilepath, bool bAllowStreaming )
+{
+	QString sKey = file_key( sFilepath );
+	if ( bAllowStreaming ) {
+		// The storage of the loaded data depends on the settings
+		// of the Sampler at the time of loading.
+		sKey += QString( "|stream:%1:%2:%3" ).arg( Sample::__stream_preload )
+			.arg( static_cast<int>( Sample::__compact_storage ) ).arg( Sample::__resample_rate );
+	}
+	return sKey;
+}
+
+QString SamplePool::key( const QString& sFilepath, const Sample::Loops& loops,
+						 const Sample::Rubberband& rubber,
+						 const Sample::VelocityEnvelope& velocity,
+						 const Sample::PanEnvelope& pan )
+{
+	QString sKey = file_key( sFilepath );
+	sKey += QString( "|loops:%1:%2:%3:%4:%5" ).arg( loops.start_frame )
+		.arg( loops.loop_frame ).arg( loops.end_frame ).arg( loops.count )
+		.arg( static_cast<int>( loops.mode ) );
+	if ( rubber.use ) {
+		// The stretch ratio is derived from the current tempo.
+		sKey += QString( "|rubber:%1:%2:%3:%4" ).arg( rubber.divider )
+			.arg( rubber.pitch ).arg( rubber.c_settings )
+			.arg( Hydrogen::get_instance()->getNewBpmJTM() );
+	}
+	sKey += "|velocity";
+	for ( const auto& pPoint : velocity ) {
+		sKey += QString( ":%1,%2" ).arg( pPoint->frame ).arg( pPoint->value );
+	}
+	sKey += "|pan";
+	for ( const auto& pPoint : pan ) {
+		sKey += QString( ":%1,%2" ).arg( pPoint->frame ).arg( pPoint->value );
+	}
+	return sKey;
+}
+
+std::shared_ptr<Sample> SamplePool::get( const QString& sKey )
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	auto it = __samples.find( sKey );
+	if ( it == __samples.end() ) {
+		return nullptr;
+	}
+	return it->second.lock();
+}
+
+std::shared_ptr<Sample> SamplePool::insert( const QString& sKey, std::shared_ptr<Sample> pSample )
+{
+	if ( pSample == nullptr ) {
+		return pSample;
+	}
+
+	std::lock_guard<std::mutex> lock( __mutex );
+	auto& pEntry = __samples[ sKey ];
+	auto pPresent = pEntry.lock();
+	if ( pPresent != nullptr ) {
+		return pPresent;
+	}
+	pEntry = pSample;
+
+	if ( __samples.size() > 2 * __purged_size + 64 ) {
+		purge();
+	}
+
+	return pSample;
+}
+
+void SamplePool::purge()
+{
+	for ( auto it = __samples.begin(); it != __samples.end(); ) {
+		if ( it->second.expired() ) {
+			it = __samples.erase( it );
+		} else {
+			++it;
+		}
+	}
+	__purged_size = __samples.size();
+}
+
+std::shared_ptr<Sample> SamplePool::load( const QString& sFilepath, bool bAllowStreaming )
+{
+	QString sKey = key( sFilepath, bAllowStreaming );
+	auto pSample = get( sKey );
+	if ( pSample != nullptr ) {
+		return pSample;
+	}
+
+	return insert( sKey, Sample::load( sFilepath, bAllowStreaming ) );
+}
+
+std::shared_ptr<Sample> SamplePool::load( const QString& sFilepath, const Sample::Loops& loops,
+										  const Sample::Rubberband& rubber,
+										  const Sample::VelocityEnvelope& velocity,
+										  const Sample::PanEnvelope& pan,
+										  bool bStretchInBackground )
+{
+	QString sKey = key( sFilepath, loops, rubber, velocity, pan );
+	auto pSample = get( sKey );
+	if ( pSample != nullptr ) {
+		return pSample;
+	}
+
+	return insert( sKey, Sample::load( sFilepath, loops, rubber, velocity, pan,
+									   bStretchInBackground ) );
+}
+
+int SamplePool::size()
+{
+	std::lock_guard<std::mutex> lock( __mutex );
+	purge();
+	return __samples.size();
+}
+
+};
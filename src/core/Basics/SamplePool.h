@@ -0,0 +1,108 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_POOL_H
+#define H2C_SAMPLE_POOL_H
+
+#include <core/Object.h>
+#include <core/Basics/Sample.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace H2Core
+{
+
+/**
+ * Process wide registry of the samples used by layers.
+ *
+ * Layers loading the same file with the same transformations, be it
+ * within a song, across different drumkits, or across the songs of a
+ * playlist, are handed the same Sample instance instead of a copy of
+ * their own. The pool does only hold weak references. An entry is
+ * evicted as soon as the last layer releases its sample.
+ *
+ * Entries are keyed by the canonical path of the file, its size and
+ * modification time, and all parameters affecting the loaded data
+ * (see key()). Samples obtained from the pool are shared and must not
+ * be altered in place. Transformations are applied to a fresh Sample
+ * instead, like the SampleEditor does.
+ */
+class SamplePool : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * Key of an unmodified sample loaded via
+		 * Sample::load( @a sFilepath, @a bAllowStreaming ).
+		 */
+		static QString key( const QString& sFilepath, bool bAllowStreaming );
+		/**
+		 * Key of a sample loaded via Sample::load() and altered by
+		 * @a loops, @a rubber, @a velocity, and @a pan.
+		 */
+		static QString key( const QString& sFilepath, const Sample::Loops& loops,
+							const Sample::Rubberband& rubber,
+							const Sample::VelocityEnvelope& velocity,
+							const Sample::PanEnvelope& pan );
+
+		/** \return Sample registered for @a sKey or nullptr if there
+			is none or it was already released.*/
+		static std::shared_ptr<Sample> get( const QString& sKey );
+		/**
+		 * Registers @a pSample for @a sKey.
+		 *
+		 * \return The sample already registered for @a sKey in case
+		 * another thread was faster, @a pSample otherwise.
+		 */
+		static std::shared_ptr<Sample> insert( const QString& sKey, std::shared_ptr<Sample> pSample );
+
+		/** Shared variant of Sample::load( @a sFilepath, @a bAllowStreaming ).*/
+		static std::shared_ptr<Sample> load( const QString& sFilepath, bool bAllowStreaming = false );
+		/** Shared variant of Sample::load() applying @a loops, @a
+			rubber, @a velocity, and @a pan.*/
+		static std::shared_ptr<Sample> load( const QString& sFilepath, const Sample::Loops& loops,
+											 const Sample::Rubberband& rubber,
+											 const Sample::VelocityEnvelope& velocity,
+											 const Sample::PanEnvelope& pan,
+											 bool bStretchInBackground = false );
+
+		/** \return Number of samples currently shared.*/
+		static int size();
+
+	private:
+		/** Identifies the file @a sFilepath and its current content.*/
+		static QString file_key( const QString& sFilepath );
+		/** Drops the entries already released. Requires #__mutex.*/
+		static void purge();
+
+		static std::mutex __mutex;
+		static std::map<QString, std::weak_ptr<Sample>> __samples;
+		/** Number of entries after the last purge().*/
+		static size_t __purged_size;
+};
+
+};
+
+#endif // H2C_SAMPLE_POOL_H
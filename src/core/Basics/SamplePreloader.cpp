@@ -0,0 +1,178 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SamplePreloader.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/SamplePool.h>
+#include <core/Helpers/Filesystem.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* SamplePreloader::__class_name = "SamplePreloader";
+
+SamplePreloader::SamplePreloader()
+	: Object( __class_name )
+	, m_bStop( false )
+{
+}
+
+SamplePreloader::~SamplePreloader()
+{
+	stop();
+}
+
+void SamplePreloader::start( const QString& sSongPath )
+{
+	stop();
+	m_bStop.store( false );
+
+	m_thread = std::thread( [=]() {
+		QElapsedTimer timer;
+		timer.start();
+
+		std::vector<QString> paths = getSongSamplePaths( sSongPath );
+		int nLoaded = 0;
+
+		for ( const auto& sPath : paths ) {
+			if ( m_bStop.load() ) {
+				return;
+			}
+
+			auto pSample = SamplePool::load( sPath, true );
+			if ( pSample == nullptr ) {
+				continue;
+			}
+			++nLoaded;
+
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_samples.push_back( pSample );
+		}
+
+		INFOLOG( QString( "Preloaded %1 of %2 samples of [%3] in %4 ms" )
+				 .arg( nLoaded ).arg( paths.size() ).arg( sSongPath )
+				 .arg( timer.elapsed() ) );
+	} );
+}
+
+void SamplePreloader::stop()
+{
+	if ( m_thread.joinable() ) {
+		m_bStop.store( true );
+		m_thread.join();
+	}
+}
+
+void SamplePreloader::wait()
+{
+	if ( m_thread.joinable() ) {
+		m_thread.join();
+	}
+}
+
+void SamplePreloader::clear()
+{
+	stop();
+
+	std::vector<std::shared_ptr<Sample>> samples;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		samples.swap( m_samples );
+	}
+	// Freed outside of the lock.
+	samples.clear();
+}
+
+std::vector<QString> SamplePreloader::getSongSamplePaths( const QString& sSongPath )
+{
+	std::vector<QString> paths;
+
+	QFile file( sSongPath );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		WARNINGLOG( QString( "Unable to open [%1]" ).arg( sSongPath ) );
+		return paths;
+	}
+
+	QXmlStreamReader reader( &file );
+	QString sDrumkitPath;
+	// Notes do refer to instruments using an element of the same
+	// name. Only the ones within the instrument list are of interest.
+	bool bInInstrumentList = false;
+	bool bInInstrument = false;
+
+	while ( ! reader.atEnd() ) {
+		reader.readNext();
+		if ( reader.isEndElement() ) {
+			if ( reader.name() == "instrument" ) {
+				bInInstrument = false;
+			} else if ( reader.name() == "instrumentList" ) {
+				bInInstrumentList = false;
+			}
+			continue;
+		}
+		if ( ! reader.isStartElement() ) {
+			continue;
+		}
+
+		if ( reader.name() == "instrumentList" ) {
+			bInInstrumentList = true;
+		} else if ( bInInstrumentList && reader.name() == "instrument" ) {
+			bInInstrument = true;
+			sDrumkitPath = "";
+		} else if ( bInInstrument && reader.name() == "drumkit" ) {
+			QString sDrumkit = reader.readElementText();
+			if ( ! sDrumkit.isEmpty() && sDrumkit != "-" ) {
+				sDrumkitPath = Filesystem::drumkit_path_search( sDrumkit,
+																Filesystem::Lookup::stacked,
+																true );
+			}
+		} else if ( bInInstrument && reader.name() == "filename" ) {
+			QString sFilename = reader.readElementText();
+			if ( sFilename.isEmpty() ) {
+				continue;
+			}
+			if ( ! QFile( sFilename ).exists() && ! sDrumkitPath.isEmpty() &&
+				 ! sFilename.startsWith( "/" ) ) {
+				sFilename = sDrumkitPath + "/" + sFilename;
+			}
+			if ( std::find( paths.begin(), paths.end(), sFilename ) == paths.end() ) {
+				paths.push_back( sFilename );
+			}
+		}
+	}
+
+	if ( reader.hasError() ) {
+		WARNINGLOG( QString( "Error while scanning [%1]: %2" )
+					.arg( sSongPath ).arg( reader.errorString() ) );
+	}
+
+	return paths;
+}
+
+};
@@ -0,0 +1,86 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_PRELOADER_H
+#define H2C_SAMPLE_PRELOADER_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Decodes the samples of a song in a background thread ahead of
+ * opening it.
+ *
+ * The song file is only scanned for the paths of its samples, which
+ * are loaded via the SamplePool the same way SongReader::readSong()
+ * does. As long as the preloader holds them, the layers of the song
+ * are handed the very same instances once it is opened.
+ */
+class SamplePreloader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		SamplePreloader();
+		/** Stops the background thread.*/
+		~SamplePreloader();
+
+		/** Starts preloading the samples of @a sSongPath. A
+			preload still running is stopped first.*/
+		void start( const QString& sSongPath );
+		/** Aborts a running preload and waits for its thread. The
+			samples loaded so far are kept.*/
+		void stop();
+		/** Blocks until a running preload finished.*/
+		void wait();
+		/** Stops and releases all samples held.*/
+		void clear();
+
+		/**
+		 * Extracts the absolute paths of all samples used in @a
+		 * sSongPath without constructing the Song itself. Relative
+		 * paths are resolved the same way SongReader::readSong()
+		 * does.
+		 */
+		static std::vector<QString> getSongSamplePaths( const QString& sSongPath );
+
+	private:
+		std::thread m_thread;
+		std::atomic<bool> m_bStop;
+		/** Protects #m_samples.*/
+		std::mutex m_mutex;
+		std::vector<std::shared_ptr<Sample>> m_samples;
+};
+
+};
+
+#endif // H2C_SAMPLE_PRELOADER_H
@@ -0,0 +1,309 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Basics/SampleStretcher.h>
+
+#include <core/AudioEngine.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+
+namespace H2Core
+{
+
+const char* SampleStretcher::__class_name = "SampleStretcher";
+
+SampleStretcher* SampleStretcher::__instance = nullptr;
+
+void SampleStretcher::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new SampleStretcher;
+	}
+}
+
+SampleStretcher::SampleStretcher()
+	: Object( __class_name )
+	, m_bQuit( false )
+	, m_bBusy( false )
+	, m_nCacheSize( 0 )
+{
+	m_worker = std::thread( &SampleStretcher::workerLoop, this );
+}
+
+SampleStretcher::~SampleStretcher()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bQuit = true;
+		m_jobs.clear();
+		m_condition.notify_all();
+	}
+	m_worker.join();
+
+	if ( __instance == this ) {
+		__instance = nullptr;
+	}
+}
+
+void SampleStretcher::stretch( std::shared_ptr<Sample> pSample )
+{
+	if ( pSample == nullptr || ! pSample->get_rubberband().use ) {
+		return;
+	}
+
+	Job job;
+	job.pTarget = pSample;
+	job.pTargetId = pSample.get();
+	job.sFilepath = pSample->get_filepath();
+	job.loops = pSample->get_loops();
+	job.rubberband = pSample->get_rubberband();
+	for ( const auto& pPoint : *pSample->get_velocity_envelope() ) {
+		job.velocity.push_back( std::make_pair( pPoint->frame, pPoint->value ) );
+	}
+	for ( const auto& pPoint : *pSample->get_pan_envelope() ) {
+		job.pan.push_back( std::make_pair( pPoint->frame, pPoint->value ) );
+	}
+	job.fBpm = Hydrogen::get_instance()->getNewBpmJTM();
+	job.bBatchMode = Preferences::get_instance()->getRubberBandBatchMode();
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for ( auto& pending : m_jobs ) {
+		if ( pending.pTargetId == job.pTargetId ) {
+			// Only the most recent tempo matters.
+			pending = std::move( job );
+			return;
+		}
+	}
+	m_jobs.push_back( std::move( job ) );
+	m_condition.notify_all();
+}
+
+void SampleStretcher::wait()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_condition.wait( lock, [&]() {
+		return m_bQuit || ( m_jobs.empty() && ! m_bBusy );
+	} );
+}
+
+void SampleStretcher::clearCache()
+{
+	std::lock_guard<std::mutex> lock( m_cacheMutex );
+	m_cache.clear();
+	m_cacheIndex.clear();
+	m_nCacheSize = 0;
+}
+
+void SampleStretcher::workerLoop()
+{
+	for ( ;; ) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_bBusy = false;
+			m_condition.notify_all();
+			m_condition.wait( lock, [&]() {
+				return m_bQuit || ! m_jobs.empty();
+			} );
+			if ( m_bQuit ) {
+				return;
+			}
+			job = std::move( m_jobs.front() );
+			m_jobs.pop_front();
+			m_bBusy = true;
+		}
+
+		if ( job.pTarget.expired() ) {
+			continue;
+		}
+
+		auto pStretched = process( job );
+		if ( pStretched == nullptr ) {
+			continue;
+		}
+
+		auto pTarget = job.pTarget.lock();
+		if ( pTarget == nullptr ) {
+			continue;
+		}
+
+		// The released data is freed when leaving the scope and thus
+		// neither within the AudioEngine lock nor in the audio
+		// thread.
+		auto pReleased = publish( pTarget, pStretched );
+	}
+}
+
+std::shared_ptr<Sample> SampleStretcher::process( const Job& job )
+{
+	QString sKey = key( job );
+
+	auto pStretched = lookup( sKey );
+	if ( pStretched != nullptr ) {
+		return pStretched;
+	}
+
+	pStretched = Sample::load( job.sFilepath );
+	if ( pStretched == nullptr ) {
+		ERRORLOG( QString( "Unable to stretch [%1]" ).arg( job.sFilepath ) );
+		return nullptr;
+	}
+
+	Sample::VelocityEnvelope velocity;
+	for ( const auto& point : job.velocity ) {
+		velocity.push_back( std::make_unique<EnvelopePoint>( point.first, point.second ) );
+	}
+	Sample::PanEnvelope pan;
+	for ( const auto& point : job.pan ) {
+		pan.push_back( std::make_unique<EnvelopePoint>( point.first, point.second ) );
+	}
+
+	pStretched->apply_loops( job.loops );
+	pStretched->apply_velocity( velocity );
+	pStretched->apply_pan( pan );
+#ifdef H2CORE_HAVE_RUBBERBAND
+	pStretched->apply_rubberband( job.rubberband, job.fBpm );
+#else
+	if ( ! pStretched->exec_rubberband_cli( job.rubberband, job.fBpm ) ) {
+		return nullptr;
+	}
+#endif
+	pStretched->detect_silence();
+
+	insert( sKey, pStretched );
+
+	// The cached instance must not be altered by the song.
+	return std::make_shared<Sample>( pStretched );
+}
+
+std::shared_ptr<Sample> SampleStretcher::publish( std::shared_ptr<Sample> pTarget,
+												  std::shared_ptr<Sample> pStretched )
+{
+	bool bReplaced = false;
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
+	// Layers holding the target get the stretched copy as a whole.
+	// This way readers outside of the AudioEngine lock, like the
+	// waveform displays, still see a consistent sample.
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong != nullptr ) {
+		InstrumentList* pInstrumentList = pSong->getInstrumentList();
+		for ( int nInstr = 0; nInstr < pInstrumentList->size(); ++nInstr ) {
+			Instrument* pInstrument = pInstrumentList->get( nInstr );
+			for ( auto& pComponent : *pInstrument->get_components() ) {
+				for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+					InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+					if ( pLayer != nullptr && pLayer->get_sample() == pTarget ) {
+						pLayer->set_sample( pStretched );
+						bReplaced = true;
+					}
+				}
+			}
+		}
+	}
+
+	if ( bReplaced ) {
+		AudioEngine::get_instance()->unlock();
+		return pTarget;
+	}
+
+	// Not part of the song (yet). The sample is held by a layer
+	// being set up or by the caller of Sample::load().
+	pTarget->swap_data( pStretched );
+
+	AudioEngine::get_instance()->unlock();
+
+	return pStretched;
+}
+
+QString SampleStretcher::key( const Job& job )
+{
+	QString sKey = QString( "%1|%2:%3:%4:%5:%6|%7:%8:%9:%10" )
+		.arg( job.sFilepath )
+		.arg( job.loops.start_frame ).arg( job.loops.loop_frame )
+		.arg( job.loops.end_frame ).arg( job.loops.count )
+		.arg( static_cast<int>( job.loops.mode ) )
+		.arg( job.rubberband.divider ).arg( job.rubberband.pitch )
+		.arg( job.rubberband.c_settings ).arg( job.bBatchMode ? 1 : 0 );
+
+	sKey.append( "|v" );
+	for ( const auto& point : job.velocity ) {
+		sKey.append( QString( ":%1,%2" ).arg( point.first ).arg( point.second ) );
+	}
+	sKey.append( "|p" );
+	for ( const auto& point : job.pan ) {
+		sKey.append( QString( ":%1,%2" ).arg( point.first ).arg( point.second ) );
+	}
+	sKey.append( QString( "|%1" ).arg( job.fBpm, 0, 'f', 3 ) );
+
+	return sKey;
+}
+
+std::shared_ptr<Sample> SampleStretcher::lookup( const QString& sKey )
+{
+	std::lock_guard<std::mutex> lock( m_cacheMutex );
+
+	auto it = m_cacheIndex.find( sKey );
+	if ( it == m_cacheIndex.end() ) {
+		return nullptr;
+	}
+
+	m_cache.splice( m_cache.begin(), m_cache, it->second );
+
+	return std::make_shared<Sample>( it->second->second );
+}
+
+void SampleStretcher::insert( const QString& sKey, std::shared_ptr<Sample> pSample )
+{
+	long long nSize = pSample->get_size();
+	if ( nSize > MAX_STRETCH_CACHE_SIZE ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( m_cacheMutex );
+
+	auto it = m_cacheIndex.find( sKey );
+	if ( it != m_cacheIndex.end() ) {
+		m_nCacheSize -= it->second->second->get_size();
+		m_cache.erase( it->second );
+		m_cacheIndex.erase( it );
+	}
+
+	while ( ! m_cache.empty() && m_nCacheSize + nSize > MAX_STRETCH_CACHE_SIZE ) {
+		m_nCacheSize -= m_cache.back().second->get_size();
+		m_cacheIndex.erase( m_cache.back().first );
+		m_cache.pop_back();
+	}
+
+	m_cache.push_front( std::make_pair( sKey, pSample ) );
+	m_cacheIndex[ sKey ] = m_cache.begin();
+	m_nCacheSize += nSize;
+}
+
+};
@@ -0,0 +1,162 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_STRETCHER_H
+#define H2C_SAMPLE_STRETCHER_H
+
+#include <core/Object.h>
+#include <core/Basics/Sample.h>
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** Maximum number of bytes of stretched sample data kept by the
+	H2Core::SampleStretcher for reuse.*/
+#define MAX_STRETCH_CACHE_SIZE ( 256 * 1024 * 1024 )
+
+namespace H2Core
+{
+
+/**
+ * Applies Rubber Band to samples in a background thread.
+ *
+ * Instead of stretching a sample in the thread loading it or handling
+ * a tempo change, stretch() does queue a job for the current tempo
+ * and returns immediately. In the meantime the sample keeps on
+ * playing its current data. As soon as the worker is done, all
+ * layers of the current song holding the sample get the stretched
+ * copy while the AudioEngine is locked. Samples not part of the song
+ * (yet), e.g. the ones of a song still being loaded, get the
+ * stretched data swapped in instead.
+ *
+ * The results are cached per source file, loop and envelope
+ * settings, Rubber Band parameters, and tempo. Switching back and
+ * forth between tempi does therefore require Rubber Band to run only
+ * once per tempo. The cache holds at most #MAX_STRETCH_CACHE_SIZE
+ * bytes and drops the least recently used results first.
+ */
+class SampleStretcher : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * If #__instance equals nullptr, a new SampleStretcher
+		 * singleton will be created and stored in #__instance.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static SampleStretcher* get_instance();
+
+		~SampleStretcher();
+
+		/**
+		 * Queues Rubber Band processing of @a pSample using its
+		 * current Sample::Rubberband parameters and the tempo
+		 * returned by Hydrogen::getNewBpmJTM().
+		 *
+		 * A job still pending for the same sample is replaced. Does
+		 * nothing if Rubber Band is not enabled for @a pSample.
+		 */
+		void stretch( std::shared_ptr<Sample> pSample );
+
+		/** Blocks until all queued jobs are done.*/
+		void wait();
+
+		/** Drops all cached results.*/
+		void clearCache();
+
+	private:
+		/** Pointer to the SampleStretcher singleton.*/
+		static SampleStretcher* __instance;
+
+		SampleStretcher();
+
+		struct Job {
+			/** Sample to hand the result to. The job is dropped if
+				it got deleted in the meantime.*/
+			std::weak_ptr<Sample> pTarget;
+			/** Only used to identify pending jobs of the same
+				sample.*/
+			Sample* pTargetId;
+			QString sFilepath;
+			Sample::Loops loops;
+			Sample::Rubberband rubberband;
+			/** Frame and value of the velocity envelope points.*/
+			std::vector<std::pair<int, int>> velocity;
+			/** Frame and value of the pan envelope points.*/
+			std::vector<std::pair<int, int>> pan;
+			float fBpm;
+			bool bBatchMode;
+		};
+
+		void workerLoop();
+		/** Loads and stretches the source of @a job or retrieves
+			it from the cache.*/
+		std::shared_ptr<Sample> process( const Job& job );
+		/** Hands @a pStretched over to @a pTarget.
+
+			\return The data not used anymore. To be freed outside
+			of the AudioEngine lock.*/
+		std::shared_ptr<Sample> publish( std::shared_ptr<Sample> pTarget,
+										 std::shared_ptr<Sample> pStretched );
+
+		/** \return Cache key of @a job.*/
+		static QString key( const Job& job );
+		/** \return Copy of the cached result for @a sKey or nullptr.*/
+		std::shared_ptr<Sample> lookup( const QString& sKey );
+		void insert( const QString& sKey, std::shared_ptr<Sample> pSample );
+
+		std::thread m_worker;
+		bool m_bQuit;
+		/** true while the worker is processing a job taken from
+			#m_jobs.*/
+		bool m_bBusy;
+		std::deque<Job> m_jobs;
+		/** Protects #m_jobs, #m_bBusy, and #m_bQuit.*/
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+
+		/** Cached results, most recently used first.*/
+		std::list<std::pair<QString, std::shared_ptr<Sample>>> m_cache;
+		std::map<QString, std::list<std::pair<QString, std::shared_ptr<Sample>>>::iterator> m_cacheIndex;
+		long long m_nCacheSize;
+		/** Protects #m_cache, #m_cacheIndex, and #m_nCacheSize.*/
+		std::mutex m_cacheMutex;
+};
+
+inline SampleStretcher* SampleStretcher::get_instance()
+{
+	return __instance;
+}
+
+};
+
+#endif
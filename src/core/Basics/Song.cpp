@@ -22,8 +22,12 @@
 
 #include "Version.h"
 
+#include <algorithm>
 #include <cassert>
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <thread>
 
 #include <core/LocalFileMng.h>
 #include <core/Preferences.h>
@@ -34,6 +38,9 @@
 #include <core/Basics/Song.h>
 #include <core/Basics/DrumkitComponent.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/DeferredSampleLoader.h>
+#include <core/Basics/SamplePool.h>
+#include <core/Basics/SongCache.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/InstrumentList.h>
@@ -44,6 +51,7 @@
 #include <core/Basics/AutomationPath.h>
 #include <core/AutomationPathSerializer.h>
 #include <core/Helpers/Xml.h>
+#include <core/Helpers/FileInfoCache.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/Hydrogen.h>
 #include <core/Sampler/Sampler.h>
@@ -52,12 +60,330 @@
 #include <core/NsmClient.h>
 #endif
 
+#include <QDataStream>
 #include <QDomDocument>
 #include <QDir>
+#include <QHash>
+#include <QXmlStreamReader>
 
 namespace
 {
 
+/** A note of the pattern list as read by parsePattern().*/
+struct NoteRecord {
+	int nInstrument = -1;
+	int nPosition = 0;
+	float fLeadLag = 0.0;
+	float fVelocity = 0.8f;
+	float fPan_L = 0.5;
+	float fPan_R = 0.5;
+	int nLength = -1;
+	float fPitch = 0.0;
+	float fProbability = 1.0;
+	QString sKey = "C0";
+	bool bNoteOff = false;
+};
+
+/** A pattern of the pattern list as read by parsePattern().
+	Instruments are resolved once the pattern is created.*/
+struct PatternRecord {
+	QString sName;
+	QString sInfo;
+	QString sCategory;
+	int nSize = -1;
+	int nDenominator = 4;
+	std::vector<NoteRecord> notes;
+};
+
+/** Reads the current <note> element of @a reader into @a note.*/
+void readNoteRecord( QXmlStreamReader& reader, NoteRecord& note )
+{
+	while ( reader.readNextStartElement() ) {
+		const QStringRef name = reader.name();
+		QString sText = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+		if ( sText.isEmpty() ) {
+			// Same as in LocalFileMng::readXmlString(): empty
+			// elements result in the default value.
+			continue;
+		}
+		if ( name == "position" ) {
+			note.nPosition = QLocale::c().toInt( sText );
+		} else if ( name == "leadlag" ) {
+			note.fLeadLag = QLocale::c().toFloat( sText );
+		} else if ( name == "velocity" ) {
+			note.fVelocity = QLocale::c().toFloat( sText );
+		} else if ( name == "pan_L" ) {
+			note.fPan_L = QLocale::c().toFloat( sText );
+		} else if ( name == "pan_R" ) {
+			note.fPan_R = QLocale::c().toFloat( sText );
+		} else if ( name == "length" ) {
+			note.nLength = QLocale::c().toInt( sText );
+		} else if ( name == "pitch" ) {
+			note.fPitch = QLocale::c().toFloat( sText );
+		} else if ( name == "probability" ) {
+			note.fProbability = QLocale::c().toFloat( sText );
+		} else if ( name == "key" ) {
+			note.sKey = sText;
+		} else if ( name == "note_off" ) {
+			note.bNoteOff = sText == "true";
+		} else if ( name == "instrument" ) {
+			note.nInstrument = QLocale::c().toInt( sText );
+		}
+	}
+}
+
+/** Reads all <note> children of the current <noteList> element of
+	@a reader.*/
+void readNoteListRecord( QXmlStreamReader& reader, std::vector<NoteRecord>& notes )
+{
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "note" ) {
+			notes.push_back( NoteRecord() );
+			readNoteRecord( reader, notes.back() );
+		} else {
+			reader.skipCurrentElement();
+		}
+	}
+}
+
+/** Reads the current <pattern> element of @a reader into
+	@a pattern. Mirrors SongReader::getPattern().*/
+void readPatternRecord( QXmlStreamReader& reader, PatternRecord& pattern )
+{
+	bool bFoundNoteList = false;
+	// Back compatibility code. Version < 0.9.4
+	std::vector<NoteRecord> sequenceNotes;
+
+	while ( reader.readNextStartElement() ) {
+		const QStringRef name = reader.name();
+		if ( name == "noteList" ) {
+			if ( bFoundNoteList ) {
+				reader.skipCurrentElement();
+				continue;
+			}
+			bFoundNoteList = true;
+			readNoteListRecord( reader, pattern.notes );
+		} else if ( name == "sequenceList" ) {
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() != "sequence" ) {
+					reader.skipCurrentElement();
+					continue;
+				}
+				while ( reader.readNextStartElement() ) {
+					if ( reader.name() == "noteList" ) {
+						readNoteListRecord( reader, sequenceNotes );
+					} else {
+						reader.skipCurrentElement();
+					}
+				}
+			}
+		} else {
+			QString sText = reader.readElementText( QXmlStreamReader::IncludeChildElements );
+			if ( sText.isEmpty() ) {
+				continue;
+			}
+			if ( name == "name" ) {
+				pattern.sName = sText;
+			} else if ( name == "info" ) {
+				pattern.sInfo = sText;
+			} else if ( name == "category" ) {
+				pattern.sCategory = sText;
+			} else if ( name == "size" ) {
+				pattern.nSize = QLocale::c().toInt( sText );
+			} else if ( name == "denominator" ) {
+				pattern.nDenominator = QLocale::c().toInt( sText );
+			}
+		}
+	}
+
+	if ( ! bFoundNoteList ) {
+		pattern.notes = std::move( sequenceNotes );
+	}
+}
+
+/** Appends the current element of @a reader, including all its
+	children, to @a parent.*/
+void copyElement( QXmlStreamReader& reader, QDomDocument& doc, QDomElement& parent )
+{
+	QDomElement element = doc.createElement( reader.name().toString() );
+	for ( const auto& attribute : reader.attributes() ) {
+		element.setAttribute( attribute.name().toString(), attribute.value().toString() );
+	}
+	parent.appendChild( element );
+
+	while ( ! reader.atEnd() ) {
+		reader.readNext();
+		if ( reader.isStartElement() ) {
+			copyElement( reader, doc, element );
+		} else if ( reader.isCharacters() && ! reader.isWhitespace() ) {
+			element.appendChild( doc.createTextNode( reader.text().toString() ) );
+		} else if ( reader.isEndElement() ) {
+			return;
+		}
+	}
+}
+
+/**
+ * Reads a song in a single forward pass.
+ *
+ * All children of the <song> element but the pattern list are put
+ * into @a doc, so the remaining code of SongReader::readSong() can
+ * handle them as usual. The patterns, making up the bulk of most
+ * songs, are only checked for being well-formed. The ranges of
+ * @a sContent holding their <pattern> elements are stored in
+ * @a patterns to be parsed by parsePatterns().
+ *
+ * \return false if @a sContent is no well-formed song or declares
+ * an encoding other than UTF-8.
+ */
+bool readSongStreamed( const QString& sContent, QDomDocument& doc, std::vector<QStringRef>& patterns )
+{
+	QXmlStreamReader reader( sContent );
+	if ( ! reader.readNextStartElement() || reader.name() != "song" ) {
+		return false;
+	}
+	// The ranges stored in patterns refer to the content as decoded
+	// by the caller.
+	if ( ! reader.documentEncoding().isEmpty() &&
+		 reader.documentEncoding().compare( QLatin1String( "UTF-8" ), Qt::CaseInsensitive ) != 0 ) {
+		return false;
+	}
+
+	QDomElement songElement = doc.createElement( "song" );
+	doc.appendChild( songElement );
+
+	bool bFoundPatternList = false;
+	while ( reader.readNextStartElement() ) {
+		if ( reader.name() == "patternList" && ! bFoundPatternList ) {
+			bFoundPatternList = true;
+			while ( reader.readNextStartElement() ) {
+				if ( reader.name() != "pattern" ) {
+					reader.skipCurrentElement();
+					continue;
+				}
+				// The reader is positioned behind the start tag.
+				int nStart = sContent.lastIndexOf( QLatin1String( "<pattern" ),
+												   reader.characterOffset() - 1 );
+				if ( nStart < 0 ) {
+					return false;
+				}
+				reader.skipCurrentElement();
+				patterns.push_back( QStringRef( &sContent, nStart,
+												reader.characterOffset() - nStart ) );
+			}
+		} else {
+			copyElement( reader, doc, songElement );
+		}
+	}
+
+	if ( reader.hasError() ) {
+		___ERRORLOG( QString( "Error reading song at line %1: %2" )
+					 .arg( reader.lineNumber() ).arg( reader.errorString() ) );
+		return false;
+	}
+
+	return true;
+}
+
+/** Upper limit of the threads used by parsePatterns().*/
+const int nMaxParserThreads = 8;
+
+/**
+ * Creates the pattern held by @a source, a single <pattern> element.
+ *
+ * \param instruments Instruments of the song by id.
+ * \return nullptr if @a source is not well-formed.
+ */
+H2Core::Pattern* parsePattern( const QStringRef& source,
+							   const QHash<int, H2Core::Instrument*>& instruments )
+{
+	QXmlStreamReader reader( source.toString() );
+	if ( ! reader.readNextStartElement() || reader.name() != "pattern" ) {
+		return nullptr;
+	}
+	PatternRecord record;
+	readPatternRecord( reader, record );
+	if ( reader.hasError() ) {
+		___ERRORLOG( QString( "Error reading pattern: %1" ).arg( reader.errorString() ) );
+		return nullptr;
+	}
+
+	H2Core::Pattern* pPattern = new H2Core::Pattern( record.sName, record.sInfo, record.sCategory,
+													 record.nSize, record.nDenominator );
+	std::vector<H2Core::Note*> notes;
+	notes.reserve( record.notes.size() );
+	for ( const auto& note : record.notes ) {
+		H2Core::Instrument* pInstrumentRef = instruments.value( note.nInstrument, nullptr );
+		if ( !pInstrumentRef ) {
+			___ERRORLOG( QString( "Instrument with ID: '%1' not found. Note skipped." ).arg( note.nInstrument ) );
+			continue;
+		}
+
+		H2Core::Note* pNote = new H2Core::Note( pInstrumentRef, note.nPosition, note.fVelocity,
+												note.fPan_L, note.fPan_R, note.nLength, note.fPitch );
+		pNote->set_key_octave( note.sKey );
+		pNote->set_lead_lag( note.fLeadLag );
+		pNote->set_note_off( note.bNoteOff );
+		pNote->set_probability( note.fProbability );
+		notes.push_back( pNote );
+	}
+	pPattern->insert_notes( notes );
+	return pPattern;
+}
+
+/**
+ * Parses the patterns found by readSongStreamed() concurrently using
+ * one thread per CPU core, the calling one included.
+ *
+ * The patterns do only refer to the instruments, which are not
+ * modified. Virtual patterns and the pattern sequence are linked by
+ * the caller afterwards.
+ *
+ * \return The patterns in the order of @a sources. Entries which
+ * could not be parsed are nullptr.
+ */
+std::vector<H2Core::Pattern*> parsePatterns( const std::vector<QStringRef>& sources,
+											 H2Core::InstrumentList* pInstrList )
+{
+	// InstrumentList::find() might rebuild its table on any thread
+	// once the id of an unrelated instrument changes. A private copy
+	// is safe to share. The first instrument of an id wins, as in
+	// find().
+	QHash<int, H2Core::Instrument*> instruments;
+	for ( int i = pInstrList->size() - 1; i >= 0; i-- ) {
+		H2Core::Instrument* pInstr = pInstrList->get( i );
+		instruments.insert( pInstr->get_id(), pInstr );
+	}
+
+	const int nPatterns = sources.size();
+	std::vector<H2Core::Pattern*> patterns( nPatterns, nullptr );
+	std::atomic<int> nNext( 0 );
+	auto parseNext = [&]() {
+		int nPattern = nNext.fetch_add( 1, std::memory_order_relaxed );
+		if ( nPattern >= nPatterns ) {
+			return false;
+		}
+		// Each thread only writes its own elements.
+		patterns[ nPattern ] = parsePattern( sources[ nPattern ], instruments );
+		return true;
+	};
+
+	int nThreads = std::min( { static_cast<int>( std::thread::hardware_concurrency() ),
+							   nMaxParserThreads, nPatterns } );
+	std::vector<std::thread> threads;
+	for ( int ii = 1; ii < nThreads; ++ii ) {
+		threads.push_back( std::thread( [&]() {
+			while ( parseNext() ) {}
+		} ) );
+	}
+	while ( parseNext() ) {}
+	for ( auto& thread : threads ) {
+		thread.join();
+	}
+
+	return patterns;
+}
+
 }//anonymous namespace
 namespace H2Core
 {
@@ -82,12 +408,18 @@ Song::Song( const QString& sName, const QString& sAuthor, float fBpm, float fVol
 	, m_bIsLoopEnabled( false )
 	, m_fHumanizeTimeValue( 0.0 )
 	, m_fHumanizeVelocityValue( 0.0 )
+	, m_nRandomSeed( 0 )
 	, m_fSwingFactor( 0.0 )
 	, m_bIsModified( false )
+	, m_nStampedModified( -1 )
+	, m_nStampedSize( -1 )
+	, m_bColumnStartTicksValid( false )
+	, m_nColumnStartTicksRevision( -1 )
 	, m_songMode( PATTERN_MODE )
 	, m_sPlaybackTrackFilename( "" )
 	, m_bPlaybackTrackEnabled( false )
 	, m_fPlaybackTrackVolume( 0.0 )
+	, m_fPlaybackTrackBpm( 0.0 )
 	, m_pVelocityAutomationPath( nullptr )
 	, m_sLicense( "" )
 	, m_actionMode( ActionMode::selectMode )
@@ -164,11 +496,31 @@ void Song::setActionMode( Song::ActionMode actionMode ) {
 }
 
 int Song::lengthInTicks() const {
-	int nSongLength = 0;
-	int nColumns = m_pPatternGroupSequence->size();
+	std::lock_guard<std::mutex> lock( m_columnStartTicksMutex );
+	updateColumnStartTicks();
+	return m_columnStartTicks.back();
+}
+
+void Song::updateColumnStartTicks() const
+{
+	int nColumns = m_pPatternGroupSequence != nullptr ?
+		m_pPatternGroupSequence->size() : 0;
+	// Adding or removing columns without marking the song as
+	// modified must not result in out of bounds indices.
+	if ( m_bColumnStartTicksValid.load() &&
+		 m_columnStartTicks.size() == static_cast<size_t>( nColumns ) + 1 ) {
+		return;
+	}
+	m_bColumnStartTicksValid.store( true );
+	static std::atomic<int> nRevisions( 0 );
+	m_nColumnStartTicksRevision.store( nRevisions.fetch_add( 1 ) );
+
+	m_columnStartTicks.resize( nColumns + 1 );
+	long nSongLength = 0;
 	// Sum the lengths of all pattern columns and use the macro
 	// MAX_NOTES in case some of them are of size zero.
 	for ( int i = 0; i < nColumns; i++ ) {
+		m_columnStartTicks[ i ] = nSongLength;
 		PatternList *pColumn = ( *m_pPatternGroupSequence )[ i ];
 		if ( pColumn->size() != 0 ) {
 			nSongLength += pColumn->longest_pattern_length();
@@ -176,7 +528,48 @@ int Song::lengthInTicks() const {
 			nSongLength += MAX_NOTES;
 		}
 	}
-    return nSongLength;
+	m_columnStartTicks[ nColumns ] = nSongLength;
+}
+
+int Song::findColumn( long nTick, int* pColumnStartTick ) const
+{
+	std::lock_guard<std::mutex> lock( m_columnStartTicksMutex );
+	updateColumnStartTicks();
+
+	if ( nTick < 0 || nTick >= m_columnStartTicks.back() ) {
+		return -1;
+	}
+
+	// First column starting after nTick. Since the first column
+	// starts at 0 it is never the first element.
+	auto it = std::upper_bound( m_columnStartTicks.begin(), m_columnStartTicks.end(), nTick );
+	--it;
+	*pColumnStartTick = *it;
+	return it - m_columnStartTicks.begin();
+}
+
+long Song::getColumnStartTick( int nColumn ) const
+{
+	std::lock_guard<std::mutex> lock( m_columnStartTicksMutex );
+	updateColumnStartTicks();
+
+	if ( nColumn < 0 ) {
+		return 0;
+	}
+	if ( nColumn >= static_cast<int>( m_columnStartTicks.size() ) ) {
+		return m_columnStartTicks.back();
+	}
+	return m_columnStartTicks[ nColumn ];
+}
+
+void Song::invalidateColumnStartTicks()
+{
+	m_bColumnStartTicksValid.store( false );
+}
+
+int Song::getColumnStartTicksRevision() const
+{
+	return m_nColumnStartTicksRevision.load();
 }
 
 	
@@ -184,7 +577,11 @@ int Song::lengthInTicks() const {
 Song* Song::load( const QString& sFilename )
 {
 	SongReader reader;
-	return reader.readSong( sFilename );
+	Song* pSong = reader.readSong( sFilename );
+	if ( pSong != nullptr ) {
+		pSong->updateFileStamp();
+	}
+	return pSong;
 }
 
 /// Save a song to file
@@ -284,8 +681,38 @@ void Song::setSwingFactor( float factor )
 	m_fSwingFactor = factor;
 }
 
+void Song::updateFileStamp()
+{
+	QFileInfo fileInfo( m_sFilename );
+	fileInfo.setCaching( false );
+	if ( ! fileInfo.exists() ) {
+		m_sStampedFilename.clear();
+		return;
+	}
+	m_sStampedFilename = fileInfo.absoluteFilePath();
+	m_nStampedModified = fileInfo.lastModified().toMSecsSinceEpoch();
+	m_nStampedSize = fileInfo.size();
+}
+
+bool Song::isFileUpToDate() const
+{
+	if ( m_bIsModified || m_sStampedFilename.isEmpty() ) {
+		return false;
+	}
+	QFileInfo fileInfo( m_sFilename );
+	fileInfo.setCaching( false );
+	return fileInfo.exists() &&
+		fileInfo.absoluteFilePath() == m_sStampedFilename &&
+		fileInfo.lastModified().toMSecsSinceEpoch() == m_nStampedModified &&
+		fileInfo.size() == m_nStampedSize;
+}
+
 void Song::setIsModified( bool bIsModified )
 {
+	// The columns or the length of their patterns might have
+	// changed.
+	invalidateColumnStartTicks();
+
 	bool Notify = false;
 
 	if( m_bIsModified != bIsModified ) {
@@ -348,19 +775,10 @@ void Song::readTempPatternList( const QString& sFilename )
 			while ( !patternName.isEmpty() && !patternNode.isNull() ) {
 				QString virtualName = patternNode.read_text( false );
 				if ( !virtualName.isEmpty() ) {
-					Pattern* pVirtualPattern = nullptr;
-					for ( unsigned i = 0; i < getPatternList()->size(); i++ ) {
-						Pattern* pat = getPatternList()->get( i );
-						if ( pPattern == nullptr && pat->get_name() == patternName ) {
-							pPattern = pat;
-						}
-						if ( pVirtualPattern == nullptr && pat->get_name() == virtualName ) {
-							pVirtualPattern = pat;
-						}
-						if ( pPattern != nullptr && pVirtualPattern != nullptr) {
-							break;
-						}
+					if ( pPattern == nullptr ) {
+						pPattern = getPatternList()->find( patternName );
 					}
+					Pattern* pVirtualPattern = getPatternList()->find( virtualName );
 					if ( pPattern == nullptr ) {
 						ERRORLOG( QString( "Invalid pattern name %1" ).arg( patternName ) );
 					}
@@ -391,14 +809,7 @@ void Song::readTempPatternList( const QString& sFilename )
 			while ( !patternNode.isNull() ) {
 				QString patternName = patternNode.read_text( false );
 				if( !patternName.isEmpty() ) {
-					Pattern* p = nullptr;
-					for ( unsigned i = 0; i < getPatternList()->size(); i++ ) {
-						Pattern* pat = getPatternList()->get( i );
-						if ( pat->get_name() == patternName ) {
-							p = pat;
-							break;
-						}
-					}
+					Pattern* p = getPatternList()->find( patternName );
 					if ( p == nullptr ) {
 						ERRORLOG( QString( "Invalid pattern name %1" ).arg( patternName ) );
 					} else {
@@ -445,67 +856,181 @@ bool Song::writeTempPatternList( const QString& sFilename )
 	return doc.write( sFilename );
 }
 
+/** Identifies the output of Song::copyInstrumentLineToBinary().*/
+static const quint32 nInstrumentLineMagic = 0x4832494c; // "H2IL"
+static const quint32 nInstrumentLineVersion = 1;
+
 QString Song::copyInstrumentLineToString( int nSelectedPattern, int nSelectedInstrument )
+{
+	return instrumentLineBinaryToString(
+		copyInstrumentLineToBinary( nSelectedPattern, nSelectedInstrument ) );
+}
+
+QByteArray Song::copyInstrumentLineToBinary( int nSelectedPattern, int nSelectedInstrument )
 {
 	Instrument *pInstr = getInstrumentList()->get( nSelectedInstrument );
 	assert( pInstr );
 
-	QDomDocument doc;
-	QDomProcessingInstruction header = doc.createProcessingInstruction( "xml", "version=\"1.0\" encoding=\"UTF-8\"");
-	doc.appendChild( header );
+	QByteArray serialized;
+	QDataStream stream( &serialized, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_5_6 );
+	stream.setFloatingPointPrecision( QDataStream::SinglePrecision );
 
-	QDomNode rootNode = doc.createElement( "instrument_line" );
-	//LIB_ID just in work to get better usability
-	//LocalFileMng::writeXmlString( &rootNode, "LIB_ID", "in_work" );
-	LocalFileMng::writeXmlString( rootNode, "author", getAuthor() );
-	LocalFileMng::writeXmlString( rootNode, "license", getLicense() );
-
-	QDomNode patternList = doc.createElement( "patternList" );
+	stream << nInstrumentLineMagic << nInstrumentLineVersion
+		   << getAuthor() << getLicense();
 
+	std::vector<Pattern*> patterns;
 	unsigned nPatterns = getPatternList()->size();
-	for ( unsigned i = 0; i < nPatterns; i++ )
-	{
+	for ( unsigned i = 0; i < nPatterns; i++ ) {
 		if (( nSelectedPattern >= 0 ) && ( nSelectedPattern != i ) ) {
 			continue;
 		}
+		patterns.push_back( getPatternList()->get( i ) );
+	}
+	stream << static_cast<quint32>( patterns.size() );
 
-		// Export pattern
-		Pattern *pPattern = getPatternList()->get( i );
-
-		QDomNode patternNode = doc.createElement( "pattern" );
-		LocalFileMng::writeXmlString( patternNode, "pattern_name", pPattern->get_name() );
-
+	for ( Pattern* pPattern : patterns ) {
 		QString category;
 		if ( pPattern->get_category().isEmpty() ) {
 			category = "No category";
 		} else {
 			category = pPattern->get_category();
 		}
+		stream << pPattern->get_name() << pPattern->get_info() << category
+			   << static_cast<qint32>( pPattern->get_length() )
+			   << static_cast<qint32>( pPattern->get_denominator() );
+
+		// Export only specified instrument. The per-instrument
+		// index avoids scanning all notes of the pattern.
+		int nNotes = 0;
+		Note* const* ppNotes =
+			pPattern->get_instrument_notes( pInstr, 0, std::numeric_limits<int>::max(), nNotes );
+		stream << static_cast<quint32>( nNotes );
+
+		for ( int nn = 0; nn < nNotes; ++nn ) {
+			Note* pNote = ppNotes[ nn ];
+			stream << static_cast<qint32>( pNote->get_position() )
+				   << pNote->get_lead_lag()
+				   << pNote->get_velocity()
+				   << pNote->get_pan_l()
+				   << pNote->get_pan_r()
+				   << pNote->get_pitch()
+				   << static_cast<qint32>( pNote->get_key() )
+				   << static_cast<qint32>( pNote->get_octave() )
+				   << static_cast<qint32>( pNote->get_length() )
+				   << static_cast<qint32>( pInstr->get_id() )
+				   << pNote->get_note_off()
+				   << pNote->get_probability();
+		}
+	}
 
-		LocalFileMng::writeXmlString( patternNode, "info", pPattern->get_info() );
-		LocalFileMng::writeXmlString( patternNode, "category", category  );
-		LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( pPattern->get_length() ) );
-		LocalFileMng::writeXmlString( patternNode, "denominator", QString("%1").arg( pPattern->get_denominator() ) );
-		QDomNode noteListNode = doc.createElement( "noteList" );
-		const Pattern::notes_t* notes = pPattern->get_notes();
-		FOREACH_NOTE_CST_IT_BEGIN_END(notes,it)
-		{
-			Note *pNote = it->second;
-			assert( pNote );
+	return serialized;
+}
 
-			// Export only specified instrument
-			if (pNote->get_instrument() == pInstr)
-			{
-				XMLNode noteNode = doc.createElement( "note" );
-				pNote->save_to( &noteNode );
-				noteListNode.appendChild( noteNode );
-			}
+/** Single note of a binary instrument line.*/
+struct InstrumentLineNote {
+	qint32 nPosition;
+	float fLeadLag;
+	float fVelocity;
+	float fPanL;
+	float fPanR;
+	float fPitch;
+	qint32 nKey;
+	qint32 nOctave;
+	qint32 nLength;
+	qint32 nInstrument;
+	bool bNoteOff;
+	float fProbability;
+};
+
+static QDataStream& operator>>( QDataStream& stream, InstrumentLineNote& note )
+{
+	return stream >> note.nPosition >> note.fLeadLag >> note.fVelocity
+				  >> note.fPanL >> note.fPanR >> note.fPitch
+				  >> note.nKey >> note.nOctave >> note.nLength
+				  >> note.nInstrument >> note.bNoteOff >> note.fProbability;
+}
+
+/** Opens a binary instrument line for reading and checks its header.*/
+static bool openInstrumentLine( QDataStream& stream, QString& sAuthor, QString& sLicense )
+{
+	stream.setVersion( QDataStream::Qt_5_6 );
+	stream.setFloatingPointPrecision( QDataStream::SinglePrecision );
+
+	quint32 nMagic = 0, nVersion = 0;
+	stream >> nMagic >> nVersion;
+	if ( nMagic != nInstrumentLineMagic || nVersion != nInstrumentLineVersion ) {
+		return false;
+	}
+	stream >> sAuthor >> sLicense;
+	return stream.status() == QDataStream::Ok;
+}
+
+QString Song::instrumentLineBinaryToString( const QByteArray& serialized )
+{
+	QDataStream stream( serialized );
+	QString sAuthor, sLicense;
+	if ( ! openInstrumentLine( stream, sAuthor, sLicense ) ) {
+		return QString();
+	}
+
+	QDomDocument doc;
+	QDomProcessingInstruction header = doc.createProcessingInstruction( "xml", "version=\"1.0\" encoding=\"UTF-8\"");
+	doc.appendChild( header );
+
+	QDomNode rootNode = doc.createElement( "instrument_line" );
+	//LIB_ID just in work to get better usability
+	//LocalFileMng::writeXmlString( &rootNode, "LIB_ID", "in_work" );
+	LocalFileMng::writeXmlString( rootNode, "author", sAuthor );
+	LocalFileMng::writeXmlString( rootNode, "license", sLicense );
+
+	QDomNode patternList = doc.createElement( "patternList" );
+
+	quint32 nPatterns = 0;
+	stream >> nPatterns;
+	for ( quint32 i = 0; i < nPatterns && stream.status() == QDataStream::Ok; i++ )
+	{
+		QString sName, sInfo, sCategory;
+		qint32 nSize = 0, nDenominator = 0;
+		quint32 nNotes = 0;
+		stream >> sName >> sInfo >> sCategory >> nSize >> nDenominator >> nNotes;
+
+		QDomNode patternNode = doc.createElement( "pattern" );
+		LocalFileMng::writeXmlString( patternNode, "pattern_name", sName );
+		LocalFileMng::writeXmlString( patternNode, "info", sInfo );
+		LocalFileMng::writeXmlString( patternNode, "category", sCategory );
+		LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( nSize ) );
+		LocalFileMng::writeXmlString( patternNode, "denominator", QString("%1").arg( nDenominator ) );
+		QDomNode noteListNode = doc.createElement( "noteList" );
+		for ( quint32 j = 0; j < nNotes && stream.status() == QDataStream::Ok; j++ ) {
+			InstrumentLineNote note;
+			stream >> note;
+
+			// Same layout as Note::save_to().
+			XMLNode noteNode = doc.createElement( "note" );
+			noteNode.write_int( "position", note.nPosition );
+			noteNode.write_float( "leadlag", note.fLeadLag );
+			noteNode.write_float( "velocity", note.fVelocity );
+			noteNode.write_float( "pan_L", note.fPanL );
+			noteNode.write_float( "pan_R", note.fPanR );
+			noteNode.write_float( "pitch", note.fPitch );
+			noteNode.write_string( "key", Note::key_to_string( static_cast<Note::Key>( note.nKey ),
+															   static_cast<Note::Octave>( note.nOctave ) ) );
+			noteNode.write_int( "length", note.nLength );
+			noteNode.write_int( "instrument", note.nInstrument );
+			noteNode.write_bool( "note_off", note.bNoteOff );
+			noteNode.write_float( "probability", note.fProbability );
+			noteListNode.appendChild( noteNode );
 		}
 		patternNode.appendChild( noteListNode );
 
 		patternList.appendChild( patternNode );
 	}
 
+	if ( stream.status() != QDataStream::Ok ) {
+		return QString();
+	}
+
 	rootNode.appendChild(patternList);
 
 	doc.appendChild( rootNode );
@@ -514,6 +1039,92 @@ QString Song::copyInstrumentLineToString( int nSelectedPattern, int nSelectedIns
 	return doc.toString();
 }
 
+Pattern* Song::createPastedPattern( QString sName, const QString& sInfo, const QString& sCategory, int nSize, bool bIsSingle, int nSelectedPattern )
+{
+	PatternList *pList = getPatternList();
+	Pattern *pSelected = ( nSelectedPattern >= 0 ) ? pList->get( nSelectedPattern ) : nullptr;
+
+	// Try to find pattern by name
+	Pattern* pat = pList->find( sName );
+
+	// If OK - check if need to add this pattern to result
+	// If there is only one pattern, we always add it to list
+	// If there is no selected pattern, we add all existing patterns to list (match by name)
+	// Otherwise we add only existing selected pattern to list (match by name)
+	if ( ! ( bIsSingle || ( ( pat != nullptr ) && ( ( nSelectedPattern < 0 ) || ( pat == pSelected ) ) ) ) ) {
+		return nullptr;
+	}
+
+	// Change name of pattern to selected pattern
+	if ( pSelected != nullptr ) {
+		sName = pSelected->get_name();
+	}
+
+	return new Pattern( sName, sInfo, sCategory, nSize );
+}
+
+bool Song::pasteInstrumentLineFromBinary( const QByteArray& serialized, int nSelectedPattern, int nSelectedInstrument, std::list<Pattern *>& pPatterns )
+{
+	QDataStream stream( serialized );
+	QString sAuthor, sLicense;
+	if ( ! openInstrumentLine( stream, sAuthor, sLicense ) ) {
+		return false;
+	}
+
+	// Get current instrument
+	Instrument *pInstr = getInstrumentList()->get( nSelectedInstrument );
+	assert( pInstr );
+
+	quint32 nPatterns = 0;
+	stream >> nPatterns;
+	bool bIsSingle = nPatterns == 1;
+
+	for ( quint32 i = 0; i < nPatterns && stream.status() == QDataStream::Ok; i++ ) {
+		QString sName, sInfo, sCategory;
+		qint32 nSize = 0, nDenominator = 0;
+		quint32 nNotes = 0;
+		stream >> sName >> sInfo >> sCategory >> nSize >> nDenominator >> nNotes;
+
+		Pattern* pat = nullptr;
+		if ( sName.length() > 0 ) {
+			pat = createPastedPattern( sName, sInfo, sCategory, nSize, bIsSingle, nSelectedPattern );
+		}
+
+		// The notes of skipped patterns have to be read nevertheless.
+		for ( quint32 j = 0; j < nNotes && stream.status() == QDataStream::Ok; j++ ) {
+			InstrumentLineNote note;
+			stream >> note;
+			if ( pat == nullptr ) {
+				continue;
+			}
+
+			Note *pNote = new Note( pInstr, note.nPosition, note.fVelocity,
+									note.fPanL, note.fPanR, note.nLength, note.fPitch );
+			pNote->set_lead_lag( note.fLeadLag );
+			pNote->set_key_octave( static_cast<Note::Key>( note.nKey ),
+								   static_cast<Note::Octave>( note.nOctave ) );
+			pNote->set_note_off( note.bNoteOff );
+			pNote->set_probability( note.fProbability );
+			pat->insert_note( pNote ); // Add note to created pattern
+		}
+
+		if ( pat != nullptr ) {
+			// Add loaded pattern to apply-list
+			pPatterns.push_back( pat );
+		}
+	}
+
+	if ( stream.status() != QDataStream::Ok ) {
+		for ( Pattern* pPattern : pPatterns ) {
+			delete pPattern;
+		}
+		pPatterns.clear();
+		return false;
+	}
+
+	return true;
+}
+
 bool Song::pasteInstrumentLineFromString( const QString& sSerialized, int nSelectedPattern, int nSelectedInstrument, std::list<Pattern *>& pPatterns )
 {
 	QDomDocument doc;
@@ -525,9 +1136,6 @@ bool Song::pasteInstrumentLineFromString( const QString& sSerialized, int nSelec
 	Instrument *pInstr = getInstrumentList()->get( nSelectedInstrument );
 	assert( pInstr );
 
-	// Get pattern list
-	PatternList *pList = getPatternList();
-	Pattern *pSelected = ( nSelectedPattern >= 0 ) ? pList->get( nSelectedPattern ) : nullptr;
 	QDomNode patternNode;
 	bool bIsNoteSelection = false;
 	bool is_single = true;
@@ -568,29 +1176,17 @@ bool Song::pasteInstrumentLineFromString( const QString& sSerialized, int nSelec
 		// Check if pattern name specified
 		if (patternName.length() > 0 || bIsNoteSelection )
 		{
-			// Try to find pattern by name
-			Pattern* pat = pList->find(patternName);
-
-			// If OK - check if need to add this pattern to result
-			// If there is only one pattern, we always add it to list
-			// If there is no selected pattern, we add all existing patterns to list (match by name)
-			// Otherwise we add only existing selected pattern to list (match by name)
-			if ((is_single) || ((pat != nullptr) && ((nSelectedPattern < 0) || (pat == pSelected))))
+			// Load additional pattern info & create pattern
+			QString sInfo;
+			sInfo = LocalFileMng::readXmlString(patternNode, "info", sInfo, false, false);
+			QString sCategory;
+			sCategory = LocalFileMng::readXmlString(patternNode, "category", sCategory, false, false);
+			int nSize = -1;
+			nSize = LocalFileMng::readXmlInt(patternNode, "size", nSize, false, false);
+
+			Pattern* pat = createPastedPattern( patternName, sInfo, sCategory, nSize, is_single, nSelectedPattern );
+			if ( pat != nullptr )
 			{
-				// Load additional pattern info & create pattern
-				QString sInfo;
-				sInfo = LocalFileMng::readXmlString(patternNode, "info", sInfo, false, false);
-				QString sCategory;
-				sCategory = LocalFileMng::readXmlString(patternNode, "category", sCategory, false, false);
-				int nSize = -1;
-				nSize = LocalFileMng::readXmlInt(patternNode, "size", nSize, false, false);
-
-				// Change name of pattern to selected pattern
-				if (pSelected != nullptr) {
-					patternName = pSelected->get_name();
-				}
-
-				pat = new Pattern( patternName, sInfo, sCategory, nSize );
 
 				// Parse pattern data
 				QDomNode pNoteListNode = patternNode.firstChildElement( "noteList" );
@@ -704,6 +1300,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2m_bIsLoopEnabled: %3\n" ).arg( sPrefix ).arg( s ).arg( m_bIsLoopEnabled ) )
 			.append( QString( "%1%2m_fHumanizeTimeValue: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fHumanizeTimeValue ) )
 			.append( QString( "%1%2m_fHumanizeVelocityValue: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fHumanizeVelocityValue ) )
+			.append( QString( "%1%2m_nRandomSeed: %3\n" ).arg( sPrefix ).arg( s ).arg( m_nRandomSeed ) )
 			.append( QString( "%1%2m_fSwingFactor: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fSwingFactor ) )
 			.append( QString( "%1%2m_bIsModified: %3\n" ).arg( sPrefix ).arg( s ).arg( m_bIsModified ) )
 			.append( QString( "%1%2m_latestRoundRobins\n" ).arg( sPrefix ).arg( s ) );
@@ -714,6 +1311,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2m_sPlaybackTrackFilename: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sPlaybackTrackFilename ) )
 			.append( QString( "%1%2m_bPlaybackTrackEnabled: %3\n" ).arg( sPrefix ).arg( s ).arg( m_bPlaybackTrackEnabled ) )
 			.append( QString( "%1%2m_fPlaybackTrackVolume: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fPlaybackTrackVolume ) )
+			.append( QString( "%1%2m_fPlaybackTrackBpm: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fPlaybackTrackBpm ) )
 			.append( QString( "%1" ).arg( m_pVelocityAutomationPath->toQString( sPrefix + s, bShort ) ) )
 			.append( QString( "%1%2m_sLicense: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sLicense ) );
 		if ( m_actionMode == ActionMode::selectMode ) {
@@ -752,6 +1350,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( ", m_bIsLoopEnabled: %1" ).arg( m_bIsLoopEnabled ) )
 			.append( QString( ", m_fHumanizeTimeValue: %1" ).arg( m_fHumanizeTimeValue ) )
 			.append( QString( ", m_fHumanizeVelocityValue: %1" ).arg( m_fHumanizeVelocityValue ) )
+			.append( QString( ", m_nRandomSeed: %1" ).arg( m_nRandomSeed ) )
 			.append( QString( ", m_fSwingFactor: %1" ).arg( m_fSwingFactor ) )
 			.append( QString( ", m_bIsModified: %1" ).arg( m_bIsModified ) )
 			.append( QString( ", m_latestRoundRobins" ) );
@@ -762,6 +1361,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( ", m_sPlaybackTrackFilename: %1" ).arg( m_sPlaybackTrackFilename ) )
 			.append( QString( ", m_bPlaybackTrackEnabled: %1" ).arg( m_bPlaybackTrackEnabled ) )
 			.append( QString( ", m_fPlaybackTrackVolume: %1" ).arg( m_fPlaybackTrackVolume ) )
+			.append( QString( ", m_fPlaybackTrackBpm: %1" ).arg( m_fPlaybackTrackBpm ) )
 			.append( QString( "%1" ).arg( m_pVelocityAutomationPath->toQString( sPrefix + s ) ) )
 			.append( QString( ", m_sLicense: %1" ).arg( m_sLicense ) );
 		if ( m_actionMode == ActionMode::selectMode ) {
@@ -787,10 +1387,41 @@ Song* SongReader::readSong( const QString& sFileName )
 		return nullptr;
 	}
 
+	bool bUseCache = Preferences::get_instance()->m_bSongCache;
+	if ( bUseCache ) {
+		Song* pCachedSong = SongCache::load( sFilename );
+		if ( pCachedSong != nullptr ) {
+			return pCachedSong;
+		}
+	}
+
 	INFOLOG( "Reading " + sFilename );
 	Song* pSong = nullptr;
 
-	QDomDocument doc = LocalFileMng::openXmlDocument( sFilename );
+	// Songs written by Hydrogen are read in a single pass. Files in
+	// TinyXML compatibility mode have to be converted first and use
+	// the DOM only.
+	QDomDocument doc;
+	QString sContent;
+	std::vector<QStringRef> patternSources;
+	bool bStreamed = false;
+	if ( ! LocalFileMng::checkTinyXMLCompatMode( sFilename ) ) {
+		QFile file( sFilename );
+		if ( file.open( QIODevice::ReadOnly ) ) {
+			sContent = QString::fromUtf8( file.readAll() );
+			// The reader drops the byte order mark, which would shift
+			// all offsets.
+			if ( sContent.startsWith( QChar( 0xFEFF ) ) ) {
+				sContent.remove( 0, 1 );
+			}
+			bStreamed = readSongStreamed( sContent, doc, patternSources );
+		}
+	}
+	if ( ! bStreamed ) {
+		patternSources.clear();
+		sContent.clear();
+		doc = LocalFileMng::openXmlDocument( sFilename );
+	}
 	QDomNodeList nodeList = doc.elementsByTagName( "song" );
 
 	if( nodeList.isEmpty() ) {
@@ -826,6 +1457,7 @@ Song* SongReader::readSong( const QString& sFileName )
 	QString sPlaybackTrack( LocalFileMng::readXmlString( songNode, "playbackTrackFilename", "" ) );
 	bool bPlaybackTrackEnabled = LocalFileMng::readXmlBool( songNode, "playbackTrackEnabled", false );
 	float fPlaybackTrackVolume = LocalFileMng::readXmlFloat( songNode, "playbackTrackVolume", 0.0 );
+	float fPlaybackTrackBpm = std::max( 0.0f, LocalFileMng::readXmlFloat( songNode, "playbackTrackBpm", 0.0, false, false ) );
 
 	Song::ActionMode actionMode;
  	int nActionMode = LocalFileMng::readXmlInt( songNode, "action_mode", 0 );
@@ -841,6 +1473,7 @@ Song* SongReader::readSong( const QString& sFileName )
 
 	float fHumanizeTimeValue = LocalFileMng::readXmlFloat( songNode, "humanize_time", 0.0 );
 	float fHumanizeVelocityValue = LocalFileMng::readXmlFloat( songNode, "humanize_velocity", 0.0 );
+	int nRandomSeed = std::max( 0, LocalFileMng::readXmlInt( songNode, "random_seed", 0, false, false ) );
 	float fSwingFactor = LocalFileMng::readXmlFloat( songNode, "swing_factor", 0.0 );
 
 	pSong = new Song( sName, sAuthor, fBpm, fVolume );
@@ -851,10 +1484,12 @@ Song* SongReader::readSong( const QString& sFileName )
 	pSong->setMode( nMode );
 	pSong->setHumanizeTimeValue( fHumanizeTimeValue );
 	pSong->setHumanizeVelocityValue( fHumanizeVelocityValue );
+	pSong->setRandomSeed( nRandomSeed );
 	pSong->setSwingFactor( fSwingFactor );
 	pSong->setPlaybackTrackFilename( sPlaybackTrack );
 	pSong->setPlaybackTrackEnabled( bPlaybackTrackEnabled );
 	pSong->setPlaybackTrackVolume( fPlaybackTrackVolume );
+	pSong->setPlaybackTrackBpm( fPlaybackTrackBpm );
 	pSong->setActionMode( actionMode );
 	
 	// pan law
@@ -925,6 +1560,9 @@ Song* SongReader::readSong( const QString& sFileName )
 
 	//  Instrument List
 	InstrumentList* pInstrList = new InstrumentList();
+	// Unmodified samples are decoded concurrently once the patterns
+	// were read too.
+	std::vector<std::pair<Instrument*, InstrumentLayer*>> loaderLayers;
 
 	QDomNode instrumentListNode = songNode.firstChildElement( "instrumentList" );
 	if ( ( ! instrumentListNode.isNull()  ) ) {
@@ -1000,6 +1638,8 @@ Song* SongReader::readSong( const QString& sFileName )
 			int iIsHiHat = LocalFileMng::readXmlInt( instrumentNode, "isHihat", -1, true );
 			int iLowerCC = LocalFileMng::readXmlInt( instrumentNode, "lower_cc", 0, true );
 			int iHigherCC = LocalFileMng::readXmlInt( instrumentNode, "higher_cc", 127, true );
+			QString sOutputBus = LocalFileMng::readXmlString( instrumentNode, "outputBus", "", true, false );
+			bool bSincInterpolation = LocalFileMng::readXmlBool( instrumentNode, "sincInterpolation", false, false );
 
 			// create a new instrument
 			Instrument* pInstrument = new Instrument( id, sName, new ADSR( fAttack, fDecay, fSustain, fRelease ) );
@@ -1025,6 +1665,8 @@ Song* SongReader::readSong( const QString& sFileName )
 			pInstrument->set_hihat_grp( iIsHiHat );
 			pInstrument->set_lower_cc( iLowerCC );
 			pInstrument->set_higher_cc( iHigherCC );
+			pInstrument->set_output_bus( sOutputBus );
+			pInstrument->set_sinc_interpolation( bSincInterpolation );
 			if ( sRead_sample_select_algo.compare("VELOCITY") == 0 ) {
 				pInstrument->set_sample_selection_alg( Instrument::VELOCITY );
 			} else if ( sRead_sample_select_algo.compare("ROUND_ROBIN") == 0 ) {
@@ -1038,6 +1680,9 @@ Song* SongReader::readSong( const QString& sFileName )
 			QString drumkitPath;
 			if ( ( !sDrumkit.isEmpty() ) && ( sDrumkit != "-" ) ) {
 				drumkitPath = Filesystem::drumkit_path_search( sDrumkit );
+				if ( ! drumkitPath.isEmpty() && FileInfoCache::get_instance() != nullptr ) {
+					FileInfoCache::get_instance()->prefetch( drumkitPath );
+				}
 			} else {
 				ERRORLOG( "Missing drumkit path" );
 			}
@@ -1049,17 +1694,17 @@ Song* SongReader::readSong( const QString& sFileName )
 				WARNINGLOG( "Using back compatibility code. sFilename node found" );
 				QString sFilename = LocalFileMng::readXmlString( instrumentNode, "filename", "" );
 
-				if ( !QFile( sFilename ).exists() && !drumkitPath.isEmpty() ) {
+				if ( !Filesystem::file_exists( sFilename, true ) && !drumkitPath.isEmpty() ) {
 					sFilename = drumkitPath + "/" + sFilename;
 				}
-				auto pSample = Sample::load( sFilename );
+				auto pSample = SamplePool::load( sFilename );
 				if ( pSample == nullptr ) {
 					// nel passaggio tra 0.8.2 e 0.9.0 il drumkit di default e' cambiato.
 					// Se fallisce provo a caricare il corrispettivo file in formato flac
 //					warningLog( "[readSong] Error loading sample: " + sFilename + " not found. Trying to load a flac..." );
 					sFilename = sFilename.left( sFilename.length() - 4 );
 					sFilename += ".flac";
-					pSample = Sample::load( sFilename );
+					pSample = SamplePool::load( sFilename );
 				}
 				if ( pSample == nullptr ) {
 					ERRORLOG( "Error loading sample: " + sFilename + " not found" );
@@ -1109,7 +1754,7 @@ Song* SongReader::readSong( const QString& sFileName )
 						float fGain = LocalFileMng::readXmlFloat( layerNode, "gain", 1.0 );
 						float fPitch = LocalFileMng::readXmlFloat( layerNode, "pitch", 0.0, false, false );
 
-						if ( !QFile( sFilename ).exists() && !drumkitPath.isEmpty() && !sFilename.startsWith("/")) {
+						if ( !Filesystem::file_exists( sFilename, true ) && !drumkitPath.isEmpty() && !sFilename.startsWith("/")) {
 							sFilename = drumkitPath + "/" + sFilename;
 						}
 
@@ -1120,8 +1765,12 @@ Song* SongReader::readSong( const QString& sFileName )
 						}
 
 						std::shared_ptr<Sample> pSample;
+						bool bDeferred = false;
 						if ( !sIsModified ) {
-							pSample = Sample::load( sFilename );
+							if ( Filesystem::file_readable( sFilename ) ) {
+								pSample = std::make_shared<Sample>( sFilename );
+								bDeferred = true;
+							}
 						} else {
 							EnvelopePoint pt;
 							int Frame = 0;
@@ -1146,7 +1795,7 @@ Song* SongReader::readSong( const QString& sFileName )
 								panNode = panNode.nextSiblingElement( "pan" );
 							}
 
-							pSample = Sample::load( sFilename, lo, ro, velocity, pan );
+							pSample = SamplePool::load( sFilename, lo, ro, velocity, pan, true );
 						}
 						if ( pSample == nullptr ) {
 							ERRORLOG( "Error loading sample: " + sFilename + " not found" );
@@ -1154,6 +1803,9 @@ Song* SongReader::readSong( const QString& sFileName )
 							pInstrument->set_missing_samples( true );
 						}
 						InstrumentLayer* pLayer = new InstrumentLayer( pSample );
+						if ( bDeferred ) {
+							loaderLayers.push_back( std::make_pair( pInstrument, pLayer ) );
+						}
 						pLayer->set_start_velocity( fMin );
 						pLayer->set_end_velocity( fMax );
 						pLayer->set_gain( fGain );
@@ -1198,7 +1850,7 @@ Song* SongReader::readSong( const QString& sFileName )
 						float fGain = LocalFileMng::readXmlFloat( layerNode, "gain", 1.0 );
 						float fPitch = LocalFileMng::readXmlFloat( layerNode, "pitch", 0.0, false, false );
 
-						if ( !QFile( sFilename ).exists() && !drumkitPath.isEmpty() ) {
+						if ( !Filesystem::file_exists( sFilename, true ) && !drumkitPath.isEmpty() ) {
 							sFilename = drumkitPath + "/" + sFilename;
 						}
 
@@ -1209,8 +1861,12 @@ Song* SongReader::readSong( const QString& sFileName )
 						}
 
 						std::shared_ptr<Sample> pSample = nullptr;
+						bool bDeferred = false;
 						if ( !sIsModified ) {
-							pSample = Sample::load( sFilename );
+							if ( Filesystem::file_readable( sFilename ) ) {
+								pSample = std::make_shared<Sample>( sFilename );
+								bDeferred = true;
+							}
 						} else {
 							int Frame = 0;
 							int Value = 0;
@@ -1234,7 +1890,7 @@ Song* SongReader::readSong( const QString& sFileName )
 								panNode = panNode.nextSiblingElement( "pan" );
 							}
 
-							pSample = Sample::load( sFilename, lo, ro, velocity, pan );
+							pSample = SamplePool::load( sFilename, lo, ro, velocity, pan, true );
 						}
 						if ( pSample == nullptr ) {
 							ERRORLOG( "Error loading sample: " + sFilename + " not found" );
@@ -1242,6 +1898,9 @@ Song* SongReader::readSong( const QString& sFileName )
 							pInstrument->set_missing_samples( true );
 						}
 						InstrumentLayer* pLayer = new InstrumentLayer( pSample );
+						if ( bDeferred ) {
+							loaderLayers.push_back( std::make_pair( pInstrument, pLayer ) );
+						}
 						pLayer->set_start_velocity( fMin );
 						pLayer->set_end_velocity( fMax );
 						pLayer->set_gain( fGain );
@@ -1261,6 +1920,7 @@ Song* SongReader::readSong( const QString& sFileName )
 		if ( instrumentList_count == 0 ) {
 			WARNINGLOG( "0 instruments?" );
 		}
+
 		pSong->setInstrumentList( pInstrList );
 	} else {
 		ERRORLOG( "Error reading song: instrumentList node not found" );
@@ -1275,25 +1935,51 @@ Song* SongReader::readSong( const QString& sFileName )
 	PatternList* pPatternList = new PatternList();
 	int pattern_count = 0;
 
-	QDomNode patternNode =  patterns.firstChildElement( "pattern" );
-	while (  !patternNode.isNull()  ) {
-		pattern_count++;
-		Pattern* pPattern = getPattern( patternNode, pInstrList );
-		if ( pPattern ) {
-			pPatternList->add( pPattern );
-		} else {
+	if ( bStreamed ) {
+		std::vector<Pattern*> parsedPatterns = parsePatterns( patternSources, pInstrList );
+		bool bFailed = std::find( parsedPatterns.begin(), parsedPatterns.end(),
+								  nullptr ) != parsedPatterns.end();
+		for ( auto pPattern : parsedPatterns ) {
+			pattern_count++;
+			if ( bFailed ) {
+				delete pPattern;
+			} else {
+				pPatternList->add( pPattern );
+			}
+		}
+		// Not needed anymore.
+		patternSources.clear();
+		sContent.clear();
+		if ( bFailed ) {
 			ERRORLOG( "Error loading pattern" );
 			delete pPatternList;
 			delete pSong;
 			return nullptr;
 		}
-		patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
+	} else {
+		QDomNode patternNode =  patterns.firstChildElement( "pattern" );
+		while (  !patternNode.isNull()  ) {
+			pattern_count++;
+			Pattern* pPattern = getPattern( patternNode, pInstrList );
+			if ( pPattern ) {
+				pPatternList->add( pPattern );
+			} else {
+				ERRORLOG( "Error loading pattern" );
+				delete pPatternList;
+				delete pSong;
+				return nullptr;
+			}
+			patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
+		}
 	}
 	if ( pattern_count == 0 ) {
 		WARNINGLOG( "0 patterns?" );
 	}
 	pSong->setPatternList( pPatternList );
 
+	DeferredSampleLoader::load_song_layers( loaderLayers, pInstrList, pPatternList,
+											pSong->getHumanizeVelocityValue() );
+
 	// Virtual Patterns
 	QDomNode  virtualPatternListNode = songNode.firstChildElement( "virtualPatternList" );
 	QDomNode virtualPatternNode = virtualPatternListNode.firstChildElement( "pattern" );
@@ -1303,31 +1989,14 @@ Song* SongReader::readSong( const QString& sFileName )
 			QString sName = "";
 			sName = LocalFileMng::readXmlString( virtualPatternNode, "name", sName );
 
-			Pattern* pCurPattern = nullptr;
-			unsigned nPatterns = pPatternList->size();
-			for ( unsigned i = 0; i < nPatterns; i++ ) {
-				Pattern* pPattern = pPatternList->get( i );
-
-				if ( pPattern->get_name() == sName ) {
-					pCurPattern = pPattern;
-					break;
-				}//if
-			}//for
+			Pattern* pCurPattern = pPatternList->find( sName );
 
 			if ( pCurPattern != nullptr ) {
 				QDomNode  virtualNode = virtualPatternNode.firstChildElement( "virtual" );
 				while (  !virtualNode.isNull()  ) {
 					QString virtName = virtualNode.firstChild().nodeValue();
 
-					Pattern* virtPattern = nullptr;
-					for ( unsigned i = 0; i < nPatterns; i++ ) {
-						Pattern* pat = pPatternList->get( i );
-
-						if ( pat->get_name() == virtName ) {
-							virtPattern = pat;
-							break;
-						}//if
-					}//for
+					Pattern* virtPattern = pPatternList->find( virtName );
 
 					if ( virtPattern != nullptr ) {
 						pCurPattern->virtual_patterns_add( virtPattern );
@@ -1358,16 +2027,7 @@ Song* SongReader::readSong( const QString& sFileName )
 		QString patId = pPatternIDNode.firstChildElement().text();
 		ERRORLOG( patId );
 
-		Pattern* pPattern = nullptr;
-		for ( unsigned i = 0; i < pPatternList->size(); i++ ) {
-			Pattern* pTmpPattern = pPatternList->get( i );
-			if ( pTmpPattern ) {
-				if ( pTmpPattern->get_name() == patId ) {
-					pPattern = pTmpPattern;
-					break;
-				}
-			}
-		}
+		Pattern* pPattern = pPatternList->find( patId );
 		if ( pPattern == nullptr ) {
 			WARNINGLOG( "patternid not found in patternSequence" );
 			pPatternIDNode = ( QDomNode ) pPatternIDNode.nextSiblingElement( "patternID" );
@@ -1390,16 +2050,7 @@ Song* SongReader::readSong( const QString& sFileName )
 		while (  !patternId.isNull()  ) {
 			QString patId = patternId.firstChild().nodeValue();
 
-			Pattern* pPattern = nullptr;
-			for ( unsigned i = 0; i < pPatternList->size(); i++ ) {
-				Pattern* pTmpPattern = pPatternList->get( i );
-				if ( pTmpPattern ) {
-					if ( pTmpPattern->get_name() == patId ) {
-						pPattern = pTmpPattern;
-						break;
-					}
-				}
-			}
+			Pattern* pPattern = pPatternList->find( patId );
 			if ( pPattern == nullptr ) {
 				WARNINGLOG( "patternid not found in patternSequence" );
 				patternId = ( QDomNode ) patternId.nextSiblingElement( "patternID" );
@@ -1473,7 +2124,8 @@ Song* SongReader::readSong( const QString& sFileName )
 		QDomNode newBPMNode = bpmTimeLine.firstChildElement( "newBPM" );
 		while( !newBPMNode.isNull() ) {
 			pTimeline->addTempoMarker( LocalFileMng::readXmlInt( newBPMNode, "BAR", 0 ),
-									   LocalFileMng::readXmlFloat( newBPMNode, "BPM", 120.0 ) );
+									   LocalFileMng::readXmlFloat( newBPMNode, "BPM", 120.0 ),
+									   LocalFileMng::readXmlBool( newBPMNode, "ramp", false, false ) );
 			newBPMNode = newBPMNode.nextSiblingElement( "newBPM" );
 		}
 	} else {
@@ -1519,6 +2171,10 @@ Song* SongReader::readSong( const QString& sFileName )
 	pSong->setIsModified( false );
 	pSong->setFilename( sFilename );
 
+	if ( bUseCache ) {
+		SongCache::store( pSong, sFilename );
+	}
+
 	return pSong;
 }
 
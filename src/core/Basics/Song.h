@@ -28,6 +28,8 @@
 #include <QDomNode>
 #include <vector>
 #include <map>
+#include <atomic>
+#include <mutex>
 
 #include <core/Object.h>
 
@@ -104,6 +106,31 @@ class Song : public H2Core::Object
 
 		/** get the length of the song, in tick units */
 		int lengthInTicks() const;
+		/**
+		 * Looks up the column of #m_pPatternGroupSequence containing
+		 * @a nTick using binary search.
+		 *
+		 * \param nTick Tick counted from the beginning of the song.
+		 * \param pColumnStartTick Set to the first tick of the found
+		 * column.
+		 * \return Index of the column or -1 if @a nTick is beyond
+		 * the end of the song or negative.
+		 */
+		int findColumn( long nTick, int* pColumnStartTick ) const;
+		/**
+		 * \param nColumn Index within #m_pPatternGroupSequence. The
+		 * number of columns yields the length of the song.
+		 * \return First tick of @a nColumn.
+		 */
+		long getColumnStartTick( int nColumn ) const;
+		/** Forces #m_columnStartTicks to be rebuilt. Called by
+			setIsModified() and setPatternGroupVector().*/
+		void invalidateColumnStartTicks();
+		/** \return Number identifying the last rebuild of the
+			column start ticks. Unique across all songs. Used by the
+			Timeline to tell whether its tempo map is still
+			valid.*/
+		int getColumnStartTicksRevision() const;
 
 		static Song* 	load( const QString& sFilename );
 		bool 			save( const QString& sFilename );
@@ -138,6 +165,13 @@ class Song : public H2Core::Object
 							
 		float			getHumanizeVelocityValue() const;
 		void			setHumanizeVelocityValue( float fValue );
+
+		/** \return Seed of the random numbers used to humanize
+			notes and to evaluate their probability. 0 if a new
+			one is chosen each time the song is loaded or
+			exported.*/
+		int				getRandomSeed() const;
+		void			setRandomSeed( int nSeed );
 							
 		float			getSwingFactor() const;
 		void			setSwingFactor( float fFactor );
@@ -147,8 +181,24 @@ class Song : public H2Core::Object
 							
 		void			setIsModified( bool bIsModified);
 		bool			getIsModified() const;
+		/**
+		 * Records the path, modification time, and size of
+		 * #m_sFilename.
+		 *
+		 * Called right after the song was read from or written to
+		 * it.
+		 */
+		void			updateFileStamp();
+		/**
+		 * \return true if the song is not modified and
+		 * #m_sFilename did not change on disk since the last call
+		 * to updateFileStamp(). Saving the song would just
+		 * reproduce the file in this case.
+		 */
+		bool			isFileUpToDate() const;
 
 		std::vector<DrumkitComponent*>* getComponents() const;
+		void			setComponents( std::vector<DrumkitComponent*>* pComponents );
 
 		AutomationPath *	getVelocityAutomationPath() const;
 
@@ -159,6 +209,21 @@ class Song : public H2Core::Object
 							
 		QString			copyInstrumentLineToString( int nSelectedPattern, int selectedInstrument );
 		bool			pasteInstrumentLineFromString( const QString& sSerialized, int nSelectedPattern, int nSelectedInstrument, std::list<Pattern *>& pPatterns );
+		/**
+		 * Compact binary counterpart of
+		 * copyInstrumentLineToString() used for copy and paste
+		 * within Hydrogen.
+		 */
+		QByteArray		copyInstrumentLineToBinary( int nSelectedPattern, int nSelectedInstrument );
+		bool			pasteInstrumentLineFromBinary( const QByteArray& serialized, int nSelectedPattern, int nSelectedInstrument, std::list<Pattern *>& pPatterns );
+		/**
+		 * Converts the output of copyInstrumentLineToBinary() into
+		 * the XML format of copyInstrumentLineToString(), e.g. for
+		 * pasting into other applications.
+		 *
+		 * \return empty string if @a serialized is not valid.
+		 */
+		static QString		instrumentLineBinaryToString( const QByteArray& serialized );
 							
 		int			getLatestRoundRobin( float fStartVelocity );
 		void			setLatestRoundRobin( float fStartVelocity, int nLatestRoundRobin );
@@ -182,6 +247,10 @@ class Song : public H2Core::Object
 		float			getPlaybackTrackVolume() const;
 		/** \param volume Sets #m_fPlaybackTrackVolume. */
 		void			setPlaybackTrackVolume( const float fVolume );
+		/** \return #m_fPlaybackTrackBpm */
+		float			getPlaybackTrackBpm() const;
+		/** \param fBpm Sets #m_fPlaybackTrackBpm. */
+		void			setPlaybackTrackBpm( const float fBpm );
 
 		/** Defines the type of user interaction experienced in the 
 			SongEditor.*/
@@ -216,6 +285,13 @@ class Song : public H2Core::Object
 		QString toQString( const QString& sPrefix, bool bShort = true ) const override;
 
 	private:
+		/**
+		 * Creates the pattern the notes of a pasted instrument line
+		 * pattern called @a sName are added to.
+		 *
+		 * \return nullptr if the pattern is not to be pasted.
+		 */
+		Pattern*		createPastedPattern( QString sName, const QString& sInfo, const QString& sCategory, int nSize, bool bIsSingle, int nSelectedPattern );
 
 		bool m_bIsMuted;
 		///< Resolution of the song (number of ticks per quarter)
@@ -252,8 +328,29 @@ class Song : public H2Core::Object
 		bool			m_bIsLoopEnabled;
 		float			m_fHumanizeTimeValue;
 		float			m_fHumanizeVelocityValue;
+		/** See getRandomSeed().*/
+		int				m_nRandomSeed;
 		float			m_fSwingFactor;
 		bool			m_bIsModified;
+		/** Absolute path, modification time (in ms since epoch),
+			and size of the file recorded by updateFileStamp().*/
+		QString			m_sStampedFilename;
+		qint64			m_nStampedModified;
+		qint64			m_nStampedSize;
+		/** First tick of each column of #m_pPatternGroupSequence
+			followed by the length of the song. Rebuilt on demand by
+			updateColumnStartTicks() since the columns and the
+			lengths of their patterns are edited in many places,
+			which all mark the song as modified.*/
+		mutable std::vector<long> m_columnStartTicks;
+		mutable std::atomic<bool> m_bColumnStartTicksValid;
+		mutable std::atomic<int> m_nColumnStartTicksRevision;
+		/** Protects #m_columnStartTicks, since the GUI and the audio
+			engine both look up positions.*/
+		mutable std::mutex m_columnStartTicksMutex;
+		/** Rebuilds #m_columnStartTicks if required. Has to be
+			called with #m_columnStartTicksMutex locked.*/
+		void updateColumnStartTicks() const;
 		std::map< float, int> 	m_latestRoundRobins;
 		SongMode		m_songMode;
 		
@@ -284,6 +381,14 @@ class Song : public H2Core::Object
 		 * Sampler::reinitialize_playback_track().
 		 */
 		float			m_fPlaybackTrackVolume;
+		/** Tempo the playback track was recorded in.
+		 *
+		 * If set, the Sampler stretches the track in realtime so it
+		 * follows the tempo of the song and its timeline (requires
+		 * #H2CORE_HAVE_RUBBERBAND). 0 plays the track at its
+		 * original speed.
+		 */
+		float			m_fPlaybackTrackBpm;
 		AutomationPath*		m_pVelocityAutomationPath;
 		///< license of the song
 		QString			m_sLicense;
@@ -389,6 +494,7 @@ inline const std::vector<PatternList*>* Song::getPatternGroupVector() const
 inline void Song::setPatternGroupVector( std::vector<PatternList*>* pGroupVector )
 {
 	m_pPatternGroupSequence = pGroupVector;
+	invalidateColumnStartTicks();
 }
 
 inline void Song::setNotes( const QString& sNotes )
@@ -461,6 +567,16 @@ inline void Song::setHumanizeVelocityValue( float fValue )
 	m_fHumanizeVelocityValue = fValue;
 }
 
+inline int Song::getRandomSeed() const
+{
+	return m_nRandomSeed;
+}
+
+inline void Song::setRandomSeed( int nSeed )
+{
+	m_nRandomSeed = nSeed;
+}
+
 inline float Song::getSwingFactor() const
 {
 	return m_fSwingFactor;
@@ -481,6 +597,11 @@ inline std::vector<DrumkitComponent*>* Song::getComponents() const
 	return m_pComponents;
 }
 
+inline void Song::setComponents( std::vector<DrumkitComponent*>* pComponents )
+{
+	m_pComponents = pComponents;
+}
+
 inline AutomationPath* Song::getVelocityAutomationPath() const
 {
 	return m_pVelocityAutomationPath;
@@ -533,6 +654,16 @@ inline void Song::setPlaybackTrackVolume( const float fVolume )
 	m_fPlaybackTrackVolume = fVolume;
 }
 
+inline float Song::getPlaybackTrackBpm() const
+{
+	return m_fPlaybackTrackBpm;
+}
+
+inline void Song::setPlaybackTrackBpm( const float fBpm )
+{
+	m_fPlaybackTrackBpm = fBpm;
+}
+
 inline Song::ActionMode Song::getActionMode() const {
 	return m_actionMode;
 }
@@ -0,0 +1,756 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "Version.h"
+#include <core/config.h>
+#include <core/Basics/SongCache.h>
+#include <core/Basics/Adsr.h>
+#include <core/Basics/AutomationPath.h>
+#include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/DeferredSampleLoader.h>
+#include <core/Basics/SamplePool.h>
+#include <core/Basics/Song.h>
+#include <core/FX/Effects.h>
+#include <core/FX/LadspaFX.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences.h>
+#include <core/Timeline.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace H2Core
+{
+
+const char* SongCache::__class_name = "SongCache";
+
+static const quint32 nCacheMagic = 0x48325347; // "H2SG"
+/** Has to be increased whenever the layout or the content read by
+	SongReader::readSong() does change.*/
+static const quint32 nCacheVersion = 3;
+
+/** A layer whose sample is loaded once the whole entry was read
+	successfully.*/
+struct PendingLayer {
+	Instrument* pInstrument;
+	InstrumentLayer* pLayer;
+	QString sFilepath;
+	bool bIsModified;
+	Sample::Loops loops;
+	Sample::Rubberband rubberband;
+	std::vector<std::pair<qint32, qint32>> velocity;
+	std::vector<std::pair<qint32, qint32>> pan;
+};
+
+/** LADSPA effect applied once the whole entry was read
+	successfully.*/
+struct PendingFX {
+	bool bPresent;
+	QString sLabel;
+	QString sLibraryPath;
+	bool bEnabled;
+	float fVolume;
+	std::vector<std::pair<QString, float>> ports;
+};
+
+static void writeEnvelope( QDataStream& stream, const Sample::VelocityEnvelope& envelope )
+{
+	stream << static_cast<qint32>( envelope.size() );
+	for ( const auto& pPoint : envelope ) {
+		stream << static_cast<qint32>( pPoint->frame ) << static_cast<qint32>( pPoint->value );
+	}
+}
+
+static void readEnvelope( QDataStream& stream, std::vector<std::pair<qint32, qint32>>& envelope )
+{
+	qint32 nPoints = 0;
+	stream >> nPoints;
+	for ( int ii = 0; ii < nPoints && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nFrame, nValue;
+		stream >> nFrame >> nValue;
+		envelope.push_back( std::make_pair( nFrame, nValue ) );
+	}
+}
+
+static void fillEnvelope( const std::vector<std::pair<qint32, qint32>>& points,
+						  Sample::VelocityEnvelope& envelope )
+{
+	for ( const auto& point : points ) {
+		envelope.push_back( std::make_unique<EnvelopePoint>( point.first, point.second ) );
+	}
+}
+
+QString SongCache::cache_path( const QString& sFilename )
+{
+	QByteArray hash = QCryptographicHash::hash( sFilename.toUtf8(),
+												QCryptographicHash::Sha1 );
+	return Filesystem::songs_cache_dir() + QString( hash.toHex() ) + ".h2sg";
+}
+
+Song* SongCache::load( const QString& sFilename )
+{
+	QFileInfo fileInfo( sFilename );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+
+	QFile file( cache_path( sAbsolutePath ) );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		// Not cached yet.
+		return nullptr;
+	}
+
+	// The mapping is released when closing the file.
+	qint64 nSize = file.size();
+	uchar* pAddress = file.map( 0, nSize );
+	if ( pAddress == nullptr ) {
+		WARNINGLOG( QString( "Unable to map cache of %1" ).arg( sAbsolutePath ) );
+		return nullptr;
+	}
+	QByteArray data = QByteArray::fromRawData( reinterpret_cast<const char*>( pAddress ), nSize );
+	QDataStream stream( data );
+	stream.setVersion( QDataStream::Qt_5_0 );
+	stream.setFloatingPointPrecision( QDataStream::SinglePrecision );
+
+	quint32 nMagic = 0, nVersion = 0;
+	qint32 nMaxFX = 0;
+	qint64 nModified = 0, nFileSize = 0;
+	QString sVersion, sPath;
+	stream >> nMagic >> nVersion >> sVersion >> nMaxFX >> nModified >> nFileSize >> sPath;
+	if ( stream.status() != QDataStream::Ok ||
+		 nMagic != nCacheMagic ||
+		 nVersion != nCacheVersion ||
+		 sVersion != QString( get_version().c_str() ) ||
+		 nMaxFX != MAX_FX ||
+		 nModified != fileInfo.lastModified().toMSecsSinceEpoch() ||
+		 nFileSize != fileInfo.size() ||
+		 sPath != sAbsolutePath ) {
+		// Outdated. It will be replaced once the XML was read.
+		return nullptr;
+	}
+
+	INFOLOG( "Reading cached " + sAbsolutePath );
+
+	Song* pSong = read_song( stream );
+	if ( pSong != nullptr ) {
+		pSong->setIsModified( false );
+		pSong->setFilename( sFilename );
+	}
+
+	return pSong;
+}
+
+void SongCache::store( Song* pSong, const QString& sFilename )
+{
+	if ( pSong == nullptr || pSong->hasMissingSamples() ||
+		 ! QDir( Filesystem::songs_cache_dir() ).exists() ) {
+		return;
+	}
+
+	QFileInfo fileInfo( sFilename );
+	QString sAbsolutePath = fileInfo.absoluteFilePath();
+
+	QByteArray data;
+	QDataStream stream( &data, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_5_0 );
+	stream.setFloatingPointPrecision( QDataStream::SinglePrecision );
+
+	stream << nCacheMagic << nCacheVersion << QString( get_version().c_str() )
+		   << static_cast<qint32>( MAX_FX )
+		   << static_cast<qint64>( fileInfo.lastModified().toMSecsSinceEpoch() )
+		   << static_cast<qint64>( fileInfo.size() ) << sAbsolutePath;
+	write_song( stream, pSong );
+
+	// Written to a temporary file first, and renamed on commit(), so
+	// other instances do never map an incomplete entry.
+	QSaveFile file( cache_path( sAbsolutePath ) );
+	if ( ! file.open( QIODevice::WriteOnly ) ||
+		 file.write( data ) != data.size() ||
+		 ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to cache %1: %2" )
+					.arg( sAbsolutePath ).arg( file.errorString() ) );
+	}
+}
+
+void SongCache::write_song( QDataStream& stream, Song* pSong )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+
+	stream << pSong->getBpm() << pSong->getVolume() << pSong->getMetronomeVolume()
+		   << pSong->getName() << pSong->getAuthor() << pSong->getNotes() << pSong->getLicense()
+		   << pSong->getIsLoopEnabled()
+		   << Preferences::get_instance()->patternModePlaysSelected()
+		   << static_cast<qint32>( pSong->getMode() )
+		   << pSong->getPlaybackTrackFilename() << pSong->getPlaybackTrackEnabled()
+		   << pSong->getPlaybackTrackVolume() << pSong->getPlaybackTrackBpm()
+		   << static_cast<qint32>( pSong->getActionMode() )
+		   << pSong->getHumanizeTimeValue() << pSong->getHumanizeVelocityValue()
+		   << static_cast<qint32>( pSong->getRandomSeed() ) << pSong->getSwingFactor()
+		   << static_cast<qint32>( pSong->getPanLawType() ) << pSong->getPanLawKNorm()
+		   << pHydrogen->getCurrentDrumkitName()
+		   << static_cast<qint32>( pHydrogen->getCurrentDrumkitLookup() );
+
+	// Drumkit components
+	auto pComponents = pSong->getComponents();
+	stream << static_cast<qint32>( pComponents->size() );
+	for ( const auto& pComponent : *pComponents ) {
+		stream << static_cast<qint32>( pComponent->get_id() ) << pComponent->get_name()
+			   << pComponent->get_volume();
+	}
+
+	// Instruments
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	stream << static_cast<qint32>( pInstrumentList->size() );
+	for ( int nInstr = 0; nInstr < pInstrumentList->size(); ++nInstr ) {
+		Instrument* pInstrument = pInstrumentList->get( nInstr );
+		ADSR* pADSR = pInstrument->get_adsr();
+
+		stream << static_cast<qint32>( pInstrument->get_id() ) << pInstrument->get_name()
+			   << pInstrument->get_drumkit_name() << pInstrument->get_volume()
+			   << pInstrument->is_muted() << pInstrument->is_soloed()
+			   << pInstrument->get_pan_l() << pInstrument->get_pan_r();
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			stream << pInstrument->get_fx_level( nFX );
+		}
+		stream << pInstrument->get_gain()
+			   << static_cast<quint32>( pADSR->get_attack() )
+			   << static_cast<quint32>( pADSR->get_decay() )
+			   << pADSR->get_sustain()
+			   << static_cast<quint32>( pADSR->get_release() )
+			   << pInstrument->get_pitch_offset() << pInstrument->get_random_pitch_factor()
+			   << pInstrument->get_apply_velocity() << pInstrument->is_filter_active()
+			   << pInstrument->get_filter_cutoff() << pInstrument->get_filter_resonance()
+			   << static_cast<qint32>( pInstrument->get_mute_group() )
+			   << static_cast<qint32>( pInstrument->get_midi_out_channel() )
+			   << static_cast<qint32>( pInstrument->get_midi_out_note() )
+			   << pInstrument->is_stop_notes()
+			   << static_cast<qint32>( pInstrument->get_hihat_grp() )
+			   << static_cast<qint32>( pInstrument->get_lower_cc() )
+			   << static_cast<qint32>( pInstrument->get_higher_cc() )
+			   << static_cast<qint32>( pInstrument->sample_selection_alg() );
+
+		auto pInstrumentComponents = pInstrument->get_components();
+		stream << static_cast<qint32>( pInstrumentComponents->size() );
+		for ( const auto& pComponent : *pInstrumentComponents ) {
+			std::vector<int> layers;
+			for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				if ( pLayer != nullptr && pLayer->get_sample() != nullptr ) {
+					layers.push_back( nLayer );
+				}
+			}
+
+			stream << static_cast<qint32>( pComponent->get_drumkit_componentID() )
+				   << pComponent->get_gain() << static_cast<qint32>( layers.size() );
+			for ( int nLayer : layers ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				auto pSample = pLayer->get_sample();
+				Sample::Loops loops = pSample->get_loops();
+				Sample::Rubberband rubberband = pSample->get_rubberband();
+
+				stream << static_cast<qint32>( nLayer )
+					   << pLayer->get_start_velocity() << pLayer->get_end_velocity()
+					   << pLayer->get_gain() << pLayer->get_pitch()
+					   << pSample->get_filepath() << pSample->get_is_modified()
+					   << static_cast<qint32>( loops.start_frame )
+					   << static_cast<qint32>( loops.loop_frame )
+					   << static_cast<qint32>( loops.end_frame )
+					   << static_cast<qint32>( loops.count )
+					   << static_cast<qint32>( loops.mode )
+					   << rubberband.use << rubberband.divider << rubberband.pitch
+					   << static_cast<qint32>( rubberband.c_settings );
+				writeEnvelope( stream, *pSample->get_velocity_envelope() );
+				writeEnvelope( stream, *pSample->get_pan_envelope() );
+			}
+		}
+	}
+
+	// Patterns
+	PatternList* pPatternList = pSong->getPatternList();
+	stream << static_cast<qint32>( pPatternList->size() );
+	for ( int nPattern = 0; nPattern < pPatternList->size(); ++nPattern ) {
+		Pattern* pPattern = pPatternList->get( nPattern );
+		const Pattern::notes_t* pNotes = pPattern->get_notes();
+
+		stream << pPattern->get_name() << pPattern->get_info() << pPattern->get_category()
+			   << static_cast<qint32>( pPattern->get_length() )
+			   << static_cast<qint32>( pPattern->get_denominator() )
+			   << static_cast<qint32>( pNotes->size() );
+		for ( const auto& it : *pNotes ) {
+			Note* pNote = it.second;
+			stream << static_cast<qint32>( pNote->get_instrument()->get_id() )
+				   << static_cast<qint32>( pNote->get_position() )
+				   << pNote->get_lead_lag() << pNote->get_velocity()
+				   << pNote->get_pan_l() << pNote->get_pan_r()
+				   << static_cast<qint32>( pNote->get_length() )
+				   << pNote->get_pitch() << pNote->get_probability()
+				   << pNote->key_to_string() << pNote->get_note_off();
+		}
+	}
+
+	// Virtual patterns
+	for ( int nPattern = 0; nPattern < pPatternList->size(); ++nPattern ) {
+		const Pattern::virtual_patterns_t* pVirtualPatterns =
+			pPatternList->get( nPattern )->get_virtual_patterns();
+		stream << static_cast<qint32>( pVirtualPatterns->size() );
+		for ( const auto& pVirtualPattern : *pVirtualPatterns ) {
+			stream << static_cast<qint32>( pPatternList->index( pVirtualPattern ) );
+		}
+	}
+
+	// Pattern sequence
+	auto pPatternGroups = pSong->getPatternGroupVector();
+	stream << static_cast<qint32>( pPatternGroups->size() );
+	for ( const auto& pGroup : *pPatternGroups ) {
+		stream << static_cast<qint32>( pGroup->size() );
+		for ( int nPattern = 0; nPattern < pGroup->size(); ++nPattern ) {
+			stream << static_cast<qint32>( pPatternList->index( pGroup->get( nPattern ) ) );
+		}
+	}
+
+	// LADSPA FX
+	stream << static_cast<qint32>( MAX_FX );
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+#ifdef H2CORE_HAVE_LADSPA
+		LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX != nullptr ) {
+			stream << true << pFX->getPluginLabel() << pFX->getLibraryPath()
+				   << pFX->isEnabled() << pFX->getVolume()
+				   << static_cast<qint32>( pFX->inputControlPorts.size() );
+			for ( const auto& pPort : pFX->inputControlPorts ) {
+				stream << QString( pPort->sName ) << pPort->fControlValue;
+			}
+			continue;
+		}
+#endif
+		stream << false;
+	}
+
+	// Timeline
+	Timeline* pTimeline = pHydrogen->getTimeline();
+	auto tempoMarkers = pTimeline->getAllTempoMarkers();
+	stream << static_cast<qint32>( tempoMarkers.size() );
+	for ( const auto& pTempoMarker : tempoMarkers ) {
+		stream << static_cast<qint32>( pTempoMarker->nBar ) << pTempoMarker->fBpm;
+	}
+	auto tags = pTimeline->getAllTags();
+	stream << static_cast<qint32>( tags.size() );
+	for ( const auto& pTag : tags ) {
+		stream << static_cast<qint32>( pTag->nBar ) << pTag->sTag;
+	}
+
+	// Automation paths
+	AutomationPath* pPath = pSong->getVelocityAutomationPath();
+	qint32 nPoints = 0;
+	for ( auto it = pPath->begin(); it != pPath->end(); ++it ) {
+		++nPoints;
+	}
+	stream << nPoints;
+	for ( auto it = pPath->begin(); it != pPath->end(); ++it ) {
+		stream << it->first << it->second;
+	}
+}
+
+Song* SongCache::read_song( QDataStream& stream )
+{
+	float fBpm, fVolume, fMetronomeVolume, fPlaybackTrackVolume, fPlaybackTrackBpm;
+	float fHumanizeTimeValue, fHumanizeVelocityValue, fSwingFactor, fPanLawKNorm;
+	QString sName, sAuthor, sNotes, sLicense, sPlaybackTrack, sDrumkit;
+	bool bLoopEnabled, bPatternModePlaysSelected, bPlaybackTrackEnabled;
+	qint32 nMode, nActionMode, nPanLawType, nLookup, nRandomSeed;
+
+	stream >> fBpm >> fVolume >> fMetronomeVolume
+		   >> sName >> sAuthor >> sNotes >> sLicense
+		   >> bLoopEnabled >> bPatternModePlaysSelected >> nMode
+		   >> sPlaybackTrack >> bPlaybackTrackEnabled >> fPlaybackTrackVolume >> fPlaybackTrackBpm
+		   >> nActionMode >> fHumanizeTimeValue >> fHumanizeVelocityValue >> nRandomSeed >> fSwingFactor
+		   >> nPanLawType >> fPanLawKNorm >> sDrumkit >> nLookup;
+	if ( stream.status() != QDataStream::Ok ) {
+		return nullptr;
+	}
+
+	Song* pSong = new Song( sName, sAuthor, fBpm, fVolume );
+	pSong->setMetronomeVolume( fMetronomeVolume );
+	pSong->setNotes( sNotes );
+	pSong->setLicense( sLicense );
+	pSong->setIsLoopEnabled( bLoopEnabled );
+	pSong->setMode( static_cast<Song::SongMode>( nMode ) );
+	pSong->setHumanizeTimeValue( fHumanizeTimeValue );
+	pSong->setHumanizeVelocityValue( fHumanizeVelocityValue );
+	pSong->setRandomSeed( nRandomSeed );
+	pSong->setSwingFactor( fSwingFactor );
+	pSong->setPlaybackTrackFilename( sPlaybackTrack );
+	pSong->setPlaybackTrackEnabled( bPlaybackTrackEnabled );
+	pSong->setPlaybackTrackVolume( fPlaybackTrackVolume );
+	pSong->setPlaybackTrackBpm( fPlaybackTrackBpm );
+	pSong->setActionMode( static_cast<Song::ActionMode>( nActionMode ) );
+	pSong->setPanLawType( nPanLawType );
+	pSong->setPanLawKNorm( fPanLawKNorm );
+
+	// Drumkit components
+	qint32 nComponents = 0;
+	stream >> nComponents;
+	for ( int ii = 0; ii < nComponents && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nId;
+		QString sComponentName;
+		float fComponentVolume;
+		stream >> nId >> sComponentName >> fComponentVolume;
+
+		DrumkitComponent* pDrumkitComponent = new DrumkitComponent( nId, sComponentName );
+		pDrumkitComponent->set_volume( fComponentVolume );
+		pSong->getComponents()->push_back( pDrumkitComponent );
+	}
+
+	// Instruments
+	InstrumentList* pInstrList = new InstrumentList();
+	pSong->setInstrumentList( pInstrList );
+	std::vector<PendingLayer> pendingLayers;
+
+	qint32 nInstruments = 0;
+	stream >> nInstruments;
+	for ( int ii = 0; ii < nInstruments && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nId, nMuteGroup, nMidiOutChannel, nMidiOutNote, nHihat, nLowerCC, nHigherCC, nAlgo;
+		QString sInstrName, sInstrDrumkit;
+		float fInstrVolume, fPan_L, fPan_R, fGain, fSustain, fPitchOffset, fRandomPitchFactor;
+		float fCutoff, fResonance;
+		float fFXLevel[ MAX_FX ];
+		quint32 nAttack, nDecay, nRelease;
+		bool bMuted, bSoloed, bApplyVelocity, bFilterActive, bStopNotes;
+
+		stream >> nId >> sInstrName >> sInstrDrumkit >> fInstrVolume
+			   >> bMuted >> bSoloed >> fPan_L >> fPan_R;
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			stream >> fFXLevel[ nFX ];
+		}
+		stream >> fGain >> nAttack >> nDecay >> fSustain >> nRelease
+			   >> fPitchOffset >> fRandomPitchFactor >> bApplyVelocity >> bFilterActive
+			   >> fCutoff >> fResonance >> nMuteGroup >> nMidiOutChannel >> nMidiOutNote
+			   >> bStopNotes >> nHihat >> nLowerCC >> nHigherCC >> nAlgo;
+
+		Instrument* pInstrument = new Instrument( nId, sInstrName,
+												  new ADSR( nAttack, nDecay, fSustain, nRelease ) );
+		pInstrument->set_volume( fInstrVolume );
+		pInstrument->set_muted( bMuted );
+		pInstrument->set_soloed( bSoloed );
+		pInstrument->set_pan_l( fPan_L );
+		pInstrument->set_pan_r( fPan_R );
+		pInstrument->set_drumkit_name( sInstrDrumkit );
+		pInstrument->set_apply_velocity( bApplyVelocity );
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			pInstrument->set_fx_level( fFXLevel[ nFX ], nFX );
+		}
+		pInstrument->set_pitch_offset( fPitchOffset );
+		pInstrument->set_random_pitch_factor( fRandomPitchFactor );
+		pInstrument->set_filter_active( bFilterActive );
+		pInstrument->set_filter_cutoff( fCutoff );
+		pInstrument->set_filter_resonance( fResonance );
+		pInstrument->set_gain( fGain );
+		pInstrument->set_mute_group( nMuteGroup );
+		pInstrument->set_stop_notes( bStopNotes );
+		pInstrument->set_hihat_grp( nHihat );
+		pInstrument->set_lower_cc( nLowerCC );
+		pInstrument->set_higher_cc( nHigherCC );
+		pInstrument->set_sample_selection_alg( static_cast<Instrument::SampleSelectionAlgo>( nAlgo ) );
+		pInstrument->set_midi_out_channel( nMidiOutChannel );
+		pInstrument->set_midi_out_note( nMidiOutNote );
+		pInstrList->add( pInstrument );
+
+		qint32 nInstrComponents = 0;
+		stream >> nInstrComponents;
+		for ( int jj = 0; jj < nInstrComponents && stream.status() == QDataStream::Ok; ++jj ) {
+			qint32 nComponentId, nLayers;
+			float fComponentGain;
+			stream >> nComponentId >> fComponentGain >> nLayers;
+
+			InstrumentComponent* pCompo = new InstrumentComponent( nComponentId );
+			pCompo->set_gain( fComponentGain );
+			pInstrument->get_components()->push_back( pCompo );
+
+			for ( int kk = 0; kk < nLayers && stream.status() == QDataStream::Ok; ++kk ) {
+				qint32 nLayer, nStart, nLoop, nEnd, nCount, nLoopMode, nCSettings;
+				float fMin, fMax, fLayerGain, fPitch;
+				PendingLayer pending;
+
+				stream >> nLayer >> fMin >> fMax >> fLayerGain >> fPitch
+					   >> pending.sFilepath >> pending.bIsModified
+					   >> nStart >> nLoop >> nEnd >> nCount >> nLoopMode
+					   >> pending.rubberband.use >> pending.rubberband.divider
+					   >> pending.rubberband.pitch >> nCSettings;
+				readEnvelope( stream, pending.velocity );
+				readEnvelope( stream, pending.pan );
+				if ( nLayer < 0 || nLayer >= InstrumentComponent::getMaxLayers() ) {
+					stream.setStatus( QDataStream::ReadCorruptData );
+					break;
+				}
+
+				pending.loops.start_frame = nStart;
+				pending.loops.loop_frame = nLoop;
+				pending.loops.end_frame = nEnd;
+				pending.loops.count = nCount;
+				pending.loops.mode = static_cast<Sample::Loops::LoopMode>( nLoopMode );
+				pending.rubberband.c_settings = nCSettings;
+
+				InstrumentLayer* pLayer = new InstrumentLayer( nullptr );
+				pLayer->set_start_velocity( fMin );
+				pLayer->set_end_velocity( fMax );
+				pLayer->set_gain( fLayerGain );
+				pLayer->set_pitch( fPitch );
+				pCompo->set_layer( pLayer, nLayer );
+
+				pending.pInstrument = pInstrument;
+				pending.pLayer = pLayer;
+				pendingLayers.push_back( std::move( pending ) );
+			}
+		}
+	}
+
+	// Patterns
+	PatternList* pPatternList = new PatternList();
+	pSong->setPatternList( pPatternList );
+
+	qint32 nPatterns = 0;
+	stream >> nPatterns;
+	for ( int ii = 0; ii < nPatterns && stream.status() == QDataStream::Ok; ++ii ) {
+		QString sPatternName, sInfo, sCategory;
+		qint32 nLength, nDenominator, nNotes;
+		stream >> sPatternName >> sInfo >> sCategory >> nLength >> nDenominator >> nNotes;
+
+		Pattern* pPattern = new Pattern( sPatternName, sInfo, sCategory, nLength, nDenominator );
+		pPatternList->add( pPattern );
+
+		for ( int jj = 0; jj < nNotes && stream.status() == QDataStream::Ok; ++jj ) {
+			qint32 nInstrId, nPosition, nNoteLength;
+			float fLeadLag, fVelocity, fPan_L, fPan_R, fPitch, fProbability;
+			QString sKey;
+			bool bNoteOff;
+			stream >> nInstrId >> nPosition >> fLeadLag >> fVelocity >> fPan_L >> fPan_R
+				   >> nNoteLength >> fPitch >> fProbability >> sKey >> bNoteOff;
+
+			Instrument* pInstrument = pInstrList->find( nInstrId );
+			if ( pInstrument == nullptr ) {
+				stream.setStatus( QDataStream::ReadCorruptData );
+				break;
+			}
+
+			Note* pNote = new Note( pInstrument, nPosition, fVelocity, fPan_L, fPan_R,
+									nNoteLength, fPitch );
+			pNote->set_key_octave( sKey );
+			pNote->set_lead_lag( fLeadLag );
+			pNote->set_note_off( bNoteOff );
+			pNote->set_probability( fProbability );
+			pPattern->insert_note( pNote );
+		}
+	}
+
+	// Virtual patterns
+	for ( int ii = 0; ii < pPatternList->size() && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nVirtualPatterns = 0;
+		stream >> nVirtualPatterns;
+		for ( int jj = 0; jj < nVirtualPatterns && stream.status() == QDataStream::Ok; ++jj ) {
+			qint32 nIndex;
+			stream >> nIndex;
+			if ( nIndex < 0 || nIndex >= pPatternList->size() ) {
+				stream.setStatus( QDataStream::ReadCorruptData );
+				break;
+			}
+			pPatternList->get( ii )->virtual_patterns_add( pPatternList->get( nIndex ) );
+		}
+	}
+	pPatternList->flattened_virtual_patterns_compute();
+
+	// Pattern sequence
+	std::vector<PatternList*>* pPatternGroupVector = new std::vector<PatternList*>;
+	pSong->setPatternGroupVector( pPatternGroupVector );
+
+	qint32 nGroups = 0;
+	stream >> nGroups;
+	for ( int ii = 0; ii < nGroups && stream.status() == QDataStream::Ok; ++ii ) {
+		PatternList* pPatternSequence = new PatternList();
+		pPatternGroupVector->push_back( pPatternSequence );
+
+		qint32 nGroupPatterns = 0;
+		stream >> nGroupPatterns;
+		for ( int jj = 0; jj < nGroupPatterns && stream.status() == QDataStream::Ok; ++jj ) {
+			qint32 nIndex;
+			stream >> nIndex;
+			if ( nIndex < 0 || nIndex >= pPatternList->size() ) {
+				stream.setStatus( QDataStream::ReadCorruptData );
+				break;
+			}
+			pPatternSequence->add( pPatternList->get( nIndex ) );
+		}
+	}
+
+	// LADSPA FX
+	std::vector<PendingFX> pendingFX;
+	qint32 nFX = 0;
+	stream >> nFX;
+	if ( nFX != MAX_FX ) {
+		stream.setStatus( QDataStream::ReadCorruptData );
+	}
+	for ( int ii = 0; ii < nFX && stream.status() == QDataStream::Ok; ++ii ) {
+		PendingFX fx;
+		stream >> fx.bPresent;
+		if ( fx.bPresent ) {
+			qint32 nPorts = 0;
+			stream >> fx.sLabel >> fx.sLibraryPath >> fx.bEnabled >> fx.fVolume >> nPorts;
+			for ( int jj = 0; jj < nPorts && stream.status() == QDataStream::Ok; ++jj ) {
+				QString sPortName;
+				float fValue;
+				stream >> sPortName >> fValue;
+				fx.ports.push_back( std::make_pair( sPortName, fValue ) );
+			}
+		}
+		pendingFX.push_back( std::move( fx ) );
+	}
+
+	// Timeline
+	std::vector<std::pair<qint32, float>> tempoMarkers;
+	std::vector<std::pair<qint32, QString>> tags;
+	qint32 nTempoMarkers = 0;
+	stream >> nTempoMarkers;
+	for ( int ii = 0; ii < nTempoMarkers && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nBar;
+		float fMarkerBpm;
+		stream >> nBar >> fMarkerBpm;
+		tempoMarkers.push_back( std::make_pair( nBar, fMarkerBpm ) );
+	}
+	qint32 nTags = 0;
+	stream >> nTags;
+	for ( int ii = 0; ii < nTags && stream.status() == QDataStream::Ok; ++ii ) {
+		qint32 nBar;
+		QString sTag;
+		stream >> nBar >> sTag;
+		tags.push_back( std::make_pair( nBar, sTag ) );
+	}
+
+	// Automation paths
+	qint32 nPoints = 0;
+	stream >> nPoints;
+	for ( int ii = 0; ii < nPoints && stream.status() == QDataStream::Ok; ++ii ) {
+		float fX, fY;
+		stream >> fX >> fY;
+		pSong->getVelocityAutomationPath()->add_point( fX, fY );
+	}
+
+	if ( stream.status() != QDataStream::Ok || ! stream.atEnd() ) {
+		ERRORLOG( "Corrupt song cache entry. Falling back to the XML file." );
+		delete pSong;
+		return nullptr;
+	}
+
+	// The entry is valid. From here on the same global state as in
+	// SongReader::readSong() is altered.
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	pHydrogen->setNewBpmJTM( fBpm );
+	pHydrogen->setCurrentDrumkitName( sDrumkit );
+	pHydrogen->setCurrentDrumkitLookup( static_cast<Filesystem::Lookup>( nLookup ) );
+	Preferences::get_instance()->setPatternModePlaysSelected( bPatternModePlaysSelected );
+
+	// Unmodified samples are decoded concurrently, just like in
+	// SongReader::readSong().
+	std::vector<std::pair<Instrument*, InstrumentLayer*>> loaderLayers;
+	for ( auto& pending : pendingLayers ) {
+		std::shared_ptr<Sample> pSample;
+		if ( ! pending.bIsModified ) {
+			if ( Filesystem::file_readable( pending.sFilepath ) ) {
+				pSample = std::make_shared<Sample>( pending.sFilepath );
+				loaderLayers.push_back( std::make_pair( pending.pInstrument, pending.pLayer ) );
+			}
+		} else {
+			Sample::VelocityEnvelope velocity;
+			Sample::PanEnvelope pan;
+			fillEnvelope( pending.velocity, velocity );
+			fillEnvelope( pending.pan, pan );
+			pSample = SamplePool::load( pending.sFilepath, pending.loops, pending.rubberband,
+										velocity, pan, true );
+		}
+		if ( pSample == nullptr ) {
+			ERRORLOG( "Error loading sample: " + pending.sFilepath + " not found" );
+			pending.pInstrument->set_muted( true );
+			pending.pInstrument->set_missing_samples( true );
+		}
+		pending.pLayer->set_sample( pSample );
+	}
+	DeferredSampleLoader::load_song_layers( loaderLayers, pSong->getInstrumentList(),
+											pSong->getPatternList(),
+											pSong->getHumanizeVelocityValue() );
+
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int ii = 0; ii < MAX_FX; ++ii ) {
+		Effects::get_instance()->setLadspaFX( nullptr, ii );
+	}
+	for ( int ii = 0; ii < static_cast<int>( pendingFX.size() ); ++ii ) {
+		const PendingFX& fx = pendingFX[ ii ];
+		if ( ! fx.bPresent ) {
+			continue;
+		}
+		// FIXME: same as in SongReader, the engine knows the actual
+		// sample rate.
+		LadspaFX* pFX = LadspaFX::load( fx.sLibraryPath, fx.sLabel, 44100 );
+		Effects::get_instance()->setLadspaFX( pFX, ii );
+		if ( pFX != nullptr ) {
+			pFX->setEnabled( fx.bEnabled );
+			pFX->setVolume( fx.fVolume );
+			for ( const auto& port : fx.ports ) {
+				for ( auto& pPort : pFX->inputControlPorts ) {
+					if ( QString( pPort->sName ) == port.first ) {
+						pPort->fControlValue = port.second;
+					}
+				}
+			}
+		}
+	}
+#endif
+
+	Timeline* pTimeline = pHydrogen->getTimeline();
+	pTimeline->deleteAllTempoMarkers();
+	for ( const auto& marker : tempoMarkers ) {
+		pTimeline->addTempoMarker( marker.first, marker.second );
+	}
+	pTimeline->deleteAllTags();
+	for ( const auto& tag : tags ) {
+		pTimeline->addTag( tag.first, tag.second );
+	}
+
+	return pSong;
+}
+
+};
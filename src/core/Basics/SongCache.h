@@ -0,0 +1,79 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SONG_CACHE_H
+#define H2C_SONG_CACHE_H
+
+#include <core/Object.h>
+
+class QDataStream;
+
+namespace H2Core
+{
+
+class Song;
+
+/**
+ * On-disk cache of parsed songs.
+ *
+ * Reading a large .h2song file with SongReader does build a DOM tree
+ * of the whole document before walking it. Once a song was read
+ * successfully, store() does write everything SongReader::readSong()
+ * did extract from it into a compact binary file in
+ * Filesystem::songs_cache_dir(), keyed by the absolute path of the
+ * song and validated against its size and modification time as well
+ * as the version of Hydrogen. load() maps this file into memory and
+ * rebuilds the song from it without touching the XML at all.
+ *
+ * Songs referencing missing samples are not cached, so the lookup of
+ * their samples is retried using the XML path the next time.
+ */
+class SongCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * Rebuilds the song stored in @a sFilename from its cache
+		 * entry.
+		 *
+		 * Just like SongReader::readSong() it does set the tempo,
+		 * the current drumkit, the LADSPA effects, and the Timeline
+		 * of the Hydrogen instance and loads all samples.
+		 *
+		 * \return nullptr if there is no valid cache entry.
+		 */
+		static Song* load( const QString& sFilename );
+		/** Stores @a pSong, just read from @a sFilename. An existing
+			entry is replaced atomically.*/
+		static void store( Song* pSong, const QString& sFilename );
+
+	private:
+		/** \return Path of the cache file of @a sFilename.*/
+		static QString cache_path( const QString& sFilename );
+		static void write_song( QDataStream& stream, Song* pSong );
+		static Song* read_song( QDataStream& stream );
+};
+
+};
+
+#endif
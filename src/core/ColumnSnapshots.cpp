@@ -0,0 +1,151 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <core/ColumnSnapshots.h>
+
+#include <core/AudioEngine.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* ColumnSnapshots::__class_name = "ColumnSnapshots";
+
+ColumnSnapshots::ColumnSnapshots()
+	: Object( __class_name )
+	, m_pSnapshot( nullptr )
+{
+}
+
+ColumnSnapshots::~ColumnSnapshots()
+{
+	delete m_pSnapshot;
+}
+
+bool ColumnSnapshots::isCurrent( const Snapshot* pSnapshot, Song* pSong )
+{
+	return pSnapshot != nullptr && pSnapshot->pSong == pSong &&
+		pSnapshot->nColumnsRevision == pSong->getColumnStartTicksRevision() &&
+		pSnapshot->nNotesRevision == Pattern::get_notes_revision();
+}
+
+void ColumnSnapshots::update( Song* pSong )
+{
+	if ( pSong == nullptr && m_pSnapshot == nullptr ) {
+		return;
+	}
+	if ( pSong != nullptr ) {
+		// Brings the column start ticks and their revision up to
+		// date.
+		pSong->lengthInTicks();
+		if ( isCurrent( m_pSnapshot, pSong ) ) {
+			return;
+		}
+	}
+
+	// The columns of the song may only be accessed with the engine
+	// locked.
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	Snapshot* pSnapshot = pSong != nullptr ? build( pSong ) : nullptr;
+	std::swap( m_pSnapshot, pSnapshot );
+	AudioEngine::get_instance()->unlock();
+	delete pSnapshot;
+}
+
+ColumnSnapshots::Snapshot* ColumnSnapshots::build( Song* pSong )
+{
+	Snapshot* pSnapshot = new Snapshot;
+	pSnapshot->pSong = pSong;
+	pSnapshot->nColumnsRevision = pSong->getColumnStartTicksRevision();
+	pSnapshot->nNotesRevision = Pattern::get_notes_revision();
+
+	std::vector<PatternList*>* pColumns = pSong->getPatternGroupVector();
+	const int nColumns = pColumns != nullptr ? pColumns->size() : 0;
+	pSnapshot->offsets.reserve( nColumns + 1 );
+
+	std::vector<SoundingNote> sounding;
+	std::vector<Pattern*> patterns;
+	for ( int nColumn = 0; nColumn < nColumns; ++nColumn ) {
+		const long nColumnStart = pSong->getColumnStartTick( nColumn );
+		sounding.erase( std::remove_if( sounding.begin(), sounding.end(),
+										[&]( const SoundingNote& note ) {
+											return note.nEndTick <= nColumnStart; } ),
+						sounding.end() );
+
+		// The patterns of the column including the flattened
+		// virtual ones, each of them once, as played by
+		// audioEngine_updateNoteQueue().
+		patterns.clear();
+		PatternList* pColumn = ( *pColumns )[ nColumn ];
+		for ( int ii = 0; ii < pColumn->size(); ++ii ) {
+			Pattern* pPattern = pColumn->get( ii );
+			patterns.push_back( pPattern );
+			for ( Pattern* pVirtual : *pPattern->get_flattened_virtual_patterns() ) {
+				patterns.push_back( pVirtual );
+			}
+		}
+		std::sort( patterns.begin(), patterns.end() );
+		patterns.erase( std::unique( patterns.begin(), patterns.end() ), patterns.end() );
+
+		for ( Pattern* pPattern : patterns ) {
+			for ( const auto& entry : *pPattern->get_notes() ) {
+				Note* pNote = entry.second;
+				if ( entry.first < 0 || entry.first >= pPattern->get_length() ||
+					 pNote == nullptr || pNote->get_length() <= 0 ) {
+					continue;
+				}
+				const long nStart = nColumnStart + entry.first;
+				sounding.push_back( { pNote, nStart, nStart + pNote->get_length() } );
+			}
+		}
+
+		pSnapshot->offsets.push_back( pSnapshot->notes.size() );
+		pSnapshot->notes.insert( pSnapshot->notes.end(), sounding.begin(), sounding.end() );
+	}
+	pSnapshot->offsets.push_back( pSnapshot->notes.size() );
+
+	return pSnapshot;
+}
+
+int ColumnSnapshots::getSoundingNotes( Song* pSong, long nTick,
+									   const SoundingNote** ppNotes ) const
+{
+	int nColumnStart;
+	const int nColumn = pSong->findColumn( nTick, &nColumnStart );
+	const Snapshot* pSnapshot = m_pSnapshot;
+	if ( nColumn < 0 || ! isCurrent( pSnapshot, pSong ) ||
+		 nColumn + 1 >= static_cast<int>( pSnapshot->offsets.size() ) ) {
+		return 0;
+	}
+
+	*ppNotes = pSnapshot->notes.data() + pSnapshot->offsets[ nColumn ];
+	return pSnapshot->offsets[ nColumn + 1 ] - pSnapshot->offsets[ nColumn ];
+}
+
+};
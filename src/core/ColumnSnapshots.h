@@ -0,0 +1,118 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef COLUMN_SNAPSHOTS_H
+#define COLUMN_SNAPSHOTS_H
+
+#include <core/Object.h>
+
+#include <vector>
+
+namespace H2Core
+{
+
+class Note;
+class Song;
+
+/**
+ * Notes with an explicit length sounding at the beginning of each
+ * column of the song.
+ *
+ * audioEngine_updateNoteQueue() only queues the notes starting
+ * within the current process cycle. After a relocation long notes
+ * started earlier would thus stay silent until they start again. The
+ * snapshots tell which of them would still be sounding, so they can
+ * be resumed in the middle of their samples.
+ *
+ * update() rebuilds the snapshots in the main thread whenever the
+ * columns or the notes of the song changed. Until then
+ * getSoundingNotes() does report none.
+ */
+class ColumnSnapshots : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Note of a pattern sounding within a column.*/
+	struct SoundingNote {
+		/** Note in the pattern. Never queued itself.*/
+		Note* pNote;
+		/** Tick the note starts at counted from the beginning of
+			the song.*/
+		long nStartTick;
+		/** Tick the note ends at.*/
+		long nEndTick;
+	};
+
+	ColumnSnapshots();
+	~ColumnSnapshots();
+
+	/**
+	 * Rebuilds the snapshots of @a pSong with the engine locked if
+	 * its columns or any pattern changed since the last call. Has
+	 * to be called from the main thread. Called periodically by the
+	 * GUI.
+	 */
+	void update( Song* pSong );
+
+	/**
+	 * Called by the audio engine with the engine locked. Neither
+	 * allocates nor waits for the main thread.
+	 *
+	 * \param pSong Song currently played.
+	 * \param nTick Tick counted from the beginning of the song.
+	 * \param ppNotes Set to the notes which are sounding at the
+	 * beginning of the column containing @a nTick or started within
+	 * it. Callers have to check their start and end ticks.
+	 * \return Number of notes in @a ppNotes. 0 if the snapshots are
+	 * outdated.
+	 */
+	int getSoundingNotes( Song* pSong, long nTick, const SoundingNote** ppNotes ) const;
+
+private:
+	struct Snapshot {
+		const Song* pSong;
+		/** Song::getColumnStartTicksRevision() at the time of the
+			build.*/
+		int nColumnsRevision;
+		/** Pattern::get_notes_revision() at the time of the
+			build.*/
+		unsigned nNotesRevision;
+		/** Sounding notes of all columns one after another.*/
+		std::vector<SoundingNote> notes;
+		/** Index of the first note of each column within #notes,
+			plus the end.*/
+		std::vector<int> offsets;
+	};
+
+	/** \return Whether @a pSnapshot still matches @a pSong.*/
+	static bool isCurrent( const Snapshot* pSnapshot, Song* pSong );
+	static Snapshot* build( Song* pSong );
+
+	/** Only replaced by the main thread with the engine locked.*/
+	Snapshot* m_pSnapshot;
+};
+
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/CommandQueue.h>
+
+#include <cstdint>
+
+namespace H2Core
+{
+
+const char* CommandQueue::__class_name = "CommandQueue";
+
+static_assert( ( MAX_COMMANDS & ( MAX_COMMANDS - 1 ) ) == 0,
+			   "MAX_COMMANDS has to be a power of two" );
+
+CommandQueue::CommandQueue()
+	: Object( __class_name )
+	, m_nWriteIndex( 0 )
+	, m_nReadIndex( 0 )
+{
+	for ( size_t ii = 0; ii < MAX_COMMANDS; ++ii ) {
+		m_slots[ ii ].sequence.store( ii, std::memory_order_relaxed );
+	}
+}
+
+CommandQueue::~CommandQueue()
+{
+}
+
+bool CommandQueue::push( Command command )
+{
+	size_t nPos = m_nWriteIndex.load( std::memory_order_relaxed );
+	Slot* pSlot;
+
+	for ( ;; ) {
+		pSlot = &m_slots[ nPos & ( MAX_COMMANDS - 1 ) ];
+		size_t nSequence = pSlot->sequence.load( std::memory_order_acquire );
+		intptr_t nDiff = static_cast<intptr_t>( nSequence ) - static_cast<intptr_t>( nPos );
+
+		if ( nDiff == 0 ) {
+			// Slot is free. Try to claim it.
+			if ( m_nWriteIndex.compare_exchange_weak( nPos, nPos + 1,
+													  std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( nDiff < 0 ) {
+			// The consumer did not free this slot yet.
+			return false;
+		} else {
+			// Another producer claimed the slot in the meantime.
+			nPos = m_nWriteIndex.load( std::memory_order_relaxed );
+		}
+	}
+
+	// Replacing the previous command of this slot does free its
+	// resources in the producing thread.
+	pSlot->command = std::move( command );
+	pSlot->sequence.store( nPos + 1, std::memory_order_release );
+
+	return true;
+}
+
+int CommandQueue::process()
+{
+	int nProcessed = 0;
+	size_t nPos = m_nReadIndex.load( std::memory_order_relaxed );
+
+	// Only handle the commands already present at the beginning of
+	// the call. A steady stream of new ones must not stall the
+	// process cycle.
+	const size_t nEnd = m_nWriteIndex.load( std::memory_order_acquire );
+
+	while ( nPos != nEnd ) {
+		Slot* pSlot = &m_slots[ nPos & ( MAX_COMMANDS - 1 ) ];
+		size_t nSequence = pSlot->sequence.load( std::memory_order_acquire );
+
+		if ( nSequence != nPos + 1 ) {
+			// Slot was claimed but the producer is still busy
+			// writing its command. We will pick it up during the
+			// next cycle.
+			break;
+		}
+
+		if ( pSlot->command ) {
+			pSlot->command();
+		}
+		++nProcessed;
+
+		pSlot->sequence.store( nPos + MAX_COMMANDS, std::memory_order_release );
+		++nPos;
+	}
+
+	m_nReadIndex.store( nPos, std::memory_order_relaxed );
+
+	return nProcessed;
+}
+
+bool CommandQueue::empty() const
+{
+	return m_nReadIndex.load( std::memory_order_relaxed ) ==
+		m_nWriteIndex.load( std::memory_order_relaxed );
+}
+
+};
@@ -0,0 +1,106 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <functional>
+
+/** Number of commands which can be pending in the
+    H2Core::CommandQueue at the same time. Has to be a power of two.*/
+#define MAX_COMMANDS 1024
+
+namespace H2Core
+{
+
+/**
+ * Bounded multi-producer single-consumer queue of commands to be
+ * applied by the audio engine.
+ *
+ * Threads other than the one running audioEngine_process() (GUI, OSC,
+ * MIDI) post mutations of the Song, its patterns, or its instruments
+ * using push(). They are applied by the realtime thread at the top of
+ * each process cycle via process(), while it already holds the
+ * AudioEngine lock. This way the producers do not have to acquire the
+ * lock themselves and the process cycle is not forced to wait for
+ * them.
+ *
+ * The implementation follows the sequence-numbered ring buffer by
+ * Dmitry Vyukov. Neither push() nor process() do block or allocate
+ * memory. Since the std::function stored in a slot is only replaced
+ * by the next producer writing into it, the destruction of captured
+ * objects does happen outside of the realtime thread too.
+ */
+class CommandQueue : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	typedef std::function<void()> Command;
+
+	CommandQueue();
+	~CommandQueue();
+
+	/**
+	 * Appends @a command to the queue.
+	 *
+	 * Can be called from arbitrary threads concurrently.
+	 *
+	 * \return false if the queue is full. The command was not queued
+	 * and it is up to the caller to apply it by other means.
+	 */
+	bool push( Command command );
+
+	/**
+	 * Applies all commands which are pending at the time of the
+	 * call in the order they were pushed.
+	 *
+	 * Must only be called by a single thread at a time (the audio
+	 * engine) while holding the AudioEngine lock.
+	 *
+	 * \return Number of commands applied.
+	 */
+	int process();
+
+	/** \return true if there are no pending commands.*/
+	bool empty() const;
+
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		Command command;
+	};
+
+	/** Ring buffer of #MAX_COMMANDS slots.*/
+	Slot m_slots[ MAX_COMMANDS ];
+	/** Position the next producer will write to.*/
+	alignas(64) std::atomic<size_t> m_nWriteIndex;
+	/** Position the consumer will read next. Only accessed by the
+		consumer but atomic since empty() may be called by others.*/
+	alignas(64) std::atomic<size_t> m_nReadIndex;
+};
+
+};
+
+#endif
@@ -105,6 +105,7 @@ void CoreActionController::setStripVolume( int nStrip, float fVolumeValue, bool
 void CoreActionController::setMetronomeIsActive( bool isActive )
 {
 	Preferences::get_instance()->m_bUseMetronome = isActive;
+	Preferences::get_instance()->publishRealtimeConfig();
 	
 #ifdef H2CORE_HAVE_OSC
 	Action FeedbackAction( "TOGGLE_METRONOME" );
@@ -470,6 +471,14 @@ bool CoreActionController::saveSong() {
 		ERRORLOG( "Unable to save song. Empty filename!" );
 		return false;
 	}
+
+	// Session managers ask all their clients to save at once and
+	// repeatedly. There is no need to rewrite a file that already
+	// holds the current state.
+	if ( pSong->isFileUpToDate() ) {
+		INFOLOG( QString( "Song [%1] is unchanged. Saving skipped." ).arg( sSongPath ) );
+		return true;
+	}
 	
 	// Actual saving
 	bool saved = pSong->save( sSongPath );
@@ -602,10 +611,10 @@ bool CoreActionController::activateTimeline( bool bActivate ) {
 	return true;
 }
 
-bool CoreActionController::addTempoMarker( int nPosition, float fBpm ) {
+bool CoreActionController::addTempoMarker( int nPosition, float fBpm, bool bRamp ) {
 	auto pTimeline = Hydrogen::get_instance()->getTimeline();
 	pTimeline->deleteTempoMarker( nPosition );
-	pTimeline->addTempoMarker( nPosition, fBpm );
+	pTimeline->addTempoMarker( nPosition, fBpm, bRamp );
 
 	EventQueue::get_instance()->push_event( EVENT_TIMELINE_UPDATE, 0 );
 
@@ -627,13 +636,14 @@ bool CoreActionController::activateJackTransport( bool bActivate ) {
 		return false;
 	}
 	
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	// The audio engine picks up the new mode at the beginning of its
+	// next cycle.
 	if ( bActivate ) {
 		Preferences::get_instance()->m_bJackTransportMode = Preferences::USE_JACK_TRANSPORT;
 	} else {
 		Preferences::get_instance()->m_bJackTransportMode = Preferences::NO_JACK_TRANSPORT;
 	}
-	AudioEngine::get_instance()->unlock();
+	Preferences::get_instance()->publishRealtimeConfig();
 	
 	EventQueue::get_instance()->push_event( EVENT_JACK_TRANSPORT_ACTIVATION, static_cast<int>( bActivate ) );
 	
@@ -655,9 +665,11 @@ bool CoreActionController::activateJackTimebaseMaster( bool bActivate ) {
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	if ( bActivate ) {
 		Preferences::get_instance()->m_bJackMasterMode = Preferences::USE_JACK_TIME_MASTER;
+		Preferences::get_instance()->publishRealtimeConfig();
 		Hydrogen::get_instance()->onJackMaster();
 	} else {
 		Preferences::get_instance()->m_bJackMasterMode = Preferences::NO_JACK_TIME_MASTER;
+		Preferences::get_instance()->publishRealtimeConfig();
 		Hydrogen::get_instance()->offJackMaster();
 	}
 	AudioEngine::get_instance()->unlock();
@@ -671,6 +683,52 @@ bool CoreActionController::activateJackTimebaseMaster( bool bActivate ) {
 #endif
 }
 
+bool CoreActionController::activateLink( bool bActivate ) {
+
+	auto pHydrogen = Hydrogen::get_instance();
+	float fBpm = pHydrogen->getSong() != nullptr ? pHydrogen->getSong()->getBpm() : 120;
+	if ( ! AudioEngine::get_instance()->get_link_transport()->setEnabled( bActivate, fBpm ) ) {
+		return false;
+	}
+	Preferences::get_instance()->m_bLinkEnabled = bActivate;
+
+	return true;
+}
+
+bool CoreActionController::activateNetworkStems( bool bActivate ) {
+
+	auto pPref = Preferences::get_instance();
+	auto pOutput = AudioEngine::get_instance()->get_network_stem_output();
+	if ( bActivate ) {
+		if ( ! pOutput->start( pPref->m_sNetworkStemsHost, pPref->m_nNetworkStemsPort,
+							   NetworkStemOutput::parseTracks( pPref->m_sNetworkStemsTracks ) ) ) {
+			return false;
+		}
+	} else {
+		pOutput->stop();
+	}
+	pPref->m_bNetworkStems = bActivate;
+
+	return true;
+}
+
+bool CoreActionController::activateMetrics( bool bActivate ) {
+
+	auto pPref = Preferences::get_instance();
+	auto pExporter = AudioEngine::get_instance()->get_metrics_exporter();
+	if ( bActivate ) {
+		if ( ! pExporter->start( MetricsExporter::parseProtocol( pPref->m_sMetricsProtocol ),
+								 pPref->m_sMetricsHost, pPref->m_nMetricsPort ) ) {
+			return false;
+		}
+	} else {
+		pExporter->stop();
+	}
+	pPref->m_bMetrics = bActivate;
+
+	return true;
+}
+
 bool CoreActionController::activateSongMode( bool bActivate, bool bTriggerEvent ) {
 
 	auto pHydrogen = Hydrogen::get_instance();
@@ -174,10 +174,12 @@ class CoreActionController : public H2Core::Object {
 		 *
 		 * @param nPosition Location of the tempo marker in bars.
 		 * @param fBpm Speed associated with the tempo marker.
+		 * @param bRamp Whether the tempo ramps towards @a fBpm
+		 * starting at the previous marker.
 		 *
 		 * @return bool true on success
 		 */
-		bool addTempoMarker( int nPosition, float fBpm );
+		bool addTempoMarker( int nPosition, float fBpm, bool bRamp = false );
 		/**
 		 * Delete a tempo marker from the Timeline.
 		 *
@@ -213,6 +215,44 @@ class CoreActionController : public H2Core::Object {
 		 * @return bool true on success
 		 */
 		bool activateJackTimebaseMaster( bool bActivate );
+		/**
+		 * Joins or leaves the Ableton Link session using
+		 * LinkTransport::setEnabled() and stores the choice in
+		 * Preferences::m_bLinkEnabled.
+		 *
+		 * Note that this function will fail if Hydrogen was not
+		 * compiled with Link support.
+		 *
+		 * @param bActivate If true - activate or if false -
+		 * deactivate.
+		 *
+		 * @return bool true on success
+		 */
+		bool activateLink( bool bActivate );
+		/**
+		 * Starts or stops streaming the tracks to a remote host
+		 * using NetworkStemOutput::start() with the host, port,
+		 * and tracks stored in the Preferences and stores the
+		 * choice in Preferences::m_bNetworkStems.
+		 *
+		 * @param bActivate If true - activate or if false -
+		 * deactivate.
+		 *
+		 * @return bool true on success
+		 */
+		bool activateNetworkStems( bool bActivate );
+		/**
+		 * Starts or stops exporting health metrics using
+		 * MetricsExporter::start() with the protocol, host, and
+		 * port stored in the Preferences and stores the choice in
+		 * Preferences::m_bMetrics.
+		 *
+		 * @param bActivate If true - activate or if false -
+		 * deactivate.
+		 *
+		 * @return bool true on success
+		 */
+		bool activateMetrics( bool bActivate );
 
 		/**
 		 * Switches between Song and Pattern mode of playback.
@@ -22,6 +22,8 @@
 
 #include <core/EventQueue.h>
 
+#include <cstdint>
+
 namespace H2Core
 {
 
@@ -36,16 +38,34 @@ void EventQueue::create_instance()
 
 const char* EventQueue::__class_name = "EventQueue";
 
+static_assert( ( MAX_EVENTS & ( MAX_EVENTS - 1 ) ) == 0,
+			   "MAX_EVENTS has to be a power of two" );
+static_assert( ( MAX_RECORDED_NOTES & ( MAX_RECORDED_NOTES - 1 ) ) == 0,
+			   "MAX_RECORDED_NOTES has to be a power of two" );
+static_assert( EVENT_DRUMKIT_LIST_CHANGED < MAX_EVENT_TYPES,
+			   "MAX_EVENT_TYPES has to be increased" );
+
 EventQueue::EventQueue()
 		: Object( __class_name )
 		, __read_index( 0 )
 		, __write_index( 0 )
+		, __dropped_events( 0 )
+		, __reported_dropped_events( 0 )
+		, __recorded_notes_read_index( 0 )
+		, __recorded_notes_write_index( 0 )
 {
 	__instance = this;
 
 	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
+		__events_buffer[ i ].sequence.store( i, std::memory_order_relaxed );
+		__events_buffer[ i ].event.type = EVENT_NONE;
+		__events_buffer[ i ].event.value = 0;
+	}
+	for ( int i = 0; i < MAX_RECORDED_NOTES; ++i ) {
+		__recorded_notes_buffer[ i ].sequence.store( i, std::memory_order_relaxed );
+	}
+	for ( int i = 0; i < MAX_EVENT_TYPES; ++i ) {
+		__pending[ i ].store( false, std::memory_order_relaxed );
 	}
 }
 
@@ -56,30 +76,145 @@ EventQueue::~EventQueue()
 }
 
 
+bool EventQueue::is_coalescable( const EventType type )
+{
+	switch ( type ) {
+	case EVENT_PATTERN_CHANGED:
+	case EVENT_PATTERN_MODIFIED:
+	case EVENT_SELECTED_PATTERN_CHANGED:
+	case EVENT_SELECTED_INSTRUMENT_CHANGED:
+	case EVENT_PARAMETERS_INSTRUMENT_CHANGED:
+	case EVENT_MIDI_ACTIVITY:
+	case EVENT_SONG_MODIFIED:
+	case EVENT_DRUMKIT_LIST_CHANGED:
+	case EVENT_SAMPLE_PEAKS_READY:
+	case EVENT_LAYER_SAMPLES_LOADED:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
 void EventQueue::push_event( const EventType type, const int nValue )
 {
-	unsigned int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
-	Event ev;
-	ev.type = type;
-	ev.value = nValue;
-//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nIndex ).arg( ev.type ).arg( ev.value ) );
-	__events_buffer[ nIndex ] = ev;
+	bool bCoalescable = is_coalescable( type );
+	if ( bCoalescable &&
+		 __pending[ type ].exchange( true, std::memory_order_acq_rel ) ) {
+		// The GUI did not handle the previous one yet.
+		return;
+	}
+
+	size_t nPos = __write_index.load( std::memory_order_relaxed );
+	Slot* pSlot;
+
+	for ( ;; ) {
+		pSlot = &__events_buffer[ nPos & ( MAX_EVENTS - 1 ) ];
+		size_t nSequence = pSlot->sequence.load( std::memory_order_acquire );
+		intptr_t nDiff = static_cast<intptr_t>( nSequence ) - static_cast<intptr_t>( nPos );
+
+		if ( nDiff == 0 ) {
+			if ( __write_index.compare_exchange_weak( nPos, nPos + 1,
+													  std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( nDiff < 0 ) {
+			// Queue is full.
+			if ( bCoalescable ) {
+				__pending[ type ].store( false, std::memory_order_release );
+			}
+			__dropped_events.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		} else {
+			nPos = __write_index.load( std::memory_order_relaxed );
+		}
+	}
+
+//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nPos ).arg( type ).arg( nValue ) );
+	pSlot->event.type = type;
+	pSlot->event.value = nValue;
+	pSlot->sequence.store( nPos + 1, std::memory_order_release );
 }
 
 
 Event EventQueue::pop_event()
 {
-	if ( __read_index == __write_index ) {
+	int nDropped = __dropped_events.load( std::memory_order_relaxed );
+	if ( nDropped != __reported_dropped_events ) {
+		WARNINGLOG( QString( "%1 events dropped since the queue was full" )
+					.arg( nDropped - __reported_dropped_events ) );
+		__reported_dropped_events = nDropped;
+	}
+
+	Slot* pSlot = &__events_buffer[ __read_index & ( MAX_EVENTS - 1 ) ];
+	if ( pSlot->sequence.load( std::memory_order_acquire ) != __read_index + 1 ) {
+		// Either empty or the producer is still writing the
+		// event. It will be picked up next time.
 		Event ev;
 		ev.type = EVENT_NONE;
 		ev.value = 0;
 		return ev;
 	}
-	unsigned int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( nIndex ).arg( __events_buffer[ nIndex ].type ).arg( __events_buffer[ nIndex ].value ) );
-	return __events_buffer[ nIndex ];
+
+	Event ev = pSlot->event;
+//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( __read_index ).arg( ev.type ).arg( ev.value ) );
+	pSlot->sequence.store( __read_index + MAX_EVENTS, std::memory_order_release );
+	++__read_index;
+
+	// Cleared before the event is handled. Any change happening
+	// afterwards will result in a new event.
+	if ( is_coalescable( ev.type ) ) {
+		__pending[ ev.type ].store( false, std::memory_order_release );
+	}
+
+	return ev;
+}
+
+
+bool EventQueue::push_recorded_note( const AddMidiNoteVector& note )
+{
+	size_t nPos = __recorded_notes_write_index.load( std::memory_order_relaxed );
+	RecordedNoteSlot* pSlot;
+
+	for ( ;; ) {
+		pSlot = &__recorded_notes_buffer[ nPos & ( MAX_RECORDED_NOTES - 1 ) ];
+		size_t nSequence = pSlot->sequence.load( std::memory_order_acquire );
+		intptr_t nDiff = static_cast<intptr_t>( nSequence ) - static_cast<intptr_t>( nPos );
+
+		if ( nDiff == 0 ) {
+			if ( __recorded_notes_write_index.compare_exchange_weak( nPos, nPos + 1,
+																	 std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( nDiff < 0 ) {
+			// Buffer is full.
+			__dropped_events.fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		} else {
+			nPos = __recorded_notes_write_index.load( std::memory_order_relaxed );
+		}
+	}
+
+	pSlot->note = note;
+	pSlot->sequence.store( nPos + 1, std::memory_order_release );
+	return true;
+}
+
+
+bool EventQueue::pop_recorded_note( AddMidiNoteVector& note )
+{
+	RecordedNoteSlot* pSlot =
+		&__recorded_notes_buffer[ __recorded_notes_read_index & ( MAX_RECORDED_NOTES - 1 ) ];
+	if ( pSlot->sequence.load( std::memory_order_acquire ) !=
+		 __recorded_notes_read_index + 1 ) {
+		return false;
+	}
+
+	note = pSlot->note;
+	pSlot->sequence.store( __recorded_notes_read_index + MAX_RECORDED_NOTES,
+						   std::memory_order_release );
+	++__recorded_notes_read_index;
+	return true;
 }
 
 };
@@ -25,11 +25,18 @@
 
 #include <core/Object.h>
 #include <core/Basics/Note.h>
+#include <atomic>
 #include <cassert>
 
 /** Maximum number of events to be stored in the
-    H2Core::EventQueue::__events_buffer.*/
+    H2Core::EventQueue::__events_buffer. Has to be a power of two.*/
 #define MAX_EVENTS 1024
+/** Maximum number of recorded notes to be stored in the
+    H2Core::EventQueue::__recorded_notes_buffer. Has to be a power of
+    two.*/
+#define MAX_RECORDED_NOTES 1024
+/** Upper bound of the number of H2Core::EventType entries.*/
+#define MAX_EVENT_TYPES 64
 
 namespace H2Core
 {
@@ -155,7 +162,26 @@ enum EventType {
 	/** Toggles the button indicating the usage loop mode.*/
 	EVENT_LOOP_MODE_ACTIVATION,
 	/** Switches between select mode (0) and draw mode (1) in the *SongEditor.*/
-	EVENT_ACTION_MODE_CHANGE
+	EVENT_ACTION_MODE_CHANGE,
+	/** Progress in percent of the SampleLoader decoding the
+		samples of a drumkit or song.*/
+	EVENT_SAMPLE_LOADING_PROGRESS,
+	/** A drumkit prepared using Hydrogen::prepareDrumkit() was
+		swapped in (0) or discarded (-1).*/
+	EVENT_DRUMKIT_LOADED,
+	/** The H2Core::DrumkitIndex or H2Core::PatternIndex noticed a
+		drumkit or pattern being added, removed, or modified on
+		disk.*/
+	EVENT_DRUMKIT_LIST_CHANGED,
+	/** The H2Core::SamplePeakBuilder attached the SamplePeaks of
+		at least one sample.*/
+	EVENT_SAMPLE_PEAKS_READY,
+	/** The H2Core::OverloadGovernor changed the rendering quality.
+		The value is the new OverloadGovernor::Level.*/
+	EVENT_OVERLOAD_LEVEL,
+	/** The H2Core::DeferredSampleLoader handed decoded samples over
+		to instrument layers.*/
+	EVENT_LAYER_SAMPLES_LOADED
 };
 
 /** Basic building block for the communication between the core of
@@ -207,15 +233,17 @@ public:/**
 	 *
 	 * The event itself will be constructed inside the function
 	 * and will be two properties: an EventType @a type and a
-	 * value @a nValue. Since the event written to the queue most
-	 * recently is indexed with #__write_index, this variable is
-	 * incremented once and its modulo with respect to #MAX_EVENTS
-	 * is calculated to determine the position of insertion into
-	 * #__events_buffer.
+	 * value @a nValue.
 	 *
-	 * The modulo operation is necessary because #__write_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * It can be called by any number of threads - including the
+	 * realtime ones - at the same time and neither blocks nor
+	 * allocates memory. The slots of #__events_buffer follow the
+	 * sequence-numbered scheme of H2Core::CommandQueue.
+	 *
+	 * Events whose value carries no information (see
+	 * is_coalescable()) are not queued again as long as an event of
+	 * the same type is still waiting to be read. If the queue is
+	 * full, the event is dropped and #__dropped_events incremented.
 	 *
 	 * \param type Type of the event, which will be queued.
 	 * \param nValue Value specifying the content of the new event.
@@ -224,18 +252,14 @@ public:/**
 	/**
 	 * Reads out the next event of the EventQueue.
 	 *
-	 * Since the event read out most recently is indexed with
-	 * #__read_index, this variable is incremented once and its
-	 * modulo with respect to #MAX_EVENTS is calculated to
-	 * determine the event returned from #__events_buffer. 
-	 *
-	 * The modulo operation is necessary because #__read_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * Must only be called by a single thread at a time (the GUI).
 	 *
-	 * \return Next event in line.
+	 * \return Next event in line or an event of type
+	 * #H2Core::EVENT_NONE if there is none.
 	 */
 	Event pop_event();
+	/** \return Number of events dropped since the queue was full.*/
+	int get_dropped_events() const;
 
 	struct AddMidiNoteVector {
 		int m_column;       //position
@@ -251,7 +275,23 @@ public:/**
 		bool b_isInstrumentMode;
 		bool b_noteExist;
 	};
-	std::vector<AddMidiNoteVector> m_addMidiNoteVector;
+	/**
+	 * Passes a note recorded by Hydrogen::addRealtimeNote() on to
+	 * the GUI, which adds it to its pattern.
+	 *
+	 * Lock-free and safe to call from the MIDI and audio threads.
+	 *
+	 * \return false if the buffer was full and the note dropped.
+	 */
+	bool push_recorded_note( const AddMidiNoteVector& note );
+	/**
+	 * Reads out the next recorded note.
+	 *
+	 * Must only be called by a single thread at a time (the GUI).
+	 *
+	 * \return false if there is none.
+	 */
+	bool pop_recorded_note( AddMidiNoteVector& note );
 
 private:
 	/**
@@ -270,28 +310,68 @@ private:
 	static EventQueue *__instance;
 
 	/**
-	 * Continuously growing number indexing the event, which has
-	 * been read from the EventQueue most recently.
-	 *
-	 * It is incremented with each call to pop_event(). 
+	 * \return Whether the GUI handles events of @a type just by
+	 * querying the current state of the engine. Successive events
+	 * of this type can be merged into one.
 	 */
-	unsigned int __read_index;
+	static bool is_coalescable( const EventType type );
+
+	struct Slot {
+		/** Equals the position of a free slot and the position
+			plus one once it contains an event.*/
+		std::atomic<size_t> sequence;
+		Event event;
+	};
+
 	/**
-	 * Continuously growing number indexing the event, which has
-	 * been written to the EventQueue most recently.
+	 * Continuously growing number indexing the next event to be
+	 * read from the EventQueue.
 	 *
-	 * It is incremented with each call to push_event(). 
+	 * Only accessed by the consumer calling pop_event().
+	 */
+	size_t __read_index;
+	/**
+	 * Continuously growing number indexing the next slot to be
+	 * written to by push_event().
 	 */
-	unsigned int __write_index;
+	alignas(64) std::atomic<size_t> __write_index;
 	/**
-	 * Array of all events contained in the EventQueue.
+	 * Ring buffer of all events contained in the EventQueue.
 	 *
 	 * Its length is set to #MAX_EVENTS and it gets initialized
 	 * with #H2Core::EVENT_NONE in EventQueue().
 	 */
-	Event __events_buffer[ MAX_EVENTS ];
+	Slot __events_buffer[ MAX_EVENTS ];
+	/** Whether a coalescable event of a particular type is waiting
+		to be read.*/
+	std::atomic<bool> __pending[ MAX_EVENT_TYPES ];
+	/** Number of events which did not fit into
+		#__events_buffer.*/
+	std::atomic<int> __dropped_events;
+	/** Value of #__dropped_events already reported by
+		pop_event().*/
+	int __reported_dropped_events;
+
+	struct RecordedNoteSlot {
+		/** Same as Slot::sequence.*/
+		std::atomic<size_t> sequence;
+		AddMidiNoteVector note;
+	};
+	/** Index of the next note read by pop_recorded_note().*/
+	size_t __recorded_notes_read_index;
+	/** Index of the next slot written to by push_recorded_note().*/
+	alignas(64) std::atomic<size_t> __recorded_notes_write_index;
+	/**
+	 * Ring buffer of #MAX_RECORDED_NOTES notes recorded but not
+	 * yet added to their pattern.
+	 */
+	RecordedNoteSlot __recorded_notes_buffer[ MAX_RECORDED_NOTES ];
 };
 
+inline int EventQueue::get_dropped_events() const {
+	return __dropped_events.load( std::memory_order_relaxed );
+}
+
 };
 
 #endif
@@ -0,0 +1,99 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef AUDIO_PLUGIN_H
+#define AUDIO_PLUGIN_H
+
+#include <core/config.h>
+#include <core/Object.h>
+
+#include <cstring>
+
+namespace H2Core
+{
+
+/**
+ * Interface of the plugin formats hosted by Hydrogen.
+ *
+ * An effect is either used as one of the #MAX_FX global sends in
+ * Effects or as insert of the InsertChain of a DrumkitComponent. Both
+ * ways only rely on the methods below. LadspaFX is the only format
+ * implemented right now.
+ */
+class AudioPlugin : public H2Core::Object
+{
+public:
+	enum {
+		MONO_FX,
+		STEREO_FX,
+		UNDEFINED
+	};
+
+	/** Output buffers of size #MAX_BUFFER_SIZE. The sends in Effects
+		use them as input as well. For MONO_FX only the left one is
+		written.*/
+	float* m_pBuffer_L;
+	float* m_pBuffer_R;
+
+	AudioPlugin( const char* class_name )
+			: Object( class_name )
+			, m_bEnabled( false ) {
+		m_pBuffer_L = new float[ MAX_BUFFER_SIZE ];
+		m_pBuffer_R = new float[ MAX_BUFFER_SIZE ];
+		memset( m_pBuffer_L, 0, MAX_BUFFER_SIZE * sizeof( float ) );
+		memset( m_pBuffer_R, 0, MAX_BUFFER_SIZE * sizeof( float ) );
+	}
+
+	virtual ~AudioPlugin() {
+		delete[] m_pBuffer_L;
+		delete[] m_pBuffer_R;
+	}
+
+	/** Connects the audio ports of the plugin. For MONO_FX @a pIn_R
+		and @a pOut_R are ignored. Must not be called while the
+		audio engine is processing the plugin.*/
+	virtual void connectAudioPorts( float* pIn_L, float* pIn_R, float* pOut_L, float* pOut_R ) = 0;
+	virtual void activate() = 0;
+	virtual void deactivate() = 0;
+	/** Processes @a nFrames frames of the connected buffers. Called
+		by the audio engine.*/
+	virtual void processFX( unsigned nFrames ) = 0;
+
+	/** \return Either MONO_FX, STEREO_FX, or UNDEFINED.*/
+	virtual int getPluginType() = 0;
+	virtual const QString& getPluginName() = 0;
+
+	bool isEnabled() {
+		return m_bEnabled;
+	}
+	void setEnabled( bool value ) {
+		m_bEnabled = value;
+	}
+
+protected:
+	bool m_bEnabled;
+};
+
+};
+
+#endif
@@ -27,10 +27,19 @@
 #include <core/FX/LadspaFX.h>
 #include <core/AudioEngine.h>
 #include <core/Helpers/Filesystem.h>
+#include "Version.h"
 
 #include <algorithm>
+#include <map>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QLibrary>
+#include <QMap>
+#include <QSaveFile>
+#include <QStringList>
 #include <cassert>
 
 #ifdef H2CORE_HAVE_LRDF
@@ -44,8 +53,145 @@ namespace H2Core
 Effects* Effects::__instance = nullptr;
 const char* Effects::__class_name = "Effects";
 
+static const quint32 nCacheMagic = 0x48324c50; // "H2LP"
+/** Has to be increased whenever the layout of the cache does
+	change.*/
+static const quint32 nCacheVersion = 1;
+
+/** Descriptor of a single plugin.*/
+struct CachedPlugin {
+	QString sName;
+	QString sLabel;
+	QString sID;
+	QString sMaker;
+	QString sCopyright;
+	quint32 nICPorts;
+	quint32 nOCPorts;
+	quint32 nIAPorts;
+	quint32 nOAPorts;
+};
+
+/** Usable plugins provided by a LADSPA library.*/
+struct CachedLibrary {
+	/** Modification time of the library in ms since epoch.*/
+	qint64 nModified;
+	/** Size of the library in bytes.*/
+	qint64 nSize;
+	std::vector<CachedPlugin> plugins;
+};
+
+/** A category of the LRDF ontology.*/
+struct CachedCategory {
+	/** Labels of the category and all its parents, starting with
+		the uppermost one. Empty for the root of the ontology.*/
+	QStringList path;
+	/** Unique IDs of the plugins within the category.*/
+	QList<qint32> uids;
+};
+
+struct Effects::PluginCache {
+	/** Keyed by the absolute path of the library.*/
+	std::map<QString, CachedLibrary> libraries;
+	/** Modification times of the RDF files #categories were read
+		from, keyed by their names.*/
+	QMap<QString, qint64> rdfFiles;
+	bool bHasCategories;
+	std::vector<CachedCategory> categories;
+
+	PluginCache() : bHasCategories( false ) {}
+};
+
+QDataStream& operator<<( QDataStream& stream, const CachedPlugin& plugin )
+{
+	stream << plugin.sName << plugin.sLabel << plugin.sID << plugin.sMaker
+		   << plugin.sCopyright << plugin.nICPorts << plugin.nOCPorts
+		   << plugin.nIAPorts << plugin.nOAPorts;
+	return stream;
+}
+
+QDataStream& operator>>( QDataStream& stream, CachedPlugin& plugin )
+{
+	stream >> plugin.sName >> plugin.sLabel >> plugin.sID >> plugin.sMaker
+		   >> plugin.sCopyright >> plugin.nICPorts >> plugin.nOCPorts
+		   >> plugin.nIAPorts >> plugin.nOAPorts;
+	return stream;
+}
+
+QDataStream& operator<<( QDataStream& stream, const CachedCategory& category )
+{
+	stream << category.path << category.uids;
+	return stream;
+}
+
+QDataStream& operator>>( QDataStream& stream, CachedCategory& category )
+{
+	stream >> category.path >> category.uids;
+	return stream;
+}
+
+/**
+ * Loads the library @a sAbsPath and stores the descriptors of all
+ * its mono and stereo plugins in @a library. The library is unloaded
+ * again afterwards.
+ *
+ * \return false if the library could not be loaded.
+ */
+static bool scanLibrary( const QString& sAbsPath, CachedLibrary& library )
+{
+	QLibrary lib( sAbsPath );
+	LADSPA_Descriptor_Function desc_func = ( LADSPA_Descriptor_Function )lib.resolve( "ladspa_descriptor" );
+	if ( desc_func == nullptr ) {
+		___ERRORLOG( "Error loading the library. (" + sAbsPath + ")" );
+		return false;
+	}
+
+	const LADSPA_Descriptor * d;
+	for ( unsigned i = 0; ( d = desc_func ( i ) ) != nullptr; i++ ) {
+		CachedPlugin plugin;
+		plugin.sName = QString::fromLocal8Bit(d->Name);
+		plugin.sLabel = QString::fromLocal8Bit(d->Label);
+		plugin.sID = QString::number(d->UniqueID);
+		plugin.sMaker = QString::fromLocal8Bit(d->Maker);
+		plugin.sCopyright = QString::fromLocal8Bit(d->Copyright);
+		plugin.nICPorts = 0;
+		plugin.nOCPorts = 0;
+		plugin.nIAPorts = 0;
+		plugin.nOAPorts = 0;
+
+		for ( unsigned j = 0; j < d->PortCount; j++ ) {
+			LADSPA_PortDescriptor pd = d->PortDescriptors[j];
+			if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
+				plugin.nICPorts++;
+			} else if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
+				plugin.nIAPorts++;
+			} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
+				plugin.nOCPorts++;
+			} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
+				plugin.nOAPorts++;
+			} else {
+				___ERRORLOG( QString( "%1::%2 unknown port type" )
+							 .arg( plugin.sLabel ).arg( QString::fromLocal8Bit( d->PortNames[ j ] ) ) );
+			}
+		}
+
+		if ( ( plugin.nIAPorts == 2 ) && ( plugin.nOAPorts == 2 ) ) {	// Stereo plugin
+			library.plugins.push_back( plugin );
+		} else if ( ( plugin.nIAPorts == 1 ) && ( plugin.nOAPorts == 1 ) ) {	// Mono plugin
+			library.plugins.push_back( plugin );
+		}
+		// else: not supported plugin
+	}
+
+	// Instantiating one of the plugins later on loads the library
+	// anew.
+	lib.unload();
+
+	return true;
+}
+
 Effects::Effects()
 		: Object( __class_name )
+		, m_pPluginCache( new PluginCache )
 		, m_pRootGroup( nullptr )
 		, m_pRecentGroup( nullptr )
 {
@@ -55,7 +201,12 @@ Effects::Effects()
 		m_FXList[ nFX ] = nullptr;
 	}
 
-	getPluginList();
+	// Runs concurrently with the remaining startup, like starting
+	// the audio drivers. Active FX are instantiated by
+	// LadspaFX::load() and do not depend on the list.
+	m_pluginScan = std::async( std::launch::async, [this]() {
+		scanPlugins();
+	} ).share();
 }
 
 
@@ -72,6 +223,8 @@ void Effects::create_instance()
 
 Effects::~Effects()
 {
+	waitForPluginScan();
+
 	//INFOLOG( "DESTROY" );
 	if ( m_pRootGroup != nullptr ) delete m_pRootGroup;
 
@@ -84,6 +237,8 @@ Effects::~Effects()
 	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
 		delete m_FXList[ nFX ];
 	}
+
+	delete m_pPluginCache;
 }
 
 
@@ -127,9 +282,26 @@ void  Effects::setLadspaFX( LadspaFX* pFX, int nFX )
 ///
 std::vector<LadspaFXInfo*> Effects::getPluginList()
 {
-	if ( m_pluginList.size() != 0 ) {
-		return m_pluginList;
+	waitForPluginScan();
+	return m_pluginList;
+}
+
+void Effects::waitForPluginScan()
+{
+	if ( m_pluginScan.valid() ) {
+		m_pluginScan.wait();
 	}
+}
+
+void Effects::scanPlugins()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	readPluginCache();
+
+	std::map<QString, CachedLibrary> libraries;
+	int nScanned = 0;
 
 	foreach ( const QString& sPluginDir, Filesystem::ladspa_paths() ) {
 		INFOLOG( "*** [getPluginList] reading directory: " + sPluginDir );
@@ -161,62 +333,54 @@ std::vector<LadspaFXInfo*> Effects::getPluginList()
 			if ( pos == -1 ) {
 				continue;
 			}
-			//warningLog( "[getPluginList] Loading: " + sPluginName  );
 
 			QString sAbsPath = QString( "%1/%2" ).arg( sPluginDir ).arg( sPluginName );
+			qint64 nModified = list.at( i ).lastModified().toMSecsSinceEpoch();
+			qint64 nSize = list.at( i ).size();
 
-			QLibrary lib( sAbsPath );
-			LADSPA_Descriptor_Function desc_func = ( LADSPA_Descriptor_Function )lib.resolve( "ladspa_descriptor" );
-			if ( desc_func == nullptr ) {
-				ERRORLOG( "Error loading the library. (" + sAbsPath + ")" );
-				continue;
-			}
-			const LADSPA_Descriptor * d;
-			if ( desc_func ) {
-				for ( unsigned i = 0; ( d = desc_func ( i ) ) != nullptr; i++ ) {
-					LadspaFXInfo* pFX = new LadspaFXInfo( QString::fromLocal8Bit(d->Name) );
-					pFX->m_sFilename = sAbsPath;
-					pFX->m_sLabel = QString::fromLocal8Bit(d->Label);
-					pFX->m_sID = QString::number(d->UniqueID);
-					pFX->m_sMaker = QString::fromLocal8Bit(d->Maker);
-					pFX->m_sCopyright = QString::fromLocal8Bit(d->Copyright);
-
-					//INFOLOG( "Loading: " + pFX->m_sLabel );
-
-					for ( unsigned j = 0; j < d->PortCount; j++ ) {
-						LADSPA_PortDescriptor pd = d->PortDescriptors[j];
-						if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
-							pFX->m_nICPorts++;
-						} else if ( LADSPA_IS_PORT_INPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
-							pFX->m_nIAPorts++;
-						} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_CONTROL( pd ) ) {
-							pFX->m_nOCPorts++;
-						} else if ( LADSPA_IS_PORT_OUTPUT( pd ) && LADSPA_IS_PORT_AUDIO( pd ) ) {
-							pFX->m_nOAPorts++;
-						} else {
-//							string sPortName = d->PortNames[ j ];
-							QString sPortName;
-							ERRORLOG( QString( "%1::%2 unknown port type" ).arg( pFX->m_sLabel ).arg( sPortName ) );
-						}
-					}
-					if ( ( pFX->m_nIAPorts == 2 ) && ( pFX->m_nOAPorts == 2 ) ) {	// Stereo plugin
-						m_pluginList.push_back( pFX );
-					} else if ( ( pFX->m_nIAPorts == 1 ) && ( pFX->m_nOAPorts == 1 ) ) {	// Mono plugin
-						m_pluginList.push_back( pFX );
-					} else {	// not supported plugin
-						//WARNINGLOG( "Plugin not supported: " + sPluginName  );
-						delete pFX;
-					}
-				}
+			auto it = m_pPluginCache->libraries.find( sAbsPath );
+			if ( it != m_pPluginCache->libraries.end() &&
+				 it->second.nModified == nModified && it->second.nSize == nSize ) {
+				libraries[ sAbsPath ] = it->second;
 			} else {
-				ERRORLOG( "Error loading: " + sPluginName  );
+				CachedLibrary library;
+				if ( ! scanLibrary( sAbsPath, library ) ) {
+					// Not cached. Maybe it can be loaded next time.
+					continue;
+				}
+				library.nModified = nModified;
+				library.nSize = nSize;
+				libraries[ sAbsPath ] = library;
+				++nScanned;
+			}
+
+			for ( const auto& plugin : libraries[ sAbsPath ].plugins ) {
+				LadspaFXInfo* pFX = new LadspaFXInfo( plugin.sName );
+				pFX->m_sFilename = sAbsPath;
+				pFX->m_sLabel = plugin.sLabel;
+				pFX->m_sID = plugin.sID;
+				pFX->m_sMaker = plugin.sMaker;
+				pFX->m_sCopyright = plugin.sCopyright;
+				pFX->m_nICPorts = plugin.nICPorts;
+				pFX->m_nOCPorts = plugin.nOCPorts;
+				pFX->m_nIAPorts = plugin.nIAPorts;
+				pFX->m_nOAPorts = plugin.nOAPorts;
+				m_pluginList.push_back( pFX );
 			}
 		}
 	}
 
-	INFOLOG( QString( "Loaded %1 LADSPA plugins" ).arg( m_pluginList.size() ) );
+	// Libraries removed in the meantime do make the sizes differ.
+	bool bChanged = nScanned > 0 ||
+		libraries.size() != m_pPluginCache->libraries.size();
+	m_pPluginCache->libraries.swap( libraries );
+	if ( bChanged ) {
+		writePluginCache();
+	}
+
+	INFOLOG( QString( "Loaded %1 LADSPA plugins (%2 libraries scanned) in %3 ms" )
+			 .arg( m_pluginList.size() ).arg( nScanned ).arg( timer.elapsed() ) );
 	std::sort( m_pluginList.begin(), m_pluginList.end(), LadspaFXInfo::alphabeticOrder );
-	return m_pluginList;
 }
 
 
@@ -224,6 +388,7 @@ std::vector<LadspaFXInfo*> Effects::getPluginList()
 LadspaFXGroup* Effects::getLadspaFXGroup()
 {
 	INFOLOG( "[getLadspaFXGroup]" );
+	waitForPluginScan();
 
 //	LadspaFX::getPluginList();	// load the list
 
@@ -289,10 +454,36 @@ void Effects::updateRecentGroup()
 #ifdef H2CORE_HAVE_LRDF
 
 
-void Effects::getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList )
+// funzione ricorsiva
+static void RDFDescend( const QString& sBase, const QStringList& path,
+						std::vector<CachedCategory>& categories )
 {
-	lrdf_init();
+	lrdf_uris* uris = lrdf_get_subclasses( sBase.toLocal8Bit() );
+	if ( uris ) {
+		for ( int i = 0; i < ( int )uris->count; i++ ) {
+			QStringList childPath( path );
+			childPath << QString::fromLocal8Bit(lrdf_get_label( uris->items[ i ] ));
+			RDFDescend( QString::fromLocal8Bit(uris->items[i]), childPath, categories );
+		}
+		lrdf_free_uris ( uris );
+	}
 
+	CachedCategory category;
+	category.path = path;
+	uris = lrdf_get_instances( sBase.toLocal8Bit() );
+	if ( uris ) {
+		for ( int i = 0; i < ( int )uris->count; i++ ) {
+			category.uids << lrdf_get_uid ( uris->items[i] );
+		}
+		lrdf_free_uris ( uris );
+	}
+	categories.push_back( category );
+}
+
+
+
+void Effects::getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList )
+{
 	QString sDir = "/usr/share/ladspa/rdf";
 
 	QDir dir( sDir );
@@ -301,6 +492,7 @@ void Effects::getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginLi
 		return;
 	}
 
+	QMap<QString, qint64> rdfFiles;
 	QFileInfoList list = dir.entryInfoList();
 	for ( int i = 0; i < list.size(); ++i ) {
 		QString sFilename = list.at( i ).fileName();
@@ -308,34 +500,42 @@ void Effects::getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginLi
 		if ( pos == -1 ) {
 			continue;
 		}
+		rdfFiles[ sFilename ] = list.at( i ).lastModified().toMSecsSinceEpoch();
+	}
 
-		QString sRDFFile = QString( "file://%1/%2" ).arg( sDir ).arg( sFilename );
-
-		int err = lrdf_read_file( sRDFFile.toLocal8Bit() );
-		if ( err ) {
-			ERRORLOG( "Error parsing rdf file " + sFilename );
-		}
+	if ( ! m_pPluginCache->bHasCategories || m_pPluginCache->rdfFiles != rdfFiles ) {
+		m_pPluginCache->categories.clear();
 
-		QString sBase = "http://ladspa.org/ontology#Plugin";
-		RDFDescend( sBase, pGroup, pluginList );
-	}
-}
+		if ( ! rdfFiles.isEmpty() ) {
+			lrdf_init();
 
+			foreach ( const QString& sFilename, rdfFiles.keys() ) {
+				QString sRDFFile = QString( "file://%1/%2" ).arg( sDir ).arg( sFilename );
 
+				int err = lrdf_read_file( sRDFFile.toLocal8Bit() );
+				if ( err ) {
+					ERRORLOG( "Error parsing rdf file " + sFilename );
+				}
+			}
 
-// funzione ricorsiva
-void Effects::RDFDescend( const QString& sBase, LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList )
-{
-	//cout << "LadspaFX::RDFDescend " << sBase.toLocal8Bit().constData() << endl;
+			// Descending once all files were read yields the same
+			// categories as doing so after each of them.
+			QString sBase = "http://ladspa.org/ontology#Plugin";
+			RDFDescend( sBase, QStringList(), m_pPluginCache->categories );
+		}
 
-	lrdf_uris* uris = lrdf_get_subclasses( sBase.toLocal8Bit() );
-	if ( uris ) {
-		for ( int i = 0; i < ( int )uris->count; i++ ) {
-			QString sGroup = QString::fromLocal8Bit(lrdf_get_label( uris->items[ i ] ));
+		m_pPluginCache->rdfFiles = rdfFiles;
+		m_pPluginCache->bHasCategories = true;
+		writePluginCache();
+	}
 
+	std::vector<LadspaFXGroup*> groups;
+	for ( const auto& category : m_pPluginCache->categories ) {
+		LadspaFXGroup *pCategoryGroup = pGroup;
+		foreach ( const QString& sGroup, category.path ) {
 			LadspaFXGroup *pNewGroup = nullptr;
 			// verifico se esiste gia una categoria con lo stesso nome
-			std::vector<LadspaFXGroup*> childGroups = pGroup-> getChildList();
+			std::vector<LadspaFXGroup*> childGroups = pCategoryGroup->getChildList();
 			for ( unsigned nGroup = 0; nGroup < childGroups.size(); nGroup++ ) {
 				LadspaFXGroup *pOldGroup = childGroups[nGroup];
 				if ( pOldGroup->getName() == sGroup ) {
@@ -345,26 +545,20 @@ void Effects::RDFDescend( const QString& sBase, LadspaFXGroup *pGroup, std::vect
 			}
 			if ( pNewGroup == nullptr ) {	// il gruppo non esiste, lo creo
 				pNewGroup = new LadspaFXGroup( sGroup );
-				pGroup->addChild( pNewGroup );
+				pCategoryGroup->addChild( pNewGroup );
+				groups.push_back( pNewGroup );
 			}
-			RDFDescend( QString::fromLocal8Bit(uris->items[i]), pNewGroup, pluginList );
+			pCategoryGroup = pNewGroup;
 		}
-		lrdf_free_uris ( uris );
-	}
-
-	uris = lrdf_get_instances( sBase.toLocal8Bit() );
-	if ( uris ) {
-		for ( int i = 0; i < ( int )uris->count; i++ ) {
-			int uid = lrdf_get_uid ( uris->items[i] );
 
+		foreach ( int uid, category.uids ) {
 			// verifico che il plugin non sia gia nella lista
 			bool bExists = false;
-			std::vector<LadspaFXInfo*> fxVect = pGroup->getLadspaInfo();
+			std::vector<LadspaFXInfo*> fxVect = pCategoryGroup->getLadspaInfo();
 			for ( unsigned nFX = 0; nFX < fxVect.size(); nFX++ ) {
-				LadspaFXInfo *pFX = fxVect[nFX];
-				if ( pFX->m_sID.toInt() == uid ) {
+				if ( fxVect[nFX]->m_sID.toInt() == uid ) {
 					bExists = true;
-					continue;
+					break;
 				}
 			}
 
@@ -374,19 +568,111 @@ void Effects::RDFDescend( const QString& sBase, LadspaFXGroup *pGroup, std::vect
 					LadspaFXInfo *pInfo = pluginList[i];
 
 					if ( pInfo->m_sID.toInt() == uid  ) {
-						pGroup->addLadspaInfo( pInfo );	// copy the LadspaFXInfo
+						pCategoryGroup->addLadspaInfo( pInfo );	// copy the LadspaFXInfo
 					}
 				}
 			}
 		}
-		lrdf_free_uris ( uris );
 	}
+
 	pGroup->sort();
+	for ( auto pSortGroup : groups ) {
+		pSortGroup->sort();
+	}
 }
 
 
 #endif // H2CORE_HAVE_LRDF
 
+void Effects::readPluginCache()
+{
+	QFile file( Filesystem::ladspa_cache_file() );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	quint32 nMagic, nVersion;
+	QString sHydrogenVersion;
+	stream >> nMagic >> nVersion >> sHydrogenVersion;
+	if ( stream.status() != QDataStream::Ok || nMagic != nCacheMagic ||
+		 nVersion != nCacheVersion ||
+		 sHydrogenVersion != QString( get_version().c_str() ) ) {
+		INFOLOG( QString( "Ignoring outdated LADSPA cache %1" ).arg( file.fileName() ) );
+		return;
+	}
+
+	PluginCache cache;
+	quint32 nLibraries;
+	stream >> nLibraries;
+	for ( quint32 i = 0; i < nLibraries && stream.status() == QDataStream::Ok; ++i ) {
+		QString sPath;
+		CachedLibrary library;
+		quint32 nPlugins;
+		stream >> sPath >> library.nModified >> library.nSize >> nPlugins;
+		for ( quint32 j = 0; j < nPlugins && stream.status() == QDataStream::Ok; ++j ) {
+			CachedPlugin plugin;
+			stream >> plugin;
+			library.plugins.push_back( plugin );
+		}
+		cache.libraries[ sPath ] = library;
+	}
+
+	quint32 nCategories;
+	stream >> cache.bHasCategories >> cache.rdfFiles >> nCategories;
+	for ( quint32 i = 0; i < nCategories && stream.status() == QDataStream::Ok; ++i ) {
+		CachedCategory category;
+		stream >> category;
+		cache.categories.push_back( category );
+	}
+
+	if ( stream.status() != QDataStream::Ok ) {
+		WARNINGLOG( QString( "LADSPA cache %1 is corrupt" ).arg( file.fileName() ) );
+		return;
+	}
+
+	*m_pPluginCache = cache;
+}
+
+void Effects::writePluginCache()
+{
+	if ( ! QDir( Filesystem::cache_dir() ).exists() ) {
+		return;
+	}
+
+	QSaveFile file( Filesystem::ladspa_cache_file() );
+	if ( ! file.open( QIODevice::WriteOnly ) ) {
+		WARNINGLOG( QString( "Unable to write LADSPA cache %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+		return;
+	}
+
+	QDataStream stream( &file );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	stream << nCacheMagic << nCacheVersion << QString( get_version().c_str() );
+	stream << static_cast<quint32>( m_pPluginCache->libraries.size() );
+	for ( const auto& it : m_pPluginCache->libraries ) {
+		stream << it.first << it.second.nModified << it.second.nSize
+			   << static_cast<quint32>( it.second.plugins.size() );
+		for ( const auto& plugin : it.second.plugins ) {
+			stream << plugin;
+		}
+	}
+	stream << m_pPluginCache->bHasCategories << m_pPluginCache->rdfFiles
+		   << static_cast<quint32>( m_pPluginCache->categories.size() );
+	for ( const auto& category : m_pPluginCache->categories ) {
+		stream << category;
+	}
+
+	if ( ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to write LADSPA cache %1: %2" )
+					.arg( file.fileName() ).arg( file.errorString() ) );
+	}
+}
+
 };
 
 #endif // H2CORE_HAVE_LADSPA
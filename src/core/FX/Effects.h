@@ -32,6 +32,7 @@
 
 #include <vector>
 #include <cassert>
+#include <future>
 
 namespace H2Core
 {
@@ -56,7 +57,27 @@ public:
 	LadspaFX* getLadspaFX( int nFX );
 	void  setLadspaFX( LadspaFX* pFX, int nFX );
 
+	/**
+	 * Lists all usable plugins in Filesystem::ladspa_paths().
+	 *
+	 * The list is assembled in a background thread started with
+	 * the creation of the singleton. This call waits for it to
+	 * finish.
+	 *
+	 * The descriptors of the plugins are read from
+	 * Filesystem::ladspa_cache_file(). Only libraries not present
+	 * in there or differing in size or modification time from the
+	 * cached entry are loaded to query them. All other libraries
+	 * are not loaded before one of their plugins is instantiated
+	 * by LadspaFX::load().
+	 */
 	std::vector<LadspaFXInfo*> getPluginList();
+	/**
+	 * Groups the plugins alphabetically and, if built with LRDF,
+	 * by the categories listed in their RDF metadata. The
+	 * categories are cached as well and the RDF files are only
+	 * parsed if one of them was changed.
+	 */
 	LadspaFXGroup* getLadspaFXGroup();
 
 
@@ -67,6 +88,10 @@ private:
 	 * accessed with get_instance().
 	 */
 	static Effects* __instance;
+	/** Content of Filesystem::ladspa_cache_file(). Defined in
+		Effects.cpp.*/
+	struct PluginCache;
+	PluginCache* m_pPluginCache;
 	std::vector<LadspaFXInfo*> m_pluginList;
 	LadspaFXGroup* m_pRootGroup;
 	LadspaFXGroup* m_pRecentGroup;
@@ -77,9 +102,17 @@ private:
 
 	Effects();
 
-	void RDFDescend( const QString& sBase, LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList );
 	void getRDF( LadspaFXGroup *pGroup, std::vector<LadspaFXInfo*> pluginList );
 
+	void readPluginCache();
+	void writePluginCache();
+
+	/** Fills #m_pluginList. Executed by #m_pluginScan.*/
+	void scanPlugins();
+	/** Blocks until #m_pluginScan is done.*/
+	void waitForPluginScan();
+	std::shared_future<void> m_pluginScan;
+
 };
 
 };
@@ -0,0 +1,134 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/FX/InsertChain.h>
+#include <core/FX/AudioPlugin.h>
+#include <core/AudioEngine.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* InsertChain::__class_name = "InsertChain";
+
+InsertChain::InsertChain( float* pBuffer_L, float* pBuffer_R )
+	: Object( __class_name )
+	, m_pBuffer_L( pBuffer_L )
+	, m_pBuffer_R( pBuffer_R )
+	, m_bActive( false )
+{
+	for ( int nSlot = 0; nSlot < MAX_INSERTS; ++nSlot ) {
+		m_plugins[ nSlot ] = nullptr;
+	}
+}
+
+InsertChain::~InsertChain()
+{
+	for ( int nSlot = 0; nSlot < MAX_INSERTS; ++nSlot ) {
+		delete m_plugins[ nSlot ];
+	}
+}
+
+void InsertChain::setPlugin( int nSlot, AudioPlugin* pPlugin )
+{
+	assert( nSlot >= 0 && nSlot < MAX_INSERTS );
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
+	AudioPlugin* pOldPlugin = m_plugins[ nSlot ];
+	if ( pOldPlugin != nullptr ) {
+		pOldPlugin->deactivate();
+	}
+
+	m_plugins[ nSlot ] = pPlugin;
+	connect();
+	if ( pPlugin != nullptr ) {
+		pPlugin->activate();
+	}
+
+	m_bActive = false;
+	for ( int nn = 0; nn < MAX_INSERTS; ++nn ) {
+		if ( m_plugins[ nn ] != nullptr ) {
+			m_bActive = true;
+		}
+	}
+
+	AudioEngine::get_instance()->unlock();
+
+	// Not required to be done with the engine locked.
+	delete pOldPlugin;
+}
+
+void InsertChain::connect()
+{
+	float* pIn_L = m_pBuffer_L;
+	float* pIn_R = m_pBuffer_R;
+
+	for ( int nSlot = 0; nSlot < MAX_INSERTS; ++nSlot ) {
+		AudioPlugin* pPlugin = m_plugins[ nSlot ];
+		if ( pPlugin == nullptr ) {
+			continue;
+		}
+
+		pPlugin->connectAudioPorts( pIn_L, pIn_R, pPlugin->m_pBuffer_L, pPlugin->m_pBuffer_R );
+		pIn_L = pPlugin->m_pBuffer_L;
+		pIn_R = pPlugin->m_pBuffer_R;
+	}
+}
+
+void InsertChain::process( uint32_t nFrames )
+{
+	const float* pIn_L = m_pBuffer_L;
+	const float* pIn_R = m_pBuffer_R;
+
+	for ( int nSlot = 0; nSlot < MAX_INSERTS; ++nSlot ) {
+		AudioPlugin* pPlugin = m_plugins[ nSlot ];
+		if ( pPlugin == nullptr ) {
+			continue;
+		}
+
+		float* pOut_L = pPlugin->m_pBuffer_L;
+		float* pOut_R = pPlugin->m_pBuffer_R;
+		if ( pPlugin->isEnabled() ) {
+			pPlugin->processFX( nFrames );
+			if ( pPlugin->getPluginType() == AudioPlugin::MONO_FX ) {
+				// The left input only was processed.
+				memcpy( pOut_R, pOut_L, nFrames * sizeof( float ) );
+			}
+		} else {
+			memcpy( pOut_L, pIn_L, nFrames * sizeof( float ) );
+			memcpy( pOut_R, pIn_R, nFrames * sizeof( float ) );
+		}
+		pIn_L = pOut_L;
+		pIn_R = pOut_R;
+	}
+
+	if ( pIn_L != m_pBuffer_L ) {
+		memcpy( m_pBuffer_L, pIn_L, nFrames * sizeof( float ) );
+		memcpy( m_pBuffer_R, pIn_R, nFrames * sizeof( float ) );
+	}
+}
+
+};
@@ -0,0 +1,109 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef INSERT_CHAIN_H
+#define INSERT_CHAIN_H
+
+#include <core/Object.h>
+
+#include <cstdint>
+
+/** Number of effects a H2Core::InsertChain can hold.*/
+#define MAX_INSERTS 4
+
+namespace H2Core
+{
+
+class AudioPlugin;
+
+/**
+ * Serial chain of insert effects processing the output of a
+ * DrumkitComponent within the Sampler.
+ *
+ * The first effect reads from the buffers passed to the constructor,
+ * every following one from the output of its predecessor, and the
+ * output of the last one is copied back. Since the buffers of the
+ * component do not move, the ports are only connected when the
+ * effects change. A disabled effect passes its input through
+ * unaltered.
+ *
+ * As long as at least one slot is occupied, the Sampler does mix the
+ * voices of the component into its buffers only and adds them to the
+ * main output after process().
+ */
+class InsertChain : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/**
+	 * \param pBuffer_L Left buffer of size #MAX_BUFFER_SIZE the
+	 * chain processes in place.
+	 * \param pBuffer_R Right one.
+	 */
+	InsertChain( float* pBuffer_L, float* pBuffer_R );
+	~InsertChain();
+
+	/** \return Effect in slot @a nSlot or nullptr.*/
+	AudioPlugin* getPlugin( int nSlot ) const;
+	/**
+	 * Replaces the effect in slot @a nSlot, connects and
+	 * activates @a pPlugin, and reconnects the following ones.
+	 *
+	 * The chain takes ownership of @a pPlugin and deletes the
+	 * previous effect. Locks the AudioEngine.
+	 *
+	 * \param nSlot In [0, #MAX_INSERTS).
+	 * \param pPlugin Effect to insert. nullptr clears the slot.
+	 */
+	void setPlugin( int nSlot, AudioPlugin* pPlugin );
+
+	/** \return Whether at least one slot is occupied. Only changes
+		while the AudioEngine is locked.*/
+	bool isActive() const;
+
+	/** Runs all effects on the first @a nFrames frames of the
+		buffers. Called by the audio engine.*/
+	void process( uint32_t nFrames );
+
+private:
+	/** Connects the audio ports of all effects. Has to be called
+		with the AudioEngine locked.*/
+	void connect();
+
+	float* m_pBuffer_L;
+	float* m_pBuffer_R;
+	AudioPlugin* m_plugins[ MAX_INSERTS ];
+	bool m_bActive;
+};
+
+inline AudioPlugin* InsertChain::getPlugin( int nSlot ) const {
+	return m_plugins[ nSlot ];
+}
+
+inline bool InsertChain::isActive() const {
+	return m_bActive;
+}
+
+};
+
+#endif
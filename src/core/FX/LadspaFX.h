@@ -31,6 +31,7 @@
 #include <list>
 #include "ladspa.h"
 #include <core/Object.h>
+#include <core/FX/AudioPlugin.h>
 
 namespace H2Core
 {
@@ -112,37 +113,28 @@ public:
 
 
 
-class LadspaFX : public H2Core::Object
+class LadspaFX : public AudioPlugin
 {
 	H2_OBJECT
 public:
-	enum {
-		MONO_FX,
-		STEREO_FX,
-		UNDEFINED
-	};
-
 	//unsigned m_nBufferSize;
 
-	float* m_pBuffer_L;
-	float* m_pBuffer_R;
-
 	std::vector<LadspaControlPort*> inputControlPorts;
 	std::vector<LadspaControlPort*> outputControlPorts;
 
 	~LadspaFX();
 
-	void connectAudioPorts( float* pIn_L, float* pIn_R, float* pOut_L, float* pOut_R );
-	void activate();
-	void deactivate();
-	void processFX( unsigned nFrames );
+	void connectAudioPorts( float* pIn_L, float* pIn_R, float* pOut_L, float* pOut_R ) override;
+	void activate() override;
+	void deactivate() override;
+	void processFX( unsigned nFrames ) override;
 
 
 	const QString& getPluginLabel() {
 		return m_sLabel;
 	}
 
-	const QString& getPluginName() {
+	const QString& getPluginName() override {
 		return m_sName;
 	}
 	void setPluginName( const QString& sName ) {
@@ -153,16 +145,9 @@ public:
 		return m_sLibraryPath;
 	}
 
-	bool isEnabled() {
-		return m_bEnabled;
-	}
-	void setEnabled( bool value ) {
-		m_bEnabled = value;
-	}
-
 	static LadspaFX* load( const QString& sLibraryPath, const QString& sPluginLabel, long nSampleRate );
 
-	int getPluginType() {
+	int getPluginType() override {
 		return m_pluginType;
 	}
 
@@ -174,7 +159,6 @@ public:
 
 private:
 	bool m_pluginType;
-	bool m_bEnabled;
 	bool m_bActivated;	// Guard against plugins that can't be deactivated before being activated (
 	QString m_sLabel;
 	QString m_sName;
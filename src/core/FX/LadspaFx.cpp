@@ -116,12 +116,9 @@ const char* LadspaFX::__class_name = "LadspaFX";
 
 // ctor
 LadspaFX::LadspaFX( const QString& sLibraryPath, const QString& sPluginLabel )
-		: Object( __class_name )
+		: AudioPlugin( __class_name )
 //, m_nBufferSize( 0 )
-		, m_pBuffer_L( nullptr )
-		, m_pBuffer_R( nullptr )
 		, m_pluginType( UNDEFINED )
-		, m_bEnabled( false )
 		, m_bActivated( false )
 		, m_sLabel( sPluginLabel )
 		, m_sLibraryPath( sLibraryPath )
@@ -135,18 +132,6 @@ LadspaFX::LadspaFX( const QString& sLibraryPath, const QString& sPluginLabel )
 		, m_nOAPorts( 0 )
 {
 	INFOLOG( QString( "INIT - %1 - %2" ).arg( sLibraryPath ).arg( sPluginLabel ) );
-
-
-	m_pBuffer_L = new float[MAX_BUFFER_SIZE];
-	m_pBuffer_R = new float[MAX_BUFFER_SIZE];
-
-
-	// Touch all the memory (is this really necessary?)
-	for ( unsigned i = 0; i < MAX_BUFFER_SIZE; ++i ) {
-		m_pBuffer_L[ i ] = 0;
-		m_pBuffer_R[ i ] = 0;
-	}
-
 }
 
 
@@ -181,9 +166,6 @@ LadspaFX::~LadspaFX()
 	for ( unsigned i = 0; i < outputControlPorts.size(); i++ ) {
 		delete outputControlPorts[i];
 	}
-
-	delete[] m_pBuffer_L;
-	delete[] m_pBuffer_R;
 }
 
 
@@ -0,0 +1,442 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/Dsp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define H2CORE_DSP_SSE
+#include <emmintrin.h>
+#endif
+
+namespace H2Core
+{
+
+bool Dsp::m_bReferenceKernels = false;
+
+void Dsp::setReferenceKernels( bool bReference )
+{
+	m_bReferenceKernels = bReference;
+}
+
+void Dsp::disableDenormals()
+{
+#ifdef H2CORE_DSP_SSE
+	// Flush-to-zero (bit 15) and denormals-are-zero (bit 6) of the
+	// MXCSR register.
+	_mm_setcsr( _mm_getcsr() | 0x8040 );
+#elif defined(__aarch64__) && defined(__GNUC__)
+	// Flush-to-zero (bit 24) of the FPCR register.
+	uint64_t nFpcr;
+	__asm__ __volatile__( "mrs %0, fpcr" : "=r"( nFpcr ) );
+	__asm__ __volatile__( "msr fpcr, %0" : : "r"( nFpcr | ( 1 << 24 ) ) );
+#endif
+}
+
+float* Dsp::allocate( uint32_t nFrames )
+{
+	float* pBuffer = new ( std::align_val_t( DSP_BUFFER_ALIGNMENT ) ) float[ nFrames ];
+	clear( pBuffer, nFrames );
+	return pBuffer;
+}
+
+void Dsp::release( float* pBuffer )
+{
+	if ( pBuffer != nullptr ) {
+		operator delete[]( pBuffer, std::align_val_t( DSP_BUFFER_ALIGNMENT ) );
+	}
+}
+
+void Dsp::clear( float* pBuffer, uint32_t nFrames )
+{
+	memset( pBuffer, 0, nFrames * sizeof( float ) );
+}
+
+void Dsp::add( float* pDst, const float* pSrc, uint32_t nFrames )
+{
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		for ( ; ii + 4 <= nFrames; ii += 4 ) {
+			_mm_storeu_ps( pDst + ii, _mm_add_ps( _mm_loadu_ps( pDst + ii ),
+												  _mm_loadu_ps( pSrc + ii ) ) );
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		pDst[ ii ] += pSrc[ ii ];
+	}
+}
+
+void Dsp::addWithGain( float* pDst, const float* pSrc, float fGain, uint32_t nFrames )
+{
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		const __m128 gain = _mm_set1_ps( fGain );
+		for ( ; ii + 4 <= nFrames; ii += 4 ) {
+			_mm_storeu_ps( pDst + ii,
+						   _mm_add_ps( _mm_loadu_ps( pDst + ii ),
+									   _mm_mul_ps( _mm_loadu_ps( pSrc + ii ), gain ) ) );
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		pDst[ ii ] += pSrc[ ii ] * fGain;
+	}
+}
+
+void Dsp::convertInt16( float* pDst, const int16_t* pSrc, uint32_t nFrames )
+{
+	const float fScale = 1.0f / 32768.0f;
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		const __m128 scale = _mm_set1_ps( fScale );
+		for ( ; ii + 8 <= nFrames; ii += 8 ) {
+			__m128i values = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + ii ) );
+			// Place each value in the upper half of a 32 bit lane and
+			// shift it back down to extend the sign.
+			__m128i low = _mm_srai_epi32( _mm_unpacklo_epi16( values, values ), 16 );
+			__m128i high = _mm_srai_epi32( _mm_unpackhi_epi16( values, values ), 16 );
+			_mm_storeu_ps( pDst + ii, _mm_mul_ps( _mm_cvtepi32_ps( low ), scale ) );
+			_mm_storeu_ps( pDst + ii + 4, _mm_mul_ps( _mm_cvtepi32_ps( high ), scale ) );
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		pDst[ ii ] = pSrc[ ii ] * fScale;
+	}
+}
+
+/** Scales @a fValue by @a fScale, clips it to [-fScale,fMax], and
+	rounds it to the nearest integer.*/
+static inline int32_t toInteger( float fValue, float fScale, float fMax )
+{
+	float fScaled = std::min( std::max( fValue * fScale, -fScale ), fMax );
+	return static_cast<int32_t>( lrintf( fScaled ) );
+}
+
+/** \return Sum of two uniformly distributed values with a triangular
+	distribution over (-1,1).*/
+static inline float ditherNoise( Dsp::Dither* pDither )
+{
+	// Linear congruential generator of Numerical Recipes. Only the
+	// upper 24 bits, which have the longest period, are used.
+	pDither->nState = pDither->nState * 1664525u + 1013904223u;
+	float fFirst = ( pDither->nState >> 8 ) * ( 1.0f / 16777216.0f );
+	pDither->nState = pDither->nState * 1664525u + 1013904223u;
+	float fSecond = ( pDither->nState >> 8 ) * ( 1.0f / 16777216.0f );
+	return fFirst - fSecond;
+}
+
+void Dsp::interleave( float* pDst, const float* const* ppSrc, uint32_t nChannels,
+					  uint32_t nFrames, bool bClip )
+{
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		if ( nChannels == 2 ) {
+			const float* pSrc_L = ppSrc[ 0 ];
+			const float* pSrc_R = ppSrc[ 1 ];
+			const __m128 lower = _mm_set1_ps( bClip ? -1.0f : -HUGE_VALF );
+			const __m128 upper = _mm_set1_ps( bClip ? 1.0f : HUGE_VALF );
+			for ( ; ii + 4 <= nFrames; ii += 4 ) {
+				__m128 left = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc_L + ii ), lower ), upper );
+				__m128 right = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc_R + ii ), lower ), upper );
+				_mm_storeu_ps( pDst + ii * 2, _mm_unpacklo_ps( left, right ) );
+				_mm_storeu_ps( pDst + ii * 2 + 4, _mm_unpackhi_ps( left, right ) );
+			}
+		} else if ( nChannels > 2 ) {
+			// Each pair of channels of a multichannel device occupies
+			// two adjacent samples of every frame.
+			const uint32_t nVectorFrames = nFrames & ~3u;
+			const __m128 lower = _mm_set1_ps( bClip ? -1.0f : -HUGE_VALF );
+			const __m128 upper = _mm_set1_ps( bClip ? 1.0f : HUGE_VALF );
+			for ( uint32_t nChannel = 0; nChannel + 2 <= nChannels; nChannel += 2 ) {
+				const float* pSrc_L = ppSrc[ nChannel ];
+				const float* pSrc_R = ppSrc[ nChannel + 1 ];
+				float* pPair = pDst + nChannel;
+				for ( uint32_t jj = 0; jj < nVectorFrames; jj += 4 ) {
+					__m128 left = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc_L + jj ), lower ), upper );
+					__m128 right = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc_R + jj ), lower ), upper );
+					__m128 low = _mm_unpacklo_ps( left, right );
+					__m128 high = _mm_unpackhi_ps( left, right );
+					_mm_storel_pi( reinterpret_cast<__m64*>( pPair + jj * nChannels ), low );
+					_mm_storeh_pi( reinterpret_cast<__m64*>( pPair + ( jj + 1 ) * nChannels ), low );
+					_mm_storel_pi( reinterpret_cast<__m64*>( pPair + ( jj + 2 ) * nChannels ), high );
+					_mm_storeh_pi( reinterpret_cast<__m64*>( pPair + ( jj + 3 ) * nChannels ), high );
+				}
+			}
+			if ( nChannels % 2 != 0 ) {
+				const uint32_t nChannel = nChannels - 1;
+				for ( uint32_t jj = 0; jj < nVectorFrames; ++jj ) {
+					float fValue = ppSrc[ nChannel ][ jj ];
+					if ( bClip ) {
+						fValue = std::min( std::max( fValue, -1.0f ), 1.0f );
+					}
+					pDst[ jj * nChannels + nChannel ] = fValue;
+				}
+			}
+			ii = nVectorFrames;
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		for ( uint32_t nChannel = 0; nChannel < nChannels; ++nChannel ) {
+			float fValue = ppSrc[ nChannel ][ ii ];
+			if ( bClip ) {
+				fValue = std::min( std::max( fValue, -1.0f ), 1.0f );
+			}
+			pDst[ ii * nChannels + nChannel ] = fValue;
+		}
+	}
+}
+
+void Dsp::interleaveInt16( int16_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+						   uint32_t nFrames, Dither* pDither )
+{
+	const float fScale = 32768.0f;
+	const float fMax = 32767.0f;
+
+	if ( pDither != nullptr ) {
+		for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+			for ( uint32_t nChannel = 0; nChannel < nChannels; ++nChannel ) {
+				float fScaled = ppSrc[ nChannel ][ ii ] * fScale + ditherNoise( pDither );
+				pDst[ ii * nChannels + nChannel ] = static_cast<int16_t>(
+					lrintf( std::min( std::max( fScaled, -fScale ), fMax ) ) );
+			}
+		}
+		return;
+	}
+
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		const __m128 scale = _mm_set1_ps( fScale );
+		const __m128 lower = _mm_set1_ps( -fScale );
+		const __m128 upper = _mm_set1_ps( fMax );
+		// Rounds according to the current rounding mode, which is to
+		// nearest just like lrintf().
+		auto convert = [&]( const float* pSrc ) {
+			return _mm_cvtps_epi32( _mm_min_ps( _mm_max_ps(
+				_mm_mul_ps( _mm_loadu_ps( pSrc ), scale ), lower ), upper ) );
+		};
+		if ( nChannels == 1 ) {
+			const float* pSrc = ppSrc[ 0 ];
+			for ( ; ii + 8 <= nFrames; ii += 8 ) {
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + ii ),
+								  _mm_packs_epi32( convert( pSrc + ii ), convert( pSrc + ii + 4 ) ) );
+			}
+		} else if ( nChannels == 2 ) {
+			const float* pSrc_L = ppSrc[ 0 ];
+			const float* pSrc_R = ppSrc[ 1 ];
+			for ( ; ii + 8 <= nFrames; ii += 8 ) {
+				__m128i left = _mm_packs_epi32( convert( pSrc_L + ii ), convert( pSrc_L + ii + 4 ) );
+				__m128i right = _mm_packs_epi32( convert( pSrc_R + ii ), convert( pSrc_R + ii + 4 ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + ii * 2 ),
+								  _mm_unpacklo_epi16( left, right ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + ii * 2 + 8 ),
+								  _mm_unpackhi_epi16( left, right ) );
+			}
+		} else if ( nChannels > 2 ) {
+			// Each pair of channels of a multichannel device occupies
+			// 32 adjacent bits of every frame.
+			const uint32_t nVectorFrames = nFrames & ~3u;
+			for ( uint32_t nChannel = 0; nChannel + 2 <= nChannels; nChannel += 2 ) {
+				const float* pSrc_L = ppSrc[ nChannel ];
+				const float* pSrc_R = ppSrc[ nChannel + 1 ];
+				int16_t* pPair = pDst + nChannel;
+				for ( uint32_t jj = 0; jj < nVectorFrames; jj += 4 ) {
+					__m128i packed = _mm_packs_epi32( convert( pSrc_L + jj ), convert( pSrc_R + jj ) );
+					__m128i pairs = _mm_unpacklo_epi16( packed, _mm_srli_si128( packed, 8 ) );
+					for ( uint32_t kk = 0; kk < 4; ++kk ) {
+						int32_t nPair = _mm_cvtsi128_si32( pairs );
+						memcpy( pPair + ( jj + kk ) * nChannels, &nPair, sizeof( nPair ) );
+						pairs = _mm_srli_si128( pairs, 4 );
+					}
+				}
+			}
+			if ( nChannels % 2 != 0 ) {
+				const uint32_t nChannel = nChannels - 1;
+				for ( uint32_t jj = 0; jj < nVectorFrames; ++jj ) {
+					pDst[ jj * nChannels + nChannel ] = static_cast<int16_t>(
+						toInteger( ppSrc[ nChannel ][ jj ], fScale, fMax ) );
+				}
+			}
+			ii = nVectorFrames;
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		for ( uint32_t nChannel = 0; nChannel < nChannels; ++nChannel ) {
+			pDst[ ii * nChannels + nChannel ] = static_cast<int16_t>(
+				toInteger( ppSrc[ nChannel ][ ii ], fScale, fMax ) );
+		}
+	}
+}
+
+void Dsp::interleaveInt24( uint8_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+						   uint32_t nFrames )
+{
+	for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+		for ( uint32_t nChannel = 0; nChannel < nChannels; ++nChannel ) {
+			int32_t nValue = toInteger( ppSrc[ nChannel ][ ii ], 8388608.0f, 8388607.0f );
+			uint8_t* pSample = pDst + ( ii * nChannels + nChannel ) * 3;
+			pSample[ 0 ] = static_cast<uint8_t>( nValue );
+			pSample[ 1 ] = static_cast<uint8_t>( nValue >> 8 );
+			pSample[ 2 ] = static_cast<uint8_t>( nValue >> 16 );
+		}
+	}
+}
+
+void Dsp::interleaveInt32( int32_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+						   uint32_t nFrames )
+{
+	const float fScale = 2147483648.0f;
+	// Largest float below 2^31.
+	const float fMax = 2147483520.0f;
+
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		const __m128 scale = _mm_set1_ps( fScale );
+		const __m128 lower = _mm_set1_ps( -fScale );
+		const __m128 upper = _mm_set1_ps( fMax );
+		auto convert = [&]( const float* pSrc ) {
+			return _mm_cvtps_epi32( _mm_min_ps( _mm_max_ps(
+				_mm_mul_ps( _mm_loadu_ps( pSrc ), scale ), lower ), upper ) );
+		};
+		if ( nChannels == 2 ) {
+			const float* pSrc_L = ppSrc[ 0 ];
+			const float* pSrc_R = ppSrc[ 1 ];
+			for ( ; ii + 4 <= nFrames; ii += 4 ) {
+				__m128i left = convert( pSrc_L + ii );
+				__m128i right = convert( pSrc_R + ii );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + ii * 2 ),
+								  _mm_unpacklo_epi32( left, right ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( pDst + ii * 2 + 4 ),
+								  _mm_unpackhi_epi32( left, right ) );
+			}
+		} else if ( nChannels > 2 ) {
+			// Each pair of channels of a multichannel device occupies
+			// 64 adjacent bits of every frame.
+			const uint32_t nVectorFrames = nFrames & ~3u;
+			for ( uint32_t nChannel = 0; nChannel + 2 <= nChannels; nChannel += 2 ) {
+				const float* pSrc_L = ppSrc[ nChannel ];
+				const float* pSrc_R = ppSrc[ nChannel + 1 ];
+				int32_t* pPair = pDst + nChannel;
+				for ( uint32_t jj = 0; jj < nVectorFrames; jj += 4 ) {
+					__m128i left = convert( pSrc_L + jj );
+					__m128i right = convert( pSrc_R + jj );
+					__m128i low = _mm_unpacklo_epi32( left, right );
+					__m128i high = _mm_unpackhi_epi32( left, right );
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( pPair + jj * nChannels ), low );
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( pPair + ( jj + 1 ) * nChannels ),
+									  _mm_unpackhi_epi64( low, low ) );
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( pPair + ( jj + 2 ) * nChannels ), high );
+					_mm_storel_epi64( reinterpret_cast<__m128i*>( pPair + ( jj + 3 ) * nChannels ),
+									  _mm_unpackhi_epi64( high, high ) );
+				}
+			}
+			if ( nChannels % 2 != 0 ) {
+				const uint32_t nChannel = nChannels - 1;
+				for ( uint32_t jj = 0; jj < nVectorFrames; ++jj ) {
+					pDst[ jj * nChannels + nChannel ] = toInteger( ppSrc[ nChannel ][ jj ], fScale, fMax );
+				}
+			}
+			ii = nVectorFrames;
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		for ( uint32_t nChannel = 0; nChannel < nChannels; ++nChannel ) {
+			pDst[ ii * nChannels + nChannel ] = toInteger( ppSrc[ nChannel ][ ii ], fScale, fMax );
+		}
+	}
+}
+
+float Dsp::maxAbs( const float* pBuffer, uint32_t nFrames, float fPeak )
+{
+	uint32_t ii = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		if ( nFrames >= 4 ) {
+			// Clearing the sign bit yields the absolute value.
+			const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+			__m128 peak = _mm_set1_ps( fPeak );
+			for ( ; ii + 4 <= nFrames; ii += 4 ) {
+				peak = _mm_max_ps( peak, _mm_and_ps( _mm_loadu_ps( pBuffer + ii ), absMask ) );
+			}
+			float peaks[ 4 ];
+			_mm_storeu_ps( peaks, peak );
+			for ( int nn = 0; nn < 4; ++nn ) {
+				if ( peaks[ nn ] > fPeak ) {
+					fPeak = peaks[ nn ];
+				}
+			}
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		float fValue = std::fabs( pBuffer[ ii ] );
+		if ( fValue > fPeak ) {
+			fPeak = fValue;
+		}
+	}
+	return fPeak;
+}
+
+float Dsp::dot( const float* pA, const float* pB, uint32_t nFrames )
+{
+	uint32_t ii = 0;
+	float fSum = 0;
+#ifdef H2CORE_DSP_SSE
+	if ( ! m_bReferenceKernels ) {
+		if ( nFrames >= 8 ) {
+			// Two accumulators hide the latency of the additions.
+			__m128 sum0 = _mm_setzero_ps();
+			__m128 sum1 = _mm_setzero_ps();
+			for ( ; ii + 8 <= nFrames; ii += 8 ) {
+				sum0 = _mm_add_ps( sum0, _mm_mul_ps( _mm_loadu_ps( pA + ii ),
+													 _mm_loadu_ps( pB + ii ) ) );
+				sum1 = _mm_add_ps( sum1, _mm_mul_ps( _mm_loadu_ps( pA + ii + 4 ),
+													 _mm_loadu_ps( pB + ii + 4 ) ) );
+			}
+			float sums[ 4 ];
+			_mm_storeu_ps( sums, _mm_add_ps( sum0, sum1 ) );
+			fSum = sums[ 0 ] + sums[ 1 ] + sums[ 2 ] + sums[ 3 ];
+		}
+	}
+#endif
+	for ( ; ii < nFrames; ++ii ) {
+		fSum += pA[ ii ] * pB[ ii ];
+	}
+	return fSum;
+}
+
+};
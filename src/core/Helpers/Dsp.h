@@ -0,0 +1,152 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_DSP_H
+#define H2C_DSP_H
+
+#include <cstdint>
+
+/** Alignment in bytes of the buffers returned by
+	H2Core::Dsp::allocate(). Covers both a cache line and the widest
+	vector registers in use.*/
+#define DSP_BUFFER_ALIGNMENT 64
+
+namespace H2Core
+{
+
+/**
+ * Block operations on float audio buffers used when mixing and
+ * metering within the process cycle and the conversions to the
+ * sample formats of the audio drivers.
+ *
+ * On x86 the SSE2 instruction set is used. All other platforms have
+ * to rely on the auto-vectorization of the scalar loops. The buffers
+ * do not need to be aligned. Buffers accumulated into within the
+ * process cycle are nevertheless created using allocate() to keep
+ * them from sharing cache lines.
+ *
+ * The scalar loops double as reference implementations. Using
+ * setReferenceKernels() they - and the ones of
+ * Interpolation::resample_stereo() - can be selected at runtime to
+ * check the vectorized kernels against them.
+ */
+class Dsp
+{
+public:
+	/** \return Buffer of @a nFrames zeroed values aligned to
+		#DSP_BUFFER_ALIGNMENT bytes. Has to be freed using
+		release().*/
+	static float* allocate( uint32_t nFrames );
+	/** Frees a buffer created by allocate(). @a pBuffer may be
+		nullptr.*/
+	static void release( float* pBuffer );
+	/** Sets the first @a nFrames values of @a pBuffer to zero.*/
+	static void clear( float* pBuffer, uint32_t nFrames );
+	/** Adds the first @a nFrames values of @a pSrc to @a pDst.*/
+	static void add( float* pDst, const float* pSrc, uint32_t nFrames );
+	/** Adds the first @a nFrames values of @a pSrc scaled by @a fGain
+		to @a pDst.*/
+	static void addWithGain( float* pDst, const float* pSrc, float fGain, uint32_t nFrames );
+	/** Converts the first @a nFrames 16 bit integers of @a pSrc to
+		float in [-1,1) and writes them to @a pDst.*/
+	static void convertInt16( float* pDst, const int16_t* pSrc, uint32_t nFrames );
+
+	/**
+	 * State of the triangular dither of one least significant bit
+	 * applied by interleaveInt16().
+	 */
+	struct Dither {
+		Dither( uint32_t nSeed = 1 ) : nState( nSeed ) {}
+		uint32_t nState;
+	};
+
+	/**
+	 * Interleaves the first @a nFrames values of each of the @a
+	 * nChannels buffers in @a ppSrc into @a pDst.
+	 *
+	 * \param bClip Whether to clip the values to [-1,1].
+	 */
+	static void interleave( float* pDst, const float* const* ppSrc, uint32_t nChannels,
+							uint32_t nFrames, bool bClip = false );
+	/**
+	 * Interleaves the first @a nFrames values of each of the @a
+	 * nChannels buffers in @a ppSrc into @a pDst as 16 bit integers
+	 * in native byte order. The values are clipped to [-1,1) and
+	 * rounded to the nearest integer.
+	 *
+	 * \param pDither Dither state to use or nullptr to truncate
+	 *   without dither. Dithering is done in scalar code and is
+	 *   meant for exports rather than the process cycle.
+	 */
+	static void interleaveInt16( int16_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+								 uint32_t nFrames, Dither* pDither = nullptr );
+	/** Like interleaveInt16() but writes packed 24 bit little endian
+		integers of three bytes each.*/
+	static void interleaveInt24( uint8_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+								 uint32_t nFrames );
+	/** Like interleaveInt16() but writes 32 bit integers in native
+		byte order.*/
+	static void interleaveInt32( int32_t* pDst, const float* const* ppSrc, uint32_t nChannels,
+								 uint32_t nFrames );
+	/**
+	 * \param pBuffer Samples to scan.
+	 * \param nFrames Number of samples to scan.
+	 * \param fPeak Peak obtained so far.
+	 * \return Maximum of @a fPeak and the absolute values of the
+	 * first @a nFrames samples of @a pBuffer.
+	 */
+	static float maxAbs( const float* pBuffer, uint32_t nFrames, float fPeak );
+	/** \return Sum of the products of the first @a nFrames values
+		of @a pA and @a pB.*/
+	static float dot( const float* pA, const float* pB, uint32_t nFrames );
+	/**
+	 * Enables flush-to-zero and denormals-are-zero for the calling
+	 * thread.
+	 *
+	 * Decaying envelopes and filter states otherwise end up in
+	 * denormal numbers, which are processed dramatically slower by
+	 * x86 CPUs. Has to be called by every thread running the audio
+	 * engine. Does nothing on platforms other than x86 and AArch64.
+	 */
+	static void disableDenormals();
+
+	/**
+	 * Selects the scalar reference loops instead of the vectorized
+	 * kernels for all threads.
+	 *
+	 * Meant for regression tests and debugging. Must not be called
+	 * while the audio engine is processing.
+	 */
+	static void setReferenceKernels( bool bReference );
+	/** \return Whether setReferenceKernels() was enabled.*/
+	static bool isUsingReferenceKernels() {
+		return m_bReferenceKernels;
+	}
+
+private:
+	static bool m_bReferenceKernels;
+};
+
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/FileInfoCache.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
+namespace H2Core
+{
+
+const char* FileInfoCache::__class_name = "FileInfoCache";
+
+FileInfoCache* FileInfoCache::__instance = nullptr;
+
+static FileInfoCache::Entry make_entry( const QFileInfo& info )
+{
+	FileInfoCache::Entry entry;
+	entry.bExists = info.exists();
+	entry.bFile = info.isFile();
+	entry.bDir = info.isDir();
+	entry.bReadable = info.isReadable();
+	entry.bWritable = info.isWritable();
+	entry.bExecutable = info.isExecutable();
+	return entry;
+}
+
+/** \return @a sPath cleaned and made absolute.*/
+static QString clean_path( const QString& sPath )
+{
+	if ( QDir::isAbsolutePath( sPath ) ) {
+		return QDir::cleanPath( sPath );
+	}
+	return QDir::cleanPath( QFileInfo( sPath ).absoluteFilePath() );
+}
+
+static QString parent_path( const QString& sPath )
+{
+	return sPath.left( sPath.lastIndexOf( '/' ) );
+}
+
+void FileInfoCache::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new FileInfoCache;
+	}
+}
+
+FileInfoCache::FileInfoCache()
+	: Object( __class_name )
+	, m_pWatcher( new QFileSystemWatcher )
+{
+	QObject::connect( m_pWatcher, &QFileSystemWatcher::directoryChanged,
+					  m_pWatcher, [this]( const QString& sDir ) {
+						  QMutexLocker locker( &m_mutex );
+						  drop( QDir::cleanPath( sDir ) );
+					  } );
+}
+
+FileInfoCache::~FileInfoCache()
+{
+	delete m_pWatcher;
+	__instance = nullptr;
+}
+
+bool FileInfoCache::is_usable() const
+{
+	return QThread::currentThread() == m_pWatcher->thread();
+}
+
+bool FileInfoCache::lookup( const QString& sPath, Entry& entry )
+{
+	if ( ! is_usable() || ! QDir::isAbsolutePath( sPath ) ) {
+		return false;
+	}
+	QString sCleanPath = QDir::cleanPath( sPath );
+
+	QMutexLocker locker( &m_mutex );
+	auto it = m_entries.constFind( sCleanPath );
+	if ( it != m_entries.constEnd() ) {
+		entry = it.value();
+		return true;
+	}
+	if ( m_dirs.contains( parent_path( sCleanPath ) ) ) {
+		// Not part of a completely listed directory.
+		entry = Entry{ false, false, false, false, false, false };
+		return true;
+	}
+	return false;
+}
+
+void FileInfoCache::prefetch( const QString& sDir )
+{
+	if ( ! is_usable() ) {
+		return;
+	}
+	QString sCleanDir = clean_path( sDir );
+	{
+		QMutexLocker locker( &m_mutex );
+		if ( m_dirs.contains( sCleanDir ) ) {
+			return;
+		}
+	}
+
+	QFileInfo dirInfo( sCleanDir );
+	if ( ! dirInfo.isDir() ) {
+		return;
+	}
+
+	QHash<QString, Entry> entries;
+	QStringList dirs;
+	entries.insert( sCleanDir, make_entry( dirInfo ) );
+	dirs << sCleanDir;
+
+	QDirIterator it( sCleanDir, QDir::AllEntries | QDir::NoDotAndDotDot |
+					 QDir::Hidden | QDir::System, QDirIterator::Subdirectories );
+	while ( it.hasNext() ) {
+		QString sPath = QDir::cleanPath( it.next() );
+		QFileInfo info = it.fileInfo();
+		entries.insert( sPath, make_entry( info ) );
+		// Content of symbolic links is not listed by the iterator.
+		if ( info.isDir() && ! info.isSymLink() ) {
+			dirs << sPath;
+		}
+		if ( entries.size() > nMaxEntries ) {
+			WARNINGLOG( QString( "[%1] contains more than %2 files. It will not be cached." )
+						.arg( sCleanDir ).arg( nMaxEntries ) );
+			return;
+		}
+	}
+
+	QStringList watched = m_pWatcher->directories();
+	QStringList missing;
+	for ( const auto& sPath : dirs ) {
+		if ( ! watched.contains( sPath ) ) {
+			missing << sPath;
+		}
+	}
+	if ( ! missing.isEmpty() ) {
+		QStringList failed = m_pWatcher->addPaths( missing );
+		if ( ! failed.isEmpty() ) {
+			// Without notifications the listing could get stale.
+			WARNINGLOG( QString( "Unable to watch [%1]. It will not be cached." )
+						.arg( failed.join( ", " ) ) );
+			return;
+		}
+	}
+
+	QMutexLocker locker( &m_mutex );
+	for ( auto itEntry = entries.constBegin(); itEntry != entries.constEnd(); ++itEntry ) {
+		m_entries.insert( itEntry.key(), itEntry.value() );
+	}
+	for ( const auto& sPath : dirs ) {
+		m_dirs.insert( sPath );
+	}
+}
+
+void FileInfoCache::invalidate( const QString& sPath )
+{
+	QString sCleanPath = clean_path( sPath );
+
+	QMutexLocker locker( &m_mutex );
+	if ( m_entries.isEmpty() ) {
+		return;
+	}
+	drop( sCleanPath );
+}
+
+void FileInfoCache::drop( const QString& sPath )
+{
+	QString sPrefix = sPath + "/";
+
+	m_entries.remove( sPath );
+	for ( auto it = m_entries.begin(); it != m_entries.end(); ) {
+		if ( it.key().startsWith( sPrefix ) ) {
+			it = m_entries.erase( it );
+		} else {
+			++it;
+		}
+	}
+
+	// Else @a sPath would be reported as missing.
+	m_dirs.remove( parent_path( sPath ) );
+	m_dirs.remove( sPath );
+	for ( auto it = m_dirs.begin(); it != m_dirs.end(); ) {
+		if ( it->startsWith( sPrefix ) ) {
+			it = m_dirs.erase( it );
+		} else {
+			++it;
+		}
+	}
+}
+
+};
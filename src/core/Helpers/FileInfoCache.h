@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_FILE_INFO_CACHE_H
+#define H2C_FILE_INFO_CACHE_H
+
+#include <core/Object.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+class QFileSystemWatcher;
+
+namespace H2Core
+{
+
+/**
+ * Cache of the type and permissions of the files within opened
+ * drumkits.
+ *
+ * Loading a song or a drumkit checks every single sample using
+ * Filesystem::file_readable() and friends, which is painfully slow on
+ * network-mounted libraries. prefetch() lists a whole drumkit
+ * directory in a single pass instead and Filesystem::check_permissions()
+ * answers all further queries for paths within it from memory -
+ * including the ones of files which do not exist.
+ *
+ * A QFileSystemWatcher observes all prefetched directories and drops
+ * them from the cache as soon as a file is added, removed, or
+ * renamed. Modifications of the content of a file are not tracked,
+ * which is why only existence, type, and permissions are cached. The
+ * Filesystem helpers writing files call invalidate() themselves, since
+ * the watcher reports changes via the event loop only.
+ *
+ * Because a QFileSystemWatcher can only be modified from the thread
+ * it was created in, the cache is used in the main thread only. All
+ * other threads access the disk as before.
+ */
+class FileInfoCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Cached properties of a path.*/
+		struct Entry {
+			bool bExists;
+			bool bFile;
+			bool bDir;
+			bool bReadable;
+			bool bWritable;
+			bool bExecutable;
+		};
+
+		/**
+		 * If #__instance equals nullptr, a new FileInfoCache
+		 * singleton will be created and stored in #__instance.
+		 *
+		 * Has to be called in the main thread.
+		 */
+		static void create_instance();
+		/** \return #__instance. nullptr if the audio engine was not
+			initialized yet or was already shut down.*/
+		static FileInfoCache* get_instance();
+
+		~FileInfoCache();
+
+		/**
+		 * \param sPath Absolute path to look up.
+		 * \param entry Set to the cached properties of @a sPath.
+		 * \return true if @a sPath lies within a prefetched
+		 * directory and @a entry was set.
+		 */
+		bool lookup( const QString& sPath, Entry& entry );
+		/**
+		 * Lists @a sDir and all its subdirectories once and caches
+		 * the properties of all contained paths. Does nothing if
+		 * @a sDir is already cached or contains more than
+		 * #nMaxEntries paths.
+		 *
+		 * \param sDir Absolute path of a directory, e.g. a drumkit.
+		 */
+		void prefetch( const QString& sDir );
+		/**
+		 * Drops @a sPath and - in case it is a directory - all paths
+		 * within it from the cache. The directory containing @a sPath
+		 * is no longer considered complete.
+		 */
+		void invalidate( const QString& sPath );
+
+		/** Maximum number of paths cached per prefetch().*/
+		static constexpr int nMaxEntries = 8192;
+
+	private:
+		FileInfoCache();
+
+		/** \return Whether the calling thread may use the cache.*/
+		bool is_usable() const;
+		/** Drops @a sPath and everything below it and marks its
+			parent as incomplete. Has to be called with #m_mutex
+			locked.*/
+		void drop( const QString& sPath );
+
+		static FileInfoCache* __instance;
+
+		QMutex m_mutex;
+		/** Cleaned absolute paths of all cached files and
+			directories.*/
+		QHash<QString, Entry> m_entries;
+		/** Directories whose complete content is stored in
+			#m_entries.*/
+		QSet<QString> m_dirs;
+		QFileSystemWatcher* m_pWatcher;
+};
+
+inline FileInfoCache* FileInfoCache::get_instance() {
+	return __instance;
+}
+
+};
+
+#endif
@@ -2,6 +2,8 @@
 #include <core/config.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/Hydrogen.h>
+#include <core/Basics/DrumkitIndex.h>
+#include <core/Helpers/FileInfoCache.h>
 
 #include <QtCore/QDir>
 #include <QtCore/QFile>
@@ -25,6 +27,7 @@
 #define PLAYLISTS       "playlists/"
 #define PLUGINS         "plugins/"
 #define REPOSITORIES    "repositories/"
+#define SAMPLES         "samples/"
 #define SCRIPTS         "scripts/"
 #define SONGS           "songs/"
 #define TMP             "hydrogen/"
@@ -161,6 +164,28 @@ bool Filesystem::bootstrap( Logger* logger, const QString& sys_path )
 
 bool Filesystem::check_permissions( const QString& path, const int perms, bool silent )
 {
+	FileInfoCache* pCache = FileInfoCache::get_instance();
+	FileInfoCache::Entry cached;
+	if ( pCache != nullptr && !( perms & is_writable ) && pCache->lookup( path, cached ) ) {
+		if( ( perms & is_dir ) && !cached.bDir ) {
+			if( !silent ) ERRORLOG( QString( "%1 is not a directory" ).arg( path ) );
+			return false;
+		}
+		if( ( perms & is_file ) && !cached.bFile ) {
+			if( !silent ) ERRORLOG( QString( "%1 is not a file" ).arg( path ) );
+			return false;
+		}
+		if( ( perms & is_readable ) && !cached.bReadable ) {
+			if( !silent ) ERRORLOG( QString( "%1 is not readable" ).arg( path ) );
+			return false;
+		}
+		if( ( perms & is_executable ) && !cached.bExecutable ) {
+			if( !silent ) ERRORLOG( QString( "%1 is not executable" ).arg( path ) );
+			return false;
+		}
+		return true;
+	}
+
 	QFileInfo fi( path );
 	if( ( perms & is_file ) && ( perms & is_writable ) && !fi.exists() ) {
 		QFileInfo folder( path.left( path.lastIndexOf( "/" ) ) );
@@ -224,6 +249,9 @@ bool Filesystem::dir_writable(  const QString& path, bool silent )
 
 bool Filesystem::mkdir( const QString& path )
 {
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->invalidate( path );
+	}
 	if ( !QDir( "/" ).mkpath( QDir( path ).absolutePath() ) ) {
 		ERRORLOG( QString( "unable to create directory : %1" ).arg( path ) );
 		return false;
@@ -249,6 +277,9 @@ bool Filesystem::write_to_file( const QString& dst, const QString& content )
 		ERRORLOG( QString( "unable to write to %1" ).arg( dst ) );
 		return false;
 	}
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->invalidate( dst );
+	}
 	QFile file( dst );
 	if ( !file.open( QIODevice::WriteOnly ) ) {
 		ERRORLOG( QString( "unable to write to %1" ).arg( dst ) );
@@ -282,12 +313,18 @@ bool Filesystem::file_copy( const QString& src, const QString& dst, bool overwri
 	if ( overwrite && file_exists( dst, true ) ) {
 		rm( dst, true );
 	}
-	
+
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->invalidate( dst );
+	}
 	return QFile::copy( src, dst );
 }
 
 bool Filesystem::rm( const QString& path, bool recursive )
 {
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->invalidate( path );
+	}
 	if ( check_permissions( path, is_file, true ) ) {
 		QFile file( path );
 		bool ret = file.remove();
@@ -313,6 +350,9 @@ bool Filesystem::rm( const QString& path, bool recursive )
 
 bool Filesystem::rm_fr( const QString& path )
 {
+	if ( FileInfoCache::get_instance() != nullptr ) {
+		FileInfoCache::get_instance()->invalidate( path );
+	}
 	bool ret = true;
 	QDir dir( path );
 	QFileInfoList entries = dir.entryInfoList( QDir::NoDotAndDotDot | QDir::AllEntries );
@@ -365,6 +405,8 @@ bool Filesystem::check_usr_paths()
 	if( !path_usable( __usr_data_path ) ) ret = false;
 	if( !path_usable( cache_dir() ) ) ret = false;
 	if( !path_usable( repositories_cache_dir() ) ) ret = false;
+	if( !path_usable( samples_cache_dir() ) ) ret = false;
+	if( !path_usable( songs_cache_dir() ) ) ret = false;
 	if( !path_usable( usr_drumkits_dir() ) ) ret = false;
 	if( !path_usable( patterns_dir() ) ) ret = false;
 	if( !path_usable( playlists_dir() ) ) ret = false;
@@ -511,6 +553,30 @@ QString Filesystem::repositories_cache_dir()
 {
 	return __usr_data_path + CACHE + REPOSITORIES;
 }
+QString Filesystem::samples_cache_dir()
+{
+	return __usr_data_path + CACHE + SAMPLES;
+}
+QString Filesystem::songs_cache_dir()
+{
+	return __usr_data_path + CACHE + SONGS;
+}
+QString Filesystem::xml_validation_cache_file()
+{
+	return __usr_data_path + CACHE + "xml_validation";
+}
+QString Filesystem::drumkit_index_file()
+{
+	return __usr_data_path + CACHE + "drumkits.index";
+}
+QString Filesystem::pattern_index_file()
+{
+	return __usr_data_path + CACHE + "patterns.index";
+}
+QString Filesystem::ladspa_cache_file()
+{
+	return __usr_data_path + CACHE + "ladspa.index";
+}
 QString Filesystem::demos_dir()
 {
 	return __sys_data_path + DEMOS;
@@ -555,10 +621,18 @@ QStringList Filesystem::drumkit_list( const QString& path )
 }
 QStringList Filesystem::sys_drumkit_list( )
 {
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	if ( pIndex != nullptr ) {
+		return pIndex->get_drumkit_list( Lookup::system );
+	}
 	return drumkit_list( sys_drumkits_dir() ) ;
 }
 QStringList Filesystem::usr_drumkit_list( )
 {
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	if ( pIndex != nullptr ) {
+		return pIndex->get_drumkit_list( Lookup::user );
+	}
 	return drumkit_list( usr_drumkits_dir() ) ;
 }
 
@@ -778,6 +852,8 @@ void Filesystem::info()
 	INFOLOG( QString( "User Click file            : %1" ).arg( usr_click_file_path() ) );
 	INFOLOG( QString( "Cache dir                  : %1" ).arg( cache_dir() ) );
 	INFOLOG( QString( "Reporitories Cache dir     : %1" ).arg( repositories_cache_dir() ) );
+	INFOLOG( QString( "Samples Cache dir          : %1" ).arg( samples_cache_dir() ) );
+	INFOLOG( QString( "Songs Cache dir            : %1" ).arg( songs_cache_dir() ) );
 	INFOLOG( QString( "User drumkit dir           : %1" ).arg( usr_drumkits_dir() ) );
 	INFOLOG( QString( "Patterns dir               : %1" ).arg( patterns_dir() ) );
 	INFOLOG( QString( "Playlist dir               : %1" ).arg( playlists_dir() ) );
@@ -130,6 +130,22 @@ namespace H2Core
 		static QString cache_dir();
 		/** returns user repository cache path */
 		static QString repositories_cache_dir();
+		/** returns user path of the decoded sample cache */
+		static QString samples_cache_dir();
+		/** returns user path of the parsed song cache */
+		static QString songs_cache_dir();
+		/** returns user path of the file holding the results of
+			previous XML schema validations */
+		static QString xml_validation_cache_file();
+		/** returns user path of the file holding the
+			H2Core::DrumkitIndex */
+		static QString drumkit_index_file();
+		/** returns user path of the file holding the
+			H2Core::PatternIndex */
+		static QString pattern_index_file();
+		/** returns user path of the file caching the metadata of
+			all LADSPA plugins, see H2Core::Effects */
+		static QString ladspa_cache_file();
 		/** returns system demos path */
 		static QString demos_dir();
 		/** returns system xsd path */
@@ -150,9 +166,13 @@ namespace H2Core
 		static bool file_is_under_drumkit( const QString& fname);
 		/** Returns the index of the basename if the given path is under an existing user or system drumkit path, otherwise -1 */
 		static int get_basename_idx_under_drumkit( const QString& fname);
-		/** returns list of usable system drumkits ( see Filesystem::drumkit_list ) */
+		/** returns list of usable system drumkits ( see
+			Filesystem::drumkit_list ). Answered by the
+			H2Core::DrumkitIndex if present. */
 		static QStringList sys_drumkit_list( );
-		/** returns list of usable user drumkits ( see Filesystem::drumkit_list ) */
+		/** returns list of usable user drumkits ( see
+			Filesystem::drumkit_list ). Answered by the
+			H2Core::DrumkitIndex if present. */
 		static QStringList usr_drumkit_list( );
 		/**
 		 * returns true if the drumkit exists within usable system or user drumkits
@@ -0,0 +1,182 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/LoudnessMeter.h>
+#include <core/Helpers/Dsp.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+/** Taps per phase of the true peak interpolation filter, as in
+	Annex 2 of ITU-R BS.1770.*/
+static const int nTruePeakTaps = 12;
+
+/** \return Loudness in LUFS of the mean square @a fEnergy.*/
+static double energyToLoudness( double fEnergy )
+{
+	return -0.691 + 10 * std::log10( fEnergy );
+}
+
+double LoudnessMeter::Biquad::process( int nChannel, double fIn )
+{
+	double fOut = b0 * fIn + b1 * x1[ nChannel ] + b2 * x2[ nChannel ]
+		- a1 * y1[ nChannel ] - a2 * y2[ nChannel ];
+	x2[ nChannel ] = x1[ nChannel ];
+	x1[ nChannel ] = fIn;
+	y2[ nChannel ] = y1[ nChannel ];
+	y1[ nChannel ] = fOut;
+	return fOut;
+}
+
+LoudnessMeter::LoudnessMeter( unsigned nSampleRate )
+	: m_nSubBlockFrames( std::max( 1u, nSampleRate / 10 ) )
+	, m_nSubBlockFill( 0 )
+	, m_fSubBlockEnergy( 0 )
+	, m_previousSubBlocks{ 0, 0, 0 }
+	, m_nSubBlocks( 0 )
+	, m_fTruePeak( 0 )
+{
+	// Coefficients of the K-weighting filter derived for arbitrary
+	// rates from the analog prototypes of BS.1770.
+	double fK = std::tan( M_PI * 1681.974450955533 / nSampleRate );
+	double fQ = 0.7071752369554196;
+	double fVh = std::pow( 10.0, 3.999843853973347 / 20 );
+	double fVb = std::pow( fVh, 0.4996667741545416 );
+	double fA0 = 1 + fK / fQ + fK * fK;
+	m_shelf = { ( fVh + fVb * fK / fQ + fK * fK ) / fA0,
+				2 * ( fK * fK - fVh ) / fA0,
+				( fVh - fVb * fK / fQ + fK * fK ) / fA0,
+				2 * ( fK * fK - 1 ) / fA0,
+				( 1 - fK / fQ + fK * fK ) / fA0,
+				{ 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+
+	fK = std::tan( M_PI * 38.13547087602444 / nSampleRate );
+	fQ = 0.5003270373238773;
+	fA0 = 1 + fK / fQ + fK * fK;
+	m_highPass = { 1, -2, 1,
+				   2 * ( fK * fK - 1 ) / fA0,
+				   ( 1 - fK / fQ + fK * fK ) / fA0,
+				   { 0, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 } };
+
+	// Windowed sinc interpolating between the original values.
+	m_nOversampling = nSampleRate > 88200 ? 2 : 4;
+	int nLength = nTruePeakTaps * m_nOversampling;
+	double fCenter = ( nLength - 1 ) / 2.0;
+	m_coefficients.resize( nLength );
+	for ( int kk = 0; kk < nLength; ++kk ) {
+		double fX = ( kk - fCenter ) / m_nOversampling;
+		double fSinc = fX == 0 ? 1 : std::sin( M_PI * fX ) / ( M_PI * fX );
+		double fWindow = 0.5 - 0.5 * std::cos( 2 * M_PI * ( kk + 0.5 ) / nLength );
+		int nPhase = kk % m_nOversampling;
+		int nTap = kk / m_nOversampling;
+		m_coefficients[ nPhase * nTruePeakTaps + nTruePeakTaps - 1 - nTap ] =
+			static_cast<float>( fSinc * fWindow );
+	}
+	for ( auto& history : m_history ) {
+		history.assign( nTruePeakTaps, 0.0f );
+	}
+}
+
+void LoudnessMeter::process( const float* pFrames, size_t nFrames )
+{
+	for ( size_t ii = 0; ii < nFrames; ++ii ) {
+		for ( int nChannel = 0; nChannel < 2; ++nChannel ) {
+			float fValue = pFrames[ 2 * ii + nChannel ];
+
+			double fWeighted = m_highPass.process( nChannel, m_shelf.process( nChannel, fValue ) );
+			m_fSubBlockEnergy += fWeighted * fWeighted;
+
+			std::vector<float>& history = m_history[ nChannel ];
+			std::copy( history.begin() + 1, history.end(), history.begin() );
+			history.back() = fValue;
+			for ( int nPhase = 0; nPhase < m_nOversampling; ++nPhase ) {
+				float fInterpolated = Dsp::dot( &m_coefficients[ nPhase * nTruePeakTaps ],
+												history.data(), nTruePeakTaps );
+				m_fTruePeak = std::max( m_fTruePeak, std::fabs( fInterpolated ) );
+			}
+			m_fTruePeak = std::max( m_fTruePeak, std::fabs( fValue ) );
+		}
+
+		if ( ++m_nSubBlockFill < m_nSubBlockFrames ) {
+			continue;
+		}
+
+		// A gating block consists of four sub-blocks of 100 ms.
+		double fEnergy = m_fSubBlockEnergy / m_nSubBlockFrames;
+		if ( ++m_nSubBlocks >= 4 ) {
+			m_blocks.push_back( ( fEnergy + m_previousSubBlocks[ 0 ] +
+								  m_previousSubBlocks[ 1 ] +
+								  m_previousSubBlocks[ 2 ] ) / 4 );
+		}
+		m_previousSubBlocks[ 2 ] = m_previousSubBlocks[ 1 ];
+		m_previousSubBlocks[ 1 ] = m_previousSubBlocks[ 0 ];
+		m_previousSubBlocks[ 0 ] = fEnergy;
+		m_fSubBlockEnergy = 0;
+		m_nSubBlockFill = 0;
+	}
+}
+
+double LoudnessMeter::getIntegratedLoudness() const
+{
+	// Absolute gate
+	double fSum = 0;
+	size_t nBlocks = 0;
+	for ( double fBlock : m_blocks ) {
+		if ( energyToLoudness( fBlock ) > -70 ) {
+			fSum += fBlock;
+			++nBlocks;
+		}
+	}
+	if ( nBlocks == 0 ) {
+		return -HUGE_VAL;
+	}
+
+	// Relative gate
+	double fThreshold = energyToLoudness( fSum / nBlocks ) - 10;
+	fSum = 0;
+	nBlocks = 0;
+	for ( double fBlock : m_blocks ) {
+		double fLoudness = energyToLoudness( fBlock );
+		if ( fLoudness > -70 && fLoudness > fThreshold ) {
+			fSum += fBlock;
+			++nBlocks;
+		}
+	}
+	if ( nBlocks == 0 ) {
+		return -HUGE_VAL;
+	}
+	return energyToLoudness( fSum / nBlocks );
+}
+
+double LoudnessMeter::getTruePeak() const
+{
+	if ( m_fTruePeak <= 0 ) {
+		return -HUGE_VAL;
+	}
+	return 20 * std::log10( m_fTruePeak );
+}
+
+};
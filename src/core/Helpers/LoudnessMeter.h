@@ -0,0 +1,102 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_LOUDNESS_METER_H
+#define H2C_LOUDNESS_METER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * Measures the integrated loudness according to EBU R128 (ITU-R
+ * BS.1770) and the true peak of interleaved stereo audio passed in
+ * blocks of arbitrary size.
+ *
+ * The loudness is computed from K-weighted 400 ms blocks overlapping
+ * by 75% using both the absolute gate of -70 LUFS and the relative
+ * gate of -10 LU. The true peak is the maximum of the audio
+ * oversampled by four (two above 88.2 kHz).
+ *
+ * It is used by the ExportWriter threads to analyse the exported
+ * files without reading them again.
+ */
+class LoudnessMeter
+{
+public:
+	explicit LoudnessMeter( unsigned nSampleRate );
+
+	void process( const float* pFrames, size_t nFrames );
+
+	/** \return Integrated loudness in LUFS or -HUGE_VAL if all
+		blocks were gated.*/
+	double getIntegratedLoudness() const;
+	/** \return True peak in dBTP or -HUGE_VAL for silence.*/
+	double getTruePeak() const;
+	/** \return Largest absolute value of the oversampled audio.*/
+	float getTruePeakLinear() const {
+		return m_fTruePeak;
+	}
+
+private:
+	/** Direct form I state of a biquad for both channels.*/
+	struct Biquad {
+		double b0, b1, b2, a1, a2;
+		double x1[ 2 ], x2[ 2 ], y1[ 2 ], y2[ 2 ];
+		double process( int nChannel, double fIn );
+	};
+
+	/** High shelf of the K-weighting filter.*/
+	Biquad m_shelf;
+	/** High pass of the K-weighting filter.*/
+	Biquad m_highPass;
+
+	/** Frames in each 100 ms sub-block.*/
+	size_t m_nSubBlockFrames;
+	/** Frames of the current sub-block processed so far.*/
+	size_t m_nSubBlockFill;
+	/** Sum of the squared weighted values of both channels of the
+		current sub-block.*/
+	double m_fSubBlockEnergy;
+	/** Mean square of the last three completed sub-blocks.*/
+	double m_previousSubBlocks[ 3 ];
+	/** Number of completed sub-blocks.*/
+	size_t m_nSubBlocks;
+	/** Mean square of all completed 400 ms blocks.*/
+	std::vector<double> m_blocks;
+
+	/** Oversampling factor of the true peak measurement.*/
+	int m_nOversampling;
+	/** Coefficients of the interpolation filter, one phase after the
+		other, each in reversed order.*/
+	std::vector<float> m_coefficients;
+	/** Last input values of each channel, oldest first.*/
+	std::vector<float> m_history[ 2 ];
+	float m_fTruePeak;
+};
+
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/Random.h>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+
+namespace H2Core
+{
+
+/**
+ * Inverse of the cumulative distribution function of the standard
+ * normal distribution using the rational approximation of Peter
+ * J. Acklam. The relative error is below 1.15e-9.
+ */
+static double inverseNormal( double p )
+{
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02,
+								-2.759285104469687e+02, 1.383577518672690e+02,
+								-3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02,
+								-1.556989798598866e+02, 6.680131188771972e+01,
+								-1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01,
+								-2.400758277161838e+00, -2.549732539343734e+00,
+								4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01,
+								2.445134137142996e+00, 3.754408661907416e+00 };
+	const double fLow = 0.02425;
+
+	if ( p < fLow ) {
+		double q = std::sqrt( -2 * std::log( p ) );
+		return ( ( ( ( ( c[0] * q + c[1] ) * q + c[2] ) * q + c[3] ) * q + c[4] ) * q + c[5] ) /
+			( ( ( ( d[0] * q + d[1] ) * q + d[2] ) * q + d[3] ) * q + 1 );
+	}
+	if ( p > 1 - fLow ) {
+		return -inverseNormal( 1 - p );
+	}
+	double q = p - 0.5;
+	double r = q * q;
+	return ( ( ( ( ( a[0] * r + a[1] ) * r + a[2] ) * r + a[3] ) * r + a[4] ) * r + a[5] ) * q /
+		( ( ( ( ( b[0] * r + b[1] ) * r + b[2] ) * r + b[3] ) * r + b[4] ) * r + 1 );
+}
+
+static std::array<float, ( 1 << 12 ) + 1> gaussianTable()
+{
+	std::array<float, ( 1 << 12 ) + 1> table;
+	for ( size_t ii = 0; ii < table.size(); ++ii ) {
+		table[ ii ] = static_cast<float>( inverseNormal( ( ii + 0.5 ) / table.size() ) );
+	}
+	return table;
+}
+
+static const std::array<float, ( 1 << 12 ) + 1> gaussianQuantiles = gaussianTable();
+const float* const Random::m_gaussianTable = gaussianQuantiles.data();
+
+void Random::seed( uint64_t nSeed )
+{
+	// SplitMix64 spreads similar seeds over the whole state, which
+	// must not be all zero.
+	for ( int ii = 0; ii < 2; ++ii ) {
+		nSeed += 0x9e3779b97f4a7c15ULL;
+		uint64_t z = nSeed;
+		z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+		z = z ^ ( z >> 31 );
+		m_state[ 2 * ii ] = static_cast<uint32_t>( z );
+		m_state[ 2 * ii + 1 ] = static_cast<uint32_t>( z >> 32 );
+	}
+	if ( ( m_state[ 0 ] | m_state[ 1 ] | m_state[ 2 ] | m_state[ 3 ] ) == 0 ) {
+		m_state[ 0 ] = 1;
+	}
+}
+
+uint64_t Random::timeSeed()
+{
+	return static_cast<uint64_t>(
+		std::chrono::high_resolution_clock::now().time_since_epoch().count() );
+}
+
+};
@@ -0,0 +1,119 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_RANDOM_H
+#define H2C_RANDOM_H
+
+#include <cstdint>
+
+namespace H2Core
+{
+
+/**
+ * Pseudo-random number generator used by the audio engine to
+ * humanize notes and to evaluate their probability.
+ *
+ * Based on xoshiro128** by David Blackman and Sebastiano Vigna. In
+ * contrast to std::rand() each instance has its own state, which
+ * makes the sequence reproducible for a given seed and avoids any
+ * locking. Gaussian values are looked up in a table instead of
+ * rejection sampling, so each of them takes exactly one draw.
+ */
+class Random
+{
+public:
+	Random( uint64_t nSeed = 1 ) { seed( nSeed ); }
+
+	/** Resets the state. The same seed yields the same sequence.*/
+	void seed( uint64_t nSeed );
+	/** \return Seed derived from the current time.*/
+	static uint64_t timeSeed();
+
+	/** \return Next 32 bit value.*/
+	uint32_t next();
+	/** \return Value uniformly distributed in [0,1).*/
+	float uniform();
+	/** \return Integer uniformly distributed in [0, @a nMax). @a
+		nMax has to be positive.*/
+	int below( int nMax );
+	/**
+	 * \return Normally distributed value with zero mean and
+	 *   standard deviation @a fDeviation. The distribution is
+	 *   truncated at about 3.5 standard deviations.
+	 */
+	float gaussian( float fDeviation );
+
+private:
+	uint32_t m_state[ 4 ];
+
+	/** Number of intervals in #m_gaussianTable.*/
+	static const int nGaussianBits = 12;
+	/** Quantiles of the standard normal distribution at
+		( k + 0.5 ) / ( 2^#nGaussianBits + 1 ) for k in [0,
+		2^#nGaussianBits].*/
+	static const float* const m_gaussianTable;
+};
+
+inline uint32_t Random::next()
+{
+	auto rotl = []( uint32_t x, int k ) {
+		return ( x << k ) | ( x >> ( 32 - k ) );
+	};
+	const uint32_t nResult = rotl( m_state[ 1 ] * 5, 7 ) * 9;
+	const uint32_t t = m_state[ 1 ] << 9;
+	m_state[ 2 ] ^= m_state[ 0 ];
+	m_state[ 3 ] ^= m_state[ 1 ];
+	m_state[ 1 ] ^= m_state[ 2 ];
+	m_state[ 0 ] ^= m_state[ 3 ];
+	m_state[ 2 ] ^= t;
+	m_state[ 3 ] = rotl( m_state[ 3 ], 11 );
+	return nResult;
+}
+
+inline float Random::uniform()
+{
+	// The upper 24 bits fit into the mantissa of a float.
+	return ( next() >> 8 ) * ( 1.0f / 16777216.0f );
+}
+
+inline int Random::below( int nMax )
+{
+	return static_cast<int>( ( static_cast<uint64_t>( next() ) * static_cast<uint32_t>( nMax ) ) >> 32 );
+}
+
+inline float Random::gaussian( float fDeviation )
+{
+	// The upper bits select the interval, the lower ones interpolate
+	// within.
+	const uint32_t nValue = next();
+	const uint32_t nIndex = nValue >> ( 32 - nGaussianBits );
+	const float fFraction = ( nValue & ( ( 1u << ( 32 - nGaussianBits ) ) - 1 ) ) *
+		( 1.0f / ( 1u << ( 32 - nGaussianBits ) ) );
+	const float fLower = m_gaussianTable[ nIndex ];
+	const float fUpper = m_gaussianTable[ nIndex + 1 ];
+	return ( fLower + ( fUpper - fLower ) * fFraction ) * fDeviation;
+}
+
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/Resampler.h>
+#include <core/Helpers/Dsp.h>
+
+#include <cmath>
+#include <numeric>
+
+namespace H2Core
+{
+
+/** Shape parameter of the Kaiser window. Results in a stop band
+	attenuation of about 90 dB.*/
+static const double fKaiserBeta = 9.0;
+/** Cut-off relative to the lower of both Nyquist frequencies.*/
+static const double fCutOff = 0.95;
+
+/** \return Zeroth order modified Bessel function of the first kind.*/
+static double besselI0( double fX )
+{
+	double fSum = 1;
+	double fTerm = 1;
+	for ( int kk = 1; kk < 50; ++kk ) {
+		fTerm *= ( fX / ( 2 * kk ) ) * ( fX / ( 2 * kk ) );
+		fSum += fTerm;
+		if ( fTerm < fSum * 1e-12 ) {
+			break;
+		}
+	}
+	return fSum;
+}
+
+bool Resampler::isSupported( unsigned nInputRate, unsigned nOutputRate )
+{
+	if ( nInputRate == 0 || nOutputRate == 0 ) {
+		return false;
+	}
+	return nOutputRate / std::gcd( nInputRate, nOutputRate ) <= RESAMPLER_MAX_PHASES;
+}
+
+Resampler::Resampler( unsigned nInputRate, unsigned nOutputRate )
+	: m_nInputRate( nInputRate )
+	, m_nOutputRate( nOutputRate )
+	, m_nInputFrames( 0 )
+	, m_nOutputFrames( 0 )
+{
+	unsigned nDivisor = std::gcd( nInputRate, nOutputRate );
+	m_nUp = nOutputRate / nDivisor;
+	m_nDown = nInputRate / nDivisor;
+
+	// Prototype low pass at the upsampled rate. Its gain of L
+	// compensates for the zeros inserted while upsampling.
+	const int nTaps = RESAMPLER_TAPS;
+	const int nLength = nTaps * m_nUp;
+	// Centered on a whole multiple of 1/L input frames to be able to
+	// compensate for the delay exactly.
+	m_nDelay = ( nLength - 1 ) / 2;
+	const double fCenter = m_nDelay;
+	const double fFrequency = 0.5 * fCutOff / std::max( m_nUp, m_nDown );
+	const double fNorm = besselI0( fKaiserBeta );
+
+	m_coefficients.resize( nLength );
+	for ( int kk = 0; kk < nLength; ++kk ) {
+		double fX = kk - fCenter;
+		double fSinc = fX == 0 ? 2 * fFrequency :
+			std::sin( 2 * M_PI * fFrequency * fX ) / ( M_PI * fX );
+		double fRatio = ( kk - fCenter ) / fCenter;
+		double fWindow = besselI0( fKaiserBeta * std::sqrt( std::max( 0.0, 1 - fRatio * fRatio ) ) ) / fNorm;
+
+		// Coefficient j of phase p is applied to the input frame j
+		// frames before the current one. Storing them in reverse
+		// allows for a forward dot product.
+		int nPhase = kk % m_nUp;
+		int nTap = kk / m_nUp;
+		m_coefficients[ nPhase * nTaps + nTaps - 1 - nTap ] =
+			static_cast<float>( m_nUp * fSinc * fWindow );
+	}
+
+	// The first output frame is centered on the first input frame.
+	for ( auto& history : m_history ) {
+		history.assign( nTaps - 1, 0.0f );
+	}
+	m_nTime = static_cast<uint64_t>( nTaps - 1 ) * m_nUp + m_nDelay;
+}
+
+void Resampler::process( const float* pIn, size_t nFrames, std::vector<float>& out )
+{
+	for ( int nChannel = 0; nChannel < 2; ++nChannel ) {
+		std::vector<float>& history = m_history[ nChannel ];
+		size_t nOffset = history.size();
+		history.resize( nOffset + nFrames );
+		for ( size_t ii = 0; ii < nFrames; ++ii ) {
+			history[ nOffset + ii ] = pIn[ 2 * ii + nChannel ];
+		}
+	}
+	m_nInputFrames += nFrames;
+
+	render( out, UINT64_MAX );
+}
+
+void Resampler::flush( std::vector<float>& out )
+{
+	uint64_t nTotal = ( m_nInputFrames * m_nUp + m_nDown - 1 ) / m_nDown;
+
+	// Enough silence to move the center of the filter past the last
+	// input frame.
+	size_t nPadding = m_nDelay / m_nUp + RESAMPLER_TAPS + 1;
+	for ( auto& history : m_history ) {
+		history.resize( history.size() + nPadding, 0.0f );
+	}
+
+	if ( nTotal > m_nOutputFrames ) {
+		render( out, nTotal - m_nOutputFrames );
+	}
+}
+
+void Resampler::render( std::vector<float>& out, uint64_t nMaxFrames )
+{
+	const int nTaps = RESAMPLER_TAPS;
+	const float* pLeft = m_history[ 0 ].data();
+	const float* pRight = m_history[ 1 ].data();
+	const uint64_t nAvailable = m_history[ 0 ].size();
+
+	uint64_t nFrames = 0;
+	while ( nFrames < nMaxFrames && m_nTime / m_nUp < nAvailable ) {
+		uint64_t nFrame = m_nTime / m_nUp;
+		const float* pCoefficients = &m_coefficients[ ( m_nTime % m_nUp ) * nTaps ];
+		size_t nFirst = nFrame + 1 - nTaps;
+		out.push_back( Dsp::dot( pCoefficients, pLeft + nFirst, nTaps ) );
+		out.push_back( Dsp::dot( pCoefficients, pRight + nFirst, nTaps ) );
+		m_nTime += m_nDown;
+		++nFrames;
+	}
+	m_nOutputFrames += nFrames;
+
+	// Drop all frames not needed by the next output frame.
+	uint64_t nConsumed = std::min( nAvailable, m_nTime / m_nUp + 1 - nTaps );
+	for ( auto& history : m_history ) {
+		history.erase( history.begin(), history.begin() + nConsumed );
+	}
+	m_nTime -= nConsumed * m_nUp;
+}
+
+};
@@ -0,0 +1,112 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_RESAMPLER_H
+#define H2C_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Number of input frames each output frame of an
+	H2Core::Resampler is computed from.*/
+#define RESAMPLER_TAPS 128
+/** Largest number of filter phases, i.e. the output rate divided by
+	the greatest common divisor of both rates, supported by
+	H2Core::Resampler.*/
+#define RESAMPLER_MAX_PHASES 1024
+
+namespace H2Core
+{
+
+/**
+ * Converts interleaved stereo audio from one sample rate to another
+ * using a polyphase windowed sinc filter.
+ *
+ * The ratio of both rates is reduced to L/M. Each output frame is
+ * the dot product of #RESAMPLER_TAPS consecutive input frames with
+ * one of L precomputed filter phases, computed using
+ * Dsp::dot(). The cut-off is placed just below the lower of both
+ * Nyquist frequencies and the delay of the filter is compensated
+ * for. Audio can be passed in blocks of arbitrary size.
+ *
+ * It is meant for the offline export, in which the whole song is
+ * rendered at the rate of the samples and converted once, instead of
+ * interpolating every single voice.
+ */
+class Resampler
+{
+public:
+	Resampler( unsigned nInputRate, unsigned nOutputRate );
+
+	/** \return Whether the ratio of @a nInputRate and @a
+		nOutputRate can be handled.*/
+	static bool isSupported( unsigned nInputRate, unsigned nOutputRate );
+
+	unsigned getInputRate() const {
+		return m_nInputRate;
+	}
+	unsigned getOutputRate() const {
+		return m_nOutputRate;
+	}
+
+	/**
+	 * Converts @a nFrames interleaved stereo frames of @a pIn and
+	 * appends the resulting frames to @a out.
+	 */
+	void process( const float* pIn, size_t nFrames, std::vector<float>& out );
+	/**
+	 * Appends the frames still held back by the delay of the filter
+	 * to @a out. The total number of output frames does correspond
+	 * to the length of the input.
+	 */
+	void flush( std::vector<float>& out );
+
+private:
+	/** Computes all output frames covered by #m_history but at most
+		@a nMaxFrames.*/
+	void render( std::vector<float>& out, uint64_t nMaxFrames );
+
+	unsigned m_nInputRate;
+	unsigned m_nOutputRate;
+	/** Upsampling factor L of the reduced ratio.*/
+	unsigned m_nUp;
+	/** Downsampling factor M of the reduced ratio.*/
+	unsigned m_nDown;
+	/** #RESAMPLER_TAPS coefficients of each of the #m_nUp phases
+		in reversed order.*/
+	std::vector<float> m_coefficients;
+	/** Input frames of both channels not consumed yet.*/
+	std::vector<float> m_history[ 2 ];
+	/** Position of the next output frame relative to the first
+		frame in #m_history in units of 1/#m_nUp input frames.*/
+	uint64_t m_nTime;
+	/** Delay of the filter in units of 1/#m_nUp input frames.*/
+	uint64_t m_nDelay;
+	uint64_t m_nInputFrames;
+	uint64_t m_nOutputFrames;
+};
+
+};
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/Threads.h>
+#include <core/Globals.h>
+#include <core/Preferences.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <QStringList>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+#if defined(__APPLE__) && defined(__has_include)
+#if __has_include(<os/workgroup.h>)
+#include <os/workgroup.h>
+#define H2CORE_OS_WORKGROUP
+#endif
+#endif
+
+namespace H2Core
+{
+
+const char* Threads::__class_name = "Threads";
+
+/** Upper bound of the CPU numbers accepted by parseCpuList(). Same
+	as the CPU_SETSIZE of glibc.*/
+static const int nMaxCpus = 1024;
+
+/** Incremented whenever the audio workgroup changes.*/
+static std::atomic<int> nAudioWorkgroupGeneration( 0 );
+/** Generation of the audio workgroup the calling thread is a member
+	of.*/
+static thread_local int nJoinedAudioWorkgroupGeneration = 0;
+#ifdef H2CORE_OS_WORKGROUP
+/** Guards #audioWorkgroup. Only locked when the workgroup changes.*/
+static std::mutex audioWorkgroupMutex;
+static os_workgroup_t audioWorkgroup = nullptr;
+static thread_local os_workgroup_t joinedAudioWorkgroup = nullptr;
+static thread_local os_workgroup_join_token_s audioWorkgroupJoinToken;
+#endif
+
+bool Threads::configureCurrentThread( Role role, const QString& sName )
+{
+	return configureThread( pthread_self(), role, sName );
+}
+
+bool Threads::configureThread( pthread_t thread, Role role, const QString& sName )
+{
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref == nullptr ) {
+		return false;
+	}
+
+	int nPriority = 0;
+	QString sCpus;
+	switch ( role ) {
+	case Role::Audio:
+		nPriority = pPref->m_nAudioThreadPriority;
+		sCpus = pPref->m_sAudioThreadCpus;
+		break;
+	case Role::Midi:
+		nPriority = pPref->m_nMidiThreadPriority;
+		sCpus = pPref->m_sMidiThreadCpus;
+		break;
+	case Role::Background:
+		sCpus = pPref->m_sBackgroundThreadCpus;
+		break;
+	}
+
+	bool bOk = true;
+
+#ifndef WIN32
+	if ( nPriority > 0 ) {
+		struct sched_param sched;
+		sched.sched_priority = std::min( std::max( nPriority, sched_get_priority_min( SCHED_FIFO ) ),
+										 sched_get_priority_max( SCHED_FIFO ) );
+		int nRes = pthread_setschedparam( thread, SCHED_FIFO, &sched );
+		if ( nRes != 0 ) {
+			_WARNINGLOG( QString( "Unable to set realtime scheduling of priority %1 for the %2 thread: %3" )
+						 .arg( sched.sched_priority ).arg( sName ).arg( strerror( nRes ) ) );
+			bOk = false;
+		} else {
+			_INFOLOG( QString( "Scheduling priority of the %1 thread = %2" )
+					  .arg( sName ).arg( sched.sched_priority ) );
+		}
+	}
+#endif
+
+	if ( ! sCpus.isEmpty() ) {
+		bool bValid;
+		std::vector<int> cpus = parseCpuList( sCpus, &bValid );
+		if ( ! bValid ) {
+			_ERRORLOG( QString( "Invalid CPU list [%1] for the %2 thread" ).arg( sCpus ).arg( sName ) );
+			return false;
+		}
+#if defined(__linux__)
+		cpu_set_t cpuSet;
+		CPU_ZERO( &cpuSet );
+		for ( int nCpu : cpus ) {
+			if ( nCpu < CPU_SETSIZE ) {
+				CPU_SET( nCpu, &cpuSet );
+			}
+		}
+		int nRes = pthread_setaffinity_np( thread, sizeof( cpuSet ), &cpuSet );
+		if ( nRes != 0 ) {
+			_WARNINGLOG( QString( "Unable to restrict the %1 thread to CPUs [%2]: %3" )
+						 .arg( sName ).arg( sCpus ).arg( strerror( nRes ) ) );
+			bOk = false;
+		} else {
+			_INFOLOG( QString( "%1 thread restricted to CPUs [%2]" ).arg( sName ).arg( sCpus ) );
+		}
+#else
+		_WARNINGLOG( QString( "CPU affinity of the %1 thread not supported on this platform" )
+					 .arg( sName ) );
+		bOk = false;
+#endif
+	}
+
+	return bOk;
+}
+
+void Threads::setAudioWorkgroup( void* pWorkgroup )
+{
+#ifdef H2CORE_OS_WORKGROUP
+	if ( __builtin_available( macOS 11.0, * ) ) {
+		std::lock_guard<std::mutex> lock( audioWorkgroupMutex );
+		if ( audioWorkgroup != nullptr ) {
+			os_release( audioWorkgroup );
+		}
+		audioWorkgroup = static_cast<os_workgroup_t>( pWorkgroup );
+		if ( audioWorkgroup != nullptr ) {
+			os_retain( audioWorkgroup );
+		}
+		nAudioWorkgroupGeneration.fetch_add( 1, std::memory_order_release );
+	}
+#else
+	UNUSED( pWorkgroup );
+#endif
+}
+
+void Threads::updateAudioWorkgroupMembership()
+{
+	int nGeneration = nAudioWorkgroupGeneration.load( std::memory_order_acquire );
+	if ( nGeneration == nJoinedAudioWorkgroupGeneration ) {
+		return;
+	}
+	nJoinedAudioWorkgroupGeneration = nGeneration;
+
+#ifdef H2CORE_OS_WORKGROUP
+	if ( __builtin_available( macOS 11.0, * ) ) {
+		leaveAudioWorkgroup();
+
+		os_workgroup_t workgroup;
+		{
+			std::lock_guard<std::mutex> lock( audioWorkgroupMutex );
+			workgroup = audioWorkgroup;
+			if ( workgroup != nullptr ) {
+				os_retain( workgroup );
+			}
+		}
+		if ( workgroup == nullptr ) {
+			return;
+		}
+
+		int nRes = os_workgroup_join( workgroup, &audioWorkgroupJoinToken );
+		if ( nRes != 0 ) {
+			_WARNINGLOG( QString( "Unable to join the audio workgroup: %1" ).arg( strerror( nRes ) ) );
+			os_release( workgroup );
+			return;
+		}
+		joinedAudioWorkgroup = workgroup;
+	}
+#endif
+}
+
+void Threads::leaveAudioWorkgroup()
+{
+#ifdef H2CORE_OS_WORKGROUP
+	if ( __builtin_available( macOS 11.0, * ) ) {
+		if ( joinedAudioWorkgroup != nullptr ) {
+			os_workgroup_leave( joinedAudioWorkgroup, &audioWorkgroupJoinToken );
+			os_release( joinedAudioWorkgroup );
+			joinedAudioWorkgroup = nullptr;
+		}
+	}
+#endif
+}
+
+bool Threads::lockMemory()
+{
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref == nullptr || ! pPref->m_bLockMemory ) {
+		return true;
+	}
+
+#ifndef WIN32
+	// With a limited amount of lockable memory locking future pages
+	// would cause allocations to fail once the limit is reached.
+	int nFlags = MCL_CURRENT | MCL_FUTURE;
+	struct rlimit limit;
+	if ( getrlimit( RLIMIT_MEMLOCK, &limit ) == 0 &&
+		 limit.rlim_cur != RLIM_INFINITY && geteuid() != 0 ) {
+		_WARNINGLOG( QString( "Lockable memory limited to %1 kB. Samples loaded later on will not be locked" )
+					 .arg( static_cast<qulonglong>( limit.rlim_cur / 1024 ) ) );
+		nFlags = MCL_CURRENT;
+	}
+	if ( mlockall( nFlags ) != 0 ) {
+		_ERRORLOG( QString( "Unable to lock memory: %1" ).arg( strerror( errno ) ) );
+		return false;
+	}
+	_INFOLOG( "Memory locked" );
+	return true;
+#else
+	_WARNINGLOG( "Memory locking not supported on this platform" );
+	return false;
+#endif
+}
+
+std::vector<int> Threads::parseCpuList( const QString& sCpus, bool* pOk )
+{
+	std::vector<int> cpus;
+	if ( pOk != nullptr ) {
+		*pOk = true;
+	}
+
+	for ( const QString& sRange : sCpus.split( ',', QString::SkipEmptyParts ) ) {
+		QStringList bounds = sRange.trimmed().split( '-' );
+		bool bFirst = false, bLast = false;
+		int nFirst = bounds[ 0 ].trimmed().toInt( &bFirst );
+		int nLast = bounds.size() > 1 ? bounds[ 1 ].trimmed().toInt( &bLast ) : nFirst;
+		if ( bounds.size() == 1 ) {
+			bLast = bFirst;
+		}
+		if ( ! bFirst || ! bLast || bounds.size() > 2 || nFirst < 0 || nLast < nFirst ||
+			 nLast >= nMaxCpus ) {
+			if ( pOk != nullptr ) {
+				*pOk = false;
+			}
+			return std::vector<int>();
+		}
+		for ( int nCpu = nFirst; nCpu <= nLast; ++nCpu ) {
+			cpus.push_back( nCpu );
+		}
+	}
+
+	std::sort( cpus.begin(), cpus.end() );
+	cpus.erase( std::unique( cpus.begin(), cpus.end() ), cpus.end() );
+	return cpus;
+}
+
+};
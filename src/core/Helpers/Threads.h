@@ -0,0 +1,127 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_THREADS_H
+#define H2C_THREADS_H
+
+#include <core/Object.h>
+
+#include <pthread.h>
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * Scheduling of the threads started by Hydrogen according to the
+ * thread configuration in the Preferences.
+ *
+ * Each thread belongs to a Role determining its SCHED_FIFO priority
+ * and the CPUs it is allowed to run on. This way the process cycle
+ * can be isolated on dedicated cores while the threads doing disk
+ * I/O and logging stay on the remaining ones.
+ *
+ * On macOS the process cycle runs on the IO thread of Core Audio,
+ * which belongs to the audio workgroup of the device. Helper threads
+ * working towards the same deadline, like the workers of the
+ * Sampler, join it via updateAudioWorkgroupMembership() so the
+ * scheduler keeps them on the performance cores.
+ */
+class Threads : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	enum class Role {
+		/** Threads running the process cycle, like the ones of the
+			ALSA, OSS, and PulseAudio drivers, and the workers of the
+			Sampler. See Preferences::m_nAudioThreadPriority and
+			Preferences::m_sAudioThreadCpus.*/
+		Audio,
+		/** Threads receiving MIDI events. See
+			Preferences::m_nMidiThreadPriority and
+			Preferences::m_sMidiThreadCpus.*/
+		Midi,
+		/** Threads doing disk I/O, logging, and OSC feedback. They
+			are never scheduled in realtime. See
+			Preferences::m_sBackgroundThreadCpus.*/
+		Background
+	};
+
+	/**
+	 * Applies the priority and CPU affinity configured for @a role
+	 * to the calling thread. Meant to be called at the beginning of
+	 * the thread function.
+	 *
+	 * \param sName Name of the thread used in the log messages.
+	 * \return false if any of the settings could not be applied.
+	 *   The thread keeps running with the default scheduling in this
+	 *   case.
+	 */
+	static bool configureCurrentThread( Role role, const QString& sName );
+	/** Like configureCurrentThread() but applies to @a thread.*/
+	static bool configureThread( pthread_t thread, Role role, const QString& sName );
+
+	/**
+	 * Sets the audio workgroup helper threads of the process cycle
+	 * are supposed to join. Called by the CoreAudioDriver with the
+	 * os_workgroup_t of its device or nullptr once it stops. A
+	 * reference to @a pWorkgroup is retained.
+	 *
+	 * Does nothing on platforms other than macOS 11 and later.
+	 */
+	static void setAudioWorkgroup( void* pWorkgroup );
+	/**
+	 * Lets the calling thread leave the audio workgroup it joined
+	 * before and join the one passed to setAudioWorkgroup(), if the
+	 * latter changed. Cheap enough to be called at every iteration of
+	 * a realtime loop.
+	 */
+	static void updateAudioWorkgroupMembership();
+	/** Lets the calling thread leave the audio workgroup it joined
+		in updateAudioWorkgroupMembership(). Has to be called before
+		the thread exits.*/
+	static void leaveAudioWorkgroup();
+
+	/**
+	 * Locks all pages of Hydrogen into RAM if
+	 * Preferences::m_bLockMemory is set. Samples loaded later on are
+	 * locked as well as long as the RLIMIT_MEMLOCK resource limit
+	 * does permit it.
+	 *
+	 * \return false if memory locking was requested but failed.
+	 */
+	static bool lockMemory();
+
+	/**
+	 * Parses a list of CPUs like "0,2-3".
+	 *
+	 * \param pOk Set to false if @a sCpus is malformed.
+	 * \return Numbers of the CPUs in ascending order. Empty if @a
+	 *   sCpus is empty or malformed.
+	 */
+	static std::vector<int> parseCpuList( const QString& sCpus, bool* pOk = nullptr );
+};
+
+};
+
+#endif
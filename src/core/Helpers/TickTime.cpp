@@ -0,0 +1,130 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Helpers/TickTime.h>
+
+#include <cmath>
+
+namespace H2Core
+{
+
+int64_t TickTime::tickSize( unsigned nSampleRate, float fBpm, int nResolution )
+{
+	if ( nSampleRate == 0 || ! ( fBpm > 0 ) || nResolution <= 0 ) {
+		return 0;
+	}
+	// The quotient is below 2^47 frames for any sensible tempo and
+	// resolution, so the rounding of a double does not lose any of
+	// the fractional bits.
+	return fromFrames( nSampleRate * 60.0 / static_cast<double>( fBpm ) / nResolution );
+}
+
+int64_t TickTime::fromFrames( double fFrames )
+{
+	return fFrames > 0 ? std::llround( std::ldexp( fFrames, nFractionBits ) ) : 0;
+}
+
+double TickTime::toFrames( int64_t nTickSize )
+{
+	return std::ldexp( static_cast<double>( nTickSize ), -nFractionBits );
+}
+
+long long TickTime::tickAtFrame( long long nFrame, int64_t nTickSize )
+{
+	if ( nTickSize <= 0 ) {
+		return 0;
+	}
+	return mulDiv( nFrame, nOneFrame, nTickSize, Rounding::down );
+}
+
+long long TickTime::frameAtTick( long long nTick, int64_t nTickSize )
+{
+	if ( nTickSize <= 0 ) {
+		return 0;
+	}
+	return mulDiv( nTick, nTickSize, nOneFrame, Rounding::up );
+}
+
+long long TickTime::framesIntoTick( long long nFrame, int64_t nTickSize )
+{
+	return nFrame - frameAtTick( tickAtFrame( nFrame, nTickSize ), nTickSize );
+}
+
+long long TickTime::rescale( long long nFrame, int64_t nOldTickSize, int64_t nNewTickSize )
+{
+	if ( nOldTickSize <= 0 || nNewTickSize <= 0 ) {
+		return nFrame;
+	}
+	return mulDiv( nFrame, nNewTickSize, nOldTickSize, Rounding::nearest );
+}
+
+int64_t TickTime::mulDiv( int64_t nA, int64_t nB, int64_t nC, Rounding rounding )
+{
+	// Negative values are handled by their magnitude with the
+	// direction of the rounding mirrored.
+	const bool bNegative = nA < 0;
+	if ( bNegative && rounding != Rounding::nearest ) {
+		rounding = rounding == Rounding::down ? Rounding::up : Rounding::down;
+	}
+	const uint64_t a = bNegative ? 0 - static_cast<uint64_t>( nA ) : static_cast<uint64_t>( nA );
+	const uint64_t b = static_cast<uint64_t>( nB );
+	const uint64_t c = static_cast<uint64_t>( nC );
+	const uint64_t nBias = rounding == Rounding::up ? c - 1 :
+		( rounding == Rounding::nearest ? c / 2 : 0 );
+
+	uint64_t nQuotient;
+#ifdef __SIZEOF_INT128__
+	nQuotient = static_cast<uint64_t>(
+		( static_cast<unsigned __int128>( a ) * b + nBias ) / c );
+#else
+	// 64 x 64 bit multiplication into two halves.
+	const uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+	const uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+	const uint64_t p0 = aLo * bLo, p1 = aLo * bHi, p2 = aHi * bLo, p3 = aHi * bHi;
+	const uint64_t nMid = ( p0 >> 32 ) + ( p1 & 0xffffffff ) + ( p2 & 0xffffffff );
+	uint64_t nLo = ( p0 & 0xffffffff ) | ( nMid << 32 );
+	uint64_t nHi = p3 + ( p1 >> 32 ) + ( p2 >> 32 ) + ( nMid >> 32 );
+	nLo += nBias;
+	if ( nLo < nBias ) {
+		++nHi;
+	}
+
+	// Restoring long division of the 128 bit product. Since the
+	// quotient fits into 64 bit, the high half is below c.
+	nQuotient = 0;
+	for ( int ii = 0; ii < 64; ++ii ) {
+		const bool bCarry = ( nHi >> 63 ) != 0;
+		nHi = ( nHi << 1 ) | ( nLo >> 63 );
+		nLo <<= 1;
+		nQuotient <<= 1;
+		if ( bCarry || nHi >= c ) {
+			nHi -= c;
+			nQuotient |= 1;
+		}
+	}
+#endif
+
+	return bNegative ? -static_cast<int64_t>( nQuotient ) : static_cast<int64_t>( nQuotient );
+}
+
+};
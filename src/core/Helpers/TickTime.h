@@ -0,0 +1,99 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_TICK_TIME_H
+#define H2C_TICK_TIME_H
+
+#include <cstdint>
+
+namespace H2Core
+{
+
+/**
+ * Exact conversion between frames and ticks.
+ *
+ * The number of frames per tick is kept as 64 bit fixed point number
+ * with #nFractionBits fractional bits instead of a float. A float
+ * tick size is off by up to 2^-24 of its value, i.e. a frame every
+ * few minutes of playback at common tempos. Since the tick size itself
+ * was rounded, dividing frames by it did not yield the same ticks
+ * everywhere the conversion was done with slightly different
+ * precision, and positions rescaled on tempo changes drifted.
+ *
+ * All conversions are done in integer arithmetic with 128 bit
+ * intermediates. They are exact with respect to the fixed point tick
+ * size and frameAtTick() is the inverse of tickAtFrame() for the
+ * first frame of each tick. Neither locks nor allocates.
+ */
+class TickTime
+{
+public:
+	/** Number of fractional bits of a fixed point tick size.*/
+	static constexpr int nFractionBits = 32;
+	/** A single frame in fixed point.*/
+	static constexpr int64_t nOneFrame = int64_t( 1 ) << nFractionBits;
+
+	/**
+	 * \return Number of frames per tick at @a fBpm as fixed point
+	 *   number. 0 if any of the arguments is not positive.
+	 */
+	static int64_t tickSize( unsigned nSampleRate, float fBpm, int nResolution );
+	/** \return @a fFrames frames per tick as fixed point number.*/
+	static int64_t fromFrames( double fFrames );
+	/** \return Fixed point tick size @a nTickSize in frames.*/
+	static double toFrames( int64_t nTickSize );
+
+	/**
+	 * \return Tick frame @a nFrame falls into, i.e. @a nFrame
+	 *   divided by @a nTickSize rounded towards negative
+	 *   infinity. 0 if @a nTickSize is not positive.
+	 */
+	static long long tickAtFrame( long long nFrame, int64_t nTickSize );
+	/**
+	 * \return First frame of tick @a nTick, i.e. @a nTick times
+	 *   @a nTickSize rounded towards positive infinity.
+	 */
+	static long long frameAtTick( long long nTick, int64_t nTickSize );
+	/**
+	 * \return Number of frames in between the first frame of tick
+	 *   tickAtFrame( @a nFrame, @a nTickSize ) and @a nFrame.
+	 */
+	static long long framesIntoTick( long long nFrame, int64_t nTickSize );
+	/**
+	 * Maps @a nFrame to the frame at the same - possibly fractional
+	 * - tick after the tick size changed from @a nOldTickSize to @a
+	 * nNewTickSize. The result is rounded to the nearest frame.
+	 */
+	static long long rescale( long long nFrame, int64_t nOldTickSize, int64_t nNewTickSize );
+
+private:
+	enum class Rounding { down, nearest, up };
+	/** \return @a nA times @a nB divided by @a nC rounded according
+		to @a rounding. @a nB and @a nC have to be positive and the
+		result has to fit into 64 bit.*/
+	static int64_t mulDiv( int64_t nA, int64_t nB, int64_t nC, Rounding rounding );
+};
+
+};
+
+#endif
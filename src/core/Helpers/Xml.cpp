@@ -1,7 +1,12 @@
 
 #include <core/Helpers/Xml.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Preferences.h>
+#include "Version.h"
 
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QFile>
+#include <QtCore/QSaveFile>
 #include <QtCore/QLocale>
 #include <QtCore/QString>
 #include <QtCore/QTextStream>
@@ -169,75 +174,147 @@ const char* XMLDoc::__class_name ="XMLDoc";
 
 XMLDoc::XMLDoc( ) : Object( __class_name ) { }
 
-bool XMLDoc::read( const QString& filepath, const QString& schemapath )
+bool XMLDoc::read( const QString& filepath, const QString& schemapath, bool force_validation )
 {
-	SilentMessageHandler Handler;
-	QXmlSchema schema;
-	schema.setMessageHandler( &Handler );
-	
-	bool schema_usable = false;
-	
-	if( schemapath!=nullptr ) {
-		QFile file( schemapath );
-		if ( !file.open( QIODevice::ReadOnly ) ) {
-			ERRORLOG( QString( "Unable to open XML schema %1 for reading" ).arg( schemapath ) );
-		} else {
-			schema.load( &file, QUrl::fromLocalFile( file.fileName() ) );
-			file.close();
-			if ( schema.isValid() ) {
-				schema_usable = true;
-			} else {
-				ERRORLOG( QString( "%2 XML schema is not valid" ).arg( schemapath ) );
-			}
-		}
-	}
-	
 	QFile file( filepath );
 	if ( !file.open( QIODevice::ReadOnly ) ) {
 		ERRORLOG( QString( "Unable to open %1 for reading" ).arg( filepath ) );
 		return false;
 	}
-	
-	if ( schema_usable ) {
-		QXmlSchemaValidator validator( schema );
-		if ( !validator.validate( &file, QUrl::fromLocalFile( file.fileName() ) ) ) {
+	const QByteArray content = file.readAll();
+	file.close();
+
+	if( schemapath!=nullptr ) {
+		const QByteArray key = validation_key( schemapath, content );
+
+		Preferences* pPref = Preferences::get_instance();
+		bool bStrict = force_validation || ( pPref != nullptr && pPref->m_bStrictXmlValidation );
+
+		int nPrevious = bStrict ? -1 : lookup_validation( key );
+		if ( nPrevious == 0 ) {
 			WARNINGLOG( QString( "XML document %1 is not valid (%2), loading may fail" ).arg( filepath ).arg( schemapath ) );
-			file.close();
 			return false;
-		} else {
-			INFOLOG( QString( "XML document %1 is valid (%2)" ).arg( filepath ).arg( schemapath ) );
+		} else if ( nPrevious < 0 ) {
+			SilentMessageHandler Handler;
+			QXmlSchema schema;
+			schema.setMessageHandler( &Handler );
+
+			QFile schemaFile( schemapath );
+			if ( !schemaFile.open( QIODevice::ReadOnly ) ) {
+				ERRORLOG( QString( "Unable to open XML schema %1 for reading" ).arg( schemapath ) );
+			} else {
+				schema.load( &schemaFile, QUrl::fromLocalFile( schemaFile.fileName() ) );
+				schemaFile.close();
+				if ( schema.isValid() ) {
+					QXmlSchemaValidator validator( schema );
+					bool bValid = validator.validate( content, QUrl::fromLocalFile( file.fileName() ) );
+					store_validation( key, bValid );
+					if ( !bValid ) {
+						WARNINGLOG( QString( "XML document %1 is not valid (%2), loading may fail" ).arg( filepath ).arg( schemapath ) );
+						return false;
+					}
+					INFOLOG( QString( "XML document %1 is valid (%2)" ).arg( filepath ).arg( schemapath ) );
+				} else {
+					ERRORLOG( QString( "%2 XML schema is not valid" ).arg( schemapath ) );
+				}
+			}
 		}
-		file.seek( 0 );
 	}
-	
-	if( !setContent( &file ) ) {
+
+	if( !setContent( content ) ) {
 		ERRORLOG( QString( "Unable to read XML document %1" ).arg( filepath ) );
-		file.close();
 		return false;
 	}
-	file.close();
-	
+
 	return true;
 }
 
+QMutex XMLDoc::__validation_mutex;
+QHash<QByteArray, bool> XMLDoc::__validation_results;
+bool XMLDoc::__validation_results_loaded = false;
+
+QByteArray XMLDoc::validation_key( const QString& schemapath, const QByteArray& content )
+{
+	// The schema shipped with another version of Hydrogen might
+	// differ.
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hash.addData( QByteArray::fromStdString( get_version() ) );
+	hash.addData( schemapath.toUtf8() );
+	hash.addData( content );
+	return hash.result().toHex();
+}
+
+int XMLDoc::lookup_validation( const QByteArray& key )
+{
+	QMutexLocker locker( &__validation_mutex );
+
+	if ( !__validation_results_loaded ) {
+		__validation_results_loaded = true;
+
+		QFile file( Filesystem::xml_validation_cache_file() );
+		if ( file.open( QIODevice::ReadOnly ) ) {
+			while ( !file.atEnd() ) {
+				QList<QByteArray> fields = file.readLine().trimmed().split( ' ' );
+				if ( fields.size() == 2 ) {
+					__validation_results.insert( fields[ 0 ], fields[ 1 ] == "1" );
+				}
+			}
+		}
+	}
+
+	auto it = __validation_results.constFind( key );
+	if ( it == __validation_results.constEnd() ) {
+		return -1;
+	}
+	return it.value() ? 1 : 0;
+}
+
+void XMLDoc::store_validation( const QByteArray& key, bool bValid )
+{
+	QMutexLocker locker( &__validation_mutex );
+
+	auto it = __validation_results.constFind( key );
+	if ( it != __validation_results.constEnd() && it.value() == bValid ) {
+		return;
+	}
+	__validation_results.insert( key, bValid );
+
+	// Entries are only appended. A later line supersedes an earlier
+	// one of the same key.
+	QFile file( Filesystem::xml_validation_cache_file() );
+	if ( !file.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+		_WARNINGLOG( QString( "Unable to write XML validation cache %1" ).arg( file.fileName() ) );
+		return;
+	}
+	file.write( key + ( bValid ? " 1\n" : " 0\n" ) );
+}
+
 bool XMLDoc::write( const QString& filepath )
 {
-	QFile file( filepath );
-	if ( !file.open( QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate ) ) {
+	// Written into a temporary file replacing the target once it is
+	// complete, so an interrupted save leaves the old version intact.
+	QSaveFile file( filepath );
+	file.setDirectWriteFallback( true );
+	if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
 		ERRORLOG( QString( "Unable to open %1 for writing" ).arg( filepath ) );
 		return false;
 	}
-	QTextStream out( &file );
-	out << toString().toUtf8();
-	out.flush();
 
-	bool rv = true;
-	if ( !toString().isEmpty() && file.size() == 0 ) {
-		rv = false;
+	QByteArray content = toString().toUtf8();
+	if ( file.write( content ) != content.size() ) {
+		ERRORLOG( QString( "Unable to write %1: %2" )
+				  .arg( filepath ).arg( file.errorString() ) );
+		file.cancelWriting();
+		file.commit();
+		return false;
 	}
 
-	file.close();
-	return rv;
+	if ( !file.commit() ) {
+		ERRORLOG( QString( "Unable to write %1: %2" )
+				  .arg( filepath ).arg( file.errorString() ) );
+		return false;
+	}
+	return true;
 }
 
 XMLNode XMLDoc::set_root( const QString& node_name, const QString& xmlns )
@@ -254,4 +331,122 @@ XMLNode XMLDoc::set_root( const QString& node_name, const QString& xmlns )
 	return root;
 }
 
+const char* XMLWriter::__class_name ="XMLWriter";
+
+XMLWriter::XMLWriter( )
+	: Object( __class_name )
+	, m_bStartTagOpen( false )
+{
+	m_text = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+}
+
+void XMLWriter::start_element( const QString& name )
+{
+	close_start_tag();
+	write_indentation();
+	m_text += '<';
+	m_text += name;
+	m_elements.push_back( name );
+	m_bStartTagOpen = true;
+}
+
+void XMLWriter::end_element()
+{
+	if ( m_elements.empty() ) {
+		ERRORLOG( "No element left to close" );
+		return;
+	}
+
+	QString name = m_elements.back();
+	m_elements.pop_back();
+	if ( m_bStartTagOpen ) {
+		m_text += "/>\n";
+		m_bStartTagOpen = false;
+	} else {
+		write_indentation();
+		m_text += "</";
+		m_text += name;
+		m_text += ">\n";
+	}
+}
+
+void XMLWriter::write_attribute( const QString& attribute, const QString& value )
+{
+	if ( ! m_bStartTagOpen ) {
+		ERRORLOG( QString( "Unable to write attribute [%1] after the children of its element" )
+				  .arg( attribute ) );
+		return;
+	}
+	m_text += ' ';
+	m_text += attribute;
+	m_text += "=\"";
+	write_escaped( value, true );
+	m_text += '"';
+}
+
+void XMLWriter::write_string( const QString& node, const QString& value )
+{
+	close_start_tag();
+	write_indentation();
+	m_text += '<';
+	m_text += node;
+	m_text += '>';
+	write_escaped( value, false );
+	m_text += "</";
+	m_text += node;
+	m_text += ">\n";
+}
+
+void XMLWriter::write_bool( const QString& node, const bool value )
+{
+	write_string( node, QString( ( value ? "true" : "false" ) ) );
+}
+
+QByteArray XMLWriter::finish()
+{
+	while ( ! m_elements.empty() ) {
+		end_element();
+	}
+	return m_text.toUtf8();
+}
+
+void XMLWriter::close_start_tag()
+{
+	if ( m_bStartTagOpen ) {
+		m_text += ">\n";
+		m_bStartTagOpen = false;
+	}
+}
+
+void XMLWriter::write_indentation()
+{
+	m_text.append( QString( static_cast<int>( m_elements.size() ), ' ' ) );
+}
+
+void XMLWriter::write_escaped( const QString& text, bool bAttribute )
+{
+	const int nLength = text.length();
+	for ( int ii = 0; ii < nLength; ++ii ) {
+		const QChar c = text.at( ii );
+		if ( c == '<' ) {
+			m_text += "&lt;";
+		} else if ( c == '"' ) {
+			m_text += "&quot;";
+		} else if ( c == '&' ) {
+			m_text += "&amp;";
+		} else if ( c == '>' && ii >= 2 && text.at( ii - 1 ) == ']' &&
+					text.at( ii - 2 ) == ']' ) {
+			m_text += "&gt;";
+		} else if ( bAttribute && c == '\n' ) {
+			m_text += "&#xa;";
+		} else if ( bAttribute && c == '\r' ) {
+			m_text += "&#xd;";
+		} else if ( bAttribute && c == '\t' ) {
+			m_text += "&#x9;";
+		} else {
+			m_text += c;
+		}
+	}
+}
+
 };
@@ -3,9 +3,13 @@
 #define H2C_XML_H
 
 #include <core/Object.h>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QString>
 #include <QtXml/QDomDocument>
 
+#include <vector>
+
 namespace H2Core
 {
 
@@ -134,10 +138,20 @@ class XMLDoc : public H2Core::Object, public QDomDocument
 		XMLDoc( );
 		/**
 		 * read the content of an xml file
+		 *
+		 * The outcome of each validation against @a schemapath is
+		 * remembered in Filesystem::xml_validation_cache_file(),
+		 * keyed by a hash of the file content. Unless
+		 * Preferences::m_bStrictXmlValidation or @a force_validation
+		 * is set, reading the same content again does reuse it
+		 * instead of running the schema validator.
+		 *
 		 * \param filepath the path to the file to read from
 		 * \param schemapath the path to the XML Schema file
+		 * \param force_validation validate even if a previous
+		 * result is known
 		 */
-		bool read( const QString& filepath, const QString& schemapath=nullptr );
+		bool read( const QString& filepath, const QString& schemapath=nullptr, bool force_validation=false );
 		/**
 		 * write itself into a file
 		 * \param filepath the path to the file to write to
@@ -149,6 +163,93 @@ class XMLDoc : public H2Core::Object, public QDomDocument
 		 * \param xmlns the xml namespace prefix to add after XMLNS_BASE
 		 */
 		XMLNode set_root( const QString& node_name, const QString& xmlns = nullptr );
+
+	private:
+		/** \return Key of the validation of @a content against
+			@a schemapath.*/
+		static QByteArray validation_key( const QString& schemapath, const QByteArray& content );
+		/** \return 1 if the document of @a key was found valid
+			before, 0 if it was found invalid, and -1 if it is
+			unknown.*/
+		static int lookup_validation( const QByteArray& key );
+		static void store_validation( const QByteArray& key, bool bValid );
+
+		/** Protects the validation results, since drumkits are
+			read by background threads too.*/
+		static QMutex __validation_mutex;
+		static QHash<QByteArray, bool> __validation_results;
+		/** Whether Filesystem::xml_validation_cache_file() was read
+			already.*/
+		static bool __validation_results_loaded;
+};
+
+/**
+ * XMLWriter writes an XML document element by element without
+ * building a DOM.
+ *
+ * The output equals the one of QDomDocument::toString() with an
+ * indentation of one space for a document holding the same
+ * elements, so files written by either of them can be compared
+ * byte by byte. Attributes are written in the order they are added.
+ * Elements are either empty, contain text only, or contain other
+ * elements only.
+ */
+class XMLWriter : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** Starts a document containing the xml header only.*/
+		XMLWriter( );
+
+		/**
+		 * opens a new child element of the current one
+		 * \param name the name of the element
+		 */
+		void start_element( const QString& name );
+		/** closes the element opened last */
+		void end_element();
+		/**
+		 * write an attribute of the element opened last. Has to be
+		 * called before any of its children is written.
+		 * \param attribute the name of the attribute to create
+		 * \param value the value to write in the attribute
+		 */
+		void write_attribute( const QString& attribute, const QString& value );
+
+		/**
+		 * write a string into a child node
+		 * \param node the name of the child node to create
+		 * \param value the value to write
+		 */
+		void write_string( const QString& node, const QString& value );
+		/**
+		 * write a boolean into a child node
+		 * \param node the name of the child node to create
+		 * \param value the value to write
+		 */
+		void write_bool( const QString& node, const bool value );
+
+		/**
+		 * closes all elements still open
+		 * \return the UTF-8 encoded document
+		 */
+		QByteArray finish();
+
+	private:
+		/** Terminates the start tag of the current element if its
+			first child is about to be written.*/
+		void close_start_tag();
+		void write_indentation();
+		/** Appends @a text with the same escaping QDomDocument
+			applies.*/
+		void write_escaped( const QString& text, bool bAttribute );
+
+		QString m_text;
+		/** Names of all elements opened but not closed yet.*/
+		std::vector<QString> m_elements;
+		/** Whether the start tag of the last element is not
+			terminated yet.*/
+		bool m_bStartTagOpen;
 };
 
 };
@@ -33,21 +33,25 @@
 #include <cassert>
 #include <cstdio>
 #include <deque>
-#include <queue>
+#include <map>
 #include <iostream>
 #include <ctime>
 #include <cmath>
 #include <algorithm>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <memory>
 
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
+#include <QElapsedTimer>
 
 #include <core/EventQueue.h>
 #include <core/Basics/Adsr.h>
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/DeferredSampleLoader.h>
 #include <core/H2Exception.h>
 #include <core/AudioEngine.h>
 #include <core/Basics/Instrument.h>
@@ -56,19 +60,38 @@
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/Playlist.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleLoader.h>
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/SampleStretcher.h>
+#include <core/Basics/DrumkitIndex.h>
+#include <core/Basics/PatternIndex.h>
+#include <core/Helpers/FileInfoCache.h>
+#include <core/InstrumentFreezer.h>
 #include <core/Basics/AutomationPath.h>
+#include <core/AllocationTracker.h>
 #include <core/Hydrogen.h>
+#include <core/NoteQueue.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
 #include <core/Basics/Note.h>
+#include <core/Basics/NotePool.h>
+#include <core/Helpers/Dsp.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Helpers/Random.h>
+#include <core/Helpers/Resampler.h>
+#include <core/Helpers/Threads.h>
+#include <core/Helpers/TickTime.h>
 #include <core/FX/LadspaFX.h>
 #include <core/FX/Effects.h>
 
 #include <core/Preferences.h>
+#include <core/RealtimeConfig.h>
+#include <core/Tracer.h>
 #include <core/Sampler/Sampler.h>
+#include <core/Sampler/WorkerPool.h>
 #include "MidiMap.h"
 #include <core/Timeline.h>
+#include <core/rt_clock.h>
 
 #ifdef H2CORE_HAVE_OSC
 #include <core/NsmClient.h>
@@ -84,19 +107,28 @@
 #include <core/IO/TransportInfo.h>
 #include <core/IO/OssDriver.h>
 #include <core/IO/FakeDriver.h>
+#include <core/IO/OfflineDriver.h>
+#include <core/IO/PluginDriver.h>
 #include <core/IO/AlsaAudioDriver.h>
 #include <core/IO/PortAudioDriver.h>
 #include <core/IO/DiskWriterDriver.h>
+#include <core/IO/ExportWriter.h>
 #include <core/IO/AlsaMidiDriver.h>
 #include <core/IO/JackMidiDriver.h>
 #include <core/IO/PortMidiDriver.h>
 #include <core/IO/CoreAudioDriver.h>
 #include <core/IO/PulseAudioDriver.h>
+#include <core/IO/PipeWireDriver.h>
+#include <core/IO/PipeWireMidiDriver.h>
 
 namespace H2Core
 {
 
 // GLOBALS
+//
+// State of the single audio engine of the process. It is accessed
+// both by the audio engine functions below and the Hydrogen
+// singleton.
 
 // info
 float				m_fMasterPeak_L = 0.0f;		///< Master peak (left channel)
@@ -147,20 +179,17 @@ MidiInput *			m_pMidiDriver = nullptr;
  */
 MidiOutput *			m_pMidiDriverOut = nullptr;
 
-// overload the > operator of Note objects for priority_queue
-struct compare_pNotes {
-	bool operator() (Note* pNote1, Note* pNote2) {
-		return (pNote1->get_humanize_delay()
-				+ pNote1->get_position() * m_pAudioDriver->m_transport.m_fTickSize)
-			    >
-			    (pNote2->get_humanize_delay()
-			    + pNote2->get_position() * m_pAudioDriver->m_transport.m_fTickSize);
-	}
-};
-
-/// Song Note FIFO
-std::priority_queue<Note*, std::deque<Note*>, compare_pNotes > m_songNoteQueue;
+/// Song Note FIFO ordered by start frame
+NoteQueue			m_songNoteQueue;
 std::deque<Note*>		m_midiNoteQueue;	///< Midi Note FIFO
+/**
+ * Notes played live via addRealtimeNote(). In contrast to
+ * #m_midiNoteQueue they do not pass through the lookahead window of
+ * audioEngine_updateNoteQueue() but are handed to the Sampler in the
+ * first process cycle covering their start frame by
+ * audioEngine_process_playLiveNotes().
+ */
+std::deque<Note*>		m_liveNoteQueue;
 
 /**
  * Patterns to be played next in Song::PATTERN_MODE.
@@ -269,6 +298,28 @@ float *				m_pMainBuffer_L = nullptr;
  * actual audio in audioEngine_process().
  */
 float *				m_pMainBuffer_R = nullptr;
+/**
+ * Receives the main output rendered in audioEngine_process() while
+ * exporting a song through the JACK driver in freewheel mode.
+ *
+ * Set and reset in Hydrogen::startExportSong() and
+ * Hydrogen::stopExportSong() while holding the AudioEngine lock.
+ */
+ExportWriter *			m_pExportWriter = nullptr;
+/** Last progress of a freewheel export pushed as #EVENT_PROGRESS.*/
+int				m_nExportProgress = 0;
+/**
+ * First tick queued by the next call of audioEngine_updateNoteQueue()
+ * or -1. Set in Hydrogen::skipExport() after the DiskWriterDriver took
+ * a column from its render cache instead of rendering it.
+ */
+long				m_nExportResumeTick = -1;
+/**
+ * First tick the next call of audioEngine_updateNoteQueue() is
+ * expected to queue during playback or -1 if the transport was not
+ * rolling. A different start tick indicates a relocation.
+ */
+long				m_nNextQueueTick = -1;
 /**
  * Current state of the H2Core::AudioEngine. 
  *
@@ -287,6 +338,12 @@ int				m_audioEngineState = STATE_UNINITIALIZED;
 #if defined(H2CORE_HAVE_LADSPA) || _DOXYGEN_
 float				m_fFXPeak_L[MAX_FX];
 float				m_fFXPeak_R[MAX_FX];
+/** Time in milliseconds LadspaFX::processFX() took for each effect
+	during the last process cycle. Zero for disabled ones.*/
+float				m_fFXProcessTime[MAX_FX];
+/** Whether the LADSPA effects were bypassed in the last process
+	cycle, see OverloadGovernor::LEVEL_BYPASS_FX.*/
+bool				m_bFXBypassed = false;
 #endif
 
 /**
@@ -316,8 +373,23 @@ unsigned int	m_nPatternTickPosition = 0;
     second loop.*/
 int				m_nSongSizeInTicks = 0;
 
-/** Updated in audioEngine_updateNoteQueue().*/
-struct timeval			m_currentTickTime;
+/** Random numbers used to humanize notes and to evaluate their
+	probability. Only accessed by the audio engine and seeded in
+	audioEngine_seedRandom().*/
+Random			m_random;
+
+/** Column of the song (PatternList) or selected Pattern
+	#m_pPlayingPatterns was last expanded from in
+	audioEngine_updateNoteQueue(), including the virtual patterns.*/
+const void*		m_pExpandedPatterns = nullptr;
+/** Pattern::get_generation() at the time #m_pExpandedPatterns was
+	expanded. The expansion is redone once any pattern did change.*/
+unsigned		m_nExpandedGeneration = 0;
+
+/** Updated in audioEngine_updateNoteQueue() in nanoseconds as
+	returned by rtclock_now_ns(). Used to place the timestamps of
+	incoming MIDI events relative to the current cycle.*/
+int64_t					m_nCurrentTickTimeNs = 0;
 
 /**
  * Variable keeping track of the transport position in realtime.
@@ -333,6 +405,69 @@ struct timeval			m_currentTickTime;
 unsigned long			m_nRealtimeFrames = 0;
 unsigned int			m_naddrealtimenotetickposition = 0;
 
+/**
+ * Drumkit loaded by Hydrogen::prepareDrumkit() in the background and
+ * swapped into the current Song by audioEngine_swapDrumkit().
+ */
+struct PreparedDrumkit {
+	enum State {
+		/** The background thread is loading the drumkit.*/
+		Loading,
+		/** Handed to #m_pPreparedDrumkit and waiting to be swapped
+			in.*/
+		Prepared,
+		/** Swapped into the Song.*/
+		Committed,
+		/** Canceled or rejected by audioEngine_swapDrumkit().*/
+		Discarded
+	};
+
+	/** Copy of the drumkit to load. Deleted once it is loaded.*/
+	Drumkit*			pDrumkit = nullptr;
+	bool				bConditional = true;
+	QString				sDrumkitName;
+	Filesystem::Lookup	lookup = Filesystem::Lookup::system;
+	/** Keeps the previous drumkit name alive, so the realtime
+		thread does not free it while swapping.*/
+	QString				sPreviousDrumkitName;
+
+	/** Song and its instruments at the time of preparation.*/
+	Song*				pSong = nullptr;
+	InstrumentList*		pSongInstrumentList = nullptr;
+	std::vector<Instrument*> songInstruments;
+	std::vector<int>	songInstrumentIDs;
+	/** Whether the element of #songInstruments at the same position
+		is kept since it is beyond the size of the new drumkit and
+		still has notes.*/
+	std::vector<char>	keepInstruments;
+
+	/** New instrument list and components before the swap and the
+		previous ones of the Song afterwards.*/
+	InstrumentList*		pInstrumentList = nullptr;
+	std::vector<DrumkitComponent*>* pComponents = nullptr;
+	/** Pairs of a replaced and the replacing instrument sorted by
+		the former.*/
+	std::vector<std::pair<Instrument*, Instrument*>> replacements;
+	/** Previous instruments to be deleted as soon as they are not
+		used by any note anymore.*/
+	std::vector<Instrument*> retiredInstruments;
+
+	std::atomic<int>	nState{ Loading };
+	std::atomic<bool>	bCommit{ false };
+	std::atomic<bool>	bAtBarBoundary{ true };
+	std::atomic<bool>	bCancel{ false };
+	/** Tells the background thread to stop waiting for notes using
+		the retired instruments.*/
+	std::atomic<bool>	bQuit{ false };
+};
+
+/**
+ * Drumkit waiting to be swapped in by audioEngine_swapDrumkit().
+ *
+ * Only accessed while holding the AudioEngine lock.
+ */
+PreparedDrumkit*		m_pPreparedDrumkit = nullptr;
+
 // PROTOTYPES
 /**
  * Initialization of the H2Core::AudioEngine called in Hydrogen::Hydrogen().
@@ -354,8 +489,15 @@ unsigned int			m_naddrealtimenotetickposition = 0;
       #STATE_INITIALIZED.
  * -# It calls H2Core::Effects::create_instance() (if the
       #H2CORE_HAVE_LADSPA is set),
-      H2Core::AudioEngine::create_instance(), and
-      H2Core::Playlist::create_instance().
+      H2Core::AudioEngine::create_instance(),
+      H2Core::Playlist::create_instance(),
+      H2Core::SampleStretcher::create_instance(),
+      H2Core::SamplePeakBuilder::create_instance(),
+      H2Core::DeferredSampleLoader::create_instance(),
+      H2Core::FileInfoCache::create_instance(),
+      H2Core::DrumkitIndex::create_instance(),
+      H2Core::PatternIndex::create_instance(), and
+      H2Core::InstrumentFreezer::create_instance().
  * -# Finally, it pushes the H2Core::EVENT_STATE, #STATE_INITIALIZED
       on the H2Core::EventQueue using
       H2Core::EventQueue::push_event().
@@ -392,7 +534,8 @@ int				audioEngine_start( bool bLockEngine = false, unsigned nTotalFrames = 0 );
  * - sets #m_nPatternStartTick to -1
  * - deletes all copied Note in song notes queue #m_songNoteQueue and
  *   MIDI notes queue #m_midiNoteQueue
- * - calls the _clear()_ member of #m_midiNoteQueue
+ * - calls the _clear()_ member of #m_midiNoteQueue and
+ *   #m_liveNoteQueue
  *
  * \param bLockEngine Whether or not to lock the audio engine before
  *   performing any actions. The audio engine __must__ be locked! This
@@ -418,6 +561,20 @@ void				audioEngine_setSong(Song *pNewSong );
  */
 void				audioEngine_removeSong();
 static void			audioEngine_noteOn( Note *note );
+/**
+ * Pushes a note played live onto #m_liveNoteQueue. The audio engine
+ * has to be locked by the caller.
+ */
+static void			audioEngine_liveNoteOn( Note *note );
+/**
+ * Places the notes passed to Hydrogen::scheduleNotes() relative to
+ * the first frame of the current cycle and pushes them onto
+ * #m_liveNoteQueue.
+ *
+ * Applied as command at the beginning of audioEngine_process() with
+ * the engine locked.
+ */
+static void			audioEngine_scheduleNotes( const std::vector<Hydrogen::ScheduledNote>& notes, bool bTicks );
 
 /**
  * Main audio processing function called by the audio drivers whenever
@@ -456,6 +613,8 @@ static void			audioEngine_noteOn( Note *note );
  * (if #H2CORE_HAVE_LADSPA is defined) to #m_pMainBuffer_L and
  * #m_pMainBuffer_R and sets we peak values for #m_fFXPeak_L,
  * #m_fFXPeak_R, #m_fMasterPeak_L, and #m_fMasterPeak_R.
+ * - hands those and the instrument and component peaks to the GUI
+ * using PeakMeters::publish().
  * - finally increments the transport position
  * TransportInfo::m_nFrames with the buffersize @a nframes. So, if
  * this function is called during the next cycle, the transport is
@@ -481,18 +640,17 @@ inline void			audioEngine_clearNoteQueue();
  * Update the tick size based on the current tempo without affecting
  * the current transport position.
  *
- * To access a change in the tick size, the value stored in
- * TransportInfo::m_fTickSize will be compared to the one calculated
- * from the AudioOutput::getSampleRate(), Song::m_fBpm, and
+ * To access a change in the tick size, the fixed point value stored
+ * in TransportInfo::m_nTickSize will be compared to the one
+ * calculated by TickTime::tickSize() from the
+ * AudioOutput::getSampleRate(), Song::m_fBpm, and
  * Song::m_resolution. Thus, if any of those quantities did change,
  * the transport position will be recalculated.
  *
- * The new transport position gets calculated by 
- * \code{.cpp}
- * ceil( m_pAudioDriver->m_transport.m_nFrames/
- *       m_pAudioDriver->m_transport.m_fTickSize ) *
- * m_pAudioDriver->getSampleRate() * 60.0 / Song::m_fBpm / Song::m_resolution 
- * \endcode
+ * The new transport position is the first frame of the tick
+ * following or starting at the old position, computed with the
+ * integer arithmetic of TickTime, so that no drift accumulates over
+ * repeated tempo changes.
  *
  * If the JackAudioDriver is used and the audio engine is playing, a
  * potential mismatch in the transport position is determined by
@@ -507,7 +665,45 @@ inline void			audioEngine_clearNoteQueue();
  * either #STATE_READY or #STATE_PLAYING.
  */
 inline void			audioEngine_process_checkBPMChanged(Song *pSong);
+/**
+ * Follows the tempo ramps of the Timeline while playing in
+ * Song::SONG_MODE.
+ *
+ * The tempo is sampled in the middle of the current cycle using
+ * Hydrogen::getTimelineBpmAtTick() and applied to the Song, the
+ * TransportInfo, and #m_fNewBpmJTM. In contrast to
+ * audioEngine_process_checkBPMChanged() the transport position is
+ * rescaled exactly, keeping the tick position continuous from one
+ * cycle to the next, and the Rubber Band samples are not
+ * recalculated. Since the song note queue holds positions in ticks,
+ * the pending notes keep their place without being queued again.
+ *
+ * Nothing is done outside of ramps, in the presence of an external
+ * JACK timebase master, or while following an Ableton Link session.
+ */
+inline void			audioEngine_process_tempoRamp( Song* pSong );
+/**
+ * Passes the duration of the cycle to the OverloadGovernor and
+ * applies its current level to the Sampler.
+ *
+ * \param bRealtime Whether the current driver has to keep up with
+ * the audio hardware. The disk writer and the offline drivers
+ * always render at full quality.
+ */
+inline void			audioEngine_process_overloadGovernor( bool bRealtime );
 inline void			audioEngine_process_playNotes( unsigned long nframes );
+/**
+ * Voices all notes in #m_liveNoteQueue starting before the end of the
+ * current process cycle. The Sampler places each of them at its
+ * offset within the buffer. Notes further in the future remain
+ * queued.
+ */
+inline void			audioEngine_process_playLiveNotes( unsigned long nframes );
+/**
+ * Applies the pitch offset of the instrument, triggers its stop-note
+ * and passes @a pNote on to the Sampler.
+ */
+inline void			audioEngine_process_voiceNote( Note* pNote );
 /**
  * Updating the TransportInfo of the audio driver.
  *
@@ -533,10 +729,20 @@ inline void			audioEngine_process_playNotes( unsigned long nframes );
  * #STATE_PLAYING the function will immediately return.
  */
 inline void			audioEngine_process_transport();
+/**
+ * Follows the tempo and beat of the Ableton Link session using
+ * LinkTransport::process().
+ *
+ * The tempo of the session is applied via Hydrogen::setBPM(). While
+ * playing, TransportInfo::m_nFrames is shifted by the phase
+ * difference between Hydrogen and the session, measured over
+ * Preferences::m_fLinkQuantum beats. Nothing is done while JACK
+ * transport is in charge of the position.
+ */
+inline void			audioEngine_process_link();
 
 inline unsigned		audioEngine_renderNote( Note* pNote, const unsigned& nBufferSize );
-// TODO: Add documentation of inPunchArea, and
-// m_addMidiNoteVector
+// TODO: Add documentation of inPunchArea
 /**
  * Takes all notes from the current patterns, from the MIDI queue
  * #m_midiNoteQueue, and those triggered by the metronome and pushes
@@ -559,9 +765,8 @@ inline unsigned		audioEngine_renderNote( Note* pNote, const unsigned& nBufferSiz
  * Note::__position smaller or equal the current tick will be popped
  * and added to #m_songNoteQueue and the #EVENT_METRONOME Event is
  * pushed to the EventQueue at a periodic rate. If in addition
- * Preferences::m_bUseMetronome is set to true,
- * #m_pMetronomeInstrument will be used to push a 'click' to the
- * #m_songNoteQueue too. All patterns enclosing the current tick will
+ * Preferences::m_bUseMetronome is set to true, a 'click' is
+ * scheduled using AudioEngine::get_metronome() too. All patterns enclosing the current tick will
  * be added to #m_pPlayingPatterns and all their containing notes,
  * which position enclose the current tick too, will be added to the
  * #m_songNoteQueue. If the Song is in Song::PATTERN_MODE, the
@@ -589,7 +794,45 @@ inline unsigned		audioEngine_renderNote( Note* pNote, const unsigned& nBufferSiz
  * cycle.
  */
 inline int			audioEngine_updateNoteQueue( unsigned nFrames );
+/**
+ * Queues copies of the notes with an explicit length which have
+ * started before @a nTick but would still be sounding at it,
+ * according to the ColumnSnapshots of the song. Called in
+ * Song::SONG_MODE after a relocation.
+ *
+ * The copies start at @a nTick and are offset by the frames passed
+ * since the beginning of the original notes at the current tempo.
+ * They neither send MIDI note-ons nor get humanized.
+ */
+static void			audioEngine_resumeSoundingNotes( long nTick, int64_t nTickSize );
+/**
+ * Swaps the drumkit prepared by Hydrogen::prepareDrumkit() into the
+ * current Song, provided Hydrogen::commitDrumkit() was called.
+ *
+ * The InstrumentList and components of the Song are replaced by
+ * swapping pointers and the notes of all patterns as well as those
+ * in #m_midiNoteQueue are mapped onto the new instruments. Nothing is
+ * allocated or freed, the previous objects are handed back to the
+ * background thread of Hydrogen::prepareDrumkit().
+ *
+ * Called with the AudioEngine being locked.
+ *
+ * \param bBarBoundary Whether the tick about to be queued is the
+ *   first one of a bar. If the swap was requested to happen at a bar
+ *   boundary and transport is rolling, nothing is done unless this
+ *   is true.
+ */
+inline void			audioEngine_swapDrumkit( bool bBarBoundary );
 inline void			audioEngine_prepNoteQueue();
+/**
+ * Hands the content of #m_pPlayingPatterns and #m_pNextPatterns to
+ * the PlaybackSnapshot of the AudioEngine.
+ *
+ * Called at the end of each process cycle and by all functions
+ * altering the lists outside of it, with the AudioEngine being
+ * locked.
+ */
+inline void			audioEngine_publishPlaybackSnapshot();
 
 /**
  * Find a PatternList corresponding to the supplied tick position @a
@@ -623,7 +866,7 @@ void				audioEngine_restartAudioDrivers();
  * - Windows:  "PortAudio", "ALSA", "CoreAudio", "JACK", "OSS",
  *   and "PulseAudio" 
  * - all other systems: "JACK", "ALSA", "CoreAudio", "PortAudio",
- *   "OSS", and "PulseAudio".
+ *   "OSS", "PipeWire", and "PulseAudio".
  * If all of them return NULL, #m_pAudioDriver will be initialized
  * with the NullDriver instead. If a specific choice is contained in
  * Preferences::m_sAudioDriver and createDriver() returns NULL, the
@@ -632,9 +875,12 @@ void				audioEngine_restartAudioDrivers();
  * It probes Preferences::m_sMidiDriver to create a midi driver using
  * either AlsaMidiDriver::AlsaMidiDriver(),
  * PortMidiDriver::PortMidiDriver(), CoreMidiDriver::CoreMidiDriver(),
- * or JackMidiDriver::JackMidiDriver(). Afterwards, it sets
+ * JackMidiDriver::JackMidiDriver(), or
+ * PipeWireMidiDriver::PipeWireMidiDriver(). Afterwards, it sets
  * #m_pMidiDriverOut and #m_pMidiDriver to the freshly created midi
- * driver and calls their open() and setActive( true ) functions.
+ * driver and calls their open() and setActive( true ) functions. The
+ * PipeWireMidiDriver only handles input and leaves #m_pMidiDriverOut
+ * unset.
  *
  * If a Song is already present, the state of the AudioEngine
  * #m_audioEngineState will be set to #STATE_READY, the bpm of the
@@ -651,8 +897,9 @@ void				audioEngine_restartAudioDrivers();
  * will be overwritten with the NullDriver and this one is connected
  * instead.
  *
- * Finally, audioEngine_renameJackPorts() (if #H2CORE_HAVE_JACK is set)
- * and audioEngine_setupLadspaFX() are called.
+ * Finally, audioEngine_renameJackPorts(),
+ * audioEngine_setupLadspaFX(), and audioEngine_setupMetronome() are
+ * called.
  *
  * The state of the AudioEngine #m_audioEngineState must not be in
  * #STATE_INITIALIZED or the function will just unlock both mutex and
@@ -673,32 +920,21 @@ void				audioEngine_startAudioDrivers();
  */
 void				audioEngine_stopAudioDrivers();
 
-/** Gets the current time.
- * \return Current time obtained by gettimeofday()*/
-inline timeval currentTime2()
-{
-	struct timeval now;
-	gettimeofday( &now, nullptr );
-	return now;
-}
-
-inline int randomValue( int max )
-{
-	return rand() % max;
-}
-
-inline float getGaussian( float z )
+/**
+ * Seeds #m_random with Song::getRandomSeed() of @a pSong. Songs
+ * without a seed of their own get one derived from the current time.
+ * This way renders of songs with a seed are reproducible.
+ *
+ * Has to be called with the AudioEngine locked or while it is not
+ * processing.
+ */
+void audioEngine_seedRandom( Song* pSong )
 {
-	// gaussian distribution -- dimss
-	float x1, x2, w;
-	do {
-		x1 = 2.0 * ( ( ( float ) rand() ) / RAND_MAX ) - 1.0;
-		x2 = 2.0 * ( ( ( float ) rand() ) / RAND_MAX ) - 1.0;
-		w = x1 * x1 + x2 * x2;
-	} while ( w >= 1.0 );
-
-	w = sqrtf( ( -2.0 * logf( w ) ) / w );
-	return x1 * w * z + 0.0; // tunable
+	if ( pSong != nullptr && pSong->getRandomSeed() != 0 ) {
+		m_random.seed( static_cast<uint64_t>( pSong->getRandomSeed() ) );
+	} else {
+		m_random.seed( Random::timeSeed() );
+	}
 }
 
 void audioEngine_raiseError( unsigned nErrorCode )
@@ -754,6 +990,15 @@ void audioEngine_init()
 #endif
 	AudioEngine::create_instance();
 	Playlist::create_instance();
+	SampleStretcher::create_instance();
+	SamplePeakBuilder::create_instance();
+	DeferredSampleLoader::create_instance();
+	FileInfoCache::create_instance();
+	if ( Preferences::get_instance()->m_bIndexLibraries ) {
+		DrumkitIndex::create_instance();
+		PatternIndex::create_instance();
+	}
+	InstrumentFreezer::create_instance();
 
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_INITIALIZED );
 
@@ -768,6 +1013,16 @@ void audioEngine_destroy()
 	}
 	AudioEngine::get_instance()->get_sampler()->stopPlayingNotes();
 
+	// Has to happen before locking the engine since the worker might
+	// be waiting for the lock to hand over its result.
+	delete SampleStretcher::get_instance();
+	delete SamplePeakBuilder::get_instance();
+	delete DeferredSampleLoader::get_instance();
+	delete DrumkitIndex::get_instance();
+	delete PatternIndex::get_instance();
+	delete FileInfoCache::get_instance();
+	delete InstrumentFreezer::get_instance();
+
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	___INFOLOG( "*** Hydrogen audio engine shutdown ***" );
 
@@ -782,6 +1037,10 @@ void audioEngine_destroy()
 		delete m_midiNoteQueue[i];
 	}
 	m_midiNoteQueue.clear();
+	for ( auto pNote : m_liveNoteQueue ) {
+		delete pNote;
+	}
+	m_liveNoteQueue.clear();
 
 	// change the current audio engine state
 	m_audioEngineState = STATE_UNINITIALIZED;
@@ -827,8 +1086,8 @@ int audioEngine_start( bool bLockEngine, unsigned nTotalFrames )
 
 	// prepare the tick size for this song
 	Song* pSong = Hydrogen::get_instance()->getSong();
-	m_pAudioDriver->m_transport.m_fTickSize =
-		AudioEngine::compute_tick_size( static_cast<float>(m_pAudioDriver->getSampleRate()), pSong->getBpm(), pSong->getResolution() );
+	m_pAudioDriver->m_transport.setTickSize( m_pAudioDriver->getSampleRate(), pSong->getBpm(),
+											 pSong->getResolution() );
 
 	// change the current audio engine state
 	m_audioEngineState = STATE_PLAYING;
@@ -877,6 +1136,10 @@ void audioEngine_stop( bool bLockEngine )
 		delete m_midiNoteQueue[i];
 	}
 	m_midiNoteQueue.clear();
+	for ( auto pNote : m_liveNoteQueue ) {
+		delete pNote;
+	}
+	m_liveNoteQueue.clear();
 
 	if ( bLockEngine ) {
 		AudioEngine::get_instance()->unlock();
@@ -902,27 +1165,34 @@ inline void audioEngine_process_checkBPMChanged(Song* pSong)
 #else
 	oldFrame = m_pAudioDriver->m_transport.m_nFrames;
 #endif
-	float fOldTickSize = m_pAudioDriver->m_transport.m_fTickSize;
-	float fNewTickSize = AudioEngine::compute_tick_size( m_pAudioDriver->getSampleRate(), pSong->getBpm(), pSong->getResolution() );
+	TransportInfo& transport = m_pAudioDriver->m_transport;
+	const int64_t nOldTickSize = transport.m_nTickSize;
+	const int64_t nNewTickSize = TickTime::tickSize( m_pAudioDriver->getSampleRate(),
+													 pSong->getBpm(), pSong->getResolution() );
 
 	// Nothing changed - avoid recomputing
-	if ( fNewTickSize == fOldTickSize ) {
+	if ( nNewTickSize == nOldTickSize ) {
 		return;
 	}
-	m_pAudioDriver->m_transport.m_fTickSize = fNewTickSize;
+	transport.setTickSize( nNewTickSize );
 
-	if ( fNewTickSize == 0 || fOldTickSize == 0 ) {
+	if ( nNewTickSize == 0 || nOldTickSize == 0 ) {
 		return;
 	}
 
-	float fTickNumber = (float)oldFrame / fOldTickSize;
+	// The position is moved to the beginning of the next tick, which
+	// is exact in fixed point.
+	long long nTick = TickTime::tickAtFrame( oldFrame, nOldTickSize );
+	if ( TickTime::frameAtTick( nTick, nOldTickSize ) < oldFrame ) {
+		++nTick;
+	}
 
 	// update frame position in transport class
-	m_pAudioDriver->m_transport.m_nFrames = ceil(fTickNumber) * fNewTickSize;
+	transport.m_nFrames = transport.frameAtTick( nTick );
 	
 	___WARNINGLOG( QString( "Tempo change: Recomputing ticksize and frame position. Old TS: %1, new TS: %2, new pos: %3" )
-		.arg( fOldTickSize ).arg( fNewTickSize )
-		.arg( m_pAudioDriver->m_transport.m_nFrames ) );
+		.arg( TickTime::toFrames( nOldTickSize ) ).arg( transport.m_fTickSize )
+		.arg( transport.m_nFrames ) );
 	
 #ifdef H2CORE_HAVE_JACK
 	if ( Hydrogen::get_instance()->haveJackTransport() ) {
@@ -932,12 +1202,80 @@ inline void audioEngine_process_checkBPMChanged(Song* pSong)
 	EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
 }
 
+inline void audioEngine_process_tempoRamp( Song* pSong )
+{
+	if ( m_audioEngineState != STATE_PLAYING || pSong == nullptr ||
+		 pSong->getMode() != Song::SONG_MODE ||
+		 ! RealtimeConfig::current().bUseTimelineBpm ) {
+		return;
+	}
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	if ( pHydrogen->getJackTimebaseState() == JackAudioDriver::Timebase::Slave ||
+		 AudioEngine::get_instance()->get_link_transport()->isEnabled() ) {
+		return;
+	}
+
+	TransportInfo& transport = m_pAudioDriver->m_transport;
+	if ( transport.m_fTickSize <= 0 ) {
+		return;
+	}
+
+	double fTick = static_cast<double>( transport.m_nFrames ) / transport.m_fTickSize;
+	bool bRamp;
+	float fBpm = pHydrogen->getTimelineBpmAtTick(
+		fTick + 0.5 * m_nBufferSize / transport.m_fTickSize, &bRamp );
+	if ( ! bRamp ) {
+		return;
+	}
+
+	const int64_t nNewTickSize = TickTime::tickSize( m_pAudioDriver->getSampleRate(),
+													 fBpm, pSong->getResolution() );
+	if ( nNewTickSize == transport.m_nTickSize || nNewTickSize <= 0 ) {
+		return;
+	}
+
+	pSong->setBpm( fBpm );
+	m_pAudioDriver->setBpm( fBpm );
+	pHydrogen->setNewBpmJTM( fBpm );
+
+	// The fractional tick of the position is kept.
+	long long nOldFrame = transport.m_nFrames;
+	transport.m_nFrames = TickTime::rescale( nOldFrame, transport.m_nTickSize, nNewTickSize );
+	transport.setTickSize( nNewTickSize );
+
+#ifdef H2CORE_HAVE_JACK
+	if ( pHydrogen->haveJackTransport() ) {
+		static_cast< JackAudioDriver* >( m_pAudioDriver )->calculateFrameOffset( nOldFrame );
+	}
+#endif
+}
+
+inline void audioEngine_process_overloadGovernor( bool bRealtime )
+{
+	OverloadGovernor* pGovernor = AudioEngine::get_instance()->get_overload_governor();
+	if ( bRealtime && RealtimeConfig::get().bOverloadGovernor ) {
+		if ( pGovernor->update( m_fProcessTime, m_fMaxProcessTime ) ) {
+			RT_WARNINGLOG( "Load of %1 ms within %2 ms. Changed to rendering quality level %3",
+						   m_fProcessTime, m_fMaxProcessTime,
+						   static_cast<int>( pGovernor->getLevel() ) );
+		}
+	} else {
+		pGovernor->reset();
+	}
+
+	OverloadGovernor::Level level = pGovernor->getLevel();
+	AudioEngine::get_instance()->get_sampler()->setDegradation(
+		level >= OverloadGovernor::LEVEL_LINEAR_INTERPOLATION,
+		level >= OverloadGovernor::LEVEL_REDUCED_VOICES );
+}
+
 inline void audioEngine_process_playNotes( unsigned long nframes )
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
 
-	unsigned int framepos;
+	long long framepos;
 
 	if (  m_audioEngineState == STATE_PLAYING ) {
 		framepos = m_pAudioDriver->m_transport.m_nFrames;
@@ -946,7 +1284,9 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 		framepos = pHydrogen->getRealtimeFrames();
 	}
 	
-	AutomationPath *pVelAutomationPath = pSong->getVelocityAutomationPath();
+	// The queue is sorted by position. The cursor therefore does
+	// not have to search the whole path for each note.
+	AutomationPath::Cursor velocityAutomation( pSong->getVelocityAutomationPath() );
 
 	int nSongLength = 0;
 	if ( pSong->getMode() == Song::SONG_MODE ) {
@@ -958,8 +1298,8 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 		Note *pNote = m_songNoteQueue.top();
 
 		// verifico se la nota rientra in questo ciclo
-		unsigned int noteStartInFrames =
-				(int)( pNote->get_position() * m_pAudioDriver->m_transport.m_fTickSize );
+		long long noteStartInFrames =
+			m_pAudioDriver->m_transport.frameAtTick( pNote->get_position() );
 
 		// if there is a negative Humanize delay, take into account so
 		// we don't miss the time slice.  ignore positive delay, or we
@@ -981,23 +1321,14 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 				float fPos = static_cast<float>( m_nSongPos ) // this is the integer part
 							+ ( static_cast<float>( pNote->get_position() % nSongLength - m_nPatternStartTick )
 								/ static_cast<float>( pHydrogen->getCurrentPatternList()->longest_pattern_length() ) );
-				pNote->set_velocity( pNote->get_velocity() * pVelAutomationPath->get_value( fPos ) );
+				pNote->set_velocity( pNote->get_velocity() * velocityAutomation.get_value( fPos ) );
 			}
 			
-			/* Check if the current note has probability != 1.
-			 * If yes call a random function to choose whether to dequeue the note or not
-			 */
-			float fNoteProbability = pNote->get_probability();
-			if ( fNoteProbability != 1. ) {
-				if ( fNoteProbability < (float) rand() / (float) RAND_MAX ) {
-					m_songNoteQueue.pop();
-					pNote->get_instrument()->dequeue();
-					continue;
-				}
-			}
+			// The probability of pattern notes was already taken
+			// into account in audioEngine_updateNoteQueue().
 
 			if ( pSong->getHumanizeVelocityValue() != 0 ) {
-				float random = pSong->getHumanizeVelocityValue() * getGaussian( 0.2 );
+				float random = pSong->getHumanizeVelocityValue() * m_random.gaussian( 0.2 );
 				pNote->set_velocity(
 							pNote->get_velocity()
 							+ ( random
@@ -1010,37 +1341,7 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 				}
 			}
 
-			// Offset + Random Pitch ;)
-			float fPitch = pNote->get_pitch() + pNote->get_instrument()->get_pitch_offset();
-			/* Check if the current instrument has random picth factor != 0.
-			 * If yes add a gaussian perturbation to the pitch
-			 */
-			float fRandomPitchFactor = pNote->get_instrument()->get_random_pitch_factor();
-			if ( fRandomPitchFactor != 0. ) {
-				fPitch += getGaussian( 0.4 ) * fRandomPitchFactor;
-			}
-			pNote->set_pitch( fPitch );
-
-
-			/*
-			 * Check if the current instrument has the property "Stop-Note" set.
-			 * If yes, a NoteOff note is generated automatically after each note.
-			 */
-			Instrument * noteInstrument = pNote->get_instrument();
-			if ( noteInstrument->is_stop_notes() ){
-				Note *pOffNote = new Note( noteInstrument,
-										   0.0,
-										   0.0,
-										   0.0,
-										   0.0,
-										   -1,
-										   0 );
-				pOffNote->set_note_off( true );
-				AudioEngine::get_instance()->get_sampler()->noteOn( pOffNote );
-				delete pOffNote;
-			}
-
-			AudioEngine::get_instance()->get_sampler()->noteOn( pNote );
+			audioEngine_process_voiceNote( pNote );
 			m_songNoteQueue.pop(); // rimuovo la nota dalla lista di note
 			pNote->get_instrument()->dequeue();
 			// raise noteOn event
@@ -1059,6 +1360,81 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 }
 
 
+inline void audioEngine_process_voiceNote( Note* pNote )
+{
+	// Offset + Random Pitch ;)
+	float fPitch = pNote->get_pitch() + pNote->get_instrument()->get_pitch_offset();
+	/* Check if the current instrument has random picth factor != 0.
+	 * If yes add a gaussian perturbation to the pitch
+	 */
+	float fRandomPitchFactor = pNote->get_instrument()->get_random_pitch_factor();
+	if ( fRandomPitchFactor != 0. ) {
+		fPitch += m_random.gaussian( 0.4 ) * fRandomPitchFactor;
+	}
+	pNote->set_pitch( fPitch );
+
+
+	/*
+	 * Check if the current instrument has the property "Stop-Note" set.
+	 * If yes, a NoteOff note is generated automatically after each note.
+	 */
+	Instrument * noteInstrument = pNote->get_instrument();
+	if ( noteInstrument->is_stop_notes() ){
+		Note *pOffNote = new ( NotePool::get_instance() ) Note( noteInstrument,
+								   0.0,
+								   0.0,
+								   0.0,
+								   0.0,
+								   -1,
+								   0 );
+		pOffNote->set_note_off( true );
+		AudioEngine::get_instance()->get_sampler()->noteOn( pOffNote );
+		delete pOffNote;
+	}
+
+	AudioEngine::get_instance()->get_sampler()->noteOn( pNote );
+}
+
+inline void audioEngine_process_playLiveNotes( unsigned long nframes )
+{
+	if ( m_liveNoteQueue.empty() ) {
+		return;
+	}
+
+	long long framepos;
+	if (  m_audioEngineState == STATE_PLAYING ) {
+		framepos = m_pAudioDriver->m_transport.m_nFrames;
+	} else {
+		framepos = Hydrogen::get_instance()->getRealtimeFrames();
+	}
+
+	auto it = m_liveNoteQueue.begin();
+	while ( it != m_liveNoteQueue.end() ) {
+		Note* pNote = *it;
+		long long nNoteStartInFrames =
+			m_pAudioDriver->m_transport.frameAtTick( pNote->get_position() ) +
+			pNote->get_humanize_delay();
+
+		if ( nNoteStartInFrames >= static_cast<long long>( framepos + nframes ) ) {
+			// Quantized notes may be due in a later cycle.
+			++it;
+			continue;
+		}
+
+		// Notes which should have already started are voiced at
+		// the beginning of the buffer by the Sampler.
+		audioEngine_process_voiceNote( pNote );
+		it = m_liveNoteQueue.erase( it );
+
+		int nInstrument = Hydrogen::get_instance()->getSong()->getInstrumentList()->index( pNote->get_instrument() );
+		if ( pNote->get_note_off() ) {
+			delete pNote;
+		}
+		EventQueue::get_instance()->push_event( EVENT_NOTEON, nInstrument );
+	}
+}
+
+
 void audioEngine_seek( long long nFrames, bool bLoopMode )
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
@@ -1080,9 +1456,8 @@ void audioEngine_seek( long long nFrames, bool bLoopMode )
 
 	m_pAudioDriver->m_transport.m_nFrames = nFrames;
 
-	int tickNumber_start = ( unsigned )(
-				m_pAudioDriver->m_transport.m_nFrames
-				/ m_pAudioDriver->m_transport.m_fTickSize );
+	int tickNumber_start = static_cast<int>(
+		m_pAudioDriver->m_transport.tickAtFrame( m_pAudioDriver->m_transport.m_nFrames ) );
 	//	sprintf(tmp, "[audioEngine_seek()] tickNumber_start = %d", tickNumber_start);
 	//	__instance->infoLog(tmp);
 
@@ -1097,6 +1472,10 @@ void audioEngine_seek( long long nFrames, bool bLoopMode )
 	//	__instance->infoLog(tmp);
 	
 	audioEngine_clearNoteQueue();
+
+	// Lets the I/O thread read the playback track ahead of the new
+	// position.
+	AudioEngine::get_instance()->get_sampler()->seekPlaybackTrack( nFrames );
 }
 
 inline void audioEngine_process_transport()
@@ -1113,6 +1492,8 @@ inline void audioEngine_process_transport()
 	// e.g. clicking on the timeline.
 	m_pAudioDriver->updateTransportInfo();
 
+	audioEngine_process_link();
+
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
 
@@ -1134,10 +1515,8 @@ inline void audioEngine_process_transport()
 
 		/* Now we're playing | Update BPM */
 		if ( pSong->getBpm() != m_pAudioDriver->m_transport.m_fBPM ) {
-			___INFOLOG( QString( "song bpm: (%1) gets transport bpm: (%2)" )
-						.arg( pSong->getBpm() )
-						.arg( m_pAudioDriver->m_transport.m_fBPM )
-			);
+			RT_INFOLOG( "song bpm: (%1) gets transport bpm: (%2)",
+						pSong->getBpm(), m_pAudioDriver->m_transport.m_fBPM );
 
 			pHydrogen->setBPM( m_pAudioDriver->m_transport.m_fBPM );
 		}
@@ -1161,6 +1540,59 @@ inline void audioEngine_process_transport()
 	}
 }
 
+inline void audioEngine_process_link()
+{
+	LinkTransport* pLink = AudioEngine::get_instance()->get_link_transport();
+	if ( ! pLink->isEnabled() ) {
+		return;
+	}
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	if ( pSong == nullptr || pHydrogen->haveJackTransport() ) {
+		return;
+	}
+
+	TransportInfo& transport = m_pAudioDriver->m_transport;
+	const unsigned nSampleRate = m_pAudioDriver->getSampleRate();
+	double fBeat = 0;
+	if ( transport.m_fTickSize > 0 && pSong->getResolution() > 0 ) {
+		fBeat = static_cast<double>( transport.m_nFrames ) /
+			transport.m_fTickSize / pSong->getResolution();
+	}
+	const double fQuantum = RealtimeConfig::get().fLinkQuantum;
+
+	float fBpm;
+	double fBeatOffset;
+	if ( ! pLink->process( m_nBufferSize, nSampleRate, fBeat, fQuantum,
+						   &fBpm, &fBeatOffset ) ) {
+		return;
+	}
+
+	fBpm = std::min( std::max( fBpm, static_cast<float>( MIN_BPM ) ),
+					 static_cast<float>( MAX_BPM ) );
+	if ( pSong->getBpm() != fBpm ) {
+		pHydrogen->setBPM( fBpm );
+	}
+
+	if ( m_audioEngineState != STATE_PLAYING ||
+		 transport.m_status != TransportInfo::ROLLING ) {
+		return;
+	}
+
+	// Shifting the position by whole frames keeps the downbeat of
+	// Hydrogen in phase with the one of the session.
+	const double fFramesPerBeat = 60.0 * nSampleRate / fBpm;
+	long long nShift = std::llround( fBeatOffset * fFramesPerBeat );
+	if ( nShift == 0 ) {
+		return;
+	}
+	if ( transport.m_nFrames + nShift < 0 ) {
+		nShift += std::llround( fQuantum * fFramesPerBeat );
+	}
+	transport.m_nFrames += nShift;
+}
+
 void audioEngine_clearNoteQueue()
 {
 	//___INFOLOG( "clear notes...");
@@ -1173,13 +1605,19 @@ void audioEngine_clearNoteQueue()
 	}
 
 	AudioEngine::get_instance()->get_sampler()->stopPlayingNotes();
+	AudioEngine::get_instance()->get_metronome()->stop();
 
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
 		delete m_midiNoteQueue[i];
 	}
 	m_midiNoteQueue.clear();
+	for ( auto pNote : m_liveNoteQueue ) {
+		delete pNote;
+	}
+	m_liveNoteQueue.clear();
 
+	InstrumentFreezer::get_instance()->resetColumn();
 }
 
 /** Clear all audio buffers.
@@ -1215,10 +1653,10 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 		m_pMainBuffer_L = m_pMainBuffer_R = nullptr;
 	}
 	if ( m_pMainBuffer_L ) {
-		memset( m_pMainBuffer_L, 0, nFrames * sizeof( float ) );
+		Dsp::clear( m_pMainBuffer_L, nFrames );
 	}
 	if ( m_pMainBuffer_R ) {
-		memset( m_pMainBuffer_R, 0, nFrames * sizeof( float ) );
+		Dsp::clear( m_pMainBuffer_R, nFrames );
 	}
 
 #ifdef H2CORE_HAVE_JACK
@@ -1226,9 +1664,25 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 	
 	if( pJackAudioDriver ) {
 		pJackAudioDriver->clearPerTrackAudioBuffers( nFrames );
+		pJackAudioDriver->clearCueAudioBuffers( nFrames );
 	}
 #endif
 
+	if ( m_pAudioDriver != nullptr &&
+		 m_pAudioDriver->class_name() == DiskWriterDriver::class_name() ) {
+		static_cast<DiskWriterDriver*>(m_pAudioDriver)->clearStemBuffers( nFrames );
+	}
+
+	if ( m_pAudioDriver != nullptr &&
+		 m_pAudioDriver->class_name() == OfflineDriver::class_name() ) {
+		static_cast<OfflineDriver*>(m_pAudioDriver)->clearTracks( nFrames );
+	}
+
+	if ( m_pAudioDriver != nullptr &&
+		 m_pAudioDriver->getTrackOutputs() != nullptr ) {
+		m_pAudioDriver->getTrackOutputs()->clear( nFrames );
+	}
+
 	mx.unlock();
 
 #ifdef H2CORE_HAVE_LADSPA
@@ -1248,6 +1702,44 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 }
 
 
+#ifdef H2CORE_HAVE_LADSPA
+/** Adds @a pSrc to @a pDst while ramping the gain linearly from @a
+	fGainStart to @a fGainEnd.*/
+static void audioEngine_addFaded( float* pDst, const float* pSrc, float fGainStart,
+								  float fGainEnd, uint32_t nFrames )
+{
+	float fStep = ( fGainEnd - fGainStart ) / nFrames;
+	for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+		pDst[ ii ] += pSrc[ ii ] * ( fGainStart + ii * fStep );
+	}
+}
+
+/** Enabled LADSPA effects of the current process cycle.*/
+struct LadspaFXTasks {
+	LadspaFX* pFX[ MAX_FX ];
+	/** Index of the corresponding effect in Effects.*/
+	int nFX[ MAX_FX ];
+	int nTasks;
+	uint32_t nFrames;
+};
+
+/**
+ * Processes and times the @a nTask-th effect of the LadspaFXTasks
+ * @a pArg points to.
+ *
+ * Used as task of the WorkerPool of the Sampler.
+ */
+static void audioEngine_processLadspaFX( int nTask, void* pArg )
+{
+	LadspaFXTasks* pTasks = static_cast<LadspaFXTasks*>( pArg );
+	int64_t nStart = rtclock_now_ns();
+	pTasks->pFX[ nTask ]->processFX( pTasks->nFrames );
+	int64_t nDuration = rtclock_now_ns() - nStart;
+	m_fFXProcessTime[ pTasks->nFX[ nTask ] ] = nDuration / 1000000.0;
+	Tracer::complete( "LadspaFX::processFX", nStart, nDuration );
+}
+#endif
+
 int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 {
 	// ___INFOLOG( QString( "[begin] status: %1, frame: %2, ticksize: %3, bpm: %4" )
@@ -1255,7 +1747,16 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nFrames )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fTickSize )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fBPM ) );
-	timeval startTimeval = currentTime2();
+	Tracer::setThreadName( "Audio engine" );
+	ProcessProfiler* pProfiler = AudioEngine::get_instance()->get_profiler();
+	pProfiler->beginCycle();
+	AllocationTracker::Cycle allocationCycle;
+	// The buffer rendered now is played back one period later at
+	// the earliest.
+	AudioEngine::get_instance()->get_latency_probe()->beginCycle(
+		m_pAudioDriver->getSampleRate(), nframes );
+	AudioEngine::get_instance()->get_playback_clock()->beginCycle(
+		nframes, m_pAudioDriver->getSampleRate() );
 
 	// Resetting all audio output buffers with zeros.
 	audioEngine_process_clearAudioBuffers( nframes );
@@ -1286,25 +1787,47 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 				
 	if ( !AudioEngine::get_instance()->try_lock_for( std::chrono::microseconds( (int)(1000.0*fSlackTime) ),
 													 RIGHT_HERE ) ) {
-		___ERRORLOG( QString( "Failed to lock audioEngine in allowed %1 ms, missed buffer" ).arg( fSlackTime ) );
+		RT_ERRORLOG( "Failed to lock audioEngine in allowed %1 ms, missed buffer", fSlackTime );
+		pProfiler->countMissedLock();
 
-		if ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() ) {
+		if ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() ||
+			 m_pAudioDriver->class_name() == OfflineDriver::class_name() ) {
 			return 2;	// inform the caller that we could not acquire the lock
 		}
 
 		return 0;
 	}
 
+	// Apply all mutations posted by other threads via
+	// AudioEngine::postCommand() since the last cycle.
+	AudioEngine::get_instance()->processCommands();
+
+	// Preferences changed since the last cycle. Code within the
+	// cycle reads them via RealtimeConfig::get().
+	RealtimeConfig::beginCycle();
+
+	// Drumkits prepared in the background are swapped in here
+	// unless they are to wait for the next bar.
+	audioEngine_swapDrumkit( false );
+
 	if ( m_audioEngineState < STATE_READY) {
 		AudioEngine::get_instance()->unlock();
 		return 0;
 	}
 
 	if ( m_nBufferSize != nframes ) {
-		___INFOLOG(
-			   QString( "Buffer size changed. Old size = %1, new size = %2" )
-			   .arg( m_nBufferSize )
-			   .arg( nframes ) );
+		// All internal buffers are sized by MAX_BUFFER_SIZE, so a
+		// smaller or larger period is picked up in place. The
+		// per-size setup is done outside of the cycle in
+		// Hydrogen::bufferSizeChanged().
+		if ( nframes > MAX_BUFFER_SIZE ) {
+			RT_ERRORLOG( "Buffer size %1 exceeds the maximum of %2, missed buffer",
+						 nframes, MAX_BUFFER_SIZE );
+			AudioEngine::get_instance()->unlock();
+			return 0;
+		}
+		RT_INFOLOG( "Buffer size changed. Old size = %1, new size = %2",
+					m_nBufferSize, nframes );
 		m_nBufferSize = nframes;
 	}
 
@@ -1326,23 +1849,32 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nFrames )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fTickSize )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fBPM ) );
+	audioEngine_process_tempoRamp( pSong );
 	// Check whether the tick size has changed.
 	audioEngine_process_checkBPMChanged(pSong);
 
+	pProfiler->endStage( ProcessProfiler::STAGE_PREPARE );
+
 	bool bSendPatternChange = false;
 	// always update note queue.. could come from pattern or realtime input
 	// (midi, keyboard)
 	int nResNoteQueue = audioEngine_updateNoteQueue( nframes );
+	pProfiler->endStage( ProcessProfiler::STAGE_NOTE_QUEUE );
 	if ( nResNoteQueue == -1 ) {	// end of song
-		___INFOLOG( "End of song received, calling engine_stop()" );
+		RT_INFOLOG( "End of song received, calling engine_stop()" );
+		if ( m_pExportWriter != nullptr ) {
+			m_pExportWriter->finish();
+		}
+		audioEngine_publishPlaybackSnapshot();
 		AudioEngine::get_instance()->unlock();
 		m_pAudioDriver->stop();
 		AudioEngine::get_instance()->locate( 0 ); // locate 0, reposition from start of the song
 
 		if ( ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() )
 			 || ( m_pAudioDriver->class_name() == FakeDriver::class_name() )
+			 || ( m_pAudioDriver->class_name() == OfflineDriver::class_name() )
 			 ) {
-			___INFOLOG( "End of song." );
+			RT_INFOLOG( "End of song." );
 			
 			return 1;	// kill the audio AudioDriver thread
 		}
@@ -1354,103 +1886,166 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 
 	// play all notes
 	audioEngine_process_playNotes( nframes );
+	audioEngine_process_playLiveNotes( nframes );
 
 	// SAMPLER
 	AudioEngine::get_instance()->get_sampler()->process( nframes, pSong );
 	float* out_L = AudioEngine::get_instance()->get_sampler()->m_pMainOut_L;
 	float* out_R = AudioEngine::get_instance()->get_sampler()->m_pMainOut_R;
-	for ( unsigned i = 0; i < nframes; ++i ) {
-		m_pMainBuffer_L[ i ] += out_L[ i ];
-		m_pMainBuffer_R[ i ] += out_R[ i ];
-	}
+	Dsp::add( m_pMainBuffer_L, out_L, nframes );
+	Dsp::add( m_pMainBuffer_R, out_R, nframes );
+	pProfiler->endStage( ProcessProfiler::STAGE_SAMPLER );
 
 	// SYNTH
 	AudioEngine::get_instance()->get_synth()->process( nframes );
 	out_L = AudioEngine::get_instance()->get_synth()->m_pOut_L;
 	out_R = AudioEngine::get_instance()->get_synth()->m_pOut_R;
-	for ( unsigned i = 0; i < nframes; ++i ) {
-		m_pMainBuffer_L[ i ] += out_L[ i ];
-		m_pMainBuffer_R[ i ] += out_R[ i ];
-	}
+	Dsp::add( m_pMainBuffer_L, out_L, nframes );
+	Dsp::add( m_pMainBuffer_R, out_R, nframes );
 
-	timeval renderTime_end = currentTime2();
-	timeval ladspaTime_start = renderTime_end;
+	// METRONOME
+	Metronome* pMetronome = AudioEngine::get_instance()->get_metronome();
+	if ( m_audioEngineState == STATE_PLAYING ) {
+		pMetronome->process( m_pAudioDriver->m_transport.m_nFrames,
+							 m_pAudioDriver->m_transport.m_fTickSize,
+							 m_pAudioDriver->getSampleRate(),
+							 m_pMainBuffer_L, m_pMainBuffer_R, nframes );
+	} else {
+		pMetronome->stop();
+	}
+	pProfiler->endStage( ProcessProfiler::STAGE_SYNTH );
 
 #ifdef H2CORE_HAVE_LADSPA
 	// Process LADSPA FX
 	if ( m_audioEngineState >= STATE_READY ) {
+		// Under load the send effects are bypassed. Their output is
+		// faded out during the first bypassed cycle and faded back
+		// in once they are resumed.
+		bool bBypassFX = AudioEngine::get_instance()->get_overload_governor()->getLevel() >=
+			OverloadGovernor::LEVEL_BYPASS_FX;
+		float fFXGainStart = m_bFXBypassed ? 0 : 1;
+		float fFXGainEnd = bBypassFX ? 0 : 1;
+		m_bFXBypassed = bBypassFX;
+
+		LadspaFXTasks tasks;
+		tasks.nTasks = 0;
+		tasks.nFrames = nframes;
 		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
 			LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-			if ( ( pFX ) && ( pFX->isEnabled() ) ) {
-				pFX->processFX( nframes );
-
-				float *buf_L, *buf_R;
-				if ( pFX->getPluginType() == LadspaFX::STEREO_FX ) {
-					buf_L = pFX->m_pBuffer_L;
-					buf_R = pFX->m_pBuffer_R;
-				} else { // MONO FX
-					buf_L = pFX->m_pBuffer_L;
-					buf_R = buf_L;
-				}
+			if ( ( pFX ) && ( pFX->isEnabled() ) &&
+				 ( fFXGainStart > 0 || fFXGainEnd > 0 ) ) {
+				tasks.pFX[ tasks.nTasks ] = pFX;
+				tasks.nFX[ tasks.nTasks ] = nFX;
+				++tasks.nTasks;
+			} else {
+				m_fFXProcessTime[ nFX ] = 0;
+			}
+		}
 
-				for ( unsigned i = 0; i < nframes; ++i ) {
-					m_pMainBuffer_L[ i ] += buf_L[ i ];
-					m_pMainBuffer_R[ i ] += buf_R[ i ];
-					if ( buf_L[ i ] > m_fFXPeak_L[nFX] ) {
-						m_fFXPeak_L[nFX] = buf_L[ i ];
-					}
+		// The effects are independent of each other and only write
+		// to their own buffers.
+		WorkerPool* pWorkerPool =
+			AudioEngine::get_instance()->get_sampler()->getWorkerPool();
+		if ( pWorkerPool != nullptr && tasks.nTasks > 1 &&
+			 RealtimeConfig::get().bParallelLadspaFX ) {
+			pWorkerPool->run( tasks.nTasks, audioEngine_processLadspaFX, &tasks );
+		} else {
+			for ( int nTask = 0; nTask < tasks.nTasks; ++nTask ) {
+				audioEngine_processLadspaFX( nTask, &tasks );
+			}
+		}
 
-					if ( buf_R[ i ] > m_fFXPeak_R[nFX] ) {
-						m_fFXPeak_R[nFX] = buf_R[ i ];
-					}
-				}
+		for ( int nTask = 0; nTask < tasks.nTasks; ++nTask ) {
+			LadspaFX *pFX = tasks.pFX[ nTask ];
+			int nFX = tasks.nFX[ nTask ];
+
+			float *buf_L, *buf_R;
+			if ( pFX->getPluginType() == LadspaFX::STEREO_FX ) {
+				buf_L = pFX->m_pBuffer_L;
+				buf_R = pFX->m_pBuffer_R;
+			} else { // MONO FX
+				buf_L = pFX->m_pBuffer_L;
+				buf_R = buf_L;
+			}
+
+			if ( fFXGainStart == 1 && fFXGainEnd == 1 ) {
+				Dsp::add( m_pMainBuffer_L, buf_L, nframes );
+				Dsp::add( m_pMainBuffer_R, buf_R, nframes );
+			} else {
+				audioEngine_addFaded( m_pMainBuffer_L, buf_L, fFXGainStart, fFXGainEnd, nframes );
+				audioEngine_addFaded( m_pMainBuffer_R, buf_R, fFXGainStart, fFXGainEnd, nframes );
 			}
+			m_fFXPeak_L[nFX] = Dsp::maxAbs( buf_L, nframes, m_fFXPeak_L[nFX] );
+			m_fFXPeak_R[nFX] = Dsp::maxAbs( buf_R, nframes, m_fFXPeak_R[nFX] );
 		}
 	}
 #endif
-	timeval ladspaTime_end = currentTime2();
+	pProfiler->endStage( ProcessProfiler::STAGE_LADSPA );
 
 
 	// update master peaks
-	float val_L, val_R;
 	if ( m_audioEngineState >= STATE_READY ) {
-		for ( unsigned i = 0; i < nframes; ++i ) {
-			val_L = m_pMainBuffer_L[i];
-			val_R = m_pMainBuffer_R[i];
-
-			if ( val_L > m_fMasterPeak_L ) {
-				m_fMasterPeak_L = val_L;
-			}
-
-			if ( val_R > m_fMasterPeak_R ) {
-				m_fMasterPeak_R = val_R;
-			}
+		m_fMasterPeak_L = Dsp::maxAbs( m_pMainBuffer_L, nframes, m_fMasterPeak_L );
+		m_fMasterPeak_R = Dsp::maxAbs( m_pMainBuffer_R, nframes, m_fMasterPeak_R );
+
+		for ( auto pCompo : *pSong->getComponents() ) {
+			pCompo->set_peak_l( Dsp::maxAbs( pCompo->get_out_buffer_L(), nframes,
+											 pCompo->get_peak_l() ) );
+			pCompo->set_peak_r( Dsp::maxAbs( pCompo->get_out_buffer_R(), nframes,
+											 pCompo->get_peak_r() ) );
+		}
 
-			for (std::vector<DrumkitComponent*>::iterator it = pSong->getComponents()->begin() ; it != pSong->getComponents()->end(); ++it) {
-				DrumkitComponent* drumkit_component = *it;
+#ifdef H2CORE_HAVE_LADSPA
+		AudioEngine::get_instance()->get_peak_meters()->publish(
+			pSong, m_fFXPeak_L, m_fFXPeak_R, &m_fMasterPeak_L, &m_fMasterPeak_R );
+#else
+		AudioEngine::get_instance()->get_peak_meters()->publish(
+			pSong, nullptr, nullptr, &m_fMasterPeak_L, &m_fMasterPeak_R );
+#endif
+	}
+	pProfiler->endStage( ProcessProfiler::STAGE_METERING );
 
-				float compo_val_L = drumkit_component->get_out_L(i);
-				float compo_val_R = drumkit_component->get_out_R(i);
+	// Hand the main output to the background writer thread when
+	// exporting in JACK freewheel mode.
+	if ( m_pExportWriter != nullptr && m_audioEngineState == STATE_PLAYING ) {
+		m_pExportWriter->write( m_pMainBuffer_L, m_pMainBuffer_R, nframes );
 
-				if( compo_val_L > drumkit_component->get_peak_l() ) {
-					drumkit_component->set_peak_l( compo_val_L );
-				}
-				if( compo_val_R > drumkit_component->get_peak_r() ) {
-					drumkit_component->set_peak_r( compo_val_R );
-				}
+		int nColumns = pSong->getPatternGroupVector()->size();
+		if ( nColumns > 0 && m_nSongPos >= 0 ) {
+			// 100 is pushed by the writer once the file is closed.
+			int nProgress = std::min( 100 * m_nSongPos / nColumns, 99 );
+			if ( nProgress != m_nExportProgress ) {
+				m_nExportProgress = nProgress;
+				EventQueue::get_instance()->push_event( EVENT_PROGRESS, nProgress );
 			}
 		}
 	}
 
+	// Hand the main and track outputs to the thread streaming them
+	// to a remote host.
+	AudioEngine::get_instance()->get_network_stem_output()->process(
+		m_pAudioDriver, m_pMainBuffer_L, m_pMainBuffer_R, nframes,
+		m_pAudioDriver->getSampleRate() );
+
+	AudioEngine::get_instance()->get_playback_clock()->publish(
+		m_pAudioDriver->m_transport.m_nFrames, m_pAudioDriver->m_transport.m_fTickSize,
+		m_audioEngineState == STATE_PLAYING, m_nPatternStartTick,
+		m_pPlayingPatterns->size() != 0 ? m_pPlayingPatterns->longest_pattern_length() : MAX_NOTES );
+
 	// update total frames number
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		m_pAudioDriver->m_transport.m_nFrames += nframes;
 	}
 
-	timeval finishTimeval = currentTime2();
-	m_fProcessTime =
-			( finishTimeval.tv_sec - startTimeval.tv_sec ) * 1000.0
-			+ ( finishTimeval.tv_usec - startTimeval.tv_usec ) / 1000.0;
+	m_fProcessTime = pProfiler->endCycle();
+	pProfiler->publishVoices( AudioEngine::get_instance()->get_sampler()->getPlayingNotesNumber(),
+							  AudioEngine::get_instance()->get_synth()->getPlayingNotesNumber() );
+
+	audioEngine_process_overloadGovernor(
+		m_pExportWriter == nullptr &&
+		m_pAudioDriver->class_name() != DiskWriterDriver::class_name() &&
+		m_pAudioDriver->class_name() != OfflineDriver::class_name() &&
+		m_pAudioDriver->class_name() != FakeDriver::class_name() );
 
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		AudioEngine::get_instance()->updateElapsedTime( m_pAudioDriver->getBufferSize(),
@@ -1459,24 +2054,35 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 
 #ifdef CONFIG_DEBUG
 	if ( m_fProcessTime > m_fMaxProcessTime ) {
-		___WARNINGLOG( "" );
-		___WARNINGLOG( "----XRUN----" );
-		___WARNINGLOG( QString( "XRUN of %1 msec (%2 > %3)" )
-					   .arg( ( m_fProcessTime - m_fMaxProcessTime ) )
-					   .arg( m_fProcessTime ).arg( m_fMaxProcessTime ) );
-		___WARNINGLOG( QString( "Ladspa process time = %1" ).arg( fLadspaTime ) );
-		___WARNINGLOG( "------------" );
-		___WARNINGLOG( "" );
+		Tracer::instant( "Process cycle overrun" );
+		RT_WARNINGLOG( "----XRUN----" );
+		RT_WARNINGLOG( "XRUN of %1 msec (%2 > %3)",
+					   m_fProcessTime - m_fMaxProcessTime,
+					   m_fProcessTime, m_fMaxProcessTime );
+		RT_WARNINGLOG( "Prepare / note queue / sampler time = %1 / %2 / %3",
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_PREPARE ),
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_NOTE_QUEUE ),
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_SAMPLER ) );
+		RT_WARNINGLOG( "Synth / LADSPA / metering time = %1 / %2 / %3",
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_SYNTH ),
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_LADSPA ),
+					   pProfiler->getLastDuration( ProcessProfiler::STAGE_METERING ) );
+		RT_WARNINGLOG( "------------" );
+	}
+#endif
+	if ( m_fProcessTime > m_fMaxProcessTime ) {
 		// raise xRun event
+		pProfiler->countXRun();
 		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
 	}
-#endif
 	// ___INFOLOG( QString( "[end] status: %1, frame: %2, ticksize: %3, bpm: %4" )
 	// 	    .arg( m_pAudioDriver->m_transport.m_status )
 	// 	    .arg( m_pAudioDriver->m_transport.m_nFrames )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fTickSize )
 	// 	    .arg( m_pAudioDriver->m_transport.m_fBPM ) );
 
+	audioEngine_publishPlaybackSnapshot();
+
 	AudioEngine::get_instance()->unlock();
 
 	if ( bSendPatternChange ) {
@@ -1520,18 +2126,48 @@ void audioEngine_setupLadspaFX( unsigned nBufferSize )
 #endif
 }
 
+/**
+ * Renders the clicks of the Metronome from the sample of
+ * #m_pMetronomeInstrument at the sample rate of #m_pAudioDriver.
+ *
+ * Has to be called whenever a new audio driver was initialized.
+ */
+void audioEngine_setupMetronome()
+{
+	if ( m_pAudioDriver == nullptr || m_pMetronomeInstrument == nullptr ) {
+		return;
+	}
+
+	std::shared_ptr<Sample> pSample = nullptr;
+	InstrumentLayer* pLayer =
+		m_pMetronomeInstrument->get_components()->front()->get_layer( 0 );
+	if ( pLayer != nullptr ) {
+		pSample = pLayer->get_sample();
+	}
+
+	AudioEngine::get_instance()->get_metronome()->setSample(
+		pSample, m_pAudioDriver->getSampleRate() );
+}
+
 /**
  * Hands the provided Song to JackAudioDriver::makeTrackOutputs() if
  * @a pSong is not a null pointer and the audio driver #m_pAudioDriver
- * is an instance of the JackAudioDriver.
+ * is an instance of the JackAudioDriver. For other drivers providing
+ * multichannel outputs TrackOutputs::makeTrackOutputs() is used
+ * instead.
  * \param pSong Song for which per-track output ports should be generated.
  */
 void audioEngine_renameJackPorts(Song * pSong)
 {
-#ifdef H2CORE_HAVE_JACK
-	// renames jack ports
 	if ( ! pSong ) return;
 
+	if ( m_pAudioDriver != nullptr &&
+		 m_pAudioDriver->getTrackOutputs() != nullptr ) {
+		m_pAudioDriver->getTrackOutputs()->makeTrackOutputs( pSong );
+	}
+
+#ifdef H2CORE_HAVE_JACK
+	// renames jack ports
 	if ( Hydrogen::get_instance()->haveJackAudioDriver() ) {
 		static_cast< JackAudioDriver* >( m_pAudioDriver )->makeTrackOutputs( pSong );
 	}
@@ -1562,18 +2198,20 @@ void audioEngine_setSong( Song* pNewSong )
 	}
 
 	audioEngine_renameJackPorts( pNewSong );
+	audioEngine_seedRandom( pNewSong );
 
 	m_pAudioDriver->setBpm( pNewSong->getBpm() );
-	m_pAudioDriver->m_transport.m_fTickSize = 
-		AudioEngine::compute_tick_size( static_cast<int>(m_pAudioDriver->getSampleRate()),
-										pNewSong->getBpm(),
-										static_cast<int>(pNewSong->getResolution()) );
+	m_pAudioDriver->m_transport.setTickSize( m_pAudioDriver->getSampleRate(),
+											 pNewSong->getBpm(),
+											 static_cast<int>(pNewSong->getResolution()) );
 
 	// change the current audio engine state
 	m_audioEngineState = STATE_READY;
 
 	AudioEngine::get_instance()->locate( 0 );
 
+	audioEngine_publishPlaybackSnapshot();
+
 	AudioEngine::get_instance()->unlock();
 
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_READY );
@@ -1598,6 +2236,7 @@ void audioEngine_removeSong()
 	m_pPlayingPatterns->clear();
 	m_pNextPatterns->clear();
 	audioEngine_clearNoteQueue();
+	audioEngine_publishPlaybackSnapshot();
 
 	// change the current audio engine state
 	m_audioEngineState = STATE_PREPARED;
@@ -1614,10 +2253,12 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 	// Indicates whether the current pattern list changed with respect
 	// to the last cycle.
 	bool bSendPatternChange = false;
-	float fTickSize = m_pAudioDriver->m_transport.m_fTickSize;
+	const TransportInfo& transport = m_pAudioDriver->m_transport;
+	float fTickSize = transport.m_fTickSize;
+	const int64_t nTickSize = transport.m_nTickSize;
 	int nLeadLagFactor = pHydrogen->calculateLeadLagFactor( fTickSize );
 
-	unsigned int framepos;
+	long long framepos;
 	if (  m_audioEngineState == STATE_PLAYING ) {
 		// Current transport position.
 		framepos = m_pAudioDriver->m_transport.m_nFrames;
@@ -1628,20 +2269,43 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 	}
 
 	int lookahead = pHydrogen->calculateLookahead( fTickSize );
+	m_songNoteQueue.setLookahead( lookahead + static_cast<int>( nFrames ) );
 	int tickNumber_start = 0;
-	if ( framepos == 0
+	bool bExportResumed = false;
+	if ( m_nExportResumeTick >= 0 ) {
+		// The notes within the lookahead of the current position
+		// were dropped by Hydrogen::skipExport().
+		tickNumber_start = m_nExportResumeTick;
+		m_nExportResumeTick = -1;
+		bExportResumed = true;
+	} else if ( framepos == 0
 		 || ( m_audioEngineState == STATE_PLAYING
 			  && pSong->getMode() == Song::SONG_MODE
 			  && m_nSongPos == -1 )
 	) {
-		tickNumber_start = framepos / fTickSize;
+		tickNumber_start = transport.tickAtFrame( framepos );
+	} else {
+		tickNumber_start = transport.tickAtFrame( framepos + lookahead );
+	}
+	int tickNumber_end = transport.tickAtFrame( framepos + nFrames + lookahead );
+
+	// The transport was started or relocated somewhere else than
+	// the end of the last cycle. Small deviations are caused by
+	// rounding after tempo changes.
+	if ( m_audioEngineState == STATE_PLAYING ) {
+		if ( pSong->getMode() == Song::SONG_MODE && tickNumber_start > 0 &&
+			 ! bExportResumed &&
+			 ( m_nNextQueueTick < 0 ||
+			   std::abs( tickNumber_start - m_nNextQueueTick ) > 1 ) ) {
+			audioEngine_resumeSoundingNotes( tickNumber_start, nTickSize );
+		}
+		m_nNextQueueTick = std::max( tickNumber_start, tickNumber_end );
 	} else {
-		tickNumber_start = ( framepos + lookahead) / fTickSize;
+		m_nNextQueueTick = -1;
 	}
-	int tickNumber_end = ( framepos + nFrames + lookahead ) /fTickSize;
 
 	// Get initial timestamp for first tick
-	gettimeofday( &m_currentTickTime, nullptr );
+	m_nCurrentTickTimeNs = rtclock_now_ns();
 
 	// A tick is the most fine-grained time scale within Hydrogen.
 	for ( int tick = tickNumber_start; tick < tickNumber_end; tick++ ) {
@@ -1656,7 +2320,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 
 			m_midiNoteQueue.pop_front();
 			pNote->get_instrument()->enqueue();
-			m_songNoteQueue.push( pNote );
+			m_songNoteQueue.push( pNote, nTickSize );
 		}
 
 		if (  m_audioEngineState != STATE_PLAYING ) {
@@ -1669,7 +2333,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 		if ( pSong->getMode() == Song::SONG_MODE ) {
 			if ( pSong->getPatternGroupVector()->size() == 0 ) {
 				// there's no song!!
-				___ERRORLOG( "no patterns in song." );
+				RT_ERRORLOG( "no patterns in song." );
 				m_pAudioDriver->stop();
 				return -1;
 			}
@@ -1705,7 +2369,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			// function returns indicating that the end of the song is
 			// reached.
 			if ( m_nSongPos == -1 ) {
-				___INFOLOG( "song pos = -1" );
+				RT_INFOLOG( "song pos = -1" );
 				if ( pSong->getIsLoopEnabled() == true ) {
 					// TODO: This function call should be redundant
 					// since `findPatternInTick()` is deterministic
@@ -1714,7 +2378,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 					m_nSongPos = findPatternInTick( 0, true, &m_nPatternStartTick );
 				} else {
 
-					___INFOLOG( "End of Song" );
+					RT_INFOLOG( "End of Song" );
 
 					if( Hydrogen::get_instance()->getMidiOutput() != nullptr ){
 						Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
@@ -1725,16 +2389,19 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			}
 			
 			// Obtain the current PatternList and use it to overwrite
-			// the on in `m_pPlayingPatterns.
-			// TODO: Why overwriting it for each and every tick
-			//       without check if it did changed? This is highly
-			//       inefficient.
+			// the on in `m_pPlayingPatterns, unless neither the
+			// column nor any of the patterns did change since.
 			PatternList *pPatternList = ( *( pSong->getPatternGroupVector() ) )[m_nSongPos];
-			m_pPlayingPatterns->clear();
-			for ( int i=0; i< pPatternList->size(); ++i ) {
-				Pattern* pPattern = pPatternList->get(i);
-				m_pPlayingPatterns->add( pPattern );
-				pPattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+			if ( pPatternList != m_pExpandedPatterns ||
+				 Pattern::get_generation() != m_nExpandedGeneration ) {
+				m_pPlayingPatterns->clear();
+				for ( int i=0; i< pPatternList->size(); ++i ) {
+					Pattern* pPattern = pPatternList->get(i);
+					m_pPlayingPatterns->add( pPattern );
+					pPattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				}
+				m_pExpandedPatterns = pPatternList;
+				m_nExpandedGeneration = Pattern::get_generation();
 			}
 		}
 		
@@ -1746,14 +2413,17 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 
 			// If the user chose to playback the pattern she focuses,
 			// use it to overwrite `m_pPlayingPatterns`.
-			if ( Preferences::get_instance()->patternModePlaysSelected() )
+			if ( RealtimeConfig::get().bPatternModePlaysSelected )
 			{
-				// TODO: Again, a check whether the pattern did change
-				// would be more efficient.
-				m_pPlayingPatterns->clear();
 				Pattern * pattern = pSong->getPatternList()->get(m_nSelectedPatternNumber);
-				m_pPlayingPatterns->add( pattern );
-				pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				if ( pattern != m_pExpandedPatterns ||
+					 Pattern::get_generation() != m_nExpandedGeneration ) {
+					m_pPlayingPatterns->clear();
+					m_pPlayingPatterns->add( pattern );
+					pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+					m_pExpandedPatterns = pattern;
+					m_nExpandedGeneration = Pattern::get_generation();
+				}
 			}
 
 			if ( m_pPlayingPatterns->size() != 0 ) {
@@ -1761,7 +2431,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			}
 
 			if ( nPatternSize == 0 ) {
-				___ERRORLOG( "nPatternSize == 0" );
+				RT_ERRORLOG( "nPatternSize == 0" );
 			}
 
 			// If either the beginning of the current pattern was not
@@ -1803,116 +2473,138 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			}
 		}
 
+		// Swap in a drumkit prepared in the background right before
+		// the notes of a new bar are queued.
+		if ( m_nPatternTickPosition == 0 ) {
+			audioEngine_swapDrumkit( true );
+		}
+
 		//////////////////////////////////////////////////////////////
 		// Metronome
 		// Only trigger the metronome at a predefined rate.
 		if ( m_nPatternTickPosition % 48 == 0 ) {
-			float fPitch;
+			bool bAccent;
 			float fVelocity;
 			
 			// Depending on whether the metronome beat will be issued
 			// at the beginning or in the remainder of the pattern,
 			// two different sounds and events will be used.
 			if ( m_nPatternTickPosition == 0 ) {
-				fPitch = 3;
+				bAccent = true;
 				fVelocity = 1.0;
 				EventQueue::get_instance()->push_event( EVENT_METRONOME, 1 );
 			} else {
-				fPitch = 0;
+				bAccent = false;
 				fVelocity = 0.8;
 				EventQueue::get_instance()->push_event( EVENT_METRONOME, 0 );
 			}
 			
 			// Only trigger the sounds if the user enabled the
-			// metronome. 
-			if ( Preferences::get_instance()->m_bUseMetronome ) {
-				m_pMetronomeInstrument->set_volume(
-							Preferences::get_instance()->m_fMetronomeVolume
-							);
-				Note *pMetronomeNote = new Note( m_pMetronomeInstrument,
-												 tick,
-												 fVelocity,
-												 0.5,
-												 0.5,
-												 -1,
-												 fPitch
-												 );
-				m_pMetronomeInstrument->enqueue();
-				m_songNoteQueue.push( pMetronomeNote );
+			// metronome. The clicks are mixed by the dedicated
+			// Metronome and do neither occupy the song note queue
+			// nor the polyphony of the Sampler.
+			if ( RealtimeConfig::get().bUseMetronome ) {
+				AudioEngine::get_instance()->get_metronome()->trigger(
+					tick, bAccent,
+					fVelocity * RealtimeConfig::get().fMetronomeVolume *
+					pSong->getVolume() );
 			}
 		}
 
+		// Frozen instruments are played back from their renders
+		// instead of their individual notes.
+		InstrumentFreezer* pFreezer = InstrumentFreezer::get_instance();
+		if ( m_nPatternTickPosition == 0 ) {
+			pFreezer->startColumn( m_pPlayingPatterns, pSong, tick, nTickSize,
+								   m_pAudioDriver->getSampleRate(), m_songNoteQueue );
+		}
+
 		//////////////////////////////////////////////////////////////
 		// Update the notes queue.
 		// 
 		if ( m_pPlayingPatterns->size() != 0 ) {
-			for ( unsigned nPat = 0 ;
-				  nPat < m_pPlayingPatterns->size() ;
-				  ++nPat ) {
-				Pattern *pPattern = m_pPlayingPatterns->get( nPat );
-				assert( pPattern != nullptr );
-				Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
-
-				// Perform a loop over all notes, which are enclose
-				// the position of the current tick, using a constant
-				// iterator (notes won't be altered!). After some
-				// humanization was applied to onset of each note, it
-				// will be added to `m_songNoteQueue` for playback.
-				FOREACH_NOTE_CST_IT_BOUND(notes,it,m_nPatternTickPosition) {
-					Note *pNote = it->second;
-					if ( pNote ) {
-						pNote->set_just_recorded( false );
-						int nOffset = 0;
-
-						// Swing //
-						// Add a constant and periodic offset at
-						// predefined positions to the note position.
-						// TODO: incorporate the factor of 6.0 either
-						// in Song::m_fSwingFactor or make it a member
-						// variable.
-						float fSwingFactor = pSong->getSwingFactor();
-						if ( ( ( m_nPatternTickPosition % 12 ) == 0 )
-							 && ( ( m_nPatternTickPosition % 24 ) != 0 ) ) {
-							// da l'accento al tick 4, 12, 20, 36...
-							nOffset += (int)( 6.0 * fTickSize * fSwingFactor );
-						}
+			// Perform a loop over all notes, which are enclose
+			// the position of the current tick, using the
+			// precompiled table of all playing patterns. After
+			// some humanization was applied to onset of each
+			// note, it will be added to `m_songNoteQueue` for
+			// playback.
+			int nNotes = 0;
+			const float* pLeadLag = nullptr;
+			const float* pProbability = nullptr;
+			Note* const* ppNotes =
+				m_pPlayingPatterns->get_notes_at( m_nPatternTickPosition, nNotes,
+												  pLeadLag, pProbability );
+			for ( int nNote = 0; nNote < nNotes; ++nNote ) {
+				if ( ppNotes[ nNote ] != nullptr &&
+					 pFreezer->isReplaced( ppNotes[ nNote ]->get_instrument() ) ) {
+					continue;
+				}
 
-						// Humanize - Time parameter //
-						// Add a random offset to each note. Due to
-						// the nature of the Gaussian distribution,
-						// the factor Song::m_fHumanizeTimeValue will
-						// also scale the variance of the generated
-						// random variable.
-						if ( pSong->getHumanizeTimeValue() != 0 ) {
-							nOffset += ( int )(
-										getGaussian( 0.3 )
-										* pSong->getHumanizeTimeValue()
-										* pHydrogen->m_nMaxTimeHumanize
-										);
-						}
+				// Check if the current note has probability != 1.
+				// If yes call a random function to choose whether
+				// to play the note or not. This is done before the
+				// note is copied, so dropped notes cost nothing but
+				// the random number.
+				float fNoteProbability = pProbability[ nNote ];
+				if ( fNoteProbability != 1. &&
+					 fNoteProbability < m_random.uniform() ) {
+					continue;
+				}
 
-						// Lead or Lag - timing parameter //
-						// Add a constant offset to all notes.
-						nOffset += (int) ( pNote->get_lead_lag()
-										   * nLeadLagFactor );
+				Note *pNote = ppNotes[ nNote ];
+				if ( pNote ) {
+					pNote->set_just_recorded( false );
+					int nOffset = 0;
+
+					// Swing //
+					// Add a constant and periodic offset at
+					// predefined positions to the note position.
+					// TODO: incorporate the factor of 6.0 either
+					// in Song::m_fSwingFactor or make it a member
+					// variable.
+					float fSwingFactor = pSong->getSwingFactor();
+					if ( ( ( m_nPatternTickPosition % 12 ) == 0 )
+						 && ( ( m_nPatternTickPosition % 24 ) != 0 ) ) {
+						// da l'accento al tick 4, 12, 20, 36...
+						nOffset += (int)( 6.0 * fTickSize * fSwingFactor );
+					}
 
-						// No note is allowed to start prior to the
-						// beginning of the song.
-						if((tick == 0) && (nOffset < 0)) {
-							nOffset = 0;
-						}
-						
-						// Generate a copy of the current note, assign
-						// it the new offset, and push it to the list
-						// of all notes, which are about to be played
-						// back.
-						// TODO: Why a copy?
-						Note *pCopiedNote = new Note( pNote );
-						pCopiedNote->set_position( tick );
-						pCopiedNote->set_humanize_delay( nOffset );
-						pNote->get_instrument()->enqueue();
-						m_songNoteQueue.push( pCopiedNote );
+					// Humanize - Time parameter //
+					// Add a random offset to each note. Due to
+					// the nature of the Gaussian distribution,
+					// the factor Song::m_fHumanizeTimeValue will
+					// also scale the variance of the generated
+					// random variable.
+					if ( pSong->getHumanizeTimeValue() != 0 ) {
+						nOffset += ( int )(
+									m_random.gaussian( 0.3 )
+									* pSong->getHumanizeTimeValue()
+									* pHydrogen->m_nMaxTimeHumanize
+									);
 					}
+
+					// Lead or Lag - timing parameter //
+					// Add a constant offset to all notes.
+					nOffset += (int) ( pLeadLag[ nNote ]
+									   * nLeadLagFactor );
+
+					// No note is allowed to start prior to the
+					// beginning of the song.
+					if((tick == 0) && (nOffset < 0)) {
+						nOffset = 0;
+					}
+					
+					// Generate a copy of the current note, assign
+					// it the new offset, and push it to the list
+					// of all notes, which are about to be played
+					// back.
+					// TODO: Why a copy?
+					Note *pCopiedNote = new ( NotePool::get_instance() ) Note( pNote );
+					pCopiedNote->set_position( tick );
+					pCopiedNote->set_humanize_delay( nOffset );
+					pNote->get_instrument()->enqueue();
+					m_songNoteQueue.push( pCopiedNote, nTickSize );
 				}
 			}
 		}
@@ -1926,37 +2618,167 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 	return 0;
 }
 
-inline int findPatternInTick( int nTick, bool bLoopMode, int* pPatternStartTick )
+void audioEngine_resumeSoundingNotes( long nTick, int64_t nTickSize )
 {
+	Song* pSong = Hydrogen::get_instance()->getSong();
+
+	// The transport position of the JACK server keeps on increasing
+	// while looping.
+	long nSongTick = nTick;
+	if ( pSong->getIsLoopEnabled() ) {
+		const int nSongLength = pSong->lengthInTicks();
+		if ( nSongLength > 0 ) {
+			nSongTick = nTick % nSongLength;
+		}
+	}
+
+	const ColumnSnapshots::SoundingNote* pSounding = nullptr;
+	const int nSounding = AudioEngine::get_instance()->get_column_snapshots()->
+		getSoundingNotes( pSong, nSongTick, &pSounding );
+	InstrumentFreezer* pFreezer = InstrumentFreezer::get_instance();
+	for ( int nNote = 0; nNote < nSounding; ++nNote ) {
+		const ColumnSnapshots::SoundingNote& sounding = pSounding[ nNote ];
+		// Notes starting at nTick are queued as usual.
+		if ( sounding.nStartTick >= nSongTick || sounding.nEndTick <= nSongTick ) {
+			continue;
+		}
+		Note* pNote = sounding.pNote;
+		if ( pNote->get_instrument() == nullptr ||
+			 pFreezer->isReplaced( pNote->get_instrument() ) ) {
+			continue;
+		}
+		float fNoteProbability = pNote->get_probability();
+		if ( fNoteProbability != 1. &&
+			 fNoteProbability < m_random.uniform() ) {
+			continue;
+		}
+
+		Note *pCopiedNote = new ( NotePool::get_instance() ) Note( pNote );
+		pCopiedNote->set_position( nTick );
+		pCopiedNote->set_start_offset(
+			static_cast<int>( TickTime::frameAtTick( nSongTick - sounding.nStartTick, nTickSize ) ) );
+		pNote->get_instrument()->enqueue();
+		m_songNoteQueue.push( pCopiedNote, nTickSize );
+	}
+}
+
+inline void audioEngine_swapDrumkit( bool bBarBoundary )
+{
+	PreparedDrumkit* pPrepared = m_pPreparedDrumkit;
+	if ( pPrepared == nullptr ||
+		 ! pPrepared->bCommit.load( std::memory_order_acquire ) ) {
+		return;
+	}
+	if ( ! bBarBoundary && m_audioEngineState == STATE_PLAYING &&
+		 pPrepared->bAtBarBoundary.load( std::memory_order_relaxed ) ) {
+		return;
+	}
+	m_pPreparedDrumkit = nullptr;
+
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
-	assert( pSong );
 
-	int nTotalLength = 0;
-	m_nSongSizeInTicks = 0;
+	// The preparation is based on the instruments present at the
+	// time prepareDrumkit() was called. If they changed in the
+	// meantime, the instruments of the Song can not be mapped
+	// properly.
+	const int nSongInstruments = pPrepared->songInstruments.size();
+	bool bValid = pSong != nullptr && pSong == pPrepared->pSong &&
+		pSong->getInstrumentList() == pPrepared->pSongInstrumentList &&
+		pSong->getInstrumentList()->size() == nSongInstruments;
+	for ( int ii = 0; bValid && ii < nSongInstruments; ++ii ) {
+		if ( pSong->getInstrumentList()->get( ii ) != pPrepared->songInstruments[ ii ] ) {
+			bValid = false;
+		}
+	}
+	if ( ! bValid ) {
+		RT_ERRORLOG( "Instruments of the song changed while preparing the drumkit. Discarding it." );
+		pPrepared->nState.store( PreparedDrumkit::Discarded, std::memory_order_release );
+		EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOADED, -1 );
+		return;
+	}
 
-	std::vector<PatternList*> *pPatternColumns = pSong->getPatternGroupVector();
-	int nColumns = pPatternColumns->size();
-
-	// Sum the lengths of all pattern columns and use the macro
-	// MAX_NOTES in case some of them are of size zero. If the
-	// supplied value nTick is bigger than this and doesn't belong to
-	// the next pattern column, we just found the pattern list we were
-	// searching for.
-	int nPatternSize;
-	for ( int i = 0; i < nColumns; ++i ) {
-		PatternList *pColumn = ( *pPatternColumns )[ i ];
-		if ( pColumn->size() != 0 ) {
-			nPatternSize = pColumn->longest_pattern_length();
-		} else {
-			nPatternSize = MAX_NOTES;
+	// Settings not part of the drumkit stay with the instrument
+	// slot, as they do in Hydrogen::loadDrumkit().
+	const auto& replacements = pPrepared->replacements;
+	for ( const auto& replacement : replacements ) {
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			replacement.second->set_fx_level( replacement.first->get_fx_level( nFX ), nFX );
 		}
+		replacement.second->set_soloed( replacement.first->is_soloed() );
+	}
+
+	auto mapNote = [&]( Note* pNote ) {
+		Instrument* pInstr = pNote->get_instrument();
+		auto it = std::lower_bound( replacements.begin(), replacements.end(), pInstr,
+									[]( const std::pair<Instrument*, Instrument*>& replacement,
+										Instrument* pOther ) {
+										return replacement.first < pOther;
+									} );
+		if ( it != replacements.end() && it->first == pInstr ) {
+			pNote->set_instrument( it->second );
+		}
+	};
 
-		if ( ( nTick >= nTotalLength ) && ( nTick < nTotalLength + nPatternSize ) ) {
-			( *pPatternStartTick ) = nTotalLength;
-			return i;
+	PatternList* pPatternList = pSong->getPatternList();
+	for ( int nPattern = 0; nPattern < pPatternList->size(); ++nPattern ) {
+		Pattern* pPattern = pPatternList->get( nPattern );
+		FOREACH_NOTE_CST_IT_BEGIN_END( pPattern->get_notes(), it ) {
+			mapNote( it->second );
 		}
-		nTotalLength += nPatternSize;
+		// The per-instrument index is keyed by the old instruments.
+		pPattern->notes_changed();
+	}
+	// Notes in the song note queue and played by the Sampler are
+	// already accounted for by Instrument::enqueue() and keep on
+	// using the previous instruments.
+	for ( auto& pNote : m_midiNoteQueue ) {
+		mapNote( pNote );
+	}
+	for ( auto& pNote : m_liveNoteQueue ) {
+		mapNote( pNote );
+	}
+
+	InstrumentList* pPreviousInstruments = pSong->getInstrumentList();
+	pSong->setInstrumentList( pPrepared->pInstrumentList );
+	pPrepared->pInstrumentList = pPreviousInstruments;
+
+	std::vector<DrumkitComponent*>* pPreviousComponents = pSong->getComponents();
+	pSong->setComponents( pPrepared->pComponents );
+	pPrepared->pComponents = pPreviousComponents;
+
+	pPrepared->sPreviousDrumkitName = pHydrogen->getCurrentDrumkitName();
+	pHydrogen->setCurrentDrumkitName( pPrepared->sDrumkitName );
+	pHydrogen->setCurrentDrumkitLookup( pPrepared->lookup );
+
+	int nInstruments = pSong->getInstrumentList()->size();
+	if ( pHydrogen->getSelectedInstrumentNumber() >= nInstruments ) {
+		pHydrogen->setSelectedInstrumentNumber( std::max( 0, nInstruments - 1 ) );
+	}
+
+	pPrepared->nState.store( PreparedDrumkit::Committed, std::memory_order_release );
+	EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOADED, 0 );
+}
+
+inline void audioEngine_publishPlaybackSnapshot()
+{
+	AudioEngine::get_instance()->get_playback_snapshot()->publish( m_pPlayingPatterns,
+																   m_pNextPatterns );
+}
+
+inline int findPatternInTick( int nTick, bool bLoopMode, int* pPatternStartTick )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	assert( pSong );
+
+	m_nSongSizeInTicks = 0;
+
+	// The start ticks of all pattern columns are cached by the Song
+	// and searched using bisection.
+	int nColumn = pSong->findColumn( nTick, pPatternStartTick );
+	if ( nColumn != -1 ) {
+		return nColumn;
 	}
 
 	// If the song is played in loop mode, the tick numbers of the
@@ -1964,27 +2786,12 @@ inline int findPatternInTick( int nTick, bool bLoopMode, int* pPatternStartTick
 	// song. Therefore, we will introduced periodic boundary
 	// conditions and start the search again.
 	if ( bLoopMode ) {
-		m_nSongSizeInTicks = nTotalLength;
+		m_nSongSizeInTicks = pSong->lengthInTicks();
 		int nLoopTick = 0;
 		if ( m_nSongSizeInTicks != 0 ) {
 			nLoopTick = nTick % m_nSongSizeInTicks;
 		}
-		nTotalLength = 0;
-		for ( int i = 0; i < nColumns; ++i ) {
-			PatternList *pColumn = ( *pPatternColumns )[ i ];
-			if ( pColumn->size() != 0 ) {
-				nPatternSize = pColumn->longest_pattern_length();
-			} else {
-				nPatternSize = MAX_NOTES;
-			}
-
-			if ( ( nLoopTick >= nTotalLength )
-				 && ( nLoopTick < nTotalLength + nPatternSize ) ) {
-				( *pPatternStartTick ) = nTotalLength;
-				return i;
-			}
-			nTotalLength += nPatternSize;
-		}
+		return pSong->findColumn( nLoopTick, pPatternStartTick );
 	}
 
 	return -1;
@@ -2003,6 +2810,59 @@ void audioEngine_noteOn( Note *note )
 	m_midiNoteQueue.push_back( note );
 }
 
+void audioEngine_scheduleNotes( const std::vector<Hydrogen::ScheduledNote>& notes, bool bTicks )
+{
+	if ( ( m_audioEngineState != STATE_READY )
+		 && ( m_audioEngineState != STATE_PLAYING ) ) {
+		___ERRORLOG( "Error the audio engine is not in READY state" );
+		return;
+	}
+
+	// Commands are applied before audioEngine_process_transport()
+	// does update the position for the current cycle. While
+	// playing the transport was already advanced at the end of
+	// the previous one.
+	long long nBase;
+	if ( m_audioEngineState == STATE_PLAYING ) {
+		nBase = m_pAudioDriver->m_transport.m_nFrames;
+	} else {
+		nBase = static_cast<long long>( m_nRealtimeFrames ) + m_nBufferSize;
+	}
+	const TransportInfo& transport = m_pAudioDriver->m_transport;
+	InstrumentList* pInstrumentList = Hydrogen::get_instance()->getSong()->getInstrumentList();
+
+	for ( const auto& note : notes ) {
+		// The instrument list might have changed since the notes
+		// were validated.
+		if ( ! pInstrumentList->is_valid_index( note.nInstrument ) ) {
+			continue;
+		}
+		double fOffset = bTicks ?
+			note.fOffset * TickTime::toFrames( transport.m_nTickSize ) : note.fOffset;
+		long long nFrame = nBase + std::llround( fOffset );
+		int nColumn = static_cast<int>( transport.tickAtFrame( nFrame ) );
+		int nSubTickFrames = static_cast<int>( nFrame - transport.frameAtTick( nColumn ) );
+
+		Note* pNote = new ( NotePool::get_instance() ) Note( pInstrumentList->get( note.nInstrument ),
+															 nColumn, note.fVelocity, 1.0, 1.0,
+															 -1, note.fPitch );
+		pNote->set_humanize_delay( nSubTickFrames );
+		m_liveNoteQueue.push_back( pNote );
+	}
+}
+
+void audioEngine_liveNoteOn( Note *note )
+{
+	if ( ( m_audioEngineState != STATE_READY )
+		 && ( m_audioEngineState != STATE_PLAYING ) ) {
+		___ERRORLOG( "Error the audio engine is not in READY state" );
+		delete note;
+		return;
+	}
+
+	m_liveNoteQueue.push_back( note );
+}
+
 /**
  * Create an audio driver using audioEngine_process() as its argument
  * based on the provided choice and calling their _init()_ function to
@@ -2064,6 +2924,13 @@ AudioOutput* createDriver( const QString& sDriver )
 		}
 	}
 	//#endif
+	else if ( sDriver == "PipeWire" ) {
+		pDriver = new PipeWireDriver( audioEngine_process );
+		if ( pDriver->class_name() == NullDriver::class_name() ) {
+			delete pDriver;
+			pDriver = nullptr;
+		}
+	}
 	else if ( sDriver == "PulseAudio" ) {
 		pDriver = new PulseAudioDriver( audioEngine_process );
 		if ( pDriver->class_name() == NullDriver::class_name() ) {
@@ -2074,6 +2941,9 @@ AudioOutput* createDriver( const QString& sDriver )
 	else if ( sDriver == "Fake" ) {
 		___WARNINGLOG( "*** Using FAKE audio driver ***" );
 		pDriver = new FakeDriver( audioEngine_process );
+	}
+	else if ( sDriver == "Plugin" ) {
+		pDriver = new PluginDriver( audioEngine_process );
 	} else {
 		___ERRORLOG( "Unknown driver " + sDriver );
 		audioEngine_raiseError( Hydrogen::UNKNOWN_DRIVER );
@@ -2127,14 +2997,16 @@ void audioEngine_startAudioDrivers()
 				if ( ( m_pAudioDriver = createDriver( "CoreAudio" ) ) == nullptr ) {
 					if ( ( m_pAudioDriver = createDriver( "PortAudio" ) ) == nullptr ) {
 						if ( ( m_pAudioDriver = createDriver( "OSS" ) ) == nullptr ) {
-							if ( ( m_pAudioDriver = createDriver( "PulseAudio" ) ) == nullptr ) {
-								audioEngine_raiseError( Hydrogen::ERROR_STARTING_DRIVER );
-								___ERRORLOG( "Error starting audio driver" );
-								___ERRORLOG( "Using the NULL output audio driver" );
-
-								// use the NULL output driver
-								m_pAudioDriver = new NullDriver( audioEngine_process );
-								m_pAudioDriver->init( 0 );
+							if ( ( m_pAudioDriver = createDriver( "PipeWire" ) ) == nullptr ) {
+								if ( ( m_pAudioDriver = createDriver( "PulseAudio" ) ) == nullptr ) {
+									audioEngine_raiseError( Hydrogen::ERROR_STARTING_DRIVER );
+									___ERRORLOG( "Error starting audio driver" );
+									___ERRORLOG( "Using the NULL output audio driver" );
+
+									// use the NULL output driver
+									m_pAudioDriver = new NullDriver( audioEngine_process );
+									m_pAudioDriver->init( 0 );
+								}
 							}
 						}
 					}
@@ -2208,6 +3080,14 @@ void audioEngine_startAudioDrivers()
 		m_pMidiDriver = jackMidiDriver;
 		m_pMidiDriver->open();
 		m_pMidiDriver->setActive( true );
+#endif
+	} else if ( preferencesMng->m_sMidiDriver == "PipeWire" ) {
+#ifdef H2CORE_HAVE_PIPEWIRE
+		// Input only. There is no MIDI output driver.
+		PipeWireMidiDriver *pipeWireMidiDriver = new PipeWireMidiDriver();
+		m_pMidiDriver = pipeWireMidiDriver;
+		m_pMidiDriver->open();
+		m_pMidiDriver->setActive( true );
 #endif
 	}
 
@@ -2254,11 +3134,14 @@ void audioEngine_startAudioDrivers()
 			___ERRORLOG( "m_pMainBuffer_R == NULL" );
 		}
 
-#ifdef H2CORE_HAVE_JACK
 		audioEngine_renameJackPorts( pSong );
-#endif
 
 		audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
+		audioEngine_setupMetronome();
+
+		// Applies to all samples loaded from now on.
+		Sample::set_resample_rate( Preferences::get_instance()->m_bResampleSamples ?
+								   m_pAudioDriver->getSampleRate() : 0 );
 	}
 
 
@@ -2287,6 +3170,11 @@ void audioEngine_stopAudioDrivers()
 
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
+	// Apply all commands posted while the drivers were still
+	// running. New ones will be handled directly by
+	// AudioEngine::postCommand().
+	AudioEngine::get_instance()->processCommands();
+
 	// delete MIDI driver
 	if ( m_pMidiDriver ) {
 		m_pMidiDriver->close();
@@ -2332,7 +3220,7 @@ void audioEngine_restartAudioDrivers()
 Hydrogen* Hydrogen::__instance = nullptr;
 const char* Hydrogen::__class_name = "Hydrogen";
 
-Hydrogen::Hydrogen()
+Hydrogen::Hydrogen( const QString& sStartupSong )
 	: Object( __class_name )
 {
 	if ( __instance ) {
@@ -2344,8 +3232,11 @@ Hydrogen::Hydrogen()
 
 	__song = nullptr;
 	m_pNextSong = nullptr;
+	m_pDrumkitSwap = nullptr;
 
 	m_bExportSessionIsActive = false;
+	m_bFreewheelExport = false;
+	m_nExportSampleDepth = 16;
 	m_pTimeline = new Timeline();
 	m_pCoreActionController = new CoreActionController();
 	m_GUIState = GUIState::unavailable;
@@ -2353,7 +3244,24 @@ Hydrogen::Hydrogen()
 
 	initBeatcounter();
 	InstrumentComponent::setMaxLayers( Preferences::get_instance()->getMaxLayers() );
+
+	// The logger is started before the Preferences are loaded.
+	Threads::configureThread( logger()->thread(), Threads::Role::Background, "logger" );
+	Threads::lockMemory();
+
+	QElapsedTimer timer;
+	timer.start();
 	audioEngine_init();
+	INFOLOG( QString( "[Startup] audio engine initialized in %1 ms" )
+			 .arg( timer.elapsed() ) );
+
+	// The samples are decoded while the (potentially slow) audio and
+	// MIDI drivers are started and the GUI is set up. The LADSPA
+	// plugins are scanned concurrently as well, see
+	// Effects::Effects().
+	if ( ! sStartupSong.isEmpty() ) {
+		m_startupPreloader.start( sStartupSong );
+	}
 
 	// Prevent double creation caused by calls from MIDI thread
 	__instance = this;
@@ -2373,7 +3281,10 @@ Hydrogen::Hydrogen()
 	// and NsmClient instance and prior to the creation of the GUI. If
 	// absent, the starting of the audio driver will be triggered.
 	if ( ! getenv( "NSM_URL" ) ){
+		timer.restart();
 		audioEngine_startAudioDrivers();
+		INFOLOG( QString( "[Startup] drivers started in %1 ms" )
+				 .arg( timer.elapsed() ) );
 	}
 	
 	for(int i = 0; i< MAX_INSTRUMENTS; i++){
@@ -2383,6 +3294,19 @@ Hydrogen::Hydrogen()
 	if ( Preferences::get_instance()->getOscServerEnabled() ) {
 		toggleOscServer( true );
 	}
+
+	if ( Preferences::get_instance()->m_bLinkEnabled ) {
+		AudioEngine::get_instance()->get_link_transport()->setEnabled(
+			true, getSong() != nullptr ? getSong()->getBpm() : 120 );
+	}
+
+	if ( Preferences::get_instance()->m_bNetworkStems ) {
+		getCoreActionController()->activateNetworkStems( true );
+	}
+
+	if ( Preferences::get_instance()->m_bMetrics ) {
+		getCoreActionController()->activateMetrics( true );
+	}
 }
 
 Hydrogen::~Hydrogen()
@@ -2415,7 +3339,7 @@ Hydrogen::~Hydrogen()
 	__instance = nullptr;
 }
 
-void Hydrogen::create_instance()
+void Hydrogen::create_instance( const QString& sStartupSong )
 {
 	// Create all the other instances that we need
 	// ....and in the right order
@@ -2423,6 +3347,10 @@ void Hydrogen::create_instance()
 	MidiMap::create_instance();
 	Preferences::create_instance();
 	EventQueue::create_instance();
+	// Besides the voices rendered by the Sampler the pool has to hold
+	// the notes waiting in the song and MIDI note queues.
+	NotePool::create_instance( 4 * std::max( Preferences::get_instance()->m_nMaxNotes,
+											 static_cast<unsigned>( MAX_NOTES ) ) );
 	MidiActionManager::create_instance();
 
 #ifdef H2CORE_HAVE_OSC
@@ -2431,7 +3359,7 @@ void Hydrogen::create_instance()
 #endif
 
 	if ( __instance == nullptr ) {
-		__instance = new Hydrogen;
+		__instance = new Hydrogen( sStartupSong );
 	}
 
 	// See audioEngine_init() for:
@@ -2526,6 +3454,9 @@ void Hydrogen::setSong( Song *pSong )
 	// Update the audio engine to work with the new song.
 	audioEngine_setSong( pSong );
 
+	// The layers of the Song hold the samples by now.
+	m_startupPreloader.clear();
+
 	// load new playback track information
 	AudioEngine::get_instance()->get_sampler()->reinitializePlaybackTrack();
 
@@ -2545,8 +3476,13 @@ void Hydrogen::setSong( Song *pSong )
 /* Mean: remove current song from memory */
 void Hydrogen::removeSong()
 {
+	// A pending drumkit swap does refer to the current song.
+	joinDrumkitSwap();
+
 	__song = nullptr;
 	audioEngine_removeSong();
+	// The renders belong to the instruments of the song.
+	InstrumentFreezer::get_instance()->clear();
 }
 
 void Hydrogen::midi_noteOn( Note *note )
@@ -2561,7 +3497,9 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 								float	pitch,
 								bool	noteOff,
 								bool	forcePlay,
-								int		msg1 )
+								int		msg1,
+								int64_t	nTimestamp,
+								LatencyProbe::Source latencySource )
 {
 	UNUSED( pitch );
 
@@ -2673,7 +3611,26 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 		}
 	}
 
-	nRealColumn = getRealtimeTickPosition();
+	// Place the note at the frame corresponding to the time the
+	// event was received instead of the time of this call. The part
+	// not covered by a whole tick is passed as humanize delay to
+	// render the note with a sub-buffer offset. Like in
+	// getRealtimeTickPosition() a buffer is added for jitter
+	// resistance.
+	if ( nTimestamp <= 0 ) {
+		nTimestamp = rtclock_now_ns();
+		latencySource = LatencyProbe::SOURCE_NONE;
+	}
+	long long nRealFrame = static_cast<long long>( getRealtimeFrames() ) +
+		m_pAudioDriver->getBufferSize() +
+		static_cast<long long>( ( nTimestamp - m_nCurrentTickTimeNs ) *
+								static_cast<double>( m_pAudioDriver->getSampleRate() ) / 1e9 );
+	if ( nRealFrame < 0 ) {
+		nRealFrame = 0;
+	}
+	nRealColumn = static_cast<unsigned int>( m_pAudioDriver->m_transport.tickAtFrame( nRealFrame ) );
+	int nSubTickFrames = static_cast<int>(
+		TickTime::framesIntoTick( nRealFrame, m_pAudioDriver->m_transport.m_nTickSize ) );
 
 	if ( currentPattern && pPreferences->getQuantizeEvents() ) {
 		// quantize it to scale
@@ -2693,6 +3650,11 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 		//getlookuptable index = instrument+36, ziel wert = der entprechende wert -36
 		instrRef = pSong->getInstrumentList()->get( m_nInstrumentLookupTable[ instrument ] );
 	}
+	if ( instrRef != nullptr && DeferredSampleLoader::get_instance() != nullptr ) {
+		// Samples not decoded yet because the song does not use
+		// them are needed now.
+		DeferredSampleLoader::get_instance()->prioritize( instrRef );
+	}
 
 	if ( currentPattern && ( getState() == STATE_PLAYING ) ) {
 		assert( currentPattern );
@@ -2721,10 +3683,14 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 				noteAction.b_isInstrumentMode = false;
 			}
 
-			Note* pNoteold = currentPattern->find_note( noteAction.m_column, -1, instrRef, noteAction.nk_noteKeyVal, noteAction.no_octaveKeyVal );
-			noteAction.b_noteExist = ( pNoteold ) ? true : false;
+			// Whether the note replaces an existing one is
+			// determined by the GUI when merging it into the
+			// pattern.
+			noteAction.b_noteExist = false;
 
-			EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+			if ( ! EventQueue::get_instance()->push_recorded_note( noteAction ) ) {
+				ERRORLOG( "Recorded note dropped" );
+			}
 
 			// hear note if its not in the future
 			if ( pPreferences->getHearNewNotes() && position <= getTickPosition() ) {
@@ -2737,12 +3703,16 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 
 	if ( !pPreferences->__playselectedinstrument ) {
 		if ( hearnote && instrRef ) {
-			Note *pNote2 = new Note( instrRef, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
-			midi_noteOn( pNote2 );
+			Note *pNote2 = new ( NotePool::get_instance() ) Note( instrRef, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
+			pNote2->set_humanize_delay( nSubTickFrames );
+			pNote2->set_trigger( nTimestamp, latencySource );
+			audioEngine_liveNoteOn( pNote2 );
 		}
 	} else if ( hearnote  ) {
 		Instrument* pInstr = pSong->getInstrumentList()->get( getSelectedInstrumentNumber() );
-		Note *pNote2 = new Note( pInstr, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
+		Note *pNote2 = new ( NotePool::get_instance() ) Note( pInstr, nRealColumn, velocity, pan_L, pan_R, -1, 0 );
+		pNote2->set_humanize_delay( nSubTickFrames );
+		pNote2->set_trigger( nTimestamp, latencySource );
 
 		int divider = msg1 / 12;
 		Note::Octave octave = (Note::Octave)(divider -3);
@@ -2750,12 +3720,54 @@ void Hydrogen::addRealtimeNote(	int		instrument,
 
 		//ERRORLOG( QString( "octave: %1, note: %2, instrument %3" ).arg( octave ).arg(notehigh).arg(instrument));
 		pNote2->set_midi_info( notehigh, octave, msg1 );
-		midi_noteOn( pNote2 );
+		audioEngine_liveNoteOn( pNote2 );
 	}
 
 	AudioEngine::get_instance()->unlock(); // unlock the audio engine
 }
 
+bool Hydrogen::scheduleNotes( std::vector<ScheduledNote> notes, bool bTicks )
+{
+	Song* pSong = getSong();
+	if ( pSong == nullptr || m_pAudioDriver == nullptr ) {
+		ERRORLOG( "No song or audio driver present" );
+		return false;
+	}
+	if ( notes.empty() ) {
+		return true;
+	}
+
+	// Only used for validation. The notes are placed using the
+	// tick size of the cycle applying the command.
+	float fMaxOffset = fMaxScheduledOffset * m_pAudioDriver->getSampleRate();
+	if ( bTicks ) {
+		fMaxOffset /= m_pAudioDriver->m_transport.m_fTickSize;
+	}
+	int nInstruments = pSong->getInstrumentList()->size();
+
+	for ( const auto& note : notes ) {
+		if ( note.nInstrument < 0 || note.nInstrument >= nInstruments ||
+			 !( note.fVelocity >= VELOCITY_MIN && note.fVelocity <= VELOCITY_MAX ) ||
+			 !( std::fabs( note.fPitch ) <= fMaxScheduledPitch ) ||
+			 !( note.fOffset >= 0 && note.fOffset <= fMaxOffset ) ) {
+			ERRORLOG( QString( "Invalid note [instrument: %1, velocity: %2, pitch: %3, offset: %4]. Dropping all %5 notes." )
+					  .arg( note.nInstrument ).arg( note.fVelocity )
+					  .arg( note.fPitch ).arg( note.fOffset )
+					  .arg( notes.size() ) );
+			return false;
+		}
+	}
+
+	// The batch is released by the thread overwriting the slot of
+	// the command, not by the realtime thread.
+	auto pNotes = std::make_shared<const std::vector<ScheduledNote>>( std::move( notes ) );
+	AudioEngine::get_instance()->postCommand( [pNotes, bTicks]() {
+		audioEngine_scheduleNotes( *pNotes, bTicks );
+	});
+
+	return true;
+}
+
 float Hydrogen::getMasterPeak_L()
 {
 	return m_fMasterPeak_L;
@@ -2775,27 +3787,16 @@ unsigned long Hydrogen::getRealtimeTickPosition()
 {
 	// Get the realtime transport position in frames and convert
 	// it into ticks.
-	unsigned int initTick = ( unsigned int )( getRealtimeFrames() /
-						  m_pAudioDriver->m_transport.m_fTickSize );
+	unsigned int initTick = static_cast<unsigned int>(
+		m_pAudioDriver->m_transport.tickAtFrame( getRealtimeFrames() ) );
 	unsigned long retTick;
 
-	struct timeval currtime;
-	struct timeval deltatime;
-
 	double sampleRate = ( double ) m_pAudioDriver->getSampleRate();
-	gettimeofday ( &currtime, nullptr );
-
-	// Definition macro from timehelper.h calculating the time
-	// difference between `currtime` and `m_currentTickTime`
-	// (`currtime`-`m_currentTickTime`) and storing the results in
-	// `deltatime`. It uses both the .tv_sec (seconds) and
-	// .tv_usec (microseconds) members of the timeval struct.
-	timersub( &currtime, &m_currentTickTime, &deltatime );
 
-	// add a buffers worth for jitter resistance
+	// The monotonic clock is not affected by adjustments of the
+	// system time. Add a buffers worth for jitter resistance.
 	double deltaSec =
-			( double ) deltatime.tv_sec
-			+ ( deltatime.tv_usec / 1000000.0 )
+			( rtclock_now_ns() - m_nCurrentTickTimeNs ) / 1e9
 			+ ( m_pAudioDriver->getBufferSize() / ( double )sampleRate );
 
 	retTick = ( unsigned long ) ( ( sampleRate / ( double ) m_pAudioDriver->m_transport.m_fTickSize ) * deltaSec );
@@ -2817,6 +3818,66 @@ PatternList * Hydrogen::getNextPatterns()
 	return m_pNextPatterns;
 }
 
+bool Hydrogen::getPlayheadPosition( int* pColumn, double* pTick, int* pLength ) const
+{
+	PlaybackClock::Position position;
+	if ( ! AudioEngine::get_instance()->get_playback_clock()->get( rtclock_now_ns(),
+																	&position ) ) {
+		return false;
+	}
+	Song* pSong = __song;
+	if ( pSong == nullptr ) {
+		return false;
+	}
+
+	if ( pSong->getMode() == Song::SONG_MODE ) {
+		const int nSongLength = pSong->lengthInTicks();
+		if ( nSongLength <= 0 ) {
+			return false;
+		}
+		double fTick = position.fTick;
+		if ( pSong->getIsLoopEnabled() ) {
+			fTick = std::fmod( fTick, static_cast<double>( nSongLength ) );
+		}
+		int nColumnStart;
+		const int nColumn = pSong->findColumn( static_cast<long>( fTick ), &nColumnStart );
+		if ( nColumn < 0 ) {
+			return false;
+		}
+		*pColumn = nColumn;
+		*pTick = fTick - nColumnStart;
+		*pLength = pSong->getColumnStartTick( nColumn + 1 ) - nColumnStart;
+	} else {
+		const int nSize = position.nPatternSize > 0 ? position.nPatternSize : MAX_NOTES;
+		double fTick = std::fmod( position.fTick - position.nPatternStartTick,
+								  static_cast<double>( nSize ) );
+		if ( fTick < 0 ) {
+			fTick += nSize;
+		}
+		*pColumn = -1;
+		*pTick = fTick;
+		*pLength = nSize;
+	}
+	return true;
+}
+
+void Hydrogen::getPlaybackPatterns( std::vector<const Pattern*>* pPlaying,
+									std::vector<const Pattern*>* pNext )
+{
+	if ( AudioEngine::get_instance()->get_playback_snapshot()->get( pPlaying, pNext ) ) {
+		return;
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	for ( int ii = 0; ii < m_pPlayingPatterns->size(); ++ii ) {
+		pPlaying->push_back( m_pPlayingPatterns->get( ii ) );
+	}
+	for ( int ii = 0; ii < m_pNextPatterns->size(); ++ii ) {
+		pNext->push_back( m_pNextPatterns->get( ii ) );
+	}
+	AudioEngine::get_instance()->unlock();
+}
+
 void Hydrogen::sequencer_setNextPattern( int pos )
 {
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
@@ -2847,6 +3908,8 @@ void Hydrogen::sequencer_setNextPattern( int pos )
 		m_pNextPatterns->clear();
 	}
 
+	audioEngine_publishPlaybackSnapshot();
+
 	AudioEngine::get_instance()->unlock();
 }
 
@@ -2874,6 +3937,8 @@ void Hydrogen::sequencer_setOnlyNextPattern( int pos )
 		ERRORLOG( "can't set next pattern in song mode" );
 		m_pNextPatterns->clear();
 	}
+
+	audioEngine_publishPlaybackSnapshot();
 	
 	AudioEngine::get_instance()->unlock();
 }
@@ -2915,22 +3980,114 @@ void Hydrogen::restartDrivers()
 	audioEngine_restartAudioDrivers();
 }
 
-void Hydrogen::startExportSession(int sampleRate, int sampleDepth )
+void Hydrogen::prepareExportSession()
 {
 	if ( getState() == STATE_PLAYING ) {
 		sequencer_stop();
 	}
-	
-	unsigned nSamplerate = (unsigned) sampleRate;
-	
+
 	AudioEngine::get_instance()->get_sampler()->stopPlayingNotes();
 
+	// Layers not decoded yet would be silent in the export.
+	if ( DeferredSampleLoader::get_instance() != nullptr ) {
+		DeferredSampleLoader::get_instance()->wait();
+	}
+
 	Song* pSong = getSong();
 	
 	m_oldEngineMode = pSong->getMode();
 	m_bOldLoopEnabled = pSong->getIsLoopEnabled();
 
 	pSong->setMode( Song::SONG_MODE );
+}
+
+/**
+ * Rewinds the song and prepares the audio engine to be run by the
+ * DiskWriterDriver or OfflineDriver #m_pAudioDriver, which was not
+ * connected yet.
+ */
+static int audioEngine_prepareExportDriver()
+{
+	m_pAudioDriver->m_transport.m_nFrames = 0; // reset total frames
+	// TODO: not -1 instead?
+	m_nSongPos = 0;
+	m_nPatternTickPosition = 0;
+	m_audioEngineState = STATE_PLAYING;
+	m_nPatternStartTick = -1;
+	m_nExportResumeTick = -1;
+	audioEngine_seedRandom( Hydrogen::get_instance()->getSong() );
+
+	Preferences *pPref = Preferences::get_instance();
+
+	int res = m_pAudioDriver->init( pPref->m_nBufferSize );
+
+	m_pMainBuffer_L = m_pAudioDriver->getOut_L();
+	m_pMainBuffer_R = m_pAudioDriver->getOut_R();
+
+	audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
+	audioEngine_setupMetronome();
+
+	audioEngine_seek( 0, false );
+
+	return res;
+}
+
+/**
+ * \return Sample rate shared by most of the layers used in @a
+ * pSong or 0 if there are none.
+ */
+static unsigned audioEngine_getNativeSampleRate( Song* pSong )
+{
+	std::map<unsigned, int> layersPerRate;
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		for ( const auto& pComponent : *pInstrumentList->get( ii )->get_components() ) {
+			for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+				InstrumentLayer* pLayer = pComponent->get_layer( nLayer );
+				if ( pLayer != nullptr && pLayer->get_sample() != nullptr ) {
+					++layersPerRate[ pLayer->get_sample()->get_sample_rate() ];
+				}
+			}
+		}
+	}
+
+	unsigned nRate = 0;
+	int nLayers = 0;
+	for ( const auto& entry : layersPerRate ) {
+		if ( entry.second > nLayers ) {
+			nRate = entry.first;
+			nLayers = entry.second;
+		}
+	}
+	return nRate;
+}
+
+void Hydrogen::startExportSession(int sampleRate, int sampleDepth )
+{
+	unsigned nSamplerate = (unsigned) sampleRate;
+
+	ExportWriter::clearAnalyses();
+	prepareExportSession();
+	Song* pSong = getSong();
+
+#ifdef H2CORE_HAVE_JACK
+	if ( Preferences::get_instance()->m_bJackFreewheelExport &&
+		 dynamic_cast<JackAudioDriver*>( m_pAudioDriver ) != nullptr ) {
+		// The JACK driver keeps running. Instead of a separate
+		// thread iterating the song, the end of the song detected
+		// by the audio engine terminates the export.
+		if ( m_pAudioDriver->getSampleRate() != nSamplerate ) {
+			WARNINGLOG( QString( "Exporting at the sample rate of the JACK server [%1] instead of [%2]" )
+						.arg( m_pAudioDriver->getSampleRate() ).arg( nSamplerate ) );
+		}
+		pSong->setIsLoopEnabled( false );
+		m_nExportSampleDepth = sampleDepth;
+		m_bFreewheelExport = true;
+		m_bExportSessionIsActive = true;
+		return;
+	}
+#endif
+
 	pSong->setIsLoopEnabled( true );
 	
 	/*
@@ -2940,7 +4097,21 @@ void Hydrogen::startExportSession(int sampleRate, int sampleDepth )
 	 */
 	audioEngine_stopAudioDrivers();
 
-	m_pAudioDriver = new DiskWriterDriver( audioEngine_process, nSamplerate, sampleDepth );
+	// Render at the rate of the samples and let the writers
+	// convert the result once.
+	unsigned nRenderSamplerate = nSamplerate;
+	if ( Preferences::get_instance()->m_bExportNativeRate ) {
+		unsigned nNativeSamplerate = audioEngine_getNativeSampleRate( pSong );
+		if ( nNativeSamplerate != 0 && nNativeSamplerate != nSamplerate &&
+			 Resampler::isSupported( nNativeSamplerate, nSamplerate ) ) {
+			INFOLOG( QString( "Rendering at %1 instead of %2" )
+					 .arg( nNativeSamplerate ).arg( nSamplerate ) );
+			nRenderSamplerate = nNativeSamplerate;
+		}
+	}
+
+	m_pAudioDriver = new DiskWriterDriver( audioEngine_process, nRenderSamplerate,
+										   sampleDepth, nSamplerate );
 	
 	m_bExportSessionIsActive = true;
 }
@@ -2948,6 +4119,15 @@ void Hydrogen::startExportSession(int sampleRate, int sampleDepth )
 void Hydrogen::stopExportSession()
 {
 	m_bExportSessionIsActive = false;
+
+	if ( m_bFreewheelExport ) {
+		m_bFreewheelExport = false;
+
+		Song* pSong = getSong();
+		pSong->setMode( m_oldEngineMode );
+		pSong->setIsLoopEnabled( m_bOldLoopEnabled );
+		return;
+	}
 	
  	audioEngine_stopAudioDrivers();
 	
@@ -2970,27 +4150,41 @@ void Hydrogen::stopExportSession()
 /// Export a song to a wav file
 void Hydrogen::startExportSong( const QString& filename)
 {
-	// reset
-	m_pAudioDriver->m_transport.m_nFrames = 0; // reset total frames
-	// TODO: not -1 instead?
-	m_nSongPos = 0;
-	m_nPatternTickPosition = 0;
-	m_audioEngineState = STATE_PLAYING;
-	m_nPatternStartTick = -1;
+#ifdef H2CORE_HAVE_JACK
+	if ( m_bFreewheelExport ) {
+		JackAudioDriver* pJackAudioDriver = dynamic_cast<JackAudioDriver*>( m_pAudioDriver );
+		if ( pJackAudioDriver == nullptr ) {
+			ERRORLOG( "JACK driver is not available anymore" );
+			return;
+		}
 
-	Preferences *pPref = Preferences::get_instance();
+		ExportWriter* pExportWriter = new ExportWriter();
+		if ( ! pExportWriter->start( filename, m_pAudioDriver->getSampleRate(),
+									 m_nExportSampleDepth, true, 0, true ) ) {
+			ERRORLOG( QString( "Unable to export to [%1]" ).arg( filename ) );
+			delete pExportWriter;
+			return;
+		}
 
-	int res = m_pAudioDriver->init( pPref->m_nBufferSize );
-	if ( res != 0 ) {
-		ERRORLOG( "Error starting disk writer driver [DiskWriterDriver::init()]" );
-	}
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
 
-	m_pMainBuffer_L = m_pAudioDriver->getOut_L();
-	m_pMainBuffer_R = m_pAudioDriver->getOut_R();
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		m_pExportWriter = pExportWriter;
+		m_nExportProgress = 0;
+		audioEngine_seedRandom( getSong() );
+		AudioEngine::get_instance()->unlock();
 
-	audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
+		setPatternPos( 0 );
+		pJackAudioDriver->setFreewheel( true );
+		sequencer_play();
+		return;
+	}
+#endif
 
-	audioEngine_seek( 0, false );
+	int res = audioEngine_prepareExportDriver();
+	if ( res != 0 ) {
+		ERRORLOG( "Error starting disk writer driver [DiskWriterDriver::init()]" );
+	}
 
 	DiskWriterDriver* pDiskWriterDriver = (DiskWriterDriver*) m_pAudioDriver;
 	pDiskWriterDriver->setFileName( filename );
@@ -3001,8 +4195,114 @@ void Hydrogen::startExportSong( const QString& filename)
 	}
 }
 
+OfflineDriver* Hydrogen::startOfflineRender( unsigned nSampleRate )
+{
+	prepareExportSession();
+	Song* pSong = getSong();
+	// The audio engine itself detects the end of the song.
+	pSong->setIsLoopEnabled( false );
+
+	audioEngine_stopAudioDrivers();
+
+	OfflineDriver* pDriver = new OfflineDriver( audioEngine_process, nSampleRate );
+	m_pAudioDriver = pDriver;
+	m_bExportSessionIsActive = true;
+
+	if ( audioEngine_prepareExportDriver() != 0 ||
+		 m_pAudioDriver->connect() != 0 ) {
+		ERRORLOG( "Error starting offline driver" );
+		stopExportSession();
+		return nullptr;
+	}
+	m_pAudioDriver->setBpm( pSong->getBpm() );
+
+	return pDriver;
+}
+
+bool Hydrogen::restartOfflineRender()
+{
+	if ( m_pAudioDriver == nullptr ||
+		 m_pAudioDriver->class_name() != OfflineDriver::class_name() ) {
+		ERRORLOG( "No offline render running" );
+		return false;
+	}
+
+	auto pAudioEngine = AudioEngine::get_instance();
+	pAudioEngine->lock( RIGHT_HERE );
+	// The seek to the beginning does not touch the queue if the song
+	// ended at the very same position.
+	audioEngine_clearNoteQueue();
+	pAudioEngine->unlock();
+
+	m_pAudioDriver->disconnect();
+	if ( audioEngine_prepareExportDriver() != 0 ||
+		 m_pAudioDriver->connect() != 0 ) {
+		ERRORLOG( "Error restarting offline driver" );
+		return false;
+	}
+	m_pAudioDriver->setBpm( getSong()->getBpm() );
+
+	return true;
+}
+
+void Hydrogen::addExportStem( Instrument* pInstrument, const QString& sFilename )
+{
+	if ( m_pAudioDriver == nullptr ||
+		 m_pAudioDriver->class_name() != DiskWriterDriver::class_name() ) {
+		ERRORLOG( "Stems can only be exported using the DiskWriterDriver" );
+		return;
+	}
+
+	static_cast<DiskWriterDriver*>(m_pAudioDriver)->addStem( pInstrument, sFilename );
+}
+
+void Hydrogen::addExportFile( const QString& sFilename )
+{
+	if ( m_pAudioDriver == nullptr ||
+		 m_pAudioDriver->class_name() != DiskWriterDriver::class_name() ) {
+		ERRORLOG( "Additional export files are only supported by the DiskWriterDriver" );
+		return;
+	}
+
+	static_cast<DiskWriterDriver*>(m_pAudioDriver)->addFileName( sFilename );
+}
+
+void Hydrogen::skipExport( unsigned long nFrame, long nTick )
+{
+	auto pAudioEngine = AudioEngine::get_instance();
+
+	pAudioEngine->lock( RIGHT_HERE );
+	audioEngine_clearNoteQueue();
+	pAudioEngine->locate( nFrame );
+	m_nExportResumeTick = nTick;
+	pAudioEngine->unlock();
+}
+
 void Hydrogen::stopExportSong()
 {
+#ifdef H2CORE_HAVE_JACK
+	if ( m_bFreewheelExport ) {
+		sequencer_stop();
+
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		ExportWriter* pExportWriter = m_pExportWriter;
+		m_pExportWriter = nullptr;
+		AudioEngine::get_instance()->unlock();
+
+		JackAudioDriver* pJackAudioDriver = dynamic_cast<JackAudioDriver*>( m_pAudioDriver );
+		if ( pJackAudioDriver != nullptr ) {
+			pJackAudioDriver->setFreewheel( false );
+		}
+
+		if ( pExportWriter != nullptr ) {
+			pExportWriter->stop();
+			delete pExportWriter;
+		}
+		AudioEngine::get_instance()->get_sampler()->stopPlayingNotes();
+		return;
+	}
+#endif
+
 	if ( m_pAudioDriver->class_name() != DiskWriterDriver::class_name() ) {
 		return;
 	}
@@ -3055,6 +4355,8 @@ void Hydrogen::setCurrentPatternList( PatternList *pPatternList )
 	}
 	m_pPlayingPatterns = pPatternList;
 	pPatternList->setNeedsLock( true );
+	Pattern::next_generation();
+	audioEngine_publishPlaybackSnapshot();
 	EventQueue::get_instance()->push_event( EVENT_PATTERN_CHANGED, -1 );
 	AudioEngine::get_instance()->unlock();
 }
@@ -3080,6 +4382,10 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 {
 	assert ( pDrumkitInfo );
 
+	// Loading a drumkit directly overrules the one prepared in the
+	// background.
+	joinDrumkitSwap();
+
 	int old_ae_state = m_audioEngineState;
 	if( m_audioEngineState >= STATE_READY ) {
 		m_audioEngineState = STATE_PREPARED;
@@ -3142,6 +4448,12 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 	int instrumentDiff =  pSongInstrList->size() - pDrumkitInstrList->size();
 	int nMaxID = -1;
 	
+	// Decode the samples of all instruments at once before
+	// replacing the instruments of the song one by one.
+	SampleLoader sampleLoader;
+	sampleLoader.add( pDrumkitInfo );
+	sampleLoader.run();
+
 	for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
 		Instrument *pInstr = nullptr;
 		if ( nInstr < pSongInstrList->size() ) {
@@ -3173,7 +4485,7 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 		nMaxID = std::max( nID, nMaxID );
 
 		// Moved code from here right into the Instrument class - Jakob Lund.
-		pInstr->load_from( pDrumkitInfo, pNewInstr );
+		pInstr->load_from( pDrumkitInfo, pNewInstr, true, &sampleLoader );
 		pInstr->set_id( nID );
 	}
 
@@ -3208,6 +4520,268 @@ int Hydrogen::loadDrumkit( Drumkit *pDrumkitInfo, bool conditional )
 	return 0;	//ok
 }
 
+int Hydrogen::prepareDrumkit( Drumkit* pDrumkitInfo, bool bConditional )
+{
+	assert( pDrumkitInfo );
+
+	if ( m_pDrumkitSwap != nullptr ) {
+		int nState = m_pDrumkitSwap->nState.load( std::memory_order_acquire );
+		if ( nState == PreparedDrumkit::Loading || nState == PreparedDrumkit::Prepared ) {
+			ERRORLOG( QString( "Unable to prepare [%1]. Drumkit [%2] is still waiting to be swapped in." )
+					  .arg( pDrumkitInfo->get_name() )
+					  .arg( m_pDrumkitSwap->sDrumkitName ) );
+			return -1;
+		}
+	}
+	joinDrumkitSwap();
+
+	INFOLOG( QString( "Preparing drumkit [%1]" ).arg( pDrumkitInfo->get_name() ) );
+
+	PreparedDrumkit* pPrepared = new PreparedDrumkit;
+	pPrepared->pDrumkit = new Drumkit( pDrumkitInfo );
+	pPrepared->bConditional = bConditional;
+	pPrepared->sDrumkitName = pDrumkitInfo->get_name();
+	if ( pDrumkitInfo->isUserDrumkit() ) {
+		pPrepared->lookup = Filesystem::Lookup::user;
+	} else {
+		pPrepared->lookup = Filesystem::Lookup::system;
+	}
+
+	// Take a snapshot of the current instruments. The background
+	// thread must not access the Song.
+	Song* pSong = getSong();
+	InstrumentList* pSongInstrList = pSong->getInstrumentList();
+	int nDrumkitInstruments = pDrumkitInfo->get_instruments()->size();
+	pPrepared->pSong = pSong;
+	pPrepared->pSongInstrumentList = pSongInstrList;
+	for ( int nInstr = 0; nInstr < pSongInstrList->size(); ++nInstr ) {
+		Instrument* pInstr = pSongInstrList->get( nInstr );
+		pPrepared->songInstruments.push_back( pInstr );
+		pPrepared->songInstrumentIDs.push_back( pInstr->get_id() );
+		pPrepared->keepInstruments.push_back( nInstr >= nDrumkitInstruments &&
+											  bConditional &&
+											  instrumentHasNotes( pInstr ) );
+	}
+
+	m_pDrumkitSwap = pPrepared;
+	m_drumkitSwapThread = std::thread( &Hydrogen::drumkitSwapWorker, this, pPrepared );
+
+	return 0;
+}
+
+void Hydrogen::commitDrumkit( bool bAtBarBoundary )
+{
+	if ( m_pDrumkitSwap == nullptr ) {
+		ERRORLOG( "No drumkit prepared" );
+		return;
+	}
+	m_pDrumkitSwap->bAtBarBoundary.store( bAtBarBoundary, std::memory_order_relaxed );
+	m_pDrumkitSwap->bCommit.store( true, std::memory_order_release );
+}
+
+void Hydrogen::cancelDrumkit()
+{
+	if ( m_pDrumkitSwap == nullptr ) {
+		return;
+	}
+	m_pDrumkitSwap->bCancel.store( true, std::memory_order_release );
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	if ( m_pPreparedDrumkit == m_pDrumkitSwap ) {
+		m_pPreparedDrumkit = nullptr;
+		m_pDrumkitSwap->nState.store( PreparedDrumkit::Discarded, std::memory_order_release );
+		INFOLOG( QString( "Drumkit [%1] discarded" ).arg( m_pDrumkitSwap->sDrumkitName ) );
+	}
+	AudioEngine::get_instance()->unlock();
+}
+
+bool Hydrogen::isDrumkitPrepared() const
+{
+	return m_pDrumkitSwap != nullptr &&
+		m_pDrumkitSwap->nState.load( std::memory_order_acquire ) == PreparedDrumkit::Prepared;
+}
+
+void Hydrogen::drumkitSwapWorker( PreparedDrumkit* pPrepared )
+{
+	Drumkit* pDrumkit = pPrepared->pDrumkit;
+	InstrumentList* pDrumkitInstrList = pDrumkit->get_instruments();
+
+	// The EventQueue may only be fed by the GUI and the audio
+	// engine.
+	SampleLoader sampleLoader;
+	sampleLoader.add( pDrumkit );
+	sampleLoader.run( true, false );
+
+	pPrepared->pComponents = new std::vector<DrumkitComponent*>;
+	for ( const auto& pSrcComponent : *pDrumkit->get_components() ) {
+		DrumkitComponent* pNewComponent =
+			new DrumkitComponent( pSrcComponent->get_id(), pSrcComponent->get_name() );
+		pNewComponent->load_from( pSrcComponent );
+		pPrepared->pComponents->push_back( pNewComponent );
+	}
+
+	const int nSongInstruments = pPrepared->songInstruments.size();
+	const int nDrumkitInstruments = pDrumkitInstrList->size();
+	pPrepared->pInstrumentList = new InstrumentList;
+	int nMaxID = -1;
+	for ( int nInstr = 0; nInstr < nDrumkitInstruments; ++nInstr ) {
+		Instrument* pNewInstr = new Instrument();
+		pNewInstr->load_from( pDrumkit, pDrumkitInstrList->get( nInstr ), false, &sampleLoader );
+
+		// Preserve instrument IDs the same way loadDrumkit() does.
+		int nID = EMPTY_INSTR_ID;
+		if ( nInstr < nSongInstruments ) {
+			nID = pPrepared->songInstrumentIDs[ nInstr ];
+			pPrepared->replacements.push_back(
+				std::make_pair( pPrepared->songInstruments[ nInstr ], pNewInstr ) );
+		}
+		if ( nID == EMPTY_INSTR_ID ) {
+			nID = nMaxID + 1;
+		}
+		nMaxID = std::max( nID, nMaxID );
+		pNewInstr->set_id( nID );
+
+		pPrepared->pInstrumentList->add( pNewInstr );
+	}
+	for ( int nInstr = nDrumkitInstruments; nInstr < nSongInstruments; ++nInstr ) {
+		if ( pPrepared->keepInstruments[ nInstr ] ) {
+			pPrepared->pInstrumentList->add( pPrepared->songInstruments[ nInstr ] );
+		}
+	}
+	std::sort( pPrepared->replacements.begin(), pPrepared->replacements.end() );
+
+	delete pDrumkit;
+	pPrepared->pDrumkit = nullptr;
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	if ( pPrepared->bCancel.load( std::memory_order_acquire ) ) {
+		pPrepared->nState.store( PreparedDrumkit::Discarded, std::memory_order_release );
+	} else {
+		pPrepared->nState.store( PreparedDrumkit::Prepared, std::memory_order_release );
+		m_pPreparedDrumkit = pPrepared;
+	}
+	AudioEngine::get_instance()->unlock();
+	INFOLOG( QString( "Drumkit [%1] prepared" ).arg( pPrepared->sDrumkitName ) );
+
+	while ( pPrepared->nState.load( std::memory_order_acquire ) == PreparedDrumkit::Prepared ) {
+		// Without the audio engine processing there is nobody
+		// else to do the swap.
+		if ( pPrepared->bCommit.load( std::memory_order_acquire ) &&
+			 getState() < STATE_READY ) {
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			if ( m_pPreparedDrumkit == pPrepared ) {
+				audioEngine_swapDrumkit( true );
+			}
+			AudioEngine::get_instance()->unlock();
+			continue;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+
+	if ( pPrepared->nState.load( std::memory_order_acquire ) == PreparedDrumkit::Discarded ) {
+		// Nothing of the prepared drumkit made it into the Song
+		// but instruments kept from it must not be deleted.
+		for ( int nInstr = 0; nInstr < pPrepared->pInstrumentList->size(); ++nInstr ) {
+			Instrument* pInstr = pPrepared->pInstrumentList->get( nInstr );
+			if ( std::find( pPrepared->songInstruments.begin(),
+							pPrepared->songInstruments.end(),
+							pInstr ) == pPrepared->songInstruments.end() ) {
+				delete pInstr;
+			}
+		}
+		while ( pPrepared->pInstrumentList->size() > 0 ) {
+			pPrepared->pInstrumentList->del( 0 );
+		}
+	} else {
+		INFOLOG( QString( "Drumkit [%1] swapped in" ).arg( pPrepared->sDrumkitName ) );
+
+		// The previous instrument list is identical to the
+		// snapshot taken in prepareDrumkit().
+		Song* pSong = pPrepared->pSong;
+		InstrumentList* pPreviousInstrList = pPrepared->pInstrumentList;
+		for ( int nInstr = 0; nInstr < nSongInstruments; ++nInstr ) {
+			Instrument* pInstr = pPreviousInstrList->get( nInstr );
+			if ( pPrepared->keepInstruments[ nInstr ] ) {
+				continue;
+			}
+			// Instruments not replaced by the new drumkit might
+			// still be referenced by notes.
+			if ( nInstr >= nDrumkitInstruments ) {
+				pSong->purgeInstrument( pInstr );
+			}
+			pPrepared->retiredInstruments.push_back( pInstr );
+		}
+		while ( pPreviousInstrList->size() > 0 ) {
+			pPreviousInstrList->del( 0 );
+		}
+
+#ifdef H2CORE_HAVE_JACK
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		renameJackPorts( pSong );
+		AudioEngine::get_instance()->unlock();
+#endif
+
+		m_pCoreActionController->initExternalControlInterfaces();
+
+		if ( isUnderSessionManagement() ) {
+#ifdef H2CORE_HAVE_OSC
+			NsmClient::linkDrumkit( NsmClient::get_instance()->m_sSessionFolderPath.toLocal8Bit().data(), false );
+#endif
+		}
+	}
+
+	delete pPrepared->pInstrumentList;
+	pPrepared->pInstrumentList = nullptr;
+	for ( auto& pComponent : *pPrepared->pComponents ) {
+		delete pComponent;
+	}
+	delete pPrepared->pComponents;
+	pPrepared->pComponents = nullptr;
+
+	// Wait for the notes still using the previous instruments to
+	// end. Whatever is left when asked to quit is handed to the
+	// instrument death row by joinDrumkitSwap().
+	auto& retired = pPrepared->retiredInstruments;
+	while ( retired.size() > 0 ) {
+		for ( auto it = retired.begin(); it != retired.end(); ) {
+			if ( (*it)->is_queued() == 0 ) {
+				delete *it;
+				it = retired.erase( it );
+			} else {
+				++it;
+			}
+		}
+		if ( retired.size() == 0 || pPrepared->bQuit.load( std::memory_order_acquire ) ) {
+			break;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	}
+}
+
+void Hydrogen::joinDrumkitSwap()
+{
+	if ( m_pDrumkitSwap == nullptr ) {
+		return;
+	}
+
+	cancelDrumkit();
+	m_pDrumkitSwap->bQuit.store( true, std::memory_order_release );
+	if ( m_drumkitSwapThread.joinable() ) {
+		m_drumkitSwapThread.join();
+	}
+
+	for ( auto& pInstr : m_pDrumkitSwap->retiredInstruments ) {
+		__instrument_death_row.push_back( pInstr );
+	}
+	if ( m_pDrumkitSwap->retiredInstruments.size() > 0 ) {
+		__kill_instruments();
+	}
+
+	delete m_pDrumkitSwap->pDrumkit;
+	delete m_pDrumkitSwap;
+	m_pDrumkitSwap = nullptr;
+}
+
 // This will check if an instrument has any notes
 bool Hydrogen::instrumentHasNotes( Instrument *pInst )
 {
@@ -3343,24 +4917,7 @@ long Hydrogen::getTickForPosition( int pos )
 		}
 	}
 
-	std::vector<PatternList*> *pColumns = pSong->getPatternGroupVector();
-	long totalTick = 0;
-	int nPatternSize;
-	Pattern *pPattern = nullptr;
-	
-	for ( int i = 0; i < pos; ++i ) {
-		PatternList *pColumn = ( *pColumns )[ i ];
-		
-		if( pColumn->size() > 0)
-		{
-			nPatternSize = pColumn->longest_pattern_length();
-		} else {
-			nPatternSize = MAX_NOTES;
-		}
-		totalTick += nPatternSize;
-	}
-	
-	return totalTick;
+	return pSong->getColumnStartTick( pos );
 }
 
 void Hydrogen::setPatternPos( int nPatternNumber )
@@ -3390,7 +4947,7 @@ void Hydrogen::setPatternPos( int nPatternNumber )
 		m_nPatternTickPosition = 0;
 	}
 	INFOLOG( "relocate" );
-	pAudioEngine->locate( static_cast<int>( totalTick * m_pAudioDriver->m_transport.m_fTickSize ));
+	pAudioEngine->locate( m_pAudioDriver->m_transport.frameAtTick( totalTick ) );
 
 	pAudioEngine->unlock();
 }
@@ -3406,6 +4963,15 @@ void Hydrogen::getLadspaFXPeak( int nFX, float *fL, float *fR )
 #endif
 }
 
+float Hydrogen::getLadspaFXProcessTime( int nFX )
+{
+#ifdef H2CORE_HAVE_LADSPA
+	return m_fFXProcessTime[nFX];
+#else
+	return 0;
+#endif
+}
+
 void Hydrogen::setLadspaFXPeak( int nFX, float fL, float fR )
 {
 #ifdef H2CORE_HAVE_LADSPA
@@ -3517,6 +5083,35 @@ void Hydrogen::setBPM( float fBPM )
 	m_pAudioDriver->setBpm( fBPM );
 	pSong->setBpm( fBPM );
 	setNewBpmJTM ( fBPM );
+
+	// Tempo changes originating from the Link session itself are
+	// not committed again by LinkTransport::process().
+	LinkTransport* pLink = AudioEngine::get_instance()->get_link_transport();
+	if ( pLink->isEnabled() ) {
+		pLink->requestTempo( fBPM );
+	}
+}
+
+bool Hydrogen::bufferSizeChanged( unsigned nBufferSize )
+{
+	if ( nBufferSize == 0 || nBufferSize > MAX_BUFFER_SIZE ) {
+		ERRORLOG( QString( "Unsupported buffer size [%1]. Hydrogen supports up to %2 frames per period." )
+				  .arg( nBufferSize ).arg( MAX_BUFFER_SIZE ) );
+		return false;
+	}
+
+	INFOLOG( QString( "Buffer size changed to [%1]" ).arg( nBufferSize ) );
+
+	// Sampler, Synth, and the track outs render into buffers of
+	// MAX_BUFFER_SIZE and only the plugins have to be reconnected.
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	audioEngine_setupLadspaFX( nBufferSize );
+	AudioEngine::get_instance()->unlock();
+
+	// Keep the new period when the driver is restarted later on.
+	Preferences::get_instance()->m_nBufferSize = nBufferSize;
+
+	return true;
 }
 
 void Hydrogen::restartLadspaFX()
@@ -3573,14 +5168,13 @@ void Hydrogen::refreshInstrumentParameters( int nInstrument )
 	EventQueue::get_instance()->push_event( EVENT_PARAMETERS_INSTRUMENT_CHANGED, -1 );
 }
 
-#ifdef H2CORE_HAVE_JACK
 void Hydrogen::renameJackPorts( Song *pSong )
 {
-	if( Preferences::get_instance()->m_bJackTrackOuts == true ){
+	if( Preferences::get_instance()->m_bJackTrackOuts == true ||
+		( m_pAudioDriver != nullptr && m_pAudioDriver->getTrackOutputs() != nullptr ) ){
 		audioEngine_renameJackPorts(pSong);
 	}
 }
-#endif
 
 /** Updates #m_nbeatsToCount
  * \param beatstocount New value*/
@@ -3807,6 +5401,7 @@ void Hydrogen::togglePlaysSelected()
 		Pattern* pSelectedPattern =
 				pSong->getPatternList()->get(m_nSelectedPatternNumber);
 		m_pPlayingPatterns->add( pSelectedPattern );
+		audioEngine_publishPlaybackSnapshot();
 	}
 
 	pPref->setPatternModePlaysSelected( !isPlaysSelected );
@@ -3870,7 +5465,7 @@ float Hydrogen::getTimelineBpm( int nBar )
 	// Check whether the user wants Hydrogen to determine the
 	// speed by local setting along the timeline or whether she
 	// wants to use a global speed instead.
-	if ( ! Preferences::get_instance()->getUseTimelineBpm() ) {
+	if ( ! RealtimeConfig::current().bUseTimelineBpm ) {
 		return fBPM;
 	}
 
@@ -3886,16 +5481,54 @@ float Hydrogen::getTimelineBpm( int nBar )
 	return fBPM;
 }
 
+float Hydrogen::getTimelineBpmAtTick( double fTick, bool* pRamp )
+{
+	if ( pRamp != nullptr ) {
+		*pRamp = false;
+	}
+
+	Song* pSong = getSong();
+	if ( pSong == nullptr || pSong->getMode() == Song::PATTERN_MODE ||
+		 ! RealtimeConfig::current().bUseTimelineBpm || fTick < 0 ) {
+		return getTimelineBpm( 0 );
+	}
+
+	long nSongLength = pSong->lengthInTicks();
+	if ( nSongLength > 0 ) {
+		fTick = std::fmod( fTick, static_cast<double>( nSongLength ) );
+	}
+
+	bool bRamp;
+	float fBpm = m_pTimeline->getTempoAtTick( fTick, pSong, &bRamp );
+	if ( pRamp != nullptr ) {
+		*pRamp = bRamp;
+	}
+	if ( bRamp ) {
+		return fBpm;
+	}
+
+	// Outside of ramps the markers apply to whole bars.
+	int nPatternStartTick;
+	return getTimelineBpm( getPosForTick( static_cast<unsigned long>( fTick ),
+										  &nPatternStartTick ) );
+}
+
 void Hydrogen::setTimelineBpm()
 {
-	if ( ! Preferences::get_instance()->getUseTimelineBpm() ||
+	if ( ! RealtimeConfig::current().bUseTimelineBpm ||
 		 getJackTimebaseState() == JackAudioDriver::Timebase::Slave ) {
 		return;
 	}
 
 	Song* pSong = getSong();
-	// Obtain the local speed specified for the current Pattern.
-	float fBPM = getTimelineBpm( getPatternPos() );
+	// Obtain the local speed at the current transport position.
+	float fBPM;
+	if ( m_pAudioDriver != nullptr && m_pAudioDriver->m_transport.m_fTickSize > 0 ) {
+		fBPM = getTimelineBpmAtTick( m_pAudioDriver->m_transport.m_nFrames /
+									 static_cast<double>( m_pAudioDriver->m_transport.m_fTickSize ) );
+	} else {
+		fBPM = getTimelineBpm( getPatternPos() );
+	}
 
 	if ( fBPM != pSong->getBpm() ) {
 		setBPM( fBPM );
@@ -3905,9 +5538,7 @@ void Hydrogen::setTimelineBpm()
 	// keyboard and MIDI input events in case the audio engine is
 	// not playing.
 	unsigned long PlayTick = getRealtimeTickPosition();
-	int nStartPos;
-	int nRealtimePatternPos = getPosForTick( PlayTick, &nStartPos );
-	float fRealtimeBPM = getTimelineBpm( nRealtimePatternPos );
+	float fRealtimeBPM = getTimelineBpmAtTick( PlayTick );
 
 	// FIXME: this was already done in setBPM but for "engine" time
 	//        so this is actually forcibly overwritten here
@@ -3931,7 +5562,7 @@ bool Hydrogen::haveJackTransport() const {
 #ifdef H2CORE_HAVE_JACK
 	if ( m_pAudioDriver != nullptr ) {
 		if ( JackAudioDriver::class_name() == m_pAudioDriver->class_name() &&
-			 Preferences::get_instance()->m_bJackTransportMode ==
+			 RealtimeConfig::current().nJackTransportMode ==
 			 Preferences::USE_JACK_TRANSPORT ){
 			return true;
 		}
@@ -4022,6 +5653,8 @@ void Hydrogen::setInitialSong( Song *pSong ) {
 		return;
 	}
 	
+	m_startupPreloader.clear();
+
 	// Just to be sure.
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
@@ -4029,6 +5662,7 @@ void Hydrogen::setInitialSong( Song *pSong ) {
 	if ( pSong->getPatternList()->size() > 0 ) {
 		m_pPlayingPatterns->add( pSong->getPatternList()->get( 0 ) );
 	}
+	audioEngine_publishPlaybackSnapshot();
 
 	AudioEngine::get_instance()->unlock();
 
@@ -29,13 +29,16 @@
 #include <core/Basics/Sample.h>
 #include <core/Object.h>
 #include <core/Timeline.h>
+#include <core/LatencyProbe.h>
 #include <core/IO/AudioOutput.h>
 #include <core/IO/MidiInput.h>
 #include <core/IO/MidiOutput.h>
 #include <core/IO/JackAudioDriver.h>
 #include <core/Basics/Drumkit.h>
+#include <core/Basics/SamplePreloader.h>
 #include <core/CoreActionController.h>
 #include <cassert>
+#include <thread>
 #include <core/Timehelper.h>
 // Engine states  (It's ok to use ==, <, and > when testing)
 /**
@@ -63,13 +66,22 @@
  * playing a sequence.
  */
 #define STATE_PLAYING		5
-inline int randomValue( int max );
 
 namespace H2Core
 {
+
+struct PreparedDrumkit;
+class OfflineDriver;
+
 ///
 /// Hydrogen Audio Engine.
 ///
+/// There is exactly one engine per process. Its transport and queue
+/// state is kept in the globals of Hydrogen.cpp and the Sampler,
+/// Effects, Preferences, and EventQueue it relies on are singletons
+/// as well. Songs to be rendered in parallel have to be handed to
+/// separate processes, see the --jobs option of h2cli.
+///
 class Hydrogen : public H2Core::Object
 {
 	H2_OBJECT
@@ -98,12 +110,19 @@ public:
 	 * The AudioEngine::create_instance(),
 	 * Effects::create_instance(), and Playlist::create_instance()
 	 * functions will be called from within audioEngine_init().
+	 *
+	 * \param sStartupSong Path of the Song about to be opened
+	 * once the startup is done. Its samples will be decoded in the
+	 * background while the audio drivers are started. May be
+	 * empty.
 	 */
-	static void		create_instance();
+	static void		create_instance( const QString& sStartupSong = "" );
 	/**
 	 * Returns the current Hydrogen instance #__instance.
 	 */
 	static Hydrogen*	get_instance(){ assert(__instance); return __instance; };
+	/** Whether create_instance() was called already.*/
+	static bool		is_created() { return __instance != nullptr; }
 
 	/**
 	 * Destructor taking care of most of the clean up.
@@ -199,6 +218,22 @@ public:
 
 		void			removeSong();
 
+		/**
+		 * Plays and, if recording, adds a note triggered by the
+		 * keyboard or a MIDI device.
+		 *
+		 * The note heard bypasses the lookahead of the song note
+		 * queue and is voiced in the next process cycle at its
+		 * offset within the buffer.
+		 *
+		 * \param nTimestamp Time the triggering event was received
+		 * as returned by rtclock_now_ns(). It is used to render
+		 * the note sample-accurately at a constant latency of one
+		 * buffer. If 0, the time of the call is used.
+		 * \param latencySource MIDI driver the triggering event was
+		 * received by. If set, the latency of the note is measured
+		 * by the LatencyProbe.
+		 */
 		void			addRealtimeNote ( int instrument,
 							  float velocity,
 							  float pan_L=1.0,
@@ -206,7 +241,54 @@ public:
 							  float pitch=0.0,
 							  bool noteoff=false,
 							  bool forcePlay=false,
-							  int msg1=0 );
+							  int msg1=0,
+							  int64_t nTimestamp=0,
+							  LatencyProbe::Source latencySource = LatencyProbe::SOURCE_NONE );
+
+		/** Note to be played at a fixed offset by scheduleNotes().*/
+		struct ScheduledNote {
+			/** Index of the instrument within the
+				InstrumentList of the current song.*/
+			int nInstrument;
+			float fVelocity;
+			/** Pitch in semitones.*/
+			float fPitch;
+			/** Distance from the start of the next process cycle in
+				frames or ticks, see scheduleNotes().*/
+			float fOffset;
+		};
+		/** Largest pitch accepted by scheduleNotes() in either
+			direction.*/
+		static constexpr float fMaxScheduledPitch = 24;
+		/** Largest offset accepted by scheduleNotes() in
+			seconds.*/
+		static constexpr float fMaxScheduledOffset = 10;
+
+		/**
+		 * Plays a whole batch of notes, e.g. generated by another
+		 * application, each at a fixed distance from the start of
+		 * the next process cycle.
+		 *
+		 * In contrast to addRealtimeNote() the engine is not
+		 * locked. All notes are validated in the calling thread and
+		 * handed to the audio engine in a single
+		 * AudioEngine::postCommand(). They are placed relative to
+		 * the first frame of the cycle applying the command and
+		 * voiced sample-accurately like notes played live. Notes are
+		 * neither quantized nor recorded.
+		 *
+		 * \param notes Notes to play in arbitrary order.
+		 * \param bTicks Whether ScheduledNote::fOffset is given in
+		 * ticks, which are converted using the tick size at the
+		 * time the notes are placed, instead of frames.
+		 *
+		 * \return false - without playing any of the notes - if one
+		 * of them refers to an instrument not present, has a
+		 * velocity outside of [#VELOCITY_MIN, #VELOCITY_MAX], a
+		 * pitch exceeding #fMaxScheduledPitch, or a negative offset
+		 * or one exceeding #fMaxScheduledOffset.
+		 */
+		bool			scheduleNotes( std::vector<ScheduledNote> notes, bool bTicks );
 
 		float			getMasterPeak_L();
 		void			setMasterPeak_L( float value );
@@ -216,6 +298,10 @@ public:
 
 		void			getLadspaFXPeak( int nFX, float *fL, float *fR );
 		void			setLadspaFXPeak( int nFX, float fL, float fR );
+		/** \return Time in milliseconds the LADSPA effect @a nFX
+			took to process the last buffer. Zero if it is
+			disabled.*/
+		float			getLadspaFXProcessTime( int nFX );
 	/** \return #m_nPatternTickPosition */
 	unsigned long		getTickPosition();
 	/** Keep track of the tick position in realtime.
@@ -255,6 +341,35 @@ public:
 
 	/** \return #m_pNextPatterns*/
 	PatternList *		getNextPatterns();
+	/**
+	 * Copies the patterns currently played and those scheduled to be
+	 * played next into @a pPlaying and @a pNext.
+	 *
+	 * The lists are taken from the PlaybackSnapshot of the
+	 * AudioEngine without locking it. Only if they do not fit into
+	 * it, the AudioEngine is locked and #m_pPlayingPatterns and
+	 * #m_pNextPatterns are copied directly.
+	 *
+	 * The pointers must only be used for comparison, e.g. with the
+	 * patterns of the Song.
+	 */
+	void			getPlaybackPatterns( std::vector<const Pattern*>* pPlaying,
+										 std::vector<const Pattern*>* pNext );
+	/**
+	 * Extrapolates the position processed by the audio engine right
+	 * now from the PlaybackClock without locking it. Used by the
+	 * GUI to move its playheads smoothly.
+	 *
+	 * \param pColumn Set to the column of the song or -1 in
+	 * Song::PATTERN_MODE.
+	 * \param pTick Set to the ticks passed since the beginning of
+	 * the column or the playing patterns.
+	 * \param pLength Set to the length of the column or the longest
+	 * playing pattern in ticks.
+	 * \return false if nothing was published yet or the position is
+	 * beyond the end of the song.
+	 */
+	bool			getPlayheadPosition( int* pColumn, double* pTick, int* pLength ) const;
 	/** Get the position of the current Pattern in the Song.
 	 * \return #m_nSongPos */
 	int			getPatternPos();
@@ -363,6 +478,52 @@ public:
 
 		int			loadDrumkit( Drumkit *pDrumkitInfo, bool conditional );
 
+		/**
+		 * Prepares @a pDrumkitInfo in a background thread to be
+		 * swapped into the current Song without stopping the audio
+		 * engine.
+		 *
+		 * Samples, components, and instruments of the new drumkit
+		 * are loaded off the realtime thread. Once commitDrumkit()
+		 * was called, audioEngine_process() replaces the
+		 * InstrumentList and components of the Song by swapping
+		 * pointers and maps the notes of all patterns onto the new
+		 * instruments. Notes still being rendered keep on using the
+		 * previous instruments, which are deleted by the background
+		 * thread as soon as they are not in use anymore.
+		 *
+		 * The swap is discarded if the instrument list of the Song
+		 * changes before it is committed.
+		 *
+		 * \param pDrumkitInfo Drumkit to load. A copy is made.
+		 * \param bConditional Whether instruments beyond the size
+		 *   of the new drumkit are kept if they have notes (see
+		 *   loadDrumkit()).
+		 *
+		 * \returns -1 if another drumkit is still waiting to be
+		 *   swapped in, 0 else.
+		 */
+		int			prepareDrumkit( Drumkit* pDrumkitInfo, bool bConditional );
+		/**
+		 * Swaps in the drumkit handed to prepareDrumkit(). Might be
+		 * called before the preparation is done.
+		 *
+		 * #EVENT_DRUMKIT_LOADED is pushed with value 0 once the
+		 * swap was done and with -1 if it had to be discarded.
+		 *
+		 * \param bAtBarBoundary If true and transport is rolling,
+		 *   the swap is done right before the first tick of the next
+		 *   bar is queued. Else, it is done in the next process
+		 *   cycle.
+		 */
+		void			commitDrumkit( bool bAtBarBoundary );
+		/** Discards the drumkit handed to prepareDrumkit() in case
+			it was not swapped in yet.*/
+		void			cancelDrumkit();
+		/** \return Whether the drumkit handed to prepareDrumkit()
+			is ready to be swapped in.*/
+		bool			isDrumkitPrepared() const;
+
 		/** Test if an Instrument has some Note in the Pattern (used to
 		    test before deleting an Instrument)*/
 		bool 			instrumentHasNotes( Instrument *pInst );
@@ -424,7 +585,7 @@ void			previewSample( Sample *pSample );
 		 * Unable to register output ports for the JACK client
 		 * using _jack_port_register()_ (jack/jack.h) in
 		 * JackAudioDriver::init() or
-		 * JackAudioDriver::setTrackOutput().
+		 * JackAudioDriver::updateTrackOutputs().
 		 */
 		JACK_ERROR_IN_PORT_REGISTER,
 		/**
@@ -448,6 +609,21 @@ void			previewSample( Sample *pSample );
 	 */
 	void			setBPM( float fBPM );
 
+	/**
+	 * Adapts the audio engine to a new period size of the audio
+	 * driver without restarting it.
+	 *
+	 * All rendering buffers are allocated with #MAX_BUFFER_SIZE
+	 * frames up front. Therefore, only the LADSPA plugins are
+	 * reconnected using audioEngine_setupLadspaFX() and
+	 * Preferences::m_nBufferSize is updated. The function locks the
+	 * AudioEngine and must not be called from within
+	 * audioEngine_process().
+	 *
+	 * \param nBufferSize New number of frames per process cycle.
+	 * \return false if @a nBufferSize is not supported.
+	 */
+	bool			bufferSizeChanged( unsigned nBufferSize );
 	void			restartLadspaFX();
 	/** \return #m_nSelectedPatternNumber*/
 	int				getSelectedPatternNumber();
@@ -471,14 +647,13 @@ void			previewSample( Sample *pSample );
 
 	void			refreshInstrumentParameters( int nInstrument );
 
-#if defined(H2CORE_HAVE_JACK) || _DOXYGEN_
 	/**
 	 * Calls audioEngine_renameJackPorts() if
-	 * Preferences::m_bJackTrackOuts is set to true.
+	 * Preferences::m_bJackTrackOuts is set to true or the audio
+	 * driver provides multichannel TrackOutputs.
 	 * \param pSong Handed to audioEngine_renameJackPorts().
 	 */
 	void			renameJackPorts(Song* pSong);
-#endif
 
 	/** Starts/stops the OSC server
 	 * \param bEnable `true` = start, `false` = stop.*/
@@ -536,11 +711,11 @@ void			previewSample( Sample *pSample );
 	 * Updates Song::m_fBpm, TransportInfo::m_fBPM, and #m_fNewBpmJTM
 	 * to the local speed.
 	 *
-	 * The local speed will be obtained by calling getTimelineBpm()
-	 * with getPatternPos() as input argument and set for the current
-	 * song and transport. For setting the
-	 * fallback speed #m_fNewBpmJTM, getRealtimeTickPosition() will be
-	 * used instead.
+	 * The local speed will be obtained by calling
+	 * getTimelineBpmAtTick() with the current transport position as
+	 * input argument and set for the current song and transport. For
+	 * setting the fallback speed #m_fNewBpmJTM,
+	 * getRealtimeTickPosition() will be used instead.
 	 *
 	 * If Preferences::__useTimelineBpm is set to false or Hydrogen
 	 * uses JACK transport in the presence of an external timebase
@@ -566,6 +741,18 @@ void			previewSample( Sample *pSample );
 	 * \return Speed in beats per minute.
 	 */
 	float			getTimelineBpm( int nBar );
+	/**
+	 * Like getTimelineBpm() but takes the tempo ramps of the Timeline
+	 * into account.
+	 *
+	 * \param fTick Position in ticks counted from the beginning of
+	 *   the Song. Positions beyond its end are wrapped.
+	 * \param pRamp If not nullptr, set to whether @a fTick lies
+	 *   within a tempo ramp.
+	 *
+	 * \return Speed in beats per minute.
+	 */
+	float			getTimelineBpmAtTick( double fTick, bool* pRamp = nullptr );
 	Timeline*		getTimeline() const;
 	
 	//export management
@@ -573,7 +760,58 @@ void			previewSample( Sample *pSample );
 	void			startExportSession( int rate, int depth );
 	void			stopExportSession();
 	void			startExportSong( const QString& filename );
+	/**
+	 * Renders @a pInstrument into a separate file @a sFilename
+	 * during the next call of startExportSong(). This way the stems
+	 * of all instruments are exported within a single pass through
+	 * the song.
+	 *
+	 * Has to be called after startExportSession() and is only
+	 * supported by the DiskWriterDriver.
+	 */
+	void			addExportStem( Instrument* pInstrument, const QString& sFilename );
+	/**
+	 * Writes the main output into @a sFilename as well during the
+	 * next call of startExportSong(). The format is derived from the
+	 * suffix. This way e.g. a WAV master and an Ogg/Vorbis preview
+	 * are created within a single pass through the song.
+	 *
+	 * Has to be called after startExportSession() and is only
+	 * supported by the DiskWriterDriver.
+	 */
+	void			addExportFile( const QString& sFilename );
+	/**
+	 * Moves the transport of an export to @a nFrame without
+	 * rendering the frames in between. Used by the DiskWriterDriver
+	 * after writing a column from its render cache.
+	 *
+	 * All queued notes are dropped and the notes of the next
+	 * process cycle are queued starting at @a nTick, the first tick
+	 * of the following column, instead of at the end of the
+	 * lookahead.
+	 */
+	void			skipExport( unsigned long nFrame, long nTick );
 	void			stopExportSong();
+	/**
+	 * Replaces the audio driver by an OfflineDriver rendering the
+	 * current song from its beginning at @a nSampleRate. Instead of
+	 * running a thread, the audio engine is driven by
+	 * OfflineDriver::render() until the end of the song.
+	 *
+	 * The session is ended by stopExportSession().
+	 *
+	 * \return The driver or nullptr if it could not be started.
+	 */
+	OfflineDriver*	startOfflineRender( unsigned nSampleRate );
+	/**
+	 * Rewinds the OfflineDriver started by startOfflineRender() to
+	 * render the current song once more, e.g. after its pattern
+	 * groups were replaced.
+	 *
+	 * \return false if no offline render is running or it could not
+	 * be restarted.
+	 */
+	bool			restartOfflineRender();
 	
 	CoreActionController* 	getCoreActionController() const;
 
@@ -711,6 +949,12 @@ void			previewSample( Sample *pSample );
 	int 			m_nMaxTimeHumanize;
 
 private:
+	/**
+	 * Holds the samples of the Song passed to create_instance()
+	 * until it is opened via setSong() or setInitialSong().
+	 */
+	SamplePreloader	m_startupPreloader;
+
 	/**
 	 * Static reference to the Hydrogen singleton. 
 	 *
@@ -740,6 +984,10 @@ private:
 	 */
 	void initBeatcounter();
 
+	/** Stops the playback and switches the song to Song::SONG_MODE
+		for startExportSession() and startOfflineRender().*/
+	void prepareExportSession();
+
 	// beatcounter
 	float			m_ntaktoMeterCompute;	///< beatcounter note length
 	int			m_nbeatsToCount;	///< beatcounter beats to count
@@ -757,6 +1005,12 @@ private:
 	Song::SongMode		m_oldEngineMode;
 	bool			m_bOldLoopEnabled;
 	bool			m_bExportSessionIsActive;
+	/** Whether the current export session renders through the
+		JackAudioDriver in freewheel mode instead of the
+		DiskWriterDriver. See Preferences::m_bJackFreewheelExport.*/
+	bool			m_bFreewheelExport;
+	/** Sample depth requested in startExportSession().*/
+	int				m_nExportSampleDepth;
 	
 	/**
 	 * Specifies whether the Qt5 GUI is active.
@@ -800,6 +1054,18 @@ private:
 	/// Deleting instruments too soon leads to potential crashes.
 	std::list<Instrument*> 	__instrument_death_row; 
 
+	/** Drumkit swap set up by prepareDrumkit(). Owned by Hydrogen
+		and deleted once #m_drumkitSwapThread was joined.*/
+	PreparedDrumkit*	m_pDrumkitSwap;
+	/** Loads #m_pDrumkitSwap and cleans up after it was swapped
+		in.*/
+	std::thread		m_drumkitSwapThread;
+	/** Body of #m_drumkitSwapThread.*/
+	void			drumkitSwapWorker( PreparedDrumkit* pPrepared );
+	/** Discards a drumkit not swapped in yet, joins
+		#m_drumkitSwapThread, and deletes #m_pDrumkitSwap.*/
+	void			joinDrumkitSwap();
+
 	/** 
 	 * Constructor, entry point, and initialization of the
 	 * Hydrogen application.
@@ -827,8 +1093,9 @@ private:
 	 *   #H2CORE_HAVE_OSC was set during compilation.
 	 * - Fills #m_nInstrumentLookupTable with the corresponding
 	 *   index of each element.
+	 * - Starts preloading the samples of @a sStartupSong.
 	 */
-	Hydrogen();
+	Hydrogen( const QString& sStartupSong );
 
 	void __kill_instruments();
 
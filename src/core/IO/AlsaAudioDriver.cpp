@@ -25,8 +25,15 @@
 #if defined(H2CORE_HAVE_ALSA) || _DOXYGEN_
 
 #include <pthread.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include <core/EventQueue.h>
 #include <core/Preferences.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+#include <core/IO/RenderAhead.h>
+#include <core/Tracer.h>
 
 namespace H2Core
 {
@@ -52,50 +59,185 @@ static int alsa_xrun_recovery( snd_pcm_t *handle, int err )
 	return err;
 }
 
-void* alsaAudioDriver_processCaller( void* param )
+/** Accounts an xrun of @a pDriver and tries to recover from it.*/
+static void alsa_handle_xrun( AlsaAudioDriver* pDriver, int err )
 {
-	Object *__object = (Object*)param;
-	AlsaAudioDriver *pDriver = ( AlsaAudioDriver* )param;
+	Object *__object = (Object*)pDriver;
+	Tracer::instant( "ALSA xrun" );
+	__ERRORLOG( "XRUN" );
+	if ( alsa_xrun_recovery( pDriver->m_pPlayback_handle, err ) < 0 ) {
+		__ERRORLOG( "Can't recover from XRUN" );
+	}
+	pDriver->m_nXRuns++;
+	EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
+}
 
-	// stolen from amSynth
-	struct sched_param sched;
-	sched.sched_priority = 50;
-	int res = sched_setscheduler( 0, SCHED_FIFO, &sched );
-	sched_getparam( 0, &sched );
-	if ( res ) {
-		__ERRORLOG( "Can't set realtime scheduling for ALSA Driver" );
+/** Converts @a nFrames frames starting at @a nOffset of the output
+	buffers to the interleaved sample format of the device and writes
+	them to @a pDest.*/
+static void alsa_convert( AlsaAudioDriver* pDriver, void* pDest, int nOffset, int nFrames )
+{
+	const float** ppSrc = pDriver->m_channelBuffers.data();
+	unsigned nChannels = pDriver->m_nChannels;
+	if ( pDriver->m_pRenderAhead != nullptr ) {
+		for ( unsigned nn = 0; nn < nChannels; ++nn ) {
+			ppSrc[ nn ] = ( pDriver->m_ppRendered != nullptr ?
+							pDriver->m_ppRendered[ nn ] :
+							pDriver->m_silence.data() ) + nOffset;
+		}
+	} else if ( pDriver->m_pTrackOutputs != nullptr ) {
+		pDriver->m_pTrackOutputs->getChannelBuffers( ppSrc, pDriver->m_pOut_L,
+													 pDriver->m_pOut_R, nOffset );
+	} else {
+		ppSrc[ 0 ] = pDriver->m_pOut_L + nOffset;
+		ppSrc[ 1 ] = pDriver->m_pOut_R + nOffset;
+	}
+	switch ( pDriver->m_format ) {
+	case SND_PCM_FORMAT_S32:
+		Dsp::interleaveInt32( static_cast<int32_t*>( pDest ), ppSrc, nChannels, nFrames );
+		break;
+	case SND_PCM_FORMAT_S24_3LE:
+		Dsp::interleaveInt24( static_cast<uint8_t*>( pDest ), ppSrc, nChannels, nFrames );
+		break;
+	default:
+		Dsp::interleaveInt16( static_cast<int16_t*>( pDest ), ppSrc, nChannels, nFrames );
+		break;
 	}
-	__INFOLOG( QString( "Scheduling priority = %1" ).arg( sched.sched_priority ) );
+}
 
-	sleep( 1 );
+/** Lets the audio engine render the next period of @a nFrames
+	frames or takes it from AlsaAudioDriver::m_pRenderAhead.*/
+static void alsa_render( AlsaAudioDriver* pDriver, int nFrames )
+{
+	if ( pDriver->m_pRenderAhead != nullptr ) {
+		pDriver->m_ppRendered = pDriver->m_pRenderAhead->front();
+	} else {
+		pDriver->m_processCallback( nFrames, nullptr );
+	}
+}
 
-	int err;
-	if ( ( err = snd_pcm_prepare( pDriver->m_pPlayback_handle ) ) < 0 ) {
-		__ERRORLOG( QString( "Cannot prepare audio interface for use: %1" ).arg( snd_strerror ( err ) ) );
+/** Hands the period taken by alsa_render() back to
+	AlsaAudioDriver::m_pRenderAhead once it was converted.*/
+static void alsa_release( AlsaAudioDriver* pDriver )
+{
+	if ( pDriver->m_ppRendered != nullptr ) {
+		pDriver->m_ppRendered = nullptr;
+		pDriver->m_pRenderAhead->pop();
 	}
+}
 
-	int nFrames = pDriver->m_nBufferSize;
-	__INFOLOG( QString( "nFrames: %1" ).arg( nFrames ) );
-	short pBuffer[ nFrames * 2 ];
+/** Converts a period rendered by the audio engine into the ring
+	buffer of the device.*/
+static int alsa_mmap_write( AlsaAudioDriver* pDriver, int nFrames )
+{
+	snd_pcm_t *pHandle = pDriver->m_pPlayback_handle;
+
+	int nWritten = 0;
+	while ( nWritten < nFrames ) {
+		const snd_pcm_channel_area_t *pAreas;
+		snd_pcm_uframes_t nOffset;
+		snd_pcm_uframes_t nChunk = nFrames - nWritten;
+		int err = snd_pcm_mmap_begin( pHandle, &pAreas, &nOffset, &nChunk );
+		if ( err < 0 ) {
+			return err;
+		}
 
-	float *pOut_L = pDriver->m_pOut_L;
-	float *pOut_R = pDriver->m_pOut_R;
+		// With interleaved access all channels share the area of
+		// the first one, which starts at the left sample of the
+		// frame.
+		const snd_pcm_channel_area_t& area = pAreas[ 0 ];
+		alsa_convert( pDriver, static_cast<char*>( area.addr ) +
+					  ( area.first + nOffset * area.step ) / 8,
+					  nWritten, nChunk );
+
+		snd_pcm_sframes_t nCommitted = snd_pcm_mmap_commit( pHandle, nOffset, nChunk );
+		if ( nCommitted < 0 ) {
+			return nCommitted;
+		} else if ( static_cast<snd_pcm_uframes_t>( nCommitted ) != nChunk ) {
+			return -EPIPE;
+		}
+		nWritten += nChunk;
+	}
+	return 0;
+}
+
+/** Renders a period each time the device has room for one and
+	writes it directly into its ring buffer.*/
+static void alsa_mmap_loop( AlsaAudioDriver* pDriver, int nFrames )
+{
+	Object *__object = (Object*)pDriver;
+	snd_pcm_t *pHandle = pDriver->m_pPlayback_handle;
+
+	// Waiting is done with a timeout so the loop notices when the
+	// driver is disconnected.
+	const int nTimeout = std::max( 100, static_cast<int>(
+		4000LL * nFrames / std::max( 1u, pDriver->getSampleRate() ) ) );
 
 	while ( pDriver->m_bIsRunning ) {
-		// prepare the audio data
-		pDriver->m_processCallback( nFrames, nullptr );
+		snd_pcm_state_t state = snd_pcm_state( pHandle );
+		if ( state == SND_PCM_STATE_XRUN || state == SND_PCM_STATE_SUSPENDED ) {
+			alsa_handle_xrun( pDriver, state == SND_PCM_STATE_XRUN ? -EPIPE : -ESTRPIPE );
+			continue;
+		}
 
-		for ( int i = 0; i < nFrames; ++i ) {
-			pBuffer[ i * 2 ] = ( short )( pOut_L[ i ] * 32768.0 );
-			pBuffer[ i * 2 + 1 ] = ( short )( pOut_R[ i ] * 32768.0 );
+		snd_pcm_sframes_t nAvail = snd_pcm_avail_update( pHandle );
+		if ( nAvail < 0 ) {
+			alsa_handle_xrun( pDriver, nAvail );
+			continue;
 		}
 
-		if ( ( err = snd_pcm_writei( pDriver->m_pPlayback_handle, pBuffer, nFrames ) ) < 0 ) {
-			__ERRORLOG( "XRUN" );
+		if ( nAvail < nFrames ) {
+			if ( state != SND_PCM_STATE_RUNNING ) {
+				// The ring buffer is filled. Playback starts
+				// explicitly to not depend on the start threshold.
+				int err = snd_pcm_start( pHandle );
+				if ( err < 0 ) {
+					__ERRORLOG( QString( "Cannot start playback: %1" ).arg( snd_strerror( err ) ) );
+					alsa_handle_xrun( pDriver, err );
+				}
+				continue;
+			}
 
-			if ( alsa_xrun_recovery( pDriver->m_pPlayback_handle, err ) < 0 ) {
-				__ERRORLOG( "Can't recover from XRUN" );
+			// Sleeps in poll() on the descriptors of the device till
+			// a period got played back.
+			int err = snd_pcm_wait( pHandle, nTimeout );
+			if ( err < 0 ) {
+				alsa_handle_xrun( pDriver, err );
 			}
+			continue;
+		}
+
+		Tracer::Scope trace( "AlsaAudioDriver period" );
+		alsa_render( pDriver, nFrames );
+
+		int err = alsa_mmap_write( pDriver, nFrames );
+		alsa_release( pDriver );
+		if ( err < 0 ) {
+			alsa_handle_xrun( pDriver, err );
+		}
+	}
+}
+
+/** Renders a period and hands it to snd_pcm_writei(), which blocks
+	till there is room in the ring buffer of the device.*/
+static void alsa_rw_loop( AlsaAudioDriver* pDriver, int nFrames )
+{
+	Object *__object = (Object*)pDriver;
+	std::vector<char> buffer( snd_pcm_frames_to_bytes( pDriver->m_pPlayback_handle, nFrames ) );
+	char *pBuffer = buffer.data();
+
+	int err;
+	while ( pDriver->m_bIsRunning ) {
+		// prepare the audio data
+		Tracer::Scope trace( "AlsaAudioDriver period" );
+		alsa_render( pDriver, nFrames );
+
+		alsa_convert( pDriver, pBuffer, 0, nFrames );
+		alsa_release( pDriver );
+
+		if ( ( err = snd_pcm_writei( pDriver->m_pPlayback_handle, pBuffer, nFrames ) ) < 0 ) {
+			alsa_handle_xrun( pDriver, err );
+
 			// retry
 			if ( ( err = snd_pcm_writei( pDriver->m_pPlayback_handle, pBuffer, nFrames ) ) < 0 ) {
 				__ERRORLOG( "XRUN 2" );
@@ -103,10 +245,35 @@ void* alsaAudioDriver_processCaller( void* param )
 					__ERRORLOG( "Can't recover from XRUN" );
 				}
 			}
-
-			pDriver->m_nXRuns++;
 		}
 	}
+}
+
+void* alsaAudioDriver_processCaller( void* param )
+{
+	Object *__object = (Object*)param;
+	AlsaAudioDriver *pDriver = ( AlsaAudioDriver* )param;
+
+	Threads::configureCurrentThread( Threads::Role::Audio, "ALSA audio" );
+
+	Dsp::disableDenormals();
+
+	int err;
+	if ( ( err = snd_pcm_prepare( pDriver->m_pPlayback_handle ) ) < 0 ) {
+		__ERRORLOG( QString( "Cannot prepare audio interface for use: %1" ).arg( snd_strerror ( err ) ) );
+	}
+
+	int nFrames = pDriver->m_nBufferSize;
+	__INFOLOG( QString( "nFrames: %1" ).arg( nFrames ) );
+
+	if ( pDriver->m_bUseMmap ) {
+		alsa_mmap_loop( pDriver, nFrames );
+	} else {
+		// Give the device some time to settle. In mmap mode the
+		// ring buffer is filled instead.
+		sleep( 1 );
+		alsa_rw_loop( pDriver, nFrames );
+	}
 	return nullptr;
 }
 
@@ -119,6 +286,12 @@ AlsaAudioDriver::AlsaAudioDriver( audioProcessCallback processCallback )
 		, m_pOut_L( nullptr )
 		, m_pOut_R( nullptr )
 		, m_nXRuns( 0 )
+		, m_bUseMmap( false )
+		, m_format( SND_PCM_FORMAT_S16 )
+		, m_nChannels( 2 )
+		, m_pTrackOutputs( nullptr )
+		, m_pRenderAhead( nullptr )
+		, m_ppRendered( nullptr )
 		, m_nBufferSize( 0 )
 		, m_pPlayback_handle( nullptr )
 		, m_processCallback( processCallback )
@@ -131,7 +304,7 @@ AlsaAudioDriver::AlsaAudioDriver( audioProcessCallback processCallback )
 AlsaAudioDriver::~AlsaAudioDriver()
 {
 	if ( m_nXRuns > 0 ) {
-		WARNINGLOG( QString( "%1 xruns" ).arg( m_nXRuns ) );
+		WARNINGLOG( QString( "%1 xruns" ).arg( m_nXRuns.load() ) );
 	}
 	INFOLOG( "DESTROY" );
 }
@@ -149,7 +322,6 @@ int AlsaAudioDriver::init( unsigned nBufferSize )
 int AlsaAudioDriver::connect()
 {
 	INFOLOG( "alsa device: " + m_sAlsaAudioDevice );
-	int nChannels = 2;
 
 	int err;
 
@@ -184,21 +356,56 @@ int AlsaAudioDriver::connect()
 		ERRORLOG( QString( "error in snd_pcm_hw_params_any: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
-//	snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED  );
 
-	if ( ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 ) {
+	// Writing directly into the ring buffer of the device saves a
+	// copy and allows the period to be rendered just in time. Devices
+	// not supporting it fall back to snd_pcm_writei().
+	m_bUseMmap = false;
+	if ( Preferences::get_instance()->m_bAlsaMmap ) {
+		if ( ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED ) ) < 0 ) {
+			WARNINGLOG( QString( "mmap access not supported, using read/write access: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
+		} else {
+			m_bUseMmap = true;
+		}
+	}
+
+	if ( ! m_bUseMmap &&
+		 ( err = snd_pcm_hw_params_set_access( m_pPlayback_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params_set_access: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
 
-	if ( ( err = snd_pcm_hw_params_set_format( m_pPlayback_handle, hw_params, SND_PCM_FORMAT_S16_LE ) ) < 0 ) {
+	// Some devices, like many USB interfaces, do not support 16 bit
+	// samples at all.
+	const snd_pcm_format_t formats[] = { SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S24_3LE,
+										 SND_PCM_FORMAT_S16 };
+	m_format = SND_PCM_FORMAT_S16;
+	for ( const auto format : formats ) {
+		if ( snd_pcm_hw_params_test_format( m_pPlayback_handle, hw_params, format ) == 0 ) {
+			m_format = format;
+			break;
+		}
+	}
+	if ( ( err = snd_pcm_hw_params_set_format( m_pPlayback_handle, hw_params, m_format ) ) < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params_set_format: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
 
 	snd_pcm_hw_params_set_rate_near( m_pPlayback_handle, hw_params, &m_nSampleRate, nullptr );
 
-	if ( ( err = snd_pcm_hw_params_set_channels( m_pPlayback_handle, hw_params, nChannels ) ) < 0 ) {
+	// Devices providing fewer channels than requested carry as many
+	// track outputs as fit.
+	m_nChannels = std::max( 2, Preferences::get_instance()->m_nOutputChannels );
+	if ( m_nChannels > 2 ) {
+		unsigned nMaxChannels = m_nChannels;
+		if ( snd_pcm_hw_params_get_channels_max( hw_params, &nMaxChannels ) == 0 &&
+			 nMaxChannels < m_nChannels ) {
+			WARNINGLOG( QString( "%1 channels requested but the device provides only %2" )
+						.arg( m_nChannels ).arg( nMaxChannels ) );
+			m_nChannels = std::max( 2u, nMaxChannels );
+		}
+	}
+	if ( ( err = snd_pcm_hw_params_set_channels( m_pPlayback_handle, hw_params, m_nChannels ) ) < 0 ) {
 		ERRORLOG( QString( "error in snd_pcm_hw_params_set_channels: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
 		return 1;
 	}
@@ -232,9 +439,29 @@ int AlsaAudioDriver::connect()
 
 	snd_pcm_hw_params_get_rate( hw_params, &m_nSampleRate, nullptr );
 
+	snd_pcm_uframes_t nRingBufferSize = nPeriods * m_nBufferSize;
+	snd_pcm_hw_params_get_buffer_size( hw_params, &nRingBufferSize );
+
+	if ( m_bUseMmap ) {
+		// Wake up once a whole period can be written and start
+		// playback only once the ring buffer is filled.
+		snd_pcm_sw_params_t *sw_params;
+		snd_pcm_sw_params_alloca( &sw_params );
+		if ( ( err = snd_pcm_sw_params_current( m_pPlayback_handle, sw_params ) ) < 0 ||
+			 ( err = snd_pcm_sw_params_set_avail_min( m_pPlayback_handle, sw_params, m_nBufferSize ) ) < 0 ||
+			 ( err = snd_pcm_sw_params_set_start_threshold( m_pPlayback_handle, sw_params, nRingBufferSize ) ) < 0 ||
+			 ( err = snd_pcm_sw_params( m_pPlayback_handle, sw_params ) ) < 0 ) {
+			ERRORLOG( QString( "error in snd_pcm_sw_params: %1" ).arg( QString::fromLocal8Bit(snd_strerror(err)) ) );
+			return 1;
+		}
+	}
+
 	INFOLOG( QString( "*** PERIOD SIZE: %1" ).arg( period_size ) );
 	INFOLOG( QString( "*** SAMPLE RATE: %1" ).arg( m_nSampleRate ) );
-	INFOLOG( QString( "*** BUFFER SIZE: %1" ).arg( nPeriods * m_nBufferSize ) );
+	INFOLOG( QString( "*** BUFFER SIZE: %1" ).arg( nRingBufferSize ) );
+	INFOLOG( QString( "*** ACCESS: %1" ).arg( m_bUseMmap ? "mmap" : "read/write" ) );
+	INFOLOG( QString( "*** FORMAT: %1" ).arg( snd_pcm_format_name( m_format ) ) );
+	INFOLOG( QString( "*** CHANNELS: %1" ).arg( m_nChannels ) );
 
 	//snd_pcm_hw_params_free( hw_params );
 
@@ -244,6 +471,26 @@ int AlsaAudioDriver::connect()
 	memset( m_pOut_L, 0, m_nBufferSize * sizeof( float ) );
 	memset( m_pOut_R, 0, m_nBufferSize * sizeof( float ) );
 
+	if ( m_nChannels > 2 ) {
+		m_pTrackOutputs = new TrackOutputs( m_nChannels, m_nBufferSize );
+	}
+	m_channelBuffers.assign( m_nChannels, nullptr );
+
+	int nRenderAheadBuffers = Preferences::get_instance()->m_nRenderAheadBuffers;
+	if ( nRenderAheadBuffers > 0 ) {
+		m_silence.assign( m_nBufferSize, 0 );
+		m_pRenderAhead = new RenderAhead( m_processCallback, m_nChannels,
+										  m_nBufferSize, nRenderAheadBuffers );
+		m_pRenderAhead->start( [this]( const float** ppOut ) {
+			if ( m_pTrackOutputs != nullptr ) {
+				m_pTrackOutputs->getChannelBuffers( ppOut, m_pOut_L, m_pOut_R, 0 );
+			} else {
+				ppOut[ 0 ] = m_pOut_L;
+				ppOut[ 1 ] = m_pOut_R;
+			}
+		} );
+	}
+
 	m_bIsRunning = true;
 
 	// start the main thread
@@ -265,6 +512,10 @@ void AlsaAudioDriver::disconnect()
 
 	pthread_join( alsaAudioDriverThread, nullptr );
 
+	delete m_pRenderAhead;
+	m_pRenderAhead = nullptr;
+	m_ppRendered = nullptr;
+
 	snd_pcm_close( m_pPlayback_handle );
 
 	delete[] m_pOut_L;
@@ -272,6 +523,9 @@ void AlsaAudioDriver::disconnect()
 
 	delete[] m_pOut_R;
 	m_pOut_R = nullptr;
+
+	delete m_pTrackOutputs;
+	m_pTrackOutputs = nullptr;
 }
 
 unsigned AlsaAudioDriver::getBufferSize()
@@ -284,6 +538,11 @@ unsigned AlsaAudioDriver::getSampleRate()
 	return m_nSampleRate;
 }
 
+int AlsaAudioDriver::getXRuns() const
+{
+	return m_nXRuns.load();
+}
+
 float* AlsaAudioDriver::getOut_L()
 {
 	return m_pOut_L;
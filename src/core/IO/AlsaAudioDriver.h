@@ -27,12 +27,16 @@
 
 #if defined(H2CORE_HAVE_ALSA) || _DOXYGEN_
 
+#include <atomic>
 #include <inttypes.h>
+#include <vector>
 #include <alsa/asoundlib.h>
 
 namespace H2Core
 {
 
+class RenderAhead;
+
 typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 class AlsaAudioDriver : public AudioOutput
@@ -44,7 +48,37 @@ public:
 	unsigned long m_nBufferSize;
 	float* m_pOut_L;
 	float* m_pOut_R;
-	int m_nXRuns;
+	/** Number of xruns since the driver was created. Incremented
+		by the audio thread.*/
+	std::atomic<int> m_nXRuns;
+	/** Whether the device is accessed via snd_pcm_mmap_begin() and
+		snd_pcm_mmap_commit() instead of snd_pcm_writei(). Chosen
+		in connect() according to Preferences::m_bAlsaMmap and the
+		capabilities of the device.*/
+	bool m_bUseMmap;
+	/** Sample format chosen in connect(). The widest one supported
+		by the device is used.*/
+	snd_pcm_format_t m_format;
+	/** Number of channels of the device chosen in connect()
+		according to Preferences::m_nOutputChannels.*/
+	unsigned m_nChannels;
+	/** Per-track outputs written to the channels following the
+		main output. nullptr if the device is used in stereo.*/
+	TrackOutputs* m_pTrackOutputs;
+	/** Buffers of all #m_nChannels channels handed to the sample
+		format conversion. Allocated in connect() to not do so in
+		the audio thread.*/
+	std::vector<const float*> m_channelBuffers;
+	/** Renders Preferences::m_nRenderAheadBuffers periods ahead of
+		the device or nullptr if the audio thread renders them
+		itself. Created in connect().*/
+	RenderAhead* m_pRenderAhead;
+	/** Channels of the period taken from #m_pRenderAhead or nullptr
+		if its render thread fell behind.*/
+	const float* const* m_ppRendered;
+	/** A period of silence played in place of the ones
+		#m_pRenderAhead did not render in time.*/
+	std::vector<float> m_silence;
 	QString m_sAlsaAudioDevice;
 	audioProcessCallback m_processCallback;
 
@@ -56,8 +90,13 @@ public:
 	virtual void disconnect();
 	virtual unsigned getBufferSize();
 	virtual unsigned getSampleRate();
+	/** \return #m_nXRuns */
+	int getXRuns() const;
 	virtual float* getOut_L();
 	virtual float* getOut_R();
+	virtual TrackOutputs* getTrackOutputs() const {
+		return m_pTrackOutputs;
+	}
 
 	virtual void updateTransportInfo();
 	virtual void play();
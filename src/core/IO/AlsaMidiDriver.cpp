@@ -26,11 +26,15 @@
 
 #include <core/Preferences.h>
 #include <core/Hydrogen.h>
+#include <core/IO/AudioOutput.h>
 
 #include <core/Globals.h>
 #include <core/EventQueue.h>
+#include <core/rt_clock.h>
+#include <core/Helpers/Threads.h>
 
 #include <pthread.h>
+#include <algorithm>
 #include <core/Basics/Note.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
@@ -52,6 +56,46 @@ struct pollfd *pfd;
 int portId;
 int clientId;
 int outPortId;
+/** Queue used to schedule outgoing notes within a process cycle and
+	to timestamp incoming events.*/
+int queueId = -1;
+
+/** Lets the sequencer stamp all events arriving at the input port
+	with the real time of #queueId.*/
+static void alsaMidiDriver_enableTimestamping( Object* __object )
+{
+	snd_seq_port_info_t *pinfo;
+	snd_seq_port_info_alloca( &pinfo );
+	if ( snd_seq_get_port_info( seq_handle, portId, pinfo ) < 0 ) {
+		__WARNINGLOG( "Unable to query the input port. Incoming events are not timestamped." );
+		return;
+	}
+	snd_seq_port_info_set_timestamping( pinfo, 1 );
+	snd_seq_port_info_set_timestamp_real( pinfo, 1 );
+	snd_seq_port_info_set_timestamp_queue( pinfo, queueId );
+	if ( snd_seq_set_port_info( seq_handle, portId, pinfo ) < 0 ) {
+		__WARNINGLOG( "Unable to enable timestamping of incoming events." );
+	}
+}
+
+/**
+ * \return Time @a ev arrived at the sequencer in rtclock_now_ns()
+ * time.
+ *
+ * @a nNow and @a nQueueNow are the current rtclock_now_ns() and real
+ * time of #queueId in nanoseconds, the latter being negative if
+ * unknown. Events without a timestamp of the queue are assumed to
+ * have arrived just now.
+ */
+static int64_t alsaMidiDriver_timestamp( const snd_seq_event_t* ev, int64_t nNow, int64_t nQueueNow )
+{
+	if ( nQueueNow < 0 || ev->queue != queueId || ! snd_seq_ev_is_real( ev ) ) {
+		return nNow;
+	}
+	int64_t nEventTime = static_cast<int64_t>( ev->time.time.tv_sec ) * 1000000000LL +
+		ev->time.time.tv_nsec;
+	return nNow - std::max( static_cast<int64_t>( 0 ), nQueueNow - nEventTime );
+}
 
 
 void* alsaMidiDriver_thread( void* param )
@@ -59,6 +103,7 @@ void* alsaMidiDriver_thread( void* param )
 	Object* __object = ( Object* )param;
 	AlsaMidiDriver *pDriver = ( AlsaMidiDriver* )param;
 	__INFOLOG( "starting" );
+	Threads::configureCurrentThread( Threads::Role::Midi, "ALSA MIDI" );
 
 	if ( seq_handle != nullptr ) {
 		__ERRORLOG( "seq_handle != NULL" );
@@ -97,6 +142,15 @@ void* alsaMidiDriver_thread( void* param )
 
 	clientId = snd_seq_client_id( seq_handle );
 
+	if ( ( queueId = snd_seq_alloc_queue( seq_handle ) ) < 0 ) {
+		__WARNINGLOG( "Error allocating sequencer queue. Outgoing notes will be sent immediately." );
+		queueId = -1;
+	} else {
+		alsaMidiDriver_enableTimestamping( __object );
+		snd_seq_start_queue( seq_handle, queueId, nullptr );
+		snd_seq_drain_output( seq_handle );
+	}
+
 #ifdef H2CORE_HAVE_LASH
 	if ( Preferences::get_instance()->useLash() ){
 		LashClient* lashClient = LashClient::get_instance();
@@ -133,6 +187,11 @@ void* alsaMidiDriver_thread( void* param )
 		/* set in and out ports */
 		snd_seq_port_subscribe_set_sender( subs, &sender );
 		snd_seq_port_subscribe_set_dest( subs, &dest );
+		if ( queueId >= 0 ) {
+			snd_seq_port_subscribe_set_queue( subs, queueId );
+			snd_seq_port_subscribe_set_time_update( subs, 1 );
+			snd_seq_port_subscribe_set_time_real( subs, 1 );
+		}
 
 		/* subscribe */
 		int ret = snd_seq_subscribe_port( seq_handle, subs );
@@ -182,10 +241,20 @@ void* alsaMidiDriver_thread( void* param )
 
 	__INFOLOG( "MIDI Thread INIT" );
 	while ( isMidiDriverRunning ) {
-		if ( poll( pfd, npfd, 100 ) > 0 ) {
+		// Wake up in time to dispatch control changes held back by
+		// the coalescing.
+		int nTimeout = pDriver->flushControlChanges();
+		if ( nTimeout < 0 || nTimeout > 100 ) {
+			nTimeout = 100;
+		}
+		if ( poll( pfd, npfd, nTimeout ) > 0 ) {
 			pDriver->midi_action( seq_handle );
 		}
 	}
+	if ( queueId >= 0 ) {
+		snd_seq_free_queue( seq_handle, queueId );
+		queueId = -1;
+	}
 	snd_seq_close ( seq_handle );
 	seq_handle = nullptr;
 	__INFOLOG( "MIDI Thread DESTROY" );
@@ -201,6 +270,7 @@ const char* AlsaMidiDriver::__class_name = "AlsaMidiDriver";
 
 AlsaMidiDriver::AlsaMidiDriver()
 		: MidiInput( __class_name ), MidiOutput( __class_name ), Object( __class_name )
+		, m_nLastQueuedFrame( 0 )
 {
 //	infoLog("INIT");
 }
@@ -249,6 +319,18 @@ void AlsaMidiDriver::midi_action( snd_seq_t *seq_handle )
 
 //	bool useMidiTransport = true;
 
+	// Reference for the timestamps of all events of this batch.
+	int64_t nQueueNow = -1;
+	if ( queueId >= 0 ) {
+		snd_seq_queue_status_t *pStatus;
+		snd_seq_queue_status_alloca( &pStatus );
+		if ( snd_seq_get_queue_status( seq_handle, queueId, pStatus ) >= 0 ) {
+			const snd_seq_real_time_t* pTime = snd_seq_queue_status_get_real_time( pStatus );
+			nQueueNow = static_cast<int64_t>( pTime->tv_sec ) * 1000000000LL + pTime->tv_nsec;
+		}
+	}
+	int64_t nNow = rtclock_now_ns();
+
 	snd_seq_event_t *ev;
 	do {
 		if ( !seq_handle ) {
@@ -259,6 +341,7 @@ void AlsaMidiDriver::midi_action( snd_seq_t *seq_handle )
 		if ( m_bActive && ev != nullptr ) {
 
 			MidiMessage msg;
+			msg.m_nTimestamp = alsaMidiDriver_timestamp( ev, nNow, nQueueNow );
 
 			switch ( ev->type ) {
 			case SND_SEQ_EVENT_NOTEON:
@@ -514,7 +597,40 @@ void AlsaMidiDriver::getPortInfo( const QString& sPortName, int& nClient, int& n
 	ERRORLOG( "Midi port " + sPortName + " not found" );
 }
 
-void AlsaMidiDriver::handleQueueNote(Note* pNote)
+void AlsaMidiDriver::scheduleEvent( snd_seq_event_t* ev, int nFrame )
+{
+	if ( nFrame < m_nLastQueuedFrame ) {
+		nFrame = m_nLastQueuedFrame;
+	}
+	m_nLastQueuedFrame = nFrame;
+
+	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	if ( nFrame <= 0 || queueId < 0 || pAudioOutput == nullptr ||
+		 pAudioOutput->getSampleRate() == 0 ) {
+		snd_seq_ev_set_direct( ev );
+		return;
+	}
+
+	long long nNs = (long long)nFrame * 1000000000LL / pAudioOutput->getSampleRate();
+	snd_seq_real_time_t time;
+	time.tv_sec = nNs / 1000000000LL;
+	time.tv_nsec = nNs % 1000000000LL;
+
+	// Relative to the current time of the queue.
+	snd_seq_ev_schedule_real( ev, queueId, 1, &time );
+}
+
+void AlsaMidiDriver::flushQueuedEvents()
+{
+	m_nLastQueuedFrame = 0;
+
+	if ( seq_handle == nullptr ) {
+		return;
+	}
+	snd_seq_drain_output( seq_handle );
+}
+
+void AlsaMidiDriver::handleQueueNote( Note* pNote, int nFrame )
 {
 	if ( seq_handle == nullptr ) {
 		ERRORLOG( "seq_handle = NULL " );
@@ -530,28 +646,29 @@ void AlsaMidiDriver::handleQueueNote(Note* pNote)
 
 	snd_seq_event_t ev;
 
+	// The events are only written to the output buffer. They are
+	// all sent at once in flushQueuedEvents().
+
 	//Note off
 	snd_seq_ev_clear(&ev);
 		snd_seq_ev_set_source(&ev, outPortId);
 		snd_seq_ev_set_subs(&ev);
-		snd_seq_ev_set_direct(&ev);
+		scheduleEvent(&ev, nFrame);
 	snd_seq_ev_set_noteoff(&ev, channel, key, velocity);
 	snd_seq_event_output(seq_handle, &ev);
-	snd_seq_drain_output(seq_handle);
 
 	//Note on
 	//snd_seq_event_input(seq_handle, &ev);
 	snd_seq_ev_clear(&ev);
 		snd_seq_ev_set_source(&ev, outPortId);
 		snd_seq_ev_set_subs(&ev);
-		snd_seq_ev_set_direct(&ev);
+		scheduleEvent(&ev, nFrame);
 		//snd_seq_event_output_direct( seq_handle, ev );
 
 	snd_seq_ev_set_noteon(&ev, channel, key, velocity);
 	snd_seq_event_output(seq_handle, &ev);
 
 		//snd_seq_free_event(ev);
-	snd_seq_drain_output(seq_handle);
 }
 
 
@@ -573,7 +690,7 @@ void AlsaMidiDriver::handleOutgoingControlChange( int param, int value, int chan
 	snd_seq_event_output_direct(seq_handle, &ev);
 }
 
-void AlsaMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
+void AlsaMidiDriver::handleQueueNoteOff( int channel, int key, int velocity, int nFrame )
 {
 	if ( seq_handle == nullptr ) {
 		ERRORLOG( "seq_handle = NULL " );
@@ -594,10 +711,9 @@ void AlsaMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
 	snd_seq_ev_clear(&ev);
 		snd_seq_ev_set_source(&ev, outPortId);
 		snd_seq_ev_set_subs(&ev);
-		snd_seq_ev_set_direct(&ev);
+		scheduleEvent(&ev, nFrame);
 	snd_seq_ev_set_noteoff(&ev, channel, key, velocity);
 	snd_seq_event_output(seq_handle, &ev);
-	snd_seq_drain_output(seq_handle);
 }
 
 void AlsaMidiDriver::handleQueueAllNoteOff()
@@ -53,13 +53,25 @@ public:
 
 	void midi_action( snd_seq_t *seq_handle );
 	void getPortInfo( const QString& sPortName, int& nClient, int& nPort );
-	virtual void handleQueueNote(Note* pNote);
+	virtual void handleQueueNote( Note* pNote, int nFrame );
 	
-	virtual void handleQueueNoteOff( int channel, int key, int velocity );
+	virtual void handleQueueNoteOff( int channel, int key, int velocity, int nFrame );
 	virtual void handleQueueAllNoteOff();
 	virtual void handleOutgoingControlChange( int param, int value, int channel );
+	virtual void flushQueuedEvents();
 
 private:
+	/**
+	 * Schedules @a ev on the queue of the sequencer @a nFrame
+	 * frames after the current time or sends it directly if @a
+	 * nFrame is zero.
+	 */
+	void scheduleEvent( snd_seq_event_t* ev, int nFrame );
+
+	/** Offset of the latest event scheduled during the current
+		process cycle. Later events are never scheduled before it to
+		preserve their order.*/
+	int m_nLastQueuedFrame;
 };
 
 };
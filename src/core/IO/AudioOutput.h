@@ -26,10 +26,14 @@
 #include <core/config.h>
 #include <core/Object.h>
 #include <core/IO/TransportInfo.h>
+#include <core/IO/TrackOutputs.h>
 
 namespace H2Core
 {
 
+class Instrument;
+class InstrumentComponent;
+
 ///
 /// Base abstract class for audio output classes.
 ///
@@ -57,6 +61,93 @@ public:
 	virtual void stop() = 0;
 	virtual void locate( unsigned long nFrame ) = 0;
 	virtual void setBpm( float fBPM ) = 0;
+
+	/**
+	 * Per-track outputs of drivers writing all tracks to the
+	 * channels of a single device.
+	 *
+	 * \return nullptr if the driver does not provide such outputs
+	 * or uses a mechanism of its own, like the JackAudioDriver.
+	 */
+	virtual TrackOutputs* getTrackOutputs() const {
+		return nullptr;
+	}
+
+	/**
+	 * Buffers of the per-track outputs the Sampler renders a
+	 * component of an instrument into in addition to the main
+	 * output. Only valid within the current process cycle.
+	 *
+	 * \return nullptr if the driver does not provide such an output.
+	 */
+	virtual float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo ) {
+		TrackOutputs* pTrackOutputs = getTrackOutputs();
+		if ( pTrackOutputs == nullptr ) {
+			return nullptr;
+		}
+		return pTrackOutputs->getTrackOut_L( pInstr, pCompo );
+	}
+	/** Right channel counterpart of getTrackOut_L().*/
+	virtual float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo ) {
+		TrackOutputs* pTrackOutputs = getTrackOutputs();
+		if ( pTrackOutputs == nullptr ) {
+			return nullptr;
+		}
+		return pTrackOutputs->getTrackOut_R( pInstr, pCompo );
+	}
+	/**
+	 * \return Number of the track output shared by @a pInstr with
+	 * other instruments or -1 if its tracks are exclusive.
+	 */
+	virtual int getTrackOutputBus( Instrument* pInstr ) const {
+		TrackOutputs* pTrackOutputs = getTrackOutputs();
+		if ( pTrackOutputs == nullptr ) {
+			return -1;
+		}
+		return pTrackOutputs->getTrackOutputBus( pInstr );
+	}
+
+	/**
+	 * Buffers of the per-track output @a nTrack, counted from zero
+	 * in the order the tracks are assigned to the instruments. Only
+	 * valid within the current process cycle. Used to tap the
+	 * tracks, e.g. by the NetworkStemOutput.
+	 *
+	 * \return nullptr if the driver does not provide such an output.
+	 */
+	virtual float* getTrackBuffer_L( int nTrack ) {
+		TrackOutputs* pTrackOutputs = getTrackOutputs();
+		if ( pTrackOutputs == nullptr || nTrack < 0 ||
+			 nTrack >= pTrackOutputs->getTrackCount() ) {
+			return nullptr;
+		}
+		return pTrackOutputs->getTrackBuffer_L( nTrack );
+	}
+	/** Right channel counterpart of getTrackBuffer_L().*/
+	virtual float* getTrackBuffer_R( int nTrack ) {
+		TrackOutputs* pTrackOutputs = getTrackOutputs();
+		if ( pTrackOutputs == nullptr || nTrack < 0 ||
+			 nTrack >= pTrackOutputs->getTrackCount() ) {
+			return nullptr;
+		}
+		return pTrackOutputs->getTrackBuffer_R( nTrack );
+	}
+
+	/**
+	 * Buffers of a separate output the Sampler renders its previews
+	 * into instead of the main output, e.g. to audition samples on
+	 * headphones during playback. Only valid within the current
+	 * process cycle and zeroed before the Sampler is called.
+	 *
+	 * \return nullptr if the driver does not provide such an output.
+	 */
+	virtual float* getCueOut_L() {
+		return nullptr;
+	}
+	/** Right channel counterpart of getCueOut_L().*/
+	virtual float* getCueOut_R() {
+		return nullptr;
+	}
 };
 
 };
@@ -28,10 +28,23 @@
  */
 
 #include <core/IO/CoreAudioDriver.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
 
 #if defined(H2CORE_HAVE_COREAUDIO) || _DOXYGEN_
 
 #include "CoreServices/CoreServices.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__has_include)
+#if __has_include(<os/workgroup.h>)
+#include <os/workgroup.h>
+#define H2CORE_OS_WORKGROUP
+#endif
+#endif
+
 ///
 /// The Render Callback
 ///
@@ -45,20 +58,49 @@ static OSStatus renderProc(
 )
 {
 	H2Core::CoreAudioDriver* pDriver = ( H2Core::CoreAudioDriver * )inRefCon;
-	pDriver->mProcessCallback( pDriver->m_nBufferSize, NULL );
-	for ( unsigned i = 0; i < ioData->mNumberBuffers; i++ ) {
-		AudioBuffer &outData = ioData->mBuffers[ i ];
-		Float32* pOutData = ( float* )( outData.mData );
-
-		float *pAudioSource;
-		if ( i == 0 ) {
-			pAudioSource = pDriver->m_pOut_L;
+	// The render thread is owned by Core Audio.
+	H2Core::Dsp::disableDenormals();
+
+	// The stream is non-interleaved with one buffer per channel. As
+	// long as they are not larger than our own ones, the audio
+	// engine renders straight into the ones of the main output. The
+	// per-track outputs are copied into the following ones.
+	const float** ppChannels = pDriver->m_channelBuffers.data();
+	UInt32 nBuffers = std::min( ioData->mNumberBuffers, pDriver->m_nChannels );
+	if ( nBuffers >= 2 && inNumberFrames <= pDriver->m_nBufferSize ) {
+		pDriver->m_pDeviceOut_L = ( float* )( ioData->mBuffers[ 0 ].mData );
+		pDriver->m_pDeviceOut_R = ( float* )( ioData->mBuffers[ 1 ].mData );
+		pDriver->mProcessCallback( inNumberFrames, NULL );
+		pDriver->m_pDeviceOut_L = NULL;
+		pDriver->m_pDeviceOut_R = NULL;
+		if ( pDriver->m_pTrackOutputs != NULL ) {
+			pDriver->m_pTrackOutputs->getChannelBuffers( ppChannels, pDriver->m_pOut_L,
+														 pDriver->m_pOut_R, 0 );
+			for ( unsigned i = 2; i < nBuffers; i++ ) {
+				memcpy( ioData->mBuffers[ i ].mData, ppChannels[ i ],
+						inNumberFrames * sizeof( float ) );
+			}
+		}
+		return noErr;
+	}
+
+	UInt32 nRendered = 0;
+	while ( nRendered < inNumberFrames ) {
+		UInt32 nChunk = std::min( inNumberFrames - nRendered, pDriver->m_nBufferSize );
+		pDriver->mProcessCallback( nChunk, NULL );
+		if ( pDriver->m_pTrackOutputs != NULL ) {
+			pDriver->m_pTrackOutputs->getChannelBuffers( ppChannels, pDriver->m_pOut_L,
+														 pDriver->m_pOut_R, 0 );
 		} else {
-			pAudioSource = pDriver->m_pOut_R;
+			ppChannels[ 0 ] = pDriver->m_pOut_L;
+			ppChannels[ 1 ] = pDriver->m_pOut_R;
 		}
-		for ( unsigned j = 0; j < inNumberFrames; ++j ) {
-			pOutData[ j ] = pAudioSource[ j ];
+		for ( unsigned i = 0; i < ioData->mNumberBuffers; i++ ) {
+			Float32* pOutData = ( float* )( ioData->mBuffers[ i ].mData );
+			const float *pAudioSource = i < nBuffers ? ppChannels[ i ] : pDriver->m_pOut_R;
+			memcpy( pOutData + nRendered, pAudioSource, nChunk * sizeof( float ) );
 		}
+		nRendered += nChunk;
 	}
 
 	return noErr;
@@ -123,6 +165,113 @@ void CoreAudioDriver::retrieveBufferSize(void)
 	INFOLOG( QString( "Buffersize: %1" ).arg( m_nBufferSize ) );
 }
 
+void CoreAudioDriver::configureDevice( unsigned nBufferSize )
+{
+	OSStatus err = 0;
+
+	if ( nBufferSize > 0 && nBufferSize != m_nBufferSize ) {
+		AudioObjectPropertyAddress rangeAddress = {
+			kAudioDevicePropertyBufferFrameSizeRange,
+			kAudioObjectPropertyScopeGlobal,
+			kAudioObjectPropertyElementMaster
+		};
+		AudioValueRange range;
+		UInt32 dataSize = sizeof( range );
+		err = AudioObjectGetPropertyData( m_outputDevice, &rangeAddress,
+										  0, NULL, &dataSize, &range );
+		UInt32 nFrames = nBufferSize;
+		if ( err == noErr ) {
+			nFrames = ( UInt32 )std::min( std::max( ( Float64 )nBufferSize, range.mMinimum ),
+										  range.mMaximum );
+		}
+
+		AudioObjectPropertyAddress propertyAddress = {
+			kAudioDevicePropertyBufferFrameSize,
+			kAudioObjectPropertyScopeGlobal,
+			kAudioObjectPropertyElementMaster
+		};
+		err = AudioObjectSetPropertyData( m_outputDevice, &propertyAddress,
+										  0, NULL, sizeof( nFrames ), &nFrames );
+		if ( err != noErr ) {
+			ERRORLOG( QString( "Could not set BufferSize to %1" ).arg( nFrames ) );
+		}
+		retrieveBufferSize();
+	}
+
+	Float32 fUsage = Preferences::get_instance()->m_fCoreAudioIOCycleUsage;
+	AudioObjectPropertyAddress usageAddress = {
+		kAudioDevicePropertyIOCycleUsage,
+		kAudioObjectPropertyScopeGlobal,
+		kAudioObjectPropertyElementMaster
+	};
+	err = AudioObjectSetPropertyData( m_outputDevice, &usageAddress,
+									  0, NULL, sizeof( fUsage ), &fUsage );
+	if ( err != noErr ) {
+		ERRORLOG( QString( "Could not set IOCycleUsage to %1" ).arg( fUsage ) );
+	} else {
+		INFOLOG( QString( "IOCycleUsage: %1" ).arg( fUsage ) );
+	}
+}
+
+void CoreAudioDriver::retrieveWorkgroup(void)
+{
+#ifdef H2CORE_OS_WORKGROUP
+	if ( __builtin_available( macOS 11.0, * ) ) {
+		AudioObjectPropertyAddress propertyAddress = {
+			kAudioDevicePropertyIOThreadOSWorkgroup,
+			kAudioObjectPropertyScopeGlobal,
+			kAudioObjectPropertyElementMaster
+		};
+		os_workgroup_t workgroup = NULL;
+		UInt32 dataSize = sizeof( workgroup );
+		OSStatus err = AudioObjectGetPropertyData( m_outputDevice, &propertyAddress,
+												   0, NULL, &dataSize, &workgroup );
+		if ( err != noErr || workgroup == NULL ) {
+			WARNINGLOG( "Could not get the audio workgroup of the device" );
+			return;
+		}
+		Threads::setAudioWorkgroup( workgroup );
+		// The property hands out a reference of its own.
+		os_release( workgroup );
+		INFOLOG( "Worker threads join the audio workgroup of the device" );
+	}
+#endif
+}
+
+UInt32 CoreAudioDriver::retrieveOutputChannels(void)
+{
+	UInt32 dataSize = 0;
+	OSStatus err = 0;
+
+	AudioObjectPropertyAddress propertyAddress = {
+		kAudioDevicePropertyStreamConfiguration,
+		kAudioDevicePropertyScopeOutput,
+		kAudioObjectPropertyElementMaster
+	};
+
+	err = AudioObjectGetPropertyDataSize( m_outputDevice, &propertyAddress,
+										  0, NULL, &dataSize );
+	if ( err != noErr || dataSize == 0 ) {
+		ERRORLOG( "get StreamConfiguration size error" );
+		return 2;
+	}
+
+	std::vector<char> bufferList( dataSize );
+	AudioBufferList* pBufferList = reinterpret_cast<AudioBufferList*>( bufferList.data() );
+	err = AudioObjectGetPropertyData( m_outputDevice, &propertyAddress,
+									  0, NULL, &dataSize, pBufferList );
+	if ( err != noErr ) {
+		ERRORLOG( "get StreamConfiguration error" );
+		return 2;
+	}
+
+	UInt32 nChannels = 0;
+	for ( UInt32 i = 0; i < pBufferList->mNumberBuffers; i++ ) {
+		nChannels += pBufferList->mBuffers[ i ].mNumberChannels;
+	}
+	return nChannels;
+}
+
 void CoreAudioDriver::printStreamInfo(void)
 {
 	AudioStreamBasicDescription outputStreamBasicDescription;
@@ -162,6 +311,10 @@ CoreAudioDriver::CoreAudioDriver( audioProcessCallback processCallback )
 		, mProcessCallback( processCallback )
 		, m_pOut_L( NULL )
 		, m_pOut_R( NULL )
+		, m_pDeviceOut_L( NULL )
+		, m_pDeviceOut_R( NULL )
+		, m_nChannels( 2 )
+		, m_pTrackOutputs( NULL )
 {
 	//INFOLOG( "INIT" );
 	m_nSampleRate = Preferences::get_instance()->m_nSampleRate;
@@ -182,6 +335,7 @@ CoreAudioDriver::~CoreAudioDriver()
 {
 	//INFOLOG( "DESTROY" );
 	disconnect();
+	delete m_pTrackOutputs;
 }
 
 
@@ -190,6 +344,8 @@ int CoreAudioDriver::init( unsigned bufferSize )
 {
 	OSStatus err = noErr;
 
+	configureDevice( bufferSize );
+
 	m_pOut_L = new float[ m_nBufferSize ];
 	m_pOut_R = new float[ m_nBufferSize ];
 
@@ -233,6 +389,24 @@ int CoreAudioDriver::init( unsigned bufferSize )
 		ERRORLOG( "Could not set Current Device" );
 	}
 
+	// Devices providing fewer channels than requested carry as many
+	// track outputs as fit.
+	m_nChannels = std::max( 2, Preferences::get_instance()->m_nOutputChannels );
+	UInt32 nDeviceChannels = retrieveOutputChannels();
+	if ( m_nChannels > 2 && nDeviceChannels < m_nChannels ) {
+		WARNINGLOG( QString( "%1 channels requested but the device provides only %2" )
+					.arg( m_nChannels ).arg( nDeviceChannels ) );
+		m_nChannels = std::max( ( UInt32 )2, nDeviceChannels );
+	}
+	INFOLOG( QString( "Channels: %1" ).arg( m_nChannels ) );
+
+	delete m_pTrackOutputs;
+	m_pTrackOutputs = NULL;
+	if ( m_nChannels > 2 ) {
+		m_pTrackOutputs = new TrackOutputs( m_nChannels, m_nBufferSize );
+	}
+	m_channelBuffers.assign( m_nChannels, NULL );
+
 	AudioStreamBasicDescription asbdesc;
 	asbdesc.mSampleRate = ( Float64 )m_nSampleRate;
 	asbdesc.mFormatID = kAudioFormatLinearPCM;
@@ -240,7 +414,7 @@ int CoreAudioDriver::init( unsigned bufferSize )
 	asbdesc.mBytesPerPacket = sizeof( Float32 );
 	asbdesc.mFramesPerPacket = 1;
 	asbdesc.mBytesPerFrame = sizeof( Float32 );
-	asbdesc.mChannelsPerFrame = 2;	// comix: was set to 1
+	asbdesc.mChannelsPerFrame = m_nChannels;
 	asbdesc.mBitsPerChannel = 32;
 
 
@@ -290,6 +464,8 @@ int CoreAudioDriver::connect()
 		ERRORLOG( "Could not start AudioUnit" );
 	}
 
+	retrieveWorkgroup();
+
 	m_bIsRunning = true;
 	return 0;
 }
@@ -300,6 +476,7 @@ void CoreAudioDriver::disconnect()
 {
 	OSStatus err = noErr;
 	err = AudioOutputUnitStop( m_outputUnit );
+	Threads::setAudioWorkgroup( NULL );
 	err = AudioUnitUninitialize( m_outputUnit );
 	err = AudioComponentInstanceDispose( m_outputUnit );
 }
@@ -324,14 +501,14 @@ void CoreAudioDriver::stop()
 
 float* CoreAudioDriver::getOut_L()
 {
-	return m_pOut_L;
+	return m_pDeviceOut_L != NULL ? m_pDeviceOut_L : m_pOut_L;
 }
 
 
 
 float* CoreAudioDriver::getOut_R()
 {
-	return m_pOut_R;
+	return m_pDeviceOut_R != NULL ? m_pDeviceOut_R : m_pOut_R;
 }
 
 
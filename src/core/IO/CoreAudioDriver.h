@@ -40,6 +40,7 @@
 
 #include <core/Preferences.h>
 #include <inttypes.h>
+#include <vector>
 
 
 typedef int ( *audioProcessCallback )( uint32_t, void * );
@@ -62,6 +63,19 @@ public:
 
 	float* m_pOut_L;
 	float* m_pOut_R;
+	/** Buffers of Core Audio the audio engine renders into directly
+		while renderProc() is running and NULL otherwise.*/
+	float* m_pDeviceOut_L;
+	float* m_pDeviceOut_R;
+	/** Number of channels of the stream chosen in init()
+		according to Preferences::m_nOutputChannels.*/
+	UInt32 m_nChannels;
+	/** Per-track outputs copied to the channels following the
+		main output. NULL if the stream is stereo.*/
+	TrackOutputs* m_pTrackOutputs;
+	/** Buffers of all #m_nChannels channels. Allocated in init()
+		to not do so in renderProc().*/
+	std::vector<const float*> m_channelBuffers;
 
 	CoreAudioDriver( audioProcessCallback processCallback );
 	virtual ~CoreAudioDriver();
@@ -76,7 +90,9 @@ public:
 
 	float* getOut_L();
 	float* getOut_R();
-
+	virtual TrackOutputs* getTrackOutputs() const {
+		return m_pTrackOutputs;
+	}
 
 	virtual void play();
 	virtual void stop();
@@ -89,6 +105,16 @@ public:
 private:
 	void retrieveDefaultDevice(void);
 	void retrieveBufferSize(void);
+	/** Requests @a nBufferSize frames per IO cycle, clamped to the
+		range supported by #m_outputDevice, and applies
+		Preferences::m_fCoreAudioIOCycleUsage. 0 keeps the buffer
+		size of the device.*/
+	void configureDevice( unsigned nBufferSize );
+	/** Passes the audio workgroup of the IO thread of #m_outputDevice
+		to Threads::setAudioWorkgroup().*/
+	void retrieveWorkgroup(void);
+	/** \return Number of output channels of #m_outputDevice.*/
+	UInt32 retrieveOutputChannels(void);
 	void printStreamInfo(void);
 
 
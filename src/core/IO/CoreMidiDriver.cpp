@@ -32,6 +32,7 @@
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Preferences.h>
+#include <core/rt_clock.h>
 #include <core/IO/CoreMidiDriver.h>
 
 #if defined(H2CORE_HAVE_COREMIDI) || _DOXYGEN_
@@ -52,6 +53,7 @@ static void midiProc ( const MIDIPacketList * pktlist,
 
 	CoreMidiDriver *instance = ( CoreMidiDriver * )readProcRefCon;
 	MidiMessage msg;
+	msg.m_nTimestamp = rtclock_now_ns();
 	for ( uint i = 0; i < pktlist->numPackets; i++ ) {
 		int nEventType = packet->data[0];
 		if ( ( nEventType >= 128 ) && ( nEventType < 144 ) ) {	// note off
@@ -95,6 +97,10 @@ static void midiProc ( const MIDIPacketList * pktlist,
 		instance->handleMidiMessage( msg );
 		packet = MIDIPacketNext( packet );
 	}
+
+	// CoreMIDI does only call us on incoming messages. Held back
+	// control changes are dispatched with the next packet.
+	instance->flushControlChanges();
 }
 
 
@@ -265,7 +271,7 @@ std::vector<QString> CoreMidiDriver::getOutputPortList()
 	return cmPortList;
 }
 
-void CoreMidiDriver::handleQueueNote(Note* pNote)
+void CoreMidiDriver::handleQueueNote( Note* pNote, int nFrame )
 {
 	if (cmH2Dst == 0 ) {
 		ERRORLOG( "cmH2Dst = 0 " );
@@ -298,7 +304,7 @@ void CoreMidiDriver::handleQueueNote(Note* pNote)
 	sendMidiPacket ( &packetList );
 }
 
-void CoreMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
+void CoreMidiDriver::handleQueueNoteOff( int channel, int key, int velocity, int nFrame )
 {
 	if (cmH2Dst == 0 ) {
 		ERRORLOG( "cmH2Dst = 0 " );
@@ -52,8 +52,8 @@ public:
 	virtual std::vector<QString> getInputPortList();
 	virtual std::vector<QString> getOutputPortList();
 
-	virtual void handleQueueNote(Note* pNote);
-	virtual void handleQueueNoteOff( int channel, int key, int velocity );
+	virtual void handleQueueNote( Note* pNote, int nFrame );
+	virtual void handleQueueNoteOff( int channel, int key, int velocity, int nFrame );
 	virtual void handleQueueAllNoteOff();
 	virtual void handleOutgoingControlChange( int param, int value, int channel );
 
@@ -27,12 +27,30 @@
 #include <core/EventQueue.h>
 #include <core/Hydrogen.h>
 #include <core/Timeline.h>
+#include <core/Basics/AutomationPath.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
 #include <core/IO/DiskWriterDriver.h>
+#include <core/IO/ExportWriter.h>
+#include <core/ProcessProfiler.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+#include <core/Helpers/TickTime.h>
+#include <core/Sampler/Sampler.h>
+#ifdef H2CORE_HAVE_LADSPA
+#include <core/FX/Effects.h>
+#include <core/FX/LadspaFX.h>
+#endif
 
 #include <pthread.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 
 #if defined(WIN32) || _DOXYGEN_
 #include <windows.h>
@@ -51,11 +69,82 @@ namespace H2Core
 
 pthread_t diskWriterDriverThread;
 
+/** Upper bound of the samples held by the render cache of a single
+	export (512 MiB).*/
+static const size_t nMaxRenderCacheSamples = 128 * 1024 * 1024;
+
+/**
+ * Checks whether the columns of @a pSong can be taken from the render
+ * cache. Each occurrence of a combination of patterns has to result
+ * in the very same audio. This is not the case for randomized notes
+ * and samples, effects carrying state from one column into the next,
+ * or audio not rendered from patterns.
+ */
+static bool renderCacheIsUsable( Song* pSong )
+{
+	if ( pSong->getHumanizeTimeValue() != 0 ||
+		 pSong->getHumanizeVelocityValue() != 0 ) {
+		___INFOLOG( "Render cache disabled: humanization is used" );
+		return false;
+	}
+	if ( ! pSong->getVelocityAutomationPath()->empty() ) {
+		___INFOLOG( "Render cache disabled: velocity automation is used" );
+		return false;
+	}
+	if ( pSong->getPlaybackTrackEnabled() ) {
+		___INFOLOG( "Render cache disabled: playback track is used" );
+		return false;
+	}
+	if ( Preferences::get_instance()->m_bUseMetronome ) {
+		___INFOLOG( "Render cache disabled: metronome is used" );
+		return false;
+	}
+
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX != nullptr && pFX->isEnabled() ) {
+			___INFOLOG( "Render cache disabled: LADSPA effects are used" );
+			return false;
+		}
+	}
+#endif
+
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		Instrument* pInstrument = pInstrumentList->get( ii );
+		if ( pInstrument->get_random_pitch_factor() != 0 ||
+			 pInstrument->sample_selection_alg() != Instrument::VELOCITY ) {
+			___INFOLOG( QString( "Render cache disabled: instrument [%1] is randomized" )
+						.arg( pInstrument->get_name() ) );
+			return false;
+		}
+	}
+
+	PatternList* pPatternList = pSong->getPatternList();
+	for ( int ii = 0; ii < pPatternList->size(); ++ii ) {
+		Pattern* pPattern = pPatternList->get( ii );
+		FOREACH_NOTE_CST_IT_BEGIN_END( pPattern->get_notes(), it ) {
+			const Note* pNote = it->second;
+			if ( pNote->get_probability() < 1 || pNote->get_lead_lag() != 0 ) {
+				___INFOLOG( QString( "Render cache disabled: pattern [%1] contains randomized or shifted notes" )
+							.arg( pPattern->get_name() ) );
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 void* diskWriterDriver_thread( void* param )
 {
 	Object* __object = ( Object* )param;	
 	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
 
+	Threads::configureCurrentThread( Threads::Role::Background, "disk writer" );
+	Dsp::disableDenormals();
+
 	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
 	
 	pDriver->setBpm( Hydrogen::get_instance()->getSong()->getBpm() );
@@ -66,89 +155,6 @@ void* diskWriterDriver_thread( void* param )
 	// always rolling, no user interaction
 	pDriver->m_transport.m_status = TransportInfo::ROLLING;
 
-	SF_INFO soundInfo;
-	soundInfo.samplerate = pDriver->m_nSampleRate;
-//	soundInfo.frames = -1;//getNFrames();		///\todo: da terminare
-	soundInfo.channels = 2;
-	//default format
-	int sfformat = 0x010000; //wav format (default)
-	int bits = 0x0002; //16 bit PCM (default)
-	//sf_format switch
-	if( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ){
-		sfformat =  0x020000; //Apple/SGI AIFF format (big endian)
-	}
-	if( pDriver->m_sFilename.endsWith(".flac") || pDriver->m_sFilename.endsWith(".FLAC") ){
-		sfformat =  0x170000; //FLAC lossless file format
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ) ){
-		bits = 0x0001; //Signed 8 bit data works with aiff
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".wav") || pDriver->m_sFilename.endsWith(".WAV") ) ){
-		bits = 0x0005; //Unsigned 8 bit data needed for Microsoft WAV format
-	}
-	if( pDriver->m_nSampleDepth == 16 ){
-		bits = 0x0002; //Signed 16 bit data
-	}
-	if( pDriver->m_nSampleDepth == 24 ){
-		bits = 0x0003; //Signed 24 bit data
-	}
-	if( pDriver->m_nSampleDepth == 32 ){
-		bits = 0x0004; ////Signed 32 bit data
-	}
-
-	soundInfo.format =  sfformat|bits;
-
-//	#ifdef HAVE_OGGVORBIS
-
-	//ogg vorbis option
-	if( pDriver->m_sFilename.endsWith( ".ogg" ) | pDriver->m_sFilename.endsWith( ".OGG" ) ) {
-		soundInfo.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
-	}
-
-//	#endif
-
-
-///formats
-//          SF_FORMAT_WAV          = 0x010000,     /* Microsoft WAV format (little endian). */
-//          SF_FORMAT_AIFF         = 0x020000,     /* Apple/SGI AIFF format (big endian). */
-//          SF_FORMAT_AU           = 0x030000,     /* Sun/NeXT AU format (big endian). */
-//          SF_FORMAT_RAW          = 0x040000,     /* RAW PCM data. */
-//          SF_FORMAT_PAF          = 0x050000,     /* Ensoniq PARIS file format. */
-//          SF_FORMAT_SVX          = 0x060000,     /* Amiga IFF / SVX8 / SV16 format. */
-//          SF_FORMAT_NIST         = 0x070000,     /* Sphere NIST format. */
-//          SF_FORMAT_VOC          = 0x080000,     /* VOC files. */
-//          SF_FORMAT_IRCAM        = 0x0A0000,     /* Berkeley/IRCAM/CARL */
-//          SF_FORMAT_W64          = 0x0B0000,     /* Sonic Foundry's 64 bit RIFF/WAV */
-//          SF_FORMAT_MAT4         = 0x0C0000,     /* Matlab (tm) V4.2 / GNU Octave 2.0 */
-//          SF_FORMAT_MAT5         = 0x0D0000,     /* Matlab (tm) V5.0 / GNU Octave 2.1 */
-//          SF_FORMAT_PVF          = 0x0E0000,     /* Portable Voice Format */
-//          SF_FORMAT_XI           = 0x0F0000,     /* Fasttracker 2 Extended Instrument */
-//          SF_FORMAT_HTK          = 0x100000,     /* HMM Tool Kit format */
-//          SF_FORMAT_SDS          = 0x110000,     /* Midi Sample Dump Standard */
-//          SF_FORMAT_AVR          = 0x120000,     /* Audio Visual Research */
-//          SF_FORMAT_WAVEX        = 0x130000,     /* MS WAVE with WAVEFORMATEX */
-//          SF_FORMAT_SD2          = 0x160000,     /* Sound Designer 2 */
-//          SF_FORMAT_FLAC         = 0x170000,     /* FLAC lossless file format */
-//          SF_FORMAT_CAF          = 0x180000,     /* Core Audio File format */
-//	    SF_FORMAT_OGG
-///bits
-//          SF_FORMAT_PCM_S8       = 0x0001,       /* Signed 8 bit data */
-//          SF_FORMAT_PCM_16       = 0x0002,       /* Signed 16 bit data */
-//          SF_FORMAT_PCM_24       = 0x0003,       /* Signed 24 bit data */
-//          SF_FORMAT_PCM_32       = 0x0004,       /* Signed 32 bit data */
-///used for ogg
-//          SF_FORMAT_VORBIS
-
-	if ( !sf_format_check( &soundInfo ) ) {
-		__ERRORLOG( "Error in soundInfo" );
-		return nullptr;
-	}
-
-
-	SNDFILE* m_file = sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
-
-	float *pData = new float[ pDriver->m_nBufferSize * 2 ];	// always stereo
-
 	float *pData_L = pDriver->m_pOut_L;
 	float *pData_R = pDriver->m_pOut_R;
 
@@ -158,11 +164,30 @@ void* diskWriterDriver_thread( void* param )
 
 	std::vector<PatternList*> *pPatternColumns = pSong->getPatternGroupVector();
 	int nColumns = pPatternColumns->size();
+
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	bool bUseRenderCache = Preferences::get_instance()->m_bExportRenderCache &&
+		renderCacheIsUsable( pSong );
+	pDriver->m_renderCache.clear();
+	pDriver->m_nRenderCacheSamples = 0;
+
+	// Channels in the order they are stored in the render cache.
+	std::vector<const float*> channels = { pData_L, pData_R };
+	for ( const auto& stem : pDriver->m_stems ) {
+		channels.push_back( stem.pOut_L );
+		channels.push_back( stem.pOut_R );
+	}
+	int nCachedColumns = 0;
+
+	// Throughput reported to the ProcessProfiler.
+	ProcessProfiler* pProfiler = AudioEngine::get_instance()->get_profiler();
+	const auto exportStart = std::chrono::steady_clock::now();
+	long long nExportedFrames = 0;
 	
 	int nPatternSize;
 	int validBpm = pEngine->getSong()->getBpm();
 	float oldBPM = 0;
-	float fTicksize = 0;
+	int64_t nTickSize = 0;
 	
 	for ( int patternPosition = 0; patternPosition < nColumns; ++patternPosition ) {
 		PatternList *pColumn = ( *pPatternColumns )[ patternPosition ];
@@ -185,9 +210,8 @@ void* diskWriterDriver_thread( void* param )
 			}
 			
 			pDriver->setBpm(validBpm);
-			fTicksize = AudioEngine::compute_tick_size( pDriver->m_nSampleRate,
-														validBpm,
-														pSong->getResolution() );
+			nTickSize = TickTime::tickSize( pDriver->m_nSampleRate, validBpm,
+											pSong->getResolution() );
 			pDriver->audioEngine_process_checkBPMChanged();
 			pEngine->setPatternPos(patternPosition);
 			
@@ -202,17 +226,53 @@ void* diskWriterDriver_thread( void* param )
 		}
 		else
 		{
-			fTicksize = AudioEngine::compute_tick_size( pDriver->m_nSampleRate,
-														pSong->getBpm(),
-														pSong->getResolution() );
+			nTickSize = TickTime::tickSize( pDriver->m_nSampleRate, pSong->getBpm(),
+											pSong->getResolution() );
 			//pDriver->m_transport.m_fTickSize = ticksize;
 		}
-		
+		const float fTicksize = static_cast<float>( TickTime::toFrames( nTickSize ) );
 		
 		//here we have the pattern length in frames dependent from bpm and samplerate
-		unsigned patternLengthInFrames = fTicksize * nPatternSize;
-		
-		unsigned frameNumber = 0;
+		unsigned patternLengthInFrames =
+			static_cast<unsigned>( TickTime::frameAtTick( nPatternSize, nTickSize ) );
+
+		// A column is only taken from or put into the render cache if
+		// no voice of a previous one is ringing into it.
+		bool bCacheColumn = bUseRenderCache && pSampler->getPlayingNotesNumber() == 0;
+		const DiskWriterDriver::CachedColumn* pCached = nullptr;
+		if ( bCacheColumn ) {
+			pCached = pDriver->findCachedColumn( pColumn, fTicksize, patternLengthInFrames );
+		}
+
+		if ( pCached != nullptr ) {
+			for ( unsigned nFrame = 0; nFrame < patternLengthInFrames;
+				  nFrame += pDriver->m_nBufferSize ) {
+				unsigned nFrames = std::min( pDriver->m_nBufferSize,
+											 patternLengthInFrames - nFrame );
+				const float* pChannel = pCached->data.data() + nFrame;
+				for ( auto pWriter : pDriver->m_writers ) {
+					pWriter->write( pChannel, pChannel + patternLengthInFrames, nFrames );
+				}
+				for ( const auto& stem : pDriver->m_stems ) {
+					pChannel += 2 * patternLengthInFrames;
+					if ( stem.pWriter != nullptr ) {
+						stem.pWriter->write( pChannel, pChannel + patternLengthInFrames, nFrames );
+					}
+				}
+			}
+			pEngine->skipExport( pDriver->m_transport.m_nFrames + patternLengthInFrames,
+								 pEngine->getTickForPosition( patternPosition + 1 ) );
+			++nCachedColumns;
+		}
+
+		std::vector<float> renderedColumn;
+		if ( pCached == nullptr && bCacheColumn &&
+			 pDriver->m_nRenderCacheSamples + channels.size() * patternLengthInFrames <=
+			 nMaxRenderCacheSamples ) {
+			renderedColumn.resize( channels.size() * patternLengthInFrames );
+		}
+
+		unsigned frameNumber = pCached != nullptr ? patternLengthInFrames : 0;
 		int lastRun = 0;
 		while ( frameNumber < patternLengthInFrames ) {
 			
@@ -233,43 +293,75 @@ void* diskWriterDriver_thread( void* param )
 			while( ret != 0) {
 				ret = pDriver->m_processCallback( usedBuffer, nullptr );
 			}
-			
-			for ( unsigned i = 0; i < usedBuffer; i++ ) {
-				if(pData_L[i] > 1){
-					pData[i * 2] = 1;
-				}
-				else if(pData_L[i] < -1){
-					pData[i * 2] = -1;
-				}else
-				{
-					pData[i * 2] = pData_L[i];
-				}
-				
-				if(pData_R[i] > 1){
-					pData[i * 2 + 1] = 1;
+
+			// Clipping and encoding are done by the writer threads
+			// while the next buffer is rendered.
+			for ( auto pWriter : pDriver->m_writers ) {
+				pWriter->write( pData_L, pData_R, usedBuffer );
+			}
+			for ( const auto& stem : pDriver->m_stems ) {
+				if ( stem.pWriter != nullptr ) {
+					stem.pWriter->write( stem.pOut_L, stem.pOut_R, usedBuffer );
 				}
-				else if(pData_R[i] < -1){
-					pData[i * 2 + 1] = -1;
-				}else
-				{
-					pData[i * 2 + 1] = pData_R[i];
+			}
+
+			if ( ! renderedColumn.empty() ) {
+				float* pFrame = renderedColumn.data() + frameNumber - usedBuffer;
+				for ( auto pChannel : channels ) {
+					memcpy( pFrame, pChannel, usedBuffer * sizeof( float ) );
+					pFrame += patternLengthInFrames;
 				}
 			}
-			int res = sf_writef_float( m_file, pData, usedBuffer );
-			if ( res != ( int )usedBuffer ) {
-				__ERRORLOG( "Error during sf_write_float" );
+		}
+
+		// Columns rendering into the next one would be cut short.
+		if ( ! renderedColumn.empty() && pSampler->getPlayingNotesNumber() == 0 ) {
+			DiskWriterDriver::CachedColumn column;
+			for ( int ii = 0; ii < pColumn->size(); ++ii ) {
+				column.patterns.push_back( pColumn->get( ii ) );
 			}
+			column.fTickSize = fTicksize;
+			column.nFrames = patternLengthInFrames;
+			pDriver->m_nRenderCacheSamples += renderedColumn.size();
+			column.data.swap( renderedColumn );
+			pDriver->m_renderCache.push_back( std::move( column ) );
 		}
 		
+		nExportedFrames += patternLengthInFrames;
+		const double fElapsed = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - exportStart ).count();
+		if ( fElapsed > 0 && pDriver->m_nSampleRate > 0 ) {
+			pProfiler->setExportRealtimeFactor(
+				static_cast<float>( nExportedFrames / static_cast<double>( pDriver->m_nSampleRate ) /
+									fElapsed ) );
+		}
+
 		// this progress bar method is not exact but ok enough to give users a usable visible progress feedback
 		float fPercent = ( float )(patternPosition +1) / ( float )nColumns * 100.0;
-		EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+		// 100 is pushed once all files are closed.
+		if ( fPercent < 100 ) {
+			EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+		}
 	}
 
-	delete[] pData;
-	pData = nullptr;
+	// Wait for the encoders to write the remaining frames.
+	for ( auto pWriter : pDriver->m_writers ) {
+		pWriter->stop();
+	}
+	for ( const auto& stem : pDriver->m_stems ) {
+		if ( stem.pWriter != nullptr ) {
+			stem.pWriter->stop();
+		}
+	}
 
-	sf_close( m_file );
+	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
+
+	if ( bUseRenderCache ) {
+		__INFOLOG( QString( "%1 of %2 columns taken from the render cache" )
+				   .arg( nCachedColumns ).arg( nColumns ) );
+	}
+	pDriver->m_renderCache.clear();
+	pDriver->m_nRenderCacheSamples = 0;
 
 	__INFOLOG( "DiskWriterDriver thread end" );
 
@@ -282,14 +374,17 @@ void* diskWriterDriver_thread( void* param )
 
 const char* DiskWriterDriver::__class_name = "DiskWriterDriver";
 
-DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, int nSampleDepth )
+DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate,
+									int nSampleDepth, unsigned nFileSampleRate )
 		: AudioOutput( __class_name )
 		, m_nSampleRate( nSamplerate )
+		, m_nFileSampleRate( nFileSampleRate != 0 ? nFileSampleRate : nSamplerate )
 		, m_nSampleDepth ( nSampleDepth )
 		, m_processCallback( processCallback )
 		, m_nBufferSize( 0 )
 		, m_pOut_L( nullptr )
 		, m_pOut_R( nullptr )
+		, m_nRenderCacheSamples( 0 )
 {
 	INFOLOG( "INIT" );
 }
@@ -322,6 +417,43 @@ int DiskWriterDriver::init( unsigned nBufferSize )
 int DiskWriterDriver::connect()
 {
 	INFOLOG( "[startExport]" );
+
+	// Without a main file only the stems are exported.
+	QStringList fileNames = m_additionalFileNames;
+	if ( ! m_sFilename.isEmpty() ) {
+		fileNames.prepend( m_sFilename );
+	}
+	for ( const auto& sFilename : fileNames ) {
+		ExportWriter* pWriter = new ExportWriter();
+		if ( ! pWriter->start( sFilename, m_nFileSampleRate, m_nSampleDepth, false,
+							   m_nSampleRate, true ) ) {
+			ERRORLOG( QString( "Unable to export to [%1]" ).arg( sFilename ) );
+			delete pWriter;
+			return 1;
+		}
+		m_writers.push_back( pWriter );
+	}
+
+	m_stemMap.assign( MAX_INSTRUMENTS, -1 );
+	for ( int ii = 0; ii < static_cast<int>( m_stems.size() ); ++ii ) {
+		Stem& stem = m_stems[ ii ];
+		if ( stem.nInstrumentId >= 0 && stem.nInstrumentId < MAX_INSTRUMENTS ) {
+			m_stemMap[ stem.nInstrumentId ] = ii;
+		}
+
+		stem.pOut_L = new float[ m_nBufferSize ];
+		stem.pOut_R = new float[ m_nBufferSize ];
+		memset( stem.pOut_L, 0, m_nBufferSize * sizeof( float ) );
+		memset( stem.pOut_R, 0, m_nBufferSize * sizeof( float ) );
+
+		stem.pWriter = new ExportWriter();
+		if ( ! stem.pWriter->start( stem.sFilename, m_nFileSampleRate,
+									m_nSampleDepth, false, m_nSampleRate ) ) {
+			ERRORLOG( QString( "Unable to export stem [%1]" ).arg( stem.sFilename ) );
+			delete stem.pWriter;
+			stem.pWriter = nullptr;
+		}
+	}
 	
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
@@ -336,6 +468,21 @@ int DiskWriterDriver::connect()
 void DiskWriterDriver::disconnect()
 {
 		INFOLOG( "[disconnect]" );
+
+	for ( auto pWriter : m_writers ) {
+		delete pWriter;
+	}
+	m_writers.clear();
+	m_additionalFileNames.clear();
+
+	for ( auto& stem : m_stems ) {
+		delete stem.pWriter;
+		delete[] stem.pOut_L;
+		delete[] stem.pOut_R;
+	}
+	m_stems.clear();
+	m_stemMap.clear();
+
 	delete[] m_pOut_L;
 	m_pOut_L = nullptr;
 
@@ -346,6 +493,75 @@ void DiskWriterDriver::disconnect()
 
 
 
+void DiskWriterDriver::addFileName( const QString& sFilename )
+{
+	m_additionalFileNames << sFilename;
+}
+
+void DiskWriterDriver::addStem( Instrument* pInstrument, const QString& sFilename )
+{
+	Stem stem;
+	stem.nInstrumentId = pInstrument->get_id();
+	stem.sFilename = sFilename;
+	stem.pOut_L = nullptr;
+	stem.pOut_R = nullptr;
+	stem.pWriter = nullptr;
+	m_stems.push_back( stem );
+}
+
+const DiskWriterDriver::CachedColumn* DiskWriterDriver::findCachedColumn( PatternList* pColumn,
+																			float fTickSize,
+																			unsigned nFrames ) const
+{
+	for ( const auto& column : m_renderCache ) {
+		if ( column.fTickSize != fTickSize || column.nFrames != nFrames ||
+			 column.patterns.size() != static_cast<size_t>( pColumn->size() ) ) {
+			continue;
+		}
+		bool bMatch = true;
+		for ( int ii = 0; ii < pColumn->size(); ++ii ) {
+			if ( column.patterns[ ii ] != pColumn->get( ii ) ) {
+				bMatch = false;
+				break;
+			}
+		}
+		if ( bMatch ) {
+			return &column;
+		}
+	}
+	return nullptr;
+}
+
+void DiskWriterDriver::clearStemBuffers( uint32_t nFrames )
+{
+	for ( const auto& stem : m_stems ) {
+		if ( stem.pOut_L != nullptr ) {
+			memset( stem.pOut_L, 0, nFrames * sizeof( float ) );
+			memset( stem.pOut_R, 0, nFrames * sizeof( float ) );
+		}
+	}
+}
+
+float* DiskWriterDriver::getTrackOut_L( Instrument* pInstr, InstrumentComponent* /*pCompo*/ )
+{
+	int nId = pInstr->get_id();
+	if ( nId < 0 || nId >= static_cast<int>( m_stemMap.size() ) ||
+		 m_stemMap[ nId ] < 0 ) {
+		return nullptr;
+	}
+	return m_stems[ m_stemMap[ nId ] ].pOut_L;
+}
+
+float* DiskWriterDriver::getTrackOut_R( Instrument* pInstr, InstrumentComponent* /*pCompo*/ )
+{
+	int nId = pInstr->get_id();
+	if ( nId < 0 || nId >= static_cast<int>( m_stemMap.size() ) ||
+		 m_stemMap[ nId ] < 0 ) {
+		return nullptr;
+	}
+	return m_stems[ m_stemMap[ nId ] ].pOut_R;
+}
+
 unsigned DiskWriterDriver::getSampleRate()
 {
 	return m_nSampleRate;
@@ -391,24 +607,21 @@ void DiskWriterDriver::setBpm( float fBPM )
 void DiskWriterDriver::audioEngine_process_checkBPMChanged()
 {
 	auto pSong = Hydrogen::get_instance()->getSong();
-	float fNewTickSize = AudioEngine::compute_tick_size( getSampleRate(),
-														 pSong->getBpm(),
-														 pSong->getResolution() );
-
-	if ( fNewTickSize != m_transport.m_fTickSize ) {
-		// cerco di convertire ...
-		float fTickNumber =
-			( float )m_transport.m_nFrames
-			/ ( float )m_transport.m_fTickSize;
+	const int64_t nNewTickSize = TickTime::tickSize( getSampleRate(),
+													 pSong->getBpm(),
+													 pSong->getResolution() );
 
-		m_transport.m_fTickSize = fNewTickSize;
+	if ( nNewTickSize != m_transport.m_nTickSize ) {
+		const int64_t nOldTickSize = m_transport.m_nTickSize;
+		m_transport.setTickSize( nNewTickSize );
 
-		if ( m_transport.m_fTickSize == 0 ) {
+		if ( nNewTickSize == 0 || nOldTickSize == 0 ) {
 			return;
 		}
 
 		// update frame position
-		m_transport.m_nFrames = ( long long )( fTickNumber * fNewTickSize );
+		m_transport.m_nFrames = TickTime::rescale( m_transport.m_nFrames,
+												   nOldTickSize, nNewTickSize );
 
 		// currently unuseble here
 		//EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
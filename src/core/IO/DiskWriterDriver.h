@@ -27,12 +27,18 @@
 
 #include <inttypes.h>
 
+#include <vector>
+
 #include <core/IO/AudioOutput.h>
 #include <core/Object.h>
 
 namespace H2Core
 {
 
+class ExportWriter;
+class Pattern;
+class PatternList;
+
 typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 ///
@@ -43,7 +49,12 @@ class DiskWriterDriver : public AudioOutput
 	H2_OBJECT
 	public:
 
+		/** Rate the song is rendered at.*/
 		unsigned				m_nSampleRate;
+		/** Rate of the exported files. If it differs from
+			#m_nSampleRate, the ExportWriter threads resample the
+			rendered audio.*/
+		unsigned				m_nFileSampleRate;
 		QString					m_sFilename;
 		unsigned				m_nBufferSize;
 		int						m_nSampleDepth;
@@ -51,7 +62,10 @@ class DiskWriterDriver : public AudioOutput
 		float*					m_pOut_L;
 		float*					m_pOut_R;
 
-		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, int nSampleDepth );
+		/** \param nFileSampleRate Sets #m_nFileSampleRate. 0 is
+			the same as @a nSamplerate.*/
+		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate,
+						  int nSampleDepth, unsigned nFileSampleRate = 0 );
 		~DiskWriterDriver();
 
 		int init( unsigned nBufferSize );
@@ -76,9 +90,41 @@ class DiskWriterDriver : public AudioOutput
 			return m_pOut_R;
 		}
 		
+		/** Sets the file the main output is written to. If empty,
+			only the stems added via addStem() are written.*/
 		void  setFileName( const QString& sFilename ){
 			m_sFilename = sFilename;
 		}
+		/**
+		 * Writes the main output into @a sFilename too. Its format is
+		 * derived from the suffix, e.g. to create an Ogg/Vorbis
+		 * preview along with a WAV master without rendering the song
+		 * twice.
+		 *
+		 * Has to be called before connect(). All additional files are
+		 * removed again in disconnect().
+		 */
+		void addFileName( const QString& sFilename );
+
+		/**
+		 * Renders all components of @a pInstrument into a file of
+		 * their own during the same pass writing the main
+		 * output. Each of these stems is encoded by a separate
+		 * ExportWriter thread.
+		 *
+		 * Has to be called before connect(). All stems are removed
+		 * again in disconnect().
+		 */
+		void addStem( Instrument* pInstrument, const QString& sFilename );
+		bool hasStems() const {
+			return ! m_stems.empty();
+		}
+		/** Resets the buffers of all stems. Called at the beginning
+			of each process cycle.*/
+		void clearStemBuffers( uint32_t nFrames );
+
+		virtual float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo );
+		virtual float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo );
 
 		virtual void play();
 		virtual void stop();
@@ -90,8 +136,51 @@ class DiskWriterDriver : public AudioOutput
 		
 
 	private:
-
-
+		/** Files added via addFileName().*/
+		QStringList m_additionalFileNames;
+		/** Encoders of #m_sFilename and #m_additionalFileNames. They
+			are created in connect() and receive the main output of
+			each process cycle.*/
+		std::vector<ExportWriter*> m_writers;
+
+		struct Stem {
+			int nInstrumentId;
+			QString sFilename;
+			float* pOut_L;
+			float* pOut_R;
+			ExportWriter* pWriter;
+		};
+
+		/** Stems added via addStem().*/
+		std::vector<Stem> m_stems;
+		/** Index of the stem in #m_stems indexed by
+			Instrument::__id or -1. Filled in connect().*/
+		std::vector<int> m_stemMap;
+
+		/** Audio of a column rendered while
+			Preferences::m_bExportRenderCache is set.*/
+		struct CachedColumn {
+			/** Patterns of the column in their order.*/
+			std::vector<Pattern*> patterns;
+			float fTickSize;
+			unsigned nFrames;
+			/** Left and right channel of the main output followed
+				by those of all stems in #m_stems, each #nFrames
+				long.*/
+			std::vector<float> data;
+		};
+
+		/** Columns rendered during the current export.*/
+		std::vector<CachedColumn> m_renderCache;
+		/** Number of samples stored in #m_renderCache.*/
+		size_t m_nRenderCacheSamples;
+
+		/** \return Entry of #m_renderCache holding the same patterns
+			as @a pColumn rendered at @a fTickSize or nullptr.*/
+		const CachedColumn* findCachedColumn( PatternList* pColumn, float fTickSize,
+											  unsigned nFrames ) const;
+
+		friend void* diskWriterDriver_thread( void* param );
 };
 
 };
@@ -0,0 +1,462 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/IO/ExportWriter.h>
+#include <core/EventQueue.h>
+#include <core/Preferences.h>
+#include <core/Helpers/LoudnessMeter.h>
+#include <core/Helpers/Resampler.h>
+#include <core/Helpers/Threads.h>
+
+#include <QFile>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace H2Core
+{
+
+const char* ExportWriter::__class_name = "ExportWriter";
+
+static_assert( ( EXPORT_WRITER_FRAMES & ( EXPORT_WRITER_FRAMES - 1 ) ) == 0,
+			   "EXPORT_WRITER_FRAMES has to be a power of two" );
+
+/** Upper bound of the true peak of normalized files in dBTP.*/
+static const double fNormalizeTruePeakCeiling = -1.0;
+
+/** Analysis of all files closed since the last
+	ExportWriter::clearAnalyses().*/
+static std::vector<ExportWriter::Analysis> analyses;
+static std::mutex analysesMutex;
+
+/** Clips the frames produced by the Resampler to [-1,1]. The
+	filter may overshoot the frames clipped in write().*/
+static void clipFrames( std::vector<float>& frames )
+{
+	for ( auto& fValue : frames ) {
+		fValue = std::min( std::max( fValue, -1.0f ), 1.0f );
+	}
+}
+
+ExportWriter::ExportWriter()
+	: Object( __class_name )
+	, m_pFile( nullptr )
+	, m_pBuffer( nullptr )
+	, m_nWritePos( 0 )
+	, m_nReadPos( 0 )
+	, m_bFinished( false )
+	, m_bReportProgress( true )
+	, m_bDither( false )
+	, m_pResampler( nullptr )
+	, m_pLoudnessMeter( nullptr )
+	, m_nSampleRate( 0 )
+	, m_nSampleDepth( 0 )
+{
+}
+
+ExportWriter::~ExportWriter()
+{
+	stop();
+	delete[] m_pBuffer;
+	delete m_pResampler;
+	delete m_pLoudnessMeter;
+}
+
+std::vector<ExportWriter::Analysis> ExportWriter::getAnalyses()
+{
+	std::lock_guard<std::mutex> lock( analysesMutex );
+	return analyses;
+}
+
+void ExportWriter::clearAnalyses()
+{
+	std::lock_guard<std::mutex> lock( analysesMutex );
+	analyses.clear();
+}
+
+SNDFILE* ExportWriter::openFile( const QString& sFilename, unsigned nSampleRate,
+								 int nSampleDepth )
+{
+	SF_INFO soundInfo;
+	soundInfo.samplerate = nSampleRate;
+//	soundInfo.frames = -1;//getNFrames();		///\todo: da terminare
+	soundInfo.channels = 2;
+	//default format
+	int sfformat = 0x010000; //wav format (default)
+	int bits = 0x0002; //16 bit PCM (default)
+	//sf_format switch
+	if( sFilename.endsWith(".aiff") || sFilename.endsWith(".AIFF") ){
+		sfformat =  0x020000; //Apple/SGI AIFF format (big endian)
+	}
+	if( sFilename.endsWith(".flac") || sFilename.endsWith(".FLAC") ){
+		sfformat =  0x170000; //FLAC lossless file format
+	}
+	if( ( nSampleDepth == 8 ) && ( sFilename.endsWith(".aiff") || sFilename.endsWith(".AIFF") ) ){
+		bits = 0x0001; //Signed 8 bit data works with aiff
+	}
+	if( ( nSampleDepth == 8 ) && ( sFilename.endsWith(".wav") || sFilename.endsWith(".WAV") ) ){
+		bits = 0x0005; //Unsigned 8 bit data needed for Microsoft WAV format
+	}
+	if( nSampleDepth == 16 ){
+		bits = 0x0002; //Signed 16 bit data
+	}
+	if( nSampleDepth == 24 ){
+		bits = 0x0003; //Signed 24 bit data
+	}
+	if( nSampleDepth == 32 ){
+		bits = 0x0004; ////Signed 32 bit data
+	}
+
+	soundInfo.format =  sfformat|bits;
+
+//	#ifdef HAVE_OGGVORBIS
+
+	//ogg vorbis option
+	if( sFilename.endsWith( ".ogg" ) | sFilename.endsWith( ".OGG" ) ) {
+		soundInfo.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+	}
+
+//	#endif
+
+
+///formats
+//          SF_FORMAT_WAV          = 0x010000,     /* Microsoft WAV format (little endian). */
+//          SF_FORMAT_AIFF         = 0x020000,     /* Apple/SGI AIFF format (big endian). */
+//          SF_FORMAT_AU           = 0x030000,     /* Sun/NeXT AU format (big endian). */
+//          SF_FORMAT_RAW          = 0x040000,     /* RAW PCM data. */
+//          SF_FORMAT_PAF          = 0x050000,     /* Ensoniq PARIS file format. */
+//          SF_FORMAT_SVX          = 0x060000,     /* Amiga IFF / SVX8 / SV16 format. */
+//          SF_FORMAT_NIST         = 0x070000,     /* Sphere NIST format. */
+//          SF_FORMAT_VOC          = 0x080000,     /* VOC files. */
+//          SF_FORMAT_IRCAM        = 0x0A0000,     /* Berkeley/IRCAM/CARL */
+//          SF_FORMAT_W64          = 0x0B0000,     /* Sonic Foundry's 64 bit RIFF/WAV */
+//          SF_FORMAT_MAT4         = 0x0C0000,     /* Matlab (tm) V4.2 / GNU Octave 2.0 */
+//          SF_FORMAT_MAT5         = 0x0D0000,     /* Matlab (tm) V5.0 / GNU Octave 2.1 */
+//          SF_FORMAT_PVF          = 0x0E0000,     /* Portable Voice Format */
+//          SF_FORMAT_XI           = 0x0F0000,     /* Fasttracker 2 Extended Instrument */
+//          SF_FORMAT_HTK          = 0x100000,     /* HMM Tool Kit format */
+//          SF_FORMAT_SDS          = 0x110000,     /* Midi Sample Dump Standard */
+//          SF_FORMAT_AVR          = 0x120000,     /* Audio Visual Research */
+//          SF_FORMAT_WAVEX        = 0x130000,     /* MS WAVE with WAVEFORMATEX */
+//          SF_FORMAT_SD2          = 0x160000,     /* Sound Designer 2 */
+//          SF_FORMAT_FLAC         = 0x170000,     /* FLAC lossless file format */
+//          SF_FORMAT_CAF          = 0x180000,     /* Core Audio File format */
+//	    SF_FORMAT_OGG
+///bits
+//          SF_FORMAT_PCM_S8       = 0x0001,       /* Signed 8 bit data */
+//          SF_FORMAT_PCM_16       = 0x0002,       /* Signed 16 bit data */
+//          SF_FORMAT_PCM_24       = 0x0003,       /* Signed 24 bit data */
+//          SF_FORMAT_PCM_32       = 0x0004,       /* Signed 32 bit data */
+///used for ogg
+//          SF_FORMAT_VORBIS
+
+	if ( !sf_format_check( &soundInfo ) ) {
+		_ERRORLOG( "Error in soundInfo" );
+		return nullptr;
+	}
+
+	SNDFILE* pFile = sf_open( sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+	if ( pFile == nullptr ) {
+		_ERRORLOG( QString( "Unable to open [%1]: %2" )
+				   .arg( sFilename ).arg( sf_strerror( nullptr ) ) );
+	}
+
+	return pFile;
+}
+
+bool ExportWriter::start( const QString& sFilename, unsigned nSampleRate, int nSampleDepth,
+						  bool bReportProgress, unsigned nRenderSampleRate,
+						  bool bNormalize )
+{
+	stop();
+
+	m_sFilename = sFilename;
+	m_nSampleRate = nSampleRate;
+	m_nSampleDepth = nSampleDepth;
+	m_sTemporaryFilename.clear();
+
+	if ( bNormalize && Preferences::get_instance()->m_fExportTargetLoudness < 0 ) {
+		// The audio is kept at full precision until the gain is
+		// known.
+		m_sTemporaryFilename = sFilename + ".part.w64";
+		SF_INFO soundInfo;
+		soundInfo.samplerate = nSampleRate;
+		soundInfo.channels = 2;
+		soundInfo.format = SF_FORMAT_W64 | SF_FORMAT_FLOAT;
+		m_pFile = sf_open( m_sTemporaryFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+		if ( m_pFile == nullptr ) {
+			ERRORLOG( QString( "Unable to open [%1]: %2" )
+					  .arg( m_sTemporaryFilename ).arg( sf_strerror( nullptr ) ) );
+			return false;
+		}
+	} else {
+		m_pFile = openFile( sFilename, nSampleRate, nSampleDepth );
+		if ( m_pFile == nullptr ) {
+			return false;
+		}
+	}
+
+	if ( m_pBuffer == nullptr ) {
+		m_pBuffer = new float[ EXPORT_WRITER_FRAMES * 2 ];
+	}
+	m_nWritePos.store( 0 );
+	m_nReadPos.store( 0 );
+	m_bFinished.store( false );
+	m_bReportProgress = bReportProgress;
+
+	updateDither();
+	m_dither = Dsp::Dither();
+
+	delete m_pLoudnessMeter;
+	m_pLoudnessMeter = new LoudnessMeter( nSampleRate );
+
+	delete m_pResampler;
+	m_pResampler = nullptr;
+	if ( nRenderSampleRate != 0 && nRenderSampleRate != nSampleRate ) {
+		if ( Resampler::isSupported( nRenderSampleRate, nSampleRate ) ) {
+			m_pResampler = new Resampler( nRenderSampleRate, nSampleRate );
+			INFOLOG( QString( "Resampling from %1 to %2" )
+					 .arg( nRenderSampleRate ).arg( nSampleRate ) );
+		} else {
+			ERRORLOG( QString( "Unable to resample from %1 to %2" )
+					  .arg( nRenderSampleRate ).arg( nSampleRate ) );
+		}
+	}
+
+	m_thread = std::thread( &ExportWriter::writerLoop, this );
+
+	INFOLOG( QString( "Writing [%1]" ).arg( sFilename ) );
+	return true;
+}
+
+void ExportWriter::updateDither()
+{
+	SF_INFO soundInfo;
+	sf_command( m_pFile, SFC_GET_CURRENT_SF_INFO, &soundInfo, sizeof( soundInfo ) );
+	m_bDither = Preferences::get_instance()->m_bExportDither &&
+		( soundInfo.format & SF_FORMAT_SUBMASK ) == SF_FORMAT_PCM_16;
+}
+
+void ExportWriter::write( const float* pBuffer_L, const float* pBuffer_R, unsigned nFrames )
+{
+	size_t nWritePos = m_nWritePos.load( std::memory_order_relaxed );
+
+	unsigned nDone = 0;
+	while ( nDone < nFrames ) {
+		if ( m_bFinished.load( std::memory_order_relaxed ) ) {
+			return;
+		}
+
+		size_t nFree = EXPORT_WRITER_FRAMES -
+			( nWritePos - m_nReadPos.load( std::memory_order_acquire ) );
+		if ( nFree == 0 ) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Fill the contiguous part of the free space of the ring.
+		size_t nOffset = nWritePos & ( EXPORT_WRITER_FRAMES - 1 );
+		size_t nChunk = std::min( { static_cast<size_t>( nFrames - nDone ), nFree,
+									static_cast<size_t>( EXPORT_WRITER_FRAMES ) - nOffset } );
+		const float* ppSrc[ 2 ] = { pBuffer_L + nDone, pBuffer_R + nDone };
+		Dsp::interleave( &m_pBuffer[ nOffset * 2 ], ppSrc, 2, nChunk, true );
+		nWritePos += nChunk;
+		nDone += nChunk;
+
+		m_nWritePos.store( nWritePos, std::memory_order_release );
+	}
+}
+
+void ExportWriter::finish()
+{
+	m_bFinished.store( true, std::memory_order_release );
+}
+
+void ExportWriter::stop()
+{
+	if ( ! m_thread.joinable() ) {
+		return;
+	}
+
+	finish();
+	m_thread.join();
+}
+
+void ExportWriter::writerLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "export writer" );
+
+	// Interleaved 16 bit frames in case of dithering.
+	std::vector<int16_t> dithered;
+	if ( m_bDither ) {
+		dithered.resize( EXPORT_WRITER_FRAMES * 2 );
+	}
+	// Interleaved frames at the rate of the file.
+	std::vector<float> resampled;
+
+	for ( ;; ) {
+		// Has to be read before the write position. Otherwise
+		// frames published right before finish() might be missed.
+		bool bFinished = m_bFinished.load( std::memory_order_acquire );
+		size_t nWritePos = m_nWritePos.load( std::memory_order_acquire );
+		size_t nReadPos = m_nReadPos.load( std::memory_order_relaxed );
+
+		if ( nWritePos == nReadPos ) {
+			if ( bFinished ) {
+				break;
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			continue;
+		}
+
+		// Write the contiguous part of the ring.
+		size_t nOffset = nReadPos & ( EXPORT_WRITER_FRAMES - 1 );
+		size_t nFrames = std::min( nWritePos - nReadPos,
+								   static_cast<size_t>( EXPORT_WRITER_FRAMES ) - nOffset );
+		if ( m_pResampler != nullptr ) {
+			resampled.clear();
+			m_pResampler->process( &m_pBuffer[ nOffset * 2 ], nFrames, resampled );
+			clipFrames( resampled );
+			m_nReadPos.store( nReadPos + nFrames, std::memory_order_release );
+			writeFrames( resampled.data(), resampled.size() / 2, dithered );
+			continue;
+		}
+
+		writeFrames( &m_pBuffer[ nOffset * 2 ], nFrames, dithered );
+
+		m_nReadPos.store( nReadPos + nFrames, std::memory_order_release );
+	}
+
+	if ( m_pResampler != nullptr ) {
+		resampled.clear();
+		m_pResampler->flush( resampled );
+		clipFrames( resampled );
+		writeFrames( resampled.data(), resampled.size() / 2, dithered );
+	}
+
+	sf_close( m_pFile );
+	m_pFile = nullptr;
+
+	Analysis analysis;
+	analysis.sFilename = m_sFilename;
+	analysis.fLoudness = m_pLoudnessMeter->getIntegratedLoudness();
+	analysis.fTruePeak = m_pLoudnessMeter->getTruePeak();
+	analysis.fGain = 0;
+
+	if ( ! m_sTemporaryFilename.isEmpty() ) {
+		// Silence stays as it is.
+		if ( std::isfinite( analysis.fLoudness ) ) {
+			analysis.fGain = std::min(
+				Preferences::get_instance()->m_fExportTargetLoudness - analysis.fLoudness,
+				fNormalizeTruePeakCeiling - analysis.fTruePeak );
+		}
+		if ( ! writeNormalized( std::pow( 10.0, analysis.fGain / 20 ), dithered ) ) {
+			analysis.fGain = 0;
+		}
+		QFile::remove( m_sTemporaryFilename );
+	}
+
+	INFOLOG( QString( "[%1]: %2 LUFS, %3 dBTP, gain %4 dB" )
+			 .arg( analysis.sFilename )
+			 .arg( analysis.fLoudness, 0, 'f', 1 )
+			 .arg( analysis.fTruePeak, 0, 'f', 1 )
+			 .arg( analysis.fGain, 0, 'f', 1 ) );
+	{
+		std::lock_guard<std::mutex> lock( analysesMutex );
+		analyses.push_back( analysis );
+	}
+
+	INFOLOG( "Export finished" );
+	if ( m_bReportProgress ) {
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
+	}
+}
+
+void ExportWriter::writeFrames( const float* pFrames, size_t nFrames,
+								std::vector<int16_t>& dithered )
+{
+	if ( nFrames == 0 ) {
+		return;
+	}
+
+	m_pLoudnessMeter->process( pFrames, nFrames );
+	encodeFrames( pFrames, nFrames, dithered );
+}
+
+void ExportWriter::encodeFrames( const float* pFrames, size_t nFrames,
+								 std::vector<int16_t>& dithered )
+{
+	sf_count_t nWritten;
+	if ( m_bDither ) {
+		// The interleaved frames are converted like a single
+		// channel holding both.
+		if ( dithered.size() < nFrames * 2 ) {
+			dithered.resize( nFrames * 2 );
+		}
+		Dsp::interleaveInt16( dithered.data(), &pFrames, 1, nFrames * 2, &m_dither );
+		nWritten = sf_writef_short( m_pFile, dithered.data(), nFrames );
+	} else {
+		nWritten = sf_writef_float( m_pFile, pFrames, nFrames );
+	}
+	if ( nWritten != static_cast<sf_count_t>( nFrames ) ) {
+		ERRORLOG( "Error during sf_write_float" );
+	}
+}
+
+bool ExportWriter::writeNormalized( float fGain, std::vector<int16_t>& dithered )
+{
+	SF_INFO soundInfo;
+	soundInfo.format = 0;
+	SNDFILE* pTemporary = sf_open( m_sTemporaryFilename.toLocal8Bit(), SFM_READ, &soundInfo );
+	if ( pTemporary == nullptr ) {
+		ERRORLOG( QString( "Unable to read [%1]: %2" )
+				  .arg( m_sTemporaryFilename ).arg( sf_strerror( nullptr ) ) );
+		return false;
+	}
+
+	m_pFile = openFile( m_sFilename, m_nSampleRate, m_nSampleDepth );
+	if ( m_pFile == nullptr ) {
+		sf_close( pTemporary );
+		return false;
+	}
+	updateDither();
+
+	const sf_count_t nChunk = 65536;
+	std::vector<float> frames( nChunk * 2 );
+	sf_count_t nRead;
+	while ( ( nRead = sf_readf_float( pTemporary, frames.data(), nChunk ) ) > 0 ) {
+		for ( sf_count_t ii = 0; ii < nRead * 2; ++ii ) {
+			frames[ ii ] = std::min( std::max( frames[ ii ] * fGain, -1.0f ), 1.0f );
+		}
+		encodeFrames( frames.data(), nRead, dithered );
+	}
+
+	sf_close( pTemporary );
+	sf_close( m_pFile );
+	m_pFile = nullptr;
+	return true;
+}
+
+};
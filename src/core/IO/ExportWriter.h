@@ -0,0 +1,198 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef EXPORT_WRITER_H
+#define EXPORT_WRITER_H
+
+#include <sndfile.h>
+
+#include <core/Object.h>
+#include <core/Helpers/Dsp.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/** Number of stereo frames the H2Core::ExportWriter can hold before
+	the audio thread has to wait for it. Has to be a power of two.*/
+#define EXPORT_WRITER_FRAMES 262144
+
+namespace H2Core
+{
+
+/**
+ * Writes the output of the audio engine into a sound file using a
+ * background thread.
+ *
+ * It is used when exporting a song through the JACK driver in
+ * freewheel mode. In contrast to the DiskWriterDriver, the engine
+ * keeps running within the process callback of JACK and hands each
+ * buffer it renders to write(). The frames are stored in a single
+ * producer single consumer ring buffer and the encoding and disk
+ * access happen in a separate thread.
+ *
+ * The DiskWriterDriver uses it for all of its files as well. This
+ * way the rendering of the next buffer and the encoding of the
+ * previous one, which dominates the export time for FLAC and
+ * Ogg/Vorbis, run in parallel and several files (main output in
+ * several formats and the stems of a single pass export) are encoded
+ * concurrently.
+ *
+ * 16 bit files are dithered by the writer thread if
+ * Preferences::m_bExportDither is set. Audio rendered at a rate
+ * other than the one of the file is converted by the writer thread
+ * too, see Resampler.
+ *
+ * The loudness and true peak of each file are measured by the writer
+ * thread as well, see LoudnessMeter and getAnalyses(). If
+ * Preferences::m_fExportTargetLoudness is set, files started with
+ * @a bNormalize are first written to a temporary file and scaled to
+ * the target loudness once their loudness is known.
+ *
+ * Once all data has been written and the file was closed, the
+ * thread pushes an #EVENT_PROGRESS of value 100 unless told
+ * otherwise.
+ */
+class LoudnessMeter;
+class Resampler;
+
+class ExportWriter : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	ExportWriter();
+	~ExportWriter();
+
+	/** Result of the analysis of an exported file.*/
+	struct Analysis {
+		QString sFilename;
+		/** Integrated loudness in LUFS.*/
+		double fLoudness;
+		/** True peak in dBTP.*/
+		double fTruePeak;
+		/** Gain in dB applied to normalize the file.*/
+		double fGain;
+	};
+
+	/** \return Analysis of all files closed since the last call
+		of clearAnalyses(), in the order they were closed.*/
+	static std::vector<Analysis> getAnalyses();
+	static void clearAnalyses();
+
+	/**
+	 * Opens a sound file for writing. The format is derived from the
+	 * suffix of @a sFilename.
+	 *
+	 * \param sFilename Path of the file to create.
+	 * \param nSampleRate Sample rate of the exported audio.
+	 * \param nSampleDepth Number of bits per sample (8, 16, 24, or
+	 *   32). Ignored for Ogg/Vorbis.
+	 *
+	 * \return Handle of the file or nullptr on failure.
+	 */
+	static SNDFILE* openFile( const QString& sFilename, unsigned nSampleRate,
+							  int nSampleDepth );
+
+	/**
+	 * Opens @a sFilename and starts the writer thread.
+	 *
+	 * \param bReportProgress Whether to push #EVENT_PROGRESS once
+	 *   the file was closed.
+	 * \param nRenderSampleRate Rate of the audio passed to
+	 *   write(). If it differs from @a nSampleRate, the audio is
+	 *   resampled. 0 is the same as @a nSampleRate.
+	 * \param bNormalize Whether to normalize the file to
+	 *   Preferences::m_fExportTargetLoudness. Stems are only
+	 *   analysed.
+	 *
+	 * \return true on success.
+	 */
+	bool start( const QString& sFilename, unsigned nSampleRate, int nSampleDepth,
+				bool bReportProgress = true, unsigned nRenderSampleRate = 0,
+				bool bNormalize = false );
+
+	/**
+	 * Appends @a nFrames frames of both channels to the ring buffer
+	 * after clipping them to [-1,1].
+	 *
+	 * Does neither allocate memory nor acquire a lock. If the ring
+	 * buffer is full the calling thread yields until the writer
+	 * thread caught up. This is only acceptable since it is called
+	 * in freewheel mode or by the DiskWriterDriver, in which there
+	 * are no deadlines for a process cycle.
+	 *
+	 * Data passed after finish() was called is discarded.
+	 */
+	void write( const float* pBuffer_L, const float* pBuffer_R, unsigned nFrames );
+
+	/**
+	 * Marks the end of the exported audio. The writer thread will
+	 * write the remaining frames and close the file.
+	 *
+	 * Can be called from within the audio thread.
+	 */
+	void finish();
+
+	/** Calls finish() and waits for the writer thread to exit.*/
+	void stop();
+
+private:
+	void writerLoop();
+	/** Measures @a nFrames interleaved frames and writes them to
+		#m_pFile. @a dithered is used as scratch buffer.*/
+	void writeFrames( const float* pFrames, size_t nFrames, std::vector<int16_t>& dithered );
+	/** Writes @a nFrames interleaved frames to #m_pFile.*/
+	void encodeFrames( const float* pFrames, size_t nFrames, std::vector<int16_t>& dithered );
+	/** Scales the temporary file by @a fGain into #m_sFilename.
+		\return true on success.*/
+	bool writeNormalized( float fGain, std::vector<int16_t>& dithered );
+	/** Sets #m_bDither according to the format of #m_pFile.*/
+	void updateDither();
+
+	SNDFILE* m_pFile;
+	/** Interleaved stereo ring buffer of #EXPORT_WRITER_FRAMES frames.*/
+	float* m_pBuffer;
+	/** Number of frames written by the producer so far.*/
+	alignas(64) std::atomic<size_t> m_nWritePos;
+	/** Number of frames handed to the sound file so far.*/
+	alignas(64) std::atomic<size_t> m_nReadPos;
+	std::atomic<bool> m_bFinished;
+	bool m_bReportProgress;
+	/** Whether the writer thread converts to 16 bit itself using
+		#m_dither.*/
+	bool m_bDither;
+	Dsp::Dither m_dither;
+	/** Converts the audio to the rate of the file or nullptr.*/
+	Resampler* m_pResampler;
+	LoudnessMeter* m_pLoudnessMeter;
+	QString m_sFilename;
+	unsigned m_nSampleRate;
+	int m_nSampleDepth;
+	/** Temporary float file holding the audio in case of
+		normalization or empty.*/
+	QString m_sTemporaryFilename;
+	std::thread m_thread;
+};
+
+};
+
+#endif
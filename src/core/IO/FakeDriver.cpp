@@ -22,6 +22,17 @@
 
 #include <core/IO/FakeDriver.h>
 
+#include <core/AudioEngine.h>
+#include <core/ProcessProfiler.h>
+#include <core/Helpers/Random.h>
+#include <core/Helpers/Threads.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 namespace H2Core
 {
 
@@ -125,4 +136,106 @@ void FakeDriver::setBpm( float fBPM )
 	m_transport.m_fBPM = fBPM;
 }
 
+/** Keeps the CPU busy for @a nMicroseconds, like a thread doing
+	actual work while holding a lock.*/
+static void spin( int nMicroseconds )
+{
+	const auto end = std::chrono::steady_clock::now() +
+		std::chrono::microseconds( nMicroseconds );
+	while ( std::chrono::steady_clock::now() < end ) {
+	}
+}
+
+FakeDriver::StressReport FakeDriver::runStress( const StressOptions& options )
+{
+	StressReport report;
+	if ( m_pOut_L == nullptr || options.nCycles <= 0 ) {
+		ERRORLOG( "Driver not initialized or no cycles requested" );
+		return report;
+	}
+
+	const unsigned nMinBufferSize = options.nMinBufferSize > 0 ?
+		std::min( options.nMinBufferSize, m_nBufferSize ) : m_nBufferSize;
+	const double fSampleRate = getSampleRate();
+	ProcessProfiler* pProfiler = AudioEngine::get_instance()->get_profiler();
+	const long long nMissedLocks = pProfiler->getMissedLocks();
+
+	std::atomic<bool> bQuit( false );
+	std::atomic<long long> nContenderLocks( 0 );
+	std::vector<std::thread> contenders;
+	for ( int ii = 0; ii < options.nLockContenders; ++ii ) {
+		contenders.emplace_back( [&, ii]() {
+			Threads::configureCurrentThread( Threads::Role::Background, "stress contender" );
+			Random random( options.nSeed + ii + 1 );
+			while ( ! bQuit.load( std::memory_order_relaxed ) ) {
+				AudioEngine::get_instance()->lock( RIGHT_HERE );
+				spin( options.nLockHoldUs );
+				AudioEngine::get_instance()->unlock();
+				nContenderLocks.fetch_add( 1, std::memory_order_relaxed );
+				std::this_thread::sleep_for( std::chrono::microseconds(
+					random.below( 2 * std::max( options.nLockIntervalUs, 0 ) + 1 ) ) );
+			}
+		} );
+	}
+
+	Random random( options.nSeed );
+	std::vector<float> durations( options.nCycles );
+	const auto start = std::chrono::steady_clock::now();
+	auto deadline = start;
+	for ( int ii = 0; ii < options.nCycles; ++ii ) {
+		const unsigned nFrames = nMinBufferSize +
+			random.below( m_nBufferSize - nMinBufferSize + 1 );
+
+		if ( options.fSpeed > 0 ) {
+			std::this_thread::sleep_until( deadline );
+			deadline += std::chrono::nanoseconds( static_cast<long long>(
+				1e9 * nFrames / ( fSampleRate * options.fSpeed ) ) );
+		}
+		if ( options.fLateProbability > 0 && random.uniform() < options.fLateProbability ) {
+			std::this_thread::sleep_for( std::chrono::microseconds(
+				random.below( std::max( options.nMaxLateUs, 1 ) ) + 1 ) );
+			++report.nLateCycles;
+		}
+
+		const auto cycleStart = std::chrono::steady_clock::now();
+		m_processCallback( nFrames, nullptr );
+		const auto cycleEnd = std::chrono::steady_clock::now();
+
+		durations[ ii ] = std::chrono::duration<float, std::milli>( cycleEnd - cycleStart ).count();
+		report.nFrames += nFrames;
+		if ( options.fSpeed > 0 && cycleEnd > deadline ) {
+			// Like a real driver after an xrun, the following cycles
+			// do not try to catch up.
+			++report.nOverruns;
+			deadline = cycleEnd;
+		}
+	}
+	const double fWallTime = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start ).count();
+
+	bQuit = true;
+	for ( auto& contender : contenders ) {
+		contender.join();
+	}
+
+	std::sort( durations.begin(), durations.end() );
+	report.nCycles = options.nCycles;
+	report.nMissedLocks = pProfiler->getMissedLocks() - nMissedLocks;
+	report.nContenderLocks = nContenderLocks.load();
+	report.fMedian = durations[ durations.size() / 2 ];
+	report.fPercentile99 = durations[ std::min( durations.size() - 1,
+												durations.size() * 99 / 100 ) ];
+	report.fMax = durations.back();
+	if ( fWallTime > 0 ) {
+		report.fRealtimeFactor = report.nFrames / fSampleRate / fWallTime;
+	}
+
+	INFOLOG( QString( "%1 cycles at %2x realtime: median / 99th percentile / max = %3 / %4 / %5 ms, %6 overruns, %7 missed locks" )
+			 .arg( report.nCycles ).arg( report.fRealtimeFactor )
+			 .arg( report.fMedian ).arg( report.fPercentile99 ).arg( report.fMax )
+			 .arg( report.nOverruns ).arg( report.nMissedLocks ) );
+
+	return report;
+}
+
 };
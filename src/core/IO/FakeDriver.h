@@ -33,11 +33,66 @@ typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 /**
  * Fake audio driver. Used only for profiling.
+ *
+ * runStress() drives the audio engine under synthetic load to
+ * validate performance work on the engine without a sound card.
  */
 class FakeDriver : public AudioOutput
 {
 	H2_OBJECT
 public:
+	/** Load applied by runStress().*/
+	struct StressOptions {
+		/** Number of process cycles to run.*/
+		int nCycles = 1000;
+		/** Rate the cycles are issued at relative to realtime,
+			e.g. 4 for four times as fast. 0 issues them back to
+			back.*/
+		float fSpeed = 0;
+		/** Lower bound of the randomized number of frames per
+			cycle. The upper one is getBufferSize(). 0 keeps the
+			buffer size fixed.*/
+		unsigned nMinBufferSize = 0;
+		/** Probability of a cycle starting late.*/
+		float fLateProbability = 0;
+		/** Longest delay of a late cycle in microseconds.*/
+		int nMaxLateUs = 0;
+		/** Number of threads repeatedly locking the AudioEngine
+			while the cycles are running.*/
+		int nLockContenders = 0;
+		/** How long each contender holds the lock in
+			microseconds.*/
+		int nLockHoldUs = 50;
+		/** Average pause of a contender between two locks in
+			microseconds.*/
+		int nLockIntervalUs = 1000;
+		/** Seed of the randomization. Runs using the same seed
+			issue the same sequence of buffer sizes and delays.*/
+		uint64_t nSeed = 1;
+	};
+
+	/** Outcome of runStress(). Durations are in milliseconds.*/
+	struct StressReport {
+		int nCycles = 0;
+		long long nFrames = 0;
+		/** Cycles delayed on purpose.*/
+		int nLateCycles = 0;
+		/** Cycles finishing after their deadline. Only counted if
+			StressOptions::fSpeed is set.*/
+		int nOverruns = 0;
+		/** Cycles the engine skipped since it could not be
+			locked in time.*/
+		long long nMissedLocks = 0;
+		/** Locks acquired by the contender threads.*/
+		long long nContenderLocks = 0;
+		float fMedian = 0;
+		float fPercentile99 = 0;
+		float fMax = 0;
+		/** Duration of the audio rendered divided by the wall
+			clock time it took.*/
+		float fRealtimeFactor = 0;
+	};
+
 	FakeDriver( audioProcessCallback processCallback );
 	~FakeDriver();
 
@@ -58,6 +113,18 @@ public:
 	virtual void updateTransportInfo();
 	virtual void setBpm( float fBPM );
 
+	/**
+	 * Runs the process callback under the load described by @a
+	 * options from the calling thread and measures the duration of
+	 * each cycle.
+	 *
+	 * The driver has to be initialized and must not be playing. The
+	 * transport is left as it is, so the engine renders the song
+	 * if it was started before. Reaching the end of the song does
+	 * not end the run.
+	 */
+	StressReport runStress( const StressOptions& options );
+
 private:
 	audioProcessCallback m_processCallback;
 	unsigned m_nBufferSize;
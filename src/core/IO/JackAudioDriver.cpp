@@ -29,6 +29,7 @@
 #include <cassert>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 #include <jack/metadata.h>
 
 #include <core/Hydrogen.h>
@@ -41,9 +42,12 @@
 #include <core/Basics/PatternList.h>
 #include <core/Basics/Playlist.h>
 #include <core/Basics/Song.h>
+#include <core/Helpers/Dsp.h>
 #include <core/Helpers/Files.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Helpers/TickTime.h>
 #include <core/Preferences.h>
+#include <core/RealtimeConfig.h>
 #include <core/Globals.h>
 #include <core/EventQueue.h>
 
@@ -60,18 +64,27 @@ namespace H2Core {
 int JackAudioDriver::jackDriverSampleRate( jack_nframes_t nframes, void* param ){
 	// Used for logging.
 	Object* __object = ( Object* )param;
-	QString msg = QString("Jack SampleRate changed: the sample rate is now %1/sec").arg( QString::number( static_cast<int>(nframes) ) );
 	// The __INFOLOG macro uses the Object *__object and not the
 	// Object instance as INFOLOG does. It will call
 	// __object->logger()->log( H2Core::Logger::Info, ..., msg )
 	// (see object.h).
-	__INFOLOG( msg );
+	__INFOLOG( QString("Jack SampleRate changed: the sample rate is now %1/sec").arg( QString::number( static_cast<int>(nframes) ) ) );
 	JackAudioDriver::jackServerSampleRate = nframes;
 	return 0;
 }
 
+void JackAudioDriver::jackDriverThreadInit( void* arg )
+{
+	UNUSED( arg );
+	Dsp::disableDenormals();
+}
+
 int JackAudioDriver::jackDriverBufferSize( jack_nframes_t nframes, void* arg ){
-	// This function does _NOT_ have to be realtime safe.
+	// This function does _NOT_ have to be realtime safe. The JACK
+	// server does not run the process callback until it returns.
+	if ( ! Hydrogen::get_instance()->bufferSizeChanged( nframes ) ) {
+		return -1;
+	}
 	JackAudioDriver::jackServerBufferSize = nframes;
 	return 0;
 }
@@ -98,10 +111,18 @@ JackAudioDriver::JackAudioDriver( JackProcessCallback m_processCallback )
 	  m_pClient( nullptr ),
 	  m_pOutputPort1( nullptr ),
 	  m_pOutputPort2( nullptr ),
+	  m_pCueOutputPort1( nullptr ),
+	  m_pCueOutputPort2( nullptr ),
+	  m_pCueOutputBuffer_L( nullptr ),
+	  m_pCueOutputBuffer_R( nullptr ),
 	  m_nTimebaseTracking( -1 ),
-	  m_timebaseState( Timebase::None )
+	  m_timebaseState( Timebase::None ),
+	  m_nUnverifiedCycles( 0 )
 {
 	INFOLOG( "INIT" );
+
+	memset( &m_JackTransportPos, 0, sizeof( m_JackTransportPos ) );
+	memset( &m_previousJackTransportPos, 0, sizeof( m_previousJackTransportPos ) );
 	
 	auto pPreferences = Preferences::get_instance();
 	
@@ -109,7 +130,7 @@ JackAudioDriver::JackAudioDriver( JackProcessCallback m_processCallback )
 	
 	m_transport.m_status = TransportInfo::STOPPED;
 	m_transport.m_nFrames = 0;
-	m_transport.m_fTickSize = 100;
+	m_transport.setTickSize( TickTime::fromFrames( 100 ) );
 	m_transport.m_fBPM = 120;
 
 	JackAudioDriver::pJackDriverInstance = this;
@@ -123,6 +144,11 @@ JackAudioDriver::JackAudioDriver( JackProcessCallback m_processCallback )
 	
 	memset( m_pTrackOutputPortsL, 0, sizeof(m_pTrackOutputPortsL) );
 	memset( m_pTrackOutputPortsR, 0, sizeof(m_pTrackOutputPortsR) );
+	memset( m_pTrackOutputBuffersL, 0, sizeof(m_pTrackOutputBuffersL) );
+	memset( m_pTrackOutputBuffersR, 0, sizeof(m_pTrackOutputBuffersR) );
+	for ( int ii = 0; ii < MAX_INSTRUMENTS; ++ii ) {
+		m_trackOutputBus[ ii ] = -1;
+	}
 
 	m_JackTransportState  = JackTransportStopped;
 }
@@ -246,6 +272,26 @@ void JackAudioDriver::deactivate()
 	}
 	memset( m_pTrackOutputPortsL, 0, sizeof(m_pTrackOutputPortsL) );
 	memset( m_pTrackOutputPortsR, 0, sizeof(m_pTrackOutputPortsR) );
+	memset( m_pTrackOutputBuffersL, 0, sizeof(m_pTrackOutputBuffersL) );
+	memset( m_pTrackOutputBuffersR, 0, sizeof(m_pTrackOutputBuffersR) );
+	m_pCueOutputBuffer_L = nullptr;
+	m_pCueOutputBuffer_R = nullptr;
+	for ( int ii = 0; ii < MAX_INSTRUMENTS; ++ii ) {
+		m_trackPortKeys[ ii ].clear();
+		m_trackPortNames[ ii ].clear();
+	}
+}
+
+void JackAudioDriver::setFreewheel( bool bEnable )
+{
+	if ( m_pClient == nullptr ) {
+		return;
+	}
+
+	INFOLOG( QString( "%1 freewheel mode" ).arg( bEnable ? "Entering" : "Leaving" ) );
+	if ( jack_set_freewheel( m_pClient, bEnable ? 1 : 0 ) != 0 ) {
+		ERRORLOG( "Error in jack_set_freewheel" );
+	}
 }
 
 unsigned JackAudioDriver::getBufferSize()
@@ -264,12 +310,18 @@ void JackAudioDriver::clearPerTrackAudioBuffers( uint32_t nFrames )
 		 Preferences::get_instance()->m_bJackTrackOuts ) {
 		float* pBuffer;
 		
+		// The buffers handed out by JACK are only valid during the
+		// current cycle. Since we have to fetch them here anyway,
+		// they are stored for the Sampler to look them up without
+		// querying the ports again for each rendered note.
 		for ( int ii = 0; ii < m_nTrackPortCount; ++ii ) {
 			pBuffer = getTrackOut_L( ii );
+			m_pTrackOutputBuffersL[ ii ] = pBuffer;
 			if ( pBuffer != nullptr ) {
 				memset( pBuffer, 0, nFrames * sizeof( float ) );
 			}
 			pBuffer = getTrackOut_R( ii );
+			m_pTrackOutputBuffersR[ ii ] = pBuffer;
 			if ( pBuffer != nullptr ) {
 				memset( pBuffer, 0, nFrames * sizeof( float ) );
 			}
@@ -277,6 +329,27 @@ void JackAudioDriver::clearPerTrackAudioBuffers( uint32_t nFrames )
 	}
 }
 
+void JackAudioDriver::clearCueAudioBuffers( uint32_t nFrames )
+{
+	m_pCueOutputBuffer_L = nullptr;
+	m_pCueOutputBuffer_R = nullptr;
+	if ( m_pClient == nullptr ||
+		 m_pCueOutputPort1 == nullptr || m_pCueOutputPort2 == nullptr ) {
+		return;
+	}
+
+	m_pCueOutputBuffer_L = static_cast<float*>(
+		jack_port_get_buffer( m_pCueOutputPort1, JackAudioDriver::jackServerBufferSize ) );
+	m_pCueOutputBuffer_R = static_cast<float*>(
+		jack_port_get_buffer( m_pCueOutputPort2, JackAudioDriver::jackServerBufferSize ) );
+	if ( m_pCueOutputBuffer_L != nullptr ) {
+		memset( m_pCueOutputBuffer_L, 0, nFrames * sizeof( float ) );
+	}
+	if ( m_pCueOutputBuffer_R != nullptr ) {
+		memset( m_pCueOutputBuffer_R, 0, nFrames * sizeof( float ) );
+	}
+}
+
 void JackAudioDriver::calculateFrameOffset(long long oldFrame)
 {
 	if ( Hydrogen::get_instance()->getState() == STATE_PLAYING ) {
@@ -319,7 +392,9 @@ void JackAudioDriver::relocateUsingBBT()
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	Song* pSong = pHydrogen->getSong();
 
-	float fTicksPerBeat = static_cast<float>( pSong->getResolution() / m_JackTransportPos.beat_type * 4 );
+	// Double precision keeps the frame position exact to the frame
+	// far beyond the 2^24 frames representable by a float.
+	double fTicksPerBeat = static_cast<double>( pSong->getResolution() / m_JackTransportPos.beat_type * 4 );
 
 	long barTicks = 0;
 	float fAdditionalTicks = 0;
@@ -406,15 +481,17 @@ void JackAudioDriver::relocateUsingBBT()
 		}
 	}
 
-	float fNewTick = static_cast<float>(barTicks) + fAdditionalTicks +
+	double fNewTick = static_cast<double>(barTicks) + fAdditionalTicks +
 		( m_JackTransportPos.beat - 1 ) * fTicksPerBeat +
 		m_JackTransportPos.tick * ( fTicksPerBeat / m_JackTransportPos.ticks_per_beat );
 
-	float fNewTickSize = AudioEngine::compute_tick_size( getSampleRate(), m_JackTransportPos.beats_per_minute, pSong->getResolution() );
+	const int64_t nNewTickSize =
+		TickTime::tickSize( getSampleRate(), m_JackTransportPos.beats_per_minute,
+							pSong->getResolution() );
 
-	if ( fNewTickSize == 0 ) {
+	if ( nNewTickSize <= 0 ) {
 		ERRORLOG(QString("Improper tick size [%1] for tick [%2]" )
-				 .arg( fNewTickSize ).arg( fNewTick ) );
+				 .arg( TickTime::toFrames( nNewTickSize ) ).arg( fNewTick ) );
 		return;
 	}
 
@@ -423,8 +500,13 @@ void JackAudioDriver::relocateUsingBBT()
 
 	// NOTE this prevents audioEngine_process_checkBPMChanged
 	// in Hydrogen.cpp from recalculating things.
-	m_transport.m_fTickSize = fNewTickSize;
-	m_transport.m_nFrames = static_cast<long long>(fNewTick * fNewTickSize);
+	// The whole ticks are mapped exactly, only the fraction of the
+	// current one is rounded.
+	m_transport.setTickSize( nNewTickSize );
+	const double fWholeTicks = std::floor( fNewTick );
+	m_transport.m_nFrames =
+		m_transport.frameAtTick( static_cast<long long>( fWholeTicks ) ) +
+		std::llround( ( fNewTick - fWholeTicks ) * TickTime::toFrames( nNewTickSize ) );
 	m_frameOffset = m_JackTransportPos.frame - m_transport.m_nFrames;
 
 	float fBPM = static_cast<float>(m_JackTransportPos.beats_per_minute);
@@ -437,12 +519,13 @@ void JackAudioDriver::relocateUsingBBT()
 
 void JackAudioDriver::updateTransportInfo()
 {
-	if ( Preferences::get_instance()->m_bJackTransportMode !=
-	     Preferences::USE_JACK_TRANSPORT ){
+	// Called by audioEngine_process().
+	const RealtimeConfig::Values& config = RealtimeConfig::get();
+	if ( config.nJackTransportMode != Preferences::USE_JACK_TRANSPORT ){
 		return;
 	}
 
-	const bool bTimebaseEnabled = Preferences::get_instance()->m_bJackTimebaseEnabled;
+	const bool bTimebaseEnabled = config.bJackTimebaseEnabled;
 	
 	// jack_transport_query() (jack/transport.h) queries the
 	// current transport state and position. If called from the
@@ -507,6 +590,28 @@ void JackAudioDriver::updateTransportInfo()
 		}
 	}
 		
+	const bool bSlave = bTimebaseEnabled && m_timebaseState == Timebase::Slave;
+
+	// Fast path for a timebase master rolling steadily: transport
+	// advanced by exactly one buffer at the tempo already applied.
+	// Neither a relocation nor the comparison of the BBT information
+	// is required. The latter is still done every
+	// #nMaxUnverifiedCycles cycles to catch changes of the master's
+	// bar layout.
+	if ( bSlave && m_JackTransportState == JackTransportRolling &&
+		 m_nUnverifiedCycles < nMaxUnverifiedCycles &&
+		 m_transport.m_nFrames + m_frameOffset == m_JackTransportPos.frame &&
+		 m_JackTransportPos.frame == m_previousJackTransportPos.frame +
+		 JackAudioDriver::jackServerBufferSize &&
+		 m_JackTransportPos.beats_per_minute ==
+		 m_previousJackTransportPos.beats_per_minute &&
+		 m_transport.m_fBPM == static_cast<float>(m_JackTransportPos.beats_per_minute) ) {
+		++m_nUnverifiedCycles;
+		m_previousJackTransportPos = m_JackTransportPos;
+		return;
+	}
+	m_nUnverifiedCycles = 0;
+
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	
 	// The relocation could be either triggered by an user interaction
@@ -679,14 +784,49 @@ float* JackAudioDriver::getTrackOut_R( unsigned nTrack )
 	return out;
 }
 
+float* JackAudioDriver::getTrackBuffer_L( int nTrack )
+{
+	if ( ! Preferences::get_instance()->m_bJackTrackOuts ||
+		 nTrack < 0 || nTrack >= m_nTrackPortCount ) {
+		return nullptr;
+	}
+	return m_pTrackOutputBuffersL[ nTrack ];
+}
+
+float* JackAudioDriver::getTrackBuffer_R( int nTrack )
+{
+	if ( ! Preferences::get_instance()->m_bJackTrackOuts ||
+		 nTrack < 0 || nTrack >= m_nTrackPortCount ) {
+		return nullptr;
+	}
+	return m_pTrackOutputBuffersR[ nTrack ];
+}
+
 float* JackAudioDriver::getTrackOut_L( Instrument* instr, InstrumentComponent* pCompo)
 {
-	return getTrackOut_L(m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()]);
+	int nTrack = m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()];
+	if ( nTrack >= m_nTrackPortCount ) {
+		return nullptr;
+	}
+	return m_pTrackOutputBuffersL[ nTrack ];
 }
 
 float* JackAudioDriver::getTrackOut_R( Instrument* instr, InstrumentComponent* pCompo)
 {
-	return getTrackOut_R(m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()]);
+	int nTrack = m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()];
+	if ( nTrack >= m_nTrackPortCount ) {
+		return nullptr;
+	}
+	return m_pTrackOutputBuffersR[ nTrack ];
+}
+
+int JackAudioDriver::getTrackOutputBus( Instrument* pInstr ) const
+{
+	int nId = pInstr->get_id();
+	if ( nId < 0 || nId >= MAX_INSTRUMENTS ) {
+		return -1;
+	}
+	return m_trackOutputBus[nId];
 }
 
 
@@ -841,6 +981,11 @@ int JackAudioDriver::init( unsigned bufferSize )
 	pPreferences->m_nSampleRate = JackAudioDriver::jackServerSampleRate;
 	pPreferences->m_nBufferSize = JackAudioDriver::jackServerBufferSize;
 
+	/* tell the JACK server to call `jackDriverThreadInit()' once
+	   in the thread it is going to call `process()' from.
+	*/
+	jack_set_thread_init_callback( m_pClient, jackDriverThreadInit, nullptr );
+
 	/* tell the JACK server to call `process()' whenever
 	   there is work to be done.
 	*/
@@ -891,6 +1036,25 @@ int JackAudioDriver::init( unsigned bufferSize )
 		return 4;
 	}
 
+	// Previews of the Sampler.
+	if ( pPreferences->m_bJackCueOutput ) {
+		m_pCueOutputPort1 = jack_port_register( m_pClient, "cue_L", JACK_DEFAULT_AUDIO_TYPE,
+												JackPortIsOutput, 0 );
+		m_pCueOutputPort2 = jack_port_register( m_pClient, "cue_R", JACK_DEFAULT_AUDIO_TYPE,
+												JackPortIsOutput, 0 );
+		if ( m_pCueOutputPort1 != nullptr && m_pCueOutputPort2 != nullptr ) {
+			jack_set_property( m_pClient, jack_port_uuid( m_pCueOutputPort1 ),
+							   JACK_METADATA_PRETTY_NAME, "Cue Output L", "text/plain" );
+			jack_set_property( m_pClient, jack_port_uuid( m_pCueOutputPort2 ),
+							   JACK_METADATA_PRETTY_NAME, "Cue Output R", "text/plain" );
+		} else {
+			// Previews are mixed into the main output instead.
+			ERRORLOG( "Unable to register the cue output ports" );
+			m_pCueOutputPort1 = nullptr;
+			m_pCueOutputPort2 = nullptr;
+		}
+	}
+
 #ifdef H2CORE_HAVE_LASH
 	if ( pPreferences->useLash() ){
 		LashClient* lashClient = LashClient::get_instance();
@@ -932,84 +1096,201 @@ void JackAudioDriver::makeTrackOutputs( Song* pSong )
 	Instrument* pInstrument;
 	int nInstruments = static_cast<int>(pInstrumentList->size());
 
-	WARNINGLOG( QString( "Creating / renaming %1 ports" ).arg( nInstruments ) );
-
 	int nTrackCount = 0;
 
 	for( int i = 0 ; i < MAX_INSTRUMENTS ; i++ ){
 		for ( int j = 0 ; j < MAX_COMPONENTS ; j++ ){
 			m_trackMap[i][j] = 0;
 		}
+		m_trackOutputBus[i] = -1;
 	}
-	// Creates a new output track or reassigns an existing one for
-	// each component of each instrument and stores the result in
-	// the `m_trackMap'.
+
+	// Track numbers of the output buses encountered so far.
+	QStringList busNames;
+	std::vector<int> busTracks;
+
+	// Identity and name of the port pair of each track.
+	QStringList trackKeys, trackNames;
+	
+	// Assigns a track to each component of each instrument and
+	// stores the result in the `m_trackMap'. All components of
+	// instruments routed to the same output bus share a single
+	// track.
 	InstrumentComponent* pInstrumentComponent;
 	for ( int n = 0; n <= nInstruments - 1; n++ ) {
 		pInstrument = pInstrumentList->get( n );
+
+		const QString& sBus = pInstrument->get_output_bus();
+		int nBusTrack = -1;
+		if ( ! sBus.isEmpty() ) {
+			int nBus = busNames.indexOf( sBus );
+			if ( nBus < 0 ) {
+				trackKeys << QString( "bus:%1" ).arg( sBus );
+				trackNames << QString( "Bus_%1_%2_" ).arg( nTrackCount + 1 ).arg( sBus );
+				busNames << sBus;
+				busTracks.push_back( nTrackCount );
+				nBusTrack = nTrackCount;
+				nTrackCount++;
+			} else {
+				nBusTrack = busTracks[ nBus ];
+			}
+			m_trackOutputBus[pInstrument->get_id()] = nBusTrack;
+		}
+		
 		for ( auto it = pInstrument->get_components()->begin();
 			  it != pInstrument->get_components()->end(); ++it) {
 			
 			pInstrumentComponent = *it;
-			setTrackOutput( nTrackCount, pInstrument, pInstrumentComponent, pSong);
+			if ( nBusTrack >= 0 ) {
+				m_trackMap[pInstrument->get_id()][pInstrumentComponent->get_drumkit_componentID()] =
+					nBusTrack;
+				continue;
+			}
+
+			DrumkitComponent* pDrumkitComponent =
+				pSong->getComponent( pInstrumentComponent->get_drumkit_componentID() );
+			trackKeys << QString( "track:%1:%2" ).arg( pInstrument->get_id() )
+				.arg( pInstrumentComponent->get_drumkit_componentID() );
+			trackNames << QString( "Track_%1_%2_%3_" ).arg( nTrackCount + 1 )
+				.arg( pInstrument->get_name() )
+				.arg( pDrumkitComponent != nullptr ? pDrumkitComponent->get_name() : QString() );
 			m_trackMap[pInstrument->get_id()][pInstrumentComponent->get_drumkit_componentID()] = 
 				nTrackCount;
 			nTrackCount++;
 		}
 	}
-	// clean up unused ports
-	jack_port_t *pPortL, *pPortR;
-	for ( int n = nTrackCount; n < m_nTrackPortCount; n++ ) {
-		pPortL = m_pTrackOutputPortsL[n];
-		pPortR = m_pTrackOutputPortsR[n];
-		m_pTrackOutputPortsL[n] = nullptr;
-		jack_port_unregister( m_pClient, pPortL );
-		m_pTrackOutputPortsR[n] = nullptr;
-		jack_port_unregister( m_pClient, pPortR );
-	}
 
-	m_nTrackPortCount = nTrackCount;
+	updateTrackOutputs( trackKeys, trackNames );
 }
 
-void JackAudioDriver::setTrackOutput( int n, Instrument* pInstrument, InstrumentComponent *pInstrumentComponent, Song* pSong )
+void JackAudioDriver::updateTrackOutputs( const QStringList& trackKeys,
+										  const QStringList& trackNames )
 {
-	QString sComponentName;
-
-	// The function considers `m_nTrackPortCount' as the number of
-	// ports already present. If it's smaller than `n', new ports
-	// have to be created.
-	if ( m_nTrackPortCount <= n ) {
-		for ( int m = m_nTrackPortCount; m <= n; m++ ) {
-			sComponentName = QString( "Track_%1_" ).arg( m + 1 );
-			m_pTrackOutputPortsL[m] =
-				jack_port_register( m_pClient, ( sComponentName + "L" ).toLocal8Bit(),
-						     JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 );
-
-			m_pTrackOutputPortsR[m] =
-				jack_port_register( m_pClient, ( sComponentName + "R" ).toLocal8Bit(),
-						    JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 );
-
-			if ( ! m_pTrackOutputPortsR[m] || ! m_pTrackOutputPortsL[m] ) {
-				Hydrogen::get_instance()->raiseError( Hydrogen::JACK_ERROR_IN_PORT_REGISTER );
+	int nTrackCount = trackKeys.size();
+	jack_port_t* pPortsL[ MAX_INSTRUMENTS ] = { nullptr };
+	jack_port_t* pPortsR[ MAX_INSTRUMENTS ] = { nullptr };
+	QString portNames[ MAX_INSTRUMENTS ];
+	std::vector<bool> claimed( m_nTrackPortCount, false );
+
+	// Tracks keep the ports they were using before, so connections
+	// made in a patchbay stay with the instrument they belong to
+	// when instruments are added, removed, or reordered.
+	for ( int nTrack = 0; nTrack < nTrackCount; ++nTrack ) {
+		for ( int nOld = 0; nOld < m_nTrackPortCount; ++nOld ) {
+			if ( ! claimed[ nOld ] && m_pTrackOutputPortsL[ nOld ] != nullptr &&
+				 m_trackPortKeys[ nOld ] == trackKeys[ nTrack ] ) {
+				claimed[ nOld ] = true;
+				pPortsL[ nTrack ] = m_pTrackOutputPortsL[ nOld ];
+				pPortsR[ nTrack ] = m_pTrackOutputPortsR[ nOld ];
+				portNames[ nTrack ] = m_trackPortNames[ nOld ];
+				break;
 			}
 		}
-		m_nTrackPortCount = n + 1;
 	}
 
-	// Now that we're sure there is an n'th port, rename it.
-	DrumkitComponent* pDrumkitComponent = pSong->getComponent( pInstrumentComponent->get_drumkit_componentID() );
-	sComponentName = QString( "Track_%1_%2_%3_" ).arg( n + 1 )
-		.arg( pInstrument->get_name() ).arg( pDrumkitComponent->get_name() );
+	// New tracks take over the ports left behind by removed ones.
+	int nOld = 0;
+	for ( int nTrack = 0; nTrack < nTrackCount; ++nTrack ) {
+		if ( pPortsL[ nTrack ] != nullptr ) {
+			continue;
+		}
+		while ( nOld < m_nTrackPortCount &&
+				( claimed[ nOld ] || m_pTrackOutputPortsL[ nOld ] == nullptr ) ) {
+			++nOld;
+		}
+		if ( nOld == m_nTrackPortCount ) {
+			break;
+		}
+		claimed[ nOld ] = true;
+		pPortsL[ nTrack ] = m_pTrackOutputPortsL[ nOld ];
+		pPortsR[ nTrack ] = m_pTrackOutputPortsR[ nOld ];
+		portNames[ nTrack ] = m_trackPortNames[ nOld ];
+	}
+
+	// Ports no longer required are released first to free up their
+	// names.
+	int nRemoved = 0;
+	for ( int ii = 0; ii < m_nTrackPortCount; ++ii ) {
+		if ( ! claimed[ ii ] && m_pTrackOutputPortsL[ ii ] != nullptr ) {
+			jack_port_unregister( m_pClient, m_pTrackOutputPortsL[ ii ] );
+			jack_port_unregister( m_pClient, m_pTrackOutputPortsR[ ii ] );
+			++nRemoved;
+		}
+	}
+
+	// Names of the tracks contain their number and may collide with
+	// a port still to be renamed. These get a unique intermediate
+	// name first.
+	int nRenamed = 0;
+	for ( int nTrack = 0; nTrack < nTrackCount; ++nTrack ) {
+		if ( pPortsL[ nTrack ] == nullptr || portNames[ nTrack ] == trackNames[ nTrack ] ) {
+			continue;
+		}
+		for ( int nOther = 0; nOther < nTrackCount; ++nOther ) {
+			if ( nOther != nTrack && pPortsL[ nOther ] != nullptr &&
+				 portNames[ nOther ] == trackNames[ nTrack ] ) {
+				QString sTemporary = QString( "Track_renaming_%1_" ).arg( nOther + 1 );
+				renameTrackOutput( pPortsL[ nOther ], pPortsR[ nOther ], sTemporary );
+				portNames[ nOther ] = sTemporary;
+				break;
+			}
+		}
+		renameTrackOutput( pPortsL[ nTrack ], pPortsR[ nTrack ], trackNames[ nTrack ] );
+		portNames[ nTrack ] = trackNames[ nTrack ];
+		++nRenamed;
+	}
 
+	int nRegistered = 0;
+	for ( int nTrack = 0; nTrack < nTrackCount; ++nTrack ) {
+		if ( pPortsL[ nTrack ] != nullptr ) {
+			continue;
+		}
+		pPortsL[ nTrack ] =
+			jack_port_register( m_pClient, ( trackNames[ nTrack ] + "L" ).toLocal8Bit(),
+								JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 );
+		pPortsR[ nTrack ] =
+			jack_port_register( m_pClient, ( trackNames[ nTrack ] + "R" ).toLocal8Bit(),
+								JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 );
+		if ( ! pPortsL[ nTrack ] || ! pPortsR[ nTrack ] ) {
+			Hydrogen::get_instance()->raiseError( Hydrogen::JACK_ERROR_IN_PORT_REGISTER );
+		}
+		portNames[ nTrack ] = trackNames[ nTrack ];
+		++nRegistered;
+	}
+
+	if ( nRegistered > 0 || nRenamed > 0 || nRemoved > 0 ) {
+		INFOLOG( QString( "Track outputs: %1 registered, %2 renamed, %3 removed, %4 in use" )
+				 .arg( nRegistered ).arg( nRenamed ).arg( nRemoved ).arg( nTrackCount ) );
+	}
+
+	for ( int nTrack = 0; nTrack < MAX_INSTRUMENTS; ++nTrack ) {
+		m_pTrackOutputPortsL[ nTrack ] = pPortsL[ nTrack ];
+		m_pTrackOutputPortsR[ nTrack ] = pPortsR[ nTrack ];
+		m_pTrackOutputBuffersL[ nTrack ] = nullptr;
+		m_pTrackOutputBuffersR[ nTrack ] = nullptr;
+		if ( nTrack < nTrackCount ) {
+			m_trackPortKeys[ nTrack ] = trackKeys[ nTrack ];
+			m_trackPortNames[ nTrack ] = portNames[ nTrack ];
+		} else {
+			m_trackPortKeys[ nTrack ].clear();
+			m_trackPortNames[ nTrack ].clear();
+		}
+	}
+	m_nTrackPortCount = nTrackCount;
+}
+
+void JackAudioDriver::renameTrackOutput( jack_port_t* pPortL, jack_port_t* pPortR,
+										 const QString& sPortName )
+{
 #ifdef HAVE_JACK_PORT_RENAME
 	// This differs from jack_port_set_name() by triggering
 	// PortRename notifications to clients that have registered a
 	// port rename handler.
-	jack_port_rename( m_pClient, m_pTrackOutputPortsL[n], ( sComponentName + "L" ).toLocal8Bit() );
-	jack_port_rename( m_pClient, m_pTrackOutputPortsR[n], ( sComponentName + "R" ).toLocal8Bit() );
+	jack_port_rename( m_pClient, pPortL, ( sPortName + "L" ).toLocal8Bit() );
+	jack_port_rename( m_pClient, pPortR, ( sPortName + "R" ).toLocal8Bit() );
 #else
-	jack_port_set_name( m_pTrackOutputPortsL[n], ( sComponentName + "L" ).toLocal8Bit() );
-	jack_port_set_name( m_pTrackOutputPortsR[n], ( sComponentName + "R" ).toLocal8Bit() );
+	jack_port_set_name( pPortL, ( sPortName + "L" ).toLocal8Bit() );
+	jack_port_set_name( pPortR, ( sPortName + "R" ).toLocal8Bit() );
 #endif
 }
 
@@ -1214,6 +1495,7 @@ void JackAudioDriver::initTimebaseMaster()
 						     JackTimebaseCallback, this);
 		if ( nReturnValue != 0 ){
 			pPreferences->m_bJackMasterMode = Preferences::NO_JACK_TIME_MASTER;
+			pPreferences->publishRealtimeConfig();
 		} else {
 			m_nTimebaseTracking = 2;
 			m_timebaseState = Timebase::Master;
@@ -1284,9 +1566,8 @@ void JackAudioDriver::JackTimebaseCallback(jack_transport_state_t state,
 
 	// First tick covered during the next cycle.
 	float fTickSize = pDriver->m_transport.m_fTickSize;
-	unsigned long nextTick = 
-		floor(( pJackPosition->frame - pDriver->m_frameOffset ) / 
-			  fTickSize );
+	unsigned long nextTick = pDriver->m_transport.tickAtFrame(
+		static_cast<long long>( pJackPosition->frame ) - pDriver->m_frameOffset );
 	
 	int nNextPatternStartTick;
 	int nNextPattern = 
@@ -1296,10 +1577,9 @@ void JackAudioDriver::JackTimebaseCallback(jack_transport_state_t state,
 	// during the next transport cycle, we have to look at the last
 	// tick handled in audioEngine_updateNoteQueue() (during this
 	// cycle and after the updateTransportInfo() returns.
-	unsigned long nextTickInternal = 
-		floor(( pJackPosition->frame - pDriver->m_frameOffset + 
-				pHydrogen->calculateLookahead( fTickSize ) ) / 
-			  fTickSize) - 1;
+	unsigned long nextTickInternal = pDriver->m_transport.tickAtFrame(
+		static_cast<long long>( pJackPosition->frame ) - pDriver->m_frameOffset +
+		pHydrogen->calculateLookahead( fTickSize ) ) - 1;
 	int nNextPatternStartTickInternal;
 	int nNextPatternInternal = 
 		pHydrogen->getPosForTick( nextTickInternal, &nNextPatternStartTickInternal );
@@ -1328,8 +1608,12 @@ void JackAudioDriver::JackTimebaseCallback(jack_transport_state_t state,
 	if ( JackAudioDriver::nWaits == 0 ) {
 		// Average tempo in BPM for the block corresponding to
 		// pJackPosition. In Hydrogen is guaranteed to be constant within
-		// a block.
-		pJackPosition->beats_per_minute = 
+		// a block. Within tempo ramps it is the one sampled by
+		// audioEngine_process_tempoRamp() in the middle of the block.
+		bool bRamp;
+		float fRampBpm = pHydrogen->getTimelineBpmAtTick(
+			nextTick + 0.5 * pDriver->getBufferSize() / fTickSize, &bRamp );
+		pJackPosition->beats_per_minute = bRamp ? static_cast<double>(fRampBpm) :
 			static_cast<double>(pHydrogen->getTimelineBpm( nNextPatternInternal ));
 	} else {
 		pJackPosition->beats_per_minute = static_cast<double>(pDriver->m_transport.m_fBPM);
@@ -208,6 +208,17 @@ public:
 	 * by #m_pTrackOutputPortsL and #m_pTrackOutputPortsR with zeros.
 	 */
 	void deactivate();
+	/**
+	 * Switches the JACK server into or out of freewheel mode using
+	 * _jack_set_freewheel()_ (jack/jack.h). While freewheeling, the
+	 * process callback is called as fast as possible and without
+	 * realtime constraints.
+	 *
+	 * Must not be called from within the process callback.
+	 *
+	 * \param bEnable Whether to start or stop freewheeling.
+	 */
+	void setFreewheel( bool bEnable );
 	/** \return Global variable #jackServerBufferSize. */
 	unsigned getBufferSize();
 	/** \return Global variable #jackServerSampleRate. */
@@ -220,20 +231,28 @@ public:
 	 * callback function.
 	 */
 	void clearPerTrackAudioBuffers( uint32_t nFrames );
+	/** Resets the buffers of #m_pCueOutputPort1 and
+	 * #m_pCueOutputPort2 and stores them in #m_pCueOutputBuffer_L
+	 * and #m_pCueOutputBuffer_R.
+	 *
+	 * @param nFrames Size of the buffers used in the audio process
+	 * callback function.
+	 */
+	void clearCueAudioBuffers( uint32_t nFrames );
 	
 	/**
 	 * Creates per component output ports for each instrument.
 	 *
 	 * Firstly, it resets #m_trackMap with zeros. Then, it loops
-	 * through all the instruments and their components, creates a new
-	 * output or resets an existing one for each of them using
-	 * setTrackOutput(), and stores the corresponding track number in
-	 * #m_trackMap. Finally, all ports in #m_pTrackOutputPortsL and
-	 * #m_pTrackOutputPortsR, which haven't been used in the previous
-	 * step, are unregistered using _jack_port_unregister()_
-	 * (jack/jack.h) and overwritten with 0. #m_nTrackPortCount will
-	 * be set to biggest track number encountered during the
-	 * creation/reassignment step.
+	 * through all the instruments and their components, assigns a
+	 * track to each of them, and stores the corresponding track
+	 * number in #m_trackMap. Instruments with a non-empty
+	 * Instrument::__output_bus do not get tracks for their
+	 * components. Instead, a single track is created for each
+	 * distinct bus and all components of all instruments routed to
+	 * it are mapped onto it. Finally, only the ports which changed
+	 * are registered, renamed, or unregistered in
+	 * updateTrackOutputs().
 	 *
 	 * The function will only perform its tasks if the
 	 * Preferences::m_bJackTrackOuts is set to true.
@@ -299,13 +318,33 @@ public:
 	 * _jack_default_audio_sample_t*_ (jack/types.h)
 	 */
 	float* getTrackOut_R( unsigned nTrack );
+	/** \return Buffer of #m_pCueOutputPort1 stored by
+		clearCueAudioBuffers() or nullptr if
+		Preferences::m_bJackCueOutput is not set.*/
+	float* getCueOut_L() override {
+		return m_pCueOutputBuffer_L;
+	}
+	/** \return Buffer of #m_pCueOutputPort2 stored by
+		clearCueAudioBuffers() or nullptr if
+		Preferences::m_bJackCueOutput is not set.*/
+	float* getCueOut_R() override {
+		return m_pCueOutputBuffer_R;
+	}
+	/** \return Buffer of track @a nTrack stored by
+		clearPerTrackAudioBuffers() or nullptr if
+		Preferences::m_bJackTrackOuts is not set.*/
+	float* getTrackBuffer_L( int nTrack ) override;
+	/** Right channel counterpart of getTrackBuffer_L().*/
+	float* getTrackBuffer_R( int nTrack ) override;
 	/** 
 	 * Convenience function looking up the track number of a component
 	 * of an instrument using in #m_trackMap using their IDs
 	 * Instrument::__id and
 	 * InstrumentComponent::__related_drumkit_componentID. Using the
-	 * track number it then calls getTrackOut_L( unsigned ) and
-	 * returns its result.
+	 * track number it returns the corresponding buffer stored in
+	 * #m_pTrackOutputBuffersL by clearPerTrackAudioBuffers().
+	 *
+	 * Only valid within the current process cycle.
 	 *
 	 * \param instr Pointer to an Instrument
 	 * \param pCompo Pointer to one of the instrument's components.
@@ -319,8 +358,10 @@ public:
 	 * of an instrument using in #m_trackMap using their IDs
 	 * Instrument::__id and
 	 * InstrumentComponent::__related_drumkit_componentID. Using the
-	 * track number it then calls getTrackOut_R( unsigned ) and
-	 * returns its result.
+	 * track number it returns the corresponding buffer stored in
+	 * #m_pTrackOutputBuffersR by clearPerTrackAudioBuffers().
+	 *
+	 * Only valid within the current process cycle.
 	 *
 	 * \param instr Pointer to an Instrument
 	 * \param pCompo Pointer to one of the instrument's components.
@@ -329,6 +370,13 @@ public:
 	 * _jack_default_audio_sample_t*_ (jack/types.h)
 	 */
 	float* getTrackOut_R( Instrument* instr, InstrumentComponent* pCompo );
+	/**
+	 * \param pInstr Pointer to an Instrument
+	 *
+	 * \return Track number of the output bus @a pInstr is routed to
+	 * or -1 if its components have ports of their own.
+	 */
+	int getTrackOutputBus( Instrument* pInstr ) const;
 
 	/**
 	 * Initializes the JACK audio driver.
@@ -454,7 +502,9 @@ public:
      * The function will check whether a relocation took place by the
 	 * JACK server and whether the current tempo did
 	 * change with respect to the last transport cycle and updates the
-	 * transport information accordingly.
+	 * transport information accordingly. As timebase slave both is
+	 * skipped while transport advances by exactly one buffer at an
+	 * unchanged tempo, see #m_nUnverifiedCycles.
 	 *
 	 * If Preferences::USE_JACK_TRANSPORT was not selected in
 	 * Preferences::m_bJackTransportMode, the function will return
@@ -607,9 +657,24 @@ public:
 	 * second input argument @a arg of type _void_, which is a pointer
 	 * supplied by the jack_set_buffer_size_callback() function.
 	 *
-	 * @return 0 on success
+	 * The audio engine is adapted using Hydrogen::bufferSizeChanged()
+	 * so the latency can be changed without restarting the driver.
+	 *
+	 * @return 0 on success, -1 if the buffer size exceeds
+	 * #MAX_BUFFER_SIZE.
 	 */
 	static int jackDriverBufferSize( jack_nframes_t nframes, void* arg );
+	/**
+	 * Callback function registered to the JACK server in
+	 * JackAudioDriver::init() using _jack_set_thread_init_callback()_.
+	 *
+	 * It is called once within the realtime thread of the JACK
+	 * client before the first process cycle and disables denormal
+	 * numbers for it via Dsp::disableDenormals().
+	 *
+	 * \param arg Not used.
+	 */
+	static void jackDriverThreadInit( void* arg );
 protected:
 	/**
 	 * Callback function registered to the JACK server in
@@ -704,31 +769,34 @@ private:
 	void relocateUsingBBT();
 
 	/**
-	 * Renames the @a n 'th port of JACK client and creates it if
-	 * it's not already present. 
-	 *
-	 * If the track number @a n is bigger than the number of ports
-	 * currently in usage #m_nTrackPortCount, @a n + 1 -
-	 * #m_nTrackPortCount new stereo ports will be created using
-	 * _jack_port_register()_ (jack/jack.h) and #m_nTrackPortCount
-	 * updated to @a n + 1.
-	 *
-	 * Afterwards, the @a n 'th port is renamed to a concatenation of
-	 * "Track_", DrumkitComponent::__name, "_", @a n + 1, "_",
-	 * Instrument::__name, and "_L", or "_R" using either
-	 * _jack_port_rename()_ (if HAVE_JACK_PORT_RENAME is defined) or
-	 * _jack_port_set_name()_ (both jack/jack.h). The former renaming
-	 * function triggers a _PortRename_ notifications to clients that
-	 * have registered a port rename handler.
-	 *
-	 * \param n Track number for which a port should be renamed
-	 *   (and created).
-	 * \param instr Pointer to the corresponding Instrument.
-	 * \param pCompo Pointer to the corresponding
-	 *   InstrumentComponent.
-	 * \param pSong Pointer to the corresponding Song.
+	 * Brings the per track output ports in line with @a trackKeys.
+	 *
+	 * Instead of recreating the whole set, the current ports are
+	 * diffed against the requested ones. A track keeps the port
+	 * pair it was assigned to before, as identified by its key in
+	 * #m_trackPortKeys. Tracks without a port take over one of the
+	 * pairs no longer in use and new pairs are registered using
+	 * _jack_port_register()_ (jack/jack.h) only if none is left.
+	 * Surplus pairs are unregistered. Ports are renamed only if
+	 * their name changed.
+	 *
+	 * \param trackKeys Identity of each track, either the ID of the
+	 *   instrument and its component or the name of an output bus.
+	 * \param trackNames Prefix of the names of the ports of each
+	 *   track. They are followed by "L" or "R".
 	 */
-	void setTrackOutput( int n, Instrument* instr, InstrumentComponent* pCompo, Song* pSong );
+	void updateTrackOutputs( const QStringList& trackKeys,
+							 const QStringList& trackNames );
+	/**
+	 * Renames a stereo pair of ports to @a sPortName followed by "L"
+	 * or "R" using either _jack_port_rename()_ (if
+	 * HAVE_JACK_PORT_RENAME is defined) or _jack_port_set_name()_
+	 * (both jack/jack.h). The former renaming function triggers a
+	 * _PortRename_ notifications to clients that have registered a
+	 * port rename handler.
+	 */
+	void renameTrackOutput( jack_port_t* pPortL, jack_port_t* pPortR,
+							const QString& sPortName );
 	/**
 	 * Constant offset between the internal transport position in
 	 * TransportInfo::m_nFrames and the external one.
@@ -776,6 +844,17 @@ private:
 	 * will be established in connect() via the JACK server.
 	 */
 	jack_port_t*			m_pOutputPort2;
+	/**
+	 * Left and right ports the previews of the Sampler are played
+	 * back on. Only registered if Preferences::m_bJackCueOutput is
+	 * set and never connected automatically.
+	 */
+	jack_port_t*			m_pCueOutputPort1;
+	jack_port_t*			m_pCueOutputPort2;
+	/** Buffers of #m_pCueOutputPort1 and #m_pCueOutputPort2 of the
+		current process cycle.*/
+	float*				m_pCueOutputBuffer_L;
+	float*				m_pCueOutputBuffer_R;
 	/**
 	 * Destination of the left source port #m_pOutputPort1, for which
 	 * a connection will be established in connect(). It is set to
@@ -800,6 +879,13 @@ private:
 	 * It gets updated by makeTrackOutputs().
 	 */
 	int				m_trackMap[MAX_INSTRUMENTS][MAX_COMPONENTS];
+	/**
+	 * Track number of the output bus an instrument is routed to
+	 * indexed by Instrument::__id or -1 if it has none.
+	 *
+	 * It gets updated by makeTrackOutputs().
+	 */
+	int				m_trackOutputBus[MAX_INSTRUMENTS];
 	/**
 	 * Total number of output ports currently in use. It gets updated
 	 * by makeTrackOutputs().
@@ -812,7 +898,7 @@ private:
 	 * They will be initialized with all zeros in both
 	 * JackAudioDriver(), deactivate(), and connect(). Individual
 	 * components will be created, renamed, or reassigned in
-	 * setTrackOutput(), deleted in makeTrackOutputs(), and accessed
+	 * updateTrackOutputs(), and accessed
 	 * via getTrackOut_L().  It is set to a length of
 	 * #MAX_INSTRUMENTS.
 	 */
@@ -824,11 +910,33 @@ private:
 	 * They will be initialized with all zeros in both
 	 * JackAudioDriver(), deactivate(), and connect(). Individual
 	 * components will be created, renamed, or reassigned in
-	 * setTrackOutput(), deleted in makeTrackOutputs(), and accessed
+	 * updateTrackOutputs(), and accessed
 	 * via getTrackOut_R().  It is set to a length of
 	 * #MAX_INSTRUMENTS.
 	 */
 	jack_port_t*		 	m_pTrackOutputPortsR[MAX_INSTRUMENTS];
+	/**
+	 * Identity of the track each pair of #m_pTrackOutputPortsL and
+	 * #m_pTrackOutputPortsR is assigned to. Used by
+	 * updateTrackOutputs() to keep the ports of a track.
+	 */
+	QString				m_trackPortKeys[MAX_INSTRUMENTS];
+	/** Current name prefix of each pair of track output ports.*/
+	QString				m_trackPortNames[MAX_INSTRUMENTS];
+	/**
+	 * Buffers of #m_pTrackOutputPortsL of the current process
+	 * cycle. They are obtained once per cycle in
+	 * clearPerTrackAudioBuffers(), sparing the Sampler to call
+	 * _jack_port_get_buffer()_ for each note it renders.
+	 */
+	float*				m_pTrackOutputBuffersL[MAX_INSTRUMENTS];
+	/**
+	 * Buffers of #m_pTrackOutputPortsR of the current process
+	 * cycle. They are obtained once per cycle in
+	 * clearPerTrackAudioBuffers(), sparing the Sampler to call
+	 * _jack_port_get_buffer()_ for each note it renders.
+	 */
+	float*				m_pTrackOutputBuffersR[MAX_INSTRUMENTS];
 
 	/**
 	 * Current transport state returned by
@@ -885,6 +993,12 @@ private:
 	 * propagate these changes on time.
 	 */
 	jack_position_t			m_previousJackTransportPos;
+	/** Number of consecutive cycles updateTransportInfo() took the
+		fast path without comparing the BBT information using
+		compareAdjacentBBT().*/
+	int						m_nUnverifiedCycles;
+	/** Upper limit of #m_nUnverifiedCycles.*/
+	static const int		nMaxUnverifiedCycles = 32;
 
 	/**
 	 * Specifies whether the default left and right (master) audio
@@ -32,10 +32,14 @@
 #include <core/Hydrogen.h>
 #include <core/Globals.h>
 #include <core/EventQueue.h>
+#include <core/rt_clock.h>
+#include <core/Helpers/Threads.h>
 #include <core/Basics/Note.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 
+#include <chrono>
+
 #ifdef H2CORE_HAVE_LASH
 #include <core/Lash/LashClient.h>
 #endif
@@ -65,7 +69,7 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 	int i;
 	void *buf;
 	jack_midi_event_t event;
-	uint8_t buffer[13];// 13 is needed if we get sysex goto messages
+	InEvent inEvent;
 
 	if (input_port == nullptr) {
 		return;
@@ -76,6 +80,12 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 		return;
 	}
 
+	// The events carry their offset within the current cycle. Their
+	// timestamps are derived from the start of the cycle to preserve
+	// the timing of the notes.
+	int64_t nCycleStart = rtclock_now_ns();
+	double fNsPerFrame = 1e9 / (double)jack_get_sample_rate(jack_client);
+
 #ifdef JACK_MIDI_NEEDS_NFRAMES
 	events = jack_midi_get_event_count(buf, nframes);
 #else
@@ -83,8 +93,6 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 #endif
 
 	for (i = 0; i < events; i++) {
-		MidiMessage msg;
-
 #ifdef JACK_MIDI_NEEDS_NFRAMES
 		error = jack_midi_event_get(&event, buf, i, nframes);
 #else
@@ -93,112 +101,172 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 		if (error) {
 			continue;
 		}
+
+		int64_t nTimestamp = nCycleStart + (int64_t)(event.time * fNsPerFrame);
 		
-		if (running < 1) {
+		if (running < 1 || event.size == 0) {
 			continue;
 		}
 
-		error = event.size;
-		if (error > (int)sizeof(buffer)) {
-			error = (int)sizeof(buffer);
+		// Notes are decoded in place and handled right away to keep
+		// their timing. Anything else is left to the input thread.
+		if (event.size == 3 &&
+			((event.buffer[0] >> 4) == 0x8 || (event.buffer[0] >> 4) == 0x9)) {
+			MidiMessage msg;
+			if ((event.buffer[0] >> 4) == 0x9) {
+				msg.m_type = MidiMessage::NOTE_ON;
+			} else {
+				msg.m_type = MidiMessage::NOTE_OFF;
+			}
+			msg.m_nData1 = event.buffer[1];
+			msg.m_nData2 = event.buffer[2];
+			msg.m_nChannel = event.buffer[0] & 0xF;
+			msg.m_nTimestamp = nTimestamp;
+			handleMidiMessage(msg);
+			continue;
+		}
+
+		if (jack_ringbuffer_write_space(m_pInEvents) < sizeof(inEvent)) {
+			/* queue is full */
+			continue;
 		}
 
-		memset(buffer, 0, sizeof(buffer));
-		memcpy(buffer, event.buffer, error);
+		inEvent.nTimestamp = nTimestamp;
+		inEvent.nSize = event.size;
+		if (inEvent.nSize > sizeof(inEvent.data)) {
+			inEvent.nSize = sizeof(inEvent.data);
+		}
+		memcpy(inEvent.data, event.buffer, inEvent.nSize);
+		jack_ringbuffer_write(m_pInEvents, (const char *)&inEvent, sizeof(inEvent));
+	}
+}
+
+void
+JackMidiDriver::processEvent(const uint8_t *data, size_t size, int64_t nTimestamp)
+{
+	MidiMessage msg;
+	uint8_t buffer[13];// 13 is needed if we get sysex goto messages
+
+	msg.m_nTimestamp = nTimestamp;
+
+	if (size > sizeof(buffer)) {
+		size = sizeof(buffer);
+	}
 
-		switch (buffer[0] >> 4) {
-		case 0x8:	 /* note off */
-			msg.m_type = MidiMessage::NOTE_OFF;
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, data, size);
+
+	switch (buffer[0] >> 4) {
+	case 0x8:	 /* note off */
+		msg.m_type = MidiMessage::NOTE_OFF;
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = buffer[0] & 0xF;
+		handleMidiMessage(msg);
+		break;
+	case 0x9:	 /* note on */
+		msg.m_type = MidiMessage::NOTE_ON;
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = buffer[0] & 0xF;
+		handleMidiMessage(msg);
+		break;
+	case 0xA:	 /* aftertouch */
+		msg.m_type = MidiMessage::POLYPHONIC_KEY_PRESSURE;
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = buffer[0] & 0xF;
+		handleMidiMessage(msg);
+		break;
+	case 0xB:	 /* control change */
+		msg.m_type = MidiMessage::CONTROL_CHANGE;
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = buffer[0] & 0xF;
+		handleMidiMessage(msg);
+		break;
+	case 0xC:	 /* program change */
+		msg.m_type = MidiMessage::PROGRAM_CHANGE;
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = buffer[0] & 0xF;
+		handleMidiMessage(msg);
+		break;
+			case 0xF:
+				switch (buffer[0]) {
+					case 0xF0:	/* system exclusive */
+							msg.m_type = MidiMessage::SYSEX;
+							if(buffer[3] == 06 ){// MMC message
+								for ( int i = 0; i < sizeof(buffer) && i<6; i++ ) {
+										 msg.m_sysexData.push_back( buffer[i] );
+								}
+							}else
+							{
+								for ( int i = 0; i < sizeof(buffer); i++ ) {
+										 msg.m_sysexData.push_back( buffer[i] );
+								}
+							}
+							handleMidiMessage(msg);
+							break;
+		case 0xF1:
+			msg.m_type = MidiMessage::QUARTER_FRAME;
 			msg.m_nData1 = buffer[1];
 			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
+			msg.m_nChannel = 0;
 			handleMidiMessage(msg);
 			break;
-		case 0x9:	 /* note on */
-			msg.m_type = MidiMessage::NOTE_ON;
+		case 0xF2:
+			msg.m_type = MidiMessage::SONG_POS;
 			msg.m_nData1 = buffer[1];
 			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
+			msg.m_nChannel = 0;
 			handleMidiMessage(msg);
 			break;
-		case 0xA:	 /* aftertouch */
-			msg.m_type = MidiMessage::POLYPHONIC_KEY_PRESSURE;
+		case 0xFA:
+			msg.m_type = MidiMessage::START;
 			msg.m_nData1 = buffer[1];
 			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
+			msg.m_nChannel = 0;
 			handleMidiMessage(msg);
 			break;
-		case 0xB:	 /* control change */
-			msg.m_type = MidiMessage::CONTROL_CHANGE;
+		case 0xFB:
+			msg.m_type = MidiMessage::CONTINUE;
 			msg.m_nData1 = buffer[1];
 			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
+			msg.m_nChannel = 0;
 			handleMidiMessage(msg);
 			break;
-		case 0xC:	 /* program change */
-			msg.m_type = MidiMessage::PROGRAM_CHANGE;
+		case 0xFC:
+			msg.m_type = MidiMessage::STOP;
 			msg.m_nData1 = buffer[1];
 			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
+			msg.m_nChannel = 0;
 			handleMidiMessage(msg);
 			break;
-				case 0xF:
-					switch (buffer[0]) {
-						case 0xF0:	/* system exclusive */
-								msg.m_type = MidiMessage::SYSEX;
-								if(buffer[3] == 06 ){// MMC message
-									for ( int i = 0; i < sizeof(buffer) && i<6; i++ ) {
-											 msg.m_sysexData.push_back( buffer[i] );
-									}
-								}else
-								{
-									for ( int i = 0; i < sizeof(buffer); i++ ) {
-											 msg.m_sysexData.push_back( buffer[i] );
-									}
-								}
-								handleMidiMessage(msg);
-								break;
-			case 0xF1:
-				msg.m_type = MidiMessage::QUARTER_FRAME;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xF2:
-				msg.m_type = MidiMessage::SONG_POS;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFA:
-				msg.m_type = MidiMessage::START;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFB:
-				msg.m_type = MidiMessage::CONTINUE;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFC:
-				msg.m_type = MidiMessage::STOP;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			default:
-				break;
-			}
 		default:
 			break;
 		}
+	default:
+		break;
+	}
+}
+
+void
+JackMidiDriver::inputThread()
+{
+	InEvent inEvent;
+
+	Threads::configureCurrentThread( Threads::Role::Midi, "JACK MIDI input" );
+
+	while (m_bInputThreadRunning.load()) {
+		while (jack_ringbuffer_read_space(m_pInEvents) >= sizeof(inEvent)) {
+			jack_ringbuffer_read(m_pInEvents, (char *)&inEvent, sizeof(inEvent));
+			processEvent(inEvent.data, inEvent.nSize, inEvent.nTimestamp);
+		}
+
+		flushControlChanges();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
 }
 
@@ -233,7 +301,7 @@ JackMidiDriver::JackMidiRead(jack_nframes_t nframes)
 	uint8_t *buffer;
 	void *buf;
 	jack_nframes_t t;
-	uint8_t data[1];
+	uint32_t next_pos;
 	uint8_t len;
 
 	if (output_port == nullptr) {
@@ -253,18 +321,26 @@ JackMidiDriver::JackMidiRead(jack_nframes_t nframes)
 
 	t = 0;
 	lock();
-	while ((t < nframes) &&
-		   (rx_out_pos != rx_in_pos)) {
+	while (rx_out_pos != rx_in_pos) {
+		next_pos = rx_in_pos + 1;
+		if (next_pos >= JACK_MIDI_BUFFER_MAX) {
+			next_pos = 0;
+		}
 
-				len = jack_buffer[4 * rx_in_pos];
+		len = jack_buffer[next_pos].nLen;
 		if (len == 0) {
-			rx_in_pos++;
-			if (rx_in_pos >= JACK_MIDI_BUFFER_MAX) {
-				rx_in_pos = 0;
-			}
+			rx_in_pos = next_pos;
 			continue;
 		}
 
+		/* events have to be written in order and within the cycle */
+		if (jack_buffer[next_pos].nFrame > t) {
+			t = jack_buffer[next_pos].nFrame;
+		}
+		if (t >= nframes) {
+			t = nframes - 1;
+		}
+
 #ifdef JACK_MIDI_NEEDS_NFRAMES
 		buffer = jack_midi_event_reserve(buf, t, len, nframes);
 #else
@@ -273,12 +349,8 @@ JackMidiDriver::JackMidiRead(jack_nframes_t nframes)
 		if (buffer == nullptr) {
 			break;
 		}
-		t++;
-		rx_in_pos++;
-		if (rx_in_pos >= JACK_MIDI_BUFFER_MAX) {
-			rx_in_pos = 0;
-		}
-		memcpy(buffer, jack_buffer + (4 * rx_in_pos) + 1, len);
+		rx_in_pos = next_pos;
+		memcpy(buffer, jack_buffer[next_pos].data, len);
 	}
 	unlock();
 }
@@ -305,16 +377,70 @@ JackMidiDriver::JackMidiOutEvent(uint8_t buf[4], uint8_t len)
 		len = 3;
 	}
 
-	jack_buffer[(4 * next_pos)] = len;
-	jack_buffer[(4 * next_pos) + 1] = buf[0];
-	jack_buffer[(4 * next_pos) + 2] = buf[1];
-	jack_buffer[(4 * next_pos) + 3] = buf[2];
+	jack_buffer[next_pos].nFrame = 0;
+	jack_buffer[next_pos].nLen = len;
+	memcpy(jack_buffer[next_pos].data, buf, 3);
 
 	rx_out_pos = next_pos;
 
 	unlock();
 }
 
+void
+JackMidiDriver::queueEvent(uint8_t buf[4], uint8_t len, int nFrame)
+{
+	if (m_nQueuedEvents >= JACK_MIDI_BUFFER_MAX) {
+		return;
+	}
+
+	if (nFrame < 0) {
+		nFrame = 0;
+	}
+	if (m_nQueuedEvents > 0 &&
+		(uint32_t)nFrame < m_queuedEvents[m_nQueuedEvents - 1].nFrame) {
+		nFrame = m_queuedEvents[m_nQueuedEvents - 1].nFrame;
+	}
+
+	if (len > 3) {
+		len = 3;
+	}
+
+	OutEvent* pEvent = &m_queuedEvents[m_nQueuedEvents];
+	pEvent->nFrame = nFrame;
+	pEvent->nLen = len;
+	memcpy(pEvent->data, buf, 3);
+	m_nQueuedEvents++;
+}
+
+void
+JackMidiDriver::flushQueuedEvents()
+{
+	uint32_t next_pos;
+
+	if (m_nQueuedEvents == 0) {
+		return;
+	}
+
+	lock();
+	for (int i = 0; i < m_nQueuedEvents; i++) {
+		next_pos = rx_out_pos + 1;
+		if (next_pos >= JACK_MIDI_BUFFER_MAX) {
+			next_pos = 0;
+		}
+
+		if (next_pos == rx_in_pos) {
+			/* buffer is full */
+			break;
+		}
+
+		jack_buffer[next_pos] = m_queuedEvents[i];
+		rx_out_pos = next_pos;
+	}
+	unlock();
+
+	m_nQueuedEvents = 0;
+}
+
 static int
 JackMidiProcessCallback(jack_nframes_t nframes, void *arg)
 {
@@ -345,9 +471,15 @@ JackMidiDriver::JackMidiDriver()
 	running = 0;
 	rx_in_pos = 0;
 	rx_out_pos = 0;
+	m_nQueuedEvents = 0;
 	output_port = nullptr;
 	input_port = nullptr;
 
+	m_pInEvents = jack_ringbuffer_create(JACK_MIDI_INPUT_EVENTS_MAX * sizeof(InEvent));
+	jack_ringbuffer_mlock(m_pInEvents);
+	m_bInputThreadRunning = true;
+	m_inputThread = std::thread(&JackMidiDriver::inputThread, this);
+
 	QString jackMidiClientId = "Hydrogen";
 
 #ifdef H2CORE_HAVE_OSC
@@ -407,6 +539,13 @@ JackMidiDriver::~JackMidiDriver()
 			ERRORLOG("Failed close jack midi client");
 		}
 	}
+
+	m_bInputThreadRunning = false;
+	if (m_inputThread.joinable()) {
+		m_inputThread.join();
+	}
+	jack_ringbuffer_free(m_pInEvents);
+
 	pthread_mutex_destroy(&mtx);
 
 }
@@ -456,7 +595,7 @@ JackMidiDriver::getPortInfo(const QString& sPortName, int& nClient, int& nPort)
 	nPort = 0;
 }
 
-void JackMidiDriver::handleQueueNote(Note* pNote)
+void JackMidiDriver::handleQueueNote( Note* pNote, int nFrame )
 {
 
 	uint8_t buffer[4];
@@ -484,18 +623,18 @@ void JackMidiDriver::handleQueueNote(Note* pNote)
 	buffer[2] = 0;
 	buffer[3] = 0;
 
-	JackMidiOutEvent(buffer, 3);
+	queueEvent(buffer, 3, nFrame);
 
 	buffer[0] = 0x90 | channel;	/* note on */
 	buffer[1] = key;
 	buffer[2] = vel;
 	buffer[3] = 0;
 
-	JackMidiOutEvent(buffer, 3);
+	queueEvent(buffer, 3, nFrame);
 }
 
 void
-JackMidiDriver::handleQueueNoteOff(int channel, int key, int vel)
+JackMidiDriver::handleQueueNoteOff(int channel, int key, int vel, int nFrame)
 {
 	uint8_t buffer[4];
 
@@ -516,7 +655,7 @@ JackMidiDriver::handleQueueNoteOff(int channel, int key, int vel)
 	buffer[2] = 0;
 	buffer[3] = 0;
 
-	JackMidiOutEvent(buffer, 3);
+	queueEvent(buffer, 3, nFrame);
 }
 
 void JackMidiDriver::handleQueueAllNoteOff()
@@ -527,6 +666,7 @@ void JackMidiDriver::handleQueueAllNoteOff()
 	unsigned int i = 0;
 	int channel = 0;
 	int key = 0;
+	uint8_t buffer[4];
 
 	for (i = 0; i < numInstruments; i++) {
 			pCurInstr = pInstrList->get(i);
@@ -541,7 +681,12 @@ void JackMidiDriver::handleQueueAllNoteOff()
 			continue;
 		}
 
-		handleQueueNoteOff(channel, key, 0);
+		buffer[0] = 0x80 | channel;	/* note off */
+		buffer[1] = key;
+		buffer[2] = 0;
+		buffer[3] = 0;
+
+		JackMidiOutEvent(buffer, 3);
 	}
 }
 
@@ -38,10 +38,15 @@
 #include <jack/midiport.h>
 #include <jack/ringbuffer.h>
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define	JACK_MIDI_BUFFER_MAX 64	/* events */
+/** Number of incoming events which can be pending in the queue to
+	the input thread of the H2Core::JackMidiDriver.*/
+#define JACK_MIDI_INPUT_EVENTS_MAX 512
 
 namespace H2Core
 {
@@ -62,13 +67,49 @@ public:
 	void JackMidiWrite(jack_nframes_t nframes);
 	void JackMidiRead(jack_nframes_t nframes);
 	
-	virtual void handleQueueNote(Note* pNote);
-	virtual void handleQueueNoteOff( int channel, int key, int velocity );
+	virtual void handleQueueNote( Note* pNote, int nFrame );
+	virtual void handleQueueNoteOff( int channel, int key, int velocity, int nFrame );
 	virtual void handleQueueAllNoteOff();
 	virtual void handleOutgoingControlChange( int param, int value, int channel );
+	virtual void flushQueuedEvents();
 
 private:
+	/** Incoming MIDI event handed to the input thread.*/
+	struct InEvent {
+		int64_t nTimestamp;
+		uint32_t nSize;
+		uint8_t data[13];// 13 is needed if we get sysex goto messages
+	};
+
+	/** Decodes a raw MIDI event and passes it to
+		handleMidiMessage().*/
+	void processEvent(const uint8_t *data, size_t size, int64_t nTimestamp);
+	/**
+	 * Handles all incoming events except for notes.
+	 *
+	 * Sysex, MMC, program and control changes may trigger actions
+	 * allocating memory or acquiring locks, like loading a song. They
+	 * are therefore passed from the process callback to this thread
+	 * via #m_pInEvents. It does also dispatch the control changes
+	 * held back by the coalescing.
+	 */
+	void inputThread();
+
+	/** Outgoing MIDI event.*/
+	struct OutEvent {
+		/** Offset within the process cycle it will be written at.*/
+		uint32_t nFrame;
+		uint8_t nLen;
+		uint8_t data[3];
+	};
+
+	/** Appends an event to #jack_buffer to be written at the
+		beginning of the next cycle.*/
 	void JackMidiOutEvent(uint8_t *buf, uint8_t len);
+	/** Appends an event to #m_queuedEvents. Frames are kept
+		monotonic since JACK requires the events of a cycle to be
+		ordered.*/
+	void queueEvent(uint8_t *buf, uint8_t len, int nFrame);
 
 	void lock();
 	void unlock();
@@ -78,9 +119,21 @@ private:
 	jack_client_t *jack_client;
 	pthread_mutex_t mtx;
 	int running;
-		uint8_t jack_buffer[JACK_MIDI_BUFFER_MAX * 4];
+	/** Ring buffer of events to be written by JackMidiRead(). Guarded
+		by #mtx.*/
+	OutEvent jack_buffer[JACK_MIDI_BUFFER_MAX];
 	uint32_t rx_in_pos;
 	uint32_t rx_out_pos;
+	/** Events queued by the audio engine during its current process
+		cycle. They are moved to #jack_buffer in flushQueuedEvents()
+		using a single lock.*/
+	OutEvent m_queuedEvents[JACK_MIDI_BUFFER_MAX];
+	int m_nQueuedEvents;
+	/** Lock-free queue of InEvent from JackMidiWrite() to
+		inputThread().*/
+	jack_ringbuffer_t *m_pInEvents;
+	std::thread m_inputThread;
+	std::atomic<bool> m_bInputThreadRunning;
 };
 
 };
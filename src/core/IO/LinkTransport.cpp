@@ -0,0 +1,178 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/LinkTransport.h>
+#include <core/AudioEngine.h>
+
+#ifdef H2CORE_HAVE_LINK
+#include <ableton/Link.hpp>
+#include <ableton/link/HostTimeFilter.hpp>
+#endif
+
+#include <cmath>
+#include <utility>
+
+namespace H2Core
+{
+
+const char* LinkTransport::__class_name = "LinkTransport";
+
+#ifdef H2CORE_HAVE_LINK
+struct LinkTransport::Impl {
+	ableton::Link link;
+	/** Maps the sample time of the audio engine onto the Link
+		clock, removing the jitter of the wake up of the audio
+		thread.*/
+	ableton::link::HostTimeFilter<ableton::link::platform::Clock> hostTimeFilter;
+	/** Frames rendered since the session was joined.*/
+	double fSampleTime;
+
+	explicit Impl( double fBpm )
+		: link( fBpm )
+		, fSampleTime( 0 ) {
+	}
+};
+#else
+struct LinkTransport::Impl {
+};
+#endif
+
+LinkTransport::LinkTransport()
+	: Object( __class_name )
+	, m_pImpl( nullptr )
+	, m_fRequestedTempo( 0 )
+{
+}
+
+LinkTransport::~LinkTransport()
+{
+	delete m_pImpl;
+}
+
+bool LinkTransport::setEnabled( bool bEnabled, float fBpm )
+{
+#ifdef H2CORE_HAVE_LINK
+	if ( bEnabled == isEnabled() ) {
+		return true;
+	}
+
+	Impl* pImpl = nullptr;
+	if ( bEnabled ) {
+		// Joining the session starts the network threads of Link
+		// and is done before taking the lock.
+		pImpl = new Impl( fBpm );
+		pImpl->link.enable( true );
+		INFOLOG( QString( "Joined Link session at [%1] bpm" ).arg( fBpm ) );
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	std::swap( m_pImpl, pImpl );
+	m_fRequestedTempo = 0;
+	AudioEngine::get_instance()->unlock();
+
+	if ( pImpl != nullptr ) {
+		pImpl->link.enable( false );
+		delete pImpl;
+		INFOLOG( "Left Link session" );
+	}
+	return true;
+#else
+	UNUSED( fBpm );
+	if ( bEnabled ) {
+		ERRORLOG( "Unable to join Link session. Your Hydrogen version was not compiled with Ableton Link support." );
+		return false;
+	}
+	return true;
+#endif
+}
+
+bool LinkTransport::isEnabled() const
+{
+	return m_pImpl != nullptr;
+}
+
+int LinkTransport::getNumPeers() const
+{
+#ifdef H2CORE_HAVE_LINK
+	if ( m_pImpl != nullptr ) {
+		return static_cast<int>( m_pImpl->link.numPeers() );
+	}
+#endif
+	return 0;
+}
+
+void LinkTransport::requestTempo( float fBpm )
+{
+	m_fRequestedTempo = fBpm;
+}
+
+bool LinkTransport::process( uint32_t nFrames, unsigned nSampleRate, double fBeat,
+							 double fQuantum, float* pBpm, double* pBeatOffset )
+{
+#ifdef H2CORE_HAVE_LINK
+	if ( m_pImpl == nullptr || nSampleRate == 0 || fQuantum <= 0 ) {
+		return false;
+	}
+
+	// The buffer becomes audible one period after the beginning
+	// of the cycle at the earliest. This is the same estimate the
+	// LatencyProbe uses.
+	const auto hostTime =
+		m_pImpl->hostTimeFilter.sampleTimeToHostTime( m_pImpl->fSampleTime );
+	m_pImpl->fSampleTime += nFrames;
+	const auto outputTime = hostTime + std::chrono::microseconds(
+		llround( 1.0e6 * nFrames / nSampleRate ) );
+
+	auto sessionState = m_pImpl->link.captureAudioSessionState();
+
+	float fRequestedTempo = m_fRequestedTempo.exchange( 0 );
+	if ( fRequestedTempo > 0 &&
+		 std::fabs( fRequestedTempo - sessionState.tempo() ) > 1e-3 ) {
+		sessionState.setTempo( fRequestedTempo, outputTime );
+		m_pImpl->link.commitAudioSessionState( sessionState );
+	}
+
+	*pBpm = static_cast<float>( sessionState.tempo() );
+
+	double fOffset = sessionState.phaseAtTime( outputTime, fQuantum ) -
+		std::fmod( fBeat, fQuantum );
+	if ( fOffset > fQuantum / 2 ) {
+		fOffset -= fQuantum;
+	} else if ( fOffset <= -fQuantum / 2 ) {
+		fOffset += fQuantum;
+	}
+	*pBeatOffset = fOffset;
+
+	return true;
+#else
+	UNUSED( nFrames );
+	UNUSED( nSampleRate );
+	UNUSED( fBeat );
+	UNUSED( fQuantum );
+	UNUSED( pBpm );
+	UNUSED( pBeatOffset );
+	return false;
+#endif
+}
+
+};
@@ -0,0 +1,121 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef LINK_TRANSPORT_H
+#define LINK_TRANSPORT_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace H2Core
+{
+
+/**
+ * Tempo and beat synchronization with other applications on the
+ * local network using Ableton Link.
+ *
+ * Contrary to the JACK timebase, Link does not require all
+ * participants to be hosted on the same machine. Once enabled, the
+ * session timeline is sampled once per process cycle in
+ * audioEngine_process_transport() via process(). The beginning of
+ * the buffer is mapped onto the Link clock by filtering the sample
+ * time of the audio engine, so the phase reported for the buffer is
+ * accurate to a single frame. Hydrogen adopts the tempo of the
+ * session and, while playing, shifts its transport position to keep
+ * its beat in phase with the one of the other peers.
+ *
+ * Tempo changes within Hydrogen, e.g. via Hydrogen::setBPM(), are
+ * passed on to the session using requestTempo().
+ *
+ * Support is only available when built with Ableton Link
+ * (#H2CORE_HAVE_LINK). Otherwise, setEnabled() fails.
+ */
+class LinkTransport : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	LinkTransport();
+	~LinkTransport();
+
+	/**
+	 * Joins or leaves the Link session.
+	 *
+	 * Must not be called from within the process cycle. The
+	 * AudioEngine is locked while the session is created or
+	 * destroyed.
+	 *
+	 * \param bEnabled Whether to join the session.
+	 * \param fBpm Tempo to start the session with in case there
+	 *   are no other peers yet.
+	 * \return false if Hydrogen was built without Link support.
+	 */
+	bool setEnabled( bool bEnabled, float fBpm );
+	bool isEnabled() const;
+	/** \return Number of other applications in the session.*/
+	int getNumPeers() const;
+
+	/**
+	 * Hands a new tempo to the session. It is committed at the
+	 * beginning of the next process cycle. Can be called from any
+	 * thread.
+	 */
+	void requestTempo( float fBpm );
+
+	/**
+	 * Samples the session timeline for the current process cycle.
+	 *
+	 * Called by the audio engine only, with the AudioEngine
+	 * locked. It is realtime safe.
+	 *
+	 * \param nFrames Size of the buffer about to be rendered.
+	 * \param nSampleRate Sample rate of the audio driver.
+	 * \param fBeat Position of the transport in beats at the
+	 *   beginning of the buffer.
+	 * \param fQuantum Number of beats the phase is aligned over,
+	 *   e.g. 4 for a bar of a 4/4 time signature.
+	 * \param pBpm Tempo of the session.
+	 * \param pBeatOffset Difference in beats between the phase of
+	 *   the session and the one of @a fBeat at the time the first
+	 *   frame of the buffer becomes audible. Wrapped to half of
+	 *   @a fQuantum in either direction.
+	 * \return false if Link is not enabled.
+	 */
+	bool process( uint32_t nFrames, unsigned nSampleRate, double fBeat,
+				  double fQuantum, float* pBpm, double* pBeatOffset );
+
+private:
+	struct Impl;
+	/** Only present while enabled. Created and destroyed with the
+		AudioEngine locked, so the process cycle never sees a
+		dangling object.*/
+	Impl* m_pImpl;
+	/** Tempo handed over by requestTempo() or 0 if there is none
+		pending.*/
+	std::atomic<float> m_fRequestedTempo;
+};
+
+};
+
+#endif
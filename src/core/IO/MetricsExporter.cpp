@@ -0,0 +1,405 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/MetricsExporter.h>
+
+#include <core/AudioEngine.h>
+#include <core/EventQueue.h>
+#include <core/Basics/SampleMemory.h>
+#include <core/Helpers/Threads.h>
+#include <core/Sampler/Sampler.h>
+
+#include <QtCore/QList>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtNetwork/QUdpSocket>
+
+#include <chrono>
+#include <thread>
+
+namespace H2Core
+{
+
+const char* MetricsExporter::__class_name = "MetricsExporter";
+
+/** Names of the stages used in the exported metrics.*/
+static const char* stageMetricNames[ ProcessProfiler::STAGE_COUNT ] = {
+	"prepare", "note_queue", "sampler", "synth", "ladspa", "metering", "total" };
+
+/** How often the worker threads check whether to quit.*/
+static const int nPollMs = 100;
+
+struct MetricsExporter::Worker {
+	Protocol protocol;
+	QString sHost;
+	int nPort;
+	std::atomic<bool> bQuit;
+	std::thread thread;
+};
+
+MetricsExporter::MetricsExporter()
+	: Object( __class_name )
+	, m_pWorker( nullptr )
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	stop();
+}
+
+bool MetricsExporter::start( Protocol protocol, const QString& sHost, int nPort )
+{
+	if ( nPort <= 0 || nPort > 65535 ) {
+		ERRORLOG( QString( "Invalid port [%1]" ).arg( nPort ) );
+		return false;
+	}
+
+	stop();
+
+	m_pWorker = new Worker;
+	m_pWorker->protocol = protocol;
+	m_pWorker->sHost = sHost;
+	m_pWorker->nPort = nPort;
+	m_pWorker->bQuit = false;
+	if ( protocol == PROTOCOL_STATSD ) {
+		m_pWorker->thread = std::thread( &MetricsExporter::statsDLoop, this, m_pWorker );
+		INFOLOG( QString( "Pushing metrics to StatsD at [%1:%2]" ).arg( sHost ).arg( nPort ) );
+	} else {
+		m_pWorker->thread = std::thread( &MetricsExporter::prometheusLoop, this, m_pWorker );
+		INFOLOG( QString( "Serving Prometheus metrics on [%1:%2]" ).arg( sHost ).arg( nPort ) );
+	}
+	return true;
+}
+
+void MetricsExporter::stop()
+{
+	if ( m_pWorker == nullptr ) {
+		return;
+	}
+	m_pWorker->bQuit = true;
+	m_pWorker->thread.join();
+	delete m_pWorker;
+	m_pWorker = nullptr;
+	INFOLOG( "Stopped exporting metrics" );
+}
+
+bool MetricsExporter::isEnabled() const
+{
+	return m_pWorker != nullptr;
+}
+
+MetricsExporter::Protocol MetricsExporter::parseProtocol( const QString& sName )
+{
+	if ( sName.trimmed().compare( "statsd", Qt::CaseInsensitive ) == 0 ) {
+		return PROTOCOL_STATSD;
+	}
+	return PROTOCOL_PROMETHEUS;
+}
+
+MetricsExporter::Snapshot MetricsExporter::gather()
+{
+	Snapshot snapshot;
+	AudioEngine* pAudioEngine = AudioEngine::get_instance();
+
+	ProcessProfiler* pProfiler = pAudioEngine->get_profiler();
+	for ( int ii = 0; ii < ProcessProfiler::STAGE_COUNT; ++ii ) {
+		snapshot.stages[ ii ] =
+			pProfiler->getStatistics( static_cast<ProcessProfiler::Stage>( ii ) );
+	}
+	snapshot.nCycles = pProfiler->getCycles();
+	snapshot.nXRuns = pProfiler->getXRuns();
+	snapshot.nMissedLocks = pProfiler->getMissedLocks();
+	snapshot.nDroppedCycles = pProfiler->getDroppedCycles();
+	snapshot.nSamplerVoices = pProfiler->getSamplerVoices();
+	snapshot.nSynthVoices = pProfiler->getSynthVoices();
+	snapshot.fExportRealtimeFactor = pProfiler->getExportRealtimeFactor();
+
+	EventQueue* pEventQueue = EventQueue::get_instance();
+	snapshot.nDroppedEvents = pEventQueue != nullptr ? pEventQueue->get_dropped_events() : 0;
+	snapshot.nStreamUnderruns = pAudioEngine->get_sampler()->getStreamUnderruns();
+
+	SampleMemory::Stats stats = SampleMemory::get_stats();
+	snapshot.nSampleBytes = stats.nBytes;
+	snapshot.nResidentSampleBytes = stats.nResidentBytes;
+	snapshot.nLockedSampleBytes = stats.nLockedBytes;
+	snapshot.nSampleBudgetBytes = stats.nBudgetBytes;
+	snapshot.nSampleEvictions = stats.nEvictions;
+
+	return snapshot;
+}
+
+/** Appends the HELP and TYPE lines of a Prometheus metric.*/
+static void appendPrometheusHeader( QByteArray& out, const char* sName, const char* sType,
+									const char* sHelp )
+{
+	out += QByteArray( "# HELP " ) + sName + " " + sHelp + "\n";
+	out += QByteArray( "# TYPE " ) + sName + " " + sType + "\n";
+}
+
+static void appendPrometheusValue( QByteArray& out, const char* sName, const QByteArray& labels,
+								   double fValue )
+{
+	out += sName;
+	if ( ! labels.isEmpty() ) {
+		out += "{" + labels + "}";
+	}
+	out += " " + QByteArray::number( fValue, 'g', 9 ) + "\n";
+}
+
+QByteArray MetricsExporter::formatPrometheus( const Snapshot& snapshot )
+{
+	QByteArray out;
+
+	appendPrometheusHeader( out, "hydrogen_cycle_time_milliseconds", "gauge",
+							"Percentiles of the duration of the stages of the process cycle." );
+	for ( int ii = 0; ii < ProcessProfiler::STAGE_COUNT; ++ii ) {
+		const QByteArray stage = QByteArray( "stage=\"" ) + stageMetricNames[ ii ] + "\"";
+		appendPrometheusValue( out, "hydrogen_cycle_time_milliseconds",
+							   stage + ",quantile=\"0.5\"", snapshot.stages[ ii ].fMedian );
+		appendPrometheusValue( out, "hydrogen_cycle_time_milliseconds",
+							   stage + ",quantile=\"0.99\"", snapshot.stages[ ii ].fPercentile99 );
+	}
+	appendPrometheusHeader( out, "hydrogen_cycle_time_max_milliseconds", "gauge",
+							"Longest duration of the stages of the process cycle." );
+	for ( int ii = 0; ii < ProcessProfiler::STAGE_COUNT; ++ii ) {
+		appendPrometheusValue( out, "hydrogen_cycle_time_max_milliseconds",
+							   QByteArray( "stage=\"" ) + stageMetricNames[ ii ] + "\"",
+							   snapshot.stages[ ii ].fMax );
+	}
+
+	appendPrometheusHeader( out, "hydrogen_cycles_total", "counter",
+							"Process cycles measured by the profiler." );
+	appendPrometheusValue( out, "hydrogen_cycles_total", "", snapshot.nCycles );
+	appendPrometheusHeader( out, "hydrogen_xruns_total", "counter",
+							"Process cycles exceeding the period of the driver." );
+	appendPrometheusValue( out, "hydrogen_xruns_total", "", snapshot.nXRuns );
+	appendPrometheusHeader( out, "hydrogen_missed_engine_locks_total", "counter",
+							"Process cycles skipped since the audio engine could not be locked." );
+	appendPrometheusValue( out, "hydrogen_missed_engine_locks_total", "", snapshot.nMissedLocks );
+	appendPrometheusHeader( out, "hydrogen_profiler_dropped_cycles_total", "counter",
+							"Process cycles the profiler could not account for." );
+	appendPrometheusValue( out, "hydrogen_profiler_dropped_cycles_total", "",
+						   snapshot.nDroppedCycles );
+
+	appendPrometheusHeader( out, "hydrogen_active_voices", "gauge",
+							"Voices rendered in the last process cycle." );
+	appendPrometheusValue( out, "hydrogen_active_voices", "engine=\"sampler\"",
+						   snapshot.nSamplerVoices );
+	appendPrometheusValue( out, "hydrogen_active_voices", "engine=\"synth\"",
+						   snapshot.nSynthVoices );
+
+	appendPrometheusHeader( out, "hydrogen_event_queue_dropped_events_total", "counter",
+							"Events dropped since the event queue was full." );
+	appendPrometheusValue( out, "hydrogen_event_queue_dropped_events_total", "",
+						   snapshot.nDroppedEvents );
+	appendPrometheusHeader( out, "hydrogen_stream_underruns_total", "counter",
+							"Streamed samples not read from disk in time." );
+	appendPrometheusValue( out, "hydrogen_stream_underruns_total", "", snapshot.nStreamUnderruns );
+
+	appendPrometheusHeader( out, "hydrogen_sample_memory_bytes", "gauge",
+							"Memory used by the data of the loaded samples." );
+	appendPrometheusValue( out, "hydrogen_sample_memory_bytes", "kind=\"total\"",
+						   snapshot.nSampleBytes );
+	appendPrometheusValue( out, "hydrogen_sample_memory_bytes", "kind=\"resident\"",
+						   snapshot.nResidentSampleBytes );
+	appendPrometheusValue( out, "hydrogen_sample_memory_bytes", "kind=\"locked\"",
+						   snapshot.nLockedSampleBytes );
+	appendPrometheusValue( out, "hydrogen_sample_memory_bytes", "kind=\"budget\"",
+						   snapshot.nSampleBudgetBytes );
+	appendPrometheusHeader( out, "hydrogen_sample_memory_evictions_total", "counter",
+							"Times the data of a sample was dropped to meet the memory budget." );
+	appendPrometheusValue( out, "hydrogen_sample_memory_evictions_total", "",
+						   snapshot.nSampleEvictions );
+
+	appendPrometheusHeader( out, "hydrogen_export_realtime_factor", "gauge",
+							"Audio rendered per wall clock time during the last export." );
+	appendPrometheusValue( out, "hydrogen_export_realtime_factor", "",
+						   snapshot.fExportRealtimeFactor );
+
+	return out;
+}
+
+static void appendStatsDGauge( QByteArray& out, const QByteArray& name, double fValue )
+{
+	out += "hydrogen." + name + ":" + QByteArray::number( fValue, 'g', 9 ) + "|g\n";
+}
+
+/** Appends the increase of a counter since @a nPrevious. A counter
+	which went down, e.g. after ProcessProfiler::reset(), was
+	restarted from zero.*/
+static void appendStatsDCounter( QByteArray& out, const QByteArray& name, long long nValue,
+								 long long nPrevious )
+{
+	long long nDelta = nValue >= nPrevious ? nValue - nPrevious : nValue;
+	if ( nDelta > 0 ) {
+		out += "hydrogen." + name + ":" + QByteArray::number( nDelta ) + "|c\n";
+	}
+}
+
+QByteArray MetricsExporter::formatStatsD( const Snapshot& snapshot, const Snapshot& previous )
+{
+	QByteArray out;
+
+	for ( int ii = 0; ii < ProcessProfiler::STAGE_COUNT; ++ii ) {
+		const QByteArray stage = QByteArray( "cycle_time." ) + stageMetricNames[ ii ];
+		appendStatsDGauge( out, stage + ".p50", snapshot.stages[ ii ].fMedian );
+		appendStatsDGauge( out, stage + ".p99", snapshot.stages[ ii ].fPercentile99 );
+		appendStatsDGauge( out, stage + ".max", snapshot.stages[ ii ].fMax );
+	}
+
+	appendStatsDCounter( out, "cycles", snapshot.nCycles, previous.nCycles );
+	appendStatsDCounter( out, "xruns", snapshot.nXRuns, previous.nXRuns );
+	appendStatsDCounter( out, "missed_engine_locks", snapshot.nMissedLocks,
+						 previous.nMissedLocks );
+	appendStatsDCounter( out, "profiler_dropped_cycles", snapshot.nDroppedCycles,
+						 previous.nDroppedCycles );
+	appendStatsDGauge( out, "active_voices.sampler", snapshot.nSamplerVoices );
+	appendStatsDGauge( out, "active_voices.synth", snapshot.nSynthVoices );
+	appendStatsDCounter( out, "event_queue_dropped_events", snapshot.nDroppedEvents,
+						 previous.nDroppedEvents );
+	appendStatsDCounter( out, "stream_underruns", snapshot.nStreamUnderruns,
+						 previous.nStreamUnderruns );
+	appendStatsDGauge( out, "sample_memory.total_bytes", snapshot.nSampleBytes );
+	appendStatsDGauge( out, "sample_memory.resident_bytes", snapshot.nResidentSampleBytes );
+	appendStatsDGauge( out, "sample_memory.locked_bytes", snapshot.nLockedSampleBytes );
+	appendStatsDGauge( out, "sample_memory.budget_bytes", snapshot.nSampleBudgetBytes );
+	appendStatsDCounter( out, "sample_memory.evictions", snapshot.nSampleEvictions,
+						 previous.nSampleEvictions );
+	appendStatsDGauge( out, "export_realtime_factor", snapshot.fExportRealtimeFactor );
+
+	return out;
+}
+
+void MetricsExporter::prometheusLoop( Worker* pWorker )
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "metrics" );
+
+	QHostAddress address;
+	if ( ! address.setAddress( pWorker->sHost ) ) {
+		address = QHostAddress::LocalHost;
+	}
+	QTcpServer server;
+	if ( ! server.listen( address, pWorker->nPort ) ) {
+		ERRORLOG( QString( "Unable to listen on [%1:%2]: %3" )
+				  .arg( pWorker->sHost ).arg( pWorker->nPort ).arg( server.errorString() ) );
+		return;
+	}
+
+	while ( ! pWorker->bQuit.load( std::memory_order_relaxed ) ) {
+		if ( ! server.waitForNewConnection( nPollMs ) ) {
+			continue;
+		}
+		QTcpSocket* pSocket = server.nextPendingConnection();
+		if ( pSocket == nullptr ) {
+			continue;
+		}
+
+		// Every request is answered with the metrics regardless
+		// of its path. Only its header is awaited.
+		QByteArray request;
+		while ( ! request.contains( "\r\n\r\n" ) && request.size() < 8192 &&
+				pSocket->waitForReadyRead( 1000 ) ) {
+			request += pSocket->readAll();
+		}
+
+		QByteArray response;
+		if ( request.startsWith( "GET " ) ) {
+			const QByteArray body = formatPrometheus( gather() );
+			response = "HTTP/1.1 200 OK\r\n"
+				"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+				"Content-Length: " + QByteArray::number( body.size() ) + "\r\n"
+				"Connection: close\r\n\r\n" + body;
+		} else {
+			response = "HTTP/1.1 405 Method Not Allowed\r\n"
+				"Content-Length: 0\r\nConnection: close\r\n\r\n";
+		}
+		pSocket->write( response );
+		while ( pSocket->bytesToWrite() > 0 && pSocket->waitForBytesWritten( 1000 ) ) {
+		}
+		pSocket->disconnectFromHost();
+		if ( pSocket->state() != QAbstractSocket::UnconnectedState ) {
+			pSocket->waitForDisconnected( 1000 );
+		}
+		delete pSocket;
+	}
+}
+
+void MetricsExporter::statsDLoop( Worker* pWorker )
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "metrics" );
+
+	QHostAddress address;
+	if ( ! address.setAddress( pWorker->sHost ) ) {
+		QHostInfo info = QHostInfo::fromName( pWorker->sHost );
+		if ( info.addresses().isEmpty() ) {
+			ERRORLOG( QString( "Unable to resolve [%1]: %2" )
+					  .arg( pWorker->sHost ).arg( info.errorString() ) );
+			return;
+		}
+		address = info.addresses().first();
+	}
+
+	QUdpSocket socket;
+	Snapshot previous = gather();
+	auto nextPush = std::chrono::steady_clock::now() + std::chrono::milliseconds( nIntervalMs );
+	bool bReportedError = false;
+
+	while ( ! pWorker->bQuit.load( std::memory_order_relaxed ) ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( nPollMs ) );
+		if ( std::chrono::steady_clock::now() < nextPush ) {
+			continue;
+		}
+		nextPush += std::chrono::milliseconds( nIntervalMs );
+
+		Snapshot snapshot = gather();
+		const QList<QByteArray> lines = formatStatsD( snapshot, previous ).split( '\n' );
+		previous = snapshot;
+
+		// Lines are packed into as few datagrams as possible.
+		QByteArray datagram;
+		for ( int ii = 0; ii <= lines.size(); ++ii ) {
+			const bool bLast = ii == lines.size();
+			if ( ! datagram.isEmpty() &&
+				 ( bLast || datagram.size() + 1 + lines[ ii ].size() > nMaxDatagramSize ) ) {
+				if ( socket.writeDatagram( datagram, address, pWorker->nPort ) < 0 &&
+					 ! bReportedError ) {
+					ERRORLOG( QString( "Unable to send metrics: %1" ).arg( socket.errorString() ) );
+					bReportedError = true;
+				}
+				datagram.clear();
+			}
+			if ( bLast || lines[ ii ].isEmpty() ) {
+				continue;
+			}
+			if ( ! datagram.isEmpty() ) {
+				datagram += '\n';
+			}
+			datagram += lines[ ii ];
+		}
+	}
+}
+
+};
@@ -0,0 +1,138 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <core/Object.h>
+#include <core/ProcessProfiler.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include <atomic>
+#include <cstddef>
+
+namespace H2Core
+{
+
+/**
+ * Exports health metrics of the audio engine to fleet monitoring,
+ * e.g. for installations running many headless instances.
+ *
+ * A background thread either serves them over HTTP in the text
+ * exposition format of Prometheus (#PROTOCOL_PROMETHEUS, pull) or
+ * sends them to a StatsD daemon over UDP every #nIntervalMs
+ * (#PROTOCOL_STATSD, push).
+ *
+ * All values are read from counters the audio thread already
+ * publishes atomically - mostly via the ProcessProfiler - so
+ * exporting never touches the process cycle. The percentiles of the
+ * cycle time are taken from ProcessProfiler::getStatistics(), which
+ * is shared with the AudioEngineInfoForm and the OscServer.
+ */
+class MetricsExporter : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	enum Protocol {
+		/** Scraped via HTTP GET on the port passed to start().*/
+		PROTOCOL_PROMETHEUS = 0,
+		/** Pushed to the host and port passed to start().*/
+		PROTOCOL_STATSD
+	};
+
+	/** Period of the StatsD pushes.*/
+	static constexpr int nIntervalMs = 10000;
+	/** Largest StatsD datagram not fragmented on Ethernet.*/
+	static constexpr int nMaxDatagramSize = 1432;
+
+	/** Values exported at a single point in time.*/
+	struct Snapshot {
+		ProcessProfiler::Statistics stages[ ProcessProfiler::STAGE_COUNT ];
+		long long nCycles;
+		long long nXRuns;
+		long long nMissedLocks;
+		int nDroppedCycles;
+		int nSamplerVoices;
+		int nSynthVoices;
+		int nDroppedEvents;
+		int nStreamUnderruns;
+		size_t nSampleBytes;
+		size_t nResidentSampleBytes;
+		size_t nLockedSampleBytes;
+		size_t nSampleBudgetBytes;
+		int nSampleEvictions;
+		float fExportRealtimeFactor;
+	};
+
+	MetricsExporter();
+	~MetricsExporter();
+
+	/**
+	 * Starts exporting. An exporter already running is replaced.
+	 *
+	 * \param protocol How to export.
+	 * \param sHost For #PROTOCOL_PROMETHEUS the address the HTTP
+	 *   server listens on, e.g. "0.0.0.0" to accept scrapes from
+	 *   other machines. For #PROTOCOL_STATSD the name or address of
+	 *   the StatsD daemon.
+	 * \param nPort TCP respectively UDP port.
+	 *
+	 * \return false if the port is invalid.
+	 */
+	bool start( Protocol protocol, const QString& sHost, int nPort );
+	/** Stops exporting.*/
+	void stop();
+	bool isEnabled() const;
+
+	/** \return Current values of all metrics. Has to be called
+		while the AudioEngine is alive. Never from within the
+		process cycle.*/
+	static Snapshot gather();
+	/** \return @a snapshot in the Prometheus text exposition
+		format.*/
+	static QByteArray formatPrometheus( const Snapshot& snapshot );
+	/**
+	 * \return @a snapshot as newline separated StatsD lines, each
+	 * prefixed with "hydrogen.". Counters are sent as the
+	 * difference to @a previous and omitted if they did not change.
+	 */
+	static QByteArray formatStatsD( const Snapshot& snapshot, const Snapshot& previous );
+	/** \return Protocol named @a sName as stored in
+		Preferences::m_sMetricsProtocol. Falls back to
+		#PROTOCOL_PROMETHEUS.*/
+	static Protocol parseProtocol( const QString& sName );
+
+private:
+	struct Worker;
+
+	void prometheusLoop( Worker* pWorker );
+	void statsDLoop( Worker* pWorker );
+
+	Worker* m_pWorker;
+};
+
+};
+
+#endif
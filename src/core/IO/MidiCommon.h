@@ -25,6 +25,7 @@
 
 #include <core/config.h>
 #include <core/Object.h>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -56,13 +57,17 @@ public:
 	int m_nData1;
 	int m_nData2;
 	int m_nChannel;
+	/** Time the message was received in nanoseconds as returned by
+		rtclock_now_ns() or 0 if unknown.*/
+	int64_t m_nTimestamp;
 	std::vector<unsigned char> m_sysexData;
 
 	MidiMessage()
 			: m_type( UNKNOWN )
 			, m_nData1( -1 )
 			, m_nData2( -1 )
-			, m_nChannel( -1 ) {}
+			, m_nChannel( -1 )
+			, m_nTimestamp( 0 ) {}
 };
 
 
@@ -27,9 +27,13 @@
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/Note.h>
+#include <core/Basics/NotePool.h>
 #include <core/MidiAction.h>
 #include <core/AudioEngine.h>
 #include <core/MidiMap.h>
+#include <core/rt_clock.h>
+
+#include <algorithm>
 
 namespace H2Core
 {
@@ -40,9 +44,16 @@ MidiInput::MidiInput( const char* class_name )
 		, __hihat_cc_openess ( 127 )
 		, __noteOffTick( 0 )
 		, __noteOnTick( 0 )
+		, m_latencySource( LatencyProbe::getSource( class_name ) )
 {
 	//INFOLOG( "INIT" );
 
+	for ( auto& controlChange : m_controlChanges ) {
+		controlChange.nLastDispatch = 0;
+		controlChange.nPendingValue = -1;
+		controlChange.bQueued = false;
+	}
+	m_pendingControlChanges.reserve( 16 * 128 );
 }
 
 
@@ -183,13 +194,31 @@ void MidiInput::handleControlChangeMessage( const MidiMessage& msg )
 {
 	//INFOLOG( QString( "[handleMidiMessage] CONTROL_CHANGE Parameter: %1, Value: %2" ).arg( msg.m_nData1 ).arg( msg.m_nData2 ) );
 	Hydrogen *pEngine = Hydrogen::get_instance();
-	MidiActionManager *pMidiActionManager = MidiActionManager::get_instance();
-	MidiMap *pMidiMap = MidiMap::get_instance();
+	int nWindow = Preferences::get_instance()->m_nMidiCCCoalescingWindow;
 
-	Action *pAction = pMidiMap->getCCAction( msg.m_nData1 );
-	pAction->setParameter2( QString::number( msg.m_nData2 ) );
-
-	pMidiActionManager->handleAction( pAction );
+	if ( nWindow <= 0 || msg.m_nData1 < 0 || msg.m_nData1 >= 128 ) {
+		dispatchControlChange( msg.m_nData1, msg.m_nData2 );
+	} else {
+		// Only the most recent value of each controller within the
+		// window is passed on. The remaining ones are dispatched
+		// by flushControlChanges().
+		int nChannel = ( msg.m_nChannel >= 0 && msg.m_nChannel < 16 ) ? msg.m_nChannel : 0;
+		int nIndex = 128 * nChannel + msg.m_nData1;
+		ControlChange& controlChange = m_controlChanges[ nIndex ];
+
+		int64_t nNow = rtclock_now_ns();
+		if ( nNow - controlChange.nLastDispatch >= static_cast<int64_t>( nWindow ) * 1000000 ) {
+			controlChange.nLastDispatch = nNow;
+			controlChange.nPendingValue = -1;
+			dispatchControlChange( msg.m_nData1, msg.m_nData2 );
+		} else {
+			controlChange.nPendingValue = msg.m_nData2;
+			if ( ! controlChange.bQueued ) {
+				controlChange.bQueued = true;
+				m_pendingControlChanges.push_back( nIndex );
+			}
+		}
+	}
 
 	if(msg.m_nData1 == 04){
 		__hihat_cc_openess = msg.m_nData2;
@@ -199,16 +228,69 @@ void MidiInput::handleControlChangeMessage( const MidiMessage& msg )
 	pEngine->lastMidiEventParameter = msg.m_nData1;
 }
 
+void MidiInput::dispatchControlChange( int nParameter, int nValue )
+{
+	CompiledAction action = MidiMap::get_instance()->getCompiledCCAction( nParameter );
+	action.nParameter2 = nValue;
+
+	MidiActionManager::get_instance()->handleAction( action );
+}
+
+int MidiInput::flushControlChanges()
+{
+	if ( m_pendingControlChanges.empty() ) {
+		return -1;
+	}
+
+	int nWindow = Preferences::get_instance()->m_nMidiCCCoalescingWindow;
+	int64_t nWindowNs = static_cast<int64_t>( std::max( nWindow, 0 ) ) * 1000000;
+	int64_t nNow = rtclock_now_ns();
+	int64_t nNextDue = -1;
+	bool bHasSong = Hydrogen::get_instance()->getSong() != nullptr;
+
+	size_t nKept = 0;
+	for ( size_t ii = 0; ii < m_pendingControlChanges.size(); ++ii ) {
+		int nIndex = m_pendingControlChanges[ ii ];
+		ControlChange& controlChange = m_controlChanges[ nIndex ];
+
+		if ( controlChange.nPendingValue >= 0 ) {
+			int64_t nRemaining = controlChange.nLastDispatch + nWindowNs - nNow;
+			if ( nRemaining > 0 ) {
+				if ( nNextDue < 0 || nRemaining < nNextDue ) {
+					nNextDue = nRemaining;
+				}
+				m_pendingControlChanges[ nKept++ ] = nIndex;
+				continue;
+			}
+
+			int nValue = controlChange.nPendingValue;
+			controlChange.nLastDispatch = nNow;
+			controlChange.nPendingValue = -1;
+			if ( bHasSong ) {
+				dispatchControlChange( nIndex % 128, nValue );
+			}
+		}
+		controlChange.bQueued = false;
+	}
+	m_pendingControlChanges.resize( nKept );
+
+	if ( nNextDue < 0 ) {
+		return -1;
+	}
+	// Round up to not wake up before the value is due.
+	return static_cast<int>( ( nNextDue + 999999 ) / 1000000 );
+}
+
 void MidiInput::handleProgramChangeMessage( const MidiMessage& msg )
 {
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	MidiActionManager *pMidiActionManager = MidiActionManager::get_instance();
 	MidiMap *pMidiMap = MidiMap::get_instance();
 
-	Action *pAction = pMidiMap->getPCAction();
-	pAction->setParameter2( QString::number( msg.m_nData1 ) );
+	CompiledAction action = pMidiMap->getCompiledPCAction();
+	action.nParameter2 = msg.m_nData1;
 
-	pMidiActionManager->handleAction( pAction );
+	pMidiActionManager->handleAction( action );
 
 	pEngine->lastMidiEvent = "PROGRAM_CHANGE";
 	pEngine->lastMidiEventParameter = 0;
@@ -233,7 +315,7 @@ void MidiInput::handleNoteOnMessage( const MidiMessage& msg )
 	pEngine->lastMidiEvent = "NOTE";
 	pEngine->lastMidiEventParameter = msg.m_nData1;
 
-	bool bActionSuccess = pMidiActionManager->handleAction( pMidiMap->getNoteAction( msg.m_nData1 ) );
+	bool bActionSuccess = pMidiActionManager->handleAction( pMidiMap->getCompiledNoteAction( msg.m_nData1 ) );
 
 	if ( bActionSuccess && Preferences::get_instance()->m_bMidiDiscardNoteAfterAction)
 	{
@@ -260,14 +342,14 @@ void MidiInput::handleNoteOnMessage( const MidiMessage& msg )
 			pInstr= pInstrList->get( pEngine->getSelectedInstrumentNumber());
 		}
 		else if(Preferences::get_instance()->m_bMidiFixedMapping ){
-			pInstr = pInstrList->findMidiNote( nNote );
+			nInstrument = pInstrList->findMidiNoteIndex( nNote );
 			
-			if(pInstr == nullptr) {
+			if( nInstrument < 0 ) {
 				WARNINGLOG( QString( "Can't find corresponding Instrument for note %1" ).arg( nNote ));
 				return;
 			}
 			
-			nInstrument = pInstrList->index( pInstr );
+			pInstr = pInstrList->get( nInstrument );
 		} else {
 			if(nInstrument < 0) {
 				//Drop everything < 36
@@ -305,7 +387,8 @@ void MidiInput::handleNoteOnMessage( const MidiMessage& msg )
 			}
 		}
 
-		pEngine->addRealtimeNote( nInstrument, fVelocity, fPan_L, fPan_R, 0.0, false, true, nNote );
+		pEngine->addRealtimeNote( nInstrument, fVelocity, fPan_L, fPan_R, 0.0, false, true, nNote,
+								  msg.m_nTimestamp, m_latencySource );
 	}
 
 	__noteOnTick = pEngine->__getMidiRealtimeNoteTickPosition();
@@ -345,13 +428,13 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg, bool CymbalChoke )
 		nInstrument = pEngine->getSelectedInstrumentNumber();
 		pInstr = pInstrList->get( pEngine->getSelectedInstrumentNumber());
 	} else if( Preferences::get_instance()->m_bMidiFixedMapping ) {
-		pInstr = pInstrList->findMidiNote( nNote );
+		nInstrument = pInstrList->findMidiNoteIndex( nNote );
 
-		if( pInstr == nullptr ) {
+		if( nInstrument < 0 ) {
 			WARNINGLOG( QString( "Can't find corresponding Instrument for note %1" ).arg( nNote ));
 			return;
 		}
-		nInstrument = pInstrList->index(pInstr);
+		pInstr = pInstrList->get( nInstrument );
 	}
 	else {
 		if( nInstrument < 0 ) {
@@ -383,7 +466,7 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg, bool CymbalChoke )
 				return;
 			}
 			
-			Note *pOffNote = new Note( pInstr,
+			Note *pOffNote = new ( NotePool::get_instance() ) Note( pInstr,
 										0.0,
 										0.0,
 										0.0,
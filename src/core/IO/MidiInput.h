@@ -24,6 +24,8 @@
 #define H2_MIDI_INPUT_H
 
 #include <core/Object.h>
+#include <core/LatencyProbe.h>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "MidiCommon.h"
@@ -53,6 +55,21 @@ public:
 	void handleProgramChangeMessage( const MidiMessage& msg );
 	void handlePolyphonicKeyPressureMessage( const MidiMessage& msg );
 
+	/**
+	 * Dispatches all control change messages held back by the
+	 * coalescing of Preferences::m_nMidiCCCoalescingWindow whose
+	 * window did elapse.
+	 *
+	 * Has to be called regularly by the thread passing the incoming
+	 * messages to handleMidiMessage(). Otherwise the last value of a
+	 * fader movement is only dispatched once the next message
+	 * arrives.
+	 *
+	 * \return Time in milliseconds till the next held back message is
+	 * due or -1 if there is none.
+	 */
+	int flushControlChanges();
+
 protected:
 	bool m_bActive;
 
@@ -66,6 +83,28 @@ private:
 	unsigned long computeDeltaNoteOnOfftime();
 
 	int __hihat_cc_openess;
+
+	/** Driver notes received by this input are attributed to in
+		the LatencyProbe.*/
+	LatencyProbe::Source m_latencySource;
+
+	/** Passes the value of a control change message to the action
+		registered in the MidiMap.*/
+	void dispatchControlChange( int nParameter, int nValue );
+
+	struct ControlChange {
+		/** Time of the last dispatch in nanoseconds.*/
+		int64_t nLastDispatch;
+		/** Most recent value held back or -1.*/
+		int nPendingValue;
+		/** Whether the controller is in #m_pendingControlChanges.*/
+		bool bQueued;
+	};
+	/** Indexed by 128 * channel + controller.*/
+	ControlChange m_controlChanges[ 16 * 128 ];
+	/** Indices into #m_controlChanges of all controllers holding
+		back a value. Its capacity is reserved up front.*/
+	std::vector<int> m_pendingControlChanges;
 };
 
 };
@@ -44,10 +44,36 @@ public:
 	
 	virtual std::vector<QString> getInputPortList() = 0;
 
-	virtual void handleQueueNote(Note* pNote) = 0;
-	virtual void handleQueueNoteOff( int channel, int key, int velocity ) = 0;
+	/**
+	 * Sends a note on preceded by a note off of the same key.
+	 *
+	 * Called by the audio engine. Drivers supporting it collect the
+	 * events of the current process cycle and send them in
+	 * flushQueuedEvents().
+	 *
+	 * \param pNote Note to send.
+	 * \param nFrame Offset in frames of the note within the current
+	 * process cycle.
+	 */
+	virtual void handleQueueNote( Note* pNote, int nFrame ) = 0;
+	/**
+	 * Sends a note off. Same as handleQueueNote().
+	 */
+	virtual void handleQueueNoteOff( int channel, int key, int velocity, int nFrame ) = 0;
+	/** Immediately sends a note off for all instruments of the
+		current song.*/
 	virtual void handleQueueAllNoteOff() = 0;
 	virtual void handleOutgoingControlChange( int param, int value, int channel ) = 0;
+	/**
+	 * Hands all events collected by handleQueueNote() and
+	 * handleQueueNoteOff() during the current process cycle over
+	 * to the MIDI system at once.
+	 *
+	 * Called by the audio engine at the end of each process
+	 * cycle. Drivers sending their events immediately do not have to
+	 * implement it.
+	 */
+	virtual void flushQueuedEvents() {}
 };
 
 };
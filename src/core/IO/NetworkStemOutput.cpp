@@ -0,0 +1,346 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/NetworkStemOutput.h>
+
+#include <core/AudioEngine.h>
+#include <core/rt_clock.h>
+#include <core/Helpers/Threads.h>
+#include <core/IO/AudioOutput.h>
+
+#include <QtCore/QStringList>
+#include <QtCore/QtEndian>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QHostInfo>
+#include <QtNetwork/QUdpSocket>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace H2Core
+{
+
+const char* NetworkStemOutput::__class_name = "NetworkStemOutput";
+
+/** Tracks of a single process cycle.*/
+struct NetworkStemChunk {
+	long long nFrame;
+	int64_t nTimeNs;
+	unsigned nSampleRate;
+	int nFrames;
+	bool bDiscontinuity;
+	/** Interleaved samples of all channels.*/
+	std::vector<float> data;
+};
+
+struct NetworkStemOutput::Stream {
+	QString sHost;
+	int nPort;
+	std::vector<int> tracks;
+	int nChannels;
+
+	/** Single producer single consumer ring written by process().*/
+	std::vector<NetworkStemChunk> chunks;
+	std::atomic<uint32_t> nWrite;
+	std::atomic<uint32_t> nRead;
+
+	/** Stream frame of the next frame handed to process(). Only
+		accessed by the audio engine.*/
+	long long nFrame;
+	/** Whether frames were dropped since the last chunk written.
+		Only accessed by the audio engine.*/
+	bool bDiscontinuity;
+
+	std::atomic<bool> bQuit;
+	std::thread sender;
+};
+
+NetworkStemOutput::NetworkStemOutput()
+	: Object( __class_name )
+	, m_pStream( nullptr )
+	, m_nDroppedFrames( 0 )
+	, m_nSentDatagrams( 0 )
+{
+}
+
+NetworkStemOutput::~NetworkStemOutput()
+{
+	// The process cycle is not running anymore once the
+	// AudioEngine destroys its helpers.
+	if ( m_pStream != nullptr ) {
+		m_pStream->bQuit = true;
+		m_pStream->sender.join();
+		delete m_pStream;
+	}
+}
+
+bool NetworkStemOutput::start( const QString& sHost, int nPort, const std::vector<int>& tracks )
+{
+	if ( nPort <= 0 || nPort > 65535 ) {
+		ERRORLOG( QString( "Invalid port [%1]" ).arg( nPort ) );
+		return false;
+	}
+	int nChannels = 2 * static_cast<int>( tracks.size() );
+	if ( nChannels == 0 || nChannels > nMaxChannels ) {
+		ERRORLOG( QString( "Unable to stream [%1] tracks. Between 1 and %2 are supported" )
+				  .arg( tracks.size() ).arg( nMaxChannels / 2 ) );
+		return false;
+	}
+	for ( int nTrack : tracks ) {
+		if ( nTrack < 0 ) {
+			ERRORLOG( QString( "Invalid track [%1]" ).arg( nTrack ) );
+			return false;
+		}
+	}
+
+	Stream* pStream = new Stream;
+	pStream->sHost = sHost;
+	pStream->nPort = nPort;
+	pStream->tracks = tracks;
+	pStream->nChannels = nChannels;
+	pStream->chunks.resize( nChunks );
+	for ( auto& chunk : pStream->chunks ) {
+		chunk.data.resize( nChunkFrames * nChannels );
+	}
+	pStream->nWrite = 0;
+	pStream->nRead = 0;
+	pStream->nFrame = 0;
+	pStream->bDiscontinuity = false;
+	pStream->bQuit = false;
+	pStream->sender = std::thread( &NetworkStemOutput::senderLoop, this, pStream );
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	std::swap( m_pStream, pStream );
+	m_nDroppedFrames = 0;
+	m_nSentDatagrams = 0;
+	AudioEngine::get_instance()->unlock();
+
+	if ( pStream != nullptr ) {
+		pStream->bQuit = true;
+		pStream->sender.join();
+		delete pStream;
+	}
+
+	INFOLOG( QString( "Streaming [%1] tracks to [%2:%3]" )
+			 .arg( tracks.size() ).arg( sHost ).arg( nPort ) );
+	return true;
+}
+
+void NetworkStemOutput::stop()
+{
+	Stream* pStream = nullptr;
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	std::swap( m_pStream, pStream );
+	AudioEngine::get_instance()->unlock();
+
+	if ( pStream != nullptr ) {
+		pStream->bQuit = true;
+		pStream->sender.join();
+		delete pStream;
+		INFOLOG( "Stopped streaming" );
+	}
+}
+
+bool NetworkStemOutput::isEnabled() const
+{
+	return m_pStream != nullptr;
+}
+
+long long NetworkStemOutput::getDroppedFrames() const
+{
+	return m_nDroppedFrames.load( std::memory_order_relaxed );
+}
+
+long long NetworkStemOutput::getSentDatagrams() const
+{
+	return m_nSentDatagrams.load( std::memory_order_relaxed );
+}
+
+void NetworkStemOutput::process( AudioOutput* pDriver, const float* pMain_L, const float* pMain_R,
+								 uint32_t nFrames, unsigned nSampleRate )
+{
+	Stream* pStream = m_pStream;
+	if ( pStream == nullptr || nFrames == 0 ) {
+		return;
+	}
+
+	const int nTracks = static_cast<int>( pStream->tracks.size() );
+	const float* buffers[ nMaxChannels ];
+	for ( int ii = 0; ii < nTracks; ++ii ) {
+		int nTrack = pStream->tracks[ ii ];
+		if ( nTrack == 0 ) {
+			buffers[ 2 * ii ] = pMain_L;
+			buffers[ 2 * ii + 1 ] = pMain_R;
+		} else if ( pDriver != nullptr ) {
+			buffers[ 2 * ii ] = pDriver->getTrackBuffer_L( nTrack - 1 );
+			buffers[ 2 * ii + 1 ] = pDriver->getTrackBuffer_R( nTrack - 1 );
+		} else {
+			buffers[ 2 * ii ] = nullptr;
+			buffers[ 2 * ii + 1 ] = nullptr;
+		}
+	}
+
+	const int nChannels = pStream->nChannels;
+	const int64_t nNow = rtclock_now_ns();
+	uint32_t nOffset = 0;
+	while ( nOffset < nFrames ) {
+		int nChunkSize = std::min( static_cast<uint32_t>( nChunkFrames ), nFrames - nOffset );
+
+		uint32_t nWrite = pStream->nWrite.load( std::memory_order_relaxed );
+		if ( nWrite - pStream->nRead.load( std::memory_order_acquire ) >= nChunks ) {
+			m_nDroppedFrames.fetch_add( nChunkSize, std::memory_order_relaxed );
+			pStream->bDiscontinuity = true;
+		} else {
+			NetworkStemChunk& chunk = pStream->chunks[ nWrite % nChunks ];
+			chunk.nFrame = pStream->nFrame;
+			chunk.nTimeNs = nNow;
+			if ( nSampleRate > 0 ) {
+				chunk.nTimeNs += static_cast<int64_t>( nOffset ) * 1000000000LL / nSampleRate;
+			}
+			chunk.nSampleRate = nSampleRate;
+			chunk.nFrames = nChunkSize;
+			chunk.bDiscontinuity = pStream->bDiscontinuity;
+			pStream->bDiscontinuity = false;
+
+			float* pData = chunk.data.data();
+			for ( int nChannel = 0; nChannel < nChannels; ++nChannel ) {
+				const float* pSrc = buffers[ nChannel ];
+				if ( pSrc == nullptr ) {
+					for ( int ii = 0; ii < nChunkSize; ++ii ) {
+						pData[ ii * nChannels + nChannel ] = 0;
+					}
+				} else {
+					pSrc += nOffset;
+					for ( int ii = 0; ii < nChunkSize; ++ii ) {
+						pData[ ii * nChannels + nChannel ] = pSrc[ ii ];
+					}
+				}
+			}
+			pStream->nWrite.store( nWrite + 1, std::memory_order_release );
+		}
+
+		pStream->nFrame += nChunkSize;
+		nOffset += nChunkSize;
+	}
+}
+
+void NetworkStemOutput::senderLoop( Stream* pStream )
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "network stems" );
+
+	QHostAddress address;
+	if ( ! address.setAddress( pStream->sHost ) ) {
+		QHostInfo info = QHostInfo::fromName( pStream->sHost );
+		if ( info.addresses().isEmpty() ) {
+			ERRORLOG( QString( "Unable to resolve [%1]: %2" )
+					  .arg( pStream->sHost ).arg( info.errorString() ) );
+			return;
+		}
+		address = info.addresses().first();
+	}
+
+	QUdpSocket socket;
+	const int nChannels = pStream->nChannels;
+	const int nFramesPerDatagram = ( nMaxDatagramSize - nHeaderSize ) / ( 4 * nChannels );
+	std::vector<uchar> datagram( nMaxDatagramSize );
+	uint32_t nSequence = 0;
+	bool bReportedError = false;
+
+	while ( ! pStream->bQuit.load( std::memory_order_relaxed ) ) {
+		uint32_t nRead = pStream->nRead.load( std::memory_order_relaxed );
+		if ( nRead == pStream->nWrite.load( std::memory_order_acquire ) ) {
+			// Polling keeps the audio thread from having to wake us
+			// up. A millisecond is well below the period of typical
+			// jitter buffers.
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			continue;
+		}
+
+		const NetworkStemChunk& chunk = pStream->chunks[ nRead % nChunks ];
+		for ( int nOffset = 0; nOffset < chunk.nFrames; nOffset += nFramesPerDatagram ) {
+			int nDatagramFrames = std::min( nFramesPerDatagram, chunk.nFrames - nOffset );
+
+			uchar* p = datagram.data();
+			qToLittleEndian<quint32>( nMagic, p );
+			qToLittleEndian<quint16>( nVersion, p + 4 );
+			qToLittleEndian<quint16>( nChannels, p + 6 );
+			qToLittleEndian<quint32>( nSequence, p + 8 );
+			qToLittleEndian<quint32>( chunk.nSampleRate, p + 12 );
+			qToLittleEndian<quint64>( chunk.nFrame + nOffset, p + 16 );
+			qint64 nTimeNs = chunk.nTimeNs;
+			if ( chunk.nSampleRate > 0 ) {
+				nTimeNs += static_cast<int64_t>( nOffset ) * 1000000000LL / chunk.nSampleRate;
+			}
+			qToLittleEndian<qint64>( nTimeNs, p + 24 );
+			qToLittleEndian<quint16>( nDatagramFrames, p + 32 );
+			qToLittleEndian<quint16>( nOffset == 0 && chunk.bDiscontinuity ?
+									  nFlagDiscontinuity : 0, p + 34 );
+
+			p += nHeaderSize;
+			const float* pSrc = chunk.data.data() + nOffset * nChannels;
+			for ( int ii = 0; ii < nDatagramFrames * nChannels; ++ii ) {
+				quint32 nBits;
+				memcpy( &nBits, &pSrc[ ii ], sizeof( nBits ) );
+				qToLittleEndian<quint32>( nBits, p );
+				p += 4;
+			}
+
+			qint64 nSize = p - datagram.data();
+			if ( socket.writeDatagram( reinterpret_cast<const char*>( datagram.data() ),
+									   nSize, address, pStream->nPort ) != nSize ) {
+				// e.g. ICMP port unreachable while the receiver is not
+				// running yet.
+				if ( ! bReportedError ) {
+					WARNINGLOG( QString( "Unable to send to [%1:%2]: %3" )
+								.arg( address.toString() ).arg( pStream->nPort )
+								.arg( socket.errorString() ) );
+					bReportedError = true;
+				}
+			} else {
+				bReportedError = false;
+				m_nSentDatagrams.fetch_add( 1, std::memory_order_relaxed );
+			}
+			++nSequence;
+		}
+
+		pStream->nRead.store( nRead + 1, std::memory_order_release );
+	}
+}
+
+std::vector<int> NetworkStemOutput::parseTracks( const QString& sTracks )
+{
+	std::vector<int> tracks;
+	for ( const auto& sTrack : sTracks.split( ',', QString::SkipEmptyParts ) ) {
+		bool bOk;
+		int nTrack = sTrack.trimmed().toInt( &bOk );
+		if ( bOk && nTrack >= 0 &&
+			 std::find( tracks.begin(), tracks.end(), nTrack ) == tracks.end() ) {
+			tracks.push_back( nTrack );
+		}
+	}
+	return tracks;
+}
+
+};
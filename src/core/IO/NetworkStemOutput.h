@@ -0,0 +1,154 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef NETWORK_STEM_OUTPUT_H
+#define NETWORK_STEM_OUTPUT_H
+
+#include <core/Object.h>
+
+#include <QtCore/QString>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace H2Core
+{
+
+class AudioOutput;
+
+/**
+ * Streams the main output and the per-track outputs of the audio
+ * driver to a remote host, e.g. a front-of-house mixer running on a
+ * separate machine the JACK ports of Hydrogen do not reach.
+ *
+ * The selected tracks are sent as uncompressed PCM over UDP. Track 0
+ * is the main output and track n the n-th per-track output of the
+ * driver, see AudioOutput::getTrackBuffer_L(). Tracks the driver
+ * does not provide are sent as silence.
+ *
+ * process() is called at the end of each process cycle and copies
+ * the tracks into a fixed ring of chunks. A sender thread takes them
+ * from there and writes the datagrams, so the audio thread never
+ * touches a socket. If the sender falls behind, whole chunks are
+ * dropped rather than blocking the audio thread.
+ *
+ * Each datagram starts with the following header, all fields little
+ * endian:
+ *
+ * - uint32 magic, #nMagic
+ * - uint16 version, #nVersion
+ * - uint16 number of channels, two per track
+ * - uint32 sequence number, increased by one per datagram
+ * - uint32 sample rate
+ * - uint64 stream frame of the first frame of the datagram
+ * - int64 steady clock time of the process cycle of this frame in ns
+ * - uint16 number of frames
+ * - uint16 flags, see #nFlagDiscontinuity
+ *
+ * followed by the interleaved float32 samples of all channels. Frames
+ * dropped by the sender still advance the stream frame. Together with
+ * the sequence numbers this lets the receiver place late and
+ * reordered datagrams in its jitter buffer. Pairs of stream frame and
+ * time allow it to estimate the drift between the two sample clocks
+ * and resample accordingly.
+ */
+class NetworkStemOutput : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	static constexpr uint32_t nMagic = 0x54533248; // "H2ST"
+	static constexpr uint16_t nVersion = 1;
+	static constexpr int nHeaderSize = 36;
+	/** Largest datagram not fragmented on Ethernet.*/
+	static constexpr int nMaxDatagramSize = 1472;
+	/** Limit of the number of channels fitting at least a few frames
+		into each datagram.*/
+	static constexpr int nMaxChannels = 64;
+	/** Frames per chunk of the ring.*/
+	static constexpr int nChunkFrames = 128;
+	/** Number of chunks of the ring, about 0.3 s at 48 kHz.*/
+	static constexpr int nChunks = 128;
+	/** Set in the first datagram following dropped frames.*/
+	static constexpr uint16_t nFlagDiscontinuity = 1;
+
+	NetworkStemOutput();
+	~NetworkStemOutput();
+
+	/**
+	 * Starts streaming @a tracks to @a sHost on UDP port @a nPort.
+	 * A stream already running is replaced.
+	 *
+	 * Must not be called from within the process cycle. The
+	 * AudioEngine is locked while the stream is swapped.
+	 *
+	 * \return false if the tracks or the port are invalid.
+	 */
+	bool start( const QString& sHost, int nPort, const std::vector<int>& tracks );
+	/** Stops streaming. Same constraints as start().*/
+	void stop();
+	bool isEnabled() const;
+
+	/**
+	 * Hands the first @a nFrames frames of the tracks of the current
+	 * process cycle to the sender thread.
+	 *
+	 * Called by audioEngine_process() with the AudioEngine locked.
+	 * Neither locks nor allocates.
+	 *
+	 * \param pDriver Driver providing the per-track outputs. May be
+	 *   nullptr
+	 * \param pMain_L Left channel of the main output. May be nullptr.
+	 * \param pMain_R Right channel of the main output. May be nullptr.
+	 */
+	void process( AudioOutput* pDriver, const float* pMain_L, const float* pMain_R,
+				  uint32_t nFrames, unsigned nSampleRate );
+
+	/** \return Number of frames dropped since start() because the
+		sender did not keep up.*/
+	long long getDroppedFrames() const;
+	/** \return Number of datagrams sent since start().*/
+	long long getSentDatagrams() const;
+
+	/**
+	 * \return Tracks in the comma separated list @a sTracks, e.g.
+	 * "0,1,2", as stored in Preferences::m_sNetworkStemsTracks.
+	 * Invalid entries are skipped.
+	 */
+	static std::vector<int> parseTracks( const QString& sTracks );
+
+private:
+	struct Stream;
+
+	void senderLoop( Stream* pStream );
+
+	/** Only replaced with the AudioEngine locked.*/
+	Stream* m_pStream;
+	std::atomic<long long> m_nDroppedFrames;
+	std::atomic<long long> m_nSentDatagrams;
+};
+
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/IO/OfflineDriver.h>
+
+#include <core/config.h>
+#include <core/Basics/Instrument.h>
+#include <core/Helpers/Dsp.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* OfflineDriver::__class_name = "OfflineDriver";
+
+OfflineDriver::OfflineDriver( audioProcessCallback processCallback, unsigned nSampleRate )
+		: AudioOutput( __class_name )
+		, m_processCallback( processCallback )
+		, m_nSampleRate( nSampleRate )
+		, m_nBufferSize( 0 )
+		, m_bFinished( false )
+		, m_pOut_L( nullptr )
+		, m_pOut_R( nullptr )
+		, m_pBuffer_L( nullptr )
+		, m_pBuffer_R( nullptr )
+		, m_pTrackInstrument( nullptr )
+{
+	INFOLOG( "INIT" );
+}
+
+
+OfflineDriver::~OfflineDriver()
+{
+	INFOLOG( "DESTROY" );
+	disconnect();
+	freeTracks();
+}
+
+
+int OfflineDriver::init( unsigned nBufferSize )
+{
+	INFOLOG( QString( "Init, %1 samples" ).arg( nBufferSize ) );
+
+	disconnect();
+	m_nBufferSize = nBufferSize;
+	m_pBuffer_L = new float[ nBufferSize ];
+	m_pBuffer_R = new float[ nBufferSize ];
+	m_pOut_L = m_pBuffer_L;
+	m_pOut_R = m_pBuffer_R;
+	allocateTracks();
+
+	return 0;
+}
+
+
+int OfflineDriver::connect()
+{
+	INFOLOG( "connect" );
+
+	m_bFinished = false;
+	m_transport.m_status = TransportInfo::ROLLING;
+
+	return 0;
+}
+
+
+void OfflineDriver::disconnect()
+{
+	delete[] m_pBuffer_L;
+	m_pBuffer_L = nullptr;
+
+	delete[] m_pBuffer_R;
+	m_pBuffer_R = nullptr;
+
+	m_pOut_L = m_pOut_R = nullptr;
+}
+
+
+uint32_t OfflineDriver::render( float* pOut_L, float* pOut_R, uint32_t nFrames )
+{
+	uint32_t nRendered = 0;
+	while ( nRendered < nFrames && ! m_bFinished ) {
+		uint32_t nChunk = std::min<uint32_t>( m_nBufferSize, nFrames - nRendered );
+		m_pOut_L = pOut_L + nRendered;
+		m_pOut_R = pOut_R + nRendered;
+
+		int nRet;
+		// 2 is returned if the engine could not be locked in time.
+		while ( ( nRet = m_processCallback( nChunk, nullptr ) ) == 2 ) {
+		}
+		if ( nRet != 0 ) {
+			m_bFinished = true;
+		} else {
+			nRendered += nChunk;
+		}
+	}
+	m_pOut_L = m_pBuffer_L;
+	m_pOut_R = m_pBuffer_R;
+
+	return nRendered;
+}
+
+
+void OfflineDriver::setTrackInstrument( Instrument* pInstr )
+{
+	m_pTrackInstrument = pInstr;
+	allocateTracks();
+}
+
+
+void OfflineDriver::allocateTracks()
+{
+	freeTracks();
+	if ( m_pTrackInstrument == nullptr || m_nBufferSize == 0 ) {
+		return;
+	}
+
+	int nTracks = std::min( static_cast<int>( m_pTrackInstrument->get_components()->size() ),
+							MAX_COMPONENTS );
+	for ( int ii = 0; ii < nTracks; ++ii ) {
+		m_tracks_L.push_back( new float[ m_nBufferSize ] );
+		m_tracks_R.push_back( new float[ m_nBufferSize ] );
+	}
+	clearTracks( m_nBufferSize );
+}
+
+
+void OfflineDriver::freeTracks()
+{
+	for ( auto pTrack : m_tracks_L ) {
+		delete[] pTrack;
+	}
+	for ( auto pTrack : m_tracks_R ) {
+		delete[] pTrack;
+	}
+	m_tracks_L.clear();
+	m_tracks_R.clear();
+}
+
+
+void OfflineDriver::clearTracks( unsigned nFrames )
+{
+	nFrames = std::min( nFrames, m_nBufferSize );
+	for ( int ii = 0; ii < getTrackCount(); ++ii ) {
+		Dsp::clear( m_tracks_L[ ii ], nFrames );
+		Dsp::clear( m_tracks_R[ ii ], nFrames );
+	}
+}
+
+
+int OfflineDriver::getTrackIndex( Instrument* pInstr, InstrumentComponent* pCompo ) const
+{
+	if ( pInstr != m_pTrackInstrument || pInstr == nullptr ) {
+		return -1;
+	}
+	const auto pComponents = pInstr->get_components();
+	for ( int ii = 0; ii < getTrackCount(); ++ii ) {
+		if ( (*pComponents)[ ii ] == pCompo ) {
+			return ii;
+		}
+	}
+	return -1;
+}
+
+
+float* OfflineDriver::getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	int nTrack = getTrackIndex( pInstr, pCompo );
+	return nTrack >= 0 ? m_tracks_L[ nTrack ] : nullptr;
+}
+
+
+float* OfflineDriver::getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	int nTrack = getTrackIndex( pInstr, pCompo );
+	return nTrack >= 0 ? m_tracks_R[ nTrack ] : nullptr;
+}
+
+
+void OfflineDriver::play()
+{
+	m_transport.m_status = TransportInfo::ROLLING;
+}
+
+void OfflineDriver::stop()
+{
+	m_transport.m_status = TransportInfo::STOPPED;
+}
+
+void OfflineDriver::locate( unsigned long nFrame )
+{
+	m_transport.m_nFrames = nFrame;
+}
+
+void OfflineDriver::updateTransportInfo()
+{
+	// not used
+}
+
+void OfflineDriver::setBpm( float fBPM )
+{
+	m_transport.m_fBPM = fBPM;
+}
+
+};
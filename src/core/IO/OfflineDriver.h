@@ -0,0 +1,147 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef OFFLINE_DRIVER_H
+#define OFFLINE_DRIVER_H
+
+#include <core/IO/AudioOutput.h>
+#include <inttypes.h>
+
+#include <vector>
+
+namespace H2Core
+{
+
+typedef int  ( *audioProcessCallback )( uint32_t, void * );
+
+/**
+ * Audio driver without a thread of its own. The audio engine is run
+ * by render() from the thread of the caller and writes its main
+ * output directly into the buffers passed to it.
+ *
+ * Created by Hydrogen::startOfflineRender() and used by
+ * OfflineRenderer and InstrumentFreezer.
+ */
+class OfflineDriver : public AudioOutput
+{
+	H2_OBJECT
+public:
+	OfflineDriver( audioProcessCallback processCallback, unsigned nSampleRate );
+	~OfflineDriver();
+
+	int init( unsigned nBufferSize );
+	int connect();
+	void disconnect();
+	unsigned getBufferSize() {
+		return m_nBufferSize;
+	}
+	unsigned getSampleRate() {
+		return m_nSampleRate;
+	}
+
+	float* getOut_L() {
+		return m_pOut_L;
+	}
+	float* getOut_R() {
+		return m_pOut_R;
+	}
+
+	/**
+	 * Renders the next @a nFrames frames of the song into @a pOut_L
+	 * and @a pOut_R in chunks of at most getBufferSize() frames.
+	 *
+	 * \return Number of frames written. It is smaller than @a
+	 * nFrames once the end of the song was reached.
+	 */
+	uint32_t render( float* pOut_L, float* pOut_R, uint32_t nFrames );
+	/** Whether render() reached the end of the song.*/
+	bool isFinished() const {
+		return m_bFinished;
+	}
+
+	/**
+	 * Renders each component of @a pInstr into a track of its own in
+	 * addition to the main output. The Sampler writes the voices
+	 * into the tracks before the volume and mute of the instrument,
+	 * its components, and the song are applied.
+	 *
+	 * \param pInstr nullptr to remove the tracks.
+	 */
+	void setTrackInstrument( Instrument* pInstr );
+	/** \return Whether setTrackInstrument() was called.*/
+	bool hasTracks() const {
+		return m_pTrackInstrument != nullptr;
+	}
+	/** \return Number of tracks. One per component of the
+		instrument passed to setTrackInstrument().*/
+	int getTrackCount() const {
+		return m_tracks_L.size();
+	}
+	/** \return Left channel of track @a nTrack holding the frames of
+		the last render() chunk.*/
+	float* getTrack_L( int nTrack ) {
+		return m_tracks_L[ nTrack ];
+	}
+	/** Right channel counterpart of getTrack_L().*/
+	float* getTrack_R( int nTrack ) {
+		return m_tracks_R[ nTrack ];
+	}
+	/** Zeros the first @a nFrames frames of all tracks.*/
+	void clearTracks( unsigned nFrames );
+
+	virtual float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo );
+	virtual float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo );
+
+	virtual void play();
+	virtual void stop();
+	virtual void locate( unsigned long nFrame );
+	virtual void updateTransportInfo();
+	virtual void setBpm( float fBPM );
+
+private:
+	audioProcessCallback m_processCallback;
+	unsigned m_nSampleRate;
+	unsigned m_nBufferSize;
+	bool m_bFinished;
+	/** Point into the buffers passed to render() while the engine
+		is processing and to #m_pBuffer_L and #m_pBuffer_R
+		otherwise.*/
+	float* m_pOut_L;
+	float* m_pOut_R;
+	float* m_pBuffer_L;
+	float* m_pBuffer_R;
+
+	/** \return Index of @a pCompo within the components of
+		#m_pTrackInstrument or -1.*/
+	int getTrackIndex( Instrument* pInstr, InstrumentComponent* pCompo ) const;
+	/** (Re)allocates the tracks of #m_pTrackInstrument.*/
+	void allocateTracks();
+	void freeTracks();
+
+	Instrument* m_pTrackInstrument;
+	std::vector<float*> m_tracks_L;
+	std::vector<float*> m_tracks_R;
+};
+
+};
+
+#endif
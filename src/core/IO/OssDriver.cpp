@@ -26,6 +26,8 @@
 #if defined(H2CORE_HAVE_OSS) || _DOXYGEN_
 
 #include <core/Preferences.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
 
 #include <pthread.h>
 
@@ -42,19 +44,12 @@ unsigned nNextFrames = 0;
 
 void* ossDriver_processCaller( void* param )
 {
-	Object* __object = ( Object* )param;
-	// stolen from amSynth
-	struct sched_param sched;
-	sched.sched_priority = 50;
-	int res = sched_setscheduler( 0, SCHED_FIFO, &sched );
-	sched_getparam( 0, &sched );
-	if ( res ) {
-		__WARNINGLOG( "Can't set realtime scheduling for OSS Driver" );
-	}
-	__INFOLOG( QString( "Scheduling priority = %1" ).arg( sched.sched_priority ) );
+	Threads::configureCurrentThread( Threads::Role::Audio, "OSS" );
 
 	OssDriver *ossDriver = ( OssDriver* )param;
 
+	Dsp::disableDenormals();
+
 	sleep( 1 );
 
 	while ( ossDriver_running ) {
@@ -244,10 +239,8 @@ void OssDriver::write()
 	unsigned size = oss_driver_bufferSize * 2;
 
 	// prepare the 2-channel array of short
-	for ( unsigned i = 0; i < ( unsigned )oss_driver_bufferSize; ++i ) {
-		audioBuffer[i * 2] = ( short )( out_L[i] * 32768.0 );
-		audioBuffer[i * 2 + 1] = ( short )( out_R[i] * 32768.0 );
-	}
+	const float* ppOut[ 2 ] = { out_L, out_R };
+	Dsp::interleaveInt16( audioBuffer, ppOut, 2, oss_driver_bufferSize );
 
 	unsigned long written = ::write( fd, audioBuffer, size * 2 );
 
@@ -0,0 +1,284 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/PipeWireDriver.h>
+
+#if defined(H2CORE_HAVE_PIPEWIRE) || _DOXYGEN_
+
+#include <core/Preferences.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Tracer.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* PipeWireDriver::__class_name = "PipeWireDriver";
+
+/** Data associated with each port of the filter. It is not used but
+	pw_filter_add_port() requires some.*/
+struct PipeWirePort {
+	int nChannel;
+};
+
+PipeWireDriver::PipeWireDriver( audioProcessCallback processCallback )
+	: AudioOutput( __class_name )
+	, m_processCallback( processCallback )
+	, m_pLoop( nullptr )
+	, m_pFilter( nullptr )
+	, m_pPort_L( nullptr )
+	, m_pPort_R( nullptr )
+	, m_nBufferSize( 0 )
+	, m_nSampleRate( 0 )
+	, m_pOut_L( nullptr )
+	, m_pOut_R( nullptr )
+	, m_pDeviceOut_L( nullptr )
+	, m_pDeviceOut_R( nullptr )
+{
+	INFOLOG( "INIT" );
+	pw_init( nullptr, nullptr );
+
+	memset( &m_filterEvents, 0, sizeof( m_filterEvents ) );
+	m_filterEvents.version = PW_VERSION_FILTER_EVENTS;
+	m_filterEvents.process = PipeWireDriver::onProcess;
+	m_filterEvents.state_changed = PipeWireDriver::onStateChanged;
+}
+
+PipeWireDriver::~PipeWireDriver()
+{
+	INFOLOG( "DESTROY" );
+	disconnect();
+	delete[] m_pOut_L;
+	delete[] m_pOut_R;
+	pw_deinit();
+}
+
+int PipeWireDriver::init( unsigned nBufferSize )
+{
+	delete[] m_pOut_L;
+	delete[] m_pOut_R;
+	m_nBufferSize = nBufferSize;
+	m_nSampleRate = Preferences::get_instance()->m_nSampleRate;
+	m_pOut_L = new float[ m_nBufferSize ];
+	m_pOut_R = new float[ m_nBufferSize ];
+	memset( m_pOut_L, 0, m_nBufferSize * sizeof( float ) );
+	memset( m_pOut_R, 0, m_nBufferSize * sizeof( float ) );
+	return 0;
+}
+
+int PipeWireDriver::connect()
+{
+	INFOLOG( "connect" );
+
+	m_pLoop = pw_thread_loop_new( "hydrogen-pipewire", nullptr );
+	if ( m_pLoop == nullptr ) {
+		ERRORLOG( "Unable to create the PipeWire loop" );
+		return 1;
+	}
+
+	const QString sLatency = QString( "%1/%2" ).arg( m_nBufferSize ).arg( m_nSampleRate );
+	const QString sRate = QString( "1/%1" ).arg( m_nSampleRate );
+
+	pw_thread_loop_lock( m_pLoop );
+
+	m_pFilter = pw_filter_new_simple(
+		pw_thread_loop_get_loop( m_pLoop ), "Hydrogen",
+		pw_properties_new( PW_KEY_MEDIA_TYPE, "Audio",
+						   PW_KEY_MEDIA_CATEGORY, "Playback",
+						   PW_KEY_MEDIA_ROLE, "Production",
+						   PW_KEY_NODE_LATENCY, sLatency.toLocal8Bit().constData(),
+						   PW_KEY_NODE_RATE, sRate.toLocal8Bit().constData(),
+						   nullptr ),
+		&m_filterEvents, this );
+	if ( m_pFilter == nullptr ) {
+		pw_thread_loop_unlock( m_pLoop );
+		ERRORLOG( "Unable to create the PipeWire filter" );
+		disconnect();
+		return 1;
+	}
+
+	m_pPort_L = pw_filter_add_port(
+		m_pFilter, PW_DIRECTION_OUTPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
+		sizeof( PipeWirePort ),
+		pw_properties_new( PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+						   PW_KEY_PORT_NAME, "out_L",
+						   PW_KEY_AUDIO_CHANNEL, "FL",
+						   nullptr ),
+		nullptr, 0 );
+	m_pPort_R = pw_filter_add_port(
+		m_pFilter, PW_DIRECTION_OUTPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
+		sizeof( PipeWirePort ),
+		pw_properties_new( PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+						   PW_KEY_PORT_NAME, "out_R",
+						   PW_KEY_AUDIO_CHANNEL, "FR",
+						   nullptr ),
+		nullptr, 0 );
+
+	int nRes = -1;
+	if ( m_pPort_L != nullptr && m_pPort_R != nullptr ) {
+		nRes = pw_filter_connect( m_pFilter, PW_FILTER_FLAG_RT_PROCESS, nullptr, 0 );
+	}
+	pw_thread_loop_unlock( m_pLoop );
+
+	if ( nRes < 0 ) {
+		ERRORLOG( QString( "Unable to connect the PipeWire filter: %1" )
+				  .arg( strerror( -nRes ) ) );
+		disconnect();
+		return 1;
+	}
+
+	if ( pw_thread_loop_start( m_pLoop ) < 0 ) {
+		ERRORLOG( "Unable to start the PipeWire loop" );
+		disconnect();
+		return 1;
+	}
+
+	INFOLOG( QString( "Requested quantum: %1" ).arg( sLatency ) );
+	return 0;
+}
+
+void PipeWireDriver::disconnect()
+{
+	if ( m_pLoop == nullptr ) {
+		return;
+	}
+	INFOLOG( "disconnect" );
+
+	pw_thread_loop_stop( m_pLoop );
+	if ( m_pFilter != nullptr ) {
+		pw_filter_destroy( m_pFilter );
+		m_pFilter = nullptr;
+	}
+	m_pPort_L = nullptr;
+	m_pPort_R = nullptr;
+	pw_thread_loop_destroy( m_pLoop );
+	m_pLoop = nullptr;
+}
+
+unsigned PipeWireDriver::getBufferSize()
+{
+	return m_nBufferSize;
+}
+
+unsigned PipeWireDriver::getSampleRate()
+{
+	return m_nSampleRate;
+}
+
+float* PipeWireDriver::getOut_L()
+{
+	return m_pDeviceOut_L != nullptr ? m_pDeviceOut_L : m_pOut_L;
+}
+
+float* PipeWireDriver::getOut_R()
+{
+	return m_pDeviceOut_R != nullptr ? m_pDeviceOut_R : m_pOut_R;
+}
+
+void PipeWireDriver::updateTransportInfo()
+{
+}
+
+void PipeWireDriver::play()
+{
+	m_transport.m_status = TransportInfo::ROLLING;
+}
+
+void PipeWireDriver::stop()
+{
+	m_transport.m_status = TransportInfo::STOPPED;
+}
+
+void PipeWireDriver::locate( unsigned long nFrame )
+{
+	m_transport.m_nFrames = nFrame;
+}
+
+void PipeWireDriver::setBpm( float fBPM )
+{
+	m_transport.m_fBPM = fBPM;
+}
+
+void PipeWireDriver::onProcess( void* pData, struct spa_io_position* pPosition )
+{
+	PipeWireDriver* pDriver = static_cast<PipeWireDriver*>( pData );
+	if ( pPosition == nullptr ) {
+		return;
+	}
+
+	const uint32_t nFrames = pPosition->clock.duration;
+	float* pPort_L = static_cast<float*>( pw_filter_get_dsp_buffer( pDriver->m_pPort_L, nFrames ) );
+	float* pPort_R = static_cast<float*>( pw_filter_get_dsp_buffer( pDriver->m_pPort_R, nFrames ) );
+	if ( pPort_L == nullptr || pPort_R == nullptr ) {
+		return;
+	}
+
+	static thread_local bool bDenormalsDisabled = false;
+	if ( ! bDenormalsDisabled ) {
+		Dsp::disableDenormals();
+		bDenormalsDisabled = true;
+	}
+	Tracer::Scope trace( "PipeWireDriver process" );
+
+	// The ports are non-interleaved. As long as the quantum is not
+	// larger than our own buffers, the audio engine renders straight
+	// into them.
+	if ( nFrames <= pDriver->m_nBufferSize ) {
+		pDriver->m_pDeviceOut_L = pPort_L;
+		pDriver->m_pDeviceOut_R = pPort_R;
+		pDriver->m_processCallback( nFrames, nullptr );
+		pDriver->m_pDeviceOut_L = nullptr;
+		pDriver->m_pDeviceOut_R = nullptr;
+		return;
+	}
+
+	uint32_t nRendered = 0;
+	while ( nRendered < nFrames ) {
+		uint32_t nChunk = std::min( nFrames - nRendered, pDriver->m_nBufferSize );
+		pDriver->m_processCallback( nChunk, nullptr );
+		memcpy( pPort_L + nRendered, pDriver->m_pOut_L, nChunk * sizeof( float ) );
+		memcpy( pPort_R + nRendered, pDriver->m_pOut_R, nChunk * sizeof( float ) );
+		nRendered += nChunk;
+	}
+}
+
+void PipeWireDriver::onStateChanged( void* pData, enum pw_filter_state oldState,
+									 enum pw_filter_state state, const char* sError )
+{
+	PipeWireDriver* pDriver = static_cast<PipeWireDriver*>( pData );
+	Object* __object = pDriver;
+	if ( state == PW_FILTER_STATE_ERROR ) {
+		__ERRORLOG( QString( "PipeWire filter error: %1" )
+					.arg( sError != nullptr ? sError : "unknown" ) );
+	} else {
+		__INFOLOG( QString( "PipeWire filter state: %1 -> %2" )
+				   .arg( pw_filter_state_as_string( oldState ) )
+				   .arg( pw_filter_state_as_string( state ) ) );
+	}
+}
+
+};
+
+#endif // H2CORE_HAVE_PIPEWIRE
@@ -0,0 +1,113 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2_PIPEWIRE_DRIVER_H
+#define H2_PIPEWIRE_DRIVER_H
+
+#include <core/IO/AudioOutput.h>
+#include <core/IO/NullDriver.h>
+
+#if defined(H2CORE_HAVE_PIPEWIRE) || _DOXYGEN_
+
+#include <inttypes.h>
+#include <pipewire/pipewire.h>
+#include <pipewire/filter.h>
+
+namespace H2Core
+{
+
+/**
+ * Native PipeWire audio driver.
+ *
+ * Registers a pw_filter with two DSP output ports. Its process
+ * callback is run by the realtime data thread of PipeWire once per
+ * graph cycle, so Hydrogen renders exactly one quantum per call
+ * without any intermediate buffering. The quantum and the sample
+ * rate are requested via the node.latency and node.rate properties
+ * derived from Preferences::m_nBufferSize and
+ * Preferences::m_nSampleRate. The audio engine renders straight
+ * into the buffers of the ports. Only a quantum larger than the
+ * buffer size is rendered in several chunks and copied.
+ */
+class PipeWireDriver : public AudioOutput
+{
+	H2_OBJECT
+public:
+	PipeWireDriver( audioProcessCallback processCallback );
+	~PipeWireDriver();
+
+	virtual int init( unsigned nBufferSize );
+	virtual int connect();
+	virtual void disconnect();
+	virtual unsigned getBufferSize();
+	virtual unsigned getSampleRate();
+	virtual float* getOut_L();
+	virtual float* getOut_R();
+
+	virtual void updateTransportInfo();
+	virtual void play();
+	virtual void stop();
+	virtual void locate( unsigned long nFrame );
+	virtual void setBpm( float fBPM );
+
+private:
+	static void onProcess( void* pData, struct spa_io_position* pPosition );
+	static void onStateChanged( void* pData, enum pw_filter_state oldState,
+								enum pw_filter_state state, const char* sError );
+
+	audioProcessCallback	m_processCallback;
+	struct pw_thread_loop*	m_pLoop;
+	struct pw_filter*		m_pFilter;
+	struct pw_filter_events	m_filterEvents;
+	void*					m_pPort_L;
+	void*					m_pPort_R;
+	unsigned				m_nBufferSize;
+	unsigned				m_nSampleRate;
+	float*					m_pOut_L;
+	float*					m_pOut_R;
+	/** DSP buffers of the ports the audio engine renders into
+		directly while onProcess() is running and nullptr
+		otherwise.*/
+	float*					m_pDeviceOut_L;
+	float*					m_pDeviceOut_R;
+};
+
+};
+
+#else
+
+namespace H2Core {
+
+class PipeWireDriver : public NullDriver
+{
+	H2_OBJECT
+public:
+	PipeWireDriver( audioProcessCallback processCallback ) : NullDriver( processCallback ) {}
+
+};
+
+};
+
+#endif // H2CORE_HAVE_PIPEWIRE
+
+#endif
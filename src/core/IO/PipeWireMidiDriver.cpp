@@ -0,0 +1,345 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/PipeWireMidiDriver.h>
+
+#if defined(H2CORE_HAVE_PIPEWIRE) || _DOXYGEN_
+
+#include <core/rt_clock.h>
+
+#include <spa/control/control.h>
+#include <spa/pod/iter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace H2Core
+{
+
+const char* PipeWireMidiDriver::__class_name = "PipeWireMidiDriver";
+
+static_assert( ( PIPEWIRE_MIDI_EVENTS_MAX & ( PIPEWIRE_MIDI_EVENTS_MAX - 1 ) ) == 0,
+			   "PIPEWIRE_MIDI_EVENTS_MAX has to be a power of two" );
+
+/** Data associated with the port of the filter. It is not used but
+	pw_filter_add_port() requires some.*/
+struct PipeWireMidiPort {
+	int nUnused;
+};
+
+PipeWireMidiDriver::PipeWireMidiDriver()
+	: MidiInput( __class_name )
+	, Object( __class_name )
+	, m_pLoop( nullptr )
+	, m_pFilter( nullptr )
+	, m_pPort( nullptr )
+	, m_pEventSource( nullptr )
+	, m_pTimer( nullptr )
+	, m_nWriteIndex( 0 )
+	, m_nReadIndex( 0 )
+{
+	INFOLOG( "INIT" );
+	pw_init( nullptr, nullptr );
+
+	memset( &m_filterEvents, 0, sizeof( m_filterEvents ) );
+	m_filterEvents.version = PW_VERSION_FILTER_EVENTS;
+	m_filterEvents.process = PipeWireMidiDriver::onProcess;
+}
+
+PipeWireMidiDriver::~PipeWireMidiDriver()
+{
+	INFOLOG( "DESTROY" );
+	close();
+	pw_deinit();
+}
+
+void PipeWireMidiDriver::open()
+{
+	INFOLOG( "open" );
+	if ( m_pLoop != nullptr ) {
+		return;
+	}
+
+	m_pLoop = pw_thread_loop_new( "hydrogen-pipewire-midi", nullptr );
+	if ( m_pLoop == nullptr ) {
+		ERRORLOG( "Unable to create the PipeWire loop" );
+		return;
+	}
+	struct pw_loop* pLoop = pw_thread_loop_get_loop( m_pLoop );
+
+	pw_thread_loop_lock( m_pLoop );
+
+	m_pEventSource = pw_loop_add_event( pLoop, PipeWireMidiDriver::onEvents, this );
+	m_pTimer = pw_loop_add_timer( pLoop, PipeWireMidiDriver::onTimer, this );
+
+	m_pFilter = pw_filter_new_simple(
+		pLoop, "Hydrogen MIDI",
+		pw_properties_new( PW_KEY_MEDIA_TYPE, "Midi",
+						   PW_KEY_MEDIA_CATEGORY, "Capture",
+						   PW_KEY_MEDIA_ROLE, "Production",
+						   nullptr ),
+		&m_filterEvents, this );
+
+	int nRes = -1;
+	if ( m_pFilter != nullptr ) {
+		m_pPort = pw_filter_add_port(
+			m_pFilter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS,
+			sizeof( PipeWireMidiPort ),
+			pw_properties_new( PW_KEY_FORMAT_DSP, "8 bit raw midi",
+							   PW_KEY_PORT_NAME, "RX",
+							   nullptr ),
+			nullptr, 0 );
+		if ( m_pPort != nullptr ) {
+			nRes = pw_filter_connect( m_pFilter, PW_FILTER_FLAG_RT_PROCESS, nullptr, 0 );
+		}
+	}
+	pw_thread_loop_unlock( m_pLoop );
+
+	if ( nRes < 0 || m_pEventSource == nullptr || m_pTimer == nullptr ) {
+		ERRORLOG( "Unable to set up the PipeWire MIDI filter" );
+		close();
+		return;
+	}
+
+	if ( pw_thread_loop_start( m_pLoop ) < 0 ) {
+		ERRORLOG( "Unable to start the PipeWire loop" );
+		close();
+	}
+}
+
+void PipeWireMidiDriver::close()
+{
+	if ( m_pLoop == nullptr ) {
+		return;
+	}
+	INFOLOG( "close" );
+
+	pw_thread_loop_stop( m_pLoop );
+	if ( m_pFilter != nullptr ) {
+		pw_filter_destroy( m_pFilter );
+		m_pFilter = nullptr;
+	}
+	m_pPort = nullptr;
+
+	struct pw_loop* pLoop = pw_thread_loop_get_loop( m_pLoop );
+	if ( m_pEventSource != nullptr ) {
+		pw_loop_destroy_source( pLoop, m_pEventSource );
+		m_pEventSource = nullptr;
+	}
+	if ( m_pTimer != nullptr ) {
+		pw_loop_destroy_source( pLoop, m_pTimer );
+		m_pTimer = nullptr;
+	}
+	pw_thread_loop_destroy( m_pLoop );
+	m_pLoop = nullptr;
+}
+
+std::vector<QString> PipeWireMidiDriver::getOutputPortList()
+{
+	// Connections are made using the patchbay of PipeWire.
+	return std::vector<QString>();
+}
+
+void PipeWireMidiDriver::onProcess( void* pData, struct spa_io_position* pPosition )
+{
+	PipeWireMidiDriver* pDriver = static_cast<PipeWireMidiDriver*>( pData );
+
+	struct pw_buffer* pBuffer = pw_filter_dequeue_buffer( pDriver->m_pPort );
+	if ( pBuffer == nullptr ) {
+		return;
+	}
+
+	int64_t nCycleStart = rtclock_now_ns();
+	double fNsPerFrame = 0;
+	if ( pPosition != nullptr && pPosition->clock.rate.denom > 0 ) {
+		fNsPerFrame = 1e9 * pPosition->clock.rate.num / pPosition->clock.rate.denom;
+	}
+
+	struct spa_data* pSpaData = &pBuffer->buffer->datas[ 0 ];
+	struct spa_pod* pPod = nullptr;
+	if ( pSpaData->data != nullptr && pSpaData->chunk != nullptr ) {
+		pPod = static_cast<struct spa_pod*>(
+			spa_pod_from_data( pSpaData->data, pSpaData->maxsize,
+							   pSpaData->chunk->offset, pSpaData->chunk->size ) );
+	}
+
+	bool bQueued = false;
+	if ( pPod != nullptr && spa_pod_is_sequence( pPod ) ) {
+		struct spa_pod_control* pControl;
+		SPA_POD_SEQUENCE_FOREACH( reinterpret_cast<struct spa_pod_sequence*>( pPod ), pControl ) {
+			if ( pControl->type != SPA_CONTROL_Midi ) {
+				continue;
+			}
+			uint32_t nSize = SPA_POD_BODY_SIZE( &pControl->value );
+			if ( nSize == 0 ) {
+				continue;
+			}
+
+			size_t nWrite = pDriver->m_nWriteIndex.load( std::memory_order_relaxed );
+			if ( nWrite - pDriver->m_nReadIndex.load( std::memory_order_acquire ) >=
+				 PIPEWIRE_MIDI_EVENTS_MAX ) {
+				/* queue is full */
+				break;
+			}
+
+			InEvent& event = pDriver->m_events[ nWrite & ( PIPEWIRE_MIDI_EVENTS_MAX - 1 ) ];
+			event.nTimestamp = nCycleStart + static_cast<int64_t>( pControl->offset * fNsPerFrame );
+			event.nSize = std::min( nSize, static_cast<uint32_t>( sizeof( event.data ) ) );
+			memcpy( event.data, SPA_POD_BODY( &pControl->value ), event.nSize );
+			pDriver->m_nWriteIndex.store( nWrite + 1, std::memory_order_release );
+			bQueued = true;
+		}
+	}
+
+	pw_filter_queue_buffer( pDriver->m_pPort, pBuffer );
+
+	if ( bQueued ) {
+		pw_loop_signal_event( pw_thread_loop_get_loop( pDriver->m_pLoop ),
+							  pDriver->m_pEventSource );
+	}
+}
+
+void PipeWireMidiDriver::onEvents( void* pData, uint64_t /*nCount*/ )
+{
+	PipeWireMidiDriver* pDriver = static_cast<PipeWireMidiDriver*>( pData );
+
+	size_t nRead = pDriver->m_nReadIndex.load( std::memory_order_relaxed );
+	const size_t nWrite = pDriver->m_nWriteIndex.load( std::memory_order_acquire );
+	for ( ; nRead != nWrite; ++nRead ) {
+		// The event is copied since the slot is handed back to the
+		// realtime thread before it is processed.
+		InEvent event = pDriver->m_events[ nRead & ( PIPEWIRE_MIDI_EVENTS_MAX - 1 ) ];
+		pDriver->m_nReadIndex.store( nRead + 1, std::memory_order_release );
+		pDriver->processEvent( event );
+	}
+
+	pDriver->scheduleTimer( pDriver->flushControlChanges() );
+}
+
+void PipeWireMidiDriver::onTimer( void* pData, uint64_t /*nExpirations*/ )
+{
+	PipeWireMidiDriver* pDriver = static_cast<PipeWireMidiDriver*>( pData );
+	pDriver->scheduleTimer( pDriver->flushControlChanges() );
+}
+
+void PipeWireMidiDriver::scheduleTimer( int nMilliseconds )
+{
+	struct timespec value;
+	if ( nMilliseconds < 0 ) {
+		// Disarms the timer.
+		value.tv_sec = 0;
+		value.tv_nsec = 0;
+	} else {
+		// A zero value would disarm it as well.
+		int64_t nNanoseconds = std::max( 1, nMilliseconds ) * 1000000LL;
+		value.tv_sec = nNanoseconds / 1000000000LL;
+		value.tv_nsec = nNanoseconds % 1000000000LL;
+	}
+	pw_loop_update_timer( pw_thread_loop_get_loop( m_pLoop ), m_pTimer,
+						  &value, nullptr, false );
+}
+
+void PipeWireMidiDriver::processEvent( const InEvent& event )
+{
+	MidiMessage msg;
+	uint8_t buffer[13];// 13 is needed if we get sysex goto messages
+
+	msg.m_nTimestamp = event.nTimestamp;
+
+	memset( buffer, 0, sizeof( buffer ) );
+	memcpy( buffer, event.data, event.nSize );
+
+	switch ( buffer[0] >> 4 ) {
+	case 0x8:	 /* note off */
+		msg.m_type = MidiMessage::NOTE_OFF;
+		break;
+	case 0x9:	 /* note on */
+		msg.m_type = MidiMessage::NOTE_ON;
+		break;
+	case 0xA:	 /* aftertouch */
+		msg.m_type = MidiMessage::POLYPHONIC_KEY_PRESSURE;
+		break;
+	case 0xB:	 /* control change */
+		msg.m_type = MidiMessage::CONTROL_CHANGE;
+		break;
+	case 0xC:	 /* program change */
+		msg.m_type = MidiMessage::PROGRAM_CHANGE;
+		break;
+	case 0xD:	 /* channel pressure */
+		msg.m_type = MidiMessage::CHANNEL_PRESSURE;
+		break;
+	case 0xE:	 /* pitch wheel */
+		msg.m_type = MidiMessage::PITCH_WHEEL;
+		break;
+	case 0xF:
+		switch ( buffer[0] ) {
+		case 0xF0:	/* system exclusive */
+			msg.m_type = MidiMessage::SYSEX;
+			if ( buffer[3] == 06 ) {// MMC message
+				for ( int i = 0; i < sizeof( buffer ) && i < 6; i++ ) {
+					msg.m_sysexData.push_back( buffer[i] );
+				}
+			} else {
+				for ( int i = 0; i < sizeof( buffer ); i++ ) {
+					msg.m_sysexData.push_back( buffer[i] );
+				}
+			}
+			handleMidiMessage( msg );
+			return;
+		case 0xF1:
+			msg.m_type = MidiMessage::QUARTER_FRAME;
+			break;
+		case 0xF2:
+			msg.m_type = MidiMessage::SONG_POS;
+			break;
+		case 0xFA:
+			msg.m_type = MidiMessage::START;
+			break;
+		case 0xFB:
+			msg.m_type = MidiMessage::CONTINUE;
+			break;
+		case 0xFC:
+			msg.m_type = MidiMessage::STOP;
+			break;
+		default:
+			return;
+		}
+		msg.m_nData1 = buffer[1];
+		msg.m_nData2 = buffer[2];
+		msg.m_nChannel = 0;
+		handleMidiMessage( msg );
+		return;
+	default:
+		return;
+	}
+
+	msg.m_nData1 = buffer[1];
+	msg.m_nData2 = buffer[2];
+	msg.m_nChannel = buffer[0] & 0xF;
+	handleMidiMessage( msg );
+}
+
+};
+
+#endif // H2CORE_HAVE_PIPEWIRE
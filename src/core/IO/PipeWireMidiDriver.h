@@ -0,0 +1,105 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2_PIPEWIRE_MIDI_DRIVER_H
+#define H2_PIPEWIRE_MIDI_DRIVER_H
+
+#include <core/IO/MidiInput.h>
+
+#if defined(H2CORE_HAVE_PIPEWIRE) || _DOXYGEN_
+
+#include <pipewire/pipewire.h>
+#include <pipewire/filter.h>
+
+#include <atomic>
+#include <vector>
+
+/** Number of incoming events which can be pending in the queue from
+	the realtime thread to the loop of the
+	H2Core::PipeWireMidiDriver. Has to be a power of two.*/
+#define PIPEWIRE_MIDI_EVENTS_MAX 512
+
+namespace H2Core
+{
+
+/**
+ * Native PipeWire MIDI input.
+ *
+ * Registers a pw_filter with a single MIDI input port. Its realtime
+ * process callback timestamps the events of each cycle according to
+ * their offset and queues them for the thread loop of the driver,
+ * which decodes them and passes them to handleMidiMessage(). The
+ * handling of MIDI messages may lock the audio engine or allocate
+ * and is therefore kept out of the data thread of PipeWire.
+ *
+ * MIDI output is not supported.
+ */
+class PipeWireMidiDriver : public virtual MidiInput
+{
+	H2_OBJECT
+public:
+	PipeWireMidiDriver();
+	virtual ~PipeWireMidiDriver();
+
+	virtual void open();
+	virtual void close();
+	virtual std::vector<QString> getOutputPortList();
+
+private:
+	struct InEvent {
+		int64_t nTimestamp;
+		uint32_t nSize;
+		uint8_t data[13];// 13 is needed if we get sysex goto messages
+	};
+
+	static void onProcess( void* pData, struct spa_io_position* pPosition );
+	/** Handles the events queued by onProcess() in the thread
+		loop.*/
+	static void onEvents( void* pData, uint64_t nCount );
+	/** Dispatches control changes held back by the coalescing.*/
+	static void onTimer( void* pData, uint64_t nExpirations );
+
+	/** Decodes a raw MIDI event and passes it to
+		handleMidiMessage().*/
+	void processEvent( const InEvent& event );
+	/** Arms #m_pTimer to fire after @a nMilliseconds or disarms it
+		if negative.*/
+	void scheduleTimer( int nMilliseconds );
+
+	struct pw_thread_loop*	m_pLoop;
+	struct pw_filter*		m_pFilter;
+	struct pw_filter_events	m_filterEvents;
+	void*					m_pPort;
+	struct spa_source*		m_pEventSource;
+	struct spa_source*		m_pTimer;
+
+	InEvent m_events[ PIPEWIRE_MIDI_EVENTS_MAX ];
+	alignas(64) std::atomic<size_t> m_nWriteIndex;
+	alignas(64) std::atomic<size_t> m_nReadIndex;
+};
+
+};
+
+#endif // H2CORE_HAVE_PIPEWIRE
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/IO/PluginDriver.h>
+#include <core/IO/MidiInput.h>
+#include <core/Hydrogen.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace H2Core
+{
+
+/**
+ * Passes the MIDI events of the host to MidiInput. Only notes are
+ * handled since they are processed by the audio thread of the host.
+ * The actions triggered by other messages are not realtime safe.
+ */
+class PluginMidiInput : public virtual MidiInput
+{
+	H2_OBJECT
+public:
+	PluginMidiInput() : Object( __class_name ), MidiInput( __class_name ) {
+		setActive( true );
+	}
+	virtual void open() {}
+	virtual void close() {}
+	virtual std::vector<QString> getOutputPortList() {
+		return std::vector<QString>();
+	}
+};
+
+const char* PluginMidiInput::__class_name = "PluginMidiInput";
+const char* PluginDriver::__class_name = "PluginDriver";
+
+unsigned PluginDriver::m_nConfiguredSampleRate = 44100;
+int PluginDriver::m_nConfiguredTrackOutputs = 0;
+
+void PluginDriver::configure( unsigned nSampleRate, int nTrackOutputs )
+{
+	m_nConfiguredSampleRate = nSampleRate;
+	m_nConfiguredTrackOutputs = std::max( nTrackOutputs, 0 );
+}
+
+PluginDriver::PluginDriver( audioProcessCallback processCallback )
+		: AudioOutput( __class_name )
+		, m_processCallback( processCallback )
+		, m_nSampleRate( m_nConfiguredSampleRate )
+		, m_nTrackOutputs( m_nConfiguredTrackOutputs )
+		, m_nBufferSize( 0 )
+		, m_pOut_L( nullptr )
+		, m_pOut_R( nullptr )
+		, m_pBuffer_L( nullptr )
+		, m_pBuffer_R( nullptr )
+		, m_pTrackOutputs( nullptr )
+		, m_pMidiInput( new PluginMidiInput )
+		, m_bHostTransport( false )
+		, m_bHostRolling( false )
+		, m_fHostBpm( 0 )
+		, m_nHostRelocation( -1 )
+{
+	INFOLOG( "INIT" );
+}
+
+
+PluginDriver::~PluginDriver()
+{
+	INFOLOG( "DESTROY" );
+	disconnect();
+	delete m_pMidiInput;
+}
+
+
+int PluginDriver::init( unsigned nBufferSize )
+{
+	INFOLOG( QString( "Init, %1 samples, %2 track outputs" )
+			 .arg( nBufferSize ).arg( m_nTrackOutputs ) );
+
+	disconnect();
+	m_nBufferSize = nBufferSize;
+	m_pBuffer_L = new float[ nBufferSize ];
+	m_pBuffer_R = new float[ nBufferSize ];
+	m_pOut_L = m_pBuffer_L;
+	m_pOut_R = m_pBuffer_R;
+
+	if ( m_nTrackOutputs > 0 ) {
+		m_pTrackOutputs = new TrackOutputs( 2 + 2 * m_nTrackOutputs, nBufferSize );
+		m_channels.resize( m_pTrackOutputs->getChannels() );
+	}
+
+	return 0;
+}
+
+
+int PluginDriver::connect()
+{
+	INFOLOG( "connect" );
+
+	m_transport.m_status = TransportInfo::STOPPED;
+
+	return 0;
+}
+
+
+void PluginDriver::disconnect()
+{
+	delete[] m_pBuffer_L;
+	m_pBuffer_L = nullptr;
+
+	delete[] m_pBuffer_R;
+	m_pBuffer_R = nullptr;
+
+	m_pOut_L = m_pOut_R = nullptr;
+
+	delete m_pTrackOutputs;
+	m_pTrackOutputs = nullptr;
+}
+
+
+void PluginDriver::process( float** ppOutputs, uint32_t nOffset, uint32_t nFrames )
+{
+	const int nOutputs = 2 + 2 * m_nTrackOutputs;
+	uint32_t nFrame = nOffset;
+	while ( nFrame < nOffset + nFrames ) {
+		uint32_t nChunk = std::min<uint32_t>( m_nBufferSize, nOffset + nFrames - nFrame );
+		m_pOut_L = ppOutputs[ 0 ] != nullptr ? ppOutputs[ 0 ] + nFrame : m_pBuffer_L;
+		m_pOut_R = ppOutputs[ 1 ] != nullptr ? ppOutputs[ 1 ] + nFrame : m_pBuffer_R;
+
+		if ( m_processCallback( nChunk, nullptr ) != 0 ) {
+			memset( m_pOut_L, 0, nChunk * sizeof( float ) );
+			memset( m_pOut_R, 0, nChunk * sizeof( float ) );
+		}
+
+		if ( m_pTrackOutputs != nullptr ) {
+			m_pTrackOutputs->getChannelBuffers( m_channels.data(), m_pOut_L, m_pOut_R, 0 );
+			for ( int ii = 2; ii < nOutputs; ++ii ) {
+				if ( ppOutputs[ ii ] != nullptr ) {
+					memcpy( ppOutputs[ ii ] + nFrame, m_channels[ ii ],
+							nChunk * sizeof( float ) );
+				}
+			}
+		}
+
+		nFrame += nChunk;
+	}
+
+	m_pOut_L = m_pBuffer_L;
+	m_pOut_R = m_pBuffer_R;
+}
+
+
+void PluginDriver::setHostTransport( bool bRolling, long long nFrame, float fBpm )
+{
+	m_bHostTransport = true;
+	m_bHostRolling = bRolling;
+	if ( fBpm > 0 ) {
+		m_fHostBpm = fBpm;
+	}
+	if ( nFrame >= 0 && nFrame != m_transport.m_nFrames ) {
+		m_nHostRelocation = nFrame;
+	}
+}
+
+
+void PluginDriver::handleMidiEvent( const uint8_t* pData, uint32_t nSize )
+{
+	if ( nSize != 3 ||
+		 ( ( pData[ 0 ] >> 4 ) != 0x8 && ( pData[ 0 ] >> 4 ) != 0x9 ) ) {
+		return;
+	}
+
+	MidiMessage msg;
+	if ( ( pData[ 0 ] >> 4 ) == 0x9 ) {
+		msg.m_type = MidiMessage::NOTE_ON;
+	} else {
+		msg.m_type = MidiMessage::NOTE_OFF;
+	}
+	msg.m_nData1 = pData[ 1 ];
+	msg.m_nData2 = pData[ 2 ];
+	msg.m_nChannel = pData[ 0 ] & 0xF;
+	m_pMidiInput->handleMidiMessage( msg );
+}
+
+
+void PluginDriver::play()
+{
+	if ( ! m_bHostTransport ) {
+		m_transport.m_status = TransportInfo::ROLLING;
+	}
+}
+
+void PluginDriver::stop()
+{
+	if ( ! m_bHostTransport ) {
+		m_transport.m_status = TransportInfo::STOPPED;
+	}
+}
+
+void PluginDriver::locate( unsigned long nFrame )
+{
+	m_transport.m_nFrames = nFrame;
+}
+
+void PluginDriver::updateTransportInfo()
+{
+	if ( ! m_bHostTransport ) {
+		return;
+	}
+
+	m_transport.m_status = m_bHostRolling ?
+		TransportInfo::ROLLING : TransportInfo::STOPPED;
+
+	if ( m_nHostRelocation >= 0 ) {
+		// Reset playback to the beginning of the pattern if Hydrogen
+		// is in pattern mode.
+		Hydrogen::get_instance()->resetPatternStartTick();
+		m_transport.m_nFrames = m_nHostRelocation;
+		m_nHostRelocation = -1;
+	}
+
+	if ( m_fHostBpm > 0 ) {
+		m_transport.m_fBPM = m_fHostBpm;
+	} else {
+		Hydrogen::get_instance()->setTimelineBpm();
+	}
+}
+
+void PluginDriver::setBpm( float fBPM )
+{
+	m_transport.m_fBPM = fBPM;
+}
+
+};
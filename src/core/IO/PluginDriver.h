@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef PLUGIN_DRIVER_H
+#define PLUGIN_DRIVER_H
+
+#include <core/IO/AudioOutput.h>
+#include <inttypes.h>
+#include <vector>
+
+namespace H2Core
+{
+
+typedef int  ( *audioProcessCallback )( uint32_t, void * );
+
+class PluginMidiInput;
+
+/**
+ * Audio driver used when Hydrogen runs as a plugin within a host,
+ * e.g. an LV2 instrument within a DAW. It is created via
+ * Preferences::m_sAudioDriver "Plugin".
+ *
+ * Instead of running a thread, the audio engine is driven by
+ * process() from the process callback of the host. The main output
+ * is written directly into the buffers of the host while the track
+ * outputs are copied into the following ones. The transport and
+ * MIDI events of the host are passed via setHostTransport() and
+ * handleMidiEvent() between the calls of process().
+ */
+class PluginDriver : public AudioOutput
+{
+	H2_OBJECT
+public:
+	/**
+	 * Sets the sample rate of the host and the number of stereo
+	 * track outputs of the plugin. Has to be called before the
+	 * driver is created.
+	 */
+	static void configure( unsigned nSampleRate, int nTrackOutputs );
+
+	PluginDriver( audioProcessCallback processCallback );
+	~PluginDriver();
+
+	int init( unsigned nBufferSize );
+	int connect();
+	void disconnect();
+	unsigned getBufferSize() {
+		return m_nBufferSize;
+	}
+	unsigned getSampleRate() {
+		return m_nSampleRate;
+	}
+
+	float* getOut_L() {
+		return m_pOut_L;
+	}
+	float* getOut_R() {
+		return m_pOut_R;
+	}
+
+	virtual TrackOutputs* getTrackOutputs() const {
+		return m_pTrackOutputs;
+	}
+
+	/**
+	 * Renders @a nFrames frames into the buffers @a ppOutputs of the
+	 * host starting at frame @a nOffset. The first two hold the main
+	 * output, each following pair one track output. Buffers not
+	 * connected by the host may be nullptr.
+	 */
+	void process( float** ppOutputs, uint32_t nOffset, uint32_t nFrames );
+
+	/**
+	 * Applies the transport of the host at the current frame. 
+	 *
+	 * \param bRolling Whether the transport of the host is rolling.
+	 * \param nFrame Transport position or -1 if unknown.
+	 * \param fBpm Tempo of the host or 0 if unknown.
+	 */
+	void setHostTransport( bool bRolling, long long nFrame, float fBpm );
+
+	/** Passes an incoming raw MIDI message to the MIDI handling of
+		Hydrogen.*/
+	void handleMidiEvent( const uint8_t* pData, uint32_t nSize );
+
+	virtual void play();
+	virtual void stop();
+	virtual void locate( unsigned long nFrame );
+	virtual void updateTransportInfo();
+	virtual void setBpm( float fBPM );
+
+private:
+	static unsigned m_nConfiguredSampleRate;
+	static int m_nConfiguredTrackOutputs;
+
+	audioProcessCallback m_processCallback;
+	unsigned m_nSampleRate;
+	int m_nTrackOutputs;
+	unsigned m_nBufferSize;
+	/** Point into the buffers of the host while the engine is
+		processing and to #m_pBuffer_L and #m_pBuffer_R
+		otherwise.*/
+	float* m_pOut_L;
+	float* m_pOut_R;
+	float* m_pBuffer_L;
+	float* m_pBuffer_R;
+	TrackOutputs* m_pTrackOutputs;
+	std::vector<const float*> m_channels;
+	PluginMidiInput* m_pMidiInput;
+
+	/** Whether the host did provide a transport at all. Otherwise
+		the transport is controlled by Hydrogen itself.*/
+	bool m_bHostTransport;
+	bool m_bHostRolling;
+	float m_fHostBpm;
+	/** Position the host relocated to which was not applied yet or
+		-1.*/
+	long long m_nHostRelocation;
+};
+
+};
+
+#endif
@@ -31,6 +31,7 @@
 #if defined(H2CORE_HAVE_PORTAUDIO) || _DOXYGEN_
 
 #include <inttypes.h>
+#include <vector>
 #include <portaudio.h>
 
 namespace H2Core
@@ -45,7 +46,20 @@ public:
 	audioProcessCallback m_processCallback;
 	float* m_pOut_L;
 	float* m_pOut_R;
+	/** Buffers of PortAudio the audio engine renders into directly
+		while the callback is running and nullptr otherwise.*/
+	float* m_pDeviceOut_L;
+	float* m_pDeviceOut_R;
 	unsigned m_nBufferSize;
+	/** Number of channels of the stream chosen in connect()
+		according to Preferences::m_nOutputChannels.*/
+	int m_nChannels;
+	/** Per-track outputs copied to the channels following the
+		main output. nullptr if the stream is stereo.*/
+	TrackOutputs* m_pTrackOutputs;
+	/** Buffers of all #m_nChannels channels. Allocated in
+		connect() to not do so in the callback.*/
+	std::vector<const float*> m_channelBuffers;
 
 	PortAudioDriver( audioProcessCallback processCallback );
 	virtual ~PortAudioDriver();
@@ -57,6 +71,9 @@ public:
 	virtual unsigned getSampleRate();
 	virtual float* getOut_L();
 	virtual float* getOut_R();
+	virtual TrackOutputs* getTrackOutputs() const {
+		return m_pTrackOutputs;
+	}
 
 	virtual void updateTransportInfo();
 	virtual void play();
@@ -65,6 +82,13 @@ public:
 	virtual void setBpm( float fBPM );
 
 private:
+	/**
+	 * \return Index of the device selected by
+	 * Preferences::m_sPortAudioDevice or the default output device
+	 * if it is not available.
+	 */
+	PaDeviceIndex findDevice( const QString& sDevice );
+
 	PaStream *m_pStream;
 	unsigned m_nSampleRate;
 
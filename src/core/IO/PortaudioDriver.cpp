@@ -2,12 +2,40 @@
 #include <core/IO/PortAudioDriver.h>
 #if defined(H2CORE_HAVE_PORTAUDIO) || _DOXYGEN_
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#if defined(WIN32) && defined(__has_include)
+#if __has_include(<pa_win_wasapi.h>)
+#include <pa_win_wasapi.h>
+#define H2CORE_HAVE_PA_WASAPI
+#endif
+#endif
+
 #include <core/Preferences.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Tracer.h>
 namespace H2Core
 {
 
+/** Copies @a nFrames frames of the per-track outputs to the
+	channels following the main output starting at frame @a
+	nOffset of @a ppOut.*/
+static void portAudioCopyTracks( PortAudioDriver* pDriver, float** ppOut,
+								 unsigned long nOffset, unsigned long nFrames )
+{
+	if ( pDriver->m_pTrackOutputs == nullptr ) {
+		return;
+	}
+	const float** ppChannels = pDriver->m_channelBuffers.data();
+	pDriver->m_pTrackOutputs->getChannelBuffers( ppChannels, pDriver->m_pOut_L,
+												 pDriver->m_pOut_R, 0 );
+	for ( int nChannel = 2; nChannel < pDriver->m_nChannels; ++nChannel ) {
+		memcpy( ppOut[ nChannel ] + nOffset, ppChannels[ nChannel ], nFrames * sizeof( float ) );
+	}
+}
+
 int portAudioCallback(
 	const void *inputBuffer,
 	void *outputBuffer,
@@ -18,13 +46,33 @@ int portAudioCallback(
 )
 {
 	PortAudioDriver *pDriver = ( PortAudioDriver* )userData;
-	pDriver->m_processCallback( pDriver->m_nBufferSize, nullptr );
-
-	float *out = ( float* )outputBuffer;
+	// The callback thread is owned by PortAudio.
+	Dsp::disableDenormals();
+	Tracer::Scope trace( "PortAudioDriver callback" );
+
+	// The stream is non-interleaved. As long as the buffers of
+	// PortAudio are not larger than our own ones, the audio engine
+	// renders straight into them.
+	float **ppOut = static_cast<float**>( outputBuffer );
+	if ( framesPerBuffer <= pDriver->m_nBufferSize ) {
+		pDriver->m_pDeviceOut_L = ppOut[ 0 ];
+		pDriver->m_pDeviceOut_R = ppOut[ 1 ];
+		pDriver->m_processCallback( framesPerBuffer, nullptr );
+		pDriver->m_pDeviceOut_L = nullptr;
+		pDriver->m_pDeviceOut_R = nullptr;
+		portAudioCopyTracks( pDriver, ppOut, 0, framesPerBuffer );
+		return 0;
+	}
 
-	for ( unsigned i = 0; i < framesPerBuffer; i++ ) {
-		*out++ = pDriver->m_pOut_L[ i ];
-		*out++ = pDriver->m_pOut_R[ i ];
+	unsigned long nRendered = 0;
+	while ( nRendered < framesPerBuffer ) {
+		unsigned long nChunk = std::min( framesPerBuffer - nRendered,
+										 static_cast<unsigned long>( pDriver->m_nBufferSize ) );
+		pDriver->m_processCallback( nChunk, nullptr );
+		memcpy( ppOut[ 0 ] + nRendered, pDriver->m_pOut_L, nChunk * sizeof( float ) );
+		memcpy( ppOut[ 1 ] + nRendered, pDriver->m_pOut_R, nChunk * sizeof( float ) );
+		portAudioCopyTracks( pDriver, ppOut, nRendered, nChunk );
+		nRendered += nChunk;
 	}
 	return 0;
 }
@@ -37,6 +85,10 @@ PortAudioDriver::PortAudioDriver( audioProcessCallback processCallback )
 		, m_processCallback( processCallback )
 		, m_pOut_L( nullptr )
 		, m_pOut_R( nullptr )
+		, m_pDeviceOut_L( nullptr )
+		, m_pDeviceOut_R( nullptr )
+		, m_nChannels( 2 )
+		, m_pTrackOutputs( nullptr )
 		, m_pStream( nullptr )
 {
 	INFOLOG( "INIT" );
@@ -55,6 +107,51 @@ int PortAudioDriver::init( unsigned nBufferSize )
 	return 0;
 }
 
+PaDeviceIndex PortAudioDriver::findDevice( const QString& sDevice )
+{
+	if ( sDevice.isEmpty() ) {
+		return Pa_GetDefaultOutputDevice();
+	}
+
+	int nSeparator = sDevice.indexOf( '/' );
+	QString sHostApi = nSeparator >= 0 ? sDevice.left( nSeparator ) : sDevice;
+	QString sName = nSeparator >= 0 ? sDevice.mid( nSeparator + 1 ) : "";
+
+	for ( PaHostApiIndex nApi = 0; nApi < Pa_GetHostApiCount(); ++nApi ) {
+		const PaHostApiInfo* pApiInfo = Pa_GetHostApiInfo( nApi );
+		if ( pApiInfo == nullptr || sHostApi != pApiInfo->name ) {
+			continue;
+		}
+		if ( sName.isEmpty() ) {
+			if ( pApiInfo->defaultOutputDevice != paNoDevice ) {
+				return pApiInfo->defaultOutputDevice;
+			}
+			break;
+		}
+		for ( int nApiDevice = 0; nApiDevice < pApiInfo->deviceCount; ++nApiDevice ) {
+			PaDeviceIndex nDevice = Pa_HostApiDeviceIndexToDeviceIndex( nApi, nApiDevice );
+			const PaDeviceInfo* pDeviceInfo = Pa_GetDeviceInfo( nDevice );
+			if ( pDeviceInfo != nullptr && pDeviceInfo->maxOutputChannels > 0 &&
+				 sName == pDeviceInfo->name ) {
+				return nDevice;
+			}
+		}
+		break;
+	}
+
+	ERRORLOG( QString( "Output device [%1] not found. Using the default one instead. Available devices:" )
+			  .arg( sDevice ) );
+	for ( PaDeviceIndex nDevice = 0; nDevice < Pa_GetDeviceCount(); ++nDevice ) {
+		const PaDeviceInfo* pDeviceInfo = Pa_GetDeviceInfo( nDevice );
+		const PaHostApiInfo* pApiInfo = pDeviceInfo != nullptr ?
+			Pa_GetHostApiInfo( pDeviceInfo->hostApi ) : nullptr;
+		if ( pApiInfo != nullptr && pDeviceInfo->maxOutputChannels > 0 ) {
+			INFOLOG( QString( "  %1/%2" ).arg( pApiInfo->name ).arg( pDeviceInfo->name ) );
+		}
+	}
+	return Pa_GetDefaultOutputDevice();
+}
+
 
 //
 // Connect
@@ -76,22 +173,75 @@ int PortAudioDriver::connect()
 		return 1;
 	}
 
-	err = Pa_OpenDefaultStream(
+	Preferences* pPref = Preferences::get_instance();
+	PaDeviceIndex nDevice = findDevice( pPref->m_sPortAudioDevice );
+	const PaDeviceInfo* pDeviceInfo = Pa_GetDeviceInfo( nDevice );
+	if ( pDeviceInfo == nullptr ) {
+		ERRORLOG( "No output device available" );
+		return 1;
+	}
+	const PaHostApiInfo* pApiInfo = Pa_GetHostApiInfo( pDeviceInfo->hostApi );
+	INFOLOG( QString( "Device: %1/%2" )
+			 .arg( pApiInfo != nullptr ? pApiInfo->name : "" ).arg( pDeviceInfo->name ) );
+
+	// Devices providing fewer channels than requested carry as many
+	// track outputs as fit.
+	m_nChannels = std::max( 2, pPref->m_nOutputChannels );
+	if ( m_nChannels > 2 && pDeviceInfo->maxOutputChannels < m_nChannels ) {
+		WARNINGLOG( QString( "%1 channels requested but the device provides only %2" )
+					.arg( m_nChannels ).arg( pDeviceInfo->maxOutputChannels ) );
+		m_nChannels = std::max( 2, pDeviceInfo->maxOutputChannels );
+	}
+	INFOLOG( QString( "Channels: %1" ).arg( m_nChannels ) );
+
+	PaStreamParameters outputParameters;
+	outputParameters.device = nDevice;
+	outputParameters.channelCount = m_nChannels; // main output followed by the tracks
+	outputParameters.sampleFormat = paFloat32 | paNonInterleaved;
+	outputParameters.suggestedLatency = pPref->m_nPortAudioLatency > 0 ?
+		pPref->m_nPortAudioLatency / static_cast<double>( m_nSampleRate ) :
+		pDeviceInfo->defaultLowOutputLatency;
+	outputParameters.hostApiSpecificStreamInfo = nullptr;
+
+#ifdef H2CORE_HAVE_PA_WASAPI
+	PaWasapiStreamInfo wasapiInfo;
+	if ( pPref->m_bPortAudioExclusive && pApiInfo != nullptr && pApiInfo->type == paWASAPI ) {
+		memset( &wasapiInfo, 0, sizeof( wasapiInfo ) );
+		wasapiInfo.size = sizeof( PaWasapiStreamInfo );
+		wasapiInfo.hostApiType = paWASAPI;
+		wasapiInfo.version = 1;
+		wasapiInfo.flags = paWinWasapiExclusive;
+		outputParameters.hostApiSpecificStreamInfo = &wasapiInfo;
+		INFOLOG( "Using WASAPI exclusive mode" );
+	}
+#endif
+
+	err = Pa_OpenStream(
 				&m_pStream,        /* passes back stream pointer */
-				0,              /* no input channels */
-				2,              /* stereo output */
-				paFloat32,      /* 32 bit floating point output */
+				nullptr,           /* no input */
+				&outputParameters,
 				m_nSampleRate,          // sample rate
 				m_nBufferSize,            // frames per buffer
+				paNoFlag,
 				portAudioCallback, /* specify our custom callback */
 				this );        /* pass our data through to callback */
 
 
 	if ( err != paNoError ) {
-		ERRORLOG(  "Portaudio error in Pa_OpenDefaultStream: " + QString( Pa_GetErrorText( err ) ) );
+		ERRORLOG(  "Portaudio error in Pa_OpenStream: " + QString( Pa_GetErrorText( err ) ) );
 		return 1;
 	}
 
+	const PaStreamInfo* pStreamInfo = Pa_GetStreamInfo( m_pStream );
+	if ( pStreamInfo != nullptr ) {
+		INFOLOG( QString( "Output latency: %1 ms" ).arg( pStreamInfo->outputLatency * 1000 ) );
+	}
+
+	if ( m_nChannels > 2 ) {
+		m_pTrackOutputs = new TrackOutputs( m_nChannels, m_nBufferSize );
+	}
+	m_channelBuffers.assign( m_nChannels, nullptr );
+
 	err = Pa_StartStream( m_pStream );
 
 
@@ -125,6 +275,9 @@ void PortAudioDriver::disconnect()
 
 	delete[] m_pOut_R;
 	m_pOut_R = nullptr;
+
+	delete m_pTrackOutputs;
+	m_pTrackOutputs = nullptr;
 }
 
 unsigned PortAudioDriver::getBufferSize()
@@ -139,12 +292,12 @@ unsigned PortAudioDriver::getSampleRate()
 
 float* PortAudioDriver::getOut_L()
 {
-	return m_pOut_L;
+	return m_pDeviceOut_L != nullptr ? m_pDeviceOut_L : m_pOut_L;
 }
 
 float* PortAudioDriver::getOut_R()
 {
-	return m_pOut_R;
+	return m_pDeviceOut_R != nullptr ? m_pDeviceOut_R : m_pOut_R;
 }
 
 void PortAudioDriver::updateTransportInfo()
@@ -28,6 +28,8 @@
 #include <core/Basics/InstrumentList.h>
 #include <core/Hydrogen.h>
 #include <core/Globals.h>
+#include <core/rt_clock.h>
+#include <core/Helpers/Threads.h>
 
 
 #ifdef WIN32
@@ -41,77 +43,147 @@
 #define TIME_START Pt_Start(1, 0, 0) /* timer started w/millisecond accuracy */
 
 #include <pthread.h>
+#include <algorithm>
 
 namespace H2Core
 {
 
 pthread_t PortMidiDriverThread;
 
+/** Number of events fetched by a single Pm_Read().*/
+#define PORTMIDI_READ_BUFFER_SIZE 64
+/** Interval in microseconds between polls while MIDI events are
+	arriving.*/
+#define PORTMIDI_ACTIVE_POLL_US 100
+/** Interval in microseconds between polls after
+	PORTMIDI_IDLE_POLLS empty ones.*/
+#define PORTMIDI_IDLE_POLL_US 1000
+#define PORTMIDI_IDLE_POLLS 1000
+
+/** Converts a PortMidi event into a MidiMessage.
+ *
+ * The event timestamp, in milliseconds of the PortTime clock, is
+ * translated into rtclock_now_ns() time using @a nNow and @a nPtNow
+ * read at the same instant. This way events queued by the driver
+ * while the thread was asleep keep their arrival time.
+ */
+static MidiMessage PortMidiDriver_message( const PmEvent& event, int64_t nNow, PmTimestamp nPtNow )
+{
+	MidiMessage msg;
+	msg.m_nTimestamp = nNow - static_cast<int64_t>( std::max( 0, nPtNow - event.timestamp ) ) * 1000000;
+
+	int nEventType = Pm_MessageStatus( event.message );
+	if ( ( nEventType >= 128 ) && ( nEventType < 144 ) ) {	// note off
+		msg.m_nChannel = nEventType - 128;
+		msg.m_type = MidiMessage::NOTE_OFF;
+	} else if ( ( nEventType >= 144 ) && ( nEventType < 160 ) ) {	// note on
+		msg.m_nChannel = nEventType - 144;
+		msg.m_type = MidiMessage::NOTE_ON;
+	} else if ( ( nEventType >= 160 ) && ( nEventType < 176 ) ) {	// Polyphonic Key Pressure (After-touch)
+		msg.m_nChannel = nEventType - 160;
+		msg.m_type = MidiMessage::POLYPHONIC_KEY_PRESSURE;
+	} else if ( ( nEventType >= 176 ) && ( nEventType < 192 ) ) {	// Control Change
+		msg.m_nChannel = nEventType - 176;
+		msg.m_type = MidiMessage::CONTROL_CHANGE;
+	} else if ( ( nEventType >= 192 ) && ( nEventType < 208 ) ) {	// Program Change
+		msg.m_nChannel = nEventType - 192;
+		msg.m_type = MidiMessage::PROGRAM_CHANGE;
+	} else if ( ( nEventType >= 208 ) && ( nEventType < 224 ) ) {	// Channel Pressure (After-touch)
+		msg.m_nChannel = nEventType - 208;
+		msg.m_type = MidiMessage::CHANNEL_PRESSURE;
+	} else if ( ( nEventType >= 224 ) && ( nEventType < 240 ) ) {	// Pitch Wheel Change
+		msg.m_nChannel = nEventType - 224;
+		msg.m_type = MidiMessage::PITCH_WHEEL;
+	} else if ( ( nEventType >= 240 ) && ( nEventType < 256 ) ) {	// System Exclusive
+		msg.m_nChannel = nEventType - 240;
+		msg.m_type = MidiMessage::SYSTEM_EXCLUSIVE;
+	} else {
+		___ERRORLOG( "Unhandled midi message type: " + QString::number( nEventType ) );
+		___INFOLOG( "MIDI msg: " );
+		___INFOLOG( QString::number( event.timestamp ) );
+		___INFOLOG( QString::number( Pm_MessageStatus( event.message ) ) );
+		___INFOLOG( QString::number( Pm_MessageData1( event.message ) ) );
+		___INFOLOG( QString::number( Pm_MessageData2( event.message ) ) );
+	}
+
+	msg.m_nData1 = Pm_MessageData1( event.message );
+	msg.m_nData2 = Pm_MessageData2( event.message );
+	return msg;
+}
+
 void* PortMidiDriver_thread( void* param )
 {
 	Object *__object = (Object*)param;
 	PortMidiDriver *instance = ( PortMidiDriver* )param;
 	__INFOLOG( "PortMidiDriver_thread starting" );
+	Threads::configureCurrentThread( Threads::Role::Midi, "PortMidi" );
 
-	PmError status;
-	int length;
-	PmEvent buffer[1];
+	// PortMidi offers no handle to wait on. The thread sleeps between
+	// polls instead, using a high resolution timer on Windows, where
+	// Sleep() is only as precise as the system tick.
+#ifdef WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+	HANDLE hTimer = CreateWaitableTimerExW( nullptr, nullptr,
+											CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+											TIMER_ALL_ACCESS );
+	if ( hTimer == nullptr ) {
+		__INFOLOG( "No high resolution timer available. Falling back to Sleep()" );
+	}
+#endif
+
+	PmEvent buffer[ PORTMIDI_READ_BUFFER_SIZE ];
+	int nIdlePolls = 0;
 	while ( instance->m_bRunning ) {
-		status = Pm_Poll( instance->m_pMidiIn );
-		if ( status == TRUE ) {
-			length = Pm_Read( instance->m_pMidiIn, buffer, 1 );
-			if ( length > 0 ) {
-				MidiMessage msg;
-
-				int nEventType = Pm_MessageStatus( buffer[0].message );
-				if ( ( nEventType >= 128 ) && ( nEventType < 144 ) ) {	// note off
-					msg.m_nChannel = nEventType - 128;
-					msg.m_type = MidiMessage::NOTE_OFF;
-				} else if ( ( nEventType >= 144 ) && ( nEventType < 160 ) ) {	// note on
-					msg.m_nChannel = nEventType - 144;
-					msg.m_type = MidiMessage::NOTE_ON;
-				} else if ( ( nEventType >= 160 ) && ( nEventType < 176 ) ) {	// Polyphonic Key Pressure (After-touch)
-					msg.m_nChannel = nEventType - 160;
-					msg.m_type = MidiMessage::POLYPHONIC_KEY_PRESSURE;
-				} else if ( ( nEventType >= 176 ) && ( nEventType < 192 ) ) {	// Control Change
-					msg.m_nChannel = nEventType - 176;
-					msg.m_type = MidiMessage::CONTROL_CHANGE;
-				} else if ( ( nEventType >= 192 ) && ( nEventType < 208 ) ) {	// Program Change
-					msg.m_nChannel = nEventType - 192;
-					msg.m_type = MidiMessage::PROGRAM_CHANGE;
-				} else if ( ( nEventType >= 208 ) && ( nEventType < 224 ) ) {	// Channel Pressure (After-touch)
-					msg.m_nChannel = nEventType - 208;
-					msg.m_type = MidiMessage::CHANNEL_PRESSURE;
-				} else if ( ( nEventType >= 224 ) && ( nEventType < 240 ) ) {	// Pitch Wheel Change
-					msg.m_nChannel = nEventType - 224;
-					msg.m_type = MidiMessage::PITCH_WHEEL;
-				} else if ( ( nEventType >= 240 ) && ( nEventType < 256 ) ) {	// System Exclusive
-					msg.m_nChannel = nEventType - 240;
-					msg.m_type = MidiMessage::SYSTEM_EXCLUSIVE;
-				} else {
-					__ERRORLOG( "Unhandled midi message type: " + QString::number( nEventType ) );
-					__INFOLOG( "MIDI msg: " );
-					__INFOLOG( QString::number( buffer[0].timestamp ) );
-					__INFOLOG( QString::number( Pm_MessageStatus( buffer[0].message ) ) );
-					__INFOLOG( QString::number( Pm_MessageData1( buffer[0].message ) ) );
-					__INFOLOG( QString::number( Pm_MessageData2( buffer[0].message ) ) );
+		int nEvents = 0;
+		while ( Pm_Poll( instance->m_pMidiIn ) == TRUE ) {
+			int nLength = Pm_Read( instance->m_pMidiIn, buffer, PORTMIDI_READ_BUFFER_SIZE );
+			if ( nLength <= 0 ) {
+				if ( nLength < 0 ) {
+					__ERRORLOG( QString( "Error in Pm_Read: %1" )
+								.arg( Pm_GetErrorText( static_cast<PmError>( nLength ) ) ) );
 				}
+				break;
+			}
 
-				msg.m_nData1 = Pm_MessageData1( buffer[0].message );
-				msg.m_nData2 = Pm_MessageData2( buffer[0].message );
-
-				instance->handleMidiMessage( msg );
+			int64_t nNow = rtclock_now_ns();
+			PmTimestamp nPtNow = Pt_Time();
+			for ( int ii = 0; ii < nLength; ++ii ) {
+				instance->handleMidiMessage( PortMidiDriver_message( buffer[ ii ], nNow, nPtNow ) );
 			}
-		} else {
+			nEvents += nLength;
+		}
+
+		if ( nEvents > 0 ) {
+			nIdlePolls = 0;
+			continue;
+		}
+
+		instance->flushControlChanges();
+		int nPollUs = nIdlePolls < PORTMIDI_IDLE_POLLS ?
+			PORTMIDI_ACTIVE_POLL_US : PORTMIDI_IDLE_POLL_US;
+		++nIdlePolls;
 #ifdef WIN32
+		if ( hTimer != nullptr ) {
+			// Relative due time in units of 100 ns.
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -10 * static_cast<LONGLONG>( nPollUs );
+			SetWaitableTimer( hTimer, &dueTime, 0, nullptr, nullptr, FALSE );
+			WaitForSingleObject( hTimer, INFINITE );
+		} else {
 			Sleep( 1 );
+		}
 #else
-			usleep( 100 );
+		usleep( nPollUs );
 #endif
-		}
 	}
 
-
+#ifdef WIN32
+	if ( hTimer != nullptr ) {
+		CloseHandle( hTimer );
+	}
+#endif
 
 	__INFOLOG( "MIDI Thread DESTROY" );
 	pthread_exit( nullptr );
@@ -288,7 +360,7 @@ std::vector<QString> PortMidiDriver::getOutputPortList()
 	return portList;
 }
 
-void PortMidiDriver::handleQueueNote(Note* pNote)
+void PortMidiDriver::handleQueueNote( Note* pNote, int nFrame )
 {
 	if ( m_pMidiOut == nullptr ) {
 		ERRORLOG( "m_pMidiOut = nullptr " );
@@ -315,7 +387,7 @@ void PortMidiDriver::handleQueueNote(Note* pNote)
 	Pm_Write(m_pMidiOut, &event, 1);
 }
 
-void PortMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
+void PortMidiDriver::handleQueueNoteOff( int channel, int key, int velocity, int nFrame )
 {
 	if ( m_pMidiOut == nullptr ) {
 		ERRORLOG( "m_pMidiOut = nullptr " );
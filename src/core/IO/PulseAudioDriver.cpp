@@ -25,7 +25,12 @@
 #if defined(H2CORE_HAVE_PULSEAUDIO) || _DOXYGEN_
 
 #include <fcntl.h>
+#include <cstring>
 #include <core/Preferences.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+#include <core/IO/RenderAhead.h>
+#include <core/Tracer.h>
 
 
 namespace H2Core
@@ -39,7 +44,9 @@ PulseAudioDriver::PulseAudioDriver(audioProcessCallback processCallback)
 		m_stream(nullptr),
 		m_connected(false),
 		m_outL(nullptr),
-		m_outR(nullptr)
+		m_outR(nullptr),
+		m_pRenderAhead(nullptr),
+		m_nRenderAheadOffset(0)
 {
 	pthread_mutex_init(&m_mutex, nullptr);
 	pthread_cond_init(&m_cond, nullptr);
@@ -79,11 +86,23 @@ int PulseAudioDriver::connect()
 
 	fcntl(m_pipe[0], F_SETFL, fcntl(m_pipe[0], F_GETFL) | O_NONBLOCK);
 
+	int nRenderAheadBuffers = Preferences::get_instance()->m_nRenderAheadBuffers;
+	if ( nRenderAheadBuffers > 0 ) {
+		m_pRenderAhead = new RenderAhead( m_callback, 2, m_buffer_size, nRenderAheadBuffers );
+		m_nRenderAheadOffset = 0;
+		m_pRenderAhead->start( [this]( const float** ppOut ) {
+			ppOut[ 0 ] = m_outL;
+			ppOut[ 1 ] = m_outR;
+		} );
+	}
+
 	m_ready = 0;
 	if (pthread_create(&m_thread, nullptr, s_thread_body, this))
 	{
 		close(m_pipe[0]);
 		close(m_pipe[1]);
+		delete m_pRenderAhead;
+		m_pRenderAhead = nullptr;
 		return 1;
 	}
 
@@ -98,6 +117,8 @@ int PulseAudioDriver::connect()
 		pthread_join(m_thread, nullptr);
 		close(m_pipe[0]);
 		close(m_pipe[1]);
+		delete m_pRenderAhead;
+		m_pRenderAhead = nullptr;
 		return 1;
 	}
 
@@ -117,6 +138,8 @@ void PulseAudioDriver::disconnect()
 		pthread_join(m_thread, nullptr);
 		close(m_pipe[0]);
 		close(m_pipe[1]);
+		delete m_pRenderAhead;
+		m_pRenderAhead = nullptr;
 	}
 }
 
@@ -177,6 +200,8 @@ void PulseAudioDriver::setBpm( float fBPM )
 void* PulseAudioDriver::s_thread_body(void* arg)
 {
 	PulseAudioDriver* self = (PulseAudioDriver*)arg;
+	Threads::configureCurrentThread( Threads::Role::Audio, "PulseAudio" );
+	Dsp::disableDenormals();
 	int r = self->thread_body();
 	if (r)
 	{
@@ -232,13 +257,21 @@ void PulseAudioDriver::ctx_state_callback(pa_context* ctx, void* udata)
 		self->m_stream = pa_stream_new(ctx, "Hydrogen", &spec, nullptr);
 		pa_stream_set_state_callback(self->m_stream, stream_state_callback, self);
 		pa_stream_set_write_callback(self->m_stream, stream_write_callback, self);
+		// Sizes are in bytes of interleaved stereo S16 frames.
+		Preferences* pPref = Preferences::get_instance();
+		unsigned nTargetLength = pPref->m_nPulseAudioTargetLength > 0 ?
+			pPref->m_nPulseAudioTargetLength : self->m_buffer_size;
 		pa_buffer_attr bufattr;
 		bufattr.fragsize = (uint32_t)-1;
-		bufattr.maxlength = self->m_buffer_size * 4;
-		bufattr.minreq = 0;
+		bufattr.maxlength = (uint32_t)-1;
+		bufattr.minreq = pPref->m_nPulseAudioMinRequest > 0 ?
+			pPref->m_nPulseAudioMinRequest * 4 : (uint32_t)-1;
 		bufattr.prebuf = (uint32_t)-1;
-		bufattr.tlength = self->m_buffer_size * 4;
-		pa_stream_connect_playback(self->m_stream, nullptr, &bufattr, pa_stream_flags_t(0), nullptr, nullptr);
+		bufattr.tlength = nTargetLength * 4;
+		// Let the server configure the latency of the sink according
+		// to tlength instead of buffering on top of it.
+		pa_stream_connect_playback(self->m_stream, nullptr, &bufattr,
+								   PA_STREAM_ADJUST_LATENCY, nullptr, nullptr);
 	}
 	else if (s == PA_CONTEXT_FAILED) {
 		pa_mainloop_quit(self->m_main_loop, 1);
@@ -254,6 +287,11 @@ void PulseAudioDriver::stream_state_callback(pa_stream* stream, void* udata)
 	if ( s == PA_STREAM_FAILED ) {
 		pa_mainloop_quit(self->m_main_loop, 1);
 	} else if ( s == PA_STREAM_READY ) {
+		const pa_buffer_attr* pAttr = pa_stream_get_buffer_attr( stream );
+		if ( pAttr != nullptr ) {
+			___INFOLOG( QString( "Negotiated buffer attributes: tlength [%1] minreq [%2] frames" )
+						.arg( pAttr->tlength / 4 ).arg( pAttr->minreq / 4 ) );
+		}
 		pthread_mutex_lock(&self->m_mutex);
 		self->m_ready = 1;
 		pthread_cond_signal(&self->m_cond);
@@ -261,11 +299,10 @@ void PulseAudioDriver::stream_state_callback(pa_stream* stream, void* udata)
 	}
 }
 
-#define FLOAT_TO_SHORT(x) short(round((std::min(std::max((x), -1.0f), 1.0f)) * 32767.0f))
-
 void PulseAudioDriver::stream_write_callback(pa_stream* stream, size_t bytes, void* udata)
 {
 	PulseAudioDriver* self = (PulseAudioDriver*)udata;
+	Tracer::Scope trace( "PulseAudioDriver write" );
 
 	void* vdata;
 	pa_stream_begin_write(stream, &vdata, &bytes);
@@ -277,13 +314,29 @@ void PulseAudioDriver::stream_write_callback(pa_stream* stream, size_t bytes, vo
 
 	while (num_samples)
 	{
-		int n = std::min(self->m_buffer_size, num_samples);
-		self->m_callback(n, nullptr);
-		for (int i = 0; i < n; ++i)
-		{
-			*out++ = FLOAT_TO_SHORT(self->m_outL[i]);
-			*out++ = FLOAT_TO_SHORT(self->m_outR[i]);
+		unsigned n = std::min(self->m_buffer_size, num_samples);
+		if ( self->m_pRenderAhead != nullptr ) {
+			const float* const* ppRendered = self->m_pRenderAhead->front();
+			if ( ppRendered != nullptr ) {
+				n = std::min( n, self->m_buffer_size - self->m_nRenderAheadOffset );
+				const float* ppOut[2] = { ppRendered[ 0 ] + self->m_nRenderAheadOffset,
+										  ppRendered[ 1 ] + self->m_nRenderAheadOffset };
+				Dsp::interleaveInt16(out, ppOut, 2, n);
+				self->m_nRenderAheadOffset += n;
+				if ( self->m_nRenderAheadOffset == self->m_buffer_size ) {
+					self->m_nRenderAheadOffset = 0;
+					self->m_pRenderAhead->pop();
+				}
+			} else {
+				// The render thread fell behind.
+				memset( out, 0, n * 4 );
+			}
+		} else {
+			self->m_callback(n, nullptr);
+			const float* ppOut[2] = { self->m_outL, self->m_outR };
+			Dsp::interleaveInt16(out, ppOut, 2, n);
 		}
+		out += n * 2;
 
 		num_samples -= n;
 	}
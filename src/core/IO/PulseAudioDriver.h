@@ -34,6 +34,7 @@
 namespace H2Core
 {
 
+class RenderAhead;
 
 ///
 /// PulseAudio driver.
@@ -76,6 +77,13 @@ private:
 	unsigned				m_buffer_size;
 	float*					m_outL;
 	float*					m_outR;
+	/** Renders Preferences::m_nRenderAheadBuffers buffers ahead
+		of the stream or nullptr if they are rendered in
+		stream_write_callback().*/
+	RenderAhead*			m_pRenderAhead;
+	/** Frames of the oldest buffer of #m_pRenderAhead already
+		written to the stream.*/
+	unsigned				m_nRenderAheadOffset;
 
 	static void* s_thread_body(void*);
 	int thread_body();
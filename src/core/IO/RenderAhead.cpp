@@ -0,0 +1,150 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/RenderAhead.h>
+#include <core/Preferences.h>
+#include <core/Tracer.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* RenderAhead::__class_name = "RenderAhead";
+
+RenderAhead::RenderAhead( audioProcessCallback processCallback, unsigned nChannels,
+						  unsigned nBufferSize, int nBuffers )
+	: Object( __class_name )
+	, m_processCallback( processCallback )
+	, m_nChannels( nChannels )
+	, m_nBufferSize( nBufferSize )
+	, m_nBuffers( std::max( 1, nBuffers ) )
+	, m_nWritten( 0 )
+	, m_nRead( 0 )
+	, m_nUnderruns( 0 )
+	, m_bRunning( false )
+{
+	m_data.resize( static_cast<size_t>( m_nBuffers ) * m_nChannels * m_nBufferSize, 0 );
+	m_channels.resize( static_cast<size_t>( m_nBuffers ) * m_nChannels );
+	for ( size_t ii = 0; ii < m_channels.size(); ++ii ) {
+		m_channels[ ii ] = m_data.data() + ii * m_nBufferSize;
+	}
+
+	// A quarter of a buffer, so a missed wakeup costs only a
+	// fraction of the time rendered ahead.
+	unsigned nSampleRate = std::max( 1u, Preferences::get_instance()->m_nSampleRate );
+	m_waitTime = std::chrono::microseconds(
+		std::max( 500LL, 250000LL * m_nBufferSize / nSampleRate ) );
+}
+
+RenderAhead::~RenderAhead()
+{
+	stop();
+}
+
+void RenderAhead::start( captureCallback capture )
+{
+	stop();
+
+	m_capture = capture;
+	m_nWritten = 0;
+	m_nRead = 0;
+	m_bRunning = true;
+	m_thread = std::thread( &RenderAhead::renderLoop, this );
+	INFOLOG( QString( "Rendering %1 buffers of %2 frames ahead" )
+			 .arg( m_nBuffers ).arg( m_nBufferSize ) );
+}
+
+void RenderAhead::stop()
+{
+	if ( ! m_thread.joinable() ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bRunning = false;
+	}
+	m_cond.notify_one();
+	m_thread.join();
+
+	if ( m_nUnderruns > 0 ) {
+		WARNINGLOG( QString( "%1 underruns" ).arg( m_nUnderruns.load() ) );
+	}
+}
+
+const float* const* RenderAhead::front()
+{
+	size_t nRead = m_nRead.load( std::memory_order_relaxed );
+	if ( m_nWritten.load( std::memory_order_acquire ) == nRead ) {
+		m_nUnderruns++;
+		return nullptr;
+	}
+	return m_channels.data() + ( nRead % m_nBuffers ) * m_nChannels;
+}
+
+void RenderAhead::pop()
+{
+	m_nRead.store( m_nRead.load( std::memory_order_relaxed ) + 1,
+				   std::memory_order_release );
+	m_cond.notify_one();
+}
+
+void RenderAhead::renderLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Audio, "Render ahead" );
+	Dsp::disableDenormals();
+
+	std::vector<const float*> output( m_nChannels, nullptr );
+	auto isFull = [&]() {
+		return m_nWritten.load( std::memory_order_relaxed ) -
+			m_nRead.load( std::memory_order_acquire ) >= static_cast<size_t>( m_nBuffers );
+	};
+
+	while ( m_bRunning ) {
+		if ( isFull() ) {
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_cond.wait_for( lock, m_waitTime, [&]() {
+				return ! m_bRunning || ! isFull();
+			} );
+			continue;
+		}
+
+		Tracer::Scope trace( "RenderAhead buffer" );
+		m_processCallback( m_nBufferSize, nullptr );
+		m_capture( output.data() );
+
+		size_t nWritten = m_nWritten.load( std::memory_order_relaxed );
+		float* const* ppSlot = m_channels.data() + ( nWritten % m_nBuffers ) * m_nChannels;
+		for ( unsigned nn = 0; nn < m_nChannels; ++nn ) {
+			memcpy( ppSlot[ nn ], output[ nn ],
+					m_nBufferSize * sizeof( float ) );
+		}
+		m_nWritten.store( nWritten + 1, std::memory_order_release );
+	}
+}
+
+};
@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_RENDER_AHEAD_H
+#define H2C_RENDER_AHEAD_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <inttypes.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * Renders the output of the audio engine ahead of its playback.
+ *
+ * Drivers with loose deadlines, like the PulseAudio and ALSA ones
+ * using large periods, call the process callback of the engine right
+ * before handing a buffer to the device. A single expensive cycle -
+ * a pattern starting many voices at once, a song switch - then
+ * directly causes an xrun, although the device would have been fine
+ * waiting for the audio a little longer on average.
+ *
+ * A RenderAhead runs the process callback in a thread of its own
+ * and keeps up to #m_nBuffers rendered buffers in a single producer
+ * single consumer queue. The driver thread only takes the oldest one
+ * via front() and releases it again via pop(), neither of which
+ * locks nor allocates. CPU spikes are absorbed by the buffers
+ * already rendered.
+ *
+ * The next buffer is rendered as soon as one got released. Live
+ * notes, e.g. received via MIDI, are therefore voiced in the newest
+ * buffer and reach the device with a latency of at most #m_nBuffers
+ * buffers on top of the one of the driver.
+ */
+class RenderAhead : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	typedef int (*audioProcessCallback)(uint32_t, void *);
+	/** Fills the passed array with pointers to the #m_nChannels
+		output buffers the process callback rendered into.*/
+	typedef std::function<void(const float**)> captureCallback;
+
+	/**
+	 * \param processCallback Process callback of the audio engine.
+	 * \param nChannels Number of output channels of the driver.
+	 * \param nBufferSize Number of frames rendered per cycle.
+	 * \param nBuffers Maximum number of buffers rendered ahead. At
+	 *   least 1.
+	 */
+	RenderAhead( audioProcessCallback processCallback, unsigned nChannels,
+				 unsigned nBufferSize, int nBuffers );
+	~RenderAhead();
+
+	/**
+	 * Starts the render thread, which immediately fills the queue.
+	 *
+	 * \param capture Called by the render thread after each cycle
+	 *   to retrieve the output buffers of the driver.
+	 */
+	void start( captureCallback capture );
+	/** Stops the render thread and drops all rendered buffers.*/
+	void stop();
+
+	/**
+	 * \return Pointers to the #m_nChannels channels of the oldest
+	 *   rendered buffer, each of #m_nBufferSize frames, or nullptr
+	 *   if the render thread fell behind. The buffer stays valid
+	 *   till pop() is called.
+	 *
+	 * Has to be called by the driver thread only.
+	 */
+	const float* const* front();
+	/** Releases the buffer returned by front() and lets the render
+		thread render the next one.*/
+	void pop();
+
+	unsigned getBufferSize() const {
+		return m_nBufferSize;
+	}
+	/** \return Number of times front() found the queue empty.*/
+	int getUnderruns() const {
+		return m_nUnderruns.load();
+	}
+
+private:
+	void renderLoop();
+
+	audioProcessCallback m_processCallback;
+	captureCallback m_capture;
+	const unsigned m_nChannels;
+	const unsigned m_nBufferSize;
+	const int m_nBuffers;
+	/** #m_nBuffers slots of #m_nChannels channels of
+		#m_nBufferSize frames.*/
+	std::vector<float> m_data;
+	/** Pointers to the channels of all slots within #m_data.*/
+	std::vector<float*> m_channels;
+
+	/** Number of buffers rendered so far.*/
+	alignas(64) std::atomic<size_t> m_nWritten;
+	/** Number of buffers released by the driver so far.*/
+	alignas(64) std::atomic<size_t> m_nRead;
+	std::atomic<int> m_nUnderruns;
+
+	std::atomic<bool> m_bRunning;
+	/** Guards the waiting of the render thread only. pop() notifies
+		#m_cond without acquiring it, so the render thread waits for
+		at most #m_waitTime to not miss a wakeup.*/
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::chrono::microseconds m_waitTime;
+	std::thread m_thread;
+};
+
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/SongAutosaver.h>
+#include <core/LocalFileMng.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Helpers/Threads.h>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <utility>
+
+namespace H2Core
+{
+
+const char* SongAutosaver::__class_name = "SongAutosaver";
+
+SongAutosaver::SongAutosaver()
+	: Object( __class_name )
+	, m_bQuit( false )
+	, m_bBusy( false )
+{
+	m_worker = std::thread( &SongAutosaver::workerLoop, this );
+}
+
+SongAutosaver::~SongAutosaver()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bQuit = true;
+		m_condition.notify_all();
+	}
+	m_worker.join();
+}
+
+void SongAutosaver::save( Song* pSong, const QString& sFilename )
+{
+	if ( pSong == nullptr ) {
+		return;
+	}
+
+	SongWriter writer;
+	QByteArray content = writer.serialize( pSong );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	// The array is implicitly shared. Swapping it in ensures the
+	// calling thread does not hold a reference once it returns.
+	std::swap( m_pending, content );
+	m_sPendingFilename = sFilename;
+	m_condition.notify_all();
+}
+
+void SongAutosaver::wait()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_condition.wait( lock, [&]() {
+		return m_pending.isEmpty() && ! m_bBusy;
+	} );
+}
+
+void SongAutosaver::workerLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "autosave" );
+
+	for ( ;; ) {
+		QByteArray content;
+		QString sFilename;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_bBusy = false;
+			m_condition.notify_all();
+			m_condition.wait( lock, [&]() {
+				return m_bQuit || ! m_pending.isEmpty();
+			} );
+			if ( m_pending.isEmpty() ) {
+				// Quit with nothing left to write.
+				return;
+			}
+			std::swap( content, m_pending );
+			sFilename = m_sPendingFilename;
+			m_bBusy = true;
+		}
+
+		if ( content == m_lastContent && sFilename == m_sLastFilename &&
+			 Filesystem::file_exists( sFilename, true ) ) {
+			continue;
+		}
+
+		QFileInfo fi( sFilename );
+		if ( ( Filesystem::file_exists( sFilename, true ) &&
+			   ! Filesystem::file_writable( sFilename, true ) ) ||
+			 ( ! Filesystem::file_exists( sFilename, true ) &&
+			   ! Filesystem::dir_writable( fi.dir().absolutePath(), true ) ) ) {
+			ERRORLOG( QString( "Unable to autosave song to %1. Path is not writable!" )
+					  .arg( sFilename ) );
+			continue;
+		}
+
+		if ( SongWriter::writeFile( content, sFilename ) ) {
+			m_lastContent = content;
+			m_sLastFilename = sFilename;
+		}
+	}
+}
+
+};
@@ -0,0 +1,92 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SONG_AUTOSAVER_H
+#define H2C_SONG_AUTOSAVER_H
+
+#include <core/Object.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace H2Core
+{
+
+class Song;
+
+/**
+ * Writes autosave copies of the song in a background thread.
+ *
+ * The calling thread does only take a snapshot of the song using
+ * SongWriter::serialize(). Writing it and flushing it to disk is done
+ * by the worker using SongWriter::writeFile(). This way a crash
+ * during autosave does not destroy the last good copy either.
+ *
+ * Snapshots not written yet are replaced by newer ones, and ones
+ * equal to the last file written are dropped without any disk access.
+ */
+class SongAutosaver : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	SongAutosaver();
+	/** Writes the pending snapshot, if any, and stops the worker.*/
+	~SongAutosaver();
+
+	/**
+	 * Takes a snapshot of @a pSong and queues it to be written to
+	 * @a sFilename. Neither the filename nor the modification state
+	 * of the song is changed.
+	 *
+	 * Has to be called by the thread editing the song.
+	 */
+	void save( Song* pSong, const QString& sFilename );
+	/** Blocks until all queued snapshots have been written.*/
+	void wait();
+
+private:
+	void workerLoop();
+
+	std::thread m_worker;
+	bool m_bQuit;
+	/** Whether the worker is writing a snapshot right now.*/
+	bool m_bBusy;
+	/** Snapshot to be written next. Empty if there is none.*/
+	QByteArray m_pending;
+	QString m_sPendingFilename;
+	/** Protects all members above except #m_worker.*/
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	/** Content of the last file written. Only used by the worker.*/
+	QByteArray m_lastContent;
+	QString m_sLastFilename;
+};
+
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/IO/TrackOutputs.h>
+
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Dsp.h>
+
+#include <QStringList>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* TrackOutputs::__class_name = "TrackOutputs";
+
+TrackOutputs::TrackOutputs( int nChannels, unsigned nBufferSize )
+	: Object( __class_name )
+	, m_nChannels( nChannels )
+	, m_nBufferSize( nBufferSize )
+{
+	int nTracks = std::max( 0, ( nChannels - 2 ) / 2 );
+	for ( int ii = 0; ii < nTracks; ++ii ) {
+		m_tracks_L.push_back( new float[ nBufferSize ] );
+		m_tracks_R.push_back( new float[ nBufferSize ] );
+	}
+	m_pSilence = new float[ nBufferSize ];
+	clear( nBufferSize );
+	Dsp::clear( m_pSilence, nBufferSize );
+
+	for ( int ii = 0; ii < MAX_INSTRUMENTS; ++ii ) {
+		for ( int jj = 0; jj < MAX_COMPONENTS; ++jj ) {
+			m_trackMap[ii][jj] = -1;
+		}
+		m_trackOutputBus[ii] = -1;
+	}
+}
+
+TrackOutputs::~TrackOutputs()
+{
+	for ( auto pBuffer : m_tracks_L ) {
+		delete[] pBuffer;
+	}
+	for ( auto pBuffer : m_tracks_R ) {
+		delete[] pBuffer;
+	}
+	delete[] m_pSilence;
+}
+
+void TrackOutputs::makeTrackOutputs( Song* pSong )
+{
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	int nTrackCount = 0;
+
+	for ( int ii = 0; ii < MAX_INSTRUMENTS; ++ii ) {
+		for ( int jj = 0; jj < MAX_COMPONENTS; ++jj ) {
+			m_trackMap[ii][jj] = -1;
+		}
+		m_trackOutputBus[ii] = -1;
+	}
+
+	// Track numbers of the output buses encountered so far.
+	QStringList busNames;
+	std::vector<int> busTracks;
+
+	for ( int nn = 0; nn < pInstrumentList->size(); ++nn ) {
+		Instrument* pInstrument = pInstrumentList->get( nn );
+		int nId = pInstrument->get_id();
+		if ( nId < 0 || nId >= MAX_INSTRUMENTS ) {
+			continue;
+		}
+
+		const QString& sBus = pInstrument->get_output_bus();
+		int nBusTrack = -1;
+		if ( ! sBus.isEmpty() ) {
+			int nBus = busNames.indexOf( sBus );
+			if ( nBus < 0 ) {
+				busNames << sBus;
+				busTracks.push_back( nTrackCount );
+				nBusTrack = nTrackCount;
+				nTrackCount++;
+			} else {
+				nBusTrack = busTracks[ nBus ];
+			}
+			m_trackOutputBus[ nId ] = nBusTrack;
+		}
+
+		for ( const auto& pCompo : *pInstrument->get_components() ) {
+			int nComponent = pCompo->get_drumkit_componentID();
+			if ( nComponent < 0 || nComponent >= MAX_COMPONENTS ) {
+				continue;
+			}
+			if ( nBusTrack >= 0 ) {
+				m_trackMap[ nId ][ nComponent ] = nBusTrack;
+			} else {
+				m_trackMap[ nId ][ nComponent ] = nTrackCount;
+				nTrackCount++;
+			}
+		}
+	}
+
+	if ( nTrackCount > getTrackCount() ) {
+		WARNINGLOG( QString( "Only %1 of %2 tracks fit on the %3 channels of the device" )
+					.arg( getTrackCount() ).arg( nTrackCount ).arg( m_nChannels ) );
+	}
+}
+
+void TrackOutputs::clear( uint32_t nFrames )
+{
+	for ( int ii = 0; ii < getTrackCount(); ++ii ) {
+		Dsp::clear( m_tracks_L[ ii ], nFrames );
+		Dsp::clear( m_tracks_R[ ii ], nFrames );
+	}
+}
+
+int TrackOutputs::getTrack( Instrument* pInstr, InstrumentComponent* pCompo ) const
+{
+	int nId = pInstr->get_id();
+	int nComponent = pCompo->get_drumkit_componentID();
+	if ( nId < 0 || nId >= MAX_INSTRUMENTS ||
+		 nComponent < 0 || nComponent >= MAX_COMPONENTS ) {
+		return -1;
+	}
+	return m_trackMap[ nId ][ nComponent ];
+}
+
+float* TrackOutputs::getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	int nTrack = getTrack( pInstr, pCompo );
+	if ( nTrack < 0 || nTrack >= getTrackCount() ) {
+		return nullptr;
+	}
+	return m_tracks_L[ nTrack ];
+}
+
+float* TrackOutputs::getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo )
+{
+	int nTrack = getTrack( pInstr, pCompo );
+	if ( nTrack < 0 || nTrack >= getTrackCount() ) {
+		return nullptr;
+	}
+	return m_tracks_R[ nTrack ];
+}
+
+int TrackOutputs::getTrackOutputBus( Instrument* pInstr ) const
+{
+	int nId = pInstr->get_id();
+	if ( nId < 0 || nId >= MAX_INSTRUMENTS ) {
+		return -1;
+	}
+	return m_trackOutputBus[ nId ];
+}
+
+void TrackOutputs::getChannelBuffers( const float** ppChannels, const float* pMain_L,
+									  const float* pMain_R, uint32_t nOffset ) const
+{
+	ppChannels[ 0 ] = pMain_L + nOffset;
+	ppChannels[ 1 ] = pMain_R + nOffset;
+	for ( int ii = 0; ii < getTrackCount(); ++ii ) {
+		ppChannels[ 2 + 2 * ii ] = m_tracks_L[ ii ] + nOffset;
+		ppChannels[ 3 + 2 * ii ] = m_tracks_R[ ii ] + nOffset;
+	}
+	for ( int ii = 2 + 2 * getTrackCount(); ii < m_nChannels; ++ii ) {
+		ppChannels[ ii ] = m_pSilence + nOffset;
+	}
+}
+
+};
@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2_TRACK_OUTPUTS_H
+#define H2_TRACK_OUTPUTS_H
+
+#include <core/config.h>
+#include <core/Object.h>
+
+#include <inttypes.h>
+#include <vector>
+
+namespace H2Core
+{
+
+class Song;
+class Instrument;
+class InstrumentComponent;
+
+///
+/// Per-track output buffers of audio drivers writing to a single
+/// multichannel device.
+///
+/// The first two channels of the device carry the main output and
+/// each following pair the output of one track. Just like the ports
+/// of the JackAudioDriver, each component of an instrument gets a
+/// track of its own while all instruments routed to the same output
+/// bus share one. Tracks not fitting on the device are rendered into
+/// the main output only.
+///
+class TrackOutputs : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/**
+	 * \param nChannels Number of channels of the device including
+	 *   the main output.
+	 * \param nBufferSize Maximum number of frames per process cycle.
+	 */
+	TrackOutputs( int nChannels, unsigned nBufferSize );
+	~TrackOutputs();
+
+	int getChannels() const {
+		return m_nChannels;
+	}
+	int getTrackCount() const {
+		return static_cast<int>( m_tracks_L.size() );
+	}
+
+	/** Assigns the tracks to the components and output buses of
+		the instruments of @a pSong.*/
+	void makeTrackOutputs( Song* pSong );
+	/** Resets the first @a nFrames frames of all tracks. Called at
+		the beginning of each process cycle.*/
+	void clear( uint32_t nFrames );
+
+	/** \return Left channel of track @a nTrack, which has to be
+		smaller than getTrackCount().*/
+	float* getTrackBuffer_L( int nTrack ) {
+		return m_tracks_L[ nTrack ];
+	}
+	/** Right channel counterpart of getTrackBuffer_L().*/
+	float* getTrackBuffer_R( int nTrack ) {
+		return m_tracks_R[ nTrack ];
+	}
+
+	float* getTrackOut_L( Instrument* pInstr, InstrumentComponent* pCompo );
+	float* getTrackOut_R( Instrument* pInstr, InstrumentComponent* pCompo );
+	int getTrackOutputBus( Instrument* pInstr ) const;
+
+	/**
+	 * Fills @a ppChannels with the buffers of all #m_nChannels
+	 * channels of the device starting at frame @a nOffset.
+	 * Channels without a track are silent.
+	 */
+	void getChannelBuffers( const float** ppChannels, const float* pMain_L,
+							const float* pMain_R, uint32_t nOffset ) const;
+
+private:
+	int m_nChannels;
+	unsigned m_nBufferSize;
+	std::vector<float*> m_tracks_L;
+	std::vector<float*> m_tracks_R;
+	/** Zeroed buffer backing the odd last channel of the device.*/
+	float* m_pSilence;
+
+	/** Track of each component of each instrument or -1.*/
+	int m_trackMap[MAX_INSTRUMENTS][MAX_COMPONENTS];
+	/** Track shared by all instruments of an output bus or -1.*/
+	int m_trackOutputBus[MAX_INSTRUMENTS];
+
+	int getTrack( Instrument* pInstr, InstrumentComponent* pCompo ) const;
+};
+
+};
+
+#endif
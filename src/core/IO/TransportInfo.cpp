@@ -34,9 +34,21 @@ TransportInfo::TransportInfo()
 	m_status = STOPPED;
 	m_nFrames = 0;
 	m_fTickSize = 0;
+	m_nTickSize = 0;
 	m_fBPM = 120;
 }
 
+void TransportInfo::setTickSize( int64_t nTickSize )
+{
+	m_nTickSize = nTickSize;
+	m_fTickSize = static_cast<float>( TickTime::toFrames( nTickSize ) );
+}
+
+void TransportInfo::setTickSize( unsigned nSampleRate, float fBpm, int nResolution )
+{
+	setTickSize( TickTime::tickSize( nSampleRate, fBpm, nResolution ) );
+}
+
 
 TransportInfo::~TransportInfo()
 {
@@ -23,6 +23,7 @@
 #define TRANSPORT_INFO_H
 
 #include <core/Object.h>
+#include <core/Helpers/TickTime.h>
 
 namespace H2Core
 {
@@ -83,14 +84,36 @@ public:
 	 * the #m_fBPM).
 	 */
 	float m_fTickSize;
+	/**
+	 * #m_fTickSize as fixed point number, see TickTime. All
+	 * conversions between frames and ticks of the scheduler are done
+	 * using this one, #m_fTickSize is derived from it.
+	 */
+	int64_t m_nTickSize;
 	/** Current tempo in beats per minute. */
 	float m_fBPM;
 
+	/** Sets #m_nTickSize to @a nTickSize and #m_fTickSize
+		accordingly.*/
+	void setTickSize( int64_t nTickSize );
+	/** Sets the tick size to the one at @a fBpm.*/
+	void setTickSize( unsigned nSampleRate, float fBpm, int nResolution );
+	/** \return Tick @a nFrame falls into, see
+		TickTime::tickAtFrame().*/
+	long long tickAtFrame( long long nFrame ) const {
+		return TickTime::tickAtFrame( nFrame, m_nTickSize );
+	}
+	/** \return First frame of @a nTick, see
+		TickTime::frameAtTick().*/
+	long long frameAtTick( long long nTick ) const {
+		return TickTime::frameAtTick( nTick, m_nTickSize );
+	}
+
 	/**
 	 * Constructor of TransportInfo
 	 *
 	 * - Sets #m_status to TransportInfo::STOPPED
-	 * - Sets #m_nFrames and #m_fTickSize to 0
+	 * - Sets #m_nFrames, #m_fTickSize, and #m_nTickSize to 0
 	 * - Sets #m_fBPM to 120
 	 */
 	TransportInfo();
@@ -0,0 +1,566 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/InstrumentFreezer.h>
+
+#include <core/config.h>
+#include <core/AudioEngine.h>
+#include <core/Hydrogen.h>
+#include <core/NoteQueue.h>
+#include <core/Preferences.h>
+#include <core/Basics/Adsr.h>
+#include <core/Basics/AutomationPath.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/NotePool.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/TickTime.h>
+#include <core/IO/OfflineDriver.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* InstrumentFreezer::__class_name = "InstrumentFreezer";
+
+InstrumentFreezer* InstrumentFreezer::__instance = nullptr;
+
+/** Relative deviation of the tick size still considered the tempo
+	a render was made at.*/
+static const float fTickSizeTolerance = 1e-5;
+
+// 64 bit FNV-1a
+static const uint64_t nHashOffset = 14695981039346656037ULL;
+static const uint64_t nHashPrime = 1099511628211ULL;
+
+template <typename T>
+static inline void hash_value( uint64_t& nHash, T value )
+{
+	unsigned char bytes[ sizeof( T ) ];
+	memcpy( bytes, &value, sizeof( T ) );
+	for ( unsigned ii = 0; ii < sizeof( T ); ++ii ) {
+		nHash = ( nHash ^ bytes[ ii ] ) * nHashPrime;
+	}
+}
+
+void InstrumentFreezer::create_instance()
+{
+	if ( __instance == nullptr ) {
+		__instance = new InstrumentFreezer;
+	}
+}
+
+InstrumentFreezer::InstrumentFreezer()
+	: Object( __class_name )
+	, m_bRendering( false )
+	, m_bStale( false )
+{
+}
+
+InstrumentFreezer::~InstrumentFreezer()
+{
+	__instance = nullptr;
+}
+
+uint64_t InstrumentFreezer::instrumentFingerprint( Instrument* pInstr, Song* pSong )
+{
+	uint64_t nHash = nHashOffset;
+	hash_value( nHash, pInstr->get_gain() );
+	hash_value( nHash, pInstr->get_pan_l() );
+	hash_value( nHash, pInstr->get_pan_r() );
+	hash_value( nHash, pInstr->get_apply_velocity() );
+	hash_value( nHash, pInstr->get_random_pitch_factor() );
+	hash_value( nHash, pInstr->get_pitch_offset() );
+	hash_value( nHash, pInstr->is_filter_active() );
+	hash_value( nHash, pInstr->get_filter_cutoff() );
+	hash_value( nHash, pInstr->get_filter_resonance() );
+	hash_value( nHash, static_cast<int>( pInstr->sample_selection_alg() ) );
+	hash_value( nHash, pInstr->get_sinc_interpolation() );
+	hash_value( nHash, pInstr->is_stop_notes() );
+
+	ADSR* pADSR = pInstr->get_adsr();
+	hash_value( nHash, pADSR->get_attack() );
+	hash_value( nHash, pADSR->get_decay() );
+	hash_value( nHash, pADSR->get_sustain() );
+	hash_value( nHash, pADSR->get_release() );
+
+	for ( const auto& pCompo : *pInstr->get_components() ) {
+		hash_value( nHash, pCompo->get_drumkit_componentID() );
+		hash_value( nHash, pCompo->get_gain() );
+		for ( int nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); ++nLayer ) {
+			InstrumentLayer* pLayer = pCompo->get_layer( nLayer );
+			if ( pLayer == nullptr ) {
+				hash_value( nHash, -1 );
+				continue;
+			}
+			auto pSample = pLayer->get_sample();
+			hash_value( nHash, pLayer->get_gain() );
+			hash_value( nHash, pLayer->get_pitch() );
+			hash_value( nHash, pLayer->get_start_velocity() );
+			hash_value( nHash, pLayer->get_end_velocity() );
+			hash_value( nHash, reinterpret_cast<uintptr_t>( pSample.get() ) );
+			if ( pSample != nullptr ) {
+				hash_value( nHash, pSample->get_frames() );
+			}
+		}
+	}
+
+	hash_value( nHash, pSong->getSwingFactor() );
+	hash_value( nHash, pSong->getHumanizeTimeValue() );
+	hash_value( nHash, pSong->getHumanizeVelocityValue() );
+	hash_value( nHash, pSong->getPanLawType() );
+	hash_value( nHash, pSong->getPanLawKNorm() );
+
+	return nHash;
+}
+
+uint64_t InstrumentFreezer::patternFingerprint( const Pattern* pPattern, const Instrument* pInstr )
+{
+	uint64_t nHash = nHashOffset;
+	bool bNotes = false;
+	hash_value( nHash, pPattern->get_length() );
+
+	FOREACH_NOTE_CST_IT_BEGIN_END( pPattern->get_notes(), it ) {
+		Note* pNote = it->second;
+		if ( pNote == nullptr || pNote->get_instrument() != pInstr ) {
+			continue;
+		}
+		bNotes = true;
+		hash_value( nHash, pNote->get_position() );
+		hash_value( nHash, pNote->get_velocity() );
+		hash_value( nHash, pNote->get_pan_l() );
+		hash_value( nHash, pNote->get_pan_r() );
+		hash_value( nHash, pNote->get_length() );
+		hash_value( nHash, pNote->get_pitch() );
+		hash_value( nHash, static_cast<int>( pNote->get_key() ) );
+		hash_value( nHash, static_cast<int>( pNote->get_octave() ) );
+		hash_value( nHash, pNote->get_lead_lag() );
+		hash_value( nHash, pNote->get_probability() );
+		hash_value( nHash, pNote->get_note_off() );
+	}
+
+	if ( ! bNotes ) {
+		return 0;
+	}
+	// 0 is reserved for patterns without notes of the instrument.
+	return nHash != 0 ? nHash : 1;
+}
+
+bool InstrumentFreezer::freeze( Instrument* pInstr )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	AudioOutput* pAudioDriver = pHydrogen->getAudioOutput();
+	if ( pInstr == nullptr || pSong == nullptr || pAudioDriver == nullptr ) {
+		return false;
+	}
+	if ( pHydrogen->getIsExportSessionActive() ) {
+		ERRORLOG( "Instruments can not be frozen during an export" );
+		return false;
+	}
+	if ( ! pSong->getVelocityAutomationPath()->empty() ) {
+		// It depends on the position of the note within the song.
+		ERRORLOG( "Instruments can not be frozen while the velocity automation is used" );
+		return false;
+	}
+
+	unfreeze( pInstr );
+
+	std::vector<Pattern*> patterns;
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	PatternList* pPatternList = pSong->getPatternList();
+	for ( int ii = 0; ii < pPatternList->size(); ++ii ) {
+		Pattern* pPattern = pPatternList->get( ii );
+		if ( pPattern->get_virtual_patterns()->empty() &&
+			 patternFingerprint( pPattern, pInstr ) != 0 ) {
+			patterns.push_back( pPattern );
+		}
+	}
+	AudioEngine::get_instance()->unlock();
+	if ( patterns.empty() ) {
+		WARNINGLOG( QString( "No notes of [%1] to freeze" ).arg( pInstr->get_name() ) );
+		return false;
+	}
+
+	const unsigned nSampleRate = pAudioDriver->getSampleRate();
+	const float fTickSize = AudioEngine::compute_tick_size( nSampleRate, pSong->getBpm(),
+															pSong->getResolution() );
+	// Empty columns appended to each pattern to capture the tails.
+	const int nTailColumns = static_cast<int>(
+		std::ceil( fMaxTail * nSampleRate / ( MAX_NOTES * fTickSize ) ) );
+
+	// All notes are rendered at the tempo of the song and only the
+	// frozen instrument is rendered at all.
+	Preferences* pPref = Preferences::get_instance();
+	const bool bUseTimelineBpm = pPref->getUseTimelineBpm();
+	pPref->setUseTimelineBpm( false );
+	InstrumentList* pInstrList = pSong->getInstrumentList();
+	std::vector<bool> exported;
+	for ( int ii = 0; ii < pInstrList->size(); ++ii ) {
+		Instrument* pOther = pInstrList->get( ii );
+		exported.push_back( pOther->is_currently_exported() );
+		pOther->set_currently_exported( pOther == pInstr );
+	}
+
+	// Stops the playback before the pattern groups are replaced.
+	m_bRendering = true;
+	OfflineDriver* pDriver = pHydrogen->startOfflineRender( nSampleRate );
+
+	std::vector<std::shared_ptr<const FrozenPattern>> renders;
+	if ( pDriver != nullptr ) {
+		pDriver->setTrackInstrument( pInstr );
+
+		std::vector<PatternList*> columns;
+		for ( int ii = 0; ii <= nTailColumns; ++ii ) {
+			columns.push_back( new PatternList );
+		}
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		std::vector<PatternList*>* pSongColumns = pSong->getPatternGroupVector();
+		pSong->setPatternGroupVector( &columns );
+		AudioEngine::get_instance()->unlock();
+
+		for ( const auto& pPattern : patterns ) {
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			columns[ 0 ]->clear();
+			columns[ 0 ]->add( pPattern );
+			pSong->invalidateColumnStartTicks();
+			AudioEngine::get_instance()->unlock();
+
+			if ( ! pHydrogen->restartOfflineRender() ) {
+				break;
+			}
+			auto pRender = renderPattern( pDriver, pPattern, pInstr, fTickSize );
+			if ( pRender == nullptr ) {
+				break;
+			}
+			renders.push_back( pRender );
+		}
+
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		pSong->setPatternGroupVector( pSongColumns );
+		for ( auto pColumn : columns ) {
+			// The pattern is still owned by the song.
+			pColumn->clear();
+			delete pColumn;
+		}
+		AudioEngine::get_instance()->unlock();
+
+		pDriver->setTrackInstrument( nullptr );
+		pHydrogen->stopExportSession();
+	}
+	m_bRendering = false;
+
+	for ( int ii = 0; ii < pInstrList->size() &&
+			  ii < static_cast<int>( exported.size() ); ++ii ) {
+		pInstrList->get( ii )->set_currently_exported( exported[ ii ] );
+	}
+	pPref->setUseTimelineBpm( bUseTimelineBpm );
+
+	if ( renders.size() != patterns.size() ) {
+		ERRORLOG( QString( "Unable to freeze [%1]" ).arg( pInstr->get_name() ) );
+		return false;
+	}
+
+	std::unique_ptr<Entry> pEntry( new Entry );
+	pEntry->nInstrumentId = pInstr->get_id();
+	pEntry->nFingerprint = instrumentFingerprint( pInstr, pSong );
+	pEntry->renders = renders;
+	pEntry->pReplaced = nullptr;
+	pEntry->queued.reserve( renders.size() );
+	pEntry->bStale = false;
+
+	size_t nBytes = 0;
+	for ( const auto& pRender : renders ) {
+		nBytes += pRender->data.size() * sizeof( float );
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	m_entries.push_back( std::move( pEntry ) );
+	AudioEngine::get_instance()->unlock();
+
+	INFOLOG( QString( "[%1] frozen into %2 patterns, %3 MiB" )
+			 .arg( pInstr->get_name() ).arg( renders.size() )
+			 .arg( nBytes / ( 1024.0 * 1024.0 ), 0, 'f', 1 ) );
+	return true;
+}
+
+std::shared_ptr<const FrozenPattern> InstrumentFreezer::renderPattern( OfflineDriver* pDriver,
+																	   Pattern* pPattern,
+																	   Instrument* pInstr,
+																	   float fTickSize )
+{
+	auto pRender = std::make_shared<FrozenPattern>();
+	pRender->pPattern = pPattern;
+	pRender->fTickSize = fTickSize;
+	pRender->nSampleRate = pDriver->getSampleRate();
+	pRender->nFingerprint = patternFingerprint( pPattern, pInstr );
+
+	const int nTracks = pDriver->getTrackCount();
+	for ( int ii = 0; ii < nTracks; ++ii ) {
+		pRender->componentIds.push_back(
+			(*pInstr->get_components())[ ii ]->get_drumkit_componentID() );
+	}
+
+	const int nPatternFrames = static_cast<int>(
+		std::ceil( pPattern->get_length() * fTickSize ) );
+	const int nMaxFrames = nPatternFrames +
+		static_cast<int>( fMaxTail * pRender->nSampleRate );
+	const unsigned nBufferSize = pDriver->getBufferSize();
+
+	std::vector<float> tracks( 2 * nTracks * static_cast<size_t>( nMaxFrames ), 0 );
+	std::vector<float> main_L( nBufferSize );
+	std::vector<float> main_R( nBufferSize );
+
+	// The tracks only hold a single chunk.
+	int nRendered = 0;
+	while ( nRendered < nMaxFrames && ! pDriver->isFinished() ) {
+		uint32_t nChunk = std::min<uint32_t>( nBufferSize, nMaxFrames - nRendered );
+		nChunk = pDriver->render( main_L.data(), main_R.data(), nChunk );
+		if ( nChunk == 0 ) {
+			break;
+		}
+		for ( int ii = 0; ii < nTracks; ++ii ) {
+			memcpy( &tracks[ 2 * ii * nMaxFrames + nRendered ],
+					pDriver->getTrack_L( ii ), nChunk * sizeof( float ) );
+			memcpy( &tracks[ ( 2 * ii + 1 ) * nMaxFrames + nRendered ],
+					pDriver->getTrack_R( ii ), nChunk * sizeof( float ) );
+		}
+		nRendered += nChunk;
+	}
+	if ( nRendered == 0 ) {
+		ERRORLOG( "Nothing rendered" );
+		return nullptr;
+	}
+
+	// Cut the silent end of the tails.
+	int nFrames = std::min( nRendered, nPatternFrames );
+	for ( int nFrame = nRendered - 1; nFrame >= nFrames; --nFrame ) {
+		bool bSilent = true;
+		for ( int nChannel = 0; nChannel < 2 * nTracks && bSilent; ++nChannel ) {
+			if ( std::fabs( tracks[ nChannel * nMaxFrames + nFrame ] ) > fSilence ) {
+				bSilent = false;
+			}
+		}
+		if ( ! bSilent ) {
+			nFrames = nFrame + 1;
+			break;
+		}
+	}
+
+	pRender->nFrames = nFrames;
+	pRender->data.resize( 2 * nTracks * static_cast<size_t>( nFrames ) );
+	for ( int nChannel = 0; nChannel < 2 * nTracks; ++nChannel ) {
+		std::copy( tracks.begin() + nChannel * nMaxFrames,
+				   tracks.begin() + nChannel * nMaxFrames + nFrames,
+				   pRender->data.begin() + nChannel * nFrames );
+	}
+
+	return pRender;
+}
+
+void InstrumentFreezer::unfreeze( Instrument* pInstr )
+{
+	if ( pInstr == nullptr ) {
+		return;
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	for ( int ii = m_entries.size() - 1; ii >= 0; --ii ) {
+		if ( m_entries[ ii ]->nInstrumentId == pInstr->get_id() ) {
+			dropEntry( ii );
+		}
+	}
+	AudioEngine::get_instance()->unlock();
+
+	collect();
+}
+
+void InstrumentFreezer::clear()
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	while ( ! m_entries.empty() ) {
+		dropEntry( m_entries.size() - 1 );
+	}
+	AudioEngine::get_instance()->unlock();
+
+	collect();
+}
+
+bool InstrumentFreezer::isFrozen( Instrument* pInstr ) const
+{
+	if ( pInstr == nullptr ) {
+		return false;
+	}
+	for ( const auto& pEntry : m_entries ) {
+		if ( pEntry->nInstrumentId == pInstr->get_id() &&
+			 ! pEntry->bStale.load( std::memory_order_relaxed ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void InstrumentFreezer::collect()
+{
+	if ( m_bStale.exchange( false ) ) {
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		for ( int ii = m_entries.size() - 1; ii >= 0; --ii ) {
+			if ( m_entries[ ii ]->bStale.load( std::memory_order_relaxed ) ) {
+				INFOLOG( QString( "Instrument [%1] unfrozen since it was changed" )
+						 .arg( m_entries[ ii ]->nInstrumentId ) );
+				dropEntry( ii );
+			}
+		}
+		AudioEngine::get_instance()->unlock();
+	}
+
+	// The audio engine only copies the renders still in
+	// #m_entries. Once a retired one is held by the freezer alone, no
+	// note can pick it up anymore.
+	m_retired.erase( std::remove_if( m_retired.begin(), m_retired.end(),
+									 []( const std::shared_ptr<const FrozenPattern>& pRender ) {
+										 return pRender.use_count() == 1;
+									 } ),
+					 m_retired.end() );
+}
+
+void InstrumentFreezer::dropEntry( int nEntry )
+{
+	for ( const auto& pRender : m_entries[ nEntry ]->renders ) {
+		m_retired.push_back( pRender );
+	}
+	m_entries.erase( m_entries.begin() + nEntry );
+}
+
+void InstrumentFreezer::startColumn( PatternList* pPlayingPatterns, Song* pSong, long nTick,
+									 int64_t nTickSize, unsigned nSampleRate, NoteQueue& queue )
+{
+	resetColumn();
+	if ( m_bRendering || m_entries.empty() ||
+		 ! pSong->getVelocityAutomationPath()->empty() ) {
+		return;
+	}
+
+	const float fTickSize = static_cast<float>( TickTime::toFrames( nTickSize ) );
+	InstrumentList* pInstrList = pSong->getInstrumentList();
+	for ( auto& pEntry : m_entries ) {
+		if ( pEntry->bStale.load( std::memory_order_relaxed ) ) {
+			continue;
+		}
+		Instrument* pInstr = pInstrList->find( pEntry->nInstrumentId );
+		if ( pInstr == nullptr ) {
+			continue;
+		}
+		if ( instrumentFingerprint( pInstr, pSong ) != pEntry->nFingerprint ) {
+			pEntry->bStale.store( true, std::memory_order_relaxed );
+			m_bStale.store( true );
+			continue;
+		}
+
+		// Each playing pattern with notes of the instrument requires
+		// a matching render. Else the whole instrument is rendered
+		// live.
+		bool bMatching = true;
+		pEntry->queued.clear();
+		for ( int ii = 0; ii < pPlayingPatterns->size() && bMatching; ++ii ) {
+			const Pattern* pPattern = pPlayingPatterns->get( ii );
+			uint64_t nFingerprint = patternFingerprint( pPattern, pInstr );
+			if ( nFingerprint == 0 ) {
+				continue;
+			}
+
+			int nRender = -1;
+			for ( int nn = 0; nn < static_cast<int>( pEntry->renders.size() ); ++nn ) {
+				if ( pEntry->renders[ nn ]->pPattern == pPattern ) {
+					nRender = nn;
+					break;
+				}
+			}
+			if ( nRender == -1 ||
+				 pEntry->queued.size() == pEntry->queued.capacity() ) {
+				bMatching = false;
+				break;
+			}
+
+			const FrozenPattern* pRender = pEntry->renders[ nRender ].get();
+			if ( pRender->nFingerprint != nFingerprint ) {
+				pEntry->bStale.store( true, std::memory_order_relaxed );
+				m_bStale.store( true );
+				bMatching = false;
+			} else if ( pRender->nSampleRate != nSampleRate ||
+						std::fabs( pRender->fTickSize - fTickSize ) >
+						fTickSizeTolerance * fTickSize ) {
+				// E.g. a tempo change. The render is still valid.
+				bMatching = false;
+			} else {
+				pEntry->queued.push_back( nRender );
+			}
+		}
+		if ( ! bMatching || pEntry->queued.empty() ) {
+			continue;
+		}
+
+		pEntry->pReplaced = pInstr;
+		for ( const auto& nRender : pEntry->queued ) {
+			Note* pNote = new ( NotePool::get_instance() ) Note( pInstr, nTick, VELOCITY_MAX,
+																  PAN_MAX, PAN_MAX, -1, 0 );
+			// The envelope is part of the render. Only its release is
+			// applied, in case the note is stopped early.
+			ADSR* pADSR = pNote->get_adsr();
+			pADSR->set_attack( 0 );
+			pADSR->set_decay( 0 );
+			pADSR->set_sustain( 1.0 );
+			pNote->set_frozen_pattern( pEntry->renders[ nRender ] );
+			pInstr->enqueue();
+			queue.push( pNote, nTickSize );
+		}
+	}
+}
+
+void InstrumentFreezer::resetColumn()
+{
+	for ( auto& pEntry : m_entries ) {
+		pEntry->pReplaced = nullptr;
+	}
+}
+
+bool InstrumentFreezer::isReplaced( const Instrument* pInstr ) const
+{
+	for ( const auto& pEntry : m_entries ) {
+		if ( pEntry->pReplaced == pInstr ) {
+			return pInstr != nullptr;
+		}
+	}
+	return false;
+}
+
+};
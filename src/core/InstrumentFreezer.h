@@ -0,0 +1,226 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef INSTRUMENT_FREEZER_H
+#define INSTRUMENT_FREEZER_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace H2Core
+{
+
+class Instrument;
+class NoteQueue;
+class OfflineDriver;
+class Pattern;
+class PatternList;
+class Song;
+
+/**
+ * Audio of all notes of a single instrument within a pattern,
+ * rendered by the InstrumentFreezer.
+ *
+ * The voices are captured before the volume and mute of the
+ * instrument, its components, and the song are applied. Everything
+ * else - samples, envelope, filter, pitch, velocity, and pan - is
+ * part of the render.
+ */
+struct FrozenPattern {
+	/** Pattern the render belongs to. Only compared, never
+		dereferenced.*/
+	const Pattern* pPattern;
+	float fTickSize;
+	unsigned nSampleRate;
+	/** Length of the render including the release tails of the
+		notes.*/
+	int nFrames;
+	/** Drumkit component IDs of the instrument components in the
+		order they are stored in #data.*/
+	std::vector<int> componentIds;
+	/** #nFrames frames of the left followed by the right channel of
+		each component.*/
+	std::vector<float> data;
+	/** InstrumentFreezer::patternFingerprint() at the time of the
+		render.*/
+	uint64_t nFingerprint;
+
+	const float* getData_L( int nComponent ) const {
+		return data.data() + 2 * nComponent * nFrames;
+	}
+	const float* getData_R( int nComponent ) const {
+		return data.data() + ( 2 * nComponent + 1 ) * nFrames;
+	}
+};
+
+/**
+ * Freezes instruments by bouncing their notes into pre-rendered
+ * audio, which is streamed during playback instead of rendering
+ * the individual voices.
+ *
+ * freeze() renders each pattern holding notes of an instrument using
+ * the OfflineDriver. Whenever a column of the song starts,
+ * startColumn() checks whether all playing patterns with notes of a
+ * frozen instrument have a render still matching the patterns, the
+ * instrument, and the current tempo and sample rate. If so a single
+ * note playing the render is queued per pattern and the notes of the
+ * instrument are skipped by audioEngine_updateNoteQueue() for the
+ * remainder of the column. Otherwise the instrument is rendered live
+ * as usual.
+ *
+ * Renders no longer matching, e.g. since a note was edited, are
+ * dropped by collect(). This unfreezes the instrument.
+ *
+ * All functions but startColumn(), resetColumn(), and isReplaced()
+ * have to be called from the main thread.
+ */
+class InstrumentFreezer : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Longest release tail rendered after the end of a pattern
+		in seconds.*/
+	static constexpr float fMaxTail = 10;
+	/** Absolute value below which the end of a tail is considered
+		silent.*/
+	static constexpr float fSilence = 1e-5;
+
+	/**
+	 * If #__instance equals nullptr, a new InstrumentFreezer
+	 * singleton will be created and stored in #__instance.
+	 */
+	static void create_instance();
+	/** \return #__instance.*/
+	static InstrumentFreezer* get_instance();
+
+	~InstrumentFreezer();
+
+	/**
+	 * Renders all patterns holding notes of @a pInstr. Stops the
+	 * playback and blocks until all of them are rendered.
+	 *
+	 * Patterns containing virtual patterns are not frozen.
+	 *
+	 * \return false if no pattern could be rendered.
+	 */
+	bool freeze( Instrument* pInstr );
+	/** Drops all renders of @a pInstr.*/
+	void unfreeze( Instrument* pInstr );
+	/** Drops all renders, e.g. when the song is replaced.*/
+	void clear();
+	/** \return Whether renders of @a pInstr are present.*/
+	bool isFrozen( Instrument* pInstr ) const;
+	/**
+	 * Drops the renders startColumn() found not to match anymore
+	 * and releases the memory of dropped renders no longer
+	 * played. Called periodically by the GUI.
+	 */
+	void collect();
+
+	/**
+	 * Decides which frozen instruments are played back from their
+	 * renders for the column starting at @a nTick and queues the
+	 * corresponding notes in @a queue.
+	 *
+	 * Called by the audio engine with the engine locked. Neither
+	 * locks nor allocates.
+	 *
+	 * \param pPlayingPatterns Patterns of the column including the
+	 * flattened virtual patterns.
+	 * \param nTickSize Fixed point tick size, see TickTime.
+	 */
+	void startColumn( PatternList* pPlayingPatterns, Song* pSong, long nTick,
+					  int64_t nTickSize, unsigned nSampleRate, NoteQueue& queue );
+	/** All instruments are rendered live till the next column
+		starts, e.g. after a relocation.*/
+	void resetColumn();
+	/** \return Whether the notes of @a pInstr are replaced by its
+		renders in the current column.*/
+	bool isReplaced( const Instrument* pInstr ) const;
+
+	/**
+	 * \return Hash of all properties of @a pInstr and @a pSong
+	 * affecting the renders of the instrument. Neither locks nor
+	 * allocates.
+	 */
+	static uint64_t instrumentFingerprint( Instrument* pInstr, Song* pSong );
+	/**
+	 * \return Hash of the length of @a pPattern and all its notes
+	 * of @a pInstr or 0 if there are none. Neither locks nor
+	 * allocates.
+	 */
+	static uint64_t patternFingerprint( const Pattern* pPattern, const Instrument* pInstr );
+
+private:
+	InstrumentFreezer();
+
+	/** Renders of a single instrument.*/
+	struct Entry {
+		int nInstrumentId;
+		/** instrumentFingerprint() at the time of the renders.*/
+		uint64_t nFingerprint;
+		std::vector<std::shared_ptr<const FrozenPattern>> renders;
+		/** Instrument replaced in the current column or nullptr.*/
+		Instrument* pReplaced;
+		/** Indices within #renders queued by startColumn(). Its
+			capacity is reserved up front.*/
+		std::vector<int> queued;
+		/** Set by startColumn() if the renders do not match
+			anymore.*/
+		std::atomic<bool> bStale;
+	};
+
+	/** Renders @a pPattern using @a pDriver, which has to play a
+		song made of the pattern followed by enough empty columns
+		for the tails.*/
+	std::shared_ptr<const FrozenPattern> renderPattern( OfflineDriver* pDriver,
+														Pattern* pPattern,
+														Instrument* pInstr,
+														float fTickSize );
+	/** Removes entry @a nEntry of #m_entries and moves its renders to
+		#m_retired. Has to be called with the engine locked.*/
+	void dropEntry( int nEntry );
+
+	static InstrumentFreezer* __instance;
+
+	/** Only modified by the main thread with the engine
+		locked.*/
+	std::vector<std::unique_ptr<Entry>> m_entries;
+	/** Dropped renders possibly still held by playing notes.*/
+	std::vector<std::shared_ptr<const FrozenPattern>> m_retired;
+	/** Set while freeze() is running the audio engine.*/
+	bool m_bRendering;
+	std::atomic<bool> m_bStale;
+};
+
+inline InstrumentFreezer* InstrumentFreezer::get_instance() {
+	return __instance;
+}
+
+};
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/LatencyProbe.h>
+#include <core/rt_clock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* LatencyProbe::__class_name = "LatencyProbe";
+
+/** Number of histogram bins per octave.*/
+static const int nBinsPerOctave = 8;
+/** Upper bound of the first histogram bin in nanoseconds.*/
+static const double fFirstBinBound = 10000.0;
+
+LatencyProbe::LatencyProbe()
+	: Object( __class_name )
+	, m_nCycleStart( 0 )
+	, m_fNsPerFrame( 0 )
+	, m_nOutputLatency( 0 )
+{
+	reset();
+}
+
+LatencyProbe::~LatencyProbe()
+{
+}
+
+QString LatencyProbe::getSourceName( Source source )
+{
+	switch ( source ) {
+	case SOURCE_ALSA:
+		return "ALSA MIDI";
+	case SOURCE_JACK:
+		return "JACK MIDI";
+	case SOURCE_PORTMIDI:
+		return "PortMidi";
+	case SOURCE_COREMIDI:
+		return "CoreMIDI";
+	case SOURCE_PIPEWIRE:
+		return "PipeWire MIDI";
+	default:
+		return "Unknown";
+	}
+}
+
+LatencyProbe::Source LatencyProbe::getSource( const char* sClassName )
+{
+	if ( sClassName == nullptr ) {
+		return SOURCE_NONE;
+	} else if ( strcmp( sClassName, "AlsaMidiDriver" ) == 0 ) {
+		return SOURCE_ALSA;
+	} else if ( strcmp( sClassName, "JackMidiDriver" ) == 0 ) {
+		return SOURCE_JACK;
+	} else if ( strcmp( sClassName, "PortMidiDriver" ) == 0 ) {
+		return SOURCE_PORTMIDI;
+	} else if ( strcmp( sClassName, "CoreMidiDriver" ) == 0 ) {
+		return SOURCE_COREMIDI;
+	} else if ( strcmp( sClassName, "PipeWireMidiDriver" ) == 0 ) {
+		return SOURCE_PIPEWIRE;
+	}
+	return SOURCE_NONE;
+}
+
+void LatencyProbe::beginCycle( int nSampleRate, int nOutputLatency )
+{
+	m_nCycleStart = rtclock_now_ns();
+	m_fNsPerFrame = nSampleRate > 0 ? 1e9 / nSampleRate : 0;
+	m_nOutputLatency = nOutputLatency;
+}
+
+int LatencyProbe::getBin( int64_t nNanoseconds )
+{
+	if ( nNanoseconds < fFirstBinBound ) {
+		return 0;
+	}
+	int nBin = 1 + static_cast<int>( std::log2( nNanoseconds / fFirstBinBound ) *
+									 nBinsPerOctave );
+	if ( nBin >= LATENCY_PROBE_BINS ) {
+		return LATENCY_PROBE_BINS - 1;
+	}
+	return nBin;
+}
+
+double LatencyProbe::getBinUpperBound( int nBin )
+{
+	return fFirstBinBound * std::exp2( static_cast<double>( nBin ) / nBinsPerOctave );
+}
+
+void LatencyProbe::recordTrigger( int64_t nTimestamp, Source source, int nOffset )
+{
+	if ( source < 0 || source >= SOURCE_COUNT || nTimestamp <= 0 ) {
+		return;
+	}
+
+	int64_t nLatency = m_nCycleStart - nTimestamp +
+		static_cast<int64_t>( ( nOffset + m_nOutputLatency ) * m_fNsPerFrame );
+	if ( nLatency < 0 ) {
+		nLatency = 0;
+	}
+
+	m_histograms[ source ][ getBin( nLatency ) ].fetch_add( 1, std::memory_order_relaxed );
+	int64_t nMax = m_nMax[ source ].load( std::memory_order_relaxed );
+	while ( nLatency > nMax &&
+			! m_nMax[ source ].compare_exchange_weak( nMax, nLatency,
+													  std::memory_order_relaxed ) ) {
+	}
+}
+
+LatencyProbe::Statistics LatencyProbe::getStatistics( Source source ) const
+{
+	Statistics statistics = { 0, 0.0, 0.0, 0.0 };
+	if ( source < 0 || source >= SOURCE_COUNT ) {
+		return statistics;
+	}
+
+	uint32_t histogram[ LATENCY_PROBE_BINS ];
+	long long nTriggers = 0;
+	for ( int nBin = 0; nBin < LATENCY_PROBE_BINS; ++nBin ) {
+		histogram[ nBin ] = m_histograms[ source ][ nBin ].load( std::memory_order_relaxed );
+		nTriggers += histogram[ nBin ];
+	}
+	if ( nTriggers == 0 ) {
+		return statistics;
+	}
+
+	const double fMax = static_cast<double>( m_nMax[ source ].load( std::memory_order_relaxed ) );
+	const long long nMedian = ( nTriggers + 1 ) / 2;
+	const long long nPercentile99 = static_cast<long long>( std::ceil( nTriggers * 0.99 ) );
+
+	double fMedian = fMax;
+	double fPercentile99 = fMax;
+	long long nCount = 0;
+	for ( int nBin = 0; nBin < LATENCY_PROBE_BINS; ++nBin ) {
+		long long nPrevious = nCount;
+		nCount += histogram[ nBin ];
+		if ( nPrevious < nMedian && nCount >= nMedian ) {
+			fMedian = std::min( getBinUpperBound( nBin ), fMax );
+		}
+		if ( nPrevious < nPercentile99 && nCount >= nPercentile99 ) {
+			fPercentile99 = std::min( getBinUpperBound( nBin ), fMax );
+			break;
+		}
+	}
+
+	statistics.nTriggers = nTriggers;
+	statistics.fMedian = fMedian / 1000000.0;
+	statistics.fPercentile99 = fPercentile99 / 1000000.0;
+	statistics.fMax = fMax / 1000000.0;
+	return statistics;
+}
+
+void LatencyProbe::reset()
+{
+	for ( int ii = 0; ii < SOURCE_COUNT; ++ii ) {
+		for ( auto& bin : m_histograms[ ii ] ) {
+			bin.store( 0, std::memory_order_relaxed );
+		}
+		m_nMax[ ii ].store( 0, std::memory_order_relaxed );
+	}
+}
+
+};
@@ -0,0 +1,138 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <core/Object.h>
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+/** Number of bins of the latency histograms of the
+	H2Core::LatencyProbe.*/
+#define LATENCY_PROBE_BINS 144
+
+namespace H2Core
+{
+
+/**
+ * Always-on measurement of the time notes triggered via MIDI take to
+ * become audible.
+ *
+ * The MIDI drivers timestamp each incoming message (see
+ * MidiMessage::m_nTimestamp) and MidiInput passes the time of arrival
+ * and the driver it was received by on to the Note. Once the Sampler
+ * starts rendering the note it calls recordTrigger(), which
+ * accounts the time passed till the beginning of the process cycle
+ * plus the offset of the first frame of the note within the buffer
+ * and the latency of the output buffer. The latency of the audio
+ * hardware and the content of the sample itself are not taken into
+ * account.
+ *
+ * The measurements are sorted into logarithmic histograms - one per
+ * Source - just as the ProcessProfiler does it. A bin spans an eighth
+ * of an octave, so the reported percentiles are accurate to about 9%.
+ * The maximum is tracked exactly.
+ *
+ * recordTrigger() can be called concurrently by the worker threads
+ * of the Sampler. It neither locks nor allocates.
+ */
+class LatencyProbe : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** MIDI driver a note was triggered by.*/
+	enum Source {
+		SOURCE_NONE = -1,
+		SOURCE_ALSA = 0,
+		SOURCE_JACK,
+		SOURCE_PORTMIDI,
+		SOURCE_COREMIDI,
+		SOURCE_PIPEWIRE,
+		SOURCE_COUNT
+	};
+
+	/** Latencies in milliseconds.*/
+	struct Statistics {
+		long long nTriggers;
+		float fMedian;
+		float fPercentile99;
+		float fMax;
+	};
+
+	LatencyProbe();
+	~LatencyProbe();
+
+	/** \return Human readable name of @a source.*/
+	static QString getSourceName( Source source );
+	/** \return Source corresponding to the class name of a MIDI
+		driver or #SOURCE_NONE if it is none known.*/
+	static Source getSource( const char* sClassName );
+
+	/**
+	 * Stores the start time of a process cycle. Realtime thread
+	 * only.
+	 *
+	 * \param nSampleRate Sample rate of the audio driver.
+	 * \param nOutputLatency Latency of the output of the audio
+	 * driver in frames.
+	 */
+	void beginCycle( int nSampleRate, int nOutputLatency );
+	/**
+	 * Accounts a note triggered at @a nTimestamp.
+	 *
+	 * \param nTimestamp Time the note was received, as returned by
+	 * rtclock_now_ns().
+	 * \param source Driver the note was received by.
+	 * \param nOffset Frame within the current buffer the note starts
+	 * at.
+	 */
+	void recordTrigger( int64_t nTimestamp, Source source, int nOffset );
+
+	/** \return Percentiles of all notes received by @a source since
+		the last reset().*/
+	Statistics getStatistics( Source source ) const;
+	/** Discards all latencies measured so far.*/
+	void reset();
+
+private:
+	static int getBin( int64_t nNanoseconds );
+	/** \return Upper bound of @a nBin in nanoseconds.*/
+	static double getBinUpperBound( int nBin );
+
+	/** Written by the realtime thread in beginCycle() and read by
+		the worker threads of the Sampler afterwards.*/
+	int64_t m_nCycleStart;
+	double m_fNsPerFrame;
+	int m_nOutputLatency;
+
+	std::atomic<uint32_t> m_histograms[ SOURCE_COUNT ][ LATENCY_PROBE_BINS ];
+	std::atomic<int64_t> m_nMax[ SOURCE_COUNT ];
+};
+
+};
+
+#endif
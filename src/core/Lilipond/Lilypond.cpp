@@ -21,9 +21,9 @@
  */
 
 #include <core/Lilipond/Lilypond.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/NoteStream.h>
 #include <core/Basics/Song.h>
-#include <core/Basics/PatternList.h>
-#include <core/Basics/Pattern.h>
 
 /*
  * Header of LilyPond file
@@ -63,23 +63,26 @@ H2Core::LilyPond::LilyPond() :
 }
 
 void H2Core::LilyPond::extractData( const Song &song ) {
+	extractData( song, NoteStream( song ) );
+}
+
+void H2Core::LilyPond::extractData( const Song &song, const NoteStream &notes ) {
 	// Retrieve metadata
 	m_sName = song.getName();
 	m_sAuthor = song.getAuthor();
 	m_fBPM = song.getBpm();
 
-	// Get the main information about the music
-	const std::vector<PatternList *> *group = song.getPatternGroupVector();
-	if ( !group ) {
-		m_Measures.clear();
-		return;
+	// Get the main information about the music. A measure is as
+	// long as the longest pattern of its column.
+	const std::vector<NoteStream::Column> &columns = notes.getColumns();
+	m_Measures = std::vector<notes_t>( columns.size() );
+	for ( unsigned nColumn = 0; nColumn < columns.size(); nColumn++ ) {
+		m_Measures[ nColumn ].resize( columns[ nColumn ].nLength );
 	}
-	unsigned nSize = group->size();
-	m_Measures = std::vector<notes_t>( nSize );
-	for ( unsigned nPatternList = 0; nPatternList < nSize; nPatternList++ ) {
-		if ( PatternList *pPatternList = ( *group )[ nPatternList ] ) {
-			addPatternList( *pPatternList, m_Measures[ nPatternList ] );
-		}
+	for ( const auto &entry : notes.getEntries() ) {
+		int nId = entry.pNote->get_instrument_id();
+		float fVelocity = entry.pNote->get_velocity();
+		m_Measures[ entry.nColumn ][ entry.nPosition ].push_back( std::make_pair( nId, fVelocity ) );
 	}
 }
 
@@ -112,36 +115,6 @@ void H2Core::LilyPond::write( const QString &sFilename ) const {
 	file << "}\n";
 }
 
-void H2Core::LilyPond::addPatternList( const PatternList &list, notes_t &to ) {
-	to.clear();
-	for ( unsigned nPattern = 0; nPattern < list.size(); nPattern++ ) {
-		if ( const Pattern *pPattern = list.get( nPattern ) ) {
-			addPattern( *pPattern, to );
-		}
-	}
-}
-
-void H2Core::LilyPond::addPattern( const Pattern &pattern, notes_t &notes ) {
-	notes.reserve( pattern.get_length() );
-	for ( unsigned nNote = 0; nNote < pattern.get_length(); nNote++ ) {
-		if ( nNote >= notes.size() ) {
-			notes.push_back( std::vector<std::pair<int, float> >() );
-		}
-
-		const Pattern::notes_t *pPatternNotes = pattern.get_notes();
-		if ( !pPatternNotes ) {
-			continue;
-		}
-		FOREACH_NOTE_CST_IT_BOUND( pPatternNotes, it, nNote ) {
-			if ( Note *pNote = it->second ) {
-				int nId = pNote->get_instrument_id();
-				float fVelocity = pNote->get_velocity();
-				notes[ nNote ].push_back( std::make_pair( nId, fVelocity ) );
-			}
-		}
-	}
-}
-
 void H2Core::LilyPond::writeMeasures( std::ofstream &stream ) const {
 	unsigned nSignature = 0; ///< Numerator of the time signature
 	for ( unsigned nMeasure = 0; nMeasure < m_Measures.size(); nMeasure++ ) {
@@ -31,8 +31,7 @@
 
 namespace H2Core {
 
-class Pattern;
-class PatternList;
+class NoteStream;
 class Song;
 
 /// A class to convert a Hydrogen song to LilyPond format
@@ -46,6 +45,13 @@ public:
 	 */
 	void extractData( const Song &song );
 
+	/*
+	 * Retrieve all needed data from the notes of an Hydrogen song
+	 * @param song  the Hydrogen song to convert
+	 * @param notes the notes gathered from the song
+	 */
+	void extractData( const Song &song, const NoteStream &notes );
+
 	/*
 	 * Write the LilyPond format into a file
 	 * @param sFilename name of output file
@@ -62,20 +68,6 @@ private:
 	 */
 	typedef std::vector<std::vector<std::pair<int, float> > > notes_t;
 
-	/*
-	 * Retrieve the information in a PatternList
-	 * @param list  the PatternList where the information is
-	 * @param notes where to store the information to
-	 */
-	static void addPatternList( const PatternList &list, notes_t &notes );
-
-	/*
-	 * Retrieve the information in a Pattern
-	 * @param pattern the Pattern where the information is
-	 * @param notes   where to store the information to
-	 */
-	static void addPattern( const Pattern &pattern, notes_t &notes );
-
 	/// Write measures in LilyPond format to stream
 	void writeMeasures( std::ofstream &stream ) const;
 
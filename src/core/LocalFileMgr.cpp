@@ -40,6 +40,7 @@
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/Sample.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Helpers/Xml.h>
 #include <core/AutomationPathSerializer.h>
 #include <core/FX/Effects.h>
 
@@ -50,6 +51,7 @@
 #include <sys/stat.h>
 
 #include <QDir>
+#include <QSaveFile>
 //#include <QCoreApplication>
 #include <QVector>
 #include <QDomDocument>
@@ -342,34 +344,49 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 	}
 	
 	INFOLOG( "Saving song " + filename );
-	int rv = 0; // return value
+	int rv = writeFile( serialize( pSong ), filename ) ? 0 : 1;
 
+	if( rv ) {
+		WARNINGLOG("File save reported an error.");
+	} else {
+		pSong->setIsModified( false );
+		INFOLOG("Save was successful.");
+	}
+
+	pSong->setFilename( filename );
+	if ( rv == 0 ) {
+		pSong->updateFileStamp();
+	}
+
+	return rv;
+}
+
+QByteArray SongWriter::serialize( Song* pSong )
+{
 	// ???
 	// FIXME: verificare che il file non sia gia' esistente
 	// FIXME: effettuare copia di backup per il file gia' esistente
 	// ???
 
 
-	QDomDocument doc;
-	QDomProcessingInstruction header = doc.createProcessingInstruction( "xml", "version=\"1.0\" encoding=\"UTF-8\"");
-	doc.appendChild( header );
-
-	QDomNode songNode = doc.createElement( "song" );
-
-	LocalFileMng::writeXmlString( songNode, "version", QString( get_version().c_str() ) );
-	LocalFileMng::writeXmlString( songNode, "bpm", QString("%1").arg( pSong->getBpm() ) );
-	LocalFileMng::writeXmlString( songNode, "volume", QString("%1").arg( pSong->getVolume() ) );
-	LocalFileMng::writeXmlString( songNode, "metronomeVolume", QString("%1").arg( pSong->getMetronomeVolume() ) );
-	LocalFileMng::writeXmlString( songNode, "name", pSong->getName() );
-	LocalFileMng::writeXmlString( songNode, "author", pSong->getAuthor() );
-	LocalFileMng::writeXmlString( songNode, "notes", pSong->getNotes() );
-	LocalFileMng::writeXmlString( songNode, "license", pSong->getLicense() );
-	LocalFileMng::writeXmlBool( songNode, "loopEnabled", pSong->getIsLoopEnabled() );
-	LocalFileMng::writeXmlBool( songNode, "patternModeMode", Preferences::get_instance()->patternModePlaysSelected());
+	XMLWriter writer;
+	writer.start_element( "song" );
+
+	writer.write_string( "version", QString( get_version().c_str() ) );
+	writer.write_string( "bpm", QString("%1").arg( pSong->getBpm() ) );
+	writer.write_string( "volume", QString("%1").arg( pSong->getVolume() ) );
+	writer.write_string( "metronomeVolume", QString("%1").arg( pSong->getMetronomeVolume() ) );
+	writer.write_string( "name", pSong->getName() );
+	writer.write_string( "author", pSong->getAuthor() );
+	writer.write_string( "notes", pSong->getNotes() );
+	writer.write_string( "license", pSong->getLicense() );
+	writer.write_bool( "loopEnabled", pSong->getIsLoopEnabled() );
+	writer.write_bool( "patternModeMode", Preferences::get_instance()->patternModePlaysSelected());
 	
-	LocalFileMng::writeXmlString( songNode, "playbackTrackFilename", QString("%1").arg( pSong->getPlaybackTrackFilename() ) );
-	LocalFileMng::writeXmlBool( songNode, "playbackTrackEnabled", pSong->getPlaybackTrackEnabled() );
-	LocalFileMng::writeXmlString( songNode, "playbackTrackVolume", QString("%1").arg( pSong->getPlaybackTrackVolume() ) );
+	writer.write_string( "playbackTrackFilename", QString("%1").arg( pSong->getPlaybackTrackFilename() ) );
+	writer.write_bool( "playbackTrackEnabled", pSong->getPlaybackTrackEnabled() );
+	writer.write_string( "playbackTrackVolume", QString("%1").arg( pSong->getPlaybackTrackVolume() ) );
+	writer.write_string( "playbackTrackBpm", QString("%1").arg( pSong->getPlaybackTrackBpm() ) );
 
 	int nActionMode = 0;
 	if ( pSong->getActionMode() == Song::ActionMode::selectMode ) {
@@ -377,13 +394,13 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 	} else if ( pSong->getActionMode() == Song::ActionMode::drawMode ) {
 		nActionMode = 1;
 	}
-	LocalFileMng::writeXmlString( songNode, "action_mode",
+	writer.write_string( "action_mode",
 								  QString::number( nActionMode ) );
 	
 	if ( pSong->getMode() == Song::SONG_MODE ) {
-		LocalFileMng::writeXmlString( songNode, "mode", QString( "song" ) );
+		writer.write_string( "mode", QString( "song" ) );
 	} else {
-		LocalFileMng::writeXmlString( songNode, "mode", QString( "pattern" ) );
+		writer.write_string( "mode", QString( "pattern" ) );
 	}
 
 	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
@@ -427,30 +444,31 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 		sPanLawType = "RATIO_STRAIGHT_POLYGONAL";
 	}
 	// write the pan law string in file
-	LocalFileMng::writeXmlString( songNode, "pan_law_type", sPanLawType );
-	LocalFileMng::writeXmlString( songNode, "pan_law_k_norm", QString("%1").arg( pSong->getPanLawKNorm() ) );
+	writer.write_string( "pan_law_type", sPanLawType );
+	writer.write_string( "pan_law_k_norm", QString("%1").arg( pSong->getPanLawKNorm() ) );
 
-	LocalFileMng::writeXmlString( songNode, "humanize_time", QString("%1").arg( pSong->getHumanizeTimeValue() ) );
-	LocalFileMng::writeXmlString( songNode, "humanize_velocity", QString("%1").arg( pSong->getHumanizeVelocityValue() ) );
-	LocalFileMng::writeXmlString( songNode, "swing_factor", QString("%1").arg( pSong->getSwingFactor() ) );
+	writer.write_string( "humanize_time", QString("%1").arg( pSong->getHumanizeTimeValue() ) );
+	writer.write_string( "humanize_velocity", QString("%1").arg( pSong->getHumanizeVelocityValue() ) );
+	writer.write_string( "random_seed", QString("%1").arg( pSong->getRandomSeed() ) );
+	writer.write_string( "swing_factor", QString("%1").arg( pSong->getSwingFactor() ) );
 
 	// component List
-	QDomNode componentListNode = doc.createElement( "componentList" );
+	writer.start_element( "componentList" );
 	for (std::vector<DrumkitComponent*>::iterator it = pSong->getComponents()->begin() ; it != pSong->getComponents()->end(); ++it) {
 		DrumkitComponent* pCompo = *it;
 
-		QDomNode componentNode = doc.createElement( "drumkitComponent" );
+		writer.start_element( "drumkitComponent" );
 
-		LocalFileMng::writeXmlString( componentNode, "id", QString("%1").arg( pCompo->get_id() ) );
-		LocalFileMng::writeXmlString( componentNode, "name", pCompo->get_name() );
-		LocalFileMng::writeXmlString( componentNode, "volume", QString("%1").arg( pCompo->get_volume() ) );
+		writer.write_string( "id", QString("%1").arg( pCompo->get_id() ) );
+		writer.write_string( "name", pCompo->get_name() );
+		writer.write_string( "volume", QString("%1").arg( pCompo->get_volume() ) );
 
-		componentListNode.appendChild( componentNode );
+		writer.end_element();
 	}
-	songNode.appendChild( componentListNode );
+	writer.end_element();
 
 	// instrument list
-	QDomNode instrumentListNode = doc.createElement( "instrumentList" );
+	writer.start_element( "instrumentList" );
 	unsigned nInstrument = pSong->getInstrumentList()->size();
 
 	// INSTRUMENT NODE
@@ -458,64 +476,66 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 		Instrument * pInstr = pSong->getInstrumentList()->get( i );
 		assert( pInstr );
 
-		QDomNode instrumentNode = doc.createElement( "instrument" );
-
-		LocalFileMng::writeXmlString( instrumentNode, "id", QString("%1").arg( pInstr->get_id() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "name", pInstr->get_name() );
-		LocalFileMng::writeXmlString( instrumentNode, "drumkit", pInstr->get_drumkit_name() );
-		LocalFileMng::writeXmlString( instrumentNode, "drumkitLookup", QString::number(static_cast<int>( Hydrogen::get_instance()->getCurrentDrumkitLookup() )) );
-		LocalFileMng::writeXmlString( instrumentNode, "volume", QString("%1").arg( pInstr->get_volume() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "isMuted", pInstr->is_muted() );
-		LocalFileMng::writeXmlBool( instrumentNode, "isSoloed", pInstr->is_soloed() );
-		LocalFileMng::writeXmlString( instrumentNode, "pan_L", QString("%1").arg( pInstr->get_pan_l() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "pan_R", QString("%1").arg( pInstr->get_pan_r() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "gain", QString("%1").arg( pInstr->get_gain() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "applyVelocity", pInstr->get_apply_velocity() );
-
-		LocalFileMng::writeXmlBool( instrumentNode, "filterActive", pInstr->is_filter_active() );
-		LocalFileMng::writeXmlString( instrumentNode, "filterCutoff", QString("%1").arg( pInstr->get_filter_cutoff() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "filterResonance", QString("%1").arg( pInstr->get_filter_resonance() ) );
-
-		LocalFileMng::writeXmlString( instrumentNode, "FX1Level", QString("%1").arg( pInstr->get_fx_level( 0 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX2Level", QString("%1").arg( pInstr->get_fx_level( 1 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX3Level", QString("%1").arg( pInstr->get_fx_level( 2 ) ) );
-		LocalFileMng::writeXmlString( instrumentNode, "FX4Level", QString("%1").arg( pInstr->get_fx_level( 3 ) ) );
+		writer.start_element( "instrument" );
+
+		writer.write_string( "id", QString("%1").arg( pInstr->get_id() ) );
+		writer.write_string( "name", pInstr->get_name() );
+		writer.write_string( "drumkit", pInstr->get_drumkit_name() );
+		writer.write_string( "drumkitLookup", QString::number(static_cast<int>( Hydrogen::get_instance()->getCurrentDrumkitLookup() )) );
+		writer.write_string( "volume", QString("%1").arg( pInstr->get_volume() ) );
+		writer.write_bool( "isMuted", pInstr->is_muted() );
+		writer.write_bool( "isSoloed", pInstr->is_soloed() );
+		writer.write_string( "pan_L", QString("%1").arg( pInstr->get_pan_l() ) );
+		writer.write_string( "pan_R", QString("%1").arg( pInstr->get_pan_r() ) );
+		writer.write_string( "gain", QString("%1").arg( pInstr->get_gain() ) );
+		writer.write_bool( "applyVelocity", pInstr->get_apply_velocity() );
+
+		writer.write_bool( "filterActive", pInstr->is_filter_active() );
+		writer.write_string( "filterCutoff", QString("%1").arg( pInstr->get_filter_cutoff() ) );
+		writer.write_string( "filterResonance", QString("%1").arg( pInstr->get_filter_resonance() ) );
+
+		writer.write_string( "FX1Level", QString("%1").arg( pInstr->get_fx_level( 0 ) ) );
+		writer.write_string( "FX2Level", QString("%1").arg( pInstr->get_fx_level( 1 ) ) );
+		writer.write_string( "FX3Level", QString("%1").arg( pInstr->get_fx_level( 2 ) ) );
+		writer.write_string( "FX4Level", QString("%1").arg( pInstr->get_fx_level( 3 ) ) );
 
 		assert( pInstr->get_adsr() );
-		LocalFileMng::writeXmlString( instrumentNode, "Attack", QString("%1").arg( pInstr->get_adsr()->get_attack() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Decay", QString("%1").arg( pInstr->get_adsr()->get_decay() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Sustain", QString("%1").arg( pInstr->get_adsr()->get_sustain() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "Release", QString("%1").arg( pInstr->get_adsr()->get_release() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "pitchOffset", QString("%1").arg( pInstr->get_pitch_offset() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "randomPitchFactor", QString("%1").arg( pInstr->get_random_pitch_factor() ) );
-
-		LocalFileMng::writeXmlString( instrumentNode, "muteGroup", QString("%1").arg( pInstr->get_mute_group() ) );
-		LocalFileMng::writeXmlBool( instrumentNode, "isStopNote", pInstr->is_stop_notes() );
+		writer.write_string( "Attack", QString("%1").arg( pInstr->get_adsr()->get_attack() ) );
+		writer.write_string( "Decay", QString("%1").arg( pInstr->get_adsr()->get_decay() ) );
+		writer.write_string( "Sustain", QString("%1").arg( pInstr->get_adsr()->get_sustain() ) );
+		writer.write_string( "Release", QString("%1").arg( pInstr->get_adsr()->get_release() ) );
+		writer.write_string( "pitchOffset", QString("%1").arg( pInstr->get_pitch_offset() ) );
+		writer.write_string( "randomPitchFactor", QString("%1").arg( pInstr->get_random_pitch_factor() ) );
+
+		writer.write_string( "muteGroup", QString("%1").arg( pInstr->get_mute_group() ) );
+		writer.write_bool( "isStopNote", pInstr->is_stop_notes() );
 		switch ( pInstr->sample_selection_alg() ) {
 			case Instrument::VELOCITY:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "VELOCITY" );
+				writer.write_string( "sampleSelectionAlgo", "VELOCITY" );
 				break;
 			case Instrument::RANDOM:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "RANDOM" );
+				writer.write_string( "sampleSelectionAlgo", "RANDOM" );
 				break;
 			case Instrument::ROUND_ROBIN:
-				LocalFileMng::writeXmlString( instrumentNode, "sampleSelectionAlgo", "ROUND_ROBIN" );
+				writer.write_string( "sampleSelectionAlgo", "ROUND_ROBIN" );
 				break;
 		}
 
-		LocalFileMng::writeXmlString( instrumentNode, "midiOutChannel", QString("%1").arg( pInstr->get_midi_out_channel() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "midiOutNote", QString("%1").arg( pInstr->get_midi_out_note() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "isHihat", QString("%1").arg( pInstr->get_hihat_grp() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "lower_cc", QString("%1").arg( pInstr->get_lower_cc() ) );
-		LocalFileMng::writeXmlString( instrumentNode, "higher_cc", QString("%1").arg( pInstr->get_higher_cc() ) );
+		writer.write_string( "midiOutChannel", QString("%1").arg( pInstr->get_midi_out_channel() ) );
+		writer.write_string( "midiOutNote", QString("%1").arg( pInstr->get_midi_out_note() ) );
+		writer.write_string( "isHihat", QString("%1").arg( pInstr->get_hihat_grp() ) );
+		writer.write_string( "lower_cc", QString("%1").arg( pInstr->get_lower_cc() ) );
+		writer.write_string( "higher_cc", QString("%1").arg( pInstr->get_higher_cc() ) );
+		writer.write_string( "outputBus", pInstr->get_output_bus() );
+		writer.write_bool( "sincInterpolation", pInstr->get_sinc_interpolation() );
 
 		for (std::vector<InstrumentComponent*>::iterator it = pInstr->get_components()->begin() ; it != pInstr->get_components()->end(); ++it) {
 			InstrumentComponent* pComponent = *it;
 
-			QDomNode componentNode = doc.createElement( "instrumentComponent" );
+			writer.start_element( "instrumentComponent" );
 
-			LocalFileMng::writeXmlString( componentNode, "component_id", QString("%1").arg( pComponent->get_drumkit_componentID() ) );
-			LocalFileMng::writeXmlString( componentNode, "gain", QString("%1").arg( pComponent->get_gain() ) );
+			writer.write_string( "component_id", QString("%1").arg( pComponent->get_drumkit_componentID() ) );
+			writer.write_string( "gain", QString("%1").arg( pComponent->get_gain() ) );
 
 			for ( unsigned nLayer = 0; nLayer < InstrumentComponent::getMaxLayers(); nLayer++ ) {
 				InstrumentLayer *pLayer = pComponent->get_layer( nLayer );
@@ -534,159 +554,159 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 				QString sMode = pSample->get_loop_mode_string();
 
 				
-				QDomNode layerNode = doc.createElement( "layer" );
-				LocalFileMng::writeXmlString( layerNode, "filename", Filesystem::prepare_sample_path( pSample->get_filepath() ) );
-				LocalFileMng::writeXmlBool( layerNode, "ismodified", sIsModified);
-				LocalFileMng::writeXmlString( layerNode, "smode", pSample->get_loop_mode_string() );
-				LocalFileMng::writeXmlString( layerNode, "startframe", QString("%1").arg( lo.start_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "loopframe", QString("%1").arg( lo.loop_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "loops", QString("%1").arg( lo.count ) );
-				LocalFileMng::writeXmlString( layerNode, "endframe", QString("%1").arg( lo.end_frame ) );
-				LocalFileMng::writeXmlString( layerNode, "userubber", QString("%1").arg( ro.use ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberdivider", QString("%1").arg( ro.divider ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberCsettings", QString("%1").arg( ro.c_settings ) );
-				LocalFileMng::writeXmlString( layerNode, "rubberPitch", QString("%1").arg( ro.pitch ) );
-				LocalFileMng::writeXmlString( layerNode, "min", QString("%1").arg( pLayer->get_start_velocity() ) );
-				LocalFileMng::writeXmlString( layerNode, "max", QString("%1").arg( pLayer->get_end_velocity() ) );
-				LocalFileMng::writeXmlString( layerNode, "gain", QString("%1").arg( pLayer->get_gain() ) );
-				LocalFileMng::writeXmlString( layerNode, "pitch", QString("%1").arg( pLayer->get_pitch() ) );
+				writer.start_element( "layer" );
+				writer.write_string( "filename", Filesystem::prepare_sample_path( pSample->get_filepath() ) );
+				writer.write_bool( "ismodified", sIsModified);
+				writer.write_string( "smode", pSample->get_loop_mode_string() );
+				writer.write_string( "startframe", QString("%1").arg( lo.start_frame ) );
+				writer.write_string( "loopframe", QString("%1").arg( lo.loop_frame ) );
+				writer.write_string( "loops", QString("%1").arg( lo.count ) );
+				writer.write_string( "endframe", QString("%1").arg( lo.end_frame ) );
+				writer.write_string( "userubber", QString("%1").arg( ro.use ) );
+				writer.write_string( "rubberdivider", QString("%1").arg( ro.divider ) );
+				writer.write_string( "rubberCsettings", QString("%1").arg( ro.c_settings ) );
+				writer.write_string( "rubberPitch", QString("%1").arg( ro.pitch ) );
+				writer.write_string( "min", QString("%1").arg( pLayer->get_start_velocity() ) );
+				writer.write_string( "max", QString("%1").arg( pLayer->get_end_velocity() ) );
+				writer.write_string( "gain", QString("%1").arg( pLayer->get_gain() ) );
+				writer.write_string( "pitch", QString("%1").arg( pLayer->get_pitch() ) );
 
 
 				Sample::VelocityEnvelope* velocity = pSample->get_velocity_envelope();
 				for (int y = 0; y < velocity->size(); y++){
-					QDomNode volumeNode = doc.createElement( "volume" );
-					LocalFileMng::writeXmlString( volumeNode, "volume-position", QString("%1").arg( velocity->at(y)->frame ) );
-					LocalFileMng::writeXmlString( volumeNode, "volume-value", QString("%1").arg( velocity->at(y)->value ) );
-					layerNode.appendChild( volumeNode );
+					writer.start_element( "volume" );
+					writer.write_string( "volume-position", QString("%1").arg( velocity->at(y)->frame ) );
+					writer.write_string( "volume-value", QString("%1").arg( velocity->at(y)->value ) );
+					writer.end_element();
 				}
 
 				Sample::PanEnvelope* pan = pSample->get_pan_envelope();
 				for (int y = 0; y < pan->size(); y++){
-					QDomNode panNode = doc.createElement( "pan" );
-					LocalFileMng::writeXmlString( panNode, "pan-position", QString("%1").arg( pan->at(y)->frame ) );
-					LocalFileMng::writeXmlString( panNode, "pan-value", QString("%1").arg( pan->at(y)->value ) );
-					layerNode.appendChild( panNode );
+					writer.start_element( "pan" );
+					writer.write_string( "pan-position", QString("%1").arg( pan->at(y)->frame ) );
+					writer.write_string( "pan-value", QString("%1").arg( pan->at(y)->value ) );
+					writer.end_element();
 				}
 
-				componentNode.appendChild( layerNode );
+				writer.end_element();
 			}
-			instrumentNode.appendChild( componentNode );
+			writer.end_element();
 		}
 
-		instrumentListNode.appendChild( instrumentNode );
+		writer.end_element();
 	}
-	songNode.appendChild( instrumentListNode );
+	writer.end_element();
 
 
 	// pattern list
-	QDomNode patternListNode = doc.createElement( "patternList" );
+	writer.start_element( "patternList" );
 
 	unsigned nPatterns = pSong->getPatternList()->size();
 	for ( unsigned i = 0; i < nPatterns; i++ ) {
 		const Pattern *pPattern = pSong->getPatternList()->get( i );
 
 		// pattern
-		QDomNode patternNode = doc.createElement( "pattern" );
-		LocalFileMng::writeXmlString( patternNode, "name", pPattern->get_name() );
-		LocalFileMng::writeXmlString( patternNode, "category", pPattern->get_category() );
-		LocalFileMng::writeXmlString( patternNode, "size", QString("%1").arg( pPattern->get_length() ) );
-		LocalFileMng::writeXmlString( patternNode, "denominator", QString("%1").arg( pPattern->get_denominator() ) );
-		LocalFileMng::writeXmlString( patternNode, "info", pPattern->get_info() );
-
-		QDomNode noteListNode = doc.createElement( "noteList" );
+		writer.start_element( "pattern" );
+		writer.write_string( "name", pPattern->get_name() );
+		writer.write_string( "category", pPattern->get_category() );
+		writer.write_string( "size", QString("%1").arg( pPattern->get_length() ) );
+		writer.write_string( "denominator", QString("%1").arg( pPattern->get_denominator() ) );
+		writer.write_string( "info", pPattern->get_info() );
+
+		writer.start_element( "noteList" );
 		const Pattern::notes_t* notes = pPattern->get_notes();
 		FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
 			Note *pNote = it->second;
 			assert( pNote );
 
-			QDomNode noteNode = doc.createElement( "note" );
-			LocalFileMng::writeXmlString( noteNode, "position", QString("%1").arg( pNote->get_position() ) );
-			LocalFileMng::writeXmlString( noteNode, "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
-			LocalFileMng::writeXmlString( noteNode, "velocity", QString("%1").arg( pNote->get_velocity() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
-			LocalFileMng::writeXmlString( noteNode, "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
-			LocalFileMng::writeXmlString( noteNode, "pitch", QString("%1").arg( pNote->get_pitch() ) );
-			LocalFileMng::writeXmlString( noteNode, "probability", QString("%1").arg( pNote->get_probability() ) );
+			writer.start_element( "note" );
+			writer.write_string( "position", QString("%1").arg( pNote->get_position() ) );
+			writer.write_string( "leadlag", QString("%1").arg( pNote->get_lead_lag() ) );
+			writer.write_string( "velocity", QString("%1").arg( pNote->get_velocity() ) );
+			writer.write_string( "pan_L", QString("%1").arg( pNote->get_pan_l() ) );
+			writer.write_string( "pan_R", QString("%1").arg( pNote->get_pan_r() ) );
+			writer.write_string( "pitch", QString("%1").arg( pNote->get_pitch() ) );
+			writer.write_string( "probability", QString("%1").arg( pNote->get_probability() ) );
 
-			LocalFileMng::writeXmlString( noteNode, "key", pNote->key_to_string() );
+			writer.write_string( "key", pNote->key_to_string() );
 
-			LocalFileMng::writeXmlString( noteNode, "length", QString("%1").arg( pNote->get_length() ) );
-			LocalFileMng::writeXmlString( noteNode, "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
+			writer.write_string( "length", QString("%1").arg( pNote->get_length() ) );
+			writer.write_string( "instrument", QString("%1").arg( pNote->get_instrument()->get_id() ) );
 
 			QString noteoff = "false";
 			if ( pNote->get_note_off() ) noteoff = "true";
-			LocalFileMng::writeXmlString( noteNode, "note_off", noteoff );
-			noteListNode.appendChild( noteNode );
+			writer.write_string( "note_off", noteoff );
+			writer.end_element();
 
 		}
-		patternNode.appendChild( noteListNode );
+		writer.end_element();
 
-		patternListNode.appendChild( patternNode );
+		writer.end_element();
 	}
-	songNode.appendChild( patternListNode );
+	writer.end_element();
 
-	QDomNode virtualPatternListNode = doc.createElement( "virtualPatternList" );
+	writer.start_element( "virtualPatternList" );
 	for ( unsigned i = 0; i < nPatterns; i++ ) {
 		const Pattern *pat = pSong->getPatternList()->get( i );
 
 		// pattern
 		if (pat->get_virtual_patterns()->empty() == false) {
-			QDomNode patternNode = doc.createElement( "pattern" );
-			LocalFileMng::writeXmlString( patternNode, "name", pat->get_name() );
+			writer.start_element( "pattern" );
+			writer.write_string( "name", pat->get_name() );
 
 			for (Pattern::virtual_patterns_it_t  virtIter = pat->get_virtual_patterns()->begin(); virtIter != pat->get_virtual_patterns()->end(); ++virtIter) {
-				LocalFileMng::writeXmlString( patternNode, "virtual", (*virtIter)->get_name() );
+				writer.write_string( "virtual", (*virtIter)->get_name() );
 			}//for
 
-			virtualPatternListNode.appendChild( patternNode );
+			writer.end_element();
 		}//if
 	}//for
-	songNode.appendChild(virtualPatternListNode);
+	writer.end_element();
 
 	// pattern sequence
-	QDomNode patternSequenceNode = doc.createElement( "patternSequence" );
+	writer.start_element( "patternSequence" );
 
 	unsigned nPatternGroups = pSong->getPatternGroupVector()->size();
 	for ( unsigned i = 0; i < nPatternGroups; i++ ) {
-		QDomNode groupNode = doc.createElement( "group" );
+		writer.start_element( "group" );
 
 		PatternList *pList = ( *pSong->getPatternGroupVector() )[i];
 		for ( unsigned j = 0; j < pList->size(); j++ ) {
 			const Pattern *pPattern = pList->get( j );
-			LocalFileMng::writeXmlString( groupNode, "patternID", pPattern->get_name() );
+			writer.write_string( "patternID", pPattern->get_name() );
 		}
-		patternSequenceNode.appendChild( groupNode );
+		writer.end_element();
 	}
 
-	songNode.appendChild( patternSequenceNode );
+	writer.end_element();
 
 
 	// LADSPA FX
-	QDomNode ladspaFxNode = doc.createElement( "ladspa" );
+	writer.start_element( "ladspa" );
 
 	for ( unsigned nFX = 0; nFX < MAX_FX; nFX++ ) {
-		QDomNode fxNode = doc.createElement( "fx" );
+		writer.start_element( "fx" );
 
 #ifdef H2CORE_HAVE_LADSPA
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX ) {
-			LocalFileMng::writeXmlString( fxNode, "name", pFX->getPluginLabel() );
-			LocalFileMng::writeXmlString( fxNode, "filename", pFX->getLibraryPath() );
-			LocalFileMng::writeXmlBool( fxNode, "enabled", pFX->isEnabled() );
-			LocalFileMng::writeXmlString( fxNode, "volume", QString("%1").arg( pFX->getVolume() ) );
+			writer.write_string( "name", pFX->getPluginLabel() );
+			writer.write_string( "filename", pFX->getLibraryPath() );
+			writer.write_bool( "enabled", pFX->isEnabled() );
+			writer.write_string( "volume", QString("%1").arg( pFX->getVolume() ) );
 			for ( unsigned nControl = 0; nControl < pFX->inputControlPorts.size(); nControl++ ) {
 				LadspaControlPort *pControlPort = pFX->inputControlPorts[ nControl ];
-				QDomNode controlPortNode = doc.createElement( "inputControlPort" );
-				LocalFileMng::writeXmlString( controlPortNode, "name", pControlPort->sName );
-				LocalFileMng::writeXmlString( controlPortNode, "value", QString("%1").arg( pControlPort->fControlValue ) );
-				fxNode.appendChild( controlPortNode );
+				writer.start_element( "inputControlPort" );
+				writer.write_string( "name", pControlPort->sName );
+				writer.write_string( "value", QString("%1").arg( pControlPort->fControlValue ) );
+				writer.end_element();
 			}
 			for ( unsigned nControl = 0; nControl < pFX->outputControlPorts.size(); nControl++ ) {
 				LadspaControlPort *pControlPort = pFX->inputControlPorts[ nControl ];
-				QDomNode controlPortNode = doc.createElement( "outputControlPort" );
-				LocalFileMng::writeXmlString( controlPortNode, "name", pControlPort->sName );
-				LocalFileMng::writeXmlString( controlPortNode, "value", QString("%1").arg( pControlPort->fControlValue ) );
-				fxNode.appendChild( controlPortNode );
+				writer.start_element( "outputControlPort" );
+				writer.write_string( "name", pControlPort->sName );
+				writer.write_string( "value", QString("%1").arg( pControlPort->fControlValue ) );
+				writer.end_element();
 			}
 		}
 #else
@@ -694,88 +714,100 @@ int SongWriter::writeSong( Song * pSong, const QString& filename )
 		}
 #endif
 		else {
-			LocalFileMng::writeXmlString( fxNode, "name", QString( "no plugin" ) );
-			LocalFileMng::writeXmlString( fxNode, "filename", QString( "-" ) );
-			LocalFileMng::writeXmlBool( fxNode, "enabled", false );
-			LocalFileMng::writeXmlString( fxNode, "volume", "0.0" );
+			writer.write_string( "name", QString( "no plugin" ) );
+			writer.write_string( "filename", QString( "-" ) );
+			writer.write_bool( "enabled", false );
+			writer.write_string( "volume", "0.0" );
 		}
-		ladspaFxNode.appendChild( fxNode );
+		writer.end_element();
 	}
 
-	songNode.appendChild( ladspaFxNode );
-	doc.appendChild( songNode );
+	writer.end_element();
 
 
 	//bpm time line
 	Timeline * pTimeline = Hydrogen::get_instance()->getTimeline();
 
-	QDomNode bpmTimeLine = doc.createElement( "BPMTimeLine" );
+	writer.start_element( "BPMTimeLine" );
 
 	auto tempoMarkerVector = pTimeline->getAllTempoMarkers();
 	
 	if ( tempoMarkerVector.size() >= 1 ){
 		for ( int t = 0; t < static_cast<int>(tempoMarkerVector.size()); t++){
-			QDomNode newBPMNode = doc.createElement( "newBPM" );
-			LocalFileMng::writeXmlString( newBPMNode, "BAR",QString("%1").arg( tempoMarkerVector[t]->nBar ));
-			LocalFileMng::writeXmlString( newBPMNode, "BPM", QString("%1").arg( tempoMarkerVector[t]->fBpm  ) );
-			bpmTimeLine.appendChild( newBPMNode );
+			writer.start_element( "newBPM" );
+			writer.write_string( "BAR",QString("%1").arg( tempoMarkerVector[t]->nBar ));
+			writer.write_string( "BPM", QString("%1").arg( tempoMarkerVector[t]->fBpm  ) );
+			if ( tempoMarkerVector[t]->bRamp ) {
+				writer.write_bool( "ramp", true );
+			}
+			writer.end_element();
 		}
 	}
-	songNode.appendChild( bpmTimeLine );
+	writer.end_element();
 
 	//time line tag
-	QDomNode timeLineTag = doc.createElement( "timeLineTag" );
+	writer.start_element( "timeLineTag" );
 
 	auto tagVector = pTimeline->getAllTags();
 	
 	if ( tagVector.size() >= 1 ){
 		for ( int t = 0; t < static_cast<int>(tagVector.size()); t++){
-			QDomNode newTAGNode = doc.createElement( "newTAG" );
-			LocalFileMng::writeXmlString( newTAGNode, "BAR",QString("%1").arg( tagVector[t]->nBar ));
-			LocalFileMng::writeXmlString( newTAGNode, "TAG", QString("%1").arg( tagVector[t]->sTag ) );
-			timeLineTag.appendChild( newTAGNode );
+			writer.start_element( "newTAG" );
+			writer.write_string( "BAR",QString("%1").arg( tagVector[t]->nBar ));
+			writer.write_string( "TAG", QString("%1").arg( tagVector[t]->sTag ) );
+			writer.end_element();
 		}
 	}
-	songNode.appendChild( timeLineTag );
+	writer.end_element();
 
 	// Automation Paths
-	QDomNode automationPathsTag = doc.createElement( "automationPaths" );
+	writer.start_element( "automationPaths" );
 	AutomationPath *pPath = pSong->getVelocityAutomationPath();
 	if (pPath) {
-		QDomElement pathNode = doc.createElement("path");
-		pathNode.setAttribute("adjust", "velocity");
+		writer.start_element( "path" );
+		writer.write_attribute( "adjust", "velocity" );
 
 		AutomationPathSerializer serializer;
-		serializer.write_automation_path(pathNode, *pPath);
+		serializer.write_automation_path( writer, *pPath );
 
-		automationPathsTag.appendChild(pathNode);
+		writer.end_element();
 	}
-	songNode.appendChild( automationPathsTag );
+	writer.end_element();
 
-	QFile file(filename);
-	if ( !file.open(QIODevice::WriteOnly) ) {
-		rv = 1;
-	}
+	// song
+	writer.end_element();
 
-	QTextStream TextStream( &file );
-	doc.save( TextStream, 1 );
+	return writer.finish();
+}
 
-	if( file.size() == 0) {
-		rv = 1;
+bool SongWriter::writeFile( const QByteArray& content, const QString& filename )
+{
+	// The content is written into a temporary file, which replaces
+	// the target once it is complete and flushed to disk. This way an
+	// interrupted save does not destroy the previous version.
+	QSaveFile file( filename );
+	file.setDirectWriteFallback( true );
+	if ( ! file.open( QIODevice::WriteOnly ) ) {
+		_ERRORLOG( QString( "Unable to open %1 for writing: %2" )
+				   .arg( filename ).arg( file.errorString() ) );
+		return false;
 	}
 
-	file.close();
-
-	if( rv ) {
-		WARNINGLOG("File save reported an error.");
-	} else {
-		pSong->setIsModified( false );
-		INFOLOG("Save was successful.");
+	if ( file.write( content ) != content.size() ) {
+		_ERRORLOG( QString( "Unable to write %1: %2" )
+				   .arg( filename ).arg( file.errorString() ) );
+		file.cancelWriting();
+		file.commit();
+		return false;
 	}
 
-	pSong->setFilename( filename );
+	if ( ! file.commit() ) {
+		_ERRORLOG( QString( "Unable to write %1: %2" )
+				   .arg( filename ).arg( file.errorString() ) );
+		return false;
+	}
 
-	return rv;
+	return true;
 }
 
 };
@@ -85,6 +85,21 @@ public:
 
 	// Returns 0 on success.
 	int writeSong( Song *song, const QString& filename );
+
+	/**
+	 * Serializes @a pSong into the UTF-8 encoded XML of a song file.
+	 *
+	 * Each element is written right away instead of building a DOM
+	 * first. The result does not reference the song and can be
+	 * written to disk by another thread while the song is edited.
+	 * See SongAutosaver.
+	 */
+	QByteArray serialize( Song* pSong );
+	/**
+	 * Replaces @a filename by @a content. The data is written into a
+	 * temporary file first, which is flushed to disk and renamed.
+	 */
+	static bool writeFile( const QByteArray& content, const QString& filename );
 };
 
 };
@@ -22,9 +22,13 @@
 
 #include "core/Logger.h"
 #include "core/Helpers/Filesystem.h"
+#include "core/Tracer.h"
 
+#include <cstdint>
 #include <cstdio>
+#include <ctime>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QString>
 
 #ifdef WIN32
@@ -39,6 +43,48 @@ const char* Logger::__levels[] = { "None", "Error", "Warning", "Info", "Debug" }
 
 pthread_t loggerThread;
 
+static_assert( ( MAX_RT_LOG_MESSAGES & ( MAX_RT_LOG_MESSAGES - 1 ) ) == 0,
+			   "MAX_RT_LOG_MESSAGES has to be a power of two" );
+
+/** Interval in milliseconds at which the logger thread checks for
+	messages of Logger::log_rt(). Realtime threads must not signal
+	#Logger::__messages_available themselves.*/
+static const long nRtPollInterval = 100;
+
+/** Size in bytes of the stdio buffer of the log file. The file is
+	flushed once per batch of messages instead of after each one.*/
+static const size_t nLogFileBufferSize = 64 * 1024;
+
+/**
+ * Opens the log file for writing using a fully buffered stream.
+ */
+static FILE* openLogFile( const QString& sLogFilename ) {
+	FILE* log_file = fopen( sLogFilename.toLocal8Bit(), "w" );
+	if ( log_file ) {
+		setvbuf( log_file, nullptr, _IOFBF, nLogFileBufferSize );
+	} else {
+		fprintf( stderr, "Error: can't open log file for writing...\n" );
+	}
+	return log_file;
+}
+
+/**
+ * Closes the current log file, shifts it and its predecessors to the
+ * numbered backups, and opens a fresh one.
+ */
+static FILE* rotateLogFile( FILE* log_file, const QString& sLogFilename ) {
+	fclose( log_file );
+	QFile::remove( QString( "%1.%2" ).arg( sLogFilename ).arg( MAX_LOG_FILE_BACKUPS ) );
+	for ( int ii = MAX_LOG_FILE_BACKUPS - 1; ii > 0; --ii ) {
+		QFile::rename( QString( "%1.%2" ).arg( sLogFilename ).arg( ii ),
+					   QString( "%1.%2" ).arg( sLogFilename ).arg( ii + 1 ) );
+	}
+	if ( MAX_LOG_FILE_BACKUPS > 0 ) {
+		QFile::rename( sLogFilename, sLogFilename + ".1" );
+	}
+	return openLogFile( sLogFilename );
+}
+
 void* loggerThread_func( void* param ) {
 	if ( param == nullptr ) return nullptr;
 	Logger* logger = ( Logger* )param;
@@ -50,32 +96,51 @@ void* loggerThread_func( void* param ) {
 #  endif
 #endif
 	FILE* log_file = nullptr;
+	QString sLogFilename;
+	long nLogFileSize = 0;
 	if ( logger->__use_file ) {
 
-		QString sLogFilename = Filesystem::log_file_path();
-				
-		log_file = fopen( sLogFilename.toLocal8Bit(), "w" );
+		sLogFilename = Filesystem::log_file_path();
+
+		log_file = openLogFile( sLogFilename );
 		if ( log_file ) {
-			fprintf( log_file, "Start logger" );
-		} else {
-			fprintf( stderr, "Error: can't open log file for writing...\n" );
+			fprintf( log_file, "Start logger\n" );
 		}
 	}
 	Logger::queue_t* queue = &logger->__msg_queue;
 	Logger::queue_t::iterator it, last;
 
+	Tracer::setThreadName( "Logger" );
 	while ( logger->__running ) {
-		pthread_cond_wait( &logger->__messages_available, &logger->__mutex );
+		struct timespec timeout;
+		clock_gettime( CLOCK_REALTIME, &timeout );
+		timeout.tv_nsec += nRtPollInterval * 1000000;
+		if ( timeout.tv_nsec >= 1000000000 ) {
+			timeout.tv_sec += 1;
+			timeout.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait( &logger->__messages_available, &logger->__mutex, &timeout );
 		pthread_mutex_unlock( &logger->__mutex );
+		Tracer::Scope trace( "Logger flush" );
+		logger->flush_rt_messages();
 		if( !queue->empty() ) {
 			for( it = last = queue->begin() ; it != queue->end() ; ++it ) {
 				last = it;
-				fprintf( stdout, "%s", it->toLocal8Bit().data() );
+				QByteArray message = it->toLocal8Bit();
+				fwrite( message.constData(), 1, message.size(), stdout );
 				if( log_file ) {
-					fprintf( log_file, "%s", it->toLocal8Bit().data() );
-					fflush( log_file );
+					fwrite( message.constData(), 1, message.size(), log_file );
+					nLogFileSize += message.size();
+					if ( nLogFileSize >= MAX_LOG_FILE_SIZE ) {
+						log_file = rotateLogFile( log_file, sLogFilename );
+						nLogFileSize = 0;
+					}
 				}
 			}
+			fflush( stdout );
+			if( log_file ) {
+				fflush( log_file );
+			}
 			// remove all in front of last
 			queue->erase( queue->begin(), last );
 			// lock before removing last
@@ -85,7 +150,7 @@ void* loggerThread_func( void* param ) {
 		}
 	}
 	if ( log_file ) {
-		fprintf( log_file, "Stop logger" );
+		fprintf( log_file, "Stop logger\n" );
 		fclose( log_file );
 	}
 #ifdef WIN32
@@ -106,8 +171,11 @@ Logger* Logger::create_instance() {
 	return __instance;
 }
 
-Logger::Logger() : __use_file( true ), __running( true ) {
+Logger::Logger() : __use_file( true ), __running( true ), __rt_write_index( 0 ), __rt_read_index( 0 ), __rt_dropped( 0 ) {
 	__instance = this;
+	for ( size_t ii = 0; ii < MAX_RT_LOG_MESSAGES; ++ii ) {
+		__rt_messages[ ii ].sequence.store( ii, std::memory_order_relaxed );
+	}
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
 	pthread_mutex_init( &__mutex, nullptr );
@@ -115,6 +183,10 @@ Logger::Logger() : __use_file( true ), __running( true ) {
 	pthread_create( &loggerThread, &attr, loggerThread_func, this );
 }
 
+pthread_t Logger::thread() const {
+	return loggerThread;
+}
+
 Logger::~Logger() {
 	__running = false;
 	pthread_cond_broadcast ( &__messages_available );
@@ -153,12 +225,18 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 		break;
 	}
 
-	QString tmp = QString( "%1%2%3::%4 %5\033[0m\n" )
-				  .arg( color[i] )
-				  .arg( prefix[i] )
-				  .arg( class_name )
-				  .arg( func_name )
-				  .arg( msg );
+	// Appending avoids the repeated placeholder scans of
+	// QString::arg().
+	QString tmp;
+	tmp.reserve( class_name.size() + msg.size() + 64 );
+	tmp.append( color[i] )
+		.append( prefix[i] )
+		.append( class_name )
+		.append( "::" )
+		.append( func_name )
+		.append( ' ' )
+		.append( msg )
+		.append( "\033[0m\n" );
 
 	pthread_mutex_lock( &__mutex );
 	__msg_queue.push_back( tmp );
@@ -166,6 +244,73 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 	pthread_cond_broadcast( &__messages_available );
 }
 
+void Logger::log_rt( unsigned level, const char* func_name, const char* msg,
+					 double a1, double a2, double a3, double a4 ) {
+
+	if( level == None ){
+		return;
+	}
+
+	size_t pos = __rt_write_index.load( std::memory_order_relaxed );
+	rt_message_t* slot;
+
+	for ( ;; ) {
+		slot = &__rt_messages[ pos & ( MAX_RT_LOG_MESSAGES - 1 ) ];
+		size_t sequence = slot->sequence.load( std::memory_order_acquire );
+		intptr_t diff = static_cast<intptr_t>( sequence ) - static_cast<intptr_t>( pos );
+
+		if ( diff == 0 ) {
+			if ( __rt_write_index.compare_exchange_weak( pos, pos + 1,
+														 std::memory_order_relaxed ) ) {
+				break;
+			}
+		} else if ( diff < 0 ) {
+			// The logger thread did not catch up yet.
+			__rt_dropped.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		} else {
+			pos = __rt_write_index.load( std::memory_order_relaxed );
+		}
+	}
+
+	slot->level = level;
+	slot->func_name = func_name;
+	slot->msg = msg;
+	slot->args[ 0 ] = a1;
+	slot->args[ 1 ] = a2;
+	slot->args[ 2 ] = a3;
+	slot->args[ 3 ] = a4;
+	slot->sequence.store( pos + 1, std::memory_order_release );
+}
+
+void Logger::flush_rt_messages() {
+	for ( ;; ) {
+		rt_message_t* slot = &__rt_messages[ __rt_read_index & ( MAX_RT_LOG_MESSAGES - 1 ) ];
+		if ( slot->sequence.load( std::memory_order_acquire ) != __rt_read_index + 1 ) {
+			// Either empty or the producer is still writing.
+			break;
+		}
+
+		QString msg( slot->msg );
+		for ( int ii = 0; ii < MAX_RT_LOG_ARGS; ++ii ) {
+			QString placeholder = QString( "%" ) + QString::number( ii + 1 );
+			if ( msg.contains( placeholder ) ) {
+				msg.replace( placeholder, QString::number( slot->args[ ii ], 'g', 12 ) );
+			}
+		}
+		log( slot->level, QString(), slot->func_name, msg );
+
+		slot->sequence.store( __rt_read_index + MAX_RT_LOG_MESSAGES, std::memory_order_release );
+		++__rt_read_index;
+	}
+
+	int dropped = __rt_dropped.exchange( 0, std::memory_order_relaxed );
+	if ( dropped > 0 ) {
+		log( Warning, QString(), __FUNCTION__,
+			 QString( "%1 realtime log messages dropped" ).arg( dropped ) );
+	}
+}
+
 unsigned Logger::parse_log_level( const char* level ) {
 	unsigned log_level = Logger::None;
 	if( 0 == strncasecmp( level, __levels[0], strlen( __levels[0] ) ) ) {
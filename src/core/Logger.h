@@ -23,7 +23,9 @@
 #ifndef H2C_LOGGER_H
 #define H2C_LOGGER_H
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <list>
 #include <pthread.h>
 #include <memory>
@@ -33,6 +35,22 @@
 class QString;
 class QStringList;
 
+/** Number of realtime log messages which can be pending in the
+	H2Core::Logger at the same time. Has to be a power of two.*/
+#define MAX_RT_LOG_MESSAGES 256
+/** Maximum number of numerical arguments of a realtime log message.*/
+#define MAX_RT_LOG_ARGS 4
+/** Size in bytes at which the log file is rotated.*/
+#define MAX_LOG_FILE_SIZE ( 4 * 1024 * 1024 )
+/** Number of rotated log files kept next to the current one.*/
+#define MAX_LOG_FILE_BACKUPS 2
+
+#ifndef H2CORE_MAX_LOG_LEVEL
+/** Most verbose level of H2Core::Logger::log_levels compiled
+	in. Set via the MAX_LOG_LEVEL CMake option.*/
+#define H2CORE_MAX_LOG_LEVEL 0x08
+#endif
+
 namespace H2Core {
 
 /**
@@ -79,10 +97,22 @@ class Logger {
 		~Logger();
 
 		/**
-		 * return true if the level is set in the bitmask
+		 * Whether messages of a level are compiled in at all.
+		 *
+		 * Levels more verbose than #H2CORE_MAX_LOG_LEVEL are
+		 * rejected. Since the logging macros pass constant levels,
+		 * the compiler drops both the check and the message.
+		 * Constructors and AELockTracing are not affected.
+		 * \param lvl the level to check
+		 */
+		static constexpr bool compiled_in( unsigned lvl ) {
+			return lvl <= H2CORE_MAX_LOG_LEVEL || lvl > Debug;
+		}
+		/**
+		 * return true if the level is compiled in and set in the bitmask
 		 * \param lvl the level to check
 		 */
-		bool should_log( unsigned lvl ) const       { return (lvl&__bit_msk); }
+		bool should_log( unsigned lvl ) const       { return compiled_in( lvl ) && (lvl&__bit_msk); }
 		/**
 		 * set the bitmask
 		 * \param msk the new bitmask to set
@@ -97,6 +127,8 @@ class Logger {
 		void set_use_file( bool use )               { __use_file = use; }
 		/** return __use_file */
 		bool use_file() const                       { return __use_file; }
+		/** return the thread writing the messages */
+		pthread_t thread() const;
 
 		/**
 		 * parse a log level string and return the corresponding bit mask
@@ -112,6 +144,25 @@ class Logger {
 		 * \param msg the message to log
 		 */
 		void log( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		/**
+		 * Log function safe to be called from realtime threads.
+		 *
+		 * Neither allocates memory nor acquires a lock. The message
+		 * is stored as a plain record in the preallocated
+		 * #__rt_messages ring buffer and formatted by the logger
+		 * thread later on. If the buffer is full, the message is
+		 * dropped and the number of dropped messages reported
+		 * instead.
+		 *
+		 * \param level used to output the corresponding level string
+		 * \param func_name the name of the calling function/method.
+		 * Must be a string literal.
+		 * \param msg the message to log. Must be a string literal.
+		 * Placeholders \%1 to \%4 are replaced by the arguments.
+		 * \param a1,a2,a3,a4 numerical arguments of the message
+		 */
+		void log_rt( unsigned level, const char* func_name, const char* msg,
+					 double a1 = 0, double a2 = 0, double a3 = 0, double a4 = 0 );
 		/**
 		 * needed for being able to access logger internal
 		 * \param param is a pointer to the logger instance
@@ -119,6 +170,21 @@ class Logger {
 		friend void* loggerThread_func( void* param );
 
 	private:
+		/** Plain record of a message passed to log_rt().*/
+		struct rt_message_t {
+			std::atomic<size_t> sequence;
+			unsigned level;
+			const char* func_name;
+			const char* msg;
+			double args[ MAX_RT_LOG_ARGS ];
+		};
+
+		/**
+		 * Moves all messages logged via log_rt() into
+		 * #__msg_queue. Called by the logger thread.
+		 */
+		void flush_rt_messages();
+
 		/**
 		 * Object holding the current H2Core::Logger
 		 * singleton. It is initialized with NULL, set with
@@ -133,6 +199,13 @@ class Logger {
 		static unsigned __bit_msk;      ///< the bitmask of log_level_t
 		static const char* __levels[];  ///< levels strings
 		pthread_cond_t __messages_available;
+		/** Ring buffer of log_rt() following the same scheme as
+			H2Core::CommandQueue. This way any number of realtime
+			threads can log at the same time.*/
+		rt_message_t __rt_messages[ MAX_RT_LOG_MESSAGES ];
+		std::atomic<size_t> __rt_write_index;
+		size_t __rt_read_index;         ///< only accessed by the logger thread
+		std::atomic<int> __rt_dropped;  ///< messages not fitting into #__rt_messages
 
 		/** constructor */
 		Logger();
@@ -35,6 +35,7 @@
 
 #include <core/Preferences.h>
 #include <core/MidiAction.h>
+#include <core/MidiMap.h>
 
 #include <core/Basics/Drumkit.h>
 
@@ -96,33 +97,33 @@ MidiActionManager::MidiActionManager() : Object( __class_name ) {
 	m_nLastBpmChangeCCParameter = -1;
 	/*
 		the actionMap holds all Action identifiers which hydrogen is able to interpret.
-		it holds pointer to member function
+		it maps them to a pointer to member function in the m_actionTable
 	*/
 	targeted_element empty = {0,0};
-	actionMap.insert(std::make_pair("PLAY", std::make_pair(&MidiActionManager::play, empty)));
-	actionMap.insert(std::make_pair("PLAY/STOP_TOGGLE", std::make_pair(&MidiActionManager::play_stop_pause_toggle, empty)));
-	actionMap.insert(std::make_pair("PLAY/PAUSE_TOGGLE", std::make_pair(&MidiActionManager::play_stop_pause_toggle, empty)));
-	actionMap.insert(std::make_pair("STOP", std::make_pair(&MidiActionManager::stop, empty)));
-	actionMap.insert(std::make_pair("PAUSE", std::make_pair(&MidiActionManager::pause, empty)));
-	actionMap.insert(std::make_pair("RECORD_READY", std::make_pair(&MidiActionManager::record_ready, empty)));
-	actionMap.insert(std::make_pair("RECORD/STROBE_TOGGLE", std::make_pair(&MidiActionManager::record_strobe_toggle, empty)));
-	actionMap.insert(std::make_pair("RECORD_STROBE", std::make_pair(&MidiActionManager::record_strobe, empty)));
-	actionMap.insert(std::make_pair("RECORD_EXIT", std::make_pair(&MidiActionManager::record_exit, empty)));
-	actionMap.insert(std::make_pair("MUTE", std::make_pair(&MidiActionManager::mute, empty)));
-	actionMap.insert(std::make_pair("UNMUTE", std::make_pair(&MidiActionManager::unmute, empty)));
-	actionMap.insert(std::make_pair("MUTE_TOGGLE", std::make_pair(&MidiActionManager::mute_toggle, empty)));
-	actionMap.insert(std::make_pair("STRIP_MUTE_TOGGLE", std::make_pair(&MidiActionManager::strip_mute_toggle, empty)));
-	actionMap.insert(std::make_pair("STRIP_SOLO_TOGGLE", std::make_pair(&MidiActionManager::strip_solo_toggle, empty)));	
-	actionMap.insert(std::make_pair(">>_NEXT_BAR", std::make_pair(&MidiActionManager::next_bar, empty)));
-	actionMap.insert(std::make_pair("<<_PREVIOUS_BAR", std::make_pair(&MidiActionManager::previous_bar, empty)));
-	actionMap.insert(std::make_pair("BPM_INCR", std::make_pair(&MidiActionManager::bpm_increase, empty)));
-	actionMap.insert(std::make_pair("BPM_DECR", std::make_pair(&MidiActionManager::bpm_decrease, empty)));
-	actionMap.insert(std::make_pair("BPM_CC_RELATIVE", std::make_pair(&MidiActionManager::bpm_cc_relative, empty)));
-	actionMap.insert(std::make_pair("BPM_FINE_CC_RELATIVE", std::make_pair(&MidiActionManager::bpm_fine_cc_relative, empty)));
-	actionMap.insert(std::make_pair("MASTER_VOLUME_RELATIVE", std::make_pair(&MidiActionManager::master_volume_relative, empty)));
-	actionMap.insert(std::make_pair("MASTER_VOLUME_ABSOLUTE", std::make_pair(&MidiActionManager::master_volume_absolute, empty)));
-	actionMap.insert(std::make_pair("STRIP_VOLUME_RELATIVE", std::make_pair(&MidiActionManager::strip_volume_relative, empty)));
-	actionMap.insert(std::make_pair("STRIP_VOLUME_ABSOLUTE", std::make_pair(&MidiActionManager::strip_volume_absolute, empty)));
+	registerAction("PLAY", &MidiActionManager::play, empty);
+	registerAction("PLAY/STOP_TOGGLE", &MidiActionManager::play_stop_toggle, empty);
+	registerAction("PLAY/PAUSE_TOGGLE", &MidiActionManager::play_pause_toggle, empty);
+	registerAction("STOP", &MidiActionManager::stop, empty);
+	registerAction("PAUSE", &MidiActionManager::pause, empty);
+	registerAction("RECORD_READY", &MidiActionManager::record_ready, empty);
+	registerAction("RECORD/STROBE_TOGGLE", &MidiActionManager::record_strobe_toggle, empty);
+	registerAction("RECORD_STROBE", &MidiActionManager::record_strobe, empty);
+	registerAction("RECORD_EXIT", &MidiActionManager::record_exit, empty);
+	registerAction("MUTE", &MidiActionManager::mute, empty);
+	registerAction("UNMUTE", &MidiActionManager::unmute, empty);
+	registerAction("MUTE_TOGGLE", &MidiActionManager::mute_toggle, empty);
+	registerAction("STRIP_MUTE_TOGGLE", &MidiActionManager::strip_mute_toggle, empty);
+	registerAction("STRIP_SOLO_TOGGLE", &MidiActionManager::strip_solo_toggle, empty);	
+	registerAction(">>_NEXT_BAR", &MidiActionManager::next_bar, empty);
+	registerAction("<<_PREVIOUS_BAR", &MidiActionManager::previous_bar, empty);
+	registerAction("BPM_INCR", &MidiActionManager::bpm_increase, empty);
+	registerAction("BPM_DECR", &MidiActionManager::bpm_decrease, empty);
+	registerAction("BPM_CC_RELATIVE", &MidiActionManager::bpm_cc_relative, empty);
+	registerAction("BPM_FINE_CC_RELATIVE", &MidiActionManager::bpm_fine_cc_relative, empty);
+	registerAction("MASTER_VOLUME_RELATIVE", &MidiActionManager::master_volume_relative, empty);
+	registerAction("MASTER_VOLUME_ABSOLUTE", &MidiActionManager::master_volume_absolute, empty);
+	registerAction("STRIP_VOLUME_RELATIVE", &MidiActionManager::strip_volume_relative, empty);
+	registerAction("STRIP_VOLUME_ABSOLUTE", &MidiActionManager::strip_volume_absolute, empty);
 	
 	for(int i = 0; i < MAX_FX; ++i) {
 		targeted_element effect = {i,0};
@@ -134,8 +135,8 @@ MidiActionManager::MidiActionManager() : Object( __class_name ) {
 		keyRelative += toChar.str();
 		keyAbsolute += "_LEVEL_ABSOLUTE";
 		keyRelative += "_LEVEL_RELATIVE";
-		actionMap.insert(std::make_pair(keyAbsolute, std::make_pair(&MidiActionManager::effect_level_absolute, effect)));
-		actionMap.insert(std::make_pair(keyRelative, std::make_pair(&MidiActionManager::effect_level_relative, effect)));
+		registerAction(keyAbsolute, &MidiActionManager::effect_level_absolute, effect);
+		registerAction(keyRelative, &MidiActionManager::effect_level_relative, effect);
 	}
 	for(int i = 0; i < MAX_COMPONENTS; ++i) {
 		std::ostringstream componentToChar;
@@ -154,32 +155,33 @@ MidiActionManager::MidiActionManager() : Object( __class_name ) {
 			keyPitch += toChar.str();
 			keyGain += "_LEVEL_ABSOLUTE";
 			keyPitch += "_LEVEL_ABSOLUTE";
-			actionMap.insert(std::make_pair(keyGain, std::make_pair(&MidiActionManager::gain_level_absolute, sample)));
-			actionMap.insert(std::make_pair(keyPitch, std::make_pair(&MidiActionManager::pitch_level_absolute, sample)));
-		}
-	}
-	actionMap.insert(std::make_pair("SELECT_NEXT_PATTERN", std::make_pair(&MidiActionManager::select_next_pattern, empty)));
-	actionMap.insert(std::make_pair("SELECT_ONLY_NEXT_PATTERN", std::make_pair(&MidiActionManager::select_only_next_pattern, empty)));
-	actionMap.insert(std::make_pair("SELECT_NEXT_PATTERN_CC_ABSOLUTE", std::make_pair(&MidiActionManager::select_next_pattern_cc_absolute, empty)));
-	actionMap.insert(std::make_pair("SELECT_NEXT_PATTERN_RELATIVE", std::make_pair(&MidiActionManager::select_next_pattern_relative, empty)));
-	actionMap.insert(std::make_pair("SELECT_AND_PLAY_PATTERN", std::make_pair(&MidiActionManager::select_and_play_pattern, empty)));
-	actionMap.insert(std::make_pair("PAN_RELATIVE", std::make_pair(&MidiActionManager::pan_relative, empty)));
-	actionMap.insert(std::make_pair("PAN_ABSOLUTE", std::make_pair(&MidiActionManager::pan_absolute, empty)));
-	actionMap.insert(std::make_pair("FILTER_CUTOFF_LEVEL_ABSOLUTE", std::make_pair(&MidiActionManager::filter_cutoff_level_absolute, empty)));
-	actionMap.insert(std::make_pair("BEATCOUNTER", std::make_pair(&MidiActionManager::beatcounter, empty)));
-	actionMap.insert(std::make_pair("TAP_TEMPO", std::make_pair(&MidiActionManager::tap_tempo, empty)));
-	actionMap.insert(std::make_pair("PLAYLIST_SONG", std::make_pair(&MidiActionManager::playlist_song, empty)));
-	actionMap.insert(std::make_pair("PLAYLIST_NEXT_SONG", std::make_pair(&MidiActionManager::playlist_next_song, empty)));
-	actionMap.insert(std::make_pair("PLAYLIST_PREV_SONG", std::make_pair(&MidiActionManager::playlist_previous_song, empty)));
-	actionMap.insert(std::make_pair("TOGGLE_METRONOME", std::make_pair(&MidiActionManager::toggle_metronome, empty)));
-	actionMap.insert(std::make_pair("SELECT_INSTRUMENT", std::make_pair(&MidiActionManager::select_instrument, empty)));
-	actionMap.insert(std::make_pair("UNDO_ACTION", std::make_pair(&MidiActionManager::undo_action, empty)));
-	actionMap.insert(std::make_pair("REDO_ACTION", std::make_pair(&MidiActionManager::redo_action, empty)));
+			registerAction(keyGain, &MidiActionManager::gain_level_absolute, sample);
+			registerAction(keyPitch, &MidiActionManager::pitch_level_absolute, sample);
+		}
+	}
+	registerAction("SELECT_NEXT_PATTERN", &MidiActionManager::select_next_pattern, empty);
+	registerAction("SELECT_ONLY_NEXT_PATTERN", &MidiActionManager::select_only_next_pattern, empty);
+	registerAction("SELECT_NEXT_PATTERN_CC_ABSOLUTE", &MidiActionManager::select_next_pattern_cc_absolute, empty);
+	registerAction("SELECT_NEXT_PATTERN_RELATIVE", &MidiActionManager::select_next_pattern_relative, empty);
+	registerAction("SELECT_AND_PLAY_PATTERN", &MidiActionManager::select_and_play_pattern, empty);
+	registerAction("PAN_RELATIVE", &MidiActionManager::pan_relative, empty);
+	registerAction("PAN_ABSOLUTE", &MidiActionManager::pan_absolute, empty);
+	registerAction("FILTER_CUTOFF_LEVEL_ABSOLUTE", &MidiActionManager::filter_cutoff_level_absolute, empty);
+	registerAction("BEATCOUNTER", &MidiActionManager::beatcounter, empty);
+	registerAction("TAP_TEMPO", &MidiActionManager::tap_tempo, empty);
+	registerAction("PLAYLIST_SONG", &MidiActionManager::playlist_song, empty);
+	registerAction("PLAYLIST_SONG_CC_ABSOLUTE", &MidiActionManager::playlist_song_cc_absolute, empty);
+	registerAction("PLAYLIST_NEXT_SONG", &MidiActionManager::playlist_next_song, empty);
+	registerAction("PLAYLIST_PREV_SONG", &MidiActionManager::playlist_previous_song, empty);
+	registerAction("TOGGLE_METRONOME", &MidiActionManager::toggle_metronome, empty);
+	registerAction("SELECT_INSTRUMENT", &MidiActionManager::select_instrument, empty);
+	registerAction("UNDO_ACTION", &MidiActionManager::undo_action, empty);
+	registerAction("REDO_ACTION", &MidiActionManager::redo_action, empty);
 	/*
 	  the actionList holds all Action identfiers which hydrogen is able to interpret.
 	*/
 	actionList <<"";
-	for(std::map<std::string, std::pair<action_f, targeted_element> >::const_iterator actionIterator = actionMap.begin();
+	for(std::map<std::string, int>::const_iterator actionIterator = actionMap.begin();
 	    actionIterator != actionMap.end();
 	    ++actionIterator) {
 		actionList << actionIterator->first.c_str();
@@ -198,6 +200,12 @@ MidiActionManager::MidiActionManager() : Object( __class_name ) {
 			  << "NOTE"
 			  << "CC"
 			  << "PROGRAM_CHANGE";
+
+	// Actions registered before the manager existed could not be
+	// resolved yet.
+	if( MidiMap::__instance != nullptr ) {
+		MidiMap::__instance->compileActions();
+	}
 }
 
 
@@ -212,7 +220,7 @@ void MidiActionManager::create_instance() {
 	}
 }
 
-bool MidiActionManager::play(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::play(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	int nState = pEngine->getState();
 	if ( nState == STATE_READY ) {
 		pEngine->sequencer_play();
@@ -220,20 +228,27 @@ bool MidiActionManager::play(Action * , Hydrogen* pEngine, targeted_element ) {
 	return true;
 }
 
-bool MidiActionManager::pause(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::pause(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->sequencer_stop();
 	return true;
 }
 
-bool MidiActionManager::stop(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::stop(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->sequencer_stop();
 	pEngine->setPatternPos( 0 );
 	pEngine->setTimelineBpm();
 	return true;
 }
 
-bool MidiActionManager::play_stop_pause_toggle(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	QString sActionString = pAction->getType();
+bool MidiActionManager::play_stop_toggle(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
+	return play_toggle( pEngine, true );
+}
+
+bool MidiActionManager::play_pause_toggle(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
+	return play_toggle( pEngine, false );
+}
+
+bool MidiActionManager::play_toggle( Hydrogen* pEngine, bool bRewind ) {
 	int nState = pEngine->getState();
 	switch ( nState )
 	{
@@ -242,7 +257,7 @@ bool MidiActionManager::play_stop_pause_toggle(Action * pAction, Hydrogen* pEngi
 		break;
 
 	case STATE_PLAYING:
-		if( sActionString == "PLAY/STOP_TOGGLE" ) {
+		if( bRewind ) {
 			pEngine->setPatternPos( 0 );
 		}
 		pEngine->sequencer_stop();
@@ -258,27 +273,26 @@ bool MidiActionManager::play_stop_pause_toggle(Action * pAction, Hydrogen* pEngi
 }
 
 //mutes the master, not a single strip
-bool MidiActionManager::mute(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::mute(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->getCoreActionController()->setMasterIsMuted( true );
 	return true;
 }
 
-bool MidiActionManager::unmute(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::unmute(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->getCoreActionController()->setMasterIsMuted( false );
 	return true;
 }
 
-bool MidiActionManager::mute_toggle(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::mute_toggle(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->getCoreActionController()->setMasterIsMuted( !Hydrogen::get_instance()->getSong()->getIsMuted() );
 	return true;
 }
 
-bool MidiActionManager::strip_mute_toggle(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::strip_mute_toggle(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	
-	bool ok;
 	bool bSucccess = true;
 	
-	int nLine = pAction->getParameter1().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -298,12 +312,11 @@ bool MidiActionManager::strip_mute_toggle(Action * pAction, Hydrogen* pEngine, t
 	return bSucccess;
 }
 
-bool MidiActionManager::strip_solo_toggle(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::strip_solo_toggle(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	
-	bool ok;
 	bool bSucccess = true;
 	
-	int nLine = pAction->getParameter1().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -323,19 +336,18 @@ bool MidiActionManager::strip_solo_toggle(Action * pAction, Hydrogen* pEngine, t
 	return bSucccess;
 }
 
-bool MidiActionManager::beatcounter(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::beatcounter(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->handleBeatCounter();
 	return true;
 }
 
-bool MidiActionManager::tap_tempo(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::tap_tempo(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->onTapTempoAccelEvent();
 	return true;
 }
 
-bool MidiActionManager::select_next_pattern(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int row = pAction->getParameter1().toInt(&ok,10);
+bool MidiActionManager::select_next_pattern(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int row = pAction->nParameter1;
 	if( row > pEngine->getSong()->getPatternList()->size() - 1 ||
 		row < 0 ) {
 		return false;
@@ -349,9 +361,8 @@ bool MidiActionManager::select_next_pattern(Action * pAction, Hydrogen* pEngine,
 	return true;
 }
 
-bool MidiActionManager::select_only_next_pattern(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int row = pAction->getParameter1().toInt(&ok,10);
+bool MidiActionManager::select_only_next_pattern(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int row = pAction->nParameter1;
 	if( row > pEngine->getSong()->getPatternList()->size() -1 ||
 		row < 0 ) {
 		return false;
@@ -365,12 +376,11 @@ bool MidiActionManager::select_only_next_pattern(Action * pAction, Hydrogen* pEn
 	return true; 
 }
 
-bool MidiActionManager::select_next_pattern_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
+bool MidiActionManager::select_next_pattern_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	if(!Preferences::get_instance()->patternModePlaysSelected()) {
 		return true;
 	}
-	int row = pEngine->getSelectedPatternNumber() + pAction->getParameter1().toInt(&ok,10);
+	int row = pEngine->getSelectedPatternNumber() + pAction->nParameter1;
 	if( row > pEngine->getSong()->getPatternList()->size() - 1 ||
 		row < 0 ) {
 		return false;
@@ -380,9 +390,8 @@ bool MidiActionManager::select_next_pattern_relative(Action * pAction, Hydrogen*
 	return true;
 }
 
-bool MidiActionManager::select_next_pattern_cc_absolute(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int row = pAction->getParameter2().toInt(&ok,10);
+bool MidiActionManager::select_next_pattern_cc_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int row = pAction->nParameter2;
 	
 	if( row > pEngine->getSong()->getPatternList()->size() - 1 ||
 		row < 0 ) {
@@ -399,7 +408,7 @@ bool MidiActionManager::select_next_pattern_cc_absolute(Action * pAction, Hydrog
 	return true;
 }
 
-bool MidiActionManager::select_and_play_pattern(Action * pAction, Hydrogen* pEngine, targeted_element t ) {
+bool MidiActionManager::select_and_play_pattern(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element t ) {
 	if ( ! select_next_pattern( pAction, pEngine, t ) ) {
 		return false;
 	}
@@ -412,9 +421,8 @@ bool MidiActionManager::select_and_play_pattern(Action * pAction, Hydrogen* pEng
 	return true;
 }
 
-bool MidiActionManager::select_instrument(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int  nInstrumentNumber = pAction->getParameter2().toInt(&ok,10) ;
+bool MidiActionManager::select_instrument(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int  nInstrumentNumber = pAction->nParameter2 ;
 	
 	if ( pEngine->getSong()->getInstrumentList()->size() < nInstrumentNumber ) {
 		nInstrumentNumber = pEngine->getSong()->getInstrumentList()->size() -1;
@@ -426,11 +434,10 @@ bool MidiActionManager::select_instrument(Action * pAction, Hydrogen* pEngine, t
 	return true;
 }
 
-bool MidiActionManager::effect_level_absolute(Action * pAction, Hydrogen* pEngine, targeted_element nEffect) {
-	bool ok;
+bool MidiActionManager::effect_level_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element nEffect) {
 	bool bSuccess = true;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int fx_param = pAction->getParameter2().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
+	int fx_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -456,16 +463,15 @@ bool MidiActionManager::effect_level_absolute(Action * pAction, Hydrogen* pEngin
 	return bSuccess;
 }
 
-bool MidiActionManager::effect_level_relative(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::effect_level_relative(const CompiledAction * , Hydrogen* , targeted_element ) {
 	//empty ?
 	return true;
 }
 
 //sets the volume of a master output to a given level (percentage)
-bool MidiActionManager::master_volume_absolute(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::master_volume_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
-	bool ok;
-	int vol_param = pAction->getParameter2().toInt(&ok,10);
+	int vol_param = pAction->nParameter2;
 
 	Song *song = pEngine->getSong();
 
@@ -479,10 +485,9 @@ bool MidiActionManager::master_volume_absolute(Action * pAction, Hydrogen* pEngi
 }
 
 //increments/decrements the volume of the whole song
-bool MidiActionManager::master_volume_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::master_volume_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
-	bool ok;
-	int vol_param = pAction->getParameter2().toInt(&ok,10);
+	int vol_param = pAction->nParameter2;
 
 	Song *song = pEngine->getSong();
 
@@ -502,11 +507,10 @@ bool MidiActionManager::master_volume_relative(Action * pAction, Hydrogen* pEngi
 }
 
 //sets the volume of a mixer strip to a given level (percentage)
-bool MidiActionManager::strip_volume_absolute(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::strip_volume_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int vol_param = pAction->getParameter2().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
+	int vol_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -532,11 +536,10 @@ bool MidiActionManager::strip_volume_absolute(Action * pAction, Hydrogen* pEngin
 }
 
 //increments/decrements the volume of one mixer strip
-bool MidiActionManager::strip_volume_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::strip_volume_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int vol_param = pAction->getParameter2().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
+	int vol_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -568,11 +571,10 @@ bool MidiActionManager::strip_volume_relative(Action * pAction, Hydrogen* pEngin
 }
 
 // sets the absolute panning of a given mixer channel
-bool MidiActionManager::pan_absolute(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::pan_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int pan_param = pAction->getParameter2().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
+	int pan_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -624,12 +626,11 @@ bool MidiActionManager::pan_absolute(Action * pAction, Hydrogen* pEngine, target
 
 // changes the panning of a given mixer channel
 // this is useful if the panning is set by a rotary control knob
-bool MidiActionManager::pan_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::pan_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
 
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int pan_param = pAction->getParameter2().toInt(&ok,10);
+	int nLine = pAction->nParameter1;
+	int pan_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -685,10 +686,9 @@ bool MidiActionManager::pan_relative(Action * pAction, Hydrogen* pEngine, target
 	return true;
 }
 
-bool MidiActionManager::gain_level_absolute(Action * pAction, Hydrogen* pEngine, targeted_element nSample) {
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int gain_param = pAction->getParameter2().toInt(&ok,10);
+bool MidiActionManager::gain_level_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element nSample) {
+	int nLine = pAction->nParameter1;
+	int gain_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -724,10 +724,9 @@ bool MidiActionManager::gain_level_absolute(Action * pAction, Hydrogen* pEngine,
 	return true;
 }
 
-bool MidiActionManager::pitch_level_absolute(Action * pAction, Hydrogen* pEngine, targeted_element nSample) {
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int pitch_param = pAction->getParameter2().toInt(&ok,10);
+bool MidiActionManager::pitch_level_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element nSample) {
+	int nLine = pAction->nParameter1;
+	int pitch_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -763,10 +762,9 @@ bool MidiActionManager::pitch_level_absolute(Action * pAction, Hydrogen* pEngine
 	return true;
 }
 
-bool MidiActionManager::filter_cutoff_level_absolute(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int nLine = pAction->getParameter1().toInt(&ok,10);
-	int filter_cutoff_param = pAction->getParameter2().toInt(&ok,10);
+bool MidiActionManager::filter_cutoff_level_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int nLine = pAction->nParameter1;
+	int filter_cutoff_param = pAction->nParameter2;
 
 	Song *pSong = pEngine->getSong();
 	InstrumentList *pInstrList = pSong->getInstrumentList();
@@ -798,34 +796,32 @@ bool MidiActionManager::filter_cutoff_level_absolute(Action * pAction, Hydrogen*
  * increments/decrements the BPM
  * this is useful if the bpm is set by a rotary control knob
  */
-bool MidiActionManager::bpm_cc_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+bool MidiActionManager::bpm_cc_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
 	//this Action should be triggered only by CC commands
 
-	bool ok;
-	int mult = pAction->getParameter1().toInt(&ok,10);
+	int mult = pAction->nParameter1;
 	//this value should be 1 to decrement and something other then 1 to increment the bpm
-	int cc_param = pAction->getParameter2().toInt(&ok,10);
+	int cc_param = pAction->nParameter2;
 
 	if( m_nLastBpmChangeCCParameter == -1) {
 		m_nLastBpmChangeCCParameter = cc_param;
 	}
 
-	Song* pSong = pEngine->getSong();
-
-	if ( m_nLastBpmChangeCCParameter >= cc_param && pSong->getBpm()  < 300) {
-		pEngine->setBPM( pSong->getBpm() - 1*mult );
-	}
+	bool bDecrease = m_nLastBpmChangeCCParameter >= cc_param;
+	m_nLastBpmChangeCCParameter = cc_param;
 
-	if ( m_nLastBpmChangeCCParameter < cc_param && pSong->getBpm()  > 40 ) {
-		pEngine->setBPM( pSong->getBpm() + 1*mult );
-	}
+	AudioEngine::get_instance()->postCommand( [pEngine, bDecrease, mult]() {
+		Song* pSong = pEngine->getSong();
 
-	m_nLastBpmChangeCCParameter = cc_param;
+		if ( bDecrease && pSong->getBpm()  < 300) {
+			pEngine->setBPM( pSong->getBpm() - 1*mult );
+		}
 
-	AudioEngine::get_instance()->unlock();
+		if ( ! bDecrease && pSong->getBpm()  > 40 ) {
+			pEngine->setBPM( pSong->getBpm() + 1*mult );
+		}
+	} );
 
 	return true;
 }
@@ -834,77 +830,67 @@ bool MidiActionManager::bpm_cc_relative(Action * pAction, Hydrogen* pEngine, tar
  * increments/decrements the BPM
  * this is useful if the bpm is set by a rotary control knob
  */
-bool MidiActionManager::bpm_fine_cc_relative(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+bool MidiActionManager::bpm_fine_cc_relative(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 
 	//this Action should be triggered only by CC commands
-	bool ok;
-	int mult = pAction->getParameter1().toInt(&ok,10);
+	int mult = pAction->nParameter1;
 	//this value should be 1 to decrement and something other then 1 to increment the bpm
-	int cc_param = pAction->getParameter2().toInt(&ok,10);
+	int cc_param = pAction->nParameter2;
 
 	if( m_nLastBpmChangeCCParameter == -1) {
 		m_nLastBpmChangeCCParameter = cc_param;
 	}
 
-	Song* pSong = pEngine->getSong();
-
-	if ( m_nLastBpmChangeCCParameter >= cc_param && pSong->getBpm()  < 300) {
-		pEngine->setBPM( pSong->getBpm() - 0.01*mult );
-	}
+	bool bDecrease = m_nLastBpmChangeCCParameter >= cc_param;
+	m_nLastBpmChangeCCParameter = cc_param;
 
-	if ( m_nLastBpmChangeCCParameter < cc_param && pSong->getBpm()  > 40 ) {
-		pEngine->setBPM( pSong->getBpm() + 0.01*mult );
-	}
+	AudioEngine::get_instance()->postCommand( [pEngine, bDecrease, mult]() {
+		Song* pSong = pEngine->getSong();
 
-	m_nLastBpmChangeCCParameter = cc_param;
+		if ( bDecrease && pSong->getBpm()  < 300) {
+			pEngine->setBPM( pSong->getBpm() - 0.01*mult );
+		}
 
-	AudioEngine::get_instance()->unlock();
+		if ( ! bDecrease && pSong->getBpm()  > 40 ) {
+			pEngine->setBPM( pSong->getBpm() + 0.01*mult );
+		}
+	} );
 
 	return true;
 }
 
-bool MidiActionManager::bpm_increase(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-	bool ok;
-	int mult = pAction->getParameter1().toInt(&ok,10);
+bool MidiActionManager::bpm_increase(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int mult = pAction->nParameter1;
 
-	Song* pSong = pEngine->getSong();
-	pEngine->setBPM( pSong->getBpm() + 1*mult );
-
-	AudioEngine::get_instance()->unlock();
-	
-	EventQueue::get_instance()->push_event( EVENT_TEMPO_CHANGED, -1 );
+	AudioEngine::get_instance()->postCommand( [pEngine, mult]() {
+		Song* pSong = pEngine->getSong();
+		pEngine->setBPM( pSong->getBpm() + 1*mult );
+		EventQueue::get_instance()->push_event( EVENT_TEMPO_CHANGED, -1 );
+	} );
 
 	return true;
 }
 
-bool MidiActionManager::bpm_decrease(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+bool MidiActionManager::bpm_decrease(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int mult = pAction->nParameter1;
 
-	bool ok;
-	int mult = pAction->getParameter1().toInt(&ok,10);
-
-	Song* pSong = pEngine->getSong();
-	pEngine->setBPM( pSong->getBpm() - 1*mult );
-	
-	AudioEngine::get_instance()->unlock();
-	
-	EventQueue::get_instance()->push_event( EVENT_TEMPO_CHANGED, -1 );
+	AudioEngine::get_instance()->postCommand( [pEngine, mult]() {
+		Song* pSong = pEngine->getSong();
+		pEngine->setBPM( pSong->getBpm() - 1*mult );
+		EventQueue::get_instance()->push_event( EVENT_TEMPO_CHANGED, -1 );
+	} );
 
 	return true;
 }
 
-bool MidiActionManager::next_bar(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::next_bar(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->setPatternPos(pEngine->getPatternPos() +1 );
 	pEngine->setTimelineBpm();
 	return true;
 }
 
 
-bool MidiActionManager::previous_bar(Action * , Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::previous_bar(const CompiledAction * , Hydrogen* pEngine, targeted_element ) {
 	pEngine->setPatternPos(pEngine->getPatternPos() -1 );
 	pEngine->setTimelineBpm();
 	return true;
@@ -918,23 +904,26 @@ bool setSong( int songnumber, Hydrogen * pEngine ) {
 	return true;
 }
 
-bool MidiActionManager::playlist_song(Action * pAction, Hydrogen* pEngine, targeted_element ) {
-	bool ok;
-	int songnumber = pAction->getParameter1().toInt(&ok,10);
+bool MidiActionManager::playlist_song(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	int songnumber = pAction->nParameter1;
 	return setSong( songnumber, pEngine );
 }
 
-bool MidiActionManager::playlist_next_song(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::playlist_song_cc_absolute(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
+	return setSong( pAction->nParameter2, pEngine );
+}
+
+bool MidiActionManager::playlist_next_song(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	int songnumber = Playlist::get_instance()->getActiveSongNumber();
 	return setSong( ++songnumber, pEngine );
 }
 
-bool MidiActionManager::playlist_previous_song(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::playlist_previous_song(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	int songnumber = Playlist::get_instance()->getActiveSongNumber();
 	return setSong( --songnumber, pEngine );
 }
 
-bool MidiActionManager::record_ready(Action * pAction, Hydrogen* pEngine, targeted_element ) {
+bool MidiActionManager::record_ready(const CompiledAction * pAction, Hydrogen* pEngine, targeted_element ) {
 	if ( pEngine->getState() != STATE_PLAYING ) {
 		if (!Preferences::get_instance()->getRecordEvents()) {
 			Preferences::get_instance()->setRecordEvents(true);
@@ -946,7 +935,7 @@ bool MidiActionManager::record_ready(Action * pAction, Hydrogen* pEngine, target
 	return true;
 }
 
-bool MidiActionManager::record_strobe_toggle(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::record_strobe_toggle(const CompiledAction * , Hydrogen* , targeted_element ) {
 	if (!Preferences::get_instance()->getRecordEvents()) {
 		Preferences::get_instance()->setRecordEvents(true);
 	}
@@ -956,38 +945,59 @@ bool MidiActionManager::record_strobe_toggle(Action * , Hydrogen* , targeted_ele
 	return true;
 }
 
-bool MidiActionManager::record_strobe(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::record_strobe(const CompiledAction * , Hydrogen* , targeted_element ) {
 	if (!Preferences::get_instance()->getRecordEvents()) {
 		Preferences::get_instance()->setRecordEvents(true);
 	}
 	return true;
 }
 
-bool MidiActionManager::record_exit(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::record_exit(const CompiledAction * , Hydrogen* , targeted_element ) {
 	if (Preferences::get_instance()->getRecordEvents()) {
 		Preferences::get_instance()->setRecordEvents(false);
 	}
 	return true;
 }
 
-bool MidiActionManager::toggle_metronome(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::toggle_metronome(const CompiledAction * , Hydrogen* , targeted_element ) {
 	Preferences::get_instance()->m_bUseMetronome = !Preferences::get_instance()->m_bUseMetronome;
+	Preferences::get_instance()->publishRealtimeConfig();
 	return true;
 }
 
-bool MidiActionManager::undo_action(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::undo_action(const CompiledAction * , Hydrogen* , targeted_element ) {
 	EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 0);// 0 = undo
 	return true;
 }
 
-bool MidiActionManager::redo_action(Action * , Hydrogen* , targeted_element ) {
+bool MidiActionManager::redo_action(const CompiledAction * , Hydrogen* , targeted_element ) {
 	EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 1);// 1 = redo
 	return true;
 }
 
-bool MidiActionManager::handleAction( Action * pAction ) {
+void MidiActionManager::registerAction( const std::string& sName, action_f action, targeted_element element ) {
+	actionMap.insert(std::make_pair(sName, static_cast<int>(m_actionTable.size())));
+	m_actionTable.push_back(std::make_pair(action, element));
+}
+
+CompiledAction MidiActionManager::compile( Action* pAction ) const {
+	CompiledAction compiled = { -1, 0, 0 };
+	if( pAction == nullptr ) {
+		return compiled;
+	}
+
+	std::map<std::string, int>::const_iterator foundAction = actionMap.find(pAction->getType().toStdString());
+	if( foundAction != actionMap.end() ) {
+		compiled.nOpcode = foundAction->second;
+	}
+
+	compiled.nParameter1 = pAction->getParameter1().toInt(nullptr,10);
+	compiled.nParameter2 = pAction->getParameter2().toInt(nullptr,10);
 
-	Hydrogen *pEngine = Hydrogen::get_instance();
+	return compiled;
+}
+
+bool MidiActionManager::handleAction( Action * pAction ) {
 	/*
 		return false if action is null
 		(for example if no Action exists for an event)
@@ -996,14 +1006,15 @@ bool MidiActionManager::handleAction( Action * pAction ) {
 		return false;
 	}
 
-	QString sActionString = pAction->getType();
+	return handleAction( compile( pAction ) );
+}
 
-	std::map<std::string, std::pair<action_f, targeted_element> >::const_iterator foundAction = actionMap.find(sActionString.toStdString());
-	if( foundAction != actionMap.end() ) {
-		action_f action = foundAction->second.first;
-		targeted_element nElement = foundAction->second.second;
-		return (this->*action)(pAction, pEngine, nElement);
+bool MidiActionManager::handleAction( const CompiledAction& action ) {
+	if( action.nOpcode < 0 || action.nOpcode >= static_cast<int>(m_actionTable.size()) ) {
+		return false;
 	}
 
-	return false;
+	action_f handler = m_actionTable[ action.nOpcode ].first;
+	targeted_element nElement = m_actionTable[ action.nOpcode ].second;
+	return (this->*handler)(&action, Hydrogen::get_instance(), nElement);
 }
@@ -24,6 +24,7 @@
 #include <core/Object.h>
 #include <map>
 #include <string>
+#include <vector>
 #include <cassert>
 
 class Action : public H2Core::Object {
@@ -57,6 +58,24 @@ class Action : public H2Core::Object {
 		QString m_sParameter2;
 };
 
+/**
+ * Action resolved by MidiActionManager::compile().
+ *
+ * Instead of the type and parameters in text form it holds the index
+ * of the handler in the dispatch table of the MidiActionManager and
+ * the parameters already converted into integers. This way incoming
+ * MIDI messages can be handled without any lookup of strings,
+ * conversion, or allocation of memory.
+ */
+struct CompiledAction {
+	/** Index of the handler in the dispatch table of the
+		MidiActionManager or -1 if the type of the Action is not
+		known.*/
+	int nOpcode;
+	int nParameter1;
+	int nParameter2;
+};
+
 namespace H2Core
 {
 	class Hydrogen;
@@ -92,59 +111,74 @@ class MidiActionManager : public H2Core::Object
 			int _subId;
 		};
 
-		typedef bool (MidiActionManager::*action_f)(Action * , H2Core::Hydrogen * , targeted_element );
+		typedef bool (MidiActionManager::*action_f)(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
 		/**
-		 * Holds all Action identifiers which Hydrogen is able to
-		 * interpret.  
-		 *
-		 * It holds pointer to member function.
+		 * Maps all Action identifiers which Hydrogen is able to
+		 * interpret to the index of their handler in
+		 * #m_actionTable.
+		 */
+		std::map<std::string, int> actionMap;
+		/**
+		 * Dispatch table holding the pointer to member function and
+		 * the targeted element of each Action. Indexed by
+		 * CompiledAction::nOpcode.
 		 */
-		std::map<std::string, std::pair<action_f, targeted_element> > actionMap;
-
-		bool play(Action * , H2Core::Hydrogen * , targeted_element );
-		bool play_stop_pause_toggle(Action * , H2Core::Hydrogen * , targeted_element );
-		bool stop(Action * , H2Core::Hydrogen * , targeted_element );
-		bool pause(Action * , H2Core::Hydrogen * , targeted_element );
-		bool record_ready(Action * , H2Core::Hydrogen * , targeted_element );
-		bool record_strobe_toggle(Action * , H2Core::Hydrogen * , targeted_element );
-		bool record_strobe(Action * , H2Core::Hydrogen * , targeted_element );
-		bool record_exit(Action * , H2Core::Hydrogen * , targeted_element );
-		bool mute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool unmute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool mute_toggle(Action * , H2Core::Hydrogen * , targeted_element );
-		bool strip_mute_toggle(Action * , H2Core::Hydrogen * , targeted_element );
-		bool strip_solo_toggle(Action * , H2Core::Hydrogen * , targeted_element );
-		bool next_bar(Action * , H2Core::Hydrogen * , targeted_element );
-		bool previous_bar(Action * , H2Core::Hydrogen * , targeted_element );
-		bool bpm_increase(Action * , H2Core::Hydrogen * , targeted_element );
-		bool bpm_decrease(Action * , H2Core::Hydrogen * , targeted_element );
-		bool bpm_cc_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool bpm_fine_cc_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool master_volume_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool master_volume_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool strip_volume_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool strip_volume_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool effect_level_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool effect_level_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_next_pattern(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_only_next_pattern(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_next_pattern_cc_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_next_pattern_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_and_play_pattern(Action * , H2Core::Hydrogen * , targeted_element );
-		bool pan_relative(Action * , H2Core::Hydrogen * , targeted_element );
-		bool pan_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool filter_cutoff_level_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool beatcounter(Action * , H2Core::Hydrogen * , targeted_element );
-		bool tap_tempo(Action * , H2Core::Hydrogen * , targeted_element );
-		bool playlist_song(Action * , H2Core::Hydrogen * , targeted_element );
-		bool playlist_next_song(Action * , H2Core::Hydrogen * , targeted_element );
-		bool playlist_previous_song(Action * , H2Core::Hydrogen * , targeted_element );
-		bool toggle_metronome(Action * , H2Core::Hydrogen * , targeted_element );
-		bool select_instrument(Action * , H2Core::Hydrogen * , targeted_element );
-		bool undo_action(Action * , H2Core::Hydrogen * , targeted_element );
-		bool redo_action(Action * , H2Core::Hydrogen * , targeted_element );
-		bool gain_level_absolute(Action * , H2Core::Hydrogen * , targeted_element );
-		bool pitch_level_absolute(Action * , H2Core::Hydrogen * , targeted_element );
+		std::vector<std::pair<action_f, targeted_element> > m_actionTable;
+
+		void registerAction( const std::string& sName, action_f action, targeted_element element );
+
+		bool play(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool play_stop_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool play_pause_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool stop(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool pause(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool record_ready(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool record_strobe_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool record_strobe(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool record_exit(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool mute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool unmute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool mute_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool strip_mute_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool strip_solo_toggle(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool next_bar(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool previous_bar(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool bpm_increase(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool bpm_decrease(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool bpm_cc_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool bpm_fine_cc_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool master_volume_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool master_volume_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool strip_volume_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool strip_volume_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool effect_level_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool effect_level_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_next_pattern(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_only_next_pattern(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_next_pattern_cc_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_next_pattern_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_and_play_pattern(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool pan_relative(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool pan_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool filter_cutoff_level_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool beatcounter(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool tap_tempo(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool playlist_song(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		/** Same as playlist_song() but the song number is taken from
+			the value of the CC or program change message.*/
+		bool playlist_song_cc_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool playlist_next_song(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool playlist_previous_song(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool toggle_metronome(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool select_instrument(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool undo_action(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool redo_action(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		/** Shared by play_stop_toggle() and play_pause_toggle().
+			@a bRewind tells whether to return to the beginning of
+			the song when stopping.*/
+		bool play_toggle( H2Core::Hydrogen * , bool bRewind );
+		bool gain_level_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
+		bool pitch_level_absolute(const CompiledAction * , H2Core::Hydrogen * , targeted_element );
 
 		QStringList eventList;
 
@@ -158,6 +192,22 @@ class MidiActionManager : public H2Core::Object
 		 * are needed to carry the desired action.
 		 */
 		bool handleAction( Action * );
+		/**
+		 * Executes an Action which was already resolved using
+		 * compile().
+		 *
+		 * Used for incoming MIDI messages. It does neither look
+		 * up nor convert any strings.
+		 */
+		bool handleAction( const CompiledAction& action );
+		/**
+		 * Resolves the type of @a pAction into the index of its
+		 * handler and converts its parameters into integers.
+		 *
+		 * \return Compiled action with a CompiledAction::nOpcode
+		 * of -1 if @a pAction is nullptr or of unknown type.
+		 */
+		CompiledAction compile( Action* pAction ) const;
 		/**
 		 * If #__instance equals 0, a new MidiActionManager
 		 * singleton will be created and stored in it.
@@ -170,6 +220,8 @@ class MidiActionManager : public H2Core::Object
 		 * singleton stored in #__instance.
 		 */
 		static MidiActionManager* get_instance() { assert(__instance); return __instance; }
+		/** \return true if the singleton was already created.*/
+		static bool is_created() { return __instance != nullptr; }
 
 		QStringList getActionList(){
 			return actionList;
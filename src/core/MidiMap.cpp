@@ -23,6 +23,7 @@
 #include <core/MidiAction.h>
 #include "MidiMap.h"
 #include <map>
+#include <thread>
 #include <QMutexLocker>
 
 /**
@@ -44,8 +45,17 @@
 MidiMap * MidiMap::__instance = nullptr;
 const char* MidiMap::__class_name = "MidiMap";
 
+/** Number of entries in the table of compiled actions.*/
+static const int nBindings = 257;
+/** Index of the first CC action in the table of compiled actions.*/
+static const int nCCBindingsOffset = 128;
+/** Index of the program change action in the table of compiled actions.*/
+static const int nPCBinding = 256;
+
 MidiMap::MidiMap()
 	: Object( __class_name )
+	, m_pBindings( nullptr )
+	, m_nBindingReaders( 0 )
 {
 	__instance = this;
 	QMutexLocker mx(&__mutex);
@@ -56,6 +66,8 @@ MidiMap::MidiMap()
 		__cc_array[ note ] = new Action("NOTHING");
 	}
 	__pc_action = new Action("NOTHING");
+
+	publishBindings();
 }
 
 MidiMap::~MidiMap()
@@ -74,6 +86,8 @@ MidiMap::~MidiMap()
 	}
 	delete __pc_action;
 
+	delete[] m_pBindings.exchange( nullptr );
+
 	__instance = nullptr;
 }
 
@@ -115,6 +129,8 @@ void MidiMap::reset()
 
 	delete __pc_action;
 	__pc_action = new Action("NOTHING");
+
+	publishBindings();
 }
 
 
@@ -147,6 +163,7 @@ void MidiMap::registerNoteEvent( int note, Action* pAction )
 	if( note >= 0 && note < 128 ) {
 		delete __note_array[ note ];
 		__note_array[ note ] = pAction;
+		publishBindings();
 	}
 }
 
@@ -160,6 +177,7 @@ void MidiMap::registerCCEvent( int parameter , Action * pAction ){
 	{
 		delete __cc_array[ parameter ];
 		__cc_array[ parameter ] = pAction;
+		publishBindings();
 	}
 }
 
@@ -203,6 +221,7 @@ void MidiMap::registerPCEvent( Action * pAction ){
 	QMutexLocker mx(&__mutex);
 	delete __pc_action;
 	__pc_action = pAction;
+	publishBindings();
 }
 
 /**
@@ -246,3 +265,84 @@ Action * MidiMap::getPCAction()
 	return __pc_action;
 }
 
+
+void MidiMap::compileActions()
+{
+	QMutexLocker mx(&__mutex);
+	publishBindings();
+}
+
+void MidiMap::publishBindings()
+{
+	CompiledAction* pBindings = new CompiledAction[ nBindings ];
+
+	// Before the MidiActionManager was created all actions are
+	// compiled as unknown ones. It will call compileActions() later
+	// on.
+	MidiActionManager* pManager = nullptr;
+	if ( MidiActionManager::is_created() ) {
+		pManager = MidiActionManager::get_instance();
+	}
+
+	for ( int i = 0; i < 128; i++ ) {
+		if ( pManager != nullptr ) {
+			pBindings[ i ] = pManager->compile( __note_array[ i ] );
+			pBindings[ nCCBindingsOffset + i ] = pManager->compile( __cc_array[ i ] );
+		} else {
+			pBindings[ i ] = { -1, 0, 0 };
+			pBindings[ nCCBindingsOffset + i ] = { -1, 0, 0 };
+		}
+	}
+	if ( pManager != nullptr ) {
+		pBindings[ nPCBinding ] = pManager->compile( __pc_action );
+	} else {
+		pBindings[ nPCBinding ] = { -1, 0, 0 };
+	}
+
+	CompiledAction* pOldBindings = m_pBindings.exchange( pBindings );
+
+	// Readers only hold the table for copying a single entry. A
+	// reader starting after the exchange does already get the new
+	// one.
+	while ( m_nBindingReaders.load() != 0 ) {
+		std::this_thread::yield();
+	}
+	delete[] pOldBindings;
+}
+
+CompiledAction MidiMap::getCompiledAction( int nIndex )
+{
+	CompiledAction action = { -1, 0, 0 };
+
+	m_nBindingReaders.fetch_add( 1 );
+	CompiledAction* pBindings = m_pBindings.load();
+	if ( pBindings != nullptr ) {
+		action = pBindings[ nIndex ];
+	}
+	m_nBindingReaders.fetch_sub( 1 );
+
+	return action;
+}
+
+CompiledAction MidiMap::getCompiledNoteAction( int note )
+{
+	if ( note < 0 || note >= 128 ) {
+		CompiledAction action = { -1, 0, 0 };
+		return action;
+	}
+	return getCompiledAction( note );
+}
+
+CompiledAction MidiMap::getCompiledCCAction( int parameter )
+{
+	if ( parameter < 0 || parameter >= 128 ) {
+		CompiledAction action = { -1, 0, 0 };
+		return action;
+	}
+	return getCompiledAction( nCCBindingsOffset + parameter );
+}
+
+CompiledAction MidiMap::getCompiledPCAction()
+{
+	return getCompiledAction( nPCBinding );
+}
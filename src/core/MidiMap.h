@@ -24,13 +24,13 @@
 
 
 #include <map>
+#include <atomic>
 #include <cassert>
 #include <core/Object.h>
+#include <core/MidiAction.h>
 
 #include <QtCore/QMutex>
 
-class Action;
-
 class MidiMap : public H2Core::Object
 {
 	H2_OBJECT
@@ -75,6 +75,27 @@ class MidiMap : public H2Core::Object
 		Action* getNoteAction( int note );
 		Action* getCCAction( int parameter );
 		Action* getPCAction();
+
+		/**
+		 * Compiled counterparts of getNoteAction(),
+		 * getCCAction(), and getPCAction() used to handle incoming
+		 * MIDI messages.
+		 *
+		 * They are read from a table which is republished on each
+		 * change of the map. Reading does neither acquire a lock
+		 * nor allocate memory.
+		 */
+		CompiledAction getCompiledNoteAction( int note );
+		CompiledAction getCompiledCCAction( int parameter );
+		CompiledAction getCompiledPCAction();
+
+		/**
+		 * Recompiles all note, CC, and program change actions.
+		 *
+		 * Called by the MidiActionManager once it was created since
+		 * actions registered before could not be resolved.
+		 */
+		void compileActions();
 		
 		int findCCValueByActionParam1( QString actionType, QString param1 ) const;
 		int findCCValueByActionType( QString actionType ) const;
@@ -83,11 +104,27 @@ class MidiMap : public H2Core::Object
 	private:
 		MidiMap();
 
+		/**
+		 * Compiles all note, CC, and program change actions into a
+		 * new table, publishes it, and frees the previous one once
+		 * no reader is accessing it anymore.
+		 *
+		 * Has to be called while holding #__mutex.
+		 */
+		void publishBindings();
+		CompiledAction getCompiledAction( int nIndex );
+
 		Action* __note_array[ 128 ];
 		Action* __cc_array[ 128 ];
 		Action* __pc_action;
 
 		map_t mmcMap;
 		QMutex __mutex;
+
+		/** Table of the compiled note (0-127), CC (128-255), and
+			program change (256) actions.*/
+		std::atomic<CompiledAction*> m_pBindings;
+		/** Number of threads currently reading #m_pBindings.*/
+		std::atomic<int> m_nBindingReaders;
 };
 #endif
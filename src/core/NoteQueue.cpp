@@ -0,0 +1,178 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/NoteQueue.h>
+
+#include <core/Basics/Note.h>
+#include <core/Helpers/TickTime.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+static_assert( ( NOTE_QUEUE_BUCKETS & ( NOTE_QUEUE_BUCKETS - 1 ) ) == 0,
+			   "NOTE_QUEUE_BUCKETS has to be a power of two" );
+
+NoteQueue::NoteQueue()
+	: m_nShift( 6 )
+	, m_nCursor( 0 )
+	, m_nInWheel( 0 )
+	, m_nSequence( 0 )
+{
+	// Avoid allocations in the realtime thread for common densities.
+	for ( auto& bucket : m_buckets ) {
+		bucket.reserve( 16 );
+	}
+}
+
+NoteQueue::~NoteQueue()
+{
+}
+
+void NoteQueue::setLookahead( int nFrames )
+{
+	int nShift = 0;
+	while ( ( static_cast<long long>( NOTE_QUEUE_BUCKETS ) << nShift ) <
+			2 * static_cast<long long>( nFrames ) ) {
+		++nShift;
+	}
+
+	if ( nShift == m_nShift ) {
+		return;
+	}
+
+	std::vector<Entry> entries;
+	entries.reserve( size() );
+	for ( auto& bucket : m_buckets ) {
+		entries.insert( entries.end(), bucket.begin(), bucket.end() );
+		bucket.clear();
+	}
+	entries.insert( entries.end(), m_overflow.begin(), m_overflow.end() );
+	m_overflow.clear();
+	m_nInWheel = 0;
+	m_nShift = nShift;
+
+	if ( entries.empty() ) {
+		return;
+	}
+
+	// The sequence numbers are kept, so notes sharing a frame stay
+	// in order.
+	m_nCursor = std::min_element( entries.begin(), entries.end(),
+								  []( const Entry& a, const Entry& b ) {
+									  return a.nFrame < b.nFrame; } )->nFrame >> m_nShift;
+	for ( const auto& entry : entries ) {
+		insert( entry );
+	}
+}
+
+void NoteQueue::push( Note* pNote, int64_t nTickSize )
+{
+	Entry entry;
+	entry.nFrame = TickTime::frameAtTick( pNote->get_position(), nTickSize ) +
+		pNote->get_humanize_delay();
+	entry.nSequence = m_nSequence++;
+	entry.pNote = pNote;
+
+	if ( empty() ) {
+		m_nCursor = entry.nFrame >> m_nShift;
+	}
+	insert( entry );
+}
+
+void NoteQueue::insert( const Entry& entry )
+{
+	long long nBucket = std::max( entry.nFrame >> m_nShift, m_nCursor );
+	if ( nBucket >= m_nCursor + NOTE_QUEUE_BUCKETS ) {
+		m_overflow.push_back( entry );
+		return;
+	}
+
+	// Skip all entries to be popped before the new one. Since its
+	// sequence number is the largest, this includes the ones of the
+	// same frame.
+	auto& bucket = m_buckets[ nBucket & ( NOTE_QUEUE_BUCKETS - 1 ) ];
+	auto it = bucket.end();
+	while ( it != bucket.begin() &&
+			( ( it - 1 )->nFrame < entry.nFrame ||
+			  ( ( it - 1 )->nFrame == entry.nFrame &&
+				( it - 1 )->nSequence < entry.nSequence ) ) ) {
+		--it;
+	}
+	bucket.insert( it, entry );
+	++m_nInWheel;
+}
+
+void NoteQueue::advance()
+{
+	if ( empty() ) {
+		return;
+	}
+
+	while ( m_buckets[ m_nCursor & ( NOTE_QUEUE_BUCKETS - 1 ) ].empty() ) {
+		if ( m_nInWheel == 0 ) {
+			// Only notes far ahead are left. Jump right to them.
+			std::vector<Entry> overflow;
+			overflow.swap( m_overflow );
+			m_nCursor = std::min_element( overflow.begin(), overflow.end(),
+										  []( const Entry& a, const Entry& b ) {
+											  return a.nFrame < b.nFrame; } )->nFrame >> m_nShift;
+			for ( const auto& entry : overflow ) {
+				insert( entry );
+			}
+			continue;
+		}
+
+		++m_nCursor;
+
+		if ( ! m_overflow.empty() ) {
+			// The bucket at the end of the wheel just became
+			// available.
+			auto it = std::partition( m_overflow.begin(), m_overflow.end(),
+									  [&]( const Entry& entry ) {
+										  return ( entry.nFrame >> m_nShift ) >=
+											  m_nCursor + NOTE_QUEUE_BUCKETS; } );
+			std::vector<Entry> entries( it, m_overflow.end() );
+			m_overflow.erase( it, m_overflow.end() );
+			for ( const auto& entry : entries ) {
+				insert( entry );
+			}
+		}
+	}
+}
+
+Note* NoteQueue::top()
+{
+	advance();
+	return m_buckets[ m_nCursor & ( NOTE_QUEUE_BUCKETS - 1 ) ].back().pNote;
+}
+
+void NoteQueue::pop()
+{
+	advance();
+	m_buckets[ m_nCursor & ( NOTE_QUEUE_BUCKETS - 1 ) ].pop_back();
+	--m_nInWheel;
+}
+
+};
@@ -0,0 +1,124 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef NOTE_QUEUE_H
+#define NOTE_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+/** Number of buckets of the H2Core::NoteQueue. Has to be a power of
+	two.*/
+#define NOTE_QUEUE_BUCKETS 256
+
+namespace H2Core
+{
+
+class Note;
+
+/**
+ * Timing wheel holding the notes scheduled by
+ * audioEngine_updateNoteQueue() until audioEngine_process_playNotes()
+ * hands them to the Sampler.
+ *
+ * Notes are ordered by the frame they start at, including their
+ * humanize delay, just like the former std::priority_queue. The frame
+ * is computed once in push() instead of each time two notes are
+ * compared. Each of the #NOTE_QUEUE_BUCKETS buckets covers a
+ * power-of-two number of frames chosen in setLookahead() so the whole
+ * wheel spans the lookahead window. Pushing a note does therefore
+ * only touch the handful of notes sharing its bucket and popping is
+ * constant time. Notes sharing a frame are popped in the order they
+ * were pushed.
+ *
+ * Notes beyond the end of the wheel are kept aside and moved into it
+ * once it advanced far enough. Notes prior to its beginning are put
+ * in the first bucket.
+ *
+ * Just like the container it replaces it is no H2Core::Object, since
+ * it is a static instance.
+ */
+class NoteQueue
+{
+public:
+	NoteQueue();
+	~NoteQueue();
+
+	/**
+	 * Adjusts the span of the buckets so the wheel covers at least
+	 * twice @a nFrames frames. Already queued notes are
+	 * redistributed in case it changed.
+	 *
+	 * \param nFrames Lookahead plus buffer size in frames.
+	 */
+	void setLookahead( int nFrames );
+
+	/** Queues @a pNote using the fixed point @a nTickSize, see
+		TickTime, to convert its position into frames.*/
+	void push( Note* pNote, int64_t nTickSize );
+	/** \return Note starting first. Must not be called if the queue
+		is empty.*/
+	Note* top();
+	/** Removes the note returned by top().*/
+	void pop();
+
+	bool empty() const;
+	int size() const;
+
+private:
+	struct Entry {
+		long long nFrame;
+		uint64_t nSequence;
+		Note* pNote;
+	};
+
+	/** Puts @a entry in its bucket or #m_overflow.*/
+	void insert( const Entry& entry );
+	/** Moves #m_nCursor to the first non-empty bucket.*/
+	void advance();
+
+	/** Each bucket is sorted in descending order, so the next note
+		is at its back.*/
+	std::vector<Entry> m_buckets[ NOTE_QUEUE_BUCKETS ];
+	/** Notes beyond the end of the wheel.*/
+	std::vector<Entry> m_overflow;
+	/** log2 of the number of frames covered by a bucket.*/
+	int m_nShift;
+	/** Absolute index of the first bucket of the wheel.*/
+	long long m_nCursor;
+	/** Number of notes in #m_buckets.*/
+	int m_nInWheel;
+	uint64_t m_nSequence;
+};
+
+inline bool NoteQueue::empty() const {
+	return m_nInWheel == 0 && m_overflow.empty();
+}
+
+inline int NoteQueue::size() const {
+	return m_nInWheel + m_overflow.size();
+}
+
+};
+
+#endif
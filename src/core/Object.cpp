@@ -22,10 +22,18 @@
 
 #include "core/Object.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <sstream>
 #include <iomanip>
 #include <cstdlib>
+#include <vector>
+
+/** Number of entries of the instance counting map. Has to be a power
+	of two and well above the number of classes derived from Object.*/
+#define MAX_OBJECT_CLASSES 2048
 
 
 /**
@@ -45,16 +53,14 @@ namespace H2Core {
 
 Logger* Object::__logger = nullptr;
 bool Object::__count = false;
-unsigned Object::__objects_count = 0;
-pthread_mutex_t Object::__mutex;
-Object::object_map_t Object::__objects_map;
+std::atomic<unsigned> Object::__objects_count( 0 );
+Object::obj_cpt_t Object::__objects_map[ MAX_OBJECT_CLASSES ];
 QString Object::sPrintIndention = "  ";
 
 int Object::bootstrap( Logger* logger, bool count ) {
 	if( __logger==nullptr && logger!=nullptr ) {
 		__logger = logger;
 		__count = count;
-		pthread_mutex_init( &__mutex, nullptr );
 		return 0;
 	}
 	return 1;
@@ -88,15 +94,44 @@ void Object::set_count( bool flag ) {
 #endif
 }
 
+Object::obj_cpt_t* Object::find_object_entry( const char* class_name, bool create ) {
+	// Class names are static strings. Their addresses are unique
+	// and serve as keys.
+	uintptr_t hash = reinterpret_cast<uintptr_t>( class_name );
+	hash ^= hash >> 17;
+	hash *= 0x9e3779b1u;
+	for ( size_t probe = 0; probe < MAX_OBJECT_CLASSES; ++probe ) {
+		obj_cpt_t* entry = &__objects_map[ ( hash + probe ) & ( MAX_OBJECT_CLASSES - 1 ) ];
+		const char* key = entry->class_name.load( std::memory_order_acquire );
+		if ( key == class_name ) {
+			return entry;
+		}
+		if ( key == nullptr ) {
+			if ( !create ) {
+				return nullptr;
+			}
+			if ( entry->class_name.compare_exchange_strong( key, class_name,
+															 std::memory_order_acq_rel ) ||
+				 key == class_name ) {
+				return entry;
+			}
+			// Another class claimed the entry in the meantime.
+		}
+	}
+	return nullptr;
+}
+
 inline void Object::add_object( const Object* obj, bool copy ) {
 #ifdef H2CORE_HAVE_DEBUG
 	const char* class_name = ( ( Object* )obj )->class_name();
 	if( __logger && __logger->should_log( Logger::Constructors ) ) __logger->log( Logger::Debug, nullptr, class_name, ( copy ? "Copy Constructor" : "Constructor" ) );
-	pthread_mutex_lock( &__mutex );
-	//if( __objects_map.size()==0) atexit( Object::write_objects_map_to_cerr );
-	__objects_count++;
-	__objects_map[ class_name ].constructed++;
-	pthread_mutex_unlock( &__mutex );
+	obj_cpt_t* entry = find_object_entry( class_name, true );
+	assert( entry != nullptr );
+	if ( entry == nullptr ) {
+		return;
+	}
+	__objects_count.fetch_add( 1, std::memory_order_relaxed );
+	entry->constructed.fetch_add( 1, std::memory_order_relaxed );
 #endif
 }
 
@@ -104,8 +139,8 @@ inline void Object::del_object( const Object* obj ) {
 #ifdef H2CORE_HAVE_DEBUG
 	const char* class_name = ( ( Object* )obj )->class_name();
 	if( __logger && __logger->should_log( Logger::Constructors ) ) __logger->log( Logger::Debug, nullptr, class_name, "Destructor" );
-	object_map_t::iterator it_count = __objects_map.find( class_name );
-	if ( it_count==__objects_map.end() ) {
+	obj_cpt_t* entry = find_object_entry( class_name, false );
+	if ( entry == nullptr ) {
 		if( __logger!=nullptr && __logger->should_log( Logger::Error ) ) {
 			std::stringstream msg;
 			msg << "the class " <<  class_name << " is not registered ! [" << obj << "]";
@@ -113,13 +148,9 @@ inline void Object::del_object( const Object* obj ) {
 		}
 		return;
 	}
-	assert( ( *it_count ).first == class_name );
-	pthread_mutex_lock( &__mutex );
-	assert( __objects_map[class_name].constructed > ( __objects_map[class_name].destructed ) );
-	__objects_count--;
-	assert( __objects_count>=0 );
-	__objects_map[ ( *it_count ).first ].destructed++;
-	pthread_mutex_unlock( &__mutex );
+	assert( entry->constructed.load() > entry->destructed.load() );
+	__objects_count.fetch_sub( 1, std::memory_order_relaxed );
+	entry->destructed.fetch_add( 1, std::memory_order_relaxed );
 #endif
 }
 void Object::write_objects_map_to( std::ostream& out ) {
@@ -133,18 +164,27 @@ void Object::write_objects_map_to( std::ostream& out ) {
 		return;
 	}
 	std::ostringstream o;
-	pthread_mutex_lock( &__mutex );
-	object_map_t::iterator it = __objects_map.begin();
-	while ( it != __objects_map.end() ) {
-		o << "\t[ " << std::setw( 30 ) << ( *it ).first << " ]\t" << std::setw( 6 ) << ( *it ).second.constructed << "\t" << std::setw( 6 ) << ( *it ).second.destructed
-		  << "\t" << std::setw( 6 ) << ( *it ).second.constructed - ( *it ).second.destructed << std::endl;
-		it++;
+	// Same order as the std::map keyed by the class name pointers
+	// used previously.
+	std::vector<const obj_cpt_t*> entries;
+	for ( size_t ii = 0; ii < MAX_OBJECT_CLASSES; ++ii ) {
+		if ( __objects_map[ ii ].class_name.load( std::memory_order_acquire ) != nullptr ) {
+			entries.push_back( &__objects_map[ ii ] );
+		}
+	}
+	std::sort( entries.begin(), entries.end(), []( const obj_cpt_t* a, const obj_cpt_t* b ) {
+		return std::less<const char*>()( a->class_name.load(), b->class_name.load() );
+	} );
+	for ( const auto entry : entries ) {
+		unsigned constructed = entry->constructed.load( std::memory_order_relaxed );
+		unsigned destructed = entry->destructed.load( std::memory_order_relaxed );
+		o << "\t[ " << std::setw( 30 ) << entry->class_name.load() << " ]\t" << std::setw( 6 ) << constructed << "\t" << std::setw( 6 ) << destructed
+		  << "\t" << std::setw( 6 ) << constructed - destructed << std::endl;
 	}
-	pthread_mutex_unlock( &__mutex );
 #ifndef WIN32
 	out << std::endl << "\033[35m";
 #endif
-	out << "Objects map :" << std::setw( 30 ) << "class\t" << "constr   destr   alive" << std::endl << o.str() << "Total : " << std::setw( 6 ) << __objects_count << " objects.";
+	out << "Objects map :" << std::setw( 30 ) << "class\t" << "constr   destr   alive" << std::endl << o.str() << "Total : " << std::setw( 6 ) << __objects_count.load() << " objects.";
 #ifndef WIN32
 	out << "\033[0m";
 #endif
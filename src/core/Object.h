@@ -28,6 +28,7 @@
 #include "core/Globals.h"
 
 #include <unistd.h>
+#include <atomic>
 #include <iostream>
 #include <QtCore>
 #include <QDebug>
@@ -53,7 +54,7 @@ class Object {
 		 */
 		static void set_count( bool flag );
 		static bool count_active()              { return __count; }             ///< return true if class instances counting is enabled
-		static unsigned objects_count()         { return __objects_count; }     ///< return the number of objects
+		static unsigned objects_count()         { return __objects_count.load( std::memory_order_relaxed ); }     ///< return the number of objects
 
 		/**
 		 * output the full objects map to a given ostream
@@ -103,19 +104,32 @@ class Object {
 		 */
 		static void add_object( const Object* obj, bool copy );
 
-		/** an objects class map item type */
+		/**
+		 * an objects class map item type
+		 *
+		 * The counters are atomic and the class name is registered
+		 * by a single compare-and-swap. This way objects created on
+		 * the realtime threads (like Note) are counted without
+		 * locking or allocating.
+		 */
 		typedef struct {
-			unsigned constructed;
-			unsigned destructed;
+			std::atomic<const char*> class_name;
+			std::atomic<unsigned> constructed;
+			std::atomic<unsigned> destructed;
 		} obj_cpt_t;
-		/** the objects class map type */
-		typedef std::map<const char*, obj_cpt_t> object_map_t;
+		/**
+		 * find the entry of the given class name within
+		 * __objects_map using open addressing
+		 * \param class_name the class name to look for
+		 * \param create whether to register the class name if not found
+		 * \return nullptr if not found or the map is full
+		 */
+		static obj_cpt_t* find_object_entry( const char* class_name, bool create );
 
 		const char* __class_name;               ///< the object class name
 		static bool __count;                    ///< should we count class instances
-		static unsigned __objects_count;        ///< total objects count
-		static object_map_t __objects_map;      ///< objects classes and instances count structure
-		static pthread_mutex_t __mutex;         ///< yeah this has to be thread safe
+		static std::atomic<unsigned> __objects_count;   ///< total objects count
+		static obj_cpt_t __objects_map[];      ///< objects classes and instances count structure
 
 	protected:
 		static Logger* __logger;                ///< logger instance pointer
@@ -141,11 +155,14 @@ inline QDebug operator<<( QDebug d, std::shared_ptr<Object> o ) {
 	private: static const char* __class_name;                           \
 
 // LOG MACROS
-#define __LOG_METHOD(   lvl, msg )  if( __logger->should_log( (lvl) ) )                 { __logger->log( (lvl), class_name(), __FUNCTION__, msg ); }
-#define __LOG_CLASS(    lvl, msg )  if( logger()->should_log( (lvl) ) )                 { logger()->log( (lvl), class_name(), __FUNCTION__, msg ); }
-#define __LOG_OBJ(      lvl, msg )  if( __object->logger()->should_log( (lvl) ) )       { __object->logger()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
-#define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
-#define __LOG( logger,  lvl, msg )  if( (logger)->should_log( (lvl) ) )                 { (logger)->log( (lvl), 0, 0, msg ); }
+// The message is only evaluated if its level is compiled in and
+// enabled. Pass the whole formatting expression to the macro instead
+// of building the QString up front.
+#define __LOG_METHOD(   lvl, msg )  if( H2Core::Logger::compiled_in( (lvl) ) && __logger->should_log( (lvl) ) )                 { __logger->log( (lvl), class_name(), __FUNCTION__, msg ); }
+#define __LOG_CLASS(    lvl, msg )  if( H2Core::Logger::compiled_in( (lvl) ) && logger()->should_log( (lvl) ) )                 { logger()->log( (lvl), class_name(), __FUNCTION__, msg ); }
+#define __LOG_OBJ(      lvl, msg )  if( H2Core::Logger::compiled_in( (lvl) ) && __object->logger()->should_log( (lvl) ) )       { __object->logger()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
+#define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::compiled_in( (lvl) ) && H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
+#define __LOG( logger,  lvl, msg )  if( H2Core::Logger::compiled_in( (lvl) ) && (logger)->should_log( (lvl) ) )                 { (logger)->log( (lvl), 0, 0, msg ); }
 
 // Object instance method logging macros
 #define DEBUGLOG(x)     __LOG_METHOD( H2Core::Logger::Debug,   (x) );
@@ -171,6 +188,14 @@ inline QDebug operator<<( QDebug d, std::shared_ptr<Object> o ) {
 #define ___WARNINGLOG(x) __LOG_STATIC(H2Core::Logger::Warning,  (x) );
 #define ___ERRORLOG(x)  __LOG_STATIC( H2Core::Logger::Error,    (x) );
 
+// Realtime variants of the macros above taking a string literal
+// followed by up to four numerical arguments. See Logger::log_rt().
+#define __LOG_RT( lvl, ... )  if( H2Core::Logger::compiled_in( (lvl) ) && H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log_rt( (lvl), __PRETTY_FUNCTION__, __VA_ARGS__ ); }
+#define RT_DEBUGLOG(...)    __LOG_RT( H2Core::Logger::Debug,   __VA_ARGS__ );
+#define RT_INFOLOG(...)     __LOG_RT( H2Core::Logger::Info,    __VA_ARGS__ );
+#define RT_WARNINGLOG(...)  __LOG_RT( H2Core::Logger::Warning, __VA_ARGS__ );
+#define RT_ERRORLOG(...)    __LOG_RT( H2Core::Logger::Error,   __VA_ARGS__ );
+
 };
 
 #endif // H2C_OBJECT_H
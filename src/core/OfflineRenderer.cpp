@@ -0,0 +1,214 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/OfflineRenderer.h>
+#include <core/OfflineRendererC.h>
+
+#include <core/Hydrogen.h>
+#include <core/MidiMap.h>
+#include <core/Preferences.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/IO/OfflineDriver.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace H2Core
+{
+
+const char* OfflineRenderer::__class_name = "OfflineRenderer";
+
+void OfflineRenderer::bootstrap( const QString& sSysDataPath )
+{
+	if ( Hydrogen::is_created() ) {
+		return;
+	}
+
+	Logger* pLogger = Logger::bootstrap( Logger::Error );
+	Object::bootstrap( pLogger, false );
+	Filesystem::bootstrap( pLogger, sSysDataPath );
+	MidiMap::create_instance();
+	Preferences::create_instance();
+
+	// Changed for this process only. The preferences are not
+	// saved.
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_sMidiDriver = "";
+	pPref->setOscServerEnabled( false );
+
+	Hydrogen::create_instance();
+}
+
+OfflineRenderer::OfflineRenderer( unsigned nSampleRate )
+	: Object( __class_name )
+	, m_nSampleRate( nSampleRate )
+	, m_pDriver( nullptr )
+	, m_bFinished( false )
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+	stop();
+}
+
+bool OfflineRenderer::loadSong( const QString& sFilename )
+{
+	stop();
+
+	Song* pSong = Song::load( sFilename );
+	if ( pSong == nullptr ) {
+		ERRORLOG( QString( "Unable to load song [%1]" ).arg( sFilename ) );
+		return false;
+	}
+	Hydrogen::get_instance()->setSong( pSong );
+	return true;
+}
+
+bool OfflineRenderer::loadDrumkit( const QString& sName )
+{
+	stop();
+
+	Drumkit* pDrumkit = Drumkit::load_by_name( sName, true );
+	if ( pDrumkit == nullptr ) {
+		ERRORLOG( QString( "Unable to load drumkit [%1]" ).arg( sName ) );
+		return false;
+	}
+	Hydrogen::get_instance()->loadDrumkit( pDrumkit );
+	return true;
+}
+
+bool OfflineRenderer::start()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	if ( pSong == nullptr ) {
+		ERRORLOG( "No song loaded" );
+		return false;
+	}
+
+	InstrumentList* pInstrumentList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrumentList->size(); ++ii ) {
+		pInstrumentList->get( ii )->set_currently_exported( true );
+	}
+
+	m_pDriver = pHydrogen->startOfflineRender( m_nSampleRate );
+	return m_pDriver != nullptr;
+}
+
+void OfflineRenderer::stop()
+{
+	if ( m_pDriver != nullptr ) {
+		m_pDriver = nullptr;
+		Hydrogen::get_instance()->stopExportSession();
+	}
+	m_bFinished = false;
+}
+
+uint32_t OfflineRenderer::render( float* pOut_L, float* pOut_R, uint32_t nFrames )
+{
+	if ( m_bFinished ) {
+		return 0;
+	}
+	if ( m_pDriver == nullptr && ! start() ) {
+		m_bFinished = true;
+		return 0;
+	}
+
+	Dsp::disableDenormals();
+	uint32_t nRendered = m_pDriver->render( pOut_L, pOut_R, nFrames );
+	if ( m_pDriver->isFinished() ) {
+		// Restores the previous driver right away instead of
+		// leaving the engine idling in the session.
+		stop();
+		m_bFinished = true;
+	}
+	return nRendered;
+}
+
+bool OfflineRenderer::isFinished() const
+{
+	return m_bFinished;
+}
+
+void OfflineRenderer::rewind()
+{
+	stop();
+}
+
+};
+
+using namespace H2Core;
+
+struct h2_offline_renderer {
+	OfflineRenderer* pRenderer;
+};
+
+h2_offline_renderer* h2_offline_renderer_new( unsigned sample_rate,
+											  const char* sys_data_path )
+{
+	OfflineRenderer::bootstrap( sys_data_path != nullptr ?
+								QString::fromUtf8( sys_data_path ) : QString() );
+	return new h2_offline_renderer{ new OfflineRenderer( sample_rate ) };
+}
+
+void h2_offline_renderer_free( h2_offline_renderer* renderer )
+{
+	if ( renderer != nullptr ) {
+		delete renderer->pRenderer;
+		delete renderer;
+	}
+}
+
+int h2_offline_renderer_load_song( h2_offline_renderer* renderer, const char* filename )
+{
+	return renderer->pRenderer->loadSong( QString::fromUtf8( filename ) ) ? 1 : 0;
+}
+
+int h2_offline_renderer_load_drumkit( h2_offline_renderer* renderer, const char* name )
+{
+	return renderer->pRenderer->loadDrumkit( QString::fromUtf8( name ) ) ? 1 : 0;
+}
+
+unsigned long h2_offline_renderer_render( h2_offline_renderer* renderer,
+										  float* left, float* right,
+										  unsigned long frames )
+{
+	frames = std::min<unsigned long>( frames, std::numeric_limits<uint32_t>::max() );
+	return renderer->pRenderer->render( left, right, static_cast<uint32_t>( frames ) );
+}
+
+int h2_offline_renderer_is_finished( h2_offline_renderer* renderer )
+{
+	return renderer->pRenderer->isFinished() ? 1 : 0;
+}
+
+void h2_offline_renderer_rewind( h2_offline_renderer* renderer )
+{
+	renderer->pRenderer->rewind();
+}
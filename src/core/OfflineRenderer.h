@@ -0,0 +1,113 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_OFFLINE_RENDERER_H
+#define H2C_OFFLINE_RENDERER_H
+
+#include <core/Object.h>
+
+#include <QString>
+#include <inttypes.h>
+
+namespace H2Core
+{
+
+class OfflineDriver;
+
+/**
+ * Renders songs within the process of the caller, e.g. an
+ * application embedding hydrogen-core, without audio driver or
+ * export thread.
+ *
+ * The song is played by the same audio engine path used for the
+ * export. Instead of writing into a file, the main output is pulled
+ * block by block via render() into buffers of the caller, which are
+ * written by the engine directly.
+ *
+ * Since there is only one audio engine per process, all renderers
+ * share it and only one of them may be used at a time.
+ *
+ * A C interface is provided by OfflineRendererC.h.
+ */
+class OfflineRenderer : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/**
+	 * Sets up the logger, the file system, the Preferences, and
+	 * the Hydrogen singleton unless this was already done by the
+	 * caller. No audio or MIDI device is opened and the OSC server
+	 * is not started. Has to be called before creating a renderer.
+	 *
+	 * \param sSysDataPath Directory holding the system data of
+	 *   Hydrogen. The default location is used if empty.
+	 */
+	static void bootstrap( const QString& sSysDataPath = QString() );
+
+	OfflineRenderer( unsigned nSampleRate = 44100 );
+	~OfflineRenderer();
+
+	/** Replaces the current song by the one stored in @a
+		sFilename. A render in progress is stopped.*/
+	bool loadSong( const QString& sFilename );
+	/** Loads the installed drumkit @a sName into the current
+		song. A render in progress is stopped.*/
+	bool loadDrumkit( const QString& sName );
+
+	/**
+	 * Writes the next @a nFrames frames of the current song into
+	 * @a pOut_L and @a pOut_R. The first call starts at the
+	 * beginning of the song.
+	 *
+	 * The audio engine is run by the calling thread, which gets
+	 * denormals disabled.
+	 *
+	 * \return Number of frames written. It is smaller than @a
+	 * nFrames once the end of the song was reached and zero for all
+	 * further calls until rewind().
+	 */
+	uint32_t render( float* pOut_L, float* pOut_R, uint32_t nFrames );
+	/** Whether render() reached the end of the song.*/
+	bool isFinished() const;
+	/** Lets the next call of render() start at the beginning of the
+		song again.*/
+	void rewind();
+
+	unsigned getSampleRate() const {
+		return m_nSampleRate;
+	}
+
+private:
+	bool start();
+	/** Ends the session created by start() and restores the audio
+		driver set before.*/
+	void stop();
+
+	unsigned m_nSampleRate;
+	/** Owned by Hydrogen while a session is active.*/
+	OfflineDriver* m_pDriver;
+	bool m_bFinished;
+};
+
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_OFFLINE_RENDERER_C_H
+#define H2C_OFFLINE_RENDERER_C_H
+
+/*
+ * C interface of H2Core::OfflineRenderer.
+ *
+ * All strings are UTF-8 encoded. Functions returning int report
+ * success with 1 and failure with 0.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct h2_offline_renderer h2_offline_renderer;
+
+/* Bootstraps hydrogen-core on first use and creates a renderer
+   producing audio at sample_rate. sys_data_path may be NULL. */
+h2_offline_renderer* h2_offline_renderer_new( unsigned sample_rate,
+											  const char* sys_data_path );
+void h2_offline_renderer_free( h2_offline_renderer* renderer );
+
+int h2_offline_renderer_load_song( h2_offline_renderer* renderer, const char* filename );
+int h2_offline_renderer_load_drumkit( h2_offline_renderer* renderer, const char* name );
+
+/* Writes up to frames frames into left and right and returns the
+   number of frames written. Fewer are returned at the end of the
+   song. */
+unsigned long h2_offline_renderer_render( h2_offline_renderer* renderer,
+										  float* left, float* right,
+										  unsigned long frames );
+int h2_offline_renderer_is_finished( h2_offline_renderer* renderer );
+void h2_offline_renderer_rewind( h2_offline_renderer* renderer );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
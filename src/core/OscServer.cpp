@@ -22,8 +22,12 @@
 
 
 #include "core/Helpers/Filesystem.h"
+#include "core/Helpers/Threads.h"
 #include "core/Preferences.h"
 
+#include <chrono>
+#include <cstring>
+#include <vector>
 #include <pthread.h>
 #include <unistd.h>
 
@@ -33,8 +37,14 @@
 #include <lo/lo.h>
 #include <lo/lo_cpp.h>
 
+#include "core/Basics/Instrument.h"
 #include "core/Basics/InstrumentList.h"
+#include "core/Basics/Pattern.h"
+#include "core/Basics/PatternList.h"
+#include "core/AudioEngine.h"
 #include "core/OscServer.h"
+#include "core/ProcessProfiler.h"
+#include "core/Tracer.h"
 #include "core/CoreActionController.h"
 #include "core/EventQueue.h"
 #include "core/Hydrogen.h"
@@ -251,7 +261,9 @@ int OscServer::generic_handler(const char *	path,
 
 
 OscServer::OscServer( H2Core::Preferences* pPreferences ) : Object( __class_name ),
-															m_bInitialized( false )
+															m_bInitialized( false ),
+															m_bResendFeedback( false ),
+															m_bFeedbackThreadRunning( false )
 {
 	m_pPreferences = pPreferences;
 	
@@ -291,6 +303,8 @@ OscServer::OscServer( H2Core::Preferences* pPreferences ) : Object( __class_name
 
 OscServer::~OscServer(){
 
+	stopFeedbackThread();
+
 	for (std::list<lo_address>::iterator it=m_pClientRegistry.begin(); it != m_pClientRegistry.end(); ++it){
 		lo_address_free( *it );
 	}
@@ -685,6 +699,24 @@ void OscServer::JACK_TIMEBASE_MASTER_ACTIVATION_Handler(lo_arg **argv, int argc)
 	}
 }
 
+void OscServer::LINK_ACTIVATION_Handler(lo_arg **argv, int argc) {
+
+	auto pController = H2Core::Hydrogen::get_instance()->getCoreActionController();
+	pController->activateLink( argv[0]->f != 0 );
+}
+
+void OscServer::NETWORK_STEMS_ACTIVATION_Handler(lo_arg **argv, int argc) {
+
+	auto pController = H2Core::Hydrogen::get_instance()->getCoreActionController();
+	pController->activateNetworkStems( argv[0]->f != 0 );
+}
+
+void OscServer::METRICS_ACTIVATION_Handler(lo_arg **argv, int argc) {
+
+	auto pController = H2Core::Hydrogen::get_instance()->getCoreActionController();
+	pController->activateMetrics( argv[0]->f != 0 );
+}
+
 void OscServer::SONG_MODE_ACTIVATION_Handler(lo_arg **argv, int argc) {
 
 	auto pController = H2Core::Hydrogen::get_instance()->getCoreActionController();
@@ -710,6 +742,252 @@ void OscServer::RELOCATE_Handler(lo_arg **argv, int argc) {
 	H2Core::Hydrogen::get_instance()->getCoreActionController()->relocate( static_cast<int>(std::round( argv[0]->f ) ) );
 }
 
+void OscServer::PROCESS_PROFILE_Handler(lo_address source, lo_arg **argv, int argc) {
+
+	H2Core::ProcessProfiler* pProfiler = H2Core::AudioEngine::get_instance()->get_profiler();
+
+	for ( int ii = 0; ii < H2Core::ProcessProfiler::STAGE_COUNT; ++ii ) {
+		auto stage = static_cast<H2Core::ProcessProfiler::Stage>( ii );
+		H2Core::ProcessProfiler::Statistics statistics = pProfiler->getStatistics( stage );
+
+		lo_message reply = lo_message_new();
+		lo_message_add_string( reply, H2Core::ProcessProfiler::getStageName( stage ).toLocal8Bit().data() );
+		lo_message_add_float( reply, statistics.fMedian );
+		lo_message_add_float( reply, statistics.fPercentile99 );
+		lo_message_add_float( reply, statistics.fMax );
+		lo_send_message( source, "/Hydrogen/PROCESS_PROFILE", reply );
+		lo_message_free( reply );
+	}
+
+	lo_message reply = lo_message_new();
+	lo_message_add_string( reply, "Cycles" );
+	lo_message_add_float( reply, static_cast<float>( pProfiler->getCycles() ) );
+	lo_message_add_float( reply, static_cast<float>( pProfiler->getDroppedCycles() ) );
+	lo_send_message( source, "/Hydrogen/PROCESS_PROFILE", reply );
+	lo_message_free( reply );
+
+	reply = lo_message_new();
+	lo_message_add_string( reply, "Quiet voices" );
+	lo_message_add_float( reply, static_cast<float>( pProfiler->getQuietVoices() ) );
+	lo_send_message( source, "/Hydrogen/PROCESS_PROFILE", reply );
+	lo_message_free( reply );
+
+	if ( argc > 0 && argv[0]->f != 0 ) {
+		pProfiler->reset();
+	}
+}
+
+void OscServer::INSTRUMENT_PROFILE_Handler(lo_address source, lo_arg **argv, int argc) {
+
+	H2Core::AudioEngine* pAudioEngine = H2Core::AudioEngine::get_instance();
+	lo_bundle bundle = lo_bundle_new( LO_TT_IMMEDIATE );
+	lo_message message;
+
+	pAudioEngine->lock( RIGHT_HERE );
+
+	H2Core::Song* pSong = H2Core::Hydrogen::get_instance()->getSong();
+	if ( pSong == nullptr ) {
+		pAudioEngine->unlock();
+		lo_bundle_free_recursive( bundle );
+		return;
+	}
+
+	H2Core::InstrumentList* pInstrList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrList->size(); ++ii ) {
+		H2Core::Instrument* pInstr = pInstrList->get( ii );
+		H2Core::Instrument::RenderStats stats = pInstr->get_render_stats();
+
+		message = lo_message_new();
+		lo_message_add_string( message, pInstr->get_name().toLocal8Bit().data() );
+		lo_message_add_float( message, static_cast<float>( ii + 1 ) );
+		lo_message_add_float( message, static_cast<float>( stats.nVoices ) );
+		lo_message_add_float( message, static_cast<float>( stats.nFrames ) );
+		lo_message_add_float( message, static_cast<float>( stats.nResampledFrames ) );
+		lo_message_add_float( message, static_cast<float>( stats.nNanoseconds / 1e6 ) );
+		lo_bundle_add_message( bundle, "/Hydrogen/INSTRUMENT_PROFILE", message );
+	}
+
+	pAudioEngine->unlock();
+
+	lo_send_bundle( source, bundle );
+	lo_bundle_free_recursive( bundle );
+}
+
+void OscServer::TRACE_ACTIVATION_Handler(lo_arg **argv, int argc) {
+
+	H2Core::Tracer::setEnabled( argv[0]->f != 0 );
+}
+
+void OscServer::TRACE_DUMP_Handler(lo_arg **argv, int argc) {
+
+	QString sPath = QString::fromUtf8( &argv[0]->s );
+	if ( H2Core::Tracer::dump( sPath ) ) {
+		INFOLOG( QString( "Trace written to [%1]" ).arg( sPath ) );
+	} else {
+		ERRORLOG( QString( "Unable to write trace to [%1]" ).arg( sPath ) );
+	}
+}
+
+/** Reads a big-endian 32 bit word starting at @a pData.*/
+static uint32_t readWord( const unsigned char* pData )
+{
+	return ( static_cast<uint32_t>( pData[ 0 ] ) << 24 ) |
+		( static_cast<uint32_t>( pData[ 1 ] ) << 16 ) |
+		( static_cast<uint32_t>( pData[ 2 ] ) << 8 ) |
+		static_cast<uint32_t>( pData[ 3 ] );
+}
+
+static float readFloat( const unsigned char* pData )
+{
+	uint32_t nWord = readWord( pData );
+	float fValue;
+	std::memcpy( &fValue, &nWord, sizeof( float ) );
+	return fValue;
+}
+
+/** Decodes the records of the blob passed to the /Hydrogen/SCHEDULE_NOTES
+	messages and hands them to H2Core::Hydrogen::scheduleNotes().*/
+static void scheduleNotes( lo_arg **argv, bool bTicks )
+{
+	const int nRecordSize = 16;
+
+	lo_blob blob = reinterpret_cast<lo_blob>( argv[0] );
+	int nSize = lo_blob_datasize( blob );
+	if ( nSize % nRecordSize != 0 ) {
+		___ERRORLOG( QString( "Size of the blob [%1] is not a multiple of [%2]" )
+					 .arg( nSize ).arg( nRecordSize ) );
+		return;
+	}
+
+	const unsigned char* pData = static_cast<const unsigned char*>( lo_blob_dataptr( blob ) );
+	std::vector<H2Core::Hydrogen::ScheduledNote> notes( nSize / nRecordSize );
+	for ( auto& note : notes ) {
+		note.nInstrument = static_cast<int32_t>( readWord( pData ) );
+		note.fVelocity = readFloat( pData + 4 );
+		note.fPitch = readFloat( pData + 8 );
+		if ( bTicks ) {
+			note.fOffset = readFloat( pData + 12 );
+		} else {
+			note.fOffset = static_cast<float>( static_cast<int32_t>( readWord( pData + 12 ) ) );
+		}
+		pData += nRecordSize;
+	}
+
+	H2Core::Hydrogen::get_instance()->scheduleNotes( std::move( notes ), bTicks );
+}
+
+void OscServer::SCHEDULE_NOTES_Handler(lo_arg **argv, int argc) {
+
+	scheduleNotes( argv, false );
+}
+
+void OscServer::SCHEDULE_NOTES_TICKS_Handler(lo_arg **argv, int argc) {
+
+	scheduleNotes( argv, true );
+}
+
+void OscServer::MIXER_STATE_Handler(lo_address source, lo_arg **argv, int argc) {
+
+	H2Core::AudioEngine* pAudioEngine = H2Core::AudioEngine::get_instance();
+	lo_bundle bundle = lo_bundle_new( LO_TT_IMMEDIATE );
+	lo_message message;
+
+	pAudioEngine->lock( RIGHT_HERE );
+
+	H2Core::Song* pSong = H2Core::Hydrogen::get_instance()->getSong();
+	if ( pSong == nullptr ) {
+		pAudioEngine->unlock();
+		lo_bundle_free_recursive( bundle );
+		return;
+	}
+
+	message = lo_message_new();
+	lo_message_add_string( message, "Master" );
+	lo_message_add_float( message, pSong->getVolume() );
+	lo_message_add_float( message, static_cast<float>( pSong->getIsMuted() ) );
+	lo_bundle_add_message( bundle, "/Hydrogen/MIXER_STATE", message );
+
+	H2Core::InstrumentList* pInstrList = pSong->getInstrumentList();
+	for ( int ii = 0; ii < pInstrList->size(); ++ii ) {
+		H2Core::Instrument* pInstr = pInstrList->get( ii );
+
+		// Same conversion as used for /Hydrogen/PAN_ABSOLUTE.
+		float fPanValue;
+		if ( pInstr->get_pan_r() == 1.0 ) {
+			fPanValue = 1.0 - ( pInstr->get_pan_l() / 2.0 );
+		} else {
+			fPanValue = pInstr->get_pan_r() / 2.0;
+		}
+
+		message = lo_message_new();
+		lo_message_add_string( message, pInstr->get_name().toLocal8Bit().data() );
+		lo_message_add_float( message, static_cast<float>( ii + 1 ) );
+		lo_message_add_float( message, pInstr->get_volume() );
+		lo_message_add_float( message, fPanValue );
+		lo_message_add_float( message, static_cast<float>( pInstr->is_muted() ) );
+		lo_message_add_float( message, static_cast<float>( pInstr->is_soloed() ) );
+		lo_bundle_add_message( bundle, "/Hydrogen/MIXER_STATE", message );
+	}
+
+	pAudioEngine->unlock();
+
+	lo_send_bundle( source, bundle );
+	lo_bundle_free_recursive( bundle );
+}
+
+void OscServer::PATTERN_STATE_Handler(lo_address source, lo_arg **argv, int argc) {
+
+	H2Core::Hydrogen* pHydrogen = H2Core::Hydrogen::get_instance();
+	H2Core::AudioEngine* pAudioEngine = H2Core::AudioEngine::get_instance();
+	lo_bundle bundle = lo_bundle_new( LO_TT_IMMEDIATE );
+	lo_message message;
+
+	pAudioEngine->lock( RIGHT_HERE );
+
+	H2Core::Song* pSong = pHydrogen->getSong();
+	if ( pSong == nullptr ) {
+		pAudioEngine->unlock();
+		lo_bundle_free_recursive( bundle );
+		return;
+	}
+
+	H2Core::PatternList* pPatternList = pSong->getPatternList();
+	H2Core::PatternList* pPlayingPatterns = pHydrogen->getCurrentPatternList();
+	H2Core::PatternList* pNextPatterns = pHydrogen->getNextPatterns();
+
+	for ( int ii = 0; ii < pPatternList->size(); ++ii ) {
+		H2Core::Pattern* pPattern = pPatternList->get( ii );
+
+		bool bPlaying = pPlayingPatterns != nullptr && pPlayingPatterns->index( pPattern ) != -1;
+		bool bNext = pNextPatterns != nullptr && pNextPatterns->index( pPattern ) != -1;
+
+		message = lo_message_new();
+		lo_message_add_string( message, pPattern->get_name().toLocal8Bit().data() );
+		lo_message_add_float( message, static_cast<float>( ii ) );
+		lo_message_add_float( message, static_cast<float>( pPattern->get_length() ) );
+		lo_message_add_float( message, static_cast<float>( bPlaying ) );
+		lo_message_add_float( message, static_cast<float>( bNext ) );
+		lo_bundle_add_message( bundle, "/Hydrogen/PATTERN_STATE", message );
+	}
+
+	std::vector<H2Core::PatternList*>* pColumns = pSong->getPatternGroupVector();
+	for ( int ii = 0; ii < pColumns->size(); ++ii ) {
+		H2Core::PatternList* pColumn = ( *pColumns )[ ii ];
+
+		message = lo_message_new();
+		lo_message_add_float( message, static_cast<float>( ii ) );
+		for ( int jj = 0; jj < pColumn->size(); ++jj ) {
+			lo_message_add_float( message, static_cast<float>( pPatternList->index( pColumn->get( jj ) ) ) );
+		}
+		lo_bundle_add_message( bundle, "/Hydrogen/SONG_GRID", message );
+	}
+
+	pAudioEngine->unlock();
+
+	lo_send_bundle( source, bundle );
+	lo_bundle_free_recursive( bundle );
+}
+
 // -------------------------------------------------------------------
 // Helper functions
 
@@ -722,19 +1000,106 @@ bool IsLoAddressEqual( lo_address first, lo_address second )
 	return portEqual && hostEqual && protoEqual;
 }
 
-void OscServer::broadcastMessage( const char* msgText, lo_message message ) {
-	for ( const auto& clientAddress: m_pClientRegistry ){
-		
-		INFOLOG( QString( "Outgoing OSC broadcast message %1" ).arg( msgText ));
-		
-		int i;
-		for (i = 0; i < lo_message_get_argc( message ); i++) {
-			QString formattedArgument = qPrettyPrint( (lo_type)lo_message_get_types(message)[i], lo_message_get_argv(message)[i] );
-			INFOLOG(QString("Argument %1: %2 %3").arg(i).arg(lo_message_get_types(message)[i]).arg(formattedArgument));
+void OscServer::queueFeedback( const QString& sPath, float fValue )
+{
+	std::lock_guard<std::mutex> lock( m_feedbackMutex );
+	m_pendingFeedback[ sPath ] = fValue;
+}
+
+void OscServer::sendFeedback( const std::map<QString, float>& feedback,
+							  const std::list<lo_address>& clients )
+{
+	// Keep the UDP packets small enough to not get fragmented.
+	const int nMaxMessagesPerBundle = 32;
+
+	auto it = feedback.begin();
+	while ( it != feedback.end() ) {
+		lo_bundle bundle = lo_bundle_new( LO_TT_IMMEDIATE );
+
+		for ( int ii = 0; ii < nMaxMessagesPerBundle && it != feedback.end(); ++ii, ++it ) {
+			lo_message message = lo_message_new();
+			lo_message_add_float( message, it->second );
+			lo_bundle_add_message( bundle, it->first.toLatin1().constData(), message );
 		}
-		
-		lo_send_message(clientAddress, msgText, message);
+
+		for ( const auto& clientAddress: clients ) {
+			lo_send_bundle( clientAddress, bundle );
+		}
+
+		lo_bundle_free_recursive( bundle );
+	}
+
+	INFOLOG( QString( "Sent %1 OSC feedback messages to %2 clients" )
+			 .arg( feedback.size() ).arg( clients.size() ) );
+}
+
+void OscServer::feedbackThread()
+{
+	std::map<QString, float> feedback;
+	std::list<lo_address> clients;
+
+	Threads::configureCurrentThread( Threads::Role::Background, "OSC feedback" );
+
+	while ( m_bFeedbackThreadRunning.load() ) {
+		{
+			std::unique_lock<std::mutex> lock( m_feedbackMutex );
+			// Wait for the whole interval to collect as many changes
+			// as possible in one go.
+			m_feedbackCondition.wait_for( lock, std::chrono::milliseconds( OSC_FEEDBACK_INTERVAL ),
+										  [&]() { return ! m_bFeedbackThreadRunning.load(); } );
+			if ( ! m_bFeedbackThreadRunning.load() ) {
+				break;
+			}
+
+			if ( m_bResendFeedback ) {
+				m_sentFeedback.clear();
+				m_bResendFeedback = false;
+			}
+
+			feedback.swap( m_pendingFeedback );
+			clients = m_pClientRegistry;
+		}
+
+		// Only send what did change.
+		for ( auto it = feedback.begin(); it != feedback.end(); ) {
+			auto sent = m_sentFeedback.find( it->first );
+			if ( sent != m_sentFeedback.end() && sent->second == it->second ) {
+				it = feedback.erase( it );
+			} else {
+				m_sentFeedback[ it->first ] = it->second;
+				++it;
+			}
+		}
+
+		if ( ! feedback.empty() && ! clients.empty() ) {
+			sendFeedback( feedback, clients );
+		}
+		feedback.clear();
+	}
+}
+
+void OscServer::startFeedbackThread()
+{
+	if ( m_feedbackThread.joinable() ) {
+		return;
+	}
+
+	m_bFeedbackThreadRunning = true;
+	m_feedbackThread = std::thread( &OscServer::feedbackThread, this );
+}
+
+void OscServer::stopFeedbackThread()
+{
+	if ( ! m_feedbackThread.joinable() ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_feedbackMutex );
+		m_bFeedbackThreadRunning = false;
 	}
+	m_feedbackCondition.notify_all();
+	m_feedbackThread.join();
 }
 
 // -------------------------------------------------------------------
@@ -751,97 +1116,50 @@ void OscServer::handleAction( Action* pAction )
 	if( pAction->getType() == "MASTER_VOLUME_ABSOLUTE"){
 		bool ok;
 		float param2 = pAction->getParameter2().toFloat(&ok);
-			
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param2);
 
-		broadcastMessage("/Hydrogen/MASTER_VOLUME_ABSOLUTE", reply);
-		
-		lo_message_free( reply );
+		queueFeedback( "/Hydrogen/MASTER_VOLUME_ABSOLUTE", param2 );
 	}
 	
 	if( pAction->getType() == "STRIP_VOLUME_ABSOLUTE"){
 		bool ok;
 		float param2 = pAction->getParameter2().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param2);
-
-		QByteArray ba = QString("/Hydrogen/STRIP_VOLUME_ABSOLUTE/%1").arg(pAction->getParameter1()).toLatin1();
-		const char *c_str2 = ba.data();
-
-		broadcastMessage( c_str2, reply);
-		
-		lo_message_free( reply );
+		queueFeedback( QString("/Hydrogen/STRIP_VOLUME_ABSOLUTE/%1").arg(pAction->getParameter1()), param2 );
 	}
 	
 	if( pAction->getType() == "TOGGLE_METRONOME"){
 		bool ok;
 		float param1 = pAction->getParameter1().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param1);
-
-		broadcastMessage("/Hydrogen/TOGGLE_METRONOME", reply);
-		
-		lo_message_free( reply );
+		queueFeedback( "/Hydrogen/TOGGLE_METRONOME", param1 );
 	}
 	
 	if( pAction->getType() == "MUTE_TOGGLE"){
 		bool ok;
 		float param1 = pAction->getParameter1().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param1);
-		
-		broadcastMessage("/Hydrogen/MUTE_TOGGLE", reply);
-		
-		lo_message_free( reply );
+		queueFeedback( "/Hydrogen/MUTE_TOGGLE", param1 );
 	}
 	
 	if( pAction->getType() == "STRIP_MUTE_TOGGLE"){
 		bool ok;
 		float param2 = pAction->getParameter2().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param2);
-
-		QByteArray ba = QString("/Hydrogen/STRIP_MUTE_TOGGLE/%1").arg(pAction->getParameter1()).toLatin1();
-		const char *c_str2 = ba.data();
-
-		broadcastMessage( c_str2, reply);
-		
-		lo_message_free( reply );
+		queueFeedback( QString("/Hydrogen/STRIP_MUTE_TOGGLE/%1").arg(pAction->getParameter1()), param2 );
 	}
 	
 	if( pAction->getType() == "STRIP_SOLO_TOGGLE"){
 		bool ok;
 		float param2 = pAction->getParameter2().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param2);
-
-		QByteArray ba = QString("/Hydrogen/STRIP_SOLO_TOGGLE/%1").arg(pAction->getParameter1()).toLatin1();
-		const char *c_str2 = ba.data();
-
-		broadcastMessage( c_str2, reply);
-		
-		lo_message_free( reply );
+		queueFeedback( QString("/Hydrogen/STRIP_SOLO_TOGGLE/%1").arg(pAction->getParameter1()), param2 );
 	}
 	
 	if( pAction->getType() == "PAN_ABSOLUTE"){
 		bool ok;
 		float param2 = pAction->getParameter2().toFloat(&ok);
 
-		lo_message reply = lo_message_new();
-		lo_message_add_float(reply, param2);
-
-		QByteArray ba = QString("/Hydrogen/PAN_ABSOLUTE/%1").arg(pAction->getParameter1()).toLatin1();
-		const char *c_str2 = ba.data();
-
-		broadcastMessage( c_str2, reply);
-		
-		lo_message_free( reply );
+		queueFeedback( QString("/Hydrogen/PAN_ABSOLUTE/%1").arg(pAction->getParameter1()), param2 );
 	}
 }
 
@@ -860,6 +1178,7 @@ bool OscServer::init()
 	m_pServerThread->add_method(nullptr, nullptr, [&](lo_message msg){
 									lo_address a = lo_message_get_source(msg);
 
+									std::unique_lock<std::mutex> lock( m_feedbackMutex );
 									bool AddressRegistered = false;
 									for (std::list<lo_address>::iterator it=m_pClientRegistry.begin(); it != m_pClientRegistry.end(); ++it){
 										lo_address b = *it;
@@ -874,6 +1193,10 @@ bool OscServer::init()
 																						lo_address_get_hostname( a ),
 																						lo_address_get_port( a ) );
 										m_pClientRegistry.push_back( newAddr );
+										// The new client has to receive
+										// the whole state.
+										m_bResendFeedback = true;
+										lock.unlock();
 										
 										H2Core::Hydrogen *pEngine = H2Core::Hydrogen::get_instance();
 										H2Core::CoreActionController* pController = pEngine->getCoreActionController();
@@ -969,9 +1292,42 @@ bool OscServer::init()
 
 	m_pServerThread->add_method("/Hydrogen/JACK_TRANSPORT_ACTIVATION", "f", JACK_TRANSPORT_ACTIVATION_Handler);
 	m_pServerThread->add_method("/Hydrogen/JACK_TIMEBASE_MASTER_ACTIVATION", "f", JACK_TIMEBASE_MASTER_ACTIVATION_Handler);
+	m_pServerThread->add_method("/Hydrogen/LINK_ACTIVATION", "f", LINK_ACTIVATION_Handler);
+	m_pServerThread->add_method("/Hydrogen/NETWORK_STEMS_ACTIVATION", "f", NETWORK_STEMS_ACTIVATION_Handler);
+	m_pServerThread->add_method("/Hydrogen/METRICS_ACTIVATION", "f", METRICS_ACTIVATION_Handler);
 	m_pServerThread->add_method("/Hydrogen/SONG_MODE_ACTIVATION", "f", SONG_MODE_ACTIVATION_Handler);
 	m_pServerThread->add_method("/Hydrogen/LOOP_MODE_ACTIVATION", "f", LOOP_MODE_ACTIVATION_Handler);
 	m_pServerThread->add_method("/Hydrogen/RELOCATE", "f", RELOCATE_Handler);
+	m_pServerThread->add_method("/Hydrogen/TRACE_ACTIVATION", "f", TRACE_ACTIVATION_Handler);
+	m_pServerThread->add_method("/Hydrogen/TRACE_DUMP", "s", TRACE_DUMP_Handler);
+	m_pServerThread->add_method("/Hydrogen/SCHEDULE_NOTES", "b", SCHEDULE_NOTES_Handler);
+	m_pServerThread->add_method("/Hydrogen/SCHEDULE_NOTES_TICKS", "b", SCHEDULE_NOTES_TICKS_Handler);
+
+	// Queries have to know the address of the client to reply to.
+	m_pServerThread->add_method("/Hydrogen/PROCESS_PROFILE", "", [](lo_arg **argv, int argc, lo_message msg){
+									PROCESS_PROFILE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/PROCESS_PROFILE", "f", [](lo_arg **argv, int argc, lo_message msg){
+									PROCESS_PROFILE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/INSTRUMENT_PROFILE", "", [](lo_arg **argv, int argc, lo_message msg){
+									INSTRUMENT_PROFILE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/INSTRUMENT_PROFILE", "f", [](lo_arg **argv, int argc, lo_message msg){
+									INSTRUMENT_PROFILE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/MIXER_STATE", "", [](lo_arg **argv, int argc, lo_message msg){
+									MIXER_STATE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/MIXER_STATE", "f", [](lo_arg **argv, int argc, lo_message msg){
+									MIXER_STATE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/PATTERN_STATE", "", [](lo_arg **argv, int argc, lo_message msg){
+									PATTERN_STATE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
+	m_pServerThread->add_method("/Hydrogen/PATTERN_STATE", "f", [](lo_arg **argv, int argc, lo_message msg){
+									PATTERN_STATE_Handler( lo_message_get_source( msg ), argv, argc );
+								});
 
 	m_bInitialized = true;
 	
@@ -991,6 +1347,7 @@ bool OscServer::start() {
 	}
 
 	m_pServerThread->start();
+	startFeedbackThread();
 
 	int nOscPortUsed;
 	if ( m_pPreferences->m_nOscTemporaryPort != -1 ) {
@@ -1011,6 +1368,7 @@ bool OscServer::stop() {
 	}
 
 	m_pServerThread->stop();
+	stopFeedbackThread();
 	INFOLOG(QString("Osc server stopped" ));
 
 	return true;
@@ -29,7 +29,17 @@
 
 
 #include <core/Object.h>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/** Interval in milliseconds in which OscServer sends the changes
+	of the state of Hydrogen to its clients.*/
+#define OSC_FEEDBACK_INTERVAL 50
 
 namespace lo
 {
@@ -242,6 +252,12 @@ class OscServer : public H2Core::Object
 		 * [x] The last part of the URI is determined by
 		 * Action::parameter1 and specifies an individual strip.
 		 *
+		 * The messages are not sent right away. Instead, the value
+		 * is stored in #m_pendingFeedback and the feedback thread
+		 * sends all values which changed since its last run in one
+		 * go. This way, e.g. loading a song does not result in
+		 * hundreds of UDP packets being sent by the calling thread.
+		 *
 		 * Only called if H2Core::Preferences::m_bOscServerEnabled is
 		 * true.
 		 *
@@ -681,6 +697,33 @@ class OscServer : public H2Core::Object
 		 * \param argc Unused number of arguments passed by the OSC
 		 * message.*/
 		static void JACK_TIMEBASE_MASTER_ACTIVATION_Handler(lo_arg **argv, int argc);
+		/**
+		 * Triggers CoreActionController::activateLink().
+		 *
+		 * \param argv The "f" field does contain the value supplied
+		 * by the user. If it is 0, Hydrogen leaves the Ableton Link
+		 * session. Else, it joins it.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void LINK_ACTIVATION_Handler(lo_arg **argv, int argc);
+		/**
+		 * Triggers CoreActionController::activateNetworkStems().
+		 *
+		 * \param argv The "f" field does contain the value supplied
+		 * by the user. If it is 0, Hydrogen stops streaming its
+		 * tracks. Else, it starts.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void NETWORK_STEMS_ACTIVATION_Handler(lo_arg **argv, int argc);
+		/**
+		 * Triggers CoreActionController::activateMetrics().
+		 *
+		 * \param argv The "f" field does contain the value supplied
+		 * by the user. If it is 0, Hydrogen stops exporting its
+		 * metrics. Else, it starts.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void METRICS_ACTIVATION_Handler(lo_arg **argv, int argc);
 		/**
 		 * Triggers CoreActionController::activateSongMode().
 		 *
@@ -708,6 +751,131 @@ class OscServer : public H2Core::Object
 		 * \param argc Unused number of arguments passed by the OSC
 		 * message.*/
 		static void RELOCATE_Handler(lo_arg **argv, int argc);
+		/**
+		 * Replies to @a source with the timing statistics of the
+		 * audio engine gathered by H2Core::ProcessProfiler.
+		 *
+		 * For each stage of the process cycle a message to \e
+		 * /Hydrogen/PROCESS_PROFILE is sent containing the name of
+		 * the stage as string followed by its median, 99th
+		 * percentile, and maximum duration in milliseconds as
+		 * floats. It is followed by a message with the stage name
+		 * "Cycles" containing the number of accounted and dropped
+		 * cycles and a final one named "Quiet voices" containing
+		 * the number of voices ended as their release became
+		 * inaudible.
+		 *
+		 * Sending a value other than zero resets the statistics
+		 * after replying.
+		 *
+		 * \param source Address of the querying client.
+		 * \param argv The optional "f" field does indicate whether
+		 * to reset the statistics.
+		 * \param argc Number of arguments passed by the OSC
+		 * message.*/
+		static void PROCESS_PROFILE_Handler(lo_address source, lo_arg **argv, int argc);
+		/**
+		 * Replies to @a source with the cost of rendering each
+		 * instrument in a single OSC bundle.
+		 *
+		 * For each instrument a message to \e
+		 * /Hydrogen/INSTRUMENT_PROFILE is sent containing its name
+		 * as string followed by its strip number (starting at 1),
+		 * the number of voices currently playing, the number of
+		 * frames rendered, the number of those which had to be
+		 * resampled, and the time spent rendering in milliseconds
+		 * as floats. See H2Core::Instrument::RenderStats.
+		 *
+		 * All but the number of voices accumulate since the
+		 * instrument was loaded. Clients derive rates by comparing
+		 * successive replies.
+		 *
+		 * \param source Address of the querying client.
+		 * \param argv Unused.
+		 * \param argc Unused.*/
+		static void INSTRUMENT_PROFILE_Handler(lo_address source, lo_arg **argv, int argc);
+		/**
+		 * Enables or disables the recording of H2Core::Tracer.
+		 *
+		 * \param argv The "f" field does indicate whether to enable
+		 * (non-zero) or disable (zero) the recording.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void TRACE_ACTIVATION_Handler(lo_arg **argv, int argc);
+		/**
+		 * Writes the events recorded by H2Core::Tracer to a file
+		 * as Chrome trace JSON using H2Core::Tracer::dump().
+		 *
+		 * \param argv The "s" field does contain the absolute path
+		 * of the file to write.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void TRACE_DUMP_Handler(lo_arg **argv, int argc);
+		/**
+		 * Plays many notes at once using
+		 * H2Core::Hydrogen::scheduleNotes().
+		 *
+		 * \param argv The "b" field does contain a blob of records
+		 * of 16 bytes each, one per note, holding - in network byte
+		 * order - the int32 index of the instrument, the float32
+		 * velocity in [0,1], the float32 pitch in semitones, and the
+		 * int32 offset from the start of the next process cycle in
+		 * frames. If the size of the blob is not a multiple of 16
+		 * or one of the notes is invalid, none of them is played.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void SCHEDULE_NOTES_Handler(lo_arg **argv, int argc);
+		/**
+		 * Same as SCHEDULE_NOTES_Handler() but the last field of
+		 * each record is a float32 offset in ticks.
+		 *
+		 * \param argv The "b" field does contain the notes.
+		 * \param argc Unused number of arguments passed by the OSC
+		 * message.*/
+		static void SCHEDULE_NOTES_TICKS_Handler(lo_arg **argv, int argc);
+		/**
+		 * Replies to @a source with the state of the whole mixer in
+		 * a single OSC bundle.
+		 *
+		 * The first message of the bundle is sent to \e
+		 * /Hydrogen/MIXER_STATE and contains the string "Master"
+		 * followed by the master volume and mute state as
+		 * floats. For each instrument a message to the same path
+		 * follows containing its name as string followed by its
+		 * strip number (starting at 1), volume, pan, mute, and solo
+		 * state as floats. Volume and pan are in the same units
+		 * used by \e /Hydrogen/STRIP_VOLUME_ABSOLUTE/[x] and \e
+		 * /Hydrogen/PAN_ABSOLUTE/[x].
+		 *
+		 * All values are taken while holding the
+		 * H2Core::AudioEngine lock and are thus consistent with each
+		 * other.
+		 *
+		 * \param source Address of the querying client.
+		 * \param argv Unused.
+		 * \param argc Unused.*/
+		static void MIXER_STATE_Handler(lo_address source, lo_arg **argv, int argc);
+		/**
+		 * Replies to @a source with the patterns of the current
+		 * song and their arrangement in a single OSC bundle.
+		 *
+		 * For each pattern a message to \e /Hydrogen/PATTERN_STATE
+		 * is sent containing its name as string followed by its
+		 * number (starting at 0), length in ticks, and whether it is
+		 * currently playing and queued to be played next as
+		 * floats. For each column of the song editor a message to
+		 * \e /Hydrogen/SONG_GRID follows containing the column
+		 * number and the numbers of all patterns activated in it as
+		 * floats.
+		 *
+		 * All values are taken while holding the
+		 * H2Core::AudioEngine lock and are thus consistent with each
+		 * other.
+		 *
+		 * \param source Address of the querying client.
+		 * \param argv Unused.
+		 * \param argc Unused.*/
+		static void PATTERN_STATE_Handler(lo_address source, lo_arg **argv, int argc);
 		/** 
 		 * Catches any incoming messages and display them. 
 		 *
@@ -751,9 +919,26 @@ class OscServer : public H2Core::Object
 		 */
 		OscServer( H2Core::Preferences* pPreferences );
 		
-		/** Helper function which sends a message with msgText to all 
-		 * connected clients. **/
-		void broadcastMessage( const char* msgText, lo_message message);
+		/** Stores @a fValue as most recent feedback for @a sPath in
+		 * #m_pendingFeedback.*/
+		void queueFeedback( const QString& sPath, float fValue );
+		/**
+		 * Sends all values of @a feedback to the clients in @a
+		 * clients using OSC bundles.
+		 */
+		void sendFeedback( const std::map<QString, float>& feedback,
+						   const std::list<lo_address>& clients );
+		/**
+		 * Runs every #OSC_FEEDBACK_INTERVAL milliseconds, drops all
+		 * values of #m_pendingFeedback which did not change since
+		 * they were sent last, and passes the remaining ones to
+		 * sendFeedback().
+		 */
+		void feedbackThread();
+		/** Starts #m_feedbackThread unless it is already running.*/
+		void startFeedbackThread();
+		/** Stops #m_feedbackThread and waits for it to finish.*/
+		void stopFeedbackThread();
 	
 		/** Pointer to the H2Core::Preferences singleton. Although it
 		 * could be accessed internally using
@@ -784,6 +969,23 @@ class OscServer : public H2Core::Object
 		 * propagated to all registered clients.
 		 */
 		std::list<lo_address> m_pClientRegistry;
+
+		/** Most recent feedback value for each OSC path not sent
+		 * yet. Guarded by #m_feedbackMutex.*/
+		std::map<QString, float> m_pendingFeedback;
+		/** Values last sent for each OSC path. Only accessed by
+		 * #m_feedbackThread.*/
+		std::map<QString, float> m_sentFeedback;
+		/** Set when a new client was registered. All pending values
+		 * will be sent regardless of #m_sentFeedback. Guarded by
+		 * #m_feedbackMutex.*/
+		bool m_bResendFeedback;
+		/** Guards #m_pendingFeedback, #m_bResendFeedback, and
+		 * #m_pClientRegistry.*/
+		std::mutex m_feedbackMutex;
+		std::condition_variable m_feedbackCondition;
+		std::thread m_feedbackThread;
+		std::atomic<bool> m_bFeedbackThreadRunning;
 };
 
 #endif /* H2CORE_HAVE_OSC */
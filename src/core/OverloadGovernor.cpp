@@ -0,0 +1,134 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/OverloadGovernor.h>
+
+#include <core/EventQueue.h>
+
+namespace H2Core
+{
+
+const char* OverloadGovernor::__class_name = "OverloadGovernor";
+
+OverloadGovernor::OverloadGovernor()
+	: Object( __class_name )
+	, m_nLevel( LEVEL_FULL )
+	, m_fSinceChange( fHoldLength )
+	, m_fCalmTime( 0 )
+{
+	resetWindow();
+}
+
+OverloadGovernor::~OverloadGovernor()
+{
+}
+
+QString OverloadGovernor::getLevelName( Level level )
+{
+	switch ( level ) {
+	case LEVEL_FULL:
+		return "Full quality";
+	case LEVEL_LINEAR_INTERPOLATION:
+		return "Linear interpolation";
+	case LEVEL_BYPASS_FX:
+		return "Linear interpolation, FX bypassed";
+	case LEVEL_REDUCED_VOICES:
+		return "Linear interpolation, FX bypassed, voices reduced";
+	default:
+		return "Unknown";
+	}
+}
+
+bool OverloadGovernor::update( float fProcessTime, float fMaxProcessTime )
+{
+	if ( fMaxProcessTime <= 0 ) {
+		return false;
+	}
+
+	float fLoad = fProcessTime / fMaxProcessTime;
+	m_fWindowTime += fMaxProcessTime;
+	m_fSinceChange += fMaxProcessTime;
+	++m_nWindowCycles;
+	if ( fLoad > fHighLoad ) {
+		++m_nWindowOverloads;
+	}
+	if ( fLoad > 1 ) {
+		++m_nWindowXRuns;
+	}
+	if ( fLoad < fLowLoad ) {
+		m_fCalmTime += fMaxProcessTime;
+	} else {
+		m_fCalmTime = 0;
+	}
+
+	int nLevel = m_nLevel.load( std::memory_order_relaxed );
+
+	// Overruns are handled right away, the share of overloaded
+	// cycles once the window is complete.
+	bool bStepDown = m_nWindowXRuns >= nXRunsToStepDown;
+	if ( m_fWindowTime >= fWindowLength ) {
+		bStepDown = bStepDown ||
+			m_nWindowOverloads > fOverloadedShare * m_nWindowCycles;
+		resetWindow();
+	}
+
+	if ( bStepDown && m_fSinceChange >= fHoldLength &&
+		 nLevel < LEVEL_COUNT - 1 ) {
+		setLevel( nLevel + 1 );
+		return true;
+	}
+	if ( m_fCalmTime >= fRecoverLength && nLevel > LEVEL_FULL ) {
+		setLevel( nLevel - 1 );
+		return true;
+	}
+
+	return false;
+}
+
+void OverloadGovernor::reset()
+{
+	if ( m_nLevel.load( std::memory_order_relaxed ) != LEVEL_FULL ) {
+		setLevel( LEVEL_FULL );
+	}
+	m_fSinceChange = fHoldLength;
+	m_fCalmTime = 0;
+}
+
+void OverloadGovernor::setLevel( int nLevel )
+{
+	m_nLevel.store( nLevel, std::memory_order_relaxed );
+	m_fSinceChange = 0;
+	m_fCalmTime = 0;
+	resetWindow();
+	EventQueue::get_instance()->push_event( EVENT_OVERLOAD_LEVEL, nLevel );
+}
+
+void OverloadGovernor::resetWindow()
+{
+	m_fWindowTime = 0;
+	m_nWindowCycles = 0;
+	m_nWindowOverloads = 0;
+	m_nWindowXRuns = 0;
+}
+
+};
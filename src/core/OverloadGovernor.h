@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef OVERLOAD_GOVERNOR_H
+#define OVERLOAD_GOVERNOR_H
+
+#include <core/Object.h>
+
+#include <QString>
+
+#include <atomic>
+
+namespace H2Core
+{
+
+/**
+ * Trades rendering quality for headroom while the audio engine
+ * struggles to keep up.
+ *
+ * audioEngine_process() passes the duration of each cycle to
+ * update(). The cycles are grouped into windows of
+ * #fWindowLength. If more than #fOverloadedShare of the cycles of a
+ * window used more than #fHighLoad of the time available, or if at
+ * least #nXRunsToStepDown of them did overrun, the governor steps one
+ * Level down. Once all cycles stayed below #fLowLoad for
+ * #fRecoverLength, it steps one Level back up. Each change is
+ * followed by #fHoldLength in which no further step down is taken,
+ * so the effect of the previous one can be observed.
+ *
+ * Each change of the level is reported by pushing
+ * #EVENT_OVERLOAD_LEVEL with the new Level as value.
+ *
+ * update() neither locks nor allocates. getLevel() can be called
+ * from arbitrary threads.
+ */
+class OverloadGovernor : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Degradation steps. Each one includes all preceding ones.*/
+	enum Level {
+		/** Full quality.*/
+		LEVEL_FULL = 0,
+		/** The Sampler renders all notes using
+			Interpolation::InterpolateMode::Linear, including the
+			instruments asking for sinc interpolation.*/
+		LEVEL_LINEAR_INTERPOLATION,
+		/** The LADSPA send effects are bypassed.*/
+		LEVEL_BYPASS_FX,
+		/** Only half of Preferences::m_nMaxNotes voices are
+			played. The ones in excess are faded out.*/
+		LEVEL_REDUCED_VOICES,
+		LEVEL_COUNT
+	};
+
+	/** Share of the available time above which a cycle counts as
+		overloaded.*/
+	static constexpr float fHighLoad = 0.85;
+	/** Share of the available time below which a cycle counts as
+		calm.*/
+	static constexpr float fLowLoad = 0.5;
+	/** Share of overloaded cycles within a window causing a step
+		down.*/
+	static constexpr float fOverloadedShare = 0.05;
+	/** Number of overruns within a window causing a step down.*/
+	static constexpr int nXRunsToStepDown = 2;
+	/** Length of a window in milliseconds of audio.*/
+	static constexpr float fWindowLength = 500;
+	/** Time in milliseconds of audio after a change in which no
+		step down is taken.*/
+	static constexpr float fHoldLength = 1000;
+	/** Time in milliseconds of audio all cycles have to stay calm
+		for a step up.*/
+	static constexpr float fRecoverLength = 5000;
+
+	OverloadGovernor();
+	~OverloadGovernor();
+
+	/** \return Human readable name of @a level.*/
+	static QString getLevelName( Level level );
+
+	/**
+	 * Accounts a completed process cycle. Realtime thread only.
+	 *
+	 * \param fProcessTime Duration of the cycle in milliseconds.
+	 * \param fMaxProcessTime Duration of the audio rendered in the
+	 * cycle in milliseconds.
+	 * \return true if the level did change.
+	 */
+	bool update( float fProcessTime, float fMaxProcessTime );
+	/** \return Current Level.*/
+	Level getLevel() const;
+	/** Returns to #LEVEL_FULL, e.g. when the governor is disabled
+		or a non-realtime driver is used. Realtime thread only.*/
+	void reset();
+
+private:
+	/** Changes the level and reports it.*/
+	void setLevel( int nLevel );
+	void resetWindow();
+
+	std::atomic<int> m_nLevel;
+	/** Milliseconds of audio covered by the current window.*/
+	float m_fWindowTime;
+	int m_nWindowCycles;
+	int m_nWindowOverloads;
+	int m_nWindowXRuns;
+	/** Milliseconds of audio since the last change.*/
+	float m_fSinceChange;
+	/** Milliseconds of audio since the last cycle which was not
+		calm.*/
+	float m_fCalmTime;
+};
+
+inline OverloadGovernor::Level OverloadGovernor::getLevel() const
+{
+	return static_cast<Level>( m_nLevel.load( std::memory_order_relaxed ) );
+}
+
+};
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/PeakMeters.h>
+#include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* PeakMeters::__class_name = "PeakMeters";
+
+PeakMeters::PeakMeters()
+	: Object( __class_name )
+	, m_bPublished( false )
+{
+	clear( &m_pending );
+	clear( &m_published );
+}
+
+PeakMeters::~PeakMeters()
+{
+}
+
+void PeakMeters::publish( Song* pSong, float* pFXPeak_L, float* pFXPeak_R,
+						  float* pMasterPeak_L, float* pMasterPeak_R )
+{
+	if ( pSong != nullptr ) {
+		InstrumentList* pInstrList = pSong->getInstrumentList();
+		int nInstruments = std::min( pInstrList->size(), MAX_INSTRUMENTS );
+		for ( int nInstr = 0; nInstr < nInstruments; ++nInstr ) {
+			Instrument* pInstr = pInstrList->get( nInstr );
+			m_pending.instrument_L[ nInstr ] =
+				std::max( m_pending.instrument_L[ nInstr ], pInstr->get_peak_l() );
+			m_pending.instrument_R[ nInstr ] =
+				std::max( m_pending.instrument_R[ nInstr ], pInstr->get_peak_r() );
+			pInstr->set_peak_l( 0.0f );
+			pInstr->set_peak_r( 0.0f );
+		}
+		for ( int nInstr = nInstruments; nInstr < m_pending.nInstruments; ++nInstr ) {
+			m_pending.instrument_L[ nInstr ] = 0.0f;
+			m_pending.instrument_R[ nInstr ] = 0.0f;
+		}
+		m_pending.nInstruments = nInstruments;
+
+		int nComponents = 0;
+		for ( auto pCompo : *pSong->getComponents() ) {
+			if ( nComponents >= MAX_COMPONENTS ) {
+				break;
+			}
+			m_pending.component_L[ nComponents ] =
+				std::max( m_pending.component_L[ nComponents ], pCompo->get_peak_l() );
+			m_pending.component_R[ nComponents ] =
+				std::max( m_pending.component_R[ nComponents ], pCompo->get_peak_r() );
+			pCompo->set_peak_l( 0.0f );
+			pCompo->set_peak_r( 0.0f );
+			++nComponents;
+		}
+		for ( int nCompo = nComponents; nCompo < m_pending.nComponents; ++nCompo ) {
+			m_pending.component_L[ nCompo ] = 0.0f;
+			m_pending.component_R[ nCompo ] = 0.0f;
+		}
+		m_pending.nComponents = nComponents;
+	}
+
+	if ( pFXPeak_L != nullptr && pFXPeak_R != nullptr ) {
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			m_pending.fx_L[ nFX ] = std::max( m_pending.fx_L[ nFX ], pFXPeak_L[ nFX ] );
+			m_pending.fx_R[ nFX ] = std::max( m_pending.fx_R[ nFX ], pFXPeak_R[ nFX ] );
+			pFXPeak_L[ nFX ] = 0.0f;
+			pFXPeak_R[ nFX ] = 0.0f;
+		}
+	}
+
+	m_pending.master_L = std::max( m_pending.master_L, *pMasterPeak_L );
+	m_pending.master_R = std::max( m_pending.master_R, *pMasterPeak_R );
+	*pMasterPeak_L = 0.0f;
+	*pMasterPeak_R = 0.0f;
+
+	if ( m_bPublished.load( std::memory_order_acquire ) ) {
+		// The consumer did not pick up the previous snapshot
+		// yet. Keep on accumulating.
+		return;
+	}
+
+	copy( m_pending, &m_published );
+	m_bPublished.store( true, std::memory_order_release );
+
+	int nInstruments = m_pending.nInstruments;
+	int nComponents = m_pending.nComponents;
+	clear( &m_pending );
+	m_pending.nInstruments = nInstruments;
+	m_pending.nComponents = nComponents;
+}
+
+bool PeakMeters::take( Snapshot* pSnapshot )
+{
+	if ( ! m_bPublished.load( std::memory_order_acquire ) ) {
+		return false;
+	}
+
+	copy( m_published, pSnapshot );
+	m_bPublished.store( false, std::memory_order_release );
+
+	return true;
+}
+
+void PeakMeters::copy( const Snapshot& source, Snapshot* pTarget )
+{
+	pTarget->nInstruments = source.nInstruments;
+	memcpy( pTarget->instrument_L, source.instrument_L, source.nInstruments * sizeof( float ) );
+	memcpy( pTarget->instrument_R, source.instrument_R, source.nInstruments * sizeof( float ) );
+	pTarget->nComponents = source.nComponents;
+	memcpy( pTarget->component_L, source.component_L, source.nComponents * sizeof( float ) );
+	memcpy( pTarget->component_R, source.component_R, source.nComponents * sizeof( float ) );
+	memcpy( pTarget->fx_L, source.fx_L, sizeof( source.fx_L ) );
+	memcpy( pTarget->fx_R, source.fx_R, sizeof( source.fx_R ) );
+	pTarget->master_L = source.master_L;
+	pTarget->master_R = source.master_R;
+}
+
+void PeakMeters::clear( Snapshot* pSnapshot )
+{
+	memset( pSnapshot, 0, sizeof( Snapshot ) );
+}
+
+};
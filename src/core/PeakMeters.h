@@ -0,0 +1,118 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef PEAK_METERS_H
+#define PEAK_METERS_H
+
+#include <core/config.h>
+#include <core/Object.h>
+
+#include <atomic>
+
+namespace H2Core
+{
+
+class Song;
+
+/**
+ * Hands the peaks of all mixer strips from the audio engine to the
+ * GUI.
+ *
+ * At the end of each process cycle audioEngine_process() calls
+ * publish(), which moves the peaks gathered by the Sampler in the
+ * Instruments, by the engine in the DrumkitComponents, and the FX
+ * and master peaks into a pending Snapshot and resets them. As soon
+ * as the consumer did take() the previous snapshot, the pending one
+ * gets published. A snapshot does therefore cover all cycles since
+ * the previous one, no matter how rarely the GUI asks for it.
+ *
+ * Only the audio thread does reset the peaks of the engine objects,
+ * and neither publish() nor take() do lock or allocate. There must
+ * only be a single consumer (the Mixer).
+ */
+class PeakMeters : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	struct Snapshot {
+		/** Number of valid entries of #instrument_L and
+			#instrument_R.*/
+		int nInstruments;
+		/** Indexed like the InstrumentList of the Song.*/
+		float instrument_L[ MAX_INSTRUMENTS ];
+		float instrument_R[ MAX_INSTRUMENTS ];
+		/** Number of valid entries of #component_L and
+			#component_R.*/
+		int nComponents;
+		/** Indexed like Song::getComponents().*/
+		float component_L[ MAX_COMPONENTS ];
+		float component_R[ MAX_COMPONENTS ];
+		float fx_L[ MAX_FX ];
+		float fx_R[ MAX_FX ];
+		float master_L;
+		float master_R;
+	};
+
+	PeakMeters();
+	~PeakMeters();
+
+	/**
+	 * Moves the current peaks of @a pSong and the ones passed as
+	 * arguments into the pending snapshot and publishes it if the
+	 * previous one was taken already.
+	 *
+	 * Must only be called by the audio engine while holding the
+	 * AudioEngine lock. All peaks are reset to zero.
+	 *
+	 * \param pFXPeak_L Left peaks of the #MAX_FX effects or nullptr.
+	 * \param pFXPeak_R Right peaks of the #MAX_FX effects or nullptr.
+	 */
+	void publish( Song* pSong, float* pFXPeak_L, float* pFXPeak_R,
+				  float* pMasterPeak_L, float* pMasterPeak_R );
+
+	/**
+	 * Copies the latest snapshot into @a pSnapshot.
+	 *
+	 * \return false if no snapshot was published since the last
+	 * call. @a pSnapshot is left untouched in this case.
+	 */
+	bool take( Snapshot* pSnapshot );
+
+private:
+	/** Copies the valid entries of @a source into @a pTarget.*/
+	static void copy( const Snapshot& source, Snapshot* pTarget );
+	/** Sets all entries of @a pSnapshot to zero.*/
+	static void clear( Snapshot* pSnapshot );
+
+	/** Peaks accumulated by the audio thread since the last
+		publication. Only accessed by publish().*/
+	Snapshot m_pending;
+	/** Owned by the audio thread while #m_bPublished is false and
+		by the consumer otherwise.*/
+	Snapshot m_published;
+	alignas(64) std::atomic<bool> m_bPublished;
+};
+
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/PlaybackClock.h>
+#include <core/rt_clock.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* PlaybackClock::__class_name = "PlaybackClock";
+
+PlaybackClock::PlaybackClock()
+	: Object( __class_name )
+	, m_nSequence( 0 )
+	, m_cycle()
+	, m_nOrigin( 0 )
+	, m_fStart( 0 )
+	, m_fNextStart( 0 )
+	, m_fPeriodNs( 0 )
+	, m_nPeriod( 0 )
+	, m_nSampleRate( 0 )
+	, m_fB( 0 )
+	, m_fC( 0 )
+{
+}
+
+PlaybackClock::~PlaybackClock()
+{
+}
+
+void PlaybackClock::beginCycle( int nFrames, unsigned nSampleRate )
+{
+	if ( nFrames <= 0 || nSampleRate == 0 ) {
+		return;
+	}
+	const int64_t nNow = rtclock_now_ns();
+	const double fPeriodNs = 1e9 * nFrames / nSampleRate;
+
+	// Changing the buffer size or the sample rate, the first
+	// cycle, and xruns restart the loop.
+	double fError = static_cast<double>( nNow - m_nOrigin ) - m_fNextStart;
+	if ( nFrames != m_nPeriod || nSampleRate != m_nSampleRate ||
+		 m_nOrigin == 0 || std::abs( fError ) > fPeriodNs ) {
+		const double fOmega = 2 * M_PI * fBandwidth * fPeriodNs / 1e9;
+		m_fB = std::sqrt( 2.0 ) * fOmega;
+		m_fC = fOmega * fOmega;
+		m_nPeriod = nFrames;
+		m_nSampleRate = nSampleRate;
+		m_nOrigin = nNow;
+		m_fPeriodNs = fPeriodNs;
+		m_fStart = 0;
+		m_fNextStart = fPeriodNs;
+		return;
+	}
+
+	m_fStart = m_fNextStart;
+	m_fNextStart += m_fB * fError + m_fPeriodNs;
+	m_fPeriodNs += m_fC * fError;
+}
+
+void PlaybackClock::publish( long long nFrame, float fTickSize, bool bRolling,
+							 long nPatternStartTick, int nPatternSize )
+{
+	const uint32_t nSequence = m_nSequence.load( std::memory_order_relaxed );
+	m_nSequence.store( nSequence + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	m_cycle.nFrame = nFrame;
+	m_cycle.nStart = m_nOrigin + static_cast<int64_t>( m_fStart );
+	m_cycle.nNextStart = m_nOrigin + static_cast<int64_t>( m_fNextStart );
+	m_cycle.nPeriod = m_nPeriod;
+	m_cycle.fTickSize = fTickSize;
+	m_cycle.bRolling = bRolling;
+	m_cycle.nPatternStartTick = nPatternStartTick;
+	m_cycle.nPatternSize = nPatternSize;
+
+	m_nSequence.store( nSequence + 2, std::memory_order_release );
+}
+
+bool PlaybackClock::get( int64_t nNow, Position* pPosition ) const
+{
+	Cycle cycle;
+	uint32_t nSequence;
+	while ( true ) {
+		nSequence = m_nSequence.load( std::memory_order_acquire );
+		if ( nSequence == 0 ) {
+			return false;
+		}
+		if ( nSequence % 2 == 1 ) {
+			continue;
+		}
+		cycle = m_cycle;
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if ( m_nSequence.load( std::memory_order_relaxed ) == nSequence ) {
+			break;
+		}
+	}
+
+	double fFrame = static_cast<double>( cycle.nFrame );
+	if ( cycle.bRolling && cycle.nNextStart > cycle.nStart ) {
+		double fPhase = static_cast<double>( nNow - cycle.nStart ) /
+			static_cast<double>( cycle.nNextStart - cycle.nStart );
+		fFrame += std::min( std::max( fPhase, 0.0 ), fMaxPhase ) * cycle.nPeriod;
+	}
+
+	pPosition->fTick = cycle.fTickSize > 0 ? fFrame / cycle.fTickSize : 0;
+	pPosition->bRolling = cycle.bRolling;
+	pPosition->nPatternStartTick = cycle.nPatternStartTick;
+	pPosition->nPatternSize = cycle.nPatternSize;
+	return true;
+}
+
+};
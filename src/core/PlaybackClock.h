@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef PLAYBACK_CLOCK_H
+#define PLAYBACK_CLOCK_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace H2Core
+{
+
+/**
+ * Timestamped transport position of the audio engine, which the GUI
+ * can extrapolate to draw a smoothly moving playhead.
+ *
+ * Polling Hydrogen::getTickPosition() yields the position at buffer
+ * granularity only. The wakeup times of the process cycles jitter
+ * as well. beginCycle() therefore feeds them into a delay-locked loop
+ * which estimates the start of the current and the next cycle. Along
+ * with the transport position published at the end of each cycle,
+ * get() interpolates the frame processed at an arbitrary point in
+ * time.
+ *
+ * The state is handed over by a sequence lock. Neither beginCycle()
+ * nor publish() lock or allocate while get() can be called from
+ * arbitrary threads and retries in case it raced the audio engine.
+ */
+class PlaybackClock : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Bandwidth of the delay-locked loop in Hz.*/
+	static constexpr double fBandwidth = 1.0;
+	/** get() does not extrapolate further than this number of
+		periods beyond the start of the last cycle, e.g. when the
+		audio driver stalls.*/
+	static constexpr double fMaxPhase = 1.5;
+
+	/** Extrapolated transport position.*/
+	struct Position {
+		/** Transport position in ticks.*/
+		double fTick;
+		/** Whether the transport is rolling.*/
+		bool bRolling;
+		/** First tick of the playing patterns in
+			Song::PATTERN_MODE, see getTickPosition().*/
+		long nPatternStartTick;
+		/** Length of the longest playing pattern in
+			Song::PATTERN_MODE.*/
+		int nPatternSize;
+	};
+
+	PlaybackClock();
+	~PlaybackClock();
+
+	/**
+	 * Updates the delay-locked loop using the current time. Called
+	 * by the audio engine at the beginning of each process cycle.
+	 *
+	 * \param nFrames Buffer size of the cycle.
+	 * \param nSampleRate Sample rate of the audio driver.
+	 */
+	void beginCycle( int nFrames, unsigned nSampleRate );
+	/**
+	 * Publishes the transport position the cycle started by the
+	 * last beginCycle() did process. Called by the audio engine.
+	 *
+	 * \param nFrame Transport position in frames at the beginning
+	 * of the cycle.
+	 */
+	void publish( long long nFrame, float fTickSize, bool bRolling,
+				  long nPatternStartTick, int nPatternSize );
+	/**
+	 * \param nNow Time to extrapolate the position to as returned
+	 * by rtclock_now_ns().
+	 * \param pPosition Set to the position processed at @a nNow.
+	 * \return false if nothing was published yet.
+	 */
+	bool get( int64_t nNow, Position* pPosition ) const;
+
+private:
+	/** Published by the audio engine.*/
+	struct Cycle {
+		long long nFrame;
+		/** Estimated start of the cycle as returned by
+			rtclock_now_ns().*/
+		int64_t nStart;
+		/** Estimated start of the following cycle.*/
+		int64_t nNextStart;
+		int nPeriod;
+		float fTickSize;
+		bool bRolling;
+		long nPatternStartTick;
+		int nPatternSize;
+	};
+
+	/** Odd while publish() is writing #m_cycle. 0 if nothing was
+		published yet.*/
+	std::atomic<uint32_t> m_nSequence;
+	Cycle m_cycle;
+
+	/** State of the loop, only accessed by the audio engine. The
+		times are relative to #m_nOrigin to retain the precision of
+		the doubles.*/
+	int64_t m_nOrigin;
+	double m_fStart;
+	double m_fNextStart;
+	/** Filtered duration of a cycle in nanoseconds.*/
+	double m_fPeriodNs;
+	int m_nPeriod;
+	unsigned m_nSampleRate;
+	double m_fB;
+	double m_fC;
+};
+
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/PlaybackSnapshot.h>
+#include <core/Basics/PatternList.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* PlaybackSnapshot::__class_name = "PlaybackSnapshot";
+
+PlaybackSnapshot::PlaybackSnapshot()
+	: Object( __class_name )
+	, m_pCurrent( nullptr )
+{
+	for ( auto& version : m_versions ) {
+		version.nPlaying = 0;
+		version.nNext = 0;
+		version.bComplete = false;
+		version.nReaders = 0;
+	}
+}
+
+PlaybackSnapshot::~PlaybackSnapshot()
+{
+}
+
+void PlaybackSnapshot::publish( const PatternList* pPlaying, const PatternList* pNext )
+{
+	if ( pPlaying == nullptr || pNext == nullptr ) {
+		return;
+	}
+
+	Version* pCurrent = m_pCurrent.load();
+	if ( pCurrent != nullptr ) {
+		if ( pCurrent->bComplete ) {
+			if ( equals( pPlaying, pCurrent->playing, pCurrent->nPlaying ) &&
+				 equals( pNext, pCurrent->next, pCurrent->nNext ) ) {
+				return;
+			}
+		} else if ( pPlaying->size() > MAX_SNAPSHOT_PATTERNS ||
+					pNext->size() > MAX_SNAPSHOT_PATTERNS ) {
+			// Still too long. Readers already fall back to the lists.
+			return;
+		}
+	}
+
+	// A reader might still be copying the previous versions.
+	Version* pSpare = nullptr;
+	for ( auto& version : m_versions ) {
+		if ( &version != pCurrent && version.nReaders.load() == 0 ) {
+			pSpare = &version;
+			break;
+		}
+	}
+	if ( pSpare == nullptr ) {
+		return;
+	}
+
+	int nPlaying = fill( pPlaying, pSpare->playing );
+	int nNext = fill( pNext, pSpare->next );
+	pSpare->bComplete = nPlaying >= 0 && nNext >= 0;
+	pSpare->nPlaying = std::max( nPlaying, 0 );
+	pSpare->nNext = std::max( nNext, 0 );
+
+	m_pCurrent.store( pSpare );
+}
+
+bool PlaybackSnapshot::get( std::vector<const Pattern*>* pPlaying,
+							std::vector<const Pattern*>* pNext ) const
+{
+	pPlaying->clear();
+	pNext->clear();
+
+	// Registering as reader and checking the version is still the
+	// current one afterwards ensures publish() will not pick it as
+	// spare while we are copying.
+	Version* pVersion;
+	while ( true ) {
+		pVersion = m_pCurrent.load();
+		if ( pVersion == nullptr ) {
+			return false;
+		}
+		pVersion->nReaders.fetch_add( 1 );
+		if ( m_pCurrent.load() == pVersion ) {
+			break;
+		}
+		pVersion->nReaders.fetch_sub( 1 );
+	}
+
+	bool bComplete = pVersion->bComplete;
+	if ( bComplete ) {
+		pPlaying->assign( pVersion->playing, pVersion->playing + pVersion->nPlaying );
+		pNext->assign( pVersion->next, pVersion->next + pVersion->nNext );
+	}
+	pVersion->nReaders.fetch_sub( 1 );
+
+	return bComplete;
+}
+
+bool PlaybackSnapshot::equals( const PatternList* pList, const Pattern* const* patterns,
+							   int nPatterns )
+{
+	if ( pList->size() != nPatterns ) {
+		return false;
+	}
+	for ( int ii = 0; ii < nPatterns; ++ii ) {
+		if ( pList->get( ii ) != patterns[ ii ] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int PlaybackSnapshot::fill( const PatternList* pList, const Pattern** patterns )
+{
+	int nPatterns = pList->size();
+	if ( nPatterns > MAX_SNAPSHOT_PATTERNS ) {
+		return -1;
+	}
+	for ( int ii = 0; ii < nPatterns; ++ii ) {
+		patterns[ ii ] = pList->get( ii );
+	}
+	return nPatterns;
+}
+
+};
@@ -0,0 +1,125 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef PLAYBACK_SNAPSHOT_H
+#define PLAYBACK_SNAPSHOT_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <vector>
+
+/** Maximum number of playing or next patterns a single version of the
+	H2Core::PlaybackSnapshot can hold.*/
+#define MAX_SNAPSHOT_PATTERNS 256
+/** Number of versions the H2Core::PlaybackSnapshot does cycle
+	through.*/
+#define SNAPSHOT_VERSIONS 4
+
+namespace H2Core
+{
+
+class Pattern;
+class PatternList;
+
+/**
+ * Lock-free view of the patterns played and the ones scheduled to be
+ * played next.
+ *
+ * Both lists are owned by the audio engine and may only be read
+ * while holding the AudioEngine lock. Widgets and the OSC server
+ * polling them did therefore compete with audioEngine_process() for
+ * the lock several times a second only to find out which patterns
+ * are active.
+ *
+ * Instead, the thread changing the lists (the audio engine at the
+ * end of each process cycle as well as the Hydrogen methods
+ * altering them) calls publish() while holding the lock. If the
+ * content differs from the current version, it is copied into a
+ * spare one out of a fixed pool of #SNAPSHOT_VERSIONS, which is
+ * then published atomically. A version is never modified while
+ * published or while a reader is still copying it and it is only
+ * recycled by a later publish(). Neither publish() nor get() do
+ * lock, and publish() does not allocate.
+ *
+ * The pointers handed out must only be used for comparison. The
+ * patterns they point to might have been deleted in the meantime.
+ */
+class PlaybackSnapshot : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	PlaybackSnapshot();
+	~PlaybackSnapshot();
+
+	/**
+	 * Publishes the content of @a pPlaying and @a pNext if it differs
+	 * from the current version.
+	 *
+	 * Must only be called while holding the AudioEngine lock. If all
+	 * spare versions are in use by readers, nothing happens and the
+	 * next call will try again.
+	 */
+	void publish( const PatternList* pPlaying, const PatternList* pNext );
+
+	/**
+	 * Copies the latest version into @a pPlaying and @a pNext.
+	 *
+	 * Can be called from arbitrary threads concurrently but not from
+	 * the realtime one since the vectors might have to grow.
+	 *
+	 * \return false if nothing was published yet or the lists were
+	 * too long to fit into a single version. Both vectors are left
+	 * empty in this case.
+	 */
+	bool get( std::vector<const Pattern*>* pPlaying,
+			  std::vector<const Pattern*>* pNext ) const;
+
+private:
+	struct Version {
+		int nPlaying;
+		const Pattern* playing[ MAX_SNAPSHOT_PATTERNS ];
+		int nNext;
+		const Pattern* next[ MAX_SNAPSHOT_PATTERNS ];
+		/** Whether both lists did fit into the arrays.*/
+		bool bComplete;
+		/** Number of threads currently copying this version.*/
+		mutable std::atomic<int> nReaders;
+	};
+
+	/** \return true if @a pList holds the same patterns as the
+		first @a nPatterns entries of @a patterns.*/
+	static bool equals( const PatternList* pList, const Pattern* const* patterns,
+						int nPatterns );
+	/** Copies @a pList into @a patterns.
+		\return number of entries written or -1 if it did not fit.*/
+	static int fill( const PatternList* pList, const Pattern** patterns );
+
+	Version m_versions[ SNAPSHOT_VERSIONS ];
+	/** Version handed out by get() or nullptr.*/
+	std::atomic<Version*> m_pCurrent;
+};
+
+};
+
+#endif
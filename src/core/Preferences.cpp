@@ -24,6 +24,7 @@
 #include <core/Preferences.h>
 
 #include <core/LocalFileMng.h>
+#include <core/RealtimeConfig.h>
 
 #ifndef WIN32
 #include <pwd.h>
@@ -43,6 +44,7 @@
 #include "core/Helpers/Filesystem.h"
 
 #include <QDir>
+#include <QSaveFile>
 //#include <QApplication>
 
 namespace H2Core
@@ -132,6 +134,8 @@ Preferences::Preferences()
 	m_startOffset = 0;  // beatcounter
 
 	sServerList.push_back( QString("http://hydrogen-music.org/feeds/drumkit_list.php") );
+	m_nParallelDownloads = 4;
+	m_nDownloadRateLimit = 0;
 	m_patternCategories.push_back( QString("not_categorized") );
 
 	//___ audio engine properties ___
@@ -139,8 +143,51 @@ Preferences::Preferences()
 	m_bUseMetronome = false;
 	m_fMetronomeVolume = 0.5;
 	m_nMaxNotes = 256;
+	m_nSamplerWorkers = 0;
+	m_bParallelLadspaFX = false;
+	m_bOverloadGovernor = true;
+	m_bSampleStreaming = false;
+	m_nStreamingPreloadFrames = 65536;
+	m_bCompactSampleStorage = false;
+	m_bPackedSampleStorage = false;
+	m_bResampleSamples = false;
+	m_bTrimSampleSilence = false;
+	m_fSampleSilenceThreshold = -80;
+	m_bSampleCache = true;
+	m_bDeferUnusedSamples = false;
+	m_bSongCache = true;
+	m_bStrictXmlValidation = false;
+	m_bExportDither = false;
+	m_bExportNativeRate = false;
+	m_fExportTargetLoudness = 0;
+	m_bExportRenderCache = false;
+	m_nOutputChannels = 2;
+	m_bLinkEnabled = false;
+	m_fLinkQuantum = 4.0;
+	m_bNetworkStems = false;
+	m_sNetworkStemsHost = "127.0.0.1";
+	m_nNetworkStemsPort = 9910;
+	m_sNetworkStemsTracks = "0";
+	m_bMetrics = false;
+	m_sMetricsProtocol = "prometheus";
+	m_sMetricsHost = "127.0.0.1";
+	m_nMetricsPort = 9911;
+
+	//___ thread configuration ___
+	m_nAudioThreadPriority = 50;
+	m_nMidiThreadPriority = 0;
+	m_sAudioThreadCpus = "";
+	m_sMidiThreadCpus = "";
+	m_sBackgroundThreadCpus = "";
+	m_bLockMemory = false;
+	m_bLockSampleMemory = false;
+	m_nSampleMemoryLockLimit = 1024;
+	m_nSampleMemoryBudget = 0;
+	m_sampleArenaPages = SampleArenaPages::transparent;
+	m_VoiceStealing = VoiceStealing::oldest;
 	m_nBufferSize = 1024;
 	m_nSampleRate = 44100;
+	m_nRenderAheadBuffers = 0;
 
 	//___ oss driver properties ___
 	m_sOSSDevice = QString("/dev/dsp");
@@ -153,9 +200,23 @@ Preferences::Preferences()
 	m_bMidiNoteOffIgnore = false;
 	m_bMidiFixedMapping = false;
 	m_bMidiDiscardNoteAfterAction = false;
+	m_nMidiCCCoalescingWindow = 0;
 
 	//___  alsa audio driver properties ___
 	m_sAlsaAudioDevice = QString("hw:0");
+	m_bAlsaMmap = true;
+
+	//___  pulseaudio driver properties ___
+	m_nPulseAudioTargetLength = 0;
+	m_nPulseAudioMinRequest = 0;
+
+	//___  portaudio driver properties ___
+	m_sPortAudioDevice = "";
+	m_nPortAudioLatency = 0;
+	m_bPortAudioExclusive = false;
+
+	//___  coreaudio driver properties ___
+	m_fCoreAudioIOCycleUsage = 1.0;
 
 	//___  jack driver properties ___
 	m_sJackPortName1 = QString("alsa_pcm:playback_1");
@@ -163,9 +224,11 @@ Preferences::Preferences()
 	m_bJackTransportMode = true;
 	m_bJackConnectDefaults = true;
 	m_bJackTrackOuts = false;
+	m_bJackCueOutput = false;
 	m_bJackTimebaseEnabled = true;
 	m_bJackMasterMode = NO_JACK_TIME_MASTER;
 	m_JackTrackOutputMode = JackTrackOutputMode::postFader;
+	m_bJackFreewheelExport = false;
 	m_JackBBTSync = JackBBTSyncMethod::constMeasure;
 
 	// OSC configuration
@@ -173,6 +236,7 @@ Preferences::Preferences()
 	m_bOscFeedbackEnabled = true;
 	m_nOscServerPort = 9000;
 	m_nOscTemporaryPort = -1;
+	m_bIndexLibraries = true;
 
 	//___ General properties ___
 	m_bPatternModePlaysSelected = true;
@@ -380,6 +444,8 @@ void Preferences::loadPreferences( bool bGlobal )
 			} else {
 				WARNINGLOG( "serverList node not found" );
 			}
+			m_nParallelDownloads = std::max( 1, LocalFileMng::readXmlInt( rootNode, "parallelDownloads", m_nParallelDownloads, false, false ) );
+			m_nDownloadRateLimit = std::max( 0, LocalFileMng::readXmlInt( rootNode, "downloadRateLimit", m_nDownloadRateLimit, false, false ) );
 
 			m_patternCategories.clear();
 			QDomNode pPatternCategoriesNode = rootNode.firstChildElement( "patternCategories" );
@@ -415,8 +481,58 @@ void Preferences::loadPreferences( bool bGlobal )
 				m_bUseMetronome = LocalFileMng::readXmlBool( audioEngineNode, "use_metronome", m_bUseMetronome );
 				m_fMetronomeVolume = LocalFileMng::readXmlFloat( audioEngineNode, "metronome_volume", 0.5f );
 				m_nMaxNotes = LocalFileMng::readXmlInt( audioEngineNode, "maxNotes", m_nMaxNotes );
+				m_nSamplerWorkers = LocalFileMng::readXmlInt( audioEngineNode, "sampler_workers", m_nSamplerWorkers );
+				m_bParallelLadspaFX = LocalFileMng::readXmlBool( audioEngineNode, "parallel_ladspa_fx", m_bParallelLadspaFX );
+				m_bOverloadGovernor = LocalFileMng::readXmlBool( audioEngineNode, "overload_governor", m_bOverloadGovernor );
+				m_bSampleStreaming = LocalFileMng::readXmlBool( audioEngineNode, "sample_streaming", m_bSampleStreaming );
+				m_nStreamingPreloadFrames = LocalFileMng::readXmlInt( audioEngineNode, "streaming_preload_frames", m_nStreamingPreloadFrames );
+				m_bCompactSampleStorage = LocalFileMng::readXmlBool( audioEngineNode, "compact_sample_storage", m_bCompactSampleStorage );
+				m_bPackedSampleStorage = LocalFileMng::readXmlBool( audioEngineNode, "packed_sample_storage", m_bPackedSampleStorage );
+				m_bResampleSamples = LocalFileMng::readXmlBool( audioEngineNode, "resample_samples", m_bResampleSamples );
+				m_bTrimSampleSilence = LocalFileMng::readXmlBool( audioEngineNode, "trim_sample_silence", m_bTrimSampleSilence );
+				m_fSampleSilenceThreshold = std::min( 0.0f, LocalFileMng::readXmlFloat( audioEngineNode, "sample_silence_threshold", m_fSampleSilenceThreshold ) );
+				m_bSampleCache = LocalFileMng::readXmlBool( audioEngineNode, "sample_cache", m_bSampleCache );
+				m_bDeferUnusedSamples = LocalFileMng::readXmlBool( audioEngineNode, "defer_unused_samples", m_bDeferUnusedSamples );
+				m_bSongCache = LocalFileMng::readXmlBool( audioEngineNode, "song_cache", m_bSongCache );
+				m_bStrictXmlValidation = LocalFileMng::readXmlBool( audioEngineNode, "strict_xml_validation", m_bStrictXmlValidation );
+				m_bExportDither = LocalFileMng::readXmlBool( audioEngineNode, "export_dither", m_bExportDither );
+				m_bExportNativeRate = LocalFileMng::readXmlBool( audioEngineNode, "export_native_rate", m_bExportNativeRate );
+				m_fExportTargetLoudness = std::min( 0.0f, LocalFileMng::readXmlFloat( audioEngineNode, "export_target_loudness", m_fExportTargetLoudness ) );
+				m_bExportRenderCache = LocalFileMng::readXmlBool( audioEngineNode, "export_render_cache", m_bExportRenderCache );
+				m_nOutputChannels = std::max( 2, LocalFileMng::readXmlInt( audioEngineNode, "output_channels", m_nOutputChannels ) );
+				m_bLinkEnabled = LocalFileMng::readXmlBool( audioEngineNode, "link_enabled", m_bLinkEnabled );
+				m_fLinkQuantum = std::max( 1.0f, LocalFileMng::readXmlFloat( audioEngineNode, "link_quantum", m_fLinkQuantum ) );
+				m_bNetworkStems = LocalFileMng::readXmlBool( audioEngineNode, "network_stems", m_bNetworkStems );
+				m_sNetworkStemsHost = LocalFileMng::readXmlString( audioEngineNode, "network_stems_host", m_sNetworkStemsHost );
+				m_nNetworkStemsPort = LocalFileMng::readXmlInt( audioEngineNode, "network_stems_port", m_nNetworkStemsPort );
+				m_sNetworkStemsTracks = LocalFileMng::readXmlString( audioEngineNode, "network_stems_tracks", m_sNetworkStemsTracks );
+				m_bMetrics = LocalFileMng::readXmlBool( audioEngineNode, "metrics", m_bMetrics );
+				m_sMetricsProtocol = LocalFileMng::readXmlString( audioEngineNode, "metrics_protocol", m_sMetricsProtocol );
+				m_sMetricsHost = LocalFileMng::readXmlString( audioEngineNode, "metrics_host", m_sMetricsHost );
+				m_nMetricsPort = LocalFileMng::readXmlInt( audioEngineNode, "metrics_port", m_nMetricsPort );
+
+				int nVoiceStealing = LocalFileMng::readXmlInt( audioEngineNode, "voice_stealing", 0 );
+				switch ( nVoiceStealing ) {
+				case 0:
+					m_VoiceStealing = VoiceStealing::oldest;
+					break;
+				case 1:
+					m_VoiceStealing = VoiceStealing::quietest;
+					break;
+				case 2:
+					m_VoiceStealing = VoiceStealing::released;
+					break;
+				case 3:
+					m_VoiceStealing = VoiceStealing::sameInstrument;
+					break;
+				default:
+					WARNINGLOG( QString( "Unknown voice_stealing value [%1]. Using VoiceStealing::oldest instead." )
+								.arg( nVoiceStealing ) );
+					m_VoiceStealing = VoiceStealing::oldest;
+				}
 				m_nBufferSize = LocalFileMng::readXmlInt( audioEngineNode, "buffer_size", m_nBufferSize );
 				m_nSampleRate = LocalFileMng::readXmlInt( audioEngineNode, "samplerate", m_nSampleRate );
+				m_nRenderAheadBuffers = std::max( 0, LocalFileMng::readXmlInt( audioEngineNode, "render_ahead_buffers", m_nRenderAheadBuffers, false, false ) );
 
 				//// OSS DRIVER ////
 				QDomNode ossDriverNode = audioEngineNode.firstChildElement( "oss_driver" );
@@ -464,7 +580,9 @@ void Preferences::loadPreferences( bool bGlobal )
 					//~ jack time master
 
 					m_bJackTrackOuts = LocalFileMng::readXmlBool( jackDriverNode, "jack_track_outs", m_bJackTrackOuts );
+					m_bJackCueOutput = LocalFileMng::readXmlBool( jackDriverNode, "jack_cue_output", m_bJackCueOutput );
 					m_bJackConnectDefaults = LocalFileMng::readXmlBool( jackDriverNode, "jack_connect_defaults", m_bJackConnectDefaults );
+					m_bJackFreewheelExport = LocalFileMng::readXmlBool( jackDriverNode, "jack_freewheel_export", m_bJackFreewheelExport );
 
 					int nJackTrackOutputMode = LocalFileMng::readXmlInt( jackDriverNode, "jack_track_output_mode", 0 );
 					switch ( nJackTrackOutputMode ) {
@@ -489,6 +607,65 @@ void Preferences::loadPreferences( bool bGlobal )
 					recreate = true;
 				} else {
 					m_sAlsaAudioDevice = LocalFileMng::readXmlString( alsaAudioDriverNode, "alsa_audio_device", m_sAlsaAudioDevice );
+					m_bAlsaMmap = LocalFileMng::readXmlBool( alsaAudioDriverNode, "mmap", m_bAlsaMmap, false );
+					// Written by former versions before the thread
+					// configuration was shared by all drivers.
+					m_nAudioThreadPriority = std::max( 0, LocalFileMng::readXmlInt( alsaAudioDriverNode, "realtime_priority", m_nAudioThreadPriority, false, false ) );
+				}
+
+				/// THREADS ///
+				QDomNode threadsNode = audioEngineNode.firstChildElement( "threads" );
+				if ( ! threadsNode.isNull() ) {
+					m_nAudioThreadPriority = std::max( 0, LocalFileMng::readXmlInt( threadsNode, "audio_priority", m_nAudioThreadPriority, false, false ) );
+					m_nMidiThreadPriority = std::max( 0, LocalFileMng::readXmlInt( threadsNode, "midi_priority", m_nMidiThreadPriority, false, false ) );
+					m_sAudioThreadCpus = LocalFileMng::readXmlString( threadsNode, "audio_cpus", m_sAudioThreadCpus, true, false );
+					m_sMidiThreadCpus = LocalFileMng::readXmlString( threadsNode, "midi_cpus", m_sMidiThreadCpus, true, false );
+					m_sBackgroundThreadCpus = LocalFileMng::readXmlString( threadsNode, "background_cpus", m_sBackgroundThreadCpus, true, false );
+					m_bLockMemory = LocalFileMng::readXmlBool( threadsNode, "lock_memory", m_bLockMemory, false );
+					m_bLockSampleMemory = LocalFileMng::readXmlBool( threadsNode, "lock_samples", m_bLockSampleMemory, false );
+					m_nSampleMemoryLockLimit = std::max( 0, LocalFileMng::readXmlInt( threadsNode, "lock_samples_limit", m_nSampleMemoryLockLimit, false, false ) );
+					m_nSampleMemoryBudget = std::max( 0, LocalFileMng::readXmlInt( threadsNode, "sample_memory_budget", m_nSampleMemoryBudget, false, false ) );
+					int nSampleArenaPages = LocalFileMng::readXmlInt( threadsNode, "sample_arena_pages",
+																	  static_cast<int>( m_sampleArenaPages ), false, false );
+					switch ( nSampleArenaPages ) {
+					case 0:
+						m_sampleArenaPages = SampleArenaPages::heap;
+						break;
+					case 1:
+						m_sampleArenaPages = SampleArenaPages::transparent;
+						break;
+					case 2:
+						m_sampleArenaPages = SampleArenaPages::hugeTlb;
+						break;
+					default:
+						WARNINGLOG( QString( "Unknown sample_arena_pages value [%1]. Using SampleArenaPages::transparent instead." )
+									.arg( nSampleArenaPages ) );
+						m_sampleArenaPages = SampleArenaPages::transparent;
+					}
+				}
+
+				/// PULSEAUDIO DRIVER ///
+				QDomNode pulseAudioDriverNode = audioEngineNode.firstChildElement( "pulseaudio_driver" );
+				if ( ! pulseAudioDriverNode.isNull() ) {
+					m_nPulseAudioTargetLength = std::max( 0, LocalFileMng::readXmlInt( pulseAudioDriverNode, "target_length", m_nPulseAudioTargetLength, false, false ) );
+					m_nPulseAudioMinRequest = std::max( 0, LocalFileMng::readXmlInt( pulseAudioDriverNode, "min_request", m_nPulseAudioMinRequest, false, false ) );
+				}
+
+				/// PORTAUDIO DRIVER ///
+				QDomNode portAudioDriverNode = audioEngineNode.firstChildElement( "portaudio_driver" );
+				if ( ! portAudioDriverNode.isNull() ) {
+					m_sPortAudioDevice = LocalFileMng::readXmlString( portAudioDriverNode, "device", m_sPortAudioDevice, true, false );
+					m_nPortAudioLatency = std::max( 0, LocalFileMng::readXmlInt( portAudioDriverNode, "latency", m_nPortAudioLatency, false, false ) );
+					m_bPortAudioExclusive = LocalFileMng::readXmlBool( portAudioDriverNode, "exclusive", m_bPortAudioExclusive, false );
+				}
+
+				/// COREAUDIO DRIVER ///
+				QDomNode coreAudioDriverNode = audioEngineNode.firstChildElement( "coreaudio_driver" );
+				if ( ! coreAudioDriverNode.isNull() ) {
+					m_fCoreAudioIOCycleUsage = LocalFileMng::readXmlFloat( coreAudioDriverNode, "io_cycle_usage", m_fCoreAudioIOCycleUsage, false, false );
+					if ( m_fCoreAudioIOCycleUsage <= 0 || m_fCoreAudioIOCycleUsage > 1 ) {
+						m_fCoreAudioIOCycleUsage = 1.0;
+					}
 				}
 
 				/// MIDI DRIVER ///
@@ -514,6 +691,7 @@ void Preferences::loadPreferences( bool bGlobal )
 					m_bMidiDiscardNoteAfterAction = LocalFileMng::readXmlBool( midiDriverNode, "discard_note_after_action", true);
 					m_bMidiFixedMapping = LocalFileMng::readXmlBool( midiDriverNode, "fixed_mapping", false, true );
 					m_bEnableMidiFeedback = LocalFileMng::readXmlBool( midiDriverNode, "enable_midi_feedback", false, true );
+					m_nMidiCCCoalescingWindow = std::max( 0, LocalFileMng::readXmlInt( midiDriverNode, "cc_coalescing_window", 0, false, false ) );
 				}
 
 				/// OSC ///
@@ -727,6 +905,13 @@ void Preferences::loadPreferences( bool bGlobal )
 		WARNINGLOG( "Recreating configuration file." );
 		savePreferences();
 	}
+
+	publishRealtimeConfig();
+}
+
+void Preferences::publishRealtimeConfig()
+{
+	RealtimeConfig::publish( this );
 }
 
 
@@ -831,6 +1016,8 @@ void Preferences::savePreferences()
 		LocalFileMng::writeXmlString( serverListNode , QString("server") , QString( *cur_Server ) );
 	}
 	rootNode.appendChild( serverListNode );
+	LocalFileMng::writeXmlString( rootNode, "parallelDownloads", QString::number( m_nParallelDownloads ) );
+	LocalFileMng::writeXmlString( rootNode, "downloadRateLimit", QString::number( m_nDownloadRateLimit ) );
 
 
 	std::list<QString>::const_iterator cur_patternCategories;
@@ -853,8 +1040,40 @@ void Preferences::savePreferences()
 		LocalFileMng::writeXmlString( audioEngineNode, "use_metronome", m_bUseMetronome ? "true": "false" );
 		LocalFileMng::writeXmlString( audioEngineNode, "metronome_volume", QString("%1").arg( m_fMetronomeVolume ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "maxNotes", QString("%1").arg( m_nMaxNotes ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sampler_workers", QString("%1").arg( m_nSamplerWorkers ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "parallel_ladspa_fx", m_bParallelLadspaFX );
+		LocalFileMng::writeXmlBool( audioEngineNode, "overload_governor", m_bOverloadGovernor );
+		LocalFileMng::writeXmlBool( audioEngineNode, "sample_streaming", m_bSampleStreaming );
+		LocalFileMng::writeXmlString( audioEngineNode, "streaming_preload_frames", QString("%1").arg( m_nStreamingPreloadFrames ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "compact_sample_storage", m_bCompactSampleStorage );
+		LocalFileMng::writeXmlBool( audioEngineNode, "packed_sample_storage", m_bPackedSampleStorage );
+		LocalFileMng::writeXmlBool( audioEngineNode, "resample_samples", m_bResampleSamples );
+		LocalFileMng::writeXmlBool( audioEngineNode, "trim_sample_silence", m_bTrimSampleSilence );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_silence_threshold", QString("%1").arg( m_fSampleSilenceThreshold ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "sample_cache", m_bSampleCache );
+		LocalFileMng::writeXmlBool( audioEngineNode, "defer_unused_samples", m_bDeferUnusedSamples );
+		LocalFileMng::writeXmlBool( audioEngineNode, "song_cache", m_bSongCache );
+		LocalFileMng::writeXmlBool( audioEngineNode, "strict_xml_validation", m_bStrictXmlValidation );
+		LocalFileMng::writeXmlBool( audioEngineNode, "export_dither", m_bExportDither );
+		LocalFileMng::writeXmlBool( audioEngineNode, "export_native_rate", m_bExportNativeRate );
+		LocalFileMng::writeXmlString( audioEngineNode, "export_target_loudness", QString("%1").arg( m_fExportTargetLoudness ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "export_render_cache", m_bExportRenderCache );
+		LocalFileMng::writeXmlString( audioEngineNode, "output_channels", QString("%1").arg( m_nOutputChannels ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "link_enabled", m_bLinkEnabled );
+		LocalFileMng::writeXmlString( audioEngineNode, "link_quantum", QString("%1").arg( m_fLinkQuantum ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "network_stems", m_bNetworkStems );
+		LocalFileMng::writeXmlString( audioEngineNode, "network_stems_host", m_sNetworkStemsHost );
+		LocalFileMng::writeXmlString( audioEngineNode, "network_stems_port", QString("%1").arg( m_nNetworkStemsPort ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "network_stems_tracks", m_sNetworkStemsTracks );
+		LocalFileMng::writeXmlBool( audioEngineNode, "metrics", m_bMetrics );
+		LocalFileMng::writeXmlString( audioEngineNode, "metrics_protocol", m_sMetricsProtocol );
+		LocalFileMng::writeXmlString( audioEngineNode, "metrics_host", m_sMetricsHost );
+		LocalFileMng::writeXmlString( audioEngineNode, "metrics_port", QString("%1").arg( m_nMetricsPort ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "voice_stealing",
+									  QString("%1").arg( static_cast<int>( m_VoiceStealing ) ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "buffer_size", QString("%1").arg( m_nBufferSize ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "samplerate", QString("%1").arg( m_nSampleRate ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "render_ahead_buffers", QString("%1").arg( m_nRenderAheadBuffers ) );
 
 		//// OSS DRIVER ////
 		QDomNode ossDriverNode = doc.createElement( "oss_driver" );
@@ -920,6 +1139,8 @@ void Preferences::savePreferences()
 				jackTrackOutsString = "true";
 			}
 			LocalFileMng::writeXmlString( jackDriverNode, "jack_track_outs", jackTrackOutsString );
+			LocalFileMng::writeXmlBool( jackDriverNode, "jack_cue_output", m_bJackCueOutput );
+			LocalFileMng::writeXmlBool( jackDriverNode, "jack_freewheel_export", m_bJackFreewheelExport );
 		}
 		audioEngineNode.appendChild( jackDriverNode );
 
@@ -927,9 +1148,51 @@ void Preferences::savePreferences()
 		QDomNode alsaAudioDriverNode = doc.createElement( "alsa_audio_driver" );
 		{
 			LocalFileMng::writeXmlString( alsaAudioDriverNode, "alsa_audio_device", m_sAlsaAudioDevice );
+			LocalFileMng::writeXmlString( alsaAudioDriverNode, "mmap", m_bAlsaMmap ? "true" : "false" );
 		}
 		audioEngineNode.appendChild( alsaAudioDriverNode );
 
+		//// PULSEAUDIO DRIVER ////
+		QDomNode pulseAudioDriverNode = doc.createElement( "pulseaudio_driver" );
+		{
+			LocalFileMng::writeXmlString( pulseAudioDriverNode, "target_length", QString("%1").arg( m_nPulseAudioTargetLength ) );
+			LocalFileMng::writeXmlString( pulseAudioDriverNode, "min_request", QString("%1").arg( m_nPulseAudioMinRequest ) );
+		}
+		audioEngineNode.appendChild( pulseAudioDriverNode );
+
+		//// PORTAUDIO DRIVER ////
+		QDomNode portAudioDriverNode = doc.createElement( "portaudio_driver" );
+		{
+			LocalFileMng::writeXmlString( portAudioDriverNode, "device", m_sPortAudioDevice );
+			LocalFileMng::writeXmlString( portAudioDriverNode, "latency", QString("%1").arg( m_nPortAudioLatency ) );
+			LocalFileMng::writeXmlBool( portAudioDriverNode, "exclusive", m_bPortAudioExclusive );
+		}
+		audioEngineNode.appendChild( portAudioDriverNode );
+
+		//// COREAUDIO DRIVER ////
+		QDomNode coreAudioDriverNode = doc.createElement( "coreaudio_driver" );
+		{
+			LocalFileMng::writeXmlString( coreAudioDriverNode, "io_cycle_usage", QString("%1").arg( m_fCoreAudioIOCycleUsage ) );
+		}
+		audioEngineNode.appendChild( coreAudioDriverNode );
+
+		//// THREADS ////
+		QDomNode threadsNode = doc.createElement( "threads" );
+		{
+			LocalFileMng::writeXmlString( threadsNode, "audio_priority", QString("%1").arg( m_nAudioThreadPriority ) );
+			LocalFileMng::writeXmlString( threadsNode, "midi_priority", QString("%1").arg( m_nMidiThreadPriority ) );
+			LocalFileMng::writeXmlString( threadsNode, "audio_cpus", m_sAudioThreadCpus );
+			LocalFileMng::writeXmlString( threadsNode, "midi_cpus", m_sMidiThreadCpus );
+			LocalFileMng::writeXmlString( threadsNode, "background_cpus", m_sBackgroundThreadCpus );
+			LocalFileMng::writeXmlBool( threadsNode, "lock_memory", m_bLockMemory );
+			LocalFileMng::writeXmlBool( threadsNode, "lock_samples", m_bLockSampleMemory );
+			LocalFileMng::writeXmlString( threadsNode, "lock_samples_limit", QString("%1").arg( m_nSampleMemoryLockLimit ) );
+			LocalFileMng::writeXmlString( threadsNode, "sample_memory_budget", QString("%1").arg( m_nSampleMemoryBudget ) );
+			LocalFileMng::writeXmlString( threadsNode, "sample_arena_pages",
+										  QString("%1").arg( static_cast<int>( m_sampleArenaPages ) ) );
+		}
+		audioEngineNode.appendChild( threadsNode );
+
 		/// MIDI DRIVER ///
 		QDomNode midiDriverNode = doc.createElement( "midi_driver" );
 		{
@@ -963,6 +1226,8 @@ void Preferences::savePreferences()
 				LocalFileMng::writeXmlString( midiDriverNode, "fixed_mapping", "false" );
 				INFOLOG("Saving fixed mapping false\n");
 			}
+
+			LocalFileMng::writeXmlString( midiDriverNode, "cc_coalescing_window", QString("%1").arg( m_nMidiCCCoalescingWindow ) );
 		}
 		audioEngineNode.appendChild( midiDriverNode );
 		
@@ -1144,15 +1409,27 @@ void Preferences::savePreferences()
 
 	doc.appendChild( rootNode );
 
-	QFile file( sPreferencesFilename );
-	if ( !file.open(QIODevice::WriteOnly) ) {
+	QByteArray content = doc.toString( 1 ).toUtf8();
+
+	// Most saves - e.g. the ones requested by a session manager - do
+	// not change a thing. Leave the file untouched in that case.
+	QFile previousFile( sPreferencesFilename );
+	if ( previousFile.open( QIODevice::ReadOnly ) && previousFile.readAll() == content ) {
+		INFOLOG( "Preferences unchanged" );
 		return;
 	}
+	previousFile.close();
 
-	QTextStream TextStream( &file );
-	doc.save( TextStream, 1 );
-
-	file.close();
+	QSaveFile file( sPreferencesFilename );
+	file.setDirectWriteFallback( true );
+	if ( !file.open( QIODevice::WriteOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1 for writing" ).arg( sPreferencesFilename ) );
+		return;
+	}
+	if ( file.write( content ) != content.size() || !file.commit() ) {
+		ERRORLOG( QString( "Unable to write %1: %2" )
+				  .arg( sPreferencesFilename ).arg( file.errorString() ) );
+	}
 }
 
 void Preferences::setMostRecentFX( QString FX_name )
@@ -198,6 +198,13 @@ public:
 
 	// switch to enable / disable lash, only on h2 startup
 	bool				m_brestartLash;
+	/**
+	 * Whether the DrumkitIndex and the PatternIndex - scanning the
+	 * drumkit and pattern libraries - are created on startup. Turned
+	 * off by applications not browsing the libraries, like the
+	 * h2player. Not saved.
+	 */
+	bool				m_bIndexLibraries;
 	bool				m_bsetLash;
 
 	//soundlibrarypanel expand song and pattern item
@@ -213,6 +220,12 @@ public:
 	//~ beatcounter
 
 	std::list<QString> 		sServerList;
+	/** Maximum number of sound library items downloaded at once by
+		the SoundLibraryImportDialog.*/
+	int					m_nParallelDownloads;
+	/** Maximum rate in KiB/s all downloads of the
+		SoundLibraryImportDialog share. 0 for no limit.*/
+	int					m_nDownloadRateLimit;
 	std::list<QString> 		m_patternCategories;
 
 	//	audio engine properties ___
@@ -231,6 +244,7 @@ public:
 	 * - "PortAudio" : createDriver() will create a PortAudioDriver.
 	 * - "Oss" : createDriver() will create a OssDriver.
 	 * - "PulseAudio" : createDriver() will create a PulseAudioDriver.
+	 * - "PipeWire" : createDriver() will create a PipeWireDriver.
 	 * - "Fake" : createDriver() will create a FakeDriver.
 	 */
 	QString				m_sAudioDriver;
@@ -242,6 +256,248 @@ public:
 	float				m_fMetronomeVolume;
 	/// max notes
 	unsigned			m_nMaxNotes;
+	/**
+	 * Number of realtime worker threads helping the audio thread to
+	 * render the voices of the Sampler. If set to zero, all voices
+	 * are rendered within the audio thread itself.
+	 *
+	 * The threads are spawned on startup of the Sampler. Changing
+	 * this value does require a restart.
+	 */
+	int					m_nSamplerWorkers;
+	/**
+	 * If set, the enabled LADSPA send effects are processed in
+	 * parallel on the worker threads of the Sampler (see
+	 * #m_nSamplerWorkers). Has no effect if there are none.
+	 */
+	bool				m_bParallelLadspaFX;
+	/**
+	 * If set, the OverloadGovernor lowers the rendering quality
+	 * step by step while the audio engine is close to overrunning
+	 * its cycles and restores it once there is headroom again.
+	 * Exports are not affected.
+	 */
+	bool				m_bOverloadGovernor;
+	/**
+	 * If set, only the first #m_nStreamingPreloadFrames frames of
+	 * the samples of a drumkit are loaded into memory. The remaining
+	 * ones are read from disk by a background thread while a voice
+	 * is playing.
+	 *
+	 * Evaluated on startup of the Sampler. Changing this value
+	 * does require a restart.
+	 */
+	bool				m_bSampleStreaming;
+	/** Number of frames of each streamed sample kept in memory.*/
+	int					m_nStreamingPreloadFrames;
+	/**
+	 * If set, drumkit samples encoded with at most 16 bit are kept
+	 * in memory in their native resolution and mono ones in a
+	 * single channel. They are converted to float by the Sampler
+	 * while rendering. See Sample::is_compact().
+	 *
+	 * Evaluated on startup of the Sampler. Changing this value
+	 * does require a restart.
+	 */
+	bool				m_bCompactSampleStorage;
+	/**
+	 * If set, long drumkit samples encoded with at most 16 bit are
+	 * kept in memory losslessly compressed. Only their first
+	 * #m_nStreamingPreloadFrames are held as float and the
+	 * SampleStreamer decodes the remaining ones ahead of playback.
+	 * Takes precedence over both #m_bSampleStreaming and
+	 * #m_bCompactSampleStorage. See SamplePack.
+	 *
+	 * Evaluated on startup of the Sampler. Changing this value
+	 * does require a restart.
+	 */
+	bool				m_bPackedSampleStorage;
+	/**
+	 * If set, drumkit samples recorded at a rate other than the one
+	 * of the audio driver are resampled once while loading. This
+	 * way they are not interpolated each time they are played. See
+	 * Sample::set_resample_rate().
+	 *
+	 * Evaluated when starting the audio driver. Samples already
+	 * loaded are not affected.
+	 */
+	bool				m_bResampleSamples;
+	/**
+	 * If set, the silent head and tail of each drumkit sample are
+	 * determined while loading. Voices end as soon as they reach
+	 * the tail and blocks within the head are not rendered. See
+	 * Sample::detect_silence().
+	 *
+	 * Evaluated on startup of the Sampler. Samples already loaded
+	 * are not affected.
+	 */
+	bool				m_bTrimSampleSilence;
+	/** Level in dBFS below which frames are considered silent by
+		#m_bTrimSampleSilence.*/
+	float				m_fSampleSilenceThreshold;
+	/**
+	 * If set, the decoded data of each loaded sample is stored in
+	 * Filesystem::samples_cache_dir() and mapped into memory when
+	 * loading the same, unchanged file again. See SampleCache.
+	 */
+	bool				m_bSampleCache;
+	/**
+	 * If set, opening a song does only decode the samples selected
+	 * by the velocities of the notes in its patterns. All other
+	 * layers are silent until the DeferredSampleLoader decoded them
+	 * in the background.
+	 */
+	bool				m_bDeferUnusedSamples;
+	/**
+	 * If set, each song read successfully is stored in
+	 * Filesystem::songs_cache_dir() and restored from there instead
+	 * of parsing the XML again as long as the file is unchanged. See
+	 * SongCache.
+	 */
+	bool				m_bSongCache;
+	/**
+	 * If set, XMLDoc::read() does validate each document against its
+	 * schema. Otherwise the result of a previous validation of the
+	 * very same file content is reused. Documents are always
+	 * validated when installing a drumkit.
+	 */
+	bool				m_bStrictXmlValidation;
+	/**
+	 * If set, exports to 16 bit files are converted with a
+	 * triangular dither of one least significant bit instead of
+	 * being rounded by libsndfile. See ExportWriter.
+	 */
+	bool				m_bExportDither;
+	/**
+	 * If set, the DiskWriterDriver renders songs at the rate most
+	 * of their samples were recorded at and a single Resampler per
+	 * exported file converts the result to the requested rate,
+	 * instead of every voice being interpolated.
+	 */
+	bool				m_bExportNativeRate;
+	/**
+	 * Integrated loudness in LUFS exported songs are normalized to
+	 * by the ExportWriter, limited by a true peak of -1 dBTP. Zero
+	 * disables the normalization. Stems are never normalized.
+	 */
+	float				m_fExportTargetLoudness;
+	/**
+	 * If set, the DiskWriterDriver renders each combination of
+	 * patterns only once per export and writes the cached audio
+	 * whenever it recurs. Columns are only cached while the song
+	 * renders deterministically, i.e. without humanization,
+	 * probabilities, LADSPA effects, or voices ringing across
+	 * column boundaries.
+	 */
+	bool				m_bExportRenderCache;
+	/**
+	 * Number of channels opened on the device by the ALSA, PortAudio,
+	 * and CoreAudio drivers. The first two carry the main output.
+	 * Each further pair carries the per-track output of an instrument
+	 * or output bus in the order of the instrument list, like the
+	 * ports created for #m_bJackTrackOuts. See TrackOutputs.
+	 */
+	int					m_nOutputChannels;
+	/**
+	 * Whether to synchronize tempo and beat with other applications
+	 * on the network using Ableton Link. See LinkTransport.
+	 */
+	bool				m_bLinkEnabled;
+	/**
+	 * Number of beats the phase of the Link session is aligned
+	 * over.
+	 */
+	float				m_fLinkQuantum;
+	/**
+	 * Whether to stream the tracks in #m_sNetworkStemsTracks to
+	 * #m_sNetworkStemsHost. See NetworkStemOutput.
+	 */
+	bool				m_bNetworkStems;
+	/** Name or address of the host receiving the tracks.*/
+	QString				m_sNetworkStemsHost;
+	/** UDP port the tracks are sent to.*/
+	int					m_nNetworkStemsPort;
+	/** Comma separated list of the streamed tracks. 0 is the main
+		output and n the n-th per-track output.*/
+	QString				m_sNetworkStemsTracks;
+	/**
+	 * Whether to export health metrics using
+	 * #m_sMetricsProtocol. See MetricsExporter.
+	 */
+	bool				m_bMetrics;
+	/** "prometheus" to serve the metrics over HTTP or "statsd" to
+		push them to a StatsD daemon.*/
+	QString				m_sMetricsProtocol;
+	/** Address the Prometheus endpoint listens on or host of the
+		StatsD daemon.*/
+	QString				m_sMetricsHost;
+	/** TCP port of the Prometheus endpoint or UDP port of the
+		StatsD daemon.*/
+	int					m_nMetricsPort;
+
+	//___ thread configuration ___
+	/** SCHED_FIFO priority of the threads running the process cycle.
+		0 keeps the default scheduling. See Threads::Role::Audio.*/
+	int					m_nAudioThreadPriority;
+	/** SCHED_FIFO priority of the threads receiving MIDI events. 0
+		keeps the default scheduling. See Threads::Role::Midi.*/
+	int					m_nMidiThreadPriority;
+	/** CPUs the threads running the process cycle are restricted
+		to, like "2,3" or "2-3". An empty string allows all of them.*/
+	QString				m_sAudioThreadCpus;
+	/** CPUs the threads receiving MIDI events are restricted to.
+		Same format as #m_sAudioThreadCpus.*/
+	QString				m_sMidiThreadCpus;
+	/** CPUs the threads doing disk I/O, logging, and OSC feedback
+		are restricted to. Same format as #m_sAudioThreadCpus.*/
+	QString				m_sBackgroundThreadCpus;
+	/** Whether the memory of Hydrogen, including the samples, is
+		locked into RAM to avoid page faults within the process
+		cycle. See Threads::lockMemory().*/
+	bool				m_bLockMemory;
+	/** Whether the data of loaded samples is locked into RAM. See
+		SampleMemory::prepare().*/
+	bool				m_bLockSampleMemory;
+	/** Upper limit of the sample data locked into RAM in MB.
+		Samples beyond are pre-touched only.*/
+	int					m_nSampleMemoryLockLimit;
+	/** Upper limit of the sample data resident in RAM in MB, 0 for
+		none. Data of the samples not played for the longest time
+		is dropped beyond and read from the SampleCache again once
+		needed. See SampleMemory::enforce_budget().*/
+	int					m_nSampleMemoryBudget;
+	/** Pages the data of loaded samples is allocated in. See
+		SampleArena.*/
+	enum class SampleArenaPages {
+		/** Each buffer is allocated on the heap.*/
+		heap = 0,
+		/** Regions of the SampleArena backed by transparent huge
+			pages if the kernel supports them.*/
+		transparent = 1,
+		/** Regions of the SampleArena backed by huge pages reserved
+			via MAP_HUGETLB. Falls back to
+			SampleArenaPages::transparent if there are none.*/
+		hugeTlb = 2 };
+	SampleArenaPages	m_sampleArenaPages;
+
+	/** Specifies which voice the Sampler does silence once more
+		than #m_nMaxNotes voices are playing.*/
+	enum class VoiceStealing {
+		/** The voice started first.*/
+		oldest = 0,
+		/** The voice with the lowest product of velocity, envelope,
+			and instrument volume.*/
+		quietest = 1,
+		/** The oldest voice already released. Falls back to
+			VoiceStealing::oldest if there is none.*/
+		released = 2,
+		/** The oldest voice of the instrument started most
+			recently. Falls back to VoiceStealing::oldest if this
+			instrument does not play more than one voice.*/
+		sameInstrument = 3 };
+	/** Policy used to pick the voices to silence. Stolen voices are
+		faded out instead of being cut off.*/
+	VoiceStealing		m_VoiceStealing;
 	/** 
 	 * Buffer size of the audio.
 	 *
@@ -256,6 +512,16 @@ public:
 	 * rate of the freshly opened JACK client.
 	 */
 	unsigned			m_nSampleRate;
+	/**
+	 * Number of buffers rendered ahead of the playback by the
+	 * drivers with loose deadlines, like the PulseAudio and ALSA
+	 * ones. 0 renders each buffer within the driver thread right
+	 * before it is played back.
+	 *
+	 * Each buffer rendered ahead adds #m_nBufferSize frames to the
+	 * latency of live input. See RenderAhead.
+	 */
+	int					m_nRenderAheadBuffers;
 
 	//	OSS driver properties ___
 	QString				m_sOSSDevice;		///< Device used for output
@@ -281,6 +547,18 @@ public:
 	bool				m_bMidiFixedMapping;
 	bool				m_bMidiDiscardNoteAfterAction;
 	bool				m_bEnableMidiFeedback;
+	/**
+	 * Time in milliseconds within which only the most recent value
+	 * of a control change message of a particular channel and
+	 * controller is dispatched. Used to cope with motorized faders
+	 * or expression pedals flooding Hydrogen with messages. 0
+	 * dispatches each message immediately.
+	 *
+	 * Note that actions reacting to relative changes, like
+	 * BPM_CC_RELATIVE, do miss the steps between the coalesced
+	 * values.
+	 */
+	int					m_nMidiCCCoalescingWindow;
 	
 	// OSC Server properties
 	/**
@@ -328,6 +606,38 @@ public:
 
 	//	alsa audio driver properties ___
 	QString				m_sAlsaAudioDevice;
+	/** Whether the AlsaAudioDriver writes directly into the ring
+		buffer of the device if it supports mmap access.*/
+	bool				m_bAlsaMmap;
+
+	//	pulseaudio driver properties ___
+	/** Target length of the playback buffer of the PulseAudioDriver
+		in frames. 0 requests one buffer of #m_nBufferSize.*/
+	int					m_nPulseAudioTargetLength;
+	/** Minimum amount of frames the server requests from the
+		PulseAudioDriver at once. 0 leaves the choice to the
+		server.*/
+	int					m_nPulseAudioMinRequest;
+
+	//	portaudio driver properties ___
+	/** Output device of the PortAudioDriver as "<host API>/<device>",
+		like "Windows WASAPI/Speakers". An empty device selects the
+		default one of the host API and an empty string the default
+		one of PortAudio.*/
+	QString				m_sPortAudioDevice;
+	/** Output latency in frames suggested to PortAudio. 0 uses the
+		default low latency of the device.*/
+	int					m_nPortAudioLatency;
+	/** Whether to open WASAPI devices in exclusive mode, bypassing
+		the mixer of Windows.*/
+	bool				m_bPortAudioExclusive;
+
+	//	coreaudio driver properties ___
+	/** Fraction of each IO cycle in (0, 1] the HAL may use for the
+		render callback of the CoreAudioDriver. Smaller values allow
+		the device to pull the output later, which trades CPU headroom
+		for latency.*/
+	float				m_fCoreAudioIOCycleUsage;
 
 	//	jack driver properties ___
 	QString				m_sJackPortName1;
@@ -348,6 +658,10 @@ public:
 	 * output will be created.
 	 */
 	bool				m_bJackTrackOuts;
+	/** If set to _true_, the JackAudioDriver creates an additional
+		pair of cue output ports the previews of the Sampler are
+		played back on instead of the main output.*/
+	bool				m_bJackCueOutput;
 
 	/** Specifies which audio settings will be applied to the sample
 		supplied in the JACK per track output ports.*/
@@ -362,6 +676,14 @@ public:
 	/** Specifies which audio settings will be applied to the sample
 		supplied in the JACK per track output ports.*/
 	JackTrackOutputMode		m_JackTrackOutputMode;
+	/**
+	 * If set and the JackAudioDriver is in use, songs are exported
+	 * by switching the JACK server into freewheel mode instead of
+	 * replacing the driver by the DiskWriterDriver. The audio will
+	 * be rendered as fast as possible using the sample rate of the
+	 * JACK server.
+	 */
+	bool				m_bJackFreewheelExport;
 	//jack time master
 
 	/**
@@ -439,6 +761,14 @@ public:
 	/// Save the preferences file
 	void			savePreferences();
 
+	/**
+	 * Hands the members read within the process cycle to the audio
+	 * engine, see RealtimeConfig. Has to be called after changing
+	 * any of them directly. Their setters and loadPreferences() do
+	 * so already.
+	 */
+	void			publishRealtimeConfig();
+
 	const QString&	getDataDirectory();
 
 	const QString&	getDefaultEditor();
@@ -1238,6 +1568,7 @@ inline bool Preferences::patternModePlaysSelected() {
 }
 inline void Preferences::setPatternModePlaysSelected( bool b ) {
 	m_bPatternModePlaysSelected = b;
+	publishRealtimeConfig();
 }
 
 inline bool Preferences::useLash(){
@@ -1336,6 +1667,7 @@ inline bool Preferences::getUseTimelineBpm(){
 }
 inline void Preferences::setUseTimelineBpm( bool val ){
 	__useTimelineBpm = val;
+	publishRealtimeConfig();
 }
 
 inline void Preferences::setShowPlaybackTrack( bool val ) {
@@ -1357,6 +1689,7 @@ inline int Preferences::getRubberBandBatchMode(){
 }
 inline void Preferences::setRubberBandBatchMode( int val ){
 	m_useTheRubberbandBpmChangeEvent = val;
+	publishRealtimeConfig();
 }
 
 inline int Preferences::getLastOpenTab(){
@@ -0,0 +1,292 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/ProcessProfiler.h>
+#include <core/Tracer.h>
+#include <core/rt_clock.h>
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* ProcessProfiler::__class_name = "ProcessProfiler";
+
+static_assert( ( PROFILER_CYCLES & ( PROFILER_CYCLES - 1 ) ) == 0,
+			   "PROFILER_CYCLES has to be a power of two" );
+
+/** Number of histogram bins per octave.*/
+static const int nBinsPerOctave = 8;
+/** Upper bound of the first histogram bin in nanoseconds.*/
+static const double fFirstBinBound = 1000.0;
+
+/** Names of the stages in the timeline of the Tracer.*/
+static const char* stageTraceNames[ ProcessProfiler::STAGE_COUNT ] = {
+	"Prepare", "Note queue", "Sampler", "Synth", "LADSPA", "Metering",
+	"audioEngine_process" };
+
+ProcessProfiler::ProcessProfiler()
+	: Object( __class_name )
+	, m_nCycleStart( 0 )
+	, m_nStageStart( 0 )
+	, m_nWriteIndex( 0 )
+	, m_nReadIndex( 0 )
+	, m_nDroppedCycles( 0 )
+	, m_nQuietVoices( 0 )
+	, m_nXRuns( 0 )
+	, m_nMissedLocks( 0 )
+	, m_nSamplerVoices( 0 )
+	, m_nSynthVoices( 0 )
+	, m_fExportRealtimeFactor( 0 )
+	, m_nCycles( 0 )
+{
+	memset( &m_current, 0, sizeof( m_current ) );
+	memset( m_histograms, 0, sizeof( m_histograms ) );
+	memset( m_nMax, 0, sizeof( m_nMax ) );
+}
+
+ProcessProfiler::~ProcessProfiler()
+{
+}
+
+QString ProcessProfiler::getStageName( Stage stage )
+{
+	switch ( stage ) {
+	case STAGE_PREPARE:
+		return "Prepare";
+	case STAGE_NOTE_QUEUE:
+		return "Note queue";
+	case STAGE_SAMPLER:
+		return "Sampler";
+	case STAGE_SYNTH:
+		return "Synth";
+	case STAGE_LADSPA:
+		return "LADSPA";
+	case STAGE_METERING:
+		return "Metering";
+	case STAGE_TOTAL:
+		return "Total";
+	default:
+		return "Unknown";
+	}
+}
+
+void ProcessProfiler::beginCycle()
+{
+	memset( &m_current, 0, sizeof( m_current ) );
+	m_nCycleStart = rtclock_now_ns();
+	m_nStageStart = m_nCycleStart;
+}
+
+void ProcessProfiler::endStage( Stage stage )
+{
+	int64_t nNow = rtclock_now_ns();
+	m_current.durations[ stage ] += nNow - m_nStageStart;
+	Tracer::complete( stageTraceNames[ stage ], m_nStageStart, nNow - m_nStageStart );
+	m_nStageStart = nNow;
+}
+
+float ProcessProfiler::endCycle()
+{
+	m_current.durations[ STAGE_TOTAL ] = rtclock_now_ns() - m_nCycleStart;
+	Tracer::complete( stageTraceNames[ STAGE_TOTAL ], m_nCycleStart,
+					  m_current.durations[ STAGE_TOTAL ] );
+
+	size_t nWrite = m_nWriteIndex.load( std::memory_order_relaxed );
+	if ( nWrite - m_nReadIndex.load( std::memory_order_acquire ) < PROFILER_CYCLES ) {
+		m_cycles[ nWrite & ( PROFILER_CYCLES - 1 ) ] = m_current;
+		m_nWriteIndex.store( nWrite + 1, std::memory_order_release );
+	} else {
+		m_nDroppedCycles.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	return m_current.durations[ STAGE_TOTAL ] / 1000000.0;
+}
+
+float ProcessProfiler::getLastDuration( Stage stage ) const
+{
+	return m_current.durations[ stage ] / 1000000.0;
+}
+
+int ProcessProfiler::getBin( int64_t nNanoseconds )
+{
+	if ( nNanoseconds < fFirstBinBound ) {
+		return 0;
+	}
+	int nBin = 1 + static_cast<int>( std::log2( nNanoseconds / fFirstBinBound ) *
+									 nBinsPerOctave );
+	if ( nBin >= PROFILER_BINS ) {
+		return PROFILER_BINS - 1;
+	}
+	return nBin;
+}
+
+double ProcessProfiler::getBinUpperBound( int nBin )
+{
+	return fFirstBinBound * std::exp2( static_cast<double>( nBin ) / nBinsPerOctave );
+}
+
+void ProcessProfiler::drain()
+{
+	size_t nRead = m_nReadIndex.load( std::memory_order_relaxed );
+	const size_t nWrite = m_nWriteIndex.load( std::memory_order_acquire );
+
+	for ( ; nRead != nWrite; ++nRead ) {
+		const Cycle& cycle = m_cycles[ nRead & ( PROFILER_CYCLES - 1 ) ];
+		for ( int ii = 0; ii < STAGE_COUNT; ++ii ) {
+			++m_histograms[ ii ][ getBin( cycle.durations[ ii ] ) ];
+			if ( cycle.durations[ ii ] > m_nMax[ ii ] ) {
+				m_nMax[ ii ] = cycle.durations[ ii ];
+			}
+		}
+		++m_nCycles;
+	}
+
+	m_nReadIndex.store( nRead, std::memory_order_release );
+}
+
+void ProcessProfiler::collect()
+{
+	QMutexLocker mx( &m_mutex );
+	drain();
+}
+
+ProcessProfiler::Statistics ProcessProfiler::getStatistics( Stage stage )
+{
+	QMutexLocker mx( &m_mutex );
+	drain();
+
+	Statistics statistics = { 0.0, 0.0, 0.0 };
+	if ( m_nCycles == 0 || stage < 0 || stage >= STAGE_COUNT ) {
+		return statistics;
+	}
+
+	const double fMax = static_cast<double>( m_nMax[ stage ] );
+	const long long nMedian = ( m_nCycles + 1 ) / 2;
+	const long long nPercentile99 = static_cast<long long>( std::ceil( m_nCycles * 0.99 ) );
+
+	double fMedian = fMax;
+	double fPercentile99 = fMax;
+	long long nCount = 0;
+	for ( int nBin = 0; nBin < PROFILER_BINS; ++nBin ) {
+		long long nPrevious = nCount;
+		nCount += m_histograms[ stage ][ nBin ];
+		if ( nPrevious < nMedian && nCount >= nMedian ) {
+			fMedian = std::min( getBinUpperBound( nBin ), fMax );
+		}
+		if ( nPrevious < nPercentile99 && nCount >= nPercentile99 ) {
+			fPercentile99 = std::min( getBinUpperBound( nBin ), fMax );
+			break;
+		}
+	}
+
+	statistics.fMedian = fMedian / 1000000.0;
+	statistics.fPercentile99 = fPercentile99 / 1000000.0;
+	statistics.fMax = fMax / 1000000.0;
+	return statistics;
+}
+
+long long ProcessProfiler::getCycles()
+{
+	QMutexLocker mx( &m_mutex );
+	drain();
+	return m_nCycles;
+}
+
+int ProcessProfiler::getDroppedCycles() const
+{
+	return m_nDroppedCycles.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::countQuietVoice()
+{
+	m_nQuietVoices.fetch_add( 1, std::memory_order_relaxed );
+}
+
+long long ProcessProfiler::getQuietVoices() const
+{
+	return m_nQuietVoices.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::countXRun()
+{
+	m_nXRuns.fetch_add( 1, std::memory_order_relaxed );
+}
+
+long long ProcessProfiler::getXRuns() const
+{
+	return m_nXRuns.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::countMissedLock()
+{
+	m_nMissedLocks.fetch_add( 1, std::memory_order_relaxed );
+}
+
+long long ProcessProfiler::getMissedLocks() const
+{
+	return m_nMissedLocks.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::publishVoices( int nSamplerVoices, int nSynthVoices )
+{
+	m_nSamplerVoices.store( nSamplerVoices, std::memory_order_relaxed );
+	m_nSynthVoices.store( nSynthVoices, std::memory_order_relaxed );
+}
+
+int ProcessProfiler::getSamplerVoices() const
+{
+	return m_nSamplerVoices.load( std::memory_order_relaxed );
+}
+
+int ProcessProfiler::getSynthVoices() const
+{
+	return m_nSynthVoices.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::setExportRealtimeFactor( float fFactor )
+{
+	m_fExportRealtimeFactor.store( fFactor, std::memory_order_relaxed );
+}
+
+float ProcessProfiler::getExportRealtimeFactor() const
+{
+	return m_fExportRealtimeFactor.load( std::memory_order_relaxed );
+}
+
+void ProcessProfiler::reset()
+{
+	QMutexLocker mx( &m_mutex );
+	drain();
+	memset( m_histograms, 0, sizeof( m_histograms ) );
+	memset( m_nMax, 0, sizeof( m_nMax ) );
+	m_nCycles = 0;
+	m_nDroppedCycles.store( 0, std::memory_order_relaxed );
+	m_nQuietVoices.store( 0, std::memory_order_relaxed );
+}
+
+};
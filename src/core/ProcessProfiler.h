@@ -0,0 +1,198 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef PROCESS_PROFILER_H
+#define PROCESS_PROFILER_H
+
+#include <core/Object.h>
+
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+/** Number of process cycles which can be pending in the
+	H2Core::ProcessProfiler before they get dropped. Has to be a power
+	of two.*/
+#define PROFILER_CYCLES 1024
+/** Number of bins of the duration histograms of the
+	H2Core::ProcessProfiler.*/
+#define PROFILER_BINS 112
+
+namespace H2Core
+{
+
+/**
+ * Always-on measurement of the time spent in the individual stages
+ * of audioEngine_process().
+ *
+ * The realtime thread marks the end of each stage using endStage()
+ * and hands the durations of a completed cycle to a single-producer
+ * single-consumer ring buffer in endCycle(). Both calls neither lock
+ * nor allocate and only query the monotonic clock of rt_clock.h.
+ *
+ * Consumers (AudioEngineInfoForm, the OscServer) call
+ * getStatistics(), which moves all pending cycles into logarithmic
+ * histograms - just as collect() does - and derives the percentiles
+ * from them. A bin spans an
+ * eighth of an octave, so the reported percentiles are accurate to
+ * about 9%. The maximum is tracked exactly.
+ */
+class ProcessProfiler : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	enum Stage {
+		/** Locking the engine, applying commands, and handling
+			transport and tempo changes.*/
+		STAGE_PREPARE = 0,
+		/** audioEngine_updateNoteQueue()*/
+		STAGE_NOTE_QUEUE,
+		/** Playing notes, rendering the Sampler, and mixing its
+			output.*/
+		STAGE_SAMPLER,
+		STAGE_SYNTH,
+		STAGE_LADSPA,
+		/** Master, FX, and component peaks and
+			PeakMeters::publish().*/
+		STAGE_METERING,
+		/** Whole cycle from beginCycle() to endCycle().*/
+		STAGE_TOTAL,
+		STAGE_COUNT
+	};
+
+	/** Durations in milliseconds.*/
+	struct Statistics {
+		float fMedian;
+		float fPercentile99;
+		float fMax;
+	};
+
+	ProcessProfiler();
+	~ProcessProfiler();
+
+	/** \return Human readable name of @a stage.*/
+	static QString getStageName( Stage stage );
+
+	/** Starts a new cycle. A cycle begun but never ended, e.g. due
+		to an early return, is discarded. Realtime thread only.*/
+	void beginCycle();
+	/** Attributes the time passed since the end of the previous
+		stage to @a stage. Realtime thread only.*/
+	void endStage( Stage stage );
+	/**
+	 * Completes the cycle and queues it for the consumers. Realtime
+	 * thread only.
+	 *
+	 * \return Duration of the whole cycle in milliseconds.
+	 */
+	float endCycle();
+	/** \return Duration of @a stage in the last cycle in
+		milliseconds. Realtime thread only.*/
+	float getLastDuration( Stage stage ) const;
+
+	/** Moves all pending cycles into the histograms. Should be
+		called periodically to prevent cycles from being dropped
+		while no one asks for the statistics.*/
+	void collect();
+	/** \return Percentiles of @a stage since the last reset().*/
+	Statistics getStatistics( Stage stage );
+	/** \return Number of cycles accounted for since the last
+		reset().*/
+	long long getCycles();
+	/** \return Number of cycles dropped since the consumers did not
+		keep up.*/
+	int getDroppedCycles() const;
+	/** Counts a voice the Sampler did end early since its release
+		dropped below the audible level. Can be called by the worker
+		threads of the Sampler too.*/
+	void countQuietVoice();
+	/** \return Number of voices passed to countQuietVoice() since
+		the last reset().*/
+	long long getQuietVoices() const;
+	/** Counts a process cycle which took longer than the period of
+		the driver. Realtime thread only.*/
+	void countXRun();
+	/** \return Number of cycles passed to countXRun(). Unlike the
+		other statistics it is not affected by reset(), so monitoring
+		tools see a monotonic counter.*/
+	long long getXRuns() const;
+	/** Counts a process cycle skipped since the AudioEngine could
+		not be locked in time. Realtime thread only.*/
+	void countMissedLock();
+	/** \return Number of cycles passed to countMissedLock(). Not
+		affected by reset().*/
+	long long getMissedLocks() const;
+	/** Publishes the number of voices rendered in the current cycle
+		by the Sampler and the Synth. Realtime thread only.*/
+	void publishVoices( int nSamplerVoices, int nSynthVoices );
+	int getSamplerVoices() const;
+	int getSynthVoices() const;
+	/** Publishes the ratio of the duration of the audio rendered by
+		the current export to the wall clock time it took. Called by
+		the DiskWriterDriver after each column. 0 while no export did
+		run yet.*/
+	void setExportRealtimeFactor( float fFactor );
+	float getExportRealtimeFactor() const;
+	/** Discards all statistics gathered so far.*/
+	void reset();
+
+private:
+	struct Cycle {
+		int64_t durations[ STAGE_COUNT ];
+	};
+
+	/** Moves all pending cycles into the histograms. Has to be
+		called with #m_mutex locked.*/
+	void drain();
+	static int getBin( int64_t nNanoseconds );
+	/** \return Upper bound of @a nBin in nanoseconds.*/
+	static double getBinUpperBound( int nBin );
+
+	/** Cycle in progress. Realtime thread only.*/
+	Cycle m_current;
+	int64_t m_nCycleStart;
+	int64_t m_nStageStart;
+
+	Cycle m_cycles[ PROFILER_CYCLES ];
+	alignas(64) std::atomic<size_t> m_nWriteIndex;
+	alignas(64) std::atomic<size_t> m_nReadIndex;
+	std::atomic<int> m_nDroppedCycles;
+	std::atomic<long long> m_nQuietVoices;
+	std::atomic<long long> m_nXRuns;
+	std::atomic<long long> m_nMissedLocks;
+	std::atomic<int> m_nSamplerVoices;
+	std::atomic<int> m_nSynthVoices;
+	std::atomic<float> m_fExportRealtimeFactor;
+
+	/** Protects the histograms against concurrent consumers.*/
+	QMutex m_mutex;
+	uint32_t m_histograms[ STAGE_COUNT ][ PROFILER_BINS ];
+	int64_t m_nMax[ STAGE_COUNT ];
+	long long m_nCycles;
+};
+
+};
+
+#endif
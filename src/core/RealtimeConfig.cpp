@@ -0,0 +1,114 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/RealtimeConfig.h>
+
+#include <thread>
+
+namespace H2Core
+{
+
+const char* RealtimeConfig::__class_name = "RealtimeConfig";
+
+RealtimeConfig::Version RealtimeConfig::m_versions[ REALTIME_CONFIG_VERSIONS ];
+std::atomic<RealtimeConfig::Version*> RealtimeConfig::m_pCurrent( nullptr );
+std::mutex RealtimeConfig::m_publishMutex;
+RealtimeConfig::Values RealtimeConfig::m_cycle;
+
+void RealtimeConfig::publish( Preferences* pPref )
+{
+	if ( pPref == nullptr ) {
+		return;
+	}
+
+	Values values;
+	values.nMaxNotes = pPref->m_nMaxNotes;
+	values.voiceStealing = pPref->m_VoiceStealing;
+	values.bJackTrackOuts = pPref->m_bJackTrackOuts;
+	values.jackTrackOutputMode = pPref->m_JackTrackOutputMode;
+	values.nJackTransportMode = pPref->m_bJackTransportMode;
+	values.nJackMasterMode = pPref->m_bJackMasterMode;
+	values.bJackTimebaseEnabled = pPref->m_bJackTimebaseEnabled;
+	values.bPlaySelectedInstrument = pPref->__playselectedinstrument;
+	values.bPatternModePlaysSelected = pPref->patternModePlaysSelected();
+	values.bUseMetronome = pPref->m_bUseMetronome;
+	values.fMetronomeVolume = pPref->m_fMetronomeVolume;
+	values.bParallelLadspaFX = pPref->m_bParallelLadspaFX;
+	values.bOverloadGovernor = pPref->m_bOverloadGovernor;
+	values.bUseTimelineBpm = pPref->getUseTimelineBpm();
+	values.bRubberBandBatchMode = pPref->getRubberBandBatchMode();
+	values.fLinkQuantum = pPref->m_fLinkQuantum;
+
+	std::lock_guard<std::mutex> lock( m_publishMutex );
+	Version* pCurrent = m_pCurrent.load();
+
+	// Unlike the PlaybackSnapshot, a change must not be dropped.
+	// Readers copy a few bytes only, so waiting for one of them
+	// to release a spare version does not take long.
+	Version* pSpare = nullptr;
+	while ( pSpare == nullptr ) {
+		for ( auto& version : m_versions ) {
+			if ( &version != pCurrent && version.nReaders.load() == 0 ) {
+				pSpare = &version;
+				break;
+			}
+		}
+		if ( pSpare == nullptr ) {
+			std::this_thread::yield();
+		}
+	}
+
+	pSpare->values = values;
+	m_pCurrent.store( pSpare );
+}
+
+RealtimeConfig::Values RealtimeConfig::current()
+{
+	// Registering as reader and checking the version is still the
+	// current one afterwards ensures publish() will not pick it as
+	// spare while we are copying.
+	Version* pVersion;
+	while ( true ) {
+		pVersion = m_pCurrent.load();
+		if ( pVersion == nullptr ) {
+			return Values();
+		}
+		pVersion->nReaders.fetch_add( 1 );
+		if ( m_pCurrent.load() == pVersion ) {
+			break;
+		}
+		pVersion->nReaders.fetch_sub( 1 );
+	}
+
+	Values values = pVersion->values;
+	pVersion->nReaders.fetch_sub( 1 );
+
+	return values;
+}
+
+void RealtimeConfig::beginCycle()
+{
+	m_cycle = current();
+}
+
+};
@@ -0,0 +1,127 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef REALTIME_CONFIG_H
+#define REALTIME_CONFIG_H
+
+#include <core/Object.h>
+#include <core/Preferences.h>
+
+#include <atomic>
+#include <mutex>
+
+/** Number of versions the H2Core::RealtimeConfig does cycle
+	through.*/
+#define REALTIME_CONFIG_VERSIONS 4
+
+namespace H2Core
+{
+
+/**
+ * Immutable copy of the Preferences read within the process cycle.
+ *
+ * The audio engine used to look up the Preferences singleton for
+ * every note and buffer, touching a large object edited concurrently
+ * by the GUI. Instead, Preferences::publishRealtimeConfig() copies
+ * the few values needed into a spare version out of a fixed pool of
+ * #REALTIME_CONFIG_VERSIONS, which is then published atomically. At
+ * the beginning of each cycle audioEngine_process() copies the
+ * latest version once using beginCycle() and all code within the
+ * cycle reads it via get().
+ *
+ * A version is never modified while published or while a reader is
+ * still copying it. Neither current() nor beginCycle() do lock or
+ * allocate.
+ */
+class RealtimeConfig : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Mirrored members of Preferences. See their documentation.*/
+	struct Values {
+		unsigned nMaxNotes = 0;
+		Preferences::VoiceStealing voiceStealing = Preferences::VoiceStealing::oldest;
+		bool bJackTrackOuts = false;
+		Preferences::JackTrackOutputMode jackTrackOutputMode =
+			Preferences::JackTrackOutputMode::postFader;
+		int nJackTransportMode = Preferences::NO_JACK_TRANSPORT;
+		int nJackMasterMode = Preferences::NO_JACK_TIME_MASTER;
+		bool bJackTimebaseEnabled = false;
+		bool bPlaySelectedInstrument = false;
+		bool bPatternModePlaysSelected = false;
+		bool bUseMetronome = false;
+		float fMetronomeVolume = 0;
+		bool bParallelLadspaFX = false;
+		bool bOverloadGovernor = false;
+		bool bUseTimelineBpm = false;
+		bool bRubberBandBatchMode = false;
+		float fLinkQuantum = 4;
+	};
+
+	/**
+	 * Publishes the current values of @a pPref.
+	 *
+	 * Called by Preferences::publishRealtimeConfig(). May block
+	 * briefly and must therefore not be called by the audio
+	 * engine.
+	 */
+	static void publish( Preferences* pPref );
+
+	/** \return Copy of the latest version. Can be called from
+		arbitrary threads. Default values are returned if nothing
+		was published yet.*/
+	static Values current();
+
+	/** Copies the latest version for the process cycle about to
+		start. Called by audioEngine_process() while holding the
+		AudioEngine lock.*/
+	static void beginCycle();
+	/** \return Values of the current process cycle. Must only be
+		used by the audio engine, the workers of the Sampler, or
+		while holding the AudioEngine lock.*/
+	static const Values& get();
+
+private:
+	struct Version {
+		Values values;
+		/** Number of threads currently copying this version.*/
+		std::atomic<int> nReaders;
+	};
+
+	static Version m_versions[ REALTIME_CONFIG_VERSIONS ];
+	/** Version handed out by current() or nullptr.*/
+	static std::atomic<Version*> m_pCurrent;
+	/** Serializes publish().*/
+	static std::mutex m_publishMutex;
+	/** see get()*/
+	static Values m_cycle;
+};
+
+inline const RealtimeConfig::Values& RealtimeConfig::get()
+{
+	return m_cycle;
+}
+
+};
+
+#endif
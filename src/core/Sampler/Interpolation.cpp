@@ -0,0 +1,74 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Sampler/Interpolation.h>
+
+namespace H2Core
+{
+
+namespace Interpolation
+{
+
+const SincTable sinc_table;
+
+/** Cutoff of the sinc kernel relative to the Nyquist frequency. It
+	leaves room for the transition band of the window.*/
+static const double fSincCutoff = 0.9;
+
+SincTable::SincTable()
+{
+	const int nHalfWidth = SINC_INTERPOLATION_TAPS / 2;
+
+	for ( int nPhase = 0; nPhase <= SINC_INTERPOLATION_PHASES; ++nPhase ) {
+		const double fFraction = static_cast<double>( nPhase ) / SINC_INTERPOLATION_PHASES;
+		double fSum = 0.0;
+
+		for ( int nTap = 0; nTap < SINC_INTERPOLATION_TAPS; ++nTap ) {
+			// Distance between the frame the tap is applied to and
+			// the interpolated position.
+			const double fDistance = nTap - ( nHalfWidth - 1 ) - fFraction;
+			double fValue = 0.0;
+
+			if ( std::fabs( fDistance ) < nHalfWidth ) {
+				const double fX = M_PI * fSincCutoff * fDistance;
+				const double fSinc = fX == 0.0 ? 1.0 : std::sin( fX ) / fX;
+				const double fWindow = 0.42 +
+					0.5 * std::cos( M_PI * fDistance / nHalfWidth ) +
+					0.08 * std::cos( 2 * M_PI * fDistance / nHalfWidth );
+				fValue = fSinc * fWindow;
+			}
+
+			coefficients[ nPhase ][ nTap ] = fValue;
+			fSum += fValue;
+		}
+
+		// Unity gain for constant signals.
+		for ( int nTap = 0; nTap < SINC_INTERPOLATION_TAPS; ++nTap ) {
+			coefficients[ nPhase ][ nTap ] /= fSum;
+		}
+	}
+}
+
+};
+
+};
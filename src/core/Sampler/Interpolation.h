@@ -25,6 +25,24 @@
 
 #include <cmath>
 
+#include <core/Helpers/Dsp.h>
+
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define H2CORE_INTERPOLATION_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define H2CORE_INTERPOLATION_NEON
+#endif
+
+/** Number of frames the windowed sinc kernel of
+	H2Core::Interpolation::InterpolateMode::Sinc does span. Has to be
+	a multiple of four.*/
+#define SINC_INTERPOLATION_TAPS 16
+/** Number of fractional positions the sinc kernel is tabulated
+	for. Positions in between are interpolated linearly.*/
+#define SINC_INTERPOLATION_PHASES 256
+
 namespace H2Core
 {
 
@@ -34,7 +52,8 @@ namespace Interpolation
 								Cosine,
 								Third,
 								Cubic,
-								Hermite };
+								Hermite,
+								Sinc };
 
 	inline static float linear_Interpolate( float y1, float y2, float mu )
 	{
@@ -118,6 +137,463 @@ namespace Interpolation
 			return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
 	};
 
+	/**
+	 * Four single precision values processed at once using SSE, NEON,
+	 * or - if neither is available - a plain array the compiler is
+	 * free to vectorize on its own.
+	 */
+	struct Vec4 {
+#if defined(H2CORE_INTERPOLATION_SSE)
+		__m128 v;
+		inline static Vec4 load( const float* p ) { return { _mm_loadu_ps( p ) }; }
+		inline static Vec4 set( float f ) { return { _mm_set1_ps( f ) }; }
+		inline void store( float* p ) const { _mm_storeu_ps( p, v ); }
+		inline Vec4 operator+( const Vec4& o ) const { return { _mm_add_ps( v, o.v ) }; }
+		inline Vec4 operator-( const Vec4& o ) const { return { _mm_sub_ps( v, o.v ) }; }
+		inline Vec4 operator*( const Vec4& o ) const { return { _mm_mul_ps( v, o.v ) }; }
+		inline float sum() const {
+			__m128 s = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+			return _mm_cvtss_f32( _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) ) );
+		}
+#elif defined(H2CORE_INTERPOLATION_NEON)
+		float32x4_t v;
+		inline static Vec4 load( const float* p ) { return { vld1q_f32( p ) }; }
+		inline static Vec4 set( float f ) { return { vdupq_n_f32( f ) }; }
+		inline void store( float* p ) const { vst1q_f32( p, v ); }
+		inline Vec4 operator+( const Vec4& o ) const { return { vaddq_f32( v, o.v ) }; }
+		inline Vec4 operator-( const Vec4& o ) const { return { vsubq_f32( v, o.v ) }; }
+		inline Vec4 operator*( const Vec4& o ) const { return { vmulq_f32( v, o.v ) }; }
+		inline float sum() const {
+			float32x2_t s = vadd_f32( vget_low_f32( v ), vget_high_f32( v ) );
+			return vget_lane_f32( vpadd_f32( s, s ), 0 );
+		}
+#else
+		float v[ 4 ];
+		inline static Vec4 load( const float* p ) {
+			return { { p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] } };
+		}
+		inline static Vec4 set( float f ) { return { { f, f, f, f } }; }
+		inline void store( float* p ) const {
+			for ( int ii = 0; ii < 4; ++ii ) { p[ ii ] = v[ ii ]; }
+		}
+		inline Vec4 operator+( const Vec4& o ) const {
+			return { { v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3] } };
+		}
+		inline Vec4 operator-( const Vec4& o ) const {
+			return { { v[0] - o.v[0], v[1] - o.v[1], v[2] - o.v[2], v[3] - o.v[3] } };
+		}
+		inline Vec4 operator*( const Vec4& o ) const {
+			return { { v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3] } };
+		}
+		inline float sum() const { return v[0] + v[1] + v[2] + v[3]; }
+#endif
+	};
+
+	/**
+	 * Precomputed kernel of InterpolateMode::Sinc.
+	 *
+	 * Row @a p holds the Blackman windowed sinc coefficients for a
+	 * fractional position of p / #SINC_INTERPOLATION_PHASES. They are
+	 * applied to the frames nPos - #SINC_INTERPOLATION_TAPS / 2 + 1
+	 * up to nPos + #SINC_INTERPOLATION_TAPS / 2. The additional last
+	 * row allows to interpolate between adjacent phases without
+	 * wrapping around. Each row occupies a single cache line.
+	 *
+	 * The table is filled once during static initialization.
+	 */
+	struct SincTable {
+		SincTable();
+		alignas(64) float coefficients[ SINC_INTERPOLATION_PHASES + 1 ][ SINC_INTERPOLATION_TAPS ];
+	};
+	extern const SincTable sinc_table;
+
+	/** Scratch space of a kernel for a single fractional position.*/
+	typedef Vec4 SincKernel[ SINC_INTERPOLATION_TAPS / 4 ];
+
+	/** Interpolates the kernel for the fractional position @a mu in
+		[0,1) between the two closest rows of #sinc_table.*/
+	inline static void sinc_kernel( double mu, SincKernel& kernel )
+	{
+		double fPhase = mu * SINC_INTERPOLATION_PHASES;
+		int nPhase = ( int )fPhase;
+		if ( nPhase >= SINC_INTERPOLATION_PHASES ) {
+			nPhase = SINC_INTERPOLATION_PHASES - 1;
+		}
+		const Vec4 vMu = Vec4::set( fPhase - nPhase );
+		const float* pRow0 = sinc_table.coefficients[ nPhase ];
+		const float* pRow1 = sinc_table.coefficients[ nPhase + 1 ];
+		for ( int ii = 0; ii < SINC_INTERPOLATION_TAPS / 4; ++ii ) {
+			const Vec4 c0 = Vec4::load( &pRow0[ 4 * ii ] );
+			kernel[ ii ] = c0 + ( Vec4::load( &pRow1[ 4 * ii ] ) - c0 ) * vMu;
+		}
+	}
+
+	/** Dot product of @a kernel and the frames around @a nPos.
+		Frames outside of [0, @a nSampleFrames) count as silence.*/
+	inline static float sinc_apply( const float* pIn, int nSampleFrames, int nPos,
+									const SincKernel& kernel )
+	{
+		const int nFirst = nPos - SINC_INTERPOLATION_TAPS / 2 + 1;
+		const float* pFrames = &pIn[ nFirst ];
+
+		float padded[ SINC_INTERPOLATION_TAPS ];
+		if ( nFirst < 0 || nFirst + SINC_INTERPOLATION_TAPS > nSampleFrames ) {
+			for ( int ii = 0; ii < SINC_INTERPOLATION_TAPS; ++ii ) {
+				int nFrame = nFirst + ii;
+				padded[ ii ] = ( nFrame >= 0 && nFrame < nSampleFrames ) ?
+					pIn[ nFrame ] : 0.0f;
+			}
+			pFrames = padded;
+		}
+
+		Vec4 sum = Vec4::set( 0.0f );
+		for ( int ii = 0; ii < SINC_INTERPOLATION_TAPS / 4; ++ii ) {
+			sum = sum + Vec4::load( &pFrames[ 4 * ii ] ) * kernel[ ii ];
+		}
+		return sum.sum();
+	}
+
+	inline static float sinc_Interpolate( const float* pIn, int nSampleFrames,
+										  int nPos, double mu )
+	{
+			/*
+			 * mu defines where to estimate the value between
+			 * pIn[ nPos ] and pIn[ nPos + 1 ]
+			 */
+			SincKernel kernel;
+			sinc_kernel( mu, kernel );
+			return sinc_apply( pIn, nSampleFrames, nPos, kernel );
+	};
+
+	/** \return Number of frames in front of the integer position
+		accessed by @a mode.*/
+	inline static int frames_before( InterpolateMode mode )
+	{
+		return mode == InterpolateMode::Sinc ? SINC_INTERPOLATION_TAPS / 2 - 1 : 1;
+	}
+
+	/** \return Number of frames after the integer position accessed
+		by @a mode.*/
+	inline static int frames_after( InterpolateMode mode )
+	{
+		return mode == InterpolateMode::Sinc ? SINC_INTERPOLATION_TAPS / 2 : 2;
+	}
+
+	/**
+	 * Interpolates four frames at once.
+	 *
+	 * The formulas match the scalar versions above. For
+	 * InterpolateMode::Cosine @a mu is expected to be already mapped
+	 * onto the cosine, see resample_stereo().
+	 */
+	template <InterpolateMode mode>
+	inline static Vec4 interpolate4( const Vec4& y0, const Vec4& y1, const Vec4& y2,
+									 const Vec4& y3, const Vec4& mu )
+	{
+		switch ( mode ) {
+		case InterpolateMode::Linear:
+		case InterpolateMode::Cosine:
+			return y1 + ( y2 - y1 ) * mu;
+		case InterpolateMode::Third: {
+			const Vec4 c0 = y1;
+			const Vec4 c1 = Vec4::set( 0.5f ) * ( y2 - y0 );
+			const Vec4 c3 = Vec4::set( 1.5f ) * ( y1 - y2 ) + Vec4::set( 0.5f ) * ( y3 - y0 );
+			const Vec4 c2 = y0 - y1 + c1 - c3;
+			return ( ( c3 * mu + c2 ) * mu + c1 ) * mu + c0;
+		}
+		case InterpolateMode::Cubic: {
+			const Vec4 a0 = y3 - y2 - y0 + y1;
+			const Vec4 a1 = y0 - y1 - a0;
+			const Vec4 a2 = y2 - y0;
+			return ( ( a0 * mu + a1 ) * mu + a2 ) * mu + y1;
+		}
+		case InterpolateMode::Hermite: {
+			const Vec4 half = Vec4::set( 0.5f );
+			const Vec4 a0 = Vec4::set( 1.5f ) * ( y1 - y2 ) + half * ( y3 - y0 );
+			const Vec4 a1 = y0 - Vec4::set( 2.5f ) * y1 + Vec4::set( 2.0f ) * y2 - half * y3;
+			const Vec4 a2 = half * ( y2 - y0 );
+			return ( ( a0 * mu + a1 ) * mu + a2 ) * mu + y1;
+		}
+		}
+		return y1;
+	}
+
+	/** Scalar interpolation of a single frame at @a fPos including
+		the handling of the first and last frames of the sample.*/
+	template <InterpolateMode mode>
+	inline static void interpolate_frame( const float* pIn_L, const float* pIn_R,
+										  int nSampleFrames, double fPos,
+										  float* pOut_L, float* pOut_R )
+	{
+		int nPos = ( int )fPos;
+		double fDiff = fPos - nPos;
+
+		if ( ( nPos + 1 ) >= nSampleFrames ) {
+			//we reach the last audioframe.
+			//set this last frame to zero do nothing wrong.
+			*pOut_L = 0.0;
+			*pOut_R = 0.0;
+			return;
+		}
+
+		// some interpolation methods need 4 frames data.
+		float first_l = 0.0, first_r = 0.0, last_l = 0.0, last_r = 0.0;
+		if ( nPos >= 1 ) {
+			first_l = pIn_L[ nPos - 1 ];
+			first_r = pIn_R[ nPos - 1 ];
+		}
+		if ( ( nPos + 2 ) < nSampleFrames ) {
+			last_l = pIn_L[ nPos + 2 ];
+			last_r = pIn_R[ nPos + 2 ];
+		}
+
+		switch ( mode ) {
+		case InterpolateMode::Linear:
+			*pOut_L = pIn_L[ nPos ] * ( 1 - fDiff ) + pIn_L[ nPos + 1 ] * fDiff;
+			*pOut_R = pIn_R[ nPos ] * ( 1 - fDiff ) + pIn_R[ nPos + 1 ] * fDiff;
+			break;
+		case InterpolateMode::Cosine:
+			*pOut_L = cosine_Interpolate( pIn_L[ nPos ], pIn_L[ nPos + 1 ], fDiff );
+			*pOut_R = cosine_Interpolate( pIn_R[ nPos ], pIn_R[ nPos + 1 ], fDiff );
+			break;
+		case InterpolateMode::Third:
+			*pOut_L = third_Interpolate( first_l, pIn_L[ nPos ], pIn_L[ nPos + 1 ], last_l, fDiff );
+			*pOut_R = third_Interpolate( first_r, pIn_R[ nPos ], pIn_R[ nPos + 1 ], last_r, fDiff );
+			break;
+		case InterpolateMode::Cubic:
+			*pOut_L = cubic_Interpolate( first_l, pIn_L[ nPos ], pIn_L[ nPos + 1 ], last_l, fDiff );
+			*pOut_R = cubic_Interpolate( first_r, pIn_R[ nPos ], pIn_R[ nPos + 1 ], last_r, fDiff );
+			break;
+		case InterpolateMode::Hermite:
+			*pOut_L = hermite_Interpolate( first_l, pIn_L[ nPos ], pIn_L[ nPos + 1 ], last_l, fDiff );
+			*pOut_R = hermite_Interpolate( first_r, pIn_R[ nPos ], pIn_R[ nPos + 1 ], last_r, fDiff );
+			break;
+		}
+	}
+
+	template <InterpolateMode mode>
+	inline static void resample_stereo_block( const float* pIn_L, const float* pIn_R,
+											  int nSampleFrames, double fSamplePos,
+											  double fStep, float* pOut_L,
+											  float* pOut_R, int nFrames )
+	{
+		int ii = 0;
+		double fPos = fSamplePos;
+
+		// The very first frame lacks a predecessor.
+		while ( ii < nFrames && fPos < 1.0 ) {
+			interpolate_frame<mode>( pIn_L, pIn_R, nSampleFrames, fPos,
+									 &pOut_L[ ii ], &pOut_R[ ii ] );
+			fPos += fStep;
+			++ii;
+		}
+
+		float y0_L[ 4 ], y1_L[ 4 ], y2_L[ 4 ], y3_L[ 4 ];
+		float y0_R[ 4 ], y1_R[ 4 ], y2_R[ 4 ], y3_R[ 4 ];
+		float mu[ 4 ];
+
+		for ( ; ii + 4 <= nFrames; ii += 4 ) {
+			// All four frames, including their successors, have to be
+			// within the sample.
+			if ( ( int )( fPos + 3 * fStep ) + 3 >= nSampleFrames ) {
+				break;
+			}
+
+			for ( int jj = 0; jj < 4; ++jj ) {
+				int nPos = ( int )fPos;
+				double fDiff = fPos - nPos;
+				if ( mode == InterpolateMode::Cosine ) {
+					fDiff = ( 1 - cos( fDiff * 3.14159 ) ) / 2;
+				}
+				mu[ jj ] = fDiff;
+				y0_L[ jj ] = pIn_L[ nPos - 1 ];
+				y1_L[ jj ] = pIn_L[ nPos ];
+				y2_L[ jj ] = pIn_L[ nPos + 1 ];
+				y3_L[ jj ] = pIn_L[ nPos + 2 ];
+				y0_R[ jj ] = pIn_R[ nPos - 1 ];
+				y1_R[ jj ] = pIn_R[ nPos ];
+				y2_R[ jj ] = pIn_R[ nPos + 1 ];
+				y3_R[ jj ] = pIn_R[ nPos + 2 ];
+				fPos += fStep;
+			}
+
+			const Vec4 vMu = Vec4::load( mu );
+			interpolate4<mode>( Vec4::load( y0_L ), Vec4::load( y1_L ),
+								Vec4::load( y2_L ), Vec4::load( y3_L ), vMu )
+				.store( &pOut_L[ ii ] );
+			interpolate4<mode>( Vec4::load( y0_R ), Vec4::load( y1_R ),
+								Vec4::load( y2_R ), Vec4::load( y3_R ), vMu )
+				.store( &pOut_R[ ii ] );
+		}
+
+		// Remaining frames and the end of the sample.
+		for ( ; ii < nFrames; ++ii ) {
+			interpolate_frame<mode>( pIn_L, pIn_R, nSampleFrames, fPos,
+									 &pOut_L[ ii ], &pOut_R[ ii ] );
+			fPos += fStep;
+		}
+	}
+
+	/** Counterpart of resample_stereo_block() for
+		InterpolateMode::Sinc. The kernel for each frame is shared by
+		both channels.*/
+	inline static void resample_stereo_sinc( const float* pIn_L, const float* pIn_R,
+											 int nSampleFrames, double fSamplePos,
+											 double fStep, float* pOut_L,
+											 float* pOut_R, int nFrames )
+	{
+		double fPos = fSamplePos;
+		SincKernel kernel;
+
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			int nPos = ( int )fPos;
+			if ( ( nPos + 1 ) >= nSampleFrames ) {
+				pOut_L[ ii ] = 0.0;
+				pOut_R[ ii ] = 0.0;
+			} else {
+				sinc_kernel( fPos - nPos, kernel );
+				pOut_L[ ii ] = sinc_apply( pIn_L, nSampleFrames, nPos, kernel );
+				pOut_R[ ii ] = sinc_apply( pIn_R, nSampleFrames, nPos, kernel );
+			}
+			fPos += fStep;
+		}
+	}
+
+	/** Scalar reference of sinc_Interpolate() accumulating in
+		double precision.*/
+	inline static float sinc_reference( const float* pIn, int nSampleFrames,
+										int nPos, double mu )
+	{
+		double fPhase = mu * SINC_INTERPOLATION_PHASES;
+		int nPhase = ( int )fPhase;
+		if ( nPhase >= SINC_INTERPOLATION_PHASES ) {
+			nPhase = SINC_INTERPOLATION_PHASES - 1;
+		}
+		const double fMu = fPhase - nPhase;
+		const float* pRow0 = sinc_table.coefficients[ nPhase ];
+		const float* pRow1 = sinc_table.coefficients[ nPhase + 1 ];
+		const int nFirst = nPos - SINC_INTERPOLATION_TAPS / 2 + 1;
+
+		double fSum = 0;
+		for ( int ii = 0; ii < SINC_INTERPOLATION_TAPS; ++ii ) {
+			int nFrame = nFirst + ii;
+			if ( nFrame >= 0 && nFrame < nSampleFrames ) {
+				fSum += pIn[ nFrame ] * ( pRow0[ ii ] + ( pRow1[ ii ] - pRow0[ ii ] ) * fMu );
+			}
+		}
+		return fSum;
+	}
+
+	/** Reference of resample_stereo() interpolating frame by frame
+		with bounds checks for each of them.*/
+	template <InterpolateMode mode>
+	inline static void resample_stereo_reference( const float* pIn_L, const float* pIn_R,
+												  int nSampleFrames, double fSamplePos,
+												  double fStep, float* pOut_L,
+												  float* pOut_R, int nFrames )
+	{
+		double fPos = fSamplePos;
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			if constexpr ( mode == InterpolateMode::Sinc ) {
+				int nPos = ( int )fPos;
+				if ( ( nPos + 1 ) >= nSampleFrames ) {
+					pOut_L[ ii ] = 0.0;
+					pOut_R[ ii ] = 0.0;
+				} else {
+					pOut_L[ ii ] = sinc_reference( pIn_L, nSampleFrames, nPos, fPos - nPos );
+					pOut_R[ ii ] = sinc_reference( pIn_R, nSampleFrames, nPos, fPos - nPos );
+				}
+			} else {
+				interpolate_frame<mode>( pIn_L, pIn_R, nSampleFrames, fPos,
+										 &pOut_L[ ii ], &pOut_R[ ii ] );
+			}
+			fPos += fStep;
+		}
+	}
+
+	/**
+	 * Resamples both channels of a sample.
+	 *
+	 * The interpolation mode is selected once for the whole block and
+	 * the frames are processed four at a time with bounds checks only
+	 * done at the beginning and the end of the sample. If
+	 * Dsp::isUsingReferenceKernels(), resample_stereo_reference() is
+	 * used instead.
+	 *
+	 * \param mode Interpolation to use.
+	 * \param pIn_L Left channel of the sample.
+	 * \param pIn_R Right channel of the sample.
+	 * \param nSampleFrames Number of frames in the sample.
+	 * \param fSamplePos Position of the first frame to interpolate.
+	 * \param fStep Increment of the position per output frame.
+	 * \param pOut_L Left output buffer of at least @a nFrames frames.
+	 * \param pOut_R Right output buffer of at least @a nFrames frames.
+	 * \param nFrames Number of frames to produce.
+	 */
+	inline static void resample_stereo( InterpolateMode mode,
+										const float* pIn_L, const float* pIn_R,
+										int nSampleFrames, double fSamplePos,
+										double fStep, float* pOut_L,
+										float* pOut_R, int nFrames )
+	{
+		if ( Dsp::isUsingReferenceKernels() ) {
+			switch ( mode ) {
+			case InterpolateMode::Linear:
+				resample_stereo_reference<InterpolateMode::Linear>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																	fStep, pOut_L, pOut_R, nFrames );
+				break;
+			case InterpolateMode::Cosine:
+				resample_stereo_reference<InterpolateMode::Cosine>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																	fStep, pOut_L, pOut_R, nFrames );
+				break;
+			case InterpolateMode::Third:
+				resample_stereo_reference<InterpolateMode::Third>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																   fStep, pOut_L, pOut_R, nFrames );
+				break;
+			case InterpolateMode::Cubic:
+				resample_stereo_reference<InterpolateMode::Cubic>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																   fStep, pOut_L, pOut_R, nFrames );
+				break;
+			case InterpolateMode::Hermite:
+				resample_stereo_reference<InterpolateMode::Hermite>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																	 fStep, pOut_L, pOut_R, nFrames );
+				break;
+			case InterpolateMode::Sinc:
+				resample_stereo_reference<InterpolateMode::Sinc>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+																  fStep, pOut_L, pOut_R, nFrames );
+				break;
+			}
+			return;
+		}
+
+		switch ( mode ) {
+		case InterpolateMode::Linear:
+			resample_stereo_block<InterpolateMode::Linear>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+															fStep, pOut_L, pOut_R, nFrames );
+			break;
+		case InterpolateMode::Cosine:
+			resample_stereo_block<InterpolateMode::Cosine>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+															fStep, pOut_L, pOut_R, nFrames );
+			break;
+		case InterpolateMode::Third:
+			resample_stereo_block<InterpolateMode::Third>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+														   fStep, pOut_L, pOut_R, nFrames );
+			break;
+		case InterpolateMode::Cubic:
+			resample_stereo_block<InterpolateMode::Cubic>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+														   fStep, pOut_L, pOut_R, nFrames );
+			break;
+		case InterpolateMode::Hermite:
+			resample_stereo_block<InterpolateMode::Hermite>( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+															 fStep, pOut_L, pOut_R, nFrames );
+			break;
+		case InterpolateMode::Sinc:
+			resample_stereo_sinc( pIn_L, pIn_R, nSampleFrames, fSamplePos,
+								  fStep, pOut_L, pOut_R, nFrames );
+			break;
+		}
+	}
+
 };
 
 }
@@ -0,0 +1,345 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/config.h>
+
+#if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
+
+#include <core/Sampler/PlaybackTrackStretcher.h>
+#include <core/Basics/Sample.h>
+#include <core/Helpers/Threads.h>
+
+#include <rubberband/RubberBandStretcher.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* PlaybackTrackStretcher::__class_name = "PlaybackTrackStretcher";
+
+static_assert( ( PLAYBACK_TRACK_STRETCH_FRAMES & ( PLAYBACK_TRACK_STRETCH_FRAMES - 1 ) ) == 0,
+			   "PLAYBACK_TRACK_STRETCH_FRAMES has to be a power of two" );
+
+/** Maximum number of frames passed to the stretcher or retrieved
+	from it at once.*/
+static const int nChunkFrames = 1024;
+
+/** Number of floats in the interleaved buffer used for reading from
+	disk.*/
+static const int nReadBufferSize = 8192;
+
+/** Time the background thread sleeps if the ring buffer is full.*/
+static const int nIdleMilliseconds = 2;
+
+PlaybackTrackStretcher::PlaybackTrackStretcher()
+	: Object( __class_name )
+	, m_state( Idle )
+	, m_pStartedSample( nullptr )
+	, m_nStartFrame( 0 )
+	, m_fPitchScale( 1.0 )
+	, m_fTimeRatio( 1.0 )
+	, m_nReadFrame( 0 )
+	, m_nWriteFrame( 0 )
+	, m_fSourceAtWrite( 0.0 )
+	, m_bFinished( false )
+	, m_pStretcher( nullptr )
+	, m_pFile( nullptr )
+	, m_nChannels( 0 )
+	, m_fAppliedTimeRatio( 1.0 )
+	, m_nLatencyToSkip( 0 )
+	, m_bInputDone( false )
+	, m_bQuit( false )
+{
+	m_pBuffer_L = new float[ PLAYBACK_TRACK_STRETCH_FRAMES ];
+	m_pBuffer_R = new float[ PLAYBACK_TRACK_STRETCH_FRAMES ];
+	m_pReadBuffer = new float[ nReadBufferSize ];
+	m_pChunk_L = new float[ nChunkFrames ];
+	m_pChunk_R = new float[ nChunkFrames ];
+
+	m_workerThread = std::thread( &PlaybackTrackStretcher::workerLoop, this );
+}
+
+PlaybackTrackStretcher::~PlaybackTrackStretcher()
+{
+	m_bQuit.store( true );
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_condition.notify_all();
+	}
+	m_workerThread.join();
+
+	close();
+	m_pSample.reset();
+	delete[] m_pBuffer_L;
+	delete[] m_pBuffer_R;
+	delete[] m_pReadBuffer;
+	delete[] m_pChunk_L;
+	delete[] m_pChunk_R;
+}
+
+bool PlaybackTrackStretcher::start( std::shared_ptr<Sample> pSample, int nFrame,
+									double fTimeRatio, double fPitchScale )
+{
+	if ( m_state.load( std::memory_order_acquire ) != Idle ) {
+		return false;
+	}
+
+	// The background thread did reset the previous pointer. Only
+	// the reference count is touched here.
+	m_pSample = pSample;
+	m_pStartedSample = pSample.get();
+	m_nStartFrame = nFrame;
+	m_fPitchScale = fPitchScale;
+	m_fTimeRatio.store( fTimeRatio, std::memory_order_relaxed );
+	m_nReadFrame.store( 0, std::memory_order_relaxed );
+	m_nWriteFrame.store( 0, std::memory_order_relaxed );
+	m_fSourceAtWrite.store( nFrame, std::memory_order_relaxed );
+	m_bFinished.store( false, std::memory_order_relaxed );
+	m_state.store( Starting, std::memory_order_release );
+
+	return true;
+}
+
+void PlaybackTrackStretcher::stop()
+{
+	int nState = m_state.load( std::memory_order_acquire );
+	if ( nState == Idle || nState == Stopping ) {
+		return;
+	}
+	m_state.store( Stopping, std::memory_order_release );
+}
+
+int PlaybackTrackStretcher::read( float* pOut_L, float* pOut_R, int nFrames )
+{
+	int nDone = 0;
+	if ( m_state.load( std::memory_order_acquire ) == Running ) {
+		int nRead = m_nReadFrame.load( std::memory_order_relaxed );
+		int nAvailable = m_nWriteFrame.load( std::memory_order_acquire ) - nRead;
+		int nFramesRead = std::min( nFrames, nAvailable );
+
+		while ( nDone < nFramesRead ) {
+			int nIndex = ( nRead + nDone ) & ( PLAYBACK_TRACK_STRETCH_FRAMES - 1 );
+			int nCopy = std::min( nFramesRead - nDone, PLAYBACK_TRACK_STRETCH_FRAMES - nIndex );
+			memcpy( pOut_L + nDone, m_pBuffer_L + nIndex, nCopy * sizeof( float ) );
+			memcpy( pOut_R + nDone, m_pBuffer_R + nIndex, nCopy * sizeof( float ) );
+			nDone += nCopy;
+		}
+		m_nReadFrame.store( nRead + nDone, std::memory_order_release );
+	}
+
+	if ( nDone < nFrames ) {
+		memset( pOut_L + nDone, 0, ( nFrames - nDone ) * sizeof( float ) );
+		memset( pOut_R + nDone, 0, ( nFrames - nDone ) * sizeof( float ) );
+	}
+
+	return nDone;
+}
+
+double PlaybackTrackStretcher::getSourcePosition() const
+{
+	int nBuffered = m_nWriteFrame.load( std::memory_order_acquire ) -
+		m_nReadFrame.load( std::memory_order_relaxed );
+	// The frames stretched ahead are mapped back using the current
+	// ratio. Good enough to keep the track in sync.
+	return m_fSourceAtWrite.load( std::memory_order_relaxed ) -
+		nBuffered / m_fTimeRatio.load( std::memory_order_relaxed );
+}
+
+void PlaybackTrackStretcher::wait( int nFrames )
+{
+	nFrames = std::min( nFrames, static_cast<int>( PLAYBACK_TRACK_STRETCH_FRAMES ) );
+
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) ) {
+		int nState = m_state.load( std::memory_order_acquire );
+		if ( nState != Starting && nState != Running ) {
+			return;
+		}
+		if ( nState == Running &&
+			 ( m_bFinished.load( std::memory_order_acquire ) ||
+			   m_nWriteFrame.load( std::memory_order_acquire ) -
+			   m_nReadFrame.load( std::memory_order_relaxed ) >= nFrames ) ) {
+			return;
+		}
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+	}
+}
+
+void PlaybackTrackStretcher::waitForStop()
+{
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) &&
+			m_state.load( std::memory_order_acquire ) == Stopping ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+	}
+}
+
+void PlaybackTrackStretcher::workerLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "track stretcher" );
+
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) ) {
+		bool bBusy = false;
+
+		switch ( m_state.load( std::memory_order_acquire ) ) {
+		case Starting: {
+			int nNewState = open() ? Running : Failed;
+			int nExpected = Starting;
+			// stop() might have been called in the meantime.
+			m_state.compare_exchange_strong( nExpected, nNewState,
+											 std::memory_order_release );
+			bBusy = true;
+			break;
+		}
+		case Running:
+			bBusy = fill();
+			break;
+		case Stopping:
+			close();
+			m_pSample.reset();
+			m_state.store( Idle, std::memory_order_release );
+			break;
+		default:
+			break;
+		}
+
+		if ( ! bBusy ) {
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_condition.wait_for( lock, std::chrono::milliseconds( nIdleMilliseconds ), [&]() {
+				return m_bQuit.load( std::memory_order_relaxed );
+			} );
+		}
+	}
+}
+
+bool PlaybackTrackStretcher::open()
+{
+	if ( m_pSample == nullptr ) {
+		return false;
+	}
+
+	SF_INFO soundInfo = {0};
+	m_pFile = sf_open( m_pSample->get_filepath().toLocal8Bit(), SFM_READ, &soundInfo );
+	if ( m_pFile == nullptr ) {
+		ERRORLOG( QString( "Unable to open %1 for stretching" ).arg( m_pSample->get_filepath() ) );
+		return false;
+	}
+	m_nChannels = soundInfo.channels;
+
+	if ( m_nChannels < 1 ||
+		 sf_seek( m_pFile, m_nStartFrame, SEEK_SET ) < 0 ) {
+		ERRORLOG( QString( "Unable to seek to frame %1 in %2" )
+				  .arg( m_nStartFrame ).arg( m_pSample->get_filepath() ) );
+		close();
+		return false;
+	}
+
+	RubberBand::RubberBandStretcher::Options options =
+		RubberBand::RubberBandStretcher::OptionProcessRealTime |
+		RubberBand::RubberBandStretcher::OptionTransientsMixed |
+		RubberBand::RubberBandStretcher::OptionThreadingNever;
+	m_fAppliedTimeRatio = m_fTimeRatio.load( std::memory_order_relaxed );
+	m_pStretcher = new RubberBand::RubberBandStretcher( soundInfo.samplerate, 2, options,
+														m_fAppliedTimeRatio, m_fPitchScale );
+	m_pStretcher->setMaxProcessSize( nChunkFrames );
+	// The output is delayed by the analysis window of the
+	// stretcher.
+	m_nLatencyToSkip = m_pStretcher->getLatency();
+	m_bInputDone = false;
+
+	return true;
+}
+
+bool PlaybackTrackStretcher::fill()
+{
+	int nWrite = m_nWriteFrame.load( std::memory_order_relaxed );
+	int nFree = PLAYBACK_TRACK_STRETCH_FRAMES -
+		( nWrite - m_nReadFrame.load( std::memory_order_acquire ) );
+	if ( nFree <= 0 || m_bFinished.load( std::memory_order_relaxed ) ) {
+		return false;
+	}
+
+	double fTimeRatio = m_fTimeRatio.load( std::memory_order_relaxed );
+	if ( fTimeRatio != m_fAppliedTimeRatio ) {
+		m_pStretcher->setTimeRatio( fTimeRatio );
+		m_fAppliedTimeRatio = fTimeRatio;
+	}
+
+	int nAvailable = m_pStretcher->available();
+	if ( nAvailable <= 0 && m_bInputDone ) {
+		m_bFinished.store( true, std::memory_order_release );
+		return false;
+	}
+
+	if ( nAvailable <= 0 ) {
+		int nFrames = std::max( static_cast<int>( m_pStretcher->getSamplesRequired() ), 1 );
+		nFrames = std::min( { nFrames, nChunkFrames, nReadBufferSize / m_nChannels } );
+
+		sf_count_t nReadFrames = std::max( sf_readf_float( m_pFile, m_pReadBuffer, nFrames ),
+										   static_cast<sf_count_t>( 0 ) );
+		const int nRight = m_nChannels > 1 ? 1 : 0;
+		for ( int ii = 0; ii < nReadFrames; ++ii ) {
+			m_pChunk_L[ ii ] = m_pReadBuffer[ ii * m_nChannels ];
+			m_pChunk_R[ ii ] = m_pReadBuffer[ ii * m_nChannels + nRight ];
+		}
+		m_bInputDone = nReadFrames < nFrames;
+
+		const float* ppInput[ 2 ] = { m_pChunk_L, m_pChunk_R };
+		m_pStretcher->process( ppInput, nReadFrames, m_bInputDone );
+		return true;
+	}
+
+	int nRetrieve = std::min( { nAvailable, nFree, nChunkFrames } );
+	float* ppOutput[ 2 ] = { m_pChunk_L, m_pChunk_R };
+	nRetrieve = m_pStretcher->retrieve( ppOutput, nRetrieve );
+
+	int nSkip = std::min( m_nLatencyToSkip, nRetrieve );
+	m_nLatencyToSkip -= nSkip;
+	for ( int ii = nSkip; ii < nRetrieve; ++ii ) {
+		int nIndex = ( nWrite + ii - nSkip ) & ( PLAYBACK_TRACK_STRETCH_FRAMES - 1 );
+		m_pBuffer_L[ nIndex ] = m_pChunk_L[ ii ];
+		m_pBuffer_R[ nIndex ] = m_pChunk_R[ ii ];
+	}
+
+	int nWritten = nRetrieve - nSkip;
+	m_fSourceAtWrite.store( m_fSourceAtWrite.load( std::memory_order_relaxed ) +
+							nWritten / m_fAppliedTimeRatio, std::memory_order_relaxed );
+	m_nWriteFrame.store( nWrite + nWritten, std::memory_order_release );
+
+	return true;
+}
+
+void PlaybackTrackStretcher::close()
+{
+	delete m_pStretcher;
+	m_pStretcher = nullptr;
+	if ( m_pFile != nullptr ) {
+		sf_close( m_pFile );
+		m_pFile = nullptr;
+	}
+}
+
+};
+
+#endif // H2CORE_HAVE_RUBBERBAND
@@ -0,0 +1,209 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#ifndef PLAYBACK_TRACK_STRETCHER_H
+#define PLAYBACK_TRACK_STRETCHER_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <sndfile.h>
+
+/** Capacity in frames of the ring buffer holding the stretched
+	output of the H2Core::PlaybackTrackStretcher. Has to be a power
+	of two. Tempo changes take effect once the frames stretched
+	ahead are played.*/
+#define PLAYBACK_TRACK_STRETCH_FRAMES 8192
+
+namespace RubberBand
+{
+class RubberBandStretcher;
+};
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Time-stretches the playback track of a Song in realtime so it
+ * follows the tempo of the timeline.
+ *
+ * Used by the Sampler if Hydrogen was compiled with
+ * #H2CORE_HAVE_RUBBERBAND and Song::getPlaybackTrackBpm() is set. A
+ * background thread reads the track from disk, runs it through a
+ * RubberBand::RubberBandStretcher in realtime mode, and keeps a ring
+ * buffer of #PLAYBACK_TRACK_STRETCH_FRAMES frames ahead of the
+ * transport filled. The time ratio can be changed at any time using
+ * setTimeRatio() without stretching the whole file again.
+ *
+ * start(), stop(), setTimeRatio(), and read() are called by the
+ * audio thread and do neither block nor allocate memory. The
+ * stretcher itself is created and destroyed by the background
+ * thread.
+ */
+class PlaybackTrackStretcher : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	PlaybackTrackStretcher();
+	~PlaybackTrackStretcher();
+
+	/**
+	 * Starts stretching @a pSample beginning at its frame @a nFrame.
+	 *
+	 * \param fTimeRatio Number of output frames per frame of
+	 * @a pSample.
+	 * \param fPitchScale Pitch shift applied on top. Compensates
+	 * the pitch change caused by a differing sample rate of the
+	 * audio driver.
+	 * \return false if the stretcher was not idle.
+	 */
+	bool start( std::shared_ptr<Sample> pSample, int nFrame,
+				double fTimeRatio, double fPitchScale );
+	/** Hands the current track back to the background thread.*/
+	void stop();
+	/** \return true if start() can be called.*/
+	bool isIdle() const;
+	/** \return true if the stretcher was started and produces
+		frames.*/
+	bool isRunning() const;
+	/** \return Sample passed to the latest start(). Must only be
+		compared and not be dereferenced.*/
+	const Sample* getSample() const;
+
+	/** Sets the number of output frames per frame of the track.*/
+	void setTimeRatio( double fTimeRatio );
+
+	/**
+	 * Copies the next @a nFrames stretched frames into @a pOut_L
+	 * and @a pOut_R.
+	 *
+	 * \return Number of frames available. The remaining ones are
+	 * set to zero.
+	 */
+	int read( float* pOut_L, float* pOut_R, int nFrames );
+	/** \return Frame of the track the next frame returned by read()
+		belongs to.*/
+	double getSourcePosition() const;
+
+	/**
+	 * Blocks until @a nFrames frames can be read, the end of the
+	 * track was reached, or the stretcher was stopped.
+	 *
+	 * Must not be called by the audio thread of a realtime driver.
+	 * Used by the DiskWriterDriver.
+	 */
+	void wait( int nFrames );
+	/** Blocks until a pending stop() was handled by the background
+		thread. Same restrictions as wait().*/
+	void waitForStop();
+
+private:
+	enum State {
+		/** No track assigned.*/
+		Idle = 0,
+		/** Set by start(). The background thread has to open the
+			file and create the stretcher.*/
+		Starting,
+		/** The background thread keeps the ring buffer filled.*/
+		Running,
+		/** The track could not be opened. read() returns silence.*/
+		Failed,
+		/** Set by stop(). The background thread has to clean up.*/
+		Stopping
+	};
+
+	void workerLoop();
+	/** Opens the file of #m_pSample and creates #m_pStretcher.*/
+	bool open();
+	/** Feeds the stretcher or moves its output into the ring
+		buffer.
+		\return true if there was something to do.*/
+	bool fill();
+	void close();
+
+	std::atomic<int> m_state;
+	/** Only written by start() while #Idle and reset by the
+		background thread while #Stopping.*/
+	std::shared_ptr<Sample> m_pSample;
+	const Sample* m_pStartedSample;
+	int m_nStartFrame;
+	double m_fPitchScale;
+	std::atomic<double> m_fTimeRatio;
+
+	float* m_pBuffer_L;
+	float* m_pBuffer_R;
+	/** Absolute index of the next frame returned by read().*/
+	std::atomic<int> m_nReadFrame;
+	/** Absolute index of the frame following the last one written
+		to the ring buffer.*/
+	std::atomic<int> m_nWriteFrame;
+	/** Frame of the track #m_nWriteFrame belongs to.*/
+	std::atomic<double> m_fSourceAtWrite;
+	/** Set once the stretcher delivered all of its output.*/
+	std::atomic<bool> m_bFinished;
+
+	/** Only accessed by the background thread.*/
+	RubberBand::RubberBandStretcher* m_pStretcher;
+	SNDFILE* m_pFile;
+	int m_nChannels;
+	double m_fAppliedTimeRatio;
+	int m_nLatencyToSkip;
+	bool m_bInputDone;
+	/** Interleaved buffer the file is read into.*/
+	float* m_pReadBuffer;
+	float* m_pChunk_L;
+	float* m_pChunk_R;
+
+	std::thread m_workerThread;
+	std::atomic<bool> m_bQuit;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
+
+inline bool PlaybackTrackStretcher::isIdle() const {
+	return m_state.load( std::memory_order_acquire ) == Idle;
+}
+
+inline bool PlaybackTrackStretcher::isRunning() const {
+	return m_state.load( std::memory_order_acquire ) == Running;
+}
+
+inline const Sample* PlaybackTrackStretcher::getSample() const {
+	return m_pStartedSample;
+}
+
+inline void PlaybackTrackStretcher::setTimeRatio( double fTimeRatio ) {
+	m_fTimeRatio.store( fTimeRatio, std::memory_order_relaxed );
+}
+
+};
+
+#endif
@@ -0,0 +1,375 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Sampler/SampleStreamer.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/SamplePack.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* SampleStreamer::__class_name = "SampleStreamer";
+
+static_assert( ( SAMPLE_STREAM_FRAMES & ( SAMPLE_STREAM_FRAMES - 1 ) ) == 0,
+			   "SAMPLE_STREAM_FRAMES has to be a power of two" );
+
+/** Number of floats in the interleaved buffer used for reading from
+	disk.*/
+static const int nReadBufferSize = 32768;
+
+/** Time the I/O thread sleeps if none of the streams needs to be
+	filled. The preload head of a sample is several orders of
+	magnitude longer.*/
+static const int nIdleMilliseconds = 2;
+
+SampleStreamer::SampleStreamer( int nStreams )
+	: Object( __class_name )
+	, m_nStreams( std::min( std::max( nStreams, 0 ), MAX_SAMPLE_STREAMS ) )
+	, m_nUnderruns( 0 )
+	, m_bQuit( false )
+{
+	for ( int ii = 0; ii < MAX_SAMPLE_STREAMS; ++ii ) {
+		Stream& stream = m_streams[ ii ];
+		stream.state.store( Free, std::memory_order_relaxed );
+		stream.nStartFrame = 0;
+		stream.nReadFrame.store( 0, std::memory_order_relaxed );
+		stream.nWriteFrame.store( 0, std::memory_order_relaxed );
+		// Streams beyond m_nStreams are never opened.
+		stream.pBuffer_L = ii < m_nStreams ? new float[ SAMPLE_STREAM_FRAMES ] : nullptr;
+		stream.pBuffer_R = ii < m_nStreams ? new float[ SAMPLE_STREAM_FRAMES ] : nullptr;
+		stream.pFile = nullptr;
+		stream.nChannels = 0;
+	}
+	m_pReadBuffer = new float[ nReadBufferSize ];
+	m_pDecoded_L = new int16_t[ SAMPLE_PACK_BLOCK ];
+	m_pDecoded_R = new int16_t[ SAMPLE_PACK_BLOCK ];
+
+	m_ioThread = std::thread( &SampleStreamer::ioLoop, this );
+
+	INFOLOG( QString( "Streaming up to %1 voices" ).arg( m_nStreams ) );
+}
+
+SampleStreamer::~SampleStreamer()
+{
+	m_bQuit.store( true );
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_condition.notify_all();
+	}
+	m_ioThread.join();
+
+	for ( auto& stream : m_streams ) {
+		closeFile( stream );
+		stream.pSample.reset();
+		delete[] stream.pBuffer_L;
+		delete[] stream.pBuffer_R;
+	}
+	delete[] m_pReadBuffer;
+	delete[] m_pDecoded_L;
+	delete[] m_pDecoded_R;
+}
+
+int SampleStreamer::open( std::shared_ptr<Sample> pSample, int nStartFrame )
+{
+	for ( int ii = 0; ii < m_nStreams; ++ii ) {
+		Stream& stream = m_streams[ ii ];
+		int nExpected = Free;
+		if ( stream.state.compare_exchange_strong( nExpected, Claimed,
+												   std::memory_order_acquire ) ) {
+			// The I/O thread did reset the previous pointer. Only
+			// the reference count is touched here.
+			stream.pSample = pSample;
+			stream.nStartFrame = nStartFrame;
+			stream.nReadFrame.store( nStartFrame, std::memory_order_relaxed );
+			stream.nWriteFrame.store( nStartFrame, std::memory_order_relaxed );
+			stream.state.store( Opening, std::memory_order_release );
+			return ii;
+		}
+	}
+
+	return -1;
+}
+
+void SampleStreamer::close( int nStream )
+{
+	if ( nStream < 0 || nStream >= MAX_SAMPLE_STREAMS ) {
+		return;
+	}
+	m_streams[ nStream ].state.store( Closing, std::memory_order_release );
+}
+
+bool SampleStreamer::read( int nStream, int nFrame, int nFrames, float* pOut_L, float* pOut_R )
+{
+	if ( nFrames <= 0 ) {
+		return true;
+	}
+
+	int nFrom = nFrame;
+	int nTo = nFrame;
+	if ( nStream >= 0 && nStream < MAX_SAMPLE_STREAMS ) {
+		Stream& stream = m_streams[ nStream ];
+		if ( stream.state.load( std::memory_order_acquire ) == Active ) {
+			nFrom = std::max( nFrame, stream.nReadFrame.load( std::memory_order_relaxed ) );
+			nTo = std::min( nFrame + nFrames,
+							stream.nWriteFrame.load( std::memory_order_acquire ) );
+			nTo = std::max( nTo, nFrom );
+
+			int nDone = nFrom;
+			while ( nDone < nTo ) {
+				int nIndex = nDone & ( SAMPLE_STREAM_FRAMES - 1 );
+				int nCopy = std::min( nTo - nDone, SAMPLE_STREAM_FRAMES - nIndex );
+				memcpy( pOut_L + ( nDone - nFrame ), stream.pBuffer_L + nIndex,
+						nCopy * sizeof( float ) );
+				memcpy( pOut_R + ( nDone - nFrame ), stream.pBuffer_R + nIndex,
+						nCopy * sizeof( float ) );
+				nDone += nCopy;
+			}
+		}
+	}
+
+	if ( nFrom == nFrame && nTo == nFrame + nFrames ) {
+		return true;
+	}
+
+	// Silence everything not available.
+	if ( nFrom > nFrame ) {
+		memset( pOut_L, 0, ( nFrom - nFrame ) * sizeof( float ) );
+		memset( pOut_R, 0, ( nFrom - nFrame ) * sizeof( float ) );
+	}
+	if ( nTo < nFrame + nFrames ) {
+		memset( pOut_L + ( nTo - nFrame ), 0, ( nFrame + nFrames - nTo ) * sizeof( float ) );
+		memset( pOut_R + ( nTo - nFrame ), 0, ( nFrame + nFrames - nTo ) * sizeof( float ) );
+	}
+	m_nUnderruns.fetch_add( 1, std::memory_order_relaxed );
+
+	return false;
+}
+
+void SampleStreamer::discard( int nStream, int nFrame )
+{
+	if ( nStream < 0 || nStream >= MAX_SAMPLE_STREAMS ) {
+		return;
+	}
+	Stream& stream = m_streams[ nStream ];
+	int nWrite = stream.nWriteFrame.load( std::memory_order_relaxed );
+	if ( nFrame > nWrite ) {
+		// The voice did overtake the I/O thread. Frames which were
+		// not read yet must not be dropped.
+		nFrame = nWrite;
+	}
+	if ( nFrame > stream.nReadFrame.load( std::memory_order_relaxed ) ) {
+		stream.nReadFrame.store( nFrame, std::memory_order_release );
+	}
+}
+
+void SampleStreamer::wait( int nStream, int nFrame )
+{
+	if ( nStream < 0 || nStream >= MAX_SAMPLE_STREAMS ) {
+		return;
+	}
+	Stream& stream = m_streams[ nStream ];
+
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) ) {
+		int nState = stream.state.load( std::memory_order_acquire );
+		if ( nState != Opening && nState != Active ) {
+			return;
+		}
+		if ( nState == Active ) {
+			// The I/O thread neither reads beyond the end of the
+			// sample nor overwrites frames not discarded yet.
+			// Packs are decoded in whole blocks, which might not
+			// fit into the remaining space.
+			int nLast = std::min( nFrame, stream.pSample->get_frames() );
+			nLast = std::min( nLast, stream.nReadFrame.load( std::memory_order_relaxed ) +
+							  SAMPLE_STREAM_FRAMES -
+							  ( stream.pPack != nullptr ? SAMPLE_PACK_BLOCK - 1 : 0 ) );
+			if ( stream.nWriteFrame.load( std::memory_order_acquire ) >= nLast ) {
+				return;
+			}
+		}
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+	}
+}
+
+void SampleStreamer::ioLoop()
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "sample streamer" );
+
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) ) {
+		bool bBusy = false;
+
+		for ( auto& stream : m_streams ) {
+			switch ( stream.state.load( std::memory_order_acquire ) ) {
+			case Opening: {
+				int nNewState = openFile( stream ) ? Active : Failed;
+				int nExpected = Opening;
+				// close() might have been called in the meantime.
+				stream.state.compare_exchange_strong( nExpected, nNewState,
+													  std::memory_order_release );
+				bBusy = true;
+				break;
+			}
+			case Active:
+				if ( fill( stream ) ) {
+					bBusy = true;
+				}
+				break;
+			case Closing:
+				closeFile( stream );
+				stream.pSample.reset();
+				stream.state.store( Free, std::memory_order_release );
+				break;
+			default:
+				break;
+			}
+		}
+
+		if ( ! bBusy ) {
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_condition.wait_for( lock, std::chrono::milliseconds( nIdleMilliseconds ), [&]() {
+				return m_bQuit.load( std::memory_order_relaxed );
+			} );
+		}
+	}
+}
+
+bool SampleStreamer::openFile( Stream& stream )
+{
+	auto pSample = stream.pSample;
+	if ( pSample == nullptr ) {
+		return false;
+	}
+
+	stream.pPack = pSample->get_pack();
+	if ( stream.pPack != nullptr ) {
+		stream.nChannels = stream.pPack->get_channels();
+		return stream.nStartFrame >= 0 && stream.nStartFrame <= stream.pPack->get_frames();
+	}
+
+	SF_INFO soundInfo = {0};
+	stream.pFile = sf_open( pSample->get_filepath().toLocal8Bit(), SFM_READ, &soundInfo );
+	if ( stream.pFile == nullptr ) {
+		ERRORLOG( QString( "Unable to open %1 for streaming" ).arg( pSample->get_filepath() ) );
+		return false;
+	}
+	stream.nChannels = soundInfo.channels;
+
+	if ( stream.nChannels < 1 ||
+		 sf_seek( stream.pFile, stream.nStartFrame, SEEK_SET ) < 0 ) {
+		ERRORLOG( QString( "Unable to seek to frame %1 in %2" )
+				  .arg( stream.nStartFrame ).arg( pSample->get_filepath() ) );
+		closeFile( stream );
+		return false;
+	}
+
+	return true;
+}
+
+bool SampleStreamer::fill( Stream& stream )
+{
+	if ( stream.pPack != nullptr ) {
+		return fillFromPack( stream );
+	}
+
+	int nWrite = stream.nWriteFrame.load( std::memory_order_relaxed );
+	int nRead = stream.nReadFrame.load( std::memory_order_acquire );
+	int nFrames = std::min( static_cast<int>( SAMPLE_STREAM_FRAMES ) - ( nWrite - nRead ),
+							stream.pSample->get_frames() - nWrite );
+	nFrames = std::min( nFrames, nReadBufferSize / stream.nChannels );
+	if ( nFrames <= 0 ) {
+		return false;
+	}
+
+	sf_count_t nReadFrames = sf_readf_float( stream.pFile, m_pReadBuffer, nFrames );
+	if ( nReadFrames < nFrames ) {
+		// Truncated file. Pad with silence so the voice can still
+		// reach its end.
+		WARNINGLOG( QString( "Unable to read frames %1 to %2 of %3" )
+					.arg( nWrite + nReadFrames ).arg( nWrite + nFrames )
+					.arg( stream.pSample->get_filepath() ) );
+		memset( m_pReadBuffer + nReadFrames * stream.nChannels, 0,
+				( nFrames - nReadFrames ) * stream.nChannels * sizeof( float ) );
+	}
+
+	const int nRight = stream.nChannels > 1 ? 1 : 0;
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		int nIndex = ( nWrite + ii ) & ( SAMPLE_STREAM_FRAMES - 1 );
+		stream.pBuffer_L[ nIndex ] = m_pReadBuffer[ ii * stream.nChannels ];
+		stream.pBuffer_R[ nIndex ] = m_pReadBuffer[ ii * stream.nChannels + nRight ];
+	}
+
+	stream.nWriteFrame.store( nWrite + nFrames, std::memory_order_release );
+
+	return true;
+}
+
+bool SampleStreamer::fillFromPack( Stream& stream )
+{
+	int nWrite = stream.nWriteFrame.load( std::memory_order_relaxed );
+	int nRead = stream.nReadFrame.load( std::memory_order_acquire );
+	const SamplePack& pack = *stream.pPack;
+
+	int nBlock = nWrite / SAMPLE_PACK_BLOCK;
+	int nOffset = nWrite - nBlock * SAMPLE_PACK_BLOCK;
+	int nEnd = std::min( { ( nBlock + 1 ) * SAMPLE_PACK_BLOCK, pack.get_frames(),
+						   stream.pSample->get_frames() } );
+	int nFrames = nEnd - nWrite;
+	if ( nFrames <= 0 ||
+		 nFrames > static_cast<int>( SAMPLE_STREAM_FRAMES ) - ( nWrite - nRead ) ) {
+		return false;
+	}
+
+	if ( pack.decode_block( nBlock, m_pDecoded_L, m_pDecoded_R ) < nOffset + nFrames ) {
+		return false;
+	}
+
+	int nDone = 0;
+	while ( nDone < nFrames ) {
+		int nIndex = ( nWrite + nDone ) & ( SAMPLE_STREAM_FRAMES - 1 );
+		int nCopy = std::min( nFrames - nDone, SAMPLE_STREAM_FRAMES - nIndex );
+		Dsp::convertInt16( stream.pBuffer_L + nIndex, m_pDecoded_L + nOffset + nDone, nCopy );
+		Dsp::convertInt16( stream.pBuffer_R + nIndex, m_pDecoded_R + nOffset + nDone, nCopy );
+		nDone += nCopy;
+	}
+
+	stream.nWriteFrame.store( nWrite + nFrames, std::memory_order_release );
+
+	return true;
+}
+
+void SampleStreamer::closeFile( Stream& stream )
+{
+	stream.pPack.reset();
+	if ( stream.pFile != nullptr ) {
+		sf_close( stream.pFile );
+		stream.pFile = nullptr;
+	}
+}
+
+};
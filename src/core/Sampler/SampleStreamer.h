@@ -0,0 +1,200 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef SAMPLE_STREAMER_H
+#define SAMPLE_STREAMER_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <sndfile.h>
+
+/** Maximum number of voices a H2Core::SampleStreamer can feed at the
+	same time.*/
+#define MAX_SAMPLE_STREAMS 64
+/** Capacity in frames of the ring buffer of a single stream. Has to
+	be a power of two.*/
+#define SAMPLE_STREAM_FRAMES 32768
+
+namespace H2Core
+{
+
+class Sample;
+class SamplePack;
+
+/**
+ * Feeds voices playing a streamed Sample with the frames beyond its
+ * resident head.
+ *
+ * If Preferences::m_bSampleStreaming is set, Sample::load() does only
+ * keep the first Preferences::m_nStreamingPreloadFrames of the
+ * samples of a drumkit in memory. As soon as a voice starts, the
+ * Sampler opens a stream for it using open(). A background I/O thread
+ * does read the remaining frames from disk into the ring buffer of
+ * the stream while the voice is still playing the resident head. The
+ * Sampler then picks them up using read().
+ *
+ * Samples stored in a SamplePack, see Sample::set_packed_storage(),
+ * are streamed as well. Their blocks are decoded from memory by the
+ * I/O thread instead of reading the file.
+ *
+ * The playback track of a Song is always streamed, see
+ * Sampler::reinitializePlaybackTrack(), and so are the files
+ * previewed in the AudioFileBrowser. Without
+ * Preferences::m_bSampleStreaming the Sampler does only create one
+ * stream for each of them.
+ *
+ * open(), read(), discard(), and close() are called by the audio
+ * thread (or the workers of the Sampler, each for its own streams)
+ * and do neither block nor allocate memory. All file operations and
+ * the release of the Sample references happen in the I/O thread.
+ */
+class SampleStreamer : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** \param nStreams Number of streams to allocate ring buffers
+		for. At most #MAX_SAMPLE_STREAMS.*/
+	SampleStreamer( int nStreams = MAX_SAMPLE_STREAMS );
+	~SampleStreamer();
+
+	/**
+	 * Claims a stream providing the frames of @a pSample starting at
+	 * @a nStartFrame.
+	 *
+	 * \return Index of the stream or -1 if all of them are in use.
+	 */
+	int open( std::shared_ptr<Sample> pSample, int nStartFrame );
+	/** Hands stream @a nStream back to the I/O thread.*/
+	void close( int nStream );
+
+	/**
+	 * Copies the frames [@a nFrame, @a nFrame + @a nFrames) of stream
+	 * @a nStream into @a pOut_L and @a pOut_R.
+	 *
+	 * Frames not read from disk yet are set to zero and the underrun
+	 * counter is incremented.
+	 *
+	 * \return false if at least one frame was missing.
+	 */
+	bool read( int nStream, int nFrame, int nFrames, float* pOut_L, float* pOut_R );
+	/** Tells the I/O thread all frames of stream @a nStream before
+		@a nFrame won't be read anymore and their space in the ring
+		buffer can be reused.*/
+	void discard( int nStream, int nFrame );
+	/**
+	 * Blocks until all frames of stream @a nStream before @a nFrame
+	 * were read from disk or the stream failed.
+	 *
+	 * Must not be called by the audio thread of a realtime driver.
+	 * Used by the DiskWriterDriver, which renders faster than the
+	 * I/O thread would otherwise keep up with.
+	 */
+	void wait( int nStream, int nFrame );
+
+	/** \return Number of calls to read() which could not be
+		satisfied completely.*/
+	int getUnderruns() const;
+
+private:
+	enum StreamState {
+		/** Not used by any voice.*/
+		Free = 0,
+		/** Claimed by open() and about to be initialized.*/
+		Claimed,
+		/** The I/O thread has to open the file.*/
+		Opening,
+		/** The I/O thread keeps the ring buffer filled.*/
+		Active,
+		/** The file could not be opened. All reads will fail.*/
+		Failed,
+		/** Returned by close(). The I/O thread has to clean up.*/
+		Closing
+	};
+
+	struct Stream {
+		std::atomic<int> state;
+		/** Only written by open() while #Claimed and reset by the
+			I/O thread while #Closing.*/
+		std::shared_ptr<Sample> pSample;
+		int nStartFrame;
+		/** Absolute index of the first frame still needed by the
+			voice.*/
+		std::atomic<int> nReadFrame;
+		/** Absolute index of the frame following the last one
+			available in the ring buffer.*/
+		std::atomic<int> nWriteFrame;
+		float* pBuffer_L;
+		float* pBuffer_R;
+		/** Only accessed by the I/O thread.*/
+		SNDFILE* pFile;
+		int nChannels;
+		/** Set by the I/O thread while #Opening if the frames are
+			decoded from a SamplePack instead of read from
+			#pFile.*/
+		std::shared_ptr<const SamplePack> pPack;
+	};
+
+	void ioLoop();
+	/** Opens the file of @a stream and seeks to its start frame.*/
+	bool openFile( Stream& stream );
+	/** Reads the next chunk of @a stream from disk.
+		\return true if frames were read.*/
+	bool fill( Stream& stream );
+	/** Decodes the next block of @a stream from its SamplePack once
+		the ring buffer has room for the rest of it.
+		\return true if frames were decoded.*/
+	bool fillFromPack( Stream& stream );
+	void closeFile( Stream& stream );
+
+	Stream m_streams[ MAX_SAMPLE_STREAMS ];
+	/** Number of streams in #m_streams which can be opened.*/
+	int m_nStreams;
+	/** Interleaved buffer the I/O thread reads the files into.*/
+	float* m_pReadBuffer;
+	/** Buffers the I/O thread decodes a block of a SamplePack
+		into.*/
+	int16_t* m_pDecoded_L;
+	int16_t* m_pDecoded_R;
+
+	alignas(64) std::atomic<int> m_nUnderruns;
+
+	std::thread m_ioThread;
+	std::atomic<bool> m_bQuit;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
+
+inline int SampleStreamer::getUnderruns() const {
+	return m_nUnderruns.load( std::memory_order_relaxed );
+}
+
+};
+
+#endif
@@ -20,12 +20,15 @@
  *
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
 
 #include <core/IO/AudioOutput.h>
+#include <core/IO/DiskWriterDriver.h>
 #include <core/IO/JackAudioDriver.h>
+#include <core/IO/OfflineDriver.h>
 
 #include <core/Basics/Adsr.h>
 #include <core/AudioEngine.h>
@@ -38,15 +41,24 @@
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/Note.h>
 #include <core/Preferences.h>
+#include <core/RealtimeConfig.h>
 #include <core/Basics/Sample.h>
 #include <core/Basics/Song.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/EventQueue.h>
+#include <core/InstrumentFreezer.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Tracer.h>
+#include <core/rt_clock.h>
 
 #include <core/FX/Effects.h>
+#include <core/FX/InsertChain.h>
+#include <core/Sampler/PlaybackTrackStretcher.h>
 #include <core/Sampler/Sampler.h>
+#include <core/Sampler/SampleStreamer.h>
+#include <core/Sampler/WorkerPool.h>
 
 #include <iostream>
 #include <QDebug>
@@ -56,6 +68,25 @@ namespace H2Core
 
 const char* Sampler::__class_name = "Sampler";
 
+/** Maximum number of frames of a streamed Sample a voice can access
+	within a single block. Extreme pitch shifts with large buffer
+	sizes exceeding it are rendered with silence beyond. Half the
+	capacity of a stream as the remainder is being refilled by the
+	I/O thread meanwhile.*/
+static const int nStreamWindowFrames = SAMPLE_STREAM_FRAMES / 2;
+
+/** Number of frames of the playback track kept in memory. The
+	stream is opened at the start of the transport and has the
+	remainder of the head to fill its ring buffer.*/
+static const int nPlaybackTrackPreloadFrames = SAMPLE_STREAM_FRAMES;
+
+/** Deviation in seconds of a stretched playback track from the
+	transport beyond which its stretcher is restarted.*/
+static const double fStretchResyncSeconds = 0.25;
+/** Maximum relative change of the time ratio used to pull a
+	stretched playback track back in sync.*/
+static const double fMaxStretchCorrection = 0.02;
+
 static Instrument* createInstrument(int id, const QString& filepath, float volume )
 {
 	Instrument* pInstrument = new Instrument( id, filepath );
@@ -72,14 +103,81 @@ Sampler::Sampler()
 		: Object( __class_name )
 		, m_pMainOut_L( nullptr )
 		, m_pMainOut_R( nullptr )
+		, m_nVoiceAge( 0 )
+		, m_midiKeyVoices{}
 		, m_pPreviewInstrument( nullptr )
+		, m_pWorkerPool( nullptr )
+		, m_bRenderingParallel( false )
+		, m_nRenderFrames( 0 )
+		, m_pRenderSong( nullptr )
+		, m_nRenderFX( 0 )
+		, m_pSampleStreamer( nullptr )
+		, m_pPlaybackTrackStretcher( nullptr )
+		, m_pTrackOutDriver( nullptr )
+		, m_bRenderingStems( false )
+		, m_bRenderingFreeze( false )
 		, m_interpolateMode( Interpolation::InterpolateMode::Linear )
+		, m_bForceLinearInterpolation( false )
+		, m_bReducedVoices( false )
 {
 	INFOLOG( "INIT" );
 	
 	m_pMainOut_L = new float[ MAX_BUFFER_SIZE ];
 	m_pMainOut_R = new float[ MAX_BUFFER_SIZE ];
 
+	m_mainTarget.pMainOut_L = m_pMainOut_L;
+	m_mainTarget.pMainOut_R = m_pMainOut_R;
+	m_mainTarget.pResampled_L = new float[ MAX_BUFFER_SIZE ];
+	m_mainTarget.pResampled_R = new float[ MAX_BUFFER_SIZE ];
+	m_mainTarget.pEnvelope = new float[ MAX_BUFFER_SIZE ];
+	m_mainTarget.pVoice_L = new float[ MAX_BUFFER_SIZE ];
+	m_mainTarget.pVoice_R = new float[ MAX_BUFFER_SIZE ];
+	m_mainTarget.pStream_L = new float[ nStreamWindowFrames ];
+	m_mainTarget.pStream_R = new float[ nStreamWindowFrames ];
+	m_mainTarget.bPreview = false;
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		m_mainTarget.pFXOut_L[ nFX ] = nullptr;
+		m_mainTarget.pFXOut_R[ nFX ] = nullptr;
+	}
+	for ( int nCompo = 0; nCompo < MAX_COMPONENTS; ++nCompo ) {
+		m_mainTarget.pComponentOut_L[ nCompo ] = nullptr;
+		m_mainTarget.pComponentOut_R[ nCompo ] = nullptr;
+	}
+	// The outputs are chosen in each cycle by processPreviews().
+	m_previewTarget = m_mainTarget;
+	m_previewTarget.bPreview = true;
+	m_previewNotes.reserve( nPreviewVoices );
+
+	Preferences* pPref = Preferences::get_instance();
+	int nWorkers = pPref->m_nSamplerWorkers;
+	if ( nWorkers > 0 ) {
+		m_pWorkerPool = new WorkerPool( nWorkers );
+		// The audio thread does take part in the rendering too.
+		allocateWorkerTargets( m_pWorkerPool->getNumberOfWorkers() + 1 );
+	}
+
+	if ( pPref->m_bSampleStreaming || pPref->m_bPackedSampleStorage ) {
+		m_pSampleStreamer = new SampleStreamer();
+		// Affects all drumkit samples loaded from now on.
+		if ( pPref->m_bSampleStreaming ) {
+			Sample::set_stream_preload( pPref->m_nStreamingPreloadFrames );
+		}
+		if ( pPref->m_bPackedSampleStorage ) {
+			Sample::set_packed_storage( pPref->m_nStreamingPreloadFrames );
+		}
+	} else {
+		// The playback track and the previews of the
+		// AudioFileBrowser are streamed regardless.
+		m_pSampleStreamer = new SampleStreamer( 2 );
+	}
+#ifdef H2CORE_HAVE_RUBBERBAND
+	m_pPlaybackTrackStretcher = new PlaybackTrackStretcher();
+#endif
+	// Affects all drumkit samples loaded from now on.
+	Sample::set_compact_storage( pPref->m_bCompactSampleStorage );
+	Sample::set_silence_threshold( pPref->m_bTrimSampleSilence ?
+								   pow( 10.0, pPref->m_fSampleSilenceThreshold / 20.0 ) : 0 );
+
 	m_nMaxLayers = InstrumentComponent::getMaxLayers();
 
 	QString sEmptySampleFilename = Filesystem::empty_sample_path();
@@ -91,6 +189,19 @@ Sampler::Sampler()
 	// dummy instrument used for playback track
 	m_pPlaybackTrackInstrument = createInstrument( PLAYBACK_INSTR_ID, sEmptySampleFilename, 0.8 );
 	m_nPlayBackSamplePosition = 0;
+	m_nPlaybackTrackStream = -1;
+
+	// Invalid values to force building the table during the first
+	// call to updatePanLawTable().
+	m_nPanLawType = -1;
+	m_fPanLawKNorm = 0;
+	m_nPanLawRevision = 0;
+	memset( m_panLawTable, 0, sizeof( m_panLawTable ) );
+
+	for ( int ii = 0; ii <= 2 * PITCH_RATIO_RANGE * PITCH_RATIO_STEPS; ++ii ) {
+		double fPitch = static_cast<double>( ii ) / PITCH_RATIO_STEPS - PITCH_RATIO_RANGE;
+		m_pitchRatioTable[ ii ] = pow( 2.0, fPitch / 12.0 );
+	}
 }
 
 
@@ -98,6 +209,25 @@ Sampler::~Sampler()
 {
 	INFOLOG( "DESTROY" );
 
+	stopPreviews();
+
+	delete m_pWorkerPool;
+	freeWorkerTargets();
+	delete[] m_mainTarget.pResampled_L;
+	delete[] m_mainTarget.pResampled_R;
+	delete[] m_mainTarget.pEnvelope;
+	delete[] m_mainTarget.pVoice_L;
+	delete[] m_mainTarget.pVoice_R;
+	delete[] m_mainTarget.pStream_L;
+	delete[] m_mainTarget.pStream_R;
+
+	Sample::set_stream_preload( 0 );
+	Sample::set_packed_storage( 0 );
+	delete m_pSampleStreamer;
+	m_pSampleStreamer = nullptr;
+	delete m_pPlaybackTrackStretcher;
+	m_pPlaybackTrackStretcher = nullptr;
+
 	delete[] m_pMainOut_L;
 	delete[] m_pMainOut_R;
 
@@ -113,69 +243,626 @@ Sampler::~Sampler()
  */
 float const Sampler::K_NORM_DEFAULT = 1.33333333333333;
 
+/** Minimum number of voices for which the rendering is distributed
+	among the threads of the WorkerPool. Below, the overhead of waking
+	them exceeds the gain.*/
+static const int nMinParallelVoices = 8;
+
+/** Duration in ticks of the fade out applied to voices taken by the
+	voice stealing. About five milliseconds at 48kHz.*/
+static const unsigned nVoiceFadeOutTicks = 256;
+
+/** Envelope value below which a released voice is considered
+	inaudible and gets ended. About -90dB.*/
+static const float fQuietEnvelope = 0.00003f;
+
+/** Size of the pool of voices playing previews.*/
+static const int nPreviewVoices = 4;
+
+void Sampler::allocateWorkerTargets( int nTargets )
+{
+	m_workerTargets.resize( nTargets );
+	for ( auto& target : m_workerTargets ) {
+		target.pMainOut_L = new float[ MAX_BUFFER_SIZE ];
+		target.pMainOut_R = new float[ MAX_BUFFER_SIZE ];
+		target.pResampled_L = new float[ MAX_BUFFER_SIZE ];
+		target.pResampled_R = new float[ MAX_BUFFER_SIZE ];
+		target.pEnvelope = new float[ MAX_BUFFER_SIZE ];
+		target.pVoice_L = new float[ MAX_BUFFER_SIZE ];
+		target.pVoice_R = new float[ MAX_BUFFER_SIZE ];
+		target.pStream_L = new float[ nStreamWindowFrames ];
+		target.pStream_R = new float[ nStreamWindowFrames ];
+		target.bPreview = false;
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			target.pFXOut_L[ nFX ] = new float[ MAX_BUFFER_SIZE ];
+			target.pFXOut_R[ nFX ] = new float[ MAX_BUFFER_SIZE ];
+		}
+		for ( int nCompo = 0; nCompo < MAX_COMPONENTS; ++nCompo ) {
+			target.pComponentOut_L[ nCompo ] = Dsp::allocate( MAX_BUFFER_SIZE );
+			target.pComponentOut_R[ nCompo ] = Dsp::allocate( MAX_BUFFER_SIZE );
+		}
+	}
+}
+
+void Sampler::freeWorkerTargets()
+{
+	for ( auto& target : m_workerTargets ) {
+		delete[] target.pMainOut_L;
+		delete[] target.pMainOut_R;
+		delete[] target.pResampled_L;
+		delete[] target.pResampled_R;
+		delete[] target.pEnvelope;
+		delete[] target.pVoice_L;
+		delete[] target.pVoice_R;
+		delete[] target.pStream_L;
+		delete[] target.pStream_R;
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			delete[] target.pFXOut_L[ nFX ];
+			delete[] target.pFXOut_R[ nFX ];
+		}
+		for ( int nCompo = 0; nCompo < MAX_COMPONENTS; ++nCompo ) {
+			Dsp::release( target.pComponentOut_L[ nCompo ] );
+			Dsp::release( target.pComponentOut_R[ nCompo ] );
+		}
+	}
+	m_workerTargets.clear();
+}
+
+void Sampler::renderTask( int nTask, void* pArg )
+{
+	Sampler* pSampler = static_cast<Sampler*>( pArg );
+	RenderTarget* pTarget = &pSampler->m_workerTargets[ nTask ];
+	const uint32_t nFrames = pSampler->m_nRenderFrames;
+	const int nTasks = pSampler->m_workerTargets.size();
+	Song* pSong = pSampler->m_pRenderSong;
+
+	memset( pTarget->pMainOut_L, 0, nFrames * sizeof( float ) );
+	memset( pTarget->pMainOut_R, 0, nFrames * sizeof( float ) );
+	for ( int nFX = 0; nFX < pSampler->m_nRenderFX; ++nFX ) {
+		memset( pTarget->pFXOut_L[ nFX ], 0, nFrames * sizeof( float ) );
+		memset( pTarget->pFXOut_R[ nFX ], 0, nFrames * sizeof( float ) );
+	}
+	int nComponents = std::min( static_cast<int>( pSong->getComponents()->size() ),
+								MAX_COMPONENTS );
+	for ( int nCompo = 0; nCompo < nComponents; ++nCompo ) {
+		memset( pTarget->pComponentOut_L[ nCompo ], 0, nFrames * sizeof( float ) );
+		memset( pTarget->pComponentOut_R[ nCompo ], 0, nFrames * sizeof( float ) );
+	}
+
+	// All voices of an instrument are handled by the same task. This
+	// way both the instrument peaks and the per-track outputs are
+	// written by a single thread only. Instruments sharing a JACK
+	// output bus are kept together for the same reason.
+	const auto& playingNotes = pSampler->m_playingNotesQueue;
+	for ( unsigned ii = 0; ii < playingNotes.size(); ++ii ) {
+		Note* pNote = playingNotes[ ii ];
+		int nKey = pNote->get_instrument()->get_id();
+		if ( pSampler->m_pTrackOutDriver != nullptr ) {
+			int nBusTrack =
+				pSampler->m_pTrackOutDriver->getTrackOutputBus( pNote->get_instrument() );
+			if ( nBusTrack >= 0 ) {
+				nKey = MAX_INSTRUMENTS + nBusTrack;
+			}
+		}
+		if ( std::abs( nKey ) % nTasks != nTask ) {
+			continue;
+		}
+		int64_t nStart = rtclock_now_ns();
+		pSampler->m_voiceFinished[ ii ] =
+			pSampler->renderNote( pNote, nFrames, pSong, pTarget );
+		pNote->get_instrument()->add_render_time( rtclock_now_ns() - nStart );
+	}
+}
+
+void Sampler::mergeWorkerTargets( uint32_t nFrames, Song* pSong )
+{
+	const auto pComponents = pSong->getComponents();
+	int nComponents = std::min( static_cast<int>( pComponents->size() ),
+								MAX_COMPONENTS );
+
+	for ( const auto& target : m_workerTargets ) {
+		Dsp::add( m_pMainOut_L, target.pMainOut_L, nFrames );
+		Dsp::add( m_pMainOut_R, target.pMainOut_R, nFrames );
+
+		for ( int nFX = 0; nFX < m_nRenderFX; ++nFX ) {
+			float* pBuf_L = m_mainTarget.pFXOut_L[ nFX ];
+			float* pBuf_R = m_mainTarget.pFXOut_R[ nFX ];
+			if ( pBuf_L == nullptr || pBuf_R == nullptr ) {
+				continue;
+			}
+			Dsp::add( pBuf_L, target.pFXOut_L[ nFX ], nFrames );
+			Dsp::add( pBuf_R, target.pFXOut_R[ nFX ], nFrames );
+		}
+
+		for ( int nCompo = 0; nCompo < nComponents; ++nCompo ) {
+			DrumkitComponent* pCompo = (*pComponents)[ nCompo ];
+			Dsp::add( pCompo->get_out_buffer_L(), target.pComponentOut_L[ nCompo ], nFrames );
+			Dsp::add( pCompo->get_out_buffer_R(), target.pComponentOut_R[ nCompo ], nFrames );
+		}
+	}
+}
+
 void Sampler::process( uint32_t nFrames, Song* pSong )
 {
 	//infoLog( "[process]" );
+	Tracer::Scope trace( "Sampler::process" );
 	AudioOutput* pAudioOutpout = Hydrogen::get_instance()->getAudioOutput();
 	assert( pAudioOutpout );
 
 	memset( m_pMainOut_L, 0, nFrames * sizeof( float ) );
 	memset( m_pMainOut_R, 0, nFrames * sizeof( float ) );
 
+	// Has to be done before the voices are distributed among the
+	// worker threads.
+	updatePanLawTable( pSong );
+
 	// Track output queues are zeroed by
 	// audioEngine_process_clearAudioBuffers()
+	m_pTrackOutDriver = nullptr;
+	m_bRenderingStems = false;
+	m_bRenderingFreeze = false;
+#ifdef H2CORE_HAVE_JACK
+	if ( RealtimeConfig::get().bJackTrackOuts &&
+		 dynamic_cast<JackAudioDriver*>(pAudioOutpout) != nullptr ) {
+		m_pTrackOutDriver = pAudioOutpout;
+	}
+#endif
+	if ( pAudioOutpout->getTrackOutputs() != nullptr ) {
+		m_pTrackOutDriver = pAudioOutpout;
+	}
+	DiskWriterDriver* pDiskWriterDriver = dynamic_cast<DiskWriterDriver*>(pAudioOutpout);
+	if ( pDiskWriterDriver != nullptr && pDiskWriterDriver->hasStems() ) {
+		m_pTrackOutDriver = pAudioOutpout;
+		m_bRenderingStems = true;
+	}
+	OfflineDriver* pOfflineDriver = dynamic_cast<OfflineDriver*>(pAudioOutpout);
+	if ( pOfflineDriver != nullptr && pOfflineDriver->hasTracks() ) {
+		m_pTrackOutDriver = pAudioOutpout;
+		m_bRenderingFreeze = true;
+	}
 
-	// Max notes limit
-	int m_nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
-	while ( ( int )m_playingNotesQueue.size() > m_nMaxNotes ) {
-		Note * pOldNote = m_playingNotesQueue[ 0 ];
-		m_playingNotesQueue.erase( m_playingNotesQueue.begin() );
-		 pOldNote->get_instrument()->dequeue();
-		delete  pOldNote;	// FIXME: send note-off instead of removing the note from the list?
+	// Max notes limit. Instead of cutting them off, the voices in
+	// excess are faded out and end within the next cycles. Those
+	// already fading do not count, neither do the ones playing a
+	// frozen instrument.
+	const RealtimeConfig::Values& config = RealtimeConfig::get();
+	int nMaxNotes = config.nMaxNotes;
+	if ( m_bReducedVoices ) {
+		nMaxNotes = std::max( nMaxNotes / 2, 1 );
+	}
+	int nActiveNotes = 0;
+	for ( const auto& pNote: m_playingNotesQueue ) {
+		if ( ! pNote->get_adsr()->is_fading_out() &&
+			 pNote->get_frozen_pattern() == nullptr ) {
+			++nActiveNotes;
+		}
+	}
+	while ( nActiveNotes > nMaxNotes ) {
+		int nVoice = findVoiceToSteal( config.voiceStealing );
+		if ( nVoice < 0 ) {
+			break;
+		}
+		m_playingNotesQueue[ nVoice ]->get_adsr()->fade_out( nVoiceFadeOutTicks );
+		--nActiveNotes;
 	}
 
 	for ( auto& pComponent : *pSong->getComponents() ) {
-		pComponent->reset_outs(nFrames);
+		pComponent->reset_outs( nFrames );
+	}
+
+	m_nRenderFX = 0;
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		m_mainTarget.pFXOut_L[ nFX ] = nullptr;
+		m_mainTarget.pFXOut_R[ nFX ] = nullptr;
+#ifdef H2CORE_HAVE_LADSPA
+		LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX ) {
+			m_mainTarget.pFXOut_L[ nFX ] = pFX->m_pBuffer_L;
+			m_mainTarget.pFXOut_R[ nFX ] = pFX->m_pBuffer_R;
+			m_nRenderFX = nFX + 1;
+		}
+#endif
+	}
+
+	// Layers are selected while rendering the first cycle of a
+	// note, possibly by several worker threads at once.
+	for ( const auto& pPlayingNote : m_playingNotesQueue ) {
+		for ( const auto& pCompo : *pPlayingNote->get_instrument()->get_components() ) {
+			pCompo->update_layer_table();
+		}
 	}
 
-	// eseguo tutte le note nella lista di note in esecuzione
 	unsigned i = 0;
 	Note* pNote;
-	while ( i < m_playingNotesQueue.size() ) {
-		pNote = m_playingNotesQueue[ i ];		// recupero una nuova nota
-		if ( renderNote( pNote, nFrames, pSong ) ) {	// la nota e' finita
-			m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
-			pNote->get_instrument()->dequeue();
-			m_queuedNoteOffs.push_back( pNote );
-		} else {
-			++i; // carico la prox nota
+	if ( m_pWorkerPool != nullptr &&
+		 static_cast<int>( m_playingNotesQueue.size() ) >= nMinParallelVoices ) {
+		// Distribute the voices among the worker threads. Each of
+		// them renders into a private set of buffers merged
+		// afterwards.
+		m_voiceFinished.assign( m_playingNotesQueue.size(), 0 );
+		m_nRenderFrames = nFrames;
+		m_pRenderSong = pSong;
+		m_bRenderingParallel = true;
+
+		m_pWorkerPool->run( m_workerTargets.size(), &Sampler::renderTask, this );
+
+		m_bRenderingParallel = false;
+		mergeWorkerTargets( nFrames, pSong );
+
+		unsigned nRemaining = 0;
+		for ( i = 0; i < m_playingNotesQueue.size(); ++i ) {
+			pNote = m_playingNotesQueue[ i ];
+			if ( m_voiceFinished[ i ] ) {
+				unlinkVoice( pNote );
+				pNote->get_instrument()->dequeue();
+				m_queuedNoteOffs.push_back( pNote );
+			} else {
+				pNote->set_voice_index( nRemaining );
+				m_playingNotesQueue[ nRemaining ] = pNote;
+				++nRemaining;
+			}
+		}
+		m_playingNotesQueue.resize( nRemaining );
+	} else {
+		// eseguo tutte le note nella lista di note in esecuzione
+		while ( i < m_playingNotesQueue.size() ) {
+			pNote = m_playingNotesQueue[ i ];		// recupero una nuova nota
+			int64_t nStart = rtclock_now_ns();
+			bool bFinished = renderNote( pNote, nFrames, pSong, &m_mainTarget );
+			pNote->get_instrument()->add_render_time( rtclock_now_ns() - nStart );
+			if ( bFinished ) {	// la nota e' finita
+				// The voice swapped in will be rendered next.
+				removePlayingNote( i );
+				pNote->get_instrument()->dequeue();
+				m_queuedNoteOffs.push_back( pNote );
+			} else {
+				++i; // carico la prox nota
+			}
 		}
 	}
 
 	//Queue midi note off messages for notes that have a length specified for them
-	while ( !m_queuedNoteOffs.empty() ) {
-		pNote =  m_queuedNoteOffs[0];
-		MidiOutput* pMidiOut = Hydrogen::get_instance()->getMidiOutput();
-		
-		if( pMidiOut != nullptr && !pNote->get_instrument()->is_muted() ){
+	MidiOutput* pMidiOut = Hydrogen::get_instance()->getMidiOutput();
+	for ( const auto& pNote: m_queuedNoteOffs ) {
+		if( pMidiOut != nullptr && !pNote->get_instrument()->is_muted() &&
+			pNote->get_frozen_pattern() == nullptr && ! m_bRenderingFreeze ){
 			pMidiOut->handleQueueNoteOff(	pNote->get_instrument()->get_midi_out_channel(), 
 											pNote->get_midi_key(),
-											pNote->get_midi_velocity() );
+											pNote->get_midi_velocity(),
+											0 );
 		}
 		
-		m_queuedNoteOffs.erase( m_queuedNoteOffs.begin() );
-		
-		if( pNote != nullptr ){
+		releaseStreams( pNote );
+		delete pNote;
+	}
+	m_queuedNoteOffs.clear();
+
+	// Send all MIDI events of this cycle at once.
+	if ( pMidiOut != nullptr ) {
+		pMidiOut->flushQueuedEvents();
+	}
+
+	processInserts( nFrames, pSong );
+
+	processPlaybackTrack(nFrames);
+
+	processPreviews( nFrames, pSong, pAudioOutpout );
+}
+
+void Sampler::processPreviews( uint32_t nFrames, Song* pSong, AudioOutput* pAudioOutput )
+{
+	if ( m_previewNotes.empty() ) {
+		return;
+	}
+
+	float* pCue_L = pAudioOutput->getCueOut_L();
+	float* pCue_R = pAudioOutput->getCueOut_R();
+	if ( pCue_L != nullptr && pCue_R != nullptr ) {
+		m_previewTarget.pMainOut_L = pCue_L;
+		m_previewTarget.pMainOut_R = pCue_R;
+	} else {
+		m_previewTarget.pMainOut_L = m_pMainOut_L;
+		m_previewTarget.pMainOut_R = m_pMainOut_R;
+	}
+
+	unsigned ii = 0;
+	while ( ii < m_previewNotes.size() ) {
+		Note* pNote = m_previewNotes[ ii ];
+		if ( renderNote( pNote, nFrames, pSong, &m_previewTarget ) ) {
+			m_previewNotes.erase( m_previewNotes.begin() + ii );
+			pNote->get_instrument()->dequeue();
+			releaseStreams( pNote );
 			delete pNote;
+		} else {
+			++ii;
 		}
-		
-		pNote = nullptr;
-	}//while
+	}
+}
 
-	processPlaybackTrack(nFrames);
+void Sampler::processInserts( uint32_t nFrames, Song* pSong )
+{
+	for ( auto pCompo : *pSong->getComponents() ) {
+		InsertChain* pInsertChain = pCompo->get_insert_chain();
+		if ( ! pInsertChain->isActive() ) {
+			continue;
+		}
+
+		pInsertChain->process( nFrames );
+		Dsp::add( m_pMainOut_L, pCompo->get_out_buffer_L(), nFrames );
+		Dsp::add( m_pMainOut_R, pCompo->get_out_buffer_R(), nFrames );
+	}
+}
+
+
+
+void Sampler::addPlayingNote( Note* pNote )
+{
+	pNote->set_voice_index( m_playingNotesQueue.size() );
+	m_playingNotesQueue.push_back( pNote );
+	// A frozen pattern must not be cut by the notes of another
+	// instrument.
+	pNote->set_voice_mute_group( pNote->get_frozen_pattern() == nullptr ?
+								 pNote->get_instrument()->get_mute_group() : -1 );
+	linkVoice( pNote );
+}
+
+void Sampler::removePlayingNote( unsigned nIndex )
+{
+	Note* pNote = m_playingNotesQueue[ nIndex ];
+	m_playingNotesQueue[ nIndex ] = m_playingNotesQueue.back();
+	m_playingNotesQueue[ nIndex ]->set_voice_index( nIndex );
+	m_playingNotesQueue.pop_back();
+	unlinkVoice( pNote );
+}
+
+Note** Sampler::voiceListHead( Note* pNote, int nList )
+{
+	switch ( nList ) {
+	case Note::INSTRUMENT_VOICES:
+		return pNote->get_instrument()->get_voices();
+
+	case Note::MUTE_GROUP_VOICES: {
+		int nGroup = pNote->get_voice_mute_group();
+		if ( nGroup < 0 ) {
+			return nullptr;
+		}
+		if ( nGroup >= static_cast<int>( m_muteGroupVoices.size() ) ) {
+			m_muteGroupVoices.resize( nGroup + 1, nullptr );
+		}
+		return &m_muteGroupVoices[ nGroup ];
+	}
+
+	case Note::MIDI_KEY_VOICES: {
+		int nKey = pNote->get_midi_msg();
+		if ( nKey < 0 || nKey >= 128 ) {
+			return nullptr;
+		}
+		return &m_midiKeyVoices[ nKey ];
+	}
+	}
+	return nullptr;
+}
+
+void Sampler::linkVoice( Note* pNote )
+{
+	pNote->get_instrument()->add_render_voices( 1 );
+	for ( int nList = 0; nList < Note::VOICE_LISTS; ++nList ) {
+		Note** ppHead = voiceListHead( pNote, nList );
+		if ( ppHead == nullptr ) {
+			continue;
+		}
+		Note::VoiceLink& link = pNote->get_voice_link( nList );
+		link.pPrev = nullptr;
+		link.pNext = *ppHead;
+		if ( *ppHead != nullptr ) {
+			( *ppHead )->get_voice_link( nList ).pPrev = pNote;
+		}
+		*ppHead = pNote;
+	}
+}
+
+void Sampler::unlinkVoice( Note* pNote )
+{
+	pNote->get_instrument()->add_render_voices( -1 );
+	for ( int nList = 0; nList < Note::VOICE_LISTS; ++nList ) {
+		Note** ppHead = voiceListHead( pNote, nList );
+		if ( ppHead == nullptr ) {
+			continue;
+		}
+		Note::VoiceLink& link = pNote->get_voice_link( nList );
+		if ( link.pPrev != nullptr ) {
+			link.pPrev->get_voice_link( nList ).pNext = link.pNext;
+		} else {
+			*ppHead = link.pNext;
+		}
+		if ( link.pNext != nullptr ) {
+			link.pNext->get_voice_link( nList ).pPrev = link.pPrev;
+		}
+		link.pPrev = nullptr;
+		link.pNext = nullptr;
+	}
+	pNote->set_voice_index( -1 );
+}
+
+int Sampler::fetchSampleData( std::shared_ptr<Sample> pSample,
+							  SelectedLayerInfo* pSelectedLayerInfo,
+							  RenderTarget* pTarget, int nFirst, int nFrames,
+							  float** ppData_L, float** ppData_R, int* pDataFrames )
+{
+	if ( pSample->is_compact() || pSample->is_deferred() ) {
+		nFirst = std::max( nFirst, 0 );
+		int nLast = std::min( nFirst + std::min( nFrames, nStreamWindowFrames ),
+							  pSample->get_frames() );
+		int nWindow = std::max( nLast - nFirst, 0 );
+		pSample->read_frames( nFirst, nWindow, pTarget->pStream_L, pTarget->pStream_R );
+
+		*ppData_L = pTarget->pStream_L;
+		*ppData_R = pTarget->pStream_R;
+		*pDataFrames = nWindow;
+		return nFirst;
+	}
+
+	if ( ! pSample->is_streamed() ) {
+		*ppData_L = pSample->get_data_l();
+		*ppData_R = pSample->get_data_r();
+		*pDataFrames = pSample->get_frames();
+		return 0;
+	}
+
+	int nResident = pSample->get_resident_frames();
+	nFirst = std::max( nFirst, 0 );
+	int nLast = std::min( nFirst + std::min( nFrames, nStreamWindowFrames ),
+						  pSample->get_frames() );
+
+	// Open the stream right away, so the I/O thread can fetch the
+	// tail while the voice is still playing the resident head.
+	if ( pSelectedLayerInfo->Stream == -1 && m_pSampleStreamer != nullptr ) {
+		pSelectedLayerInfo->Stream =
+			m_pSampleStreamer->open( pSample, std::max( nFirst, nResident ) );
+	}
+
+	if ( nLast <= nResident ) {
+		*ppData_L = pSample->get_data_l();
+		*ppData_R = pSample->get_data_r();
+		*pDataFrames = nResident;
+		return 0;
+	}
+
+	float* pData_L = pTarget->pStream_L;
+	float* pData_R = pTarget->pStream_R;
+	int nHead = std::max( std::min( nResident, nLast ) - nFirst, 0 );
+	if ( nHead > 0 ) {
+		memcpy( pData_L, pSample->get_data_l() + nFirst, nHead * sizeof( float ) );
+		memcpy( pData_R, pSample->get_data_r() + nFirst, nHead * sizeof( float ) );
+	}
+
+	int nTailFirst = nFirst + nHead;
+	int nTailFrames = std::max( nLast - nTailFirst, 0 );
+	if ( m_pSampleStreamer != nullptr ) {
+		m_pSampleStreamer->read( pSelectedLayerInfo->Stream, nTailFirst, nTailFrames,
+								 pData_L + nHead, pData_R + nHead );
+		// Voices only move forward.
+		m_pSampleStreamer->discard( pSelectedLayerInfo->Stream, nTailFirst );
+	} else {
+		memset( pData_L + nHead, 0, nTailFrames * sizeof( float ) );
+		memset( pData_R + nHead, 0, nTailFrames * sizeof( float ) );
+	}
+
+	*ppData_L = pData_L;
+	*ppData_R = pData_R;
+	*pDataFrames = nLast - nFirst;
+	return nFirst;
+}
+
+void Sampler::releaseStreams( Note* pNote )
+{
+	if ( m_pSampleStreamer == nullptr ) {
+		return;
+	}
+	for ( int nCompo = 0; nCompo < MAX_COMPONENTS; ++nCompo ) {
+		SelectedLayerInfo* pSelectedLayerInfo = pNote->get_layer_selected( nCompo );
+		if ( pSelectedLayerInfo->Stream != -1 ) {
+			m_pSampleStreamer->close( pSelectedLayerInfo->Stream );
+			pSelectedLayerInfo->Stream = -1;
+		}
+	}
+}
+
+int Sampler::getStreamUnderruns() const
+{
+	if ( m_pSampleStreamer == nullptr ) {
+		return 0;
+	}
+	return m_pSampleStreamer->getUnderruns();
 }
 
+int Sampler::findVoiceToSteal( Preferences::VoiceStealing policy )
+{
+	// Since voices are removed by swapping in the last one, the
+	// queue is not ordered. The voice age is used instead.
+	int nOldest = -1;
+	int nNewest = -1;
+	int nOldestReleased = -1;
+	int nQuietest = -1;
+	float fMinLevel = 0;
+
+	for ( int ii = 0; ii < static_cast<int>( m_playingNotesQueue.size() ); ++ii ) {
+		Note* pNote = m_playingNotesQueue[ ii ];
+		ADSR* pADSR = pNote->get_adsr();
+		if ( pADSR->is_fading_out() || pNote->get_frozen_pattern() != nullptr ) {
+			continue;
+		}
+		uint64_t nAge = pNote->get_voice_age();
+
+		if ( nOldest == -1 ||
+			 nAge < m_playingNotesQueue[ nOldest ]->get_voice_age() ) {
+			nOldest = ii;
+		}
+		if ( nNewest == -1 ||
+			 nAge > m_playingNotesQueue[ nNewest ]->get_voice_age() ) {
+			nNewest = ii;
+		}
+		if ( pADSR->is_released() &&
+			 ( nOldestReleased == -1 ||
+			   nAge < m_playingNotesQueue[ nOldestReleased ]->get_voice_age() ) ) {
+			nOldestReleased = ii;
+		}
+
+		if ( policy == Preferences::VoiceStealing::quietest ) {
+			// A voice still attacking has a low envelope value but
+			// is about to get loud. Until it is released it is
+			// assumed to be at least at its sustain level.
+			float fEnvelope = pADSR->get_current_value();
+			if ( ! pADSR->is_released() ) {
+				fEnvelope = std::max( fEnvelope, pADSR->get_sustain() );
+			}
+			float fLevel = pNote->get_velocity() * fEnvelope *
+				pNote->get_instrument()->get_volume();
+			if ( nQuietest == -1 || fLevel < fMinLevel ) {
+				nQuietest = ii;
+				fMinLevel = fLevel;
+			}
+		}
+	}
+
+	switch ( policy ) {
+	case Preferences::VoiceStealing::quietest:
+		return nQuietest;
+
+	case Preferences::VoiceStealing::released:
+		if ( nOldestReleased != -1 ) {
+			return nOldestReleased;
+		}
+		return nOldest;
+
+	case Preferences::VoiceStealing::sameInstrument: {
+		if ( nNewest == -1 ) {
+			return -1;
+		}
+		Instrument* pInstr = m_playingNotesQueue[ nNewest ]->get_instrument();
+		int nCandidate = -1;
+		for ( int ii = 0; ii < static_cast<int>( m_playingNotesQueue.size() ); ++ii ) {
+			Note* pNote = m_playingNotesQueue[ ii ];
+			if ( ii == nNewest || pNote->get_instrument() != pInstr ||
+				 pNote->get_adsr()->is_fading_out() ) {
+				continue;
+			}
+			if ( nCandidate == -1 || pNote->get_voice_age() <
+				 m_playingNotesQueue[ nCandidate ]->get_voice_age() ) {
+				nCandidate = ii;
+			}
+		}
+		if ( nCandidate != -1 ) {
+			return nCandidate;
+		}
+		return nOldest;
+	}
 
+	case Preferences::VoiceStealing::oldest:
+	default:
+		return nOldest;
+	}
+}
 
 void Sampler::noteOn(Note *pNote )
 {
@@ -184,40 +871,44 @@ void Sampler::noteOn(Note *pNote )
 
 	pNote->get_adsr()->attack();
 	Instrument *pInstr = pNote->get_instrument();
+	bool bFrozen = pNote->get_frozen_pattern() != nullptr;
 
 	// mute group
 	int nMuteGrp = pInstr->get_mute_group();
-	if ( nMuteGrp != -1 ) {
-		// remove all notes using the same mute group
-		for ( const auto& pNote: m_playingNotesQueue ) {	// delete older note
-			if ( ( pNote->get_instrument() != pInstr )  && ( pNote->get_instrument()->get_mute_group() == nMuteGrp ) ) {
-				pNote->get_adsr()->release();
+	if ( nMuteGrp != -1 && nMuteGrp < static_cast<int>( m_muteGroupVoices.size() ) &&
+		 ! bFrozen ) {
+		// release all notes started in the same mute group
+		for ( Note* pVoice = m_muteGroupVoices[ nMuteGrp ]; pVoice != nullptr;
+			  pVoice = pVoice->get_voice_link( Note::MUTE_GROUP_VOICES ).pNext ) {
+			if ( pVoice->get_instrument() != pInstr ) {
+				pVoice->get_adsr()->release();
 			}
 		}
 	}
 
 	//note off notes
-	if( pNote->get_note_off() ){
-		for ( const auto& pNote: m_playingNotesQueue ) {
-			if ( ( pNote->get_instrument() == pInstr ) ) {
-				//ERRORLOG("note_off");
-				pNote->get_adsr()->release();
-			}
+	if( pNote->get_note_off() && ! bFrozen ){
+		for ( Note* pVoice = *pInstr->get_voices(); pVoice != nullptr;
+			  pVoice = pVoice->get_voice_link( Note::INSTRUMENT_VOICES ).pNext ) {
+			pVoice->get_adsr()->release();
 		}
 	}
 
 	pInstr->enqueue();
 	if( !pNote->get_note_off() ){
-		m_playingNotesQueue.push_back( pNote );
+		pNote->set_voice_age( ++m_nVoiceAge );
+		addPlayingNote( pNote );
 	}
 }
 
 void Sampler::midiKeyboardNoteOff( int key )
 {
-	for ( const auto& pNote: m_playingNotesQueue ) {
-		if ( ( pNote->get_midi_msg() == key) ) {
-			pNote->get_adsr()->release();
-		}
+	if ( key < 0 || key >= 128 ) {
+		return;
+	}
+	for ( Note* pVoice = m_midiKeyVoices[ key ]; pVoice != nullptr;
+		  pVoice = pVoice->get_voice_link( Note::MIDI_KEY_VOICES ).pNext ) {
+		pVoice->get_adsr()->release();
 	}
 }
 
@@ -227,11 +918,10 @@ void Sampler::midiKeyboardNoteOff( int key )
 void Sampler::noteOff(Note* pNote )
 {
 	Instrument *pInstr = pNote->get_instrument();
-	// find the notes using the same instrument, and release them
-	for ( const auto& pNote: m_playingNotesQueue ) {
-		if ( pNote->get_instrument() == pInstr ) {
-			pNote->get_adsr()->release();
-		}
+	// release the notes using the same instrument
+	for ( Note* pVoice = *pInstr->get_voices(); pVoice != nullptr;
+		  pVoice = pVoice->get_voice_link( Note::INSTRUMENT_VOICES ).pNext ) {
+		pVoice->get_adsr()->release();
 	}
 	
 	delete pNote;
@@ -368,8 +1058,7 @@ float Sampler::ratioConstKNormPanLaw( float fPan, float k) {
 }
 
 // function to direct the computation to the selected pan law.
-inline float Sampler::panLaw( float fPan, Song* pSong ) {
-	int nPanLawType = pSong->getPanLawType();
+float Sampler::computePanLaw( float fPan, int nPanLawType, float fKNorm ) {
 	if ( nPanLawType == RATIO_STRAIGHT_POLYGONAL ) {
 		return ratioStraightPolygonalPanLaw( fPan );
 	} else if ( nPanLawType == RATIO_CONST_POWER ) {
@@ -395,26 +1084,73 @@ inline float Sampler::panLaw( float fPan, Song* pSong ) {
 	} else if ( nPanLawType == QUADRATIC_CONST_SUM ) {
 		return quadraticConstSumPanLaw( fPan );
 	} else if ( nPanLawType == LINEAR_CONST_K_NORM ) {
-		return linearConstKNormPanLaw( fPan, pSong->getPanLawKNorm() );
+		return linearConstKNormPanLaw( fPan, fKNorm );
 	} else if ( nPanLawType == POLAR_CONST_K_NORM ) {
-		return polarConstKNormPanLaw( fPan, pSong->getPanLawKNorm() );
+		return polarConstKNormPanLaw( fPan, fKNorm );
 	} else if ( nPanLawType == RATIO_CONST_K_NORM ) {
-		return ratioConstKNormPanLaw( fPan, pSong->getPanLawKNorm() );
+		return ratioConstKNormPanLaw( fPan, fKNorm );
 	} else if ( nPanLawType == QUADRATIC_CONST_K_NORM ) {
-		return quadraticConstKNormPanLaw( fPan, pSong->getPanLawKNorm() );
+		return quadraticConstKNormPanLaw( fPan, fKNorm );
 	} else {
-		WARNINGLOG( "Unknown pan law type. Set default." );
-		pSong->setPanLawType( RATIO_STRAIGHT_POLYGONAL );
 		return ratioStraightPolygonalPanLaw( fPan );
 	}
 }
 
+void Sampler::updatePanLawTable( Song* pSong ) {
+	int nPanLawType = pSong->getPanLawType();
+	if ( nPanLawType < RATIO_STRAIGHT_POLYGONAL ||
+		 nPanLawType > QUADRATIC_CONST_K_NORM ) {
+		WARNINGLOG( "Unknown pan law type. Set default." );
+		nPanLawType = RATIO_STRAIGHT_POLYGONAL;
+		pSong->setPanLawType( nPanLawType );
+	}
+	const float fKNorm = pSong->getPanLawKNorm();
+
+	if ( nPanLawType == m_nPanLawType && fKNorm == m_fPanLawKNorm ) {
+		return;
+	}
+
+	for ( int ii = 0; ii <= PAN_LAW_TABLE_SIZE; ++ii ) {
+		float fPan = 2.0 * ii / PAN_LAW_TABLE_SIZE - 1.0;
+		m_panLawTable[ ii ] = computePanLaw( fPan, nPanLawType, fKNorm );
+	}
+
+	m_nPanLawType = nPanLawType;
+	m_fPanLawKNorm = fKNorm;
+	++m_nPanLawRevision;
+}
+
+inline float Sampler::panLaw( float fPan ) const {
+	float fPos = ( fPan + 1.0 ) * 0.5 * PAN_LAW_TABLE_SIZE;
+	if ( fPos <= 0 ) {
+		return m_panLawTable[ 0 ];
+	} else if ( fPos >= PAN_LAW_TABLE_SIZE ) {
+		return m_panLawTable[ PAN_LAW_TABLE_SIZE ];
+	}
+	int nPos = static_cast<int>( fPos );
+	float fFrac = fPos - nPos;
+	return m_panLawTable[ nPos ] +
+		fFrac * ( m_panLawTable[ nPos + 1 ] - m_panLawTable[ nPos ] );
+}
+
+inline float Sampler::pitchRatio( float fPitch ) const {
+	float fPos = ( fPitch + PITCH_RATIO_RANGE ) * PITCH_RATIO_STEPS;
+	if ( fPos < 0 || fPos >= 2 * PITCH_RATIO_RANGE * PITCH_RATIO_STEPS ) {
+		return pow( 1.0594630943593, ( double )fPitch );
+	}
+	int nPos = static_cast<int>( fPos );
+	float fFrac = fPos - nPos;
+	return m_pitchRatioTable[ nPos ] +
+		fFrac * ( m_pitchRatioTable[ nPos + 1 ] - m_pitchRatioTable[ nPos ] );
+}
+
+
 //------------------------------------------------------------------
 
 /// Render a note
 /// Return false: the note is not ended
 /// Return true: the note is ended
-bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
+bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong, RenderTarget* pTarget )
 {
 	//infoLog( "[renderNote] instr: " + pNote->getInstrument()->m_sName );
 	assert( pSong );
@@ -434,6 +1170,27 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 		ERRORLOG( "NULL instrument" );
 		return 1;
 	}
+	// All parameters read for every voice share a few cache lines.
+	const Instrument::RenderState& state = pInstr->get_render_state();
+	if ( m_bRenderingFreeze && ! state.bCurrentlyExported ) {
+		return true;
+	}
+
+	const Preferences::JackTrackOutputMode jackTrackOutputMode =
+		RealtimeConfig::get().jackTrackOutputMode;
+
+	// The remainder of a release tail is inaudible but its envelope
+	// and filter states would keep on decaying into denormals.
+	ADSR* pADSR = pNote->get_adsr();
+	if ( pADSR->is_released() && ! pADSR->is_idle() &&
+		 pADSR->get_current_value() < fQuietEnvelope ) {
+		AudioEngine::get_instance()->get_profiler()->countQuietVoice();
+		return true;
+	}
+
+	if ( pNote->get_frozen_pattern() != nullptr ) {
+		return renderFrozenNote( pNote, nBufferSize, nFramepos, pSong, pTarget );
+	}
 
 	// new instrument and note pan interaction--------------------------
 	// notePan moves the RESULTANT pan in a smaller pan range centered at instrumentPan
@@ -448,7 +1205,7 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 	* so the chain killed the signal if instrument and note pans were hard-sided to opposites sides!
 	*/
 	float fNotePan = getRatioPan( pNote->get_pan_l(), pNote->get_pan_r() );
-	float fInstrPan = getRatioPan( pInstr->get_pan_l(), pInstr->get_pan_r() );
+	float fInstrPan = getRatioPan( state.fPan_L, state.fPan_R );
 	
    /** Get the RESULTANT pan, following a "matryoshka" multi panning, like in this graphic:
     *
@@ -469,27 +1226,83 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 	*/
 	float fPan = fInstrPan + fNotePan * ( 1 - fabs( fInstrPan ) );
 	
-	// Pass fPan to the Pan Law
-	float fPan_L = panLaw( fPan, pSong );
-	float fPan_R = panLaw( -fPan, pSong );
+	// Pass fPan to the Pan Law. Its gains are cached by the note
+	// until either the pan or the pan law changes.
+	float fPan_L, fPan_R;
+	if ( ! pNote->get_pan_law_gains( fPan, m_nPanLawRevision, &fPan_L, &fPan_R ) ) {
+		fPan_L = panLaw( fPan );
+		fPan_R = panLaw( -fPan );
+		pNote->set_pan_law_gains( fPan, m_nPanLawRevision, fPan_L, fPan_R );
+	}
 	//---------------------------------------------------------
 
-	bool nReturnValues [pInstr->get_components()->size()];
-	
-	for(int i = 0; i < pInstr->get_components()->size(); i++){
-		nReturnValues[i] = false;
+	// Timing, gains, and envelope of the note are shared by all its
+	// components. They are set up once per block before the sample
+	// of each component is rendered by renderVoice().
+	int noteStartInFrames = static_cast<int>(
+		pAudioOutput->m_transport.frameAtTick( pNote->get_position() ) ) + pNote->get_humanize_delay();
+
+	int nInitialSilence = 0;
+	if ( noteStartInFrames > ( int ) nFramepos ) {	// scrivo silenzio prima dell'inizio della nota
+		nInitialSilence = noteStartInFrames - nFramepos;
+		if ( nInitialSilence > ( int ) nBufferSize ) {
+			int noteStartInFramesNoHumanize = static_cast<int>(
+				pAudioOutput->m_transport.frameAtTick( pNote->get_position() ) );
+			if ( noteStartInFramesNoHumanize > ( int )( nFramepos + nBufferSize ) ) {
+				// this note is not valid. it's in the future...let's skip it....
+				ERRORLOG( QString( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg(noteStartInFramesNoHumanize ) );
+				return true;
+			}
+			// delay note execution
+			return false;
+		}
 	}
-	
-	int nReturnValueIndex = 0;
-	int nAlreadySelectedLayer = -1;
+	const int nBlockFrames = nBufferSize - nInitialSilence;
+
+	bool isMutedForExport = (pHydrogen->getIsExportSessionActive() && !state.bCurrentlyExported);
+	bool isMutedBecauseOfSolo = (isAnyInstrumentSoloed() && !state.bSoloed);
+
+	/*
+	 *  Is instrument muted?
+	 *
+	 *  This can be the case either if: 
+	 *   - the song, instrument or component is muted 
+	 *   - if we're in an export session and we're doing per-instruments exports, 
+	 *       but this instrument is not currently being exported.
+	 *   - if at least one instrument is soloed (but not this instrument)
+	 */
+	const bool bNoteMuted = isMutedForExport || state.bMuted || pSong->getIsMuted() ||
+		isMutedBecauseOfSolo;
+
+	// Gains of the main output before the layer and the components
+	// are accounted.
+	float fNoteGain = state.fGain * state.fVolume;
+	if ( state.bApplyVelocity ) {
+		fNoteGain *= pNote->get_velocity();
+	}
+	const float fNoteGain_L = fNoteGain * fPan_L;
+	const float fNoteGain_R = fNoteGain * fPan_R;
+	const float fNotePitch = pNote->get_total_pitch();
 
-	for (const auto& pCompo : *pInstr->get_components()) {
-		nReturnValues[nReturnValueIndex] = false;
+	ComponentVoice voices[ MAX_COMPONENTS ];
+	int nVoices = 0;
+	int nAlreadySelectedLayer = -1;
+	bool bRelease = false;
+	bool bStarting = false;
+	// Components whose layers share the same pitch share the pitch
+	// ratio as well.
+	float fRatioLayerPitch = 0.0;
+	float fRatio = -1.0;
+
+	for (const auto& pCompo : *state.pComponents) {
 		DrumkitComponent* pMainCompo = nullptr;
 
 		if( pNote->get_specific_compo_id() != -1 && pNote->get_specific_compo_id() != pCompo->get_drumkit_componentID() ) {
 			continue;
 		}
+		if ( nVoices == MAX_COMPONENTS ) {
+			break;
+		}
 
 		if(		pInstr->is_preview_instrument()
 			||	pInstr->is_metronome_instrument()){
@@ -498,6 +1311,12 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 			int nComponentID = pCompo->get_drumkit_componentID();
 			if ( nComponentID >= 0 ) {
 				pMainCompo = pHydrogen->getSong()->getComponent( nComponentID );
+				if ( pMainCompo == nullptr ) {
+					// Notes of instruments replaced by a drumkit
+					// swapped in during playback might refer to
+					// components not present anymore.
+					pMainCompo = pHydrogen->getSong()->getComponents()->front();
+				}
 			} else {
 				/* Invalid component found. This is possible on loading older or broken song files. */
 				pMainCompo = pHydrogen->getSong()->getComponents()->front();
@@ -506,6 +1325,19 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 
 		assert(pMainCompo);
 
+		// Position of the component within the Song. Used to
+		// address the private component buffers of the worker
+		// threads.
+		int nComponentIdx = MAX_COMPONENTS;
+		int nSongCompoIdx = 0;
+		for ( const auto& pSongCompo : *pSong->getComponents() ) {
+			if ( pSongCompo == pMainCompo ) {
+				nComponentIdx = nSongCompoIdx;
+				break;
+			}
+			++nSongCompoIdx;
+		}
+
 		float fLayerGain = 1.0;
 		float fLayerPitch = 0.0;
 
@@ -516,7 +1348,6 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 		if ( !pSelectedLayer ) {
 			QString dummy = QString( "NULL Layer Information for instrument %1. Component: %2" ).arg( pInstr->get_name() ).arg( pCompo->get_drumkit_componentID() );
 			WARNINGLOG( dummy );
-			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
 
@@ -532,367 +1363,260 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, Song* pSong )
 			
 		}
 		else {
-			switch ( pInstr->sample_selection_alg() ) {
-				case Instrument::VELOCITY:
-					for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ) {
-						InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-						if ( pLayer == nullptr ) continue;
-
-						if ( ( pNote->get_velocity() >= pLayer->get_start_velocity() ) && ( pNote->get_velocity() <= pLayer->get_end_velocity() ) ) {
-							pSelectedLayer->SelectedLayer = nLayer;
-
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
-							break;
-						}
-					}
+			int nLayer = -1;
+			if ( state.sampleSelectionAlg != Instrument::VELOCITY &&
+				 nAlreadySelectedLayer != -1 &&
+				 pCompo->get_layer( nAlreadySelectedLayer ) != nullptr ) {
+				// Use the layer already chosen for another component
+				// of the note.
+				nLayer = nAlreadySelectedLayer;
+			} else {
+				// Holes between the velocity ranges of the layers are
+				// resolved by the table too.
+				int selectedLayers[ m_nMaxLayers ];
+				int nSelectedLayers = pCompo->select_layers( pNote->get_velocity(), selectedLayers );
+				if ( nSelectedLayers > 0 ) {
+					switch ( state.sampleSelectionAlg ) {
+					case Instrument::VELOCITY:
+						nLayer = selectedLayers[ 0 ];
+						break;
 
-					if ( !pSample ){
-						WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
-						// There are a small distance between the
-						// layers of the instruments the velocity of
-						// the pNote has fallen into. This can if the
-						// drumkits weren't written with enough care.
-						// To fix this rare problem, we have to search
-						// for the nearest layer and use its sample.
-						float shortestDistance = 1.0f;
-						int nearestLayer = -1;
-						for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ){
-							InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-							if ( pLayer == nullptr ) continue;
-							
-							if ( std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-								  abs( pLayer->get_start_velocity() - pNote->get_velocity() ) ) <
-							     shortestDistance ){
-								shortestDistance = std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-											abs( pLayer->get_start_velocity() - pNote->get_velocity() ) );
-								nearestLayer = nLayer;
-							}
-						}
+					case Instrument::RANDOM:
+						nLayer = selectedLayers[ rand() % nSelectedLayers ];
+						nAlreadySelectedLayer = nLayer;
+						break;
 
-						// Check whether the search was successful and assign the results.
-						if ( nearestLayer > -1 ){
-							InstrumentLayer *pLayer = pCompo->get_layer( nearestLayer );
-							pSelectedLayer->SelectedLayer = nearestLayer;
-						
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
+					case Instrument::ROUND_ROBIN: {
+						float fRoundRobinID = pInstr->get_id() * 10 +
+							pCompo->get_layer( selectedLayers[ nSelectedLayers - 1 ] )->get_start_velocity();
+						std::unique_lock<std::mutex> lock( m_sharedStateMutex, std::defer_lock );
+						if ( m_bRenderingParallel ) {
+							lock.lock();
 						}
-					}
-					break;
-
-				case Instrument::RANDOM:
-					if( nAlreadySelectedLayer != -1 ) {
-						InstrumentLayer *pLayer = pCompo->get_layer( nAlreadySelectedLayer );
-						if ( pLayer != nullptr ) {
-							pSelectedLayer->SelectedLayer = nAlreadySelectedLayer;
-
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
+						int nIndexToUse = pSong->getLatestRoundRobin( fRoundRobinID ) + 1;
+						if ( nIndexToUse > nSelectedLayers - 1 ) {
+							nIndexToUse = 0;
 						}
-					}
-					if( pSample == nullptr ) {
-						int __possibleIndex[ m_nMaxLayers ];
-						int __foundSamples = 0;
-						for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ) {
-							InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-							if ( pLayer == nullptr ) continue;
-
-							if ( ( pNote->get_velocity() >= pLayer->get_start_velocity() ) && ( pNote->get_velocity() <= pLayer->get_end_velocity() ) ) {
-								__possibleIndex[__foundSamples] = nLayer;
-								__foundSamples++;
-							}
+						pSong->setLatestRoundRobin( fRoundRobinID, nIndexToUse );
+						if ( lock.owns_lock() ) {
+							lock.unlock();
 						}
+						nLayer = selectedLayers[ nIndexToUse ];
+						nAlreadySelectedLayer = nLayer;
+						break;
+					}
+					}
+				}
+			}
 
-						
-
-						// In some instruments the start and end
-						// velocities of a layer are not set
-						// perfectly giving rise to some 'holes'.
-						// Occasionally the velocity of a note
-						// can fall into it causing the sampler
-						// to just skip it. Instead, we will search
-						// for the nearest sample and play this
-						// one instead.
-						if ( __foundSamples == 0 ){
-							WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
-							float shortestDistance = 1.0f;
-							int nearestLayer = -1;
-							for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ){
-								InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-								if ( pLayer == nullptr ) continue;
-								
-								if ( std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-									  abs( pLayer->get_start_velocity() - pNote->get_velocity() ) ) <
-								     shortestDistance ){
-									shortestDistance = std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-												abs( pLayer->get_start_velocity() - pNote->get_velocity() ) );
-									nearestLayer = nLayer;
-								}
-							}
-							// Check whether the search was
-							// successful and assign the
-							// results.
-							if ( nearestLayer > -1 ){
-								pSelectedLayer->SelectedLayer = nearestLayer;
-
-								// No loop needed in here.
-								// Since the note was in
-								// no layer in the first
-								// place, only one is
-								// sufficient.
-								__possibleIndex[__foundSamples] = nearestLayer;
-								__foundSamples++;
-							}
-						}
-
-						if( __foundSamples > 0 ) {
-							nAlreadySelectedLayer = __possibleIndex[rand() % __foundSamples];
-							pSelectedLayer->SelectedLayer = nAlreadySelectedLayer;
-
-							InstrumentLayer *pLayer = pCompo->get_layer( nAlreadySelectedLayer );
-
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
-						}
-					}
-					break;
-
-				case Instrument::ROUND_ROBIN:
-					if( nAlreadySelectedLayer != -1 ) {
-						InstrumentLayer *pLayer = pCompo->get_layer( nAlreadySelectedLayer );
-						if ( pLayer != nullptr ) {
-							pSelectedLayer->SelectedLayer = nAlreadySelectedLayer;
-
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
-						}
-					}
-					if( !pSample ) {
-						int __possibleIndex[ m_nMaxLayers ];
-						int __foundSamples = 0;
-						float __roundRobinID;
-						for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ) {
-							InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-							if ( pLayer == nullptr ) continue;
-
-							if ( ( pNote->get_velocity() >= pLayer->get_start_velocity() ) && ( pNote->get_velocity() <= pLayer->get_end_velocity() ) ) {
-								__possibleIndex[__foundSamples] = nLayer;
-								__roundRobinID = pLayer->get_start_velocity();
-								__foundSamples++;
-							}
-						}
-
-						// In some instruments the start and end
-						// velocities of a layer are not set
-						// perfectly giving rise to some 'holes'.
-						// Occasionally the velocity of a note
-						// can fall into it causing the sampler
-						// to just skip it. Instead, we will search
-						// for the nearest sample and play this
-						// one instead.
-						if ( __foundSamples == 0 ){
-							WARNINGLOG( "Velocity did fall into a hole between the instrument layers." );
-							float shortestDistance = 1.0f;
-							int nearestLayer = -1;
-							for ( unsigned nLayer = 0; nLayer < m_nMaxLayers; ++nLayer ){
-								InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
-								if ( pLayer == nullptr ) {
-									continue;
-								}
-								
-								
-								if ( std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-									  abs( pLayer->get_start_velocity() - pNote->get_velocity() ) ) <
-								     shortestDistance ){
-									shortestDistance = std::min( abs( pLayer->get_start_velocity() - pNote->get_velocity() ),
-												abs( pLayer->get_start_velocity() - pNote->get_velocity() ) );
-									nearestLayer = nLayer;
-								}
-							}
-							// Check whether the search was
-							// successful and assign the
-							// results.
-							if ( nearestLayer > -1 ){
-								InstrumentLayer *pLayer = pCompo->get_layer( nearestLayer );
-								pSelectedLayer->SelectedLayer = nearestLayer;
-
-								// No loop needed in here.
-								// Since the note was in
-								// no layer in the first
-								// place, only one is
-								// sufficient.
-								__possibleIndex[__foundSamples] = nearestLayer;
-								__roundRobinID = pLayer->get_start_velocity();
-								__foundSamples++;
-							}
-						}
-
-						if( __foundSamples > 0 ) {
-							__roundRobinID = pInstr->get_id() * 10 + __roundRobinID;
-							int p_indexToUse = pSong->getLatestRoundRobin(__roundRobinID)+1;
-							if( p_indexToUse > __foundSamples - 1) {
-								p_indexToUse = 0;
-							}
-
-							pSong->setLatestRoundRobin(__roundRobinID, p_indexToUse);
-							nAlreadySelectedLayer = __possibleIndex[p_indexToUse];
-
-							pSelectedLayer->SelectedLayer = nAlreadySelectedLayer;
+			if ( nLayer != -1 ) {
+				InstrumentLayer *pLayer = pCompo->get_layer( nLayer );
+				pSelectedLayer->SelectedLayer = nLayer;
 
-							InstrumentLayer *pLayer = pCompo->get_layer( nAlreadySelectedLayer );
-							pSample = pLayer->get_sample();
-							fLayerGain = pLayer->get_gain();
-							fLayerPitch = pLayer->get_pitch();
-						}
-					}
-					break;
+				pSample = pLayer->get_sample();
+				fLayerGain = pLayer->get_gain();
+				fLayerPitch = pLayer->get_pitch();
 			}
 		}
 		if ( !pSample ) {
 			QString dummy = QString( "NULL sample for instrument %1. Note velocity: %2" ).arg( pInstr->get_name() ).arg( pNote->get_velocity() );
 			WARNINGLOG( dummy );
-			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
 
 		if ( pSelectedLayer->SamplePosition >= pSample->get_frames() ) {
 			WARNINGLOG( "sample position out of bounds. The layer has been resized during note play?" );
-			nReturnValues[nReturnValueIndex] = true;
 			continue;
 		}
-
-		int noteStartInFrames = ( int ) ( pNote->get_position() * pAudioOutput->m_transport.m_fTickSize ) + pNote->get_humanize_delay();
-
-		int nInitialSilence = 0;
-		if ( noteStartInFrames > ( int ) nFramepos ) {	// scrivo silenzio prima dell'inizio della nota
-			nInitialSilence = noteStartInFrames - nFramepos;
-			int nFrames = nBufferSize - nInitialSilence;
-			if ( nFrames < 0 ) {
-				int noteStartInFramesNoHumanize = ( int )pNote->get_position() * pAudioOutput->m_transport.m_fTickSize;
-				if ( noteStartInFramesNoHumanize > ( int )( nFramepos + nBufferSize ) ) {
-					// this note is not valid. it's in the future...let's skip it....
-					ERRORLOG( QString( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg(noteStartInFramesNoHumanize ) );
-					//pNote->dumpInfo();
-					nReturnValues[nReturnValueIndex] = true;
-					continue;
-				}
-				// delay note execution
-				//INFOLOG( "Delaying note execution. noteStartInFrames: " + to_string( noteStartInFrames ) + ", nFramePos: " + to_string( nFramepos ) );
-				//return 0;
-				continue;
-			}
+		// The remainder of the sample is silent.
+		const int nAudibleEnd = pSample->get_audible_end();
+		if ( pSelectedLayer->SamplePosition >= nAudibleEnd ) {
+			continue;
 		}
+		pSample->mark_used();
+
+		ComponentVoice& voice = voices[ nVoices ];
+		voice.pSample = pSample;
+		voice.pSelectedLayerInfo = pSelectedLayer;
+		voice.pCompo = pCompo;
+		voice.pDrumCompo = pMainCompo;
+		voice.nComponentIdx = nComponentIdx;
 
 		float cost_L = 1.0f;
 		float cost_R = 1.0f;
 		float cost_track_L = 1.0f;
 		float cost_track_R = 1.0f;
 
-		assert(pMainCompo);
-		
-		bool isMutedForExport = (pHydrogen->getIsExportSessionActive() && !pInstr->is_currently_exported());
-		bool isMutedBecauseOfSolo = (isAnyInstrumentSoloed() && !pInstr->is_soloed());
-		
-		/*
-		 *  Is instrument muted?
-		 *
-		 *  This can be the case either if: 
-		 *   - the song, instrument or component is muted 
-		 *   - if we're in an export session and we're doing per-instruments exports, 
-		 *       but this instrument is not currently being exported.
-		 *   - if at least one instrument is soloed (but not this instrument)
-		 */
-		if ( isMutedForExport || pInstr->is_muted() || pSong->getIsMuted() || pMainCompo->is_muted() || isMutedBecauseOfSolo) {	
+		if ( bNoteMuted || pMainCompo->is_muted() ) {
 			cost_L = 0.0;
 			cost_R = 0.0;
-			if ( Preferences::get_instance()->m_JackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
+			if ( jackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
 				cost_track_L = 0.0;
 				cost_track_R = 0.0;
 			}
 
-		} else {	// Precompute some values...
-			if ( pInstr->get_apply_velocity() ) {
-				cost_L = cost_L * pNote->get_velocity();		// note velocity
-				cost_R = cost_R * pNote->get_velocity();		// note velocity
-			}
-
-
-			cost_L *= fPan_L;							// pan
-			cost_L = cost_L * fLayerGain;				// layer gain
-			cost_L = cost_L * pInstr->get_gain();		// instrument gain
-
-			cost_L = cost_L * pCompo->get_gain();		// Component gain
-			cost_L = cost_L * pMainCompo->get_volume(); // Component volument
-
-			cost_L = cost_L * pInstr->get_volume();		// instrument volume
-			if ( Preferences::get_instance()->m_JackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
+		} else {
+			const float fCompoGain = fLayerGain * pCompo->get_gain() * pMainCompo->get_volume();
+			cost_L = fNoteGain_L * fCompoGain;
+			cost_R = fNoteGain_R * fCompoGain;
+			if ( jackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
 				cost_track_L = cost_L * 2;
-			}
-			cost_L = cost_L * pSong->getVolume();	// song volume
-
-			cost_R *= fPan_R;							// pan
-			cost_R = cost_R * fLayerGain;				// layer gain
-			cost_R = cost_R * pInstr->get_gain();		// instrument gain
-
-			cost_R = cost_R * pCompo->get_gain();		// Component gain
-			cost_R = cost_R * pMainCompo->get_volume(); // Component volument
-
-			cost_R = cost_R * pInstr->get_volume();		// instrument volume
-			if ( Preferences::get_instance()->m_JackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
 				cost_track_R = cost_R * 2;
 			}
-			cost_R = cost_R * pSong->getVolume();	// song pan
+			cost_L = cost_L * pSong->getVolume();	// song volume
+			cost_R = cost_R * pSong->getVolume();
 		}
 
 		// direct track outputs only use velocity
-		if ( Preferences::get_instance()->m_JackTrackOutputMode == Preferences::JackTrackOutputMode::preFader ) {
+		if ( jackTrackOutputMode == Preferences::JackTrackOutputMode::preFader ) {
 			cost_track_L = cost_track_L * pNote->get_velocity();
 			cost_track_L = cost_track_L * fLayerGain;
 			cost_track_R = cost_track_L;
 		}
 
+		// Stems have to add up to the main output.
+		if ( m_bRenderingStems ) {
+			cost_track_L = cost_L;
+			cost_track_R = cost_R;
+		}
+
+		// Frozen renders are mixed like a layer of the instrument
+		// during playback.
+		if ( m_bRenderingFreeze ) {
+			float fGain = fLayerGain * state.fGain * pCompo->get_gain();
+			if ( state.bApplyVelocity ) {
+				fGain *= pNote->get_velocity();
+			}
+			cost_track_L = fGain * fPan_L;
+			cost_track_R = fGain * fPan_R;
+		}
+
+		voice.fGain_L = cost_L;
+		voice.fGain_R = cost_R;
+		voice.fTrackGain_L = cost_track_L;
+		voice.fTrackGain_R = cost_track_R;
+
 		// Se non devo fare resample (drumkit) posso evitare di utilizzare i float e gestire il tutto in
 		// maniera ottimizzata
 		//	constant^12 = 2, so constant = 2^(1/12) = 1.059463.
-		//	float nStep = 1.0;1.0594630943593
-
-		float fTotalPitch = pNote->get_total_pitch() + fLayerPitch;
+		float fTotalPitch = fNotePitch + fLayerPitch;
+		int nNoteLength = -1;
+		voice.bResample = fTotalPitch != 0.0 ||
+			pSample->get_sample_rate() != pAudioOutput->getSampleRate();
+		if ( voice.bResample ) {
+			if ( fRatio < 0 || fLayerPitch != fRatioLayerPitch ) {
+				fRatio = pitchRatio( fTotalPitch );
+				fRatioLayerPitch = fLayerPitch;
+			}
+			// Adjust for audio driver sample rate
+			voice.fStep = fRatio * ( float )pSample->get_sample_rate() / pAudioOutput->getSampleRate();
+			if ( pNote->get_length() != -1 ) {
+				float resampledTickSize = AudioEngine::compute_tick_size( pSample->get_sample_rate(),
+																		  pAudioOutput->m_transport.m_fBPM,
+																		  pSong->getResolution() );
+				nNoteLength = ( int )( pNote->get_length() * resampledTickSize );
+			}
+		} else {
+			voice.fStep = 1.0;
+			if ( pNote->get_length() != -1 ) {
+				nNoteLength = ( int )( pNote->get_length() * pAudioOutput->m_transport.m_fTickSize );
+			}
+		}
 
-		//_INFOLOG( "total pitch: " + to_string( fTotalPitch ) );
-		if( (int) pSelectedLayer->SamplePosition == 0  && !pInstr->is_muted() )
-		{
-			if( Hydrogen::get_instance()->getMidiOutput() != nullptr ){
-				Hydrogen::get_instance()->getMidiOutput()->handleQueueNote( pNote );
+		// Notes resumed after a relocation start at the position
+		// they would have reached by now.
+		if ( pNote->get_start_offset() > 0 && pSelectedLayer->SamplePosition == 0 ) {
+			pSelectedLayer->SamplePosition = pNote->get_start_offset() * voice.fStep;
+			if ( pSelectedLayer->SamplePosition >= nAudibleEnd ) {
+				continue;
 			}
 		}
+		if ( voice.bResample ) {
+			voice.nFrames = ( int )( ( float )( nAudibleEnd - pSelectedLayer->SamplePosition ) / voice.fStep );
+		} else {
+			voice.nFrames = nAudibleEnd - ( int )pSelectedLayer->SamplePosition;
+		}
+
+		// verifico il numero di frame disponibili ancora da eseguire
+		voice.bEnds = true;
+		if ( voice.nFrames > nBlockFrames ) {
+			voice.nFrames = nBlockFrames;
+			voice.bEnds = false;
+		}
 
-		if ( fTotalPitch == 0.0 && pSample->get_sample_rate() == pAudioOutput->getSampleRate() ) { // NO RESAMPLE
-			nReturnValues[nReturnValueIndex] = renderNoteNoResample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong );
+		// The sample position does not change within the block.
+		// Whether the note has to be released can thus be decided
+		// up front.
+		if ( nNoteLength != -1 && nNoteLength <= pSelectedLayer->SamplePosition ) {
+			bRelease = true;
 		}
-		else { // RESAMPLE
-			nReturnValues[nReturnValueIndex] = renderNoteResample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
+		if ( (int) pSelectedLayer->SamplePosition == 0 ) {
+			bStarting = true;
 		}
 
-		nReturnValueIndex++;
+		pInstr->add_render_frames( nBlockFrames, voice.bResample );
+		++nVoices;
 	}
-	for ( unsigned i = 0 ; i < pInstr->get_components()->size() ; i++ ) {
-		if ( !nReturnValues[i] ) {
-			return false;
+	// Applied to all components in the first block only.
+	pNote->set_start_offset( 0 );
+
+	if ( nVoices == 0 ) {
+		return true;
+	}
+
+	if ( bStarting && !state.bMuted ) {
+		if( Hydrogen::get_instance()->getMidiOutput() != nullptr && ! m_bRenderingFreeze ){
+			std::unique_lock<std::mutex> lock( m_sharedStateMutex, std::defer_lock );
+			if ( m_bRenderingParallel ) {
+				lock.lock();
+			}
+			Hydrogen::get_instance()->getMidiOutput()->handleQueueNote( pNote, nInitialSilence );
+		}
+		if ( pNote->get_trigger_time() > 0 ) {
+			AudioEngine::get_instance()->get_latency_probe()->recordTrigger(
+				pNote->get_trigger_time(),
+				static_cast<LatencyProbe::Source>( pNote->get_trigger_source() ),
+				nInitialSilence );
+			pNote->set_trigger( 0, LatencyProbe::SOURCE_NONE );
 		}
 	}
-	return true;
+
+	// The envelope is advanced once per block using the step of the
+	// first component. Each component reads as many values as it
+	// renders frames.
+	bool bEnded = false;
+	if ( bRelease && pADSR->release() == 0 ) {
+		bEnded = true;	// the note is ended
+	}
+	int nEnvelopeFrames = 0;
+	for ( int ii = 0; ii < nVoices; ++ii ) {
+		nEnvelopeFrames = std::max( nEnvelopeFrames, voices[ ii ].nFrames );
+	}
+	float* pEnvelope = pTarget->pEnvelope;
+	if ( nEnvelopeFrames > 0 ) {
+		pADSR->get_values( pEnvelope, nEnvelopeFrames, voices[ 0 ].fStep );
+	}
+	if ( pADSR->is_idle() ) {
+		// The envelope did end within the block, either due to the
+		// note length, a note off, a mute group, or voice stealing.
+		bEnded = true;
+	}
+
+	bool bFinished = true;
+	for ( int ii = 0; ii < nVoices; ++ii ) {
+		renderVoice( pNote, voices[ ii ], pTarget, nInitialSilence, pEnvelope, pSong );
+		if ( ! voices[ ii ].bEnds ) {
+			bFinished = false;
+		}
+	}
+	pNote->end_filter_block();
+
+	return bFinished || bEnded;
 }
 
 bool Sampler::processPlaybackTrack(int nBufferSize)
 {
 	Hydrogen* pEngine = Hydrogen::get_instance();
-	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
 	Song* pSong = pEngine->getSong();
 
 	if(   !pSong->getPlaybackTrackEnabled()
@@ -907,574 +1631,709 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 
 	assert(pSample);
 
-	float fVal_L;
-	float fVal_R;
-
-	auto pSample_data_L = pSample->get_data_l();
-	auto pSample_data_R = pSample->get_data_r();
-	
 	float fInstrPeak_L = m_pPlaybackTrackInstrument->get_peak_l(); // this value will be reset to 0 by the mixer..
 	float fInstrPeak_R = m_pPlaybackTrackInstrument->get_peak_r(); // this value will be reset to 0 by the mixer..
 
-	int nAvail_bytes = 0;
-	int	nInitialBufferPos = 0;
-
-	if(pSample->get_sample_rate() == pAudioOutput->getSampleRate()){
-		//No resampling	
-		m_nPlayBackSamplePosition = pAudioOutput->m_transport.m_nFrames;
-	
-		nAvail_bytes = pSample->get_frames() - ( int )m_nPlayBackSamplePosition;
-		
-		if ( nAvail_bytes > nBufferSize ) {
-			nAvail_bytes = nBufferSize;
-		}
-
-		int nInitialSamplePos = ( int ) m_nPlayBackSamplePosition;
-		int nSamplePos = nInitialSamplePos;
-	
-		int nTimes = nInitialBufferPos + nAvail_bytes;
-	
-		if(m_nPlayBackSamplePosition > pSample->get_frames()){
-			//playback track has ended..
-			return true;
-		}
-	
-		for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-			fVal_L = pSample_data_L[ nSamplePos ];
-			fVal_R = pSample_data_R[ nSamplePos ];
-	
-			fVal_L = fVal_L * 1.0f * pSong->getPlaybackTrackVolume(); //costr
-			fVal_R = fVal_R * 1.0f * pSong->getPlaybackTrackVolume(); //cost l
-	
-			//pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
-	
-			// to main mix
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
-			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
-			}
-			
-			m_pMainOut_L[nBufferPos] += fVal_L;
-			m_pMainOut_R[nBufferPos] += fVal_R;
-			
-			++nSamplePos;
-		}
+	float* pTrack_L;
+	float* pTrack_R;
+	int nAvail_bytes;
+	if ( m_pPlaybackTrackStretcher != nullptr && pSong->getPlaybackTrackBpm() > 0 ) {
+		nAvail_bytes = stretchPlaybackTrack( pSample, nBufferSize );
+		pTrack_L = m_mainTarget.pResampled_L;
+		pTrack_R = m_mainTarget.pResampled_R;
 	} else {
-		//Perform resampling
-		double	fSamplePos = 0;
-		int		nSampleFrames = pSample->get_frames();
-		float	fStep = 1;
-		fStep *= ( float )pSample->get_sample_rate() / pAudioOutput->getSampleRate(); // Adjust for audio driver sample rate
-		
-		
-		if(pAudioOutput->m_transport.m_nFrames == 0){
-			fSamplePos = 0;
-		} else {
-			fSamplePos = ( (pAudioOutput->m_transport.m_nFrames/nBufferSize) * (nBufferSize * fStep));
-		}
-		
-		nAvail_bytes = ( int )( ( float )( pSample->get_frames() - fSamplePos ) / fStep );
-	
-		if ( nAvail_bytes > nBufferSize ) {
-			nAvail_bytes = nBufferSize;
-		}
+		nAvail_bytes = fetchPlaybackTrack( pSample, nBufferSize, &pTrack_L, &pTrack_R );
+	}
 
-		int nTimes = nInitialBufferPos + nAvail_bytes;
-	
-		for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-			int nSamplePos = ( int ) fSamplePos;
-			double fDiff = fSamplePos - nSamplePos;
-			if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-				//we reach the last audioframe.
-				//set this last frame to zero do nothing wrong.
-							fVal_L = 0.0;
-							fVal_R = 0.0;
-			} else {
-				// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					} else {
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
-	
-					switch( m_interpolateMode ){
-	
-						case Interpolation::InterpolateMode::Linear:
-								fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-								fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-								break;
-						case Interpolation::InterpolateMode::Cosine:
-								fVal_L = Interpolation::cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								fVal_R = Interpolation::cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case Interpolation::InterpolateMode::Third:
-								fVal_L = Interpolation::third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case Interpolation::InterpolateMode::Cubic:
-								fVal_L = Interpolation::cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case Interpolation::InterpolateMode::Hermite:
-								fVal_L = Interpolation::hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-					}
-			}
-			
-			if ( fVal_L > fInstrPeak_L ) {
-				fInstrPeak_L = fVal_L;
-			}
-			if ( fVal_R > fInstrPeak_R ) {
-				fInstrPeak_R = fVal_R;
-			}
+	if ( nAvail_bytes < 0 ) {
+		//playback track has ended..
+		return true;
+	}
 
-			m_pMainOut_L[nBufferPos] += fVal_L;
-			m_pMainOut_R[nBufferPos] += fVal_R;
+	float fVolume = pSong->getPlaybackTrackVolume();
+	for ( int nBufferPos = 0; nBufferPos < nAvail_bytes; ++nBufferPos ) {
+		float fVal_L = pTrack_L[ nBufferPos ] * fVolume;
+		float fVal_R = pTrack_R[ nBufferPos ] * fVolume;
 
+		if ( fVal_L > fInstrPeak_L ) {
+			fInstrPeak_L = fVal_L;
+		}
+		if ( fVal_R > fInstrPeak_R ) {
+			fInstrPeak_R = fVal_R;
+		}
 
-			fSamplePos += fStep;
-		} //for
+		m_pMainOut_L[nBufferPos] += fVal_L;
+		m_pMainOut_R[nBufferPos] += fVal_R;
 	}
-	
+
 	m_pPlaybackTrackInstrument->set_peak_l( fInstrPeak_L );
 	m_pPlaybackTrackInstrument->set_peak_r( fInstrPeak_R );
 
 	return true;
 }
 
-bool Sampler::renderNoteNoResample(
-	std::shared_ptr<Sample> pSample,
-	Note *pNote,
-	SelectedLayerInfo *pSelectedLayerInfo,
-	InstrumentComponent *pCompo,
-	DrumkitComponent *pDrumCompo,
-	int nBufferSize,
-	int nInitialSilence,
-	float cost_L,
-	float cost_R,
-	float cost_track_L,
-	float cost_track_R,
-	Song* pSong
-)
+int Sampler::fetchPlaybackTrack( std::shared_ptr<Sample> pSample, int nBufferSize,
+								 float** ppTrack_L, float** ppTrack_R )
 {
-	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
-	bool retValue = true; // the note is ended
+	Hydrogen* pEngine = Hydrogen::get_instance();
+	AudioOutput* pAudioOutput = pEngine->getAudioOutput();
 
-	int nNoteLength = -1;
-	if ( pNote->get_length() != -1 ) {
-		nNoteLength = ( int )( pNote->get_length() * pAudioOutput->m_transport.m_fTickSize );
+	// The tempo of the track was reset.
+	if ( m_pPlaybackTrackStretcher != nullptr ) {
+		m_pPlaybackTrackStretcher->stop();
 	}
 
-	int nAvail_bytes = pSample->get_frames() - ( int )pSelectedLayerInfo->SamplePosition;	// verifico il numero di frame disponibili ancora da eseguire
+	bool bResample = pSample->get_sample_rate() != pAudioOutput->getSampleRate();
+	double fStep = ( double )pSample->get_sample_rate() / pAudioOutput->getSampleRate(); // Adjust for audio driver sample rate
+	double fSamplePos = pAudioOutput->m_transport.m_nFrames * fStep;
 
-	if ( nAvail_bytes > nBufferSize - nInitialSilence ) {	// il sample e' piu' grande del buffersize
-		// imposto il numero dei bytes disponibili uguale al buffersize
-		nAvail_bytes = nBufferSize - nInitialSilence;
-		retValue = false; // the note is not ended yet
+	if ( fSamplePos > pSample->get_frames() ) {
+		return -1;
 	}
 
+	int nAvail_bytes = std::min( ( int )( ( pSample->get_frames() - fSamplePos ) / fStep ),
+								 nBufferSize );
+
+	// Frames accessed by the interpolation on either side of the
+	// block, see renderVoice().
+	int nFirstFrame = ( int )fSamplePos;
+	int nLastFrame = nFirstFrame + nAvail_bytes;
+	if ( bResample ) {
+		nFirstFrame = std::max( nFirstFrame - Interpolation::frames_before( m_interpolateMode ), 0 );
+		nLastFrame = ( int )( fSamplePos + nAvail_bytes * fStep ) +
+			Interpolation::frames_after( m_interpolateMode ) + 1;
+	}
 
-	//ADSR *pADSR = pNote->m_pADSR;
+	// The transport was relocated without passing
+	// seekPlaybackTrack(), e.g. by the JACK server. Streams do only
+	// move forward.
+	if ( m_nPlaybackTrackStream != -1 &&
+		 ( nFirstFrame < m_nPlayBackSamplePosition ||
+		   nFirstFrame > m_nPlayBackSamplePosition + nStreamWindowFrames ) ) {
+		m_pSampleStreamer->close( m_nPlaybackTrackStream );
+		m_nPlaybackTrackStream = -1;
+	}
+	m_nPlayBackSamplePosition = nFirstFrame;
 
-	int nInitialBufferPos = nInitialSilence;
-	int nInitialSamplePos = ( int )pSelectedLayerInfo->SamplePosition;
-	int nSamplePos = nInitialSamplePos;
-	int nTimes = nInitialBufferPos + nAvail_bytes;
+	if ( pSample->is_streamed() && m_pSampleStreamer != nullptr ) {
+		if ( m_nPlaybackTrackStream == -1 ) {
+			m_nPlaybackTrackStream =
+				m_pSampleStreamer->open( pSample, std::max( m_nPlayBackSamplePosition,
+															pSample->get_resident_frames() ) );
+		}
+		// Exporting does not happen in realtime and would outpace
+		// the I/O thread.
+		if ( pEngine->getIsExportSessionActive() ) {
+			m_pSampleStreamer->wait( m_nPlaybackTrackStream, nLastFrame );
+		}
+	}
 
-	auto pSample_data_L = pSample->get_data_l();
-	auto pSample_data_R = pSample->get_data_r();
+	SelectedLayerInfo streamInfo;
+	streamInfo.Stream = m_nPlaybackTrackStream;
+	float* pSample_data_L;
+	float* pSample_data_R;
+	int nSampleFrames;
+	int nDataOffset = fetchSampleData( pSample, &streamInfo, &m_mainTarget,
+									   nFirstFrame, nLastFrame - nFirstFrame,
+									   &pSample_data_L, &pSample_data_R, &nSampleFrames );
+	m_nPlaybackTrackStream = streamInfo.Stream;
+
+	if ( bResample ) {
+		*ppTrack_L = m_mainTarget.pResampled_L;
+		*ppTrack_R = m_mainTarget.pResampled_R;
+		if ( nAvail_bytes > 0 ) {
+			Interpolation::resample_stereo( m_interpolateMode, pSample_data_L, pSample_data_R,
+											nSampleFrames, fSamplePos - nDataOffset, fStep,
+											*ppTrack_L, *ppTrack_R, nAvail_bytes );
+		}
+	} else {
+		*ppTrack_L = pSample_data_L + ( nFirstFrame - nDataOffset );
+		*ppTrack_R = pSample_data_R + ( nFirstFrame - nDataOffset );
+		nAvail_bytes = std::min( nAvail_bytes, nDataOffset + nSampleFrames - nFirstFrame );
+	}
 
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
+	return nAvail_bytes;
+}
 
-	float fADSRValue;
-	float fVal_L;
-	float fVal_R;
+int Sampler::stretchPlaybackTrack( std::shared_ptr<Sample> pSample, int nBufferSize )
+{
+	Hydrogen* pEngine = Hydrogen::get_instance();
+	AudioOutput* pAudioOutput = pEngine->getAudioOutput();
+	Song* pSong = pEngine->getSong();
+	PlaybackTrackStretcher* pStretcher = m_pPlaybackTrackStretcher;
 
+	// The stretcher reads the file on its own.
+	if ( m_nPlaybackTrackStream != -1 ) {
+		m_pSampleStreamer->close( m_nPlaybackTrackStream );
+		m_nPlaybackTrackStream = -1;
+	}
 
-#ifdef H2CORE_HAVE_JACK
-	float *		pTrackOutL = nullptr;
-	float *		pTrackOutR = nullptr;
+	// Frames of the track per tick at the tempo it was recorded in.
+	double fTickSize = pAudioOutput->m_transport.m_fTickSize;
+	double fTrackTickSize = AudioEngine::compute_tick_size( pSample->get_sample_rate(),
+															pSong->getPlaybackTrackBpm(),
+															pSong->getResolution() );
+	if ( fTickSize <= 0 || fTrackTickSize <= 0 ) {
+		return 0;
+	}
 
-	if ( Preferences::get_instance()->m_bJackTrackOuts ) {
-		auto pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput);
-		if( pJackAudioDriver ) {
-			pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
-			pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
-		}
+	double fSourcePos = pAudioOutput->m_transport.m_nFrames / fTickSize * fTrackTickSize;
+	if ( fSourcePos > pSample->get_frames() ) {
+		pStretcher->stop();
+		return -1;
 	}
-#endif
 
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = true;	// the note is ended
-			}
+	double fTimeRatio = fTickSize / fTrackTickSize;
+
+	// A different track was loaded or the transport was relocated.
+	double fError = 0;
+	if ( pStretcher->getSample() != pSample.get() ) {
+		pStretcher->stop();
+	} else if ( pStretcher->isRunning() ) {
+		fError = fSourcePos - pStretcher->getSourcePosition();
+		if ( std::abs( fError ) > fStretchResyncSeconds * pSample->get_sample_rate() ) {
+			pStretcher->stop();
 		}
+	}
 
-		fADSRValue = pNote->get_adsr()->get_value( 1 );
-		fVal_L = pSample_data_L[ nSamplePos ] * fADSRValue;
-		fVal_R = pSample_data_R[ nSamplePos ] * fADSRValue;
+	// Exporting does not happen in realtime and would outpace the
+	// background thread.
+	bool bExporting = pEngine->getIsExportSessionActive();
+	if ( bExporting ) {
+		pStretcher->waitForStop();
+	}
 
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
+	if ( pStretcher->isIdle() ) {
+		// The pitch change caused by a differing rate of the audio
+		// driver is compensated by the stretcher as well.
+		pStretcher->start( pSample, static_cast<int>( fSourcePos ), fTimeRatio,
+						   static_cast<double>( pSample->get_sample_rate() ) /
+						   pAudioOutput->getSampleRate() );
+		fError = 0;
+	}
 
-#ifdef H2CORE_HAVE_JACK
-		if(  pTrackOutL ) {
-			 pTrackOutL[nBufferPos] += fVal_L * cost_track_L;
-		}
-		if( pTrackOutR ) {
-			pTrackOutR[nBufferPos] += fVal_R * cost_track_R;
-		}
-#endif
+	// Pull the track towards the transport position. Catches up on
+	// the frames stretched ahead using the previous ratio after a
+	// tempo change.
+	double fCorrection = std::clamp( fError / pSample->get_sample_rate(),
+									 -fMaxStretchCorrection, fMaxStretchCorrection );
+	pStretcher->setTimeRatio( fTimeRatio / ( 1 + fCorrection ) );
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+	if ( bExporting ) {
+		pStretcher->wait( nBufferSize );
+	}
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
-		}
+	return pStretcher->read( m_mainTarget.pResampled_L, m_mainTarget.pResampled_R,
+							 nBufferSize );
+}
 
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
+/** Output buffers of a voice, already offset to its first frame.*/
+struct VoiceOutputs {
+	float* pMain_L;
+	float* pMain_R;
+	float* pComponent_L;
+	float* pComponent_R;
+	float* pTrack_L;
+	float* pTrack_R;
+};
 
-		// to main mix
-		m_pMainOut_L[nBufferPos] += fVal_L;
-		m_pMainOut_R[nBufferPos] += fVal_R;
+/**
+ * Gains a voice is mixed with during a block. Frame ii uses the
+ * start gain plus (ii + 1) steps.
+ */
+struct VoiceGains {
+	float fMain_L;
+	float fMain_R;
+	float fTrack_L;
+	float fTrack_R;
+	float fMainStep_L;
+	float fMainStep_R;
+	float fTrackStep_L;
+	float fTrackStep_R;
+};
 
-		++nSamplePos;
+/**
+ * Ramps the gains of a voice linearly from the ones it ended its
+ * previous block with to the current ones.
+ *
+ * Volume, pan, and mute of the instrument, its components, and the
+ * song are picked up once per process cycle. Applying a change
+ * instantaneously at the start of a block would be audible as a
+ * zipper noise. Stores the current gains in @a pInfo for the next
+ * block.
+ */
+static VoiceGains rampVoiceGains( SelectedLayerInfo* pInfo, int nFrames,
+								  float fGain_L, float fGain_R,
+								  float fTrackGain_L, float fTrackGain_R )
+{
+	VoiceGains gains;
+	if ( pInfo->Gain_L < 0 || nFrames <= 0 ) {
+		// First block of the note.
+		gains.fMain_L = fGain_L;
+		gains.fMain_R = fGain_R;
+		gains.fTrack_L = fTrackGain_L;
+		gains.fTrack_R = fTrackGain_R;
+	} else {
+		gains.fMain_L = pInfo->Gain_L;
+		gains.fMain_R = pInfo->Gain_R;
+		gains.fTrack_L = pInfo->TrackGain_L;
+		gains.fTrack_R = pInfo->TrackGain_R;
 	}
-	pSelectedLayerInfo->SamplePosition += nAvail_bytes;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
 
+	if ( nFrames > 0 ) {
+		gains.fMainStep_L = ( fGain_L - gains.fMain_L ) / nFrames;
+		gains.fMainStep_R = ( fGain_R - gains.fMain_R ) / nFrames;
+		gains.fTrackStep_L = ( fTrackGain_L - gains.fTrack_L ) / nFrames;
+		gains.fTrackStep_R = ( fTrackGain_R - gains.fTrack_R ) / nFrames;
 
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->getIsMuted() ) return retValue;
-	float masterVol =  pSong->getVolume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		pInfo->Gain_L = fGain_L;
+		pInfo->Gain_R = fGain_R;
+		pInfo->TrackGain_L = fTrackGain_L;
+		pInfo->TrackGain_R = fTrackGain_R;
+	} else {
+		gains.fMainStep_L = 0;
+		gains.fMainStep_R = 0;
+		gains.fTrackStep_L = 0;
+		gains.fTrackStep_R = 0;
+	}
 
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
+	return gains;
+}
 
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
+/**
+ * Adds the enveloped and filtered frames of a voice to its outputs.
+ *
+ * Which of the optional outputs are present is a template parameter,
+ * so each specialization is a loop without any branches.
+ */
+template <bool bTrackOuts, bool bComponentOuts>
+static void mixVoice( const float* pVoice_L, const float* pVoice_R, int nFrames,
+					  const VoiceGains& gains,
+					  const VoiceOutputs& outputs,
+					  float* pPeak_L, float* pPeak_R )
+{
+	float* pMain_L = outputs.pMain_L;
+	float* pMain_R = outputs.pMain_R;
+	float* pComponent_L = outputs.pComponent_L;
+	float* pComponent_R = outputs.pComponent_R;
+	float* pTrack_L = outputs.pTrack_L;
+	float* pTrack_R = outputs.pTrack_R;
+	float fPeak_L = *pPeak_L;
+	float fPeak_R = *pPeak_R;
+
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		const float fSteps = static_cast<float>( ii + 1 );
+		if ( bTrackOuts ) {
+			pTrack_L[ ii ] += pVoice_L[ ii ] * ( gains.fTrack_L + gains.fTrackStep_L * fSteps );
+			pTrack_R[ ii ] += pVoice_R[ ii ] * ( gains.fTrack_R + gains.fTrackStep_R * fSteps );
+		}
 
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
+		float fVal_L = pVoice_L[ ii ] * ( gains.fMain_L + gains.fMainStep_L * fSteps );
+		float fVal_R = pVoice_R[ ii ] * ( gains.fMain_R + gains.fMainStep_R * fSteps );
 
-			int nBufferPos = nInitialBufferPos;
-			int nSamplePos = nInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				pBuf_L[ nBufferPos ] += pSample_data_L[ nSamplePos ] * fFXCost_L;
-				pBuf_R[ nBufferPos ] += pSample_data_R[ nSamplePos ] * fFXCost_R;
-				++nSamplePos;
-				++nBufferPos;
-			}
+		fPeak_L = std::max( fPeak_L, fVal_L );
+		fPeak_R = std::max( fPeak_R, fVal_R );
+
+		if ( bComponentOuts ) {
+			pComponent_L[ ii ] += fVal_L;
+			pComponent_R[ ii ] += fVal_R;
 		}
+
+		pMain_L[ ii ] += fVal_L;
+		pMain_R[ ii ] += fVal_R;
 	}
-	// ~LADSPA
-#endif
 
-	return retValue;
+	*pPeak_L = fPeak_L;
+	*pPeak_R = fPeak_R;
 }
 
+typedef void (*MixVoiceFunc)( const float*, const float*, int, const VoiceGains&,
+							  const VoiceOutputs&, float*, float* );
 
+/** Specializations of mixVoice() indexed by the presence of track and
+	component outputs.*/
+static const MixVoiceFunc mixVoiceKernels[ 2 ][ 2 ] = {
+	{ mixVoice<false, false>, mixVoice<false, true> },
+	{ mixVoice<true, false>, mixVoice<true, true> }
+};
 
-bool Sampler::renderNoteResample(
-	std::shared_ptr<Sample> pSample,
-	Note *pNote,
-	SelectedLayerInfo *pSelectedLayerInfo,
-	InstrumentComponent *pCompo,
-	DrumkitComponent *pDrumCompo,
-	int nBufferSize,
-	int nInitialSilence,
-	float cost_L,
-	float cost_R,
-	float cost_track_L,
-	float cost_track_R,
-	float fLayerPitch,
-	Song* pSong
-)
+static inline MixVoiceFunc mixVoiceKernel( bool bTrackOuts, bool bComponentOuts )
 {
-	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	return mixVoiceKernels[ bTrackOuts ? 1 : 0 ][ bComponentOuts ? 1 : 0 ];
+}
 
-	int nNoteLength = -1;
-	if ( pNote->get_length() != -1 ) {
-		float resampledTickSize = AudioEngine::compute_tick_size( pSample->get_sample_rate(),
-		                                                          pAudioOutput->m_transport.m_fBPM,
-		                                                          pSong->getResolution() );
-		
-		nNoteLength = ( int )( pNote->get_length() * resampledTickSize);
+void Sampler::renderVoice( Note* pNote, const ComponentVoice& voice, RenderTarget* pTarget,
+						   int nInitialSilence, const float* pEnvelope, Song* pSong )
+{
+	Instrument* pInstr = pNote->get_instrument();
+	SelectedLayerInfo* pSelectedLayerInfo = voice.pSelectedLayerInfo;
+	const int nFrames = voice.nFrames;
+	const double fSamplePos = pSelectedLayerInfo->SamplePosition;
+
+	// Instruments asking for it are rendered using the windowed
+	// sinc regardless of the global mode.
+	Interpolation::InterpolateMode interpolateMode = m_interpolateMode;
+	if ( pInstr->get_sinc_interpolation() ) {
+		interpolateMode = Interpolation::InterpolateMode::Sinc;
+	}
+	if ( m_bForceLinearInterpolation ) {
+		interpolateMode = Interpolation::InterpolateMode::Linear;
 	}
-	float fNotePitch = pNote->get_total_pitch() + fLayerPitch;
 
-	float fStep = pow( 1.0594630943593, ( double )fNotePitch );
-//	_ERRORLOG( QString("pitch: %1, step: %2" ).arg(fNotePitch).arg( fStep) );
-	fStep *= ( float )pSample->get_sample_rate() / pAudioOutput->getSampleRate(); // Adjust for audio driver sample rate
+	// Blocks not reaching beyond the silent head of the sample do
+	// only advance the position. Streamed samples are fetched
+	// regardless to open their stream in time.
+	if ( ! voice.pSample->is_streamed() &&
+		 static_cast<int>( fSamplePos + nFrames * voice.fStep ) +
+		 Interpolation::frames_after( interpolateMode ) + 1 < voice.pSample->get_audible_start() ) {
+		rampVoiceGains( pSelectedLayerInfo, nFrames, voice.fGain_L, voice.fGain_R,
+						voice.fTrackGain_L, voice.fTrackGain_R );
+		pSelectedLayerInfo->SamplePosition += nFrames * voice.fStep;
+		return;
+	}
 
-	// verifico il numero di frame disponibili ancora da eseguire
-	int nAvail_bytes = ( int )( ( float )( pSample->get_frames() - pSelectedLayerInfo->SamplePosition ) / fStep );
+	// Frames of the sample covered by the block. They are either
+	// read from the sample directly or interpolated into the scratch
+	// buffers of @a pTarget and kept untouched for the LADSPA sends
+	// below.
+	const float* pSource_L;
+	const float* pSource_R;
+	float* pSample_data_L;
+	float* pSample_data_R;
+	int nDataFrames;
+	if ( ! voice.bResample ) {
+		int nFirstFrame = ( int )fSamplePos;
+		int nDataOffset = fetchSampleData( voice.pSample, pSelectedLayerInfo, pTarget,
+										   nFirstFrame, nFrames,
+										   &pSample_data_L, &pSample_data_R, &nDataFrames );
+		pSource_L = pSample_data_L + nFirstFrame - nDataOffset;
+		pSource_R = pSample_data_R + nFirstFrame - nDataOffset;
+	} else {
+		// Fetch the frames the interpolation accesses on either side
+		// of the positions covered by the block. One more is added to
+		// account for rounding in the accumulation of the step.
+		int nFirstFrame = static_cast<int>( fSamplePos ) -
+			Interpolation::frames_before( interpolateMode );
+		int nLastFrame = static_cast<int>( fSamplePos + nFrames * voice.fStep ) +
+			Interpolation::frames_after( interpolateMode ) + 1;
+		int nDataOffset = fetchSampleData( voice.pSample, pSelectedLayerInfo, pTarget,
+										   nFirstFrame, nLastFrame - nFirstFrame,
+										   &pSample_data_L, &pSample_data_R, &nDataFrames );
+
+		// Interpolate the whole block at once.
+		if ( nFrames > 0 ) {
+			Interpolation::resample_stereo( interpolateMode, pSample_data_L, pSample_data_R,
+											nDataFrames, fSamplePos - nDataOffset, voice.fStep,
+											pTarget->pResampled_L, pTarget->pResampled_R, nFrames );
+		}
+		pSource_L = pTarget->pResampled_L;
+		pSource_R = pTarget->pResampled_R;
+	}
 
+	float fInstrPeak_L = pInstr->get_peak_l(); // this value will be reset to 0 by the mixer..
+	float fInstrPeak_R = pInstr->get_peak_r(); // this value will be reset to 0 by the mixer..
 
-	bool retValue = true; // the note is ended
-	if ( nAvail_bytes > nBufferSize - nInitialSilence ) {	// il sample e' piu' grande del buffersize
-		// imposto il numero dei bytes disponibili uguale al buffersize
-		nAvail_bytes = nBufferSize - nInitialSilence;
-		retValue = false; // the note is not ended yet
+	float *		pTrackOutL = nullptr;
+	float *		pTrackOutR = nullptr;
+
+	if ( m_pTrackOutDriver != nullptr && ! pTarget->bPreview ) {
+		pTrackOutL = m_pTrackOutDriver->getTrackOut_L( pInstr, voice.pCompo );
+		pTrackOutR = m_pTrackOutDriver->getTrackOut_R( pInstr, voice.pCompo );
 	}
 
-	//	ADSR *pADSR = pNote->m_pADSR;
+	// Parallel renderers collect the components in their target. The
+	// audio thread adds to the buffers of the DrumkitComponent
+	// directly.
+	float* pComponentOut_L = nullptr;
+	float* pComponentOut_R = nullptr;
+	if ( voice.nComponentIdx < MAX_COMPONENTS ) {
+		pComponentOut_L = pTarget->pComponentOut_L[ voice.nComponentIdx ];
+		pComponentOut_R = pTarget->pComponentOut_R[ voice.nComponentIdx ];
+	}
+	if ( pComponentOut_L == nullptr && pTarget == &m_mainTarget &&
+		 voice.pDrumCompo != nullptr ) {
+		pComponentOut_L = voice.pDrumCompo->get_out_buffer_L();
+		pComponentOut_R = voice.pDrumCompo->get_out_buffer_R();
+	}
 
-	int nInitialBufferPos = nInitialSilence;
-	//float fInitialSamplePos = pNote->get_sample_position( pCompo->get_drumkit_componentID() );
-	double fSamplePos = pSelectedLayerInfo->SamplePosition;
-	int nTimes = nInitialBufferPos + nAvail_bytes;
+	// Apply the envelope shared by all components and the filter to
+	// the whole block before mixing.
+	float* pVoice_L = pTarget->pVoice_L;
+	float* pVoice_R = pTarget->pVoice_R;
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		pVoice_L[ ii ] = pSource_L[ ii ] * pEnvelope[ ii ];
+		pVoice_R[ ii ] = pSource_R[ ii ] * pEnvelope[ ii ];
+	}
 
-	auto pSample_data_L = pSample->get_data_l();
-	auto pSample_data_R = pSample->get_data_r();
+	// Low pass resonant filter
+	if ( pInstr->is_filter_active() ) {
+		pNote->compute_lr_values( pVoice_L, pVoice_R, nFrames, pSelectedLayerInfo );
+	}
 
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
+	// Mix the voice using the kernel specialized for its outputs.
+	VoiceOutputs outputs;
+	outputs.pMain_L = pTarget->pMainOut_L + nInitialSilence;
+	outputs.pMain_R = pTarget->pMainOut_R + nInitialSilence;
+	outputs.pComponent_L = pComponentOut_L != nullptr ? pComponentOut_L + nInitialSilence : nullptr;
+	outputs.pComponent_R = pComponentOut_R != nullptr ? pComponentOut_R + nInitialSilence : nullptr;
+	outputs.pTrack_L = pTrackOutL != nullptr ? pTrackOutL + nInitialSilence : nullptr;
+	outputs.pTrack_R = pTrackOutR != nullptr ? pTrackOutR + nInitialSilence : nullptr;
+	if ( outputs.pComponent_L != nullptr && voice.pDrumCompo != nullptr &&
+		 voice.pDrumCompo->get_insert_chain()->isActive() ) {
+		// Added to the main output by processInserts() once the
+		// effects were applied.
+		outputs.pMain_L = outputs.pComponent_L;
+		outputs.pMain_R = outputs.pComponent_R;
+		outputs.pComponent_L = nullptr;
+		outputs.pComponent_R = nullptr;
+	}
+	VoiceGains gains = rampVoiceGains( pSelectedLayerInfo, nFrames, voice.fGain_L, voice.fGain_R,
+									   voice.fTrackGain_L, voice.fTrackGain_R );
+	mixVoiceKernel( outputs.pTrack_L != nullptr && outputs.pTrack_R != nullptr,
+					outputs.pComponent_L != nullptr )(
+						pVoice_L, pVoice_R, nFrames, gains, outputs,
+						&fInstrPeak_L, &fInstrPeak_R );
 
-	float fADSRValue = 1.0;
-	float fVal_L;
-	float fVal_R;
-	int nSampleFrames = pSample->get_frames();
+	pSelectedLayerInfo->SamplePosition += nFrames * voice.fStep;
+	pInstr->set_peak_l( fInstrPeak_L );
+	pInstr->set_peak_r( fInstrPeak_R );
 
+#ifdef H2CORE_HAVE_LADSPA
+	// LADSPA
+	if ( pInstr->is_muted() || pSong->getIsMuted() || nFrames <= 0 ||
+		 pTarget->bPreview ) {
+		return;
+	}
+	float masterVol = pSong->getVolume();
+	for ( int nFX = 0; nFX < m_nRenderFX; ++nFX ) {
+		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		float fLevel = pInstr->get_fx_level( nFX );
+		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
+			fLevel = fLevel * pFX->getVolume();
 
-#ifdef H2CORE_HAVE_JACK
-	float *		pTrackOutL = nullptr;
-	float *		pTrackOutR = nullptr;
+			float fFXCost_L = fLevel * masterVol;
+			float fFXCost_R = fLevel * masterVol;
 
-	if ( Preferences::get_instance()->m_bJackTrackOuts ) {
-		auto pJackAudioDriver = dynamic_cast<JackAudioDriver*>(pAudioOutput);
-		if( pJackAudioDriver ) {
-			pTrackOutL = pJackAudioDriver->getTrackOut_L( pNote->get_instrument(), pCompo );
-			pTrackOutR = pJackAudioDriver->getTrackOut_R( pNote->get_instrument(), pCompo );
+			Dsp::addWithGain( pTarget->pFXOut_L[ nFX ] + nInitialSilence, pSource_L,
+							  fFXCost_L, nFrames );
+			Dsp::addWithGain( pTarget->pFXOut_R[ nFX ] + nInitialSilence, pSource_R,
+							  fFXCost_R, nFrames );
 		}
 	}
+	// ~LADSPA
 #endif
+}
 
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pSelectedLayerInfo->SamplePosition ) ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
+bool Sampler::renderFrozenNote( Note* pNote, unsigned nBufferSize, unsigned nFramepos,
+								Song* pSong, RenderTarget* pTarget )
+{
+	const FrozenPattern* pFrozen = pNote->get_frozen_pattern();
+	Instrument* pInstr = pNote->get_instrument();
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	AudioOutput* pAudioOutput = pHydrogen->getAudioOutput();
+	const Preferences::JackTrackOutputMode jackTrackOutputMode =
+		RealtimeConfig::get().jackTrackOutputMode;
+
+	// The position within the render is shared by all components.
+	SelectedLayerInfo* pPosition = pNote->get_layer_selected( 0 );
+
+	int nNoteStart = static_cast<int>(
+		pAudioOutput->m_transport.frameAtTick( pNote->get_position() ) );
+	int nInitialSilence = 0;
+	if ( nNoteStart > static_cast<int>( nFramepos ) ) {
+		nInitialSilence = nNoteStart - nFramepos;
+		if ( nInitialSilence >= static_cast<int>( nBufferSize ) ) {
+			return false;
 		}
+	}
 
-		int nSamplePos = ( int )fSamplePos;
-		double fDiff = fSamplePos - nSamplePos;
-		if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-			//we reach the last audioframe.
-			//set this last frame to zero do nothing wrong.
-						fVal_L = 0.0;
-						fVal_R = 0.0;
-		} else {
-			// some interpolation methods need 4 frames data.
-				float last_l;
-				float last_r;
-				if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-					last_l = 0.0;
-					last_r = 0.0;
-				} else {
-					last_l =  pSample_data_L[nSamplePos + 2];
-					last_r =  pSample_data_R[nSamplePos + 2];
-				}
+	int nFirst = static_cast<int>( pPosition->SamplePosition );
+	int nAvail = std::min( pFrozen->nFrames - nFirst,
+						   static_cast<int>( nBufferSize ) - nInitialSilence );
+	bool bFinished = nFirst + nAvail >= pFrozen->nFrames;
+	if ( nAvail <= 0 ) {
+		return true;
+	}
+	pInstr->add_render_frames( nAvail, false );
 
-				switch( m_interpolateMode ){
-
-						case Interpolation::InterpolateMode::Linear:
-								fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-								fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-								//fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								//fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case Interpolation::InterpolateMode::Cosine:
-								fVal_L = Interpolation::cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								fVal_R = Interpolation::cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case Interpolation::InterpolateMode::Third:
-								fVal_L = Interpolation::third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case Interpolation::InterpolateMode::Cubic:
-								fVal_L = Interpolation::cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case Interpolation::InterpolateMode::Hermite:
-								fVal_L = Interpolation::hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = Interpolation::hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-				}
-		}
+	float* pEnvelope = pTarget->pEnvelope;
+	pNote->get_adsr()->get_values( pEnvelope, nAvail, 1 );
 
-		// ADSR envelope
-		fADSRValue = pNote->get_adsr()->get_value( fStep );
-		fVal_L = fVal_L * fADSRValue;
-		fVal_R = fVal_R * fADSRValue;
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
+	bool bMuted = ( pHydrogen->getIsExportSessionActive() && ! pInstr->is_currently_exported() ) ||
+		pInstr->is_muted() || pSong->getIsMuted() ||
+		( isAnyInstrumentSoloed() && ! pInstr->is_soloed() );
 
+	float fInstrPeak_L = pInstr->get_peak_l();
+	float fInstrPeak_R = pInstr->get_peak_r();
 
+	const int nComponents = pFrozen->componentIds.size();
+	for ( int ii = 0; ii < nComponents; ++ii ) {
+		const int nComponentID = pFrozen->componentIds[ ii ];
 
-#ifdef H2CORE_HAVE_JACK
-		if( 		pTrackOutL ) {
-					pTrackOutL[nBufferPos] += fVal_L * cost_track_L;
+		InstrumentComponent* pCompo = nullptr;
+		for ( const auto& pInstrCompo : *pInstr->get_components() ) {
+			if ( pInstrCompo->get_drumkit_componentID() == nComponentID ) {
+				pCompo = pInstrCompo;
+				break;
+			}
 		}
-		if( 		pTrackOutR ) {
-					pTrackOutR[nBufferPos] += fVal_R * cost_track_R;
+		DrumkitComponent* pMainCompo = pSong->getComponent( nComponentID );
+		if ( pMainCompo == nullptr ) {
+			pMainCompo = pSong->getComponents()->front();
+		}
+		int nComponentIdx = MAX_COMPONENTS;
+		int nSongCompoIdx = 0;
+		for ( const auto& pSongCompo : *pSong->getComponents() ) {
+			if ( pSongCompo == pMainCompo ) {
+				nComponentIdx = nSongCompoIdx;
+				break;
+			}
+			++nSongCompoIdx;
 		}
-#endif
-
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
+		float fGain = 0.0;
+		float fTrackGain = 1.0;
+		if ( bMuted || pMainCompo->is_muted() ) {
+			if ( jackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
+				fTrackGain = 0.0;
+			}
+		} else {
+			fGain = pInstr->get_volume() * pMainCompo->get_volume();
+			if ( jackTrackOutputMode == Preferences::JackTrackOutputMode::postFader ) {
+				fTrackGain = fGain * 2;
+			}
+			fGain *= pSong->getVolume();
 		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+		if ( m_bRenderingStems ) {
+			fTrackGain = fGain;
 		}
 
-		pDrumCompo->set_outs( nBufferPos, fVal_L, fVal_R );
-
-		// to main mix
-		m_pMainOut_L[nBufferPos] += fVal_L;
-		m_pMainOut_R[nBufferPos] += fVal_R;
-
-		fSamplePos += fStep;
-	}
-	pSelectedLayerInfo->SamplePosition += nAvail_bytes * fStep;
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
+		float* pVoice_L = pTarget->pVoice_L;
+		float* pVoice_R = pTarget->pVoice_R;
+		const float* pData_L = pFrozen->getData_L( ii ) + nFirst;
+		const float* pData_R = pFrozen->getData_R( ii ) + nFirst;
+		for ( int nFrame = 0; nFrame < nAvail; ++nFrame ) {
+			pVoice_L[ nFrame ] = pData_L[ nFrame ] * pEnvelope[ nFrame ];
+			pVoice_R[ nFrame ] = pData_R[ nFrame ] * pEnvelope[ nFrame ];
+		}
 
+		float* pTrackOutL = nullptr;
+		float* pTrackOutR = nullptr;
+		if ( m_pTrackOutDriver != nullptr && pCompo != nullptr ) {
+			pTrackOutL = m_pTrackOutDriver->getTrackOut_L( pInstr, pCompo );
+			pTrackOutR = m_pTrackOutDriver->getTrackOut_R( pInstr, pCompo );
+		}
+		float* pComponentOut_L = nullptr;
+		float* pComponentOut_R = nullptr;
+		if ( nComponentIdx < MAX_COMPONENTS ) {
+			pComponentOut_L = pTarget->pComponentOut_L[ nComponentIdx ];
+			pComponentOut_R = pTarget->pComponentOut_R[ nComponentIdx ];
+		}
+		if ( pComponentOut_L == nullptr && pTarget == &m_mainTarget ) {
+			pComponentOut_L = pMainCompo->get_out_buffer_L();
+			pComponentOut_R = pMainCompo->get_out_buffer_R();
+		}
 
+		VoiceOutputs outputs;
+		outputs.pMain_L = pTarget->pMainOut_L + nInitialSilence;
+		outputs.pMain_R = pTarget->pMainOut_R + nInitialSilence;
+		outputs.pComponent_L = pComponentOut_L != nullptr ? pComponentOut_L + nInitialSilence : nullptr;
+		outputs.pComponent_R = pComponentOut_R != nullptr ? pComponentOut_R + nInitialSilence : nullptr;
+		outputs.pTrack_L = pTrackOutL != nullptr ? pTrackOutL + nInitialSilence : nullptr;
+		outputs.pTrack_R = pTrackOutR != nullptr ? pTrackOutR + nInitialSilence : nullptr;
+		if ( outputs.pComponent_L != nullptr &&
+			 pMainCompo->get_insert_chain()->isActive() ) {
+			outputs.pMain_L = outputs.pComponent_L;
+			outputs.pMain_R = outputs.pComponent_R;
+			outputs.pComponent_L = nullptr;
+			outputs.pComponent_R = nullptr;
+		}
+		VoiceGains gains = rampVoiceGains( pNote->get_layer_selected( ii ), nAvail,
+										   fGain, fGain, fTrackGain, fTrackGain );
+		mixVoiceKernel( outputs.pTrack_L != nullptr && outputs.pTrack_R != nullptr,
+						outputs.pComponent_L != nullptr )(
+							pVoice_L, pVoice_R, nAvail, gains, outputs,
+							&fInstrPeak_L, &fInstrPeak_R );
 
 #ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-	// change the below return logic if you add code after that ifdef
-	if (pNote->get_instrument()->is_muted() || pSong->getIsMuted() ) return retValue;
-	float masterVol = pSong->getVolume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
-
-//			float fFXCost_L = cost_L * fLevel;
-//			float fFXCost_R = cost_R * fLevel;
-			float fFXCost_L = fLevel * masterVol;
-			float fFXCost_R = fLevel * masterVol;
-
-			int nBufferPos = nInitialBufferPos;
-			float fSamplePos = pSelectedLayerInfo->SamplePosition;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				int nSamplePos = ( int )fSamplePos;
-				double fDiff = fSamplePos - nSamplePos;
-
-				if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-					//we reach the last audioframe.
-					//set this last frame to zero do nothing wrong.
-					fVal_L = 0.0;
-					fVal_R = 0.0;
-				} else {
-					// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					}else
-					{
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
-
-					switch( m_interpolateMode ){
-
-					case Interpolation::InterpolateMode::Linear:
-						fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-						fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-						break;
-					case Interpolation::InterpolateMode::Cosine:
-						fVal_L = Interpolation::cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-						fVal_R = Interpolation::cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-						break;
-					case Interpolation::InterpolateMode::Third:
-						fVal_L = Interpolation::third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = Interpolation::third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case Interpolation::InterpolateMode::Cubic:
-						fVal_L = Interpolation::cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = Interpolation::cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case Interpolation::InterpolateMode::Hermite:
-						fVal_L = Interpolation::hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = Interpolation::hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					}
-				}
-
-				pBuf_L[ nBufferPos ] += fVal_L * fFXCost_L;
-								pBuf_R[ nBufferPos ] += fVal_R * fFXCost_R;
-				fSamplePos += fStep;
-				++nBufferPos;
+		// The sends are fed by the frozen signal, which already
+		// contains the pan of the notes.
+		if ( pInstr->is_muted() || pSong->getIsMuted() ) {
+			continue;
+		}
+		for ( int nFX = 0; nFX < m_nRenderFX; ++nFX ) {
+			LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+			float fLevel = pInstr->get_fx_level( nFX );
+			if ( pFX == nullptr || fLevel == 0.0 ) {
+				continue;
 			}
+			float fFXGain = fLevel * pFX->getVolume() * pSong->getVolume();
+			Dsp::addWithGain( pTarget->pFXOut_L[ nFX ] + nInitialSilence,
+							  pVoice_L, fFXGain, nAvail );
+			Dsp::addWithGain( pTarget->pFXOut_R[ nFX ] + nInitialSilence,
+							  pVoice_R, fFXGain, nAvail );
 		}
-	}
 #endif
+	}
+
+	pInstr->set_peak_l( fInstrPeak_L );
+	pInstr->set_peak_r( fInstrPeak_R );
+	pPosition->SamplePosition += nAvail;
 
-	return retValue;
+	// Stopped, e.g. by a relocation or a note off.
+	return bFinished || pNote->get_adsr()->is_idle();
 }
 
 
 void Sampler::stopPlayingNotes(Instrument* pInstr )
 {
 	if ( pInstr ) { // stop all notes using this instrument
-		for ( unsigned i = 0; i < m_playingNotesQueue.size(); ) {
-			Note *pNote = m_playingNotesQueue[ i ];
-			assert( pNote );
-			if ( pNote->get_instrument() == pInstr ) {
-				delete pNote;
-				pInstr->dequeue();
-				m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
-			}
-			++i;
+		while ( *pInstr->get_voices() != nullptr ) {
+			Note *pNote = *pInstr->get_voices();
+			removePlayingNote( pNote->get_voice_index() );
+			releaseStreams( pNote );
+			delete pNote;
+			pInstr->dequeue();
 		}
 	} else { // stop all notes
 		// delete all copied notes in the playing notes queue
 		for ( unsigned i = 0; i < m_playingNotesQueue.size(); ++i ) {
 			Note *pNote = m_playingNotesQueue[i];
+			unlinkVoice( pNote );
 			pNote->get_instrument()->dequeue();
+			releaseStreams( pNote );
 			delete pNote;
 		}
 		m_playingNotesQueue.clear();
+		stopPreviews();
 	}
 }
 
+void Sampler::stopPreviews()
+{
+	for ( const auto& pNote : m_previewNotes ) {
+		pNote->get_instrument()->dequeue();
+		releaseStreams( pNote );
+		delete pNote;
+	}
+	m_previewNotes.clear();
+}
+
+void Sampler::startPreview( Note* pNote )
+{
+	if ( static_cast<int>( m_previewNotes.size() ) >= nPreviewVoices ) {
+		Note* pOldest = m_previewNotes.front();
+		m_previewNotes.erase( m_previewNotes.begin() );
+		pOldest->get_instrument()->dequeue();
+		releaseStreams( pOldest );
+		delete pOldest;
+	}
+
+	pNote->get_adsr()->attack();
+	pNote->get_instrument()->enqueue();
+	m_previewNotes.push_back( pNote );
+}
+
 
 
 /// Preview, uses only the first layer
@@ -1482,18 +2341,17 @@ void Sampler::preview_sample(std::shared_ptr<Sample> pSample, int length )
 {
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
+	stopPreviews();
 	for (const auto& pComponent: *m_pPreviewInstrument->get_components()) {
 		InstrumentLayer *pLayer = pComponent->get_layer( 0 );
 
 		pLayer->set_sample( pSample );
-
-		Note *pPreviewNote = new Note( m_pPreviewInstrument, 0, 1.0, 0.5, 0.5, length, 0 );
-
-		stopPlayingNotes( m_pPreviewInstrument );
-		noteOn( pPreviewNote );
-
 	}
 
+	// A single note plays all components.
+	Note *pPreviewNote = new Note( m_pPreviewInstrument, 0, 1.0, 0.5, 0.5, length, 0 );
+	startPreview( pPreviewNote );
+
 	AudioEngine::get_instance()->unlock();
 }
 
@@ -1504,7 +2362,7 @@ void Sampler::preview_instrument(Instrument* pInstr )
 	Instrument * pOldPreview;
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
-	stopPlayingNotes( m_pPreviewInstrument );
+	stopPreviews();
 
 	pOldPreview = m_pPreviewInstrument;
 	m_pPreviewInstrument = pInstr;
@@ -1512,7 +2370,7 @@ void Sampler::preview_instrument(Instrument* pInstr )
 
 	Note *pPreviewNote = new Note( m_pPreviewInstrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
 
-	noteOn( pPreviewNote );	// exclusive note
+	startPreview( pPreviewNote );	// exclusive note
 	AudioEngine::get_instance()->unlock();
 	delete pOldPreview;
 }
@@ -1609,14 +2467,7 @@ bool Sampler::isAnyInstrumentSoloed() const
 
 bool Sampler::isInstrumentPlaying( Instrument* instrument )
 {
-	if ( instrument ) { // stop all notes using this instrument
-		for ( unsigned j = 0; j < m_playingNotesQueue.size(); j++ ) {
-			if ( instrument->get_name() == m_playingNotesQueue[ j ]->get_instrument()->get_name()){
-				return true;
-			}
-		}
-	}
-	return false;
+	return instrument != nullptr && *instrument->get_voices() != nullptr;
 }
 
 void Sampler::reinitializePlaybackTrack()
@@ -1626,14 +2477,53 @@ void Sampler::reinitializePlaybackTrack()
 	std::shared_ptr<Sample>	pSample;
 
 	if(!pSong->getPlaybackTrackFilename().isEmpty()){
-		pSample = Sample::load( pSong->getPlaybackTrackFilename() );
+		pSample = Sample::load_streamed( pSong->getPlaybackTrackFilename(),
+										 nPlaybackTrackPreloadFrames );
 	}
 	
 	InstrumentLayer* pPlaybackTrackLayer = new InstrumentLayer( pSample );
 
+	// The stream still refers to the previous track.
+	if ( m_nPlaybackTrackStream != -1 ) {
+		m_pSampleStreamer->close( m_nPlaybackTrackStream );
+		m_nPlaybackTrackStream = -1;
+	}
 	m_pPlaybackTrackInstrument->get_components()->front()->set_layer( pPlaybackTrackLayer, 0 );
 	m_nPlayBackSamplePosition = 0;
 }
 
+void Sampler::seekPlaybackTrack( long long nFrame )
+{
+	if ( m_pPlaybackTrackStretcher != nullptr ) {
+		// Restarted at the new position by the next process cycle.
+		m_pPlaybackTrackStretcher->stop();
+	}
+	if ( m_nPlaybackTrackStream != -1 ) {
+		m_pSampleStreamer->close( m_nPlaybackTrackStream );
+		m_nPlaybackTrackStream = -1;
+	}
+
+	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	auto pSample = m_pPlaybackTrackInstrument->get_components()->front()->get_layer( 0 )->get_sample();
+	if ( pSample == nullptr || pAudioOutput == nullptr ) {
+		return;
+	}
+
+	// Same position processPlaybackTrack() will start with.
+	int nFirstFrame = ( int )( nFrame * ( double )pSample->get_sample_rate() /
+							   pAudioOutput->getSampleRate() );
+	if ( pSample->get_sample_rate() != pAudioOutput->getSampleRate() ) {
+		nFirstFrame -= Interpolation::frames_before( m_interpolateMode );
+	}
+	m_nPlayBackSamplePosition = std::max( nFirstFrame, 0 );
+
+	if ( pSample->is_streamed() && m_pSampleStreamer != nullptr &&
+		 m_nPlayBackSamplePosition < pSample->get_frames() ) {
+		m_nPlaybackTrackStream =
+			m_pSampleStreamer->open( pSample, std::max( m_nPlayBackSamplePosition,
+														pSample->get_resident_frames() ) );
+	}
+}
+
 };
 
@@ -24,13 +24,28 @@
 #ifndef SAMPLER_H
 #define SAMPLER_H
 
+#include <core/config.h>
 #include <core/Object.h>
 #include <core/Globals.h>
+#include <core/Preferences.h>
 #include <core/Sampler/Interpolation.h>
 
 #include <inttypes.h>
 #include <vector>
 #include <memory>
+#include <mutex>
+
+/** Number of intervals the pan range [-1,1] is divided into by the
+	pan law table of the H2Core::Sampler. Even, so the center is
+	sampled exactly.*/
+#define PAN_LAW_TABLE_SIZE 1024
+
+/** Number of semitones covered by the pitch ratio table of the
+	H2Core::Sampler in either direction.*/
+#define PITCH_RATIO_RANGE 48
+/** Number of intervals each semitone is divided into by the pitch
+	ratio table of the H2Core::Sampler.*/
+#define PITCH_RATIO_STEPS 64
 
 
 
@@ -45,6 +60,9 @@ class Instrument;
 struct SelectedLayerInfo;
 class InstrumentComponent;
 class AudioOutput;
+class WorkerPool;
+class SampleStreamer;
+class PlaybackTrackStretcher;
 
 ///
 /// Waveform based sampler.
@@ -180,12 +198,31 @@ public:
 		return m_playingNotesQueue.size();
 	}
 
+	/**
+	 * Auditions @a pSample for @a length ticks using the preview
+	 * instrument. Stops all previews already playing.
+	 *
+	 * Previews are played by a small pool of voices of their own,
+	 * which neither counts towards Preferences::m_nMaxNotes nor is
+	 * subject to voice stealing. They are rendered after all other
+	 * voices into the cue output of the audio driver if it provides
+	 * one (see AudioOutput::getCueOut_L()) and added to the main
+	 * output otherwise.
+	 */
 	void preview_sample( std::shared_ptr<Sample> pSample, int length );
+	/** Replaces the preview instrument by @a pInstr, which is owned
+		by the Sampler from now on, and auditions it. See
+		preview_sample().*/
 	void preview_instrument( Instrument* pInstr );
+	/** Stops all voices of the preview pool.*/
+	void stopPreviews();
 
 	void setPlayingNotelength( Instrument* pInstrument, unsigned long ticks, unsigned long noteOnTick );
 	bool isInstrumentPlaying( Instrument* pInstr );
 
+	/** Sets the interpolation used for all instruments which do not
+		ask for Interpolation::InterpolateMode::Sinc on their own, see
+		Instrument::set_sinc_interpolation().*/
 	void setInterpolateMode( Interpolation::InterpolateMode mode ){
 			 m_interpolateMode = mode;
 	}
@@ -200,6 +237,22 @@ public:
 
 	Interpolation::InterpolateMode getInterpolateMode(){ return m_interpolateMode; }
 
+	/**
+	 * Lowers the rendering quality as decided by the
+	 * OverloadGovernor. Called by audioEngine_process() at the end
+	 * of each cycle.
+	 *
+	 * \param bLinearInterpolation Render all notes using
+	 * Interpolation::InterpolateMode::Linear, regardless of the mode
+	 * set and Instrument::get_sinc_interpolation().
+	 * \param bReducedVoices Play half of Preferences::m_nMaxNotes
+	 * voices only.
+	 */
+	void setDegradation( bool bLinearInterpolation, bool bReducedVoices ) {
+		m_bForceLinearInterpolation = bLinearInterpolation;
+		m_bReducedVoices = bReducedVoices;
+	}
+
 	/**
 	 * Loading of the playback track.
 	 *
@@ -208,12 +261,82 @@ public:
 	 * containing the loaded Sample. If
 	 * Song::__playback_track_filename is empty, the
 	 * layer will be loaded with a nullptr instead.
+	 *
+	 * Only the head of the track is kept in memory. The remainder
+	 * is read ahead by the SampleStreamer during playback.
 	 */
 	void reinitializePlaybackTrack();
+	/**
+	 * Restarts the stream of the playback track at the transport
+	 * position @a nFrame.
+	 *
+	 * Called by audioEngine_seek() so the I/O thread can read ahead
+	 * before the next process cycle asks for the frames. Other
+	 * relocations are detected in processPlaybackTrack().
+	 */
+	void seekPlaybackTrack( long long nFrame );
+
+	/** \return Number of blocks in which a streamed Sample,
+		including the playback track, could not be read from disk
+		in time.*/
+	int getStreamUnderruns() const;
+
+	/** \return Pool of realtime worker threads shared with other
+		stages of the process cycle. nullptr if
+		Preferences::m_nSamplerWorkers is zero.*/
+	WorkerPool* getWorkerPool() const {
+		return m_pWorkerPool;
+	}
 	
 private:
+	/** Voices currently rendered. Not ordered: finished voices are
+		removed by moving the last one into their place. Use
+		Note::get_voice_age() to find the oldest one.*/
 	std::vector<Note*> m_playingNotesQueue;
 	std::vector<Note*> m_queuedNoteOffs;
+	/** Age assigned to the most recent voice started in noteOn().*/
+	uint64_t m_nVoiceAge;
+
+	/** Heads of the lists of voices started in each mute group,
+		indexed by the group. See Note::VoiceList.*/
+	std::vector<Note*> m_muteGroupVoices;
+	/** Heads of the lists of voices triggered by each MIDI key.*/
+	Note* m_midiKeyVoices[ 128 ];
+
+	/** Appends @a pNote to #m_playingNotesQueue and links it into
+		its voice lists.*/
+	void addPlayingNote( Note* pNote );
+	/** Removes the voice at @a nIndex from #m_playingNotesQueue in
+		constant time by replacing it with the last one. The voice is
+		unlinked from its voice lists.*/
+	void removePlayingNote( unsigned nIndex );
+	/** \return Head of the list @a nList ( a Note::VoiceList ) @a
+		pNote belongs to or nullptr if it is part of none of this
+		kind.*/
+	Note** voiceListHead( Note* pNote, int nList );
+	void linkVoice( Note* pNote );
+	void unlinkVoice( Note* pNote );
+	/**
+	 * Picks the voice to fade out once more than
+	 * Preferences::m_nMaxNotes voices are playing.
+	 *
+	 * Voices already fading out are never picked.
+	 *
+	 * \param policy Strategy to use.
+	 * \return Index in #m_playingNotesQueue or -1 if all voices are
+	 * already fading out.
+	 */
+	int findVoiceToSteal( Preferences::VoiceStealing policy );
+
+	/** Voices of the previews, see preview_sample(). Its capacity
+		is reserved up front and never exceeded.*/
+	std::vector<Note*> m_previewNotes;
+	/** Adds @a pNote to #m_previewNotes. The oldest preview is
+		dropped if the pool is full.*/
+	void startPreview( Note* pNote );
+	/** Renders #m_previewNotes into the cue output of
+		@a pAudioOutput or #m_pMainOut_L and #m_pMainOut_R.*/
+	void processPreviews( uint32_t nFrames, Song* pSong, AudioOutput* pAudioOutput );
 	
 	/// Instrument used for the playback track feature.
 	Instrument* m_pPlaybackTrackInstrument;
@@ -228,52 +351,259 @@ private:
 	    assigned in Preferences::Preferences(): 16.*/
 	int m_nMaxLayers;
 	
+	/** First frame of the playback track requested in the
+		previous process cycle. Requests before it or far beyond
+		restart #m_nPlaybackTrackStream.*/
 	int m_nPlayBackSamplePosition;
+	/** Stream of #m_pSampleStreamer feeding the playback track, -1
+		if none.*/
+	int m_nPlaybackTrackStream;
 	
-	/** function to direct the computation to the selected pan law function
+	/** Evaluates the pan law @a nPanLawType at @a fPan.
+	 *
+	 * Too expensive to be called per note. Used to fill
+	 * #m_panLawTable.*/
+	static float computePanLaw( float fPan, int nPanLawType, float fKNorm );
+	/** Rebuilds #m_panLawTable whenever the pan law type or its
+	 * K-norm of @a pSong changed since the last call.
+	 *
+	 * Called by process() prior to rendering any voice.*/
+	void updatePanLawTable( Song* pSong );
+	/** \return Gain of the current pan law at @a fPan in [-1,1]
+	 * linearly interpolated from #m_panLawTable.*/
+	float panLaw( float fPan ) const;
+
+	/** Gain of the current pan law sampled at
+		#PAN_LAW_TABLE_SIZE + 1 equidistant positions in [-1,1].*/
+	float m_panLawTable[ PAN_LAW_TABLE_SIZE + 1 ];
+	/** Pan law type #m_panLawTable was built for.*/
+	int m_nPanLawType;
+	/** K-norm #m_panLawTable was built for.*/
+	float m_fPanLawKNorm;
+	/** Incremented each time #m_panLawTable is rebuilt to
+		invalidate the gains cached by the notes.*/
+	int m_nPanLawRevision;
+
+	/** \return Ratio of the frequencies of a sample played
+	 * @a fPitch semitones higher and the original one, linearly
+	 * interpolated from #m_pitchRatioTable.*/
+	float pitchRatio( float fPitch ) const;
+	/** Pitch ratios sampled at the pitches in
+		[-#PITCH_RATIO_RANGE, #PITCH_RATIO_RANGE] semitones in steps
+		of 1 / #PITCH_RATIO_STEPS.*/
+	float m_pitchRatioTable[ 2 * PITCH_RATIO_RANGE * PITCH_RATIO_STEPS + 1 ];
+
+	/**
+	 * Buffers a set of voices is rendered into.
+	 *
+	 * When rendering within the audio thread only, all pointers
+	 * refer to #m_pMainOut_L, #m_pMainOut_R, and the buffers of the
+	 * LadspaFX. The component outputs are left nullptr and the
+	 * voices are accumulated into
+	 * DrumkitComponent::get_out_buffer_L() and
+	 * DrumkitComponent::get_out_buffer_R() directly.
+	 *
+	 * Each task of the #m_pWorkerPool does use a private set of
+	 * buffers instead, which are merged after all voices were
+	 * rendered.
 	 */
-	float panLaw( float fPan, Song* pSong );
+	struct RenderTarget {
+		float* pMainOut_L;
+		float* pMainOut_R;
+		float* pFXOut_L[ MAX_FX ];
+		float* pFXOut_R[ MAX_FX ];
+		/** Indexed by the position of the DrumkitComponent in
+			Song::getComponents().*/
+		float* pComponentOut_L[ MAX_COMPONENTS ];
+		float* pComponentOut_R[ MAX_COMPONENTS ];
+		/** Scratch buffers holding the interpolated frames of the
+			voice currently rendered by renderVoice().*/
+		float* pResampled_L;
+		float* pResampled_R;
+		/** Scratch buffer holding the ADSR envelope of the note
+			currently rendered. It is shared by all its components.*/
+		float* pEnvelope;
+		/** Scratch buffers holding the enveloped and filtered
+			frames of the voice currently rendered.*/
+		float* pVoice_L;
+		float* pVoice_R;
+		/** Scratch buffers holding the frames of a streamed,
+			compactly stored, or deferred sample provided by
+			fetchSampleData().*/
+		float* pStream_L;
+		float* pStream_R;
+		/** Whether the voices rendered are previews. Those are
+			neither sent to the LadspaFX nor to track outputs.*/
+		bool bPreview;
+	};
+
+	/** Target used when rendering in the audio thread only.*/
+	RenderTarget m_mainTarget;
+	/** Target the previews are rendered into. It shares the
+		scratch buffers of #m_mainTarget.*/
+	RenderTarget m_previewTarget;
+	/** One target per task of #m_pWorkerPool.*/
+	std::vector<RenderTarget> m_workerTargets;
+
+	/** Optional pool of realtime threads rendering the voices in
+		parallel. It is created in Sampler() if
+		Preferences::m_nSamplerWorkers is larger than zero.*/
+	WorkerPool* m_pWorkerPool;
+	/** Whether renderNote() is currently called by several threads
+		at once.*/
+	bool m_bRenderingParallel;
+	/** Protects state shared by all voices, like the MIDI output and
+		the round robin counters of the Song, while rendering in
+		parallel.*/
+	std::mutex m_sharedStateMutex;
+	/** Whether the voice at the same position in
+		#m_playingNotesQueue did end in the current cycle.*/
+	std::vector<char> m_voiceFinished;
+	/** Arguments of the current cycle shared with the tasks of
+		#m_pWorkerPool.*/
+	uint32_t m_nRenderFrames;
+	Song* m_pRenderSong;
+	/** Number of FX slots up to the last one holding an effect in
+		the current cycle. Slots beyond are neither cleared nor
+		rendered into.*/
+	int m_nRenderFX;
+
+	/** Renders all voices of #m_playingNotesQueue assigned to task
+		@a nTask into the corresponding element of
+		#m_workerTargets.*/
+	static void renderTask( int nTask, void* pArg );
+	void allocateWorkerTargets( int nTargets );
+	void freeWorkerTargets();
+	/** Adds the content of all #m_workerTargets to the buffers of
+		#m_mainTarget and the DrumkitComponents of @a pSong.*/
+	void mergeWorkerTargets( uint32_t nFrames, Song* pSong );
+	/** Applies the InsertChain of all DrumkitComponents of @a pSong
+		having one and adds their output to #m_pMainOut_L and
+		#m_pMainOut_R. The voices of those components are not mixed
+		into the main output directly.*/
+	void processInserts( uint32_t nFrames, Song* pSong );
+
+	/** Feeds voices playing streamed samples and the playback
+		track. Has two streams only unless
+		Preferences::m_bSampleStreaming or
+		Preferences::m_bPackedSampleStorage is set.*/
+	SampleStreamer* m_pSampleStreamer;
+	/** Stretches the playback track if Song::getPlaybackTrackBpm()
+		is set. nullptr without #H2CORE_HAVE_RUBBERBAND.*/
+	PlaybackTrackStretcher* m_pPlaybackTrackStretcher;
+
+	/** Driver providing per-track outputs, either the JACK driver
+		if Preferences::m_bJackTrackOuts is set or the
+		DiskWriterDriver while exporting stems. It is looked up once
+		at the beginning of each process() and nullptr otherwise.*/
+	AudioOutput* m_pTrackOutDriver;
+	/** Whether #m_pTrackOutDriver receives the stems of an
+		export. Their gain matches the one of the main output.*/
+	bool m_bRenderingStems;
+	/** Whether #m_pTrackOutDriver is the OfflineDriver of the
+		InstrumentFreezer. Only the instrument being frozen is
+		rendered and its tracks leave out all volumes and mutes.*/
+	bool m_bRenderingFreeze;
+
+	/**
+	 * Provides the frames [@a nFirst, @a nFirst + @a nFrames) of
+	 * @a pSample as contiguous arrays.
+	 *
+	 * For a sample held in memory entirely these are its own
+	 * buffers. For a streamed one the frames are assembled from its
+	 * resident head and the stream of @a pSelectedLayerInfo - opened
+	 * on demand - in the scratch buffers of @a pTarget. The frames
+	 * of a compactly stored or deferred one are converted into the
+	 * same scratch buffers.
+	 *
+	 * \param ppData_L Set to the buffer of the left channel.
+	 * \param ppData_R Set to the buffer of the right channel.
+	 * \param pDataFrames Set to the number of frames in @a ppData_L
+	 * and @a ppData_R.
+	 * \return Index within @a pSample of the first frame in
+	 * @a ppData_L and @a ppData_R.
+	 */
+	int fetchSampleData( std::shared_ptr<Sample> pSample,
+						 SelectedLayerInfo* pSelectedLayerInfo,
+						 RenderTarget* pTarget, int nFirst, int nFrames,
+						 float** ppData_L, float** ppData_R, int* pDataFrames );
+	/** Closes all streams opened for the layers of @a pNote.*/
+	void releaseStreams( Note* pNote );
 
 
 
 	bool processPlaybackTrack(int nBufferSize);
+	/**
+	 * Provides the next @a nBufferSize frames of the playback track
+	 * at the tempo it was recorded in.
+	 *
+	 * \param ppTrack_L Set to the frames of the left channel.
+	 * \param ppTrack_R Set to the frames of the right channel.
+	 * \return Number of frames available or -1 if the track has
+	 * ended.
+	 */
+	int fetchPlaybackTrack( std::shared_ptr<Sample> pSample, int nBufferSize,
+							float** ppTrack_L, float** ppTrack_R );
+	/**
+	 * Renders the next @a nBufferSize frames of the playback track
+	 * stretched to the tempo of the song into the scratch buffers
+	 * of #m_mainTarget using #m_pPlaybackTrackStretcher.
+	 *
+	 * \return Number of frames available or -1 if the track has
+	 * ended.
+	 */
+	int stretchPlaybackTrack( std::shared_ptr<Sample> pSample, int nBufferSize );
 	
 	bool isAnyInstrumentSoloed() const;
 	
-	bool renderNote( Note* pNote, unsigned nBufferSize, Song* pSong );
+	bool renderNote( Note* pNote, unsigned nBufferSize, Song* pSong, RenderTarget* pTarget );
+	/**
+	 * Renders a note queued by InstrumentFreezer::startColumn() by
+	 * streaming its FrozenPattern. Only the volumes, mutes, and
+	 * the release of the envelope are applied.
+	 *
+	 * \return true if the note is ended.
+	 */
+	bool renderFrozenNote( Note* pNote, unsigned nBufferSize, unsigned nFramepos,
+						   Song* pSong, RenderTarget* pTarget );
 
 	Interpolation::InterpolateMode m_interpolateMode;
+	/** see setDegradation()*/
+	bool m_bForceLinearInterpolation;
+	/** see setDegradation()*/
+	bool m_bReducedVoices;
+
+	/** State of a single component of a note set up by
+		renderNote() before any of its components is rendered.*/
+	struct ComponentVoice {
+		std::shared_ptr<Sample> pSample;
+		SelectedLayerInfo* pSelectedLayerInfo;
+		InstrumentComponent* pCompo;
+		DrumkitComponent* pDrumCompo;
+		/** Position of #pDrumCompo in Song::getComponents() or
+			MAX_COMPONENTS.*/
+		int nComponentIdx;
+		float fGain_L;
+		float fGain_R;
+		float fTrackGain_L;
+		float fTrackGain_R;
+		/** Frames of the sample advanced per output frame.*/
+		float fStep;
+		bool bResample;
+		/** Number of frames rendered in the current block.*/
+		int nFrames;
+		/** Whether the sample does end within the current block.*/
+		bool bEnds;
+	};
 
-	bool renderNoteNoResample(
-		std::shared_ptr<Sample> pSample,
-		Note *pNote,
-		SelectedLayerInfo *pSelectedLayerInfo,
-		InstrumentComponent *pCompo,
-		DrumkitComponent *pDrumCompo,
-		int nBufferSize,
-		int nInitialSilence,
-		float cost_L,
-		float cost_R,
-		float cost_track_L,
-		float cost_track_R,
-		Song* pSong
-	);
-
-	bool renderNoteResample(
-		std::shared_ptr<Sample> pSample,
-		Note *pNote,
-		SelectedLayerInfo *pSelectedLayerInfo,
-		InstrumentComponent *pCompo,
-		DrumkitComponent *pDrumCompo,
-		int nBufferSize,
-		int nInitialSilence,
-		float cost_L,
-		float cost_R,
-		float cost_track_L,
-		float cost_track_R,
-		float fLayerPitch,
-		Song* pSong
-	);
+	/**
+	 * Renders the current block of a single component of @a pNote.
+	 *
+	 * \param pEnvelope Envelope shared by all components of the
+	 * note holding at least ComponentVoice::nFrames values.
+	 */
+	void renderVoice( Note* pNote, const ComponentVoice& voice, RenderTarget* pTarget,
+					  int nInitialSilence, const float* pEnvelope, Song* pSong );
 };
 
 
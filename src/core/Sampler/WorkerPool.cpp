@@ -0,0 +1,178 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <core/Sampler/WorkerPool.h>
+#include <core/AllocationTracker.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Threads.h>
+#include <core/Tracer.h>
+
+#include <chrono>
+
+namespace H2Core
+{
+
+const char* WorkerPool::__class_name = "WorkerPool";
+
+/** Number of times an idle worker yields before going to sleep.*/
+static const int nSpinCount = 2000;
+
+WorkerPool::WorkerPool( int nWorkers )
+	: Object( __class_name )
+	, m_nState( 0 )
+	, m_nFinishedTasks( 0 )
+	, m_task( nullptr )
+	, m_pArg( nullptr )
+	, m_bQuit( false )
+{
+	if ( nWorkers > MAX_WORKER_THREADS ) {
+		WARNINGLOG( QString( "Requested %1 worker threads. Using %2 instead" )
+					.arg( nWorkers ).arg( MAX_WORKER_THREADS ) );
+		nWorkers = MAX_WORKER_THREADS;
+	}
+
+	for ( int ii = 0; ii < nWorkers; ++ii ) {
+		m_workers.push_back( std::thread( &WorkerPool::workerLoop, this ) );
+
+#ifndef WIN32
+		// Same scheduling as the process thread of the audio
+		// driver. Failing is not fatal: the thread will just be
+		// scheduled of lower priority.
+		Threads::configureThread( m_workers.back().native_handle(), Threads::Role::Audio,
+								  QString( "sampler worker %1" ).arg( ii ) );
+#endif
+	}
+
+	INFOLOG( QString( "Started %1 worker threads" ).arg( m_workers.size() ) );
+}
+
+WorkerPool::~WorkerPool()
+{
+	m_bQuit.store( true );
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_condition.notify_all();
+	}
+
+	for ( auto& worker : m_workers ) {
+		worker.join();
+	}
+}
+
+void WorkerPool::run( int nTasks, Task task, void* pArg )
+{
+	if ( nTasks <= 0 ) {
+		return;
+	}
+
+	m_task = task;
+	m_pArg = pArg;
+	m_nFinishedTasks.store( 0, std::memory_order_relaxed );
+
+	uint32_t nGeneration =
+		static_cast<uint32_t>( m_nState.load( std::memory_order_relaxed ) >> 32 ) + 1;
+	m_nState.store( ( static_cast<uint64_t>( nGeneration ) << 32 ) |
+					( static_cast<uint64_t>( nTasks & 0xffff ) << 16 ),
+					std::memory_order_release );
+
+	if ( m_workers.size() > 0 ) {
+		m_condition.notify_all();
+	}
+
+	work( nGeneration );
+
+	while ( m_nFinishedTasks.load( std::memory_order_acquire ) < nTasks ) {
+		std::this_thread::yield();
+	}
+}
+
+void WorkerPool::work( uint32_t nGeneration )
+{
+	uint64_t nState = m_nState.load( std::memory_order_acquire );
+
+	for ( ;; ) {
+		if ( static_cast<uint32_t>( nState >> 32 ) != nGeneration ) {
+			return;
+		}
+
+		int nTasks = static_cast<int>( ( nState >> 16 ) & 0xffff );
+		int nTask = static_cast<int>( nState & 0xffff );
+		if ( nTask >= nTasks ) {
+			return;
+		}
+
+		if ( m_nState.compare_exchange_weak( nState, nState + 1,
+											 std::memory_order_acq_rel,
+											 std::memory_order_acquire ) ) {
+			{
+				AllocationTracker::Scope allocationScope;
+				Tracer::Scope trace( "WorkerPool task" );
+				m_task( nTask, m_pArg );
+			}
+			m_nFinishedTasks.fetch_add( 1, std::memory_order_release );
+			nState = m_nState.load( std::memory_order_acquire );
+		}
+	}
+}
+
+void WorkerPool::workerLoop()
+{
+	uint32_t nLastGeneration = 0;
+	int nSpins = 0;
+
+	Dsp::disableDenormals();
+	Tracer::setThreadName( "Worker" );
+
+	while ( ! m_bQuit.load( std::memory_order_relaxed ) ) {
+		Threads::updateAudioWorkgroupMembership();
+
+		uint32_t nGeneration =
+			static_cast<uint32_t>( m_nState.load( std::memory_order_acquire ) >> 32 );
+
+		if ( nGeneration != nLastGeneration ) {
+			nLastGeneration = nGeneration;
+			work( nGeneration );
+			nSpins = 0;
+			continue;
+		}
+
+		if ( nSpins < nSpinCount ) {
+			++nSpins;
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Since run() notifies without holding the mutex, a wake up
+		// might get lost. The timeout bounds the time such a worker
+		// sits idle.
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_condition.wait_for( lock, std::chrono::milliseconds( 1 ), [&]() {
+			return m_bQuit.load( std::memory_order_relaxed ) ||
+				static_cast<uint32_t>( m_nState.load( std::memory_order_acquire ) >> 32 )
+				!= nLastGeneration;
+		} );
+	}
+
+	Threads::leaveAudioWorkgroup();
+}
+
+};
@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <core/Object.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Maximum number of threads a H2Core::WorkerPool will spawn.*/
+#define MAX_WORKER_THREADS 16
+
+namespace H2Core
+{
+
+/**
+ * Fixed pool of realtime worker threads helping the audio engine to
+ * split the work of a process cycle.
+ *
+ * The calling thread hands a number of independent tasks to run(),
+ * participates in their execution itself, and returns as soon as all
+ * of them are done. Tasks are claimed using a single atomic
+ * word. Since the calling thread keeps on claiming tasks until none
+ * is left, a worker being late to wake up does only cost parallelism
+ * but never stalls the cycle.
+ *
+ * Neither run() nor the claiming of tasks do allocate memory or
+ * acquire a lock.
+ */
+class WorkerPool : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Function executed for each task. @a nTask is in [0, nTasks)
+		of the corresponding run() call.*/
+	typedef void (*Task)( int nTask, void* pArg );
+
+	/**
+	 * \param nWorkers Number of threads to spawn in addition to the
+	 * one calling run(). Capped at #MAX_WORKER_THREADS.
+	 */
+	WorkerPool( int nWorkers );
+	~WorkerPool();
+
+	/** \return Number of spawned worker threads.*/
+	int getNumberOfWorkers() const;
+
+	/**
+	 * Executes @a task for all indices in [0, @a nTasks) and returns
+	 * once all of them are done.
+	 *
+	 * Must not be called concurrently.
+	 *
+	 * \param nTasks Number of tasks. Must be smaller than 65536.
+	 * \param task Function to call.
+	 * \param pArg Passed to @a task.
+	 */
+	void run( int nTasks, Task task, void* pArg );
+
+private:
+	/** Claims and executes tasks of generation @a nGeneration until
+		none of them is left.*/
+	void work( uint32_t nGeneration );
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+
+	/** Generation (upper 32 bits), number of tasks (bits 16-31),
+		and index of the next unclaimed task (lower 16 bits) of the
+		current run().*/
+	alignas(64) std::atomic<uint64_t> m_nState;
+	/** Number of tasks finished in the current run().*/
+	alignas(64) std::atomic<int> m_nFinishedTasks;
+
+	Task m_task;
+	void* m_pArg;
+
+	std::atomic<bool> m_bQuit;
+
+	/** Used by idle workers to sleep. The calling thread of run()
+		does only notify without acquiring it.*/
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
+
+inline int WorkerPool::getNumberOfWorkers() const {
+	return m_workers.size();
+}
+
+};
+
+#endif
@@ -36,6 +36,7 @@ namespace H2Core
 
 class Song;
 class Instrument;
+class NoteStream;
 
 class SMFHeader : public SMFBase, public H2Core::Object
 {
@@ -45,7 +46,7 @@ public:
 	~SMFHeader();
 	
 	void addTrack();
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 	
 private:
 	int m_nFormat;		///< SMF format
@@ -64,8 +65,9 @@ public:
 	~SMFTrack();
 
 	void addEvent( SMFEvent *pEvent );
+	int getEventCount() const;
 
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 private:
 	std::vector<SMFEvent*> m_eventList;
@@ -81,7 +83,7 @@ public:
 	~SMF();
 
 	void addTrack( SMFTrack *pTrack );
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 private:
 	std::vector<SMFTrack*> m_trackList;
@@ -101,6 +103,10 @@ public:
 	SMFWriter( const char* sWriterName );
 	virtual ~SMFWriter();
 	void save( const QString& sFilename, Song *pSong );
+	/** Writes the notes of @a notes, which has to be gathered from
+		@a pSong. Lets several writers share a single traversal of
+		the song.*/
+	void save( const QString& sFilename, Song *pSong, const NoteStream& notes );
 
 protected:
 	void sortEvents( EventList* pEventList );
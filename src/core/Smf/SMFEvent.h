@@ -42,6 +42,9 @@ public:
 	void writeDWord( long nVal );
 	void writeString( const QString& sMsg );
 	void writeVarLen( long nVal );
+	/** Overwrites four bytes at @a nOffset, e.g. the length of a
+		chunk which is only known once its content was written.*/
+	void writeDWordAt( size_t nOffset, long nVal );
 
 	std::vector<char> m_buffer;
 
@@ -77,7 +80,8 @@ class SMFBase
 {
 public:
 	virtual ~SMFBase() {}
-	virtual std::vector<char> getBuffer() = 0;
+	/** Appends the binary representation to @a buffer.*/
+	virtual void write( SMFBuffer& buffer ) = 0;
 };
 
 
@@ -100,7 +104,7 @@ class SMFTrackNameMetaEvent : public SMFEvent
 	H2_OBJECT
 public:
 	SMFTrackNameMetaEvent( const QString& sTrackName, unsigned nDeltaTime );
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 private:
 	QString m_sTrackName;
@@ -114,7 +118,7 @@ class SMFSetTempoMetaEvent : public SMFEvent
 	H2_OBJECT
 public:
 	SMFSetTempoMetaEvent( float fBPM, unsigned nDeltaTime );
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 private:
 	unsigned m_fBPM;
@@ -128,7 +132,7 @@ class SMFCopyRightNoticeMetaEvent : public SMFEvent
 	H2_OBJECT
 public:
 	SMFCopyRightNoticeMetaEvent( const QString& sAuthor, unsigned nDeltaTime );
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 private:
 	QString m_sAuthor;
@@ -142,7 +146,7 @@ class SMFTimeSignatureMetaEvent : public SMFEvent
 	H2_OBJECT
 public:
 	SMFTimeSignatureMetaEvent( unsigned nBeats, unsigned nNote , unsigned nMTPMC , unsigned nTSNP24 , unsigned nTicks );
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 	// MTPMC = MIDI ticks per metronome click
 	// TSNP24 = Thirty Second Notes Per 24 MIDI Ticks.
 private:
@@ -157,7 +161,7 @@ class SMFNoteOnEvent : public SMFEvent
 public:
 	SMFNoteOnEvent( unsigned nTicks, int nChannel, int nPitch, int nVelocity );
 
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 protected:
 	unsigned m_nChannel;
@@ -173,7 +177,7 @@ class SMFNoteOffEvent : public SMFEvent
 public:
 	SMFNoteOffEvent(  unsigned nTicks, int nChannel, int nPitch, int nVelocity );
 
-	virtual std::vector<char> getBuffer();
+	virtual void write( SMFBuffer& buffer );
 
 protected:
 	unsigned m_nChannel;
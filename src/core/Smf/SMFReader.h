@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef SMF_READER_H
+#define SMF_READER_H
+
+#include <core/Object.h>
+
+#include <QString>
+#include <vector>
+
+class QIODevice;
+
+namespace H2Core
+{
+
+class InstrumentList;
+class Note;
+class Pattern;
+
+/**
+ * Imports Standard MIDI Files of type 0 and 1 into Patterns.
+ *
+ * The file is read chunk by chunk and only a single track is held in
+ * memory at a time. Note-on events of all channels are mapped onto
+ * the instruments via their MIDI out note - the one used by the
+ * SMFWriter as well - using the lookup table of
+ * InstrumentList::findMidiNoteIndex(). Notes without a matching
+ * instrument are dropped. Positions are quantized to the resolution
+ * of the Song and all notes of a file are added to their Pattern in
+ * a single Pattern::insert_notes().
+ *
+ * The length of the resulting Pattern is rounded up to full bars of
+ * the first time signature found in the file (4/4 if there is none).
+ */
+class SMFReader : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/**
+	 * \param pInstrumentList Instruments the notes are mapped onto.
+	 * \param nResolution Ticks per quarter note of the Song the
+	 * patterns are imported into.
+	 */
+	SMFReader( InstrumentList* pInstrumentList, int nResolution );
+	~SMFReader();
+
+	/**
+	 * Reads @a sFilename into a new Pattern named after the file.
+	 *
+	 * \return nullptr if the file could not be read or is neither
+	 * of type 0 nor 1.
+	 */
+	Pattern* import( const QString& sFilename );
+	/**
+	 * Imports all files with a .mid or .midi extension directly
+	 * contained in @a sDirectory, in alphabetical order. Files
+	 * which can not be read are skipped.
+	 */
+	std::vector<Pattern*> importDirectory( const QString& sDirectory );
+
+private:
+	/**
+	 * Parses the events of a single track and appends a Note for
+	 * each mapped note-on to #m_notes.
+	 *
+	 * \return false if the track data is truncated.
+	 */
+	bool readTrack( const QByteArray& track );
+	/** Reads a variable-length quantity starting at @a nPos.
+		\return -1 if @a data ends before.*/
+	static int readVarLen( const QByteArray& data, int& nPos );
+	/** Reads @a nBytes big-endian bytes from @a pDevice.
+		\return -1 on failure.*/
+	static qint64 readNumber( QIODevice* pDevice, int nBytes );
+	/** Deletes all notes in #m_notes.*/
+	void clearNotes();
+
+	InstrumentList* m_pInstrumentList;
+	int m_nResolution;
+	/** Ticks per quarter note of the file currently read.*/
+	int m_nTPQN;
+	/** First time signature of the file currently read as
+		numerator and denominator. 0 if none was found yet.*/
+	int m_nNumerator;
+	int m_nDenominator;
+	/** Notes of the file currently read.*/
+	std::vector<Note*> m_notes;
+	/** Quantized position of the latest note in #m_notes.*/
+	int m_nLastTick;
+	/** Number of notes without matching instrument.*/
+	int m_nUnmapped;
+};
+
+};
+
+#endif
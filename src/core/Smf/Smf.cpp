@@ -28,6 +28,8 @@
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/AutomationPath.h>
+#include <core/Basics/NoteStream.h>
+#include <algorithm>
 #include <fstream>
 
 namespace H2Core
@@ -54,17 +56,13 @@ void SMFHeader::addTrack() {
 	m_nTracks++;	
 }
 
-std::vector<char> SMFHeader::getBuffer()
+void SMFHeader::write( SMFBuffer& buffer )
 {
-	SMFBuffer buffer;
-
 	buffer.writeDWord( 1297377380 );		// MThd
 	buffer.writeDWord( 6 );				// Header length = 6
 	buffer.writeWord( m_nFormat );
 	buffer.writeWord( m_nTracks );
 	buffer.writeWord( m_nTPQN );
-
-	return buffer.m_buffer;
 }
 
 
@@ -94,43 +92,24 @@ SMFTrack::~SMFTrack()
 
 
 
-std::vector<char> SMFTrack::getBuffer()
+void SMFTrack::write( SMFBuffer& buffer )
 {
-	// fill the data vector
-	std::vector<char> trackData;
-
-	for ( unsigned i = 0; i < m_eventList.size(); i++ ) {
-		SMFEvent *pEv = m_eventList[ i ];
-		std::vector<char> buf = pEv->getBuffer();
-
-		// copy the buffer into the data vector
-		for ( unsigned j = 0; j < buf.size(); j++ ) {
-			trackData.push_back( buf[ j ] );
-		}
-	}
-
-
-	SMFBuffer buf;
+	buffer.writeDWord( 1297379947 );		// MTrk
+	// The track length is filled in once all events are written.
+	size_t nLengthOffset = buffer.m_buffer.size();
+	buffer.writeDWord( 0 );
 
-	buf.writeDWord( 1297379947 );		// MTrk
-	buf.writeDWord( trackData.size() + 4 );	// Track length
-
-	std::vector<char> trackBuf = buf.getBuffer();
-
-	for ( unsigned i = 0; i < trackData.size(); i++ ) {
-		trackBuf.push_back( trackData[i] );
+	for ( auto pEvent : m_eventList ) {
+		pEvent->write( buffer );
 	}
 
-
 	//  track end
-	trackBuf.push_back( 0x00 );		// delta
-	trackBuf.push_back( 0xFF );
-	trackBuf.push_back( 0x2F );
-	trackBuf.push_back( 0x00 );
-
-
+	buffer.writeByte( 0x00 );		// delta
+	buffer.writeByte( 0xFF );
+	buffer.writeByte( 0x2F );
+	buffer.writeByte( 0x00 );
 
-	return trackBuf;
+	buffer.writeDWordAt( nLengthOffset, buffer.m_buffer.size() - nLengthOffset - 4 );
 }
 
 
@@ -142,6 +121,13 @@ void SMFTrack::addEvent( SMFEvent *pEvent )
 
 
 
+int SMFTrack::getEventCount() const
+{
+	return m_eventList.size();
+}
+
+
+
 // ::::::::::::::::::::::
 
 const char* SMF::__class_name = "SMF";
@@ -177,27 +163,20 @@ void SMF::addTrack( SMFTrack *pTrack )
 
 
 
-std::vector<char> SMF::getBuffer()
+void SMF::write( SMFBuffer& buffer )
 {
-	std::vector<char> smfVect;
-
-	// header
-	std::vector<char> headerVect = m_pHeader->getBuffer();
-	for ( unsigned i = 0; i < headerVect.size(); i++ ) {
-		smfVect.push_back( headerVect[ i ] );
+	// Note events take four bytes mostly, meta events a few more.
+	// Reserving ahead avoids reallocating the buffer while writing.
+	size_t nSize = 14;
+	for ( auto pTrack : m_trackList ) {
+		nSize += 12 + 5 * pTrack->getEventCount();
 	}
+	buffer.m_buffer.reserve( buffer.m_buffer.size() + nSize );
 
-
-	// tracks
-	for ( unsigned nTrack = 0; nTrack < m_trackList.size(); nTrack++ ) {
-		SMFTrack *pTrack = m_trackList[ nTrack ];
-		std::vector<char> trackVect = pTrack->getBuffer();
-		for ( unsigned i = 0; i < trackVect.size(); i++ ) {
-			smfVect.push_back( trackVect[ i ] );
-		}
+	m_pHeader->write( buffer );
+	for ( auto pTrack : m_trackList ) {
+		pTrack->write( buffer );
 	}
-
-	return smfVect;
 }
 
 
@@ -234,89 +213,78 @@ SMFTrack* SMFWriter::createTrack0( Song* pSong ) {
 
 
 void SMFWriter::save( const QString& sFilename, Song *pSong )
+{
+	save( sFilename, pSong, NoteStream( *pSong ) );
+}
+
+
+void SMFWriter::save( const QString& sFilename, Song *pSong, const NoteStream& notes )
 {
 	INFOLOG( "save" );
 
 	SMF* pSmf = createSMF( pSong );
 
-	AutomationPath* pAutomationPath = pSong->getVelocityAutomationPath();
+	AutomationPath::Cursor velocityAutomation( pSong->getVelocityAutomationPath() );
 
 	// here writers must prepare to receive pattern events
 	prepareEvents( pSong, pSmf );
 
-	InstrumentList* pInstrumentList = pSong->getInstrumentList();
-	// ogni pattern sara' una diversa traccia
-	int nTick = 1;
-	for ( unsigned nPatternList = 0 ;
-		  nPatternList < pSong->getPatternGroupVector()->size() ;
-		  nPatternList++ ) {
-		// infoLog( "[save] pattern list pos: " + toString( nPatternList ) );
-		PatternList *pPatternList =
-			( *(pSong->getPatternGroupVector()) )[ nPatternList ];
-
-		int nStartTicks = nTick;
-		int nMaxPatternLength = 0;
-		for ( unsigned nPattern = 0 ;
-			  nPattern < pPatternList->size() ;
-			  nPattern++ ) {
-			Pattern *pPattern = pPatternList->get( nPattern );
-			// infoLog( "      |-> pattern: " + pPattern->getName() );
-			if ( ( int )pPattern->get_length() > nMaxPatternLength ) {
-				nMaxPatternLength = pPattern->get_length();
-			}
-
-			for ( unsigned nNote = 0; nNote < pPattern->get_length(); nNote++ ) {
-				const Pattern::notes_t* notes = pPattern->get_notes();
-				FOREACH_NOTE_CST_IT_BOUND(notes,it,nNote) {
-					Note *pNote = it->second;
-					if ( pNote ) {
-						float rnd = (float)rand()/(float)RAND_MAX;
-						if ( pNote->get_probability() < rnd ) {
-							continue;
-						}
-
-						float fPos = nPatternList + (float)nNote/(float)nMaxPatternLength;
-						float fVelocityAdjustment =  pAutomationPath->get_value(fPos);
-						int nVelocity =
-							(int)( 127.0 * pNote->get_velocity() * fVelocityAdjustment );
-
-						Instrument *pInstr = pNote->get_instrument();
-						int nPitch = pNote->get_midi_key();
-						
-						int nChannel =  pInstr->get_midi_out_channel();
-						if ( nChannel == -1 ) {
-							nChannel = DRUM_CHANNEL;
-						}
-						
-						int nLength = pNote->get_length();
-						if ( nLength == -1 ) {
-							nLength = NOTE_LENGTH;
-						}
-						
-						// get events for specific instrument
-						EventList* eventList = getEvents(pSong, pInstr);
-						eventList->push_back(
-							new SMFNoteOnEvent(
-								nStartTicks + nNote,
-								nChannel,
-								nPitch,
-								nVelocity
-								)
-							);
-							
-						eventList->push_back(
-							new SMFNoteOffEvent(
-								nStartTicks + nNote + nLength,
-								nChannel,
-								nPitch,
-								nVelocity
-								)
-							);
-					}
-				}
-			}
+	const std::vector<NoteStream::Column>& columns = notes.getColumns();
+	for ( const auto& entry : notes.getEntries() ) {
+		const NoteStream::Column& column = columns[ entry.nColumn ];
+		Note *pNote = entry.pNote;
+
+		float rnd = (float)rand()/(float)RAND_MAX;
+		if ( pNote->get_probability() < rnd ) {
+			continue;
 		}
-		nTick += nMaxPatternLength;
+
+		// Events start at tick 1. The position used to look up the
+		// velocity automation is relative to the longest of the
+		// patterns up to the one holding the note.
+		int nStartTicks = column.nStartTick + 1;
+		int nMaxPatternLength =
+			*std::max_element( column.patternLengths.begin(),
+							   column.patternLengths.begin() + entry.nPattern + 1 );
+		int nNote = entry.nPosition;
+
+		float fPos = entry.nColumn + (float)nNote/(float)nMaxPatternLength;
+		float fVelocityAdjustment =  velocityAutomation.get_value(fPos);
+		int nVelocity =
+			(int)( 127.0 * pNote->get_velocity() * fVelocityAdjustment );
+
+		Instrument *pInstr = pNote->get_instrument();
+		int nPitch = pNote->get_midi_key();
+
+		int nChannel =  pInstr->get_midi_out_channel();
+		if ( nChannel == -1 ) {
+			nChannel = DRUM_CHANNEL;
+		}
+
+		int nLength = pNote->get_length();
+		if ( nLength == -1 ) {
+			nLength = NOTE_LENGTH;
+		}
+
+		// get events for specific instrument
+		EventList* eventList = getEvents(pSong, pInstr);
+		eventList->push_back(
+			new SMFNoteOnEvent(
+				nStartTicks + nNote,
+				nChannel,
+				nPitch,
+				nVelocity
+				)
+			);
+
+		eventList->push_back(
+			new SMFNoteOffEvent(
+				nStartTicks + nNote + nLength,
+				nChannel,
+				nPitch,
+				nVelocity
+				)
+			);
 	}
 
 	//tracks creation
@@ -329,20 +297,12 @@ void SMFWriter::save( const QString& sFilename, Song *pSong )
 
 void SMFWriter::sortEvents( EventList *pEvents )
 {
-	// awful bubble sort..
-	for ( unsigned i = 0; i < pEvents->size(); i++ ) {
-		for ( std::vector<SMFEvent*>::iterator it = pEvents->begin() ;
-			  it != ( pEvents->end() - 1 ) ;
-			  it++ ) {
-			SMFEvent *pEvent = *it;
-			SMFEvent *pNextEvent = *( it + 1 );
-			if ( pNextEvent->m_nTicks < pEvent->m_nTicks ) {
-				// swap
-				*it = pNextEvent;
-				*( it +1 ) = pEvent;
-			}
-		}
-	}
+	// Events at the same tick have to keep their order, e.g. the
+	// note off of a note preceding the note on of the next one.
+	std::stable_sort( pEvents->begin(), pEvents->end(),
+					  []( SMFEvent* pA, SMFEvent* pB ) {
+						  return pA->m_nTicks < pB->m_nTicks;
+					  });
 }
 
 
@@ -352,12 +312,15 @@ void SMFWriter::saveSMF( const QString& sFilename, SMF*  pSmf )
 	FILE* pFile = fopen( sFilename.toLocal8Bit(), "wb" );
 
 	if( pFile == nullptr ) {
+		ERRORLOG( QString( "Unable to open %1 for writing" ).arg( sFilename ) );
 		return;
 	}
 
-	std::vector<char> smfVect = pSmf->getBuffer();
-	for ( unsigned i = 0; i < smfVect.size(); i++ ) {
-		fwrite( &smfVect[ i ], 1, 1, pFile );
+	SMFBuffer buffer;
+	pSmf->write( buffer );
+	if ( fwrite( buffer.m_buffer.data(), 1, buffer.m_buffer.size(), pFile ) !=
+		 buffer.m_buffer.size() ) {
+		ERRORLOG( QString( "Unable to write %1" ).arg( sFilename ) );
 	}
 	fclose( pFile );
 }
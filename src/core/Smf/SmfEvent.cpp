@@ -57,14 +57,24 @@ void SMFBuffer::writeDWord( long nVal )
 
 
 
+void SMFBuffer::writeDWordAt( size_t nOffset, long nVal )
+{
+	m_buffer[ nOffset ] = nVal >> 24;
+	m_buffer[ nOffset + 1 ] = nVal >> 16;
+	m_buffer[ nOffset + 2 ] = nVal >> 8;
+	m_buffer[ nOffset + 3 ] = nVal;
+}
+
+
+
 void SMFBuffer::writeString( const QString& sMsg )
 {
 //	infoLog( "writeString" );
-	writeVarLen( sMsg.length() );
-
-	for ( int i = 0; i < sMsg.length(); i++ ) {
-				writeByte( sMsg.toLocal8Bit().at(i) );
-	}
+	// The length is the one of the encoded string, which differs
+	// from the number of characters for non-ASCII ones.
+	QByteArray msg = sMsg.toLocal8Bit();
+	writeVarLen( msg.size() );
+	m_buffer.insert( m_buffer.end(), msg.constData(), msg.constData() + msg.size() );
 }
 
 
@@ -75,7 +85,6 @@ void SMFBuffer::writeVarLen( long value )
 	long buffer;
 	buffer = value & 0x7f;
 	while ( ( value >>= 7 ) > 0 ) {
-		INFOLOG( "." );
 		buffer <<= 8;
 		buffer |= 0x80;
 		buffer += ( value & 0x7f );
@@ -106,15 +115,12 @@ SMFTrackNameMetaEvent::SMFTrackNameMetaEvent( const QString& sTrackName, unsigne
 }
 
 
-std::vector<char> SMFTrackNameMetaEvent::getBuffer()
+void SMFTrackNameMetaEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
 	buf.writeVarLen( m_nDeltaTime );
 	buf.writeByte( 0xFF );
 	buf.writeByte( TRACK_NAME );
 	buf.writeString( m_sTrackName );
-
-	return buf.getBuffer();
 }
 
 // ::::::::::::::::::
@@ -130,9 +136,8 @@ SMFSetTempoMetaEvent::SMFSetTempoMetaEvent( float fBPM, unsigned nTicks )
 }
 
 
-std::vector<char> SMFSetTempoMetaEvent::getBuffer()
+void SMFSetTempoMetaEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
 	long msPerBeat;
 	
 	msPerBeat = long( 60000000 / m_fBPM ); // 60 seconds * mills \ BPM
@@ -145,8 +150,6 @@ std::vector<char> SMFSetTempoMetaEvent::getBuffer()
 	buf.writeByte( msPerBeat >> 16 );
 	buf.writeByte( msPerBeat >> 8 );
 	buf.writeByte( msPerBeat );
-	
-	return buf.getBuffer();
 }
 
 // ::::::::::::::::::
@@ -162,9 +165,8 @@ SMFCopyRightNoticeMetaEvent::SMFCopyRightNoticeMetaEvent( const QString& sAuthor
 }
 
 
-std::vector<char> SMFCopyRightNoticeMetaEvent::getBuffer()
+void SMFCopyRightNoticeMetaEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
 	QString sCopyRightString;
 	
 	time_t now = time(nullptr);
@@ -180,8 +182,6 @@ std::vector<char> SMFCopyRightNoticeMetaEvent::getBuffer()
 	buf.writeByte( 0xFF );
 	buf.writeByte( COPYRIGHT_NOTICE );
 	buf.writeString( sCopyRightString );
-
-	return buf.getBuffer();
 }
 
 // ::::::::::::::::::
@@ -202,10 +202,8 @@ SMFTimeSignatureMetaEvent::SMFTimeSignatureMetaEvent( unsigned nBeats, unsigned
 }
 
 
-std::vector<char> SMFTimeSignatureMetaEvent::getBuffer()
+void SMFTimeSignatureMetaEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
-	
 	unsigned nBeatsCopy = m_nNote , Note2Log =  0;	// Copy Nbeats as the process to generate Note2Log alters the value.
 	
 	while (nBeatsCopy >>= 1) ++Note2Log;			// Generate a log to base 2 of the note value, so 8 (as in 6/8) becomes 3
@@ -219,7 +217,6 @@ std::vector<char> SMFTimeSignatureMetaEvent::getBuffer()
 	buf.writeByte( m_nMTPMC );	// MIDI Ticks per Metronome click, normally 24 ( i.e. each quarter note ).
 	buf.writeByte( m_nTSNP24 );	// Thirty Second Notes ( as in 1/32 ) per 24 MIDI clocks, normally 8.
 
-	return buf.getBuffer();
 }
 
 // :::::::::::::
@@ -258,15 +255,12 @@ SMFNoteOnEvent::SMFNoteOnEvent( unsigned nTicks, int nChannel, int nPitch, int n
 
 
 
-std::vector<char> SMFNoteOnEvent::getBuffer()
+void SMFNoteOnEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
 	buf.writeVarLen( m_nDeltaTime );
 	buf.writeByte( NOTE_ON + m_nChannel );
 	buf.writeByte( m_nPitch );
 	buf.writeByte( m_nVelocity );
-
-	return buf.getBuffer();
 }
 
 
@@ -288,15 +282,12 @@ SMFNoteOffEvent::SMFNoteOffEvent( unsigned nTicks, int nChannel, int nPitch, int
 
 
 
-std::vector<char> SMFNoteOffEvent::getBuffer()
+void SMFNoteOffEvent::write( SMFBuffer& buf )
 {
-	SMFBuffer buf;
 	buf.writeVarLen( m_nDeltaTime );
 	buf.writeByte( NOTE_OFF + m_nChannel );
 	buf.writeByte( m_nPitch );
 	buf.writeByte( m_nVelocity );
-
-	return buf.getBuffer();
 }
 
 };
@@ -0,0 +1,314 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Smf/SMFReader.h>
+#include <core/Smf/SMFEvent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* SMFReader::__class_name = "SMFReader";
+
+SMFReader::SMFReader( InstrumentList* pInstrumentList, int nResolution )
+	: Object( __class_name )
+	, m_pInstrumentList( pInstrumentList )
+	, m_nResolution( nResolution )
+	, m_nTPQN( 0 )
+	, m_nNumerator( 0 )
+	, m_nDenominator( 0 )
+	, m_nLastTick( 0 )
+	, m_nUnmapped( 0 )
+{
+}
+
+SMFReader::~SMFReader()
+{
+	clearNotes();
+}
+
+Pattern* SMFReader::import( const QString& sFilename )
+{
+	QFile file( sFilename );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open %1" ).arg( sFilename ) );
+		return nullptr;
+	}
+
+	QByteArray chunkType = file.read( 4 );
+	qint64 nHeaderLength = readNumber( &file, 4 );
+	if ( chunkType != "MThd" || nHeaderLength < 6 ) {
+		ERRORLOG( QString( "%1 is not a Standard MIDI File" ).arg( sFilename ) );
+		return nullptr;
+	}
+	int nFormat = readNumber( &file, 2 );
+	int nTracks = readNumber( &file, 2 );
+	int nDivision = readNumber( &file, 2 );
+	if ( nFormat != 0 && nFormat != 1 ) {
+		ERRORLOG( QString( "Unsupported SMF type [%1] of %2" ).arg( nFormat ).arg( sFilename ) );
+		return nullptr;
+	}
+	if ( nDivision <= 0 || ( nDivision & 0x8000 ) ) {
+		ERRORLOG( QString( "Unsupported time division of %1" ).arg( sFilename ) );
+		return nullptr;
+	}
+
+	m_nTPQN = nDivision;
+	m_nNumerator = 0;
+	m_nDenominator = 0;
+	m_nLastTick = 0;
+	m_nUnmapped = 0;
+	clearNotes();
+
+	// The header might be longer than the six bytes defined so far.
+	file.seek( 8 + nHeaderLength );
+
+	int nTrack = 0;
+	while ( nTrack < nTracks && ! file.atEnd() ) {
+		chunkType = file.read( 4 );
+		qint64 nLength = readNumber( &file, 4 );
+		if ( chunkType.size() != 4 || nLength < 0 ) {
+			break;
+		}
+		if ( chunkType != "MTrk" ) {
+			// Unknown chunks have to be skipped.
+			file.seek( file.pos() + nLength );
+			continue;
+		}
+
+		QByteArray track = file.read( nLength );
+		if ( track.size() != nLength || ! readTrack( track ) ) {
+			WARNINGLOG( QString( "Track %1 of %2 is truncated" ).arg( nTrack ).arg( sFilename ) );
+		}
+		++nTrack;
+	}
+
+	if ( m_nUnmapped > 0 ) {
+		WARNINGLOG( QString( "%1 notes of %2 do not match the MIDI out note of any instrument" )
+					.arg( m_nUnmapped ).arg( sFilename ) );
+	}
+
+	int nDenominator = m_nDenominator > 0 ? m_nDenominator : 4;
+	int nBarLength = m_nNumerator > 0 ?
+		m_nNumerator * 4 * m_nResolution / nDenominator : 4 * m_nResolution;
+	int nBars = std::max( 1, ( m_nLastTick + nBarLength ) / nBarLength );
+
+	Pattern* pPattern = new Pattern( QFileInfo( sFilename ).completeBaseName(), "",
+									 "not_categorized", nBars * nBarLength, nDenominator );
+
+	// Notes of the same instrument quantized to the same tick would
+	// be triggered twice. Only the loudest is kept.
+	std::stable_sort( m_notes.begin(), m_notes.end(), []( Note* pA, Note* pB ) {
+		return pA->get_position() < pB->get_position();
+	});
+	std::vector<Note*> notes;
+	notes.reserve( m_notes.size() );
+	size_t nFirstAtTick = 0;
+	for ( Note* pNote : m_notes ) {
+		if ( ! notes.empty() && notes.back()->get_position() != pNote->get_position() ) {
+			nFirstAtTick = notes.size();
+		}
+		Note* pDuplicate = nullptr;
+		for ( size_t ii = nFirstAtTick; ii < notes.size(); ++ii ) {
+			if ( notes[ ii ]->get_instrument() == pNote->get_instrument() ) {
+				pDuplicate = notes[ ii ];
+				break;
+			}
+		}
+		if ( pDuplicate == nullptr ) {
+			notes.push_back( pNote );
+			continue;
+		}
+		if ( pNote->get_velocity() > pDuplicate->get_velocity() ) {
+			pDuplicate->set_velocity( pNote->get_velocity() );
+		}
+		delete pNote;
+	}
+	m_notes.clear();
+
+	pPattern->insert_notes( notes );
+
+	INFOLOG( QString( "Imported %1 notes from %2" ).arg( notes.size() ).arg( sFilename ) );
+	return pPattern;
+}
+
+std::vector<Pattern*> SMFReader::importDirectory( const QString& sDirectory )
+{
+	std::vector<Pattern*> patterns;
+
+	QDir dir( sDirectory );
+	QStringList files = dir.entryList( QStringList() << "*.mid" << "*.midi" << "*.MID" << "*.MIDI",
+									   QDir::Files | QDir::Readable, QDir::Name );
+	for ( const QString& sFile : files ) {
+		Pattern* pPattern = import( dir.absoluteFilePath( sFile ) );
+		if ( pPattern != nullptr ) {
+			patterns.push_back( pPattern );
+		}
+	}
+
+	return patterns;
+}
+
+bool SMFReader::readTrack( const QByteArray& track )
+{
+	const unsigned char* pData = reinterpret_cast<const unsigned char*>( track.constData() );
+	int nSize = track.size();
+	int nPos = 0;
+	long long nTicks = 0;
+	int nStatus = 0;
+
+	while ( nPos < nSize ) {
+		int nDelta = readVarLen( track, nPos );
+		if ( nDelta < 0 || nPos >= nSize ) {
+			return false;
+		}
+		nTicks += nDelta;
+
+		int nByte = pData[ nPos ];
+		if ( nByte >= 0x80 ) {
+			++nPos;
+			if ( nByte < 0xF0 ) {
+				nStatus = nByte;
+			}
+		} else if ( nStatus == 0 ) {
+			// Running status without any preceding status byte.
+			return false;
+		} else {
+			nByte = nStatus;
+		}
+
+		if ( nByte == 0xFF ) {
+			// Meta event. Ends any running status.
+			nStatus = 0;
+			if ( nPos >= nSize ) {
+				return false;
+			}
+			int nType = pData[ nPos++ ];
+			int nLength = readVarLen( track, nPos );
+			if ( nLength < 0 || nPos + nLength > nSize ) {
+				return false;
+			}
+			if ( nType == END_OF_TRACK ) {
+				return true;
+			}
+			if ( nType == TIME_SIGNATURE && nLength >= 2 && m_nNumerator == 0 ) {
+				m_nNumerator = pData[ nPos ];
+				m_nDenominator = 1 << std::min<int>( pData[ nPos + 1 ], 6 );
+			}
+			nPos += nLength;
+			continue;
+		}
+		if ( nByte == 0xF0 || nByte == 0xF7 ) {
+			// System exclusive message.
+			nStatus = 0;
+			int nLength = readVarLen( track, nPos );
+			if ( nLength < 0 || nPos + nLength > nSize ) {
+				return false;
+			}
+			nPos += nLength;
+			continue;
+		}
+		if ( nByte >= 0xF0 ) {
+			// System common messages are not allowed in files.
+			return false;
+		}
+
+		int nType = nByte & 0xF0;
+		int nDataBytes = ( nType == 0xC0 || nType == 0xD0 ) ? 1 : 2;
+		if ( nPos + nDataBytes > nSize ) {
+			return false;
+		}
+		int nKey = pData[ nPos ];
+		int nVelocity = nDataBytes > 1 ? pData[ nPos + 1 ] : 0;
+		nPos += nDataBytes;
+
+		if ( nType != NOTE_ON || nVelocity == 0 ) {
+			continue;
+		}
+
+		int nInstrument = m_pInstrumentList->findMidiNoteIndex( nKey );
+		if ( nInstrument < 0 ) {
+			++m_nUnmapped;
+			continue;
+		}
+
+		int nTick = static_cast<int>( std::llround( nTicks * static_cast<double>( m_nResolution ) /
+													m_nTPQN ) );
+		m_nLastTick = std::max( m_nLastTick, nTick );
+		m_notes.push_back( new Note( m_pInstrumentList->get( nInstrument ), nTick,
+									 nVelocity / 127.0f, 0.5f, 0.5f, -1, 0 ) );
+	}
+
+	// The end of track event is missing.
+	return true;
+}
+
+int SMFReader::readVarLen( const QByteArray& data, int& nPos )
+{
+	int nValue = 0;
+	// At most four bytes are allowed.
+	for ( int ii = 0; ii < 4; ++ii ) {
+		if ( nPos >= data.size() ) {
+			return -1;
+		}
+		unsigned char nByte = static_cast<unsigned char>( data[ nPos++ ] );
+		nValue = ( nValue << 7 ) | ( nByte & 0x7F );
+		if ( ! ( nByte & 0x80 ) ) {
+			return nValue;
+		}
+	}
+	return -1;
+}
+
+qint64 SMFReader::readNumber( QIODevice* pDevice, int nBytes )
+{
+	QByteArray bytes = pDevice->read( nBytes );
+	if ( bytes.size() != nBytes ) {
+		return -1;
+	}
+	qint64 nValue = 0;
+	for ( char byte : bytes ) {
+		nValue = ( nValue << 8 ) | static_cast<unsigned char>( byte );
+	}
+	return nValue;
+}
+
+void SMFReader::clearNotes()
+{
+	for ( Note* pNote : m_notes ) {
+		delete pNote;
+	}
+	m_notes.clear();
+}
+
+};
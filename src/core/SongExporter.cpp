@@ -0,0 +1,177 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/SongExporter.h>
+
+#include <core/Hydrogen.h>
+#include <core/Basics/NoteStream.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Threads.h>
+#include <core/Lilipond/Lilypond.h>
+#include <core/Smf/SMF.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <memory>
+
+namespace H2Core
+{
+
+const char* SongExporter::__class_name = "SongExporter";
+
+SongExporter::SongExporter()
+	: Object( __class_name )
+	, m_nPending( 0 )
+{
+}
+
+SongExporter::~SongExporter()
+{
+	finish();
+}
+
+bool SongExporter::start( const Job& job )
+{
+	if ( job.audioFilenames.isEmpty() && job.sMidiFilename.isEmpty() &&
+		 job.sLilyPondFilename.isEmpty() ) {
+		ERRORLOG( "Nothing to export" );
+		return false;
+	}
+	if ( ! startScores( job ) ) {
+		return false;
+	}
+	if ( job.audioFilenames.isEmpty() ) {
+		return true;
+	}
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	pHydrogen->startExportSession( job.nSampleRate, job.nSampleDepth );
+	for ( int ii = 1; ii < job.audioFilenames.size(); ++ii ) {
+		pHydrogen->addExportFile( job.audioFilenames[ ii ] );
+	}
+	pHydrogen->startExportSong( job.audioFilenames[ 0 ] );
+
+	return true;
+}
+
+bool SongExporter::startScores( const Job& job )
+{
+	finish();
+
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong == nullptr ) {
+		ERRORLOG( "No song to export" );
+		return false;
+	}
+
+	m_scoreFilenames.clear();
+	if ( job.sMidiFilename.isEmpty() && job.sLilyPondFilename.isEmpty() ) {
+		return true;
+	}
+
+	// Shared by all writers.
+	std::shared_ptr<const NoteStream> pNotes = std::make_shared<const NoteStream>( *pSong );
+
+	if ( ! job.sMidiFilename.isEmpty() ) {
+		const QString sFilename = job.sMidiFilename;
+		const MidiFormat format = job.midiFormat;
+		// A file left over from a previous export must not be
+		// mistaken for a written one in finish().
+		QFile::remove( sFilename );
+		m_scoreFilenames << sFilename;
+		++m_nPending;
+		m_threads.emplace_back( [this, pSong, pNotes, sFilename, format]() {
+			Threads::configureCurrentThread( Threads::Role::Background, "MIDI export" );
+			std::unique_ptr<SMFWriter> pWriter;
+			switch ( format ) {
+			case MIDI_SMF1_MULTI:
+				pWriter.reset( new SMF1WriterMulti );
+				break;
+			case MIDI_SMF0:
+				pWriter.reset( new SMF0Writer );
+				break;
+			default:
+				pWriter.reset( new SMF1WriterSingle );
+			}
+			pWriter->save( sFilename, pSong, *pNotes );
+			--m_nPending;
+		} );
+	}
+
+	if ( ! job.sLilyPondFilename.isEmpty() ) {
+		const QString sFilename = job.sLilyPondFilename;
+		QFile::remove( sFilename );
+		m_scoreFilenames << sFilename;
+		++m_nPending;
+		m_threads.emplace_back( [this, pSong, pNotes, sFilename]() {
+			Threads::configureCurrentThread( Threads::Role::Background, "LilyPond export" );
+			LilyPond ly;
+			ly.extractData( *pSong, *pNotes );
+			ly.write( sFilename );
+			--m_nPending;
+		} );
+	}
+
+	return true;
+}
+
+bool SongExporter::finish()
+{
+	for ( auto& thread : m_threads ) {
+		thread.join();
+	}
+	m_threads.clear();
+
+	bool bSuccess = true;
+	for ( const auto& sFilename : m_scoreFilenames ) {
+		if ( ! QFileInfo( sFilename ).exists() ) {
+			ERRORLOG( QString( "Unable to write [%1]" ).arg( sFilename ) );
+			bSuccess = false;
+		}
+	}
+	m_scoreFilenames.clear();
+
+	return bSuccess;
+}
+
+bool SongExporter::isFinished() const
+{
+	return m_nPending == 0;
+}
+
+void SongExporter::addFilenames( Job& job, const QStringList& filenames )
+{
+	for ( const auto& sFilename : filenames ) {
+		const QString sSuffix = QFileInfo( sFilename ).suffix().toLower();
+		if ( sSuffix == "mid" || sSuffix == "midi" ) {
+			job.sMidiFilename = sFilename;
+		} else if ( sSuffix == "ly" ) {
+			job.sLilyPondFilename = sFilename;
+		} else {
+			job.audioFilenames << sFilename;
+		}
+	}
+}
+
+};
@@ -0,0 +1,127 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SONG_EXPORTER_H
+#define H2C_SONG_EXPORTER_H
+
+#include <core/Object.h>
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * Exports the current song into audio, MIDI, and LilyPond files
+ * from a single invocation.
+ *
+ * The notes are gathered once into a NoteStream shared by the
+ * SMFWriter and LilyPond, which write their files in threads of
+ * their own. Meanwhile all audio files are rendered within a single
+ * export session, so the drivers are swapped only once.
+ *
+ * The song must not be modified until finish() returned.
+ */
+class SongExporter : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	/** Same order as Preferences::getMidiExportMode().*/
+	enum MidiFormat {
+		MIDI_SMF1_SINGLE = 0,
+		MIDI_SMF1_MULTI,
+		MIDI_SMF0
+	};
+
+	struct Job {
+		/** All rendered in the same pass. The format of each file
+			is derived from its suffix.*/
+		QStringList audioFilenames;
+		int nSampleRate = 44100;
+		int nSampleDepth = 16;
+		/** Empty for none.*/
+		QString sMidiFilename;
+		MidiFormat midiFormat = MIDI_SMF1_SINGLE;
+		/** Empty for none.*/
+		QString sLilyPondFilename;
+	};
+
+	SongExporter();
+	/** Waits for the MIDI and LilyPond files.*/
+	~SongExporter();
+
+	/**
+	 * Starts exporting @a job.
+	 *
+	 * Once the audio is rendered, #EVENT_PROGRESS is pushed with a
+	 * value of 100 and the caller has to end the session using
+	 * Hydrogen::stopExportSession() as for any other audio export.
+	 * The instruments to render have to be marked using
+	 * Instrument::set_currently_exported() beforehand.
+	 *
+	 * \return false if there is nothing to export or the song is
+	 * missing.
+	 */
+	bool start( const Job& job );
+	/**
+	 * Starts writing the MIDI and LilyPond files of @a job only.
+	 * Meant for callers setting up the audio export themselves,
+	 * e.g. to add stems. Should be called right before
+	 * Hydrogen::startExportSong() so both are written while the
+	 * audio is rendered.
+	 */
+	bool startScores( const Job& job );
+	/**
+	 * Blocks till the MIDI and LilyPond files are written.
+	 *
+	 * \return false if any of them could not be written.
+	 */
+	bool finish();
+	/** \return Whether the MIDI and LilyPond files are written.*/
+	bool isFinished() const;
+
+	/**
+	 * Sorts @a filenames into @a job by their suffixes. ".mid" and
+	 * ".midi" are exported as MIDI, ".ly" as LilyPond, and
+	 * everything else as audio. Only the last MIDI and LilyPond
+	 * file are kept.
+	 */
+	static void addFilenames( Job& job, const QStringList& filenames );
+
+private:
+	/** One per MIDI and LilyPond file.*/
+	std::vector<std::thread> m_threads;
+	/** Number of #m_threads still writing.*/
+	std::atomic<int> m_nPending;
+	/** Files written by #m_threads.*/
+	QStringList m_scoreFilenames;
+};
+
+};
+
+#endif
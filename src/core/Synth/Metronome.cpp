@@ -0,0 +1,166 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <core/Synth/Metronome.h>
+#include <core/AudioEngine.h>
+#include <core/Basics/Sample.h>
+#include <core/Helpers/Dsp.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* Metronome::__class_name = "Metronome";
+
+/** Pitch in semitones of the click marking the start of a bar. Matches
+	the pitch used for the accented metronome note in the past.*/
+static const float fAccentPitch = 3.0;
+
+Metronome::Metronome()
+		: Object( __class_name )
+		, m_nSampleRate( 0 )
+		, m_nPlayingVoices( 0 )
+{
+	INFOLOG( "INIT" );
+}
+
+Metronome::~Metronome()
+{
+	INFOLOG( "DESTROY" );
+}
+
+void Metronome::renderClick( std::shared_ptr<Sample> pSample, float fPitch,
+							 int nSampleRate, Click* pClick )
+{
+	const int nSampleFrames = pSample->get_frames();
+	const float* pData_L = pSample->get_data_l();
+	const float* pData_R = pSample->get_data_r();
+
+	// Same pitch to step conversion as used by the Sampler.
+	const double fStep = std::pow( 1.0594630943593, ( double )fPitch ) *
+		pSample->get_sample_rate() / nSampleRate;
+	const int nFrames = static_cast<int>( nSampleFrames / fStep );
+
+	pClick->data_L.resize( nFrames );
+	pClick->data_R.resize( nFrames );
+
+	for ( int ii = 0; ii < nFrames; ++ii ) {
+		const double fPos = ii * fStep;
+		const int nPos = static_cast<int>( fPos );
+		const float fFrac = fPos - nPos;
+		const int nNext = std::min( nPos + 1, nSampleFrames - 1 );
+
+		pClick->data_L[ ii ] = pData_L[ nPos ] +
+			fFrac * ( pData_L[ nNext ] - pData_L[ nPos ] );
+		pClick->data_R[ ii ] = pData_R[ nPos ] +
+			fFrac * ( pData_R[ nNext ] - pData_R[ nPos ] );
+	}
+}
+
+void Metronome::setSample( std::shared_ptr<Sample> pSample, int nSampleRate )
+{
+	Click accentClick, click;
+	if ( pSample != nullptr && pSample->get_frames() > 0 && nSampleRate > 0 ) {
+		renderClick( pSample, fAccentPitch, nSampleRate, &accentClick );
+		renderClick( pSample, 0, nSampleRate, &click );
+	} else {
+		nSampleRate = 0;
+	}
+
+	// The previous buffers are freed when leaving this function and
+	// thus outside of the lock.
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	std::swap( m_accentClick, accentClick );
+	std::swap( m_click, click );
+	m_nSampleRate = nSampleRate;
+	m_nPlayingVoices = 0;
+	AudioEngine::get_instance()->unlock();
+}
+
+void Metronome::trigger( int nTick, bool bAccent, float fGain )
+{
+	if ( m_nPlayingVoices >= MAX_METRONOME_VOICES ) {
+		// No logging. We are in the realtime thread.
+		return;
+	}
+
+	Voice* pVoice = &m_voices[ m_nPlayingVoices++ ];
+	pVoice->nTick = nTick;
+	pVoice->pClick = bAccent ? &m_accentClick : &m_click;
+	pVoice->fGain = fGain;
+}
+
+void Metronome::process( long long nFramepos, float fTickSize, int nSampleRate,
+						 float* pOut_L, float* pOut_R, uint32_t nFrames )
+{
+	if ( nSampleRate != m_nSampleRate ) {
+		// The driver was replaced but the clicks were not rendered
+		// for it yet.
+		return;
+	}
+
+	const long long nBufferEnd = nFramepos + nFrames;
+
+	int ii = 0;
+	while ( ii < m_nPlayingVoices ) {
+		Voice* pVoice = &m_voices[ ii ];
+		const long long nStart =
+			static_cast<long long>( pVoice->nTick * fTickSize );
+		const long long nEnd = nStart + pVoice->pClick->data_L.size();
+
+		if ( nStart >= nBufferEnd ) {
+			// Not due yet.
+			++ii;
+			continue;
+		}
+
+		if ( nEnd > nFramepos ) {
+			const long long nFrom = std::max( nStart, nFramepos );
+			const long long nTo = std::min( nEnd, nBufferEnd );
+			const uint32_t nOffset = nFrom - nFramepos;
+			const size_t nSrcOffset = nFrom - nStart;
+
+			Dsp::addWithGain( pOut_L + nOffset,
+							  pVoice->pClick->data_L.data() + nSrcOffset,
+							  pVoice->fGain, nTo - nFrom );
+			Dsp::addWithGain( pOut_R + nOffset,
+							  pVoice->pClick->data_R.data() + nSrcOffset,
+							  pVoice->fGain, nTo - nFrom );
+		}
+
+		if ( nEnd <= nBufferEnd ) {
+			m_voices[ ii ] = m_voices[ --m_nPlayingVoices ];
+		} else {
+			++ii;
+		}
+	}
+}
+
+void Metronome::stop()
+{
+	m_nPlayingVoices = 0;
+}
+
+};
@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef METRONOME_H
+#define METRONOME_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <core/Object.h>
+
+/** Maximum number of clicks the H2Core::Metronome plays at the same
+	time.*/
+#define MAX_METRONOME_VOICES 8
+
+namespace H2Core
+{
+class Sample;
+
+/**
+ * Lightweight click generator used for the metronome.
+ *
+ * Instead of queuing notes of the metronome instrument into the
+ * Sampler - where they compete with the song for polyphony and go
+ * through resampling, envelopes, and the mixer for every click - the
+ * click sample is rendered once for both the accented and the regular
+ * pitch at the sample rate of the audio driver. Clicks are then mixed
+ * at their exact frame position using plain gain-scaled additions.
+ *
+ * Neither trigger() nor process() allocate memory or acquire a lock.
+ */
+class Metronome : public H2Core::Object
+{
+	H2_OBJECT
+public:
+	Metronome();
+	~Metronome();
+
+	/**
+	 * Renders the cached clicks of @a pSample for a driver running
+	 * at @a nSampleRate.
+	 *
+	 * Allocates memory and must therefore not be called from the
+	 * realtime thread. The cached buffers are swapped in while
+	 * holding the AudioEngine lock.
+	 *
+	 * \param pSample Click sample. If nullptr, the metronome stays
+	 * silent.
+	 * \param nSampleRate Sample rate of the current audio driver.
+	 */
+	void setSample( std::shared_ptr<Sample> pSample, int nSampleRate );
+
+	/**
+	 * Schedules a click.
+	 *
+	 * \param nTick Transport position of the click in ticks.
+	 * \param bAccent Whether to play the click marking the start of
+	 * a bar.
+	 * \param fGain Linear gain of the click.
+	 */
+	void trigger( int nTick, bool bAccent, float fGain );
+
+	/**
+	 * Adds all clicks sounding during the current buffer to @a pOut_L
+	 * and @a pOut_R.
+	 *
+	 * \param nFramepos Frame position corresponding to the start of
+	 * the buffer.
+	 * \param fTickSize Number of frames per tick.
+	 * \param nSampleRate Sample rate of the audio driver. If it does
+	 * not match the rate the clicks were rendered at, nothing is
+	 * mixed.
+	 * \param nFrames Size of the buffer.
+	 */
+	void process( long long nFramepos, float fTickSize, int nSampleRate,
+				  float* pOut_L, float* pOut_R, uint32_t nFrames );
+
+	/** Discards all scheduled and sounding clicks.*/
+	void stop();
+
+	int getPlayingClicksNumber() const {
+		return m_nPlayingVoices;
+	}
+
+private:
+	struct Click {
+		std::vector<float> data_L;
+		std::vector<float> data_R;
+	};
+
+	struct Voice {
+		/** Transport position of the click in ticks.*/
+		int nTick;
+		/** Cached click to play.*/
+		const Click* pClick;
+		float fGain;
+	};
+
+	/** Resamples @a pSample shifted by @a fPitch semitones to
+		@a nSampleRate into @a pClick.*/
+	static void renderClick( std::shared_ptr<Sample> pSample, float fPitch,
+							 int nSampleRate, Click* pClick );
+
+	/** Clicks marking the start of a bar.*/
+	Click m_accentClick;
+	/** Clicks on all other beats.*/
+	Click m_click;
+	/** Sample rate the cached clicks were rendered at. 0 if there
+		are none.*/
+	int m_nSampleRate;
+
+	/** Voices currently scheduled or playing are stored in the first
+		#m_nPlayingVoices entries.*/
+	Voice m_voices[ MAX_METRONOME_VOICES ];
+	int m_nPlayingVoices;
+};
+
+} // namespace H2Core
+
+#endif
+
@@ -24,6 +24,8 @@
 #include <core/Synth/Synth.h>
 #include <core/Basics/Note.h>
 #include <core/Globals.h>
+#include <core/Helpers/Dsp.h>
+#include <core/IO/AudioOutput.h>
 
 #include <cassert>
 #include <cmath>
@@ -35,13 +37,18 @@ const char* Synth::__class_name = "Synth";
 
 Synth::Synth()
 		: Object( __class_name )
+		, m_nPlayingVoices( 0 )
 {
 	INFOLOG( "INIT" );
 
 	m_pOut_L = new float[ MAX_BUFFER_SIZE ];
 	m_pOut_R = new float[ MAX_BUFFER_SIZE ];
+	m_pVoiceBuffer = new float[ MAX_BUFFER_SIZE ];
 
-	m_fTheta = 0.0;
+	const int nTableSize = 1 << SYNTH_WAVETABLE_BITS;
+	for ( int i = 0; i <= nTableSize; ++i ) {
+		m_wavetable[ i ] = sin( TWOPI * ( i % nTableSize ) / nTableSize );
+	}
 
 	m_pAudioOutput = nullptr;
 }
@@ -51,8 +58,12 @@ Synth::Synth()
 Synth::~Synth()
 {
 	INFOLOG( "DESTROY" );
+	for ( int i = 0; i < m_nPlayingVoices; ++i ) {
+		delete m_voices[ i ].pNote;
+	}
 	delete[] m_pOut_L;
 	delete[] m_pOut_R;
+	delete[] m_pVoiceBuffer;
 }
 
 
@@ -63,7 +74,16 @@ void Synth::noteOn( Note* pNote )
 	INFOLOG( "NOTE ON" );
 	assert( pNote );
 
-	m_playingNotesQueue.push_back( pNote );
+	if ( m_nPlayingVoices >= MAX_SYNTH_VOICES ) {
+		ERRORLOG( "No free voice left" );
+		delete pNote;
+		return;
+	}
+
+	Voice* pVoice = &m_voices[ m_nPlayingVoices ];
+	pVoice->pNote = pNote;
+	pVoice->nPhase = 0;
+	++m_nPlayingVoices;
 }
 
 
@@ -75,15 +95,17 @@ void Synth::noteOff( Note* pNote )
 	assert( pNote );
 
 	// delete the older note...
-	for ( uint i = 0; i < m_playingNotesQueue.size(); ++i ) {
-		Note *pPlayingNote = m_playingNotesQueue[ i ];
+	for ( int i = 0; i < m_nPlayingVoices; ++i ) {
+		Note *pPlayingNote = m_voices[ i ].pNote;
 		if ( pPlayingNote->get_instrument() == pNote->get_instrument() ) {
-			m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
+			// Keep the playing voices contiguous.
+			--m_nPlayingVoices;
+			m_voices[ i ] = m_voices[ m_nPlayingVoices ];
 			delete pPlayingNote;
 
 			delete pNote;
 			pNote = nullptr;
-			break;
+			return;
 		}
 	}
 
@@ -92,29 +114,57 @@ void Synth::noteOff( Note* pNote )
 
 
 
+void Synth::renderVoice( Voice* pVoice, uint32_t nPhaseIncrement, uint32_t nFrames )
+{
+	const int nShift = 32 - SYNTH_WAVETABLE_BITS;
+	const uint32_t nFracMask = ( 1u << nShift ) - 1;
+	const float fFracScale = 1.0f / (float)( 1u << nShift );
+
+	uint32_t nPhase = pVoice->nPhase;
+
+	for ( uint32_t i = 0; i < nFrames; ++i ) {
+		uint32_t nIndex = nPhase >> nShift;
+		float fFrac = ( nPhase & nFracMask ) * fFracScale;
+		float fVal = m_wavetable[ nIndex ];
+		m_pVoiceBuffer[ i ] = fVal + fFrac * ( m_wavetable[ nIndex + 1 ] - fVal );
+
+		// Overflow wraps the phase around a period.
+		nPhase += nPhaseIncrement;
+	}
+
+	pVoice->nPhase = nPhase;
+}
+
+
+
 // perche' viene passata anche la canzone? E' davvero necessaria?
 void Synth::process( uint32_t nFrames )
 {
 	//INFOLOG( "process" );
 
 	// cleanup of the output buffers
-	memset( m_pOut_L, 0, nFrames * sizeof( float ) );
-	memset( m_pOut_R, 0, nFrames * sizeof( float ) );
+	Dsp::clear( m_pOut_L, nFrames );
+	Dsp::clear( m_pOut_R, nFrames );
 
+	if ( m_nPlayingVoices == 0 ) {
+		return;
+	}
 
-	for ( const auto& pPlayingNote :  m_playingNotesQueue ) {
-		//pPlayingNote->dumpInfo();
+	float fSampleRate = 44100.0;
+	if ( m_pAudioOutput != nullptr && m_pAudioOutput->getSampleRate() > 0 ) {
+		fSampleRate = m_pAudioOutput->getSampleRate();
+	}
+	uint32_t nPhaseIncrement = (uint32_t)( 220.0 / fSampleRate * 4294967296.0 );
 
-		float fAmplitude = pPlayingNote->get_velocity();
-		float fFrequency = TWOPI * 220.0 / 44100.0;
+	for ( int i = 0; i < m_nPlayingVoices; ++i ) {
+		Voice* pVoice = &m_voices[ i ];
+		//pVoice->pNote->dumpInfo();
 
-		for ( uint i = 0; i < nFrames; ++i ) {
-			float fVal = sin( m_fTheta ) * fAmplitude;
-			m_pOut_L[ i ] += fVal;
-			m_pOut_R[ i ] += fVal;
+		renderVoice( pVoice, nPhaseIncrement, nFrames );
 
-			m_fTheta += fFrequency;
-		}
+		float fAmplitude = pVoice->pNote->get_velocity();
+		Dsp::addWithGain( m_pOut_L, m_pVoiceBuffer, fAmplitude, nFrames );
+		Dsp::addWithGain( m_pOut_R, m_pVoiceBuffer, fAmplitude, nFrames );
 	}
 }
 
@@ -25,10 +25,15 @@
 #define SYNTH_H
 
 #include <cstdint>
-#include <vector>
 
 #include <core/Object.h>
 
+/** Maximum number of notes the H2Core::Synth plays at the same
+	time.*/
+#define MAX_SYNTH_VOICES 32
+/** Base two logarithm of the number of samples of one period stored
+	in the wavetable of the H2Core::Synth.*/
+#define SYNTH_WAVETABLE_BITS 10
 
 namespace H2Core
 {
@@ -38,6 +43,10 @@ class AudioOutput;
 ///
 /// A simple synthetizer...
 ///
+/// Each note is rendered block-wise by a phase accumulator reading
+/// from a precomputed sine wavetable. All voices are preallocated so
+/// neither noteOn() nor process() allocate memory.
+///
 class Synth : public H2Core::Object
 {
 	H2_OBJECT
@@ -64,14 +73,32 @@ public:
 	void setAudioOutput( AudioOutput* pAudioOutput );
 
 	int getPlayingNotesNumber() {
-		return m_playingNotesQueue.size();
+		return m_nPlayingVoices;
 	}
 
 
 private:
-	std::vector<Note*> m_playingNotesQueue;
+	struct Voice {
+		Note* pNote;
+		/** Phase of the oscillator. The whole range of the
+			integer corresponds to one period.*/
+		uint32_t nPhase;
+	};
+
+	/** Renders @a nFrames samples of the oscillator of @a pVoice
+		with unit amplitude into #m_pVoiceBuffer.*/
+	void renderVoice( Voice* pVoice, uint32_t nPhaseIncrement, uint32_t nFrames );
+
+	/** Voices currently playing are stored in the first
+		#m_nPlayingVoices entries.*/
+	Voice m_voices[ MAX_SYNTH_VOICES ];
+	int m_nPlayingVoices;
+
+	/** One period of a sine. The additional sample repeats the
+		first one to avoid wrapping during interpolation.*/
+	float m_wavetable[ ( 1 << SYNTH_WAVETABLE_BITS ) + 1 ];
+	float *m_pVoiceBuffer;
 
-	float m_fTheta;
 	AudioOutput *m_pAudioOutput;
 
 
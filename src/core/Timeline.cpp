@@ -22,13 +22,18 @@
 
 
 #include <algorithm>
+#include <cmath>
 #include <core/Timeline.h>
+#include <core/Basics/Song.h>
 
 namespace H2Core
 {
 	const char* Timeline::__class_name = "Timeline";
 
 	Timeline::Timeline() : Object( __class_name )
+						 , m_bTempoMapValid( false )
+						 , m_nTempoMapRevision( -1 )
+						 , m_nTempoMapResolution( 0 )
 	{
 	}
 
@@ -37,7 +42,7 @@ namespace H2Core
 		m_tags.clear();
 	}
 
-	void Timeline::addTempoMarker( int nBar, float fBpm ) {
+	void Timeline::addTempoMarker( int nBar, float fBpm, bool bRamp ) {
 		
 		if ( fBpm < MIN_BPM ) {
 			fBpm = MIN_BPM;
@@ -52,9 +57,11 @@ namespace H2Core
 		std::shared_ptr<TempoMarker> pTempoMarker( new TempoMarker );
 		pTempoMarker->nBar = nBar;
 		pTempoMarker->fBpm = fBpm;
+		pTempoMarker->bRamp = bRamp;
 
 		m_tempoMarkers.push_back( pTempoMarker );
 		sortTempoMarkers();
+		m_bTempoMapValid.store( false );
 	}
 
 	void Timeline::deleteTempoMarker( int nBar ) {
@@ -67,29 +74,158 @@ namespace H2Core
 				}
 			}
 		}
+		m_bTempoMapValid.store( false );
 	}
 
 	float Timeline::getTempoAtBar( int nBar, bool bSticky ) const {
 		float fBpm = 0;
 
-		if ( bSticky ) {
-			for ( int i = 0; i < static_cast<int>(m_tempoMarkers.size()); i++) {
-				if ( m_tempoMarkers[i]->nBar > nBar ) {
-					break;
-				}
-				fBpm = m_tempoMarkers[i]->fBpm;
-			}
-		} else {
-			for ( int t = 0; t < static_cast<int>(m_tempoMarkers.size()); t++ ){
-				if ( m_tempoMarkers[t]->nBar == nBar ){
-					fBpm = m_tempoMarkers[t]->fBpm;
-				}
+		// m_tempoMarkers is kept sorted.
+		auto it = std::upper_bound( m_tempoMarkers.begin(), m_tempoMarkers.end(), nBar,
+									[]( int nBar, const std::shared_ptr<const TempoMarker>& pMarker ) {
+										return nBar < pMarker->nBar; } );
+		if ( it != m_tempoMarkers.begin() ) {
+			--it;
+			if ( bSticky || (*it)->nBar == nBar ) {
+				fBpm = (*it)->fBpm;
 			}
 		}
 
 		return fBpm;
 	}
 
+	bool Timeline::updateTempoMap( const Song* pSong ) const {
+		if ( m_tempoMarkers.size() == 0 ) {
+			return false;
+		}
+
+		// Ensures the column start ticks are up to date before
+		// comparing their revision.
+		pSong->lengthInTicks();
+		int nRevision = pSong->getColumnStartTicksRevision();
+		int nResolution = pSong->getResolution();
+		if ( m_bTempoMapValid.load() && m_nTempoMapRevision == nRevision &&
+			 m_nTempoMapResolution == nResolution ) {
+			return true;
+		}
+		m_bTempoMapValid.store( true );
+		m_nTempoMapRevision = nRevision;
+		m_nTempoMapResolution = nResolution;
+
+		m_tempoMap.clear();
+		m_tempoMap.reserve( m_tempoMarkers.size() + 1 );
+
+		TempoSegment segment;
+		segment.nStartTick = 0;
+		segment.fStartTime = 0;
+		segment.fStartTicksPerSecond = m_tempoMarkers[ 0 ]->fBpm * nResolution / 60.0;
+		segment.fSlope = 0;
+		m_tempoMap.push_back( segment );
+
+		for ( const auto& pMarker : m_tempoMarkers ) {
+			TempoSegment& previous = m_tempoMap.back();
+			long nTick = pSong->getColumnStartTick( pMarker->nBar );
+			double fTicksPerSecond = pMarker->fBpm * nResolution / 60.0;
+			if ( nTick == previous.nStartTick ) {
+				// Covers a marker at the very first bar as well as
+				// markers placed beyond the end of the song.
+				previous.fStartTicksPerSecond = fTicksPerSecond;
+				continue;
+			}
+			if ( pMarker->bRamp ) {
+				previous.fSlope = ( fTicksPerSecond - previous.fStartTicksPerSecond ) /
+					( nTick - previous.nStartTick );
+			}
+			segment.fStartTime = previous.getTime( nTick );
+			segment.nStartTick = nTick;
+			segment.fStartTicksPerSecond = fTicksPerSecond;
+			segment.fSlope = 0;
+			m_tempoMap.push_back( segment );
+		}
+
+		return true;
+	}
+
+	double Timeline::TempoSegment::getTime( double fTick ) const {
+		double fTicks = fTick - nStartTick;
+		if ( fSlope == 0 ) {
+			return fStartTime + fTicks / fStartTicksPerSecond;
+		}
+		// Integral of 1 / ( v0 + k * x ) over the ticks x.
+		return fStartTime + std::log1p( fSlope * fTicks / fStartTicksPerSecond ) / fSlope;
+	}
+
+	double Timeline::TempoSegment::getTick( double fTime ) const {
+		double fSeconds = fTime - fStartTime;
+		if ( fSlope == 0 ) {
+			return nStartTick + fSeconds * fStartTicksPerSecond;
+		}
+		return nStartTick + std::expm1( fSlope * fSeconds ) * fStartTicksPerSecond / fSlope;
+	}
+
+	const Timeline::TempoSegment& Timeline::findSegment( double fTick ) const {
+		auto it = std::upper_bound( m_tempoMap.begin(), m_tempoMap.end(), fTick,
+									[]( double fTick, const TempoSegment& segment ) {
+										return fTick < segment.nStartTick; } );
+		if ( it != m_tempoMap.begin() ) {
+			--it;
+		}
+		return *it;
+	}
+
+	float Timeline::getTempoAtTick( double fTick, const Song* pSong, bool* pRamp ) const {
+		if ( pRamp != nullptr ) {
+			*pRamp = false;
+		}
+		if ( pSong == nullptr || pSong->getResolution() <= 0 ) {
+			return 0;
+		}
+
+		std::lock_guard<std::mutex> lock( m_tempoMapMutex );
+		if ( ! updateTempoMap( pSong ) ) {
+			return pSong->getBpm();
+		}
+
+		const TempoSegment& segment = findSegment( fTick );
+		if ( pRamp != nullptr ) {
+			*pRamp = segment.fSlope != 0;
+		}
+		return static_cast<float>( segment.getTicksPerSecond( fTick ) * 60.0 /
+								   pSong->getResolution() );
+	}
+
+	double Timeline::getTimeAtTick( long nTick, const Song* pSong ) const {
+		if ( pSong == nullptr || pSong->getResolution() <= 0 ) {
+			return 0;
+		}
+
+		std::lock_guard<std::mutex> lock( m_tempoMapMutex );
+		if ( ! updateTempoMap( pSong ) ) {
+			return nTick * 60.0 / ( pSong->getBpm() * pSong->getResolution() );
+		}
+
+		return findSegment( nTick ).getTime( nTick );
+	}
+
+	double Timeline::getTickAtTime( double fTime, const Song* pSong ) const {
+		if ( pSong == nullptr || pSong->getResolution() <= 0 ) {
+			return 0;
+		}
+
+		std::lock_guard<std::mutex> lock( m_tempoMapMutex );
+		if ( ! updateTempoMap( pSong ) ) {
+			return fTime * pSong->getBpm() * pSong->getResolution() / 60.0;
+		}
+
+		auto it = std::upper_bound( m_tempoMap.begin(), m_tempoMap.end(), fTime,
+									[]( double fTime, const TempoSegment& segment ) {
+										return fTime < segment.fStartTime; } );
+		if ( it != m_tempoMap.begin() ) {
+			--it;
+		}
+		return it->getTick( fTime );
+	}
+
 	void Timeline::addTag( int nBar, QString sTag ) {
 		
 		std::shared_ptr<Tag> pTag( new Tag );
@@ -23,12 +23,17 @@
 #ifndef TIMELINE_H
 #define TIMELINE_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <core/Object.h>
 
 namespace H2Core
 {
+	class Song;
+
 	/**
 	 * Timeline class storing and handling all TempoMarkers and Tags.
 	 *
@@ -53,6 +58,11 @@ namespace H2Core
 			{
 				int		nBar;		// beat position in timeline
 				float	fBpm;		// tempo in beats per minute
+				/** Whether the tempo changes gradually, linear in
+					ticks, from the one of the previous marker to
+					#fBpm over the bars in between instead of
+					jumping at #nBar.*/
+				bool	bRamp;
 			};
 
 			/** 
@@ -71,8 +81,11 @@ namespace H2Core
 			 *   tempo marker.
 			 * @param fBpm New tempo in beats per minute. All values
 			 *   below 30 and above 500 will be cut.
+			 * @param bRamp Whether the tempo ramps towards @a fBpm
+			 *   starting at the previous marker. See
+			 *   TempoMarker::bRamp.
 			 */
-			void		addTempoMarker( int nBar, float fBpm );
+			void		addTempoMarker( int nBar, float fBpm, bool bRamp = false );
 			/**
 			 * @param nBar Position of the Timeline to delete the
 			 * tempo marker at (if one is present).
@@ -104,6 +117,53 @@ namespace H2Core
 			 */
 			const std::vector<std::shared_ptr<const TempoMarker>> getAllTempoMarkers() const;
 
+			/**
+			 * Tempo at @a fTick taking tempo ramps into account.
+			 *
+			 * \param fTick Tick counted from the beginning of the
+			 * song.
+			 * \param pSong Song providing the position of each bar
+			 * and the resolution.
+			 * \param pRamp If not nullptr, set to whether @a fTick
+			 * lies within a tempo ramp.
+			 *
+			 * eturn Tempo in beats per minute. The tempo of @a
+			 * pSong if there are no tempo markers.
+			 */
+			float		getTempoAtTick( double fTick, const Song* pSong,
+										bool* pRamp = nullptr ) const;
+
+			/**
+			 * Time passed since the beginning of @a pSong till @a
+			 * nTick taking all tempo markers into account.
+			 *
+			 * Uses a tempo map which is looked up using binary
+			 * search and rebuilt on demand whenever the tempo markers
+			 * or the columns of @a pSong changed. Before the first
+			 * marker its tempo is used (see #854). Without any
+			 * markers the tempo of @a pSong is used. Tempo ramps are
+			 * integrated exactly.
+			 *
+			 * \param nTick Tick counted from the beginning of the
+			 * song.
+			 * \param pSong Song providing the position of each bar
+			 * and the resolution.
+			 *
+			 * \return Time in seconds.
+			 */
+			double		getTimeAtTick( long nTick, const Song* pSong ) const;
+			/**
+			 * Inverse of getTimeAtTick().
+			 *
+			 * \param fTime Time in seconds passed since the beginning
+			 * of the song.
+			 * \param pSong Song providing the position of each bar
+			 * and the resolution.
+			 *
+			 * \return Tick. Not rounded in order to be exact.
+			 */
+			double		getTickAtTime( double fTime, const Song* pSong ) const;
+
 			/**
 			 * @param nBar Position of the Timeline to query for a 
 			 *   tag.
@@ -140,6 +200,49 @@ namespace H2Core
 			void		sortTempoMarkers();
 			void		sortTags();
 
+			/** Part of the song played at a constant tempo or
+				ramping linearly in ticks.*/
+			struct TempoSegment
+			{
+				long	nStartTick;
+				/** Time in seconds passed at #nStartTick.*/
+				double	fStartTime;
+				/** Tempo in ticks per second at #nStartTick.*/
+				double	fStartTicksPerSecond;
+				/** Change of the tempo in ticks per second per
+					tick. 0 for a constant tempo.*/
+				double	fSlope;
+
+				double	getTime( double fTick ) const;
+				double	getTick( double fTime ) const;
+				double	getTicksPerSecond( double fTick ) const {
+					return fStartTicksPerSecond + fSlope * ( fTick - nStartTick );
+				}
+			};
+
+			/** \return Segment of #m_tempoMap containing @a fTick.
+				Has to be called with #m_tempoMapMutex locked and an
+				up to date map.*/
+			const TempoSegment& findSegment( double fTick ) const;
+
+			/** Rebuilds #m_tempoMap if required. Has to be called
+				with #m_tempoMapMutex locked.
+				\return false if there are no tempo markers.*/
+			bool		updateTempoMap( const Song* pSong ) const;
+
+			/** Segments sorted by their start tick. The first one
+				starts at tick 0.*/
+			mutable std::vector<TempoSegment> m_tempoMap;
+			/** Invalidated each time the tempo markers change.*/
+			mutable std::atomic<bool> m_bTempoMapValid;
+			/** Column layout of the Song #m_tempoMap was built
+				for (see Song::getColumnStartTicksRevision()).*/
+			mutable int m_nTempoMapRevision;
+			mutable int m_nTempoMapResolution;
+			/** Protects #m_tempoMap since both audio engine and GUI
+				convert positions.*/
+			mutable std::mutex m_tempoMapMutex;
+
 			std::vector<std::shared_ptr<const TempoMarker>> m_tempoMarkers;
 			std::vector<std::shared_ptr<const Tag>> m_tags;
 
@@ -160,6 +263,7 @@ namespace H2Core
 	};
 inline void Timeline::deleteAllTempoMarkers() {
 	m_tempoMarkers.clear();
+	m_bTempoMapValid.store( false );
 }
 inline void Timeline::deleteAllTags() {
 	m_tags.clear();
@@ -0,0 +1,235 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <core/Tracer.h>
+#include <core/rt_clock.h>
+
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace H2Core
+{
+
+static_assert( ( TRACER_EVENTS & ( TRACER_EVENTS - 1 ) ) == 0,
+			   "TRACER_EVENTS has to be a power of two" );
+
+struct TraceEvent {
+	const char* sName;
+	int64_t nStart;
+	/** Negative for instant events.*/
+	int64_t nDuration;
+};
+
+/** Ring buffer written by a single thread only.*/
+struct TraceThread {
+	std::atomic<const char*> sName;
+	std::atomic<size_t> nWriteIndex;
+	/** Events before are discarded by reset().*/
+	std::atomic<size_t> nFirstIndex;
+	TraceEvent events[ TRACER_EVENTS ];
+};
+
+static std::atomic<bool> bEnabled( false );
+/** Array of #TRACER_THREADS buffers allocated on first
+	enabling. Never freed, since threads might still be recording.*/
+static std::atomic<TraceThread*> pThreads( nullptr );
+/** Number of buffers claimed so far.*/
+static std::atomic<int> nThreads( 0 );
+/** Serializes the allocation of #pThreads.*/
+static std::mutex allocationMutex;
+
+/** Buffer claimed by the calling thread.*/
+static thread_local TraceThread* pThreadBuffer = nullptr;
+/** Whether the calling thread did not get a buffer.*/
+static thread_local bool bThreadDropped = false;
+/** Passed to setThreadName() before a buffer was claimed.*/
+static thread_local const char* sThreadName = nullptr;
+
+/** \return Buffer of the calling thread or nullptr if all of them
+	are taken already.*/
+static TraceThread* threadBuffer()
+{
+	if ( pThreadBuffer != nullptr || bThreadDropped ) {
+		return pThreadBuffer;
+	}
+	TraceThread* pAll = pThreads.load( std::memory_order_acquire );
+	if ( pAll == nullptr ) {
+		return nullptr;
+	}
+	int nThread = nThreads.fetch_add( 1, std::memory_order_relaxed );
+	if ( nThread >= TRACER_THREADS ) {
+		bThreadDropped = true;
+		return nullptr;
+	}
+	pThreadBuffer = &pAll[ nThread ];
+	if ( sThreadName != nullptr ) {
+		pThreadBuffer->sName.store( sThreadName, std::memory_order_release );
+	}
+	return pThreadBuffer;
+}
+
+static void record( const char* sName, int64_t nStart, int64_t nDuration )
+{
+	TraceThread* pThread = threadBuffer();
+	if ( pThread == nullptr ) {
+		return;
+	}
+	size_t nWrite = pThread->nWriteIndex.load( std::memory_order_relaxed );
+	TraceEvent& event = pThread->events[ nWrite & ( TRACER_EVENTS - 1 ) ];
+	event.sName = sName;
+	event.nStart = nStart;
+	event.nDuration = nDuration;
+	pThread->nWriteIndex.store( nWrite + 1, std::memory_order_release );
+}
+
+Tracer::Scope::Scope( const char* sName )
+	: m_sName( sName )
+	, m_nStart( bEnabled.load( std::memory_order_relaxed ) ? rtclock_now_ns() : -1 )
+{
+}
+
+Tracer::Scope::~Scope()
+{
+	if ( m_nStart >= 0 ) {
+		record( m_sName, m_nStart, rtclock_now_ns() - m_nStart );
+	}
+}
+
+void Tracer::setEnabled( bool bEnable )
+{
+	if ( bEnable ) {
+		std::lock_guard<std::mutex> lock( allocationMutex );
+		if ( pThreads.load() == nullptr ) {
+			pThreads.store( new TraceThread[ TRACER_THREADS ]() );
+		}
+	}
+	bEnabled.store( bEnable );
+}
+
+bool Tracer::isEnabled()
+{
+	return bEnabled.load( std::memory_order_relaxed );
+}
+
+void Tracer::setThreadName( const char* sName )
+{
+	if ( sThreadName != nullptr ) {
+		return;
+	}
+	sThreadName = sName;
+	if ( pThreadBuffer != nullptr ) {
+		pThreadBuffer->sName.store( sName, std::memory_order_release );
+	}
+}
+
+void Tracer::complete( const char* sName, int64_t nStart, int64_t nDuration )
+{
+	if ( bEnabled.load( std::memory_order_relaxed ) ) {
+		record( sName, nStart, nDuration );
+	}
+}
+
+void Tracer::instant( const char* sName )
+{
+	if ( bEnabled.load( std::memory_order_relaxed ) ) {
+		record( sName, rtclock_now_ns(), -1 );
+	}
+}
+
+bool Tracer::dump( const QString& sPath )
+{
+	QFile file( sPath );
+	if ( ! file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		return false;
+	}
+	QTextStream out( &file );
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	TraceThread* pAll = pThreads.load( std::memory_order_acquire );
+	int nCount = pAll != nullptr ? std::min( nThreads.load(), TRACER_THREADS ) : 0;
+	bool bFirst = true;
+	std::vector<TraceEvent> events;
+	for ( int nThread = 0; nThread < nCount; ++nThread ) {
+		TraceThread& thread = pAll[ nThread ];
+
+		const char* sName = thread.sName.load( std::memory_order_acquire );
+		out << ( bFirst ? "" : "," )
+			<< QString( "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%1,"
+						"\"args\":{\"name\":\"%2\"}}" )
+			.arg( nThread )
+			.arg( sName != nullptr ? QString( sName ) : QString( "Thread %1" ).arg( nThread ) );
+		bFirst = false;
+
+		size_t nEnd = thread.nWriteIndex.load( std::memory_order_acquire );
+		size_t nBegin = std::max( thread.nFirstIndex.load(),
+								  nEnd > TRACER_EVENTS ? nEnd - TRACER_EVENTS : 0 );
+		events.clear();
+		for ( size_t ii = nBegin; ii < nEnd; ++ii ) {
+			events.push_back( thread.events[ ii & ( TRACER_EVENTS - 1 ) ] );
+		}
+
+		// Events the thread did overwrite while they were copied are
+		// dropped.
+		size_t nWritten = thread.nWriteIndex.load( std::memory_order_acquire ) + 1;
+		size_t nValid = std::max( nBegin, nWritten > TRACER_EVENTS ? nWritten - TRACER_EVENTS : 0 );
+		for ( size_t ii = nValid; ii < nEnd; ++ii ) {
+			const TraceEvent& event = events[ ii - nBegin ];
+			if ( event.nDuration >= 0 ) {
+				out << QString( ",\n{\"name\":\"%1\",\"ph\":\"X\",\"pid\":1,\"tid\":%2,"
+								"\"ts\":%3,\"dur\":%4}" )
+					.arg( event.sName ).arg( nThread )
+					.arg( event.nStart / 1000.0, 0, 'f', 3 )
+					.arg( event.nDuration / 1000.0, 0, 'f', 3 );
+			} else {
+				out << QString( ",\n{\"name\":\"%1\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+								"\"tid\":%2,\"ts\":%3}" )
+					.arg( event.sName ).arg( nThread )
+					.arg( event.nStart / 1000.0, 0, 'f', 3 );
+			}
+		}
+	}
+
+	out << "\n]}\n";
+	out.flush();
+	return file.error() == QFileDevice::NoError;
+}
+
+void Tracer::reset()
+{
+	TraceThread* pAll = pThreads.load( std::memory_order_acquire );
+	if ( pAll == nullptr ) {
+		return;
+	}
+	int nCount = std::min( nThreads.load(), TRACER_THREADS );
+	for ( int nThread = 0; nThread < nCount; ++nThread ) {
+		pAll[ nThread ].nFirstIndex.store( pAll[ nThread ].nWriteIndex.load() );
+	}
+}
+
+};
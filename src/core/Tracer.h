@@ -0,0 +1,104 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+
+#include <cstdint>
+
+/** Maximum number of threads the H2Core::Tracer keeps events
+	of. Events of further threads are dropped.*/
+#define TRACER_THREADS 32
+/** Number of most recent events kept per thread by the
+	H2Core::Tracer. Has to be a power of two.*/
+#define TRACER_EVENTS 16384
+
+namespace H2Core
+{
+
+/**
+ * Opt-in timeline of what the engine, driver, and GUI threads were
+ * doing, meant to track down sporadic xruns.
+ *
+ * Each thread recording an event claims one of #TRACER_THREADS
+ * fixed-size ring buffers holding its latest #TRACER_EVENTS
+ * events. Instrumented code marks a span using a Tracer::Scope or
+ * reports one measured already using complete(). The
+ * ProcessProfiler does report the stages of audioEngine_process()
+ * this way.
+ *
+ * dump() writes the events of all threads as Chrome trace JSON,
+ * which can be opened in both chrome://tracing and the Perfetto
+ * UI. It is triggered by the --trace command line option when
+ * exiting and by the \e /Hydrogen/TRACE_DUMP OSC message.
+ *
+ * While disabled, which is the default, each marker costs a relaxed
+ * atomic load. Recording neither locks nor allocates. Names of
+ * events and threads have to be string literals.
+ */
+class Tracer
+{
+public:
+	/** Records the span from construction to destruction.*/
+	class Scope
+	{
+	public:
+		Scope( const char* sName );
+		~Scope();
+	private:
+		const char* m_sName;
+		int64_t m_nStart;
+	};
+
+	/** Enables or disables recording. Enabling does allocate the
+		ring buffers on first use.*/
+	static void setEnabled( bool bEnabled );
+	static bool isEnabled();
+
+	/** Names the calling thread in the trace. Only the first call
+		per thread has an effect.*/
+	static void setThreadName( const char* sName );
+	/** Records a span of @a nDuration nanoseconds starting at @a
+		nStart, both as obtained by rtclock_now_ns().*/
+	static void complete( const char* sName, int64_t nStart, int64_t nDuration );
+	/** Records an event without duration, like an xrun.*/
+	static void instant( const char* sName );
+
+	/**
+	 * Writes all events kept into @a sPath as Chrome trace JSON.
+	 *
+	 * Recording does continue meanwhile. Must not be called on a
+	 * realtime thread.
+	 *
+	 * \return false if the file could not be written.
+	 */
+	static bool dump( const QString& sPath );
+	/** Discards all events recorded so far.*/
+	static void reset();
+};
+
+};
+
+#endif
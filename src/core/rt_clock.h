@@ -55,4 +55,16 @@
 	#define RTCLOCK_MS -1
 #endif
 
+#include <chrono>
+#include <cstdint>
+
+/** Monotonic time in nanoseconds. In contrast to the macros above it
+	is always available and cheap enough to be called several times
+	per process cycle.*/
+inline int64_t rtclock_now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
 #endif // H2_RTCLOCK_H
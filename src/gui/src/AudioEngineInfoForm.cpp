@@ -30,12 +30,15 @@
 
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
+#include <core/Basics/SampleMemory.h>
 #include <core/Preferences.h>
 #include <core/Hydrogen.h>
 #include <core/IO/MidiInput.h>
 #include <core/IO/AudioOutput.h>
 #include <core/Sampler/Sampler.h>
 #include <core/AudioEngine.h>
+#include <core/LatencyProbe.h>
+#include <core/ProcessProfiler.h>
 using namespace H2Core;
 
 #include "Skin.h"
@@ -45,6 +48,7 @@ const char* AudioEngineInfoForm::__class_name = "AudioEngineInfoForm";
 AudioEngineInfoForm::AudioEngineInfoForm(QWidget* parent)
  : QWidget( parent )
  , Object( __class_name )
+ , m_nSampleMemoryTicks( 0 )
 {
 	setupUi( this );
 
@@ -58,7 +62,7 @@ AudioEngineInfoForm::AudioEngineInfoForm(QWidget* parent)
 	m_pTimer = new QTimer(this);
 	connect(m_pTimer, SIGNAL(timeout()), this, SLOT(updateInfo()));
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_STATE, EVENT_PATTERN_CHANGED } );
 	updateAudioEngineState();
 }
 
@@ -77,6 +81,7 @@ AudioEngineInfoForm::~AudioEngineInfoForm()
  */
 void AudioEngineInfoForm::showEvent ( QShowEvent* )
 {
+	m_nSampleMemoryTicks = 0;
 	updateInfo();
 	m_pTimer->start(200);
 }
@@ -200,10 +205,54 @@ void AudioEngineInfoForm::updateInfo()
 	// SAMPLER
 	Sampler *pSampler = AudioEngine::get_instance()->get_sampler();
 	sampler_playingNotesLbl->setText(QString( "%1 / %2" ).arg(pSampler->getPlayingNotesNumber()).arg(Preferences::get_instance()->m_nMaxNotes));
+	sampler_streamUnderrunsLbl->setText( QString( "%1" ).arg( pSampler->getStreamUnderruns() ) );
+
+	// Sample memory, about once a second
+	if ( m_nSampleMemoryTicks <= 0 ) {
+		updateSampleMemory();
+		m_nSampleMemoryTicks = 5;
+	}
+	--m_nSampleMemoryTicks;
 
 	// Synth
 	Synth *pSynth = AudioEngine::get_instance()->get_synth();
 	synth_playingNotesLbl->setText( QString( "%1" ).arg( pSynth->getPlayingNotesNumber() ) );
+
+	// Process cycle
+	ProcessProfiler *pProfiler = AudioEngine::get_instance()->get_profiler();
+	QLabel* stageLabels[ ProcessProfiler::STAGE_COUNT ] = {
+		profilePrepareLbl, profileNoteQueueLbl, profileSamplerLbl, profileSynthLbl,
+		profileLadspaLbl, profileMeteringLbl, profileTotalLbl };
+	for ( int ii = 0; ii < ProcessProfiler::STAGE_COUNT; ++ii ) {
+		ProcessProfiler::Statistics statistics =
+			pProfiler->getStatistics( static_cast<ProcessProfiler::Stage>( ii ) );
+		stageLabels[ ii ]->setText( QString( "%1 / %2 / %3" )
+									.arg( statistics.fMedian, 0, 'f', 3 )
+									.arg( statistics.fPercentile99, 0, 'f', 3 )
+									.arg( statistics.fMax, 0, 'f', 3 ) );
+	}
+	profileCyclesLbl->setText( QString( "%1 (%2)" ).arg( pProfiler->getCycles() )
+							   .arg( pProfiler->getDroppedCycles() ) );
+	profileQuietVoicesLbl->setText( QString( "%1" ).arg( pProfiler->getQuietVoices() ) );
+
+	// MIDI note latency
+	LatencyProbe *pLatencyProbe = AudioEngine::get_instance()->get_latency_probe();
+	QLabel* latencyLabels[ LatencyProbe::SOURCE_COUNT ] = {
+		latencyAlsaLbl, latencyJackLbl, latencyPortMidiLbl, latencyCoreMidiLbl,
+		latencyPipeWireLbl };
+	for ( int ii = 0; ii < LatencyProbe::SOURCE_COUNT; ++ii ) {
+		LatencyProbe::Statistics statistics =
+			pLatencyProbe->getStatistics( static_cast<LatencyProbe::Source>( ii ) );
+		if ( statistics.nTriggers == 0 ) {
+			latencyLabels[ ii ]->setText( "N/A" );
+			continue;
+		}
+		latencyLabels[ ii ]->setText( QString( "%1 / %2 / %3 (%4 notes)" )
+									  .arg( statistics.fMedian, 0, 'f', 2 )
+									  .arg( statistics.fPercentile99, 0, 'f', 2 )
+									  .arg( statistics.fMax, 0, 'f', 2 )
+									  .arg( statistics.nTriggers ) );
+	}
 }
 
 
@@ -211,6 +260,39 @@ void AudioEngineInfoForm::updateInfo()
 
 
 
+void AudioEngineInfoForm::updateSampleMemory()
+{
+	const double fMB = 1024.0 * 1024.0;
+	SampleMemory::Stats stats = SampleMemory::get_stats();
+
+	QString sLocked = QString( "%1 MB (%2 / %3 samples)" )
+		.arg( stats.nLockedBytes / fMB, 0, 'f', 1 )
+		.arg( stats.nLockedSamples )
+		.arg( stats.nSamples );
+	if ( stats.nFailedSamples > 0 ) {
+		sLocked += QString( ", %1 failed" ).arg( stats.nFailedSamples );
+	}
+	memoryLockedLbl->setText( sLocked );
+
+	int nPercent = stats.nBytes == 0 ? 100 :
+		static_cast<int>( std::min<size_t>( stats.nResidentBytes, stats.nBytes ) * 100 / stats.nBytes );
+	QString sResident = QString( "%1 / %2 MB (%3%)" )
+		.arg( stats.nResidentBytes / fMB, 0, 'f', 1 )
+		.arg( stats.nBytes / fMB, 0, 'f', 1 )
+		.arg( nPercent );
+	if ( stats.nBudgetBytes > 0 ) {
+		sResident += QString( ", budget %1 MB, %2 evicted" )
+			.arg( stats.nBudgetBytes / fMB, 0, 'f', 0 )
+			.arg( stats.nEvictions );
+	}
+	if ( stats.nArenaRegions > 0 ) {
+		sResident += QString( ", %1 MB mapped in %2 regions" )
+			.arg( stats.nArenaBytes / fMB, 0, 'f', 0 )
+			.arg( stats.nArenaRegions );
+	}
+	memoryResidentLbl->setText( sResident );
+}
+
 /**
  * Update engineStateLbl with the current audio engine state
  */
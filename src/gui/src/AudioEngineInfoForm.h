@@ -41,6 +41,9 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 	Q_OBJECT
 	private:
 		QTimer* m_pTimer;
+		/** Timer ticks left until the sample memory is queried
+			again. See updateSampleMemory().*/
+		int m_nSampleMemoryTicks;
 
 		// EventListener implementation
 		virtual void stateChangedEvent(int nState) override;
@@ -59,6 +62,9 @@ class AudioEngineInfoForm : public QWidget, public Ui_AudioEngineInfoForm_UI, pu
 
 	private:
 		void updateAudioEngineState();
+		/** Updates the residency of the sample data, which is
+			comparatively expensive to query.*/
+		void updateSampleMemory();
 };
 
 #endif
@@ -36,6 +36,10 @@
 #include <QTreeWidget>
 #include <QMessageBox>
 
+/** Frames of a previewed file decoded up front, a few seconds at
+	common sample rates. The remainder is streamed while playing.*/
+static const int nPreviewResidentFrames = 5 * 48000;
+
 using namespace H2Core;
 
 const char* AudioFileBrowser::__class_name = "AudioFileBrowser";
@@ -88,7 +92,7 @@ AudioFileBrowser::AudioFileBrowser ( QWidget* pParent, bool bAllowMultiSelect, b
 	m_pStopBtn->setToolTip( QString( tr( "Stop" )));
 
 	m_pSampleWaveDisplay = new SampleWaveDisplay( waveformview );
-	m_pSampleWaveDisplay->updateDisplay( m_sEmptySampleFilename );
+	m_pSampleWaveDisplay->updateDisplay( nullptr );
 	m_pSampleWaveDisplay->move( 3, 3 );
 
 	playSamplescheckBox->setChecked( Preferences::get_instance()->__playsamplesonclicking );
@@ -226,7 +230,7 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
 
 	QString path = m_pDirModel->filePath( index );
 	pathLineEdit->setText( path );
-	m_pSampleWaveDisplay->updateDisplay( m_sEmptySampleFilename );
+	m_pSampleWaveDisplay->updateDisplay( nullptr );
 
 	updateModelIndex(); //with this you have a navigation like konqueror
 
@@ -258,7 +262,10 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
 	{
 
 		filelineedit->setText( fleTxt );
-		auto pNewSample = Sample::load( path2 );
+		// Only the head is decoded, so neither long files nor
+		// the waveform delay the preview.
+		auto pNewSample = Sample::load_streamed( path2, nPreviewResidentFrames );
+		m_pPreviewSample = pNewSample;
 
 		if ( pNewSample != nullptr ) {
 			m_pNBytesLable->setText( tr( "Size: %1 bytes" ).arg( pNewSample->get_size() / 2 ) );
@@ -270,19 +277,12 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
 
 			m_pSampleFilename = path2;
 
-			m_pSampleWaveDisplay->updateDisplay( path2 );
+			m_pSampleWaveDisplay->updateDisplay( pNewSample );
 			m_pPlayBtn->setEnabled( true );
 			openBTN->setEnabled( true );
 
-			//important this will only working correct if m_pSampleWaveDisplay->updateDisplay( file )
-			//is ready with painting the wav file. else the playing sample get crackled sound!!
 			if (playSamplescheckBox->isChecked()){
-				if ( sec <= 600.00){
-					on_m_pPlayBtn_clicked();
-				}else
-				{
-					QMessageBox::information ( this, "Hydrogen", tr( "Please do not preview samples which are longer than 10 minutes!" )  );
-				}
+				on_m_pPlayBtn_clicked();
 			}
 			m_pNameLabel->setText( message );
 		} else {
@@ -295,11 +295,12 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
 		m_pNBytesLable->setText( tr( "Size:" ) );
 		m_pSamplerateLable->setText( tr( "Samplerate:" ) );
 		m_pLengthLable->setText( tr( "Sample length:" ) );
-		m_pSampleWaveDisplay->updateDisplay( m_sEmptySampleFilename );
+		m_pSampleWaveDisplay->updateDisplay( nullptr );
 		m_pPlayBtn->setEnabled( false );
 		m_pStopBtn->setEnabled( false );
 		openBTN->setEnabled( false );
 		m_pSampleFilename = "";
+		m_pPreviewSample = nullptr;
 	}
 	QApplication::restoreOverrideCursor();
 }
@@ -315,7 +316,12 @@ void AudioFileBrowser::on_m_pPlayBtn_clicked()
 	
 	m_pStopBtn->setEnabled( true );
 	
-	auto pNewSample = Sample::load( m_pSampleFilename );
+	auto pNewSample = m_pPreviewSample;
+	if ( pNewSample == nullptr ||
+		 pNewSample->get_filepath() != m_pSampleFilename ) {
+		pNewSample = Sample::load_streamed( m_pSampleFilename, nPreviewResidentFrames );
+		m_pPreviewSample = pNewSample;
+	}
 	if ( pNewSample ) {
 		assert(pNewSample->get_sample_rate() != 0);
 		
@@ -30,6 +30,12 @@
 #include <core/Object.h>
 #include <core/Preferences.h>
 
+#include <memory>
+
+namespace H2Core
+{
+	class Sample;
+}
 
 class Button;
 class SampleWaveDisplay;
@@ -77,6 +83,9 @@ class AudioFileBrowser : public QDialog, public Ui_AudioFileBrowser_UI, public H
 		SampleWaveDisplay *	m_pSampleWaveDisplay;
 		
 		QString				m_pSampleFilename;
+		/** Streamed Sample of #m_pSampleFilename shared by the
+			info labels, the waveform, and the preview.*/
+		std::shared_ptr<H2Core::Sample>	m_pPreviewSample;
 		QStringList			m_pSelectedFile;
 
 		bool				m_SingleClick;
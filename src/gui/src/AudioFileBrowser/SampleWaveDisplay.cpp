@@ -23,16 +23,23 @@
 #include <core/Basics/Sample.h>
 #include <core/Basics/Song.h>
 #include <core/Basics/Instrument.h>
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/SamplePeaks.h>
 using namespace H2Core;
 
 #include "SampleWaveDisplay.h"
+#include "../HydrogenApp.h"
 #include "../Skin.h"
 
+#include <algorithm>
+#include <vector>
+
 const char* SampleWaveDisplay::__class_name = "SampleWaveDisplay";
 
 SampleWaveDisplay::SampleWaveDisplay(QWidget* pParent)
  : QWidget( pParent )
  , Object( __class_name )
+ , m_pSample( nullptr )
  , m_sSampleName( "" )
 {
 //	setAttribute(Qt::WA_OpaquePaintEvent);
@@ -48,7 +55,9 @@ SampleWaveDisplay::SampleWaveDisplay(QWidget* pParent)
 	}
 
 	m_pPeakData = new int[ w ];
+	memset( m_pPeakData, 0, w * sizeof( m_pPeakData[0] ) );
 
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_SAMPLE_PEAKS_READY } );
 }
 
 
@@ -58,6 +67,7 @@ SampleWaveDisplay::~SampleWaveDisplay()
 {
 	//INFOLOG( "DESTROY" );
 
+	HydrogenApp::get_instance()->removeEventListener( this );
 	delete[] m_pPeakData;
 }
 
@@ -85,50 +95,72 @@ void SampleWaveDisplay::paintEvent(QPaintEvent *ev)
 
 
 
-void SampleWaveDisplay::updateDisplay( QString filename )
+void SampleWaveDisplay::samplePeaksReadyEvent( int nValue )
 {
+	UNUSED( nValue );
+	if ( m_pSample != nullptr ) {
+		updateDisplay( m_pSample );
+	}
+}
 
-	auto pNewSample = Sample::load( filename );
 
-	if ( pNewSample != nullptr ) {
-		// Extract the filename from the complete path
-		QString sName = filename;
-		int nPos = sName.lastIndexOf( "/" );
 
-		if ( sName.endsWith("emptySample.wav")){
-			m_sSampleName = "";
-		}else
-		{
-			m_sSampleName = sName.mid( nPos + 1, sName.length() );
-		}
+void SampleWaveDisplay::updateDisplay( std::shared_ptr<Sample> pSample )
+{
+	m_pSample = pSample;
+
+	if ( pSample == nullptr ) {
+		m_sSampleName = "";
+		memset( m_pPeakData, 0, width() * sizeof( m_pPeakData[0] ) );
+		update();
+		return;
+	}
 
-//		INFOLOG( "[updateDisplay] sample: " + m_sSampleName  );
+	m_sSampleName = pSample->get_filename();
 
-		int nSampleLength = pNewSample->get_frames();
-		float nScaleFactor = nSampleLength / width();
+//	INFOLOG( "[updateDisplay] sample: " + m_sSampleName  );
 
-		float fGain = height() / 2.0 * 1.0;
+	int nSampleLength = pSample->get_frames();
+	float nScaleFactor = nSampleLength / width();
 
-		auto pSampleData = pNewSample->get_data_l();
+	float fGain = height() / 2.0 * 1.0;
 
-		int nSamplePos =0;
-		int nVal;
+	// Does not block. The peaks of a file not summarized yet are
+	// built in the background.
+	SamplePeakBuilder* pBuilder = SamplePeakBuilder::get_instance();
+	auto pPeaks = pBuilder != nullptr && nSampleLength > 0 ?
+		pBuilder->peaks( pSample ) : nullptr;
+	double fScale = pPeaks != nullptr ?
+		pPeaks->get_frames() / static_cast<double>( nSampleLength ) : 1;
+	std::vector<float> min( width() ), max( width() );
+	if ( pPeaks != nullptr &&
+		 pPeaks->get_peaks( 0, 0, nScaleFactor * fScale, width(), min.data(), max.data() ) ) {
 		for ( int i = 0; i < width(); ++i ){
-			nVal = 0;
-			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					int newVal = static_cast<int>( pSampleData[ nSamplePos ] * fGain );
-					if ( newVal > nVal ) {
-						nVal = newVal;
-					}
+			m_pPeakData[ i ] = static_cast<int>( std::max( max[ i ], -min[ i ] ) * fGain );
+		}
+		update();
+		return;
+	}
+
+	auto pSampleData = pSample->get_data_l();
+	// Only the head of a streamed sample is held in memory.
+	int nResidentFrames = pSample->get_resident_frames();
+
+	int nSamplePos =0;
+	int nVal;
+	for ( int i = 0; i < width(); ++i ){
+		nVal = 0;
+		for ( int j = 0; j < nScaleFactor; ++j ) {
+			if ( nSamplePos < nResidentFrames ) {
+				int newVal = static_cast<int>( pSampleData[ nSamplePos ] * fGain );
+				if ( newVal > nVal ) {
+					nVal = newVal;
 				}
-				++nSamplePos;
 			}
-			m_pPeakData[ i ] = nVal;
+			++nSamplePos;
 		}
+		m_pPeakData[ i ] = nVal;
 	}
 
 	update();
-
 }
-
@@ -26,10 +26,16 @@
 #include <QtWidgets>
 
 #include <core/Object.h>
+#include "../EventListener.h"
 
+#include <memory>
 
+namespace H2Core
+{
+	class Sample;
+}
 
-class SampleWaveDisplay : public QWidget, public H2Core::Object
+class SampleWaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
 	H2_OBJECT
 	Q_OBJECT
@@ -38,11 +44,25 @@ class SampleWaveDisplay : public QWidget, public H2Core::Object
 		explicit SampleWaveDisplay( QWidget* pParent );
 		~SampleWaveDisplay();
 
-		void updateDisplay( QString filename );
+		/**
+		 * Draws the waveform of @a pSample or clears the display if
+		 * it is a nullptr.
+		 *
+		 * The peaks are requested from the
+		 * H2Core::SamplePeakBuilder. As long as they are not built
+		 * yet only the frames held in memory - just the head of a
+		 * streamed sample - are scanned and the display is redrawn
+		 * in samplePeaksReadyEvent().
+		 */
+		void updateDisplay( std::shared_ptr<H2Core::Sample> pSample );
 
 		void paintEvent(QPaintEvent *ev);
 
+		/** Redraws using the SamplePeaks which became available.*/
+		virtual void samplePeaksReadyEvent( int nValue ) override;
+
 	private:
+		std::shared_ptr<H2Core::Sample> m_pSample;
 		QPixmap m_Background;
 		QString m_sSampleName;
 		int *	m_pPeakData;
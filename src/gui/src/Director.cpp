@@ -68,7 +68,7 @@ Director::Director ( QWidget* pParent )
 		, Object ( "Director" )
 {
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_METRONOME } );
 	setupUi ( this );
 	//INFOLOG ( "INIT" );
 	setWindowTitle ( tr ( "Director" ) );
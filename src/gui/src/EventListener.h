@@ -54,6 +54,12 @@ class EventListener
 		virtual void loopModeActivationEvent( int nValue ){ UNUSED( nValue ); }
 		virtual void updatePreferencesEvent( int nValue ){ UNUSED( nValue ); }
 		virtual void actionModeChangeEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void sampleLoadingProgressEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void drumkitLoadedEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void drumkitListChangedEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void samplePeaksReadyEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void overloadLevelEvent( int nValue ){ UNUSED( nValue ); }
+		virtual void layerSamplesLoadedEvent( int nValue ){ UNUSED( nValue ); }
 
 		virtual ~EventListener() {}
 };
@@ -42,6 +42,9 @@
 #include <core/Preferences.h>
 #include <core/Timeline.h>
 #include <core/IO/AudioOutput.h>
+#include <core/IO/DiskWriterDriver.h>
+#include <core/IO/ExportWriter.h>
+#include <core/IO/JackAudioDriver.h>
 #include <core/AudioEngine.h>
 #include <core/Sampler/Sampler.h>
 #include <core/EventQueue.h>
@@ -78,6 +81,9 @@ static int interpolateModeToComboBoxIndex(Interpolation::InterpolateMode interpo
 		case Interpolation::InterpolateMode::Hermite:
 			Index = 4;
 			break;
+		case Interpolation::InterpolateMode::Sinc:
+			Index = 5;
+			break;
 	}
 	
 	return Index;
@@ -101,7 +107,7 @@ ExportSongDialog::ExportSongDialog(QWidget* parent)
 	exportTypeCombo->addItem(tr("Export to separate tracks"));
 	exportTypeCombo->addItem(tr("Both"));
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_PROGRESS } );
 
 	m_pProgressBar->setValue( 0 );
 	
@@ -126,6 +132,18 @@ ExportSongDialog::ExportSongDialog(QWidget* parent)
 	m_bOldTimeLineBPMMode = m_pPreferences->getUseTimelineBpm();
 	connect(toggleTimeLineBPMCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleTimeLineBPMMode( bool )));
 
+	// use of JACK freewheel mode
+	toggleJackFreewheelCheckBox->setChecked( m_pPreferences->m_bJackFreewheelExport );
+	if ( dynamic_cast<JackAudioDriver*>( m_pEngine->getAudioOutput() ) != nullptr ) {
+		connect(toggleJackFreewheelCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleJackFreewheelMode( bool )));
+	} else {
+		toggleJackFreewheelCheckBox->setEnabled( false );
+	}
+
+	// use of the render cache
+	toggleRenderCacheCheckBox->setChecked( m_pPreferences->m_bExportRenderCache );
+	connect(toggleRenderCacheCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleRenderCache( bool )));
+
 	// use of interpolation mode
 	m_OldInterpolationMode = AudioEngine::get_instance()->get_sampler()->getInterpolateMode();
 	resampleComboBox->setCurrentIndex( interpolateModeToComboBoxIndex( m_OldInterpolationMode ) );
@@ -338,6 +356,17 @@ void ExportSongDialog::on_okBtn_clicked()
 		}
 
 		m_pEngine->startExportSession( sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt());
+
+		// Render the stems within the same pass if possible.
+		if ( m_bExportTrackouts &&
+			 dynamic_cast<DiskWriterDriver*>( m_pEngine->getAudioOutput() ) != nullptr ) {
+			if ( ! addStems() ) {
+				return;
+			}
+			m_bExportTrackouts = false;
+		}
+
+		startScoreExport();
 		m_pEngine->startExportSong( filename );
 
 		return;
@@ -346,7 +375,22 @@ void ExportSongDialog::on_okBtn_clicked()
 	if( exportTypeCombo->currentIndex() == EXPORT_TO_SEPARATE_TRACKS ){
 		m_bExportTrackouts = true;
 		m_pEngine->startExportSession(sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt());
-		exportTracks();
+
+		if ( dynamic_cast<DiskWriterDriver*>( m_pEngine->getAudioOutput() ) != nullptr ) {
+			for (auto i = 0; i < pInstrumentList->size(); i++) {
+				pInstrumentList->get(i)->set_currently_exported( true );
+			}
+			if ( ! addStems() ) {
+				return;
+			}
+			m_bExportTrackouts = false;
+			startScoreExport();
+			// Only the stems are written.
+			m_pEngine->startExportSong( "" );
+		} else {
+			startScoreExport();
+			exportTracks();
+		}
 		return;
 	}
 
@@ -397,6 +441,41 @@ QString ExportSongDialog::findUniqueExportFilenameForInstrument(Instrument* pIns
 	return uniqueInstrumentName;
 }
 
+bool ExportSongDialog::addStems()
+{
+	Song *pSong = m_pEngine->getSong();
+	InstrumentList *pInstrumentList = pSong->getInstrumentList();
+
+	QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
+	QString firstItem;
+	if( !filenameList.isEmpty() ){
+		firstItem = filenameList.first();
+	}
+
+	for ( m_nInstrument = 0; m_nInstrument < pInstrumentList->size(); ++m_nInstrument ) {
+		if ( ! currentInstrumentHasNotes() ) {
+			continue;
+		}
+
+		Instrument* pInstrument = pInstrumentList->get( m_nInstrument );
+		QString filename = firstItem + "-" + findUniqueExportFilenameForInstrument( pInstrument ) + m_sExtension;
+
+		if ( QFile( filename ).exists() == true && m_bQfileDialog == false && !m_bOverwriteFiles) {
+			int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
+			if (res == QMessageBox::No ) {
+				m_nInstrument = 0;
+				return false;
+			}
+			if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
+		}
+
+		m_pEngine->addExportStem( pInstrument, filename );
+	}
+	m_nInstrument = 0;
+
+	return true;
+}
+
 void ExportSongDialog::exportTracks()
 {
 	Song *pSong = m_pEngine->getSong();
@@ -463,10 +542,34 @@ void ExportSongDialog::on_closeBtn_clicked()
 {
 	closeExport();
 }
+void ExportSongDialog::startScoreExport()
+{
+	QFileInfo info( exportNameTxt->text() );
+	const QString sBase = info.absoluteDir().filePath( info.completeBaseName() );
+
+	SongExporter::Job job;
+	if ( exportMidiCheckBox->isChecked() ) {
+		job.sMidiFilename = sBase + ".mid";
+		job.midiFormat = static_cast<SongExporter::MidiFormat>( m_pPreferences->getMidiExportMode() );
+	}
+	if ( exportLilyPondCheckBox->isChecked() ) {
+		job.sLilyPondFilename = sBase + ".ly";
+	}
+	m_scoreExporter.startScores( job );
+}
+
+void ExportSongDialog::finishScoreExport()
+{
+	if ( ! m_scoreExporter.finish() ) {
+		QMessageBox::warning( this, "Hydrogen", tr( "Unable to write the MIDI or LilyPond file" ) );
+	}
+}
+
 void ExportSongDialog::closeExport() {
 	
 	m_pEngine->stopExportSong();
 	m_pEngine->stopExportSession();
+	finishScoreExport();
 	
 	m_bExporting = false;
 	
@@ -646,6 +749,15 @@ void ExportSongDialog::progressEvent( int nValue )
 
 		m_bExporting = false;
 
+		// Report the loudness of the file written last.
+		std::vector<ExportWriter::Analysis> analyses = ExportWriter::getAnalyses();
+		if ( ! analyses.empty() ) {
+			const ExportWriter::Analysis& analysis = analyses.back();
+			m_pProgressBar->setFormat( tr( "%1 LUFS, %2 dBTP" )
+									   .arg( analysis.fLoudness, 0, 'f', 1 )
+									   .arg( analysis.fTruePeak, 0, 'f', 1 ) );
+		}
+
 		if( m_nInstrument == Hydrogen::get_instance()->getSong()->getInstrumentList()->size()){
 			m_nInstrument = 0;
 			m_bExportTrackouts = false;
@@ -653,10 +765,13 @@ void ExportSongDialog::progressEvent( int nValue )
 
 		if( m_bExportTrackouts ){
 			exportTracks();
+		} else {
+			finishScoreExport();
 		}
 	}
 
 	if ( nValue < 100 ) {
+		m_pProgressBar->setFormat( "%p%" );
 		closeBtn->setEnabled(false);
 		resampleComboBox->setEnabled(false);
 
@@ -680,6 +795,16 @@ void ExportSongDialog::toggleTimeLineBPMMode(bool toggled)
 	m_pPreferences->setUseTimelineBpm(toggled);
 }
 
+void ExportSongDialog::toggleJackFreewheelMode(bool toggled)
+{
+	m_pPreferences->m_bJackFreewheelExport = toggled;
+}
+
+void ExportSongDialog::toggleRenderCache(bool toggled)
+{
+	m_pPreferences->m_bExportRenderCache = toggled;
+}
+
 void ExportSongDialog::resampleComboBoIndexChanged(int index )
 {
 	setResamplerMode(index);
@@ -703,6 +828,9 @@ void ExportSongDialog::setResamplerMode(int index)
 	case 4:
 		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Interpolation::InterpolateMode::Hermite );
 		break;
+	case 5:
+		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Interpolation::InterpolateMode::Sinc );
+		break;
 	}
 }
 
@@ -28,6 +28,7 @@
 #include "ui_ExportSongDialog_UI.h"
 #include "EventListener.h"
 #include <core/Object.h>
+#include <core/SongExporter.h>
 #include <core/Sampler/Sampler.h>
 
 using InterpolateMode = H2Core::Interpolation::InterpolateMode;
@@ -62,6 +63,8 @@ private slots:
 	void		on_templateCombo_currentIndexChanged(int index);
 	void		toggleRubberbandBatchMode(bool toggled);
 	void		toggleTimeLineBPMMode(bool toggled);
+	void		toggleJackFreewheelMode(bool toggled);
+	void		toggleRenderCache(bool toggled);
 	void		resampleComboBoIndexChanged(int index);
 
 private:
@@ -77,6 +80,12 @@ private:
 	QString		findUniqueExportFilenameForInstrument(H2Core::Instrument* pInstrument);
 
 	void		exportTracks();
+	bool		addStems();
+	/** Starts writing the MIDI and LilyPond files requested next
+		to the audio file.*/
+	void		startScoreExport();
+	/** Waits for the files started by startScoreExport().*/
+	void		finishScoreExport();
 	bool 		validateUserInput();
 	QString		createDefaultFilename();
 
@@ -93,6 +102,7 @@ private:
 	bool					m_bQfileDialog;
 	H2Core::Hydrogen *		m_pEngine;
 	H2Core::Preferences*	m_pPreferences;
+	H2Core::SongExporter	m_scoreExporter;
 	
 	static QString 			sLastFilename;
 };
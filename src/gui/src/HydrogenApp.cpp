@@ -22,11 +22,19 @@
 
 #include <core/config.h>
 #include <core/Version.h>
+#include <core/AudioEngine.h>
 #include <core/Hydrogen.h>
 #include <core/EventQueue.h>
+#include <core/InstrumentFreezer.h>
+#include <core/Basics/Song.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
 #include <core/FX/LadspaFX.h>
 #include <core/Preferences.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Tracer.h>
 
 #include "HydrogenApp.h"
 #include "Skin.h"
@@ -69,6 +77,7 @@ HydrogenApp::HydrogenApp( MainForm *pMainForm, Song *pFirstSong )
  , m_pMixer( nullptr )
  , m_pPatternEditorPanel( nullptr )
  , m_pAudioEngineInfoForm( nullptr )
+ , m_pFilesystemInfoForm( nullptr )
  , m_pSongEditorPanel( nullptr )
  , m_pPlayerControl( nullptr )
  , m_pPlaylistDialog( nullptr )
@@ -99,21 +108,12 @@ HydrogenApp::HydrogenApp( MainForm *pMainForm, Song *pFirstSong )
 
 	setupSinglePanedInterface();
 
-	// restore audio engine form properties
-	m_pAudioEngineInfoForm = new AudioEngineInfoForm( nullptr );
-	WindowProperties audioEngineInfoProp = pPref->getAudioEngineInfoProperties();
-	m_pAudioEngineInfoForm->move( audioEngineInfoProp.x, audioEngineInfoProp.y );
-	if ( audioEngineInfoProp.visible ) {
-		m_pAudioEngineInfoForm->show();
+	// The info forms, the PlaylistDialog, and the Director are
+	// hidden most of the time. They are created on first use
+	// instead.
+	if ( pPref->getAudioEngineInfoProperties().visible ) {
+		getAudioEngineInfoForm()->show();
 	}
-	else {
-		m_pAudioEngineInfoForm->hide();
-	}
-	
-	m_pFilesystemInfoForm = new FilesystemInfoForm( nullptr );
-
-	m_pPlaylistDialog = new PlaylistDialog( nullptr );
-	m_pDirector = new Director( nullptr );
 
 	// Initially keyboard cursor is hidden.
 	m_bHideKeyboardCursor = true;
@@ -433,21 +433,53 @@ void HydrogenApp::setScrollStatusBarMessage( const QString& msg, int msec, bool
 
 
 
+AudioEngineInfoForm* HydrogenApp::getAudioEngineInfoForm()
+{
+	if ( m_pAudioEngineInfoForm == nullptr ) {
+		m_pAudioEngineInfoForm = new AudioEngineInfoForm( nullptr );
+		WindowProperties audioEngineInfoProp =
+			Preferences::get_instance()->getAudioEngineInfoProperties();
+		m_pAudioEngineInfoForm->move( audioEngineInfoProp.x, audioEngineInfoProp.y );
+		m_pAudioEngineInfoForm->installEventFilter( m_pMainForm );
+	}
+	return m_pAudioEngineInfoForm;
+}
+
+PlaylistDialog* HydrogenApp::getPlayListDialog()
+{
+	if ( m_pPlaylistDialog == nullptr ) {
+		m_pPlaylistDialog = new PlaylistDialog( nullptr );
+	}
+	return m_pPlaylistDialog;
+}
+
+Director* HydrogenApp::getDirector()
+{
+	if ( m_pDirector == nullptr ) {
+		m_pDirector = new Director( nullptr );
+		m_pDirector->installEventFilter( m_pMainForm );
+	}
+	return m_pDirector;
+}
+
 void HydrogenApp::showAudioEngineInfoForm()
 {
-	m_pAudioEngineInfoForm->hide();
+	getAudioEngineInfoForm()->hide();
 	m_pAudioEngineInfoForm->show();
 }
 
 void HydrogenApp::showFilesystemInfoForm()
 {
+	if ( m_pFilesystemInfoForm == nullptr ) {
+		m_pFilesystemInfoForm = new FilesystemInfoForm( nullptr );
+	}
 	m_pFilesystemInfoForm->hide();
 	m_pFilesystemInfoForm->show();
 }
 
 void HydrogenApp::showPlaylistDialog()
 {
-	if ( m_pPlaylistDialog->isVisible() ) {
+	if ( getPlayListDialog()->isVisible() ) {
 		m_pPlaylistDialog->hide();
 	} else {
 		m_pPlaylistDialog->show();
@@ -458,7 +490,7 @@ void HydrogenApp::showPlaylistDialog()
 
 void HydrogenApp::showDirector()
 {
-	if ( m_pDirector->isVisible() ) {
+	if ( getDirector()->isVisible() ) {
 		m_pDirector->hide();
 	} else {
 		m_pDirector->show();
@@ -495,176 +527,315 @@ void HydrogenApp::songModifiedEvent()
 
 void HydrogenApp::onEventQueueTimer()
 {
+	Tracer::setThreadName( "GUI" );
+	Tracer::Scope trace( "HydrogenApp::onEventQueueTimer" );
+
 	// use the timer to do schedule instrument slaughter;
 	EventQueue *pQueue = EventQueue::get_instance();
 
+	// Keeps the process cycles from being dropped while neither the
+	// AudioEngineInfoForm nor an OSC client queries them.
+	AudioEngine::get_instance()->get_profiler()->collect();
+
+	// Unfreezes the instruments changed since and frees the renders
+	// no longer played.
+	InstrumentFreezer::get_instance()->collect();
+
+	// Keeps track of the long notes to resume after relocations.
+	AudioEngine::get_instance()->get_column_snapshots()->update(
+		Hydrogen::get_instance()->getSong() );
+
+	// Aggregate the events of this tick. Of several events sharing
+	// both type and value only the first one is kept.
+	m_pendingEvents.clear();
 	Event event;
 	while ( ( event = pQueue->pop_event() ).type != EVENT_NONE ) {
-		
-		// Provide the event to all EventListeners registered to
-		// HydrogenApp. By registering itself as EventListener and
-		// implementing at least on the methods used below a
-		// particular GUI component can react on specific events.
-		for (int i = 0; i < (int)m_EventListeners.size(); i++ ) {
-			EventListener *pListener = m_EventListeners[ i ];
-
-			switch ( event.type ) {
-			case EVENT_STATE:
-				pListener->stateChangedEvent( event.value );
-				break;
-
-			case EVENT_PATTERN_CHANGED:
-				pListener->patternChangedEvent();
-				break;
-
-			case EVENT_PATTERN_MODIFIED:
-				pListener->patternModifiedEvent();
-				break;
-
-			case EVENT_SONG_MODIFIED:
-				pListener->songModifiedEvent();
-				break;
-
-			case EVENT_SELECTED_PATTERN_CHANGED:
-				pListener->selectedPatternChangedEvent();
-				break;
-
-			case EVENT_SELECTED_INSTRUMENT_CHANGED:
-				pListener->selectedInstrumentChangedEvent();
-				break;
-
-			case EVENT_PARAMETERS_INSTRUMENT_CHANGED:
-				pListener->parametersInstrumentChangedEvent();
-				break;
-
-			case EVENT_MIDI_ACTIVITY:
-				pListener->midiActivityEvent();
-				break;
-
-			case EVENT_NOTEON:
-				pListener->noteOnEvent( event.value );
-				break;
-
-			case EVENT_ERROR:
-				pListener->errorEvent( event.value );
-				break;
-
-			case EVENT_XRUN:
-				pListener->XRunEvent();
-				break;
-
-			case EVENT_METRONOME:
-				pListener->metronomeEvent( event.value );
-				break;
-
-			case EVENT_RECALCULATERUBBERBAND:
-				pListener->rubberbandbpmchangeEvent();
-				break;
-
-			case EVENT_PROGRESS:
-				pListener->progressEvent( event.value );
-				break;
-
-			case EVENT_JACK_SESSION:
-				pListener->jacksessionEvent( event.value );
-				break;
-
-			case EVENT_PLAYLIST_LOADSONG:
-				pListener->playlistLoadSongEvent( event.value );
-				break;
-
-			case EVENT_UNDO_REDO:
-				pListener->undoRedoActionEvent( event.value );
-				break;
-
-			case EVENT_TEMPO_CHANGED:
-				pListener->tempoChangedEvent( event.value );
-				break;
-				
-			case EVENT_UPDATE_PREFERENCES:
-				pListener->updatePreferencesEvent( event.value );
-				break;
-			
-			case EVENT_UPDATE_SONG:
-				pListener->updateSongEvent( event.value );
-				break;
-				
-			case EVENT_QUIT:
-				pListener->quitEvent( event.value );
-				break;
-
-			case EVENT_TIMELINE_ACTIVATION:
-				pListener->timelineActivationEvent( event.value );
-				break;
-
-			case EVENT_TIMELINE_UPDATE:
-				pListener->timelineUpdateEvent( event.value );
-				break;
-
-			case EVENT_JACK_TRANSPORT_ACTIVATION:
-				pListener->jackTransportActivationEvent( event.value );
-				break;
-
-			case EVENT_JACK_TIMEBASE_ACTIVATION:
-				pListener->jackTimebaseActivationEvent( event.value );
-				break;
-				
-			case EVENT_SONG_MODE_ACTIVATION:
-				pListener->songModeActivationEvent( event.value );
-				break;
-				
-			case EVENT_LOOP_MODE_ACTIVATION:
-				pListener->loopModeActivationEvent( event.value );
-				break;
-
-			case EVENT_ACTION_MODE_CHANGE:
-				pListener->actionModeChangeEvent( event.value );
-				break;
-				
-			default:
-				ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
+		bool bDuplicate = false;
+		if ( isCollapsible( event.type ) ) {
+			for ( const auto& pending : m_pendingEvents ) {
+				if ( pending.type == event.type && pending.value == event.value ) {
+					bDuplicate = true;
+					break;
+				}
 			}
 		}
+		if ( ! bDuplicate ) {
+			m_pendingEvents.push_back( event );
+		}
+	}
 
+	for ( const auto& pending : m_pendingEvents ) {
+		// Provide the event to all EventListeners registered to
+		// HydrogenApp for its type. By registering itself as
+		// EventListener and implementing at least on the methods
+		// called in dispatchEvent() a particular GUI component can
+		// react on specific events.
+		//
+		// Listeners may register or remove others while handling
+		// an event. Thus, the vector is accessed by index.
+		for ( int ii = 0; ii < (int)m_EventListeners.size(); ii++ ) {
+			if ( m_EventListeners[ ii ].types.test( pending.type ) ) {
+				dispatchEvent( m_EventListeners[ ii ].pListener, pending );
+			}
+		}
 	}
 
 	// midi notes
-	while(!pQueue->m_addMidiNoteVector.empty()){
+	// All notes recorded since the last tick are merged into their
+	// patterns as a single undo step.
+	EventQueue::AddMidiNoteVector recorded;
+	bool bMacro = false;
+	while ( pQueue->pop_recorded_note( recorded ) ) {
+		if ( ! bMacro ) {
+			m_pUndoStack->beginMacro( tr( "Record notes" ) );
+			bMacro = true;
+		}
+
+		Song* pSong = Hydrogen::get_instance()->getSong();
+		Pattern* pPattern = nullptr;
+		Instrument* pInstrument = nullptr;
+		if ( pSong != nullptr ) {
+			pPattern = pSong->getPatternList()->get( recorded.m_pattern );
+			pInstrument = pSong->getInstrumentList()->get( recorded.m_row );
+		}
+		if ( pPattern != nullptr && pInstrument != nullptr ) {
+			recorded.b_noteExist =
+				pPattern->find_note( recorded.m_column, -1, pInstrument,
+									 recorded.nk_noteKeyVal,
+									 recorded.no_octaveKeyVal ) != nullptr;
+		}
 
 		int rounds = 1;
-		if(pQueue->m_addMidiNoteVector[0].b_noteExist) { // run twice, delete old note and add new note. this let the undo stack consistent 
+		if(recorded.b_noteExist) { // run twice, delete old note and add new note. this let the undo stack consistent 
 			rounds = 2;
 		}
 		for(int i = 0; i<rounds; i++){
-			SE_addOrDeleteNoteAction *action = new SE_addOrDeleteNoteAction( pQueue->m_addMidiNoteVector[0].m_column,
-																			 pQueue->m_addMidiNoteVector[0].m_row,
-																			 pQueue->m_addMidiNoteVector[0].m_pattern,
-																			 pQueue->m_addMidiNoteVector[0].m_length,
-																			 pQueue->m_addMidiNoteVector[0].f_velocity,
-																			 pQueue->m_addMidiNoteVector[0].f_pan_L,
-																			 pQueue->m_addMidiNoteVector[0].f_pan_R,
+			SE_addOrDeleteNoteAction *action = new SE_addOrDeleteNoteAction( recorded.m_column,
+																			 recorded.m_row,
+																			 recorded.m_pattern,
+																			 recorded.m_length,
+																			 recorded.f_velocity,
+																			 recorded.f_pan_L,
+																			 recorded.f_pan_R,
 																			 0.0,
-																			 pQueue->m_addMidiNoteVector[0].nk_noteKeyVal,
-																			 pQueue->m_addMidiNoteVector[0].no_octaveKeyVal,
+																			 recorded.nk_noteKeyVal,
+																			 recorded.no_octaveKeyVal,
 																			 1.0f,
 																			 false,
 																			 false,
-																			 pQueue->m_addMidiNoteVector[0].b_isMidi,
-																			 pQueue->m_addMidiNoteVector[0].b_isInstrumentMode,
+																			 recorded.b_isMidi,
+																			 recorded.b_isInstrumentMode,
 																			 false );
 
-			HydrogenApp::get_instance()->m_pUndoStack->push( action );
+			m_pUndoStack->push( action );
 		}
-		pQueue->m_addMidiNoteVector.erase(pQueue->m_addMidiNoteVector.begin());
+	}
+	if ( bMacro ) {
+		m_pUndoStack->endMacro();
+	}
+}
+
 
+bool HydrogenApp::isCollapsible( EventType type )
+{
+	if ( EventQueue::is_coalescable( type ) ) {
+		return true;
+	}
+
+	switch ( type ) {
+	case EVENT_NOTEON:
+	case EVENT_METRONOME:
+	case EVENT_TEMPO_CHANGED:
+	case EVENT_PROGRESS:
+	case EVENT_SAMPLE_LOADING_PROGRESS:
+	case EVENT_TIMELINE_ACTIVATION:
+	case EVENT_TIMELINE_UPDATE:
+	case EVENT_JACK_TRANSPORT_ACTIVATION:
+	case EVENT_JACK_TIMEBASE_ACTIVATION:
+	case EVENT_SONG_MODE_ACTIVATION:
+	case EVENT_LOOP_MODE_ACTIVATION:
+	case EVENT_ACTION_MODE_CHANGE:
+		return true;
+	default:
+		return false;
 	}
 }
 
+void HydrogenApp::dispatchEvent( EventListener* pListener, const Event& event )
+{
+	switch ( event.type ) {
+	case EVENT_STATE:
+		pListener->stateChangedEvent( event.value );
+		break;
+
+	case EVENT_PATTERN_CHANGED:
+		pListener->patternChangedEvent();
+		break;
+
+	case EVENT_PATTERN_MODIFIED:
+		pListener->patternModifiedEvent();
+		break;
+
+	case EVENT_SONG_MODIFIED:
+		pListener->songModifiedEvent();
+		break;
+
+	case EVENT_SELECTED_PATTERN_CHANGED:
+		pListener->selectedPatternChangedEvent();
+		break;
+
+	case EVENT_SELECTED_INSTRUMENT_CHANGED:
+		pListener->selectedInstrumentChangedEvent();
+		break;
+
+	case EVENT_PARAMETERS_INSTRUMENT_CHANGED:
+		pListener->parametersInstrumentChangedEvent();
+		break;
+
+	case EVENT_MIDI_ACTIVITY:
+		pListener->midiActivityEvent();
+		break;
+
+	case EVENT_NOTEON:
+		pListener->noteOnEvent( event.value );
+		break;
+
+	case EVENT_ERROR:
+		pListener->errorEvent( event.value );
+		break;
+
+	case EVENT_XRUN:
+		pListener->XRunEvent();
+		break;
+
+	case EVENT_METRONOME:
+		pListener->metronomeEvent( event.value );
+		break;
+
+	case EVENT_RECALCULATERUBBERBAND:
+		pListener->rubberbandbpmchangeEvent();
+		break;
+
+	case EVENT_PROGRESS:
+		pListener->progressEvent( event.value );
+		break;
+
+	case EVENT_JACK_SESSION:
+		pListener->jacksessionEvent( event.value );
+		break;
+
+	case EVENT_PLAYLIST_LOADSONG:
+		pListener->playlistLoadSongEvent( event.value );
+		break;
+
+	case EVENT_UNDO_REDO:
+		pListener->undoRedoActionEvent( event.value );
+		break;
+
+	case EVENT_TEMPO_CHANGED:
+		pListener->tempoChangedEvent( event.value );
+		break;
+		
+	case EVENT_UPDATE_PREFERENCES:
+		pListener->updatePreferencesEvent( event.value );
+		break;
+	
+	case EVENT_UPDATE_SONG:
+		pListener->updateSongEvent( event.value );
+		break;
+		
+	case EVENT_QUIT:
+		pListener->quitEvent( event.value );
+		break;
+
+	case EVENT_TIMELINE_ACTIVATION:
+		pListener->timelineActivationEvent( event.value );
+		break;
+
+	case EVENT_TIMELINE_UPDATE:
+		pListener->timelineUpdateEvent( event.value );
+		break;
+
+	case EVENT_JACK_TRANSPORT_ACTIVATION:
+		pListener->jackTransportActivationEvent( event.value );
+		break;
+
+	case EVENT_JACK_TIMEBASE_ACTIVATION:
+		pListener->jackTimebaseActivationEvent( event.value );
+		break;
+		
+	case EVENT_SONG_MODE_ACTIVATION:
+		pListener->songModeActivationEvent( event.value );
+		break;
+		
+	case EVENT_LOOP_MODE_ACTIVATION:
+		pListener->loopModeActivationEvent( event.value );
+		break;
+
+	case EVENT_ACTION_MODE_CHANGE:
+		pListener->actionModeChangeEvent( event.value );
+		break;
+
+	case EVENT_SAMPLE_LOADING_PROGRESS:
+		pListener->sampleLoadingProgressEvent( event.value );
+		break;
+
+	case EVENT_DRUMKIT_LOADED:
+		pListener->drumkitLoadedEvent( event.value );
+		break;
+
+	case EVENT_DRUMKIT_LIST_CHANGED:
+		pListener->drumkitListChangedEvent( event.value );
+		break;
+
+	case EVENT_SAMPLE_PEAKS_READY:
+		pListener->samplePeaksReadyEvent( event.value );
+		break;
+
+	case EVENT_OVERLOAD_LEVEL:
+		pListener->overloadLevelEvent( event.value );
+		break;
+
+	case EVENT_LAYER_SAMPLES_LOADED:
+		pListener->layerSamplesLoadedEvent( event.value );
+		break;
+		
+	default:
+		ERRORLOG( QString("[dispatchEvent] Unhandled event: %1").arg( event.type ) );
+	}
+}
 
 void HydrogenApp::addEventListener( EventListener* pListener )
 {
 	if (pListener) {
-		m_EventListeners.push_back( pListener );
+		Subscription subscription;
+		subscription.pListener = pListener;
+		subscription.types.set();
+		m_EventListeners.push_back( subscription );
+	}
+}
+
+void HydrogenApp::addEventListener( EventListener* pListener,
+									std::initializer_list<EventType> types )
+{
+	if ( pListener == nullptr ) {
+		return;
+	}
+
+	Subscription* pSubscription = nullptr;
+	for ( auto& subscription : m_EventListeners ) {
+		if ( subscription.pListener == pListener ) {
+			pSubscription = &subscription;
+			break;
+		}
+	}
+	if ( pSubscription == nullptr ) {
+		m_EventListeners.push_back( Subscription{ pListener, {} } );
+		pSubscription = &m_EventListeners.back();
+	}
+
+	for ( const auto& type : types ) {
+		pSubscription->types.set( type );
 	}
 }
 
@@ -672,8 +843,9 @@ void HydrogenApp::addEventListener( EventListener* pListener )
 void HydrogenApp::removeEventListener( EventListener* pListener )
 {
 	for ( uint i = 0; i < m_EventListeners.size(); i++ ) {
-		if ( pListener == m_EventListeners[ i ] ) {
+		if ( pListener == m_EventListeners[ i ].pListener ) {
 			m_EventListeners.erase( m_EventListeners.begin() + i );
+			--i;
 		}
 	}
 }
@@ -714,11 +886,12 @@ void HydrogenApp::updatePreferencesEvent( int nValue ) {
 		int uiLayout = pPref->getDefaultUILayout();
 
 		WindowProperties audioEngineInfoProp = pPref->getAudioEngineInfoProperties();
-		m_pAudioEngineInfoForm->move( audioEngineInfoProp.x, audioEngineInfoProp.y );
 		if ( audioEngineInfoProp.visible ) {
+			getAudioEngineInfoForm()->move( audioEngineInfoProp.x, audioEngineInfoProp.y );
 			m_pAudioEngineInfoForm->show();
 		}
-		else {
+		else if ( m_pAudioEngineInfoForm != nullptr ) {
+			m_pAudioEngineInfoForm->move( audioEngineInfoProp.x, audioEngineInfoProp.y );
 			m_pAudioEngineInfoForm->hide();
 		}
 
@@ -26,10 +26,13 @@
 #include <core/config.h>
 #include <core/Object.h>
 #include <core/Globals.h>
+#include <core/EventQueue.h>
 #include <core/Preferences.h>
 
 #include "EventListener.h"
 
+#include <bitset>
+#include <initializer_list>
 #include <iostream>
 #include <cstdint>
 #include <vector>
@@ -104,9 +107,14 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		Mixer*				getMixer();
 		MainForm*			getMainForm();
 		SongEditorPanel*		getSongEditorPanel();
+		/** The following three windows are created on first
+			access.*/
 		AudioEngineInfoForm*		getAudioEngineInfoForm();
 		PlaylistDialog*			getPlayListDialog();
 		Director*			getDirector();
+		/** \return Whether getAudioEngineInfoForm() was called
+			before.*/
+		bool				hasAudioEngineInfoForm() const;
 		SampleEditor*			getSampleEditor();
 		PatternEditorPanel*		getPatternEditorPanel();
 		PlayerControl*			getPlayerControl();
@@ -122,7 +130,17 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 #ifdef H2CORE_HAVE_LADSPA
 		LadspaFXProperties* getLadspaFXProperties(uint nFX) {	return m_pLadspaFXProperties[nFX];	}
 #endif
+		/** Registers @a pListener for all event types.*/
 		void addEventListener( EventListener* pListener );
+		/**
+		 * Registers @a pListener for the event types in @a types
+		 * only. onEventQueueTimer() will skip it for all others.
+		 *
+		 * Calling it again for an already registered listener adds
+		 * @a types to its subscription.
+		 */
+		void addEventListener( EventListener* pListener,
+							   std::initializer_list<H2Core::EventType> types );
 		void removeEventListener( EventListener* pListener );
 		void closeFXProperties();
 
@@ -178,12 +196,33 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		     EventListener::updatePreferencesEvent()
 		 * - H2Core::EVENT_UPDATE_SONG -> 
 		     EventListener::updateSongEvent()
+		 * - H2Core::EVENT_SAMPLE_LOADING_PROGRESS -> 
+		     EventListener::sampleLoadingProgressEvent()
+		 * - H2Core::EVENT_DRUMKIT_LOADED -> 
+		     EventListener::drumkitLoadedEvent()
+		 * - H2Core::EVENT_DRUMKIT_LIST_CHANGED -> 
+		     EventListener::drumkitListChangedEvent()
+		 * - H2Core::EVENT_SAMPLE_PEAKS_READY -> 
+		     EventListener::samplePeaksReadyEvent()
+		 * - H2Core::EVENT_OVERLOAD_LEVEL -> 
+		     EventListener::overloadLevelEvent()
+		 * - H2Core::EVENT_LAYER_SAMPLES_LOADED -> 
+		     EventListener::layerSamplesLoadedEvent()
 		 * - H2Core::EVENT_NONE -> nothing
 		 *
-		 * In addition, all MIDI notes in
-		 * H2Core::EventQueue::m_addMidiNoteVector will converted into
-		 * actions via SE_addNoteAction() and deleted from the
-		 * former array.
+		 * The events popped during a single call are aggregated
+		 * first. Of several events sharing both type and value, only
+		 * the first one is dispatched, as long as handling them is
+		 * idempotent (see isCollapsible()). This way a burst of
+		 * e.g. H2Core::EVENT_NOTEON or H2Core::EVENT_METRONOME does
+		 * cause a single redraw per tick. Each event is only handed
+		 * to the listeners subscribed to its type (see
+		 * addEventListener()).
+		 *
+		 * In addition, all notes recorded since the last call
+		 * are read via H2Core::EventQueue::pop_recorded_note() and
+		 * converted into actions via SE_addOrDeleteNoteAction(),
+		 * grouped as a single undo step.
 		*/
 		void onEventQueueTimer();
 		void currentTabChanged(int);
@@ -207,7 +246,16 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		SampleEditor *				m_pSampleEditor;
 		Director *					m_pDirector;
 		QTimer *					m_pEventQueueTimer;
-		std::vector<EventListener*> 	m_EventListeners;
+		/** A registered EventListener and the event types it is
+			interested in.*/
+		struct Subscription {
+			EventListener*						pListener;
+			std::bitset<MAX_EVENT_TYPES>		types;
+		};
+		std::vector<Subscription> 	m_EventListeners;
+		/** Events of the current onEventQueueTimer() call. Kept as
+			member to reuse its memory.*/
+		std::vector<H2Core::Event>	m_pendingEvents;
 		QTabWidget *				m_pTab;
 		QSplitter *					m_pSplitter;
 		QVBoxLayout *				m_pMainVBox;
@@ -218,6 +266,13 @@ class HydrogenApp : public QObject, public EventListener, public H2Core::Object
 		void engineError(uint nErrorCode);
 
 		void setupSinglePanedInterface();
+
+		/** Calls the member of @a pListener corresponding to the
+			type of @a event.*/
+		void dispatchEvent( EventListener* pListener, const H2Core::Event& event );
+		/** \return true if handling the second of two events of type
+			@a type carrying the same value has no visible effect.*/
+		static bool isCollapsible( H2Core::EventType type );
 		virtual void songModifiedEvent() override;
 
 		/** Handles the loading and saving of the H2Core::Preferences
@@ -275,19 +330,9 @@ inline SongEditorPanel* HydrogenApp::getSongEditorPanel()
 	return m_pSongEditorPanel;
 }
 
-inline AudioEngineInfoForm* HydrogenApp::getAudioEngineInfoForm()
-{
-	return m_pAudioEngineInfoForm;
-}
-
-inline PlaylistDialog* HydrogenApp::getPlayListDialog()
-{
-	return m_pPlaylistDialog;
-}
-
-inline Director* HydrogenApp::getDirector()
+inline bool HydrogenApp::hasAudioEngineInfoForm() const
 {
-	return m_pDirector;
+	return m_pAudioEngineInfoForm != nullptr;
 }
 
 inline SampleEditor* HydrogenApp::getSampleEditor()
@@ -32,7 +32,9 @@
 #include <core/Hydrogen.h>
 #include <core/Globals.h>
 #include <core/Basics/Adsr.h>
+#include <core/Basics/DeferredSampleLoader.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleStretcher.h>
 #include <core/Basics/DrumkitComponent.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
@@ -521,7 +523,8 @@ InstrumentEditor::InstrumentEditor( QWidget* pParent )
 
 	selectLayer( m_nSelectedLayer );
 
-	HydrogenApp::get_instance()->addEventListener(this);
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_SELECTED_INSTRUMENT_CHANGED,
+														   EVENT_RECALCULATERUBBERBAND } );
 
 	selectedInstrumentChangedEvent(); 	// force an update
 
@@ -991,30 +994,50 @@ void InstrumentEditor::loadLayer()
 			selectedLayer = m_nSelectedLayer + i - 2;
 			if( ( i-2 >= InstrumentComponent::getMaxLayers() ) || ( selectedLayer + 1  > InstrumentComponent::getMaxLayers() ) ) break;
 
-			auto pNewSample = Sample::load( filename[i] );
-
-			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			// The sample is decoded in the background while the
+			// layer does play silence. This way the AudioEngine is
+			// locked just for swapping the pointers.
+			DeferredSampleLoader* pLoader = DeferredSampleLoader::get_instance();
+			std::shared_ptr<Sample> pNewSample;
+			if ( pLoader != nullptr ) {
+				pNewSample = std::make_shared<Sample>( filename[i] );
+			} else {
+				pNewSample = Sample::load( filename[i] );
+			}
 
 			/*
 				if we're using multiple layers, we start inserting the first layer
 				at m_nSelectedLayer and the next layer at m_nSelectedLayer+1
 			*/
 
+			// Layers are only edited by the GUI thread and can be
+			// inspected without locking.
 			InstrumentComponent *pCompo = m_pInstrument->get_component(m_nSelectedComponent);
+			H2Core::InstrumentLayer *pLayer = nullptr;
+			if ( pCompo != nullptr ) {
+				pLayer = pCompo->get_layer( selectedLayer );
+			}
+			H2Core::InstrumentLayer *pNewLayer = nullptr;
+			if ( pLayer == nullptr ) {
+				pNewLayer = new H2Core::InstrumentLayer( pNewSample );
+			}
+			// Freed when leaving the scope and not within the
+			// AudioEngine lock.
+			std::shared_ptr<Sample> pOldSample;
+
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
+
 			if( !pCompo ) {
 				pCompo = new InstrumentComponent( m_nSelectedComponent );
 				m_pInstrument->get_components()->push_back( pCompo );
 			}
 
-			H2Core::InstrumentLayer *pLayer = pCompo->get_layer( selectedLayer );
-
 			if (pLayer != nullptr) {
-				// insert new sample from newInstrument, old sample gets deleted by set_sample
+				pOldSample = pLayer->get_sample();
 				pLayer->set_sample( pNewSample );
 			}
 			else {
-				pLayer = new H2Core::InstrumentLayer(pNewSample);
-				m_pInstrument->get_component(m_nSelectedComponent)->set_layer( pLayer, selectedLayer );
+				pCompo->set_layer( pNewLayer, selectedLayer );
 			}
 
 			if ( fnc ){
@@ -1029,6 +1052,10 @@ void InstrumentEditor::loadLayer()
 			}
 
 			AudioEngine::get_instance()->unlock();
+
+			if ( pLoader != nullptr ) {
+				pLoader->load_first( pNewSample );
+			}
 		}
 	}
 
@@ -1123,12 +1150,10 @@ void InstrumentEditor::labelClicked( ClickableLabel* pRef )
 			m_pInstrument->set_name( sNewName );
 			selectedInstrumentChangedEvent();
 
-#ifdef H2CORE_HAVE_JACK
 			AudioEngine::get_instance()->lock( RIGHT_HERE );
 			Hydrogen *engine = Hydrogen::get_instance();
 			engine->renameJackPorts(engine->getSong());
 			AudioEngine::get_instance()->unlock();
-#endif
 
 			// this will force an update...
 			EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1335,9 +1360,7 @@ void InstrumentEditor::compoChangeAddDelete(QAction* pAction)
 				// this will force an update...
 				EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
-#ifdef H2CORE_HAVE_JACK
 				pEngine->renameJackPorts(pEngine->getSong());
-#endif
 			}
 			else {
 				// user entered nothing or pressed Cancel
@@ -1410,9 +1433,7 @@ void InstrumentEditor::compoChangeAddDelete(QAction* pAction)
 
 
 
-#ifdef H2CORE_HAVE_JACK
 			pEngine->renameJackPorts(pEngine->getSong());
-#endif
 		}
 
 		m_pLayerPreview->set_selected_component(m_nSelectedComponent);
@@ -1455,6 +1476,14 @@ void InstrumentEditor::rubberbandbpmchangeEvent()
 						if ( pSample ) {
 							if( pSample->get_rubberband().use ) {
 								//INFOLOG( QString("Instrument %1 Layer %2" ).arg(nInstr).arg(nLayer));
+								// The current sample keeps on playing until
+								// the stretched one is ready.
+								SampleStretcher* pStretcher = SampleStretcher::get_instance();
+								if ( pStretcher != nullptr ) {
+									pStretcher->stretch( pSample );
+									continue;
+								}
+								
 								auto pNewSample = Sample::load(
 														pSample->get_filepath(),
 														pSample->get_loops(),
@@ -65,7 +65,7 @@ InstrumentEditorPanel::InstrumentEditorPanel( QWidget *pParent )
 	this->setLayout( vbox );
 	m_nLayer = 0;
 
-	HydrogenApp::get_instance()->addEventListener(this);
+	HydrogenApp::get_instance()->addEventListener( this, { H2Core::EVENT_PARAMETERS_INSTRUMENT_CHANGED } );
 }
 
 
@@ -65,7 +65,7 @@ LayerPreview::LayerPreview( QWidget* pParent )
 
 	m_speakerPixmap.load( Skin::getImagePath() + "/instrumentEditor/speaker.png" );
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_SELECTED_INSTRUMENT_CHANGED } );
 
 	/**
 	 * We get a style similar to the one used for the 2 buttons on top of the instrument editor panel
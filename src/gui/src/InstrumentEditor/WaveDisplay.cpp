@@ -24,11 +24,16 @@
 #include <core/Basics/Song.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/SamplePeaks.h>
 using namespace H2Core;
 
 #include "WaveDisplay.h"
+#include "../HydrogenApp.h"
 #include "../Skin.h"
 
+#include <algorithm>
+
 const char* WaveDisplay::__class_name = "WaveDisplay";
 
 WaveDisplay::WaveDisplay(QWidget* pParent)
@@ -38,6 +43,7 @@ WaveDisplay::WaveDisplay(QWidget* pParent)
  , m_sSampleName( "-" )
  , m_pLayer( nullptr )
  , m_SampleNameAlignment( Qt::AlignCenter )
+ , m_bWaveformChanged( true )
 {
 	setAttribute(Qt::WA_OpaquePaintEvent);
 
@@ -50,6 +56,9 @@ WaveDisplay::WaveDisplay(QWidget* pParent)
 
 	m_pPeakData = new int[ width() ];
 	memset( m_pPeakData, 0, width() * sizeof( m_pPeakData[0] ) );
+
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_SAMPLE_PEAKS_READY,
+														   EVENT_LAYER_SAMPLES_LOADED } );
 }
 
 
@@ -75,13 +84,12 @@ void WaveDisplay::paintEvent( QPaintEvent *ev )
 	painter.drawRect(0, 0, width(), height());
 	
 	if( m_pLayer ){
-		painter.setPen( QColor( 102, 150, 205 ) );
-		int VCenter = height() / 2;
-		for ( int x = 0; x < width(); x++ ) {
-			painter.drawLine( x, VCenter, x, m_pPeakData[x] + VCenter );
-			painter.drawLine( x, VCenter, x, -m_pPeakData[x] + VCenter );
+		qreal fPixelRatio = devicePixelRatio();
+		if ( m_bWaveformChanged || m_waveform.size() != size() * fPixelRatio ||
+			 m_waveform.devicePixelRatio() != fPixelRatio ) {
+			drawWaveform( fPixelRatio );
 		}
-		
+		painter.drawPixmap( 0, 0, m_waveform );
 	}
 	
 	QFont font;
@@ -100,11 +108,77 @@ void WaveDisplay::paintEvent( QPaintEvent *ev )
 	
 }
 
+void WaveDisplay::drawWaveform( qreal fPixelRatio )
+{
+	m_waveform = QPixmap( size() * fPixelRatio );
+	m_waveform.setDevicePixelRatio( fPixelRatio );
+	m_waveform.fill( Qt::transparent );
+
+	// Vertical lines do not need antialiasing.
+	QPainter painter( &m_waveform );
+	painter.setPen( QColor( 102, 150, 205 ) );
+	int VCenter = height() / 2;
+	for ( int x = 0; x < width(); x++ ) {
+		painter.drawLine( x, -m_pPeakData[x] + VCenter, x, m_pPeakData[x] + VCenter );
+	}
+
+	m_bWaveformChanged = false;
+}
+
+void WaveDisplay::invalidateWaveform()
+{
+	m_bWaveformChanged = true;
+	update();
+}
+
 void WaveDisplay::resizeEvent( QResizeEvent * event )
 {
 	updateDisplay(m_pLayer);
 }
 
+void WaveDisplay::samplePeaksReadyEvent( int nValue )
+{
+	UNUSED( nValue );
+	if ( m_pLayer != nullptr ) {
+		updateDisplay( m_pLayer );
+	}
+}
+
+void WaveDisplay::layerSamplesLoadedEvent( int nValue )
+{
+	// The sample of the layer might have been replaced.
+	samplePeaksReadyEvent( nValue );
+}
+
+bool WaveDisplay::readPeaks( std::shared_ptr<Sample> pSample,
+							 double fFirstFrame, double fFramesPerPixel,
+							 int nFirstPixel, int nPixels, float fGain )
+{
+	SamplePeakBuilder* pBuilder = SamplePeakBuilder::get_instance();
+	if ( pBuilder == nullptr || pSample == nullptr || pSample->get_frames() <= 0 ) {
+		return false;
+	}
+	auto pPeaks = pBuilder->peaks( pSample );
+	if ( pPeaks == nullptr ) {
+		return false;
+	}
+
+	// Samples resampled at load time are summarized at the rate of
+	// their file.
+	double fScale = pPeaks->get_frames() / static_cast<double>( pSample->get_frames() );
+	std::vector<float> min( nPixels ), max( nPixels );
+	if ( ! pPeaks->get_peaks( 0, fFirstFrame * fScale, fFramesPerPixel * fScale,
+							  nPixels, min.data(), max.data() ) ) {
+		return false;
+	}
+
+	for ( int ii = 0; ii < nPixels; ++ii ) {
+		m_pPeakData[ nFirstPixel + ii ] =
+			static_cast<int>( std::max( max[ ii ], -min[ ii ] ) * fGain );
+	}
+	return true;
+}
+
 
 
 void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
@@ -137,14 +211,33 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = height() / 2.0 * pLayer->get_gain();
 
+		if ( readPeaks( pLayer->get_sample(), 0, nScaleFactor, 0,
+						m_nCurrentWidth, fGain ) ) {
+			invalidateWaveform();
+			return;
+		}
+
 		auto pSampleData = pLayer->get_sample()->get_data_l();
+		// Only the head of a streamed sample is held in memory.
+		int nResidentFrames = pLayer->get_sample()->get_resident_frames();
+		// Compactly stored and deferred samples are converted for
+		// display.
+		std::vector<float> compactData_L, compactData_R;
+		if ( pLayer->get_sample()->is_compact() || pLayer->get_sample()->is_deferred() ) {
+			compactData_L.resize( nSampleLength );
+			compactData_R.resize( nSampleLength );
+			pLayer->get_sample()->read_frames( 0, nSampleLength,
+											   compactData_L.data(), compactData_R.data() );
+			pSampleData = compactData_L.data();
+			nResidentFrames = nSampleLength;
+		}
 
 		int nSamplePos =0;
 		int nVal;
 		for ( int i = 0; i < width(); ++i ){
 			nVal = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
+				if ( j < nSampleLength && nSamplePos < nResidentFrames ) {
 					int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
 					if ( newVal > nVal ) {
 						nVal = newVal;
@@ -164,7 +257,7 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 		
 	}
 
-	update();
+	invalidateWaveform();
 }
 
 void WaveDisplay::mouseDoubleClickEvent(QMouseEvent *ev)
@@ -27,13 +27,17 @@
 #include <QtWidgets>
 
 #include <core/Object.h>
+#include "../EventListener.h"
+
+#include <memory>
 
 namespace H2Core
 {
 	class InstrumentLayer;
+	class Sample;
 }
 
-class WaveDisplay : public QWidget, public H2Core::Object
+class WaveDisplay : public QWidget, public H2Core::Object, public EventListener
 {
     H2_OBJECT
 	Q_OBJECT
@@ -50,10 +54,36 @@ class WaveDisplay : public QWidget, public H2Core::Object
 		
 		void			setSampleNameAlignment(Qt::AlignmentFlag flag);
 
+		/** Redraws using the SamplePeaks which became available.*/
+		virtual void	samplePeaksReadyEvent( int nValue ) override;
+		virtual void	layerSamplesLoadedEvent( int nValue ) override;
+
 	signals:
 		void doubleClicked(QWidget *pWidget);
 
 	protected:
+		/**
+		 * Fills @a nPixels entries of #m_pPeakData, starting at
+		 * @a nFirstPixel, with the peaks of the left channel of
+		 * @a pSample taken from its H2Core::SamplePeaks.
+		 *
+		 * \param fFirstFrame First frame of @a pSample covered.
+		 * \param fFramesPerPixel Number of frames of @a pSample
+		 * covered by each pixel.
+		 * \param fGain Scaling applied to the peaks.
+		 *
+		 * \return false if the pyramid is not built yet or too
+		 * coarse for @a fFramesPerPixel. The frames have to be
+		 * scanned by the caller instead.
+		 */
+		bool			readPeaks( std::shared_ptr<H2Core::Sample> pSample,
+								   double fFirstFrame, double fFramesPerPixel,
+								   int nFirstPixel, int nPixels, float fGain );
+
+		/** Has to be called instead of update() whenever
+			#m_pPeakData changed.*/
+		void			invalidateWaveform();
+
 		Qt::AlignmentFlag			m_SampleNameAlignment;
 		QPixmap						m_Background;
 		QString						m_sSampleName;
@@ -66,6 +96,17 @@ class WaveDisplay : public QWidget, public H2Core::Object
 		int							m_nCurrentWidth;
 		
 		H2Core::InstrumentLayer *	m_pLayer;
+
+	private:
+		/** Renders #m_pPeakData into #m_waveform.*/
+		void			drawWaveform( qreal fPixelRatio );
+
+		/** The peaks as drawn by the last paintEvent(). Only
+			re-rendered after invalidateWaveform() or a change of
+			size, so repaints caused by the sample name or
+			overlapping widgets are a single blit.*/
+		QPixmap						m_waveform;
+		bool						m_bWaveformChanged;
 };
 
 inline void WaveDisplay::setSampleNameAlignment(Qt::AlignmentFlag flag)
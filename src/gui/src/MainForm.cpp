@@ -25,8 +25,10 @@
 #include <core/Hydrogen.h>
 #include <core/AudioEngine.h>
 #include <core/Smf/SMF.h>
+#include <core/Smf/SMFReader.h>
 #include <core/Preferences.h>
 #include <core/Timeline.h>
+#include <core/IO/SongAutosaver.h>
 #include <core/Helpers/Files.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
@@ -173,11 +175,12 @@ MainForm::MainForm( QApplication * pQApplication, const QString& songFilename, c
 	h2app->getSongEditorPanel()->installEventFilter (this);
 	h2app->getPlayerControl()->installEventFilter(this);
 	InstrumentEditorPanel::get_instance()->installEventFilter(this);
-	h2app->getAudioEngineInfoForm()->installEventFilter(this);
-	h2app->getDirector()->installEventFilter(this);
+	// The AudioEngineInfoForm and the Director install this filter
+	// themselves once they get created.
 	//	h2app->getPlayListDialog()->installEventFilter(this);
 	installEventFilter( this );
 
+	m_pAutosaver = new SongAutosaver();
 	connect( &m_AutosaveTimer, SIGNAL(timeout()), this, SLOT(onAutoSaveTimer()));
 	m_AutosaveTimer.start( 60 * 1000 );
 
@@ -230,6 +233,11 @@ MainForm::MainForm( QApplication * pQApplication, const QString& songFilename, c
 
 MainForm::~MainForm()
 {
+	// Let pending autosaves finish before removing their file.
+	m_AutosaveTimer.stop();
+	delete m_pAutosaver;
+	m_pAutosaver = nullptr;
+
 	// remove the autosave file
 	QFile file( getAutoSaveFilename() );
 	file.remove();
@@ -242,7 +250,6 @@ MainForm::~MainForm()
 	}
 
 	// remove the autosave file
-	m_AutosaveTimer.stop();
 	QFile autosaveFile( "hydrogen_autosave.h2song" );
 	autosaveFile.remove();
 
@@ -308,6 +315,7 @@ void MainForm::createMenuBar()
 
 	m_pFileMenu->addAction ( tr ( "Open &Pattern" ), this, SLOT ( action_file_openPattern() ), QKeySequence ( "" ) );
 	m_pFileMenu->addAction( tr( "E&xport Pattern As..." ), this, SLOT( action_file_export_pattern_as() ), QKeySequence( "Ctrl+P" ) );
+	m_pFileMenu->addAction( tr( "&Import MIDI File" ), this, SLOT( action_file_import_midi() ), QKeySequence( "" ) );
 
 	m_pFileMenu->addSeparator();				// -----
 
@@ -742,6 +750,7 @@ void MainForm::action_inputMode_instrument()
 	if( !Preferences::get_instance()->__playselectedinstrument )
 	{
 		Preferences::get_instance()->__playselectedinstrument = true;
+		Preferences::get_instance()->publishRealtimeConfig();
 		m_pDrumkitAction->setChecked (false );
 	}
 	m_pInstrumentAction->setChecked( true );
@@ -752,6 +761,7 @@ void MainForm::action_inputMode_drumkit()
 	if( Preferences::get_instance()->__playselectedinstrument )
 	{
 		Preferences::get_instance()->__playselectedinstrument = false;
+		Preferences::get_instance()->publishRealtimeConfig();
 		m_pInstrumentAction->setChecked( false );
 	}
 	m_pDrumkitAction->setChecked (true );
@@ -949,6 +959,39 @@ void MainForm::action_file_openPattern()
 	}
 }
 
+void MainForm::action_file_import_midi()
+{
+	Hydrogen *pHydrogen = Hydrogen::get_instance();
+	Song *pSong = pHydrogen->getSong();
+	PatternList *pPatternList = pSong->getPatternList();
+
+	QFileDialog fd(this);
+	fd.setFileMode( QFileDialog::ExistingFiles );
+	fd.setNameFilter( tr( "MIDI files (*.mid *.midi)" ) );
+	fd.setWindowTitle( tr( "Import MIDI File" ) );
+
+	if ( fd.exec() != QDialog::Accepted ) {
+		return;
+	}
+
+	// Each file becomes a pattern inserted after the selected one.
+	SMFReader reader( pSong->getInstrumentList(), pSong->getResolution() );
+	int nPosition = pHydrogen->getSelectedPatternNumber() + 1;
+	for ( const QString& sFilename : fd.selectedFiles() ) {
+		Pattern* pNewPattern = reader.import( sFilename );
+		if ( pNewPattern == nullptr ) {
+			QMessageBox::warning( this, "Hydrogen", tr( "Unable to import %1" ).arg( sFilename ) );
+			continue;
+		}
+
+		if ( !pPatternList->check_name( pNewPattern->get_name() ) ) {
+			pNewPattern->set_name( pPatternList->find_unused_pattern_name( pNewPattern->get_name() ) );
+		}
+		SE_insertPatternAction* pAction = new SE_insertPatternAction( nPosition++, pNewPattern );
+		HydrogenApp::get_instance()->m_pUndoStack->push( pAction );
+	}
+}
+
 /// \todo parametrizzare il metodo action_file_open ed eliminare il seguente...
 void MainForm::action_file_openDemo()
 {
@@ -1129,9 +1172,7 @@ void MainForm::action_instruments_addComponent()
 		// this will force an update...
 		EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
-#ifdef H2CORE_HAVE_JACK
 		pEngine->renameJackPorts(pEngine->getSong());
-#endif
 	}
 	else {
 		// user entered nothing or pressed Cancel
@@ -1427,12 +1468,15 @@ void MainForm::savePreferences() {
 	instrumentRackProp.visible = h2app->getInstrumentRack()->isVisible();
 	pPreferences->setInstrumentRackProperties( instrumentRackProp );
 
-	// save audio engine info properties
-	WindowProperties audioEngineInfoProp;
-	audioEngineInfoProp.x = h2app->getAudioEngineInfoForm()->x();
-	audioEngineInfoProp.y = h2app->getAudioEngineInfoForm()->y();
-	audioEngineInfoProp.visible = h2app->getAudioEngineInfoForm()->isVisible();
-	pPreferences->setAudioEngineInfoProperties( audioEngineInfoProp );
+	// save audio engine info properties. If the form was never
+	// shown, the stored ones are still valid.
+	if ( h2app->hasAudioEngineInfoForm() ) {
+		WindowProperties audioEngineInfoProp;
+		audioEngineInfoProp.x = h2app->getAudioEngineInfoForm()->x();
+		audioEngineInfoProp.y = h2app->getAudioEngineInfoForm()->y();
+		audioEngineInfoProp.visible = h2app->getAudioEngineInfoForm()->isVisible();
+		pPreferences->setAudioEngineInfoProperties( audioEngineInfoProp );
+	}
 
 
 #ifdef H2CORE_HAVE_LADSPA
@@ -2074,11 +2118,9 @@ void MainForm::onAutoSaveTimer()
 	Song *pSong = Hydrogen::get_instance()->getSong();
 	assert( pSong );
 	if ( pSong->getIsModified() ) {
-		QString sOldFilename = pSong->getFilename();
-		pSong->save( getAutoSaveFilename() );
-
-		pSong->setFilename( sOldFilename );
-		pSong->setIsModified( true );
+		// Only the snapshot is taken here. Writing it is done in the
+		// background.
+		m_pAutosaver->save( pSong, getAutoSaveFilename() );
 	}
 }
 
@@ -2234,6 +2276,40 @@ void MainForm::undoRedoActionEvent( int nEvent ){
 	}
 }
 
+void MainForm::sampleLoadingProgressEvent( int nValue ) {
+	if ( nValue < 100 ) {
+		h2app->setStatusBarMessage( tr( "Loading samples ... %1%" ).arg( nValue ) );
+	} else {
+		h2app->setStatusBarMessage( tr( "Samples loaded." ), 2000 );
+	}
+}
+
+void MainForm::drumkitLoadedEvent( int nValue ) {
+	if ( nValue != 0 ) {
+		h2app->setStatusBarMessage( tr( "Instruments changed in the meantime. Drumkit discarded." ), 5000 );
+		return;
+	}
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	pHydrogen->getSong()->setIsModified( true );
+	h2app->onDrumkitLoad( pHydrogen->getCurrentDrumkitName() );
+	h2app->getPatternEditorPanel()->getDrumPatternEditor()->updateEditor();
+	h2app->getPatternEditorPanel()->updatePianorollEditor();
+	InstrumentEditorPanel::get_instance()->notifyOfDrumkitChange();
+}
+
+void MainForm::drumkitListChangedEvent( int nValue ) {
+	UNUSED( nValue );
+
+	// Dialogs, like the SoundLibraryPropertiesDialog, might still
+	// hold drumkits owned by the panel. They do update the panel
+	// themselves once done.
+	if ( QApplication::activeModalWidget() != nullptr ) {
+		return;
+	}
+	h2app->getInstrumentRack()->getSoundLibraryPanel()->updateDrumkitList();
+}
+
 bool MainForm::handleSelectNextPrevSongOnPlaylist( int step )
 {
 	int nPlaylistSize = Playlist::get_instance()->size();
@@ -35,6 +35,9 @@
 #include <core/Object.h>
 
 class HydrogenApp;
+namespace H2Core {
+	class SongAutosaver;
+}
 class QUndoView;///debug only
 
 ///
@@ -75,6 +78,15 @@ class MainForm : public QMainWindow, public EventListener, public H2Core::Object
 		 */
 		virtual void updatePreferencesEvent( int nValue ) override;
 		virtual void undoRedoActionEvent( int nEvent ) override;
+		/** Shows the progress of the H2Core::SampleLoader in the
+			status bar.*/
+		virtual void sampleLoadingProgressEvent( int nValue ) override;
+		/** Updates the editors once a drumkit prepared in the
+			background was swapped in.*/
+		virtual void drumkitLoadedEvent( int nValue ) override;
+		/** Refreshes the SoundLibraryPanel once drumkits were
+			added, removed, or modified on disk.*/
+		virtual void drumkitListChangedEvent( int nValue ) override;
 		static void usr1SignalHandler(int unused);
 
 
@@ -126,6 +138,9 @@ public slots:
 		 */
 		void action_file_save_as();
 		void action_file_openPattern();
+		/** Imports the selected Standard MIDI Files as new
+			patterns using H2Core::SMFReader.*/
+		void action_file_import_midi();
 		void action_file_export_pattern_as();
 		bool action_file_exit();
 
@@ -260,6 +275,7 @@ public slots:
 		QUndoView *	m_pUndoView;///debug only
 
 		QTimer		m_AutosaveTimer;
+		H2Core::SongAutosaver* m_pAutosaver;
 
 		/** Create the menubar */
 		void createMenuBar();
@@ -41,15 +41,32 @@
 #include <core/Preferences.h>
 #include <core/Basics/Note.h>
 #include <core/FX/Effects.h>
+#include <core/Tracer.h>
 using namespace H2Core;
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 
 #define MIXER_STRIP_WIDTH	56
 #define MASTERMIXER_STRIP_WIDTH	126
 
 const char* Mixer::__class_name = "Mixer";
 
+/** Resolution of the peak meters. Peaks are rounded down to a
+	multiple of it, so decaying meters do settle at zero and strips
+	without a visible change are not repainted.*/
+static const float fMeterResolution = 1.0f / 256;
+
+/** \return Peak to display given the latest one of the engine and
+	the one currently shown.*/
+static float meterPeak( float fNewPeak, float fOldPeak, float fFallOff )
+{
+	float fPeak = fNewPeak >= fOldPeak ? fNewPeak : fOldPeak / fFallOff;
+	return std::floor( fPeak / fMeterResolution ) * fMeterResolution;
+}
+
 Mixer::Mixer( QWidget* pParent )
  : QWidget( pParent )
  , Object( __class_name )
@@ -65,7 +82,8 @@ Mixer::Mixer( QWidget* pParent )
 	m_pFaderHBox->setMargin( 0 );
 
 	m_pFaderPanel = new QWidget( nullptr );
-	m_pFaderPanel->resize( MIXER_STRIP_WIDTH * MAX_INSTRUMENTS, height() );
+	// Sized by updateMixer() according to the number of strips.
+	m_pFaderPanel->resize( 0, height() );
 
 	m_pFaderPanel->setLayout( m_pFaderHBox );
 
@@ -76,10 +94,6 @@ Mixer::Mixer( QWidget* pParent )
 	m_pFaderScrollArea->setMinimumWidth( MIXER_STRIP_WIDTH * 4 );
 	m_pFaderScrollArea->setWidget( m_pFaderPanel );
 
-	for ( uint i = 0; i < MAX_INSTRUMENTS; ++i ) {
-		m_pMixerLine[ i ] = nullptr;
-	}
-
 //~ fader panel
 
 
@@ -163,11 +177,14 @@ Mixer::Mixer( QWidget* pParent )
 	this->setLayout( pLayout );
 
 
+	memset( &m_peaks, 0, sizeof( m_peaks ) );
+
+	// Started in showEvent().
 	m_pUpdateTimer = new QTimer( this );
+	m_pUpdateTimer->setInterval( 50 );
 	connect( m_pUpdateTimer, SIGNAL( timeout() ), this, SLOT( updateMixer() ) );
-	m_pUpdateTimer->start(50);
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { EVENT_NOTEON } );
 }
 
 Mixer::~Mixer()
@@ -268,7 +285,7 @@ void Mixer::soloClicked(MixerLine* ref)
 
 	pController->setStripIsSoloed( nLine, ref->isSoloClicked() );
 
-	for ( int i = 0; i < nInstruments; ++i ) {
+	for ( int i = 0; i < nInstruments && i < m_pMixerLine.size(); ++i ) {
 			if( m_pMixerLine[i] ){
 				m_pMixerLine[i]->setSoloClicked( pInstrList->get(i)->is_soloed() );
 			}
@@ -282,6 +299,9 @@ void Mixer::soloClicked(MixerLine* ref)
 /// used in PatternEditorInstrumentList
 void Mixer::soloClicked(uint nLine)
 {
+	if ( nLine >= m_pMixerLine.size() ) {
+		return;
+	}
 	MixerLine * pMixerLine = m_pMixerLine[ nLine ];
 
 	if( pMixerLine ){
@@ -294,7 +314,7 @@ void Mixer::soloClicked(uint nLine)
 
 bool Mixer::isSoloClicked( uint n )
 {
-	if ( n >= MAX_INSTRUMENTS || m_pMixerLine[ n ] == nullptr ) {
+	if ( n >= m_pMixerLine.size() || m_pMixerLine[ n ] == nullptr ) {
 		return false;
 	}
 	return m_pMixerLine[ n ]->isSoloClicked();
@@ -331,7 +351,7 @@ void Mixer::noteOnClicked( MixerLine* ref )
 
 uint Mixer::findMixerLineByRef(MixerLine* ref)
 {
-	for (uint i = 0; i < MAX_INSTRUMENTS; i++) {
+	for (uint i = 0; i < m_pMixerLine.size(); i++) {
 		if (m_pMixerLine[i] == ref) {
 			return i;
 		}
@@ -374,6 +394,7 @@ void Mixer::masterVolumeChanged(MasterMixerLine* ref)
 
 void Mixer::updateMixer()
 {
+	Tracer::Scope trace( "Mixer::updateMixer" );
 	Preferences *pPref = Preferences::get_instance();
 	bool bShowPeaks = pPref->showInstrumentPeaks();
 
@@ -386,9 +407,31 @@ void Mixer::updateMixer()
 
 	float fallOff = pPref->getMixerFalloffSpeed();
 
+	// Without a new snapshot the meters just decay.
+	bool bNewPeaks = AudioEngine::get_instance()->get_peak_meters()->take( &m_peaks );
+	if ( ! bNewPeaks || ! bShowPeaks ) {
+		memset( &m_peaks, 0, sizeof( m_peaks ) );
+	}
+
+	// The render statistics are summarized about once a
+	// second. The first call after showing the Mixer only records
+	// their current values.
+	bool bShowRenderStats = m_renderStatsTimer.isValid();
+	bool bUpdateRenderStats = ! bShowRenderStats ||
+		m_renderStatsTimer.elapsed() >= 1000;
+	qint64 nElapsedNs = bShowRenderStats ? m_renderStatsTimer.nsecsElapsed() : 0;
+	if ( bUpdateRenderStats ) {
+		m_renderStatsTimer.start();
+	}
+
 	int nInstruments = pInstrList->size();
 	int nCompo = pDrumkitComponentList->size();
-	for ( unsigned nInstr = 0; nInstr < MAX_INSTRUMENTS; ++nInstr ) {
+	// The strips follow the instruments of the song. Surplus ones
+	// are destroyed in the loop below and dropped afterwards.
+	unsigned nLines = std::max( m_pMixerLine.size(), static_cast<size_t>( nInstruments ) );
+	m_pMixerLine.resize( nLines, nullptr );
+	m_renderStats.resize( nLines, Instrument::RenderStats() );
+	for ( unsigned nInstr = 0; nInstr < nLines; ++nInstr ) {
 
 		if ( nInstr >= nInstruments ) {	// unused instrument! let's hide and destroy the mixerline!
 			if ( m_pMixerLine[ nInstr ] ) {
@@ -418,11 +461,12 @@ void Mixer::updateMixer()
 			Instrument *pInstr = pInstrList->get( nInstr );
 			assert( pInstr );
 
-			float fNewPeak_L = pInstr->get_peak_l();
-			pInstr->set_peak_l( 0.0f );	// reset instrument peak
-
-			float fNewPeak_R = pInstr->get_peak_r();
-			pInstr->set_peak_r( 0.0f );	// reset instrument peak
+			float fNewPeak_L = 0.0f;
+			float fNewPeak_R = 0.0f;
+			if ( static_cast<int>( nInstr ) < m_peaks.nInstruments ) {
+				fNewPeak_L = m_peaks.instrument_L[ nInstr ];
+				fNewPeak_R = m_peaks.instrument_R[ nInstr ];
+			}
 
 			float fNewVolume = pInstr->get_volume();
 
@@ -432,26 +476,8 @@ void Mixer::updateMixer()
 
 
 			// fader
-			float fOldPeak_L = pLine->getPeak_L();
-			float fOldPeak_R = pLine->getPeak_R();
-
-			if (!bShowPeaks) {
-				fNewPeak_L = 0.0f;
-				fNewPeak_R = 0.0f;
-			}
-
-			if ( fNewPeak_L >= fOldPeak_L) {	// LEFT peak
-				pLine->setPeak_L( fNewPeak_L );
-			}
-			else {
-				pLine->setPeak_L( fOldPeak_L / fallOff );
-			}
-			if ( fNewPeak_R >= fOldPeak_R) {	// Right peak
-				pLine->setPeak_R( fNewPeak_R );
-			}
-			else {
-				pLine->setPeak_R( fOldPeak_R / fallOff );
-			}
+			pLine->setPeak_L( meterPeak( fNewPeak_L, pLine->getPeak_L(), fallOff ) );
+			pLine->setPeak_R( meterPeak( fNewPeak_R, pLine->getPeak_R(), fallOff ) );
 
 			// fader position
 			pLine->setVolume( fNewVolume );
@@ -489,10 +515,34 @@ void Mixer::updateMixer()
 
 			pLine->setSelected( nInstr == nSelectedInstr );
 
+			if ( bUpdateRenderStats ) {
+				Instrument::RenderStats stats = pInstr->get_render_stats();
+				const Instrument::RenderStats& last = m_renderStats[ nInstr ];
+				// Counters of replaced instruments start from zero
+				// again.
+				long long nFrames = std::max( stats.nFrames - last.nFrames, 0LL );
+				long long nResampledFrames =
+					std::max( stats.nResampledFrames - last.nResampledFrames, 0LL );
+				long long nNanoseconds =
+					std::max( stats.nNanoseconds - last.nNanoseconds, 0LL );
+				if ( bShowRenderStats && nElapsedNs > 0 ) {
+					pLine->setToolTip(
+						tr( "%1\nVoices: %2\nRender load: %3 %\nResampled frames: %4 %" )
+						.arg( sName )
+						.arg( stats.nVoices )
+						.arg( 100.0 * nNanoseconds / nElapsedNs, 0, 'f', 2 )
+						.arg( nFrames > 0 ? 100.0 * nResampledFrames / nFrames : 0.0, 0, 'f', 0 ) );
+				}
+				m_renderStats[ nInstr ] = stats;
+			}
+
 			pLine->updateMixerLine();
 		}
 	}
+	m_pMixerLine.resize( nInstruments );
+	m_renderStats.resize( nInstruments );
 
+	int nCompoIndex = 0;
 	for (auto& pDrumkitComponent : *pDrumkitComponentList) {
 
 		if( m_pComponentMixerLine.find(pDrumkitComponent->get_id()) == m_pComponentMixerLine.end() ) {
@@ -508,37 +558,21 @@ void Mixer::updateMixer()
 
 		ComponentMixerLine *pLine = m_pComponentMixerLine[ pDrumkitComponent->get_id() ];
 
-		float fNewPeak_L = pDrumkitComponent->get_peak_l();
-		pDrumkitComponent->set_peak_l( 0.0f );	// reset instrument peak
-
-		float fNewPeak_R = pDrumkitComponent->get_peak_r();
-		pDrumkitComponent->set_peak_r( 0.0f );	// reset instrument peak
+		float fNewPeak_L = 0.0f;
+		float fNewPeak_R = 0.0f;
+		if ( nCompoIndex < m_peaks.nComponents ) {
+			fNewPeak_L = m_peaks.component_L[ nCompoIndex ];
+			fNewPeak_R = m_peaks.component_R[ nCompoIndex ];
+		}
+		++nCompoIndex;
 
 		float fNewVolume = pDrumkitComponent->get_volume();
 		bool bMuted = pDrumkitComponent->is_muted();
 
 		QString sName = pDrumkitComponent->get_name();
 
-		float fOldPeak_L = pLine->getPeak_L();
-		float fOldPeak_R = pLine->getPeak_R();
-
-		if (!bShowPeaks) {
-			fNewPeak_L = 0.0f;
-			fNewPeak_R = 0.0f;
-		}
-
-		if ( fNewPeak_L >= fOldPeak_L) {	// LEFT peak
-			pLine->setPeak_L( fNewPeak_L );
-		}
-		else {
-			pLine->setPeak_L( fOldPeak_L / fallOff );
-		}
-		if ( fNewPeak_R >= fOldPeak_R) {	// Right peak
-			pLine->setPeak_R( fNewPeak_R );
-		}
-		else {
-			pLine->setPeak_R( fOldPeak_R / fallOff );
-		}
+		pLine->setPeak_L( meterPeak( fNewPeak_L, pLine->getPeak_L(), fallOff ) );
+		pLine->setPeak_R( meterPeak( fNewPeak_R, pLine->getPeak_R(), fallOff ) );
 
 		// fader position
 		pLine->setVolume( fNewVolume );
@@ -582,30 +616,8 @@ void Mixer::updateMixer()
 
 
 	// update MasterPeak
-	float fOldPeak_L = m_pMasterLine->getPeak_L();
-	float fNewPeak_L = pEngine->getMasterPeak_L();
-	pEngine->setMasterPeak_L(0.0);
-	float fOldPeak_R = m_pMasterLine->getPeak_R();
-	float fNewPeak_R = pEngine->getMasterPeak_R();
-	pEngine->setMasterPeak_R(0.0);
-
-	if (!bShowPeaks) {
-		fNewPeak_L = 0.0;
-		fNewPeak_R = 0.0;
-	}
-
-	if (fNewPeak_L >= fOldPeak_L) {
-		m_pMasterLine->setPeak_L( fNewPeak_L );
-	}
-	else {
-		m_pMasterLine->setPeak_L( fOldPeak_L / fallOff );
-	}
-	if (fNewPeak_R >= fOldPeak_R) {
-		m_pMasterLine->setPeak_R(fNewPeak_R);
-	}
-	else {
-		m_pMasterLine->setPeak_R( fOldPeak_R / fallOff );
-	}
+	m_pMasterLine->setPeak_L( meterPeak( m_peaks.master_L, m_pMasterLine->getPeak_L(), fallOff ) );
+	m_pMasterLine->setPeak_R( meterPeak( m_peaks.master_R, m_pMasterLine->getPeak_R(), fallOff ) );
 
 
 	// set master fader position
@@ -623,23 +635,24 @@ void Mixer::updateMixer()
 		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
 		if ( pFX ) {
 			m_pLadspaFXLine[nFX]->setName( pFX->getPluginName() );
-			float fNewPeak_L = 0.0;
-			float fNewPeak_R = 0.0;
 
 			float fOldPeak_L = 0.0;
 			float fOldPeak_R = 0.0;
 			m_pLadspaFXLine[nFX]->getPeaks( &fOldPeak_L, &fOldPeak_R );
-
-			if (fNewPeak_L < fOldPeak_L)	fNewPeak_L = fOldPeak_L / fallOff;
-			if (fNewPeak_R < fOldPeak_R)	fNewPeak_R = fOldPeak_R / fallOff;
-			m_pLadspaFXLine[nFX]->setPeaks( fNewPeak_L, fNewPeak_R );
+			m_pLadspaFXLine[nFX]->setPeaks( meterPeak( m_peaks.fx_L[ nFX ], fOldPeak_L, fallOff ),
+											meterPeak( m_peaks.fx_R[ nFX ], fOldPeak_R, fallOff ) );
 			m_pLadspaFXLine[nFX]->setFxActive( pFX->isEnabled() );
 			m_pLadspaFXLine[nFX]->setVolume( pFX->getVolume() );
+			m_pLadspaFXLine[nFX]->setToolTip(
+				tr( "%1\nProcessing time: %2 ms per buffer" )
+				.arg( pFX->getPluginName() )
+				.arg( Hydrogen::get_instance()->getLadspaFXProcessTime( nFX ), 0, 'f', 3 ) );
 		}
 		else {
 			m_pLadspaFXLine[nFX]->setName( "No plugin" );
 			m_pLadspaFXLine[nFX]->setFxActive( false );
 			m_pLadspaFXLine[nFX]->setVolume( 0.0 );
+			m_pLadspaFXLine[nFX]->setToolTip( "" );
 		}
 	}
 	// ~LADSPA
@@ -653,6 +666,7 @@ void Mixer::showEvent ( QShowEvent *ev )
 {
 	UNUSED( ev );
 	updateMixer();
+	m_pUpdateTimer->start();
 }
 
 
@@ -661,6 +675,10 @@ void Mixer::showEvent ( QShowEvent *ev )
 void Mixer::hideEvent ( QHideEvent *ev )
 {
 	UNUSED( ev );
+	// Nobody would see the meters anyway. The audio engine keeps
+	// on accumulating peaks until the next snapshot is taken.
+	m_pUpdateTimer->stop();
+	m_renderStatsTimer.invalidate();
 }
 
 
@@ -712,7 +730,8 @@ void Mixer::knobChanged(MixerLine* ref, int nKnob) {
 
 void Mixer::noteOnEvent( int nInstrument )
 {
-	if ( m_pMixerLine[ nInstrument ] ) {
+	if ( nInstrument >= 0 && nInstrument < m_pMixerLine.size() &&
+		 m_pMixerLine[ nInstrument ] ) {
 		m_pMixerLine[ nInstrument ]->setActivity( 100 );
 	}
 }
@@ -821,7 +840,7 @@ void Mixer::ladspaVolumeChanged( LadspaFXMixerLine* ref)
 
 void Mixer::getPeaksInMixerLine( uint nMixerLine, float& fPeak_L, float& fPeak_R )
 {
-	if ( nMixerLine < MAX_INSTRUMENTS ) {
+	if ( nMixerLine < m_pMixerLine.size() && m_pMixerLine[ nMixerLine ] != nullptr ) {
 		fPeak_L = m_pMixerLine[ nMixerLine ]->getPeak_L();
 		fPeak_R = m_pMixerLine[ nMixerLine ]->getPeak_R();
 	}
@@ -26,9 +26,12 @@
 
 #include <QtGui>
 #include <QtWidgets>
+#include <vector>
 
 #include <core/Object.h>
 #include <core/Globals.h>
+#include <core/PeakMeters.h>
+#include <core/Basics/Instrument.h>
 #include "../EventListener.h"
 
 class Button;
@@ -90,12 +93,23 @@ class Mixer : public QWidget, public EventListener, public H2Core::Object
 		MasterMixerLine *		m_pMasterLine;
 
 		QWidget *				m_pFaderPanel;
-		MixerLine *				m_pMixerLine[MAX_INSTRUMENTS];
+		/** One strip per instrument of the current song. Created
+			and destroyed in updateMixer().*/
+		std::vector<MixerLine*>	m_pMixerLine;
 		std::map<int, ComponentMixerLine*> m_pComponentMixerLine;
 
 		PixmapWidget *			m_pFXFrame;
 
+		/** Only running while the Mixer is visible.*/
 		QTimer *				m_pUpdateTimer;
+		/** Latest peaks handed over by the audio engine.*/
+		H2Core::PeakMeters::Snapshot	m_peaks;
+		/** Render statistics of the instruments at the last restart
+			of #m_renderStatsTimer. Shown as tool tips of the
+			mixer strips.*/
+		std::vector<H2Core::Instrument::RenderStats>	m_renderStats;
+		/** Invalid while the Mixer is hidden.*/
+		QElapsedTimer			m_renderStatsTimer;
 
 		uint					findMixerLineByRef(MixerLine* ref);
 		uint					findCompoMixerLineByRef(ComponentMixerLine* ref);
@@ -21,6 +21,7 @@
  */
 
 #include "DrumPatternEditor.h"
+#include "NoteDiff.h"
 #include "PatternEditorPanel.h"
 #include "NotePropertiesRuler.h"
 
@@ -49,6 +50,7 @@
 #include <cassert>
 #include <algorithm>
 #include <stack>
+#include <unordered_map>
 
 using namespace H2Core;
 
@@ -56,6 +58,9 @@ const char* DrumPatternEditor::__class_name = "DrumPatternEditor";
 
 DrumPatternEditor::DrumPatternEditor(QWidget* parent, PatternEditorPanel *panel)
  : PatternEditor( parent, __class_name, panel )
+ , m_layerGeometry()
+ , m_nLayerSelectedInstrument( -1 )
+ , m_bLayerMoving( false )
 {
 	m_nGridHeight = Preferences::get_instance()->getPatternEditorGridHeight();
 	m_nEditorHeight = m_nGridHeight * MAX_INSTRUMENTS;
@@ -316,6 +321,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 					  && pNote->get_probability() == fProbability ) ) {
 				delete pNote;
 				notes->erase( it );
+				pPattern->notes_changed();
 				bFound = true;
 				break;
 			}
@@ -807,12 +813,30 @@ std::vector<DrumPatternEditor::SelectionIndex> DrumPatternEditor::elementsInters
 	int x_min = (r.left() - m_nMargin - 1) / m_fGridWidth;
 	int x_max = (r.right() - m_nMargin) / m_fGridWidth;
 
+	// Rows (instruments) this rect can intersect with. Looking up the
+	// row of each note in this small table is much cheaper than
+	// searching the whole instrument list for every note in range.
+	int nFirstRow = std::max( 0, r.top() / (int)m_nGridHeight - 1 );
+	int nLastRow = std::min( pInstrList->size() - 1, r.bottom() / (int)m_nGridHeight + 1 );
+	std::unordered_map< const Instrument*, int > rows;
+	for ( int nRow = nFirstRow; nRow <= nLastRow; ++nRow ) {
+		rows[ pInstrList->get( nRow ) ] = nRow;
+	}
+
 	const Pattern::notes_t* notes = m_pPattern->get_notes();
 	std::vector<SelectionIndex> result;
 
+	if ( rows.empty() ) {
+		return std::move( result );
+	}
+
 	for (auto it = notes->lower_bound( x_min ); it != notes->end() && it->first <= x_max; ++it ) {
 		Note *note = it->second;
-		int nInstrument = pInstrList->index( note->get_instrument() );
+		auto row = rows.find( note->get_instrument() );
+		if ( row == rows.end() ) {
+			continue;
+		}
+		int nInstrument = row->second;
 		uint x_pos = m_nMargin + (it->first * m_fGridWidth);
 		uint y_pos = ( nInstrument * m_nGridHeight) + (m_nGridHeight / 2) - 3;
 
@@ -1003,45 +1027,88 @@ void DrumPatternEditor::paste()
 
 
 ///
-/// Draws a pattern
+/// Draws the notes of the selected rows
 ///
-void DrumPatternEditor::__draw_pattern(QPainter& painter)
+void DrumPatternEditor::__draw_notes( QPainter& painter, const std::vector<char>& rows )
 {
-	const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
-	const QColor selectedRowColor( pStyle->m_patternEditor_selectedRowColor.getRed(), pStyle->m_patternEditor_selectedRowColor.getGreen(), pStyle->m_patternEditor_selectedRowColor.getBlue() );
+	if ( m_pPattern == nullptr ) {
+		return;
+	}
 
-	__create_background( painter );
+	InstrumentList * pInstrList = Hydrogen::get_instance()->getSong()->getInstrumentList();
 
-	if (m_pPattern == nullptr) {
+	const Pattern::notes_t *pNotes = m_pPattern->get_notes();
+	if ( pNotes->size() == 0 ) {
 		return;
 	}
 
-	int nNotes = m_pPattern->get_length();
-	int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
-	Song *pSong = Hydrogen::get_instance()->getSong();
+	std::vector< int > noteCount; // instrument_id -> count
+	std::stack< Instrument *> instruments;
 
-	InstrumentList * pInstrList = pSong->getInstrumentList();
+	// Process notes in batches by note position, counting the notes at each instrument so we can display
+	// markers for instruments which have more than one note in the same position (a chord or genuine
+	// duplicates)
+	for ( auto posIt = pNotes->begin(); posIt != pNotes->end(); ) {
+		int nPosition = posIt->second->get_position();
 
+		// Process all notes at this position
+		auto noteIt = posIt;
+		while ( noteIt != pNotes->end() && noteIt->second->get_position() == nPosition ) {
+			Note *pNote = noteIt->second;
+			++noteIt;
 
-	if ( m_nEditorHeight != (int)( m_nGridHeight * pInstrList->size() ) ) {
-		// the number of instruments is changed...recreate all
-		m_nEditorHeight = m_nGridHeight * pInstrList->size();
-		resize( width(), m_nEditorHeight );
-	}
+			int nInstrument = pInstrList->index( pNote->get_instrument() );
+			if ( nInstrument >= 0 && nInstrument < (int)rows.size() && ! rows[ nInstrument ] ) {
+				continue;
+			}
+
+			int nInstrumentID = pNote->get_instrument_id();
+			if ( nInstrumentID >= noteCount.size() ) {
+				noteCount.resize( nInstrumentID+1, 0 );
+			}
+
+			if ( ++noteCount[ nInstrumentID ] == 1) {
+				instruments.push( pNote->get_instrument() );
+			}
 
-	for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-		uint y = m_nGridHeight * nInstr;
-		if ( nInstr == (uint)nSelectedInstrument ) {	// selected instrument
-			painter.fillRect( 0, y + 1, ( m_nMargin + nNotes * m_fGridWidth ), m_nGridHeight - 1, selectedRowColor );
+			__draw_note( pNote, painter );
 		}
-	}
 
+		// Go through used instruments list, drawing markers for superimposed notes and zero'ing the
+		// counts.
+		while ( ! instruments.empty() ) {
+			Instrument *pInstrument = instruments.top();
+			int nInstrumentID = pInstrument->get_id();
+			if ( noteCount[ nInstrumentID ] >  1 ) {
+				// Draw "2x" text to the left of the note
+				int nInstrument = pInstrList->index( pInstrument );
+				int x = m_nMargin + (nPosition * m_fGridWidth);
+				int y = ( nInstrument * m_nGridHeight);
+				const int boxWidth = 128;
+				QFont font;
+				font.setPointSize( 9 );
+				painter.setFont( font );
+				painter.setPen( QColor( 0, 0, 0 ) );
+
+				painter.drawText( QRect( x-boxWidth-6, y, boxWidth, m_nGridHeight),
+								  Qt::AlignRight | Qt::AlignVCenter,
+								  ( QString( "%1" ) + QChar( 0x00d7 )).arg( noteCount[ nInstrumentID ] ) );
+			}
+			noteCount[ nInstrumentID ] = 0;
+			instruments.pop();
+		}
+
+		posIt = noteIt;
+	}
+}
 
-	// draw the grid
-	__draw_grid( painter );
 
 
-	// Draw cursor
+///
+/// Draws the keyboard cursor
+///
+void DrumPatternEditor::__draw_cursor( QPainter& painter )
+{
 	if ( hasFocus() && !HydrogenApp::get_instance()->hideKeyboardCursor() ) {
 		uint x = m_nMargin + m_pPatternEditorPanel->getCursorPosition() * m_fGridWidth;
 		int nSelectedInstrument = Hydrogen::get_instance()->getSelectedInstrumentNumber();
@@ -1052,79 +1119,6 @@ void DrumPatternEditor::__draw_pattern(QPainter& painter)
 		painter.setRenderHint( QPainter::Antialiasing );
 		painter.drawRoundedRect( QRect( x-m_fGridWidth*3, y+2, m_fGridWidth*6, m_nGridHeight-3 ), 4, 4 );
 	}
-
-
-	/*
-		BUGFIX
-
-		if m_pPattern is not renewed every time we draw a note,
-		hydrogen will crash after you save a song and create a new one.
-		-smoors
-	*/
-	updatePatternInfo();
-
-	if( m_pPattern ) {
-		const Pattern::notes_t *pNotes = m_pPattern->get_notes();
-		if ( pNotes->size() == 0 ) {
-			return;
-		}
-
-		validateSelection();
-
-		std::vector< int > noteCount; // instrument_id -> count
-		std::stack< Instrument *> instruments;
-
-		// Process notes in batches by note position, counting the notes at each instrument so we can display
-		// markers for instruments which have more than one note in the same position (a chord or genuine
-		// duplicates)
-		for ( auto posIt = pNotes->begin(); posIt != pNotes->end(); ) {
-			int nPosition = posIt->second->get_position();
-
-			// Process all notes at this position
-			auto noteIt = posIt;
-			while ( noteIt != pNotes->end() && noteIt->second->get_position() == nPosition ) {
-				Note *pNote = noteIt->second;
-
-				int nInstrumentID = pNote->get_instrument_id();
-				if ( nInstrumentID >= noteCount.size() ) {
-					noteCount.resize( nInstrumentID+1, 0 );
-				}
-
-				if ( ++noteCount[ nInstrumentID ] == 1) {
-					instruments.push( pNote->get_instrument() );
-				}
-
-				__draw_note( pNote, painter );
-				++noteIt;
-			}
-
-			// Go through used instruments list, drawing markers for superimposed notes and zero'ing the
-			// counts.
-			while ( ! instruments.empty() ) {
-				Instrument *pInstrument = instruments.top();
-				int nInstrumentID = pInstrument->get_id();
-				if ( noteCount[ nInstrumentID ] >  1 ) {
-					// Draw "2x" text to the left of the note
-					int nInstrument = pInstrList->index( pInstrument );
-					int x = m_nMargin + (nPosition * m_fGridWidth);
-					int y = ( nInstrument * m_nGridHeight);
-					const int boxWidth = 128;
-					QFont font;
-					font.setPointSize( 9 );
-					painter.setFont( font );
-					painter.setPen( QColor( 0, 0, 0 ) );
-
-					painter.drawText( QRect( x-boxWidth-6, y, boxWidth, m_nGridHeight),
-									  Qt::AlignRight | Qt::AlignVCenter,
-									  ( QString( "%1" ) + QChar( 0x00d7 )).arg( noteCount[ nInstrumentID ] ) );
-				}
-				noteCount[ nInstrumentID ] = 0;
-				instruments.pop();
-			}
-
-			posIt = noteIt;
-		}
-	}
 }
 
 
@@ -1221,13 +1215,178 @@ void DrumPatternEditor::__create_background( QPainter& p)
 
 
 
-void DrumPatternEditor::paintEvent( QPaintEvent* /*ev*/ )
+bool DrumPatternEditor::LayerGeometry::operator==( const LayerGeometry& other ) const
+{
+	return nNotes == other.nNotes && nInstruments == other.nInstruments &&
+		nResolution == other.nResolution && bUseTriplets == other.bUseTriplets &&
+		fGridWidth == other.fGridWidth && nGridHeight == other.nGridHeight &&
+		nWidth == other.nWidth && fPixelRatio == other.fPixelRatio;
+}
+
+
+
+QRect DrumPatternEditor::rowRect( int nRow ) const
+{
+	return QRect( 0, nRow * m_nGridHeight, width(), m_nGridHeight + 1 );
+}
+
+
+
+void DrumPatternEditor::updateLayers( const QRect& rect )
+{
+	const UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
+	const QColor selectedRowColor( pStyle->m_patternEditor_selectedRowColor.getRed(), pStyle->m_patternEditor_selectedRowColor.getGreen(), pStyle->m_patternEditor_selectedRowColor.getBlue() );
+
+	/*
+		BUGFIX
+
+		if m_pPattern is not renewed every time we draw a note,
+		hydrogen will crash after you save a song and create a new one.
+		-smoors
+	*/
+	updatePatternInfo();
+	validateSelection();
+
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	InstrumentList* pInstrList = pHydrogen->getSong()->getInstrumentList();
+	int nInstruments = pInstrList->size();
+	int nSelectedInstrument = pHydrogen->getSelectedInstrumentNumber();
+
+	if ( m_nEditorHeight != (int)( m_nGridHeight * nInstruments ) ) {
+		// the number of instruments is changed...recreate all
+		m_nEditorHeight = m_nGridHeight * nInstruments;
+		resize( width(), m_nEditorHeight );
+	}
+
+	LayerGeometry geometry;
+	geometry.nNotes = m_pPattern != nullptr ? m_pPattern->get_length() : MAX_NOTES;
+	geometry.nInstruments = nInstruments;
+	geometry.nResolution = m_nResolution;
+	geometry.bUseTriplets = m_bUseTriplets;
+	geometry.fGridWidth = m_fGridWidth;
+	geometry.nGridHeight = m_nGridHeight;
+	geometry.nWidth = width();
+	geometry.fPixelRatio = devicePixelRatioF();
+
+	bool bFull = false;
+	if ( ! ( geometry == m_layerGeometry ) || ! m_layerRect.contains( rect ) ) {
+		QRect visible = visibleRegion().boundingRect().united( rect );
+		m_layerRect = visible.adjusted( -visible.width() / 2, -visible.height() / 2,
+										visible.width() / 2, visible.height() / 2 )
+			.intersected( this->rect() );
+		if ( m_layerRect.isEmpty() ) {
+			m_backgroundPixmap = QPixmap();
+			m_notesPixmap = QPixmap();
+			m_layerGeometry = LayerGeometry();
+			return;
+		}
+
+		m_backgroundPixmap = QPixmap( m_layerRect.size() * geometry.fPixelRatio );
+		m_backgroundPixmap.setDevicePixelRatio( geometry.fPixelRatio );
+		m_notesPixmap = QPixmap( m_layerRect.size() * geometry.fPixelRatio );
+		m_notesPixmap.setDevicePixelRatio( geometry.fPixelRatio );
+		m_layerGeometry = geometry;
+		bFull = true;
+	}
+
+	// Rows whose notes look different than the last time.
+	std::vector<quint64> rowHashes( nInstruments, 0 );
+	if ( m_pPattern != nullptr ) {
+		for ( const auto& it : *m_pPattern->get_notes() ) {
+			Note* pNote = it.second;
+			int nRow = pInstrList->index( pNote->get_instrument() );
+			if ( nRow < 0 || nRow >= nInstruments ) {
+				continue;
+			}
+			quint64 nHash = rowHashes[ nRow ];
+			nHash = nHash * 1000003 + pNote->get_position();
+			nHash = nHash * 1000003 + pNote->get_length();
+			nHash = nHash * 1000003 + qHash( pNote->get_velocity() );
+			nHash = nHash * 1000003 + pNote->get_key() * 16 + pNote->get_octave() + 8;
+			nHash = nHash * 1000003 + ( pNote->get_note_off() ? 1 : 0 ) +
+				( m_selection.isSelected( pNote ) ? 2 : 0 );
+			rowHashes[ nRow ] = nHash;
+		}
+	}
+
+	// Notes being moved are drawn a second time at their new
+	// position, which may be within any row.
+	bool bMoving = m_selection.isMoving();
+	bool bAllNotes = bFull || bMoving || m_bLayerMoving ||
+		m_rowHashes.size() != rowHashes.size();
+	m_bLayerMoving = bMoving;
+
+	QRegion backgroundRegion;
+	QRegion notesRegion;
+	std::vector<char> rows( nInstruments, bAllNotes ? 1 : 0 );
+	if ( bFull ) {
+		backgroundRegion = m_layerRect;
+	} else if ( nSelectedInstrument != m_nLayerSelectedInstrument ) {
+		for ( int nRow : { m_nLayerSelectedInstrument, nSelectedInstrument } ) {
+			if ( nRow >= 0 && nRow < nInstruments ) {
+				backgroundRegion += rowRect( nRow );
+				rows[ nRow ] = 1;
+			}
+		}
+	}
+	m_nLayerSelectedInstrument = nSelectedInstrument;
+
+	if ( bAllNotes ) {
+		notesRegion = m_layerRect;
+	} else {
+		for ( int nRow = 0; nRow < nInstruments; ++nRow ) {
+			if ( rowHashes[ nRow ] != m_rowHashes[ nRow ] ) {
+				rows[ nRow ] = 1;
+			}
+			if ( rows[ nRow ] ) {
+				notesRegion += rowRect( nRow );
+			}
+		}
+	}
+	m_rowHashes = rowHashes;
+
+	notesRegion &= m_layerRect;
+	backgroundRegion &= m_layerRect;
+	if ( notesRegion.isEmpty() ) {
+		return;
+	}
+
+	if ( ! backgroundRegion.isEmpty() ) {
+		QPainter painter( &m_backgroundPixmap );
+		painter.translate( -m_layerRect.topLeft() );
+		painter.setClipRegion( backgroundRegion );
+
+		__create_background( painter );
+		if ( nSelectedInstrument >= 0 && nSelectedInstrument < nInstruments ) {
+			painter.fillRect( 0, m_nGridHeight * nSelectedInstrument + 1,
+							  ( m_nMargin + geometry.nNotes * m_fGridWidth ),
+							  m_nGridHeight - 1, selectedRowColor );
+		}
+		__draw_grid( painter );
+	}
+
+	QPainter painter( &m_notesPixmap );
+	painter.translate( -m_layerRect.topLeft() );
+	painter.setClipRegion( notesRegion );
+	painter.drawPixmap( m_layerRect.topLeft(), m_backgroundPixmap );
+	__draw_notes( painter, rows );
+}
+
+
+
+void DrumPatternEditor::paintEvent( QPaintEvent* ev )
 {
 	//INFOLOG( "paint" );
 	//QWidget::paintEvent(ev);
 
+	updateLayers( ev->rect() );
+
 	QPainter painter( this );
-	__draw_pattern( painter );
+	if ( ! m_notesPixmap.isNull() ) {
+		painter.drawPixmap( m_layerRect.topLeft(), m_notesPixmap );
+	}
+
+	__draw_cursor( painter );
 	m_selection.paintSelection( &painter );
 }
 
@@ -1348,242 +1507,23 @@ void DrumPatternEditor::undoRedoAction( int column,
 ///==========================================================
 ///undo / redo actions from pattern editor instrument list
 
-void DrumPatternEditor::functionClearNotesRedoAction( int nSelectedInstrument, int patternNumber )
-{
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *pPatternList = Hydrogen::get_instance()->getSong()->getPatternList();
-	Pattern *pPattern = pPatternList->get( patternNumber );
-
-	Instrument *pSelectedInstrument = H->getSong()->getInstrumentList()->get( nSelectedInstrument );
-
-	pPattern->purge_instrument( pSelectedInstrument );
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-}
-
-
-
-void DrumPatternEditor::functionClearNotesUndoAction( std::list< H2Core::Note* > noteList, int nSelectedInstrument, int patternNumber )
-{
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *pPatternList = H->getSong()->getPatternList();
-	Pattern *pPattern = pPatternList->get( patternNumber );
-
-	std::list < H2Core::Note *>::const_iterator pos;
-	for ( pos = noteList.begin(); pos != noteList.end(); ++pos){
-		Note *pNote;
-		pNote = new Note(*pos);
-		assert( pNote );
-		pPattern->insert_note( pNote );
-	}
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-
-	m_pPatternEditorPanel->updateEditors();
-}
-
-void DrumPatternEditor::functionPasteNotesUndoAction(std::list<H2Core::Pattern*> & appliedList)
-{
-	// Get song's pattern list
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *patternList = H->getSong()->getPatternList();
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
-
-	while (appliedList.size() > 0)
-	{
-		// Get next applied pattern
-		Pattern *pApplied = appliedList.front();
-		assert(pApplied);
-
-		// Find destination pattern to perform undo
-		Pattern *pat = patternList->find(pApplied->get_name());
-
-		if (pat != nullptr)
-		{
-			// Remove all notes of applied pattern from destination pattern
-			const Pattern::notes_t* notes = pApplied->get_notes();
-			FOREACH_NOTE_CST_IT_BEGIN_END(notes, it)
-			{
-				// Get note to remove
-				Note *pNote = it->second;
-				assert(pNote);
-
-				// Check if note is not present
-				Pattern::notes_t* notes = (Pattern::notes_t *)pat->get_notes();
-				FOREACH_NOTE_IT_BOUND(notes, it, pNote->get_position())
-				{
-					Note *pFoundNote = it->second;
-					if (pFoundNote->get_instrument() == pNote->get_instrument())
-					{
-						notes->erase(it);
-						delete pFoundNote;
-						break;
-					}
-				}
-			}
-		}
-
-		// Remove applied pattern;
-		delete pApplied;
-		appliedList.pop_front();
-	}
-
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
-
-	// Update editors
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-	m_pPatternEditorPanel->updateEditors();
-}
-
-void DrumPatternEditor::functionPasteNotesRedoAction(std::list<H2Core::Pattern*> & changeList, std::list<H2Core::Pattern*> & appliedList)
-{
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *patternList = H->getSong()->getPatternList();
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
-
-	// Add notes to pattern
-	std::list < H2Core::Pattern *>::iterator pos;
-	for ( pos = changeList.begin(); pos != changeList.end(); ++pos)
-	{
-		Pattern *pPattern = *pos;
-		assert(pPattern);
-
-		Pattern *pat = patternList->find(pPattern->get_name()); // Destination pattern
-
-		if (pat != nullptr)
-		{
-			// Create applied pattern
-			Pattern *pApplied = new Pattern(
-					pat->get_name(),
-					pat->get_info(),
-					pat->get_category(),
-					pat->get_length());
-
-			// Add all notes of source pattern to destination pattern
-			// and store all applied notes in applied pattern
-			const Pattern::notes_t* notes = pPattern->get_notes();
-			FOREACH_NOTE_CST_IT_BEGIN_END(notes, it)
-			{
-				Note *pNote = it->second;
-				assert(pNote);
-
-				// Check if note is not present
-				bool noteExists = false;
-				const Pattern::notes_t* notes = pat->get_notes();
-				FOREACH_NOTE_CST_IT_BOUND(notes, it, pNote->get_position())
-				{
-					Note *pFoundNote = it->second;
-					if (pFoundNote->get_instrument() == pNote->get_instrument())
-					{
-						// note already exists
-						noteExists = true;
-						break;
-					}
-				}
-
-				// Apply note and store it as applied
-				if (!noteExists)
-				{
-					pat->insert_note(new Note(pNote));
-					pApplied->insert_note(new Note(pNote));
-				}
-			}
-
-			// Add applied pattern to applied list
-			appliedList.push_back(pApplied);
-		}
-	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
-
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-	// Update editors
-	m_pPatternEditorPanel->updateEditors();
-}
-
-
-
-void DrumPatternEditor::functionFillNotesUndoAction( QStringList noteList, int nSelectedInstrument, int patternNumber )
+void DrumPatternEditor::functionNoteDiffAction( const NoteDiff& diff, int nPatternNumber, bool bRevert )
 {
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *pPatternList = Hydrogen::get_instance()->getSong()->getPatternList();
-	Pattern *pPattern = pPatternList->get( patternNumber );
-	Instrument *pSelectedInstrument = H->getSong()->getInstrumentList()->get( nSelectedInstrument );
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
-
-	for (int i = 0; i < noteList.size(); i++ ) {
-		int nColumn  = noteList.value(i).toInt();
-		Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
-		FOREACH_NOTE_IT_BOUND(notes,it,nColumn) {
-			Note *pNote = it->second;
-			assert( pNote );
-			if ( pNote->get_instrument() == pSelectedInstrument ) {
-				// the note exists...remove it!
-				notes->erase( it );
-				delete pNote;
-				break;
-			}
-		}
-	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
-
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-	m_pPatternEditorPanel->updateEditors();
-}
-
-
-void DrumPatternEditor::functionFillNotesRedoAction( QStringList noteList, int nSelectedInstrument, int patternNumber )
-{
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *pPatternList = Hydrogen::get_instance()->getSong()->getPatternList();
-	Pattern *pPattern = pPatternList->get( patternNumber );
-	Instrument *pSelectedInstrument = H->getSong()->getInstrumentList()->get( nSelectedInstrument );
-
-	const float velocity = 0.8f;
-	const float pan_L = 0.5f;
-	const float pan_R = 0.5f;
-	const float fPitch = 0.0f;
-	const int nLength = -1;
-
-	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
-	for (int i = 0; i < noteList.size(); i++ ) {
-
-		// create the new note
-		int position = noteList.value(i).toInt();
-		Note *pNote = new Note( pSelectedInstrument, position, velocity, pan_L, pan_R, nLength, fPitch );
-		pPattern->insert_note( pNote );
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	PatternList *pPatternList = pSong->getPatternList();
+	if ( nPatternNumber < 0 || nPatternNumber >= pPatternList->size() ) {
+		ERRORLOG( QString( "Invalid pattern number [%1]" ).arg( nPatternNumber ) );
+		return;
 	}
-	AudioEngine::get_instance()->unlock();	// unlock the audio engine
-
-	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
-	m_pPatternEditorPanel->updateEditors();
-}
-
-
-void DrumPatternEditor::functionRandomVelocityAction( QStringList noteVeloValue, int nSelectedInstrument, int selectedPatternNumber )
-{
-	Hydrogen * H = Hydrogen::get_instance();
-	PatternList *pPatternList = Hydrogen::get_instance()->getSong()->getPatternList();
-	Pattern *pPattern = pPatternList->get( selectedPatternNumber );
-	Instrument *pSelectedInstrument = H->getSong()->getInstrumentList()->get( nSelectedInstrument );
-
+	Pattern *pPattern = pPatternList->get( nPatternNumber );
 
 	AudioEngine::get_instance()->lock( RIGHT_HERE );	// lock the audio engine
-
-	int nResolution = granularity();
-	int positionCount = 0;
-	for (int i = 0; i < pPattern->get_length(); i += nResolution) {
-		const Pattern::notes_t* notes = pPattern->get_notes();
-		FOREACH_NOTE_CST_IT_BOUND(notes,it,i) {
-			Note *pNote = it->second;
-			if ( pNote->get_instrument() ==  pSelectedInstrument) {
-				float velocity = noteVeloValue.value( positionCount ).toFloat();
-				pNote->set_velocity(velocity);
-				positionCount++;
-			}
-		}
+	if ( bRevert ) {
+		diff.revert( pPattern, pSong->getInstrumentList() );
+	} else {
+		diff.apply( pPattern, pSong->getInstrumentList() );
 	}
-	H->getSong()->setIsModified( true );
+	pSong->setIsModified( true );
 	AudioEngine::get_instance()->unlock();	// unlock the audio engine
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1606,9 +1546,7 @@ void DrumPatternEditor::functionMoveInstrumentAction( int nSourceInstrument,  in
 
 		pInstrumentList->move( nSourceInstrument, nTargetInstrument );
 
-		#ifdef H2CORE_HAVE_JACK
 		engine->renameJackPorts( pSong );
-		#endif
 
 		AudioEngine::get_instance()->unlock();
 		engine->setSelectedInstrumentNumber( nTargetInstrument );
@@ -1637,10 +1575,8 @@ void  DrumPatternEditor::functionDropInstrumentUndoAction( int nTargetInstrument
 	}
 
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
-#ifdef H2CORE_HAVE_JACK
 	Song *pSong = pHydrogen->getSong();
 	pHydrogen->renameJackPorts( pSong );
-#endif
 	AudioEngine::get_instance()->unlock();
 	updateEditor();
 }
@@ -1722,9 +1658,7 @@ void  DrumPatternEditor::functionDropInstrumentRedoAction( QString sDrumkitName,
 
 		pEngine->getSong()->getInstrumentList()->add( pNewInstrument );
 
-		#ifdef H2CORE_HAVE_JACK
 		pEngine->renameJackPorts( pEngine->getSong() );
-		#endif
 
 		pEngine->getSong()->setIsModified( true );
 		AudioEngine::get_instance()->unlock();
@@ -1811,9 +1745,7 @@ void DrumPatternEditor::functionDeleteInstrumentUndoAction( std::list< H2Core::N
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	pHydrogen->getSong()->getInstrumentList()->add( pNewInstrument );
 
-	#ifdef H2CORE_HAVE_JACK
 	pHydrogen->renameJackPorts( pHydrogen->getSong() );
-	#endif
 
 	pHydrogen->getSong()->setIsModified( true );
 	AudioEngine::get_instance()->unlock();	// unlock the audio engine
@@ -1853,9 +1785,7 @@ void DrumPatternEditor::functionAddEmptyInstrumentUndo()
 	pEngine->removeInstrument( pEngine->getSong()->getInstrumentList()->size() -1 , false );
 
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
-#ifdef H2CORE_HAVE_JACK
 	pEngine->renameJackPorts( pEngine->getSong() );
-#endif
 	pEngine->getSong()->setIsModified( true );
 	AudioEngine::get_instance()->unlock();
 	updateEditor();
@@ -1881,9 +1811,7 @@ void DrumPatternEditor::functionAddEmptyInstrumentRedo()
 	Instrument *pNewInstr = new Instrument( nID, "New instrument");
 	pList->add( pNewInstr );
 
-	#ifdef H2CORE_HAVE_JACK
 	Hydrogen::get_instance()->renameJackPorts( pSong );
-	#endif
 
 	pSong->setIsModified( true );
 	AudioEngine::get_instance()->unlock();
@@ -34,7 +34,10 @@
 #include <QtGui>
 #include <QtWidgets>
 
+#include <vector>
+
 class PatternEditorInstrumentList;
+class NoteDiff;
 
 ///
 /// Drum pattern editor
@@ -90,11 +93,12 @@ class DrumPatternEditor : public PatternEditor
 								float probability,
 								int noteKeyVal,
 								int octaveKeyVal );
-		void functionClearNotesRedoAction( int nSelectedInstrument, int selectedPatternNumber );
-		void functionClearNotesUndoAction( std::list< H2Core::Note* > noteList, int nSelectedInstrument, int patternNumber );
-		void functionFillNotesUndoAction( QStringList noteList, int nSelectedInstrument, int patternNumber );
-		void functionFillNotesRedoAction( QStringList noteList, int nSelectedInstrument, int patternNumber );
-		void functionRandomVelocityAction( QStringList noteVeloValue, int nSelectedInstrument, int selectedPatternNumber );
+		/**
+		 * Applies @a diff to the pattern number @a nPatternNumber or,
+		 * if @a bRevert is true, undoes it. Used by the undo actions
+		 * of bulk note edits.
+		 */
+		void functionNoteDiffAction( const NoteDiff& diff, int nPatternNumber, bool bRevert );
 		void functionMoveInstrumentAction( int nSourceInstrument,  int nTargetInstrument );
 		void functionDropInstrumentUndoAction( int nTargetInstrument, std::vector<int>* AddedComponents );
 		/**
@@ -105,8 +109,6 @@ class DrumPatternEditor : public PatternEditor
 		void functionDeleteInstrumentUndoAction(  std::list< H2Core::Note* > noteList, int nSelectedInstrument, QString instrumentName, QString drumkitName );
 		void functionAddEmptyInstrumentUndo();
 		void functionAddEmptyInstrumentRedo();
-		void functionPasteNotesRedoAction(std::list<H2Core::Pattern*> & changeList, std::list<H2Core::Pattern*> & appliedList);
-		void functionPasteNotesUndoAction(std::list<H2Core::Pattern*> & appliedList);
 
 		// Synthetic UI events from selection manager
 		virtual void mouseClickEvent( QMouseEvent *ev ) override;
@@ -132,10 +134,61 @@ class DrumPatternEditor : public PatternEditor
 
 	private:
 		void __draw_note( H2Core::Note* note, QPainter& painter );
-		void __draw_pattern( QPainter& painter );
+		/** Draws the notes of all instruments for which @a rows is
+			set.*/
+		void __draw_notes( QPainter& painter, const std::vector<char>& rows );
 		void __draw_grid( QPainter& painter );
+		void __draw_cursor( QPainter& painter );
 		void __create_background( QPainter& pointer );
 
+		/**
+		 * Brings #m_backgroundPixmap and #m_notesPixmap up to date
+		 * before @a rect gets painted.
+		 *
+		 * Both are redrawn completely only if the geometry of the
+		 * grid changed or @a rect is not covered by them
+		 * anymore. Otherwise only the rows of the instruments whose
+		 * notes did change - as told by #m_rowHashes - and those
+		 * whose selection state changed are drawn again.
+		 */
+		void updateLayers( const QRect& rect );
+		/** Area covered by the row of instrument @a nRow including
+			its separating lines.*/
+		QRect rowRect( int nRow ) const;
+
+		/** Properties of the grid the layers were drawn for. A change
+			of any of them requires a complete redraw.*/
+		struct LayerGeometry {
+			int nNotes;
+			int nInstruments;
+			uint nResolution;
+			bool bUseTriplets;
+			float fGridWidth;
+			unsigned nGridHeight;
+			int nWidth;
+			qreal fPixelRatio;
+			bool operator==( const LayerGeometry& other ) const;
+		};
+
+		/** Row colours, grid lines, and the highlighting of the
+			selected instrument.*/
+		QPixmap m_backgroundPixmap;
+		/** #m_backgroundPixmap with the notes drawn on top. The
+			keyboard cursor and the lasso are painted on top of it in
+			each paintEvent().*/
+		QPixmap m_notesPixmap;
+		/** Part of the editor covered by the layers. Both the pixmaps
+			only span the visible part of the editor and some space
+			around, since the editor itself can get wider than any
+			sensible pixmap when zooming in.*/
+		QRect m_layerRect;
+		LayerGeometry m_layerGeometry;
+		int m_nLayerSelectedInstrument;
+		bool m_bLayerMoving;
+		/** Hash of the appearance of the notes of each row as they
+			are drawn in #m_notesPixmap.*/
+		std::vector<quint64> m_rowHashes;
+
 		virtual void keyPressEvent (QKeyEvent *ev) override;
 		virtual void keyReleaseEvent (QKeyEvent *ev) override;
 		virtual void showEvent ( QShowEvent *ev ) override;
@@ -0,0 +1,195 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "NoteDiff.h"
+
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Pattern.h>
+
+#include <cassert>
+
+using namespace H2Core;
+
+NoteDiff::NoteRecord NoteDiff::NoteRecord::fromNote( Note* pNote )
+{
+	NoteRecord record;
+	record.nPosition = pNote->get_position();
+	record.nInstrumentId = pNote->get_instrument()->get_id();
+	record.nLength = pNote->get_length();
+	record.fVelocity = pNote->get_velocity();
+	record.fPan_L = pNote->get_pan_l();
+	record.fPan_R = pNote->get_pan_r();
+	record.fLeadLag = pNote->get_lead_lag();
+	record.fProbability = pNote->get_probability();
+	record.fPitch = pNote->get_pitch();
+	record.key = pNote->get_key();
+	record.octave = pNote->get_octave();
+	record.bNoteOff = pNote->get_note_off();
+	return record;
+}
+
+bool NoteDiff::NoteRecord::refersTo( Note* pNote ) const
+{
+	return pNote->get_position() == nPosition &&
+		pNote->get_instrument()->get_id() == nInstrumentId &&
+		pNote->get_key() == key &&
+		pNote->get_octave() == octave;
+}
+
+void NoteDiff::NoteRecord::assignTo( Note* pNote ) const
+{
+	pNote->set_length( nLength );
+	pNote->set_velocity( fVelocity );
+	pNote->set_pan_l( fPan_L );
+	pNote->set_pan_r( fPan_R );
+	pNote->set_lead_lag( fLeadLag );
+	pNote->set_probability( fProbability );
+	pNote->set_pitch( fPitch );
+	pNote->set_note_off( bNoteOff );
+}
+
+Note* NoteDiff::NoteRecord::createNote( InstrumentList* pInstrumentList ) const
+{
+	Instrument* pInstrument = pInstrumentList->find( nInstrumentId );
+	if ( pInstrument == nullptr ) {
+		return nullptr;
+	}
+
+	Note* pNote = new Note( pInstrument, nPosition, fVelocity, fPan_L, fPan_R, nLength, fPitch );
+	pNote->set_key_octave( key, octave );
+	pNote->set_lead_lag( fLeadLag );
+	pNote->set_probability( fProbability );
+	pNote->set_note_off( bNoteOff );
+	return pNote;
+}
+
+void NoteDiff::addNote( Note* pNote )
+{
+	m_added.push_back( NoteRecord::fromNote( pNote ) );
+}
+
+void NoteDiff::addNote( const NoteRecord& record )
+{
+	m_added.push_back( record );
+}
+
+void NoteDiff::removeNote( Note* pNote )
+{
+	m_removed.push_back( NoteRecord::fromNote( pNote ) );
+}
+
+void NoteDiff::modifyNote( const NoteRecord& before, const NoteRecord& after )
+{
+	m_modified.push_back( std::make_pair( before, after ) );
+}
+
+void NoteDiff::apply( Pattern* pPattern, InstrumentList* pInstrumentList ) const
+{
+	eraseNotes( pPattern, m_removed );
+	assignNotes( pPattern, m_modified, false );
+	insertNotes( pPattern, pInstrumentList, m_added );
+}
+
+void NoteDiff::revert( Pattern* pPattern, InstrumentList* pInstrumentList ) const
+{
+	eraseNotes( pPattern, m_added );
+	assignNotes( pPattern, m_modified, true );
+	insertNotes( pPattern, pInstrumentList, m_removed );
+}
+
+bool NoteDiff::mergeWith( const NoteDiff& other )
+{
+	if ( ! m_added.empty() || ! m_removed.empty() ||
+		 ! other.m_added.empty() || ! other.m_removed.empty() ) {
+		return false;
+	}
+
+	for ( const auto& modification : other.m_modified ) {
+		bool bFound = false;
+		for ( auto& existing : m_modified ) {
+			const NoteRecord& after = existing.second;
+			if ( after.nPosition == modification.first.nPosition &&
+				 after.nInstrumentId == modification.first.nInstrumentId &&
+				 after.key == modification.first.key &&
+				 after.octave == modification.first.octave ) {
+				existing.second = modification.second;
+				bFound = true;
+				break;
+			}
+		}
+		if ( ! bFound ) {
+			m_modified.push_back( modification );
+		}
+	}
+
+	return true;
+}
+
+void NoteDiff::insertNotes( Pattern* pPattern, InstrumentList* pInstrumentList,
+							const std::vector<NoteRecord>& records )
+{
+	for ( const auto& record : records ) {
+		Note* pNote = record.createNote( pInstrumentList );
+		if ( pNote != nullptr ) {
+			pPattern->insert_note( pNote );
+		}
+	}
+}
+
+void NoteDiff::eraseNotes( Pattern* pPattern, const std::vector<NoteRecord>& records )
+{
+	Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
+	for ( const auto& record : records ) {
+		FOREACH_NOTE_IT_BOUND( notes, it, record.nPosition ) {
+			Note* pNote = it->second;
+			assert( pNote );
+			if ( record.refersTo( pNote ) ) {
+				notes->erase( it );
+				pPattern->notes_changed();
+				delete pNote;
+				break;
+			}
+		}
+	}
+}
+
+void NoteDiff::assignNotes( Pattern* pPattern,
+							const std::vector< std::pair<NoteRecord, NoteRecord> >& records,
+							bool bRevert )
+{
+	const Pattern::notes_t* notes = pPattern->get_notes();
+	for ( const auto& record : records ) {
+		const NoteRecord& from = bRevert ? record.second : record.first;
+		const NoteRecord& to = bRevert ? record.first : record.second;
+		FOREACH_NOTE_CST_IT_BOUND( notes, it, from.nPosition ) {
+			Note* pNote = it->second;
+			assert( pNote );
+			if ( from.refersTo( pNote ) ) {
+				to.assignTo( pNote );
+				break;
+			}
+		}
+	}
+	pPattern->notes_changed();
+}
@@ -0,0 +1,123 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef NOTE_DIFF_H
+#define NOTE_DIFF_H
+
+#include <vector>
+#include <utility>
+
+#include <core/Basics/Note.h>
+
+namespace H2Core
+{
+	class InstrumentList;
+	class Pattern;
+}
+
+///
+/// Note-level difference between two states of a single pattern.
+///
+/// Undo actions of bulk edits (clear, fill, paste, randomize...) keep a NoteDiff instead of copies of whole
+/// notes or patterns. This way the memory held by the undo stack grows with the number of notes touched by
+/// an edit and not with the size of the pattern. Notes are identified by their position, the id of their
+/// instrument, and their key and octave.
+///
+/// The NoteDiff does not lock the audio engine. This is up to the caller of apply() and revert().
+///
+class NoteDiff
+{
+public:
+	/** Compact copy of the properties of a H2Core::Note.*/
+	struct NoteRecord {
+		int nPosition;
+		int nInstrumentId;
+		int nLength;
+		float fVelocity;
+		float fPan_L;
+		float fPan_R;
+		float fLeadLag;
+		float fProbability;
+		float fPitch;
+		H2Core::Note::Key key;
+		H2Core::Note::Octave octave;
+		bool bNoteOff;
+
+		static NoteRecord fromNote( H2Core::Note* pNote );
+		/** \return whether @a pNote is the note described by this record.*/
+		bool refersTo( H2Core::Note* pNote ) const;
+		/** Sets all properties of @a pNote not used for identification.*/
+		void assignTo( H2Core::Note* pNote ) const;
+		/** \return new note or nullptr if the instrument is not present in @a pInstrumentList.*/
+		H2Core::Note* createNote( H2Core::InstrumentList* pInstrumentList ) const;
+	};
+
+	/** Records that @a pNote is added to the pattern.*/
+	void addNote( H2Core::Note* pNote );
+	void addNote( const NoteRecord& record );
+	/** Records that @a pNote is removed from the pattern.*/
+	void removeNote( H2Core::Note* pNote );
+	/** Records that the properties of a note change from @a before to @a after.*/
+	void modifyNote( const NoteRecord& before, const NoteRecord& after );
+
+	/** Removes, modifies, and adds the recorded notes in @a pPattern.*/
+	void apply( H2Core::Pattern* pPattern, H2Core::InstrumentList* pInstrumentList ) const;
+	/** Undoes apply().*/
+	void revert( H2Core::Pattern* pPattern, H2Core::InstrumentList* pInstrumentList ) const;
+
+	/**
+	 * Combines @a other, which has to be applied after this diff, into this one.
+	 *
+	 * Only diffs modifying notes can be merged. Modifications of the same note are collapsed into one.
+	 *
+	 * \return false if either of the diffs adds or removes notes. Both are left untouched in this case.
+	 */
+	bool mergeWith( const NoteDiff& other );
+
+	bool isEmpty() const;
+	/** \return Number of notes affected.*/
+	int size() const;
+
+private:
+	static void insertNotes( H2Core::Pattern* pPattern, H2Core::InstrumentList* pInstrumentList,
+							 const std::vector<NoteRecord>& records );
+	static void eraseNotes( H2Core::Pattern* pPattern, const std::vector<NoteRecord>& records );
+	static void assignNotes( H2Core::Pattern* pPattern,
+							 const std::vector< std::pair<NoteRecord, NoteRecord> >& records,
+							 bool bRevert );
+
+	std::vector<NoteRecord> m_added;
+	std::vector<NoteRecord> m_removed;
+	/** Properties before and after the modification.*/
+	std::vector< std::pair<NoteRecord, NoteRecord> > m_modified;
+};
+
+inline bool NoteDiff::isEmpty() const {
+	return m_added.empty() && m_removed.empty() && m_modified.empty();
+}
+
+inline int NoteDiff::size() const {
+	return m_added.size() + m_removed.size() + m_modified.size();
+}
+
+#endif
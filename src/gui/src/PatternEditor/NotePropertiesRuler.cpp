@@ -29,6 +29,7 @@
 #include <core/Basics/Note.h>
 using namespace H2Core;
 
+#include <algorithm>
 #include <cassert>
 
 #include "../HydrogenApp.h"
@@ -127,6 +128,7 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 	}
 
 	int nColumn = getColumn( ev->x() );
+	bool bCursorWasHidden = HydrogenApp::get_instance()->hideKeyboardCursor();
 
 	m_pPatternEditorPanel->setCursorPosition( nColumn );
 	HydrogenApp::get_instance()->setHideKeyboardCursor( true );
@@ -136,7 +138,8 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 
 	// Gather notes to act on: selected or under the mouse cursor
 	std::list< Note *> notes;
-	if ( m_selection.begin() != m_selection.end() ) {
+	bool bSelection = m_selection.begin() != m_selection.end();
+	if ( bSelection ) {
 		for ( Note *pNote : m_selection ) {
 			notes.push_back( pNote );
 		}
@@ -156,7 +159,11 @@ void NotePropertiesRuler::wheelEvent(QWheelEvent *ev )
 
 	pSong->setIsModified( true );
 	addUndoAction();
-	updateEditor();
+	if ( bCursorWasHidden && ! bSelection ) {
+		updateColumn( nColumn );
+	} else {
+		updateEditor();
+	}
 }
 
 
@@ -337,6 +344,7 @@ void NotePropertiesRuler::propertyDragUpdate( QMouseEvent *ev )
 	}
 
 	int nColumn = getColumn( ev->x() );
+	bool bCursorWasHidden = HydrogenApp::get_instance()->hideKeyboardCursor();
 
 	m_pPatternEditorPanel->setCursorPosition( nColumn );
 	HydrogenApp::get_instance()->setHideKeyboardCursor( true );
@@ -446,7 +454,13 @@ void NotePropertiesRuler::propertyDragUpdate( QMouseEvent *ev )
 	m_nDragPreviousColumn = nColumn;
 
 	Hydrogen::get_instance()->getSong()->setIsModified( true );
-	updateEditor();
+	if ( bCursorWasHidden ) {
+		// Only the notes of the current column changed.
+		updateColumn( nColumn );
+	} else {
+		// Erase the keyboard cursor as well.
+		updateEditor();
+	}
 
 	m_pPatternEditorPanel->getPianoRollEditor()->updateEditor();
 	m_pPatternEditorPanel->getDrumPatternEditor()->updateEditor();
@@ -799,7 +813,7 @@ void NotePropertiesRuler::addUndoAction()
 void NotePropertiesRuler::paintEvent( QPaintEvent *ev)
 {
 	QPainter painter(this);
-	if ( m_bNeedsUpdate ) {
+	if ( m_bNeedsUpdate || ! m_dirtyRect.isNull() ) {
 		finishUpdateEditor();
 	}
 	painter.drawPixmap( ev->rect(), *m_pBackground, ev->rect() );
@@ -830,6 +844,9 @@ void NotePropertiesRuler::createVelocityBackground(QPixmap *pixmap)
 	}
 
 	QPainter p( pixmap );
+	if ( ! m_dirtyRect.isNull() ) {
+		p.setClipRect( m_dirtyRect );
+	}
 
 	p.fillRect( 0, 0, m_nMargin + nNotes * m_fGridWidth, height(), backgroundColor );
 
@@ -913,6 +930,9 @@ void NotePropertiesRuler::createPanBackground(QPixmap *pixmap)
 				  pStyle->m_patternEditor_line1Color.getBlue() );
 
 	QPainter p( pixmap );
+	if ( ! m_dirtyRect.isNull() ) {
+		p.setClipRect( m_dirtyRect );
+	}
 
 	unsigned nNotes = MAX_NOTES;
 	if (m_pPattern) {
@@ -1000,6 +1020,9 @@ void NotePropertiesRuler::createLeadLagBackground(QPixmap *pixmap)
 				  pStyle->m_patternEditor_line1Color.getBlue() );
 
 	QPainter p( pixmap );
+	if ( ! m_dirtyRect.isNull() ) {
+		p.setClipRect( m_dirtyRect );
+	}
 
 	unsigned nNotes = MAX_NOTES;
 	if (m_pPattern) {
@@ -1113,6 +1136,9 @@ void NotePropertiesRuler::createNoteKeyBackground(QPixmap *pixmap)
 		nNotes = m_pPattern->get_length();
 	}
 	QPainter p( pixmap );
+	if ( ! m_dirtyRect.isNull() ) {
+		p.setClipRect( m_dirtyRect );
+	}
 
 	p.fillRect( 0, 0, m_nMargin + nNotes * m_fGridWidth, height(), backgroundColor );
 
@@ -1254,11 +1280,20 @@ void NotePropertiesRuler::updateEditor( bool bPatternOnly )
 
 void NotePropertiesRuler::finishUpdateEditor()
 {
-	assert( m_bNeedsUpdate );
-	resize( m_nEditorWidth, height() );
-		
-	delete m_pBackground;
-	m_pBackground = new QPixmap( m_nEditorWidth, m_nEditorHeight );
+	if ( m_bNeedsUpdate ) {
+		resize( m_nEditorWidth, height() );
+
+		// The pixmap is only reallocated if the pattern length
+		// changed.
+		if ( m_pBackground->width() != (int)m_nEditorWidth ||
+			 m_pBackground->height() != (int)m_nEditorHeight ) {
+			delete m_pBackground;
+			m_pBackground = new QPixmap( m_nEditorWidth, m_nEditorHeight );
+		}
+
+		// Redraw all
+		m_dirtyRect = QRect();
+	}
 
 	if ( m_Mode == VELOCITY || m_Mode == PROBABILITY ) {
 		createVelocityBackground( m_pBackground );
@@ -1275,6 +1310,9 @@ void NotePropertiesRuler::finishUpdateEditor()
 
 	if ( hasFocus() && ! HydrogenApp::get_instance()->hideKeyboardCursor() ) {
 		QPainter p( m_pBackground );
+		if ( ! m_dirtyRect.isNull() ) {
+			p.setClipRect( m_dirtyRect );
+		}
 
 		uint x = m_nMargin + m_pPatternEditorPanel->getCursorPosition() * m_fGridWidth;
 
@@ -1285,9 +1323,27 @@ void NotePropertiesRuler::finishUpdateEditor()
 		p.drawRoundedRect( QRect( x-m_fGridWidth*3, 0+1, m_fGridWidth*6, height()-2 ), 4, 4 );
 	}
 
-	// redraw all
+	// Called from within paintEvent(). There is no need to schedule
+	// another one.
 	m_bNeedsUpdate = false;
-	update();
+	m_dirtyRect = QRect();
+}
+
+void NotePropertiesRuler::updateColumn( int nColumn )
+{
+	if ( m_bNeedsUpdate ) {
+		// Everything will be redrawn anyway.
+		return;
+	}
+
+	// Covers notes of the column drawn side by side, the outline of
+	// selected ones, and the keyboard cursor.
+	int nX = m_nMargin + nColumn * m_fGridWidth;
+	int nHalfWidth = std::max( (int)( m_fGridWidth * 3 ), 16 );
+	QRect columnRect( nX - nHalfWidth, 0, 2 * nHalfWidth + 16, height() );
+
+	m_dirtyRect = m_dirtyRect.united( columnRect );
+	update( columnRect );
 }
 
 
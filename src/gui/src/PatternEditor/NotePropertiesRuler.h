@@ -99,6 +99,13 @@ class NotePropertiesRuler : public PatternEditor
 		bool m_bNeedsUpdate;
 		void finishUpdateEditor();
 
+		//! Marks the lane of the notes at @a nColumn to be redrawn. Used when the properties of those notes
+		//! changed only, in order to leave the remainder of #m_pBackground untouched.
+		void updateColumn( int nColumn );
+		//! Part of #m_pBackground to be redrawn by the next finishUpdateEditor() if #m_bNeedsUpdate is not
+		//! set. Null if there is none.
+		QRect m_dirtyRect;
+
 		NotePropertiesMode m_Mode;
 
 		QPixmap *m_pBackground;
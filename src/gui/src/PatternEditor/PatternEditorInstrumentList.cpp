@@ -25,6 +25,7 @@
 #include <core/AudioEngine.h>
 #include <core/EventQueue.h>
 #include <core/Hydrogen.h>
+#include <core/InstrumentFreezer.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/Note.h>
@@ -39,6 +40,7 @@ using namespace H2Core;
 #include "PatternEditorPanel.h"
 #include "InstrumentEditor/InstrumentEditorPanel.h"
 #include "DrumPatternEditor.h"
+#include "NoteDiff.h"
 #include "../HydrogenApp.h"
 #include "../Mixer/Mixer.h"
 #include "../Widgets/Button.h"
@@ -46,12 +48,51 @@ using namespace H2Core;
 #include <QtGui>
 #include <QtWidgets>
 #include <QClipboard>
+#include <QMimeData>
 
 #include <cassert>
 #include <algorithm> // for std::min
 
 const char* InstrumentLine::__class_name = "InstrumentLine";
 
+/** MIME type of instrument lines copied within Hydrogen.*/
+static const QString sInstrumentLineMimeType = "application/x-hydrogen-instrument-line";
+
+/**
+ * Clipboard content of a copied instrument line.
+ *
+ * It holds the compact binary format of
+ * Song::copyInstrumentLineToBinary(). The XML format is only
+ * generated in case another application asks for plain text.
+ */
+class InstrumentLineMimeData : public QMimeData
+{
+public:
+	explicit InstrumentLineMimeData( const QByteArray& serialized )
+		: m_serialized( serialized ) {}
+
+	QStringList formats() const override {
+		return QStringList() << sInstrumentLineMimeType << "text/plain";
+	}
+	bool hasFormat( const QString& sMimeType ) const override {
+		return formats().contains( sMimeType );
+	}
+
+protected:
+	QVariant retrieveData( const QString& sMimeType, QVariant::Type type ) const override {
+		if ( sMimeType == sInstrumentLineMimeType ) {
+			return m_serialized;
+		}
+		if ( sMimeType == "text/plain" ) {
+			return Song::instrumentLineBinaryToString( m_serialized );
+		}
+		return QMimeData::retrieveData( sMimeType, type );
+	}
+
+private:
+	QByteArray m_serialized;
+};
+
 InstrumentLine::InstrumentLine(QWidget* pParent)
 	: PixmapWidget(pParent, __class_name)
 	, m_bIsSelected(false)
@@ -131,6 +172,9 @@ InstrumentLine::InstrumentLine(QWidget* pParent)
 
 	m_pFunctionPopup->addSection( tr( "Instrument" ) );
 	m_pFunctionPopup->addAction( tr( "Rename instrument" ), this, SLOT( functionRenameInstrument() ) );
+	m_pFunctionPopup->addAction( tr( "Set JACK output bus" ), this, SLOT( functionSetOutputBus() ) );
+	m_pFreezeAction = m_pFunctionPopup->addAction( tr( "Freeze instrument" ), this, SLOT( functionFreezeInstrument() ) );
+	m_pFreezeAction->setCheckable( true );
 	m_pFunctionPopup->addAction( tr( "Delete instrument" ), this, SLOT( functionDeleteInstrument() ) );
 	m_pFunctionPopup->setObjectName( "PatternEditorFunctionPopup" );
 
@@ -142,7 +186,9 @@ InstrumentLine::InstrumentLine(QWidget* pParent)
 
 void InstrumentLine::setName(const QString& sName)
 {
-	m_pNameLbl->setText(sName);
+	if ( m_pNameLbl->text() != sName ) {
+		m_pNameLbl->setText(sName);
+	}
 }
 
 
@@ -184,6 +230,9 @@ void InstrumentLine::setSoloed( bool soloed )
 
 void InstrumentLine::setSamplesMissing( bool bSamplesMissing )
 {
+	if ( bSamplesMissing == ! m_pSampleWarning->isHidden() ) {
+		return;
+	}
 	if ( bSamplesMissing ) {
 		m_pSampleWarning->show();
 	} else {
@@ -245,6 +294,8 @@ void InstrumentLine::mousePressEvent(QMouseEvent *ev)
 		AudioEngine::get_instance()->get_sampler()->noteOn(pNote);
 	}
 	else if (ev->button() == Qt::RightButton ) {
+		Instrument* pInstr = Hydrogen::get_instance()->getSong()->getInstrumentList()->get( m_nInstrumentNumber );
+		m_pFreezeAction->setChecked( InstrumentFreezer::get_instance()->isFrozen( pInstr ) );
 		m_pFunctionPopup->popup( QPoint( ev->globalX(), ev->globalY() ) );
 	}
 
@@ -301,9 +352,9 @@ void InstrumentLine::functionCopyAllInstrumentPatterns()
 	assert(song);
 
 	// Serialize & put to clipboard
-	QString serialized = song->copyInstrumentLineToString( -1, m_nInstrumentNumber );
+	QByteArray serialized = song->copyInstrumentLineToBinary( -1, m_nInstrumentNumber );
 	QClipboard *clipboard = QApplication::clipboard();
-	clipboard->setText(serialized);
+	clipboard->setMimeData( new InstrumentLineMimeData( serialized ) );
 }
 
 
@@ -321,11 +372,20 @@ void InstrumentLine::functionPasteInstrumentPatternExec(int patternID)
 	// This is a note list for pasted notes collection
 	std::list< Pattern* > patternList;
 
-	// Get from clipboard & deserialize
+	// Get from clipboard & deserialize. Content copied within
+	// Hydrogen is read in its binary format.
 	QClipboard *clipboard = QApplication::clipboard();
-	QString serialized = clipboard->text();
-	if ( !song->pasteInstrumentLineFromString( serialized, patternID, m_nInstrumentNumber, patternList ) ) {
-		return;
+	const QMimeData* pMimeData = clipboard->mimeData();
+	if ( pMimeData != nullptr && pMimeData->hasFormat( sInstrumentLineMimeType ) ) {
+		if ( !song->pasteInstrumentLineFromBinary( pMimeData->data( sInstrumentLineMimeType ),
+												   patternID, m_nInstrumentNumber, patternList ) ) {
+			return;
+		}
+	} else {
+		QString serialized = clipboard->text();
+		if ( !song->pasteInstrumentLineFromString( serialized, patternID, m_nInstrumentNumber, patternList ) ) {
+			return;
+		}
 	}
 
 	// Ignore empty result
@@ -396,7 +456,7 @@ void InstrumentLine::functionFillNotes( int every )
 
 	Song *pSong = pEngine->getSong();
 
-	QStringList notePositions;
+	NoteDiff diff;
 
 	Pattern* pCurrentPattern = getCurrentPattern();
 	if (pCurrentPattern != nullptr) {
@@ -419,10 +479,11 @@ void InstrumentLine::functionFillNotes( int every )
 				}
 
 				if ( noteAlreadyPresent == false ) {
-					notePositions << QString("%1").arg(i);
+					Note note( instrRef, i, 0.8f, 0.5f, 0.5f, -1, 0.0f );
+					diff.addNote( &note );
 				}
 			}
-			SE_fillNotesRightClickAction *action = new SE_fillNotesRightClickAction( notePositions, nSelectedInstrument, pEngine->getSelectedPatternNumber() );
+			SE_fillNotesRightClickAction *action = new SE_fillNotesRightClickAction( diff, nSelectedInstrument, pEngine->getSelectedPatternNumber() );
 			HydrogenApp::get_instance()->m_pUndoStack->push( action );
 		}
 	}
@@ -450,8 +511,7 @@ void InstrumentLine::functionRandomizeVelocity()
 
 	Song *pSong = pEngine->getSong();
 
-	QStringList noteVeloValue;
-	QStringList oldNoteVeloValue;
+	NoteDiff diff;
 
 	Pattern* pCurrentPattern = getCurrentPattern();
 	if (pCurrentPattern != nullptr) {
@@ -467,7 +527,6 @@ void InstrumentLine::functionRandomizeVelocity()
 					Note *pNote = it->second;
 					if ( pNote->get_instrument() == instrRef ) {
 						float fVal = ( rand() % 100 ) / 100.0;
-						oldNoteVeloValue <<  QString("%1").arg( pNote->get_velocity() );
 						fVal = pNote->get_velocity() + ( ( fVal - 0.50 ) / 2 );
 						if ( fVal < 0  ) {
 							fVal = 0;
@@ -475,11 +534,14 @@ void InstrumentLine::functionRandomizeVelocity()
 						if ( fVal > 1 ) {
 							fVal = 1;
 						}
-						noteVeloValue << QString("%1").arg(fVal);
+						NoteDiff::NoteRecord before = NoteDiff::NoteRecord::fromNote( pNote );
+						NoteDiff::NoteRecord after = before;
+						after.fVelocity = fVal;
+						diff.modifyNote( before, after );
 					}
 				}
 			}
-			SE_randomVelocityRightClickAction *action = new SE_randomVelocityRightClickAction( noteVeloValue, oldNoteVeloValue, nSelectedInstrument, pEngine->getSelectedPatternNumber() );
+			SE_randomVelocityRightClickAction *action = new SE_randomVelocityRightClickAction( diff, nSelectedInstrument, pEngine->getSelectedPatternNumber() );
 			HydrogenApp::get_instance()->m_pUndoStack->push( action );
 		}
 	}
@@ -500,12 +562,10 @@ void InstrumentLine::functionRenameInstrument()
 	if ( bIsOkPressed  ) {
 		pSelectedInstrument->set_name( sNewName );
 
-#ifdef H2CORE_HAVE_JACK
 		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		Hydrogen *engine = Hydrogen::get_instance();
 		engine->renameJackPorts(engine->getSong());
 		AudioEngine::get_instance()->unlock();
-#endif
 
 		// this will force an update...
 		EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -518,6 +578,53 @@ void InstrumentLine::functionRenameInstrument()
 
 }
 
+void InstrumentLine::functionSetOutputBus()
+{
+	Hydrogen * pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	Instrument *pSelectedInstrument = pSong->getInstrumentList()->get( m_nInstrumentNumber );
+
+	bool bIsOkPressed;
+	QString sBus = QInputDialog::getText( this, "Hydrogen",
+										  tr( "Output bus of the JACK per-track outputs (leave empty for individual ports)" ),
+										  QLineEdit::Normal, pSelectedInstrument->get_output_bus(),
+										  &bIsOkPressed );
+	if ( ! bIsOkPressed || sBus.trimmed() == pSelectedInstrument->get_output_bus() ) {
+		return;
+	}
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	pSelectedInstrument->set_output_bus( sBus.trimmed() );
+	pHydrogen->renameJackPorts( pSong );
+	AudioEngine::get_instance()->unlock();
+
+	pSong->setIsModified( true );
+}
+
+void InstrumentLine::functionFreezeInstrument()
+{
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	Instrument *pSelectedInstrument = pSong->getInstrumentList()->get( m_nInstrumentNumber );
+	InstrumentFreezer* pFreezer = InstrumentFreezer::get_instance();
+
+	if ( pFreezer->isFrozen( pSelectedInstrument ) ) {
+		pFreezer->unfreeze( pSelectedInstrument );
+		HydrogenApp::get_instance()->setStatusBarMessage( tr( "Instrument unfrozen" ), 5000 );
+		return;
+	}
+
+	// Rendering all patterns of the instrument stops the playback.
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	bool bFrozen = pFreezer->freeze( pSelectedInstrument );
+	QApplication::restoreOverrideCursor();
+
+	if ( bFrozen ) {
+		HydrogenApp::get_instance()->setStatusBarMessage( tr( "Instrument frozen" ), 5000 );
+	} else {
+		HydrogenApp::get_instance()->setStatusBarMessage( tr( "Unable to freeze the instrument" ), 5000 );
+	}
+}
+
 void InstrumentLine::functionDeleteInstrument()
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
@@ -608,7 +715,11 @@ InstrumentLine* PatternEditorInstrumentList::createInstrumentLine()
 
 
 ///
-/// Update every InstrumentLine, create or destroy lines if necessary.
+/// Update every InstrumentLine, create lines if necessary.
+///
+/// Lines of instruments no longer present are only hidden and reused as soon as the instrument list grows
+/// again, e.g. when loading another drumkit. The setters of InstrumentLine do only repaint a line if its
+/// content actually changed.
 ///
 void PatternEditorInstrumentList::updateInstrumentLines()
 {
@@ -621,15 +732,21 @@ void PatternEditorInstrumentList::updateInstrumentLines()
 	unsigned nSelectedInstr = pEngine->getSelectedInstrumentNumber();
 
 	unsigned nInstruments = pInstrList->size();
-	for ( unsigned nInstr = 0; nInstr < MAX_INSTRUMENTS; ++nInstr ) {
-		if ( nInstr >= nInstruments ) {	// unused instrument! let's hide and destroy the mixerline!
-			if ( m_pInstrumentLine[ nInstr ] ) {
-				delete m_pInstrumentLine[ nInstr ];
-				m_pInstrumentLine[ nInstr ] = nullptr;
 
-				int newHeight = m_nGridHeight * nInstruments;
-				resize( width(), newHeight );
+	int nNewHeight = m_nGridHeight * nInstruments;
+	if ( nNewHeight != height() ) {
+		resize( width(), nNewHeight );
+	}
 
+	for ( unsigned nInstr = 0; nInstr < MAX_INSTRUMENTS; ++nInstr ) {
+		if ( nInstr >= nInstruments ) {	// unused instrument! let's hide the line
+			if ( m_pInstrumentLine[ nInstr ] == nullptr ) {
+				// Lines are created in order. All following
+				// ones do not exist either.
+				break;
+			}
+			if ( ! m_pInstrumentLine[ nInstr ]->isHidden() ) {
+				m_pInstrumentLine[ nInstr ]->hide();
 			}
 			continue;
 		}
@@ -638,10 +755,9 @@ void PatternEditorInstrumentList::updateInstrumentLines()
 				// the instrument line doesn't exists..I'll create a new one!
 				m_pInstrumentLine[ nInstr ] = createInstrumentLine();
 				m_pInstrumentLine[nInstr]->move( 0, m_nGridHeight * nInstr );
-				m_pInstrumentLine[nInstr]->show();
-
-				int newHeight = m_nGridHeight * nInstruments;
-				resize( width(), newHeight );
+			}
+			if ( m_pInstrumentLine[ nInstr ]->isHidden() ) {
+				m_pInstrumentLine[ nInstr ]->show();
 			}
 			InstrumentLine *pLine = m_pInstrumentLine[ nInstr ];
 			Instrument* pInstr = pInstrList->get(nInstr);
@@ -79,6 +79,8 @@ class InstrumentLine : public PixmapWidget
 		void functionRandomizeVelocity();
 		void functionDeleteInstrument();
 		void functionRenameInstrument();
+		void functionSetOutputBus();
+		void functionFreezeInstrument();
 		void muteClicked();
 		void soloClicked();
 		void sampleWarningClicked();
@@ -89,6 +91,7 @@ class InstrumentLine : public PixmapWidget
 	private:
 		QMenu *m_pFunctionPopup;
 		QMenu *m_pFunctionPopupSub;
+		QAction *m_pFreezeAction;
 		QLabel *m_pNameLbl;
 		bool m_bIsSelected;
 		int m_nInstrumentNumber;	///< The related instrument number
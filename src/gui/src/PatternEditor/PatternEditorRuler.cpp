@@ -31,6 +31,7 @@ using namespace H2Core;
 
 #include <QTimer>
 #include <QPainter>
+#include <algorithm>
 
 
 #include "PatternEditorRuler.h"
@@ -56,6 +57,7 @@ PatternEditorRuler::PatternEditorRuler( QWidget* parent )
 
 
 	m_pPattern = nullptr;
+	m_nTicks = -1;
 	m_fGridWidth = Preferences::get_instance()->getPatternEditorGridWidth();
 
 	m_nRulerWidth = 20 + m_fGridWidth * ( MAX_NOTES * 4 );
@@ -72,6 +74,7 @@ PatternEditorRuler::PatternEditorRuler( QWidget* parent )
 	m_pBackground->fill( backgroundColor );
 
 	m_pTimer = new QTimer(this);
+	m_pTimer->setTimerType( Qt::PreciseTimer );
 	connect(m_pTimer, SIGNAL(timeout()), this, SLOT(updateEditor()));
 
 	HydrogenApp::get_instance()->addEventListener( this );
@@ -87,7 +90,7 @@ PatternEditorRuler::~PatternEditorRuler() {
 
 void PatternEditorRuler::updateStart(bool start) {
 	if (start) {
-		m_pTimer->start(50);	// update ruler at 20 fps
+		m_pTimer->start(16);	// move the tick position at 60 fps
 	}
 	else {
 		m_pTimer->stop();
@@ -115,8 +118,6 @@ void PatternEditorRuler::hideEvent ( QHideEvent *ev )
 
 void PatternEditorRuler::updateEditor( bool bRedrawAll )
 {
-	static int oldNTicks = 0;
-
 	Hydrogen *pEngine = Hydrogen::get_instance();
 
 	//Do not redraw anything if Export is active.
@@ -135,43 +136,47 @@ void PatternEditorRuler::updateEditor( bool bRedrawAll )
 	}
 
 
-	bool bActive = false;	// is the pattern playing now?
-
-	/* 
-	 * Lock audio engine to make sure pattern list does not get
-	 * modified / cleared during iteration 
-	 */
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-	PatternList *pList = pEngine->getCurrentPatternList();
-	for (uint i = 0; i < pList->size(); i++) {
-		if ( m_pPattern == pList->get(i) ) {
-			bActive = true;
-			break;
-		}
-	}
-
-	AudioEngine::get_instance()->unlock();
+	// Is the pattern playing now? The snapshot spares us from
+	// locking the audio engine on every timer tick.
+	std::vector<const Pattern*> playingPatterns, nextPatterns;
+	pEngine->getPlaybackPatterns( &playingPatterns, &nextPatterns );
+	bool bActive = m_pPattern != nullptr &&
+		std::find( playingPatterns.begin(), playingPatterns.end(), m_pPattern ) != playingPatterns.end();
 
 
+	// The position is extrapolated from the last process cycle, so
+	// the tick position moves smoothly instead of in buffer sized
+	// steps.
+	int nOldTicks = m_nTicks;
 	int state = pEngine->getState();
-	if ( ( state == STATE_PLAYING ) && (bActive) ) {
-		m_nTicks = pEngine->getTickPosition();
+	int nColumn, nLength;
+	double fTick;
+	if ( ( state == STATE_PLAYING ) && (bActive) &&
+		 pEngine->getPlayheadPosition( &nColumn, &fTick, &nLength ) ) {
+		m_nTicks = static_cast<int>( fTick );
 	}
 	else {
 		m_nTicks = -1;	// hide the tickPosition
 	}
 
-
-	if (oldNTicks != m_nTicks) {
-		// redraw all
-		bRedrawAll = true;
-	}
-	oldNTicks = m_nTicks;
-
 	if (bRedrawAll) {
 		update( 0, 0, width(), height() );
 	}
+	else if ( nOldTicks != m_nTicks ) {
+		// Only the area covered by the tick position is repainted.
+		if ( nOldTicks != -1 ) {
+			update( tickPositionRect( nOldTicks ) );
+		}
+		if ( m_nTicks != -1 ) {
+			update( tickPositionRect( m_nTicks ) );
+		}
+	}
+}
+
+QRect PatternEditorRuler::tickPositionRect( int nTicks ) const
+{
+	int x = (int)( 20 + nTicks * m_fGridWidth - 5 - 11 / 2.0 );
+	return QRect( x, 0, 11, height() );
 }
 
 
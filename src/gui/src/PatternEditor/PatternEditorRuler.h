@@ -72,7 +72,12 @@ class PatternEditorRuler : public QWidget, public H2Core::Object, public EventLi
 		QPixmap m_tickPosition;
 
 		QTimer *m_pTimer;
+		/** Ticks passed since the beginning of the pattern or -1 if
+			the tick position is hidden.*/
 		int m_nTicks;
+
+		/** \return Area covered by the tick position at @a nTicks.*/
+		QRect tickPositionRect( int nTicks ) const;
 		PatternEditorPanel *m_pPatternEditorPanel;
 		H2Core::Pattern *m_pPattern;
 
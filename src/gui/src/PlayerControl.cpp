@@ -763,9 +763,10 @@ void PlayerControl::bpmChanged() {
 
 	m_pEngine->getSong()->setIsModified( true );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-	m_pEngine->setBPM( fNewBpmValue );
-	AudioEngine::get_instance()->unlock();
+	Hydrogen* pEngine = m_pEngine;
+	AudioEngine::get_instance()->postCommand( [pEngine, fNewBpmValue]() {
+		pEngine->setBPM( fNewBpmValue );
+	} );
 }
 
 
@@ -891,17 +892,17 @@ void PlayerControl::jackTransportBtnClicked( Button* )
 		return;
 	}
 
+	// The audio engine picks up the new mode at the beginning of its
+	// next cycle.
 	if (m_pJackTransportBtn->isPressed()) {
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		pPref->m_bJackTransportMode = Preferences::USE_JACK_TRANSPORT;
-		AudioEngine::get_instance()->unlock();
+		pPref->publishRealtimeConfig();
 		(HydrogenApp::get_instance())->setStatusBarMessage(tr("JACK transport mode = On"), 5000);
 		m_pJackMasterBtn->setDisabled( false );
 	}
 	else {
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		pPref->m_bJackTransportMode = Preferences::NO_JACK_TRANSPORT;
-		AudioEngine::get_instance()->unlock();
+		pPref->publishRealtimeConfig();
 		(HydrogenApp::get_instance())->setStatusBarMessage(tr("JACK transport mode = Off"), 5000);
 		m_pJackMasterBtn->setPressed( false );
 		m_pJackMasterBtn->setDisabled( true );
@@ -923,6 +924,7 @@ void PlayerControl::jackMasterBtnClicked( Button* )
 	if (m_pJackMasterBtn->isPressed()) {
 		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		pPref->m_bJackMasterMode = Preferences::USE_JACK_TIME_MASTER;
+		pPref->publishRealtimeConfig();
 		AudioEngine::get_instance()->unlock();
 		(HydrogenApp::get_instance())->setStatusBarMessage(tr("JACK Timebase master mode = On"), 5000);
 		Hydrogen::get_instance()->onJackMaster();
@@ -930,6 +932,7 @@ void PlayerControl::jackMasterBtnClicked( Button* )
 	} else {
 		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		pPref->m_bJackMasterMode = Preferences::NO_JACK_TIME_MASTER;
+		pPref->publishRealtimeConfig();
 		AudioEngine::get_instance()->unlock();
 		(HydrogenApp::get_instance())->setStatusBarMessage(tr("JACK Timebase master mode = Off"), 5000);
 		Hydrogen::get_instance()->offJackMaster();
@@ -947,10 +950,10 @@ void PlayerControl::bpmClicked()
 
 		m_pEngine->getSong()->setIsModified( true );
 
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-		m_pEngine->setBPM( fNewVal );
-		AudioEngine::get_instance()->unlock();
+		Hydrogen* pEngine = m_pEngine;
+		AudioEngine::get_instance()->postCommand( [pEngine, fNewVal]() {
+			pEngine->setBPM( fNewVal );
+		} );
 	}
 	else {
 		// user entered nothing or pressed Cancel
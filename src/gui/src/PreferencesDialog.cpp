@@ -85,6 +85,9 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 #ifdef H2CORE_HAVE_PULSEAUDIO
 	driverComboBox->addItem( "PulseAudio" );
 #endif
+#ifdef H2CORE_HAVE_PIPEWIRE
+	driverComboBox->addItem( "PipeWire" );
+#endif
 
 	// Language selection menu
 	for ( QString sLang : Translations::availableTranslations( "hydrogen" ) ) {
@@ -129,6 +132,9 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 #ifdef H2CORE_HAVE_JACK
 	m_pMidiDriverComboBox->addItem( "JACK-MIDI" );
 #endif
+#ifdef H2CORE_HAVE_PIPEWIRE
+	m_pMidiDriverComboBox->addItem( "PipeWire" );
+#endif
 
 
 	if( m_pMidiDriverComboBox->findText(pPref->m_sMidiDriver) > -1){
@@ -442,6 +448,7 @@ void PreferencesDialog::updateDriverPreferences() {
 	}
 	else if (driverComboBox->currentText() == "PortAudio" ) {
 		pPref->m_sAudioDriver = "PortAudio";
+		pPref->m_sPortAudioDevice = m_pAudioDeviceTxt->text();
 	}
 	else if (driverComboBox->currentText() == "CoreAudio" ) {
 		pPref->m_sAudioDriver = "CoreAudio";
@@ -449,6 +456,9 @@ void PreferencesDialog::updateDriverPreferences() {
 	else if (driverComboBox->currentText() == "PulseAudio" ) {
 		pPref->m_sAudioDriver = "PulseAudio";
 	}
+	else if (driverComboBox->currentText() == "PipeWire" ) {
+		pPref->m_sAudioDriver = "PipeWire";
+	}
 	else {
 		ERRORLOG( "[okBtnClicked] Invalid audio driver:" + driverComboBox->currentText() );
 	}
@@ -528,6 +538,9 @@ void PreferencesDialog::on_okBtn_clicked()
 	else if ( m_pMidiDriverComboBox->currentText() == "JACK-MIDI" ) {
 		pPref->m_sMidiDriver = "JACK-MIDI";
 	}
+	else if ( m_pMidiDriverComboBox->currentText() == "PipeWire" ) {
+		pPref->m_sMidiDriver = "PipeWire";
+	}
 
 
 
@@ -645,6 +658,7 @@ void PreferencesDialog::on_okBtn_clicked()
 		pPref->setPreferredLanguage( sPreferredLanguage );
 	}
 
+	pPref->publishRealtimeConfig();
 	pPref->savePreferences();
 
 
@@ -702,6 +716,11 @@ void PreferencesDialog::updateDriverInfo()
 	bPulseAudio_support = true;
 #endif
 
+	bool bPipeWire_support = false;
+#ifdef H2CORE_HAVE_PIPEWIRE
+	bPipeWire_support = true;
+#endif
+
 	if ( driverComboBox->currentText() == "Auto" ) {
 		info += tr("Automatic driver selection");
 		
@@ -831,8 +850,8 @@ void PreferencesDialog::updateDriverInfo()
 				.append( tr( "Not compiled" ) )
 				.append( "</font></b>" );
 		}
-		m_pAudioDeviceTxt->setEnabled(false);
-		m_pAudioDeviceTxt->setText( "" );
+		m_pAudioDeviceTxt->setEnabled(true);
+		m_pAudioDeviceTxt->setText( pPref->m_sPortAudioDevice );
 		bufferSizeSpinBox->setEnabled(true);
 		sampleRateComboBox->setEnabled(true);
 		trackOutputComboBox->hide();
@@ -885,6 +904,27 @@ void PreferencesDialog::updateDriverInfo()
 		jackBBTSyncComboBox->hide();
 		jackBBTSyncLbl->hide();
 	}
+	else if ( driverComboBox->currentText() == "PipeWire" ) {
+		info.append( "<b>" ).append( tr( "PipeWire Driver" ) )
+			.append( "</b><br>" );
+		if ( !bPipeWire_support ) {
+			info += QString("<br><b><font color=")
+				.append( m_sColorRed ).append( ">")
+				.append( tr( "Not compiled" ) )
+				.append( "</font></b>" );
+		}
+		m_pAudioDeviceTxt->setEnabled(false);
+		m_pAudioDeviceTxt->setText("");
+		bufferSizeSpinBox->setEnabled(true);
+		sampleRateComboBox->setEnabled(true);
+		trackOutputComboBox->hide();
+		trackOutputLbl->hide();
+		connectDefaultsCheckBox->hide();
+		enableTimebaseCheckBox->hide();
+		trackOutsCheckBox->hide();
+		jackBBTSyncComboBox->hide();
+		jackBBTSyncLbl->hide();
+	}
 	else {
 		QString selectedDriver = driverComboBox->currentText();
 		ERRORLOG( "Unknown driver = " + selectedDriver );
@@ -947,6 +987,7 @@ void PreferencesDialog::on_restartDriverBtn_clicked()
 {
 	updateDriverPreferences();
 	Preferences *pPref = Preferences::get_instance();
+	pPref->publishRealtimeConfig();
 	pPref->savePreferences();
 	Hydrogen::get_instance()->restartDrivers();
 	m_bNeedDriverRestart = false;
@@ -1052,6 +1093,9 @@ void PreferencesDialog::on_resampleComboBox_currentIndexChanged ( int index )
 	case 4:
 		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Interpolation::InterpolateMode::Hermite );
 		break;
+	case 5:
+		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Interpolation::InterpolateMode::Sinc );
+		break;
 	}
 
 }
@@ -1064,6 +1108,7 @@ void PreferencesDialog::onMidiDriverComboBoxIndexChanged ( int index )
 void PreferencesDialog::toggleTrackOutsCheckBox(bool toggled)
 {
 	Preferences::get_instance()->m_bJackTrackOuts = toggled;
+	Preferences::get_instance()->publishRealtimeConfig();
 	m_bNeedDriverRestart = true;
 }
 
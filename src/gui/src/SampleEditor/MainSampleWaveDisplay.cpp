@@ -23,6 +23,8 @@
 #include <core/Basics/Sample.h>
 #include <core/Basics/Song.h>
 #include <core/Basics/Instrument.h>
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/SamplePeaks.h>
 #include "HydrogenApp.h"
 #include "SampleEditor.h"
 using namespace H2Core;
@@ -30,6 +32,8 @@ using namespace H2Core;
 #include "MainSampleWaveDisplay.h"
 #include "../Skin.h"
 
+#include <vector>
+
 const char* MainSampleWaveDisplay::__class_name = "MainSampleWaveDisplay";
 
 MainSampleWaveDisplay::MainSampleWaveDisplay(QWidget* pParent)
@@ -168,6 +172,24 @@ void MainSampleWaveDisplay::updateDisplay( const QString& filename )
 
 		float fGain = height() / 4.0 * 1.0;
 
+		auto pPeaks = SamplePeakBuilder::build( pNewSample );
+		double fScale = pPeaks != nullptr && nSampleLength > 0 ?
+			pPeaks->get_frames() / static_cast<double>( nSampleLength ) : 1;
+		std::vector<float> min_l( width() ), max_l( width() ), min_r( width() ), max_r( width() );
+		if ( pPeaks != nullptr &&
+			 pPeaks->get_peaks( 0, 0, nScaleFactor * fScale, width(), min_l.data(), max_l.data() ) &&
+			 pPeaks->get_peaks( 1, 0, nScaleFactor * fScale, width(), min_r.data(), max_r.data() ) ) {
+			// Trace the extremum of larger magnitude of each pixel.
+			for ( int i = 0; i < width(); ++i ){
+				m_pPeakDatal[ i ] = static_cast<int>(
+					( max_l[ i ] >= -min_l[ i ] ? max_l[ i ] : min_l[ i ] ) * fGain );
+				m_pPeakDatar[ i ] = static_cast<int>(
+					( max_r[ i ] >= -min_r[ i ] ? max_r[ i ] : min_r[ i ] ) * fGain );
+			}
+			update();
+			return;
+		}
+
 		auto pSampleDatal = pNewSample->get_data_l();
 		auto pSampleDatar = pNewSample->get_data_r();
 
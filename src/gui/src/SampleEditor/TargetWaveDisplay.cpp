@@ -24,6 +24,8 @@
 #include <core/Basics/Song.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/SamplePeakBuilder.h>
+#include <core/Basics/SamplePeaks.h>
 
 #include <memory>
 
@@ -200,8 +202,39 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = (height() - 8) / 2.0 * pLayer->get_gain();
 
+		auto pPeaks = SamplePeakBuilder::build( pLayer->get_sample() );
+		// Samples resampled at load time are summarized at the rate
+		// of their file.
+		double fScale = pPeaks != nullptr && nSampleLength > 0 ?
+			pPeaks->get_frames() / static_cast<double>( nSampleLength ) : 1;
+		std::vector<float> min_L( width() ), max_L( width() ), min_R( width() ), max_R( width() );
+		if ( pPeaks != nullptr &&
+			 pPeaks->get_peaks( 0, 0, nScaleFactor * fScale, width(), min_L.data(), max_L.data() ) &&
+			 pPeaks->get_peaks( 1, 0, nScaleFactor * fScale, width(), min_R.data(), max_R.data() ) ) {
+			for ( int i = 0; i < width(); ++i ){
+				m_pPeakData_Left[ i ] = static_cast<int>( std::max( max_L[ i ], -min_L[ i ] ) * fGain );
+				m_pPeakData_Right[ i ] = static_cast<int>( std::max( max_R[ i ], -min_R[ i ] ) * -fGain );
+			}
+			update();
+			return;
+		}
+
 		auto pSampleDatal = pLayer->get_sample()->get_data_l();
 		auto pSampleDatar = pLayer->get_sample()->get_data_r();
+		// Only the head of a streamed sample is held in memory.
+		int nResidentFrames = pLayer->get_sample()->get_resident_frames();
+		// Compactly stored and deferred samples are converted for
+		// display.
+		std::vector<float> compactData_L, compactData_R;
+		if ( pLayer->get_sample()->is_compact() || pLayer->get_sample()->is_deferred() ) {
+			compactData_L.resize( nSampleLength );
+			compactData_R.resize( nSampleLength );
+			pLayer->get_sample()->read_frames( 0, nSampleLength,
+											   compactData_L.data(), compactData_R.data() );
+			pSampleDatal = compactData_L.data();
+			pSampleDatar = compactData_R.data();
+			nResidentFrames = nSampleLength;
+		}
 		int nSamplePos = 0;
 		int nVall;
 		int nValr;
@@ -209,7 +242,7 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 			nVall = 0;
 			nValr = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
+				if ( j < nSampleLength && nSamplePos < nResidentFrames ) {
 					if ( pSampleDatal[ nSamplePos ] < 0 ){
 						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * -fGain );
 						nVall = newVal;
@@ -30,6 +30,8 @@
 #include <core/Basics/Pattern.h>
 using namespace H2Core;
 
+#include <algorithm>
+
 
 #include "../Skin.h"
 #include "../HydrogenApp.h"
@@ -112,6 +114,9 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 		
 		auto	pSampleData = pLayer->get_sample()->get_data_l();
 		int		nSampleLength = m_pLayer->get_sample()->get_frames();
+		// The track is streamed. Until its peaks are ready only the
+		// head held in memory can be shown.
+		int		nResidentFrames = m_pLayer->get_sample()->get_resident_frames();
 		float	fLengthOfPlaybackTrackInSecs = ( float )( nSampleLength / (float) m_pLayer->get_sample()->get_sample_rate() );
 		float	fRemainingLengthOfPlaybackTrack = fLengthOfPlaybackTrackInSecs;		
 		float	fGain = height() / 2.0 * pLayer->get_gain();
@@ -159,24 +164,31 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 				int nSamplesToRender = nScaleFactor * nSampleLength;
 				
 				int nVal = 0;
+				int nSamplesToRenderInThisStep =  (nSamplesToRender / nSongEditorGridWith);
+				int nPixels = std::min( nSongEditorGridWith, m_nCurrentWidth - nRenderStartPosition );
 				
-				for ( int i = nRenderStartPosition; i < nRenderStartPosition + nSongEditorGridWith ; ++i ) {
-					if( i < m_nCurrentWidth ) {
-						nVal = 0;
+				if ( nPixels > 0 &&
+					 readPeaks( pLayer->get_sample(), nSamplePos, nSamplesToRenderInThisStep,
+								nRenderStartPosition, nPixels, fGain ) ) {
+					nSamplePos += nPixels * nSamplesToRenderInThisStep;
+				} else {
+					for ( int i = nRenderStartPosition; i < nRenderStartPosition + nSongEditorGridWith ; ++i ) {
+						if( i < m_nCurrentWidth ) {
+							nVal = 0;
 						
-						int nSamplesToRenderInThisStep =  (nSamplesToRender / nSongEditorGridWith);
-						for ( int j = 0; j < nSamplesToRenderInThisStep; ++j ) {
-							if ( nSamplePos < nSampleLength ) {
-								int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
-								if ( newVal > nVal ) {
-									nVal = newVal;
+							for ( int j = 0; j < nSamplesToRenderInThisStep; ++j ) {
+								if ( nSamplePos < nSampleLength && nSamplePos < nResidentFrames ) {
+									int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
+									if ( newVal > nVal ) {
+										nVal = newVal;
+									}
 								}
-							}
 							
-							++nSamplePos;
-						}
+								++nSamplePos;
+							}
 					
-						m_pPeakData[ i ] = nVal;
+							m_pPeakData[ i ] = nVal;
+						}
 					}
 				}
 				
@@ -192,6 +204,6 @@ void PlaybackTrackWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 		
 	}
 
-	update();
+	invalidateWaveform();
 }
 
@@ -22,6 +22,7 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <limits>
 #include <memory>
 
 #include <core/Basics/Song.h>
@@ -78,6 +79,7 @@ SongEditor::SongEditor( QWidget *parent, QScrollArea *pScrollView, SongEditorPan
  : QWidget( parent )
  , Object( __class_name )
  , m_bSequenceChanged( true )
+ , m_bSelectionChanged( false )
  , m_pScrollView( pScrollView )
  , m_pSongEditorPanel( pSongEditorPanel )
  , m_selection( this )
@@ -819,9 +821,9 @@ void SongEditor::updateWidget() {
 		}
 	} else if ( m_selection.isLasso() ) {
 		// Selection must redraw the pattern when a cell boundary is crossed, as the selected cells are
-		// drawn when drawing the pattern.
+		// drawn when drawing the pattern. The cells themselves did not change.
 		if ( bCellBoundaryCrossed ) {
-			m_bSequenceChanged = true;
+			m_bSelectionChanged = true;
 		}
 		update();
 	} else {
@@ -839,11 +841,64 @@ void SongEditor::paintEvent( QPaintEvent *ev )
 	// ridisegno tutto solo se sono cambiate le note
 	if (m_bSequenceChanged) {
 		m_bSequenceChanged = false;
-		drawSequence();
+		m_bSelectionChanged = false;
+		updateGridCells();
+		m_tiles.clear();
+	} else if ( m_bSelectionChanged ) {
+		m_bSelectionChanged = false;
+		m_tiles.clear();
 	}
 
 	QPainter painter(this);
-	painter.drawPixmap( ev->rect(), *m_pSequencePixmap, ev->rect() );
+
+	// Render missing tiles covered by the area to repaint and copy
+	// them to the screen.
+	const QRect dirtyRect = ev->rect();
+	qreal pixelRatio = devicePixelRatio();
+	for ( int nTileY = dirtyRect.top() / m_nTileSize;
+		  nTileY <= dirtyRect.bottom() / m_nTileSize; ++nTileY ) {
+		for ( int nTileX = dirtyRect.left() / m_nTileSize;
+			  nTileX <= dirtyRect.right() / m_nTileSize; ++nTileX ) {
+			QRect tileRect( nTileX * m_nTileSize, nTileY * m_nTileSize,
+							m_nTileSize, m_nTileSize );
+
+			auto it = m_tiles.find( QPoint( nTileX, nTileY ) );
+			if ( it != m_tiles.end() && it->second.devicePixelRatio() != pixelRatio ) {
+				// The widget was moved to a screen of different resolution.
+				m_tiles.erase( it );
+				it = m_tiles.end();
+			}
+			if ( it == m_tiles.end() ) {
+				QPixmap tile( m_nTileSize * pixelRatio, m_nTileSize * pixelRatio );
+				tile.setDevicePixelRatio( pixelRatio );
+				drawTile( &tile, tileRect );
+				it = m_tiles.insert( std::make_pair( QPoint( nTileX, nTileY ), tile ) ).first;
+			}
+
+			QRect targetRect = tileRect.intersected( dirtyRect );
+			QRect tileSrcRect = targetRect.translated( -tileRect.topLeft() );
+			QRectF srcRect(
+					pixelRatio * tileSrcRect.x(),
+					pixelRatio * tileSrcRect.y(),
+					pixelRatio * tileSrcRect.width(),
+					pixelRatio * tileSrcRect.height()
+			);
+			painter.drawPixmap( targetRect, it->second, srcRect );
+		}
+	}
+
+	// Drop tiles which were scrolled out of view.
+	const QRect keepRect = visibleRegion().boundingRect()
+		.adjusted( -m_nTileSize, -m_nTileSize, m_nTileSize, m_nTileSize );
+	for ( auto it = m_tiles.begin(); it != m_tiles.end(); ) {
+		QRect tileRect( it->first.x() * m_nTileSize, it->first.y() * m_nTileSize,
+						m_nTileSize, m_nTileSize );
+		if ( ! tileRect.intersects( keepRect ) ) {
+			it = m_tiles.erase( it );
+		} else {
+			++it;
+		}
+	}
 
 	// Draw moving selected cells
 	QColor patternColor( 0, 0, 0 );
@@ -879,50 +934,47 @@ void SongEditor::paintEvent( QPaintEvent *ev )
 
 void SongEditor::createBackground()
 {
-	UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
-	QColor backgroundColor( pStyle->m_songEditor_backgroundColor.getRed(), pStyle->m_songEditor_backgroundColor.getGreen(), pStyle->m_songEditor_backgroundColor.getBlue() );
-	QColor alternateRowColor( pStyle->m_songEditor_alternateRowColor.getRed(), pStyle->m_songEditor_alternateRowColor.getGreen(), pStyle->m_songEditor_alternateRowColor.getBlue() );
-	QColor linesColor( pStyle->m_songEditor_lineColor.getRed(), pStyle->m_songEditor_lineColor.getGreen(), pStyle->m_songEditor_lineColor.getBlue() );
-
 	Hydrogen *pHydrogen = Hydrogen::get_instance();
 	Song *pSong = pHydrogen->getSong();
 
 	uint nPatterns = pSong->getPatternList()->size();
 
-	static int nOldHeight = -1;
 	int nNewHeight = m_nGridHeight * nPatterns;
+	if (nNewHeight == 0) {
+		nNewHeight = 1;	// the widget should not be empty
+	}
 
-	if (nOldHeight != nNewHeight) {
-		// cambiamento di dimensioni...
-		if (nNewHeight == 0) {
-			nNewHeight = 1;	// the pixmap should not be empty
-		}
-
-		m_pBackgroundPixmap = new QPixmap( width(), nNewHeight );	// initialize the pixmap
-		m_pSequencePixmap = new QPixmap( width(), nNewHeight );	// initialize the pixmap
+	if ( nNewHeight != height() ) {
 		this->resize( QSize( width(), nNewHeight ) );
 	}
 
-	m_pBackgroundPixmap->fill( alternateRowColor );
+	m_bSequenceChanged = true;
+}
 
-	QPainter p( m_pBackgroundPixmap );
-	p.setPen( linesColor );
+void SongEditor::drawBackground( QPainter &p, const QRect& rect )
+{
+	UIStyle *pStyle = Preferences::get_instance()->getDefaultUIStyle();
+	QColor backgroundColor( pStyle->m_songEditor_backgroundColor.getRed(), pStyle->m_songEditor_backgroundColor.getGreen(), pStyle->m_songEditor_backgroundColor.getBlue() );
+	QColor alternateRowColor( pStyle->m_songEditor_alternateRowColor.getRed(), pStyle->m_songEditor_alternateRowColor.getGreen(), pStyle->m_songEditor_alternateRowColor.getBlue() );
+	QColor linesColor( pStyle->m_songEditor_lineColor.getRed(), pStyle->m_songEditor_lineColor.getGreen(), pStyle->m_songEditor_lineColor.getBlue() );
+
+	uint nPatterns = Hydrogen::get_instance()->getSong()->getPatternList()->size();
+	int nGridRight = m_nMaxPatternSequence * m_nGridWidth;
+
+	p.fillRect( rect, alternateRowColor );
+
+	// Only the rows and columns intersecting rect are painted.
+	uint nFirstColumn = std::max( 0, ( rect.left() - m_nMargin ) / (int)m_nGridWidth - 1 );
+	uint nLastColumn = std::min( m_nMaxPatternSequence,
+								 (uint)std::max( 0, ( rect.right() - m_nMargin ) / (int)m_nGridWidth + 1 ) );
+	uint nFirstRow = std::max( 0, rect.top() / (int)m_nGridHeight );
+	uint nLastRow = std::min( nPatterns, (uint)( rect.bottom() / (int)m_nGridHeight + 1 ) );
 
-/*	// sfondo per celle scure (alternato)
-	for (uint i = 0; i < nPatterns; i++) {
-		if ( ( i % 2) != 0) {
-			uint y = m_nGridHeight * i;
-			p.fillRect ( 0, y, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
-			p.fillRect ( 0, y + 2, m_nMaxPatternSequence * m_nGridWidth, m_nGridHeight - 4, alternateRowColor );
-			p.fillRect ( 0, y + m_nGridHeight - 2, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
-		}
-	}
-*/
 	// celle...
 	p.setPen( linesColor );
 
 	// vertical lines
-	for (uint i = 0; i < m_nMaxPatternSequence + 1; i++) {
+	for (uint i = nFirstColumn; i <= nLastColumn; i++) {
 		uint x = m_nMargin + i * m_nGridWidth;
 		int x1 = x;
 		int x2 = x + m_nGridWidth;
@@ -933,34 +985,31 @@ void SongEditor::createBackground()
 
 	p.setPen( linesColor );
 	// horizontal lines
-	for (uint i = 0; i < nPatterns; i++) {
+	for (uint i = nFirstRow; i < nLastRow; i++) {
 		uint y = m_nGridHeight * i;
 
 		int y1 = y + 2;
 		int y2 = y + m_nGridHeight - 2;
 
-		p.drawLine( 0, y1, (m_nMaxPatternSequence * m_nGridWidth), y1 );
-		p.drawLine( 0, y2, (m_nMaxPatternSequence * m_nGridWidth), y2 );
+		p.drawLine( 0, y1, nGridRight, y1 );
+		p.drawLine( 0, y2, nGridRight, y2 );
 	}
 
 
 	p.setPen( backgroundColor );
 	// horizontal lines (erase..)
-	for (uint i = 0; i < nPatterns + 1; i++) {
+	for (uint i = nFirstRow; i <= nLastRow; i++) {
 		uint y = m_nGridHeight * i;
 
-		p.fillRect( 0, y, m_nMaxPatternSequence * m_nGridWidth, 2, backgroundColor );
-		p.drawLine( 0, y + m_nGridHeight - 1, m_nMaxPatternSequence * m_nGridWidth, y + m_nGridHeight - 1 );
+		p.fillRect( 0, y, nGridRight, 2, backgroundColor );
+		p.drawLine( 0, y + m_nGridHeight - 1, nGridRight, y + m_nGridHeight - 1 );
 	}
-
 	//~ celle
-	m_bSequenceChanged = true;
 }
 
 void SongEditor::cleanUp(){
 
-	delete m_pBackgroundPixmap;
-	delete m_pSequencePixmap;
+	m_tiles.clear();
 }
 
 // Update the GridCell representation.
@@ -1009,33 +1058,29 @@ QPoint SongEditor::movingGridOffset( ) const {
 }
 
 
-void SongEditor::drawSequence()
+void SongEditor::drawTile( QPixmap *pTile, const QRect& rect )
 {
-	QPainter p;
-	p.begin( m_pSequencePixmap );
-	p.drawPixmap( rect(), *m_pBackgroundPixmap, rect() );
-	p.end();
+	QPainter p( pTile );
+	p.translate( -rect.topLeft() );
+	p.setClipRect( rect );
 
-	Song* song = Hydrogen::get_instance()->getSong();
-	PatternList *patList = song->getPatternList();
-	std::vector<PatternList*>* pColumns = song->getPatternGroupVector();
-	uint listLength = patList->size();
-
-	updateGridCells();
+	drawBackground( p, rect );
 
 	// Draw using GridCells representation
 	for ( auto it : m_gridCells ) {
-		drawPattern( it.first.x(), it.first.y(), it.second.m_bDrawnVirtual, it.second.m_fWidth );
+		QRect cellRect( columnRowToXy( it.first ), QSize( m_nGridWidth, m_nGridHeight ) );
+		if ( cellRect.intersects( rect ) ) {
+			drawPattern( p, it.first.x(), it.first.y(), it.second.m_bDrawnVirtual, it.second.m_fWidth );
+		}
 	}
 }
 
 
 
-void SongEditor::drawPattern( int pos, int number, bool invertColour, double width )
+void SongEditor::drawPattern( QPainter &p, int pos, int number, bool invertColour, double width )
 {
 	Preferences *pref = Preferences::get_instance();
 	UIStyle *pStyle = pref->getDefaultUIStyle();
-	QPainter p( m_pSequencePixmap );
 	QColor patternColor( pStyle->m_songEditor_pattern1Color.getRed(), pStyle->m_songEditor_pattern1Color.getGreen(), pStyle->m_songEditor_pattern1Color.getBlue() );
 
 	/*
@@ -1111,11 +1156,20 @@ void SongEditor::drawPattern( int pos, int number, bool invertColour, double wid
 std::vector<SongEditor::SelectionIndex> SongEditor::elementsIntersecting( QRect r )
 {
 	std::vector<SelectionIndex> elems;
-	for ( auto it : m_gridCells ) {
-		if ( r.intersects( QRect( columnRowToXy( it.first ),
+
+	// m_gridCells is ordered by column first. Only the columns
+	// covered by r (plus one on either side to account for rounding)
+	// have to be visited.
+	r = r.normalized();
+	int nFirstColumn = ( r.left() - m_nMargin ) / (int)m_nGridWidth - 1;
+	int nLastColumn = ( r.right() - m_nMargin ) / (int)m_nGridWidth + 1;
+
+	for ( auto it = m_gridCells.lower_bound( QPoint( nFirstColumn, std::numeric_limits<int>::min() ) );
+		  it != m_gridCells.end() && it->first.x() <= nLastColumn; ++it ) {
+		if ( r.intersects( QRect( columnRowToXy( it->first ),
 								  QSize( m_nGridWidth, m_nGridHeight) ) ) ) {
-			if ( ! it.second.m_bDrawnVirtual ) {
-				elems.push_back( it.first );
+			if ( ! it->second.m_bDrawnVirtual ) {
+				elems.push_back( it->first );
 			}
 		}
 	}
@@ -1439,28 +1493,20 @@ void SongEditorPatternList::createBackground()
 
 	std::unique_ptr<PatternDisplayInfo[]> PatternArray{new PatternDisplayInfo[nPatterns]};
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-	PatternList *pCurrentPatternList = pHydrogen->getCurrentPatternList();
+	std::vector<const Pattern*> playingPatterns, nextPatterns;
+	pHydrogen->getPlaybackPatterns( &playingPatterns, &nextPatterns );
 	
 	//assemble the data..
 	for ( int i = 0; i < nPatterns; i++ ) {
 		H2Core::Pattern *pPattern = pSong->getPatternList()->get(i);
 
-		if ( pCurrentPatternList->index( pPattern ) != -1 ) {
-			PatternArray[i].bActive = true;
-		} else {
-			PatternArray[i].bActive = false;
-		}
-
-		if ( pHydrogen->getNextPatterns()->index( pPattern ) != -1 ) {
-			PatternArray[i].bNext = true;
-		} else {
-			PatternArray[i].bNext = false;
-		}
+		PatternArray[i].bActive = std::find( playingPatterns.begin(), playingPatterns.end(),
+											 pPattern ) != playingPatterns.end();
+		PatternArray[i].bNext = std::find( nextPatterns.begin(), nextPatterns.end(),
+										   pPattern ) != nextPatterns.end();
 
 		PatternArray[i].sPatternName = pPattern->get_name();
 	}
-	AudioEngine::get_instance()->unlock();
 
 	/// paint the foreground (pattern name etc.)
 	for ( int i = 0; i < nPatterns; i++ ) {
@@ -2118,6 +2164,7 @@ const char* SongEditorPositionRuler::__class_name = "SongEditorPositionRuler";
 SongEditorPositionRuler::SongEditorPositionRuler( QWidget *parent )
  : QWidget( parent )
  , Object( __class_name )
+ , m_fPlayheadPos( -1 )
  , m_bRightBtnPressed( false )
 {
 	setAttribute(Qt::WA_OpaquePaintEvent);
@@ -2149,12 +2196,18 @@ SongEditorPositionRuler::SongEditorPositionRuler( QWidget *parent )
 	m_pTimer = new QTimer(this);
 	connect(m_pTimer, SIGNAL(timeout()), this, SLOT(updatePosition()));
 	m_pTimer->start(200);
+
+	m_pPlayheadTimer = new QTimer(this);
+	m_pPlayheadTimer->setTimerType( Qt::PreciseTimer );
+	connect(m_pPlayheadTimer, SIGNAL(timeout()), this, SLOT(updatePlayhead()));
+	m_pPlayheadTimer->start(16);	// move the playhead at 60 fps
 }
 
 
 
 SongEditorPositionRuler::~SongEditorPositionRuler() {
 	m_pTimer->stop();
+	m_pPlayheadTimer->stop();
 }
 
 
@@ -2232,7 +2285,9 @@ void SongEditorPositionRuler::createBackground()
 		p.drawLine( x, 19, x, 20 );
 		for ( int t = 0; t < static_cast<int>(tempoMarkerVector.size()); t++){
 			if ( tempoMarkerVector[t]->nBar == i ) {
-				sprintf( tempo, "%d",  ((int)tempoMarkerVector[t]->fBpm) );
+				// Ramps are marked by a leading tilde.
+				sprintf( tempo, tempoMarkerVector[t]->bRamp ? "~%d" : "%d",
+						 ((int)tempoMarkerVector[t]->fBpm) );
 				p.drawText( x - m_nGridWidth, 3, m_nGridWidth * 2, height() / 2 - 5, Qt::AlignCenter, tempo );
 			}
 		}
@@ -2244,6 +2299,7 @@ void SongEditorPositionRuler::createBackground()
 	p.fillRect ( 0, height() - 27, width(), 1, QColor(35, 39, 51) );
 	p.fillRect ( 0, height() - 3, width(), 2, alternateRowColor );
 
+	update();
 }
 
 
@@ -2355,30 +2411,16 @@ void SongEditorPositionRuler::paintEvent( QPaintEvent *ev )
 
 	Hydrogen *pHydrogen = Hydrogen::get_instance();
 
-	float fPos = pHydrogen->getPatternPos();
+	float fPos = m_fPlayheadPos;
 	int pIPos = Preferences::get_instance()->getPunchInPos();
 	int pOPos = Preferences::get_instance()->getPunchOutPos();
 
-	AudioEngine *pAudioEngine = AudioEngine::get_instance();
-	pAudioEngine->lock( RIGHT_HERE );
-
-	if ( pHydrogen->getCurrentPatternList()->size() != 0 ) {
-		int nLength = pHydrogen->getCurrentPatternList()->longest_pattern_length();
-		fPos += (float)pHydrogen->getTickPosition() / (float)nLength;
-	}
-	else {
-		// nessun pattern, uso la grandezza di default
-		fPos += (float)pHydrogen->getTickPosition() / (float)MAX_NOTES;
-	}
-
 	if ( pHydrogen->getSong()->getMode() == Song::PATTERN_MODE ) {
 		fPos = -1;
 		pIPos = 0;
 		pOPos = -1;
 	}
 
-	pAudioEngine->unlock();
-
 	QPainter painter(this);
 	qreal pixelRatio = devicePixelRatio();
 	QRectF srcRect(
@@ -2412,16 +2454,57 @@ void SongEditorPositionRuler::paintEvent( QPaintEvent *ev )
 void SongEditorPositionRuler::updatePosition()
 {
 	HydrogenApp::get_instance()->getSongEditorPanel()->updateTimelineUsage();
-	update();
 }
 
 
-void SongEditorPositionRuler::editTimeLineAction( int nNewPosition, float fNewBpm )
+
+void SongEditorPositionRuler::updatePlayhead()
+{
+	if ( !isVisible() ) {
+		return;
+	}
+
+	Hydrogen *pHydrogen = Hydrogen::get_instance();
+	float fPos = -1;
+	int nColumn, nLength;
+	double fTick;
+	if ( pHydrogen->getSong()->getMode() == Song::SONG_MODE &&
+		 pHydrogen->getPlayheadPosition( &nColumn, &fTick, &nLength ) && nLength > 0 ) {
+		fPos = nColumn + static_cast<float>( fTick / nLength );
+	}
+
+	QRect oldRect = playheadRect( m_fPlayheadPos );
+	QRect newRect = playheadRect( fPos );
+	if ( oldRect == newRect ) {
+		return;
+	}
+	m_fPlayheadPos = fPos;
+	if ( oldRect.isValid() ) {
+		update( oldRect );
+	}
+	if ( newRect.isValid() ) {
+		update( newRect );
+	}
+}
+
+
+
+QRect SongEditorPositionRuler::playheadRect( float fPos ) const
+{
+	if ( fPos == -1 ) {
+		return QRect();
+	}
+	int x = (int)( m_nMargin + fPos * m_nGridWidth - 11 / 2 );
+	return QRect( x, 0, 11, height() );
+}
+
+
+void SongEditorPositionRuler::editTimeLineAction( int nNewPosition, float fNewBpm, bool bRamp )
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 
 	pHydrogen->getTimeline()->deleteTempoMarker( nNewPosition - 1 );
-	pHydrogen->getTimeline()->addTempoMarker( nNewPosition - 1, fNewBpm );
+	pHydrogen->getTimeline()->addTempoMarker( nNewPosition - 1, fNewBpm, bRamp );
 	createBackground();
 }
 
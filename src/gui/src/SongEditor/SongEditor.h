@@ -23,6 +23,7 @@
 #ifndef SONG_EDITOR_H
 #define SONG_EDITOR_H
 
+#include <map>
 #include <vector>
 
 #include <unistd.h>
@@ -118,21 +119,25 @@ class SongEditor : public QWidget, public H2Core::Object, public SelectionWidget
 
 		//! Pattern sequence or selection has changed, so must be redrawn.
 		bool m_bSequenceChanged;
+		//! Only the selection has changed. The cached tiles have to be redrawn but #m_gridCells is still
+		//! valid.
+		bool m_bSelectionChanged;
 
 		//! In "draw" mode, whether we're activating pattern cells ("drawing") or deactivating ("erasing") is
 		//! set at the start of the draw gesture.
 		bool m_bDrawingActiveCell;
 
-		//! @name Background pixmap caching
+		//! @name Sequence tile caching
 		//!
-		//! To make painting the song editor sequence grid more efficient, the drawing uses multiple levels of lazy painting.
-		//!   * The grid background pixmap is only updated when the size of the pattern grid changes.
-		//!   * The sequence pixmap are only updated when cells are added/removed or selections change
-		//!       * the cached grid background pixmap is used when repainting the pattern
-		//!   * selections and moving cells are painted on top of the cached sequence pixmap
+		//! To make painting the song editor sequence grid more efficient without holding a pixmap of the
+		//! whole song, the grid is split into tiles of #m_nTileSize pixels which are painted lazily.
+		//!   * Only tiles intersecting the visible part of the widget are rendered and cached. Tiles scrolled
+		//!     out of view by more than one tile are dropped again.
+		//!   * All tiles are discarded when cells are added/removed, selections change, or the grid is resized.
+		//!   * selections and moving cells are painted on top of the cached tiles
 		//! @{
-		QPixmap *m_pBackgroundPixmap;
-		QPixmap *m_pSequencePixmap;
+		std::map< QPoint, QPixmap > m_tiles;
+		static const int m_nTileSize = 256;
 		//! @}
 
 		const int m_nMargin = 10;
@@ -181,9 +186,12 @@ class SongEditor : public QWidget, public H2Core::Object, public SelectionWidget
 		bool togglePatternActive( int nColumn, int nRow );
 		void setPatternActive( int nColumn, int nRow, bool value );
 
-		void drawSequence();
-  
-		void drawPattern( int pos, int number, bool invertColour, double width );
+		//! Renders the grid background and patterns within @a rect into @a pTile.
+		void drawTile( QPixmap *pTile, const QRect& rect );
+		//! Paints the grid lines and the alternating row background within @a rect.
+		void drawBackground( QPainter &p, const QRect& rect );
+
+		void drawPattern( QPainter &p, int pos, int number, bool invertColour, double width );
 
 		std::map< QPoint, GridCell > m_gridCells;
 		void updateGridCells();
@@ -313,18 +321,26 @@ class SongEditorPositionRuler : public QWidget, public H2Core::Object
 
 		uint getGridWidth();
 		void setGridWidth (uint width);
-		void editTimeLineAction( int newPosition, float newBpm );
+		void editTimeLineAction( int newPosition, float newBpm, bool bRamp = false );
 		void deleteTimeLinePosition( int position );
 		void editTagAction( QString text, int position, QString textToReplace );
 		void deleteTagAction( QString text, int position );
 
 	public slots:
 		void updatePosition();
+		/** Moves the playhead to the position extrapolated by
+			H2Core::Hydrogen::getPlayheadPosition(), repainting the
+			area it covers only.*/
+		void updatePlayhead();
 		void showTagWidget( int nColumn );
 		void showBpmWidget( int nColumn );
 
 	private:
 		QTimer *			m_pTimer;
+		QTimer *			m_pPlayheadTimer;
+		/** Position of the playhead in columns or -1 if it is
+			hidden.*/
+		float				m_fPlayheadPos;
 		uint				m_nGridWidth;
 		uint				m_nMaxPatternSequence;
 		uint				m_nInitialWidth;
@@ -340,6 +356,9 @@ class SongEditorPositionRuler : public QWidget, public H2Core::Object
 		virtual void mouseReleaseEvent(QMouseEvent *ev);
 		virtual void paintEvent( QPaintEvent *ev );
 
+		/** \return Area covered by the playhead at @a fPos.*/
+		QRect playheadRect( float fPos ) const;
+
 };
 
 
@@ -58,6 +58,7 @@ SongEditorPanelBpmWidget::SongEditorPanelBpmWidget( QWidget* pParent, int beat )
 		for ( int t = 0; t < tempoMarkers.size(); t++ ){
 			if ( tempoMarkers[t]->nBar == m_stimelineposition ) {
 				lineEditBpm->setText( QString("%1").arg( tempoMarkers[t]->fBpm ) );
+				rampCheckBox->setChecked( tempoMarkers[t]->bRamp );
 				deleteBtn->setEnabled ( true );
 				return;
 			}
@@ -110,17 +111,20 @@ void SongEditorPanelBpmWidget::on_okBtn_clicked()
 	auto tempoMarkerVector = pTimeline->getAllTempoMarkers();
 
 	float fOldBpm = -1.0;
+	bool bOldRamp = false;
 	//search for an old entry
 	if( tempoMarkerVector.size() >= 1 ){
 		for ( int t = 0; t < tempoMarkerVector.size(); t++){
 			if ( tempoMarkerVector[t]->nBar == ( QString( lineEditBeat->text() ).toInt() ) -1 ) {
 				fOldBpm = tempoMarkerVector[t]->fBpm;
+				bOldRamp = tempoMarkerVector[t]->bRamp;
 			}
 		}
 	}
 
 
-	SE_editTimeLineAction *action = new SE_editTimeLineAction( lineEditBeat->text().toInt(), fOldBpm, QString( lineEditBpm->text() ).toFloat() );
+	SE_editTimeLineAction *action = new SE_editTimeLineAction( lineEditBeat->text().toInt(), fOldBpm, QString( lineEditBpm->text() ).toFloat(),
+															   bOldRamp, rampCheckBox->isChecked() );
 	HydrogenApp::get_instance()->m_pUndoStack->push( action );
 	accept();
 }
@@ -133,16 +137,18 @@ void SongEditorPanelBpmWidget::on_deleteBtn_clicked()
 	auto tempoMarkerVector = pTimeline->getAllTempoMarkers();
 
 	float fOldBpm = -1.0;
+	bool bOldRamp = false;
 	//search for an old entry
 	if( tempoMarkerVector.size() >= 1 ){
 		for ( int t = 0; t < tempoMarkerVector.size(); t++){
 			if ( tempoMarkerVector[t]->nBar == ( QString( lineEditBeat->text() ).toInt() ) -1 ) {
 				fOldBpm = tempoMarkerVector[t]->fBpm;
+				bOldRamp = tempoMarkerVector[t]->bRamp;
 			}
 		}
 	}
 
-	SE_deleteTimeLineAction *action = new SE_deleteTimeLineAction( lineEditBeat->text().toInt(), fOldBpm );
+	SE_deleteTimeLineAction *action = new SE_deleteTimeLineAction( lineEditBeat->text().toInt(), fOldBpm, bOldRamp );
 	HydrogenApp::get_instance()->m_pUndoStack->push( action );
 	accept();
 }
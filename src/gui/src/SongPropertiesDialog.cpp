@@ -22,6 +22,7 @@
 
 #include "SongPropertiesDialog.h"
 #include "Skin.h"
+#include <core/config.h>
 #include <core/Basics/Song.h>
 #include <core/Hydrogen.h>
 
@@ -45,6 +46,12 @@ SongPropertiesDialog::SongPropertiesDialog(QWidget* parent)
 	authorTxt->setText( pSong->getAuthor() );
 	notesTxt->append( pSong->getNotes() );
 	licenseTxt->setText( pSong->getLicense() );
+	randomSeedSpinBox->setValue( pSong->getRandomSeed() );
+	playbackTrackBpmSpinBox->setValue( pSong->getPlaybackTrackBpm() );
+#ifndef H2CORE_HAVE_RUBBERBAND
+	// The track can only be stretched using the Rubber Band library.
+	playbackTrackBpmSpinBox->setEnabled( false );
+#endif
 }
 
 
@@ -67,6 +74,14 @@ void SongPropertiesDialog::on_okBtn_clicked()
 	pSong->setAuthor( authorTxt->text() );
 	pSong->setNotes( notesTxt->toPlainText() );
 	pSong->setLicense( licenseTxt->text() );
+	if ( pSong->getRandomSeed() != randomSeedSpinBox->value() ) {
+		pSong->setRandomSeed( randomSeedSpinBox->value() );
+		pSong->setIsModified( true );
+	}
+	if ( pSong->getPlaybackTrackBpm() != static_cast<float>( playbackTrackBpmSpinBox->value() ) ) {
+		pSong->setPlaybackTrackBpm( playbackTrackBpmSpinBox->value() );
+		pSong->setIsModified( true );
+	}
 
 	accept();
 }
@@ -10,6 +10,7 @@
 #include <core/H2Exception.h>
 #include <core/Preferences.h>
 #include <core/Basics/Drumkit.h>
+#include <core/Basics/PatternIndex.h>
 #include <core/Helpers/Filesystem.h>
 
 #include "SoundLibraryDatastructures.h"
@@ -83,22 +84,32 @@ void SoundLibraryDatabase::update()
 
 void SoundLibraryDatabase::updatePatterns()
 {
+	for ( auto pInfo : *patternVector ) {
+		delete pInfo;
+	}
 	patternVector->clear();
 	patternCategories = QStringList();
 
-	// search drumkit subdirectories within patterns user directory
-	foreach ( const QString& drumkit, Filesystem::pattern_drumkits() ) {
-		getPatternFromDirectory( Filesystem::patterns_dir( drumkit ), patternVector);
+	PatternIndex* pIndex = PatternIndex::get_instance();
+	if ( pIndex == nullptr ) {
+		ERRORLOG( "Pattern index not available" );
+		return;
 	}
-	// search patterns user directory
-	getPatternFromDirectory( Filesystem::patterns_dir(), patternVector);
-}
 
-void SoundLibraryDatabase::getPatternFromDirectory( const QString& sPatternDir, std::vector<SoundLibraryInfo*>* patternVector )
-{
-	foreach ( const QString& fName, Filesystem::pattern_list( sPatternDir ) ) {
-		QString sFile = sPatternDir + fName;
-		SoundLibraryInfo* slInfo = new SoundLibraryInfo( sFile );
+	// The caller might just have written or removed a pattern.
+	pIndex->invalidate();
+	for ( const auto& entry : pIndex->get_entries() ) {
+		if ( ! entry.bLoaded ) {
+			continue;
+		}
+		SoundLibraryInfo* slInfo = new SoundLibraryInfo();
+		slInfo->setType( "pattern" );
+		slInfo->setPath( entry.sPath );
+		slInfo->setName( entry.sName );
+		slInfo->setInfo( entry.sInfo.isEmpty() ? "No information available." : entry.sInfo );
+		slInfo->setCategory( entry.sCategory );
+		slInfo->setAuthor( entry.sAuthor.isEmpty() ? "undefined author" : entry.sAuthor );
+		slInfo->setLicense( entry.sLicense.isEmpty() ? "undefined license" : entry.sLicense );
 		patternVector->push_back( slInfo );
 		if ( !patternCategories.contains( slInfo->getCategory() ) ) {
 			patternCategories << slInfo->getCategory();
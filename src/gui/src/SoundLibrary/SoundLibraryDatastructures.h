@@ -35,7 +35,6 @@ class SoundLibraryDatabase:  public H2Core::Object
 		void update();
 		void updatePatterns();
 		void printPatterns();
-		void getPatternFromDirectory(const QString& path, soundLibraryInfoVector* );
 		bool isPatternInstalled( const QString& patternName);
 
 		static void create_instance();
@@ -105,6 +104,12 @@ class SoundLibraryInfo :  public H2Core::Object
 			return m_sImageLicense;
 		}
 
+		/** SHA-256 of the file at getUrl() as listed by the remote
+			repository. Empty if none is given.*/
+		QString getSha256() const {
+			return m_sSha256;
+		}
+
 		void setName( const QString& name ){
 			m_sName = name;
 		}
@@ -141,6 +146,10 @@ class SoundLibraryInfo :  public H2Core::Object
 			m_sImageLicense = imageLicense;
 		}
 
+		void setSha256( const QString& sSha256 ){
+			m_sSha256 = sSha256;
+		}
+
 		void setPath( const QString& path){
 			m_sPath = path;
 		}
@@ -160,6 +169,7 @@ class SoundLibraryInfo :  public H2Core::Object
 		QString m_sLicense;
 		QString m_sImage;
 		QString m_sImageLicense;
+		QString m_sSha256;
 		QString m_sPath;
 };
 
@@ -33,6 +33,7 @@
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/DrumkitComponent.h>
+#include <core/Helpers/Threads.h>
 
 #include <QFileDialog>
 #include <QtGui>
@@ -44,11 +45,88 @@
 #include <archive.h>
 #include <archive_entry.h>
 #include <fcntl.h>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <thread>
+#include <utility>
 #endif
 
 using namespace H2Core;
 
+#if defined(H2CORE_HAVE_LIBARCHIVE)
+/** Drumkit archive written by writeArchive().*/
+struct ArchiveJob {
+	/** Archive opened for writing by the dialog.*/
+	struct archive* pArchive = nullptr;
+	/** Path of each file and its name within the archive.*/
+	std::vector<std::pair<QString, QString>> files;
+	qint64 nTotalBytes = 0;
+	std::atomic<qint64> nBytesDone{ 0 };
+	/** Set by the dialog to stop writing.*/
+	std::atomic<bool> bCancel{ false };
+	/** Set once the archive was closed.*/
+	std::atomic<bool> bDone{ false };
+	bool bSuccess = false;
+};
+
+/** Compresses all files of @a pJob into its archive and closes
+	it. Runs in a background thread.*/
+static void writeArchive( ArchiveJob* pJob )
+{
+	Threads::configureCurrentThread( Threads::Role::Background, "drumkit export" );
+
+	struct archive* a = pJob->pArchive;
+	char buff[8192];
+	bool bSuccess = true;
+	for ( const auto& file : pJob->files ) {
+		if ( pJob->bCancel.load() ) {
+			bSuccess = false;
+			break;
+		}
+		FILE* f = fopen( file.first.toUtf8().constData(), "rb" );
+		if ( f == nullptr ) {
+			___ERRORLOG( QString( "Unable to open %1" ).arg( file.first ) );
+			bSuccess = false;
+			break;
+		}
+		struct archive_entry* entry = archive_entry_new();
+		archive_entry_set_pathname( entry, file.second.toUtf8().constData() );
+		archive_entry_set_size( entry, QFileInfo( file.first ).size() );
+		archive_entry_set_filetype( entry, AE_IFREG );
+		archive_entry_set_perm( entry, 0644 );
+		archive_write_header( a, entry );
+		size_t len = fread( buff, sizeof( char ), sizeof( buff ), f );
+		while ( len > 0 && ! pJob->bCancel.load() ) {
+			if ( archive_write_data( a, buff, len ) < 0 ) {
+				___ERRORLOG( QString( "archive_write_data() %1" ).arg( archive_error_string( a ) ) );
+				bSuccess = false;
+				break;
+			}
+			pJob->nBytesDone += len;
+			len = fread( buff, sizeof( char ), sizeof( buff ), f );
+		}
+		fclose( f );
+		archive_entry_free( entry );
+		if ( ! bSuccess ) {
+			break;
+		}
+	}
+	if ( archive_write_close( a ) != ARCHIVE_OK ) {
+		bSuccess = false;
+	}
+
+	#if ARCHIVE_VERSION_NUMBER < 3000000
+		archive_write_finish( a );
+	#else
+		archive_write_free( a );
+	#endif
+
+	pJob->bSuccess = bSuccess && ! pJob->bCancel.load();
+	pJob->bDone.store( true );
+}
+#endif
+
 const char* SoundLibraryExportDialog::__class_name = "SoundLibraryExportDialog";
 
 SoundLibraryExportDialog::SoundLibraryExportDialog( QWidget* pParent,  const QString& sSelectedKit, H2Core::Filesystem::Lookup lookup )
@@ -139,28 +217,7 @@ void SoundLibraryExportDialog::on_exportBtn_clicked()
 
 	QString outname = saveDir + "/" + drumkitName + ".h2drumkit";
 
-	struct archive *a;
-	struct archive_entry *entry;
-	struct stat st;
-	char buff[8192];
-	int len;
-	FILE *f;
-
-	a = archive_write_new();
-
-	#if ARCHIVE_VERSION_NUMBER < 3000000
-		archive_write_set_compression_gzip(a);
-	#else
-		archive_write_add_filter_gzip(a);
-	#endif
-
-	archive_write_set_format_pax_restricted(a);
-	int ret = archive_write_open_filename(a, outname.toUtf8().constData());
-	if ( ret != ARCHIVE_OK ) {
-		QMessageBox::critical( this, "Hydrogen", tr( "Couldn't create archive" )
-							   .append( QString( " [%0]" ).arg( outname ) ) );
-		return;
-	}
+	ArchiveJob job;
 	for (int i = 0; i < filesList.size(); i++) {
 		QString filename = fullDir + "/" + filesList.at(i);
 		QString targetFilename = drumkitName + "/" + filesList.at(i);
@@ -194,34 +251,65 @@ void SoundLibraryExportDialog::on_exportBtn_clicked()
 			}
 		}
 
-
-		stat(filename.toUtf8().constData(), &st);
-		entry = archive_entry_new();
-		archive_entry_set_pathname(entry, targetFilename.toUtf8().constData());
-		archive_entry_set_size(entry, st.st_size);
-		archive_entry_set_filetype(entry, AE_IFREG);
-		archive_entry_set_perm(entry, 0644);
-		archive_write_header(a, entry);
-		f = fopen(filename.toUtf8().constData(), "rb");
-		len = fread(buff, sizeof(char), sizeof(buff), f);
-		while ( len > 0 ) {
-				archive_write_data(a, buff, len);
-				len = fread(buff, sizeof(char), sizeof(buff), f);
-		}
-		fclose(f);
-		archive_entry_free(entry);
+		job.files.push_back( std::make_pair( filename, targetFilename ) );
+		job.nTotalBytes += QFileInfo( filename ).size();
 	}
-	archive_write_close(a);
+	filesList.clear();
+
+	job.pArchive = archive_write_new();
 
 	#if ARCHIVE_VERSION_NUMBER < 3000000
-		archive_write_finish(a);
+		archive_write_set_compression_gzip(job.pArchive);
 	#else
-		archive_write_free(a);
+		archive_write_add_filter_gzip(job.pArchive);
 	#endif
 
-	filesList.clear();
+	archive_write_set_format_pax_restricted(job.pArchive);
+	int ret = archive_write_open_filename(job.pArchive, outname.toUtf8().constData());
+	if ( ret != ARCHIVE_OK ) {
+		#if ARCHIVE_VERSION_NUMBER < 3000000
+			archive_write_finish(job.pArchive);
+		#else
+			archive_write_free(job.pArchive);
+		#endif
+		QApplication::restoreOverrideCursor();
+		QMessageBox::critical( this, "Hydrogen", tr( "Couldn't create archive" )
+							   .append( QString( " [%0]" ).arg( outname ) ) );
+		return;
+	}
 
+	// Compressing large kits takes a while. It is done in the
+	// background while the dialog shows the progress.
+	std::thread worker( &writeArchive, &job );
 	QApplication::restoreOverrideCursor();
+
+	QProgressDialog progress( tr( "Exporting drumkit..." ), tr( "Cancel" ), 0, 100, this );
+	progress.setWindowModality( Qt::WindowModal );
+	progress.setMinimumDuration( 500 );
+	while ( ! job.bDone.load() ) {
+		if ( progress.wasCanceled() ) {
+			job.bCancel.store( true );
+		}
+		if ( job.nTotalBytes > 0 ) {
+			progress.setValue( static_cast<int>( 100 * job.nBytesDone.load() / job.nTotalBytes ) );
+		}
+		QApplication::processEvents( QEventLoop::AllEvents, 50 );
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+	}
+	worker.join();
+	progress.reset();
+
+	if ( job.bCancel.load() ) {
+		QFile::remove( outname );
+		return;
+	}
+	if ( ! job.bSuccess ) {
+		QFile::remove( outname );
+		QMessageBox::critical( this, "Hydrogen", tr( "Couldn't create archive" )
+							   .append( QString( " [%0]" ).arg( outname ) ) );
+		return;
+	}
+
 	QMessageBox::information( this, "Hydrogen", tr("Drumkit exported.") );
 #elif !defined(WIN32)
 
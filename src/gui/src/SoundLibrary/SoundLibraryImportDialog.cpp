@@ -32,6 +32,7 @@
 #include <core/H2Exception.h>
 #include <core/Preferences.h>
 #include <core/Basics/Drumkit.h>
+#include <core/Basics/DrumkitInstaller.h>
 #include <core/Helpers/Filesystem.h>
 
 
@@ -41,7 +42,12 @@
 #include <QHeaderView>
 #include <QFileDialog>
 #include <QCryptographicHash>
+#include <QEventLoop>
+#include <QProgressDialog>
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <memory>
 
 const char* SoundLibraryImportDialog::__class_name = "SoundLibraryImportDialog";
@@ -63,6 +69,9 @@ SoundLibraryImportDialog::SoundLibraryImportDialog( QWidget* pParent, bool bOnli
 	m_pDrumkitTree->header()->resizeSection( 0, 200 );
 
 	connect( m_pDrumkitTree, SIGNAL( currentItemChanged ( QTreeWidgetItem*, QTreeWidgetItem* ) ), this, SLOT( soundLibraryItemChanged( QTreeWidgetItem*, QTreeWidgetItem* ) ) );
+	// Several items can be downloaded at once.
+	m_pDrumkitTree->setSelectionMode( QAbstractItemView::ExtendedSelection );
+	connect( m_pDrumkitTree, SIGNAL( itemSelectionChanged() ), this, SLOT( soundLibrarySelectionChanged() ) );
 	connect( repositoryCombo, SIGNAL(currentIndexChanged(int)), this, SLOT( onRepositoryComboBoxIndexChanged(int) ));
 
 	SoundLibraryNameLbl->setText( "" );
@@ -71,6 +80,12 @@ SoundLibraryImportDialog::SoundLibraryImportDialog( QWidget* pParent, bool bOnli
 
 	InstallBtn->setEnabled (false );
 
+	// Samples can only be cached in advance if the cache is used at
+	// all.
+	bool bSampleCache = H2Core::Preferences::get_instance()->m_bSampleCache;
+	cacheSamplesCheckBox->setEnabled( bSampleCache );
+	cacheSamplesCheckBox->setChecked( false );
+
 	updateRepositoryCombo();
 
 	if( bOnlineImport){
@@ -231,6 +246,30 @@ QString SoundLibraryImportDialog::readCachedData(const QString& fileName)
 	return content;
 }
 
+void SoundLibraryImportDialog::readCacheValidators( const QString& fileName, QByteArray* pETag, QByteArray* pLastModified )
+{
+	QFile inFile( fileName + ".validators" );
+	if ( ! inFile.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+		return;
+	}
+	*pETag = inFile.readLine().trimmed();
+	*pLastModified = inFile.readLine().trimmed();
+}
+
+void SoundLibraryImportDialog::writeCacheValidators( const QString& fileName, const QByteArray& eTag, const QByteArray& lastModified )
+{
+	QFile outFile( fileName + ".validators" );
+	if ( eTag.isEmpty() && lastModified.isEmpty() ) {
+		outFile.remove();
+		return;
+	}
+	if ( ! outFile.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		ERRORLOG( QString("Failed to open file for writing repository cache: %1").arg( outFile.fileName() ) );
+		return;
+	}
+	outFile.write( eTag + "\n" + lastModified + "\n" );
+}
+
 QString SoundLibraryImportDialog::readCachedImage( const QString& imageFile )
 {
 	QString cacheFile = getCachedImageFilename() ;
@@ -313,6 +352,11 @@ void SoundLibraryImportDialog::reloadRepositoryData()
 					soundLibInfo.setImageLicense( imageLicenseNode.text() );
 				}
 
+				QDomElement sha256Node = drumkitNode.firstChildElement( "sha256" );
+				if ( !sha256Node.isNull() ) {
+					soundLibInfo.setSha256( sha256Node.text().trimmed() );
+				}
+
 
 				m_soundLibraryList.push_back( soundLibInfo );
 			}
@@ -332,15 +376,36 @@ void SoundLibraryImportDialog::on_UpdateListBtn_clicked()
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 	QString downloadUrl = repositoryCombo->currentText();
 	QString sDrumkitXML;
+	QString cacheFile = getCachedFilename();
+
+	// Only fetch the list if it changed since it was cached.
+	Download::headers_t headers;
+	if ( H2Core::Filesystem::file_exists( cacheFile, true ) ) {
+		QByteArray eTag, lastModified;
+		readCacheValidators( cacheFile, &eTag, &lastModified );
+		if ( ! eTag.isEmpty() ) {
+			headers << qMakePair( QByteArray( "If-None-Match" ), eTag );
+		}
+		if ( ! lastModified.isEmpty() ) {
+			headers << qMakePair( QByteArray( "If-Modified-Since" ), lastModified );
+		}
+	}
+	bool bNotModified = false;
+	QByteArray eTag, lastModified;
 
 	for (int ii=1; ii <= max_redirects; ii++) {
-		DownloadWidget drumkitList( this, tr( "Updating SoundLibrary list..." ), downloadUrl);
+		DownloadWidget drumkitList( this, tr( "Updating SoundLibrary list..." ), downloadUrl, "", headers );
 		drumkitList.exec();
 
 		if (!drumkitList.get_redirect_url().isEmpty()) {
 			downloadUrl = drumkitList.get_redirect_url().toEncoded();
+		} else if ( drumkitList.is_not_modified() ) {
+			bNotModified = true;
+			break;
 		} else if (drumkitList.get_error().isEmpty()) {
 			sDrumkitXML = drumkitList.get_xml_content();
+			eTag = drumkitList.get_response_header( "ETag" );
+			lastModified = drumkitList.get_response_header( "Last-Modified" );
 			break;
 		}
 
@@ -360,13 +425,15 @@ void SoundLibraryImportDialog::on_UpdateListBtn_clicked()
 	 * CACHE_DIR
 	 *     +-----repositories
 	 *	   +-----serverlist_$(md5(SERVER_NAME))
+	 * The ETag and Last-Modified header of the response are stored
+	 * next to it in serverlist_$(md5(SERVER_NAME)).validators.
 	 */
 
 
-	QString cacheFile = getCachedFilename();
-
-
-	writeCachedData(cacheFile, sDrumkitXML);
+	if ( ! bNotModified && ! sDrumkitXML.isEmpty() ) {
+		writeCachedData(cacheFile, sDrumkitXML);
+		writeCacheValidators( cacheFile, eTag, lastModified );
+	}
 
 	reloadRepositoryData();
 	QApplication::restoreOverrideCursor();
@@ -595,95 +662,225 @@ void SoundLibraryImportDialog::soundLibraryItemChanged( QTreeWidgetItem* current
 	SoundLibraryNameLbl->setText( "" );
 	SoundLibraryInfoLbl->setText( "" );
 	AuthorLbl->setText( "" );
-	DownloadBtn->setEnabled( false );
+	soundLibrarySelectionChanged();
+}
+
+void SoundLibraryImportDialog::soundLibrarySelectionChanged()
+{
+	bool bDownloadable = false;
+	for ( auto pItem : m_pDrumkitTree->selectedItems() ) {
+		// The category items have no parent.
+		if ( pItem->parent() != nullptr ) {
+			bDownloadable = true;
+			break;
+		}
+	}
+	if ( ! bDownloadable ) {
+		auto pCurrent = m_pDrumkitTree->currentItem();
+		bDownloadable = pCurrent != nullptr && pCurrent->parent() != nullptr;
+	}
+	DownloadBtn->setEnabled( bDownloadable );
 }
 
 
 
 void SoundLibraryImportDialog::on_DownloadBtn_clicked()
 {
-	QApplication::setOverrideCursor(Qt::WaitCursor);
-	QString selected = m_pDrumkitTree->currentItem()->text(0);
-
-	for ( uint i = 0; i < m_soundLibraryList.size(); ++i ) {
-		if ( m_soundLibraryList[ i ].getName() == selected ) {
-			// Download the sound library
-			QString sURL = m_soundLibraryList[ i ].getUrl();
-			QString sType = m_soundLibraryList[ i ].getType();
-			QString sLocalFile;
-
-			if( sType == "drumkit") {
-				sLocalFile = QDir::tempPath() + "/" + QFileInfo( sURL ).fileName();
+	std::vector<SoundLibraryInfo> items;
+	QList<QTreeWidgetItem*> selected = m_pDrumkitTree->selectedItems();
+	if ( selected.isEmpty() && m_pDrumkitTree->currentItem() != nullptr ) {
+		selected << m_pDrumkitTree->currentItem();
+	}
+	for ( auto pItem : selected ) {
+		for ( const auto& info : m_soundLibraryList ) {
+			if ( info.getName() == pItem->text( 0 ) ) {
+				items.push_back( info );
+				break;
 			}
+		}
+	}
+	if ( items.empty() ) {
+		return;
+	}
 
-			if( sType == "song") {
-				sLocalFile = H2Core::Filesystem::songs_dir() + QFileInfo( sURL ).fileName();
-			}
+	QStringList failed = downloadItems( items );
 
-			if( sType == "pattern") {
-				sLocalFile = H2Core::Filesystem::patterns_dir() + QFileInfo( sURL ).fileName();
-			}
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	// update the drumkit list
+	SoundLibraryDatabase::get_instance()->update();
+	HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->test_expandedItems();
+	HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->updateDrumkitList();
+	updateSoundLibraryList();
+	QApplication::restoreOverrideCursor();
 
-			bool Error = false;
+	if ( ! failed.isEmpty() ) {
+		QMessageBox::warning( this, "Hydrogen", tr( "An error occurred importing the SoundLibrary."  )
+							  .append( "\n\n" ).append( failed.join( "\n" ) ) );
+	} else {
+		QMessageBox::information( this, "Hydrogen", QString( tr( "SoundLibrary imported in %1" ) ).arg( H2Core::Filesystem::usr_data_path() ) );
+	}
+}
 
-			for ( int i = 0; i < max_redirects; ++i ) {
-				DownloadWidget dl( this, tr( "Downloading SoundLibrary..." ), sURL, sLocalFile );
-				dl.exec();
+QStringList SoundLibraryImportDialog::downloadItems( const std::vector<SoundLibraryInfo>& items )
+{
+	H2Core::Preferences* pPref = H2Core::Preferences::get_instance();
+	const int nParallel = std::max( 1, pPref->m_nParallelDownloads );
+	const int nRateLimit = pPref->m_nDownloadRateLimit * 1024;
+	const bool bCacheSamples = cacheSamplesCheckBox->isChecked();
+
+	struct Transfer {
+		SoundLibraryInfo info;
+		QString sUrl;
+		QString sLocalFile;
+		int nRedirects = 0;
+		std::unique_ptr<H2Core::DrumkitInstaller> pInstaller;
+		Download* pDownload = nullptr;
+	};
+
+	std::deque<std::unique_ptr<Transfer>> pending;
+	for ( const auto& info : items ) {
+		auto pTransfer = std::make_unique<Transfer>();
+		pTransfer->info = info;
+		pTransfer->sUrl = info.getUrl();
+		QString sFileName = QFileInfo( info.getUrl() ).fileName();
+		if ( info.getType() == "drumkit" ) {
+			if ( info.getSha256().isEmpty() ) {
+				// Extracted while it is downloaded.
+				pTransfer->pInstaller = std::make_unique<H2Core::DrumkitInstaller>( bCacheSamples );
+			} else {
+				// Has to be verified before it is installed.
+				pTransfer->sLocalFile = H2Core::Filesystem::tmp_file_path( sFileName );
+			}
+		} else if ( info.getType() == "song" ) {
+			pTransfer->sLocalFile = H2Core::Filesystem::songs_dir() + sFileName;
+		} else if ( info.getType() == "pattern" ) {
+			pTransfer->sLocalFile = H2Core::Filesystem::patterns_dir() + sFileName;
+		} else {
+			continue;
+		}
+		pending.push_back( std::move( pTransfer ) );
+	}
 
-				QUrl redirect_url = dl.get_redirect_url();
-				if (redirect_url.isEmpty() ) {
-					// ok, we have all data
-					Error = !dl.get_error().isEmpty();
-					break;
-				}
-				else {
-					sURL = redirect_url.toEncoded();
-					Error = !dl.get_error().isEmpty();
-				}
+	QStringList failed;
+	std::vector<std::unique_ptr<Transfer>> running;
+	int nDone = 0;
+	const int nTotal = pending.size();
+
+	QProgressDialog progress( tr( "Downloading SoundLibrary..." ), tr( "Cancel" ), 0, nTotal, this );
+	progress.setWindowModality( Qt::WindowModal );
+	progress.setMinimumDuration( 0 );
+	progress.setValue( 0 );
+
+	QEventLoop loop;
+	// std::function to allow the recursion via the redirects.
+	std::function<void( Transfer* )> start;
+	std::function<void()> startNext;
+
+	// All running downloads share the limit.
+	auto balance = [&]() {
+		if ( nRateLimit > 0 && ! running.empty() ) {
+			for ( auto& pTransfer : running ) {
+				pTransfer->pDownload->set_rate_limit( nRateLimit / running.size() );
 			}
+		}
+	};
+
+	auto complete = [&]( Transfer* pTransfer ) {
+		Download* pDownload = pTransfer->pDownload;
+		pTransfer->pDownload = nullptr;
+		pDownload->deleteLater();
+
+		bool bOk = pDownload->result() == QDialog::Accepted &&
+			pDownload->get_error().isEmpty();
+		if ( bOk && ! pTransfer->info.getSha256().isEmpty() &&
+			 pDownload->get_sha256().compare( pTransfer->info.getSha256(), Qt::CaseInsensitive ) != 0 ) {
+			ERRORLOG( QString( "Checksum mismatch of [%1]" ).arg( pTransfer->sUrl ) );
+			bOk = false;
+		}
 
+		if ( pTransfer->pInstaller != nullptr ) {
+			if ( bOk ) {
+				bOk = pTransfer->pInstaller->finish();
+			} else {
+				pTransfer->pInstaller->abort();
+			}
+		} else if ( pTransfer->info.getType() == "drumkit" ) {
+			if ( bOk ) {
+				bOk = H2Core::Drumkit::install( pTransfer->sLocalFile, bCacheSamples );
+			}
+			QFile::remove( pTransfer->sLocalFile );
+		} else if ( ! bOk ) {
+			QFile::remove( pTransfer->sLocalFile );
+		}
 
-			//No 'else', error message has been already displayed by DL widget
-			if(!Error)
-			{
-				// install the new soundlibrary
-				try {
-					if ( sType == "drumkit" ) {
-						H2Core::Drumkit::install( sLocalFile );
-						QApplication::restoreOverrideCursor();
-						QMessageBox::information( this, "Hydrogen", QString( tr( "SoundLibrary imported in %1" ) ).arg( H2Core::Filesystem::usr_data_path() ) );
-					}
+		if ( ! bOk ) {
+			failed << pTransfer->info.getName();
+		}
+		progress.setValue( ++nDone );
+	};
+
+	start = [&]( Transfer* pTransfer ) {
+		pTransfer->pDownload = new Download( this, pTransfer->sUrl, pTransfer->sLocalFile );
+		pTransfer->pDownload->set_installer( pTransfer->pInstaller.get() );
+		connect( pTransfer->pDownload, &QDialog::finished, &loop, [&, pTransfer]( int ) {
+			QUrl redirect = pTransfer->pDownload->get_redirect_url();
+			if ( ! redirect.isEmpty() && pTransfer->nRedirects < max_redirects ) {
+				pTransfer->pDownload->deleteLater();
+				pTransfer->sUrl = redirect.toEncoded();
+				++pTransfer->nRedirects;
+				start( pTransfer );
+				balance();
+				return;
+			}
 
-					if ( sType == "song" || sType == "pattern") {
-						QApplication::restoreOverrideCursor();
-					}
-				}
-				catch( H2Core::H2Exception ex ) {
-					QApplication::restoreOverrideCursor();
-					QMessageBox::warning( this, "Hydrogen", tr( "An error occurred importing the SoundLibrary."  ) );
+			complete( pTransfer );
+			for ( auto it = running.begin(); it != running.end(); ++it ) {
+				if ( it->get() == pTransfer ) {
+					running.erase( it );
+					break;
 				}
 			}
-			else
-			{
-				QApplication::restoreOverrideCursor();
-			}
+			startNext();
+		} );
+	};
+	startNext = [&]() {
+		while ( ! pending.empty() && static_cast<int>( running.size() ) < nParallel ) {
+			running.push_back( std::move( pending.front() ) );
+			pending.pop_front();
+			start( running.back().get() );
+		}
+		balance();
+		if ( running.empty() ) {
+			loop.quit();
+		}
+	};
 
-			QApplication::setOverrideCursor(Qt::WaitCursor);
-			// remove the downloaded files..
-			if( sType == "drumkit" ) {
-				QDir dir;
-				dir.remove( sLocalFile );
+	connect( &progress, &QProgressDialog::canceled, &loop, [&]() {
+		for ( const auto& pTransfer : pending ) {
+			failed << pTransfer->info.getName();
+		}
+		pending.clear();
+		for ( auto& pTransfer : running ) {
+			// Deleting the download does abort its transfer.
+			delete pTransfer->pDownload;
+			pTransfer->pDownload = nullptr;
+			if ( pTransfer->pInstaller != nullptr ) {
+				pTransfer->pInstaller->abort();
+			} else {
+				QFile::remove( pTransfer->sLocalFile );
 			}
-
-			// update the drumkit list
-			SoundLibraryDatabase::get_instance()->update();
-			HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->test_expandedItems();
-			HydrogenApp::get_instance()->getInstrumentRack()->getSoundLibraryPanel()->updateDrumkitList();
-			updateSoundLibraryList();
-			QApplication::restoreOverrideCursor();
-			return;
+			failed << pTransfer->info.getName();
 		}
+		running.clear();
+		loop.quit();
+	} );
+
+	startNext();
+	if ( ! running.empty() ) {
+		loop.exec();
 	}
+
+	return failed;
 }
 
 
@@ -720,7 +917,12 @@ void SoundLibraryImportDialog::on_InstallBtn_clicked()
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
 	try {
-		H2Core::Drumkit::install( SoundLibraryPathTxt->text() );
+		if ( ! H2Core::Drumkit::install( SoundLibraryPathTxt->text(),
+										 cacheSamplesCheckBox->isChecked() ) ) {
+			QApplication::restoreOverrideCursor();
+			QMessageBox::warning( this, "Hydrogen", tr( "An error occurred importing the SoundLibrary."  ) );
+			return;
+		}
 		QMessageBox::information( this, "Hydrogen", QString( tr( "SoundLibrary imported in %1" ).arg( H2Core::Filesystem::usr_data_path() )  ) );
 		// update the drumkit list
 		SoundLibraryDatabase::get_instance()->update();
@@ -54,6 +54,7 @@ class SoundLibraryImportDialog : public QDialog, public Ui_SoundLibraryImportDia
 		void on_close_btn_clicked();
 
 		void soundLibraryItemChanged( QTreeWidgetItem*, QTreeWidgetItem* );
+		void soundLibrarySelectionChanged();
 		void onRepositoryComboBoxIndexChanged(int);
 
 
@@ -73,6 +74,21 @@ class SoundLibraryImportDialog : public QDialog, public Ui_SoundLibraryImportDia
 		QString readCachedData(const QString& fileName);
 		QString getCachedFilename();
 		QString getCachedImageFilename();
+		/**
+		 * Reads the ETag and Last-Modified header of the response
+		 * the cached server list @a fileName was created from.
+		 */
+		void readCacheValidators( const QString& fileName, QByteArray* pETag, QByteArray* pLastModified );
+		void writeCacheValidators( const QString& fileName, const QByteArray& eTag, const QByteArray& lastModified );
+		/**
+		 * Downloads and installs @a items. Up to
+		 * Preferences::m_nParallelDownloads of them are transferred at
+		 * once, sharing Preferences::m_nDownloadRateLimit.
+		 *
+		 * \param items the entries of #m_soundLibraryList to fetch
+		 * \return names of the items which could not be installed
+		 */
+		QStringList downloadItems( const std::vector<SoundLibraryInfo>& items );
 		void reloadRepositoryData();
 		void updateSoundLibraryList();
 		void updateRepositoryCombo();
@@ -49,6 +49,8 @@
 #include <core/AudioEngine.h>
 #include <core/H2Exception.h>
 #include <core/Hydrogen.h>
+#include <core/Basics/DrumkitIndex.h>
+#include <core/Basics/PatternIndex.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Preferences.h>
@@ -78,12 +80,14 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
  , __song_item( nullptr )
  , __pattern_item( nullptr )
  , __pattern_item_list( nullptr )
+ , m_pPatternFilter( nullptr )
  , m_bInItsOwnDialog( bInItsOwnDialog )
 {
 
 	//INFOLOG( "INIT" );
 	__drumkit_menu = new QMenu( this );
 	__drumkit_menu->addAction( tr( "Load" ), this, SLOT( on_drumkitLoadAction() ) );
+	__drumkit_menu->addAction( tr( "Load at next bar" ), this, SLOT( on_drumkitLoadAtNextBarAction() ) );
 	__drumkit_menu->addAction( tr( "Export" ), this, SLOT( on_drumkitExportAction() ) );
 	__drumkit_menu->addAction( tr( "Properties" ), this, SLOT( on_drumkitPropertiesAction() ) );
 	__drumkit_menu->addSeparator();
@@ -122,6 +126,15 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
 	pVBox->setSpacing( 0 );
 	pVBox->setMargin( 0 );
 
+	if ( ! m_bInItsOwnDialog ) {
+		m_pPatternFilter = new QLineEdit( this );
+		m_pPatternFilter->setPlaceholderText( tr( "Search patterns" ) );
+		m_pPatternFilter->setToolTip( tr( "Only list the patterns whose name, info, category, or drumkit contains all words" ) );
+		m_pPatternFilter->setClearButtonEnabled( true );
+		connect( m_pPatternFilter, &QLineEdit::textChanged,
+				 this, [this]( const QString& ) { updatePatternItems(); } );
+		pVBox->addWidget( m_pPatternFilter );
+	}
 	pVBox->addWidget( __sound_library_tree );
 	
 
@@ -132,7 +145,18 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent, bool bInItsOwnDialog )
 
 	m_sMessageFailedPreDrumkitLoad = tr( "Drumkit registered in the current song can not be found on disk.\nPlease load an existing drumkit first.\nCurrent kit:" );
 
-	updateDrumkitList();
+	if ( m_bInItsOwnDialog ) {
+		updateDrumkitList();
+	} else {
+		// The panel in the InstrumentRack is populated once the
+		// event loop is running so it does not delay the appearance
+		// of the main window.
+		QTimer::singleShot( 0, this, [this]() {
+				if ( __system_drumkits_item == nullptr ) {
+					updateDrumkitList();
+				}
+			} );
+	}
 }
 
 
@@ -155,9 +179,9 @@ SoundLibraryPanel::~SoundLibraryPanel()
 
 void SoundLibraryPanel::updateDrumkitList()
 {
-	LocalFileMng mng;
-
 	__sound_library_tree->clear();
+	__song_item = nullptr;
+	__pattern_item = nullptr;
 
 
 
@@ -181,45 +205,18 @@ void SoundLibraryPanel::updateDrumkitList()
 	}
 	__user_drumkit_info_list.clear();
 
-	//User drumkit list
-	QStringList usr_dks = Filesystem::usr_drumkit_list();
-	for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			__user_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( ! m_bInItsOwnDialog ) {
-				InstrumentList *pInstrList = pInfo->get_instruments();
-				for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-					Instrument *pInstr = pInstrList->get( nInstr );
-					QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-					pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-					pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-				}
-			}
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	if ( pIndex == nullptr ) {
+		ERRORLOG( "Drumkit index not available" );
+	} else {
+		//User drumkit list
+		for ( const auto& entry : pIndex->get_entries( Filesystem::Lookup::user ) ) {
+			addDrumkitItem( __user_drumkits_item, entry );
 		}
-	}
 
-	//System drumkit list
-	QStringList sys_dks = Filesystem::sys_drumkit_list();
-	for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath, false );
-		if (pInfo) {
-			__system_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( ! m_bInItsOwnDialog ) {
-				InstrumentList *pInstrList = pInfo->get_instruments();
-				for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-					Instrument *pInstr = pInstrList->get( nInstr );
-					QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-					pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-					pInstrumentItem->setToolTip( 0, pInstr->get_name() );
-				}
-			}
+		//System drumkit list
+		for ( const auto& entry : pIndex->get_entries( Filesystem::Lookup::system ) ) {
+			addDrumkitItem( __system_drumkits_item, entry );
 		}
 	}
 
@@ -241,49 +238,116 @@ void SoundLibraryPanel::updateDrumkitList()
 
 
 		//Pattern list
-		QStringList patternDirList = Filesystem::pattern_drumkits();
-		if ( patternDirList.size() > 0 ) {
-		
+		PatternIndex* pPatternIndex = PatternIndex::get_instance();
+		if ( pPatternIndex == nullptr ) {
+			ERRORLOG( "Pattern index not available" );
+		} else if ( ! pPatternIndex->get_entries().empty() ) {
 			__pattern_item = new QTreeWidgetItem( __sound_library_tree );
 			__pattern_item->setText( 0, tr( "Patterns" ) );
 			__pattern_item->setToolTip( 0, tr("Double click to expand the list") );
 			__pattern_item->setExpanded( __expand_pattern_list );
-		
-			//this is the second step to push the mng.function
-			//SoundLibraryDatabase::create_instance();
-			SoundLibraryDatabase* db = SoundLibraryDatabase::get_instance();
-			soundLibraryInfoVector* allPatternDirList = db->getAllPatterns();
-			QStringList allCategoryNameList = db->getAllPatternCategories();
-
-			//now sorting via category
-
-			for (uint i = 0; i < allCategoryNameList.size(); ++i) {
-				QString categoryName = allCategoryNameList[i];
-
-				QTreeWidgetItem* pCategoryItem = new QTreeWidgetItem( __pattern_item );
-				pCategoryItem->setText( 0, categoryName  );
-
-				soundLibraryInfoVector::iterator mapIterator;
-				for( mapIterator=allPatternDirList->begin(); mapIterator != allPatternDirList->end(); mapIterator++ )
-					{
-						QString patternCategory = (*mapIterator)->getCategory();
-						if ( (patternCategory == categoryName) || (patternCategory.isEmpty() && categoryName == "No category") ){
-							QTreeWidgetItem* pPatternItem = new QTreeWidgetItem( pCategoryItem );
-							pPatternItem->setText( 0, (*mapIterator)->getName());
-							pPatternItem->setText( 1, (*mapIterator)->getPath() );
-							pPatternItem->setToolTip( 0, mng.getDrumkitNameForPattern( (*mapIterator)->getPath() ));
-							INFOLOG( "Path" +  (*mapIterator)->getPath() );
-						}
-					}
-			}
+			updatePatternItems();
 		}
 	}
 	
 	update_background_color();
 }
 
+void SoundLibraryPanel::updatePatternItems()
+{
+	PatternIndex* pIndex = PatternIndex::get_instance();
+	if ( __pattern_item == nullptr || pIndex == nullptr ) {
+		return;
+	}
+
+	for ( auto pItem : __pattern_item->takeChildren() ) {
+		delete pItem;
+	}
+
+	QString sFilter = m_pPatternFilter != nullptr ? m_pPatternFilter->text() : "";
+	std::vector<PatternIndex::Entry> entries = pIndex->find( sFilter );
+
+	QStringList categories = pIndex->get_categories();
+	categories << "";
+
+	for ( const auto& sCategory : categories ) {
+		QTreeWidgetItem* pCategoryItem = nullptr;
+
+		for ( const auto& entry : entries ) {
+			if ( entry.sCategory != sCategory ) {
+				continue;
+			}
+			if ( pCategoryItem == nullptr ) {
+				pCategoryItem = new QTreeWidgetItem( __pattern_item );
+				pCategoryItem->setText( 0, sCategory.isEmpty() ? tr( "No category" ) : sCategory );
+				pCategoryItem->setExpanded( ! sFilter.isEmpty() );
+			}
+
+			QTreeWidgetItem* pPatternItem = new QTreeWidgetItem( pCategoryItem );
+			pPatternItem->setText( 0, entry.sName );
+			pPatternItem->setText( 1, entry.sPath );
+			pPatternItem->setToolTip( 0, tr( "%1\n%2 ticks, %3 notes of %4 instruments, %5 notes per quarter" )
+									  .arg( entry.sDrumkitName )
+									  .arg( entry.nLength )
+									  .arg( entry.nNotes )
+									  .arg( entry.instruments.size() )
+									  .arg( entry.fNoteDensity, 0, 'f', 1 ) );
+		}
+	}
+
+	if ( ! sFilter.isEmpty() ) {
+		__pattern_item->setExpanded( true );
+	}
+}
+
 
 
+void SoundLibraryPanel::addDrumkitItem( QTreeWidgetItem* pParent, const DrumkitIndex::Entry& entry )
+{
+	if ( ! entry.bLoaded ) {
+		return;
+	}
+
+	QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( pParent );
+	pDrumkitItem->setText( 0, entry.sName );
+	if ( ! m_bInItsOwnDialog ) {
+		for ( int nInstr = 0; nInstr < entry.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + entry.instruments[ nInstr ] );
+			pInstrumentItem->setToolTip( 0, entry.instruments[ nInstr ] );
+		}
+	}
+}
+
+Drumkit* SoundLibraryPanel::getDrumkit( const QString& sName, Filesystem::Lookup lookup )
+{
+	std::vector<Drumkit*>& drumkits = lookup == Filesystem::Lookup::system ?
+		__system_drumkit_info_list : __user_drumkit_info_list;
+	for ( auto pDrumkit : drumkits ) {
+		if ( pDrumkit->get_name() == sName ) {
+			return pDrumkit;
+		}
+	}
+
+	DrumkitIndex* pIndex = DrumkitIndex::get_instance();
+	if ( pIndex == nullptr ) {
+		return nullptr;
+	}
+
+	// Only the drumkits actually used are read in full.
+	for ( const auto& entry : pIndex->get_entries( lookup ) ) {
+		if ( entry.bLoaded && entry.sName == sName ) {
+			Drumkit* pDrumkit = Drumkit::load( entry.sPath, false );
+			if ( pDrumkit != nullptr ) {
+				drumkits.push_back( pDrumkit );
+			}
+			return pDrumkit;
+		}
+	}
+
+	return nullptr;
+}
+
 void SoundLibraryPanel::on_DrumkitList_ItemChanged( QTreeWidgetItem * current, QTreeWidgetItem * previous )
 {
 	UNUSED( previous );
@@ -491,6 +555,16 @@ void SoundLibraryPanel::on_DrumkitList_mouseMove( QMouseEvent *event)
 
 
 void SoundLibraryPanel::on_drumkitLoadAction()
+{
+	loadSelectedDrumkit( false );
+}
+
+void SoundLibraryPanel::on_drumkitLoadAtNextBarAction()
+{
+	loadSelectedDrumkit( true );
+}
+
+void SoundLibraryPanel::loadSelectedDrumkit( bool bAtNextBar )
 {
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 	// Whether we deal with a system or a user drumkit.
@@ -502,23 +576,9 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 	// "System drumkit", it won't be searched in the user ones and
 	// vice versa.
 	if ( sDrumkitType == __system_drumkits_item->text(0) ) {
-		
-		for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-			Drumkit *pInfo = __system_drumkit_info_list[i];
-			if ( pInfo->get_name() == sDrumkitName ) {
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
+		pDrumkitInfo = getDrumkit( sDrumkitName, Filesystem::Lookup::system );
 	} else if ( sDrumkitType == __user_drumkits_item->text(0) ) {
-		
-		for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-			Drumkit *pInfo = __user_drumkit_info_list[i];
-			if ( pInfo->get_name() == sDrumkitName ) {
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
+		pDrumkitInfo = getDrumkit( sDrumkitName, Filesystem::Lookup::user );
 	} else {
 		ERRORLOG( QString( "Unknown drumkit type [%1] for drumkit [%2]" )
 				  .arg( sDrumkitType ).arg( sDrumkitName ) );
@@ -594,6 +654,21 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 	assert( pDrumkitInfo );
 
+	if ( bAtNextBar ) {
+		// The GUI is updated in MainForm::drumkitLoadedEvent() once
+		// the drumkit was swapped in.
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		if ( pHydrogen->prepareDrumkit( pDrumkitInfo, conditionalLoad ) == 0 ) {
+			pHydrogen->commitDrumkit( true );
+			HydrogenApp::get_instance()->setStatusBarMessage(
+				tr( "Drumkit [%1] will be loaded at the next bar" ).arg( pDrumkitInfo->get_name() ), 5000 );
+		} else {
+			HydrogenApp::get_instance()->setStatusBarMessage(
+				tr( "Another drumkit is still being loaded" ), 5000 );
+		}
+		return;
+	}
+
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
 	Hydrogen::get_instance()->loadDrumkit( pDrumkitInfo, conditionalLoad );
@@ -724,23 +799,9 @@ void SoundLibraryPanel::on_drumkitPropertiesAction()
 	// as a "System drumkit", it won't be searched in the user ones
 	// and vice versa.
 	if ( sDrumkitType == __system_drumkits_item->text(0) ) {
-		
-		for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-			Drumkit *pInfo = __system_drumkit_info_list[i];
-			if ( pInfo->get_name() == sDrumkitName ) {
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
+		pDrumkitInfo = getDrumkit( sDrumkitName, Filesystem::Lookup::system );
 	} else if ( sDrumkitType == __user_drumkits_item->text(0) ) {
-		
-		for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-			Drumkit*pInfo = __user_drumkit_info_list[i];
-			if ( pInfo->get_name() == sDrumkitName ) {
-				pDrumkitInfo = pInfo;
-				break;
-			}
-		}
+		pDrumkitInfo = getDrumkit( sDrumkitName, Filesystem::Lookup::user );
 	} else {
 		ERRORLOG( QString( "Unknown drumkit type [%1] for drumkit [%2]" )
 				  .arg( sDrumkitType ).arg( sDrumkitName ) );
@@ -760,21 +821,9 @@ void SoundLibraryPanel::on_drumkitPropertiesAction()
 	// the current lookup to decide whether to search in the system or
 	// the user folder.
 	if ( Hydrogen::get_instance()->getCurrentDrumkitLookup() == Filesystem::Lookup::system ) {
-		for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-			Drumkit *prInfo = __system_drumkit_info_list[i];
-			if ( prInfo->get_name() == sPreDrumkitName ) {
-				pPreDrumkitInfo = prInfo;
-				break;
-			}
-		}
+		pPreDrumkitInfo = getDrumkit( sPreDrumkitName, Filesystem::Lookup::system );
 	} else {
-		for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-			Drumkit *prInfo = __user_drumkit_info_list[i];
-			if ( prInfo->get_name() == sPreDrumkitName ) {
-				pPreDrumkitInfo = prInfo;
-				break;
-			}
-		}
+		pPreDrumkitInfo = getDrumkit( sPreDrumkitName, Filesystem::Lookup::user );
 	}
 
 	if ( pPreDrumkitInfo == nullptr ){
@@ -860,6 +909,10 @@ void SoundLibraryPanel::on_patternDeleteAction()
 void SoundLibraryPanel::test_expandedItems()
 {
 	assert( __sound_library_tree );
+	if ( __system_drumkits_item == nullptr ) {
+		// Not populated yet. Keep the stored values.
+		return;
+	}
 	if ( __song_item == nullptr) {
 		__expand_songs_list = false;
 	} else {
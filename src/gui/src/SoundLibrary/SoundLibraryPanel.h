@@ -30,6 +30,7 @@
 #include <vector>
 
 #include <core/Object.h>
+#include <core/Basics/DrumkitIndex.h>
 
 namespace H2Core
 {
@@ -64,6 +65,7 @@ private slots:
 	void on_DrumkitList_rightClicked( QPoint pos );
 	void on_DrumkitList_mouseMove( QMouseEvent* event );
 
+	void on_drumkitLoadAtNextBarAction();
 	void on_drumkitDeleteAction();
 	void on_drumkitPropertiesAction();
 	void on_drumkitExportAction();
@@ -91,13 +93,33 @@ private:
 	QTreeWidgetItem* __song_item;
 	QTreeWidgetItem* __pattern_item;
 	QTreeWidgetItem* __pattern_item_list;
+	/** Narrows down the listed patterns, see
+		H2Core::PatternIndex::find(). nullptr if the panel is part of
+		its own dialog.*/
+	QLineEdit* m_pPatternFilter;
 
+	/** Drumkits read in full by getDrumkit(). Owned by the panel
+		and dropped by updateDrumkitList().*/
 	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;
 	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;
+	/** Adds the drumkit of @a entry and, unless the panel is part of
+		its own dialog, its instruments to the tree.*/
+	void addDrumkitItem( QTreeWidgetItem* pParent, const H2Core::DrumkitIndex::Entry& entry );
+	/** \return The drumkit named @a sName listed in the
+		H2Core::DrumkitIndex, read on first use. nullptr if not
+		found.*/
+	H2Core::Drumkit* getDrumkit( const QString& sName, H2Core::Filesystem::Lookup lookup );
+	/** Lists the patterns of the H2Core::PatternIndex matching
+		#m_pPatternFilter by category below #__pattern_item.*/
+	void updatePatternItems();
 	bool __expand_pattern_list;
 	bool __expand_songs_list;
 	void restore_background_color();
 	void change_background_color();
+	/** Loads the selected drumkit. If @a bAtNextBar is set, it is
+		prepared in the background and swapped in at the beginning
+		of the next bar without stopping playback.*/
+	void loadSelectedDrumkit( bool bAtNextBar );
 
 	/** Whether the dialog was constructed via a click in the MainForm
 	 * or as part of the GUI.
@@ -8,8 +8,11 @@
 #include <QPoint>
 #include <vector>
 
+#include <core/Hydrogen.h>
 #include <core/Basics/Note.h>
 #include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
 #include <core/Basics/AutomationPath.h>
 #include <core/Helpers/Filesystem.h>
 
@@ -20,6 +23,7 @@
 
 #include "PatternEditor/NotePropertiesRuler.h"
 #include "PatternEditor/DrumPatternEditor.h"
+#include "PatternEditor/NoteDiff.h"
 #include "PatternEditor/PatternEditorPanel.h"
 #include "PatternEditor/NotePropertiesRuler.h"
 #include "Widgets/AutomationPathView.h"
@@ -376,11 +380,13 @@ private:
 class SE_editTimeLineAction : public QUndoCommand
 {
 public:
-	SE_editTimeLineAction( int newPosition, float oldBpm, float newBpm ){
+	SE_editTimeLineAction( int newPosition, float oldBpm, float newBpm, bool bOldRamp = false, bool bNewRamp = false ){
 		setText( QObject::tr( "Edit timeline tempo" ) );
 		__newPosition = newPosition;
 		__oldBpm = oldBpm;
 		__newBpm = newBpm;
+		m_bOldRamp = bOldRamp;
+		m_bNewRamp = bNewRamp;
 
 	}
 	virtual void undo()
@@ -388,7 +394,7 @@ public:
 		//qDebug() <<  "edit timeline tempo undo";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
 		if(__oldBpm >-1 ){
-			h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __oldBpm );
+			h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __oldBpm, m_bOldRamp );
 		}else
 		{
 			h2app->getSongEditorPanel()->getSongEditorPositionRuler()->deleteTimeLinePosition( __newPosition );
@@ -399,12 +405,14 @@ public:
 	{
 		//qDebug() <<  "edit timeline tempo redo";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __newBpm );
+		h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __newBpm, m_bNewRamp );
 	}
 private:
 	int __newPosition;
 	float __oldBpm;
 	float __newBpm;
+	bool m_bOldRamp;
+	bool m_bNewRamp;
 };
 
 //~song editor commands
@@ -414,17 +422,18 @@ private:
 class SE_deleteTimeLineAction : public QUndoCommand
 {
 public:
-	SE_deleteTimeLineAction( int newPosition, float oldBpm ){
+	SE_deleteTimeLineAction( int newPosition, float oldBpm, bool bOldRamp = false ){
 		setText( QObject::tr( "Delete timeline tempo" ) );
 		__newPosition = newPosition;
 		__oldBpm = oldBpm;
+		m_bOldRamp = bOldRamp;
 
 	}
 	virtual void undo()
 	{
 		//qDebug() <<  "delete timeline tempo undo";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __oldBpm );
+		h2app->getSongEditorPanel()->getSongEditorPositionRuler()->editTimeLineAction( __newPosition, __oldBpm, m_bOldRamp );
 
 	}
 
@@ -438,6 +447,7 @@ private:
 	int __newPosition;
 	float __oldBpm;
 	float __newBpm;
+	bool m_bOldRamp;
 };
 
 class SE_editTagAction : public QUndoCommand
@@ -736,41 +746,29 @@ public:
 	SE_clearNotesPatternEditorAction(  std::list<  H2Core::Note* > noteList, int nSelectedInstrument, int selectedPatternNumber ){
 		setText( QObject::tr( "Clear notes" ) );
 
-		std::list < H2Core::Note *>::iterator pos;
-		for ( pos = noteList.begin(); pos != noteList.end(); ++pos){
-			H2Core::Note *pNote;
-			pNote = new H2Core::Note(*pos);
+		for ( H2Core::Note* pNote : noteList ) {
 			assert( pNote );
-			__noteList.push_back( pNote );
+			__diff.removeNote( pNote );
 		}
 
 		__nSelectedInstrument = nSelectedInstrument;
 		__selectedPatternNumber = selectedPatternNumber;
 	}
 
-	~SE_clearNotesPatternEditorAction(){
-		//qDebug() << "delete left notes ";
-		while ( __noteList.size() ) {
-			delete __noteList.front();
-			__noteList.pop_front();
-		}
-
-	}
-
 	virtual void undo()
 	{
 		//qDebug() << "clear note sequence Undo ";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionClearNotesUndoAction( __noteList, __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, true );
 	}
 	virtual void redo()
 	{
 		//qDebug() << "clear note sequence Redo " ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionClearNotesRedoAction( __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, false );
 	}
 private:
-	std::list< H2Core::Note* > __noteList;
+	NoteDiff __diff;
 	int __nSelectedInstrument;
 	int __selectedPatternNumber;
 };
@@ -778,32 +776,53 @@ private:
 class SE_pasteNotesPatternEditorAction : public QUndoCommand
 {
 public:
+	/**
+	 * \param patternList Patterns holding the notes to paste. Each
+	 * one is matched by name with a pattern of the song. Only those notes
+	 * not already present in the song are recorded. The action takes
+	 * ownership of the patterns and deletes them right away.
+	 */
 	explicit SE_pasteNotesPatternEditorAction(const std::list<H2Core::Pattern*> & patternList)
 	{
 		//qDebug() << "paste note sequence Create ";
 		setText( QObject::tr( "Paste instrument notes" ) );
 
-		std::list < H2Core::Pattern *>::const_iterator pos;
-		for ( pos = patternList.begin(); pos != patternList.end(); ++pos)
-		{
-			H2Core::Pattern *pPattern = *pos;
+		H2Core::PatternList *pSongPatterns = H2Core::Hydrogen::get_instance()->getSong()->getPatternList();
+
+		for ( H2Core::Pattern *pPattern : patternList ) {
 			assert( pPattern );
-			__patternList.push_back(pPattern);
-		}
-	}
 
-	~SE_pasteNotesPatternEditorAction()
-	{
-		//qDebug() << "paste note sequence Destroy ";
-		while ( __patternList.size() > 0)
-		{
-			delete __patternList.front();
-			__patternList.pop_front();
-		}
-		while ( __appliedList.size() > 0)
-		{
-			delete __appliedList.front();
-			__appliedList.pop_front();
+			// Destination pattern
+			H2Core::Pattern *pDestination = pSongPatterns->find( pPattern->get_name() );
+			if ( pDestination != nullptr ) {
+				NoteDiff diff;
+				const H2Core::Pattern::notes_t* notes = pPattern->get_notes();
+				for ( auto it = notes->begin(); it != notes->end(); ++it ) {
+					H2Core::Note *pNote = it->second;
+					assert( pNote );
+
+					// Check if note is not present
+					bool bNoteExists = false;
+					const H2Core::Pattern::notes_t* destinationNotes = pDestination->get_notes();
+					for ( auto dit = destinationNotes->lower_bound( pNote->get_position() );
+						  dit != destinationNotes->end() && dit->first == pNote->get_position(); ++dit ) {
+						if ( dit->second->get_instrument() == pNote->get_instrument() ) {
+							bNoteExists = true;
+							break;
+						}
+					}
+
+					if ( ! bNoteExists ) {
+						diff.addNote( pNote );
+					}
+				}
+
+				if ( ! diff.isEmpty() ) {
+					__diffs.push_back( std::make_pair( pSongPatterns->index( pDestination ), diff ) );
+				}
+			}
+
+			delete pPattern;
 		}
 	}
 
@@ -811,28 +830,32 @@ public:
 	{
 		//qDebug() << "paste note sequence Undo ";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionPasteNotesUndoAction( __appliedList );
+		for ( auto it = __diffs.rbegin(); it != __diffs.rend(); ++it ) {
+			h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( it->second, it->first, true );
+		}
 	}
 
 	virtual void redo()
 	{
 		//qDebug() << "paste note sequence Redo " ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionPasteNotesRedoAction( __patternList, __appliedList );
+		for ( const auto& diff : __diffs ) {
+			h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( diff.second, diff.first, false );
+		}
 	}
 
 private:
-	std::list< H2Core::Pattern* > __patternList;
-	std::list< H2Core::Pattern* > __appliedList;
+	/** Notes added to each pattern (identified by its number).*/
+	std::vector< std::pair< int, NoteDiff > > __diffs;
 };
 
 
 class SE_fillNotesRightClickAction : public QUndoCommand
 {
 public:
-	SE_fillNotesRightClickAction( QStringList notePositions, int nSelectedInstrument, int selectedPatternNumber  ){
+	SE_fillNotesRightClickAction( const NoteDiff& diff, int nSelectedInstrument, int selectedPatternNumber  ){
 		setText( QObject::tr( "Fill notes" ) );
-		__notePositions = notePositions;
+		__diff = diff;
 		__nSelectedInstrument= nSelectedInstrument;
 		__selectedPatternNumber = selectedPatternNumber;
 	}
@@ -840,16 +863,16 @@ public:
 	{
 		//qDebug() << "fill notes Undo ";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionFillNotesUndoAction( __notePositions, __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, true );
 	}
 	virtual void redo()
 	{
 		//qDebug() << "fill notes Redo " ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionFillNotesRedoAction( __notePositions, __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, false );
 	}
 private:
-	QStringList __notePositions;
+	NoteDiff __diff;
 	int __nSelectedInstrument;
 	int __selectedPatternNumber;
 };
@@ -858,10 +881,9 @@ private:
 class SE_randomVelocityRightClickAction : public QUndoCommand
 {
 public:
-	SE_randomVelocityRightClickAction( QStringList noteVeloValue, QStringList oldNoteVeloValue, int nSelectedInstrument, int selectedPatternNumber  ){
+	SE_randomVelocityRightClickAction( const NoteDiff& diff, int nSelectedInstrument, int selectedPatternNumber  ){
 		setText( QObject::tr( "Random velocity" ) );
-		__noteVeloValue = noteVeloValue;
-		__oldNoteVeloValue = oldNoteVeloValue;
+		__diff = diff;
 		__nSelectedInstrument= nSelectedInstrument;
 		__selectedPatternNumber = selectedPatternNumber;
 	}
@@ -869,17 +891,32 @@ public:
 	{
 		//qDebug() << "Random velocity Undo ";
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionRandomVelocityAction( __oldNoteVeloValue, __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, true );
 	}
 	virtual void redo()
 	{
 		//qDebug() << "Random velocity Redo " ;
 		HydrogenApp* h2app = HydrogenApp::get_instance();
-		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionRandomVelocityAction( __noteVeloValue, __nSelectedInstrument, __selectedPatternNumber );
+		h2app->getPatternEditorPanel()->getDrumPatternEditor()->functionNoteDiffAction( __diff, __selectedPatternNumber, false );
+	}
+
+	virtual int id() const { return ID; }
+
+	//! Successive randomizations of the same instrument line are
+	//! undone in one go.
+	virtual bool mergeWith( const QUndoCommand* pOther )
+	{
+		const SE_randomVelocityRightClickAction* pAction =
+			static_cast< const SE_randomVelocityRightClickAction* >( pOther );
+		if ( pAction->__nSelectedInstrument != __nSelectedInstrument ||
+			 pAction->__selectedPatternNumber != __selectedPatternNumber ) {
+			return false;
+		}
+		return __diff.mergeWith( pAction->__diff );
 	}
 private:
-	QStringList __noteVeloValue;
-	QStringList __oldNoteVeloValue;
+	static const int ID = 1;
+	NoteDiff __diff;
 	int __nSelectedInstrument;
 	int __selectedPatternNumber;
 };
@@ -1390,8 +1427,36 @@ public:
 											__noteKeyVal,
 											__octaveKeyVal );
 	}
+
+	virtual int id() const { return ID; }
+
+	//! Successive edits of the same property of the notes in a single
+	//! column - like the steps of a scroll wheel gesture - are merged
+	//! into one, keeping the values prior to the first of them.
+	virtual bool mergeWith( const QUndoCommand* pOther )
+	{
+		const SE_editNotePropertiesVolumeAction* pAction =
+			static_cast< const SE_editNotePropertiesVolumeAction* >( pOther );
+		if ( pAction->__undoColumn != __undoColumn ||
+			 pAction->__mode != __mode ||
+			 pAction->__nSelectedPatternNumber != __nSelectedPatternNumber ||
+			 pAction->__nSelectedInstrument != __nSelectedInstrument ) {
+			return false;
+		}
+
+		__velocity = pAction->__velocity;
+		__pan_L = pAction->__pan_L;
+		__pan_R = pAction->__pan_R;
+		__leadLag = pAction->__leadLag;
+		__probability = pAction->__probability;
+		__noteKeyVal = pAction->__noteKeyVal;
+		__octaveKeyVal = pAction->__octaveKeyVal;
+		return true;
+	}
 private:
 
+	static const int ID = 2;
+
 
 	int __undoColumn;
 	QString __mode;
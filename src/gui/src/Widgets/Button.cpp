@@ -42,6 +42,7 @@ Button::Button( QWidget * pParent, const QString& sOnImage, const QString& sOffI
  , m_bMouseOver( false )
  , __use_skin_style(use_skin_style)
  , __enable_press_hold(enable_press_hold)
+ , m_fFacesRatio( 0 )
 {
 	// draw the background: slower but useful with transparent images!
 	//setAttribute(Qt::WA_OpaquePaintEvent);
@@ -169,6 +170,8 @@ void Button::buttonPressed_timer_timeout()
 void Button::setFontSize(int size)
 {
 	m_textFont.setPointSize(size);
+	invalidateFaces();
+	update();
 }
 
 void Button::setPressed(bool pressed)
@@ -200,63 +203,80 @@ void Button::leaveEvent(QEvent *ev)
 void Button::paintEvent( QPaintEvent* ev)
 {
 	QPainter painter(this);
+	const QPixmap& pixmap = face();
+	painter.drawPixmap( ev->rect(), pixmap,
+						QRectF( ev->rect().topLeft() * m_fFacesRatio,
+								ev->rect().size() * m_fFacesRatio ) );
+}
+
+
+
+void Button::resizeEvent( QResizeEvent* ev )
+{
+	UNUSED( ev );
+	invalidateFaces();
+}
+
+
+
+const QPixmap& Button::face()
+{
+	qreal fRatio = devicePixelRatioF();
+	if ( fRatio != m_fFacesRatio ) {
+		// e.g. moved to a screen of another resolution
+		invalidateFaces();
+		m_fFacesRatio = fRatio;
+	}
+
+	QPixmap& face = m_faces[ ( m_bPressed ? 2 : 0 ) + ( m_bMouseOver ? 1 : 0 ) ];
+	if ( face.isNull() ) {
+		face = QPixmap( size() * m_fFacesRatio );
+		face.setDevicePixelRatio( m_fFacesRatio );
+		face.fill( Qt::transparent );
+		renderFace( face, m_bPressed, m_bMouseOver );
+	}
+	return face;
+}
+
+
+
+void Button::invalidateFaces()
+{
+	for ( auto& face : m_faces ) {
+		face = QPixmap();
+	}
+}
+
+
+
+void Button::renderFace( QPixmap& face, bool bPressed, bool bMouseOver )
+{
+	QPainter painter( &face );
 
 	// background
-	if (m_bPressed) {
-		if (__use_skin_style) {
-			static int w = 5;
-			static int h = m_onPixmap.height();
+	const QPixmap* pBackground = &m_offPixmap;
+	if ( bPressed ) {
+		pBackground = &m_onPixmap;
+	}
+	else if ( bMouseOver ) {
+		pBackground = &m_overPixmap;
+	}
 
-			// central section, scaled
-			painter.drawPixmap( QRect(w, 0, width() - w * 2, h), m_onPixmap, QRect(10, 0, w, h) );
+	if (__use_skin_style) {
+		int w = 5;
+		int h = pBackground->height();
 
-			// left side
-			painter.drawPixmap( QRect(0, 0, w, h), m_onPixmap, QRect(0, 0, w, h) );
+		// central section, scaled
+		painter.drawPixmap( QRect(w, 0, width() - w * 2, h), *pBackground, QRect(10, 0, w, h) );
 
-			// right side
-			painter.drawPixmap( QRect(width() - w, 0, w, h), m_onPixmap, QRect(m_onPixmap.width() - w, 0, w, h) );
-		}
-		else {
-			painter.drawPixmap( ev->rect(), m_onPixmap, ev->rect() );
-		}
+		// left side
+		painter.drawPixmap( QRect(0, 0, w, h), *pBackground, QRect(0, 0, w, h) );
+
+		// right side
+		painter.drawPixmap( QRect(width() - w, 0, w, h), *pBackground, QRect(pBackground->width() - w, 0, w, h) );
 	}
 	else {
-		if (m_bMouseOver) {
-			if (__use_skin_style) {
-				static int w = 5;
-				static int h = m_overPixmap.height();
-
-				// central section, scaled
-				painter.drawPixmap( QRect(w, 0, width() - w * 2, h), m_overPixmap, QRect(10, 0, w, h) );
-
-				// left side
-				painter.drawPixmap( QRect(0, 0, w, h), m_overPixmap, QRect(0, 0, w, h) );
-
-				// right side
-				painter.drawPixmap( QRect(width() - w, 0, w, h), m_overPixmap, QRect(m_overPixmap.width() - w, 0, w, h) );
-			}
-			else {
-				painter.drawPixmap( ev->rect(), m_overPixmap, ev->rect() );
-			}
-		}
-		else {
-			if (__use_skin_style) {
-				static int w = 5;
-				static int h = m_offPixmap.height();
-
-				// central section, scaled
-				painter.drawPixmap( QRect(w, 0, width() - w * 2, h), m_offPixmap, QRect(10, 0, w, h) );
-
-				// left side
-				painter.drawPixmap( QRect(0, 0, w, h), m_offPixmap, QRect(0, 0, w, h) );
-
-				// right side
-				painter.drawPixmap( QRect(width() - w, 0, w, h), m_offPixmap, QRect(m_offPixmap.width() - w, 0, w, h) );
-			}
-			else {
-				painter.drawPixmap( ev->rect(), m_offPixmap, ev->rect() );
-			}
-		}
+		painter.drawPixmap( rect(), *pBackground, rect() );
 	}
 
 
@@ -266,7 +286,7 @@ void Button::paintEvent( QPaintEvent* ev)
 		QColor shadow(150, 150, 150, 100);
 		QColor text(10, 10, 10);
 
-		if (m_bMouseOver) {
+		if (bMouseOver) {
 			shadow = QColor(220, 220, 220, 100);
 		}
 
@@ -286,7 +306,11 @@ void Button::paintEvent( QPaintEvent* ev)
 
 void Button::setText( const QString& sText )
 {
+	if ( sText == m_sText ) {
+		return;
+	}
 	m_sText = sText;
+	invalidateFaces();
 	update();
 }
 
@@ -93,11 +93,25 @@ class Button : public QWidget, public H2Core::Object, public MidiLearnable
 		void enterEvent(QEvent *ev);
 		void leaveEvent(QEvent *ev);
 		void paintEvent( QPaintEvent* ev);
+		void resizeEvent( QResizeEvent* ev );
 
 		QTimer *m_timer;
 		int m_timerTimeout;
 
+		/** Composed background and text of the button for all
+			combinations of being pressed and hovered, rendered at
+			#m_fFacesRatio. A null pixmap is rendered on demand.*/
+		QPixmap m_faces[ 4 ];
+		qreal m_fFacesRatio;
+
 		bool loadImage( const QString& sFilename, QPixmap& pixmap );
+		/** \return Face of the current state, rendering it if
+			required.*/
+		const QPixmap& face();
+		void renderFace( QPixmap& face, bool bPressed, bool bMouseOver );
+		/** Drops all faces. Has to be called whenever the look of
+			the button changes.*/
+		void invalidateFaces();
 };
 
 
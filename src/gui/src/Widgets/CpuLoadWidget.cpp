@@ -23,6 +23,7 @@
 
 #include "CpuLoadWidget.h"
 #include <core/Hydrogen.h>
+#include <core/OverloadGovernor.h>
 
 #include "../Skin.h"
 #include "../HydrogenApp.h"
@@ -68,7 +69,8 @@ CpuLoadWidget::CpuLoadWidget( QWidget *pParent )
 	connect( timer, SIGNAL( timeout() ), this, SLOT( updateCpuLoadWidget() ) );
 	timer->start(200);	// update player control at 5 fps
 
-	HydrogenApp::get_instance()->addEventListener( this );
+	HydrogenApp::get_instance()->addEventListener( this, { H2Core::EVENT_XRUN,
+												   H2Core::EVENT_OVERLOAD_LEVEL } );
 }
 
 
@@ -163,3 +165,22 @@ void CpuLoadWidget::XRunEvent()
 
 
 
+void CpuLoadWidget::overloadLevelEvent( int nValue )
+{
+	H2Core::OverloadGovernor::Level level =
+		static_cast<H2Core::OverloadGovernor::Level>( nValue );
+	QString sLevel = H2Core::OverloadGovernor::getLevelName( level );
+
+	if ( level == H2Core::OverloadGovernor::LEVEL_FULL ) {
+		setToolTip( "" );
+		HydrogenApp::get_instance()->setStatusBarMessage(
+			tr( "Audio engine recovered. Rendering at full quality" ), 5000 );
+	} else {
+		setToolTip( tr( "Reduced rendering quality: %1" ).arg( sLevel ) );
+		HydrogenApp::get_instance()->setStatusBarMessage(
+			tr( "Audio engine overloaded. Reduced rendering quality: %1" ).arg( sLevel ), 5000 );
+	}
+}
+
+
+
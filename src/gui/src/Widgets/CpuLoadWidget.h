@@ -51,6 +51,9 @@ class CpuLoadWidget : public QWidget, public EventListener, public H2Core::Objec
 		void paintEvent(QPaintEvent *ev);
 
 		void XRunEvent();
+		/** Shows the rendering quality chosen by the
+			H2Core::OverloadGovernor.*/
+		virtual void overloadLevelEvent( int nValue ) override;
 
 	public slots:
 		void updateCpuLoadWidget();
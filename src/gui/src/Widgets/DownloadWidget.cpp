@@ -22,6 +22,9 @@
 
 #include "DownloadWidget.h"
 
+#include <core/Basics/DrumkitInstaller.h>
+
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <QNetworkReply>
@@ -30,7 +33,8 @@
 
 const char* Download::__class_name = "Download";
 
-Download::Download( QWidget* pParent, const QString& download_url, const QString& local_file )
+Download::Download( QWidget* pParent, const QString& download_url, const QString& local_file,
+					const headers_t& headers )
 		: QDialog( pParent )
 		, Object( __class_name )
 		, __download_percent( 0 )
@@ -41,6 +45,13 @@ Download::Download( QWidget* pParent, const QString& download_url, const QString
 		, __local_file( local_file )
 		, __reply(nullptr)
 		, __error( "" )
+		, __installer( nullptr )
+		, __hash( QCryptographicHash::Sha256 )
+		, __bytes_received( 0 )
+		, __not_modified( false )
+		, __rate_limit( 0 )
+		, __budget( 0 )
+		, __budget_timer( nullptr )
 {
 	if ( !__local_file.isEmpty() ) {
 		INFOLOG( QString( "Downloading '%1' in '%2'" ).arg( __remote_url.toString() ).arg( __local_file ) );
@@ -73,26 +84,145 @@ Download::Download( QWidget* pParent, const QString& download_url, const QString
 	QNetworkRequest getReq;
 	getReq.setUrl( __remote_url );
 	getReq.setRawHeader( "User-Agent" , "Hydrogen" );
+	for ( const auto& header : headers ) {
+		getReq.setRawHeader( header.first, header.second );
+	}
 
 	__reply = __http_client->get( getReq );
 
 	connect(__reply, SIGNAL(finished()),this, SLOT(finished()));
 	connect(__reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(downloadProgress(qint64,qint64)));
+	connect(__reply, SIGNAL(readyRead()), this, SLOT(readyRead()));
 }
 
 
 
 Download::~Download()
 {
+	if ( __file.isOpen() ) {
+		// Aborted before finishing.
+		__file.close();
+		__file.remove();
+	}
+}
+
+void Download::set_rate_limit( int nBytesPerSecond )
+{
+	__rate_limit = std::max( nBytesPerSecond, 0 );
+	if ( __rate_limit == 0 ) {
+		__reply->setReadBufferSize( 0 );
+		if ( __budget_timer != nullptr ) {
+			__budget_timer->stop();
+		}
+		return;
+	}
+
+	// The budget is refilled ten times a second. The reply stops
+	// reading from the socket once its buffer is full.
+	__reply->setReadBufferSize( std::max( __rate_limit / 10, 4096 ) );
+	if ( __budget_timer == nullptr ) {
+		__budget_timer = new QTimer( this );
+		connect( __budget_timer, SIGNAL( timeout() ), this, SLOT( refillBudget() ) );
+	}
+	__budget = __rate_limit / 10;
+	__budget_timer->start( 100 );
+}
+
+void Download::refillBudget()
+{
+	__budget = std::min( __budget + __rate_limit / 10,
+						 static_cast<qint64>( __rate_limit / 5 ) );
+	consume( false );
+}
+
+void Download::readyRead()
+{
+	consume( false );
+}
+
+void Download::consume( bool bAll )
+{
+	if ( ! is_success() ) {
+		return;
+	}
+	qint64 nAvailable = __reply->bytesAvailable();
+	if ( ! bAll && __rate_limit > 0 ) {
+		nAvailable = std::min( nAvailable, __budget );
+	}
+	if ( nAvailable <= 0 ) {
+		return;
+	}
+	QByteArray data = __reply->read( nAvailable );
+	__budget -= data.size();
+	deliver( data );
+}
+
+void Download::deliver( const QByteArray& data )
+{
+	if ( data.isEmpty() || ! __error.isEmpty() ) {
+		return;
+	}
+	__hash.addData( data );
+	__bytes_received += data.size();
+
+	if ( __installer != nullptr ) {
+		__installer->feed( data );
+	} else if ( __local_file.isEmpty() ) {
+		// store the text received only when not using the file.
+		__content.append( data );
+	} else {
+		// The file is written as the data arrives instead of
+		// keeping the whole download in memory.
+		if ( ! __file.isOpen() ) {
+			__file.setFileName( __local_file );
+			if ( ! __file.open( QIODevice::WriteOnly ) ) {
+				ERRORLOG( QString( "Unable to save %1" ).arg( __local_file ) );
+				__error = QString( tr( "Unable to save %1" ) ).arg( __local_file );
+				return;
+			}
+		}
+		if ( __file.write( data ) != data.size() ) {
+			ERRORLOG( QString( "Unable to save %1" ).arg( __local_file ) );
+			__error = QString( tr( "Unable to save %1" ) ).arg( __local_file );
+		}
+	}
+}
+
+void Download::fail( const QString& sError )
+{
+	__error = sError;
+	ERRORLOG( __error );
+	if ( __file.isOpen() ) {
+		__file.close();
+		__file.remove();
+	}
+	reject();
+}
+
+bool Download::is_success() const
+{
+	int nStatus = __reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+	return nStatus >= 200 && nStatus < 300;
+}
+
+QByteArray Download::get_response_header( const QByteArray& name ) const
+{
+	return __reply->rawHeader( name );
+}
+
+QString Download::get_sha256() const
+{
+	return QString( __hash.result().toHex() );
 }
 
-/// TODO: I have to save the file to disk on a temporary dir and then move it if everything is ok.
 void Download::finished()
 {
+	if ( __budget_timer != nullptr ) {
+		__budget_timer->stop();
+	}
+
 	if ( __reply->error() ) {
-		__error = QString( tr( "Importing item failed: %1" ) ).arg( __reply->errorString() );
-		ERRORLOG( __error );
-		reject();
+		fail( QString( tr( "Importing item failed: %1" ) ).arg( __reply->errorString() ) );
 		return;
 	}
 
@@ -100,6 +230,12 @@ void Download::finished()
 	int StatusAttribute = __reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 	if(StatusAttribute >= 200 && StatusAttribute < 300){
 		//do nothing, handling will be done later..
+	} else if ( StatusAttribute == 304 ) {
+		// The copy of the caller is still up to date.
+		INFOLOG( QString( "'%1' not modified" ).arg( __remote_url.toString() ) );
+		__not_modified = true;
+		accept();
+		return;
 	} else if(StatusAttribute >= 300 && StatusAttribute < 400){
 		QVariant RedirectAttribute = __reply->attribute(QNetworkRequest::RedirectionTargetAttribute);
 
@@ -114,21 +250,31 @@ void Download::finished()
 		}
 	}
 
-	INFOLOG( "Download completed. " );
+	// Whatever the rate limit held back.
+	consume( true );
 
-	if ( __local_file.isEmpty() ) {
-		// store the text received only when not using the file.
-		__feed_xml_string = QString( __reply->readAll() );
-	} else {
-		QFile file( __local_file );
+	qint64 nExpected = __reply->header( QNetworkRequest::ContentLengthHeader ).toLongLong();
+	if ( __error.isEmpty() && nExpected > 0 && __bytes_received != nExpected ) {
+		__error = QString( tr( "Incomplete download: %1 of %2 bytes" ) )
+			.arg( __bytes_received ).arg( nExpected );
+	}
+	if ( ! __error.isEmpty() ) {
+		fail( __error );
+		return;
+	}
 
-		if ( !file.open( QIODevice::WriteOnly ) ) {
-			ERRORLOG( QString( "Unable to save %1" ).arg( __local_file ) );
-		} else {
-			file.write(__reply->readAll());
-			file.flush();
-			file.close();
+	INFOLOG( "Download completed. " );
+
+	if ( __installer == nullptr && __local_file.isEmpty() ) {
+		__feed_xml_string = QString( __content );
+	} else if ( __installer == nullptr ) {
+		if ( ! __file.isOpen() ) {
+			// Empty file.
+			__file.setFileName( __local_file );
+			__file.open( QIODevice::WriteOnly );
 		}
+		__file.flush();
+		__file.close();
 	}
 	accept();
 }
@@ -148,8 +294,9 @@ void Download::downloadProgress( qint64 done, qint64 total )
 
 
 
-DownloadWidget::DownloadWidget( QWidget* parent, const QString& title, const QString& __remote_url, const QString& local_file )
-		: Download( parent, __remote_url, local_file )
+DownloadWidget::DownloadWidget( QWidget* parent, const QString& title, const QString& __remote_url, const QString& local_file,
+								const headers_t& headers )
+		: Download( parent, __remote_url, local_file, headers )
 {
 	setWindowTitle( title );
 	setModal( true );
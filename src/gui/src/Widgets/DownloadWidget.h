@@ -32,22 +32,68 @@
 class QNetworkAccessManager;
 class QNetworkReply;
 
+namespace H2Core {
+	class DrumkitInstaller;
+}
+
+/**
+ * Downloads a file or a text feed.
+ *
+ * The data is stored in @a local_file as it arrives, kept in memory
+ * for get_xml_content(), or handed to a DrumkitInstaller. Without a
+ * parent widget being shown it can be used without its own window,
+ * e.g. to run several downloads at once. The dialog is accepted once
+ * the transfer finished successfully and rejected otherwise.
+ */
 class Download : public QDialog, public H2Core::Object
 {
 	H2_OBJECT
 	Q_OBJECT
 
 public:
-	Download( QWidget* parent, const QString& download_url, const QString& local_file );
+	/** Additional HTTP request headers, e.g. for conditional
+		requests.*/
+	typedef QList<QPair<QByteArray, QByteArray>> headers_t;
+
+	Download( QWidget* parent, const QString& download_url, const QString& local_file,
+			  const headers_t& headers = headers_t() );
 	~Download();
 
 	int get_percent_done() {	return (int)__download_percent;	}
 	const QString& get_xml_content() {	return __feed_xml_string;	}
 	const QString& get_error() { return __error; }
+	QUrl get_redirect_url() {	return __redirect_url;	}
+	/** \return whether the server answered a conditional request
+		with "304 Not Modified". Nothing was stored in that case.*/
+	bool is_not_modified() const { return __not_modified; }
+	/** \return value of the response header @a name, e.g. "ETag".*/
+	QByteArray get_response_header( const QByteArray& name ) const;
+	/** \return SHA-256 of the received data as hex string.*/
+	QString get_sha256() const;
+
+	/**
+	 * Hands the received data to @a pInstaller while the transfer
+	 * is still running instead of storing it. Responses other than
+	 * a success, like redirects, are not passed on.
+	 *
+	 * \param pInstaller installer to feed, nullptr to store the
+	 * data as usual
+	 */
+	void set_installer( H2Core::DrumkitInstaller* pInstaller ) { __installer = pInstaller; }
+	/**
+	 * Limits the rate the data is read with. The network access
+	 * itself is throttled as well, since the reply does not buffer
+	 * more than a fraction of a second.
+	 *
+	 * \param nBytesPerSecond maximum rate, 0 for none
+	 */
+	void set_rate_limit( int nBytesPerSecond );
 
 private slots:
 	void	finished();
 	void	downloadProgress( qint64 done, qint64 total );
+	void	readyRead();
+	void	refillBudget();
 
 protected:
 	QNetworkAccessManager*	__http_client;
@@ -68,6 +114,30 @@ protected:
 	QString					__feed_xml_string;
 
 	QString					__error;
+
+	H2Core::DrumkitInstaller*	__installer;
+
+private:
+	/** \return whether the response is a success, whose content is
+		meant to be kept.*/
+	bool is_success() const;
+	/** Reads as much of the available data as the rate limit
+		allows. @a bAll ignores the limit.*/
+	void consume( bool bAll );
+	/** Stores @a data according to the mode of the download.*/
+	void deliver( const QByteArray& data );
+	/** Rejects the download with the error @a sError and removes
+		the partially written file.*/
+	void fail( const QString& sError );
+
+	QFile					__file;
+	QByteArray				__content;
+	QCryptographicHash		__hash;
+	qint64					__bytes_received;
+	bool					__not_modified;
+	int						__rate_limit;
+	qint64					__budget;
+	QTimer*					__budget_timer;
 };
 
 
@@ -78,11 +148,10 @@ class DownloadWidget : public Download
 	Q_OBJECT
 
 public:
-	DownloadWidget( QWidget* parent, const QString& title, const QString& download_url, const QString& local_file = "" );
+	DownloadWidget( QWidget* parent, const QString& title, const QString& download_url, const QString& local_file = "",
+					const headers_t& headers = headers_t() );
 	~DownloadWidget();
 
-	QUrl get_redirect_url() {	return __redirect_url;	}
-
 private slots:
 	void updateStats();
 
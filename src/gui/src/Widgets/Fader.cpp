@@ -29,6 +29,9 @@
 #include <QtGui>
 #include <QtWidgets>
 
+#include <algorithm>
+#include <cstdlib>
+
 #include <core/Globals.h>
 
 const char* Fader::__class_name = "Fader";
@@ -227,8 +230,9 @@ void Fader::setPeak_L( float fPeak )
 	}
 
 	if ( m_fPeakValue_L != fPeak) {
+		float fOld = m_fPeakValue_L;
 		m_fPeakValue_L = fPeak;
-		update();
+		updateMeter( 0, fOld, fPeak );
 	}
 }
 
@@ -248,8 +252,42 @@ void Fader::setPeak_R( float fPeak )
 	}
 
 	if ( m_fPeakValue_R != fPeak ) {
+		float fOld = m_fPeakValue_R;
 		m_fPeakValue_R = fPeak;
-		update();
+		updateMeter( 1, fOld, fPeak );
+	}
+}
+
+
+
+int Fader::peakRow( float fPeak ) const
+{
+	float realPeak = fPeak - m_fMinPeak;
+	int nRow = 116 - ( realPeak / ( m_fMaxPeak - m_fMinPeak ) ) * 116.0;
+	if ( nRow > 116 ) {
+		nRow = 116;
+	}
+	return nRow;
+}
+
+
+
+QRect Fader::meterRect( int nChannel, int nRowA, int nRowB ) const
+{
+	return QRect( 11 * nChannel, std::min( nRowA, nRowB ), 11, std::abs( nRowA - nRowB ) );
+}
+
+
+
+void Fader::updateMeter( int nChannel, float fOld, float fNew )
+{
+	// Meters are updated at a high rate for all strips of the mixer.
+	// Most of the time the lit part does not change at all or by a
+	// few pixels only.
+	int nOldRow = peakRow( fOld );
+	int nNewRow = peakRow( fNew );
+	if ( nOldRow != nNewRow ) {
+		update( meterRect( nChannel, nOldRow, nNewRow ) );
 	}
 }
 
@@ -266,20 +304,11 @@ void Fader::paintEvent( QPaintEvent *ev)
 
 
 
-	float realPeak_L = m_fPeakValue_L - m_fMinPeak;
-	int peak_L = 116 - ( realPeak_L / ( m_fMaxPeak - m_fMinPeak ) ) * 116.0;
-
-	if ( peak_L > 116 ) {
-		peak_L = 116;
-	}
+	int peak_L = peakRow( m_fPeakValue_L );
 	painter.drawPixmap( QRect( 0, peak_L, 11, 116 - peak_L ), m_leds, QRect( 0, peak_L, 11, 116 - peak_L ) );
 
 
-	float realPeak_R = m_fPeakValue_R - m_fMinPeak;
-	int peak_R = 116 - ( realPeak_R / ( m_fMaxPeak - m_fMinPeak ) ) * 116.0;
-	if ( peak_R > 116 ) {
-		peak_R = 116;
-	}
+	int peak_R = peakRow( m_fPeakValue_R );
 	painter.drawPixmap( QRect( 11, peak_R, 11, 116 - peak_R ), m_leds, QRect( 11, peak_R, 11, 116 - peak_R ) );
 
 	if ( m_bWithoutKnob == false ) {
@@ -408,20 +437,11 @@ void VerticalFader::paintEvent( QPaintEvent *ev)
 	painter.drawPixmap( ev->rect(), m_back, ev->rect() );
 
 
-	float realPeak_L = m_fPeakValue_L - m_fMinPeak;
-	int peak_L = 116 - ( realPeak_L / ( m_fMaxPeak - m_fMinPeak ) ) * 116.0;
-	
-	if ( peak_L > 116 ) {
-		peak_L = 116;
-	}
+	int peak_L = peakRow( m_fPeakValue_L );
 	painter.drawPixmap( QRect( 0, 0, 116 - peak_L, 11 ), m_leds, QRect( 0, 0, 116 - peak_L, 11 ) );
 
 
-	float realPeak_R = m_fPeakValue_R - m_fMinPeak;
-	int peak_R = 116 - ( realPeak_R / ( m_fMaxPeak - m_fMinPeak ) ) * 116.0;
-	if ( peak_R > 116 ) {
-		peak_R = 116;
-	}
+	int peak_R = peakRow( m_fPeakValue_R );
 	painter.drawPixmap( QRect( 0, 11, 116 - peak_R, 11 ), m_leds, QRect( 0, 11, 116 - peak_R, 11 ) );
 
 	if ( m_bWithoutKnob == false ) {
@@ -439,6 +459,11 @@ void VerticalFader::paintEvent( QPaintEvent *ev)
 	}
 }
 
+QRect VerticalFader::meterRect( int nChannel, int nRowA, int nRowB ) const
+{
+	return QRect( 116 - std::max( nRowA, nRowB ), 11 * nChannel, std::abs( nRowA - nRowB ), 11 );
+}
+
 //////////////////////////////////
 
 const char* MasterFader::__class_name = "MasterFader";
@@ -613,8 +638,12 @@ void MasterFader::setPeak_L( float peak )
 	}
 
 	if ( m_fPeakValue_L != peak ) {
+		int nOld = peakOffset( m_fPeakValue_L );
 		m_fPeakValue_L = peak;
-		update();
+		int nNew = peakOffset( peak );
+		if ( nOld != nNew ) {
+			update( 0, std::min( nOld, nNew ), 9, std::abs( nOld - nNew ) );
+		}
 	}
 }
 
@@ -634,13 +663,24 @@ void MasterFader::setPeak_R( float peak )
 	}
 
 	if ( m_fPeakValue_R != peak ) {
+		int nOld = peakOffset( m_fPeakValue_R );
 		m_fPeakValue_R = peak;
-		update();
+		int nNew = peakOffset( peak );
+		if ( nOld != nNew ) {
+			update( 9, std::min( nOld, nNew ), 9, std::abs( nOld - nNew ) );
+		}
 	}
 }
 
 
 
+int MasterFader::peakOffset( float fPeak )
+{
+	return (uint)( 190.0 - fPeak * 190.0 );
+}
+
+
+
 void MasterFader::paintEvent( QPaintEvent* ev )
 {
 	QPainter painter(this);
@@ -649,12 +689,10 @@ void MasterFader::paintEvent( QPaintEvent* ev )
 	painter.drawPixmap( ev->rect(), m_back, ev->rect() );
 
 	// leds
-	float peak_L = m_fPeakValue_L * 190.0;
-	uint offset_L = (uint)( 190.0 - peak_L );
+	uint offset_L = peakOffset( m_fPeakValue_L );
 	painter.drawPixmap( QRect( 0, offset_L, 9, 190 - offset_L), m_leds, QRect( 0, offset_L, 9, 190 - offset_L) );
 
-	float peak_R = m_fPeakValue_R * 190.0;
-	uint offset_R = (uint)( 190.0 - peak_R );
+	uint offset_R = peakOffset( m_fPeakValue_R );
 	painter.drawPixmap( QRect( 9, offset_R, 9, 190 - offset_R), m_leds, QRect( 9, offset_R, 9, 190 - offset_R) );
 
 	if (m_bWithoutKnob == false) {
@@ -740,8 +778,7 @@ void Knob::paintEvent( QPaintEvent* ev )
 
 	QPainter painter(this);
 
-	int nFrame = (int)(31.0 * m_fValue);
-	int xPos = m_nWidgetWidth * nFrame;
+	int xPos = m_nWidgetWidth * getFrame( m_fValue );
 //	bitBlt(&m_temp, 0, 0, m_background, xPos, 0, m_nWidgetWidth, m_nWidgetHeight, CopyROP);
 	painter.drawPixmap( rect(), *m_background, QRect( xPos, 0, m_nWidgetWidth, m_nWidgetHeight ) );
 }
@@ -764,13 +801,24 @@ void Knob::setValue( float fValue )
 	}
 
 	if ( fValue != m_fValue ) {
+		// Values sharing a frame of the image look the same.
+		bool bChanged = getFrame( fValue ) != getFrame( m_fValue );
 		m_fValue = fValue;
-		update();
+		if ( bChanged ) {
+			update();
+		}
 	}
 }
 
 
 
+int Knob::getFrame( float fValue )
+{
+	return (int)(31.0 * fValue);
+}
+
+
+
 void Knob::setDefaultValue( float fDefaultValue )
 {
 	if ( fDefaultValue == m_fDefaultValue ) {
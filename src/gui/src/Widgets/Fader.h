@@ -91,6 +91,17 @@ class Fader : public QWidget, public H2Core::Object, public MidiLearnable
 		QPixmap m_back;
 		QPixmap m_leds;
 		QPixmap m_knob;
+
+		/** \return Number of unlit pixels of a meter showing @a fPeak.*/
+		int peakRow( float fPeak ) const;
+		/** \return Area of the meter of channel @a nChannel (0 for
+			left, 1 for right) between the rows @a nRowA and @a nRowB
+			as returned by peakRow(). Only this area is repainted when
+			the peak changes.*/
+		virtual QRect meterRect( int nChannel, int nRowA, int nRowB ) const;
+		/** Repaints the part of the meter changed by setting the peak
+			of channel @a nChannel from @a fOld to @a fNew, if any.*/
+		void updateMeter( int nChannel, float fOld, float fNew );
 };
 
 class VerticalFader : public Fader
@@ -103,6 +114,9 @@ public:
 		
 		virtual void paintEvent(QPaintEvent *ev) override;
 		virtual void mouseMoveEvent(QMouseEvent *ev) override;	
+
+protected:
+		virtual QRect meterRect( int nChannel, int nRowA, int nRowB ) const override;
 };
 
 
@@ -158,7 +172,8 @@ class MasterFader : public QWidget, public H2Core::Object, public MidiLearnable
 		QPixmap m_leds;
 		QPixmap m_knob;
 
-
+		/** \return First lit row of a meter showing @a fPeak.*/
+		static int peakOffset( float fPeak );
 };
 
 
@@ -186,6 +201,9 @@ class Knob : public QWidget, public H2Core::Object, public MidiLearnable
 		static QPixmap *m_background;
 		bool m_bIgnoreMouseMove;
 
+		/** \return Frame of #m_background showing @a fValue.*/
+		static int getFrame( float fValue );
+
 		int m_nWidgetWidth;
 		int m_nWidgetHeight;
 
@@ -162,15 +162,23 @@ void LCDDigit::set( char ch )
 			'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', ' ', ' ',
 			'-', ':', '/', '\\', ',', ';', '.', ' ', ' ', ' ', '#'
 	};
+	int nCol = m_nCol;
+	int nRow = m_nRow;
 	for ( int n = 0; n < 77; n++ ) { //73
 		if ( keymap[ n ] == ch ) {
-			m_nCol = n % MAXCOL;
-			m_nRow = n / MAXCOL;
+			nCol = n % MAXCOL;
+			nRow = n / MAXCOL;
 			break;
 		}
 	}
 
-	update();
+	// Displays are refreshed as a whole, mostly changing only a
+	// few of their digits.
+	if ( nCol != m_nCol || nRow != m_nRow ) {
+		m_nCol = nCol;
+		m_nRow = nRow;
+		update();
+	}
 }
 
 
@@ -257,14 +265,13 @@ void LCDDisplay::setText( const QString& sMsg )
 	}
 
 	m_sMsg = sMsg;
-	int nLen = sMsg.length();
-
-
+	const QByteArray sChars = sMsg.toLocal8Bit();
+	int nLen = sChars.length();
 
 	if ( m_bLeftAlign ) {
 		for ( int i = 0; i < (int)m_pDisplay.size(); ++i ) {
 			if ( i < nLen ) {
-                            m_pDisplay[ i ]->set( sMsg.toLocal8Bit().at(i) );
+				m_pDisplay[ i ]->set( sChars.at(i) );
 			}
 			else {
 				m_pDisplay[ i ]->set( ' ' );
@@ -286,7 +293,7 @@ void LCDDisplay::setText( const QString& sMsg )
 		}
 
 		for ( int i = 0; i < nLen; i++ ) {
-			m_pDisplay[ i + nPadding ]->set( sMsg.toLocal8Bit().at(i) );
+			m_pDisplay[ i + nPadding ]->set( sChars.at(i) );
 		}
 	}
 }
@@ -58,7 +58,7 @@ MidiActivityWidget::MidiActivityWidget( QWidget * parent )
 		ERRORLOG( "Error loading pixmap" );
 	}
 
-	HydrogenApp::get_instance()->addEventListener(this);
+	HydrogenApp::get_instance()->addEventListener( this, { H2Core::EVENT_MIDI_ACTIVITY } );
 	m_qTimer = new QTimer(this);
 	connect( m_qTimer, SIGNAL( timeout() ), this, SLOT( restoreMidiActivityWidget() ) );
 
@@ -125,8 +125,21 @@ void Rotary::paintEvent( QPaintEvent* ev )
 	UNUSED( ev );
 	QPainter painter(this);
 
+	int xPos = m_nWidgetWidth * getFrame( m_fValue );
+	if ( m_type == TYPE_NORMAL ) {
+		painter.drawPixmap( rect(), *m_background_normal, QRect( xPos, 0, m_nWidgetWidth, m_nWidgetHeight ) );
+	}
+	else {
+		painter.drawPixmap( rect(), *m_background_center, QRect( xPos, 0, m_nWidgetWidth, m_nWidgetHeight ) );
+	}
+}
+
+
+
+int Rotary::getFrame( float fValue ) const
+{
 	float fRange = fabs( m_fMax ) + fabs( m_fMin );
-	float fValue = fabs( m_fMin ) + m_fValue;
+	fValue += fabs( m_fMin );
 
 	int nFrame;
 	if ( m_bUseIntSteps ) {
@@ -136,24 +149,11 @@ void Rotary::paintEvent( QPaintEvent* ev )
 		nFrame = (int)( 63.0 * ( fValue / fRange ) );
 	}
 
-//	INFOLOG( "\nrange: " + toString( fRange ) );
-//	INFOLOG( "norm value: " + toString( fValue ) );
-//	INFOLOG( "frame: " + toString( nFrame ) );
-
-	if ( m_type == TYPE_NORMAL ) {
-
-		int xPos = m_nWidgetWidth * nFrame;
-		painter.drawPixmap( rect(), *m_background_normal, QRect( xPos, 0, m_nWidgetWidth, m_nWidgetHeight ) );
-	}
-	else {
-		// the image is broken...
-		if ( nFrame > 62 ) {
-			nFrame = 62;
-		}
-		int xPos = m_nWidgetWidth * nFrame;
-		painter.drawPixmap( rect(), *m_background_center, QRect( xPos, 0, m_nWidgetWidth, m_nWidgetHeight ) );
-
+	// the image of the center type is broken...
+	if ( m_type != TYPE_NORMAL && nFrame > 62 ) {
+		nFrame = 62;
 	}
+	return nFrame;
 }
 
 
@@ -172,8 +172,13 @@ void Rotary::setValue( float fValue )
 	}
 
 	if ( fValue != m_fValue ) {
+		// The knob is moved by a lot of small steps, most of which
+		// do not reach the next frame of the image.
+		bool bChanged = getFrame( fValue ) != getFrame( m_fValue );
 		m_fValue = fValue;
-		update();
+		if ( bChanged ) {
+			update();
+		}
 	}
 }
 
@@ -112,6 +112,10 @@ class Rotary : public QWidget, public H2Core::Object, public MidiLearnable
 		virtual void mouseReleaseEvent( QMouseEvent *ev );
 		virtual void mouseMoveEvent(QMouseEvent *ev);
 		virtual void wheelEvent( QWheelEvent *ev );
+
+		/** \return Frame of the background image showing
+			@a fValue.*/
+		int getFrame( float fValue ) const;
 };
 
 
@@ -52,6 +52,7 @@
 #include <core/Basics/Playlist.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/Helpers/Translations.h>
+#include <core/Tracer.h>
 
 #ifdef H2CORE_HAVE_OSC
 #include <core/NsmClient.h>
@@ -243,6 +244,7 @@ int main(int argc, char *argv[])
 		QCommandLineOption verboseOption( QStringList() << "V" << "verbose", "Level, if present, may be None, Error, Warning, Info, Debug or 0xHHHH","Level");
 		QCommandLineOption shotListOption( QStringList() << "t" << "shotlist", "Shot list of widgets to grab", "ShotList" );
 		QCommandLineOption uiLayoutOption( QStringList() << "layout", "UI layout ('tabbed' or 'single')", "Layout" );
+		QCommandLineOption traceOption( QStringList() << "T" << "trace", "Record a timeline of the engine, driver, and GUI threads and write it as Chrome trace JSON on exit", "File" );
 		
 		parser.addHelpOption();
 		parser.addVersionOption();
@@ -256,6 +258,7 @@ int main(int argc, char *argv[])
 		parser.addOption( verboseOption );
 		parser.addOption( shotListOption );
 		parser.addOption( uiLayoutOption );
+		parser.addOption( traceOption );
 		parser.addPositionalArgument( "file", "Song, playlist or Drumkit file" );
 		
 		//Conditional options
@@ -276,6 +279,7 @@ int main(int argc, char *argv[])
 		QString sVerbosityString = parser.value( verboseOption );
 		QString sShotList = parser.value( shotListOption );
 		QString sUiLayout = parser.value( uiLayoutOption );
+		QString sTraceFilename = parser.value( traceOption );
 		
 		unsigned logLevelOpt = H2Core::Logger::Error;
 		if( parser.isSet(verboseOption) ){
@@ -312,6 +316,11 @@ int main(int argc, char *argv[])
 		
 		setup_unix_signal_handlers();
 
+		// Enabled before any thread gets started.
+		if ( ! sTraceFilename.isEmpty() ) {
+			H2Core::Tracer::setEnabled( true );
+		}
+
 		// Man your battle stations... this is not a drill.
 		H2Core::Logger::create_instance();
 		H2Core::Logger::set_bit_mask( logLevelOpt );
@@ -504,8 +513,19 @@ int main(int argc, char *argv[])
 		pPref->setJackSessionApplicationPath( path );
 #endif
 
+		// The Song the MainForm is going to open. Under session
+		// management it is chosen by the NSM client instead and a
+		// playlist brings its own.
+		QString sStartupSong;
+		if ( ! getenv( "NSM_URL" ) && sPlaylistFilename.isEmpty() ) {
+			sStartupSong = sSongFilename;
+			if ( sStartupSong.isEmpty() && pPref->isRestoreLastSongEnabled() ) {
+				sStartupSong = pPref->getLastSongFilename();
+			}
+		}
+
 		// Hydrogen here to honor all preferences.
-		H2Core::Hydrogen::create_instance();
+		H2Core::Hydrogen::create_instance( sStartupSong );
 		
 		// Tell Hydrogen it was started via the QT5 GUI.
 		H2Core::Hydrogen::get_instance()->setGUIState( H2Core::Hydrogen::GUIState::notReady );
@@ -578,6 +598,14 @@ int main(int argc, char *argv[])
 
 		pQApp->exec();
 
+		if ( ! sTraceFilename.isEmpty() ) {
+			if ( H2Core::Tracer::dump( sTraceFilename ) ) {
+				___INFOLOG( QString( "Trace written to [%1]" ).arg( sTraceFilename ) );
+			} else {
+				___ERRORLOG( QString( "Unable to write trace to [%1]" ).arg( sTraceFilename ) );
+			}
+		}
+
 		delete pSplash;
 		delete pMainForm;
 		delete pQApp;
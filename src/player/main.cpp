@@ -20,9 +20,26 @@
  *
  */
 
+/*
+ * Headless playback daemon for stage use.
+ *
+ * All songs of a set - given as .h2song files or .h2playlist
+ * playlists - have their samples decoded into the SamplePool at
+ * startup and held till shutdown. Switching between the songs via
+ * OSC (/Hydrogen/PLAYLIST_SONG and friends), MIDI program changes, or
+ * the commands read from the standard input does therefore only parse
+ * the song file. Neither a GUI nor the drumkit and pattern library
+ * indexes are created.
+ */
+
 #include <iostream>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <core/Object.h>
 #include <core/Hydrogen.h>
@@ -30,18 +47,192 @@
 #include <core/FX/Effects.h>
 #include <core/EventQueue.h>
 #include <core/AudioEngine.h>
+#include <core/Basics/Playlist.h>
+#include <core/Basics/SamplePreloader.h>
+#include <core/Basics/Song.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/MidiAction.h>
 #include <core/MidiMap.h>
 
 using std::cout;
 using std::endl;
 
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+
+using namespace H2Core;
+
+/** Set by the "q" command or the OSC QUIT message.*/
+static std::atomic<bool> bQuit( false );
+
+static void showPlaylist()
+{
+	Playlist* pPlaylist = Playlist::get_instance();
+	for ( int ii = 0; ii < pPlaylist->size(); ++ii ) {
+		cout << ( ii == pPlaylist->getActiveSongNumber() ? " * " : "   " )
+			 << ( ii + 1 ) << ". "
+			 << pPlaylist->get( ii )->filePath.toLocal8Bit().constData() << endl;
+	}
+}
+
+/**
+ * Fills the Playlist singleton with all songs of @a files. Playlist
+ * files are expanded into their songs.
+ *
+ * \return false if one of the files could not be read.
+ */
+static bool buildPlaylist( const QStringList& files )
+{
+	Preferences* pPref = Preferences::get_instance();
+	std::vector<Playlist::Entry> entries;
+
+	for ( const auto& sFile : files ) {
+		if ( sFile.endsWith( Filesystem::playlist_ext ) ) {
+			Playlist* pLoaded = Playlist::load( sFile, pPref->isPlaylistUsingRelativeFilenames() );
+			if ( pLoaded == nullptr ) {
+				cout << "Unable to load playlist " << sFile.toLocal8Bit().constData() << endl;
+				return false;
+			}
+			for ( int ii = 0; ii < pLoaded->size(); ++ii ) {
+				entries.push_back( *pLoaded->get( ii ) );
+			}
+		} else {
+			Playlist::Entry entry;
+			entry.filePath = QFileInfo( sFile ).absoluteFilePath();
+			entry.fileExists = QFileInfo( sFile ).isReadable();
+			entry.scriptPath = "";
+			entry.scriptEnabled = false;
+			entries.push_back( entry );
+		}
+	}
+
+	// Playlist::load() might have replaced the singleton.
+	Playlist* pPlaylist = Playlist::get_instance();
+	pPlaylist->clear();
+	for ( const auto& entry : entries ) {
+		if ( ! entry.fileExists ) {
+			cout << "Song " << entry.filePath.toLocal8Bit().constData()
+				 << " does not exist" << endl;
+			return false;
+		}
+		pPlaylist->add( new Playlist::Entry( entry ) );
+	}
+	return pPlaylist->size() > 0;
+}
+
+/**
+ * Decodes the samples of all songs of the Playlist in parallel and
+ * keeps them in the SamplePool as long as the returned preloaders
+ * exist.
+ */
+static std::vector<std::unique_ptr<SamplePreloader>> preloadPlaylist()
+{
+	Playlist* pPlaylist = Playlist::get_instance();
+	std::vector<std::unique_ptr<SamplePreloader>> preloaders;
+
+	QElapsedTimer timer;
+	timer.start();
+	for ( int ii = 0; ii < pPlaylist->size(); ++ii ) {
+		preloaders.push_back( std::make_unique<SamplePreloader>() );
+		preloaders.back()->start( pPlaylist->get( ii )->filePath );
+	}
+	for ( auto& pPreloader : preloaders ) {
+		pPreloader->wait();
+	}
+	cout << "Preloaded " << pPlaylist->size() << " song(s) in "
+		 << timer.elapsed() << " ms" << endl;
+
+	return preloaders;
+}
+
+/** Replaces the current song by the one of Playlist entry @a
+	nSong.*/
+static bool switchSong( int nSong, bool bAutoplay )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Playlist* pPlaylist = Playlist::get_instance();
+
+	QString sFilename;
+	if ( nSong < 0 || ! pPlaylist->getSongFilenameByNumber( nSong, sFilename ) ) {
+		cout << "There is no song " << ( nSong + 1 ) << endl;
+		return false;
+	}
 
-void usage()
+	QElapsedTimer timer;
+	timer.start();
+	if ( pHydrogen->getState() == STATE_PLAYING ) {
+		pHydrogen->sequencer_stop();
+	}
+	Song* pSong = Song::load( sFilename );
+	if ( pSong == nullptr ) {
+		cout << "Error loading song " << sFilename.toLocal8Bit().constData() << endl;
+		return false;
+	}
+	pHydrogen->setSong( pSong );
+	pPlaylist->activateSong( nSong );
+	if ( bAutoplay ) {
+		pHydrogen->sequencer_play();
+	}
+
+	cout << "Song " << ( nSong + 1 ) << ". " << pSong->getName().toLocal8Bit().constData()
+		 << " ready in " << timer.elapsed() << " ms" << endl;
+	return true;
+}
+
+static void usage()
 {
-	cout << "Usage: hydrogenPlayer song.h2song" << endl;
-	exit(1);
+	cout << "Commands (followed by return):" << endl;
+	cout << "  p       play" << endl;
+	cout << "  s       stop" << endl;
+	cout << "  b       rewind to the beginning" << endl;
+	cout << "  n / v   next / previous song" << endl;
+	cout << "  <N>     switch to song N" << endl;
+	cout << "  l       list songs" << endl;
+	cout << "  f       show frames" << endl;
+	cout << "  q       quit" << endl;
+}
+
+/**
+ * Reads commands from the standard input. Song switches are handed
+ * to the main thread like the ones requested via OSC and MIDI. The
+ * thread ends silently at the end of the input, e.g. when the player
+ * runs as a service.
+ */
+static void readCommands()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	std::string sLine;
+	while ( ! bQuit.load() && std::getline( std::cin, sLine ) ) {
+		QString sCommand = QString::fromStdString( sLine ).trimmed();
+		bool bIsNumber;
+		int nSong = sCommand.toInt( &bIsNumber );
+		int nActive = Playlist::get_instance()->getActiveSongNumber();
+
+		if ( bIsNumber ) {
+			EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, nSong - 1 );
+		} else if ( sCommand == "n" ) {
+			EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, nActive + 1 );
+		} else if ( sCommand == "v" ) {
+			EventQueue::get_instance()->push_event( EVENT_PLAYLIST_LOADSONG, nActive - 1 );
+		} else if ( sCommand == "p" ) {
+			pHydrogen->sequencer_play();
+		} else if ( sCommand == "s" ) {
+			pHydrogen->sequencer_stop();
+		} else if ( sCommand == "b" ) {
+			pHydrogen->setPatternPos( 0 );
+		} else if ( sCommand == "l" ) {
+			showPlaylist();
+		} else if ( sCommand == "f" ) {
+			cout << "Frames = " << pHydrogen->getTotalFrames() << endl;
+		} else if ( sCommand == "q" ) {
+			bQuit.store( true );
+		} else if ( ! sCommand.isEmpty() ) {
+			usage();
+		}
+	}
 }
 
 int main(int argc, char** argv){
@@ -54,83 +245,99 @@ int main(int argc, char** argv){
 
 	QCoreApplication a(argc, argv);
 
-	H2Core::Filesystem::bootstrap( logger );
+	QCommandLineParser parser;
+	parser.setApplicationDescription( "Headless Hydrogen player preloading a whole set of songs." );
+	parser.addHelpOption();
+	QCommandLineOption driverOption( { "d", "driver" },
+									 "Audio driver [Auto, JACK, ALSA, OSS, PulseAudio, PipeWire, CoreAudio, PortAudio]",
+									 "driver" );
+	QCommandLineOption oscOption( { "o", "osc-port" },
+								  "Accept OSC messages, like /Hydrogen/PLAYLIST_SONG, at <port>",
+								  "port" );
+	QCommandLineOption programChangeOption( { "m", "program-change" },
+											"Switch to song N+1 on MIDI program change N" );
+	QCommandLineOption autoplayOption( { "a", "autoplay" },
+									   "Start the playback after switching songs" );
+	parser.addOptions( { driverOption, oscOption, programChangeOption, autoplayOption } );
+	parser.addPositionalArgument( "files", "Songs (.h2song) and playlists (.h2playlist) in the order of the set",
+								  "<file>..." );
+	parser.process( a );
 
-	if (argc != 2) {
-		usage();
+	if ( parser.positionalArguments().isEmpty() ) {
+		parser.showHelp( 1 );
 	}
-	cout << "Hydrogen player starting..." << endl << endl;
 
-	QString filename = argv[1];
+	H2Core::Filesystem::bootstrap( logger );
+
+	cout << "Hydrogen player starting..." << endl << endl;
 
 	MidiMap::create_instance();
 	H2Core::Preferences::create_instance();
-	H2Core::Hydrogen::create_instance();
 	H2Core::Preferences *preferences = H2Core::Preferences::get_instance();
 
-	H2Core::Song *pSong = H2Core::Song::load( filename );
-	if (pSong == nullptr) {
-		cout << "Error loading song!" << endl;
-		exit(2);
+	// Changed for this process only. The preferences are not
+	// saved.
+	preferences->m_bIndexLibraries = false;
+	if ( parser.isSet( driverOption ) ) {
+		preferences->m_sAudioDriver = parser.value( driverOption );
+	}
+	if ( parser.isSet( oscOption ) ) {
+		preferences->setOscServerEnabled( true );
+		preferences->setOscServerPort( parser.value( oscOption ).toInt() );
 	}
+	if ( parser.isSet( programChangeOption ) ) {
+		MidiMap::get_instance()->registerPCEvent( new Action( "PLAYLIST_SONG_CC_ABSOLUTE" ) );
+	}
+	const bool bAutoplay = parser.isSet( autoplayOption );
 
+	H2Core::Hydrogen::create_instance();
 	H2Core::Hydrogen *hydrogen = H2Core::Hydrogen::get_instance();
-	hydrogen->setSong(pSong);
-
-
-	cout << "Press b for rewind from beginning" << endl;
-	cout << "Press p for play" << endl;
-	cout << "Press s for stop" << endl;
-	cout << "Press q for quit" << endl;
-	cout << "f = show frames" << endl;
-
-	char pippo;
-
-	while (true) {
-		pippo = getchar();
-		switch( pippo ) {
-			case 'q':
-				cout << endl << "HydrogenPlayer shutdown..." << endl;
-				hydrogen->sequencer_stop();
-
-				delete hydrogen;
-				delete pSong;
-				delete H2Core::EventQueue::get_instance();
-				delete H2Core::AudioEngine::get_instance();
-				delete preferences;
-				delete H2Core::Logger::get_instance();
-
-				std::cout << std::endl << std::endl << H2Core::Object::objects_count() << " alive objects" << std::endl << std::endl;
-				H2Core::Object::write_objects_map_to_cerr();
-
-				exit(0);
-				break;
-
-			case 'p':
-				hydrogen->sequencer_play();
-				break;
-
-			case 's':
-				hydrogen->sequencer_stop();
-				break;
-
-			case 'b':
-				hydrogen->setPatternPos( 0 );
-				break;
-
-			case 'f':
-				cout << "Frames = " << hydrogen->getTotalFrames() << endl;
-				break;
-
-			case 'd':
-				cout << "DEBUG" << endl;
-				H2Core::Object::write_objects_map_to_cerr();
-				int nObj = H2Core::Object::objects_count();
-				std::cout << std::endl << std::endl << nObj << " alive objects" << std::endl << std::endl;
-				break;
+
+	if ( ! buildPlaylist( parser.positionalArguments() ) ) {
+		exit(2);
+	}
+	auto preloaders = preloadPlaylist();
+	if ( ! switchSong( 0, false ) ) {
+		exit(2);
+	}
+	showPlaylist();
+	cout << endl;
+	usage();
+
+	std::thread( readCommands ).detach();
+
+	EventQueue* pQueue = EventQueue::get_instance();
+	while ( ! bQuit.load() ) {
+		Event event = pQueue->pop_event();
+		switch ( event.type ) {
+		case EVENT_PLAYLIST_LOADSONG:
+			switchSong( event.value, bAutoplay );
+			break;
+		case EVENT_QUIT:
+			bQuit.store( true );
+			break;
+		case EVENT_NONE:
+			// Short enough for the switch to be perceived as
+			// instant.
+			QThread::msleep( 5 );
+			break;
+		default:
+			break;
 		}
 	}
-}
 
+	cout << endl << "HydrogenPlayer shutdown..." << endl;
+	hydrogen->sequencer_stop();
 
+	delete hydrogen;
+	preloaders.clear();
+	delete H2Core::EventQueue::get_instance();
+	delete H2Core::AudioEngine::get_instance();
+	delete preferences;
+	delete H2Core::Logger::get_instance();
 
+	std::cout << std::endl << std::endl << H2Core::Object::objects_count() << " alive objects" << std::endl << std::endl;
+	H2Core::Object::write_objects_map_to_cerr();
+
+	return 0;
+}
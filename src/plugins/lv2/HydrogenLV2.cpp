@@ -0,0 +1,388 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * LV2 instrument running the audio engine of Hydrogen within the
+ * process of the host. The transport, MIDI input, and buffers of the
+ * host are handed to the PluginDriver. The song is chosen via the
+ * song parameter and stored in the state of the plugin.
+ */
+
+#include <core/config.h>
+#include <core/Hydrogen.h>
+#include <core/MidiMap.h>
+#include <core/Preferences.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/IO/PluginDriver.h>
+
+#include <lv2/core/lv2.h>
+#include <lv2/atom/atom.h>
+#include <lv2/atom/util.h>
+#include <lv2/buf-size/buf-size.h>
+#include <lv2/midi/midi.h>
+#include <lv2/options/options.h>
+#include <lv2/patch/patch.h>
+#include <lv2/state/state.h>
+#include <lv2/time/time.h>
+#include <lv2/urid/urid.h>
+#include <lv2/worker/worker.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#define HYDROGEN_LV2_URI "http://www.hydrogen-music.org/lv2/hydrogen"
+#define HYDROGEN_LV2__song HYDROGEN_LV2_URI "#song"
+
+using namespace H2Core;
+
+namespace {
+
+/** Stereo track outputs following the main output. Has to match
+	hydrogen.ttl.*/
+const int nTrackOutputs = 8;
+const int nOutputs = 2 + 2 * nTrackOutputs;
+
+enum Port {
+	PORT_CONTROL = 0,
+	PORT_OUTPUT = 1
+};
+
+/** The audio engine is a singleton. */
+std::atomic<bool> bInstantiated( false );
+
+struct URIs {
+	LV2_URID atom_Blank;
+	LV2_URID atom_Object;
+	LV2_URID atom_Path;
+	LV2_URID atom_URID;
+	LV2_URID atom_Float;
+	LV2_URID atom_Double;
+	LV2_URID atom_Int;
+	LV2_URID atom_Long;
+	LV2_URID bufsz_maxBlockLength;
+	LV2_URID midi_MidiEvent;
+	LV2_URID patch_Set;
+	LV2_URID patch_property;
+	LV2_URID patch_value;
+	LV2_URID time_Position;
+	LV2_URID time_beatsPerMinute;
+	LV2_URID time_frame;
+	LV2_URID time_speed;
+	LV2_URID song;
+};
+
+struct Plugin {
+	URIs uris;
+	LV2_Worker_Schedule* pSchedule;
+	const LV2_Atom_Sequence* pControl;
+	float* outputs[ nOutputs ];
+	PluginDriver* pDriver;
+};
+
+double atomToDouble( const URIs& uris, const LV2_Atom* pAtom )
+{
+	if ( pAtom->type == uris.atom_Float ) {
+		return ( (const LV2_Atom_Float*)pAtom )->body;
+	} else if ( pAtom->type == uris.atom_Double ) {
+		return ( (const LV2_Atom_Double*)pAtom )->body;
+	} else if ( pAtom->type == uris.atom_Int ) {
+		return ( (const LV2_Atom_Int*)pAtom )->body;
+	} else if ( pAtom->type == uris.atom_Long ) {
+		return ( (const LV2_Atom_Long*)pAtom )->body;
+	}
+	return -1;
+}
+
+bool loadSong( const QString& sFilename )
+{
+	Song* pSong = Song::load( sFilename );
+	if ( pSong == nullptr ) {
+		___ERRORLOG( QString( "Unable to load song [%1]" ).arg( sFilename ) );
+		return false;
+	}
+	Hydrogen::get_instance()->setSong( pSong );
+	return true;
+}
+
+LV2_Handle instantiate( const LV2_Descriptor* /*pDescriptor*/, double fRate,
+						const char* /*sBundlePath*/, const LV2_Feature* const* ppFeatures )
+{
+	LV2_URID_Map* pMap = nullptr;
+	LV2_Worker_Schedule* pSchedule = nullptr;
+	const LV2_Options_Option* pOptions = nullptr;
+	for ( int ii = 0; ppFeatures[ ii ] != nullptr; ++ii ) {
+		if ( ! strcmp( ppFeatures[ ii ]->URI, LV2_URID__map ) ) {
+			pMap = (LV2_URID_Map*)ppFeatures[ ii ]->data;
+		} else if ( ! strcmp( ppFeatures[ ii ]->URI, LV2_WORKER__schedule ) ) {
+			pSchedule = (LV2_Worker_Schedule*)ppFeatures[ ii ]->data;
+		} else if ( ! strcmp( ppFeatures[ ii ]->URI, LV2_OPTIONS__options ) ) {
+			pOptions = (const LV2_Options_Option*)ppFeatures[ ii ]->data;
+		}
+	}
+	if ( pMap == nullptr || pSchedule == nullptr ) {
+		return nullptr;
+	}
+	if ( bInstantiated.exchange( true ) ) {
+		// A second instance would share the engine of the first
+		// one.
+		return nullptr;
+	}
+
+	Plugin* pPlugin = new Plugin;
+	memset( pPlugin->outputs, 0, sizeof( pPlugin->outputs ) );
+	pPlugin->pControl = nullptr;
+	pPlugin->pSchedule = pSchedule;
+	pPlugin->pDriver = nullptr;
+
+	URIs& uris = pPlugin->uris;
+	uris.atom_Blank = pMap->map( pMap->handle, LV2_ATOM__Blank );
+	uris.atom_Object = pMap->map( pMap->handle, LV2_ATOM__Object );
+	uris.atom_Path = pMap->map( pMap->handle, LV2_ATOM__Path );
+	uris.atom_URID = pMap->map( pMap->handle, LV2_ATOM__URID );
+	uris.atom_Float = pMap->map( pMap->handle, LV2_ATOM__Float );
+	uris.atom_Double = pMap->map( pMap->handle, LV2_ATOM__Double );
+	uris.atom_Int = pMap->map( pMap->handle, LV2_ATOM__Int );
+	uris.atom_Long = pMap->map( pMap->handle, LV2_ATOM__Long );
+	uris.bufsz_maxBlockLength = pMap->map( pMap->handle, LV2_BUF_SIZE__maxBlockLength );
+	uris.midi_MidiEvent = pMap->map( pMap->handle, LV2_MIDI__MidiEvent );
+	uris.patch_Set = pMap->map( pMap->handle, LV2_PATCH__Set );
+	uris.patch_property = pMap->map( pMap->handle, LV2_PATCH__property );
+	uris.patch_value = pMap->map( pMap->handle, LV2_PATCH__value );
+	uris.time_Position = pMap->map( pMap->handle, LV2_TIME__Position );
+	uris.time_beatsPerMinute = pMap->map( pMap->handle, LV2_TIME__beatsPerMinute );
+	uris.time_frame = pMap->map( pMap->handle, LV2_TIME__frame );
+	uris.time_speed = pMap->map( pMap->handle, LV2_TIME__speed );
+	uris.song = pMap->map( pMap->handle, HYDROGEN_LV2__song );
+
+	int nMaxBlockLength = 0;
+	for ( int ii = 0; pOptions != nullptr && pOptions[ ii ].key != 0; ++ii ) {
+		if ( pOptions[ ii ].key == uris.bufsz_maxBlockLength &&
+			 pOptions[ ii ].type == uris.atom_Int ) {
+			nMaxBlockLength = *(const int32_t*)pOptions[ ii ].value;
+		}
+	}
+
+	PluginDriver::configure( static_cast<unsigned>( fRate ), nTrackOutputs );
+
+	bool bCreated = Hydrogen::is_created();
+	if ( ! bCreated ) {
+		Logger* pLogger = Logger::bootstrap( Logger::Error );
+		Object::bootstrap( pLogger, false );
+		Filesystem::bootstrap( pLogger );
+		MidiMap::create_instance();
+		Preferences::create_instance();
+	}
+
+	// Changed for this process only. The preferences are not
+	// saved by the plugin.
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Plugin";
+	pPref->m_sMidiDriver = "";
+	pPref->setOscServerEnabled( false );
+	if ( nMaxBlockLength > 0 ) {
+		// Larger blocks of the host are split by the driver.
+		pPref->m_nBufferSize = std::min( nMaxBlockLength, MAX_BUFFER_SIZE );
+	}
+
+	if ( bCreated ) {
+		// Left over by a previous instance. Picks up the sample
+		// rate of the new host.
+		Hydrogen::get_instance()->restartDrivers();
+	} else {
+		Hydrogen::create_instance();
+	}
+	pPlugin->pDriver = dynamic_cast<PluginDriver*>(
+		Hydrogen::get_instance()->getAudioOutput() );
+
+	return pPlugin;
+}
+
+void connect_port( LV2_Handle instance, uint32_t nPort, void* pData )
+{
+	Plugin* pPlugin = (Plugin*)instance;
+	if ( nPort == PORT_CONTROL ) {
+		pPlugin->pControl = (const LV2_Atom_Sequence*)pData;
+	} else if ( nPort >= PORT_OUTPUT && nPort < PORT_OUTPUT + nOutputs ) {
+		pPlugin->outputs[ nPort - PORT_OUTPUT ] = (float*)pData;
+	}
+}
+
+void handleObject( Plugin* pPlugin, const LV2_Atom_Object* pObject )
+{
+	const URIs& uris = pPlugin->uris;
+
+	if ( pObject->body.otype == uris.time_Position ) {
+		const LV2_Atom* pSpeed = nullptr;
+		const LV2_Atom* pFrame = nullptr;
+		const LV2_Atom* pBpm = nullptr;
+		lv2_atom_object_get( pObject,
+							 uris.time_speed, &pSpeed,
+							 uris.time_frame, &pFrame,
+							 uris.time_beatsPerMinute, &pBpm,
+							 0 );
+		pPlugin->pDriver->setHostTransport(
+			pSpeed != nullptr && atomToDouble( uris, pSpeed ) > 0,
+			pFrame != nullptr ? static_cast<long long>( atomToDouble( uris, pFrame ) ) : -1,
+			pBpm != nullptr ? static_cast<float>( atomToDouble( uris, pBpm ) ) : 0 );
+	}
+	else if ( pObject->body.otype == uris.patch_Set ) {
+		const LV2_Atom* pProperty = nullptr;
+		const LV2_Atom* pValue = nullptr;
+		lv2_atom_object_get( pObject,
+							 uris.patch_property, &pProperty,
+							 uris.patch_value, &pValue,
+							 0 );
+		if ( pProperty != nullptr && pProperty->type == uris.atom_URID &&
+			 ( (const LV2_Atom_URID*)pProperty )->body == uris.song &&
+			 pValue != nullptr && pValue->type == uris.atom_Path ) {
+			// Loading the song is not realtime safe.
+			pPlugin->pSchedule->schedule_work( pPlugin->pSchedule->handle,
+											   pValue->size, LV2_ATOM_BODY_CONST( pValue ) );
+		}
+	}
+}
+
+void run( LV2_Handle instance, uint32_t nSamples )
+{
+	Plugin* pPlugin = (Plugin*)instance;
+	if ( pPlugin->pDriver == nullptr ) {
+		for ( int ii = 0; ii < nOutputs; ++ii ) {
+			if ( pPlugin->outputs[ ii ] != nullptr ) {
+				memset( pPlugin->outputs[ ii ], 0, nSamples * sizeof( float ) );
+			}
+		}
+		return;
+	}
+	Dsp::disableDenormals();
+
+	// The engine is run up to each event to keep the timing of the
+	// notes and transport changes.
+	uint32_t nFrame = 0;
+	if ( pPlugin->pControl != nullptr ) {
+		LV2_ATOM_SEQUENCE_FOREACH( pPlugin->pControl, pEvent ) {
+			uint32_t nEventFrame = std::min<uint32_t>(
+				static_cast<uint32_t>( std::max<int64_t>( pEvent->time.frames, 0 ) ), nSamples );
+			if ( nEventFrame > nFrame ) {
+				pPlugin->pDriver->process( pPlugin->outputs, nFrame, nEventFrame - nFrame );
+				nFrame = nEventFrame;
+			}
+
+			if ( pEvent->body.type == pPlugin->uris.midi_MidiEvent ) {
+				pPlugin->pDriver->handleMidiEvent( (const uint8_t*)( pEvent + 1 ),
+												   pEvent->body.size );
+			} else if ( pEvent->body.type == pPlugin->uris.atom_Object ||
+						pEvent->body.type == pPlugin->uris.atom_Blank ) {
+				handleObject( pPlugin, (const LV2_Atom_Object*)&pEvent->body );
+			}
+		}
+	}
+	if ( nFrame < nSamples ) {
+		pPlugin->pDriver->process( pPlugin->outputs, nFrame, nSamples - nFrame );
+	}
+}
+
+void cleanup( LV2_Handle instance )
+{
+	// The engine and its singletons are kept for the next instance.
+	delete (Plugin*)instance;
+	bInstantiated = false;
+}
+
+LV2_Worker_Status work( LV2_Handle /*instance*/, LV2_Worker_Respond_Function /*respond*/,
+						LV2_Worker_Respond_Handle /*handle*/, uint32_t nSize, const void* pData )
+{
+	QString sFilename = QString::fromUtf8( (const char*)pData,
+										   strnlen( (const char*)pData, nSize ) );
+	return loadSong( sFilename ) ? LV2_WORKER_SUCCESS : LV2_WORKER_ERR_UNKNOWN;
+}
+
+LV2_Worker_Status work_response( LV2_Handle /*instance*/, uint32_t /*nSize*/,
+								 const void* /*pData*/ )
+{
+	return LV2_WORKER_SUCCESS;
+}
+
+LV2_State_Status save( LV2_Handle instance, LV2_State_Store_Function store,
+					   LV2_State_Handle handle, uint32_t /*nFlags*/,
+					   const LV2_Feature* const* /*ppFeatures*/ )
+{
+	Plugin* pPlugin = (Plugin*)instance;
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong == nullptr || pSong->getFilename().isEmpty() ) {
+		return LV2_STATE_SUCCESS;
+	}
+
+	QByteArray filename = pSong->getFilename().toUtf8();
+	return store( handle, pPlugin->uris.song, filename.constData(), filename.size() + 1,
+				  pPlugin->uris.atom_Path, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE );
+}
+
+LV2_State_Status restore( LV2_Handle instance, LV2_State_Retrieve_Function retrieve,
+						  LV2_State_Handle handle, uint32_t /*nFlags*/,
+						  const LV2_Feature* const* /*ppFeatures*/ )
+{
+	Plugin* pPlugin = (Plugin*)instance;
+	size_t nSize = 0;
+	uint32_t nType = 0;
+	uint32_t nValueFlags = 0;
+	const void* pValue = retrieve( handle, pPlugin->uris.song, &nSize, &nType, &nValueFlags );
+	if ( pValue == nullptr || nType != pPlugin->uris.atom_Path ) {
+		return LV2_STATE_SUCCESS;
+	}
+
+	QString sFilename = QString::fromUtf8( (const char*)pValue,
+										   strnlen( (const char*)pValue, nSize ) );
+	return loadSong( sFilename ) ? LV2_STATE_SUCCESS : LV2_STATE_ERR_UNKNOWN;
+}
+
+const void* extension_data( const char* sURI )
+{
+	static const LV2_Worker_Interface worker = { work, work_response, nullptr };
+	static const LV2_State_Interface state = { save, restore };
+	if ( ! strcmp( sURI, LV2_WORKER__interface ) ) {
+		return &worker;
+	} else if ( ! strcmp( sURI, LV2_STATE__interface ) ) {
+		return &state;
+	}
+	return nullptr;
+}
+
+const LV2_Descriptor descriptor = {
+	HYDROGEN_LV2_URI,
+	instantiate,
+	connect_port,
+	nullptr, // activate
+	run,
+	nullptr, // deactivate
+	cleanup,
+	extension_data
+};
+
+};
+
+LV2_SYMBOL_EXPORT const LV2_Descriptor* lv2_descriptor( uint32_t nIndex )
+{
+	return nIndex == 0 ? &descriptor : nullptr;
+}
@@ -55,3 +55,52 @@ void ADSRTest::testRelease()
 	/* Idle */
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, m_adsr->get_value( 2.0 ), delta );
 }
+
+void ADSRTest::testBlock()
+{
+	const int nFrames = 64;
+	float values[ nFrames ];
+
+	/* Block evaluation has to match the frame by frame one across all
+	 * segment boundaries, including those in the middle of a block. */
+	ADSR reference( 100, 300, 0.6, 1000 );
+	ADSR blockwise( 100, 300, 0.6, 1000 );
+	reference.attack();
+	blockwise.attack();
+
+	for ( int nBlock = 0; nBlock < 40; ++nBlock ) {
+		if ( nBlock == 20 ) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( reference.release(), blockwise.release(), delta );
+		}
+
+		blockwise.get_values( values, nFrames, 1.3 );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( reference.get_value( 1.3 ), values[ ii ], delta );
+		}
+	}
+
+	CPPUNIT_ASSERT( blockwise.is_idle() );
+}
+
+void ADSRTest::testFadeOut()
+{
+	ADSR adsr( 0, 0, 1.0, 100000 );
+	adsr.attack();
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, adsr.get_value( 1 ), delta );
+	CPPUNIT_ASSERT( !adsr.is_fading_out() );
+
+	/* The fade has to replace the long regular release. */
+	adsr.fade_out( 256 );
+	CPPUNIT_ASSERT( adsr.is_released() );
+	CPPUNIT_ASSERT( adsr.is_fading_out() );
+	float values[ 256 ];
+	adsr.get_values( values, 256, 1 );
+	CPPUNIT_ASSERT( values[ 0 ] <= 1.0 );
+	CPPUNIT_ASSERT( values[ 255 ] < 0.01 );
+
+	adsr.get_value( 1 );
+	CPPUNIT_ASSERT( adsr.is_idle() );
+
+	adsr.attack();
+	CPPUNIT_ASSERT( !adsr.is_fading_out() );
+}
@@ -11,6 +11,8 @@ class ADSRTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( ADSRTest );
 	CPPUNIT_TEST( testAttack );
 	CPPUNIT_TEST( testRelease );
+	CPPUNIT_TEST( testBlock );
+	CPPUNIT_TEST( testFadeOut );
 	CPPUNIT_TEST_SUITE_END();
 
 	private:
@@ -22,6 +24,8 @@ class ADSRTest : public CppUnit::TestCase {
 	
 	void testAttack();
 	void testRelease();
+	void testBlock();
+	void testFadeOut();
 };
 
 #endif
@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/AllocationHooks.h>
+#include <core/AllocationTracker.h>
+#include <core/EventQueue.h>
+#include <core/Hydrogen.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Filesystem.h>
+#include "TestHelper.h"
+
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace H2Core;
+
+class AllocationTrackerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( AllocationTrackerTest );
+	CPPUNIT_TEST( testTracking );
+	CPPUNIT_TEST( testSteadyStateProcess );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Renders @a sSongFile using the DiskWriterDriver, which drives
+		audioEngine_process() just like a realtime driver.*/
+	void exportSong( const QString& sSongFile, const QString& sFileName )
+	{
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		EventQueue* pQueue = EventQueue::get_instance();
+
+		Song* pSong = Song::load( sSongFile );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		pHydrogen->setSong( pSong );
+
+		InstrumentList* pInstrumentList = pSong->getInstrumentList();
+		for ( int ii = 0; ii < pInstrumentList->size(); ii++ ) {
+			pInstrumentList->get( ii )->set_currently_exported( true );
+		}
+
+		pHydrogen->startExportSession( 44100, 16 );
+		pHydrogen->startExportSong( sFileName );
+
+		bool bDone = false;
+		while ( ! bDone ) {
+			Event event = pQueue->pop_event();
+			if ( event.type == EVENT_PROGRESS && event.value == 100 ) {
+				bDone = true;
+			} else {
+				usleep( 100 * 1000 );
+			}
+		}
+		pHydrogen->stopExportSession();
+	}
+
+public:
+	void tearDown() override
+	{
+		AllocationTracker::setEnabled( false );
+		AllocationTracker::reset();
+	}
+
+	void testTracking()
+	{
+		AllocationTracker::reset();
+		AllocationTracker::setEnabled( true );
+
+		// Allocations outside of a marked scope are not counted. The
+		// volatile pointers keep the compiler from eliding them.
+		void* volatile pOutside = malloc( 16 );
+		free( pOutside );
+		int* volatile pInt = new int( 1 );
+		delete pInt;
+		CPPUNIT_ASSERT_EQUAL( 0LL, AllocationTracker::getAllocations() );
+
+		{
+			AllocationTracker::Cycle cycle;
+			void* volatile pBuffer = malloc( 16 );
+			free( pBuffer );
+		}
+		{
+			AllocationTracker::Cycle cycle;
+		}
+		AllocationTracker::setEnabled( false );
+
+		CPPUNIT_ASSERT_EQUAL( 2LL, AllocationTracker::getCycles() );
+		CPPUNIT_ASSERT_EQUAL( 1LL, AllocationTracker::getAllocations() );
+		CPPUNIT_ASSERT_EQUAL( 1LL, AllocationTracker::getAllocatingCycles() );
+		CPPUNIT_ASSERT_EQUAL( 1, AllocationTracker::getMaxAllocationsPerCycle() );
+
+		AllocationTracker::reset();
+		CPPUNIT_ASSERT_EQUAL( 0LL, AllocationTracker::getAllocations() );
+		CPPUNIT_ASSERT( AllocationTracker::getCallSites().isEmpty() );
+	}
+
+	void testSteadyStateProcess()
+	{
+		QString sSongFile = H2TEST_FILE( "functional/test.h2song" );
+		QString sOutFile = Filesystem::tmp_file_path( "allocations.test.wav" );
+
+		// The first run populates the caches and pools used by the
+		// engine.
+		exportSong( sSongFile, sOutFile );
+
+		AllocationTracker::reset();
+		AllocationTracker::setEnabled( true );
+		exportSong( sSongFile, sOutFile );
+		AllocationTracker::setEnabled( false );
+
+		CPPUNIT_ASSERT( AllocationTracker::getCycles() > 0 );
+		CPPUNIT_ASSERT_MESSAGE(
+			QString( "%1 allocations in %2 of %3 cycles:\n%4" )
+			.arg( AllocationTracker::getAllocations() )
+			.arg( AllocationTracker::getAllocatingCycles() )
+			.arg( AllocationTracker::getCycles() )
+			.arg( AllocationTracker::getCallSites().join( "\n" ) )
+			.toStdString(),
+			AllocationTracker::getAllocations() == 0 );
+
+		Filesystem::rm( sOutFile );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( AllocationTrackerTest );
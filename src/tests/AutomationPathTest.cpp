@@ -60,6 +60,7 @@ class AutomationPathTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testFindNotFound);
 	CPPUNIT_TEST(testMovePoint);
 	CPPUNIT_TEST(testRemovePoint);
+	CPPUNIT_TEST(testCursor);
 	CPPUNIT_TEST_SUITE_END();
 
 	const double delta = 0.0001;
@@ -335,6 +336,36 @@ class AutomationPathTest : public CppUnit::TestCase {
 				delta);
 
 	}
+
+
+	/* Test evaluating forwards and backwards using a cursor */
+	void testCursor()
+	{
+		AutomationPath p(0.0f, 2.0f, 1.0f);
+		p.add_point(1.0f, 0.0f);
+		p.add_point(2.0f, 2.0f);
+		p.add_point(4.0f, 1.0f);
+
+		AutomationPath::Cursor cursor(&p);
+		for (float x : { 0.0f, 1.0f, 1.5f, 2.0f, 3.0f, 5.0f, 1.25f, 3.5f }) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(
+					static_cast<double>(p.get_value(x)),
+					static_cast<double>(cursor.get_value(x)),
+					delta);
+		}
+
+		/* A cursor keeps on using the points present at its
+		 * creation. */
+		p.remove_point(4.0f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				1.5,
+				static_cast<double>(cursor.get_value(3.0f)),
+				delta);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				2.0,
+				static_cast<double>(p.get_value(3.0f)),
+				delta);
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( AutomationPathTest );
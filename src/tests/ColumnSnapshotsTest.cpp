@@ -0,0 +1,97 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/AudioEngine.h>
+#include <core/ColumnSnapshots.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+
+using namespace H2Core;
+
+class ColumnSnapshotsTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( ColumnSnapshotsTest );
+	CPPUNIT_TEST( testSoundingNotes );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp()
+	{
+		AudioEngine::create_instance();
+	}
+
+	void testSoundingNotes()
+	{
+		Instrument* pInstr = new Instrument();
+		Pattern* pFirst = new Pattern( "first", "", "", 192 );
+		Pattern* pSecond = new Pattern( "second", "", "", 192 );
+		// Lasts into the second column.
+		pFirst->insert_note( new Note( pInstr, 96, 0.8, 0.5, 0.5, 192, 0 ) );
+		// Played till the end of its samples.
+		pFirst->insert_note( new Note( pInstr, 0, 0.8, 0.5, 0.5, -1, 0 ) );
+		pSecond->insert_note( new Note( pInstr, 48, 0.8, 0.5, 0.5, 24, 0 ) );
+
+		Song* pSong = new Song( "test", "", 120, 0.5 );
+		auto pColumns = new std::vector<PatternList*>;
+		pColumns->push_back( new PatternList() );
+		pColumns->back()->add( pFirst );
+		pColumns->push_back( new PatternList() );
+		pColumns->back()->add( pSecond );
+		pSong->setPatternGroupVector( pColumns );
+
+		ColumnSnapshots snapshots;
+		const ColumnSnapshots::SoundingNote* pNotes = nullptr;
+		// Outdated till the first update.
+		CPPUNIT_ASSERT_EQUAL( 0, snapshots.getSoundingNotes( pSong, 50, &pNotes ) );
+
+		snapshots.update( pSong );
+		CPPUNIT_ASSERT_EQUAL( 1, snapshots.getSoundingNotes( pSong, 50, &pNotes ) );
+		CPPUNIT_ASSERT_EQUAL( 96L, pNotes[ 0 ].nStartTick );
+		CPPUNIT_ASSERT_EQUAL( 288L, pNotes[ 0 ].nEndTick );
+
+		CPPUNIT_ASSERT_EQUAL( 2, snapshots.getSoundingNotes( pSong, 200, &pNotes ) );
+		CPPUNIT_ASSERT_EQUAL( 96L, pNotes[ 0 ].nStartTick );
+		CPPUNIT_ASSERT_EQUAL( 240L, pNotes[ 1 ].nStartTick );
+		CPPUNIT_ASSERT_EQUAL( 264L, pNotes[ 1 ].nEndTick );
+
+		// Beyond the end of the song.
+		CPPUNIT_ASSERT_EQUAL( 0, snapshots.getSoundingNotes( pSong, 400, &pNotes ) );
+
+		// Editing notes outdates the snapshots.
+		pSecond->insert_note( new Note( pInstr, 0, 0.8, 0.5, 0.5, 12, 0 ) );
+		CPPUNIT_ASSERT_EQUAL( 0, snapshots.getSoundingNotes( pSong, 200, &pNotes ) );
+		snapshots.update( pSong );
+		CPPUNIT_ASSERT_EQUAL( 3, snapshots.getSoundingNotes( pSong, 200, &pNotes ) );
+
+		delete pSong;
+		delete pFirst;
+		delete pSecond;
+		delete pInstr;
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ColumnSnapshotsTest );
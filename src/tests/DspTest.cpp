@@ -0,0 +1,214 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/Dsp.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace H2Core;
+
+class DspTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( DspTest );
+	CPPUNIT_TEST( testInterleave );
+	CPPUNIT_TEST( testInterleaveInt16 );
+	CPPUNIT_TEST( testInterleaveInt24 );
+	CPPUNIT_TEST( testInterleaveInt32 );
+	CPPUNIT_TEST( testInterleaveMultichannel );
+	CPPUNIT_TEST( testDither );
+	CPPUNIT_TEST( testAllocate );
+	CPPUNIT_TEST( testDot );
+	CPPUNIT_TEST_SUITE_END();
+
+	/* An odd number of frames covers both the vectorized and the
+	 * scalar parts of the kernels. */
+	static const int nFrames = 37;
+
+	std::vector<float> m_left;
+	std::vector<float> m_right;
+	const float* m_ppSrc[ 2 ];
+
+	public:
+	void setUp()
+	{
+		m_left.resize( nFrames );
+		m_right.resize( nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			m_left[ ii ] = std::sin( ii * 0.7f ) * 1.3f;
+			m_right[ ii ] = -std::cos( ii * 0.3f ) * 0.9f;
+		}
+		m_left[ 3 ] = 1.0f;
+		m_right[ 5 ] = -1.0f;
+		m_ppSrc[ 0 ] = m_left.data();
+		m_ppSrc[ 1 ] = m_right.data();
+	}
+
+	/** Reference conversion to @a nBits clipping to [-1,1) and rounding
+		halfway cases to even like the default rounding mode.*/
+	static long reference( float fValue, int nBits )
+	{
+		double fScale = std::ldexp( 1.0, nBits - 1 );
+		double fScaled = std::min( std::max( fValue * fScale, -fScale ), fScale - 1 );
+		return std::lrint( fScaled );
+	}
+
+	void testInterleave()
+	{
+		std::vector<float> out( nFrames * 2 );
+		Dsp::interleave( out.data(), m_ppSrc, 2, nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( m_left[ ii ], out[ ii * 2 ] );
+			CPPUNIT_ASSERT_EQUAL( m_right[ ii ], out[ ii * 2 + 1 ] );
+		}
+
+		Dsp::interleave( out.data(), m_ppSrc, 2, nFrames, true );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( std::min( std::max( m_left[ ii ], -1.0f ), 1.0f ), out[ ii * 2 ] );
+			CPPUNIT_ASSERT_EQUAL( std::min( std::max( m_right[ ii ], -1.0f ), 1.0f ), out[ ii * 2 + 1 ] );
+		}
+	}
+
+	void testInterleaveInt16()
+	{
+		std::vector<int16_t> stereo( nFrames * 2 );
+		Dsp::interleaveInt16( stereo.data(), m_ppSrc, 2, nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( reference( m_left[ ii ], 16 ), static_cast<long>( stereo[ ii * 2 ] ) );
+			CPPUNIT_ASSERT_EQUAL( reference( m_right[ ii ], 16 ), static_cast<long>( stereo[ ii * 2 + 1 ] ) );
+		}
+
+		std::vector<int16_t> mono( nFrames );
+		Dsp::interleaveInt16( mono.data(), m_ppSrc, 1, nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( stereo[ ii * 2 ], mono[ ii ] );
+		}
+	}
+
+	void testInterleaveInt24()
+	{
+		std::vector<uint8_t> out( nFrames * 2 * 3 );
+		Dsp::interleaveInt24( out.data(), m_ppSrc, 2, nFrames );
+		for ( int ii = 0; ii < nFrames * 2; ++ii ) {
+			const uint8_t* pSample = &out[ ii * 3 ];
+			// Sign extension of the most significant byte.
+			long nValue = pSample[ 0 ] | pSample[ 1 ] << 8 |
+				static_cast<int8_t>( pSample[ 2 ] ) * 65536L;
+			CPPUNIT_ASSERT_EQUAL( reference( m_ppSrc[ ii % 2 ][ ii / 2 ], 24 ), nValue );
+		}
+	}
+
+	void testInterleaveInt32()
+	{
+		std::vector<int32_t> out( nFrames * 2 );
+		Dsp::interleaveInt32( out.data(), m_ppSrc, 2, nFrames );
+		for ( int ii = 0; ii < nFrames * 2; ++ii ) {
+			// Single precision floats do not resolve the lower bits.
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( reference( m_ppSrc[ ii % 2 ][ ii / 2 ], 32 ),
+										  out[ ii ], 128 );
+		}
+	}
+
+	void testInterleaveMultichannel()
+	{
+		/* An odd number of channels covers both the channel pairs
+		 * and the remaining single channel. */
+		const int nChannels = 5;
+		const float* ppSrc[ nChannels ] = { m_left.data(), m_right.data(), m_right.data(),
+											m_left.data(), m_left.data() };
+
+		std::vector<float> outFloat( nFrames * nChannels );
+		std::vector<int16_t> out16( nFrames * nChannels );
+		std::vector<int32_t> out32( nFrames * nChannels );
+		Dsp::interleave( outFloat.data(), ppSrc, nChannels, nFrames, true );
+		Dsp::interleaveInt16( out16.data(), ppSrc, nChannels, nFrames );
+		Dsp::interleaveInt32( out32.data(), ppSrc, nChannels, nFrames );
+
+		std::vector<float> stereoFloat( nFrames * 2 );
+		std::vector<int16_t> stereo16( nFrames * 2 );
+		std::vector<int32_t> stereo32( nFrames * 2 );
+		Dsp::interleave( stereoFloat.data(), m_ppSrc, 2, nFrames, true );
+		Dsp::interleaveInt16( stereo16.data(), m_ppSrc, 2, nFrames );
+		Dsp::interleaveInt32( stereo32.data(), m_ppSrc, 2, nFrames );
+
+		// Channels carrying the left and right input respectively.
+		const int channelSide[ nChannels ] = { 0, 1, 1, 0, 0 };
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			for ( int nChannel = 0; nChannel < nChannels; ++nChannel ) {
+				int nOut = ii * nChannels + nChannel;
+				int nStereo = ii * 2 + channelSide[ nChannel ];
+				CPPUNIT_ASSERT_EQUAL( stereoFloat[ nStereo ], outFloat[ nOut ] );
+				CPPUNIT_ASSERT_EQUAL( stereo16[ nStereo ], out16[ nOut ] );
+				CPPUNIT_ASSERT_EQUAL( stereo32[ nStereo ], out32[ nOut ] );
+			}
+		}
+	}
+
+	void testDither()
+	{
+		/* A constant quarter of a least significant bit is lost by
+		 * rounding but preserved on average by the dither. */
+		const int nSamples = 100000;
+		std::vector<float> in( nSamples, 0.25f / 32768 );
+		std::vector<int16_t> out( nSamples );
+		const float* pIn = in.data();
+		Dsp::Dither dither;
+		Dsp::interleaveInt16( out.data(), &pIn, 1, nSamples, &dither );
+
+		double fSum = 0;
+		for ( auto nValue : out ) {
+			CPPUNIT_ASSERT( nValue >= -1 && nValue <= 1 );
+			fSum += nValue;
+		}
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.25, fSum / nSamples, 0.01 );
+	}
+
+	void testAllocate()
+	{
+		float* pBuffer = Dsp::allocate( nFrames );
+		CPPUNIT_ASSERT_EQUAL( static_cast<uintptr_t>( 0 ),
+							  reinterpret_cast<uintptr_t>( pBuffer ) % DSP_BUFFER_ALIGNMENT );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( 0.0f, pBuffer[ ii ] );
+		}
+		Dsp::add( pBuffer, m_left.data(), nFrames );
+		CPPUNIT_ASSERT_EQUAL( m_left[ nFrames - 1 ], pBuffer[ nFrames - 1 ] );
+		Dsp::release( pBuffer );
+		Dsp::release( nullptr );
+	}
+
+	void testDot()
+	{
+		double fExpected = 0;
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			fExpected += m_left[ ii ] * m_right[ ii ];
+		}
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( fExpected,
+									  Dsp::dot( m_left.data(), m_right.data(), nFrames ),
+									  1e-5 );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, Dsp::dot( m_left.data(), m_right.data(), 0 ) );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( DspTest );
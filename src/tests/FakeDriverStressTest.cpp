@@ -0,0 +1,92 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Hydrogen.h>
+#include <core/IO/FakeDriver.h>
+
+using namespace H2Core;
+
+class FakeDriverStressTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( FakeDriverStressTest );
+	CPPUNIT_TEST( testUnthrottled );
+	CPPUNIT_TEST( testPaced );
+	CPPUNIT_TEST_SUITE_END();
+
+	FakeDriver* getDriver()
+	{
+		auto pDriver = dynamic_cast<FakeDriver*>( Hydrogen::get_instance()->getAudioOutput() );
+		CPPUNIT_ASSERT( pDriver != nullptr );
+		return pDriver;
+	}
+
+public:
+	void testUnthrottled()
+	{
+		FakeDriver* pDriver = getDriver();
+
+		FakeDriver::StressOptions options;
+		options.nCycles = 500;
+		options.nMinBufferSize = pDriver->getBufferSize() / 4;
+		options.fLateProbability = 0.1;
+		options.nMaxLateUs = 200;
+		options.nLockContenders = 2;
+		options.nLockHoldUs = 20;
+		options.nLockIntervalUs = 500;
+
+		auto report = pDriver->runStress( options );
+		CPPUNIT_ASSERT_EQUAL( 500, report.nCycles );
+		CPPUNIT_ASSERT( report.nFrames >= 500LL * options.nMinBufferSize );
+		CPPUNIT_ASSERT( report.nFrames <= 500LL * pDriver->getBufferSize() );
+		CPPUNIT_ASSERT( report.nLateCycles > 0 );
+		CPPUNIT_ASSERT( report.nLateCycles < 500 );
+		CPPUNIT_ASSERT_EQUAL( 0, report.nOverruns );
+		CPPUNIT_ASSERT( report.fMedian <= report.fPercentile99 );
+		CPPUNIT_ASSERT( report.fPercentile99 <= report.fMax );
+		CPPUNIT_ASSERT( report.fRealtimeFactor > 0 );
+
+		// The same seed issues the same buffer sizes.
+		options.nLockContenders = 0;
+		auto repeated = pDriver->runStress( options );
+		CPPUNIT_ASSERT_EQUAL( report.nFrames, repeated.nFrames );
+		CPPUNIT_ASSERT_EQUAL( report.nLateCycles, repeated.nLateCycles );
+	}
+
+	void testPaced()
+	{
+		FakeDriver* pDriver = getDriver();
+
+		FakeDriver::StressOptions options;
+		options.nCycles = 50;
+		options.fSpeed = 8;
+		auto report = pDriver->runStress( options );
+		CPPUNIT_ASSERT_EQUAL( 50LL * pDriver->getBufferSize(), report.nFrames );
+		// The first cycle starts right away, so the run covers only
+		// 49 periods.
+		CPPUNIT_ASSERT( report.fRealtimeFactor <= options.fSpeed * 50 / 49 + 0.1 );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( FakeDriverStressTest );
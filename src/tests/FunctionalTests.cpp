@@ -40,6 +40,7 @@
 #include <core/Basics/Sample.h>
 #include <core/Basics/Song.h>
 #include <core/Smf/SMF.h>
+#include <core/SongExporter.h>
 #include "TestHelper.h"
 #include "assertions/File.h"
 #include "assertions/AudioFile.h"
@@ -122,6 +123,7 @@ class FunctionalTest : public CppUnit::TestCase {
 	CPPUNIT_TEST( testExportMIDISMF0 );
 	CPPUNIT_TEST( testExportMIDISMF1Single );
 	CPPUNIT_TEST( testExportMIDISMF1Multi );
+	CPPUNIT_TEST( testExportAllFormats );
 //	CPPUNIT_TEST( testExportMuteGroupsAudio ); // SKIP
 	CPPUNIT_TEST( testExportVelocityAutomationAudio );
 	CPPUNIT_TEST( testExportVelocityAutomationMIDISMF0 );
@@ -200,6 +202,50 @@ class FunctionalTest : public CppUnit::TestCase {
 
 	}
 
+	void testExportAllFormats()
+	{
+		auto songFile = H2TEST_FILE("functional/test.h2song");
+		auto audioFile = Filesystem::tmp_file_path("all.test.wav");
+		auto midiFile = Filesystem::tmp_file_path("all.test.mid");
+		auto lilyPondFile = Filesystem::tmp_file_path("all.test.ly");
+
+		Song *pSong = Song::load( songFile );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		Hydrogen::get_instance()->setSong( pSong );
+		InstrumentList *pInstrumentList = pSong->getInstrumentList();
+		for ( auto i = 0; i < pInstrumentList->size(); i++ ) {
+			pInstrumentList->get( i )->set_currently_exported( true );
+		}
+
+		SongExporter::Job job;
+		SongExporter::addFilenames( job, { audioFile, midiFile, lilyPondFile } );
+		CPPUNIT_ASSERT_EQUAL( 1, job.audioFilenames.size() );
+		CPPUNIT_ASSERT( job.sMidiFilename == midiFile );
+		CPPUNIT_ASSERT( job.sLilyPondFilename == lilyPondFile );
+
+		EventQueue *pQueue = EventQueue::get_instance();
+		SongExporter exporter;
+		CPPUNIT_ASSERT( exporter.start( job ) );
+		bool done = false;
+		while ( ! done ) {
+			Event event = pQueue->pop_event();
+			if ( event.type == EVENT_PROGRESS && event.value == 100 ) {
+				done = true;
+			} else {
+				usleep( 100 * 1000 );
+			}
+		}
+		Hydrogen::get_instance()->stopExportSession();
+		CPPUNIT_ASSERT( exporter.finish() );
+
+		H2TEST_ASSERT_AUDIO_FILES_EQUAL( H2TEST_FILE("functional/test.ref.flac"), audioFile );
+		H2TEST_ASSERT_FILES_EQUAL( H2TEST_FILE("functional/smf1single.test.ref.mid"), midiFile );
+		CPPUNIT_ASSERT( QFileInfo( lilyPondFile ).size() > 0 );
+		Filesystem::rm( audioFile );
+		Filesystem::rm( midiFile );
+		Filesystem::rm( lilyPondFile );
+	}
+
 	void testExportAudio()
 	{
 		auto songFile = H2TEST_FILE("functional/test.h2song");
@@ -0,0 +1,270 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/AudioEngine.h>
+#include <core/Hydrogen.h>
+#include <core/OfflineRenderer.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Dsp.h>
+#include <core/Helpers/Random.h>
+#include <core/Sampler/Interpolation.h>
+#include <core/Sampler/Sampler.h>
+
+#include "TestHelper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace H2Core;
+
+/**
+ * Checks the vectorized kernels of Dsp and Interpolation against
+ * their scalar reference implementations selected using
+ * Dsp::setReferenceKernels().
+ *
+ * The songs are rendered stem by stem - one instrument at a time
+ * with all others muted - at a sample rate differing from the one of
+ * the samples so the interpolation is exercised. The deviation of
+ * each stem relative to its reference must not exceed #fToleranceDb.
+ * The render times of both are reported alongside, so a faster
+ * kernel breaking the audio is spotted right away.
+ *
+ * The kernels are chosen at compile time. Builds for each platform
+ * do run the suite for the instruction set they target.
+ */
+class GoldenRenderTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( GoldenRenderTest );
+	CPPUNIT_TEST( testDspKernels );
+	CPPUNIT_TEST( testStems );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Largest level of the difference between the optimized and
+		the reference render relative to the latter.*/
+	static constexpr double fToleranceDb = -90;
+	/** Differs from the rate of the samples of the test songs.*/
+	static const unsigned nSampleRate = 48000;
+
+	static const char* instructionSet()
+	{
+#if defined(H2CORE_INTERPOLATION_SSE)
+		return "SSE2";
+#elif defined(H2CORE_INTERPOLATION_NEON)
+		return "NEON";
+#else
+		return "scalar";
+#endif
+	}
+
+	/** \return Level of @a actual - @a expected relative to @a
+		expected in dB. -inf if both are identical.*/
+	static double deviationDb( const std::vector<float>& expected,
+							   const std::vector<float>& actual )
+	{
+		double fSignal = 0, fError = 0;
+		for ( size_t ii = 0; ii < expected.size(); ++ii ) {
+			fSignal += static_cast<double>( expected[ ii ] ) * expected[ ii ];
+			double fDiff = static_cast<double>( actual[ ii ] ) - expected[ ii ];
+			fError += fDiff * fDiff;
+		}
+		if ( fError == 0 ) {
+			return -HUGE_VAL;
+		}
+		if ( fSignal == 0 ) {
+			return HUGE_VAL;
+		}
+		return 10 * std::log10( fError / fSignal );
+	}
+
+	/** Renders the current song and returns both channels one after
+		another. @a fMilliseconds is set to the time spent.*/
+	static std::vector<float> render( OfflineRenderer& renderer, double& fMilliseconds )
+	{
+		const uint32_t nBlock = 4096;
+		std::vector<float> left, right;
+		std::vector<float> block_L( nBlock ), block_R( nBlock );
+
+		renderer.rewind();
+		auto start = std::chrono::steady_clock::now();
+		while ( ! renderer.isFinished() ) {
+			uint32_t nFrames = renderer.render( block_L.data(), block_R.data(), nBlock );
+			left.insert( left.end(), block_L.begin(), block_L.begin() + nFrames );
+			right.insert( right.end(), block_R.begin(), block_R.begin() + nFrames );
+		}
+		fMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start ).count();
+
+		left.insert( left.end(), right.begin(), right.end() );
+		return left;
+	}
+
+	static bool isUsed( Song* pSong, Instrument* pInstr )
+	{
+		PatternList* pPatterns = pSong->getPatternList();
+		for ( int ii = 0; ii < pPatterns->size(); ++ii ) {
+			if ( pPatterns->get( ii )->references( pInstr ) ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	Interpolation::InterpolateMode m_previousMode;
+
+public:
+	void setUp()
+	{
+		m_previousMode = AudioEngine::get_instance()->get_sampler()->getInterpolateMode();
+	}
+
+	void tearDown()
+	{
+		Dsp::setReferenceKernels( false );
+		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( m_previousMode );
+	}
+
+	void testDspKernels()
+	{
+		// Odd length to cover the remainder loops too.
+		const uint32_t nFrames = 1027;
+		Random random( 3 );
+		std::vector<float> a( nFrames ), b( nFrames );
+		for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+			a[ ii ] = 2.5f * random.uniform() - 1.25f;
+			b[ ii ] = 2 * random.uniform() - 1;
+		}
+		const float* channels[] = { a.data(), b.data(), a.data() };
+
+		struct Results {
+			std::vector<float> added;
+			std::vector<float> interleaved;
+			std::vector<int16_t> interleaved16;
+			std::vector<int32_t> interleaved32;
+			float fPeak;
+			float fDot;
+		};
+		auto run = [&]( bool bReference ) {
+			Dsp::setReferenceKernels( bReference );
+			Results results;
+			results.added = a;
+			Dsp::add( results.added.data(), b.data(), nFrames );
+			Dsp::addWithGain( results.added.data(), b.data(), 0.3f, nFrames );
+			results.interleaved.resize( 3 * nFrames );
+			Dsp::interleave( results.interleaved.data(), channels, 3, nFrames, true );
+			results.interleaved16.resize( 2 * nFrames );
+			Dsp::interleaveInt16( results.interleaved16.data(), channels, 2, nFrames );
+			results.interleaved32.resize( 2 * nFrames );
+			Dsp::interleaveInt32( results.interleaved32.data(), channels, 2, nFrames );
+			results.fPeak = Dsp::maxAbs( a.data(), nFrames, 0 );
+			results.fDot = Dsp::dot( a.data(), b.data(), nFrames );
+			return results;
+		};
+
+		const Results reference = run( true );
+		const Results optimized = run( false );
+
+		// Element-wise kernels have to match exactly.
+		CPPUNIT_ASSERT( optimized.added == reference.added );
+		CPPUNIT_ASSERT( optimized.interleaved == reference.interleaved );
+		CPPUNIT_ASSERT( optimized.interleaved16 == reference.interleaved16 );
+		CPPUNIT_ASSERT( optimized.interleaved32 == reference.interleaved32 );
+		CPPUNIT_ASSERT_EQUAL( reference.fPeak, optimized.fPeak );
+		// Reductions only up to the order of the summation.
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( reference.fDot, optimized.fDot, 1e-5 * nFrames );
+	}
+
+	void testStems()
+	{
+		const char* songs[] = { "functional/test.h2song",
+								"functional/velocityautomation.h2song",
+								"functional/mutegroups.h2song" };
+		const Interpolation::InterpolateMode modes[] = {
+			Interpolation::InterpolateMode::Linear,
+			Interpolation::InterpolateMode::Hermite,
+			Interpolation::InterpolateMode::Sinc };
+		const char* modeNames[] = { "linear", "hermite", "sinc" };
+
+		Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+		OfflineRenderer renderer( nSampleRate );
+
+		printf( "\n[GoldenRenderTest] %s kernels\n", instructionSet() );
+		for ( const char* sSong : songs ) {
+			CPPUNIT_ASSERT( renderer.loadSong( H2TEST_FILE( sSong ) ) );
+			Song* pSong = Hydrogen::get_instance()->getSong();
+			// Both renders have to humanize the notes alike.
+			if ( pSong->getRandomSeed() == 0 ) {
+				pSong->setRandomSeed( 1 );
+			}
+			InstrumentList* pInstruments = pSong->getInstrumentList();
+
+			for ( int nMode = 0; nMode < 3; ++nMode ) {
+				pSampler->setInterpolateMode( modes[ nMode ] );
+
+				for ( int nStem = 0; nStem < pInstruments->size(); ++nStem ) {
+					Instrument* pStem = pInstruments->get( nStem );
+					if ( ! isUsed( pSong, pStem ) ) {
+						continue;
+					}
+					std::vector<bool> muted( pInstruments->size() );
+					for ( int ii = 0; ii < pInstruments->size(); ++ii ) {
+						muted[ ii ] = pInstruments->get( ii )->is_muted();
+						pInstruments->get( ii )->set_muted( ii != nStem );
+					}
+
+					double fReferenceMs, fOptimizedMs;
+					Dsp::setReferenceKernels( true );
+					const auto reference = render( renderer, fReferenceMs );
+					Dsp::setReferenceKernels( false );
+					const auto optimized = render( renderer, fOptimizedMs );
+
+					for ( int ii = 0; ii < pInstruments->size(); ++ii ) {
+						pInstruments->get( ii )->set_muted( muted[ ii ] );
+					}
+
+					const double fDeviation = deviationDb( reference, optimized );
+					const QString sStem = QString( "%1 [%2] %3" )
+						.arg( sSong ).arg( pStem->get_name() ).arg( modeNames[ nMode ] );
+					printf( "  %-60s %8.1f dB %9.1f ms reference %9.1f ms optimized (x%.2f)\n",
+							sStem.toLocal8Bit().data(), fDeviation, fReferenceMs,
+							fOptimizedMs, fReferenceMs / std::max( fOptimizedMs, 1e-3 ) );
+
+					CPPUNIT_ASSERT_EQUAL_MESSAGE( sStem.toStdString(),
+												  reference.size(), optimized.size() );
+					CPPUNIT_ASSERT_MESSAGE( QString( "%1 deviates by %2 dB" )
+											.arg( sStem ).arg( fDeviation ).toStdString(),
+											fDeviation <= fToleranceDb );
+				}
+			}
+		}
+	}
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( GoldenRenderTest );
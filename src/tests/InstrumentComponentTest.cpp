@@ -0,0 +1,111 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+
+#include <vector>
+
+using namespace H2Core;
+
+class InstrumentComponentTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( InstrumentComponentTest );
+	CPPUNIT_TEST( testSelectLayers );
+	CPPUNIT_TEST( testHoles );
+	CPPUNIT_TEST( testLayerChanges );
+	CPPUNIT_TEST_SUITE_END();
+
+	private:
+	InstrumentLayer* createLayer( float fStart, float fEnd )
+	{
+		InstrumentLayer* pLayer = new InstrumentLayer( nullptr );
+		pLayer->set_start_velocity( fStart );
+		pLayer->set_end_velocity( fEnd );
+		return pLayer;
+	}
+
+	std::vector<int> selectLayers( InstrumentComponent* pCompo, float fVelocity )
+	{
+		std::vector<int> layers( InstrumentComponent::getMaxLayers() );
+		layers.resize( pCompo->select_layers( fVelocity, layers.data() ) );
+		return layers;
+	}
+
+	public:
+	void testSelectLayers()
+	{
+		InstrumentComponent compo( 0 );
+		compo.set_layer( createLayer( 0.0, 0.5 ), 0 );
+		compo.set_layer( createLayer( 0.5, 1.0 ), 1 );
+		compo.set_layer( createLayer( 0.3, 0.7 ), 3 );
+		compo.update_layer_table();
+
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.0 ) == std::vector<int>( { 0 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.4 ) == std::vector<int>( { 0, 3 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.5 ) == std::vector<int>( { 0, 1, 3 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.5001 ) == std::vector<int>( { 1, 3 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 1.0 ) == std::vector<int>( { 1 } ) );
+	}
+
+	void testHoles()
+	{
+		InstrumentComponent compo( 0 );
+		compo.set_layer( createLayer( 0.0, 0.2 ), 0 );
+		compo.set_layer( createLayer( 0.6, 0.61 ), 1 );
+		compo.set_layer( createLayer( 0.9, 1.0 ), 2 );
+		compo.update_layer_table();
+
+		// Within the zone of a layer as well as in zones not
+		// covered by any.
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.605 ) == std::vector<int>( { 1 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.59 ) == std::vector<int>( { 1 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.3 ) == std::vector<int>( { 0 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.45 ) == std::vector<int>( { 1 } ) );
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.8 ) == std::vector<int>( { 2 } ) );
+
+		InstrumentComponent empty( 0 );
+		empty.update_layer_table();
+		CPPUNIT_ASSERT( selectLayers( &empty, 0.5 ).empty() );
+	}
+
+	void testLayerChanges()
+	{
+		InstrumentComponent compo( 0 );
+		compo.set_layer( createLayer( 0.0, 1.0 ), 0 );
+		compo.update_layer_table();
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.8 ) == std::vector<int>( { 0 } ) );
+
+		compo.get_layer( 0 )->set_end_velocity( 0.5 );
+		compo.set_layer( createLayer( 0.5, 1.0 ), 1 );
+		compo.update_layer_table();
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.8 ) == std::vector<int>( { 1 } ) );
+
+		compo.set_layer( nullptr, 1 );
+		compo.update_layer_table();
+		CPPUNIT_ASSERT( selectLayers( &compo, 0.8 ) == std::vector<int>( { 0 } ) );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( InstrumentComponentTest );
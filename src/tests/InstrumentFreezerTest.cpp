@@ -0,0 +1,78 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/AudioEngine.h>
+#include <core/InstrumentFreezer.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+
+using namespace H2Core;
+
+class InstrumentFreezerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( InstrumentFreezerTest );
+	CPPUNIT_TEST( testPatternFingerprint );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp()
+	{
+		AudioEngine::create_instance();
+	}
+
+	void testPatternFingerprint()
+	{
+		Instrument* pInstr = new Instrument();
+		Instrument* pOther = new Instrument();
+		Pattern* pPattern = new Pattern();
+
+		CPPUNIT_ASSERT_EQUAL( static_cast<uint64_t>( 0 ),
+							  InstrumentFreezer::patternFingerprint( pPattern, pInstr ) );
+
+		Note* pNote = new Note( pInstr, 0, 0.8, 0.5, 0.5, -1, 0 );
+		pPattern->insert_note( pNote );
+		uint64_t nFingerprint = InstrumentFreezer::patternFingerprint( pPattern, pInstr );
+		CPPUNIT_ASSERT( nFingerprint != 0 );
+
+		// Notes of other instruments do not matter.
+		pPattern->insert_note( new Note( pOther, 48, 1.0, 0.5, 0.5, -1, 0 ) );
+		CPPUNIT_ASSERT_EQUAL( nFingerprint,
+							  InstrumentFreezer::patternFingerprint( pPattern, pInstr ) );
+
+		pNote->set_velocity( 0.6 );
+		CPPUNIT_ASSERT( nFingerprint !=
+						InstrumentFreezer::patternFingerprint( pPattern, pInstr ) );
+
+		delete pPattern;
+		delete pOther;
+		delete pInstr;
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( InstrumentFreezerTest );
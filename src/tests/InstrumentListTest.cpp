@@ -13,6 +13,8 @@ class InstrumentListTest : public CppUnit::TestCase {
 	CPPUNIT_TEST( test2 );
 	CPPUNIT_TEST( test3 );
 	CPPUNIT_TEST( test4 );
+	CPPUNIT_TEST( test_find_midi_note );
+	CPPUNIT_TEST( test_find );
 	CPPUNIT_TEST_SUITE_END();
 	
 	public:
@@ -99,6 +101,76 @@ class InstrumentListTest : public CppUnit::TestCase {
 		CPPUNIT_ASSERT( !list.is_valid_index(1) );
 		CPPUNIT_ASSERT( !list.is_valid_index(-42) );
 	}
+
+	void test_find_midi_note()
+	{
+		InstrumentList list;
+
+		Instrument *pKick = new Instrument(EMPTY_INSTR_ID, "Kick");
+		pKick->set_midi_out_note(36);
+		list.add(pKick);
+
+		Instrument *pSnare = new Instrument(EMPTY_INSTR_ID, "Snare");
+		pSnare->set_midi_out_note(38);
+		list.add(pSnare);
+
+		Instrument *pLayer = new Instrument(EMPTY_INSTR_ID, "Layer");
+		pLayer->set_midi_out_note(36);
+		list.add(pLayer);
+
+		CPPUNIT_ASSERT( list.findMidiNote(36) == pKick );
+		CPPUNIT_ASSERT( list.findMidiNote(38) == pSnare );
+		CPPUNIT_ASSERT( list.findMidiNote(40) == nullptr );
+
+		// Instruments sharing a note
+		CPPUNIT_ASSERT_EQUAL( 0, list.findMidiNoteIndex(36) );
+		CPPUNIT_ASSERT_EQUAL( 2, list.findMidiNoteIndex(36, 0) );
+		CPPUNIT_ASSERT_EQUAL( -1, list.findMidiNoteIndex(36, 2) );
+
+		// Changing the note of an instrument already in the list
+		pKick->set_midi_out_note(40);
+		CPPUNIT_ASSERT( list.findMidiNote(36) == pLayer );
+		CPPUNIT_ASSERT( list.findMidiNote(40) == pKick );
+
+		list.move(2, 0);
+		CPPUNIT_ASSERT_EQUAL( 0, list.findMidiNoteIndex(36) );
+		CPPUNIT_ASSERT_EQUAL( 1, list.findMidiNoteIndex(40) );
+	}
+
+	void test_find()
+	{
+		InstrumentList list;
+
+		// More instruments than initial slots of the id table.
+		for ( int i = 0; i < 40; i++ ) {
+			list.add( new Instrument( i, QString( "Instr %1" ).arg( i ) ) );
+		}
+		Instrument *pDuplicate = new Instrument( 7, "Instr 3" );
+		list.add( pDuplicate );
+
+		CPPUNIT_ASSERT( list.find( 0 ) == list.get( 0 ) );
+		CPPUNIT_ASSERT( list.find( 39 ) == list.get( 39 ) );
+		CPPUNIT_ASSERT( list.find( 40 ) == nullptr );
+		CPPUNIT_ASSERT( list.find( "Instr 21" ) == list.get( 21 ) );
+		CPPUNIT_ASSERT( list.find( "Kick" ) == nullptr );
+
+		// Duplicates resolve to the lowest index.
+		CPPUNIT_ASSERT( list.find( 7 ) == list.get( 7 ) );
+		CPPUNIT_ASSERT( list.find( "Instr 3" ) == list.get( 3 ) );
+
+		// Changing an instrument already in the list
+		Instrument *pInstr = list.get( 5 );
+		pInstr->set_id( 100 );
+		pInstr->set_name( "Kick" );
+		CPPUNIT_ASSERT( list.find( 5 ) == nullptr );
+		CPPUNIT_ASSERT( list.find( 100 ) == pInstr );
+		CPPUNIT_ASSERT( list.find( "Instr 5" ) == nullptr );
+		CPPUNIT_ASSERT( list.find( "Kick" ) == pInstr );
+
+		delete list.del( 7 );
+		CPPUNIT_ASSERT( list.find( 7 ) == pDuplicate );
+		CPPUNIT_ASSERT( list.find( 8 ) == list.get( 7 ) );
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( InstrumentListTest );
@@ -0,0 +1,89 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/LoudnessMeter.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace H2Core;
+
+class LoudnessMeterTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( LoudnessMeterTest );
+	CPPUNIT_TEST( testSilence );
+	CPPUNIT_TEST( testSine );
+	CPPUNIT_TEST( testTruePeak );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Meters @a nFrames of a stereo sine with amplitude @a fAmplitude,
+		@a fFrequency Hz and initial phase @a fPhase.*/
+	void meterSine( LoudnessMeter& meter, unsigned nSampleRate, float fAmplitude,
+					double fFrequency, double fPhase, int nFrames )
+	{
+		std::vector<float> frames( 2 * nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			frames[ 2 * ii ] = fAmplitude *
+				std::sin( 2 * M_PI * fFrequency * ii / nSampleRate + fPhase );
+			frames[ 2 * ii + 1 ] = frames[ 2 * ii ];
+		}
+		// Blocks not aligned to the 100 ms sub-blocks.
+		for ( int ii = 0; ii < nFrames; ii += 1000 ) {
+			meter.process( &frames[ 2 * ii ], std::min( 1000, nFrames - ii ) );
+		}
+	}
+
+	public:
+	void testSilence()
+	{
+		LoudnessMeter meter( 48000 );
+		std::vector<float> frames( 2 * 48000, 0.f );
+		meter.process( frames.data(), 48000 );
+		CPPUNIT_ASSERT( std::isinf( meter.getIntegratedLoudness() ) );
+		CPPUNIT_ASSERT( std::isinf( meter.getTruePeak() ) );
+	}
+
+	void testSine()
+	{
+		// A 997 Hz sine of -20 dBFS on both channels reads -20 LUFS.
+		LoudnessMeter meter( 48000 );
+		meterSine( meter, 48000, 0.1f, 997, 0, 5 * 48000 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( -20.0, meter.getIntegratedLoudness(), 0.1 );
+
+		LoudnessMeter meter44( 44100 );
+		meterSine( meter44, 44100, 0.1f, 997, 0, 5 * 44100 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( -20.0, meter44.getIntegratedLoudness(), 0.1 );
+	}
+
+	void testTruePeak()
+	{
+		// A quarter sample rate sine sampled at 45 degrees peaks between
+		// the samples, 3 dB above the largest sample.
+		LoudnessMeter meter( 48000 );
+		meterSine( meter, 48000, 0.5f, 12000, M_PI / 4, 48000 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 20 * std::log10( 0.5 ), meter.getTruePeak(), 0.5 );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LoudnessMeterTest );
@@ -0,0 +1,97 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/IO/MetricsExporter.h>
+
+#include <cstring>
+
+using namespace H2Core;
+
+class MetricsExporterTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( MetricsExporterTest );
+	CPPUNIT_TEST( testParseProtocol );
+	CPPUNIT_TEST( testPrometheus );
+	CPPUNIT_TEST( testStatsD );
+	CPPUNIT_TEST_SUITE_END();
+
+	static MetricsExporter::Snapshot emptySnapshot()
+	{
+		MetricsExporter::Snapshot snapshot;
+		memset( &snapshot, 0, sizeof( snapshot ) );
+		return snapshot;
+	}
+
+public:
+	void testParseProtocol()
+	{
+		CPPUNIT_ASSERT( MetricsExporter::parseProtocol( " StatsD" ) ==
+						MetricsExporter::PROTOCOL_STATSD );
+		CPPUNIT_ASSERT( MetricsExporter::parseProtocol( "prometheus" ) ==
+						MetricsExporter::PROTOCOL_PROMETHEUS );
+		CPPUNIT_ASSERT( MetricsExporter::parseProtocol( "unknown" ) ==
+						MetricsExporter::PROTOCOL_PROMETHEUS );
+	}
+
+	void testPrometheus()
+	{
+		auto snapshot = emptySnapshot();
+		snapshot.stages[ ProcessProfiler::STAGE_TOTAL ].fPercentile99 = 1.5;
+		snapshot.nXRuns = 3;
+		snapshot.nSamplerVoices = 12;
+		snapshot.nResidentSampleBytes = 4096;
+
+		const QByteArray out = MetricsExporter::formatPrometheus( snapshot );
+		CPPUNIT_ASSERT( out.contains( "# TYPE hydrogen_xruns_total counter\n" ) );
+		CPPUNIT_ASSERT( out.contains(
+			"hydrogen_cycle_time_milliseconds{stage=\"total\",quantile=\"0.99\"} 1.5\n" ) );
+		CPPUNIT_ASSERT( out.contains( "hydrogen_xruns_total 3\n" ) );
+		CPPUNIT_ASSERT( out.contains( "hydrogen_active_voices{engine=\"sampler\"} 12\n" ) );
+		CPPUNIT_ASSERT( out.contains( "hydrogen_sample_memory_bytes{kind=\"resident\"} 4096\n" ) );
+	}
+
+	void testStatsD()
+	{
+		auto previous = emptySnapshot();
+		previous.nXRuns = 5;
+		previous.nDroppedCycles = 10;
+		auto snapshot = previous;
+		snapshot.nXRuns = 7;
+		// Reset in between.
+		snapshot.nDroppedCycles = 4;
+		snapshot.nSynthVoices = 2;
+
+		const QByteArray out = MetricsExporter::formatStatsD( snapshot, previous );
+		CPPUNIT_ASSERT( out.contains( "hydrogen.xruns:2|c\n" ) );
+		CPPUNIT_ASSERT( out.contains( "hydrogen.profiler_dropped_cycles:4|c\n" ) );
+		CPPUNIT_ASSERT( out.contains( "hydrogen.active_voices.synth:2|g\n" ) );
+		CPPUNIT_ASSERT( ! out.contains( "hydrogen.missed_engine_locks" ) );
+		for ( const auto& line : out.split( '\n' ) ) {
+			CPPUNIT_ASSERT( line.isEmpty() || line.startsWith( "hydrogen." ) );
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MetricsExporterTest );
@@ -0,0 +1,127 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/AudioEngine.h>
+#include <core/IO/NetworkStemOutput.h>
+
+#include <QtCore/QtEndian>
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QUdpSocket>
+
+#include <cstring>
+#include <vector>
+
+using namespace H2Core;
+
+class NetworkStemOutputTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( NetworkStemOutputTest );
+	CPPUNIT_TEST( testParseTracks );
+	CPPUNIT_TEST( testDatagrams );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp()
+	{
+		AudioEngine::create_instance();
+	}
+
+	void testParseTracks()
+	{
+		auto tracks = NetworkStemOutput::parseTracks( "0, 2,x,,2,-1,5" );
+		CPPUNIT_ASSERT_EQUAL( static_cast<size_t>( 3 ), tracks.size() );
+		CPPUNIT_ASSERT_EQUAL( 0, tracks[ 0 ] );
+		CPPUNIT_ASSERT_EQUAL( 2, tracks[ 1 ] );
+		CPPUNIT_ASSERT_EQUAL( 5, tracks[ 2 ] );
+	}
+
+	void testDatagrams()
+	{
+		QUdpSocket receiver;
+		CPPUNIT_ASSERT( receiver.bind( QHostAddress::LocalHost, 0 ) );
+
+		NetworkStemOutput output;
+		CPPUNIT_ASSERT( ! output.start( "127.0.0.1", 0, { 0 } ) );
+		CPPUNIT_ASSERT( ! output.start( "127.0.0.1", receiver.localPort(), {} ) );
+		// The main output and a track the driver does not provide.
+		CPPUNIT_ASSERT( output.start( "127.0.0.1", receiver.localPort(), { 0, 1 } ) );
+		CPPUNIT_ASSERT( output.isEnabled() );
+
+		const int nFrames = 256;
+		std::vector<float> main_L( nFrames ), main_R( nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			main_L[ ii ] = ii / 1000.0;
+			main_R[ ii ] = -ii / 1000.0;
+		}
+		output.process( nullptr, main_L.data(), main_R.data(), nFrames, 48000 );
+
+		// Four channels leave room for 89 frames per datagram.
+		const int nFramesPerDatagram = ( NetworkStemOutput::nMaxDatagramSize -
+										 NetworkStemOutput::nHeaderSize ) / 16;
+		long long nExpectedFrame = 0;
+		uint32_t nExpectedSequence = 0;
+		while ( nExpectedFrame < nFrames ) {
+			CPPUNIT_ASSERT( receiver.hasPendingDatagrams() ||
+							receiver.waitForReadyRead( 5000 ) );
+			std::vector<uchar> datagram( receiver.pendingDatagramSize() );
+			receiver.readDatagram( reinterpret_cast<char*>( datagram.data() ), datagram.size() );
+			const uchar* p = datagram.data();
+
+			CPPUNIT_ASSERT_EQUAL( NetworkStemOutput::nMagic, qFromLittleEndian<quint32>( p ) );
+			CPPUNIT_ASSERT_EQUAL( NetworkStemOutput::nVersion, qFromLittleEndian<quint16>( p + 4 ) );
+			CPPUNIT_ASSERT_EQUAL( static_cast<quint16>( 4 ), qFromLittleEndian<quint16>( p + 6 ) );
+			CPPUNIT_ASSERT_EQUAL( nExpectedSequence, qFromLittleEndian<quint32>( p + 8 ) );
+			CPPUNIT_ASSERT_EQUAL( static_cast<quint32>( 48000 ), qFromLittleEndian<quint32>( p + 12 ) );
+			long long nFrame = qFromLittleEndian<quint64>( p + 16 );
+			CPPUNIT_ASSERT_EQUAL( nExpectedFrame, nFrame );
+			int nDatagramFrames = qFromLittleEndian<quint16>( p + 32 );
+			CPPUNIT_ASSERT( nDatagramFrames > 0 && nDatagramFrames <= nFramesPerDatagram );
+			CPPUNIT_ASSERT_EQUAL( static_cast<size_t>( NetworkStemOutput::nHeaderSize +
+													   16 * nDatagramFrames ),
+								  datagram.size() );
+
+			for ( int ii = 0; ii < nDatagramFrames; ++ii ) {
+				float frame[ 4 ];
+				for ( int nChannel = 0; nChannel < 4; ++nChannel ) {
+					quint32 nBits = qFromLittleEndian<quint32>(
+						p + NetworkStemOutput::nHeaderSize + 4 * ( 4 * ii + nChannel ) );
+					memcpy( &frame[ nChannel ], &nBits, sizeof( nBits ) );
+				}
+				CPPUNIT_ASSERT_EQUAL( main_L[ nFrame + ii ], frame[ 0 ] );
+				CPPUNIT_ASSERT_EQUAL( main_R[ nFrame + ii ], frame[ 1 ] );
+				CPPUNIT_ASSERT_EQUAL( 0.0f, frame[ 2 ] );
+				CPPUNIT_ASSERT_EQUAL( 0.0f, frame[ 3 ] );
+			}
+
+			nExpectedFrame += nDatagramFrames;
+			++nExpectedSequence;
+		}
+
+		output.stop();
+		CPPUNIT_ASSERT( ! output.isEnabled() );
+		CPPUNIT_ASSERT_EQUAL( 0LL, output.getDroppedFrames() );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( NetworkStemOutputTest );
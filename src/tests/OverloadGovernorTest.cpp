@@ -0,0 +1,105 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/OverloadGovernor.h>
+
+using namespace H2Core;
+
+class OverloadGovernorTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( OverloadGovernorTest );
+	CPPUNIT_TEST( testSustainedLoad );
+	CPPUNIT_TEST( testXRuns );
+	CPPUNIT_TEST( testRecovery );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Duration of a single simulated cycle in milliseconds.*/
+	const float fCycle = 10;
+
+	/** Feeds @a nCycles cycles of @a fLoad into @a governor.*/
+	void run( OverloadGovernor& governor, float fLoad, int nCycles )
+	{
+		for ( int ii = 0; ii < nCycles; ++ii ) {
+			governor.update( fLoad * fCycle, fCycle );
+		}
+	}
+
+	public:
+	void testSustainedLoad()
+	{
+		OverloadGovernor governor;
+		int nWindow = OverloadGovernor::fWindowLength / fCycle;
+
+		run( governor, 0.7, 3 * nWindow );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_FULL );
+
+		run( governor, 0.9, nWindow - 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_FULL );
+		run( governor, 0.9, 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_LINEAR_INTERPOLATION );
+
+		// No further step within the hold time.
+		int nHold = OverloadGovernor::fHoldLength / fCycle;
+		run( governor, 0.9, nHold - 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_LINEAR_INTERPOLATION );
+
+		run( governor, 0.9, 20 * nWindow );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_REDUCED_VOICES );
+
+		governor.reset();
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_FULL );
+	}
+
+	void testXRuns()
+	{
+		OverloadGovernor governor;
+
+		run( governor, 1.1, 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_FULL );
+		run( governor, 1.1, 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_LINEAR_INTERPOLATION );
+	}
+
+	void testRecovery()
+	{
+		OverloadGovernor governor;
+		run( governor, 1.1, 2 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_LINEAR_INTERPOLATION );
+
+		// A single busy cycle restarts the calm period.
+		int nRecover = OverloadGovernor::fRecoverLength / fCycle;
+		run( governor, 0.2, nRecover - 1 );
+		run( governor, 0.6, 1 );
+		run( governor, 0.2, nRecover - 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_LINEAR_INTERPOLATION );
+
+		run( governor, 0.2, 1 );
+		CPPUNIT_ASSERT( governor.getLevel() == OverloadGovernor::LEVEL_FULL );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( OverloadGovernorTest );
@@ -0,0 +1,60 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Basics/PatternIndex.h>
+#include "TestHelper.h"
+
+using namespace H2Core;
+
+class PatternIndexTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( PatternIndexTest );
+	CPPUNIT_TEST( testReadEntry );
+	CPPUNIT_TEST( testMissingFile );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testReadEntry()
+	{
+		PatternIndex::Entry entry = PatternIndex::read_entry( H2TEST_FILE( "/pattern/pat.h2pattern" ) );
+
+		CPPUNIT_ASSERT( entry.bLoaded );
+		CPPUNIT_ASSERT( entry.sName == "1" );
+		CPPUNIT_ASSERT( entry.sCategory == "unknown" );
+		CPPUNIT_ASSERT( entry.sDrumkitName == "GMkit" );
+		CPPUNIT_ASSERT_EQUAL( 192, entry.nLength );
+		CPPUNIT_ASSERT_EQUAL( 22, entry.nNotes );
+		CPPUNIT_ASSERT( entry.instruments == QList<int>( { 0, 1, 2, 3, 69, 666 } ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 5.5, entry.fNoteDensity, 1e-6 );
+	}
+
+	void testMissingFile()
+	{
+		PatternIndex::Entry entry = PatternIndex::read_entry( H2TEST_FILE( "/pattern/missing.h2pattern" ) );
+
+		CPPUNIT_ASSERT( ! entry.bLoaded );
+		CPPUNIT_ASSERT_EQUAL( 0, entry.nNotes );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PatternIndexTest );
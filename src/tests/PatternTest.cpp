@@ -2,6 +2,7 @@
 
 #include <core/AudioEngine.h>
 #include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
 
 CPPUNIT_TEST_SUITE_REGISTRATION( PatternTest );
 
@@ -27,3 +28,141 @@ void PatternTest::testPurgeInstrument()
 
 	delete pPattern;
 }
+
+
+void PatternTest::testMergedNotes()
+{
+	Instrument *pInstrument = new Instrument();
+	Pattern *pFirst = new Pattern();
+	Pattern *pSecond = new Pattern();
+	Note *pNote0 = new Note( pInstrument, 0, 1.0, 1.0, 1.0, 1, 1.0 );
+	Note *pNote1 = new Note( pInstrument, 4, 1.0, 1.0, 1.0, 1, 1.0 );
+	Note *pNote2 = new Note( pInstrument, 4, 1.0, 1.0, 1.0, 1, 1.0 );
+	pFirst->insert_note( pNote0 );
+	pFirst->insert_note( pNote1 );
+	pSecond->insert_note( pNote2 );
+
+	PatternList *pList = new PatternList();
+	pList->add( pFirst );
+	pList->add( pSecond );
+
+	int nCount = -1;
+	Note* const* ppNotes = pList->get_notes_at( 0, nCount );
+	CPPUNIT_ASSERT_EQUAL( 1, nCount );
+	CPPUNIT_ASSERT( ppNotes[ 0 ] == pNote0 );
+	ppNotes = pList->get_notes_at( 4, nCount );
+	CPPUNIT_ASSERT_EQUAL( 2, nCount );
+	CPPUNIT_ASSERT( ppNotes[ 0 ] == pNote1 );
+	CPPUNIT_ASSERT( ppNotes[ 1 ] == pNote2 );
+	pList->get_notes_at( 2, nCount );
+	CPPUNIT_ASSERT_EQUAL( 0, nCount );
+	pList->get_notes_at( 5, nCount );
+	CPPUNIT_ASSERT_EQUAL( 0, nCount );
+
+	// Editing a note does update the columns of the table.
+	pNote2->set_probability( 0.5 );
+	const float* pLeadLag = nullptr;
+	const float* pProbability = nullptr;
+	pList->get_notes_at( 4, nCount, pLeadLag, pProbability );
+	CPPUNIT_ASSERT_EQUAL( 2, nCount );
+	CPPUNIT_ASSERT_EQUAL( 1.0f, pProbability[ 0 ] );
+	CPPUNIT_ASSERT_EQUAL( 0.5f, pProbability[ 1 ] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pLeadLag[ 1 ] );
+
+	// Changing a pattern does invalidate the merged table.
+	pSecond->remove_note( pNote2 );
+	pList->get_notes_at( 4, nCount );
+	CPPUNIT_ASSERT_EQUAL( 1, nCount );
+	delete pNote2;
+
+	pList->del( pFirst );
+	pList->get_notes_at( 0, nCount );
+	CPPUNIT_ASSERT_EQUAL( 0, nCount );
+
+	delete pList;
+	delete pFirst;
+	delete pInstrument;
+}
+
+
+void PatternTest::testInstrumentNotes()
+{
+	Instrument *pKick = new Instrument();
+	Instrument *pSnare = new Instrument();
+	Note *pKick0 = new Note( pKick, 0, 1.0, 1.0, 1.0, 4, 1.0 );
+	Note *pSnare2 = new Note( pSnare, 2, 1.0, 1.0, 1.0, 1, 1.0 );
+	Note *pKick4 = new Note( pKick, 4, 1.0, 1.0, 1.0, 1, 1.0 );
+	Note *pKick4b = new Note( pKick, 4, 1.0, 1.0, 1.0, 1, 1.0 );
+
+	Pattern *pPattern = new Pattern();
+	pPattern->insert_note( pKick4 );
+	pPattern->insert_note( pSnare2 );
+	pPattern->insert_note( pKick0 );
+	pPattern->insert_note( pKick4b );
+
+	int nCount = -1;
+	Note* const* ppNotes = pPattern->get_instrument_notes( pKick, 0, 8, nCount );
+	CPPUNIT_ASSERT_EQUAL( 3, nCount );
+	CPPUNIT_ASSERT( ppNotes[ 0 ] == pKick0 );
+	CPPUNIT_ASSERT( ppNotes[ 1 ] == pKick4 );
+	CPPUNIT_ASSERT( ppNotes[ 2 ] == pKick4b );
+	pPattern->get_instrument_notes( pKick, 1, 4, nCount );
+	CPPUNIT_ASSERT_EQUAL( 0, nCount );
+	ppNotes = pPattern->get_instrument_notes( pSnare, 0, 8, nCount );
+	CPPUNIT_ASSERT_EQUAL( 1, nCount );
+	CPPUNIT_ASSERT( ppNotes[ 0 ] == pSnare2 );
+
+	// Notes covering a position are found by the non-strict search.
+	CPPUNIT_ASSERT( pPattern->find_note( 3, 3, pKick, false ) == pKick0 );
+	CPPUNIT_ASSERT( pPattern->find_note( 3, 3, pSnare, false ) == nullptr );
+	CPPUNIT_ASSERT( pPattern->find_note( 4, -1, pKick ) == pKick4 );
+
+	pPattern->remove_note( pKick4 );
+	ppNotes = pPattern->get_instrument_notes( pKick, 4, 5, nCount );
+	CPPUNIT_ASSERT_EQUAL( 1, nCount );
+	CPPUNIT_ASSERT( ppNotes[ 0 ] == pKick4b );
+	delete pKick4;
+
+	// Notes modified directly are picked up after notes_changed().
+	Pattern::notes_t *pNotes = const_cast<Pattern::notes_t*>( pPattern->get_notes() );
+	pNotes->insert( std::make_pair( 6, new Note( pSnare, 6, 1.0, 1.0, 1.0, 1, 1.0 ) ) );
+	pPattern->notes_changed();
+	pPattern->get_instrument_notes( pSnare, 0, 8, nCount );
+	CPPUNIT_ASSERT_EQUAL( 2, nCount );
+
+	delete pPattern;
+	delete pKick;
+	delete pSnare;
+}
+
+
+void PatternTest::testFindByName()
+{
+	Pattern *pFirst = new Pattern( "Verse" );
+	Pattern *pSecond = new Pattern( "Chorus" );
+	Pattern *pDuplicate = new Pattern( "Verse" );
+
+	PatternList *pList = new PatternList();
+	pList->add( pFirst );
+	pList->add( pSecond );
+	pList->add( pDuplicate );
+
+	CPPUNIT_ASSERT( pList->find( "Verse" ) == pFirst );
+	CPPUNIT_ASSERT( pList->find( "Chorus" ) == pSecond );
+	CPPUNIT_ASSERT( pList->find( "Bridge" ) == nullptr );
+	CPPUNIT_ASSERT( ! pList->check_name( "Verse", pSecond ) );
+	CPPUNIT_ASSERT( ! pList->check_name( "Verse", pFirst ) );
+	CPPUNIT_ASSERT( pList->check_name( "Chorus", pSecond ) );
+
+	// Renaming a pattern already in the list
+	pSecond->set_name( "Bridge" );
+	CPPUNIT_ASSERT( pList->find( "Chorus" ) == nullptr );
+	CPPUNIT_ASSERT( pList->find( "Bridge" ) == pSecond );
+
+	pList->del( pFirst );
+	CPPUNIT_ASSERT( pList->find( "Verse" ) == pDuplicate );
+	CPPUNIT_ASSERT( pList->check_name( "Verse", pDuplicate ) );
+
+	delete pFirst;
+	delete pList;
+}
@@ -6,11 +6,17 @@
 class PatternTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE(PatternTest);
 	CPPUNIT_TEST(testPurgeInstrument);
+	CPPUNIT_TEST(testMergedNotes);
+	CPPUNIT_TEST(testInstrumentNotes);
+	CPPUNIT_TEST(testFindByName);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
 		virtual void setUp();
 		void testPurgeInstrument();
+		void testMergedNotes();
+		void testInstrumentNotes();
+		void testFindByName();
 };
 
 
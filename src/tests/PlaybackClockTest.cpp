@@ -0,0 +1,64 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/PlaybackClock.h>
+#include <core/rt_clock.h>
+
+using namespace H2Core;
+
+class PlaybackClockTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( PlaybackClockTest );
+	CPPUNIT_TEST( testExtrapolation );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testExtrapolation()
+	{
+		PlaybackClock clock;
+		PlaybackClock::Position position;
+		CPPUNIT_ASSERT( ! clock.get( rtclock_now_ns(), &position ) );
+
+		clock.beginCycle( 256, 48000 );
+		const int64_t nStart = rtclock_now_ns();
+		clock.publish( 4800, 10.0, false, 0, 192 );
+		CPPUNIT_ASSERT( clock.get( nStart + 1000000000LL, &position ) );
+		// Stopped transport is not extrapolated.
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 480.0, position.fTick, 1e-9 );
+		CPPUNIT_ASSERT( ! position.bRolling );
+		CPPUNIT_ASSERT_EQUAL( 192, position.nPatternSize );
+
+		clock.publish( 4800, 10.0, true, 0, 192 );
+		// Never ahead of the last cycle by more than the maximum
+		// phase.
+		CPPUNIT_ASSERT( clock.get( nStart + 1000000000LL, &position ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( ( 4800 + PlaybackClock::fMaxPhase * 256 ) / 10.0,
+									  position.fTick, 1e-6 );
+		// Nor behind its start.
+		CPPUNIT_ASSERT( clock.get( nStart - 1000000000LL, &position ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 480.0, position.fTick, 1e-6 );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PlaybackClockTest );
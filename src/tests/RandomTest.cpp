@@ -0,0 +1,91 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/Random.h>
+
+#include <cmath>
+
+using namespace H2Core;
+
+class RandomTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RandomTest );
+	CPPUNIT_TEST( testSeed );
+	CPPUNIT_TEST( testUniform );
+	CPPUNIT_TEST( testGaussian );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testSeed()
+	{
+		Random first( 42 ), second( 42 ), third( 43 );
+		bool bDiffers = false;
+		for ( int ii = 0; ii < 100; ++ii ) {
+			uint32_t nValue = first.next();
+			CPPUNIT_ASSERT( nValue == second.next() );
+			bDiffers = bDiffers || nValue != third.next();
+		}
+		CPPUNIT_ASSERT( bDiffers );
+
+		first.seed( 42 );
+		second.seed( 42 );
+		CPPUNIT_ASSERT( first.next() == second.next() );
+	}
+
+	void testUniform()
+	{
+		Random random( 1 );
+		double fSum = 0;
+		const int nDraws = 100000;
+		for ( int ii = 0; ii < nDraws; ++ii ) {
+			float fValue = random.uniform();
+			CPPUNIT_ASSERT( fValue >= 0 && fValue < 1 );
+			fSum += fValue;
+
+			int nValue = random.below( 7 );
+			CPPUNIT_ASSERT( nValue >= 0 && nValue < 7 );
+		}
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, fSum / nDraws, 0.01 );
+	}
+
+	void testGaussian()
+	{
+		Random random( 1 );
+		double fSum = 0, fSquares = 0;
+		const int nDraws = 100000;
+		for ( int ii = 0; ii < nDraws; ++ii ) {
+			float fValue = random.gaussian( 0.5 );
+			CPPUNIT_ASSERT( std::fabs( fValue ) < 0.5 * 4 );
+			fSum += fValue;
+			fSquares += fValue * fValue;
+		}
+		double fMean = fSum / nDraws;
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, fMean, 0.01 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, std::sqrt( fSquares / nDraws - fMean * fMean ), 0.01 );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RandomTest );
@@ -0,0 +1,91 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/IO/RenderAhead.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace H2Core;
+
+static const unsigned nTestBufferSize = 64;
+static float fTestOut_L[ nTestBufferSize ];
+static float fTestOut_R[ nTestBufferSize ];
+/** Number of cycles rendered by testProcess().*/
+static int nTestCycles = 0;
+
+/** Fills the left channel with the number of the cycle and the
+	right one with its negative.*/
+static int testProcess( uint32_t nFrames, void* )
+{
+	for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+		fTestOut_L[ ii ] = nTestCycles;
+		fTestOut_R[ ii ] = -nTestCycles;
+	}
+	nTestCycles++;
+	return 0;
+}
+
+class RenderAheadTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RenderAheadTest );
+	CPPUNIT_TEST( testOrder );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testOrder()
+	{
+		const int nBuffers = 3;
+		nTestCycles = 0;
+		RenderAhead renderAhead( testProcess, 2, nTestBufferSize, nBuffers );
+		renderAhead.start( []( const float** ppOut ) {
+			ppOut[ 0 ] = fTestOut_L;
+			ppOut[ 1 ] = fTestOut_R;
+		} );
+
+		for ( int nCycle = 0; nCycle < 20; ++nCycle ) {
+			const float* const* ppRendered = nullptr;
+			for ( int nTry = 0; nTry < 1000 && ppRendered == nullptr; ++nTry ) {
+				ppRendered = renderAhead.front();
+				if ( ppRendered == nullptr ) {
+					std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+				}
+			}
+			CPPUNIT_ASSERT( ppRendered != nullptr );
+			CPPUNIT_ASSERT_EQUAL( static_cast<float>( nCycle ), ppRendered[ 0 ][ 0 ] );
+			CPPUNIT_ASSERT_EQUAL( static_cast<float>( nCycle ), ppRendered[ 0 ][ nTestBufferSize - 1 ] );
+			CPPUNIT_ASSERT_EQUAL( static_cast<float>( -nCycle ), ppRendered[ 1 ][ nTestBufferSize - 1 ] );
+			renderAhead.pop();
+		}
+
+		// The render thread does not get further ahead than
+		// requested.
+		std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+		renderAhead.stop();
+		CPPUNIT_ASSERT( nTestCycles <= 20 + nBuffers );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RenderAheadTest );
@@ -0,0 +1,93 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/Resampler.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace H2Core;
+
+class ResamplerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( ResamplerTest );
+	CPPUNIT_TEST( testSupported );
+	CPPUNIT_TEST( testLength );
+	CPPUNIT_TEST( testSine );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Resamples @a nFrames of a stereo sine of @a fFrequency Hz in
+		blocks of @a nBlockSize frames.*/
+	std::vector<float> resampleSine( unsigned nInputRate, unsigned nOutputRate,
+									 double fFrequency, int nFrames, int nBlockSize )
+	{
+		std::vector<float> in( 2 * nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			in[ 2 * ii ] = 0.5 * std::sin( 2 * M_PI * fFrequency * ii / nInputRate );
+			in[ 2 * ii + 1 ] = -in[ 2 * ii ];
+		}
+
+		Resampler resampler( nInputRate, nOutputRate );
+		std::vector<float> out;
+		for ( int ii = 0; ii < nFrames; ii += nBlockSize ) {
+			resampler.process( &in[ 2 * ii ], std::min( nBlockSize, nFrames - ii ), out );
+		}
+		resampler.flush( out );
+		return out;
+	}
+
+	public:
+	void testSupported()
+	{
+		CPPUNIT_ASSERT( Resampler::isSupported( 48000, 44100 ) );
+		CPPUNIT_ASSERT( Resampler::isSupported( 44100, 96000 ) );
+		CPPUNIT_ASSERT( ! Resampler::isSupported( 44100, 44101 ) );
+		CPPUNIT_ASSERT( ! Resampler::isSupported( 0, 44100 ) );
+	}
+
+	void testLength()
+	{
+		std::vector<float> out = resampleSine( 48000, 44100, 1000, 4800, 333 );
+		CPPUNIT_ASSERT_EQUAL( static_cast<size_t>( 2 * 4410 ), out.size() );
+
+		out = resampleSine( 22050, 48000, 1000, 2205, 4096 );
+		CPPUNIT_ASSERT_EQUAL( static_cast<size_t>( 2 * 4800 ), out.size() );
+	}
+
+	void testSine()
+	{
+		// Away from both ends the output has to match the sine at
+		// the new rate, without any delay.
+		const unsigned nOutputRate = 44100;
+		const double fFrequency = 1000;
+		std::vector<float> out = resampleSine( 48000, nOutputRate, fFrequency, 9600, 512 );
+		for ( int ii = 1000; ii < 7000; ++ii ) {
+			double fExpected = 0.5 * std::sin( 2 * M_PI * fFrequency * ii / nOutputRate );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fExpected, out[ 2 * ii ], 1e-3 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( -fExpected, out[ 2 * ii + 1 ], 1e-3 );
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ResamplerTest );
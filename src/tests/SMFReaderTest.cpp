@@ -0,0 +1,116 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Smf/SMFReader.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+
+#include <QTemporaryFile>
+
+using namespace H2Core;
+
+class SMFReaderTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SMFReaderTest );
+	CPPUNIT_TEST( testImport );
+	CPPUNIT_TEST( testInvalidFile );
+	CPPUNIT_TEST_SUITE_END();
+
+	InstrumentList* m_pInstrumentList;
+
+public:
+	void setUp() override
+	{
+		m_pInstrumentList = new InstrumentList();
+		Instrument* pKick = new Instrument( 0, "Kick" );
+		pKick->set_midi_out_note( 36 );
+		Instrument* pSnare = new Instrument( 1, "Snare" );
+		pSnare->set_midi_out_note( 38 );
+		m_pInstrumentList->add( pKick );
+		m_pInstrumentList->add( pSnare );
+	}
+
+	void tearDown() override
+	{
+		delete m_pInstrumentList;
+	}
+
+	void testImport()
+	{
+		// Type 0 file with 96 ticks per quarter note in 3/4.
+		const unsigned char track[] = {
+			0x00, 0xFF, 0x58, 0x04, 0x03, 0x02, 0x18, 0x08,
+			0x00, 0x99, 0x24, 0x64,		// kick
+			0x00, 0x26, 0x50,			// snare using running status
+			0x30, 0x24, 0x00,			// kick off
+			0x00, 0x2A, 0x40,			// no matching instrument
+			0x2F, 0x24, 0x14,			// kick at 95 ticks
+			0x01, 0x24, 0x7F,			// kick at 96 ticks
+			0x00, 0xFF, 0x2F, 0x00
+		};
+		const unsigned char header[] = {
+			'M', 'T', 'h', 'd', 0x00, 0x00, 0x00, 0x06,
+			0x00, 0x00, 0x00, 0x01, 0x00, 0x60,
+			'M', 'T', 'r', 'k', 0x00, 0x00, 0x00, sizeof( track )
+		};
+
+		QTemporaryFile file;
+		CPPUNIT_ASSERT( file.open() );
+		file.write( reinterpret_cast<const char*>( header ), sizeof( header ) );
+		file.write( reinterpret_cast<const char*>( track ), sizeof( track ) );
+		file.close();
+
+		SMFReader reader( m_pInstrumentList, 48 );
+		Pattern* pPattern = reader.import( file.fileName() );
+		CPPUNIT_ASSERT( pPattern != nullptr );
+		CPPUNIT_ASSERT_EQUAL( 144, pPattern->get_length() );
+
+		const Pattern::notes_t* pNotes = pPattern->get_notes();
+		CPPUNIT_ASSERT_EQUAL( 3, static_cast<int>( pNotes->size() ) );
+		CPPUNIT_ASSERT_EQUAL( 2, static_cast<int>( pNotes->count( 0 ) ) );
+
+		// Both kicks are quantized onto the same tick and merged.
+		auto it = pNotes->find( 48 );
+		CPPUNIT_ASSERT( it != pNotes->end() );
+		CPPUNIT_ASSERT( it->second->get_instrument() == m_pInstrumentList->get( 0 ) );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, it->second->get_velocity(), 1e-6 );
+
+		delete pPattern;
+	}
+
+	void testInvalidFile()
+	{
+		QTemporaryFile file;
+		CPPUNIT_ASSERT( file.open() );
+		file.write( "RIFF....WAVE" );
+		file.close();
+
+		SMFReader reader( m_pInstrumentList, 48 );
+		CPPUNIT_ASSERT( reader.import( file.fileName() ) == nullptr );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SMFReaderTest );
@@ -2,10 +2,30 @@
 #include "TestHelper.h"
 
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleArena.h>
+#include <core/Basics/SampleLoader.h>
+#include <core/Basics/SamplePack.h>
+#include <core/Basics/SamplePool.h>
+#include <core/Preferences.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 class SampleTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( SampleTest );
 	CPPUNIT_TEST( testLoadInvalidSample );
+	CPPUNIT_TEST( testLoadCachedSample );
+	CPPUNIT_TEST( testCompactSample );
+	CPPUNIT_TEST( testPackedSample );
+	CPPUNIT_TEST( testSampleLoader );
+	CPPUNIT_TEST( testSamplePool );
+	CPPUNIT_TEST( testLoopedSample );
+	CPPUNIT_TEST( testDeferredEnvelopes );
+	CPPUNIT_TEST( testSilenceDetection );
+	CPPUNIT_TEST( testSampleAnalysis );
+	CPPUNIT_TEST( testSampleArena );
 
 	CPPUNIT_TEST_SUITE_END();
 
@@ -23,6 +43,410 @@ class SampleTest : public CppUnit::TestCase {
 		pSample = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/drumkit.xml") );
 		CPPUNIT_ASSERT(pSample == nullptr);
 	}
+
+	void testLoadCachedSample()
+	{
+		auto pPref = H2Core::Preferences::get_instance();
+		bool bOldCache = pPref->m_bSampleCache;
+		QString sSamplePath = H2TEST_FILE("drumkits/baseKit/snare.wav");
+
+		pPref->m_bSampleCache = false;
+		auto pReference = H2Core::Sample::load( sSamplePath );
+
+		// The first load does fill the cache, the second one maps it.
+		pPref->m_bSampleCache = true;
+		auto pFirst = H2Core::Sample::load( sSamplePath );
+		auto pCached = H2Core::Sample::load( sSamplePath );
+		pPref->m_bSampleCache = bOldCache;
+
+		CPPUNIT_ASSERT( pReference != nullptr );
+		CPPUNIT_ASSERT( pFirst != nullptr );
+		CPPUNIT_ASSERT( pCached != nullptr );
+		CPPUNIT_ASSERT_EQUAL( pReference->get_frames(), pCached->get_frames() );
+		CPPUNIT_ASSERT_EQUAL( pReference->get_sample_rate(), pCached->get_sample_rate() );
+		size_t nBytes = pReference->get_frames() * sizeof( float );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), pCached->get_data_l(), nBytes ) == 0 );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_r(), pCached->get_data_r(), nBytes ) == 0 );
+	}
+
+	void testCompactSample()
+	{
+		auto pPref = H2Core::Preferences::get_instance();
+		bool bOldCache = pPref->m_bSampleCache;
+		// 16 bit mono
+		QString sSamplePath = H2TEST_FILE("drumkits/baseKit/kick.wav");
+
+		pPref->m_bSampleCache = false;
+		auto pReference = H2Core::Sample::load( sSamplePath );
+		H2Core::Sample::set_compact_storage( true );
+		auto pCompact = H2Core::Sample::load( sSamplePath, true );
+		H2Core::Sample::set_compact_storage( false );
+		pPref->m_bSampleCache = bOldCache;
+
+		CPPUNIT_ASSERT( pReference != nullptr );
+		CPPUNIT_ASSERT( pCompact != nullptr );
+		CPPUNIT_ASSERT( pCompact->is_compact() );
+		CPPUNIT_ASSERT_EQUAL( pReference->get_frames(), pCompact->get_frames() );
+		// A single channel of 16 bit integers.
+		CPPUNIT_ASSERT_EQUAL( pReference->get_frames() * static_cast<int>( sizeof( int16_t ) ),
+							  pCompact->get_size() );
+
+		int nFrames = pReference->get_frames();
+		size_t nBytes = nFrames * sizeof( float );
+		std::vector<float> data_L( nFrames ), data_R( nFrames );
+		pCompact->read_frames( 0, nFrames, data_L.data(), data_R.data() );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), data_L.data(), nBytes ) == 0 );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_r(), data_R.data(), nBytes ) == 0 );
+
+		CPPUNIT_ASSERT( pCompact->make_resident() );
+		CPPUNIT_ASSERT( ! pCompact->is_compact() );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), pCompact->get_data_l(), nBytes ) == 0 );
+	}
+
+	void testPackedSample()
+	{
+		auto pPref = H2Core::Preferences::get_instance();
+		bool bOldCache = pPref->m_bSampleCache;
+		// 16 bit mono
+		QString sSamplePath = H2TEST_FILE("drumkits/baseKit/kick.wav");
+		const int nResident = 1000;
+
+		pPref->m_bSampleCache = false;
+		auto pReference = H2Core::Sample::load( sSamplePath );
+		H2Core::Sample::set_packed_storage( nResident );
+		auto pPacked = H2Core::Sample::load( sSamplePath, true );
+		H2Core::Sample::set_packed_storage( 0 );
+		pPref->m_bSampleCache = bOldCache;
+
+		CPPUNIT_ASSERT( pReference != nullptr );
+		CPPUNIT_ASSERT( pPacked != nullptr );
+		CPPUNIT_ASSERT( pReference->get_frames() > nResident );
+		CPPUNIT_ASSERT( pPacked->is_streamed() );
+		CPPUNIT_ASSERT_EQUAL( nResident, pPacked->get_resident_frames() );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), pPacked->get_data_l(),
+								nResident * sizeof( float ) ) == 0 );
+
+		auto pPack = pPacked->get_pack();
+		CPPUNIT_ASSERT( pPack != nullptr );
+		CPPUNIT_ASSERT_EQUAL( pReference->get_frames(), pPack->get_frames() );
+		CPPUNIT_ASSERT( pPack->get_size() <
+						static_cast<size_t>( pReference->get_frames() ) * sizeof( int16_t ) );
+
+		// Lossless
+		std::vector<int16_t> block_L( SAMPLE_PACK_BLOCK ), block_R( SAMPLE_PACK_BLOCK );
+		int nFrame = 0;
+		for ( int nBlock = 0; nBlock < pPack->get_blocks(); ++nBlock ) {
+			int nFrames = pPack->decode_block( nBlock, block_L.data(), block_R.data() );
+			for ( int ii = 0; ii < nFrames; ++ii ) {
+				CPPUNIT_ASSERT_EQUAL( pReference->get_data_l()[ nFrame + ii ],
+									  block_L[ ii ] / 32768.0f );
+				CPPUNIT_ASSERT_EQUAL( pReference->get_data_r()[ nFrame + ii ],
+									  block_R[ ii ] / 32768.0f );
+			}
+			nFrame += nFrames;
+		}
+		CPPUNIT_ASSERT_EQUAL( pReference->get_frames(), nFrame );
+
+		CPPUNIT_ASSERT( pPacked->make_resident() );
+		CPPUNIT_ASSERT( pPacked->get_pack() == nullptr );
+	}
+
+	void testSampleLoader()
+	{
+		QString sKick = H2TEST_FILE("drumkits/baseKit/kick.wav");
+		QString sInvalid = H2TEST_FILE("drumkits/baseKit/drumkit.xml");
+
+		H2Core::SampleLoader loader;
+		loader.add( sKick );
+		loader.add( sKick );
+		loader.add( sInvalid );
+		int nSnare = loader.add( std::make_shared<H2Core::Sample>( H2TEST_FILE("drumkits/baseKit/snare.wav") ) );
+		CPPUNIT_ASSERT_EQUAL( 4, loader.size() );
+
+		loader.run();
+
+		CPPUNIT_ASSERT( loader.is_loaded( nSnare ) );
+		CPPUNIT_ASSERT( loader.take( sInvalid ) == nullptr );
+
+		// Each sample added by path is handed out once. Identical
+		// files are decoded only once and shared.
+		auto pFirst = loader.take( sKick );
+		auto pSecond = loader.take( sKick );
+		CPPUNIT_ASSERT( pFirst != nullptr );
+		CPPUNIT_ASSERT( pSecond != nullptr );
+		CPPUNIT_ASSERT( pFirst == pSecond );
+		CPPUNIT_ASSERT( pFirst->get_frames() > 0 );
+		CPPUNIT_ASSERT( loader.take( sKick ) == nullptr );
+
+		// Samples added by object are loaded in place unless they
+		// are shareable.
+		auto pSnare = std::make_shared<H2Core::Sample>( H2TEST_FILE("drumkits/baseKit/snare.wav") );
+		H2Core::SampleLoader sharingLoader;
+		int nKick = sharingLoader.add( std::make_shared<H2Core::Sample>( sKick ), true );
+		sharingLoader.add( pSnare );
+		sharingLoader.run();
+		CPPUNIT_ASSERT( sharingLoader.get( nKick ) == pFirst );
+		CPPUNIT_ASSERT( sharingLoader.get( 1 ) == pSnare );
+	}
+
+	void testSamplePool()
+	{
+		QString sKick = H2TEST_FILE("drumkits/baseKit/kick.wav");
+
+		auto pFirst = H2Core::SamplePool::load( sKick );
+		auto pSecond = H2Core::SamplePool::load( sKick );
+		CPPUNIT_ASSERT( pFirst != nullptr );
+		CPPUNIT_ASSERT( pFirst == pSecond );
+
+		// Modified samples are keyed by their transformations.
+		H2Core::Sample::Loops loops;
+		loops.end_frame = pFirst->get_frames() / 2;
+		H2Core::Sample::Rubberband rubber;
+		H2Core::Sample::VelocityEnvelope velocity;
+		H2Core::Sample::PanEnvelope pan;
+		auto pModified = H2Core::SamplePool::load( sKick, loops, rubber, velocity, pan );
+		CPPUNIT_ASSERT( pModified != nullptr );
+		CPPUNIT_ASSERT( pModified != pFirst );
+		CPPUNIT_ASSERT( pModified == H2Core::SamplePool::load( sKick, loops, rubber, velocity, pan ) );
+
+		// Entries are evicted on last release.
+		QString sKey = H2Core::SamplePool::key( sKick, false );
+		pFirst.reset();
+		CPPUNIT_ASSERT( H2Core::SamplePool::get( sKey ) != nullptr );
+		pSecond.reset();
+		CPPUNIT_ASSERT( H2Core::SamplePool::get( sKey ) == nullptr );
+	}
+
+	void testLoopedSample()
+	{
+		auto pReference = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/kick.wav") );
+		auto pLooped = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/kick.wav") );
+		CPPUNIT_ASSERT( pReference != nullptr );
+		CPPUNIT_ASSERT( pLooped != nullptr );
+		const int nFrames = pReference->get_frames();
+		const float* pData_L = pReference->get_data_l();
+
+		H2Core::Sample::Loops loops;
+		loops.start_frame = nFrames / 8;
+		loops.loop_frame = nFrames / 4;
+		loops.end_frame = nFrames / 2;
+		loops.count = 3;
+		loops.mode = H2Core::Sample::Loops::PINGPONG;
+		int nFull = loops.end_frame - loops.start_frame;
+		int nLoop = loops.end_frame - loops.loop_frame;
+
+		// The loops are not expanded in memory.
+		CPPUNIT_ASSERT( pLooped->apply_loops( loops ) );
+		CPPUNIT_ASSERT( pLooped->is_deferred() );
+		CPPUNIT_ASSERT_EQUAL( nFull + 3 * nLoop, pLooped->get_frames() );
+		CPPUNIT_ASSERT_EQUAL( 0, pLooped->get_resident_frames() );
+		CPPUNIT_ASSERT( pLooped->get_size() <= pReference->get_size() );
+
+		std::vector<float> data_L( pLooped->get_frames() ), data_R( pLooped->get_frames() );
+		pLooped->read_frames( 0, pLooped->get_frames(), data_L.data(), data_R.data() );
+		for ( int ii = 0; ii < nFull; ++ii ) {
+			CPPUNIT_ASSERT_EQUAL( pData_L[ loops.start_frame + ii ], data_L[ ii ] );
+		}
+		for ( int ii = 0; ii < nLoop; ++ii ) {
+			// Ping pong does start in reverse.
+			CPPUNIT_ASSERT_EQUAL( pData_L[ loops.end_frame - ii ], data_L[ nFull + ii ] );
+			CPPUNIT_ASSERT_EQUAL( pData_L[ loops.loop_frame + ii ], data_L[ nFull + nLoop + ii ] );
+		}
+
+		// Reading in chunks yields the same frames.
+		std::vector<float> chunk_L( 100 ), chunk_R( 100 );
+		pLooped->read_frames( nFull - 50, 100, chunk_L.data(), chunk_R.data() );
+		CPPUNIT_ASSERT( memcmp( chunk_L.data(), data_L.data() + nFull - 50, 100 * sizeof( float ) ) == 0 );
+
+		// Expanding them keeps the content.
+		CPPUNIT_ASSERT( pLooped->make_resident() );
+		CPPUNIT_ASSERT( ! pLooped->is_deferred() );
+		CPPUNIT_ASSERT_EQUAL( pLooped->get_frames(), pLooped->get_resident_frames() );
+		CPPUNIT_ASSERT( memcmp( pLooped->get_data_l(), data_L.data(),
+								data_L.size() * sizeof( float ) ) == 0 );
+	}
+
+	void testDeferredEnvelopes()
+	{
+		auto pReference = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/kick.wav") );
+		auto pSample = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/kick.wav") );
+		CPPUNIT_ASSERT( pReference != nullptr );
+		CPPUNIT_ASSERT( pSample != nullptr );
+		const int nFrames = pReference->get_frames();
+
+		// Fade out over the whole sample.
+		H2Core::Sample::VelocityEnvelope velocity;
+		velocity.push_back( std::make_unique<H2Core::EnvelopePoint>( 0, 0 ) );
+		velocity.push_back( std::make_unique<H2Core::EnvelopePoint>( 841, 91 ) );
+		pSample->apply_velocity( velocity );
+
+		// The data in memory is left untouched.
+		CPPUNIT_ASSERT( pSample->is_deferred() );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), pSample->get_data_l(),
+								nFrames * sizeof( float ) ) == 0 );
+
+		std::vector<float> data_L( nFrames ), data_R( nFrames );
+		pSample->read_frames( 0, nFrames, data_L.data(), data_R.data() );
+		for ( int ii = 0; ii < nFrames; ii += 97 ) {
+			float fGain = 1 - static_cast<float>( ii ) / nFrames;
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( pReference->get_data_l()[ ii ] * fGain, data_L[ ii ], 1e-4 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( pReference->get_data_r()[ ii ] * fGain, data_R[ ii ], 1e-4 );
+		}
+
+		// A new envelope replaces the previous one instead of being
+		// applied on top.
+		H2Core::Sample::VelocityEnvelope flat;
+		flat.push_back( std::make_unique<H2Core::EnvelopePoint>( 0, 0 ) );
+		flat.push_back( std::make_unique<H2Core::EnvelopePoint>( 841, 0 ) );
+		pSample->apply_velocity( flat );
+		pSample->read_frames( 0, nFrames, data_L.data(), data_R.data() );
+		CPPUNIT_ASSERT( memcmp( pReference->get_data_l(), data_L.data(),
+								nFrames * sizeof( float ) ) == 0 );
+
+		// Baking the envelope keeps the content.
+		pSample->apply_velocity( velocity );
+		pSample->read_frames( 0, nFrames, data_L.data(), data_R.data() );
+		CPPUNIT_ASSERT( pSample->make_resident() );
+		CPPUNIT_ASSERT( ! pSample->is_deferred() );
+		CPPUNIT_ASSERT( memcmp( pSample->get_data_l(), data_L.data(),
+								nFrames * sizeof( float ) ) == 0 );
+	}
+
+	void testSilenceDetection()
+	{
+		// Silent head, a burst spanning several blocks, and a
+		// nearly silent tail.
+		const int nFrames = 20000;
+		float* pData_L = new float[ nFrames ];
+		float* pData_R = new float[ nFrames ];
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			pData_L[ ii ] = 0;
+			pData_R[ ii ] = ii >= 5000 ? 1e-6 : 0;
+		}
+		for ( int ii = 1000; ii < 9000; ++ii ) {
+			pData_L[ ii ] = ii % 2 == 0 ? 0.5 : -0.5;
+		}
+		pData_R[ 9500 ] = -0.01;
+		auto pSample = std::make_shared<H2Core::Sample>( "/tmp/silence.wav", nFrames, 44100,
+														 pData_L, pData_R );
+
+		// Disabled by default.
+		pSample->detect_silence();
+		CPPUNIT_ASSERT_EQUAL( 0, pSample->get_audible_start() );
+		CPPUNIT_ASSERT_EQUAL( nFrames, pSample->get_audible_end() );
+
+		H2Core::Sample::set_silence_threshold( 1e-4 );
+		pSample->detect_silence();
+		CPPUNIT_ASSERT_EQUAL( 1000, pSample->get_audible_start() );
+		CPPUNIT_ASSERT_EQUAL( 9501, pSample->get_audible_end() );
+
+		// Copies share the result.
+		auto pCopy = std::make_shared<H2Core::Sample>( pSample );
+		CPPUNIT_ASSERT_EQUAL( 9501, pCopy->get_audible_end() );
+
+		// Modifications discard it.
+		H2Core::Sample::PanEnvelope pan;
+		pan.push_back( std::make_unique<H2Core::EnvelopePoint>( 0, 45 ) );
+		pan.push_back( std::make_unique<H2Core::EnvelopePoint>( 841, 45 ) );
+		pSample->apply_pan( pan );
+		CPPUNIT_ASSERT_EQUAL( 0, pSample->get_audible_start() );
+		CPPUNIT_ASSERT_EQUAL( nFrames, pSample->get_audible_end() );
+
+		// A silent sample ends right away.
+		H2Core::Sample::set_silence_threshold( 1 );
+		pSample->detect_silence();
+		CPPUNIT_ASSERT_EQUAL( 0, pSample->get_audible_end() );
+		H2Core::Sample::set_silence_threshold( 0 );
+	}
+
+	void testSampleAnalysis()
+	{
+		// A soft lead-in, a burst, and a tail below the silence
+		// level.
+		const int nFrames = 20000;
+		float* pData_L = new float[ nFrames ];
+		float* pData_R = new float[ nFrames ];
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			pData_L[ ii ] = 0;
+			pData_R[ ii ] = ii >= 5000 ? 1e-6 : 0;
+		}
+		for ( int ii = 900; ii < 1000; ++ii ) {
+			pData_L[ ii ] = 0.02;
+		}
+		for ( int ii = 1000; ii < 9000; ++ii ) {
+			pData_L[ ii ] = ii % 2 == 0 ? 0.5 : -0.5;
+		}
+		pData_R[ 9500 ] = -0.01;
+		auto pSample = std::make_shared<H2Core::Sample>( "/tmp/analysis.wav", nFrames, 44100,
+														 pData_L, pData_R );
+		CPPUNIT_ASSERT( ! pSample->get_analysis().bValid );
+
+		auto pPeaks = std::make_shared<H2Core::SamplePeaks>( pSample );
+		CPPUNIT_ASSERT( pSample->set_peaks( pPeaks, pSample->get_peaks_generation() ) );
+		H2Core::SampleAnalysis analysis = pSample->get_analysis();
+		CPPUNIT_ASSERT( analysis.bValid );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, analysis.fPeak, 1e-6 );
+		double fSquares = 8000 * 0.25 + 100 * 0.02 * 0.02 + 0.01 * 0.01 +
+			( nFrames - 5000 - 1 ) * 1e-12;
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( std::sqrt( fSquares / ( 2 * nFrames ) ),
+									  analysis.fRms, 1e-5 );
+		CPPUNIT_ASSERT_EQUAL( 1000, analysis.nOnset );
+		CPPUNIT_ASSERT_EQUAL( 9501, analysis.nEnd );
+
+		// The analysis is stored along with the peaks.
+		auto pKick = H2Core::Sample::load( H2TEST_FILE("drumkits/baseKit/kick.wav") );
+		CPPUNIT_ASSERT( pKick != nullptr );
+		H2Core::SamplePeaks built( pKick );
+		built.store( pKick->get_filepath() );
+		auto pLoaded = H2Core::SamplePeaks::load( pKick->get_filepath() );
+		CPPUNIT_ASSERT( pLoaded != nullptr );
+		CPPUNIT_ASSERT( pLoaded->get_analysis().bValid );
+		CPPUNIT_ASSERT_EQUAL( built.get_analysis().fPeak, pLoaded->get_analysis().fPeak );
+		CPPUNIT_ASSERT_EQUAL( built.get_analysis().fRms, pLoaded->get_analysis().fRms );
+		CPPUNIT_ASSERT_EQUAL( built.get_analysis().nOnset, pLoaded->get_analysis().nOnset );
+		CPPUNIT_ASSERT_EQUAL( built.get_analysis().nEnd, pLoaded->get_analysis().nEnd );
+		CPPUNIT_ASSERT( built.get_analysis().fPeak > 0 );
+	}
+
+	void testSampleArena()
+	{
+		auto pPref = H2Core::Preferences::get_instance();
+		auto previousPages = pPref->m_sampleArenaPages;
+		pPref->m_sampleArenaPages = H2Core::Preferences::SampleArenaPages::transparent;
+		const int nRegions = H2Core::SampleArena::get_stats().nRegions;
+
+		std::vector<float*> buffers;
+		for ( int ii = 0; ii < 16; ++ii ) {
+			float* pData = H2Core::SampleArena::allocate( 1000 + ii, "/tmp/arena/sample.wav" );
+			CPPUNIT_ASSERT( pData != nullptr );
+			CPPUNIT_ASSERT( reinterpret_cast<uintptr_t>( pData ) % H2Core::SampleArena::nAlignment == 0 );
+			memset( pData, 0, ( 1000 + ii ) * sizeof( float ) );
+			buffers.push_back( pData );
+		}
+		// Other directories and long samples get regions of their
+		// own.
+		buffers.push_back( H2Core::SampleArena::allocate( 1000, "/tmp/arena2/sample.wav" ) );
+		buffers.push_back( H2Core::SampleArena::allocate( H2Core::SampleArena::nMaxRegionSize / 2,
+														  "/tmp/arena/long.wav" ) );
+#ifndef WIN32
+		CPPUNIT_ASSERT_EQUAL( nRegions + 3, H2Core::SampleArena::get_stats().nRegions );
+#endif
+
+		for ( auto pData : buffers ) {
+			H2Core::SampleArena::deallocate( pData );
+		}
+		CPPUNIT_ASSERT_EQUAL( nRegions, H2Core::SampleArena::get_stats().nRegions );
+
+		// Buffers on the heap are released as well.
+		pPref->m_sampleArenaPages = H2Core::Preferences::SampleArenaPages::heap;
+		float* pHeap = H2Core::SampleArena::allocate( 1000, "/tmp/arena/sample.wav" );
+		CPPUNIT_ASSERT( pHeap != nullptr );
+		CPPUNIT_ASSERT_EQUAL( nRegions, H2Core::SampleArena::get_stats().nRegions );
+		H2Core::SampleArena::deallocate( pHeap );
+		H2Core::SampleArena::deallocate( new float[ 10 ] );
+
+		pPref->m_sampleArenaPages = previousPages;
+	}
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( SampleTest );
@@ -0,0 +1,86 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Hydrogen.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Song.h>
+
+#include "TestHelper.h"
+
+#include <limits>
+
+using namespace H2Core;
+
+class ScheduledNotesTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( ScheduledNotesTest );
+	CPPUNIT_TEST( testValidation );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp()
+	{
+		Song* pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+		CPPUNIT_ASSERT( pSong != nullptr );
+		Hydrogen::get_instance()->setSong( pSong );
+	}
+
+	void testValidation()
+	{
+		Hydrogen* pHydrogen = Hydrogen::get_instance();
+		const Hydrogen::ScheduledNote valid = { 0, 0.8f, -2, 64 };
+
+		CPPUNIT_ASSERT( pHydrogen->scheduleNotes( {}, false ) );
+		CPPUNIT_ASSERT( pHydrogen->scheduleNotes( { valid, valid }, false ) );
+		CPPUNIT_ASSERT( pHydrogen->scheduleNotes( { valid }, true ) );
+
+		auto rejects = [&]( Hydrogen::ScheduledNote invalid ) {
+			return ! pHydrogen->scheduleNotes( { valid, invalid }, false );
+		};
+
+		auto note = valid;
+		note.nInstrument = -1;
+		CPPUNIT_ASSERT( rejects( note ) );
+		note.nInstrument = pHydrogen->getSong()->getInstrumentList()->size();
+		CPPUNIT_ASSERT( rejects( note ) );
+
+		note = valid;
+		note.fVelocity = 1.5;
+		CPPUNIT_ASSERT( rejects( note ) );
+		note.fVelocity = std::numeric_limits<float>::quiet_NaN();
+		CPPUNIT_ASSERT( rejects( note ) );
+
+		note = valid;
+		note.fPitch = Hydrogen::fMaxScheduledPitch + 1;
+		CPPUNIT_ASSERT( rejects( note ) );
+
+		note = valid;
+		note.fOffset = -1;
+		CPPUNIT_ASSERT( rejects( note ) );
+		note.fOffset = 1e9;
+		CPPUNIT_ASSERT( rejects( note ) );
+	}
+};
+CPPUNIT_TEST_SUITE_REGISTRATION( ScheduledNotesTest );
@@ -0,0 +1,67 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/Threads.h>
+
+#include <vector>
+
+using namespace H2Core;
+
+class ThreadsTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( ThreadsTest );
+	CPPUNIT_TEST( testParseCpuList );
+	CPPUNIT_TEST( testParseInvalidCpuList );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testParseCpuList()
+	{
+		bool bOk = false;
+		CPPUNIT_ASSERT( Threads::parseCpuList( "", &bOk ).empty() );
+		CPPUNIT_ASSERT( bOk );
+
+		std::vector<int> expected = { 0, 2, 3, 4, 7 };
+		CPPUNIT_ASSERT( Threads::parseCpuList( "7, 2-4,0", &bOk ) == expected );
+		CPPUNIT_ASSERT( bOk );
+
+		// Overlapping ranges count each CPU once.
+		expected = { 1, 2, 3 };
+		CPPUNIT_ASSERT( Threads::parseCpuList( "1-3,2", &bOk ) == expected );
+		CPPUNIT_ASSERT( bOk );
+	}
+
+	void testParseInvalidCpuList()
+	{
+		const char* invalid[] = { "a", "1-", "-1", "3-1", "1-2-3", "1;2" };
+		for ( const char* sCpus : invalid ) {
+			bool bOk = true;
+			CPPUNIT_ASSERT( Threads::parseCpuList( sCpus, &bOk ).empty() );
+			CPPUNIT_ASSERT( ! bOk );
+		}
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ThreadsTest );
@@ -0,0 +1,92 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/TickTime.h>
+
+#include <cmath>
+
+using namespace H2Core;
+
+class TickTimeTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( TickTimeTest );
+	CPPUNIT_TEST( testInverse );
+	CPPUNIT_TEST( testLargeFrames );
+	CPPUNIT_TEST( testNegativeFrames );
+	CPPUNIT_TEST( testRescale );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testInverse()
+	{
+		// The tick size of this tempo is not representable as a
+		// float.
+		const int64_t nTickSize = TickTime::tickSize( 44100, 133.7, 192 );
+		CPPUNIT_ASSERT( nTickSize > 0 );
+
+		for ( long long nTick = 0; nTick < 1000000; ++nTick ) {
+			const long long nFrame = TickTime::frameAtTick( nTick, nTickSize );
+			CPPUNIT_ASSERT_EQUAL( nTick, TickTime::tickAtFrame( nFrame, nTickSize ) );
+			CPPUNIT_ASSERT_EQUAL( nTick - 1, TickTime::tickAtFrame( nFrame - 1, nTickSize ) );
+			CPPUNIT_ASSERT_EQUAL( 0LL, TickTime::framesIntoTick( nFrame, nTickSize ) );
+		}
+	}
+
+	void testLargeFrames()
+	{
+		const int64_t nTickSize = TickTime::tickSize( 48000, 97.3, 192 );
+		const long long nFrame = ( 1LL << 42 ) + 12345;
+		const long double fReference = static_cast<long double>( nFrame ) *
+			TickTime::nOneFrame / nTickSize;
+		const long long nTick = TickTime::tickAtFrame( nFrame, nTickSize );
+		CPPUNIT_ASSERT_EQUAL( static_cast<long long>( std::floor( fReference ) ), nTick );
+		CPPUNIT_ASSERT( TickTime::frameAtTick( nTick, nTickSize ) <= nFrame );
+		CPPUNIT_ASSERT( TickTime::frameAtTick( nTick + 1, nTickSize ) > nFrame );
+	}
+
+	void testNegativeFrames()
+	{
+		const int64_t nTickSize = TickTime::tickSize( 44100, 120, 192 );
+		CPPUNIT_ASSERT_EQUAL( -1LL, TickTime::tickAtFrame( -1, nTickSize ) );
+		CPPUNIT_ASSERT_EQUAL( -1LL, TickTime::tickAtFrame(
+			TickTime::frameAtTick( -1, nTickSize ), nTickSize ) );
+		CPPUNIT_ASSERT_EQUAL( 0LL, TickTime::tickAtFrame( 0, nTickSize ) );
+	}
+
+	void testRescale()
+	{
+		// Slowing down and back again restores the original
+		// position.
+		const int64_t nFast = TickTime::tickSize( 44100, 133.7, 192 );
+		const int64_t nSlow = TickTime::tickSize( 44100, 61.3, 192 );
+		for ( long long nFrame = 0; nFrame < 10000000; nFrame += 997 ) {
+			CPPUNIT_ASSERT_EQUAL( nFrame, TickTime::rescale(
+				TickTime::rescale( nFrame, nFast, nSlow ), nSlow, nFast ) );
+		}
+		CPPUNIT_ASSERT_EQUAL( 1234LL, TickTime::rescale( 1234, 0, nSlow ) );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TickTimeTest );
@@ -5,6 +5,7 @@
 #include <core/AudioEngine.h>
 #include <core/Hydrogen.h>
 #include <core/Basics/Song.h>
+#include <core/Timeline.h>
 #include <core/Helpers/Filesystem.h>
 
 #include <cmath>
@@ -74,3 +75,74 @@ void TimeTest::testElapsedTime(){
 	CPPUNIT_ASSERT( std::abs( locateAndLookupTime( 5 ) - 10.7875 ) < 0.0001 );
 	CPPUNIT_ASSERT( std::abs( locateAndLookupTime( 2 ) - 3.98958 ) < 0.0001 );
 }
+
+void TimeTest::testTempoMap(){
+
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pSong = pHydrogen->getSong();
+	auto pTimeline = pHydrogen->getTimeline();
+	auto pCoreActionController = pHydrogen->getCoreActionController();
+
+	pTimeline->deleteAllTempoMarkers();
+	pCoreActionController->addTempoMarker( 1, 120 );
+	pCoreActionController->addTempoMarker( 3, 100 );
+
+	long nTickBar1 = pSong->getColumnStartTick( 1 );
+	long nTickBar3 = pSong->getColumnStartTick( 3 );
+	double fTimeBar1 = nTickBar1 * 60.0 / ( 120 * pSong->getResolution() );
+	double fTimeBar3 = fTimeBar1 +
+		( nTickBar3 - nTickBar1 ) * 60.0 / ( 120 * pSong->getResolution() );
+
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( 0, pSong ) ) < 1e-9 );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar1, pSong ) - fTimeBar1 ) < 1e-9 );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar3, pSong ) - fTimeBar3 ) < 1e-9 );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar3 + 80, pSong ) -
+							  ( fTimeBar3 + 80 * 60.0 / ( 100 * pSong->getResolution() ) ) ) < 1e-9 );
+
+	for ( long nTick : { 0L, nTickBar1 - 1, nTickBar1, nTickBar3 + 17, 5 * nTickBar3 } ) {
+		double fTime = pTimeline->getTimeAtTick( nTick, pSong );
+		CPPUNIT_ASSERT( std::abs( pTimeline->getTickAtTime( fTime, pSong ) - nTick ) < 1e-6 );
+	}
+
+	// Editing the markers has to invalidate the map.
+	pCoreActionController->deleteTempoMarker( 3 );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar3, pSong ) -
+							  nTickBar3 * 60.0 / ( 120 * pSong->getResolution() ) ) < 1e-9 );
+}
+
+void TimeTest::testTempoRamp(){
+
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pSong = pHydrogen->getSong();
+	auto pTimeline = pHydrogen->getTimeline();
+	auto pCoreActionController = pHydrogen->getCoreActionController();
+
+	pTimeline->deleteAllTempoMarkers();
+	pCoreActionController->addTempoMarker( 1, 120 );
+	pCoreActionController->addTempoMarker( 3, 60, true );
+
+	long nTickBar1 = pSong->getColumnStartTick( 1 );
+	long nTickBar3 = pSong->getColumnStartTick( 3 );
+	double fTicksPerSecond1 = 120.0 * pSong->getResolution() / 60.0;
+	double fTicksPerSecond3 = 60.0 * pSong->getResolution() / 60.0;
+	double fSlope = ( fTicksPerSecond3 - fTicksPerSecond1 ) / ( nTickBar3 - nTickBar1 );
+	double fTimeBar1 = nTickBar1 / fTicksPerSecond1;
+	double fTimeBar3 = fTimeBar1 + std::log( fTicksPerSecond3 / fTicksPerSecond1 ) / fSlope;
+
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar1, pSong ) - fTimeBar1 ) < 1e-9 );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTimeAtTick( nTickBar3, pSong ) - fTimeBar3 ) < 1e-9 );
+
+	bool bRamp = false;
+	double fMiddle = ( nTickBar1 + nTickBar3 ) / 2.0;
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTempoAtTick( fMiddle, pSong, &bRamp ) - 90 ) < 1e-3 );
+	CPPUNIT_ASSERT( bRamp );
+	CPPUNIT_ASSERT( std::abs( pTimeline->getTempoAtTick( nTickBar3 + 1, pSong, &bRamp ) - 60 ) < 1e-3 );
+	CPPUNIT_ASSERT( ! bRamp );
+
+	for ( long nTick : { nTickBar1 + 1, ( nTickBar1 + nTickBar3 ) / 2, nTickBar3 - 1, nTickBar3 + 17 } ) {
+		double fTime = pTimeline->getTimeAtTick( nTick, pSong );
+		CPPUNIT_ASSERT( std::abs( pTimeline->getTickAtTime( fTime, pSong ) - nTick ) < 1e-6 );
+	}
+
+	pTimeline->deleteAllTempoMarkers();
+}
@@ -7,6 +7,8 @@
 class TimeTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE( TimeTest );
 	CPPUNIT_TEST( testElapsedTime );
+	CPPUNIT_TEST( testTempoMap );
+	CPPUNIT_TEST( testTempoRamp );
 	CPPUNIT_TEST_SUITE_END();
 	
 private:
@@ -29,5 +31,17 @@ public:
 	 * within the song to check the calculation of the elapsed time.
 	 */
 	void testElapsedTime();
+
+	/**
+	 * Converts ticks into time and back using the tempo map of the
+	 * Timeline.
+	 */
+	void testTempoMap();
+
+	/**
+	 * Checks the time and tempo within a ramp between two tempo
+	 * markers against the closed-form integral.
+	 */
+	void testTempoRamp();
 };
 CPPUNIT_TEST_SUITE_REGISTRATION( TimeTest );
@@ -0,0 +1,143 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Tracer.h>
+#include <core/Helpers/Filesystem.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <thread>
+
+using namespace H2Core;
+
+class TracerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( TracerTest );
+	CPPUNIT_TEST( testDump );
+	CPPUNIT_TEST( testRingBuffer );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** \return Events of @a sFile written by Tracer::dump().*/
+	static QJsonArray readTrace( const QString& sFile )
+	{
+		QFile file( sFile );
+		CPPUNIT_ASSERT( file.open( QIODevice::ReadOnly ) );
+		QJsonParseError error;
+		QJsonDocument doc = QJsonDocument::fromJson( file.readAll(), &error );
+		CPPUNIT_ASSERT_EQUAL( QJsonParseError::NoError, error.error );
+		return doc.object()[ "traceEvents" ].toArray();
+	}
+
+	/** \return Number of events in @a events named @a sName.*/
+	static int count( const QJsonArray& events, const QString& sName )
+	{
+		int nCount = 0;
+		for ( const auto& event : events ) {
+			if ( event.toObject()[ "name" ].toString() == sName ) {
+				++nCount;
+			}
+		}
+		return nCount;
+	}
+
+public:
+	void setUp() override
+	{
+		Tracer::setEnabled( true );
+		Tracer::reset();
+	}
+
+	void tearDown() override
+	{
+		Tracer::setEnabled( false );
+	}
+
+	void testDump()
+	{
+		std::thread thread( [] {
+			Tracer::setThreadName( "Test thread" );
+			{
+				Tracer::Scope outer( "outer" );
+				Tracer::Scope inner( "inner" );
+			}
+			Tracer::instant( "xrun" );
+		} );
+		thread.join();
+
+		Tracer::setEnabled( false );
+		{
+			Tracer::Scope ignored( "ignored" );
+		}
+
+		QString sFile = Filesystem::tmp_file_path( "tracer.test.json" );
+		CPPUNIT_ASSERT( Tracer::dump( sFile ) );
+		QJsonArray events = readTrace( sFile );
+
+		CPPUNIT_ASSERT_EQUAL( 1, count( events, "outer" ) );
+		CPPUNIT_ASSERT_EQUAL( 1, count( events, "inner" ) );
+		CPPUNIT_ASSERT_EQUAL( 1, count( events, "xrun" ) );
+		CPPUNIT_ASSERT_EQUAL( 0, count( events, "ignored" ) );
+
+		bool bNamed = false;
+		for ( const auto& value : events ) {
+			QJsonObject event = value.toObject();
+			if ( event[ "ph" ].toString() == "M" &&
+				 event[ "args" ].toObject()[ "name" ].toString() == "Test thread" ) {
+				bNamed = true;
+			}
+			if ( event[ "name" ].toString() == "outer" ) {
+				CPPUNIT_ASSERT_EQUAL( QString( "X" ), event[ "ph" ].toString() );
+				CPPUNIT_ASSERT( event[ "dur" ].toDouble() >= 0 );
+			}
+		}
+		CPPUNIT_ASSERT( bNamed );
+	}
+
+	void testRingBuffer()
+	{
+		std::thread thread( [] {
+			for ( int ii = 0; ii < 2 * TRACER_EVENTS; ++ii ) {
+				Tracer::Scope scope( "loop" );
+			}
+		} );
+		thread.join();
+
+		QString sFile = Filesystem::tmp_file_path( "tracer.test.json" );
+		CPPUNIT_ASSERT( Tracer::dump( sFile ) );
+		int nLoops = count( readTrace( sFile ), "loop" );
+		// Only the most recent events are kept.
+		CPPUNIT_ASSERT( nLoops > TRACER_EVENTS / 2 );
+		CPPUNIT_ASSERT( nLoops <= TRACER_EVENTS );
+
+		Tracer::reset();
+		CPPUNIT_ASSERT( Tracer::dump( sFile ) );
+		CPPUNIT_ASSERT_EQUAL( 0, count( readTrace( sFile ), "loop" ) );
+	}
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TracerTest );
@@ -9,6 +9,9 @@
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+#include <core/Basics/PatternList.h>
+#include <core/Preferences.h>
 
 #include <core/Helpers/Filesystem.h>
 #include <core/Helpers/Xml.h>
@@ -196,6 +199,93 @@ void XmlTest::testPattern()
 	delete dk0;
 }
 
+void XmlTest::testSongCache()
+{
+	auto pPref = H2Core::Preferences::get_instance();
+	bool bOldCache = pPref->m_bSongCache;
+	QString sSongPath = H2TEST_FILE( "functional/test.h2song" );
+
+	pPref->m_bSongCache = false;
+	H2Core::Song* pReference = H2Core::Song::load( sSongPath );
+
+	// The first load does fill the cache, the second one restores it.
+	pPref->m_bSongCache = true;
+	H2Core::Song* pFirst = H2Core::Song::load( sSongPath );
+	H2Core::Song* pCached = H2Core::Song::load( sSongPath );
+	pPref->m_bSongCache = bOldCache;
+
+	CPPUNIT_ASSERT( pReference != nullptr );
+	CPPUNIT_ASSERT( pFirst != nullptr );
+	CPPUNIT_ASSERT( pCached != nullptr );
+	CPPUNIT_ASSERT( pReference->getName() == pCached->getName() );
+	CPPUNIT_ASSERT_EQUAL( pReference->getBpm(), pCached->getBpm() );
+	CPPUNIT_ASSERT( pReference->getFilename() == pCached->getFilename() );
+	CPPUNIT_ASSERT( ! pCached->getIsModified() );
+
+	H2Core::InstrumentList* pRefInstruments = pReference->getInstrumentList();
+	H2Core::InstrumentList* pCachedInstruments = pCached->getInstrumentList();
+	CPPUNIT_ASSERT_EQUAL( pRefInstruments->size(), pCachedInstruments->size() );
+	for ( int ii = 0; ii < pRefInstruments->size(); ++ii ) {
+		auto pRefInstr = pRefInstruments->get( ii );
+		auto pCachedInstr = pCachedInstruments->get( ii );
+		CPPUNIT_ASSERT_EQUAL( pRefInstr->get_id(), pCachedInstr->get_id() );
+		CPPUNIT_ASSERT( pRefInstr->get_name() == pCachedInstr->get_name() );
+		CPPUNIT_ASSERT_EQUAL( pRefInstr->get_volume(), pCachedInstr->get_volume() );
+		CPPUNIT_ASSERT_EQUAL( pRefInstr->get_components()->size(),
+							  pCachedInstr->get_components()->size() );
+	}
+
+	H2Core::PatternList* pRefPatterns = pReference->getPatternList();
+	H2Core::PatternList* pCachedPatterns = pCached->getPatternList();
+	CPPUNIT_ASSERT_EQUAL( pRefPatterns->size(), pCachedPatterns->size() );
+	for ( int ii = 0; ii < pRefPatterns->size(); ++ii ) {
+		CPPUNIT_ASSERT( pRefPatterns->get( ii )->get_name() ==
+						pCachedPatterns->get( ii )->get_name() );
+		CPPUNIT_ASSERT_EQUAL( pRefPatterns->get( ii )->get_notes()->size(),
+							  pCachedPatterns->get( ii )->get_notes()->size() );
+	}
+	CPPUNIT_ASSERT_EQUAL( pReference->getPatternGroupVector()->size(),
+						  pCached->getPatternGroupVector()->size() );
+
+	delete pReference;
+	delete pFirst;
+	delete pCached;
+}
+
+void XmlTest::testXmlWriter()
+{
+	QString sText = "a<b&c\"d]]>e>f \t\n\u00e9";
+
+	H2Core::XMLDoc doc;
+	H2Core::XMLNode root = doc.set_root( "song" );
+	root.write_string( "name", sText );
+	root.write_string( "empty", "" );
+	root.write_bool( "enabled", true );
+	H2Core::XMLNode list = root.createNode( "list" );
+	H2Core::XMLNode item = list.createNode( "item" );
+	item.write_attribute( "value", sText );
+	item.write_string( "id", "1" );
+	list.createNode( "item" );
+	root.createNode( "emptyList" );
+
+	H2Core::XMLWriter writer;
+	writer.start_element( "song" );
+	writer.write_string( "name", sText );
+	writer.write_string( "empty", "" );
+	writer.write_bool( "enabled", true );
+	writer.start_element( "list" );
+	writer.start_element( "item" );
+	writer.write_attribute( "value", sText );
+	writer.write_string( "id", "1" );
+	writer.end_element();
+	writer.start_element( "item" );
+	writer.end_element();
+	writer.end_element();
+	writer.start_element( "emptyList" );
+
+	CPPUNIT_ASSERT( doc.toString( 1 ).toUtf8() == writer.finish() );
+}
+
 void XmlTest::tearDown() {
 
 	QDirIterator it( TestHelper::get_instance()->getTestDataDir(),
@@ -9,6 +9,8 @@ class XmlTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testDrumkit_UpgradeInvalidADSRValues);
 	CPPUNIT_TEST(testPattern);
 	CPPUNIT_TEST(testShippedDrumkits);
+	CPPUNIT_TEST(testSongCache);
+	CPPUNIT_TEST(testXmlWriter);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
@@ -20,6 +22,12 @@ class XmlTest : public CppUnit::TestCase {
 		// Check whether the drumkits provided alongside this repo can
 		// be validated against the drumkit XSD.
 		void testShippedDrumkits();
+		// Check whether a song restored from the SongCache matches
+		// the one read from XML.
+		void testSongCache();
+		// Check whether the XMLWriter produces the same output as
+		// the DOM.
+		void testXmlWriter();
 	
 };
 